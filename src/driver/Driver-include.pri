@@ -1,4 +1,4 @@
 INCLUDEPATH *= $$PWD
 
 # Windows
-LIBS *= -lfwpuclnt -ladvapi32 -lkernel32 -luser32 -lshell32 -luuid -lversion -lws2_32 -lwtsapi32 -lbcrypt
+LIBS *= -lfwpuclnt -ladvapi32 -lkernel32 -luser32 -lshell32 -luuid -lversion -lws2_32 -lwtsapi32 -lbcrypt -ldnsapi -ltdh
@@ -6,16 +6,23 @@ QT = core
 
 SOURCES += \
     fortbuf.c \
+    fortcache.c \
     fortcb.c \
     fortcnf.c \
     fortcout.c \
     fortdbg.c \
     fortdev.c \
     fortdrv.c \
+    fortetw.c \
+    forthash.c \
+    forthost.c \
+    fortmem.c \
     fortmod.c \
+    fortperf.c \
     fortpkt.c \
     fortpool.c \
     fortps.c \
+    fortrate.c \
     fortscb.c \
     fortstat.c \
     forttds.c \
@@ -32,6 +39,7 @@ SOURCES += \
     proxycb/fortpcb_dst.c \
     proxycb/fortpcb_src.c \
     test/main.c \
+    test/replay.c \
     wdm/um_aux_klib.c \
     wdm/um_fwpmk.c \
     wdm/um_fwpsk.c \
@@ -43,6 +51,7 @@ SOURCES += \
 HEADERS += \
     evt/fortevt.h \
     fortbuf.h \
+    fortcache.h \
     fortcb.h \
     fortcnf.h \
     fortcout.h \
@@ -50,10 +59,16 @@ HEADERS += \
     fortdbg.h \
     fortdev.h \
     fortdrv.h \
+    fortetw.h \
+    forthash.h \
+    forthost.h \
+    fortmem.h \
     fortmod.h \
+    fortperf.h \
     fortpkt.h \
     fortpool.h \
     fortps.h \
+    fortrate.h \
     fortscb.h \
     fortstat.h \
     forttds.h \
@@ -70,6 +85,7 @@ HEADERS += \
     proxycb/fortpcb_drv.h \
     proxycb/fortpcb_dst.h \
     proxycb/fortpcb_src.h \
+    test/replay.h \
     wdm/um_aux_klib.h \
     wdm/um_fwpmk.h \
     wdm/um_fwpsk.h \
@@ -19,6 +19,7 @@
 #    include <ntifs.h> /* Before ntddk.h */
 
 #    include <ntddk.h>
+#    include <ntintsafe.h>
 #    include <winerror.h>
 
 #    include <fwpmk.h>
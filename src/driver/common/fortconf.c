@@ -8,13 +8,14 @@
 #include "fortdef.h"
 
 static_assert(sizeof(ip6_addr_t) == 16, "ip6_addr_t size mismatch");
+static_assert(sizeof(FORT_CONF_IP6) == sizeof(ip6_addr_t), "FORT_CONF_IP6 size mismatch");
 
 static_assert(sizeof(FORT_CONF_FLAGS) == sizeof(UINT32), "FORT_CONF_FLAGS size mismatch");
-static_assert(sizeof(FORT_TRAF) == sizeof(UINT64), "FORT_TRAF size mismatch");
+static_assert(sizeof(FORT_TRAF) == 2 * sizeof(UINT64), "FORT_TRAF size mismatch");
 static_assert(sizeof(FORT_TIME) == sizeof(UINT16), "FORT_TIME size mismatch");
 static_assert(sizeof(FORT_PERIOD) == sizeof(UINT32), "FORT_PERIOD size mismatch");
 static_assert(sizeof(FORT_APP_FLAGS) == sizeof(UINT16), "FORT_APP_FLAGS size mismatch");
-static_assert(sizeof(FORT_APP_ENTRY) == 2 * sizeof(UINT32), "FORT_APP_ENTRY size mismatch");
+static_assert(sizeof(FORT_APP_ENTRY) == 3 * sizeof(UINT32), "FORT_APP_ENTRY size mismatch");
 
 #ifndef FORT_DRIVER
 #    define fort_memcmp memcmp
@@ -41,7 +42,8 @@ FORT_API BOOL is_time_in_period(FORT_TIME time, FORT_PERIOD period)
     return (from <= to ? (x >= from && x < (to - 1)) : (x >= from || x < (to - 1)));
 }
 
-static BOOL fort_conf_ip4_find(const UINT32 *iparr, UINT32 ip, UINT32 count, BOOL is_range)
+static BOOL fort_conf_ip4_find(const UINT32 *iparr, UINT32 ip, UINT32 count,
+        const UINT32 *ipindex, UCHAR index_bits, BOOL is_range)
 {
     if (count == 0)
         return FALSE;
@@ -49,7 +51,20 @@ static BOOL fort_conf_ip4_find(const UINT32 *iparr, UINT32 ip, UINT32 count, BOO
     int low = 0;
     int high = count - 1;
 
-    do {
+    /* Narrow the search to the bucket of high bits of address */
+    if (ipindex != NULL) {
+        const UINT32 bucket = ip >> (32 - index_bits);
+
+        low = ipindex[bucket];
+        high = ipindex[bucket + 1] - 1;
+
+        /* The range from the previous bucket may contain the address */
+        if (is_range && low > 0) {
+            --low;
+        }
+    }
+
+    while (low <= high) {
         const int mid = (low + high) / 2;
         const UINT32 mid_ip = iparr[mid];
 
@@ -59,7 +74,7 @@ static BOOL fort_conf_ip4_find(const UINT32 *iparr, UINT32 ip, UINT32 count, BOO
             low = mid + 1;
         else
             return TRUE;
-    } while (low <= high);
+    }
 
     if (!is_range)
         return FALSE;
@@ -98,16 +113,77 @@ static BOOL fort_conf_ip6_find(
             && fort_ip6_cmp(ip, &iparr[count + high]) <= 0;
 }
 
-#define fort_conf_ip4_inarr(iparr, ip, count)                                                      \
-    fort_conf_ip4_find(iparr, ip, count, /*is_range=*/FALSE)
+#define fort_ip6_u64_cmp(l, r)                                                                     \
+    ((l)->hi != (r)->hi ? ((l)->hi < (r)->hi ? -1 : 1)                                             \
+                        : ((l)->lo != (r)->lo ? ((l)->lo < (r)->lo ? -1 : 1) : 0))
+
+static BOOL fort_conf_ip6_u64_find(const FORT_CONF_IP6 *iparr, const FORT_CONF_IP6 *ip,
+        UINT32 count, const UINT32 *ipindex, UCHAR index_bits, BOOL is_range)
+{
+    if (count == 0)
+        return FALSE;
+
+    int low = 0;
+    int high = count - 1;
+
+    /* Narrow the search to the bucket of high bits of address */
+    if (ipindex != NULL) {
+        const UINT32 bucket = (UINT32) (ip->hi >> (64 - index_bits));
+
+        low = ipindex[bucket];
+        high = ipindex[bucket + 1] - 1;
+
+        /* The range from the previous bucket may contain the address */
+        if (is_range && low > 0) {
+            --low;
+        }
+    }
+
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+        const FORT_CONF_IP6 *mid_ip = &iparr[mid];
+
+        const int res = fort_ip6_u64_cmp(ip, mid_ip);
+        if (res < 0)
+            high = mid - 1;
+        else if (res > 0)
+            low = mid + 1;
+        else
+            return TRUE;
+    }
+
+    if (!is_range)
+        return FALSE;
+
+    return high >= 0 && fort_ip6_u64_cmp(ip, &iparr[high]) >= 0
+            && fort_ip6_u64_cmp(ip, &iparr[count + high]) <= 0;
+}
+
+static void fort_conf_ip6_u64_set(PFORT_CONF_IP6 ip6_u64, const ip6_addr_t *ip6)
+{
+    /* Network byte order of address to the comparable integers */
+    ip6_u64->hi = _byteswap_uint64(ip6->lo64);
+    ip6_u64->lo = _byteswap_uint64(ip6->hi64);
+}
 
-#define fort_conf_ip4_inrange(iprange, ip, count)                                                  \
-    fort_conf_ip4_find(iprange, ip, count, /*is_range=*/TRUE)
+#define fort_conf_ip4_inarr(iparr, ip, count, ipindex, index_bits)                                 \
+    fort_conf_ip4_find(iparr, ip, count, ipindex, index_bits, /*is_range=*/FALSE)
+
+#define fort_conf_ip4_inrange(iprange, ip, count, ipindex, index_bits)                             \
+    fort_conf_ip4_find(iprange, ip, count, ipindex, index_bits, /*is_range=*/TRUE)
 
 #define fort_conf_addr_list_ip4_ref(addr_list) (addr_list)->ip
 
 #define fort_conf_addr_list_pair4_ref(addr_list) &(addr_list)->ip[(addr_list)->ip_n]
 
+#define fort_conf_addr_list_index4_ref(addr_list)                                                  \
+    ((addr_list)->index_bits == 0                                                                  \
+                    ? NULL                                                                         \
+                    : &(addr_list)->ip[(addr_list)->ip_n + (addr_list)->pair_n * 2])
+
+#define fort_conf_addr_list_pair_index_ref(addr_list, ipindex)                                     \
+    ((ipindex) == NULL ? NULL : (ipindex) + FORT_CONF_IP_INDEX_N((addr_list)->index_bits))
+
 #define fort_conf_ip6_inarr(iparr, ip, count)                                                      \
     fort_conf_ip6_find(iparr, ip, count, /*is_range=*/FALSE)
 
@@ -118,25 +194,179 @@ static BOOL fort_conf_ip6_find(
 
 #define fort_conf_addr_list_pair6_ref(addr6_list) &(addr6_list)->ip[(addr6_list)->ip_n]
 
+#define fort_conf_ip6_u64_inarr(iparr, ip, count, ipindex, index_bits)                             \
+    fort_conf_ip6_u64_find(iparr, ip, count, ipindex, index_bits, /*is_range=*/FALSE)
+
+#define fort_conf_ip6_u64_inrange(iprange, ip, count, ipindex, index_bits)                         \
+    fort_conf_ip6_u64_find(iprange, ip, count, ipindex, index_bits, /*is_range=*/TRUE)
+
+#define fort_conf_addr_list_ip6_u64_ref(addr6_list) ((const FORT_CONF_IP6 *) (addr6_list)->ip)
+
+#define fort_conf_addr_list_pair6_u64_ref(addr6_list)                                              \
+    ((const FORT_CONF_IP6 *) &(addr6_list)->ip[(addr6_list)->ip_n])
+
+#define fort_conf_addr_list_index6_ref(addr6_list)                                                 \
+    ((addr6_list)->index_bits == 0                                                                 \
+                    ? NULL                                                                         \
+                    : (const UINT32 *) &(addr6_list)->ip[(addr6_list)->ip_n                        \
+                            + (addr6_list)->pair_n * 2])
+
+static BOOL fort_conf_ip6_inlist(const ip6_addr_t *ip6, const PFORT_CONF_ADDR6_LIST addr6_list)
+{
+    /* Old format of cached zones */
+    if (!addr6_list->is_ip_u64) {
+        return fort_conf_ip6_inarr(fort_conf_addr_list_ip6_ref(addr6_list), ip6, addr6_list->ip_n)
+                || fort_conf_ip6_inrange(
+                        fort_conf_addr_list_pair6_ref(addr6_list), ip6, addr6_list->pair_n);
+    }
+
+    FORT_CONF_IP6 ip6_u64;
+    fort_conf_ip6_u64_set(&ip6_u64, ip6);
+
+    const UINT32 *ipindex = fort_conf_addr_list_index6_ref(addr6_list);
+    const UINT32 *pairindex = fort_conf_addr_list_pair_index_ref(addr6_list, ipindex);
+    const UCHAR index_bits = addr6_list->index_bits;
+
+    return fort_conf_ip6_u64_inarr(fort_conf_addr_list_ip6_u64_ref(addr6_list), &ip6_u64,
+                   addr6_list->ip_n, ipindex, index_bits)
+            || fort_conf_ip6_u64_inrange(fort_conf_addr_list_pair6_u64_ref(addr6_list), &ip6_u64,
+                    addr6_list->pair_n, pairindex, index_bits);
+}
+
+static UINT32 fort_conf_ip_varint_read(const UCHAR **data)
+{
+    const UCHAR *p = *data;
+    UINT32 v = 0;
+    int shift = 0;
+    UCHAR c;
+
+    do {
+        c = *p++;
+        v |= (UINT32) (c & 0x7F) << shift;
+        shift += 7;
+    } while ((c & 0x80) != 0 && shift < 35);
+
+    *data = p;
+
+    return v;
+}
+
+static BOOL fort_conf_ip4_packed_inlist(UINT32 ip, const PFORT_CONF_ADDR4_LIST addr_list)
+{
+    const UINT32 count = addr_list->ip_n;
+    if (count == 0)
+        return FALSE;
+
+    const int blocks_n = FORT_CONF_IP_BLOCKS_N(count);
+    const UINT32 *block_ips = addr_list->ip;
+    const UINT32 *block_offs = block_ips + blocks_n;
+    const UCHAR *blocks_data = (const UCHAR *) (block_offs + blocks_n + 1);
+
+    /* Find the last block, which starts at or before the address */
+    int low = 0;
+    int high = blocks_n - 1;
+
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+
+        if (ip < block_ips[mid])
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+
+    if (high < 0)
+        return FALSE;
+
+    /* Decode the block: length of the first range, then gaps and lengths of the next ones */
+    const UCHAR *data = blocks_data + block_offs[high];
+    const UCHAR *end = blocks_data + block_offs[high + 1];
+
+    UINT32 from = block_ips[high];
+    UINT32 to = from + fort_conf_ip_varint_read(&data);
+
+    for (;;) {
+        if (ip <= to)
+            return TRUE;
+
+        if (data >= end)
+            return FALSE;
+
+        from = to + fort_conf_ip_varint_read(&data);
+        if (ip < from)
+            return FALSE;
+
+        to = from + fort_conf_ip_varint_read(&data);
+    }
+}
+
+FORT_API UCHAR fort_conf_ip_index_bits(UINT32 ip_n, UINT32 pair_n)
+{
+    const UINT32 count = (ip_n > pair_n) ? ip_n : pair_n;
+
+    if (count < FORT_CONF_IP_INDEX_MIN_COUNT)
+        return 0;
+
+    UCHAR index_bits = 1;
+    while (index_bits < FORT_CONF_IP_INDEX_BITS_MAX
+            && (count >> index_bits) > FORT_CONF_IP_INDEX_BUCKET) {
+        ++index_bits;
+    }
+
+    return index_bits;
+}
+
 FORT_API BOOL fort_conf_ip_inlist(
         const UINT32 *ip, const PFORT_CONF_ADDR4_LIST addr_list, BOOL isIPv6)
 {
     if (isIPv6) {
         const ip6_addr_t *ip6 = (const ip6_addr_t *) ip;
-        const PFORT_CONF_ADDR6_LIST addr6_list =
-                (const PFORT_CONF_ADDR6_LIST)((const PCHAR) addr_list
-                        + FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n));
+        const PFORT_CONF_ADDR6_LIST addr6_list = (const PFORT_CONF_ADDR6_LIST)(
+                (const PCHAR) addr_list + FORT_CONF_ADDR4_LIST_REF_SIZE(addr_list));
 
-        return fort_conf_ip6_inarr(fort_conf_addr_list_ip6_ref(addr6_list), ip6, addr6_list->ip_n)
-                || fort_conf_ip6_inrange(
-                        fort_conf_addr_list_pair6_ref(addr6_list), ip6, addr6_list->pair_n);
+        return fort_conf_ip6_inlist(ip6, addr6_list);
+    } else if (addr_list->is_packed) {
+        return fort_conf_ip4_packed_inlist(*ip, addr_list);
     } else {
-        return fort_conf_ip4_inarr(fort_conf_addr_list_ip4_ref(addr_list), *ip, addr_list->ip_n)
-                || fort_conf_ip4_inrange(
-                        fort_conf_addr_list_pair4_ref(addr_list), *ip, addr_list->pair_n);
+        const UINT32 *ipindex = fort_conf_addr_list_index4_ref(addr_list);
+        const UINT32 *pairindex = fort_conf_addr_list_pair_index_ref(addr_list, ipindex);
+        const UCHAR index_bits = addr_list->index_bits;
+
+        return fort_conf_ip4_inarr(fort_conf_addr_list_ip4_ref(addr_list), *ip, addr_list->ip_n,
+                       ipindex, index_bits)
+                || fort_conf_ip4_inrange(fort_conf_addr_list_pair4_ref(addr_list), *ip,
+                        addr_list->pair_n, pairindex, index_bits);
     }
 }
 
+FORT_API UINT32 fort_conf_zones_ip4_mask(const PFORT_CONF_ZONES zones, UINT32 ip)
+{
+    const UINT32 count = zones->index_n;
+    if (count == 0)
+        return 0;
+
+    const UINT32 *from_arr = (const UINT32 *) (zones->data + zones->index_off);
+    const UINT32 *to_arr = from_arr + count;
+    const UINT32 *mask_arr = to_arr + count;
+
+    int low = 0;
+    int high = count - 1;
+
+    do {
+        const int mid = (low + high) / 2;
+        const UINT32 mid_ip = from_arr[mid];
+
+        if (ip < mid_ip)
+            high = mid - 1;
+        else if (ip > mid_ip)
+            low = mid + 1;
+        else
+            return mask_arr[mid];
+    } while (low <= high);
+
+    return (high >= 0 && ip <= to_arr[high]) ? mask_arr[high] : 0;
+}
+
 FORT_API PFORT_CONF_ADDR_GROUP fort_conf_addr_group_ref(const PFORT_CONF conf, int addr_group_index)
 {
     const UINT32 *addr_group_offsets = (const UINT32 *) (conf->data + conf->addr_groups_off);
@@ -232,6 +462,31 @@ static FORT_APP_ENTRY fort_conf_app_find_loop(const PFORT_CONF conf, const PVOID
     return app_data;
 }
 
+FORT_API UINT32 fort_conf_app_path_hash(const PVOID path, UINT32 path_len)
+{
+    const UCHAR *p = (const UCHAR *) path;
+
+    /* FNV-1a by 4 path chars at once, the high bits are folded to be mixed by the next step */
+    UINT64 hash = 14695981039346656037ull;
+
+    for (; path_len >= sizeof(UINT64); path_len -= sizeof(UINT64), p += sizeof(UINT64)) {
+        UINT64 v;
+        RtlCopyMemory(&v, p, sizeof(UINT64));
+
+        hash ^= v;
+        hash *= 1099511628211ull;
+        hash ^= (hash >> 32);
+    }
+
+    /* The rest path chars */
+    for (; path_len >= sizeof(UINT16); path_len -= sizeof(UINT16), p += sizeof(UINT16)) {
+        hash ^= *((const UINT16 *) p);
+        hash *= 1099511628211ull;
+    }
+
+    return (UINT32) (hash ^ (hash >> 32));
+}
+
 FORT_API FORT_APP_ENTRY fort_conf_app_exe_find(
         const PFORT_CONF conf, PVOID context, const PVOID path, UINT32 path_len)
 {
@@ -241,60 +496,228 @@ FORT_API FORT_APP_ENTRY fort_conf_app_exe_find(
             conf, path, path_len, conf->exe_apps_off, conf->exe_apps_n, fort_conf_app_exe_equal);
 }
 
-static FORT_APP_ENTRY fort_conf_app_wild_find(
-        const PFORT_CONF conf, const PVOID path, UINT32 path_len)
+#define fort_conf_wild_buckets_ref(matcher) ((const PFORT_CONF_WILD_BUCKET) (matcher)->data)
+
+#define fort_conf_wild_items_ref(matcher)                                                          \
+    ((const PFORT_CONF_WILD_ITEM) (fort_conf_wild_buckets_ref(matcher) + (matcher)->buckets_n))
+
+#define fort_conf_wild_apps_ref(matcher)                                                           \
+    ((const char *) (fort_conf_wild_items_ref(matcher) + (matcher)->items_n))
+
+/* Returns 0, when the prefix is a prefix of the path */
+static int fort_conf_wild_prefix_cmp(
+        const WCHAR *prefix, UINT32 prefix_len, const WCHAR *path, UINT32 path_len)
 {
-    return fort_conf_app_find_loop(
-            conf, path, path_len, conf->wild_apps_off, conf->wild_apps_n, fort_conf_app_wild_equal);
+    const UINT32 len = (prefix_len < path_len ? prefix_len : path_len) / sizeof(WCHAR);
+
+    for (UINT32 i = 0; i < len; ++i) {
+        if (prefix[i] != path[i])
+            return (prefix[i] < path[i]) ? -1 : 1;
+    }
+
+    return (prefix_len <= path_len) ? 0 : 1;
 }
 
-static int fort_conf_app_prefix_cmp(PFORT_APP_ENTRY app_entry, const PVOID path, UINT32 path_len)
+static const WCHAR *fort_conf_wild_bucket_prefix(
+        const PFORT_CONF_WILD_MATCHER matcher, const PFORT_CONF_WILD_BUCKET bucket)
 {
-    const PVOID app_path = app_entry + 1;
-    const UINT32 app_path_len = app_entry->path_len;
+    const PFORT_CONF_WILD_ITEM item = &fort_conf_wild_items_ref(matcher)[bucket->items_i];
+    const PFORT_APP_ENTRY app_entry =
+            (const PFORT_APP_ENTRY) (fort_conf_wild_apps_ref(matcher) + item->app_off);
 
-    if (path_len > app_path_len)
-        path_len = app_path_len;
+    return (const WCHAR *) (app_entry + 1);
+}
+
+static int fort_conf_wild_bucket_cmp(const PFORT_CONF_WILD_MATCHER matcher, UINT16 bucket_i,
+        const PVOID path, UINT32 path_len)
+{
+    const PFORT_CONF_WILD_BUCKET bucket = &fort_conf_wild_buckets_ref(matcher)[bucket_i];
 
-    return fort_memcmp(path, app_path, path_len);
+    return fort_conf_wild_prefix_cmp(fort_conf_wild_bucket_prefix(matcher, bucket),
+            bucket->prefix_len, (const WCHAR *) path, path_len);
 }
 
-static FORT_APP_ENTRY fort_conf_app_prefix_find(
+/* Find the deepest bucket, which literal prefix is a prefix of the path */
+static UINT16 fort_conf_wild_bucket_find(
+        const PFORT_CONF_WILD_MATCHER matcher, const PVOID path, UINT32 path_len)
+{
+    const PFORT_CONF_WILD_BUCKET buckets = fort_conf_wild_buckets_ref(matcher);
+
+    /* Find the last bucket, which prefix is less or equal to the path */
+    UINT16 bucket_i = FORT_CONF_WILD_NONE;
+    int low = 0, high = matcher->buckets_n - 1;
+
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+
+        if (fort_conf_wild_bucket_cmp(matcher, (UINT16) mid, path, path_len) <= 0) {
+            bucket_i = (UINT16) mid;
+            low = mid + 1;
+        } else {
+            high = mid - 1;
+        }
+    }
+
+    /* Only its parents may be prefixes of the path */
+    while (bucket_i != FORT_CONF_WILD_NONE
+            && fort_conf_wild_bucket_cmp(matcher, bucket_i, path, path_len) != 0) {
+        bucket_i = buckets[bucket_i].parent;
+    }
+
+    return bucket_i;
+}
+
+static BOOL fort_conf_wild_item_equal(const PFORT_CONF_WILD_ITEM item,
+        const PFORT_APP_ENTRY app_entry, const PVOID path, UINT32 path_len, UINT16 prefix_len)
+{
+    const UINT16 suffix_len = item->suffix_len;
+
+    if (path_len < (UINT32) prefix_len + suffix_len)
+        return FALSE;
+
+    /* Check the literal suffix before the full match */
+    const char *app_path = (const char *) (app_entry + 1);
+
+    if (fort_memcmp((const char *) path + path_len - suffix_len,
+                app_path + app_entry->path_len - suffix_len, suffix_len)
+            != 0)
+        return FALSE;
+
+    return fort_conf_app_wild_equal(app_entry, path, path_len);
+}
+
+static FORT_APP_ENTRY fort_conf_app_wild_find(
         const PFORT_CONF conf, const PVOID path, UINT32 path_len)
 {
     FORT_APP_ENTRY app_data;
     app_data.flags.v = 0;
 
-    const UINT16 count = conf->prefix_apps_n;
-    if (count == 0)
+    if (conf->wild_apps_n == 0)
         return app_data;
 
-    const char *data = conf->data;
-    const UINT32 *app_offsets = (const UINT32 *) (data + conf->prefix_apps_off);
+    const PFORT_CONF_WILD_MATCHER matcher =
+            (const PFORT_CONF_WILD_MATCHER) (conf->data + conf->wild_apps_off);
 
-    const char *app_entries = (const char *) (app_offsets + count + 1);
-    int low = 0;
-    int high = count - 1;
+    const PFORT_CONF_WILD_BUCKET buckets = fort_conf_wild_buckets_ref(matcher);
+    const PFORT_CONF_WILD_ITEM items = fort_conf_wild_items_ref(matcher);
+    const char *app_entries = fort_conf_wild_apps_ref(matcher);
 
-    do {
-        const int mid = (low + high) / 2;
-        const UINT32 app_off = app_offsets[mid];
-        const PFORT_APP_ENTRY app_entry = (PFORT_APP_ENTRY) (app_entries + app_off);
+    UINT32 best_app_i = matcher->items_n;
+
+    /* Check the items of the deepest matched bucket and all its parents */
+    UINT16 bucket_i = fort_conf_wild_bucket_find(matcher, path, path_len);
+
+    for (; bucket_i != FORT_CONF_WILD_NONE; bucket_i = buckets[bucket_i].parent) {
+        const PFORT_CONF_WILD_BUCKET bucket = &buckets[bucket_i];
+
+        const PFORT_CONF_WILD_ITEM bucket_items = &items[bucket->items_i];
+
+        for (UINT16 i = 0; i < bucket->items_n; ++i) {
+            const PFORT_CONF_WILD_ITEM item = &bucket_items[i];
+
+            if (item->app_i >= best_app_i)
+                break; /* items are sorted by priority */
+
+            const PFORT_APP_ENTRY app_entry = (const PFORT_APP_ENTRY) (app_entries + item->app_off);
+
+            if (fort_conf_wild_item_equal(item, app_entry, path, path_len, bucket->prefix_len)) {
+                best_app_i = item->app_i;
+                app_data = *app_entry;
+                break;
+            }
+        }
+    }
 
-        const int res = fort_conf_app_prefix_cmp(app_entry, path, path_len);
+    return app_data;
+}
+
+static PFORT_CONF_PREFIX_NODE fort_conf_prefix_child_find(
+        const PFORT_CONF_PREFIX_NODE nodes, const PFORT_CONF_PREFIX_NODE node, const char *apps,
+        WCHAR c)
+{
+    const PFORT_CONF_PREFIX_NODE children = &nodes[node->children_i];
+
+    int low = 0, high = node->children_n - 1;
+
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+        const PFORT_CONF_PREFIX_NODE child = &children[mid];
+        const WCHAR label_c = *((const WCHAR *) (apps + child->label_off));
 
-        if (res < 0) {
+        if (c < label_c) {
             high = mid - 1;
-        } else if (res > 0) {
+        } else if (c > label_c) {
             low = mid + 1;
         } else {
-            return *app_entry;
+            return child;
         }
-    } while (low <= high);
+    }
+
+    return NULL;
+}
+
+static FORT_APP_ENTRY fort_conf_app_prefix_find(
+        const PFORT_CONF conf, const PVOID path, UINT32 path_len)
+{
+    FORT_APP_ENTRY app_data;
+    app_data.flags.v = 0;
+
+    if (conf->prefix_apps_n == 0)
+        return app_data;
+
+    const PFORT_CONF_PREFIX_TRIE trie =
+            (const PFORT_CONF_PREFIX_TRIE) (conf->data + conf->prefix_apps_off);
+
+    const PFORT_CONF_PREFIX_NODE nodes = (const PFORT_CONF_PREFIX_NODE) trie->data;
+    const char *apps = (const char *) (nodes + trie->nodes_n);
+
+    const char *p = (const char *) path;
+    UINT32 app_off = FORT_CONF_PREFIX_NONE;
+    UINT32 pos = 0;
+
+    /* Descend to the deepest node, which label path is a prefix of the path */
+    PFORT_CONF_PREFIX_NODE node = nodes;
+    for (;;) {
+        if (node->app_off != FORT_CONF_PREFIX_NONE) {
+            app_off = node->app_off; /* the longest prefix so far */
+        }
+
+        if (pos >= path_len || node->children_n == 0)
+            break;
+
+        node = fort_conf_prefix_child_find(nodes, node, apps, *((const WCHAR *) (p + pos)));
+        if (node == NULL)
+            break;
+
+        const UINT16 label_len = node->label_len;
+        if (pos + label_len > path_len
+                || fort_memcmp(p + pos, apps + node->label_off, label_len) != 0)
+            break;
+
+        pos += label_len;
+    }
+
+    if (app_off != FORT_CONF_PREFIX_NONE) {
+        app_data = *((const PFORT_APP_ENTRY) (apps + app_off));
+    }
 
     return app_data;
 }
 
+FORT_API FORT_APP_ENTRY fort_conf_app_pattern_find(
+        const PFORT_CONF conf, const PVOID path, UINT32 path_len)
+{
+    FORT_APP_ENTRY app_entry;
+
+    app_entry = fort_conf_app_wild_find(conf, path, path_len);
+    if (app_entry.flags.v != 0)
+        return app_entry;
+
+    app_entry = fort_conf_app_prefix_find(conf, path, path_len);
+
+    return app_entry;
+}
+
 FORT_API FORT_APP_ENTRY fort_conf_app_find(const PFORT_CONF conf, const PVOID path, UINT32 path_len,
         fort_conf_app_exe_find_func *exe_find_func, PVOID exe_context)
 {
@@ -304,13 +727,149 @@ FORT_API FORT_APP_ENTRY fort_conf_app_find(const PFORT_CONF conf, const PVOID pa
     if (app_entry.flags.v != 0)
         return app_entry;
 
-    app_entry = fort_conf_app_wild_find(conf, path, path_len);
-    if (app_entry.flags.v != 0)
-        return app_entry;
+    return fort_conf_app_pattern_find(conf, path, path_len);
+}
 
-    app_entry = fort_conf_app_prefix_find(conf, path, path_len);
+static BOOL fort_conf_rule_ports_find(
+        const PFORT_CONF_RULE_PORTS ports_arr, UINT16 count, UINT16 port)
+{
+    int low = 0;
+    int high = count - 1;
 
-    return app_entry;
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+
+        if (port < ports_arr[mid].from)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+
+    return high >= 0 && port <= ports_arr[high].to;
+}
+
+static BOOL fort_conf_rule_addr_included(
+        const char *rules_data, UINT32 addr_off, const UINT32 *ip, BOOL isIPv6)
+{
+    if (addr_off == 0)
+        return TRUE; /* any address */
+
+    const PFORT_CONF_ADDR_GROUP addr_group = (const PFORT_CONF_ADDR_GROUP) (rules_data + addr_off);
+
+    return !addr_group->include_is_empty
+            && fort_conf_ip_inlist(
+                    ip, fort_conf_addr_group_include_list_ref(addr_group), isIPv6);
+}
+
+static BOOL fort_conf_rule_matched(
+        const char *rules_data, const PFORT_CONF_RULE rule, const PFORT_CONF_RULE_CONN conn)
+{
+    if (rule->inbound != conn->inbound)
+        return FALSE;
+
+    if (rule->equal_ports && conn->local_port != conn->remote_port)
+        return FALSE;
+
+    if (rule->local_ports_n != 0
+            && !fort_conf_rule_ports_find(
+                    (const PFORT_CONF_RULE_PORTS) (rules_data + rule->local_ports_off),
+                    rule->local_ports_n, conn->local_port))
+        return FALSE;
+
+    return fort_conf_rule_addr_included(
+                   rules_data, rule->remote_addr_off, conn->remote_ip, conn->isIPv6)
+            && fort_conf_rule_addr_included(
+                    rules_data, rule->local_addr_off, conn->local_ip, conn->isIPv6);
+}
+
+static const PFORT_CONF_RULE_PROTO fort_conf_rules_proto(
+        const PFORT_CONF_RULES rules, UINT16 ip_proto)
+{
+    const PFORT_CONF_RULE_PROTO protos = rules->protos;
+
+    int low = 0;
+    int high = rules->protos_n - 1;
+
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+        const UINT16 mid_proto = protos[mid].ip_proto;
+
+        if (ip_proto < mid_proto)
+            high = mid - 1;
+        else if (ip_proto > mid_proto)
+            low = mid + 1;
+        else
+            return &protos[mid];
+    }
+
+    /* Rules of any protocol */
+    if (rules->protos_n != 0 && protos[rules->protos_n - 1].ip_proto == FORT_CONF_RULE_PROTO_ANY)
+        return &protos[rules->protos_n - 1];
+
+    return NULL;
+}
+
+static const PFORT_CONF_RULE_RANGE fort_conf_rules_range(
+        const PFORT_CONF_RULE_RANGE ranges, UINT16 count, UINT16 port)
+{
+    int low = 0;
+    int high = count - 1;
+
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+
+        if (port < ranges[mid].ports.from)
+            high = mid - 1;
+        else
+            low = mid + 1;
+    }
+
+    return (high >= 0 && port <= ranges[high].ports.to) ? &ranges[high] : NULL;
+}
+
+FORT_API PFORT_CONF_RULE fort_conf_rules_find(
+        const PFORT_CONF conf, const PFORT_CONF_RULE_CONN conn)
+{
+    const char *rules_data = conf->data + conf->rules_off;
+    const PFORT_CONF_RULES rules = (const PFORT_CONF_RULES) rules_data;
+
+    if (rules->rules_n == 0)
+        return NULL;
+
+    /* Lookup the protocol bucket and then the range of remote ports */
+    const PFORT_CONF_RULE_PROTO proto = fort_conf_rules_proto(rules, conn->ip_proto);
+    if (proto == NULL)
+        return NULL;
+
+    const PFORT_CONF_RULE_RANGE ranges =
+            (const PFORT_CONF_RULE_RANGE) (rules_data + rules->ranges_off) + proto->ranges_i;
+
+    const PFORT_CONF_RULE_RANGE range =
+            fort_conf_rules_range(ranges, proto->ranges_n, conn->remote_port);
+    if (range == NULL)
+        return NULL;
+
+    /* Check the candidate rules in priority order */
+    const UINT16 *list = (const UINT16 *) (rules_data + rules->lists_off) + range->list_i;
+    const PFORT_CONF_RULE rules_arr = (const PFORT_CONF_RULE) (rules_data + rules->rules_off);
+
+    const UINT16 count = *list++;
+
+    for (UINT16 i = 0; i < count; ++i) {
+        const PFORT_CONF_RULE rule = &rules_arr[list[i]];
+
+        if (fort_conf_rule_matched(rules_data, rule, conn))
+            return rule;
+    }
+
+    return NULL;
+}
+
+FORT_API BOOL fort_conf_rules_has_locals(const PFORT_CONF conf)
+{
+    const PFORT_CONF_RULES rules = (const PFORT_CONF_RULES) (conf->data + conf->rules_off);
+
+    return rules->locals_n != 0;
 }
 
 static BOOL fort_conf_app_blocked_check(const PFORT_CONF conf, INT8 *block_reason, BOOL app_found,
@@ -357,6 +916,93 @@ FORT_API BOOL fort_conf_app_blocked(
     return fort_conf_app_blocked_check(conf, block_reason, app_found, app_allowed, app_blocked);
 }
 
+/* The subnets' broadcasts are not known by the address: only the limited broadcast is */
+FORT_API UCHAR fort_conf_log_filter_addr_classes(const UINT32 *ip, BOOL isIPv6)
+{
+    if (isIPv6) {
+        const UCHAR *ip6 = (const UCHAR *) ip;
+
+        if (ip6[0] == 0xFF)
+            return FORT_LOG_FILTER_ADDR_MULTICAST; /* ff00::/8 */
+
+        if (ip6[0] == 0xFE && (ip6[1] & 0xC0) == 0x80)
+            return FORT_LOG_FILTER_ADDR_LINK_LOCAL; /* fe80::/10 */
+
+        return 0;
+    }
+
+    const UINT32 ip4 = *ip;
+
+    if (ip4 == 0xFFFFFFFF)
+        return FORT_LOG_FILTER_ADDR_BROADCAST; /* 255.255.255.255 */
+
+    if ((ip4 >> 28) == 0xE)
+        return FORT_LOG_FILTER_ADDR_MULTICAST; /* 224.0.0.0/4 */
+
+    if ((ip4 >> 16) == 0xA9FE)
+        return FORT_LOG_FILTER_ADDR_LINK_LOCAL; /* 169.254.0.0/16 */
+
+    return 0;
+}
+
+inline static BOOL fort_conf_log_filter_port_check(
+        const FORT_CONF_RULE_PORTS *ports, UINT16 port)
+{
+    return port >= ports->from && port <= ports->to;
+}
+
+/* Returns the index of the first matched filter or -1 */
+FORT_API int fort_conf_log_filter_find(const PFORT_CONF conf, BOOL inbound, UCHAR ip_proto,
+        UINT16 local_port, UINT16 remote_port, UCHAR addr_classes)
+{
+    const int filters_n = conf->log_filters_n;
+
+    for (int i = 0; i < filters_n; ++i) {
+        const FORT_CONF_LOG_FILTER *filter = &conf->log_filters[i];
+
+        if (filter->ip_proto != 0 && filter->ip_proto != ip_proto)
+            continue;
+
+        if (!(inbound ? filter->inbound : filter->outbound))
+            continue;
+
+        if (filter->addr_classes != 0 && (filter->addr_classes & addr_classes) == 0)
+            continue;
+
+        if (fort_conf_log_filter_port_check(&filter->local_ports, local_port)
+                && fort_conf_log_filter_port_check(&filter->remote_ports, remote_port))
+            return i;
+    }
+
+    return -1;
+}
+
+FORT_API BOOL fort_conf_udp_light_port(const PFORT_CONF conf, UINT16 port)
+{
+    const int ports_n = conf->udp_light_ports_n;
+
+    for (int i = 0; i < ports_n; ++i) {
+        if (fort_conf_log_filter_port_check(&conf->udp_light_ports[i], port))
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/* The service sorts by it too, so the bytes are compared as unsigned */
+FORT_API int fort_conf_file_id_cmp(const PFORT_FILE_ID l, const PFORT_FILE_ID r)
+{
+    if (l->volume_serial != r->volume_serial)
+        return (l->volume_serial < r->volume_serial) ? -1 : 1;
+
+    for (UINT32 i = 0; i < sizeof(l->id); ++i) {
+        if (l->id[i] != r->id[i])
+            return (l->id[i] < r->id[i]) ? -1 : 1;
+    }
+
+    return 0;
+}
+
 FORT_API UINT16 fort_conf_app_period_bits(const PFORT_CONF conf, FORT_TIME time, int *periods_n)
 {
     UINT8 count = conf->app_periods_n;
@@ -392,6 +1038,54 @@ FORT_API UINT16 fort_conf_app_period_bits(const PFORT_CONF conf, FORT_TIME time,
     return period_bits;
 }
 
+inline static int fort_conf_app_period_delta(int x, int boundary)
+{
+    const int day_minutes = 24 * 60;
+
+    const int delta = (boundary - x + day_minutes) % day_minutes;
+
+    return (delta == 0) ? day_minutes : delta;
+}
+
+/* Minutes till the next boundary of the app groups periods, 0 if there are no periods */
+FORT_API int fort_conf_app_period_next(const PFORT_CONF conf, FORT_TIME time)
+{
+    UINT8 count = conf->app_periods_n;
+
+    if (count == 0)
+        return 0;
+
+    const char *data = conf->data;
+    PFORT_PERIOD app_periods = (const PFORT_PERIOD)(data + conf->app_periods_off);
+    const UINT16 group_bits = (UINT16) conf->flags.group_bits;
+    const int x = time.hour * 60 + time.minute;
+    int next = 0;
+
+    for (int i = 0; i < FORT_CONF_GROUP_MAX; ++i) {
+        const UINT16 bit = (1 << i);
+        const FORT_PERIOD period = *app_periods++;
+
+        if ((group_bits & bit) != 0 && period.v != 0) {
+            /* See is_time_in_period() for the boundaries */
+            const int from = period.from.hour * 60 + period.from.minute;
+            const int to = period.to.hour * 60 + period.to.minute - 1;
+
+            const int from_delta = fort_conf_app_period_delta(x, from);
+            const int to_delta = fort_conf_app_period_delta(x, to);
+            const int delta = (from_delta < to_delta) ? from_delta : to_delta;
+
+            if (next == 0 || delta < next) {
+                next = delta;
+            }
+
+            if (--count == 0)
+                break;
+        }
+    }
+
+    return next;
+}
+
 FORT_API void fort_conf_app_perms_mask_init(PFORT_CONF conf, UINT32 group_bits)
 {
     UINT32 perms_mask = (group_bits & 0x0001) | ((group_bits & 0x0002) << 1)
@@ -408,3 +1102,40 @@ FORT_API void fort_conf_app_perms_mask_init(PFORT_CONF conf, UINT32 group_bits)
     conf->app_perms_block_mask = (perms_mask & 0xAAAAAAAA);
     conf->app_perms_allow_mask = (perms_mask & 0x55555555);
 }
+
+FORT_API UINT32 fort_conf_cache_checksum(const PVOID data, UINT32 size)
+{
+    const UCHAR *p = (const UCHAR *) data;
+
+    /* FNV-1a by bytes */
+    UINT32 hash = 2166136261u;
+
+    while (size-- != 0) {
+        hash ^= *p++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+FORT_API BOOL fort_conf_cache_check(const PFORT_CONF_CACHE cache, UINT32 size)
+{
+    if (size < FORT_CONF_CACHE_DATA_OFF || cache->magic != FORT_CONF_CACHE_MAGIC)
+        return FALSE;
+
+    const UINT32 conf_size = cache->conf_size;
+    const UINT32 zones_size = cache->zones_size;
+
+    if (conf_size <= sizeof(FORT_CONF_IO) || conf_size > size || zones_size > size)
+        return FALSE;
+
+    if (zones_size != 0 && zones_size < FORT_CONF_ZONES_DATA_OFF)
+        return FALSE;
+
+    const UINT32 data_size = FORT_CONF_CACHE_DATA_SIZE(conf_size, zones_size);
+
+    if (size != FORT_CONF_CACHE_DATA_OFF + data_size)
+        return FALSE;
+
+    return fort_conf_cache_checksum(cache->data, data_size) == cache->checksum;
+}
@@ -3,11 +3,19 @@
 
 #include "common.h"
 
-#define FORT_CONF_IP_MAX              (2 * 1024 * 1024)
+#define FORT_CONF_IP_MAX              (16 * 1024 * 1024) /* limited by ip_n bits */
 #define FORT_CONF_IP4_ARR_SIZE(n)     ((n) * sizeof(UINT32))
 #define FORT_CONF_IP6_ARR_SIZE(n)     ((n) * sizeof(ip6_addr_t))
 #define FORT_CONF_IP4_RANGE_SIZE(n)   (FORT_CONF_IP4_ARR_SIZE(n) * 2)
 #define FORT_CONF_IP6_RANGE_SIZE(n)   (FORT_CONF_IP6_ARR_SIZE(n) * 2)
+#define FORT_CONF_IP_INDEX_MIN_COUNT  1024
+#define FORT_CONF_IP_INDEX_BITS_MAX   20
+#define FORT_CONF_IP_INDEX_BUCKET     8 /* average count of addresses per index bucket */
+#define FORT_CONF_IP_INDEX_N(n)       ((n) == 0 ? 0 : ((1 << (n)) + 1))
+#define FORT_CONF_IP_INDEX_SIZE(n)    (FORT_CONF_IP4_ARR_SIZE(FORT_CONF_IP_INDEX_N(n)) * 2)
+#define FORT_CONF_IP_PACK_MIN_COUNT   (64 * 1024) /* pack the larger IPv4 lists */
+#define FORT_CONF_IP_BLOCK_N          16 /* count of delta-encoded ranges per block */
+#define FORT_CONF_IP_BLOCKS_N(n)      (((n) + FORT_CONF_IP_BLOCK_N - 1) / FORT_CONF_IP_BLOCK_N)
 #define FORT_CONF_ZONE_MAX            32
 #define FORT_CONF_GROUP_MAX           16
 #define FORT_CONF_APPS_LEN_MAX        (64 * 1024 * 1024)
@@ -41,7 +49,7 @@ typedef struct fort_conf_flags
     UINT32 log_blocked_ip : 1;
     UINT32 log_alerted_blocked_ip : 1;
 
-    UINT32 reserved : 1; /* DUMMY */
+    UINT32 log_flow_stat : 1;
 
     UINT32 group_bits : 16;
 } FORT_CONF_FLAGS, *PFORT_CONF_FLAGS;
@@ -49,6 +57,7 @@ typedef struct fort_conf_flags
 typedef struct fort_service_info
 {
     UINT32 process_id;
+    UINT32 service_tag; /* of the shared svchost's threads, 0 if unknown */
 
     UINT16 name_len;
     WCHAR name[2];
@@ -71,15 +80,25 @@ typedef struct fort_service_info_list
 
 typedef struct fort_conf_addr4_list
 {
-    UINT32 ip_n;
-    UINT32 pair_n;
+    UINT32 ip_n : 24; /* count of ranges, when packed */
+    UINT32 index_bits : 7; /* bits of the optional index by high bits of address */
+    UINT32 is_packed : 1; /* ranges are delta-encoded by blocks */
+    UINT32 pair_n; /* size of blocks data, when packed */
 
     UINT32 ip[1];
 } FORT_CONF_ADDR4_LIST, *PFORT_CONF_ADDR4_LIST;
 
+typedef struct fort_conf_ip6
+{
+    UINT64 hi;
+    UINT64 lo;
+} FORT_CONF_IP6, *PFORT_CONF_IP6;
+
 typedef struct fort_conf_addr6_list
 {
-    UINT32 ip_n;
+    UINT32 ip_n : 24;
+    UINT32 index_bits : 7; /* bits of the optional index by high bits of address */
+    UINT32 is_ip_u64 : 1; /* addresses are stored as FORT_CONF_IP6 */
     UINT32 pair_n;
 
     ip6_addr_t ip[1];
@@ -105,11 +124,23 @@ typedef struct fort_conf_zones
     UINT32 mask;
     UINT32 enabled_mask;
 
+    UINT32 index_n; /* count of disjoint IPv4 ranges of the merged zones index */
+    UINT32 index_off;
+    UINT32 index_mask; /* zones of the merged index, the packed ones are looked up by their own */
+
     UINT32 addr_off[FORT_CONF_ZONE_MAX];
 
     char data[4];
 } FORT_CONF_ZONES, *PFORT_CONF_ZONES;
 
+typedef struct fort_conf_zone
+{
+    UCHAR zone_id;
+    UCHAR enabled;
+
+    char data[4]; /* address list */
+} FORT_CONF_ZONE, *PFORT_CONF_ZONE;
+
 typedef struct fort_conf_zone_flag
 {
     UCHAR zone_id;
@@ -118,17 +149,27 @@ typedef struct fort_conf_zone_flag
 
 typedef struct fort_traf
 {
-    union {
-        UINT64 v;
-
-        struct
-        {
-            UINT32 in_bytes;
-            UINT32 out_bytes;
-        };
-    };
+    UINT64 in_bytes;
+    UINT64 out_bytes;
 } FORT_TRAF, *PFORT_TRAF;
 
+typedef struct fort_flow_traf
+{
+    UINT64 in_bytes;
+    UINT64 out_bytes;
+    UINT64 in_packets;
+    UINT64 out_packets;
+} FORT_FLOW_TRAF, *PFORT_FLOW_TRAF;
+
+typedef struct fort_shaper_stat
+{
+    UINT64 queued_bytes;
+    UINT64 passed_bytes;
+    UINT64 dropped_bytes;
+    UINT32 passed_packets;
+    UINT32 dropped_packets;
+} FORT_SHAPER_STAT, *PFORT_SHAPER_STAT;
+
 typedef struct fort_time
 {
     union {
@@ -184,15 +225,135 @@ typedef struct fort_app_entry
 {
     FORT_APP_FLAGS flags;
     UINT16 path_len;
-    UINT16 accept_zones;
+    UINT16 accept_zones; /* of the first 16 zones */
     UINT16 reject_zones;
+    UINT32 app_id; /* of the conf's exe app, 0 for the wildcard & added by driver apps */
 } FORT_APP_ENTRY, *PFORT_APP_ENTRY;
 
+#define FORT_CONF_WILD_NONE 0xFFFF
+
+typedef struct fort_conf_wild_bucket
+{
+    UINT16 parent; /* nearest bucket, which literal prefix is a prefix of this one */
+    UINT16 prefix_len; /* literal prefix length in bytes */
+    UINT16 items_i;
+    UINT16 items_n;
+} FORT_CONF_WILD_BUCKET, *PFORT_CONF_WILD_BUCKET;
+
+typedef struct fort_conf_wild_item
+{
+    UINT16 app_i; /* app entry index: lower index has a higher priority */
+    UINT16 suffix_len; /* literal suffix length in bytes */
+    UINT32 app_off;
+} FORT_CONF_WILD_ITEM, *PFORT_CONF_WILD_ITEM;
+
+/* Wildcard app entries bucketed by their literal prefixes, sorted by prefix */
+typedef struct fort_conf_wild_matcher
+{
+    UINT16 buckets_n;
+    UINT16 items_n;
+
+    char data[4]; /* buckets, items and then app entries */
+} FORT_CONF_WILD_MATCHER, *PFORT_CONF_WILD_MATCHER;
+
+#define FORT_CONF_PREFIX_NONE 0xFFFFFFFF
+
+typedef struct fort_conf_prefix_node
+{
+    UINT32 app_off; /* app entry, which path ends at this node */
+    UINT32 label_off; /* label is a part of some app entry's path */
+    UINT16 label_len; /* in bytes */
+    UINT16 children_n;
+    UINT32 children_i; /* children are sorted by the first label char */
+} FORT_CONF_PREFIX_NODE, *PFORT_CONF_PREFIX_NODE;
+
+/* Radix trie of prefix app entries, the root node is the first one */
+typedef struct fort_conf_prefix_trie
+{
+    UINT32 nodes_n;
+
+    char data[4]; /* nodes and then app entries */
+} FORT_CONF_PREFIX_TRIE, *PFORT_CONF_PREFIX_TRIE;
+
+#define FORT_CONF_RULE_PROTO_ANY  0x100 /* bucket of other protocols, sorted last */
+#define FORT_CONF_RULE_PORT_MAX   0xFFFF
+#define FORT_CONF_RULES_MAX       0xFFFF
+
+typedef struct fort_conf_rule_ports
+{
+    UINT16 from;
+    UINT16 to;
+} FORT_CONF_RULE_PORTS, *PFORT_CONF_RULE_PORTS;
+
+typedef struct fort_conf_rule
+{
+    UINT16 block : 1;
+    UINT16 inbound : 1;
+    UINT16 equal_ports : 1; /* local port equals to remote port */
+
+    UINT16 local_ports_n; /* sorted disjoint ranges of local ports */
+    UINT32 local_ports_off;
+
+    UINT32 local_addr_off; /* FORT_CONF_ADDR_GROUP with the include list only, 0 for any */
+    UINT32 remote_addr_off;
+} FORT_CONF_RULE, *PFORT_CONF_RULE;
+
+/* Disjoint range of remote ports with the rules, which may match it */
+typedef struct fort_conf_rule_range
+{
+    FORT_CONF_RULE_PORTS ports;
+
+    UINT32 list_i; /* count and then indexes of the rules in priority order */
+} FORT_CONF_RULE_RANGE, *PFORT_CONF_RULE_RANGE;
+
+typedef struct fort_conf_rule_proto
+{
+    UINT16 ip_proto;
+    UINT16 ranges_n; /* sorted by remote ports */
+    UINT32 ranges_i;
+} FORT_CONF_RULE_PROTO, *PFORT_CONF_RULE_PROTO;
+
+/* Compiled rules, the offsets are relative to the section */
+typedef struct fort_conf_rules
+{
+    UINT16 rules_n;
+    UINT16 protos_n; /* sorted by protocol */
+    UINT16 locals_n; /* rules with the local ports, addresses or equal ports */
+    UINT16 reserved; /* to align to 4-byte boundary */
+
+    UINT32 ranges_off;
+    UINT32 lists_off;
+    UINT32 rules_off;
+
+    FORT_CONF_RULE_PROTO protos[1];
+} FORT_CONF_RULES, *PFORT_CONF_RULES;
+
+typedef struct fort_conf_rule_conn
+{
+    const UINT32 *local_ip;
+    const UINT32 *remote_ip;
+
+    UINT16 local_port;
+    UINT16 remote_port;
+
+    UCHAR ip_proto;
+    UCHAR inbound : 1;
+    UCHAR isIPv6 : 1;
+} FORT_CONF_RULE_CONN, *PFORT_CONF_RULE_CONN;
+
+#define FORT_SPEED_LIMIT_FQ      0x01 /* fair queuing of the flows */
+#define FORT_SPEED_LIMIT_FQ_PROC 0x02 /* fair queuing of the processes */
+#define FORT_SPEED_LIMIT_FQ_MASK (FORT_SPEED_LIMIT_FQ | FORT_SPEED_LIMIT_FQ_PROC)
+#define FORT_SPEED_LIMIT_ECN     0x04 /* mark the inbound ECN-capable packets instead of dropping */
+#define FORT_SPEED_LIMIT_PACING  0x08 /* release the packets evenly, without bursts after idle */
+
 typedef struct fort_speed_limit
 {
     UINT16 plr; /* packet loss rate in 1/100% (0-10000, i.e. 10% packet loss = 1000) */
+    UINT16 flags;
     UINT32 latency_ms; /* latency in milliseconds */
     UINT32 buffer_bytes; /* size of packet buffer in bytes (150,000 is the dummynet's default) */
+    UINT32 burst_bytes; /* bytes to send at once after idle, 0 to scale by the bandwidth */
     UINT64 bps; /* bandwidth in bytes per second */
 } FORT_SPEED_LIMIT, *PFORT_SPEED_LIMIT;
 
@@ -203,12 +364,51 @@ typedef struct fort_conf_group
     UINT16 log_blocked;
     UINT16 log_conn;
 
+    UINT16 stat_off_bits; /* without the traffic statistics */
+
     UINT16 limit_bits;
     UINT32 limit_io_bits;
 
     FORT_SPEED_LIMIT limits[FORT_CONF_GROUP_MAX * 2]; /* in/out-bound pairs */
 } FORT_CONF_GROUP, *PFORT_CONF_GROUP;
 
+#define FORT_CONF_LOG_FILTERS_MAX 16
+
+#define FORT_LOG_FILTER_ADDR_BROADCAST  0x01
+#define FORT_LOG_FILTER_ADDR_MULTICAST  0x02
+#define FORT_LOG_FILTER_ADDR_LINK_LOCAL 0x04
+
+/* The blocked connections, matched by a filter, are not logged */
+typedef struct fort_conf_log_filter
+{
+    UCHAR ip_proto; /* 0 for any */
+
+    UCHAR inbound : 1;
+    UCHAR outbound : 1;
+
+    UCHAR addr_classes; /* FORT_LOG_FILTER_ADDR_* of the local or remote address, 0 for any */
+
+    FORT_CONF_RULE_PORTS local_ports;
+    FORT_CONF_RULE_PORTS remote_ports;
+} FORT_CONF_LOG_FILTER, *PFORT_CONF_LOG_FILTER;
+
+#define FORT_CONF_UDP_LIGHT_PORTS_MAX 8
+
+/* The same for the file's hard links, junctions' and short names' paths */
+typedef struct fort_file_id
+{
+    UINT64 volume_serial;
+    UCHAR id[16];
+} FORT_FILE_ID, *PFORT_FILE_ID;
+
+typedef struct fort_conf_file_id_app
+{
+    FORT_FILE_ID file_id;
+    UINT32 app_index; /* of the exe apps */
+} FORT_CONF_FILE_ID_APP, *PFORT_CONF_FILE_ID_APP;
+
+#define FORT_CONF_FILE_ID_APPS_SIZE(n) ((n) * sizeof(FORT_CONF_FILE_ID_APP))
+
 typedef struct fort_conf
 {
     FORT_CONF_FLAGS flags;
@@ -216,10 +416,38 @@ typedef struct fort_conf
     UCHAR app_periods_n;
 
     UCHAR proc_wild : 1;
+    UCHAR quota_block_inet : 1; /* block the internet traffic, when a quota is exceeded */
+    UCHAR addr_prov_filters : 1; /* filter the static addresses by WFP without callouts */
+    UCHAR zones_node_replicas : 1; /* replicate the zones per NUMA node */
+    UCHAR proc_pending_allow : 1; /* the default verdict of the timed out asks */
 
     UINT16 wild_apps_n;
     UINT16 prefix_apps_n;
     UINT16 exe_apps_n;
+    UINT16 file_id_apps_n;
+
+    UINT16 proc_pending_packets_max; /* per process on ask to connect, 0 for the default */
+    UINT16 proc_pending_timeout; /* seconds to wait for the answer, 0 for no timeout */
+
+    UINT16 log_buffer_limit; /* MiB of the buffered logs, 0 for the default */
+
+    UINT16 mem_limit; /* MiB of the nonpaged pool per subsystem but conf & zones, 0 for none */
+
+    /* The allowed connections are sampled per app & endpoint, 0 for both to log all */
+    UCHAR log_allowed_ip_first; /* logged first per window */
+    UCHAR log_allowed_ip_rate; /* 1 of the rate's count logged after the first, 0 for none */
+
+    UINT16 accept_rate_limit; /* inbound connections per second per address, 0 for no limit */
+
+    UCHAR log_filters_n;
+    FORT_CONF_LOG_FILTER log_filters[FORT_CONF_LOG_FILTERS_MAX];
+
+    /* The UDP flows to the ports are charged to the processes without the flows' tracking */
+    UCHAR udp_light_ports_n;
+    FORT_CONF_RULE_PORTS udp_light_ports[FORT_CONF_UDP_LIGHT_PORTS_MAX];
+
+    UINT32 quota_day_mb; /* MiB of the inbound traffic per day, 0 for no quota */
+    UINT32 quota_month_mb;
 
     UINT32 app_perms_block_mask;
     UINT32 app_perms_allow_mask;
@@ -228,18 +456,121 @@ typedef struct fort_conf
 
     UINT32 app_periods_off;
 
+    UINT32 rules_off;
+
     UINT32 wild_apps_off;
     UINT32 prefix_apps_off;
     UINT32 exe_apps_off;
+    UINT32 exe_hashes_off; /* path hashes of the exe apps */
+    UINT32 file_id_apps_off; /* file ids of the exe apps, sorted by the file ids */
 
     char data[4];
 } FORT_CONF, *PFORT_CONF;
 
+#define FORT_QUOTA_DAY   0x01
+#define FORT_QUOTA_MONTH 0x02
+
+typedef struct fort_conf_quota
+{
+    UINT64 day_bytes; /* of the inbound traffic, already counted by the service */
+    UINT64 month_bytes;
+
+    UCHAR set_bits; /* FORT_QUOTA_* of the counters to set, the others are kept */
+    UCHAR alerted_bits; /* FORT_QUOTA_* of the quotas, exceeded in the current period */
+} FORT_CONF_QUOTA, *PFORT_CONF_QUOTA;
+
 typedef struct fort_conf_version
 {
     UINT16 driver_version;
+
+    UINT16 compact_traf : 1; /* 32-bit traffic counters in the stat records */
 } FORT_CONF_VERSION, *PFORT_CONF_VERSION;
 
+#define FORT_DEVICE_STATS_INJECT_BATCH_MAX   64
+#define FORT_DEVICE_STATS_INJECT_BATCH_COUNT 7 /* batch sizes: 1, 2-3, 4-7, ..., 64 */
+
+#define FORT_DEVICE_STATS_ALE_LAYER_COUNT   4 /* connect v4, connect v6, accept v4, accept v6 */
+#define FORT_DEVICE_STATS_ALE_VERDICT_COUNT 3 /* permit, block, other (pended, continued) */
+#define FORT_DEVICE_STATS_ALE_TIME_COUNT    32 /* by power of 2 ticks of the performance counter */
+
+#define FORT_DEVICE_STATS_MEM_TYPE_COUNT 9 /* by the subsystems, ordered by name */
+
+#define FORT_DEVICE_STATS_ADDR_GROUP_COUNT 2 /* internet addresses, allowed internet addresses */
+
+typedef struct fort_device_stats
+{
+    UINT64 verdict_cache_hits;
+    UINT64 verdict_cache_misses;
+
+    UINT64 stat_insert_time_max; /* in microseconds */
+
+    UINT64 inject_batches[FORT_DEVICE_STATS_INJECT_BATCH_COUNT]; /* by power of 2 sizes */
+
+    UINT64 perf_frequency; /* ticks per second of the performance counter */
+
+    UINT64 ale_classifies[FORT_DEVICE_STATS_ALE_LAYER_COUNT][FORT_DEVICE_STATS_ALE_VERDICT_COUNT];
+    UINT64 ale_classify_times[FORT_DEVICE_STATS_ALE_TIME_COUNT]; /* latency histogram */
+
+    UINT64 flows_count; /* current */
+    UINT64 flow_inserts;
+
+    UINT64 shaper_queued_bytes; /* current */
+    UINT64 shaper_drops;
+    UINT64 shaper_injects;
+
+    UINT64 log_buffered_bytes; /* current */
+    UINT64 log_drops;
+
+    UINT64 conf_swaps;
+
+    UINT64 pending_expires; /* asked connections of the default verdict */
+
+    UINT64 mem_bytes[FORT_DEVICE_STATS_MEM_TYPE_COUNT]; /* current, by the subsystems */
+    UINT64 mem_peak_bytes[FORT_DEVICE_STATS_MEM_TYPE_COUNT];
+    UINT64 mem_limit_fails;
+
+    UINT64 zone_hits[FORT_CONF_ZONE_MAX]; /* matched lookups by the zones' indexes */
+    INT64 zone_hit_times[FORT_CONF_ZONE_MAX]; /* system time of the last match, 0 for none */
+
+    UINT64 addr_group_hits[FORT_DEVICE_STATS_ADDR_GROUP_COUNT];
+    INT64 addr_group_hit_times[FORT_DEVICE_STATS_ADDR_GROUP_COUNT];
+
+    UINT64 log_filter_suppressed[FORT_CONF_LOG_FILTERS_MAX]; /* by the conf's log filters */
+} FORT_DEVICE_STATS, *PFORT_DEVICE_STATS;
+
+#define FORT_FLOWS_PAGE_MAX 256 /* flows per the stat lock's hold */
+
+#define FORT_FLOW_INFO_TCP     0x01
+#define FORT_FLOW_INFO_IP6     0x02
+#define FORT_FLOW_INFO_INBOUND 0x04
+
+typedef struct fort_flow_info
+{
+    UINT64 flow_id;
+
+    UINT64 in_bytes;
+    UINT64 out_bytes;
+
+    UINT32 process_id;
+
+    UINT32 remote_ip[4];
+    UINT16 local_port;
+    UINT16 remote_port;
+
+    UCHAR ip_proto;
+    UCHAR flags; /* FORT_FLOW_INFO_* */
+    UCHAR group_index;
+} FORT_FLOW_INFO, *PFORT_FLOW_INFO;
+
+/* The active flows' snapshot, read by the pages */
+typedef struct fort_flows_page
+{
+    UINT32 next_index; /* the resume cursor of the next page, 0 at the end */
+    UINT32 flows_count;
+
+    FORT_FLOW_INFO flows[1];
+} FORT_FLOWS_PAGE, *PFORT_FLOWS_PAGE;
+
 typedef struct fort_conf_io
 {
     FORT_CONF_GROUP conf_group;
@@ -247,21 +578,97 @@ typedef struct fort_conf_io
     FORT_CONF conf;
 } FORT_CONF_IO, *PFORT_CONF_IO;
 
+#define FORT_CONF_CACHE_MAGIC 0x43465746 /* "FWFC" */
+#define FORT_CONF_CACHE_ALIGN 8
+#define FORT_CONF_CACHE_FILE  "fortfw.conf" /* in the system drivers' directory */
+
+/* The last applied conf and zones, cached by the service to filter them at boot */
+typedef struct fort_conf_cache
+{
+    UINT32 magic;
+    UINT32 driver_version;
+
+    UINT32 conf_size; /* of the FORT_CONF_IO */
+    UINT32 zones_size; /* of the FORT_CONF_ZONES, 0 for no zones */
+
+    UINT32 checksum; /* of the data */
+    UINT32 reserved;
+
+    char data[8]; /* the aligned conf and then zones */
+} FORT_CONF_CACHE, *PFORT_CONF_CACHE;
+
+#define FORT_CONF_PATCH_ADDR_GROUPS 0x01
+#define FORT_CONF_PATCH_APP_PERIODS 0x02
+#define FORT_CONF_PATCH_APP_GROUPS  0x04 /* app groups' log flags and speed limits */
+
+typedef struct fort_conf_patch
+{
+    UINT16 sections;
+
+    UCHAR app_periods_n;
+
+    UINT32 addr_groups_size;
+    UINT32 app_periods_size;
+
+    FORT_CONF_FLAGS flags;
+
+    FORT_CONF_GROUP conf_group;
+
+    char data[4]; /* patched address groups and then app periods */
+} FORT_CONF_PATCH, *PFORT_CONF_PATCH;
+
 #define FORT_CONF_DATA_OFF       offsetof(FORT_CONF, data)
 #define FORT_CONF_IO_CONF_OFF    offsetof(FORT_CONF_IO, conf)
+#define FORT_CONF_PATCH_DATA_OFF offsetof(FORT_CONF_PATCH, data)
+#define FORT_CONF_CACHE_DATA_OFF offsetof(FORT_CONF_CACHE, data)
 #define FORT_CONF_ADDR4_LIST_OFF offsetof(FORT_CONF_ADDR4_LIST, ip)
 #define FORT_CONF_ADDR6_LIST_OFF offsetof(FORT_CONF_ADDR6_LIST, ip)
 #define FORT_CONF_ADDR_GROUP_OFF offsetof(FORT_CONF_ADDR_GROUP, data)
 #define FORT_CONF_ZONES_DATA_OFF offsetof(FORT_CONF_ZONES, data)
+#define FORT_CONF_ZONE_DATA_OFF  offsetof(FORT_CONF_ZONE, data)
+#define FORT_CONF_WILD_DATA_OFF  offsetof(FORT_CONF_WILD_MATCHER, data)
+#define FORT_CONF_PREFIX_DATA_OFF offsetof(FORT_CONF_PREFIX_TRIE, data)
+#define FORT_CONF_RULES_DATA_OFF  offsetof(FORT_CONF_RULES, protos)
+#define FORT_FLOWS_PAGE_FLOWS_OFF offsetof(FORT_FLOWS_PAGE, flows)
+
+#define FORT_CONF_PREFIX_TRIE_SIZE(nodes_n)                                                        \
+    (FORT_CONF_PREFIX_DATA_OFF + (nodes_n) * sizeof(FORT_CONF_PREFIX_NODE))
+
+#define FORT_CONF_WILD_MATCHER_SIZE(buckets_n, items_n)                                            \
+    (FORT_CONF_WILD_DATA_OFF + (buckets_n) * sizeof(FORT_CONF_WILD_BUCKET)                         \
+            + (items_n) * sizeof(FORT_CONF_WILD_ITEM))
+
+#define FORT_CONF_ADDR4_LIST_SIZE(ip_n, pair_n, index_bits)                                        \
+    (FORT_CONF_ADDR4_LIST_OFF + FORT_CONF_IP4_ARR_SIZE(ip_n) + FORT_CONF_IP4_RANGE_SIZE(pair_n)    \
+            + FORT_CONF_IP_INDEX_SIZE(index_bits))
 
-#define FORT_CONF_ADDR4_LIST_SIZE(ip_n, pair_n)                                                    \
-    (FORT_CONF_ADDR4_LIST_OFF + FORT_CONF_IP4_ARR_SIZE(ip_n) + FORT_CONF_IP4_RANGE_SIZE(pair_n))
+/* First addresses of blocks, offsets of blocks and then blocks data */
+#define FORT_CONF_ADDR4_PACKED_SIZE(ip_n, data_size)                                               \
+    (FORT_CONF_ADDR4_LIST_OFF + FORT_CONF_IP4_ARR_SIZE(FORT_CONF_IP_BLOCKS_N(ip_n) * 2 + 1)        \
+            + (data_size))
 
-#define FORT_CONF_ADDR6_LIST_SIZE(ip_n, pair_n)                                                    \
-    (FORT_CONF_ADDR6_LIST_OFF + FORT_CONF_IP6_ARR_SIZE(ip_n) + FORT_CONF_IP6_RANGE_SIZE(pair_n))
+#define FORT_CONF_ADDR4_LIST_REF_SIZE(addr_list)                                                   \
+    ((addr_list)->is_packed                                                                        \
+                    ? FORT_CONF_ADDR4_PACKED_SIZE((addr_list)->ip_n, (addr_list)->pair_n)          \
+                    : FORT_CONF_ADDR4_LIST_SIZE(                                                   \
+                            (addr_list)->ip_n, (addr_list)->pair_n, (addr_list)->index_bits))
 
-#define FORT_CONF_ADDR_LIST_SIZE(ip4_n, pair4_n, ip6_n, pair6_n)                                   \
-    (FORT_CONF_ADDR4_LIST_SIZE(ip4_n, pair4_n) + FORT_CONF_ADDR6_LIST_SIZE(ip6_n, pair6_n))
+#define FORT_CONF_ADDR6_LIST_SIZE(ip_n, pair_n, index_bits)                                        \
+    (FORT_CONF_ADDR6_LIST_OFF + FORT_CONF_IP6_ARR_SIZE(ip_n) + FORT_CONF_IP6_RANGE_SIZE(pair_n)    \
+            + FORT_CONF_IP_INDEX_SIZE(index_bits))
+
+#define FORT_CONF_EXE_HASHES_SIZE(n) ((n) * sizeof(UINT32))
+
+#define FORT_CONF_CACHE_ZONES_OFF(conf_size) FORT_ALIGN_SIZE((conf_size), FORT_CONF_CACHE_ALIGN)
+
+#define FORT_CONF_CACHE_DATA_SIZE(conf_size, zones_size)                                           \
+    (FORT_CONF_CACHE_ZONES_OFF(conf_size) + (zones_size))
+
+#define FORT_CONF_ZONES_INDEX_SIZE(n) (FORT_CONF_IP4_RANGE_SIZE(n) + FORT_CONF_IP4_ARR_SIZE(n))
+
+#define FORT_CONF_ADDR_LIST_SIZE(ip4_n, pair4_n, index4_bits, ip6_n, pair6_n, index6_bits)         \
+    (FORT_CONF_ADDR4_LIST_SIZE(ip4_n, pair4_n, index4_bits)                                        \
+            + FORT_CONF_ADDR6_LIST_SIZE(ip6_n, pair6_n, index6_bits))
 
 typedef FORT_APP_ENTRY fort_conf_app_exe_find_func(
         const PFORT_CONF conf, PVOID context, const PVOID path, UINT32 path_len);
@@ -277,9 +684,13 @@ FORT_API int bit_scan_forward(ULONG mask);
 
 FORT_API BOOL is_time_in_period(FORT_TIME time, FORT_PERIOD period);
 
+FORT_API UCHAR fort_conf_ip_index_bits(UINT32 ip_n, UINT32 pair_n);
+
 FORT_API BOOL fort_conf_ip_inlist(
         const UINT32 *ip, const PFORT_CONF_ADDR4_LIST addr_list, BOOL isIPv6);
 
+FORT_API UINT32 fort_conf_zones_ip4_mask(const PFORT_CONF_ZONES zones, UINT32 ip);
+
 FORT_API PFORT_CONF_ADDR_GROUP fort_conf_addr_group_ref(
         const PFORT_CONF conf, int addr_group_index);
 
@@ -302,19 +713,45 @@ FORT_API BOOL fort_conf_ip_included(const PFORT_CONF conf,
 FORT_API BOOL fort_conf_app_exe_equal(
         const PFORT_APP_ENTRY app_entry, const PVOID path, UINT32 path_len);
 
+FORT_API UINT32 fort_conf_app_path_hash(const PVOID path, UINT32 path_len);
+
 FORT_API FORT_APP_ENTRY fort_conf_app_exe_find(
         const PFORT_CONF conf, PVOID context, const PVOID path, UINT32 path_len);
 
+/* The wildcard and then the prefix paths */
+FORT_API FORT_APP_ENTRY fort_conf_app_pattern_find(
+        const PFORT_CONF conf, const PVOID path, UINT32 path_len);
+
 FORT_API FORT_APP_ENTRY fort_conf_app_find(const PFORT_CONF conf, const PVOID path, UINT32 path_len,
         fort_conf_app_exe_find_func *exe_find_func, PVOID exe_context);
 
+FORT_API PFORT_CONF_RULE fort_conf_rules_find(
+        const PFORT_CONF conf, const PFORT_CONF_RULE_CONN conn);
+
+FORT_API BOOL fort_conf_rules_has_locals(const PFORT_CONF conf);
+
 FORT_API BOOL fort_conf_app_blocked(
         const PFORT_CONF conf, FORT_APP_FLAGS app_flags, INT8 *block_reason);
 
+FORT_API UCHAR fort_conf_log_filter_addr_classes(const UINT32 *ip, BOOL isIPv6);
+
+FORT_API int fort_conf_log_filter_find(const PFORT_CONF conf, BOOL inbound, UCHAR ip_proto,
+        UINT16 local_port, UINT16 remote_port, UCHAR addr_classes);
+
+FORT_API BOOL fort_conf_udp_light_port(const PFORT_CONF conf, UINT16 port);
+
+FORT_API int fort_conf_file_id_cmp(const PFORT_FILE_ID l, const PFORT_FILE_ID r);
+
 FORT_API UINT16 fort_conf_app_period_bits(const PFORT_CONF conf, FORT_TIME time, int *periods_n);
 
+FORT_API int fort_conf_app_period_next(const PFORT_CONF conf, FORT_TIME time);
+
 FORT_API void fort_conf_app_perms_mask_init(PFORT_CONF conf, UINT32 group_bits);
 
+FORT_API UINT32 fort_conf_cache_checksum(const PVOID data, UINT32 size);
+
+FORT_API BOOL fort_conf_cache_check(const PFORT_CONF_CACHE cache, UINT32 size);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
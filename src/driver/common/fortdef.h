@@ -10,8 +10,17 @@ enum FortLogType {
     FORT_LOG_TYPE_PROC_NEW,
     FORT_LOG_TYPE_STAT_TRAF,
     FORT_LOG_TYPE_TIME,
+    FORT_LOG_TYPE_FLOW_STAT,
+    FORT_LOG_TYPE_BLOCKED_IP_REPEAT,
+    FORT_LOG_TYPE_PATH_DEF,
+    FORT_LOG_TYPE_DROPPED,
+    FORT_LOG_TYPE_QUOTA,
+    FORT_LOG_TYPE_SHAPER_STAT,
 };
 
+/* The process's logon session is not resolved */
+#define FORT_LOG_SESSION_UNKNOWN 0xFFFFFFFFU
+
 enum FortLogBlockedIpFlag {
     FORT_LOG_BLOCKED_IP_INHERITED = (1 << 0),
 };
@@ -27,6 +36,10 @@ enum FortBlockReason {
     FORT_BLOCK_REASON_LAN_ONLY,
     FORT_BLOCK_REASON_ZONE,
     FORT_BLOCK_REASON_ASK_LIMIT,
+    FORT_BLOCK_REASON_RULE,
+    FORT_BLOCK_REASON_ALLOWED, /* the allowed connection is logged */
+    FORT_BLOCK_REASON_ACCEPT_RATE, /* the inbound connections from the address are too often */
+    FORT_BLOCK_REASON_ASK_TIMEOUT, /* the default verdict of the unanswered ask to connect */
     FORT_BLOCK_REASON_ASK_PENDING = 15 /* must be last! */
 };
 
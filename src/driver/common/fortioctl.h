@@ -160,6 +160,38 @@ DEFINE_GUID(FORT_GUID_FILTER_REAUTH_OUT_V4, 0x749709ce, 0x9686, 0x4056, 0xb8, 0x
 DEFINE_GUID(FORT_GUID_FILTER_REAUTH_OUT_V6, 0xb3db1623, 0xc317, 0x4e04, 0xa9, 0xd1, 0x54, 0x82,
         0x96, 0xe, 0xb7, 0xc);
 
+/* {30E44043-C18B-4409-B259-74641DAA469C} */
+DEFINE_GUID(FORT_GUID_FILTER_ADDR_ALLOW_CONNECT_V4, 0x30e44043, 0xc18b, 0x4409, 0xb2, 0x59, 0x74,
+        0x64, 0x1d, 0xaa, 0x46, 0x9c);
+
+/* {647FF366-8E57-4EAD-B93B-2F390AFA3D96} */
+DEFINE_GUID(FORT_GUID_FILTER_ADDR_ALLOW_CONNECT_V6, 0x647ff366, 0x8e57, 0x4ead, 0xb9, 0x3b, 0x2f,
+        0x39, 0xa, 0xfa, 0x3d, 0x96);
+
+/* {E7E7F716-BD49-4518-9FBF-1F06F982EA1A} */
+DEFINE_GUID(FORT_GUID_FILTER_ADDR_ALLOW_ACCEPT_V4, 0xe7e7f716, 0xbd49, 0x4518, 0x9f, 0xbf, 0x1f,
+        0x6, 0xf9, 0x82, 0xea, 0x1a);
+
+/* {FF49507E-00FA-42ED-B574-6621BDC57072} */
+DEFINE_GUID(FORT_GUID_FILTER_ADDR_ALLOW_ACCEPT_V6, 0xff49507e, 0x00fa, 0x42ed, 0xb5, 0x74, 0x66,
+        0x21, 0xbd, 0xc5, 0x70, 0x72);
+
+/* {5BB5FD72-D0F9-43FD-AF5B-9C7C34DE8EF3} */
+DEFINE_GUID(FORT_GUID_FILTER_ADDR_BLOCK_CONNECT_V4, 0x5bb5fd72, 0xd0f9, 0x43fd, 0xaf, 0x5b, 0x9c,
+        0x7c, 0x34, 0xde, 0x8e, 0xf3);
+
+/* {729CFD97-D097-4E14-AF63-F5A85D114041} */
+DEFINE_GUID(FORT_GUID_FILTER_ADDR_BLOCK_CONNECT_V6, 0x729cfd97, 0xd097, 0x4e14, 0xaf, 0x63, 0xf5,
+        0xa8, 0x5d, 0x11, 0x40, 0x41);
+
+/* {BE613B2D-F807-4DDF-819F-E4D77D5AA2B5} */
+DEFINE_GUID(FORT_GUID_FILTER_ADDR_BLOCK_ACCEPT_V4, 0xbe613b2d, 0xf807, 0x4ddf, 0x81, 0x9f, 0xe4,
+        0xd7, 0x7d, 0x5a, 0xa2, 0xb5);
+
+/* {ACCB7982-03D6-4A90-A894-B95C252A92E5} */
+DEFINE_GUID(FORT_GUID_FILTER_ADDR_BLOCK_ACCEPT_V6, 0xaccb7982, 0x03d6, 0x4a90, 0xa8, 0x94, 0xb9,
+        0x5c, 0x25, 0x2a, 0x92, 0xe5);
+
 /* {00000000-0000-0000-0000-000000000000} */
 DEFINE_GUID(FORT_GUID_EMPTY, 0x00000000, 0x0000, 0x0000, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
         0x00);
@@ -173,14 +205,25 @@ DEFINE_GUID(FORT_GUID_EMPTY, 0x00000000, 0x0000, 0x0000, 0x00, 0x00, 0x00, 0x00,
 
 #define FORT_CTL_CODE(i, a) CTL_CODE(FORT_DEVICE_TYPE, FORT_IOCTL_BASE + (i), METHOD_BUFFERED, (a))
 
+/* The output buffer is passed as locked user pages to the driver */
+#define FORT_CTL_CODE_IN_DIRECT(i, a)                                                              \
+    CTL_CODE(FORT_DEVICE_TYPE, FORT_IOCTL_BASE + (i), METHOD_IN_DIRECT, (a))
+
 #define FORT_IOCTL_VALIDATE    FORT_CTL_CODE(0, FILE_WRITE_DATA)
 #define FORT_IOCTL_SETSERVICES FORT_CTL_CODE(1, FILE_WRITE_DATA)
-#define FORT_IOCTL_SETCONF     FORT_CTL_CODE(2, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETCONF     FORT_CTL_CODE_IN_DIRECT(2, FILE_WRITE_DATA)
 #define FORT_IOCTL_SETFLAGS    FORT_CTL_CODE(3, FILE_WRITE_DATA)
 #define FORT_IOCTL_GETLOG      FORT_CTL_CODE(4, FILE_READ_DATA)
 #define FORT_IOCTL_ADDAPP      FORT_CTL_CODE(5, FILE_WRITE_DATA)
 #define FORT_IOCTL_DELAPP      FORT_CTL_CODE(6, FILE_WRITE_DATA)
-#define FORT_IOCTL_SETZONES    FORT_CTL_CODE(7, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETZONES    FORT_CTL_CODE_IN_DIRECT(7, FILE_WRITE_DATA)
 #define FORT_IOCTL_SETZONEFLAG FORT_CTL_CODE(8, FILE_WRITE_DATA)
+#define FORT_IOCTL_GETSTATS    FORT_CTL_CODE(9, FILE_READ_DATA)
+#define FORT_IOCTL_PATCHCONF   FORT_CTL_CODE(10, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETZONE     FORT_CTL_CODE_IN_DIRECT(11, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETLIVE     FORT_CTL_CODE(12, FILE_WRITE_DATA)
+#define FORT_IOCTL_SETLOGRING  FORT_CTL_CODE(13, FILE_READ_DATA)
+#define FORT_IOCTL_SETQUOTA    FORT_CTL_CODE(14, FILE_WRITE_DATA)
+#define FORT_IOCTL_GETFLOWS    FORT_CTL_CODE(15, FILE_READ_DATA)
 
 #endif // FORTIOCTL_H
@@ -17,7 +17,7 @@ FORT_API void fort_log_blocked_write(
 {
     fort_log_blocked_header_write(p, blocked, pid, path_len);
 
-    if (path_len != 0) {
+    if (FORT_LOG_PATH_LEN(path_len) != 0) {
         RtlCopyMemory(p + FORT_LOG_BLOCKED_HEADER_SIZE, path, path_len);
     }
 }
@@ -33,15 +33,16 @@ FORT_API void fort_log_blocked_header_read(
 }
 
 void fort_log_blocked_ip_header_write(char *p, BOOL isIPv6, BOOL inbound, BOOL inherited,
-        UCHAR block_reason, UCHAR ip_proto, UINT16 local_port, UINT16 remote_port,
-        const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid, UINT32 path_len)
+        UCHAR block_reason, UCHAR sample_rate, UCHAR ip_proto, UINT16 local_port,
+        UINT16 remote_port, const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid,
+        UINT32 path_len)
 {
     UINT32 *up = (UINT32 *) p;
 
     *up++ = fort_log_flag_type(FORT_LOG_TYPE_BLOCKED_IP) | (isIPv6 ? FORT_LOG_FLAG_IP6 : 0)
             | (inbound ? FORT_LOG_FLAG_IP_INBOUND : 0) | path_len;
     *up++ = (inherited ? FORT_LOG_BLOCKED_IP_INHERITED : 0) | ((UINT32) block_reason << 8)
-            | ((UINT32) ip_proto << 16);
+            | ((UINT32) ip_proto << 16) | ((UINT32) sample_rate << 24);
     *up++ = local_port | ((UINT32) remote_port << 16);
     *up++ = pid;
 
@@ -53,21 +54,21 @@ void fort_log_blocked_ip_header_write(char *p, BOOL isIPv6, BOOL inbound, BOOL i
 }
 
 void fort_log_blocked_ip_write(char *p, BOOL isIPv6, BOOL inbound, BOOL inherited,
-        UCHAR block_reason, UCHAR ip_proto, UINT16 local_port, UINT16 remote_port,
-        const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid, UINT32 path_len,
-        const char *path)
+        UCHAR block_reason, UCHAR sample_rate, UCHAR ip_proto, UINT16 local_port,
+        UINT16 remote_port, const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid,
+        UINT32 path_len, const char *path)
 {
-    fort_log_blocked_ip_header_write(p, isIPv6, inbound, inherited, block_reason, ip_proto,
-            local_port, remote_port, local_ip, remote_ip, pid, path_len);
+    fort_log_blocked_ip_header_write(p, isIPv6, inbound, inherited, block_reason, sample_rate,
+            ip_proto, local_port, remote_port, local_ip, remote_ip, pid, path_len);
 
-    if (path_len != 0) {
+    if (FORT_LOG_PATH_LEN(path_len) != 0) {
         RtlCopyMemory(p + FORT_LOG_BLOCKED_IP_HEADER_SIZE(isIPv6), path, path_len);
     }
 }
 
 void fort_log_blocked_ip_header_read(const char *p, BOOL *isIPv6, BOOL *inbound, BOOL *inherited,
-        UCHAR *block_reason, UCHAR *ip_proto, UINT16 *local_port, UINT16 *remote_port,
-        UINT32 *local_ip, UINT32 *remote_ip, UINT32 *pid, UINT32 *path_len)
+        UCHAR *block_reason, UCHAR *sample_rate, UCHAR *ip_proto, UINT16 *local_port,
+        UINT16 *remote_port, UINT32 *local_ip, UINT32 *remote_ip, UINT32 *pid, UINT32 *path_len)
 {
     const UINT32 *up = (const UINT32 *) p;
 
@@ -78,7 +79,8 @@ void fort_log_blocked_ip_header_read(const char *p, BOOL *isIPv6, BOOL *inbound,
     const UCHAR flags = (UCHAR) *up;
     *inherited = (flags & FORT_LOG_BLOCKED_IP_INHERITED) != 0;
     *block_reason = (UCHAR) (*up >> 8);
-    *ip_proto = (UCHAR) (*up++ >> 16);
+    *ip_proto = (UCHAR) (*up >> 16);
+    *sample_rate = (UCHAR) (*up++ >> 24);
     *local_port = *((const UINT16 *) up);
     *remote_port = (UINT16) (*up++ >> 16);
     *pid = *up++;
@@ -90,45 +92,168 @@ void fort_log_blocked_ip_header_read(const char *p, BOOL *isIPv6, BOOL *inbound,
     RtlCopyMemory(remote_ip, up, ip_size);
 }
 
-FORT_API void fort_log_proc_new_header_write(char *p, UINT32 pid, UINT32 path_len)
+FORT_API void fort_log_blocked_ip_repeat_write(char *p, BOOL isIPv6, BOOL inbound,
+        UCHAR block_reason, UCHAR ip_proto, UINT16 remote_port, const UINT32 *remote_ip,
+        UINT32 pid, UINT32 repeat_count, INT64 first_time, INT64 last_time)
+{
+    UINT32 *up = (UINT32 *) p;
+
+    *up++ = fort_log_flag_type(FORT_LOG_TYPE_BLOCKED_IP_REPEAT) | (isIPv6 ? FORT_LOG_FLAG_IP6 : 0)
+            | (inbound ? FORT_LOG_FLAG_IP_INBOUND : 0) | block_reason | ((UINT32) ip_proto << 8);
+    *up++ = remote_port;
+    *up++ = pid;
+    *up++ = repeat_count;
+
+    INT64 *tp = (INT64 *) up;
+    *tp++ = first_time;
+    *tp++ = last_time;
+
+    RtlCopyMemory(tp, remote_ip, FORT_IP_ADDR_SIZE(isIPv6));
+}
+
+FORT_API void fort_log_blocked_ip_repeat_read(const char *p, BOOL *isIPv6, BOOL *inbound,
+        UCHAR *block_reason, UCHAR *ip_proto, UINT16 *remote_port, UINT32 *remote_ip,
+        UINT32 *pid, UINT32 *repeat_count, INT64 *first_time, INT64 *last_time)
+{
+    const UINT32 *up = (const UINT32 *) p;
+
+    *isIPv6 = (*up & FORT_LOG_FLAG_IP6) != 0;
+    *inbound = (*up & FORT_LOG_FLAG_IP_INBOUND) != 0;
+    *block_reason = (UCHAR) *up;
+    *ip_proto = (UCHAR) (*up++ >> 8);
+    *remote_port = (UINT16) *up++;
+    *pid = *up++;
+    *repeat_count = *up++;
+
+    const INT64 *tp = (const INT64 *) up;
+    *first_time = *tp++;
+    *last_time = *tp++;
+
+    RtlCopyMemory(remote_ip, tp, FORT_IP_ADDR_SIZE(*isIPv6));
+}
+
+FORT_API void fort_log_proc_new_header_write(
+        char *p, UINT32 pid, UINT32 session_id, UINT32 app_id, UINT32 path_len)
 {
     UINT32 *up = (UINT32 *) p;
 
     *up++ = fort_log_flag_type(FORT_LOG_TYPE_PROC_NEW) | path_len;
-    *up = pid;
+    *up++ = pid;
+    *up++ = session_id;
+    *up = app_id;
 }
 
-FORT_API void fort_log_proc_new_write(char *p, UINT32 pid, UINT32 path_len, const char *path)
+FORT_API void fort_log_proc_new_write(char *p, UINT32 pid, UINT32 session_id, UINT32 app_id,
+        UINT32 path_len, const char *path)
 {
-    fort_log_proc_new_header_write(p, pid, path_len);
+    fort_log_proc_new_header_write(p, pid, session_id, app_id, path_len);
 
-    if (path_len != 0) {
+    if (FORT_LOG_PATH_LEN(path_len) != 0) {
         RtlCopyMemory(p + FORT_LOG_PROC_NEW_HEADER_SIZE, path, path_len);
     }
 }
 
-FORT_API void fort_log_proc_new_header_read(const char *p, UINT32 *pid, UINT32 *path_len)
+FORT_API void fort_log_proc_new_header_read(
+        const char *p, UINT32 *pid, UINT32 *session_id, UINT32 *app_id, UINT32 *path_len)
 {
     const UINT32 *up = (const UINT32 *) p;
 
     *path_len = (*up++ & ~FORT_LOG_FLAG_EX_MASK);
-    *pid = *up;
+    *pid = *up++;
+    *session_id = *up++;
+    *app_id = *up;
 }
 
-FORT_API void fort_log_stat_traf_header_write(char *p, UINT16 proc_count)
+FORT_API void fort_log_path_def_write(char *p, UINT32 path_id, UINT32 path_len, const char *path)
 {
     UINT32 *up = (UINT32 *) p;
 
-    *up = fort_log_flag_type(FORT_LOG_TYPE_STAT_TRAF) | proc_count;
+    *up++ = fort_log_flag_type(FORT_LOG_TYPE_PATH_DEF) | path_len;
+    *up++ = path_id;
+
+    RtlCopyMemory(up, path, path_len);
 }
 
-FORT_API void fort_log_stat_traf_header_read(const char *p, UINT16 *proc_count)
+FORT_API void fort_log_path_def_header_read(const char *p, UINT32 *path_id, UINT32 *path_len)
 {
     const UINT32 *up = (const UINT32 *) p;
 
+    *path_len = (*up++ & ~FORT_LOG_FLAG_EX_MASK);
+    *path_id = *up;
+}
+
+FORT_API void fort_log_stat_traf_header_write(
+        char *p, UINT16 proc_count, BOOL compact, BOOL conns)
+{
+    UINT32 *up = (UINT32 *) p;
+
+    *up = fort_log_flag_type(FORT_LOG_TYPE_STAT_TRAF)
+            | (compact ? FORT_LOG_FLAG_STAT_TRAF_COMPACT : 0)
+            | (conns ? FORT_LOG_FLAG_STAT_TRAF_CONNS : 0) | proc_count;
+}
+
+FORT_API void fort_log_stat_traf_header_read(
+        const char *p, UINT16 *proc_count, BOOL *compact, BOOL *conns)
+{
+    const UINT32 *up = (const UINT32 *) p;
+
+    *compact = (*up & FORT_LOG_FLAG_STAT_TRAF_COMPACT) != 0;
+    *conns = (*up & FORT_LOG_FLAG_STAT_TRAF_CONNS) != 0;
     *proc_count = (UINT16) *up;
 }
 
+FORT_API void fort_log_flow_stat_header_write(char *p, UINT16 flow_count)
+{
+    UINT32 *up = (UINT32 *) p;
+
+    *up = fort_log_flag_type(FORT_LOG_TYPE_FLOW_STAT) | flow_count;
+}
+
+FORT_API void fort_log_flow_stat_header_read(const char *p, UINT16 *flow_count)
+{
+    const UINT32 *up = (const UINT32 *) p;
+
+    *flow_count = (UINT16) *up;
+}
+
+FORT_API void fort_log_flow_stat_write(char *p, BOOL isIPv6, BOOL inbound, UCHAR ip_proto,
+        UINT16 local_port, UINT16 remote_port, const UINT32 *remote_ip, UINT32 pid,
+        const PFORT_FLOW_TRAF traf)
+{
+    UINT32 *up = (UINT32 *) p;
+
+    *up++ = pid;
+    *up++ = ip_proto | (isIPv6 ? FORT_LOG_FLAG_IP6 : 0) | (inbound ? FORT_LOG_FLAG_IP_INBOUND : 0);
+    *up++ = local_port | ((UINT32) remote_port << 16);
+
+    /* IPv4 address is zero-padded */
+    const int ip_size = FORT_IP_ADDR_SIZE(isIPv6);
+    RtlZeroMemory(up, sizeof(ip6_addr_t));
+    RtlCopyMemory(up, remote_ip, ip_size);
+    up += sizeof(ip6_addr_t) / sizeof(UINT32);
+
+    RtlCopyMemory(up, traf, sizeof(FORT_FLOW_TRAF));
+}
+
+FORT_API void fort_log_flow_stat_read(const char *p, BOOL *isIPv6, BOOL *inbound, UCHAR *ip_proto,
+        UINT16 *local_port, UINT16 *remote_port, UINT32 *remote_ip, UINT32 *pid,
+        PFORT_FLOW_TRAF traf)
+{
+    const UINT32 *up = (const UINT32 *) p;
+
+    *pid = *up++;
+    *isIPv6 = (*up & FORT_LOG_FLAG_IP6) != 0;
+    *inbound = (*up & FORT_LOG_FLAG_IP_INBOUND) != 0;
+    *ip_proto = (UCHAR) *up++;
+    *local_port = (UINT16) *up;
+    *remote_port = (UINT16) (*up++ >> 16);
+
+    RtlCopyMemory(remote_ip, up, FORT_IP_ADDR_SIZE(*isIPv6));
+    up += sizeof(ip6_addr_t) / sizeof(UINT32);
+
+    RtlCopyMemory(traf, up, sizeof(FORT_FLOW_TRAF));
+}
+
 FORT_API void fort_log_time_write(char *p, BOOL system_time_changed, INT64 unix_time)
 {
     UINT32 *up = (UINT32 *) p;
@@ -144,3 +269,55 @@ FORT_API void fort_log_time_read(const char *p, BOOL *system_time_changed, INT64
     *system_time_changed = ((UCHAR) *up++ != 0);
     *unix_time = *((INT64 *) up);
 }
+
+FORT_API void fort_log_dropped_write(char *p, const UINT32 *drops)
+{
+    UINT32 *up = (UINT32 *) p;
+
+    *up++ = fort_log_flag_type(FORT_LOG_TYPE_DROPPED);
+
+    RtlCopyMemory(up, drops, FORT_LOG_DROPPED_TYPES * sizeof(UINT32));
+}
+
+FORT_API void fort_log_dropped_read(const char *p, UINT32 *drops)
+{
+    const UINT32 *up = (const UINT32 *) p + 1;
+
+    RtlCopyMemory(drops, up, FORT_LOG_DROPPED_TYPES * sizeof(UINT32));
+}
+
+FORT_API void fort_log_quota_write(char *p, UCHAR quota_bits)
+{
+    UINT32 *up = (UINT32 *) p;
+
+    *up = fort_log_flag_type(FORT_LOG_TYPE_QUOTA) | quota_bits;
+}
+
+FORT_API void fort_log_quota_read(const char *p, UCHAR *quota_bits)
+{
+    const UINT32 *up = (const UINT32 *) p;
+
+    *quota_bits = (UCHAR) *up;
+}
+
+FORT_API void fort_log_shaper_stat_write(
+        char *p, UCHAR queue_index, UINT32 sojourn_max_ms, const PFORT_SHAPER_STAT stat)
+{
+    UINT32 *up = (UINT32 *) p;
+
+    *up++ = fort_log_flag_type(FORT_LOG_TYPE_SHAPER_STAT) | queue_index;
+    *up++ = sojourn_max_ms;
+
+    RtlCopyMemory(up, stat, sizeof(FORT_SHAPER_STAT));
+}
+
+FORT_API void fort_log_shaper_stat_read(
+        const char *p, UCHAR *queue_index, UINT32 *sojourn_max_ms, PFORT_SHAPER_STAT stat)
+{
+    const UINT32 *up = (const UINT32 *) p;
+
+    *queue_index = (UCHAR) *up++;
+    *sojourn_max_ms = *up++;
+
+    RtlCopyMemory(stat, up, sizeof(FORT_SHAPER_STAT));
+}
@@ -2,6 +2,7 @@
 #define FORTLOG_H
 
 #include "common.h"
+#include "fortconf.h"
 
 #define FORT_BUFFER_SIZE  (16 * 1024 - 64)
 #define FORT_LOG_PATH_MAX 512
@@ -15,6 +16,17 @@
 #define FORT_LOG_FLAG_OPT_MASK_OFF  28
 #define FORT_LOG_FLAG_EX_MASK       (FORT_LOG_FLAG_TYPE_MASK | FORT_LOG_FLAG_OPT_MASK)
 
+#define FORT_LOG_FLAG_STAT_TRAF_COMPACT 0x10000000
+#define FORT_LOG_FLAG_STAT_TRAF_CONNS   0x20000000
+
+/* The record's path_len carries the id of an interned path instead of the path */
+#define FORT_LOG_PATH_ID_FLAG 0x00080000
+#define FORT_LOG_PATH_ID_MASK 0x0007FFFF
+
+#define fort_log_path_id(id) (FORT_LOG_PATH_ID_FLAG | (id))
+
+#define FORT_LOG_PATH_LEN(path_len) (((path_len) & FORT_LOG_PATH_ID_FLAG) ? 0 : (path_len))
+
 #define fort_log_flag_type(type) (((UINT32) (type)) << FORT_LOG_FLAG_TYPE_MASK_OFF)
 #define fort_log_flag_opt(opt)   (((UINT32) (opt)) << FORT_LOG_FLAG_OPT_MASK_OFF)
 
@@ -25,7 +37,7 @@
 #define FORT_LOG_BLOCKED_HEADER_SIZE (2 * sizeof(UINT32))
 
 #define FORT_LOG_BLOCKED_SIZE(path_len)                                                            \
-    FORT_ALIGN_SIZE(FORT_LOG_BLOCKED_HEADER_SIZE + (path_len), FORT_LOG_ALIGN)
+    FORT_ALIGN_SIZE(FORT_LOG_BLOCKED_HEADER_SIZE + FORT_LOG_PATH_LEN(path_len), FORT_LOG_ALIGN)
 
 #define FORT_LOG_BLOCKED_SIZE_MAX FORT_LOG_BLOCKED_SIZE(FORT_LOG_PATH_MAX)
 
@@ -34,29 +46,92 @@
 #define FORT_LOG_BLOCKED_IP_HEADER_SIZE(isIPv6) (4 * sizeof(UINT32) + 2 * FORT_IP_ADDR_SIZE(isIPv6))
 
 #define FORT_LOG_BLOCKED_IP_SIZE(path_len, isIPv6)                                                 \
-    FORT_ALIGN_SIZE(FORT_LOG_BLOCKED_IP_HEADER_SIZE(isIPv6) + (path_len), FORT_LOG_ALIGN)
+    FORT_ALIGN_SIZE(                                                                               \
+            FORT_LOG_BLOCKED_IP_HEADER_SIZE(isIPv6) + FORT_LOG_PATH_LEN(path_len), FORT_LOG_ALIGN)
 
 #define FORT_LOG_BLOCKED_IP_SIZE_MAX FORT_LOG_BLOCKED_IP_SIZE(FORT_LOG_PATH_MAX, /*isIPv6=*/TRUE)
 
-#define FORT_LOG_PROC_NEW_HEADER_SIZE (2 * sizeof(UINT32))
+#define FORT_LOG_BLOCKED_IP_REPEAT_SIZE(isIPv6)                                                    \
+    (4 * sizeof(UINT32) + 2 * sizeof(INT64) + FORT_IP_ADDR_SIZE(isIPv6))
+
+#define FORT_LOG_PROC_NEW_HEADER_SIZE (4 * sizeof(UINT32))
 
 #define FORT_LOG_PROC_NEW_SIZE(path_len)                                                           \
-    FORT_ALIGN_SIZE(FORT_LOG_PROC_NEW_HEADER_SIZE + (path_len), FORT_LOG_ALIGN)
+    FORT_ALIGN_SIZE(FORT_LOG_PROC_NEW_HEADER_SIZE + FORT_LOG_PATH_LEN(path_len), FORT_LOG_ALIGN)
+
+#define FORT_LOG_PATH_DEF_HEADER_SIZE (2 * sizeof(UINT32))
+
+#define FORT_LOG_PATH_DEF_SIZE(path_len)                                                           \
+    FORT_ALIGN_SIZE(FORT_LOG_PATH_DEF_HEADER_SIZE + (path_len), FORT_LOG_ALIGN)
 
 #define FORT_LOG_STAT_HEADER_SIZE (sizeof(UINT32))
 
-#define FORT_LOG_STAT_TRAF_SIZE(proc_count) ((proc_count) * sizeof(UINT32) * 3)
+/* The process's connections are counted by UINT16 new | UINT16 blocked */
+#define FORT_LOG_STAT_PROC_SIZE(compact, conns)                                                    \
+    (sizeof(UINT32) + ((compact) ? 2 * sizeof(UINT32) : sizeof(FORT_TRAF))                         \
+            + ((conns) ? sizeof(UINT32) : 0))
+
+#define FORT_LOG_STAT_TRAF_SIZE(proc_count, compact, conns)                                        \
+    ((proc_count) * FORT_LOG_STAT_PROC_SIZE(compact, conns))
+
+#define FORT_LOG_STAT_SIZE(proc_count, compact, conns)                                             \
+    (FORT_LOG_STAT_HEADER_SIZE + FORT_LOG_STAT_TRAF_SIZE(proc_count, compact, conns))
+
+#define FORT_LOG_STAT_BUFFER_PROC_COUNT(compact, conns)                                            \
+    ((FORT_BUFFER_SIZE - FORT_LOG_STAT_HEADER_SIZE) / FORT_LOG_STAT_PROC_SIZE(compact, conns))
 
-#define FORT_LOG_STAT_SIZE(proc_count)                                                             \
-    (FORT_LOG_STAT_HEADER_SIZE + FORT_LOG_STAT_TRAF_SIZE(proc_count))
+#define FORT_LOG_FLOW_STAT_HEADER_SIZE (sizeof(UINT32))
 
-#define FORT_LOG_STAT_BUFFER_PROC_COUNT                                                            \
-    ((FORT_BUFFER_SIZE - FORT_LOG_STAT_HEADER_SIZE) / FORT_LOG_STAT_TRAF_SIZE(1))
+#define FORT_LOG_FLOW_STAT_ENTRY_SIZE (7 * sizeof(UINT32) + sizeof(FORT_FLOW_TRAF))
+
+#define FORT_LOG_FLOW_STAT_SIZE(flow_count)                                                        \
+    (FORT_LOG_FLOW_STAT_HEADER_SIZE + (flow_count) * FORT_LOG_FLOW_STAT_ENTRY_SIZE)
+
+#define FORT_LOG_FLOW_STAT_BUFFER_FLOW_COUNT                                                       \
+    ((FORT_BUFFER_SIZE - FORT_LOG_FLOW_STAT_HEADER_SIZE) / FORT_LOG_FLOW_STAT_ENTRY_SIZE)
 
 #define FORT_LOG_TIME_SIZE (sizeof(UINT32) + sizeof(INT64))
 
+#define FORT_LOG_DROPPED_TYPES 16 /* counters, indexed by the log type */
+
+#define FORT_LOG_DROPPED_SIZE (sizeof(UINT32) + FORT_LOG_DROPPED_TYPES * sizeof(UINT32))
+
+#define FORT_LOG_QUOTA_SIZE (sizeof(UINT32))
+
+/* Per the shaper's queue: group_index * 2 + (inbound ? 0 : 1) */
+#define FORT_LOG_SHAPER_STAT_SIZE (2 * sizeof(UINT32) + sizeof(FORT_SHAPER_STAT))
+
 #define FORT_LOG_SIZE_MAX FORT_LOG_BLOCKED_SIZE_MAX
 
+#define FORT_LOG_RING_SIZE_MIN (8 * 1024 * 1024)
+#define FORT_LOG_RING_SIZE_MAX (64 * 1024 * 1024)
+
+/* Log ring, shared by the driver with the service */
+typedef struct fort_log_ring
+{
+    volatile UINT32 head; /* published by the driver */
+    volatile UINT32 tail; /* consumed by the service */
+    volatile UINT32 waiting; /* the service waits for the event */
+    volatile UINT32 dropped; /* records, dropped on overflow */
+
+    UINT32 size; /* of data, power of 2 */
+
+    UINT32 reserved[11]; /* the data starts on a new cache line */
+
+    /* The records don't cross the data's end: a zero log type marks the wrap */
+    char data[1];
+} FORT_LOG_RING, *PFORT_LOG_RING;
+
+#define FORT_LOG_RING_DATA_OFF offsetof(FORT_LOG_RING, data)
+
+typedef struct fort_log_ring_conf
+{
+    UINT64 ring; /* address of the user buffer of FORT_LOG_RING_DATA_OFF + size bytes */
+    UINT64 event; /* handle of the auto-reset event */
+
+    UINT32 size; /* of data; 0 to detach the ring */
+} FORT_LOG_RING_CONF, *PFORT_LOG_RING_CONF;
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -70,32 +145,77 @@ FORT_API void fort_log_blocked_header_read(
         const char *p, BOOL *blocked, UINT32 *pid, UINT32 *path_len);
 
 FORT_API void fort_log_blocked_ip_header_write(char *p, BOOL isIPv6, BOOL inbound, BOOL inherited,
-        UCHAR block_reason, UCHAR ip_proto, UINT16 local_port, UINT16 remote_port,
-        const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid, UINT32 path_len);
+        UCHAR block_reason, UCHAR sample_rate, UCHAR ip_proto, UINT16 local_port,
+        UINT16 remote_port, const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid,
+        UINT32 path_len);
 
 FORT_API void fort_log_blocked_ip_write(char *p, BOOL isIPv6, BOOL inbound, BOOL inherited,
-        UCHAR block_reason, UCHAR ip_proto, UINT16 local_port, UINT16 remote_port,
-        const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid, UINT32 path_len,
-        const char *path);
+        UCHAR block_reason, UCHAR sample_rate, UCHAR ip_proto, UINT16 local_port,
+        UINT16 remote_port, const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid,
+        UINT32 path_len, const char *path);
 
 FORT_API void fort_log_blocked_ip_header_read(const char *p, BOOL *isIPv6, BOOL *inbound,
-        BOOL *inherited, UCHAR *block_reason, UCHAR *ip_proto, UINT16 *local_port,
-        UINT16 *remote_port, UINT32 *local_ip, UINT32 *remote_ip, UINT32 *pid, UINT32 *path_len);
+        BOOL *inherited, UCHAR *block_reason, UCHAR *sample_rate, UCHAR *ip_proto,
+        UINT16 *local_port, UINT16 *remote_port, UINT32 *local_ip, UINT32 *remote_ip, UINT32 *pid,
+        UINT32 *path_len);
+
+FORT_API void fort_log_blocked_ip_repeat_write(char *p, BOOL isIPv6, BOOL inbound,
+        UCHAR block_reason, UCHAR ip_proto, UINT16 remote_port, const UINT32 *remote_ip,
+        UINT32 pid, UINT32 repeat_count, INT64 first_time, INT64 last_time);
+
+FORT_API void fort_log_blocked_ip_repeat_read(const char *p, BOOL *isIPv6, BOOL *inbound,
+        UCHAR *block_reason, UCHAR *ip_proto, UINT16 *remote_port, UINT32 *remote_ip,
+        UINT32 *pid, UINT32 *repeat_count, INT64 *first_time, INT64 *last_time);
+
+FORT_API void fort_log_proc_new_header_write(
+        char *p, UINT32 pid, UINT32 session_id, UINT32 app_id, UINT32 path_len);
+
+FORT_API void fort_log_proc_new_write(char *p, UINT32 pid, UINT32 session_id, UINT32 app_id,
+        UINT32 path_len, const char *path);
+
+FORT_API void fort_log_proc_new_header_read(
+        const char *p, UINT32 *pid, UINT32 *session_id, UINT32 *app_id, UINT32 *path_len);
 
-FORT_API void fort_log_proc_new_header_write(char *p, UINT32 pid, UINT32 path_len);
+FORT_API void fort_log_path_def_write(char *p, UINT32 path_id, UINT32 path_len, const char *path);
 
-FORT_API void fort_log_proc_new_write(char *p, UINT32 pid, UINT32 path_len, const char *path);
+FORT_API void fort_log_path_def_header_read(const char *p, UINT32 *path_id, UINT32 *path_len);
 
-FORT_API void fort_log_proc_new_header_read(const char *p, UINT32 *pid, UINT32 *path_len);
+FORT_API void fort_log_stat_traf_header_write(
+        char *p, UINT16 proc_count, BOOL compact, BOOL conns);
 
-FORT_API void fort_log_stat_traf_header_write(char *p, UINT16 proc_count);
+FORT_API void fort_log_stat_traf_header_read(
+        const char *p, UINT16 *proc_count, BOOL *compact, BOOL *conns);
 
-FORT_API void fort_log_stat_traf_header_read(const char *p, UINT16 *proc_count);
+FORT_API void fort_log_flow_stat_header_write(char *p, UINT16 flow_count);
+
+FORT_API void fort_log_flow_stat_header_read(const char *p, UINT16 *flow_count);
+
+FORT_API void fort_log_flow_stat_write(char *p, BOOL isIPv6, BOOL inbound, UCHAR ip_proto,
+        UINT16 local_port, UINT16 remote_port, const UINT32 *remote_ip, UINT32 pid,
+        const PFORT_FLOW_TRAF traf);
+
+FORT_API void fort_log_flow_stat_read(const char *p, BOOL *isIPv6, BOOL *inbound, UCHAR *ip_proto,
+        UINT16 *local_port, UINT16 *remote_port, UINT32 *remote_ip, UINT32 *pid,
+        PFORT_FLOW_TRAF traf);
 
 FORT_API void fort_log_time_write(char *p, BOOL system_time_changed, INT64 unix_time);
 
 FORT_API void fort_log_time_read(const char *p, BOOL *system_time_changed, INT64 *unix_time);
 
+FORT_API void fort_log_dropped_write(char *p, const UINT32 *drops);
+
+FORT_API void fort_log_dropped_read(const char *p, UINT32 *drops);
+
+FORT_API void fort_log_quota_write(char *p, UCHAR quota_bits);
+
+FORT_API void fort_log_quota_read(const char *p, UCHAR *quota_bits);
+
+FORT_API void fort_log_shaper_stat_write(
+        char *p, UCHAR queue_index, UINT32 sojourn_max_ms, const PFORT_SHAPER_STAT stat);
+
+FORT_API void fort_log_shaper_stat_read(
+        const char *p, UCHAR *queue_index, UINT32 *sojourn_max_ms, PFORT_SHAPER_STAT stat);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
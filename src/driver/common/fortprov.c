@@ -11,6 +11,7 @@
 #define FORT_PROV_FLOW_FILTERS_COUNT    4
 #define FORT_PROV_PACKET_FILTERS_COUNT  4
 #define FORT_PROV_REAUTH_FILTERS_COUNT  4
+#define FORT_PROV_ADDR_FILTERS_COUNT    4
 
 static struct
 {
@@ -34,6 +35,9 @@ static struct
     FWPM_FILTER0 packet_filters[FORT_PROV_PACKET_FILTERS_COUNT];
 
     FWPM_FILTER0 reauth_filters[FORT_PROV_REAUTH_FILTERS_COUNT];
+
+    FWPM_FILTER0 allow_addr_filters[FORT_PROV_ADDR_FILTERS_COUNT];
+    FWPM_FILTER0 block_addr_filters[FORT_PROV_ADDR_FILTERS_COUNT];
 } g_provGlobal;
 
 static void fort_prov_init_callout(
@@ -296,6 +300,51 @@ static void fort_prov_init_reauth_filters(void)
             FWPM_LAYER_ALE_AUTH_CONNECT_V6, L"FortFilterReauthOut6");
 }
 
+static void fort_prov_init_addr_filter(FWPM_FILTER0 *filter, GUID filterKey, GUID layerKey,
+        PCWCH name, FWP_ACTION_TYPE actionType)
+{
+    /* Higher than the callout filters, the LAN is allowed before the blocked addresses */
+    FWP_VALUE0 weight;
+    weight.type = FWP_UINT8;
+    weight.uint8 = (actionType == FWP_ACTION_PERMIT) ? 11 : 10;
+
+    fort_prov_init_filter(filter, filterKey, layerKey, FORT_GUID_SUBLAYER, name, NULL, weight, 0,
+            actionType);
+}
+
+static void fort_prov_init_addr_filters(void)
+{
+    FWPM_FILTER0 *filter = g_provGlobal.allow_addr_filters;
+
+    /* ofilter4 */
+    fort_prov_init_addr_filter(filter++, FORT_GUID_FILTER_ADDR_ALLOW_CONNECT_V4,
+            FWPM_LAYER_ALE_AUTH_CONNECT_V4, L"FortFilterAddrAllowConnect4", FWP_ACTION_PERMIT);
+    /* ofilter6 */
+    fort_prov_init_addr_filter(filter++, FORT_GUID_FILTER_ADDR_ALLOW_CONNECT_V6,
+            FWPM_LAYER_ALE_AUTH_CONNECT_V6, L"FortFilterAddrAllowConnect6", FWP_ACTION_PERMIT);
+    /* ifilter4 */
+    fort_prov_init_addr_filter(filter++, FORT_GUID_FILTER_ADDR_ALLOW_ACCEPT_V4,
+            FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V4, L"FortFilterAddrAllowAccept4", FWP_ACTION_PERMIT);
+    /* ifilter6 */
+    fort_prov_init_addr_filter(filter++, FORT_GUID_FILTER_ADDR_ALLOW_ACCEPT_V6,
+            FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V6, L"FortFilterAddrAllowAccept6", FWP_ACTION_PERMIT);
+
+    filter = g_provGlobal.block_addr_filters;
+
+    /* ofilter4 */
+    fort_prov_init_addr_filter(filter++, FORT_GUID_FILTER_ADDR_BLOCK_CONNECT_V4,
+            FWPM_LAYER_ALE_AUTH_CONNECT_V4, L"FortFilterAddrBlockConnect4", FWP_ACTION_BLOCK);
+    /* ofilter6 */
+    fort_prov_init_addr_filter(filter++, FORT_GUID_FILTER_ADDR_BLOCK_CONNECT_V6,
+            FWPM_LAYER_ALE_AUTH_CONNECT_V6, L"FortFilterAddrBlockConnect6", FWP_ACTION_BLOCK);
+    /* ifilter4 */
+    fort_prov_init_addr_filter(filter++, FORT_GUID_FILTER_ADDR_BLOCK_ACCEPT_V4,
+            FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V4, L"FortFilterAddrBlockAccept4", FWP_ACTION_BLOCK);
+    /* ifilter6 */
+    fort_prov_init_addr_filter(filter++, FORT_GUID_FILTER_ADDR_BLOCK_ACCEPT_V6,
+            FWPM_LAYER_ALE_AUTH_RECV_ACCEPT_V6, L"FortFilterAddrBlockAccept6", FWP_ACTION_BLOCK);
+}
+
 static void fort_prov_init_provider(void)
 {
     FWPM_PROVIDER0 *provider = &g_provGlobal.provider;
@@ -345,6 +394,8 @@ FORT_API void fort_prov_init()
     fort_prov_init_packet_filters();
 
     fort_prov_init_reauth_filters();
+
+    fort_prov_init_addr_filters();
 }
 
 FORT_API DWORD fort_prov_trans_open(HANDLE *engine)
@@ -413,6 +464,8 @@ static void fort_prov_unregister_filters(HANDLE engine)
     FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_CONNECT_V6);
     FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ACCEPT_V4);
     FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ACCEPT_V6);
+
+    fort_prov_addr_unregister(engine);
 }
 
 static DWORD fort_prov_unregister_reauth_filters(HANDLE engine)
@@ -596,3 +649,224 @@ FORT_API void fort_prov_reauth(HANDLE engine)
         fort_prov_add_filters(engine, g_provGlobal.reauth_filters, FORT_PROV_REAUTH_FILTERS_COUNT);
     }
 }
+
+static BOOL fort_prov_addr_list_fits(const PFORT_CONF_ADDR4_LIST addr_list)
+{
+    const PFORT_CONF_ADDR6_LIST addr6_list = (const PFORT_CONF_ADDR6_LIST)(
+            (const PCHAR) addr_list + FORT_CONF_ADDR4_LIST_REF_SIZE(addr_list));
+
+    return !addr_list->is_packed
+            && addr_list->ip_n + addr_list->pair_n <= FORT_PROV_ADDR_CONDITIONS_MAX
+            && addr6_list->ip_n + addr6_list->pair_n <= FORT_PROV_ADDR_CONDITIONS_MAX;
+}
+
+FORT_API BOOL fort_prov_addr_enabled(const PFORT_CONF conf, const FORT_CONF_FLAGS conf_flags)
+{
+    if (!conf->addr_prov_filters)
+        return FALSE;
+
+    /* The callouts check the blocked traffic and rules before the addresses */
+    if (!conf_flags.filter_enabled || conf_flags.block_traffic)
+        return FALSE;
+
+    const PFORT_CONF_RULES rules = (const PFORT_CONF_RULES) (conf->data + conf->rules_off);
+    if (rules->rules_n != 0)
+        return FALSE;
+
+    /* The callouts log, count and rate limit the connections */
+    if (conf_flags.log_stat || conf_flags.log_allowed_ip || conf_flags.log_blocked_ip
+            || conf->accept_rate_limit != 0)
+        return FALSE;
+
+    /* The LAN must be filtered fully to keep it allowed before the blocked addresses */
+    const PFORT_CONF_ADDR_GROUP lan_group = fort_conf_addr_group_ref(conf, 0);
+
+    if (!lan_group->include_all || lan_group->exclude_all || lan_group->exclude_zones != 0)
+        return FALSE;
+
+    return lan_group->exclude_is_empty
+            || fort_prov_addr_list_fits(fort_conf_addr_group_exclude_list_ref(lan_group));
+}
+
+FORT_API void fort_prov_addr_unregister(HANDLE engine)
+{
+    FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ADDR_ALLOW_CONNECT_V4);
+    FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ADDR_ALLOW_CONNECT_V6);
+    FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ADDR_ALLOW_ACCEPT_V4);
+    FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ADDR_ALLOW_ACCEPT_V6);
+
+    FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ADDR_BLOCK_CONNECT_V4);
+    FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ADDR_BLOCK_CONNECT_V6);
+    FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ADDR_BLOCK_ACCEPT_V4);
+    FwpmFilterDeleteByKey0(engine, (GUID *) &FORT_GUID_FILTER_ADDR_BLOCK_ACCEPT_V6);
+}
+
+static void fort_prov_addr_condition_set(
+        FWPM_FILTER_CONDITION0 *cond, FWP_MATCH_TYPE matchType, FWP_DATA_TYPE type)
+{
+    cond->fieldKey = FWPM_CONDITION_IP_REMOTE_ADDRESS;
+    cond->matchType = matchType;
+    cond->conditionValue.type = type;
+}
+
+static UINT32 fort_prov_addr4_conditions(
+        PFORT_PROV_ADDR_BUF buf, const PFORT_CONF_ADDR4_LIST addr_list)
+{
+    FWPM_FILTER_CONDITION0 *cond = &buf->conditions[1];
+
+    const UINT32 ip_n = addr_list->ip_n;
+    const UINT32 pair_n = addr_list->pair_n;
+
+    for (UINT32 i = 0; i < ip_n; ++i) {
+        fort_prov_addr_condition_set(cond, FWP_MATCH_EQUAL, FWP_UINT32);
+        cond->conditionValue.uint32 = addr_list->ip[i];
+        ++cond;
+    }
+
+    const UINT32 *from_arr = &addr_list->ip[ip_n];
+    const UINT32 *to_arr = from_arr + pair_n;
+
+    for (UINT32 i = 0; i < pair_n; ++i) {
+        FWP_RANGE0 *range = &buf->ranges[i];
+
+        range->valueLow.type = FWP_UINT32;
+        range->valueLow.uint32 = from_arr[i];
+        range->valueHigh.type = FWP_UINT32;
+        range->valueHigh.uint32 = to_arr[i];
+
+        fort_prov_addr_condition_set(cond, FWP_MATCH_RANGE, FWP_RANGE_TYPE);
+        cond->conditionValue.rangeValue = range;
+        ++cond;
+    }
+
+    return ip_n + pair_n;
+}
+
+static void fort_prov_addr_ip6_set(
+        FWP_BYTE_ARRAY16 *value, const ip6_addr_t *ip6, const PFORT_CONF_ADDR6_LIST addr6_list)
+{
+    if (!addr6_list->is_ip_u64) {
+        RtlCopyMemory(value->byteArray16, ip6, sizeof(ip6_addr_t));
+        return;
+    }
+
+    /* The comparable integers to network byte order of address */
+    const PFORT_CONF_IP6 ip6_u64 = (const PFORT_CONF_IP6) ip6;
+
+    const UINT64 hi64 = _byteswap_uint64(ip6_u64->hi);
+    const UINT64 lo64 = _byteswap_uint64(ip6_u64->lo);
+
+    RtlCopyMemory(value->byteArray16, &hi64, sizeof(UINT64));
+    RtlCopyMemory(value->byteArray16 + sizeof(UINT64), &lo64, sizeof(UINT64));
+}
+
+static UINT32 fort_prov_addr6_conditions(
+        PFORT_PROV_ADDR_BUF buf, const PFORT_CONF_ADDR6_LIST addr6_list)
+{
+    FWPM_FILTER_CONDITION0 *cond = &buf->conditions[1];
+    FWP_BYTE_ARRAY16 *value = buf->ip6;
+
+    const UINT32 ip_n = addr6_list->ip_n;
+    const UINT32 pair_n = addr6_list->pair_n;
+
+    for (UINT32 i = 0; i < ip_n; ++i) {
+        fort_prov_addr_ip6_set(value, &addr6_list->ip[i], addr6_list);
+
+        fort_prov_addr_condition_set(cond, FWP_MATCH_EQUAL, FWP_BYTE_ARRAY16_TYPE);
+        cond->conditionValue.byteArray16 = value++;
+        ++cond;
+    }
+
+    const ip6_addr_t *from_arr = &addr6_list->ip[ip_n];
+    const ip6_addr_t *to_arr = from_arr + pair_n;
+
+    for (UINT32 i = 0; i < pair_n; ++i) {
+        FWP_RANGE0 *range = &buf->ranges[i];
+
+        fort_prov_addr_ip6_set(value, &from_arr[i], addr6_list);
+        range->valueLow.type = FWP_BYTE_ARRAY16_TYPE;
+        range->valueLow.byteArray16 = value++;
+
+        fort_prov_addr_ip6_set(value, &to_arr[i], addr6_list);
+        range->valueHigh.type = FWP_BYTE_ARRAY16_TYPE;
+        range->valueHigh.byteArray16 = value++;
+
+        fort_prov_addr_condition_set(cond, FWP_MATCH_RANGE, FWP_RANGE_TYPE);
+        cond->conditionValue.rangeValue = range;
+        ++cond;
+    }
+
+    return ip_n + pair_n;
+}
+
+static DWORD fort_prov_addr_filter_add(
+        HANDLE engine, const FWPM_FILTER0 *filter, PFORT_PROV_ADDR_BUF buf, UINT32 addr_n)
+{
+    if (addr_n == 0)
+        return 0;
+
+    FWPM_FILTER0 addr_filter = *filter;
+    addr_filter.numFilterConditions = 1 + addr_n;
+    addr_filter.filterCondition = buf->conditions;
+
+    return FwpmFilterAdd0(engine, &addr_filter, NULL, NULL);
+}
+
+static DWORD fort_prov_addr_filters_add(HANDLE engine, const FWPM_FILTER0 *filters,
+        PFORT_PROV_ADDR_BUF buf, const PFORT_CONF_ADDR4_LIST addr_list)
+{
+    DWORD status;
+
+    /* ofilter4, ifilter4 */
+    const UINT32 addr4_n = fort_prov_addr4_conditions(buf, addr_list);
+
+    if ((status = fort_prov_addr_filter_add(engine, &filters[0], buf, addr4_n)))
+        return status;
+
+    if ((status = fort_prov_addr_filter_add(engine, &filters[2], buf, addr4_n)))
+        return status;
+
+    /* ofilter6, ifilter6 */
+    const PFORT_CONF_ADDR6_LIST addr6_list = (const PFORT_CONF_ADDR6_LIST)(
+            (const PCHAR) addr_list + FORT_CONF_ADDR4_LIST_REF_SIZE(addr_list));
+
+    const UINT32 addr6_n = fort_prov_addr6_conditions(buf, addr6_list);
+
+    if ((status = fort_prov_addr_filter_add(engine, &filters[1], buf, addr6_n)))
+        return status;
+
+    return fort_prov_addr_filter_add(engine, &filters[3], buf, addr6_n);
+}
+
+FORT_API DWORD fort_prov_addr_register(
+        HANDLE engine, const PFORT_CONF conf, PFORT_PROV_ADDR_BUF buf)
+{
+    DWORD status;
+
+    /* The loopback is allowed by the callouts */
+    FWPM_FILTER_CONDITION0 *flags_cond = &buf->conditions[0];
+    flags_cond->fieldKey = FWPM_CONDITION_FLAGS;
+    flags_cond->matchType = FWP_MATCH_FLAGS_NONE_SET;
+    flags_cond->conditionValue.type = FWP_UINT32;
+    flags_cond->conditionValue.uint32 = FWP_CONDITION_FLAG_IS_LOOPBACK;
+
+    /* LAN addresses */
+    const PFORT_CONF_ADDR_GROUP lan_group = fort_conf_addr_group_ref(conf, 0);
+
+    if (!lan_group->exclude_is_empty
+            && (status = fort_prov_addr_filters_add(engine, g_provGlobal.allow_addr_filters, buf,
+                        fort_conf_addr_group_exclude_list_ref(lan_group))))
+        return status;
+
+    /* Blocked Internet addresses, the zones are checked by the callouts */
+    const PFORT_CONF_ADDR_GROUP inet_group = fort_conf_addr_group_ref(conf, 1);
+
+    if (inet_group->exclude_all || inet_group->exclude_is_empty)
+        return 0;
+
+    const PFORT_CONF_ADDR4_LIST block_list = fort_conf_addr_group_exclude_list_ref(inet_group);
+    if (!fort_prov_addr_list_fits(block_list))
+        return 0;
+
+    return fort_prov_addr_filters_add(engine, g_provGlobal.block_addr_filters, buf, block_list);
+}
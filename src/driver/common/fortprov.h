@@ -3,6 +3,8 @@
 
 #include "common.h"
 
+#include "fortconf.h"
+
 typedef struct fort_prov_boot_conf
 {
     union {
@@ -16,6 +18,17 @@ typedef struct fort_prov_boot_conf
     };
 } FORT_PROV_BOOT_CONF, *PFORT_PROV_BOOT_CONF;
 
+/* Addresses per filter, the larger lists are checked by the callouts */
+#define FORT_PROV_ADDR_CONDITIONS_MAX 512
+
+/* Conditions of the address filters, the filters are copied by BFE */
+typedef struct fort_prov_addr_buf
+{
+    FWPM_FILTER_CONDITION0 conditions[1 + FORT_PROV_ADDR_CONDITIONS_MAX]; /* flags first */
+    FWP_RANGE0 ranges[FORT_PROV_ADDR_CONDITIONS_MAX];
+    FWP_BYTE_ARRAY16 ip6[FORT_PROV_ADDR_CONDITIONS_MAX * 2];
+} FORT_PROV_ADDR_BUF, *PFORT_PROV_ADDR_BUF;
+
 #define fort_prov_open(engine)         FwpmEngineOpen0(NULL, RPC_C_AUTHN_WINNT, NULL, NULL, (engine))
 #define fort_prov_close(engine)        FwpmEngineClose0(engine)
 #define fort_prov_trans_begin(engine)  FwpmTransactionBegin0((engine), 0)
@@ -48,6 +61,13 @@ FORT_API DWORD fort_prov_flow_register(HANDLE engine, BOOL filter_packets);
 
 FORT_API void fort_prov_reauth(HANDLE engine);
 
+FORT_API BOOL fort_prov_addr_enabled(const PFORT_CONF conf, const FORT_CONF_FLAGS conf_flags);
+
+FORT_API void fort_prov_addr_unregister(HANDLE engine);
+
+FORT_API DWORD fort_prov_addr_register(
+        HANDLE engine, const PFORT_CONF conf, PFORT_PROV_ADDR_BUF buf);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
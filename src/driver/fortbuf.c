@@ -4,11 +4,12 @@
 
 #include "fortdbg.h"
 #include "fortdev.h"
+#include "fortetw.h"
+#include "fortmem.h"
+#include "forttds.h"
 #include "forttrace.h"
 #include "fortutl.h"
 
-#define FORT_BUFFER_POOL_TAG 'BwfF'
-
 static PFORT_BUFFER_DATA fort_buffer_data_new(PFORT_BUFFER buf)
 {
     PFORT_BUFFER_DATA data = buf->data_free;
@@ -16,7 +17,7 @@ static PFORT_BUFFER_DATA fort_buffer_data_new(PFORT_BUFFER buf)
     if (data != NULL) {
         buf->data_free = data->next;
     } else {
-        data = fort_mem_alloc(sizeof(FORT_BUFFER_DATA), FORT_BUFFER_POOL_TAG);
+        data = fort_mem_type_alloc(FORT_MEM_BUFFER, sizeof(FORT_BUFFER_DATA));
     }
 
     return data;
@@ -26,17 +27,17 @@ static void fort_buffer_data_del(PFORT_BUFFER_DATA data)
 {
     while (data != NULL) {
         PFORT_BUFFER_DATA next = data->next;
-        fort_mem_free(data, FORT_BUFFER_POOL_TAG);
+        fort_mem_type_free(FORT_MEM_BUFFER, data);
         data = next;
     }
 }
 
-static PFORT_BUFFER_DATA fort_buffer_data_alloc(PFORT_BUFFER buf, UINT32 len)
+static PFORT_BUFFER_DATA fort_buffer_data_alloc(PFORT_BUFFER buf, UINT32 len, UINT32 data_max)
 {
     PFORT_BUFFER_DATA data = buf->data_tail;
 
     if (data == NULL || len > FORT_BUFFER_SIZE - data->top) {
-        if (len > FORT_BUFFER_SIZE)
+        if (len > FORT_BUFFER_SIZE || buf->data_count >= data_max)
             return NULL;
 
         PFORT_BUFFER_DATA new_data = fort_buffer_data_new(buf);
@@ -53,6 +54,7 @@ static PFORT_BUFFER_DATA fort_buffer_data_alloc(PFORT_BUFFER buf, UINT32 len)
         }
 
         buf->data_tail = new_data;
+        ++buf->data_count;
 
         data = new_data;
     }
@@ -72,10 +74,71 @@ static void fort_buffer_data_shift(PFORT_BUFFER buf)
 
     data->next = buf->data_free;
     buf->data_free = data;
+
+    --buf->data_count;
+}
+
+static void fort_buffer_paths_del(PFORT_BUFFER buf)
+{
+    for (UINT16 i = 0; i < FORT_BUFFER_PATHS_COUNT; ++i) {
+        PFORT_BUFFER_PATH entry = &buf->paths[i];
+
+        if (entry->path != NULL) {
+            fort_mem_type_free(FORT_MEM_BUFFER, entry->path);
+        }
+    }
+}
+
+static UINT32 fort_buffer_data_limit(UINT16 limit_mb)
+{
+    if (limit_mb == 0) {
+        limit_mb = FORT_BUFFER_LIMIT_DEFAULT;
+    } else if (limit_mb > FORT_BUFFER_LIMIT_MAX) {
+        limit_mb = FORT_BUFFER_LIMIT_MAX;
+    }
+
+    return (UINT32) limit_mb * (1024 * 1024 / sizeof(FORT_BUFFER_DATA));
+}
+
+/* The blocked connections are dropped first, the stat records are kept */
+static UINT32 fort_buffer_data_max(PFORT_BUFFER buf, UCHAR log_type)
+{
+    const UINT32 data_limit = buf->data_limit;
+
+    switch (log_type) {
+    case FORT_LOG_TYPE_BLOCKED_IP:
+    case FORT_LOG_TYPE_BLOCKED_IP_REPEAT:
+        return data_limit / 2;
+    case FORT_LOG_TYPE_STAT_TRAF:
+    case FORT_LOG_TYPE_FLOW_STAT:
+    case FORT_LOG_TYPE_TIME:
+    case FORT_LOG_TYPE_DROPPED:
+    case FORT_LOG_TYPE_QUOTA:
+    case FORT_LOG_TYPE_SHAPER_STAT:
+        return data_limit + data_limit / 4;
+    default:
+        return data_limit;
+    }
+}
+
+static void fort_buffer_drop(PFORT_BUFFER buf, UCHAR log_type)
+{
+    if (log_type < FORT_LOG_DROPPED_TYPES) {
+        ++buf->drops[log_type];
+    }
+
+    buf->drops_pending = TRUE;
+
+    fort_perf_add(&fort_device()->perf, FORT_PERF_LOG_DROPS, 1);
 }
 
 FORT_API void fort_buffer_open(PFORT_BUFFER buf)
 {
+    buf->data_limit = fort_buffer_data_limit(0);
+
+    const LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+    buf->sample_seed = now.LowPart;
+
     KeInitializeSpinLock(&buf->lock);
 }
 
@@ -83,6 +146,8 @@ FORT_API void fort_buffer_close(PFORT_BUFFER buf)
 {
     fort_buffer_data_del(buf->data_head);
     fort_buffer_data_del(buf->data_free);
+
+    fort_buffer_paths_del(buf);
 }
 
 FORT_API void fort_buffer_clear(PFORT_BUFFER buf)
@@ -95,10 +160,197 @@ FORT_API void fort_buffer_clear(PFORT_BUFFER buf)
     buf->data_head = NULL;
     buf->data_tail = NULL;
     buf->data_free = NULL;
+    buf->data_count = 0;
+
+    buf->drops_pending = FALSE;
+    RtlZeroMemory(buf->drops, sizeof(buf->drops));
+
+    buf->repeats_pending = 0;
+    RtlZeroMemory(buf->repeats, sizeof(buf->repeats));
+
+    RtlZeroMemory(buf->paths, sizeof(buf->paths));
+
+    RtlZeroMemory(buf->apps_reported, sizeof(buf->apps_reported));
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
+FORT_API void fort_buffer_conf_update(PFORT_BUFFER buf, const PFORT_CONF conf)
+{
+    buf->data_limit = fort_buffer_data_limit(conf->log_buffer_limit);
+
+    buf->sample_first = conf->log_allowed_ip_first;
+    buf->sample_rate = conf->log_allowed_ip_rate;
+
+    /* The service forgets the conf apps' paths */
+    fort_buffer_apps_unreport(buf);
+}
+
+FORT_API void fort_buffer_apps_unreport(PFORT_BUFFER buf)
+{
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+    {
+        RtlZeroMemory(buf->apps_reported, sizeof(buf->apps_reported));
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+}
+
+FORT_API UINT64 fort_buffer_data_bytes(PFORT_BUFFER buf)
+{
+    UINT32 data_count;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+    {
+        data_count = buf->data_count;
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return (UINT64) data_count * sizeof(FORT_BUFFER_DATA);
+}
+
+static NTSTATUS fort_buffer_ring_lock(PVOID address, ULONG len, PMDL *mdl, PFORT_LOG_RING *ring)
+{
+    PMDL ring_mdl = IoAllocateMdl(address, len, FALSE, FALSE, NULL);
+    if (ring_mdl == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    __try {
+        MmProbeAndLockPages(ring_mdl, UserMode, IoWriteAccess);
+    } __except (EXCEPTION_EXECUTE_HANDLER) {
+        IoFreeMdl(ring_mdl);
+        return GetExceptionCode();
+    }
+
+    *ring = MmGetSystemAddressForMdlSafe(ring_mdl, NormalPagePriority | MdlMappingNoExecute);
+    if (*ring == NULL) {
+        MmUnlockPages(ring_mdl);
+        IoFreeMdl(ring_mdl);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    *mdl = ring_mdl;
+
+    return STATUS_SUCCESS;
+}
+
+static void fort_buffer_ring_unlock(PMDL mdl)
+{
+    MmUnlockPages(mdl);
+    IoFreeMdl(mdl);
+}
+
+FORT_API NTSTATUS fort_buffer_ring_open(PFORT_BUFFER buf, const PFORT_LOG_RING_CONF ring_conf)
+{
+    fort_buffer_ring_close(buf);
+
+    const UINT32 size = ring_conf->size;
+    if (size == 0)
+        return STATUS_SUCCESS; /* detached */
+
+    if (size < FORT_LOG_RING_SIZE_MIN || size > FORT_LOG_RING_SIZE_MAX
+            || (size & (size - 1)) != 0)
+        return STATUS_INVALID_PARAMETER;
+
+    PKEVENT event;
+    NTSTATUS status = ObReferenceObjectByHandle((HANDLE) (ULONG_PTR) ring_conf->event,
+            EVENT_MODIFY_STATE, *ExEventObjectType, UserMode, (PVOID *) &event, NULL);
+    if (!NT_SUCCESS(status))
+        return status;
+
+    PMDL mdl;
+    PFORT_LOG_RING ring;
+    status = fort_buffer_ring_lock(
+            (PVOID) (ULONG_PTR) ring_conf->ring, FORT_LOG_RING_DATA_OFF + size, &mdl, &ring);
+    if (!NT_SUCCESS(status)) {
+        ObDereferenceObject(event);
+        return status;
+    }
+
+    RtlZeroMemory(ring, FORT_LOG_RING_DATA_OFF);
+    ring->size = size;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+
+    buf->ring = ring;
+    buf->ring_mdl = mdl;
+    buf->ring_event = event;
+    buf->ring_size = size;
+    buf->ring_top = 0;
+    buf->ring_head = 0;
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return STATUS_SUCCESS;
+}
+
+FORT_API void fort_buffer_ring_close(PFORT_BUFFER buf)
+{
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+
+    const PMDL mdl = buf->ring_mdl;
+    const PKEVENT event = buf->ring_event;
+
+    buf->ring = NULL;
+    buf->ring_mdl = NULL;
+    buf->ring_event = NULL;
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    if (mdl != NULL) {
+        fort_buffer_ring_unlock(mdl);
+        ObDereferenceObject(event);
+    }
+}
+
+inline static NTSTATUS fort_buffer_prepare_ring(PFORT_BUFFER buf, UINT32 len, PCHAR *out)
+{
+    PFORT_LOG_RING ring = buf->ring;
+    const UINT32 size = buf->ring_size;
+    UINT32 top = buf->ring_top;
+
+    /* Wrap, when the record doesn't fit before the data's end */
+    const UINT32 pos = top & (size - 1);
+    const UINT32 pad = (len > size - pos) ? (size - pos) : 0;
+
+    /* The reader is behind for the whole ring, or its tail is invalid */
+    if (top + pad + len - ring->tail > size) {
+        ++ring->dropped;
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    if (pad != 0) {
+        *((UINT32 *) (ring->data + pos)) = FORT_LOG_TYPE_NONE;
+        top += pad;
+    }
+
+    *out = ring->data + (top & (size - 1));
+    buf->ring_top = top + len;
+
+    return STATUS_SUCCESS;
+}
+
+/* The reserved records are written already, as their writers hold the lock */
+static void fort_buffer_ring_publish(PFORT_BUFFER buf)
+{
+    PFORT_LOG_RING ring = buf->ring;
+
+    if (ring == NULL || buf->ring_head == buf->ring_top)
+        return;
+
+    buf->ring_head = buf->ring_top;
+
+    InterlockedExchange((volatile LONG *) &ring->head, (LONG) buf->ring_head);
+
+    /* Signal the idle reader only */
+    if (ring->waiting != 0 && InterlockedExchange((volatile LONG *) &ring->waiting, 0) != 0) {
+        KeSetEvent(buf->ring_event, IO_NO_INCREMENT, FALSE);
+    }
+}
+
 inline static NTSTATUS fort_buffer_prepare_pending(
         PFORT_BUFFER buf, UINT32 len, PCHAR *out, PIRP *irp, ULONG_PTR *info)
 {
@@ -124,12 +376,17 @@ inline static NTSTATUS fort_buffer_prepare_pending(
     return STATUS_SUCCESS;
 }
 
-inline static NTSTATUS fort_buffer_prepare_new(PFORT_BUFFER buf, UINT32 len, PCHAR *out)
+inline static NTSTATUS fort_buffer_prepare_new(
+        PFORT_BUFFER buf, UCHAR log_type, UINT32 len, PCHAR *out)
 {
-    PFORT_BUFFER_DATA data = fort_buffer_data_alloc(buf, len);
+    const UINT32 data_max = fort_buffer_data_max(buf, log_type);
+
+    PFORT_BUFFER_DATA data = fort_buffer_data_alloc(buf, len, data_max);
     if (data == NULL) {
-        LOG("Buffer OOM: len=%d\n", len);
-        TRACE(FORT_BUFFER_OOM, STATUS_INSUFFICIENT_RESOURCES, len, 0);
+        if (buf->data_count < data_max) {
+            LOG("Buffer OOM: len=%d\n", len);
+            TRACE(FORT_BUFFER_OOM, STATUS_INSUFFICIENT_RESOURCES, len, 0);
+        }
         return STATUS_INSUFFICIENT_RESOURCES;
     }
 
@@ -139,9 +396,12 @@ inline static NTSTATUS fort_buffer_prepare_new(PFORT_BUFFER buf, UINT32 len, PCH
     return STATUS_SUCCESS;
 }
 
-FORT_API NTSTATUS fort_buffer_prepare(
-        PFORT_BUFFER buf, UINT32 len, PCHAR *out, PIRP *irp, ULONG_PTR *info)
+static NTSTATUS fort_buffer_prepare_out(
+        PFORT_BUFFER buf, UCHAR log_type, UINT32 len, PCHAR *out, PIRP *irp, ULONG_PTR *info)
 {
+    if (buf->ring != NULL)
+        return fort_buffer_prepare_ring(buf, len, out);
+
     /* Check a pending buffer */
     if (buf->data_head == NULL) {
         const ULONG out_len = buf->out_len;
@@ -151,7 +411,62 @@ FORT_API NTSTATUS fort_buffer_prepare(
         }
     }
 
-    return fort_buffer_prepare_new(buf, len, out);
+    return fort_buffer_prepare_new(buf, log_type, len, out);
+}
+
+FORT_API NTSTATUS fort_buffer_prepare(
+        PFORT_BUFFER buf, UCHAR log_type, UINT32 len, PCHAR *out, PIRP *irp, ULONG_PTR *info)
+{
+    const NTSTATUS status = fort_buffer_prepare_out(buf, log_type, len, out, irp, info);
+
+    if (!NT_SUCCESS(status)) {
+        fort_buffer_drop(buf, log_type);
+    }
+
+    return status;
+}
+
+/* Returns the record's path_len: the interned path's id or the path's own length */
+static UINT32 fort_buffer_path_intern(
+        PFORT_BUFFER buf, UINT32 path_len, const PVOID path, PIRP *irp, ULONG_PTR *info)
+{
+    if (path_len == 0)
+        return 0;
+
+    const UINT32 hash = (UINT32) tommy_hash_u32(0, path, path_len);
+    const UINT32 index = hash & (FORT_BUFFER_PATHS_COUNT - 1);
+
+    PFORT_BUFFER_PATH entry = &buf->paths[index];
+
+    if (entry->hash == hash && entry->len == path_len
+            && RtlEqualMemory(entry->path, path, path_len))
+        return fort_log_path_id(index + 1);
+
+    /* The path is (re)defined, before the records of its id */
+    PCHAR path_copy = fort_mem_type_alloc(FORT_MEM_BUFFER, path_len);
+    if (path_copy == NULL)
+        return path_len;
+
+    PCHAR out;
+    if (!NT_SUCCESS(fort_buffer_prepare(
+                buf, FORT_LOG_TYPE_PATH_DEF, FORT_LOG_PATH_DEF_SIZE(path_len), &out, irp, info))) {
+        fort_mem_type_free(FORT_MEM_BUFFER, path_copy);
+        return path_len;
+    }
+
+    fort_log_path_def_write(out, index + 1, path_len, path);
+
+    RtlCopyMemory(path_copy, path, path_len);
+
+    if (entry->path != NULL) {
+        fort_mem_type_free(FORT_MEM_BUFFER, entry->path);
+    }
+
+    entry->hash = hash;
+    entry->len = (UINT16) path_len;
+    entry->path = path_copy;
+
+    return fort_log_path_id(index + 1);
 }
 
 FORT_API NTSTATUS fort_buffer_blocked_write(PFORT_BUFFER buf, BOOL blocked, UINT32 pid,
@@ -163,16 +478,21 @@ FORT_API NTSTATUS fort_buffer_blocked_write(PFORT_BUFFER buf, BOOL blocked, UINT
         path_len = 0; /* drop too long path */
     }
 
-    const UINT32 len = FORT_LOG_BLOCKED_SIZE(path_len);
-
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
     {
+        path_len = fort_buffer_path_intern(buf, path_len, path, irp, info);
+
+        const UCHAR log_type = blocked ? FORT_LOG_TYPE_BLOCKED : FORT_LOG_TYPE_ALLOWED;
+        const UINT32 len = FORT_LOG_BLOCKED_SIZE(path_len);
+
         PCHAR out;
-        status = fort_buffer_prepare(buf, len, &out, irp, info);
+        status = fort_buffer_prepare(buf, log_type, len, &out, irp, info);
 
         if (NT_SUCCESS(status)) {
             fort_log_blocked_write(out, blocked, pid, path_len, path);
+
+            fort_buffer_ring_publish(buf);
         }
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
@@ -180,6 +500,112 @@ FORT_API NTSTATUS fort_buffer_blocked_write(PFORT_BUFFER buf, BOOL blocked, UINT
     return status;
 }
 
+static void fort_buffer_repeat_key_init(PFORT_BUFFER_REPEAT_KEY key, BOOL isIPv6, BOOL inbound,
+        UCHAR block_reason, UCHAR ip_proto, UINT16 remote_port, const UINT32 *remote_ip,
+        UINT32 pid)
+{
+    RtlZeroMemory(key, sizeof(FORT_BUFFER_REPEAT_KEY));
+
+    key->pid = pid;
+    RtlCopyMemory(key->remote_ip, remote_ip, FORT_IP_ADDR_SIZE(isIPv6));
+    key->remote_port = remote_port;
+    key->ip_proto = ip_proto;
+    key->block_reason = block_reason;
+    key->inbound = (UCHAR) inbound;
+    key->isIPv6 = (UCHAR) isIPv6;
+}
+
+inline static tommy_key_t fort_buffer_repeat_key_hash(const PFORT_BUFFER_REPEAT_KEY key)
+{
+    return (tommy_key_t) tommy_hash_u32(0, key, sizeof(FORT_BUFFER_REPEAT_KEY));
+}
+
+static PFORT_BUFFER_REPEAT fort_buffer_repeat_entry(
+        PFORT_BUFFER buf, const PFORT_BUFFER_REPEAT_KEY key)
+{
+    const tommy_key_t key_hash = fort_buffer_repeat_key_hash(key);
+
+    return &buf->repeats[key_hash & (FORT_BUFFER_REPEATS_COUNT - 1)];
+}
+
+inline static BOOL fort_buffer_repeat_expired(PFORT_BUFFER_REPEAT repeat, INT64 system_time)
+{
+    /* The system time may be changed backwards */
+    return (UINT64) (system_time - repeat->window_time) >= FORT_BUFFER_REPEAT_WINDOW;
+}
+
+static BOOL fort_buffer_repeat_hit(PFORT_BUFFER buf, PFORT_BUFFER_REPEAT repeat,
+        const PFORT_BUFFER_REPEAT_KEY key, INT64 system_time)
+{
+    if (fort_buffer_repeat_expired(repeat, system_time)
+            || !RtlEqualMemory(&repeat->key, key, sizeof(FORT_BUFFER_REPEAT_KEY)))
+        return FALSE;
+
+    const INT64 unix_time = fort_system_to_unix_time(system_time);
+
+    if (repeat->count++ == 0) {
+        repeat->first_time = unix_time;
+        ++buf->repeats_pending;
+    }
+
+    repeat->last_time = unix_time;
+
+    return TRUE;
+}
+
+static void fort_buffer_repeat_flush(
+        PFORT_BUFFER buf, PFORT_BUFFER_REPEAT repeat, PIRP *irp, ULONG_PTR *info)
+{
+    if (repeat->count == 0)
+        return;
+
+    const PFORT_BUFFER_REPEAT_KEY key = &repeat->key;
+    const UINT32 len = FORT_LOG_BLOCKED_IP_REPEAT_SIZE(key->isIPv6);
+
+    PCHAR out;
+    const NTSTATUS status =
+            fort_buffer_prepare(buf, FORT_LOG_TYPE_BLOCKED_IP_REPEAT, len, &out, irp, info);
+
+    if (NT_SUCCESS(status)) {
+        fort_log_blocked_ip_repeat_write(out, key->isIPv6, key->inbound, key->block_reason,
+                key->ip_proto, key->remote_port, key->remote_ip, key->pid, repeat->count,
+                repeat->first_time, repeat->last_time);
+    }
+
+    repeat->count = 0;
+    --buf->repeats_pending;
+}
+
+static void fort_buffer_repeat_start(
+        PFORT_BUFFER_REPEAT repeat, const PFORT_BUFFER_REPEAT_KEY key, INT64 system_time)
+{
+    RtlCopyMemory(&repeat->key, key, sizeof(FORT_BUFFER_REPEAT_KEY));
+    repeat->window_time = system_time;
+}
+
+static NTSTATUS fort_buffer_blocked_ip_record_write(PFORT_BUFFER buf, BOOL isIPv6, BOOL inbound,
+        BOOL inherited, UCHAR block_reason, UCHAR sample_rate, UCHAR ip_proto, UINT16 local_port,
+        UINT16 remote_port, const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid,
+        UINT32 path_len, const PVOID path, PIRP *irp, ULONG_PTR *info)
+{
+    path_len = fort_buffer_path_intern(buf, path_len, path, irp, info);
+
+    const UINT32 len = FORT_LOG_BLOCKED_IP_SIZE(path_len, isIPv6);
+
+    PCHAR out;
+    const NTSTATUS status =
+            fort_buffer_prepare(buf, FORT_LOG_TYPE_BLOCKED_IP, len, &out, irp, info);
+
+    if (NT_SUCCESS(status)) {
+        fort_log_blocked_ip_write(out, isIPv6, inbound, inherited, block_reason, sample_rate,
+                ip_proto, local_port, remote_port, local_ip, remote_ip, pid, path_len, path);
+
+        fort_buffer_ring_publish(buf);
+    }
+
+    return status;
+}
+
 NTSTATUS fort_buffer_blocked_ip_write(PFORT_BUFFER buf, BOOL isIPv6, BOOL inbound, BOOL inherited,
         UCHAR block_reason, UCHAR ip_proto, UINT16 local_port, UINT16 remote_port,
         const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid, UINT32 path_len,
@@ -193,26 +619,129 @@ NTSTATUS fort_buffer_blocked_ip_write(PFORT_BUFFER buf, BOOL isIPv6, BOOL inboun
         path_len = 0; /* drop too long path */
     }
 
-    const UINT32 len = FORT_LOG_BLOCKED_IP_SIZE(path_len, isIPv6);
+    FORT_BUFFER_REPEAT_KEY key;
+    fort_buffer_repeat_key_init(
+            &key, isIPv6, inbound, block_reason, ip_proto, remote_port, remote_ip, pid);
+
+    LARGE_INTEGER system_time;
+    KeQuerySystemTime(&system_time);
 
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
-    {
-        PCHAR out;
-        status = fort_buffer_prepare(buf, len, &out, irp, info);
 
-        if (NT_SUCCESS(status)) {
-            fort_log_blocked_ip_write(out, isIPv6, inbound, inherited, block_reason, ip_proto,
-                    local_port, remote_port, local_ip, remote_ip, pid, path_len, path);
-        }
+    PFORT_BUFFER_REPEAT repeat = fort_buffer_repeat_entry(buf, &key);
+
+    /* Only the first record of the window is written in full */
+    if (fort_buffer_repeat_hit(buf, repeat, &key, system_time.QuadPart)) {
+        status = STATUS_SUCCESS;
+    } else {
+        fort_buffer_repeat_flush(buf, repeat, irp, info);
+        fort_buffer_repeat_start(repeat, &key, system_time.QuadPart);
+
+        status = fort_buffer_blocked_ip_record_write(buf, isIPv6, inbound, inherited,
+                block_reason, /*sample_rate=*/0, ip_proto, local_port, remote_port, local_ip,
+                remote_ip, pid, path_len, path, irp, info);
     }
+
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
     return status;
 }
 
-FORT_API NTSTATUS fort_buffer_proc_new_write(
-        PFORT_BUFFER buf, UINT32 pid, UINT32 path_len, const PVOID path, PIRP *irp, ULONG_PTR *info)
+/* Returns the sampling rate of the connection to log, 0 to skip it */
+static UCHAR fort_buffer_sample_check(
+        PFORT_BUFFER buf, const PFORT_BUFFER_REPEAT_KEY key, INT64 system_time)
+{
+    if (buf->sample_first == 0 && buf->sample_rate == 0)
+        return 1; /* log all */
+
+    const tommy_key_t key_hash = fort_buffer_repeat_key_hash(key);
+
+    PFORT_BUFFER_SAMPLE sample = &buf->samples[key_hash & (FORT_BUFFER_SAMPLES_COUNT - 1)];
+
+    /* The system time may be changed backwards */
+    if ((UINT64) (system_time - sample->window_time) >= FORT_BUFFER_SAMPLE_WINDOW
+            || !RtlEqualMemory(&sample->key, key, sizeof(FORT_BUFFER_REPEAT_KEY))) {
+        RtlCopyMemory(&sample->key, key, sizeof(FORT_BUFFER_REPEAT_KEY));
+        sample->window_time = system_time;
+        sample->count = 0;
+    }
+
+    if (sample->count < buf->sample_first) {
+        ++sample->count;
+        return 1;
+    }
+
+    if (buf->sample_rate != 0 && RtlRandomEx(&buf->sample_seed) % buf->sample_rate == 0)
+        return buf->sample_rate;
+
+    return 0;
+}
+
+FORT_API NTSTATUS fort_buffer_allowed_ip_write(PFORT_BUFFER buf, BOOL isIPv6, BOOL inbound,
+        BOOL inherited, UCHAR ip_proto, UINT16 local_port, UINT16 remote_port,
+        const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid, UINT32 path_len,
+        const PVOID path, PIRP *irp, ULONG_PTR *info)
+{
+    NTSTATUS status = STATUS_SUCCESS;
+
+    if (path_len > FORT_LOG_PATH_MAX) {
+        path_len = 0; /* drop too long path */
+    }
+
+    FORT_BUFFER_REPEAT_KEY key;
+    fort_buffer_repeat_key_init(&key, isIPv6, inbound, FORT_BLOCK_REASON_ALLOWED, ip_proto,
+            remote_port, remote_ip, pid);
+
+    LARGE_INTEGER system_time;
+    KeQuerySystemTime(&system_time);
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
+
+    const UCHAR sample_rate = fort_buffer_sample_check(buf, &key, system_time.QuadPart);
+
+    if (sample_rate != 0) {
+        status = fort_buffer_blocked_ip_record_write(buf, isIPv6, inbound, inherited,
+                FORT_BLOCK_REASON_ALLOWED, sample_rate, ip_proto, local_port, remote_port,
+                local_ip, remote_ip, pid, path_len, path, irp, info);
+    }
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return status;
+}
+
+/* Called with the buffer locked: the inbound connections from the address are summarized */
+FORT_API void fort_buffer_blocked_ip_summary_write(PFORT_BUFFER buf, BOOL isIPv6,
+        UCHAR block_reason, const UINT32 *remote_ip, UINT32 count, INT64 first_time,
+        INT64 last_time, PIRP *irp, ULONG_PTR *info)
+{
+    const UINT32 local_ip[4] = { 0 };
+
+    if (!NT_SUCCESS(fort_buffer_blocked_ip_record_write(buf, isIPv6, /*inbound=*/TRUE,
+                /*inherited=*/FALSE, block_reason, /*sample_rate=*/0, /*ip_proto=*/0,
+                /*local_port=*/0, /*remote_port=*/0, local_ip, remote_ip, /*pid=*/0,
+                /*path_len=*/0, /*path=*/NULL, irp, info)))
+        return;
+
+    if (count <= 1)
+        return;
+
+    const UINT32 len = FORT_LOG_BLOCKED_IP_REPEAT_SIZE(isIPv6);
+
+    PCHAR out;
+    if (!NT_SUCCESS(fort_buffer_prepare(
+                buf, FORT_LOG_TYPE_BLOCKED_IP_REPEAT, len, &out, irp, info)))
+        return;
+
+    fort_log_blocked_ip_repeat_write(out, isIPv6, /*inbound=*/TRUE, block_reason,
+            /*ip_proto=*/0, /*remote_port=*/0, remote_ip, /*pid=*/0, count - 1, first_time,
+            last_time);
+}
+
+FORT_API NTSTATUS fort_buffer_proc_new_write(PFORT_BUFFER buf, UINT32 pid, UINT32 session_id,
+        UINT32 app_id, UINT32 path_len, const PVOID path, PIRP *irp, ULONG_PTR *info)
 {
     NTSTATUS status;
 
@@ -220,16 +749,33 @@ FORT_API NTSTATUS fort_buffer_proc_new_write(
         path_len = 0; /* drop too long path */
     }
 
-    const UINT32 len = FORT_LOG_PROC_NEW_SIZE(path_len);
+    PUINT32 app_reported = (app_id != 0)
+            ? &buf->apps_reported[app_id & (FORT_BUFFER_APPS_COUNT - 1)]
+            : NULL;
 
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&buf->lock, &lock_queue);
     {
+        /* The reported conf app's path is known to the service by the app's id */
+        if (app_reported != NULL && *app_reported == app_id) {
+            path_len = 0;
+        } else {
+            path_len = fort_buffer_path_intern(buf, path_len, path, irp, info);
+        }
+
+        const UINT32 len = FORT_LOG_PROC_NEW_SIZE(path_len);
+
         PCHAR out;
-        status = fort_buffer_prepare(buf, len, &out, irp, info);
+        status = fort_buffer_prepare(buf, FORT_LOG_TYPE_PROC_NEW, len, &out, irp, info);
 
         if (NT_SUCCESS(status)) {
-            fort_log_proc_new_write(out, pid, path_len, path);
+            fort_log_proc_new_write(out, pid, session_id, app_id, path_len, path);
+
+            if (app_reported != NULL && path_len != 0) {
+                *app_reported = app_id;
+            }
+
+            fort_buffer_ring_publish(buf);
         }
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
@@ -265,9 +811,23 @@ static NTSTATUS fort_buffer_xmove_locked(
     if (out_len < buf_top)
         return STATUS_BUFFER_TOO_SMALL;
 
-    RtlCopyMemory(out, data->p, buf_top);
+    /* Move the whole chunks, which fit into the larger output buffer */
+    PCHAR out_p = out;
+    ULONG out_top = 0;
+
+    do {
+        RtlCopyMemory(out_p + out_top, data->p, data->top);
+        out_top += data->top;
+
+        fort_buffer_data_shift(buf);
 
-    fort_buffer_data_shift(buf);
+        data = buf->data_head;
+    } while (data != NULL && data->top <= out_len - out_top);
+
+    *info = out_top;
+
+    /* Report the drops, when the buffer is drained */
+    fort_buffer_drops_flush(buf, NULL, NULL);
 
     return STATUS_SUCCESS;
 }
@@ -282,6 +842,8 @@ FORT_API NTSTATUS fort_buffer_xmove(
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
+    fort_etw_log_flush(status, *info);
+
     return status;
 }
 
@@ -349,8 +911,46 @@ FORT_API void fort_buffer_dpc_end(PKLOCK_QUEUE_HANDLE lock_queue)
     KeReleaseInStackQueuedSpinLockFromDpcLevel(lock_queue);
 }
 
+FORT_API void fort_buffer_repeats_flush(PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info)
+{
+    if (buf->repeats_pending == 0)
+        return;
+
+    LARGE_INTEGER system_time;
+    KeQuerySystemTime(&system_time);
+
+    for (int i = 0; i < FORT_BUFFER_REPEATS_COUNT; ++i) {
+        PFORT_BUFFER_REPEAT repeat = &buf->repeats[i];
+
+        if (repeat->count != 0 && fort_buffer_repeat_expired(repeat, system_time.QuadPart)) {
+            fort_buffer_repeat_flush(buf, repeat, irp, info);
+        }
+    }
+}
+
+FORT_API void fort_buffer_drops_flush(PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info)
+{
+    if (!buf->drops_pending)
+        return;
+
+    PCHAR out;
+    if (!NT_SUCCESS(fort_buffer_prepare_out(
+                buf, FORT_LOG_TYPE_DROPPED, FORT_LOG_DROPPED_SIZE, &out, irp, info)))
+        return;
+
+    fort_log_dropped_write(out, buf->drops);
+
+    buf->drops_pending = FALSE;
+    RtlZeroMemory(buf->drops, sizeof(buf->drops));
+}
+
 FORT_API void fort_buffer_flush_pending(PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info)
 {
+    if (buf->ring != NULL) {
+        fort_buffer_ring_publish(buf);
+        return;
+    }
+
     UINT32 out_top = buf->out_top;
 
     /* Move data from buffer to pending */
@@ -372,6 +972,8 @@ FORT_API void fort_buffer_flush_pending(PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *
         buf->out_top = 0;
         buf->out_len = 0;
 
+        fort_etw_log_flush(STATUS_SUCCESS, out_top);
+
         *irp = buf->irp;
         buf->irp = NULL;
     }
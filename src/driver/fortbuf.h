@@ -3,6 +3,7 @@
 
 #include "fortdrv.h"
 
+#include "common/fortdef.h"
 #include "common/fortlog.h"
 
 typedef struct fort_buffer_data
@@ -13,17 +14,98 @@ typedef struct fort_buffer_data
     CHAR p[FORT_BUFFER_SIZE];
 } FORT_BUFFER_DATA, *PFORT_BUFFER_DATA;
 
+#define FORT_BUFFER_LIMIT_DEFAULT 16 /* MiB of the buffered logs */
+#define FORT_BUFFER_LIMIT_MAX     256
+
+#define FORT_BUFFER_REPEATS_COUNT 256 /* must be power of 2 */
+#define FORT_BUFFER_REPEAT_WINDOW (1 * 10000000LL) /* 1 second in 100-ns units */
+
+typedef struct fort_buffer_repeat_key
+{
+    UINT32 pid;
+    UINT32 remote_ip[4];
+    UINT16 remote_port;
+    UCHAR ip_proto;
+    UCHAR block_reason;
+    UCHAR inbound;
+    UCHAR isIPv6;
+} FORT_BUFFER_REPEAT_KEY, *PFORT_BUFFER_REPEAT_KEY;
+
+/* The blocked connections of the same key are coalesced per window */
+typedef struct fort_buffer_repeat
+{
+    FORT_BUFFER_REPEAT_KEY key;
+
+    UINT32 count; /* repeats after the window's first record */
+
+    INT64 window_time; /* system time of the window's first record */
+    INT64 first_time; /* unix time of the first repeat */
+    INT64 last_time; /* unix time of the last repeat */
+} FORT_BUFFER_REPEAT, *PFORT_BUFFER_REPEAT;
+
+#define FORT_BUFFER_SAMPLES_COUNT 256 /* must be power of 2 */
+#define FORT_BUFFER_SAMPLE_WINDOW (10 * 10000000LL) /* 10 seconds in 100-ns units */
+
+/* The allowed connections of the same key are sampled per window */
+typedef struct fort_buffer_sample
+{
+    FORT_BUFFER_REPEAT_KEY key;
+
+    UINT32 count; /* logged first in the window */
+
+    INT64 window_time; /* system time of the window's first record */
+} FORT_BUFFER_SAMPLE, *PFORT_BUFFER_SAMPLE;
+
+#define FORT_BUFFER_PATHS_COUNT 1024 /* must be power of 2 */
+
+#define FORT_BUFFER_APPS_COUNT 256 /* must be power of 2 */
+
+/* The logged paths are interned: the path id is the entry's index + 1 */
+typedef struct fort_buffer_path
+{
+    UINT32 hash;
+    UINT16 len; /* 0 for undefined */
+
+    PCHAR path; /* copy */
+} FORT_BUFFER_PATH, *PFORT_BUFFER_PATH;
+
 typedef struct fort_buffer
 {
     PFORT_BUFFER_DATA data_head;
     PFORT_BUFFER_DATA data_tail; /* last is current */
     PFORT_BUFFER_DATA data_free;
 
+    UINT32 data_count; /* queued */
+    UINT32 data_limit; /* queued chunks, exceeded only by the stat records */
+
     PIRP irp; /* pending */
     PCHAR out;
     ULONG out_len;
     UINT32 out_top;
 
+    PFORT_LOG_RING ring; /* shared with the service, replaces the pending IRP */
+    PMDL ring_mdl;
+    PKEVENT ring_event;
+    UINT32 ring_size; /* the shared fields are not trusted */
+    UINT32 ring_top; /* reserved */
+    UINT32 ring_head; /* published */
+
+    UINT16 repeats_pending;
+    FORT_BUFFER_REPEAT repeats[FORT_BUFFER_REPEATS_COUNT];
+
+    UCHAR sample_first; /* FORT_CONF's log_allowed_ip_first */
+    UCHAR sample_rate; /* FORT_CONF's log_allowed_ip_rate */
+    ULONG sample_seed;
+    FORT_BUFFER_SAMPLE samples[FORT_BUFFER_SAMPLES_COUNT];
+
+    FORT_BUFFER_PATH paths[FORT_BUFFER_PATHS_COUNT];
+
+    /* The conf's apps, reported with their paths: the service resolves them by ids */
+    UINT32 apps_reported[FORT_BUFFER_APPS_COUNT];
+
+    BOOL drops_pending;
+    UINT32 drops[FORT_LOG_DROPPED_TYPES]; /* records, dropped per log type */
+
     KSPIN_LOCK lock;
 } FORT_BUFFER, *PFORT_BUFFER;
 
@@ -37,8 +119,18 @@ FORT_API void fort_buffer_close(PFORT_BUFFER buf);
 
 FORT_API void fort_buffer_clear(PFORT_BUFFER buf);
 
+FORT_API void fort_buffer_conf_update(PFORT_BUFFER buf, const PFORT_CONF conf);
+
+FORT_API void fort_buffer_apps_unreport(PFORT_BUFFER buf);
+
+FORT_API UINT64 fort_buffer_data_bytes(PFORT_BUFFER buf);
+
+FORT_API NTSTATUS fort_buffer_ring_open(PFORT_BUFFER buf, const PFORT_LOG_RING_CONF ring_conf);
+
+FORT_API void fort_buffer_ring_close(PFORT_BUFFER buf);
+
 FORT_API NTSTATUS fort_buffer_prepare(
-        PFORT_BUFFER buf, UINT32 len, PCHAR *out, PIRP *irp, ULONG_PTR *info);
+        PFORT_BUFFER buf, UCHAR log_type, UINT32 len, PCHAR *out, PIRP *irp, ULONG_PTR *info);
 
 FORT_API NTSTATUS fort_buffer_blocked_write(PFORT_BUFFER buf, BOOL blocked, UINT32 pid,
         UINT32 path_len, const PVOID path, PIRP *irp, ULONG_PTR *info);
@@ -48,9 +140,18 @@ FORT_API NTSTATUS fort_buffer_blocked_ip_write(PFORT_BUFFER buf, BOOL isIPv6, BO
         const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid, UINT32 path_len,
         const PVOID path, PIRP *irp, ULONG_PTR *info);
 
-FORT_API NTSTATUS fort_buffer_proc_new_write(PFORT_BUFFER buf, UINT32 pid, UINT32 path_len,
+FORT_API NTSTATUS fort_buffer_allowed_ip_write(PFORT_BUFFER buf, BOOL isIPv6, BOOL inbound,
+        BOOL inherited, UCHAR ip_proto, UINT16 local_port, UINT16 remote_port,
+        const UINT32 *local_ip, const UINT32 *remote_ip, UINT32 pid, UINT32 path_len,
         const PVOID path, PIRP *irp, ULONG_PTR *info);
 
+FORT_API void fort_buffer_blocked_ip_summary_write(PFORT_BUFFER buf, BOOL isIPv6,
+        UCHAR block_reason, const UINT32 *remote_ip, UINT32 count, INT64 first_time,
+        INT64 last_time, PIRP *irp, ULONG_PTR *info);
+
+FORT_API NTSTATUS fort_buffer_proc_new_write(PFORT_BUFFER buf, UINT32 pid, UINT32 session_id,
+        UINT32 app_id, UINT32 path_len, const PVOID path, PIRP *irp, ULONG_PTR *info);
+
 FORT_API NTSTATUS fort_buffer_xmove(
         PFORT_BUFFER buf, PIRP irp, PVOID out, ULONG out_len, ULONG_PTR *info);
 
@@ -62,6 +163,10 @@ FORT_API void fort_buffer_dpc_begin(PFORT_BUFFER buf, PKLOCK_QUEUE_HANDLE lock_q
 
 FORT_API void fort_buffer_dpc_end(PKLOCK_QUEUE_HANDLE lock_queue);
 
+FORT_API void fort_buffer_repeats_flush(PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info);
+
+FORT_API void fort_buffer_drops_flush(PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info);
+
 FORT_API void fort_buffer_flush_pending(PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info);
 
 #ifdef __cplusplus
@@ -0,0 +1,104 @@
+/* Fort Firewall Verdict Cache */
+
+#include "fortcache.h"
+
+#include "fortmem.h"
+#include "forttds.h"
+
+FORT_API void fort_cache_open(PFORT_CACHE cache)
+{
+    const ULONG cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    const SIZE_T size = cpu_count * sizeof(FORT_CACHE_CPU);
+
+    /* The cache stays disabled on allocation failure */
+    PFORT_CACHE_CPU cpus = fort_mem_type_alloc(FORT_MEM_CACHE, size);
+    if (cpus == NULL)
+        return;
+
+    RtlZeroMemory(cpus, size);
+
+    cache->cpus = cpus;
+    cache->cpu_count = cpu_count;
+}
+
+FORT_API void fort_cache_close(PFORT_CACHE cache)
+{
+    if (cache->cpus == NULL)
+        return;
+
+    fort_mem_type_free(FORT_MEM_CACHE, cache->cpus);
+
+    cache->cpus = NULL;
+    cache->cpu_count = 0;
+}
+
+static PFORT_CACHE_CPU fort_cache_cpu(PFORT_CACHE cache)
+{
+    const ULONG cpu_index = KeGetCurrentProcessorIndex();
+
+    return (cpu_index < cache->cpu_count) ? &cache->cpus[cpu_index] : NULL;
+}
+
+static PFORT_CACHE_ENTRY fort_cache_entry(PFORT_CACHE_CPU cpu, const PFORT_CACHE_KEY key)
+{
+    const tommy_key_t key_hash = (tommy_key_t) tommy_hash_u32(0, key, sizeof(FORT_CACHE_KEY));
+
+    return &cpu->entries[key_hash & (FORT_CACHE_ENTRIES_COUNT - 1)];
+}
+
+FORT_API BOOL fort_cache_lookup(PFORT_CACHE cache, const PFORT_CACHE_KEY key, LONG generation,
+        PFORT_CACHE_VERDICT verdict)
+{
+    BOOL found = FALSE;
+
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
+
+    PFORT_CACHE_CPU cpu = fort_cache_cpu(cache);
+    if (cpu != NULL) {
+        const PFORT_CACHE_ENTRY entry = fort_cache_entry(cpu, key);
+
+        found = (entry->generation == generation
+                && RtlEqualMemory(&entry->key, key, sizeof(FORT_CACHE_KEY)));
+
+        if (found) {
+            *verdict = entry->verdict;
+            ++cpu->hits;
+        } else {
+            ++cpu->misses;
+        }
+    }
+
+    KeLowerIrql(oldIrql);
+
+    return found;
+}
+
+FORT_API void fort_cache_insert(PFORT_CACHE cache, const PFORT_CACHE_KEY key, LONG generation,
+        const PFORT_CACHE_VERDICT verdict)
+{
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
+
+    PFORT_CACHE_CPU cpu = fort_cache_cpu(cache);
+    if (cpu != NULL) {
+        PFORT_CACHE_ENTRY entry = fort_cache_entry(cpu, key);
+
+        entry->generation = generation;
+        entry->key = *key;
+        entry->verdict = *verdict;
+    }
+
+    KeLowerIrql(oldIrql);
+}
+
+FORT_API void fort_cache_stats(PFORT_CACHE cache, UINT64 *hits, UINT64 *misses)
+{
+    *hits = 0;
+    *misses = 0;
+
+    for (ULONG i = 0; i < cache->cpu_count; ++i) {
+        const PFORT_CACHE_CPU cpu = &cache->cpus[i];
+
+        *hits += cpu->hits;
+        *misses += cpu->misses;
+    }
+}
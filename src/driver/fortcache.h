@@ -0,0 +1,77 @@
+#ifndef FORTCACHE_H
+#define FORTCACHE_H
+
+#include "fortdrv.h"
+
+#include "common/fortconf.h"
+
+#define FORT_CACHE_ENTRIES_COUNT 256 /* must be power of 2 */
+
+typedef struct fort_cache_key
+{
+    UINT32 process_id;
+    UINT32 path_hash;
+    UINT32 local_ip[4]; /* matched by rules, else zero */
+    UINT32 remote_ip[4];
+    UINT16 local_port;
+    UINT16 remote_port;
+    UINT16 path_len;
+    UCHAR ip_proto;
+    UCHAR inbound : 1;
+    UCHAR isIPv6 : 1;
+} FORT_CACHE_KEY, *PFORT_CACHE_KEY;
+
+typedef struct fort_cache_verdict
+{
+    UCHAR decided : 1; /* decided by the conf flags and addresses only */
+    UCHAR blocked : 1;
+    INT8 block_reason;
+
+    FORT_APP_ENTRY app_data;
+} FORT_CACHE_VERDICT, *PFORT_CACHE_VERDICT;
+
+typedef struct fort_cache_entry
+{
+    LONG generation;
+
+    FORT_CACHE_KEY key;
+    FORT_CACHE_VERDICT verdict;
+} FORT_CACHE_ENTRY, *PFORT_CACHE_ENTRY;
+
+/* Accessed by the owner processor at DISPATCH_LEVEL only */
+typedef struct fort_cache_cpu
+{
+    UINT64 hits;
+    UINT64 misses;
+
+    FORT_CACHE_ENTRY entries[FORT_CACHE_ENTRIES_COUNT];
+} FORT_CACHE_CPU, *PFORT_CACHE_CPU;
+
+typedef struct fort_cache
+{
+    ULONG cpu_count;
+
+    PFORT_CACHE_CPU cpus;
+} FORT_CACHE, *PFORT_CACHE;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API void fort_cache_open(PFORT_CACHE cache);
+
+FORT_API void fort_cache_close(PFORT_CACHE cache);
+
+FORT_API BOOL fort_cache_lookup(PFORT_CACHE cache, const PFORT_CACHE_KEY key, LONG generation,
+        PFORT_CACHE_VERDICT verdict);
+
+FORT_API void fort_cache_insert(PFORT_CACHE cache, const PFORT_CACHE_KEY key, LONG generation,
+        const PFORT_CACHE_VERDICT verdict);
+
+FORT_API void fort_cache_stats(PFORT_CACHE cache, UINT64 *hits, UINT64 *misses);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTCACHE_H
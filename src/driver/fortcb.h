@@ -27,6 +27,7 @@ FORT_API void fort_callback_setup(PFORT_PROXYCB_INFO cb_info);
 } // extern "C"
 #endif
 
+/* Returns the func itself, when the driver is not loaded by the loader: resolve it once */
 #define FORT_CALLBACK(id, T, func) (T) fort_callback((id), (FortCallbackFunc) (func))
 
 #endif // FORTCB_H
@@ -2,20 +2,43 @@
 
 #include "fortcnf.h"
 
-#define FORT_ZONES_POOL_TAG 'ZwfF'
+#include "fortmem.h"
 
-/* Synchronize with tommy_hashdyn_node! */
+/* Synchronize with tommy_node! */
 typedef struct fort_conf_exe_node
 {
     struct fort_conf_exe_node *next;
     struct fort_conf_exe_node *prev;
 
-    PFORT_APP_ENTRY app_entry; /* tommy_hashdyn_node::data */
+    PFORT_APP_ENTRY app_entry; /* tommy_node::data */
 
-    tommy_key_t path_hash; /* tommy_hashdyn_node::index */
+    tommy_key_t path_hash; /* tommy_node::index */
+
+    struct fort_conf_exe_dir *dir; /* the app entry keeps the rest of the path */
+
+    UINT16 file_id_i; /* index + 1 of the file id's node, 0 for none */
 } FORT_CONF_EXE_NODE, *PFORT_CONF_EXE_NODE;
 
-static FORT_TIME fort_current_time(void)
+typedef struct fort_conf_exe_dir
+{
+    tommy_hashdyn_node node;
+
+    LONG refcount;
+
+    UINT16 path_len; /* including the trailing backslash */
+
+    WCHAR path[1];
+} FORT_CONF_EXE_DIR, *PFORT_CONF_EXE_DIR;
+
+#define FORT_CONF_EXE_DIR_SIZE(path_len) (offsetof(FORT_CONF_EXE_DIR, path) + (path_len))
+
+typedef struct fort_conf_exe_dir_key
+{
+    const PVOID path;
+    UINT16 path_len;
+} FORT_CONF_EXE_DIR_KEY, *PFORT_CONF_EXE_DIR_KEY;
+
+static FORT_TIME fort_current_time(ULONG *minute_msec)
 {
     TIME_FIELDS tf;
     LARGE_INTEGER system_time, local_time;
@@ -24,6 +47,8 @@ static FORT_TIME fort_current_time(void)
     ExSystemTimeToLocalTime(&system_time, &local_time);
     RtlTimeToTimeFields(&local_time, &tf);
 
+    *minute_msec = tf.Second * 1000 + tf.Milliseconds;
+
     FORT_TIME time;
     time.hour = (UCHAR) tf.Hour;
     time.minute = (UCHAR) tf.Minute;
@@ -34,6 +59,8 @@ static FORT_TIME fort_current_time(void)
 FORT_API void fort_device_conf_open(PFORT_DEVICE_CONF device_conf)
 {
     KeInitializeSpinLock(&device_conf->ref_lock);
+
+    device_conf->generation = 1;
 }
 
 FORT_API UCHAR fort_device_flag_set(PFORT_DEVICE_CONF device_conf, UCHAR flag, BOOL on)
@@ -52,14 +79,113 @@ FORT_API UCHAR fort_device_flag(PFORT_DEVICE_CONF device_conf, UCHAR flag)
     return fort_device_flags(device_conf) & flag;
 }
 
+FORT_API void fort_device_conf_generation_bump(PFORT_DEVICE_CONF device_conf)
+{
+    InterlockedIncrement(&device_conf->generation);
+}
+
+static void fort_conf_ref_sync_cpus(void)
+{
+    /* A thread runs on a processor only when it is below DISPATCH_LEVEL */
+    const ULONG cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+
+    for (ULONG i = 0; i < cpu_count; ++i) {
+        PROCESSOR_NUMBER proc_num;
+        if (!NT_SUCCESS(KeGetProcessorNumberFromIndex(i, &proc_num)))
+            continue;
+
+        const KAFFINITY mask = (KAFFINITY) 1 << proc_num.Number;
+        if ((KeQueryGroupAffinity(proc_num.Group) & mask) == 0)
+            continue; /* inactive processor */
+
+        GROUP_AFFINITY affinity;
+        RtlZeroMemory(&affinity, sizeof(GROUP_AFFINITY));
+        affinity.Group = proc_num.Group;
+        affinity.Mask = mask;
+
+        GROUP_AFFINITY old_affinity;
+        KeSetSystemGroupAffinityThread(&affinity, &old_affinity);
+        KeRevertToUserGroupAffinityThread(&old_affinity);
+    }
+}
+
+static PFORT_CONF_EXE_BUCKETS fort_conf_ref_exe_buckets_new(UINT32 count)
+{
+    UINT32 bits = FORT_CONF_EXE_BUCKETS_BITS_MIN;
+    while (((UINT32) 1 << bits) < count * 2) {
+        ++bits;
+    }
+
+    const UINT32 buckets_n = (UINT32) 1 << bits;
+    const SIZE_T size = FORT_CONF_EXE_BUCKETS_SIZE(buckets_n);
+
+    PFORT_CONF_EXE_BUCKETS buckets = fort_mem_type_alloc(FORT_MEM_CONF, size);
+    if (buckets != NULL) {
+        RtlZeroMemory(buckets, size);
+
+        buckets->mask = buckets_n - 1;
+    }
+
+    return buckets;
+}
+
+static void fort_conf_ref_exe_buckets_del(PFORT_CONF_EXE_BUCKETS buckets)
+{
+    while (buckets != NULL) {
+        PFORT_CONF_EXE_BUCKETS prev = buckets->prev;
+        fort_mem_type_free(FORT_MEM_CONF, buckets);
+        buckets = prev;
+    }
+}
+
+static void fort_conf_ref_exe_write_begin(PFORT_CONF_REF conf_ref)
+{
+    InterlockedIncrement(&conf_ref->exe_seq);
+}
+
+static void fort_conf_ref_exe_write_end(PFORT_CONF_REF conf_ref)
+{
+    InterlockedIncrement(&conf_ref->exe_seq);
+}
+
+static UINT16 fort_conf_exe_dir_len(const PVOID path, UINT32 path_len)
+{
+    const WCHAR *p = (const WCHAR *) path;
+    UINT32 n = path_len / sizeof(WCHAR);
+
+    while (n != 0 && p[n - 1] != L'\\') {
+        --n;
+    }
+
+    return (UINT16) (n * sizeof(WCHAR));
+}
+
+static BOOL fort_conf_exe_node_equal(
+        const PFORT_CONF_EXE_NODE node, const PVOID path, UINT32 path_len)
+{
+    const PFORT_APP_ENTRY entry = node->app_entry;
+    const PFORT_CONF_EXE_DIR dir = node->dir;
+
+    if (entry->path_len != path_len)
+        return FALSE;
+
+    const UINT16 dir_len = (dir != NULL) ? dir->path_len : 0;
+
+    if (dir_len != 0 && fort_memcmp(path, dir->path, dir_len) != 0)
+        return FALSE;
+
+    return fort_memcmp((const char *) path + dir_len, entry + 1, path_len - dir_len) == 0;
+}
+
 static PFORT_CONF_EXE_NODE fort_conf_ref_exe_find_node(
         PFORT_CONF_REF conf_ref, const PVOID path, UINT32 path_len, tommy_key_t path_hash)
 {
-    PFORT_CONF_EXE_NODE node =
-            (PFORT_CONF_EXE_NODE) tommy_hashdyn_bucket(&conf_ref->exe_map, path_hash);
+    const PFORT_CONF_EXE_BUCKETS buckets = conf_ref->exe_buckets;
+
+    PFORT_CONF_EXE_NODE node = buckets->heads[path_hash & buckets->mask];
 
     while (node != NULL) {
-        if (fort_conf_app_exe_equal(node->app_entry, path, path_len))
+        if (node->path_hash == path_hash && fort_conf_exe_node_equal(node, path, path_len))
             return node;
 
         node = node->next;
@@ -68,239 +194,1089 @@ static PFORT_CONF_EXE_NODE fort_conf_ref_exe_find_node(
     return NULL;
 }
 
+static FORT_APP_ENTRY fort_conf_ref_exe_find(
+        PFORT_CONF_REF conf_ref, const PVOID path, UINT32 path_len, tommy_key_t path_hash)
+{
+    FORT_APP_ENTRY app_data;
+
+    /* Deleted nodes are freed after fort_conf_ref_sync_cpus() */
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
+
+    for (;;) {
+        const LONG seq = InterlockedCompareExchange(&conf_ref->exe_seq, 0, 0);
+
+        if ((seq & 1) != 0) {
+            YieldProcessor();
+            continue;
+        }
+
+        const PFORT_CONF_EXE_NODE node =
+                fort_conf_ref_exe_find_node(conf_ref, path, path_len, path_hash);
+
+        if (node != NULL) {
+            app_data = *node->app_entry;
+        } else {
+            app_data.flags.v = 0;
+        }
+
+        if (InterlockedCompareExchange(&conf_ref->exe_seq, 0, 0) == seq)
+            break;
+    }
+
+    KeLowerIrql(oldIrql);
+
+    return app_data;
+}
+
 FORT_API FORT_APP_ENTRY fort_conf_exe_find(
         const PFORT_CONF conf, PVOID context, const PVOID path, UINT32 path_len)
 {
+    UNUSED(conf);
+
     PFORT_CONF_REF conf_ref = context;
-    const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path, path_len);
+    const tommy_key_t path_hash = fort_conf_app_path_hash(path, path_len);
+
+    return fort_conf_ref_exe_find(conf_ref, path, path_len, path_hash);
+}
+
+FORT_API FORT_APP_ENTRY fort_conf_exe_find_hashed(
+        const PFORT_CONF conf, PVOID context, const PVOID path, UINT32 path_len)
+{
+    UNUSED(conf);
+
+    const PFORT_CONF_EXE_FIND_ARG arg = context;
+
+    return fort_conf_ref_exe_find(arg->conf_ref, path, path_len, arg->path_hash);
+}
+
+static PFORT_CONF_EXE_NODE fort_conf_ref_file_id_node(
+        PFORT_CONF_REF conf_ref, const PFORT_FILE_ID file_id)
+{
+    const PFORT_CONF_FILE_ID_NODE file_ids = conf_ref->file_ids;
+
+    int low = 0;
+    int high = conf_ref->file_ids_n - 1;
+
+    while (low <= high) {
+        const int mid = (low + high) / 2;
+        const int res = fort_conf_file_id_cmp(file_id, &file_ids[mid].file_id);
+
+        if (res < 0)
+            high = mid - 1;
+        else if (res > 0)
+            low = mid + 1;
+        else
+            return file_ids[mid].node;
+    }
 
+    return NULL;
+}
+
+FORT_API FORT_APP_ENTRY fort_conf_ref_file_id_find(
+        PFORT_CONF_REF conf_ref, const PFORT_FILE_ID file_id)
+{
     FORT_APP_ENTRY app_data;
     app_data.flags.v = 0;
 
-    KIRQL oldIrql = ExAcquireSpinLockShared(&conf_ref->conf_lock);
-    {
-        const PFORT_CONF_EXE_NODE node =
-                fort_conf_ref_exe_find_node(conf_ref, path, path_len, path_hash);
+    if (conf_ref->file_ids_n == 0)
+        return app_data;
+
+    /* Deleted nodes are freed after fort_conf_ref_sync_cpus() */
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
+
+    for (;;) {
+        const LONG seq = InterlockedCompareExchange(&conf_ref->exe_seq, 0, 0);
+
+        if ((seq & 1) != 0) {
+            YieldProcessor();
+            continue;
+        }
+
+        const PFORT_CONF_EXE_NODE node = fort_conf_ref_file_id_node(conf_ref, file_id);
 
         if (node != NULL) {
             app_data = *node->app_entry;
+        } else {
+            app_data.flags.v = 0;
         }
+
+        if (InterlockedCompareExchange(&conf_ref->exe_seq, 0, 0) == seq)
+            break;
     }
-    ExReleaseSpinLockShared(&conf_ref->conf_lock, oldIrql);
+
+    KeLowerIrql(oldIrql);
 
     return app_data;
 }
 
-static void fort_conf_ref_exe_new_path(
-        PFORT_CONF_REF conf_ref, PFORT_APP_ENTRY entry, tommy_key_t path_hash)
+#define fort_conf_app_group_bit(app_entry) ((UINT16) (1 << (app_entry).flags.group_index))
+
+static FORT_APP_ENTRY fort_conf_exe_find_none(
+        const PFORT_CONF conf, PVOID context, const PVOID path, UINT32 path_len)
+{
+    UNUSED(conf);
+    UNUSED(context);
+    UNUSED(path);
+    UNUSED(path_len);
+
+    FORT_APP_ENTRY app_data;
+    app_data.flags.v = 0;
+
+    return app_data;
+}
+
+/* Group of the app matched by the path, to be called by the writer */
+static UINT16 fort_conf_ref_exe_group_bit(
+        PFORT_CONF_REF conf_ref, const PVOID path, UINT32 path_len, tommy_key_t path_hash)
+{
+    const PFORT_CONF_EXE_NODE node =
+            fort_conf_ref_exe_find_node(conf_ref, path, path_len, path_hash);
+
+    const FORT_APP_ENTRY app_data = (node != NULL)
+            ? *node->app_entry
+            : fort_conf_app_find(
+                    &conf_ref->conf, path, path_len, &fort_conf_exe_find_none, /*context=*/NULL);
+
+    return fort_conf_app_group_bit(app_data);
+}
+
+static BOOL fort_conf_ref_exe_buckets_grow(PFORT_CONF_REF conf_ref)
+{
+    const PFORT_CONF_EXE_BUCKETS buckets = conf_ref->exe_buckets;
+    const UINT32 buckets_n = buckets->mask + 1;
+
+    /* Grow if more than 50% full */
+    if (conf_ref->conf.exe_apps_n < buckets_n / 2)
+        return TRUE;
+
+    PFORT_CONF_EXE_BUCKETS new_buckets = fort_conf_ref_exe_buckets_new(buckets_n);
+    if (new_buckets == NULL)
+        return FALSE;
+
+    for (UINT32 i = 0; i < buckets_n; ++i) {
+        PFORT_CONF_EXE_NODE node = buckets->heads[i];
+
+        while (node != NULL) {
+            PFORT_CONF_EXE_NODE next = node->next;
+            const UINT32 pos = node->path_hash & new_buckets->mask;
+
+            node->next = new_buckets->heads[pos];
+            new_buckets->heads[pos] = node;
+
+            node = next;
+        }
+    }
+
+    /* Readers may still walk the old buckets */
+    new_buckets->prev = buckets;
+
+    InterlockedExchangePointer((PVOID volatile *) &conf_ref->exe_buckets, new_buckets);
+
+    return TRUE;
+}
+
+static int fort_conf_exe_dir_cmp(const void *arg, const void *obj)
+{
+    const PFORT_CONF_EXE_DIR_KEY key = (const PFORT_CONF_EXE_DIR_KEY) arg;
+    const PFORT_CONF_EXE_DIR dir = (const PFORT_CONF_EXE_DIR) obj;
+
+    if (key->path_len != dir->path_len)
+        return 1;
+
+    return fort_memcmp(key->path, dir->path, key->path_len);
+}
+
+static PFORT_CONF_EXE_DIR fort_conf_ref_exe_dir_take(
+        PFORT_CONF_REF conf_ref, const PVOID path, UINT16 path_len)
+{
+    if (path_len == 0)
+        return NULL;
+
+    const FORT_CONF_EXE_DIR_KEY key = { path, path_len };
+    const tommy_key_t dir_hash = fort_conf_app_path_hash(path, path_len);
+
+    PFORT_CONF_EXE_DIR dir =
+            tommy_hashdyn_search(&conf_ref->exe_dirs, fort_conf_exe_dir_cmp, &key, dir_hash);
+
+    if (dir == NULL) {
+        dir = fort_pool_malloc(&conf_ref->pool_list, FORT_CONF_EXE_DIR_SIZE(path_len));
+        if (dir == NULL)
+            return NULL;
+
+        dir->refcount = 0;
+        dir->path_len = path_len;
+        RtlCopyMemory(dir->path, path, path_len);
+
+        tommy_hashdyn_insert(&conf_ref->exe_dirs, &dir->node, dir, dir_hash);
+    }
+
+    ++dir->refcount;
+
+    return dir;
+}
+
+static void fort_conf_ref_exe_dir_put(PFORT_CONF_REF conf_ref, PFORT_CONF_EXE_DIR dir)
+{
+    if (dir == NULL || --dir->refcount != 0)
+        return;
+
+    tommy_hashdyn_remove_existing(&conf_ref->exe_dirs, &dir->node);
+
+    fort_pool_free(&conf_ref->pool_list, dir);
+}
+
+static void fort_conf_ref_exe_new_path(PFORT_CONF_REF conf_ref, PFORT_APP_ENTRY entry,
+        PFORT_CONF_EXE_DIR dir, tommy_key_t path_hash)
 {
     PFORT_CONF conf = &conf_ref->conf;
 
     tommy_arrayof *exe_nodes = &conf_ref->exe_nodes;
-    tommy_hashdyn *exe_map = &conf_ref->exe_map;
 
-    tommy_hashdyn_node *exe_node = tommy_list_tail(&conf_ref->free_nodes);
+    PFORT_CONF_EXE_NODE node = (PFORT_CONF_EXE_NODE) tommy_list_tail(&conf_ref->free_nodes);
 
-    if (exe_node != NULL) {
-        tommy_list_remove_existing(&conf_ref->free_nodes, exe_node);
+    if (node != NULL) {
+        tommy_list_remove_existing(&conf_ref->free_nodes, (tommy_node *) node);
     } else {
         const UINT16 index = conf->exe_apps_n;
 
-        tommy_arrayof_grow(exe_nodes, index + 1);
+        tommy_arrayof_grow(exe_nodes, index + 1);
+
+        node = tommy_arrayof_ref(exe_nodes, index);
+    }
+
+    node->app_entry = entry;
+    node->path_hash = path_hash;
+    node->dir = dir;
+    node->file_id_i = 0;
+
+    /* Link the fully initialized node */
+    {
+        const PFORT_CONF_EXE_BUCKETS buckets = conf_ref->exe_buckets;
+        PFORT_CONF_EXE_NODE volatile *head = &buckets->heads[path_hash & buckets->mask];
+
+        node->next = *head;
+        node->prev = NULL;
+
+        InterlockedExchangePointer((PVOID volatile *) head, node);
+    }
+
+    ++conf->exe_apps_n;
+}
+
+static NTSTATUS fort_conf_ref_exe_new_dir_entry(PFORT_CONF_REF conf_ref,
+        const PFORT_APP_ENTRY app_entry, const PVOID dir_path, UINT16 dir_len,
+        const PVOID suffix, tommy_key_t path_hash)
+{
+    const UINT32 suffix_len = app_entry->path_len - dir_len;
+
+    if (!fort_conf_ref_exe_buckets_grow(conf_ref))
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    PFORT_CONF_EXE_DIR dir = fort_conf_ref_exe_dir_take(conf_ref, dir_path, dir_len);
+    if (dir == NULL && dir_len != 0)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    const UINT16 entry_size = (UINT16) FORT_CONF_APP_ENTRY_SIZE(suffix_len);
+    PFORT_APP_ENTRY entry = fort_pool_malloc(&conf_ref->pool_list, entry_size);
+
+    if (entry == NULL) {
+        fort_conf_ref_exe_dir_put(conf_ref, dir);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    /* Keeps the full path length */
+    *entry = *app_entry;
+
+    /* Copy the path after the dir */
+    {
+        PVOID new_path = entry + 1;
+        RtlCopyMemory(new_path, suffix, suffix_len);
+    }
+
+    /* Add exe node */
+    fort_conf_ref_exe_new_path(conf_ref, entry, dir, path_hash);
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fort_conf_ref_exe_new_entry(PFORT_CONF_REF conf_ref,
+        const PFORT_APP_ENTRY app_entry, const PVOID path, tommy_key_t path_hash)
+{
+    const UINT16 dir_len = fort_conf_exe_dir_len(path, app_entry->path_len);
+
+    return fort_conf_ref_exe_new_dir_entry(
+            conf_ref, app_entry, path, dir_len, (const char *) path + dir_len, path_hash);
+}
+
+static NTSTATUS fort_conf_ref_exe_add_path_locked(PFORT_CONF_REF conf_ref,
+        const PFORT_APP_ENTRY app_entry, const PVOID path, tommy_key_t path_hash)
+{
+    const PFORT_CONF_EXE_NODE node =
+            fort_conf_ref_exe_find_node(conf_ref, path, app_entry->path_len, path_hash);
+
+    if (node == NULL) {
+        return fort_conf_ref_exe_new_entry(conf_ref, app_entry, path, path_hash);
+    }
+
+    if (app_entry->flags.is_new)
+        return FORT_STATUS_USER_ERROR;
+
+    /* Replace the data */
+    {
+        PFORT_APP_ENTRY entry = node->app_entry;
+        *entry = *app_entry;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+FORT_API NTSTATUS fort_conf_ref_exe_add_path(
+        PFORT_CONF_REF conf_ref, const PFORT_APP_ENTRY app_entry, const PVOID path)
+{
+    const tommy_key_t path_hash = fort_conf_app_path_hash(path, app_entry->path_len);
+    NTSTATUS status;
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
+    fort_conf_ref_exe_write_begin(conf_ref);
+
+    status = fort_conf_ref_exe_add_path_locked(conf_ref, app_entry, path, path_hash);
+
+    fort_conf_ref_exe_write_end(conf_ref);
+    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
+
+    return status;
+}
+
+FORT_API NTSTATUS fort_conf_ref_exe_add_entry(
+        PFORT_CONF_REF conf_ref, const PFORT_APP_ENTRY app_entry, BOOL locked)
+{
+    const PVOID path = app_entry + 1;
+
+    if (locked) {
+        const tommy_key_t path_hash = fort_conf_app_path_hash(path, app_entry->path_len);
+
+        return fort_conf_ref_exe_add_path_locked(conf_ref, app_entry, path, path_hash);
+    } else {
+        return fort_conf_ref_exe_add_path(conf_ref, app_entry, path);
+    }
+}
+
+/* The exe entries are followed by their path hashes */
+static BOOL fort_conf_exe_entry_next(
+        const char *exe_data, UINT32 *off, UINT32 end, PFORT_APP_ENTRY *entry)
+{
+    if (*off > end || end - *off < sizeof(FORT_APP_ENTRY))
+        return FALSE;
+
+    *entry = (PFORT_APP_ENTRY) (exe_data + *off);
+
+    const UINT32 entry_size = FORT_CONF_APP_ENTRY_SIZE((*entry)->path_len);
+    if (end - *off < entry_size)
+        return FALSE;
+
+    *off += entry_size;
+
+    return TRUE;
+}
+
+static NTSTATUS fort_conf_ref_exe_fill(
+        PFORT_CONF_REF conf_ref, const char *exe_data, UINT32 entries_size, UINT16 count)
+{
+    const UINT32 *path_hashes = (const UINT32 *) (exe_data + entries_size);
+
+    UINT32 off = 0;
+
+    /* The paths are unique and hashed by the service */
+    for (UINT16 i = 0; i < count; ++i) {
+        PFORT_APP_ENTRY entry;
+        if (!fort_conf_exe_entry_next(exe_data, &off, entries_size, &entry))
+            return STATUS_INVALID_PARAMETER;
+
+        const NTSTATUS status =
+                fort_conf_ref_exe_new_entry(conf_ref, entry, entry + 1, path_hashes[i]);
+        if (!NT_SUCCESS(status))
+            return status;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+static PFORT_CONF_EXE_NODE fort_conf_ref_exe_unlink_path(
+        PFORT_CONF_REF conf_ref, const PVOID path, UINT32 path_len, tommy_key_t path_hash)
+{
+    const PFORT_CONF_EXE_BUCKETS buckets = conf_ref->exe_buckets;
+
+    PFORT_CONF_EXE_NODE volatile *link = &buckets->heads[path_hash & buckets->mask];
+    PFORT_CONF_EXE_NODE node;
+
+    while ((node = *link) != NULL) {
+        if (node->path_hash == path_hash && fort_conf_exe_node_equal(node, path, path_len)) {
+            /* The node keeps its next link for readers walking through it */
+            InterlockedExchangePointer((PVOID volatile *) link, node->next);
+
+            if (node->file_id_i != 0) {
+                conf_ref->file_ids[node->file_id_i - 1].node = NULL;
+            }
+            break;
+        }
+
+        link = &node->next;
+    }
+
+    return node;
+}
+
+static PFORT_CONF_EXE_NODE fort_conf_ref_exe_unlink_entry(
+        PFORT_CONF_REF conf_ref, const PFORT_APP_ENTRY entry, UINT16 *group_bits)
+{
+    const PVOID path = (const PVOID)(entry + 1);
+    const UINT32 path_len = entry->path_len;
+    const tommy_key_t path_hash = fort_conf_app_path_hash(path, path_len);
+
+    PFORT_CONF_EXE_NODE node = fort_conf_ref_exe_unlink_path(conf_ref, path, path_len, path_hash);
+
+    /* The flows of the deleted app and of the app matched instead are affected */
+    if (node != NULL) {
+        *group_bits |= fort_conf_app_group_bit(*node->app_entry)
+                | fort_conf_ref_exe_group_bit(conf_ref, path, path_len, path_hash);
+    }
+
+    return node;
+}
+
+/* The unlinked nodes are chained by their prev links, readers use the next links only */
+static void fort_conf_ref_exe_free_nodes(PFORT_CONF_REF conf_ref, PFORT_CONF_EXE_NODE node)
+{
+    /* Wait for readers, which may still use the nodes */
+    fort_conf_ref_sync_cpus();
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
+
+    while (node != NULL) {
+        PFORT_CONF_EXE_NODE prev = node->prev;
+
+        /* Delete from conf, the node index stays in use until now */
+        {
+            PFORT_CONF conf = &conf_ref->conf;
+            --conf->exe_apps_n;
+        }
+
+        /* Delete from pool */
+        {
+            PFORT_APP_ENTRY entry = node->app_entry;
+            fort_pool_free(&conf_ref->pool_list, entry);
+
+            fort_conf_ref_exe_dir_put(conf_ref, node->dir);
+        }
+
+        tommy_list_insert_tail_check(&conf_ref->free_nodes, (tommy_node *) node);
+
+        node = prev;
+    }
+
+    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
+}
+
+FORT_API void fort_conf_ref_exe_del_entry(PFORT_CONF_REF conf_ref, const PFORT_APP_ENTRY entry)
+{
+    UINT16 group_bits;
+
+    fort_conf_ref_exe_del_entries(
+            conf_ref, entry, FORT_CONF_APP_ENTRY_SIZE(entry->path_len), &group_bits);
+}
+
+inline static ULONG fort_conf_app_entries_next(const PFORT_APP_ENTRY entry, ULONG len)
+{
+    if (len < sizeof(FORT_APP_ENTRY))
+        return 0;
+
+    const ULONG entry_size = FORT_CONF_APP_ENTRY_SIZE(entry->path_len);
+
+    return (entry_size <= len) ? entry_size : 0;
+}
+
+FORT_API BOOL fort_conf_app_entries_valid(const PVOID entries, ULONG len)
+{
+    const char *data = entries;
+
+    if (len == 0)
+        return FALSE;
+
+    while (len != 0) {
+        const ULONG entry_size = fort_conf_app_entries_next((const PFORT_APP_ENTRY) data, len);
+        if (entry_size == 0)
+            return FALSE;
+
+        data += entry_size;
+        len -= entry_size;
+    }
+
+    return TRUE;
+}
+
+FORT_API NTSTATUS fort_conf_ref_exe_add_entries(PFORT_CONF_REF conf_ref, const PVOID entries,
+        ULONG len, UINT32 *added_n, UINT16 *group_bits)
+{
+    NTSTATUS status = STATUS_SUCCESS;
+    const char *data = entries;
+    UINT32 n = 0;
+    UINT16 bits = 0;
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
+    fort_conf_ref_exe_write_begin(conf_ref);
+
+    while (len != 0) {
+        const PFORT_APP_ENTRY entry = (const PFORT_APP_ENTRY) data;
+        const ULONG entry_size = FORT_CONF_APP_ENTRY_SIZE(entry->path_len);
+
+        const PVOID path = entry + 1;
+        const tommy_key_t path_hash = fort_conf_app_path_hash(path, entry->path_len);
+
+        /* The flows of the app matched before and of the added app are affected */
+        const UINT16 old_group_bit =
+                fort_conf_ref_exe_group_bit(conf_ref, path, entry->path_len, path_hash);
+
+        status = fort_conf_ref_exe_add_path_locked(conf_ref, entry, path, path_hash);
+        if (!NT_SUCCESS(status))
+            break;
+
+        bits |= old_group_bit | fort_conf_app_group_bit(*entry);
+        ++n;
+
+        data += entry_size;
+        len -= entry_size;
+    }
+
+    fort_conf_ref_exe_write_end(conf_ref);
+    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
+
+    *added_n = n;
+    *group_bits = bits;
+
+    return status;
+}
+
+FORT_API void fort_conf_ref_exe_del_entries(
+        PFORT_CONF_REF conf_ref, const PVOID entries, ULONG len, UINT16 *group_bits)
+{
+    PFORT_CONF_EXE_NODE unlinked = NULL;
+    const char *data = entries;
+
+    *group_bits = 0;
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
+    fort_conf_ref_exe_write_begin(conf_ref);
+
+    while (len != 0) {
+        const PFORT_APP_ENTRY entry = (const PFORT_APP_ENTRY) data;
+        const ULONG entry_size = FORT_CONF_APP_ENTRY_SIZE(entry->path_len);
+
+        PFORT_CONF_EXE_NODE node = fort_conf_ref_exe_unlink_entry(conf_ref, entry, group_bits);
+        if (node != NULL) {
+            node->prev = unlinked;
+            unlinked = node;
+        }
+
+        data += entry_size;
+        len -= entry_size;
+    }
+
+    fort_conf_ref_exe_write_end(conf_ref);
+    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
+
+    if (unlinked != NULL) {
+        fort_conf_ref_exe_free_nodes(conf_ref, unlinked);
+    }
+}
+
+FORT_API void fort_conf_ref_trim(PFORT_CONF_REF conf_ref)
+{
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
+
+    if (fort_pool_trim_needed(&conf_ref->pool_list)) {
+        fort_pool_trim(&conf_ref->pool_list);
+    }
+
+    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
+}
+
+static BOOL fort_conf_ref_init(PFORT_CONF_REF conf_ref, UINT16 exe_apps_n)
+{
+    const ULONG cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    const SIZE_T cpus_size = cpu_count * sizeof(FORT_CONF_REF_CPU);
+
+    PFORT_CONF_REF_CPU cpus = fort_mem_type_alloc(FORT_MEM_CONF, cpus_size);
+    if (cpus == NULL)
+        return FALSE;
+
+    PFORT_CONF_EXE_BUCKETS exe_buckets = fort_conf_ref_exe_buckets_new(exe_apps_n);
+    if (exe_buckets == NULL) {
+        fort_mem_type_free(FORT_MEM_CONF, cpus);
+        return FALSE;
+    }
+
+    RtlZeroMemory(cpus, cpus_size);
+
+    conf_ref->refcount = 0;
+    conf_ref->retired = FALSE;
+
+    conf_ref->cpu_count = cpu_count;
+    conf_ref->cpus = cpus;
+
+    fort_pool_list_init(&conf_ref->pool_list, FORT_MEM_CONF, FORT_POOL_SIZE_CLASSES);
+    tommy_list_init(&conf_ref->free_nodes);
+
+    tommy_arrayof_init(&conf_ref->exe_nodes, sizeof(FORT_CONF_EXE_NODE));
+    conf_ref->exe_buckets = exe_buckets;
+    tommy_hashdyn_init(&conf_ref->exe_dirs);
+
+    conf_ref->file_ids = NULL;
+    conf_ref->file_ids_n = 0;
+
+    conf_ref->exe_seq = 0;
+    conf_ref->conf_lock = 0;
+
+    return TRUE;
+}
+
+static PFORT_CONF_REF fort_conf_ref_alloc(ULONG conf_len, UINT16 exe_apps_n)
+{
+    const ULONG ref_len = conf_len + offsetof(FORT_CONF_REF, conf);
+    PFORT_CONF_REF conf_ref = fort_mem_type_alloc_large(FORT_MEM_CONF, ref_len, FORT_MEM_NODE_ANY);
+
+    if (conf_ref != NULL && !fort_conf_ref_init(conf_ref, exe_apps_n)) {
+        fort_mem_type_free(FORT_MEM_CONF, conf_ref);
+        conf_ref = NULL;
+    }
+
+    return conf_ref;
+}
+
+/* The service sorts the exe entries by path, so the entries of a dir are adjacent */
+static BOOL fort_conf_exe_pool_size(
+        const char *exe_data, UINT32 entries_size, UINT16 count, UINT32 *size)
+{
+    UINT32 off = 0;
+
+    PVOID prev_dir = NULL;
+    UINT16 prev_dir_len = 0;
+
+    *size = 0;
+
+    for (UINT16 i = 0; i < count; ++i) {
+        PFORT_APP_ENTRY entry;
+        if (!fort_conf_exe_entry_next(exe_data, &off, entries_size, &entry))
+            return FALSE;
+
+        const PVOID path = entry + 1;
+        const UINT16 dir_len = fort_conf_exe_dir_len(path, entry->path_len);
+
+        if (dir_len != 0
+                && (dir_len != prev_dir_len || fort_memcmp(path, prev_dir, dir_len) != 0)) {
+            *size += FORT_CONF_EXE_DIR_SIZE(dir_len);
+
+            prev_dir = path;
+            prev_dir_len = dir_len;
+        }
+
+        *size += FORT_CONF_APP_ENTRY_SIZE(entry->path_len - dir_len);
+    }
+
+    return TRUE;
+}
+
+static PFORT_CONF_FILE_ID_NODE fort_conf_ref_file_ids_new(PFORT_CONF_REF conf_ref, UINT16 count)
+{
+    const SIZE_T size = count * sizeof(FORT_CONF_FILE_ID_NODE);
+
+    PFORT_CONF_FILE_ID_NODE file_ids = fort_mem_type_alloc(FORT_MEM_CONF, size);
+    if (file_ids != NULL) {
+        conf_ref->file_ids = file_ids;
+        conf_ref->file_ids_n = count;
+    }
+
+    return file_ids;
+}
+
+static void fort_conf_ref_file_id_link(
+        PFORT_CONF_REF conf_ref, UINT16 file_id_i, PFORT_CONF_EXE_NODE node)
+{
+    if (node->file_id_i != 0)
+        return;
+
+    conf_ref->file_ids[file_id_i].node = node;
+    node->file_id_i = file_id_i + 1;
+}
+
+/* The exe nodes are indexed by the apps' order, when all of them are added */
+static void fort_conf_ref_file_ids_fill(
+        PFORT_CONF_REF conf_ref, const PFORT_CONF conf, ULONG len, UINT16 exe_apps_n)
+{
+    const UINT16 count = conf_ref->conf.file_id_apps_n;
+
+    if (count == 0 || conf_ref->conf.exe_apps_n != exe_apps_n)
+        return;
+
+    /* Check the copy's offset again */
+    if (len < FORT_CONF_DATA_OFF + conf_ref->conf.file_id_apps_off
+                    + FORT_CONF_FILE_ID_APPS_SIZE(count))
+        return;
+
+    PFORT_CONF_FILE_ID_NODE file_ids = fort_conf_ref_file_ids_new(conf_ref, count);
+    if (file_ids == NULL)
+        return;
+
+    const PFORT_CONF_FILE_ID_APP apps =
+            (const PFORT_CONF_FILE_ID_APP) (conf->data + conf_ref->conf.file_id_apps_off);
+
+    for (UINT16 i = 0; i < count; ++i) {
+        /* Copy, as the service's pages are not stable */
+        const FORT_CONF_FILE_ID_APP app = apps[i];
+
+        file_ids[i].file_id = app.file_id;
+        file_ids[i].node = NULL;
+
+        if (app.app_index < exe_apps_n) {
+            PFORT_CONF_EXE_NODE node = tommy_arrayof_ref(&conf_ref->exe_nodes, app.app_index);
+
+            fort_conf_ref_file_id_link(conf_ref, i, node);
+        }
+    }
+}
+
+static void fort_conf_ref_del(PFORT_CONF_REF conf_ref)
+{
+    fort_pool_done(&conf_ref->pool_list);
+
+    fort_conf_ref_exe_buckets_del(conf_ref->exe_buckets);
+    tommy_arrayof_done(&conf_ref->exe_nodes);
+    tommy_hashdyn_done(&conf_ref->exe_dirs);
+
+    if (conf_ref->file_ids != NULL) {
+        fort_mem_type_free(FORT_MEM_CONF, conf_ref->file_ids);
+    }
+
+    fort_mem_type_free(FORT_MEM_CONF, conf_ref->cpus);
+    fort_mem_type_free(FORT_MEM_CONF, conf_ref);
+}
+
+static BOOL fort_conf_header_check(const PFORT_CONF conf_hdr, ULONG len)
+{
+    if (len < FORT_CONF_DATA_OFF || conf_hdr->exe_hashes_off > len - FORT_CONF_DATA_OFF)
+        return FALSE;
+
+    const ULONG exe_hashes_end = FORT_CONF_DATA_OFF + conf_hdr->exe_hashes_off
+            + FORT_CONF_EXE_HASHES_SIZE(conf_hdr->exe_apps_n);
+
+    if (conf_hdr->exe_hashes_off < conf_hdr->exe_apps_off || len < exe_hashes_end)
+        return FALSE;
+
+    if (conf_hdr->file_id_apps_n == 0)
+        return TRUE;
+
+    if (conf_hdr->file_id_apps_off > len - FORT_CONF_DATA_OFF)
+        return FALSE;
+
+    const ULONG file_id_apps_end = FORT_CONF_DATA_OFF + conf_hdr->file_id_apps_off
+            + FORT_CONF_FILE_ID_APPS_SIZE(conf_hdr->file_id_apps_n);
+
+    return FORT_CONF_DATA_OFF + conf_hdr->file_id_apps_off >= exe_hashes_end
+            && len >= file_id_apps_end;
+}
+
+/* Size the pool and fill the exe map by one copy, as the service's pages are not stable */
+static BOOL fort_conf_ref_exe_load(PFORT_CONF_REF conf_ref, const PFORT_CONF conf, UINT16 count)
+{
+    const UINT32 entries_size = conf_ref->conf.exe_hashes_off - conf_ref->conf.exe_apps_off;
+    const UINT32 exe_size = entries_size + FORT_CONF_EXE_HASHES_SIZE(count);
+
+    /* Counted again by the exe map */
+    conf_ref->conf.exe_apps_n = 0;
+
+    if (count == 0) {
+        fort_pool_init(&conf_ref->pool_list, 0);
+        return TRUE;
+    }
+
+    char *exe_data = fort_mem_type_alloc(FORT_MEM_CONF, exe_size);
+    if (exe_data == NULL)
+        return FALSE;
+
+    RtlCopyMemory(exe_data, conf->data + conf_ref->conf.exe_apps_off, exe_size);
+
+    UINT32 pool_size;
+    BOOL ok = fort_conf_exe_pool_size(exe_data, entries_size, count, &pool_size);
+
+    if (ok) {
+        fort_pool_init(&conf_ref->pool_list, pool_size);
+
+        ok = NT_SUCCESS(fort_conf_ref_exe_fill(conf_ref, exe_data, entries_size, count));
+    }
+
+    fort_mem_type_free(FORT_MEM_CONF, exe_data);
+
+    return ok;
+}
+
+FORT_API PFORT_CONF_REF fort_conf_ref_new(const PFORT_CONF conf, ULONG len)
+{
+    /* Read the header once, as the service's pages are not stable */
+    FORT_CONF conf_hdr;
+    RtlCopyMemory(&conf_hdr, conf, FORT_CONF_DATA_OFF);
+
+    if (!fort_conf_header_check(&conf_hdr, len))
+        return NULL;
+
+    const ULONG conf_len = FORT_CONF_DATA_OFF + conf_hdr.exe_apps_off;
+
+    PFORT_CONF_REF conf_ref = fort_conf_ref_alloc(conf_len, conf_hdr.exe_apps_n);
+
+    if (conf_ref == NULL)
+        return NULL;
+
+    RtlCopyMemory(&conf_ref->conf, conf, conf_len);
+    RtlCopyMemory(&conf_ref->conf, &conf_hdr, FORT_CONF_DATA_OFF);
+
+    /* Check the copy, as the service's pages are not stable */
+    if (conf_ref->conf.log_filters_n > FORT_CONF_LOG_FILTERS_MAX) {
+        conf_ref->conf.log_filters_n = FORT_CONF_LOG_FILTERS_MAX;
+    }
+    if (conf_ref->conf.udp_light_ports_n > FORT_CONF_UDP_LIGHT_PORTS_MAX) {
+        conf_ref->conf.udp_light_ports_n = FORT_CONF_UDP_LIGHT_PORTS_MAX;
+    }
+
+    const UINT16 exe_apps_n = conf_ref->conf.exe_apps_n;
 
-        exe_node = tommy_arrayof_ref(exe_nodes, index);
+    if (!fort_conf_ref_exe_load(conf_ref, conf, exe_apps_n)) {
+        fort_conf_ref_del(conf_ref);
+        return NULL;
     }
 
-    tommy_hashdyn_insert(exe_map, exe_node, entry, path_hash);
+    fort_conf_ref_file_ids_fill(conf_ref, conf, len, exe_apps_n);
 
-    ++conf->exe_apps_n;
+    return conf_ref;
 }
 
-static NTSTATUS fort_conf_ref_exe_new_entry(PFORT_CONF_REF conf_ref,
-        const PFORT_APP_ENTRY app_entry, const PVOID path, tommy_key_t path_hash)
+static void fort_conf_exe_dir_size_add(void *arg, void *obj)
 {
-    const UINT32 path_len = app_entry->path_len;
+    UINT32 *size = arg;
+    const PFORT_CONF_EXE_DIR dir = obj;
 
-    const UINT16 entry_size = (UINT16) FORT_CONF_APP_ENTRY_SIZE(path_len);
-    PFORT_APP_ENTRY entry = fort_pool_malloc(&conf_ref->pool_list, entry_size);
+    *size += FORT_CONF_EXE_DIR_SIZE(dir->path_len);
+}
 
-    if (entry == NULL)
-        return STATUS_INSUFFICIENT_RESOURCES;
+static NTSTATUS fort_conf_ref_exe_copy(PFORT_CONF_REF conf_ref, PFORT_CONF_REF src_ref)
+{
+    const PFORT_CONF_EXE_BUCKETS buckets = src_ref->exe_buckets;
+    const UINT32 buckets_n = buckets->mask + 1;
 
-    *entry = *app_entry;
+    UINT32 entries_size = 0;
+    for (UINT32 i = 0; i < buckets_n; ++i) {
+        for (PFORT_CONF_EXE_NODE node = buckets->heads[i]; node != NULL; node = node->next) {
+            const PFORT_CONF_EXE_DIR dir = node->dir;
+            const UINT16 dir_len = (dir != NULL) ? dir->path_len : 0;
 
-    /* Copy path */
-    {
-        PVOID new_path = entry + 1;
-        RtlCopyMemory(new_path, path, path_len);
+            entries_size += FORT_CONF_APP_ENTRY_SIZE(node->app_entry->path_len - dir_len);
+        }
     }
 
-    /* Add exe node */
-    fort_conf_ref_exe_new_path(conf_ref, entry, path_hash);
+    tommy_hashdyn_foreach_arg(&src_ref->exe_dirs, fort_conf_exe_dir_size_add, &entries_size);
 
-    return STATUS_SUCCESS;
-}
+    fort_pool_init(&conf_ref->pool_list, entries_size);
 
-static NTSTATUS fort_conf_ref_exe_add_path_locked(PFORT_CONF_REF conf_ref,
-        const PFORT_APP_ENTRY app_entry, const PVOID path, tommy_key_t path_hash)
-{
-    const PFORT_CONF_EXE_NODE node =
-            fort_conf_ref_exe_find_node(conf_ref, path, app_entry->path_len, path_hash);
+    /* The file ids of the deleted nodes stay unlinked */
+    PFORT_CONF_FILE_ID_NODE file_ids = (src_ref->file_ids_n != 0)
+            ? fort_conf_ref_file_ids_new(conf_ref, src_ref->file_ids_n)
+            : NULL;
 
-    if (node == NULL) {
-        return fort_conf_ref_exe_new_entry(conf_ref, app_entry, path, path_hash);
+    for (UINT16 i = 0; file_ids != NULL && i < src_ref->file_ids_n; ++i) {
+        file_ids[i].file_id = src_ref->file_ids[i].file_id;
+        file_ids[i].node = NULL;
     }
 
-    if (app_entry->flags.is_new)
-        return FORT_STATUS_USER_ERROR;
+    /* Keep the path hashes */
+    for (UINT32 i = 0; i < buckets_n; ++i) {
+        for (PFORT_CONF_EXE_NODE node = buckets->heads[i]; node != NULL; node = node->next) {
+            const PFORT_APP_ENTRY entry = node->app_entry;
+            const PFORT_CONF_EXE_DIR dir = node->dir;
 
-    /* Replace the data */
-    {
-        PFORT_APP_ENTRY entry = node->app_entry;
-        *entry = *app_entry;
+            const PVOID dir_path = (dir != NULL) ? dir->path : NULL;
+            const UINT16 dir_len = (dir != NULL) ? dir->path_len : 0;
+
+            /* The new ref has no free nodes */
+            const UINT16 node_i = conf_ref->conf.exe_apps_n;
+
+            const NTSTATUS status = fort_conf_ref_exe_new_dir_entry(
+                    conf_ref, entry, dir_path, dir_len, entry + 1, node->path_hash);
+            if (!NT_SUCCESS(status))
+                return status;
+
+            if (file_ids != NULL && node->file_id_i != 0) {
+                PFORT_CONF_EXE_NODE new_node = tommy_arrayof_ref(&conf_ref->exe_nodes, node_i);
+
+                fort_conf_ref_file_id_link(conf_ref, node->file_id_i - 1, new_node);
+            }
+        }
     }
 
     return STATUS_SUCCESS;
 }
 
-FORT_API NTSTATUS fort_conf_ref_exe_add_path(
-        PFORT_CONF_REF conf_ref, const PFORT_APP_ENTRY app_entry, const PVOID path)
+static BOOL fort_conf_patch_addr_groups_check(
+        const PFORT_CONF old_conf, const char *addr_groups, UINT32 addr_groups_size)
 {
-    const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path, app_entry->path_len);
-    NTSTATUS status;
+    const UINT32 *old_offsets = (const UINT32 *) (old_conf->data + old_conf->addr_groups_off);
+    const UINT32 *offsets = (const UINT32 *) addr_groups;
 
-    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
-    status = fort_conf_ref_exe_add_path_locked(conf_ref, app_entry, path, path_hash);
-    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
+    /* The offsets' table is followed by the groups and keeps their count */
+    const UINT32 table_size = old_offsets[0];
 
-    return status;
-}
+    if (table_size < sizeof(UINT32) || addr_groups_size < table_size + FORT_CONF_ADDR_GROUP_OFF
+            || offsets[0] != table_size)
+        return FALSE;
 
-FORT_API NTSTATUS fort_conf_ref_exe_add_entry(
-        PFORT_CONF_REF conf_ref, const PFORT_APP_ENTRY app_entry, BOOL locked)
-{
-    const PVOID path = app_entry + 1;
+    const UINT32 groups_n = table_size / sizeof(UINT32);
 
-    if (locked) {
-        const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path, app_entry->path_len);
+    for (UINT32 i = 0; i < groups_n; ++i) {
+        const UINT32 off = offsets[i];
 
-        return fort_conf_ref_exe_add_path_locked(conf_ref, app_entry, path, path_hash);
-    } else {
-        return fort_conf_ref_exe_add_path(conf_ref, app_entry, path);
+        if (off < table_size || off > addr_groups_size - FORT_CONF_ADDR_GROUP_OFF)
+            return FALSE;
     }
+
+    return TRUE;
 }
 
-static void fort_conf_ref_exe_fill(PFORT_CONF_REF conf_ref, const PFORT_CONF conf)
+static BOOL fort_conf_patch_app_periods_check(
+        const PFORT_CONF_PATCH patch, UINT32 app_periods_size, UCHAR app_periods_n)
 {
-    const char *app_entries = (const char *) (conf->data + conf->exe_apps_off);
+    if (app_periods_n == 0)
+        return TRUE;
 
-    const int count = conf->exe_apps_n;
+    /* The periods are indexed by the enabled groups */
+    UINT32 group_bits = (UINT16) patch->flags.group_bits;
+    UINT32 groups_n = 0;
 
-    for (int i = 0; i < count; ++i) {
-        const PFORT_APP_ENTRY entry = (const PFORT_APP_ENTRY) app_entries;
+    while (group_bits != 0) {
+        group_bits >>= 1;
+        ++groups_n;
+    }
 
-        fort_conf_ref_exe_add_entry(conf_ref, entry, TRUE);
+    const UINT32 periods_n = app_periods_size / sizeof(FORT_PERIOD);
 
-        app_entries += FORT_CONF_APP_ENTRY_SIZE(entry->path_len);
-    }
+    return app_periods_n <= periods_n && groups_n <= periods_n;
 }
 
-static void fort_conf_ref_exe_del_path(PFORT_CONF_REF conf_ref, const PVOID path, UINT32 path_len)
+FORT_API NTSTATUS fort_conf_ref_patch(
+        PFORT_CONF_REF conf_ref, const PFORT_CONF_PATCH patch, PFORT_CONF_REF *patched_conf_ref)
 {
-    const tommy_key_t path_hash = (tommy_key_t) tommy_hash_u64(0, path, path_len);
+    const PFORT_CONF old_conf = &conf_ref->conf;
 
-    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
-    {
-        PFORT_CONF_EXE_NODE node = fort_conf_ref_exe_find_node(conf_ref, path, path_len, path_hash);
+    const BOOL is_addr_groups = (patch->sections & FORT_CONF_PATCH_ADDR_GROUPS) != 0;
+    const BOOL is_app_periods = (patch->sections & FORT_CONF_PATCH_APP_PERIODS) != 0;
 
-        if (node != NULL) {
-            /* Delete from conf */
-            {
-                PFORT_CONF conf = &conf_ref->conf;
-                --conf->exe_apps_n;
-            }
+    const UINT32 addr_groups_size = is_addr_groups
+            ? patch->addr_groups_size
+            : (old_conf->app_periods_off - old_conf->addr_groups_off);
+    const UINT32 app_periods_size = is_app_periods
+            ? patch->app_periods_size
+            : (old_conf->rules_off - old_conf->app_periods_off);
+    const UINT32 apps_size = old_conf->exe_apps_off - old_conf->rules_off; /* rules and apps */
 
-            /* Delete from pool */
-            {
-                PFORT_APP_ENTRY entry = node->app_entry;
-                fort_pool_free(&conf_ref->pool_list, entry);
-            }
+    const char *addr_groups =
+            is_addr_groups ? patch->data : (old_conf->data + old_conf->addr_groups_off);
+    const char *app_periods = is_app_periods
+            ? (patch->data + (is_addr_groups ? addr_groups_size : 0))
+            : (old_conf->data + old_conf->app_periods_off);
 
-            /* Delete from exe map */
-            tommy_hashdyn_remove_existing(&conf_ref->exe_map, (tommy_hashdyn_node *) node);
+    const UCHAR app_periods_n = is_app_periods ? patch->app_periods_n : old_conf->app_periods_n;
 
-            tommy_list_insert_tail_check(&conf_ref->free_nodes, (tommy_node *) node);
-        }
-    }
-    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
-}
+    if (is_addr_groups
+            && !fort_conf_patch_addr_groups_check(old_conf, addr_groups, addr_groups_size))
+        return STATUS_INVALID_PARAMETER;
 
-FORT_API void fort_conf_ref_exe_del_entry(PFORT_CONF_REF conf_ref, const PFORT_APP_ENTRY entry)
-{
-    const PVOID path = (const PVOID)(entry + 1);
-    const UINT32 path_len = entry->path_len;
+    if (!fort_conf_patch_app_periods_check(patch, app_periods_size, app_periods_n))
+        return STATUS_INVALID_PARAMETER;
 
-    fort_conf_ref_exe_del_path(conf_ref, path, path_len);
-}
+    ULONG conf_len;
+    if (!NT_SUCCESS(RtlULongAdd(FORT_CONF_DATA_OFF + apps_size, addr_groups_size, &conf_len))
+            || !NT_SUCCESS(RtlULongAdd(conf_len, app_periods_size, &conf_len)))
+        return STATUS_INTEGER_OVERFLOW;
 
-static void fort_conf_ref_init(PFORT_CONF_REF conf_ref)
-{
-    conf_ref->refcount = 0;
+    PFORT_CONF_REF new_conf_ref = fort_conf_ref_alloc(conf_len, old_conf->exe_apps_n);
 
-    fort_pool_list_init(&conf_ref->pool_list);
-    tommy_list_init(&conf_ref->free_nodes);
+    if (new_conf_ref == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
 
-    tommy_arrayof_init(&conf_ref->exe_nodes, sizeof(FORT_CONF_EXE_NODE));
-    tommy_hashdyn_init(&conf_ref->exe_map);
+    PFORT_CONF conf = &new_conf_ref->conf;
 
-    conf_ref->conf_lock = 0;
-}
+    RtlCopyMemory(conf, old_conf, FORT_CONF_DATA_OFF);
 
-FORT_API PFORT_CONF_REF fort_conf_ref_new(const PFORT_CONF conf, ULONG len)
-{
-    const ULONG conf_len = FORT_CONF_DATA_OFF + conf->exe_apps_off;
-    const ULONG ref_len = conf_len + offsetof(FORT_CONF_REF, conf);
-    PFORT_CONF_REF conf_ref = tommy_malloc(ref_len);
+    conf->flags = patch->flags;
 
-    if (conf_ref != NULL) {
-        RtlCopyMemory(&conf_ref->conf, conf, conf_len);
+    conf->app_periods_n = app_periods_n;
 
-        fort_conf_ref_init(conf_ref);
-        fort_pool_init(&conf_ref->pool_list, len - conf_len);
+    /* The rules and app sections use relative offsets only */
+    conf->addr_groups_off = 0;
+    conf->app_periods_off = addr_groups_size;
+    conf->rules_off = conf->app_periods_off + app_periods_size;
+    conf->wild_apps_off = conf->rules_off + (old_conf->wild_apps_off - old_conf->rules_off);
+    conf->prefix_apps_off = conf->rules_off + (old_conf->prefix_apps_off - old_conf->rules_off);
+    conf->exe_apps_off = conf->rules_off + apps_size;
+    conf->exe_hashes_off = conf->exe_apps_off;
 
-        fort_conf_ref_exe_fill(conf_ref, conf);
-    }
+    RtlCopyMemory(conf->data + conf->addr_groups_off, addr_groups, addr_groups_size);
+    RtlCopyMemory(conf->data + conf->app_periods_off, app_periods, app_periods_size);
+    RtlCopyMemory(conf->data + conf->rules_off, old_conf->data + old_conf->rules_off, apps_size);
 
-    return conf_ref;
-}
+    fort_conf_app_perms_mask_init(conf, patch->flags.group_bits);
 
-static void fort_conf_ref_del(PFORT_CONF_REF conf_ref)
-{
-    fort_pool_done(&conf_ref->pool_list);
+    /* Counted again by the exe map */
+    conf->exe_apps_n = 0;
 
-    tommy_hashdyn_done(&conf_ref->exe_map);
-    tommy_arrayof_done(&conf_ref->exe_nodes);
+    NTSTATUS status;
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&conf_ref->conf_lock);
+    status = fort_conf_ref_exe_copy(new_conf_ref, conf_ref);
+    ExReleaseSpinLockExclusive(&conf_ref->conf_lock, oldIrql);
+
+    if (!NT_SUCCESS(status)) {
+        fort_conf_ref_del(new_conf_ref);
+        return status;
+    }
 
-    tommy_free(conf_ref);
+    *patched_conf_ref = new_conf_ref;
+
+    return STATUS_SUCCESS;
 }
 
-static void fort_conf_ref_put_locked(PFORT_DEVICE_CONF device_conf, PFORT_CONF_REF conf_ref)
+static PFORT_CONF_REF_CPU fort_conf_ref_cpu(PFORT_CONF_REF conf_ref)
 {
-    const UINT32 refcount = --conf_ref->refcount;
+    const ULONG cpu_index = KeGetCurrentProcessorIndex();
 
-    if (refcount == 0 && conf_ref != device_conf->ref) {
-        fort_conf_ref_del(conf_ref);
-    }
+    /* Any counter fits, only their sum matters */
+    return &conf_ref->cpus[(cpu_index < conf_ref->cpu_count) ? cpu_index : 0];
 }
 
 FORT_API void fort_conf_ref_put(PFORT_DEVICE_CONF device_conf, PFORT_CONF_REF conf_ref)
 {
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&device_conf->ref_lock, &lock_queue);
-    {
-        fort_conf_ref_put_locked(device_conf, conf_ref);
+    UNUSED(device_conf);
+
+    BOOL is_del = FALSE;
+
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
+
+    if (!conf_ref->retired) {
+        InterlockedDecrement(&fort_conf_ref_cpu(conf_ref)->refcount);
+    } else {
+        is_del = (InterlockedDecrement(&conf_ref->refcount) == 0);
+    }
+
+    KeLowerIrql(oldIrql);
+
+    if (is_del) {
+        fort_conf_ref_del(conf_ref);
     }
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
 FORT_API PFORT_CONF_REF fort_conf_ref_take(PFORT_DEVICE_CONF device_conf)
@@ -308,43 +1284,64 @@ FORT_API PFORT_CONF_REF fort_conf_ref_take(PFORT_DEVICE_CONF device_conf)
     if (device_conf->ref == NULL)
         return NULL;
 
-    PFORT_CONF_REF conf_ref;
+    /* The DISPATCH_LEVEL section is waited for by fort_conf_ref_sync_cpus() */
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
 
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&device_conf->ref_lock, &lock_queue);
-    {
-        conf_ref = device_conf->ref;
-        if (conf_ref != NULL) {
-            ++conf_ref->refcount;
-        }
+    PFORT_CONF_REF conf_ref = device_conf->ref;
+    if (conf_ref != NULL) {
+        InterlockedIncrement(&fort_conf_ref_cpu(conf_ref)->refcount);
     }
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    KeLowerIrql(oldIrql);
 
     return conf_ref;
 }
 
-FORT_API FORT_CONF_FLAGS fort_conf_ref_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_REF conf_ref)
+#define FORT_CONF_REF_RETIRE_BIAS 0x40000000
+
+static void fort_conf_ref_retire(PFORT_CONF_REF conf_ref)
 {
-    FORT_CONF_FLAGS old_conf_flags;
+    /* Wait for readers, which may still see the old conf ref */
+    fort_conf_ref_sync_cpus();
 
-    const PFORT_CONF_REF old_conf_ref = fort_conf_ref_take(device_conf);
+    /* Switch the puts to the shared counter */
+    conf_ref->refcount = FORT_CONF_REF_RETIRE_BIAS;
+    InterlockedExchange(&conf_ref->retired, TRUE);
 
-    if (old_conf_ref != NULL) {
-        old_conf_flags = old_conf_ref->conf.flags;
-    } else {
-        const UCHAR flags = fort_device_flag(device_conf, FORT_DEVICE_BOOT_MASK);
+    /* Wait for puts, which may still use the per-CPU counters */
+    fort_conf_ref_sync_cpus();
+
+    LONG refcount = 0;
+    for (ULONG i = 0; i < conf_ref->cpu_count; ++i) {
+        refcount += conf_ref->cpus[i].refcount;
+    }
 
-        RtlZeroMemory(&old_conf_flags, sizeof(FORT_CONF_FLAGS));
-        old_conf_flags.boot_filter = (flags & FORT_DEVICE_BOOT_FILTER) != 0;
-        old_conf_flags.filter_locals = (flags & FORT_DEVICE_BOOT_FILTER_LOCALS) != 0;
+    if (InterlockedAdd(&conf_ref->refcount, refcount - FORT_CONF_REF_RETIRE_BIAS) == 0) {
+        fort_conf_ref_del(conf_ref);
     }
+}
+
+FORT_API FORT_CONF_FLAGS fort_conf_ref_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_REF conf_ref)
+{
+    FORT_CONF_FLAGS old_conf_flags;
+    PFORT_CONF_REF old_conf_ref;
 
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&device_conf->ref_lock, &lock_queue);
     {
-        FORT_CONF_FLAGS conf_flags;
+        old_conf_ref = device_conf->ref;
+
+        if (old_conf_ref != NULL) {
+            old_conf_flags = old_conf_ref->conf.flags;
+        } else {
+            const UCHAR flags = fort_device_flag(device_conf, FORT_DEVICE_BOOT_MASK);
+
+            RtlZeroMemory(&old_conf_flags, sizeof(FORT_CONF_FLAGS));
+            old_conf_flags.boot_filter = (flags & FORT_DEVICE_BOOT_FILTER) != 0;
+            old_conf_flags.filter_locals = (flags & FORT_DEVICE_BOOT_FILTER_LOCALS) != 0;
+        }
 
-        device_conf->ref = conf_ref;
+        FORT_CONF_FLAGS conf_flags;
 
         if (conf_ref != NULL) {
             PFORT_CONF conf = &conf_ref->conf;
@@ -361,12 +1358,16 @@ FORT_API FORT_CONF_FLAGS fort_conf_ref_set(PFORT_DEVICE_CONF device_conf, PFORT_
 
         device_conf->conf_flags = conf_flags;
 
-        if (old_conf_ref != NULL) {
-            fort_conf_ref_put_locked(device_conf, old_conf_ref);
-        }
+        InterlockedExchangePointer((PVOID volatile *) &device_conf->ref, conf_ref);
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
+    fort_device_conf_generation_bump(device_conf);
+
+    if (old_conf_ref != NULL) {
+        fort_conf_ref_retire(old_conf_ref);
+    }
+
     return old_conf_flags;
 }
 
@@ -405,11 +1406,16 @@ FORT_API FORT_CONF_FLAGS fort_conf_ref_flags_set(
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
+    fort_device_conf_generation_bump(device_conf);
+
     return old_conf_flags;
 }
 
-FORT_API BOOL fort_conf_ref_period_update(PFORT_DEVICE_CONF device_conf, BOOL force, int *periods_n)
+FORT_API BOOL fort_conf_ref_period_update(
+        PFORT_DEVICE_CONF device_conf, BOOL force, ULONG *next_msec)
 {
+    *next_msec = 0;
+
     PFORT_CONF_REF conf_ref = fort_conf_ref_take(device_conf);
 
     if (conf_ref == NULL)
@@ -419,8 +1425,20 @@ FORT_API BOOL fort_conf_ref_period_update(PFORT_DEVICE_CONF device_conf, BOOL fo
     PFORT_CONF conf = &conf_ref->conf;
 
     if (conf->app_periods_n != 0) {
-        const FORT_TIME time = fort_current_time();
-        const UINT16 period_bits = fort_conf_app_period_bits(conf, time, periods_n);
+        ULONG minute_msec;
+        const FORT_TIME time = fort_current_time(&minute_msec);
+        const UINT16 period_bits = fort_conf_app_period_bits(conf, time, /*periods_n=*/NULL);
+
+        /* Time till the next period boundary */
+        int next_minutes = fort_conf_app_period_next(conf, time);
+
+        /* The local time's bias changes at a full hour (e.g. by DST), so check it again */
+        const int hour_minutes = 60 - time.minute;
+        if (next_minutes == 0 || next_minutes > hour_minutes) {
+            next_minutes = hour_minutes;
+        }
+
+        *next_msec = next_minutes * 60000 - minute_msec;
 
         if (force || device_conf->conf_flags.group_bits != period_bits) {
             device_conf->conf_flags.group_bits = period_bits;
@@ -433,12 +1451,16 @@ FORT_API BOOL fort_conf_ref_period_update(PFORT_DEVICE_CONF device_conf, BOOL fo
 
     fort_conf_ref_put(device_conf, conf_ref);
 
+    if (res) {
+        fort_device_conf_generation_bump(device_conf);
+    }
+
     return res;
 }
 
 FORT_API PFORT_CONF_ZONES fort_conf_zones_new(PFORT_CONF_ZONES zones, ULONG len)
 {
-    PFORT_CONF_ZONES conf_zones = fort_mem_alloc(len, FORT_ZONES_POOL_TAG);
+    PFORT_CONF_ZONES conf_zones = fort_mem_type_alloc_large(FORT_MEM_ZONES, len, FORT_MEM_NODE_ANY);
     if (conf_zones != NULL) {
         RtlCopyMemory(conf_zones, zones, len);
     }
@@ -448,18 +1470,179 @@ FORT_API PFORT_CONF_ZONES fort_conf_zones_new(PFORT_CONF_ZONES zones, ULONG len)
 static void fort_conf_zones_free(PFORT_CONF_ZONES zones)
 {
     if (zones != NULL) {
-        fort_mem_free(zones, FORT_ZONES_POOL_TAG);
+        fort_mem_type_free(FORT_MEM_ZONES, zones);
+    }
+}
+
+static void fort_conf_zone_free(PFORT_CONF_ZONE zone)
+{
+    if (zone != NULL) {
+        fort_mem_type_free(FORT_MEM_ZONES, zone);
+    }
+}
+
+static UINT32 fort_conf_zones_replaced_take(
+        PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONE *replaced_zones)
+{
+    const UINT32 zones_mask = device_conf->replaced_zones_mask;
+
+    RtlCopyMemory(replaced_zones, device_conf->replaced_zones, sizeof(device_conf->replaced_zones));
+    RtlZeroMemory(device_conf->replaced_zones, sizeof(device_conf->replaced_zones));
+
+    device_conf->replaced_zones_mask = 0;
+
+    return zones_mask;
+}
+
+static void fort_conf_zones_replaced_free(PFORT_CONF_ZONE *replaced_zones, UINT32 zones_mask)
+{
+    while (zones_mask != 0) {
+        const int zone_index = bit_scan_forward(zones_mask);
+
+        fort_conf_zone_free(replaced_zones[zone_index]);
+
+        zones_mask ^= (1u << zone_index);
+    }
+}
+
+static BOOL fort_conf_zones_node_replicated(PFORT_DEVICE_CONF device_conf)
+{
+    BOOL res = FALSE;
+
+    PFORT_CONF_REF conf_ref = fort_conf_ref_take(device_conf);
+    if (conf_ref != NULL) {
+        res = conf_ref->conf.zones_node_replicas;
+
+        fort_conf_ref_put(device_conf, conf_ref);
+    }
+
+    return res;
+}
+
+static void fort_conf_zones_node_new(PFORT_DEVICE_CONF device_conf, const PFORT_CONF_ZONES zones,
+        ULONG len, PFORT_CONF_ZONES *node_zones)
+{
+    RtlZeroMemory(node_zones, FORT_CONF_ZONES_NODE_MAX * sizeof(PFORT_CONF_ZONES));
+
+    const USHORT node_count = KeQueryHighestNodeNumber() + 1;
+
+    if (zones == NULL || node_count < 2 || !fort_conf_zones_node_replicated(device_conf))
+        return;
+
+    const USHORT count = min(node_count, FORT_CONF_ZONES_NODE_MAX);
+
+    for (USHORT node = 0; node < count; ++node) {
+        PFORT_CONF_ZONES conf_zones = fort_mem_type_alloc_large(FORT_MEM_ZONES, len, node);
+        if (conf_zones == NULL)
+            break; /* the node uses the primary zones */
+
+        RtlCopyMemory(conf_zones, zones, len);
+
+        node_zones[node] = conf_zones;
+    }
+}
+
+static void fort_conf_zones_node_free(PFORT_CONF_ZONES *node_zones)
+{
+    for (int node = 0; node < FORT_CONF_ZONES_NODE_MAX; ++node) {
+        fort_conf_zones_free(node_zones[node]);
     }
 }
 
-FORT_API void fort_conf_zones_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONES zones)
+/* The replicas' masks are stale, the primary zones keep them */
+inline static PFORT_CONF_ZONES fort_conf_zones_node(
+        PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONES zones)
 {
+    const USHORT node = KeGetCurrentNodeNumber();
+
+    PFORT_CONF_ZONES node_zones =
+            (node < FORT_CONF_ZONES_NODE_MAX) ? device_conf->node_zones[node] : NULL;
+
+    return (node_zones != NULL) ? node_zones : zones;
+}
+
+FORT_API void fort_conf_zones_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONES zones, ULONG len)
+{
+    PFORT_CONF_ZONES node_zones[FORT_CONF_ZONES_NODE_MAX];
+
+    /* Copy the zones to the nodes' local memory before the lock */
+    fort_conf_zones_node_new(device_conf, zones, len, node_zones);
+
+    PFORT_CONF_ZONES old_zones;
+    PFORT_CONF_ZONE replaced_zones[FORT_CONF_ZONE_MAX];
+    UINT32 replaced_zones_mask;
+
     KIRQL oldIrql = ExAcquireSpinLockExclusive(&device_conf->zones_lock);
     {
-        fort_conf_zones_free(device_conf->zones);
+        /* The large blocks are freed at PASSIVE_LEVEL, after the lock */
+        replaced_zones_mask = fort_conf_zones_replaced_take(device_conf, replaced_zones);
+
+        old_zones = device_conf->zones;
         device_conf->zones = zones;
+
+        for (int node = 0; node < FORT_CONF_ZONES_NODE_MAX; ++node) {
+            PFORT_CONF_ZONES old_zones = device_conf->node_zones[node];
+
+            device_conf->node_zones[node] = node_zones[node];
+            node_zones[node] = old_zones;
+        }
+    }
+    ExReleaseSpinLockExclusive(&device_conf->zones_lock, oldIrql);
+
+    fort_conf_zones_replaced_free(replaced_zones, replaced_zones_mask);
+
+    fort_conf_zones_free(old_zones);
+
+    /* The old replicas */
+    fort_conf_zones_node_free(node_zones);
+
+    fort_device_conf_generation_bump(device_conf);
+}
+
+FORT_API PFORT_CONF_ZONE fort_conf_zone_new(PFORT_CONF_ZONE zone, ULONG len)
+{
+    PFORT_CONF_ZONE conf_zone = fort_mem_type_alloc_large(FORT_MEM_ZONES, len, FORT_MEM_NODE_ANY);
+    if (conf_zone != NULL) {
+        RtlCopyMemory(conf_zone, zone, len);
+    }
+    return conf_zone;
+}
+
+FORT_API NTSTATUS fort_conf_zone_replace(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONE zone)
+{
+    NTSTATUS status = STATUS_INVALID_DEVICE_STATE;
+    PFORT_CONF_ZONE old_zone = zone;
+
+    const int zone_index = zone->zone_id - 1;
+    const UINT32 zone_mask = (1u << zone_index);
+
+    KIRQL oldIrql = ExAcquireSpinLockExclusive(&device_conf->zones_lock);
+    PFORT_CONF_ZONES zones = device_conf->zones;
+    if (zones != NULL) {
+        old_zone = device_conf->replaced_zones[zone_index];
+
+        device_conf->replaced_zones[zone_index] = zone;
+        device_conf->replaced_zones_mask |= zone_mask;
+
+        zones->mask |= zone_mask;
+        if (zone->enabled) {
+            zones->enabled_mask |= zone_mask;
+        } else {
+            zones->enabled_mask &= ~zone_mask;
+        }
+
+        status = STATUS_SUCCESS;
     }
     ExReleaseSpinLockExclusive(&device_conf->zones_lock, oldIrql);
+
+    /* The replaced zone or the rejected new one */
+    fort_conf_zone_free(old_zone);
+
+    if (NT_SUCCESS(status)) {
+        fort_device_conf_generation_bump(device_conf);
+    }
+
+    return status;
 }
 
 FORT_API void fort_conf_zone_flag_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONE_FLAG zone_flag)
@@ -475,24 +1658,41 @@ FORT_API void fort_conf_zone_flag_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_
         }
     }
     ExReleaseSpinLockExclusive(&device_conf->zones_lock, oldIrql);
+
+    fort_device_conf_generation_bump(device_conf);
 }
 
-FORT_API BOOL fort_conf_zones_ip_included(
+/* Returns the mask of the matched zones: all of them by the merged index, else the first one */
+FORT_API UINT32 fort_conf_zones_ip_matched(
         PFORT_DEVICE_CONF device_conf, UINT32 zones_mask, const UINT32 *remote_ip, BOOL isIPv6)
 {
-    BOOL res = FALSE;
+    UINT32 matched_mask = 0;
 
     KIRQL oldIrql = ExAcquireSpinLockShared(&device_conf->zones_lock);
     PFORT_CONF_ZONES zones = device_conf->zones;
     if (zones != NULL) {
         zones_mask &= (zones->mask & zones->enabled_mask);
+
+        /* Read the addresses from the current NUMA node's replica */
+        zones = fort_conf_zones_node(device_conf, zones);
+
+        /* Lookup the indexed zones by the merged index, it's stale for the replaced zones */
+        if (!isIPv6 && zones->index_n != 0) {
+            const UINT32 index_mask = zones->index_mask & ~device_conf->replaced_zones_mask;
+
+            matched_mask = fort_conf_zones_ip4_mask(zones, *remote_ip) & zones_mask & index_mask;
+            zones_mask = (matched_mask != 0) ? 0 : (zones_mask & ~index_mask);
+        }
+
         while (zones_mask != 0) {
             const int zone_index = bit_scan_forward(zones_mask);
-            PFORT_CONF_ADDR4_LIST addr_list =
-                    (PFORT_CONF_ADDR4_LIST) (zones->data + zones->addr_off[zone_index]);
+            const PFORT_CONF_ZONE zone = device_conf->replaced_zones[zone_index];
+            PFORT_CONF_ADDR4_LIST addr_list = (zone != NULL)
+                    ? (PFORT_CONF_ADDR4_LIST) zone->data
+                    : (PFORT_CONF_ADDR4_LIST) (zones->data + zones->addr_off[zone_index]);
 
             if (fort_conf_ip_inlist(remote_ip, addr_list, isIPv6)) {
-                res = TRUE;
+                matched_mask = (1u << zone_index);
                 break;
             }
 
@@ -501,5 +1701,11 @@ FORT_API BOOL fort_conf_zones_ip_included(
     }
     ExReleaseSpinLockShared(&device_conf->zones_lock, oldIrql);
 
-    return res;
+    return matched_mask;
+}
+
+FORT_API BOOL fort_conf_zones_ip_included(
+        PFORT_DEVICE_CONF device_conf, UINT32 zones_mask, const UINT32 *remote_ip, BOOL isIPv6)
+{
+    return fort_conf_zones_ip_matched(device_conf, zones_mask, remote_ip, isIPv6) != 0;
 }
@@ -7,17 +7,56 @@
 #include "fortpool.h"
 #include "forttds.h"
 
+#define FORT_CONF_REF_CPU_SIZE 64 /* cache line size */
+
+typedef struct fort_conf_ref_cpu
+{
+    LONG volatile refcount;
+
+    UCHAR pad[FORT_CONF_REF_CPU_SIZE - sizeof(LONG)];
+} FORT_CONF_REF_CPU, *PFORT_CONF_REF_CPU;
+
+typedef struct fort_conf_exe_buckets
+{
+    struct fort_conf_exe_buckets *prev; /* retired, freed with the conf ref */
+
+    UINT32 mask;
+
+    struct fort_conf_exe_node *volatile heads[1];
+} FORT_CONF_EXE_BUCKETS, *PFORT_CONF_EXE_BUCKETS;
+
+/* The exe node of the file id, NULL when the node is deleted */
+typedef struct fort_conf_file_id_node
+{
+    FORT_FILE_ID file_id;
+    struct fort_conf_exe_node *volatile node;
+} FORT_CONF_FILE_ID_NODE, *PFORT_CONF_FILE_ID_NODE;
+
+#define FORT_CONF_EXE_BUCKETS_BITS_MIN 4
+#define FORT_CONF_EXE_BUCKETS_SIZE(n)                                                              \
+    (offsetof(FORT_CONF_EXE_BUCKETS, heads) + (n) * sizeof(struct fort_conf_exe_node *))
+
 typedef struct fort_conf_ref
 {
-    UINT32 volatile refcount;
+    LONG volatile refcount; /* used after the conf ref is retired */
+    LONG volatile retired;
+
+    ULONG cpu_count;
+    PFORT_CONF_REF_CPU cpus; /* per-CPU references of readers */
 
     FORT_POOL_LIST pool_list;
     tommy_list free_nodes;
 
     tommy_arrayof exe_nodes;
-    tommy_hashdyn exe_map;
+    PFORT_CONF_EXE_BUCKETS volatile exe_buckets;
+    tommy_hashdyn exe_dirs; /* shared dir paths of exe entries */
 
-    EX_SPIN_LOCK conf_lock;
+    PFORT_CONF_FILE_ID_NODE file_ids; /* sorted by the file ids */
+    UINT16 file_ids_n;
+
+    LONG volatile exe_seq; /* odd while the exe map is changing */
+
+    EX_SPIN_LOCK conf_lock; /* serializes exe map writers */
 
     FORT_CONF conf;
 } FORT_CONF_REF, *PFORT_CONF_REF;
@@ -31,15 +70,22 @@ typedef struct fort_conf_ref
 #define FORT_DEVICE_FILTER_PACKETS      0x20
 #define FORT_DEVICE_SHUTDOWN_REGISTERED 0x40
 
+#define FORT_CONF_ZONES_NODE_MAX 8 /* NUMA nodes with the zones' replicas, others use the primary */
+
 typedef struct fort_device_conf
 {
     UCHAR volatile flags;
 
+    LONG volatile generation; /* changed on every conf or zones update */
+
     FORT_CONF_FLAGS volatile conf_flags;
     PFORT_CONF_REF volatile ref;
-    KSPIN_LOCK ref_lock;
+    KSPIN_LOCK ref_lock; /* serializes writers only */
 
     PFORT_CONF_ZONES zones;
+    PFORT_CONF_ZONES node_zones[FORT_CONF_ZONES_NODE_MAX]; /* read-only copies of the zones */
+    PFORT_CONF_ZONE replaced_zones[FORT_CONF_ZONE_MAX]; /* replaced after the zones were set */
+    UINT32 replaced_zones_mask;
     EX_SPIN_LOCK zones_lock;
 } FORT_DEVICE_CONF, *PFORT_DEVICE_CONF;
 
@@ -53,9 +99,24 @@ FORT_API UCHAR fort_device_flag_set(PFORT_DEVICE_CONF device_conf, UCHAR flag, B
 
 FORT_API UCHAR fort_device_flag(PFORT_DEVICE_CONF device_conf, UCHAR flag);
 
+FORT_API void fort_device_conf_generation_bump(PFORT_DEVICE_CONF device_conf);
+
+/* Context of fort_conf_exe_find_hashed() */
+typedef struct fort_conf_exe_find_arg
+{
+    PFORT_CONF_REF conf_ref;
+    UINT32 path_hash; /* by fort_conf_app_path_hash() */
+} FORT_CONF_EXE_FIND_ARG, *PFORT_CONF_EXE_FIND_ARG;
+
 FORT_API FORT_APP_ENTRY fort_conf_exe_find(
         const PFORT_CONF conf, PVOID context, const PVOID path, UINT32 path_len);
 
+FORT_API FORT_APP_ENTRY fort_conf_exe_find_hashed(
+        const PFORT_CONF conf, PVOID context, const PVOID path, UINT32 path_len);
+
+FORT_API FORT_APP_ENTRY fort_conf_ref_file_id_find(
+        PFORT_CONF_REF conf_ref, const PFORT_FILE_ID file_id);
+
 FORT_API NTSTATUS fort_conf_ref_exe_add_path(
         PFORT_CONF_REF conf_ref, const PFORT_APP_ENTRY app_entry, const PVOID path);
 
@@ -64,8 +125,21 @@ FORT_API NTSTATUS fort_conf_ref_exe_add_entry(
 
 FORT_API void fort_conf_ref_exe_del_entry(PFORT_CONF_REF conf_ref, const PFORT_APP_ENTRY entry);
 
+FORT_API BOOL fort_conf_app_entries_valid(const PVOID entries, ULONG len);
+
+FORT_API NTSTATUS fort_conf_ref_exe_add_entries(PFORT_CONF_REF conf_ref, const PVOID entries,
+        ULONG len, UINT32 *added_n, UINT16 *group_bits);
+
+FORT_API void fort_conf_ref_exe_del_entries(
+        PFORT_CONF_REF conf_ref, const PVOID entries, ULONG len, UINT16 *group_bits);
+
+FORT_API void fort_conf_ref_trim(PFORT_CONF_REF conf_ref);
+
 FORT_API PFORT_CONF_REF fort_conf_ref_new(const PFORT_CONF conf, ULONG len);
 
+FORT_API NTSTATUS fort_conf_ref_patch(
+        PFORT_CONF_REF conf_ref, const PFORT_CONF_PATCH patch, PFORT_CONF_REF *patched_conf_ref);
+
 FORT_API void fort_conf_ref_put(PFORT_DEVICE_CONF device_conf, PFORT_CONF_REF conf_ref);
 
 FORT_API PFORT_CONF_REF fort_conf_ref_take(PFORT_DEVICE_CONF device_conf);
@@ -76,15 +150,23 @@ FORT_API FORT_CONF_FLAGS fort_conf_ref_flags_set(
         PFORT_DEVICE_CONF device_conf, const PFORT_CONF_FLAGS conf_flags);
 
 FORT_API BOOL fort_conf_ref_period_update(
-        PFORT_DEVICE_CONF device_conf, BOOL force, int *periods_n);
+        PFORT_DEVICE_CONF device_conf, BOOL force, ULONG *next_msec);
 
 FORT_API PFORT_CONF_ZONES fort_conf_zones_new(PFORT_CONF_ZONES zones, ULONG len);
 
-FORT_API void fort_conf_zones_set(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONES zones);
+FORT_API void fort_conf_zones_set(
+        PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONES zones, ULONG len);
+
+FORT_API PFORT_CONF_ZONE fort_conf_zone_new(PFORT_CONF_ZONE zone, ULONG len);
+
+FORT_API NTSTATUS fort_conf_zone_replace(PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONE zone);
 
 FORT_API void fort_conf_zone_flag_set(
         PFORT_DEVICE_CONF device_conf, PFORT_CONF_ZONE_FLAG zone_flag);
 
+FORT_API UINT32 fort_conf_zones_ip_matched(
+        PFORT_DEVICE_CONF device_conf, UINT32 zones_mask, const UINT32 *remote_ip, BOOL isIPv6);
+
 FORT_API BOOL fort_conf_zones_ip_included(
         PFORT_DEVICE_CONF device_conf, UINT32 zones_mask, const UINT32 *remote_ip, BOOL isIPv6);
 
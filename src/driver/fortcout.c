@@ -9,6 +9,8 @@
 #include "fortcoutarg.h"
 #include "fortdbg.h"
 #include "fortdev.h"
+#include "fortetw.h"
+#include "fortmem.h"
 #include "fortps.h"
 #include "forttrace.h"
 #include "fortutl.h"
@@ -53,20 +55,111 @@ inline static void fort_callout_ale_set_app_flags(
     cx->app_data = app_data;
 }
 
+/* The app of the process's image file, by any of the file's paths */
+inline static FORT_APP_ENTRY fort_callout_ale_file_id_app(
+        PCFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref)
+{
+    FORT_APP_ENTRY app_data;
+    app_data.flags.v = 0;
+
+    FORT_FILE_ID file_id;
+    if (conf_ref->file_ids_n != 0 && !cx->inherited
+            && fort_pstree_get_proc_file_id(&fort_device()->ps_tree, cx->process_id, &file_id)) {
+        app_data = fort_conf_ref_file_id_find(conf_ref, &file_id);
+    }
+
+    return app_data;
+}
+
 static FORT_APP_ENTRY fort_callout_ale_conf_app_data(
         PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref)
 {
     if (cx->app_data_found)
         return cx->app_data;
 
-    const FORT_APP_ENTRY app_data = fort_conf_app_find(
-            &conf_ref->conf, cx->path->Buffer, cx->path->Length, fort_conf_exe_find, conf_ref);
+    PFORT_PSTREE ps_tree = &fort_device()->ps_tree;
+
+    FORT_APP_ENTRY app_data;
+    if (!fort_pstree_get_proc_app(
+                ps_tree, cx->process_id, cx->conf_generation, cx->path_hash, &app_data)) {
+        FORT_CONF_EXE_FIND_ARG exe_arg = { .conf_ref = conf_ref, .path_hash = cx->path_hash };
+
+        /* The exact path first, then the image's file id, then the path patterns */
+        app_data = fort_conf_exe_find_hashed(
+                &conf_ref->conf, &exe_arg, cx->path->Buffer, cx->path->Length);
+
+        if (app_data.flags.v == 0) {
+            app_data = fort_callout_ale_file_id_app(cx, conf_ref);
+        }
+
+        if (app_data.flags.v == 0) {
+            app_data = fort_conf_app_pattern_find(
+                    &conf_ref->conf, cx->path->Buffer, cx->path->Length);
+        }
+
+        /* Unknown apps may be added by fort_callout_ale_log_app_path() */
+        if (app_data.flags.v != 0) {
+            fort_pstree_set_proc_app(
+                    ps_tree, cx->process_id, cx->conf_generation, cx->path_hash, app_data);
+        }
+    }
 
     fort_callout_ale_set_app_flags(cx, app_data);
 
     return app_data;
 }
 
+inline static void fort_callout_ale_log_proc_new(PFORT_CALLOUT_ALE_EXTRA cx)
+{
+    const UINT32 session_id =
+            fort_pstree_get_proc_session_id(&fort_device()->ps_tree, cx->process_id);
+
+    /* The inherited app's path differs from the process's one */
+    const UINT32 app_id = (cx->app_data_found && !cx->inherited) ? cx->app_data.app_id : 0;
+
+    fort_buffer_proc_new_write(&fort_device()->buffer, cx->process_id, session_id, app_id,
+            cx->real_path->Length, cx->real_path->Buffer, &cx->irp, &cx->info);
+}
+
+/* The short-lived UDP flows, e.g. of DNS, are not tracked to spare the flows' map */
+inline static BOOL fort_callout_ale_light_flow(PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx,
+        PFORT_CONF_REF conf_ref, FORT_APP_FLAGS app_flags)
+{
+    const PFORT_CONF conf = &conf_ref->conf;
+
+    if (conf->udp_light_ports_n == 0)
+        return FALSE;
+
+    const IPPROTO ip_proto =
+            (IPPROTO) ca->inFixedValues->incomingValue[ca->fi->ipProto].value.uint8;
+    if (ip_proto != IPPROTO_UDP)
+        return FALSE;
+
+    /* The service's port */
+    const UCHAR port_index = ca->inbound ? ca->fi->localPort : ca->fi->remotePort;
+    const UINT16 port = ca->inFixedValues->incomingValue[port_index].value.uint16;
+
+    if (!fort_conf_udp_light_port(conf, port))
+        return FALSE;
+
+    /* The classifying datagram, when available */
+    const UINT32 data_len = (ca->netBufList != NULL)
+            ? NET_BUFFER_DATA_LENGTH(NET_BUFFER_LIST_FIRST_NB(ca->netBufList))
+            : 0;
+
+    BOOL log_stat = FALSE;
+
+    if (!fort_stat_proc_light_add(&fort_device()->stat, cx->process_id,
+                (UCHAR) app_flags.group_index, ca->inbound, data_len, &log_stat))
+        return FALSE;
+
+    if (!log_stat) {
+        fort_callout_ale_log_proc_new(cx);
+    }
+
+    return TRUE;
+}
+
 inline static BOOL fort_callout_ale_associate_flow(PCFORT_CALLOUT_ARG ca,
         PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref, FORT_APP_FLAGS app_flags)
 {
@@ -78,10 +171,17 @@ inline static BOOL fort_callout_ale_associate_flow(PCFORT_CALLOUT_ARG ca,
 
     const UCHAR group_index = (UCHAR) app_flags.group_index;
 
+    const FORT_FLOW_ENDPOINT endpoint = {
+        .remote_ip = cx->remote_ip,
+        .local_port = ca->inFixedValues->incomingValue[ca->fi->localPort].value.uint16,
+        .remote_port = ca->inFixedValues->incomingValue[ca->fi->remotePort].value.uint16,
+        .ip_proto = (UCHAR) ip_proto,
+    };
+
     BOOL log_stat = FALSE;
 
     const NTSTATUS status = fort_flow_associate(&fort_device()->stat, flow_id, cx->process_id,
-            group_index, ca->isIPv6, is_tcp, ca->inbound, cx->is_reauth, &log_stat);
+            group_index, ca->isIPv6, is_tcp, ca->inbound, cx->is_reauth, &endpoint, &log_stat);
 
     if (!NT_SUCCESS(status)) {
         if (status != FORT_STATUS_FLOW_BLOCK) {
@@ -94,8 +194,7 @@ inline static BOOL fort_callout_ale_associate_flow(PCFORT_CALLOUT_ARG ca,
     }
 
     if (!log_stat) {
-        fort_buffer_proc_new_write(&fort_device()->buffer, cx->process_id, cx->real_path->Length,
-                cx->real_path->Buffer, &cx->irp, &cx->info);
+        fort_callout_ale_log_proc_new(cx);
     }
 
     return FALSE;
@@ -152,52 +251,146 @@ inline static BOOL fort_callout_ale_log_blocked_ip_check(
     return fort_callout_ale_log_blocked_ip_check_app(conf_flags, app_data.flags);
 }
 
+inline static const UINT32 *fort_callout_ale_local_ip(PCFORT_CALLOUT_ARG ca)
+{
+    return ca->isIPv6
+            ? (const UINT32 *) ca->inFixedValues->incomingValue[ca->fi->localIp].value.byteArray16
+            : &ca->inFixedValues->incomingValue[ca->fi->localIp].value.uint32;
+}
+
+inline static UCHAR fort_callout_ale_addr_classes(
+        PCFORT_CALLOUT_ARG ca, PCFORT_CALLOUT_ALE_EXTRA cx, const UINT32 *local_ip)
+{
+    UCHAR addr_classes = fort_conf_log_filter_addr_classes(local_ip, ca->isIPv6)
+            | fort_conf_log_filter_addr_classes(cx->remote_ip, ca->isIPv6);
+
+    /* The subnets' broadcasts are known by the destination's type only */
+    const UCHAR addr_type = ca->inFixedValues->incomingValue[ca->fi->destAddrType].value.uint8;
+
+    if (addr_type == NlatBroadcast) {
+        addr_classes |= FORT_LOG_FILTER_ADDR_BROADCAST;
+    } else if (addr_type == NlatMulticast) {
+        addr_classes |= FORT_LOG_FILTER_ADDR_MULTICAST;
+    }
+
+    return addr_classes;
+}
+
+inline static BOOL fort_callout_ale_log_filtered(PCFORT_CALLOUT_ARG ca,
+        PCFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref, const UINT32 *local_ip,
+        IPPROTO ip_proto, UINT16 local_port, UINT16 remote_port)
+{
+    const PFORT_CONF conf = &conf_ref->conf;
+
+    if (conf->log_filters_n == 0)
+        return FALSE;
+
+    const UCHAR addr_classes = fort_callout_ale_addr_classes(ca, cx, local_ip);
+
+    const int filter_index = fort_conf_log_filter_find(
+            conf, ca->inbound, (UCHAR) ip_proto, local_port, remote_port, addr_classes);
+    if (filter_index < 0)
+        return FALSE;
+
+    fort_perf_log_filter_suppressed(&fort_device()->perf, filter_index);
+
+    return TRUE;
+}
+
 inline static void fort_callout_ale_log_blocked_ip(PCFORT_CALLOUT_ARG ca,
         PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags)
 {
     if (!fort_callout_ale_log_blocked_ip_check(cx, conf_ref, conf_flags))
         return;
 
-    const UINT32 *local_ip = ca->isIPv6
-            ? (const UINT32 *) ca->inFixedValues->incomingValue[ca->fi->localIp].value.byteArray16
-            : &ca->inFixedValues->incomingValue[ca->fi->localIp].value.uint32;
+    const UINT32 *local_ip = fort_callout_ale_local_ip(ca);
 
     const UINT16 local_port = ca->inFixedValues->incomingValue[ca->fi->localPort].value.uint16;
     const UINT16 remote_port = ca->inFixedValues->incomingValue[ca->fi->remotePort].value.uint16;
     const IPPROTO ip_proto =
             (IPPROTO) ca->inFixedValues->incomingValue[ca->fi->ipProto].value.uint8;
 
+    /* Suppress the noisy discovery traffic before the buffer */
+    if (fort_callout_ale_log_filtered(
+                ca, cx, conf_ref, local_ip, ip_proto, local_port, remote_port))
+        return;
+
     fort_buffer_blocked_ip_write(&fort_device()->buffer, ca->isIPv6, ca->inbound, cx->inherited,
             cx->block_reason, ip_proto, local_port, remote_port, local_ip, cx->remote_ip,
             cx->process_id, cx->real_path->Length, cx->real_path->Buffer, &cx->irp, &cx->info);
 }
 
+inline static void fort_callout_ale_log_allowed_ip(PCFORT_CALLOUT_ARG ca,
+        PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags)
+{
+    if (!conf_flags.log_allowed_ip)
+        return;
+
+    const FORT_APP_ENTRY app_data = fort_callout_ale_conf_app_data(cx, conf_ref);
+
+    if (!(app_data.flags.v == 0 || app_data.flags.log_conn))
+        return;
+
+    const UINT32 *local_ip = fort_callout_ale_local_ip(ca);
+
+    const UINT16 local_port = ca->inFixedValues->incomingValue[ca->fi->localPort].value.uint16;
+    const UINT16 remote_port = ca->inFixedValues->incomingValue[ca->fi->remotePort].value.uint16;
+    const IPPROTO ip_proto =
+            (IPPROTO) ca->inFixedValues->incomingValue[ca->fi->ipProto].value.uint8;
+
+    /* Sampled by the buffer */
+    fort_buffer_allowed_ip_write(&fort_device()->buffer, ca->isIPv6, ca->inbound, cx->inherited,
+            ip_proto, local_port, remote_port, local_ip, cx->remote_ip, cx->process_id,
+            cx->real_path->Length, cx->real_path->Buffer, &cx->irp, &cx->info);
+}
+
 inline static BOOL fort_callout_ale_add_pending(
         PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx, FORT_CONF_FLAGS conf_flags)
 {
-    if (!fort_pending_add_packet(&fort_device()->pending, ca, cx)) {
+    switch (fort_pending_add_packet(&fort_device()->pending, ca, cx)) {
+    case FORT_PENDING_ADDED:
+        cx->drop_blocked = TRUE;
+        cx->block_reason = FORT_BLOCK_REASON_ASK_PENDING;
+        return TRUE; /* drop (pending) */
+    case FORT_PENDING_EXPIRED_ALLOW:
+        return FALSE; /* allow (timed out) */
+    case FORT_PENDING_EXPIRED_BLOCK:
+        cx->block_reason = FORT_BLOCK_REASON_ASK_TIMEOUT;
+        return TRUE; /* block (timed out) */
+    default:
         cx->block_reason = FORT_BLOCK_REASON_ASK_LIMIT;
         return TRUE; /* block (error) */
     }
-
-    cx->drop_blocked = TRUE;
-    cx->block_reason = FORT_BLOCK_REASON_ASK_PENDING;
-    return TRUE; /* drop (pending) */
 }
 
 inline static BOOL fort_callout_ale_process_flow(PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx,
         PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags, FORT_APP_FLAGS app_flags)
 {
-    if (app_flags.v == 0 && conf_flags.ask_to_connect) {
-        return fort_callout_ale_add_pending(ca, cx, conf_flags);
-    }
+    if (app_flags.v == 0 && conf_flags.ask_to_connect && !cx->rule_allowed
+            && fort_callout_ale_add_pending(ca, cx, conf_flags))
+        return TRUE;
 
     if (!conf_flags.log_stat)
         return FALSE;
 
+    if (fort_callout_ale_light_flow(ca, cx, conf_ref, app_flags))
+        return FALSE;
+
     return fort_callout_ale_associate_flow(ca, cx, conf_ref, app_flags);
 }
 
+/* Count the zones' hits for pruning of the never matched ones */
+static BOOL fort_callout_zones_ip_included(
+        PFORT_DEVICE_CONF device_conf, UINT32 zones_mask, const UINT32 *remote_ip, BOOL isIPv6)
+{
+    const UINT32 matched_mask =
+            fort_conf_zones_ip_matched(device_conf, zones_mask, remote_ip, isIPv6);
+
+    fort_perf_zones_hit(&fort_device()->perf, matched_mask);
+
+    return matched_mask != 0;
+}
+
 static BOOL fort_callout_ale_is_zone_blocked(PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx,
         PFORT_CONF_REF conf_ref, FORT_APP_ENTRY app_data)
 {
@@ -211,14 +404,14 @@ static BOOL fort_callout_ale_is_zone_blocked(PCFORT_CALLOUT_ARG ca, PFORT_CALLOU
     }
 
     if (app_data.reject_zones != 0
-            && fort_conf_zones_ip_included(
+            && fort_callout_zones_ip_included(
                     &fort_device()->conf, app_data.reject_zones, cx->remote_ip, ca->isIPv6)) {
         cx->block_reason = FORT_BLOCK_REASON_ZONE;
         return TRUE; /* block Rejected Zone */
     }
 
     if (app_data.accept_zones != 0
-            && !fort_conf_zones_ip_included(
+            && !fort_callout_zones_ip_included(
                     &fort_device()->conf, app_data.accept_zones, cx->remote_ip, ca->isIPv6)) {
         cx->block_reason = FORT_BLOCK_REASON_ZONE;
         return TRUE; /* block Not Accepted Zone */
@@ -234,9 +427,21 @@ inline static BOOL fort_callout_ale_is_new(FORT_CONF_FLAGS conf_flags, FORT_APP_
     return !app_found && (conf_flags.allow_all_new || conf_flags.ask_to_connect);
 }
 
+/* The Rule allows the addresses, but not the explicitly blocked apps */
+inline static BOOL fort_callout_ale_is_rule_allowed(
+        PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref, FORT_APP_ENTRY app_data)
+{
+    const BOOL app_found = (app_data.flags.v != 0);
+
+    return !(app_found && fort_conf_app_blocked(&conf_ref->conf, app_data.flags, &cx->block_reason));
+}
+
 inline static BOOL fort_callout_ale_is_allowed(PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx,
         PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags, FORT_APP_ENTRY app_data)
 {
+    if (cx->rule_allowed)
+        return fort_callout_ale_is_rule_allowed(cx, conf_ref, app_data);
+
     return !cx->blocked /* collect traffic, when Filter Disabled */
             /* "Allow, if not blocked" or "Ask to Connect" */
             || fort_callout_ale_is_new(conf_flags, app_data)
@@ -247,22 +452,149 @@ inline static BOOL fort_callout_ale_is_allowed(PCFORT_CALLOUT_ARG ca, PFORT_CALL
                     || fort_conf_app_blocked(&conf_ref->conf, app_data.flags, &cx->block_reason));
 }
 
+inline static void fort_callout_ale_cache_insert(
+        PFORT_CALLOUT_ALE_EXTRA cx, const PFORT_CACHE_KEY cache_key, BOOL decided, BOOL blocked)
+{
+    FORT_CACHE_VERDICT verdict = {
+        .decided = (UCHAR) decided,
+        .blocked = (UCHAR) blocked,
+        .block_reason = cx->block_reason,
+        .app_data = cx->app_data,
+    };
+
+    fort_cache_insert(&fort_device()->cache, cache_key, cx->conf_generation, &verdict);
+}
+
+inline static BOOL fort_callout_ale_log_allowed(PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx,
+        PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags, FORT_APP_FLAGS app_flags)
+{
+    if (fort_callout_ale_process_flow(ca, cx, conf_ref, conf_flags, app_flags))
+        return TRUE;
+
+    cx->blocked = FALSE; /* allow */
+
+    return FALSE;
+}
+
 inline static void fort_callout_ale_log(PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx,
-        PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags)
+        PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags, const PFORT_CACHE_KEY cache_key)
 {
     const FORT_APP_ENTRY app_data = fort_callout_ale_conf_app_data(cx, conf_ref);
 
-    if (fort_callout_ale_is_allowed(ca, cx, conf_ref, conf_flags, app_data)) {
+    const BOOL is_allowed = fort_callout_ale_is_allowed(ca, cx, conf_ref, conf_flags, app_data);
 
-        if (fort_callout_ale_process_flow(ca, cx, conf_ref, conf_flags, app_data.flags))
-            return;
-
-        cx->blocked = FALSE; /* allow */
+    /* Unknown apps have side effects: ask to connect, log the app path */
+    if (app_data.flags.v != 0) {
+        fort_callout_ale_cache_insert(cx, cache_key, /*decided=*/FALSE, /*blocked=*/!is_allowed);
     }
 
+    if (is_allowed && fort_callout_ale_log_allowed(ca, cx, conf_ref, conf_flags, app_data.flags))
+        return;
+
     fort_callout_ale_log_app_path(cx, conf_ref, conf_flags, app_data);
 }
 
+inline static BOOL fort_callout_ale_check_rules(
+        PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref)
+{
+    const FORT_CONF_RULE_CONN conn = {
+        .local_ip = fort_callout_ale_local_ip(ca),
+        .remote_ip = cx->remote_ip,
+        .local_port = ca->inFixedValues->incomingValue[ca->fi->localPort].value.uint16,
+        .remote_port = ca->inFixedValues->incomingValue[ca->fi->remotePort].value.uint16,
+        .ip_proto = ca->inFixedValues->incomingValue[ca->fi->ipProto].value.uint8,
+        .inbound = (UCHAR) ca->inbound,
+        .isIPv6 = (UCHAR) ca->isIPv6,
+    };
+
+    const PFORT_CONF_RULE rule = fort_conf_rules_find(&conf_ref->conf, &conn);
+    if (rule == NULL)
+        return FALSE;
+
+    if (rule->block) {
+        cx->block_reason = FORT_BLOCK_REASON_RULE;
+        return TRUE;
+    }
+
+    cx->rule_allowed = TRUE;
+
+    return FALSE;
+}
+
+typedef struct fort_callout_verdict_zones
+{
+    PFORT_DEVICE_CONF device_conf;
+
+    UINT32 matched_mask;
+} FORT_CALLOUT_VERDICT_ZONES, *PFORT_CALLOUT_VERDICT_ZONES;
+
+/* Collect the matched zones to count their hits by the kept verdict too */
+static BOOL fort_callout_verdict_zones_ip_included(PFORT_CALLOUT_VERDICT_ZONES verdict_zones,
+        UINT32 zones_mask, const UINT32 *remote_ip, BOOL isIPv6)
+{
+    const UINT32 matched_mask =
+            fort_conf_zones_ip_matched(verdict_zones->device_conf, zones_mask, remote_ip, isIPv6);
+
+    verdict_zones->matched_mask |= matched_mask;
+
+    return matched_mask != 0;
+}
+
+static UCHAR fort_callout_ale_ip_verdict(
+        PCFORT_CALLOUT_ARG ca, PCFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref)
+{
+    PFORT_HOST host = &fort_device()->host;
+
+    /* The IPv4 verdicts are kept until the conf or zones change */
+    UCHAR verdict = 0;
+    UINT32 zones_mask = 0;
+    if (!ca->isIPv6
+            && fort_host_verdict_get(
+                    host, *cx->remote_ip, cx->conf_generation, &verdict, &zones_mask)) {
+        fort_perf_zones_hit(&fort_device()->perf, zones_mask);
+        return verdict;
+    }
+
+    FORT_CALLOUT_VERDICT_ZONES verdict_zones = {
+        .device_conf = &fort_device()->conf,
+    };
+
+    if (fort_conf_ip_is_inet(&conf_ref->conf,
+                (fort_conf_zones_ip_included_func *) &fort_callout_verdict_zones_ip_included,
+                &verdict_zones, cx->remote_ip, ca->isIPv6)) {
+        verdict |= FORT_HOST_VERDICT_INET;
+
+        if (fort_conf_ip_inet_included(&conf_ref->conf,
+                    (fort_conf_zones_ip_included_func *) &fort_callout_verdict_zones_ip_included,
+                    &verdict_zones, cx->remote_ip, ca->isIPv6)) {
+            verdict |= FORT_HOST_VERDICT_INET_INCLUDED;
+        }
+    }
+
+    fort_perf_zones_hit(&fort_device()->perf, verdict_zones.matched_mask);
+
+    if (!ca->isIPv6) {
+        fort_host_verdict_set(host, *cx->remote_ip, cx->conf_generation, verdict,
+                verdict_zones.matched_mask);
+    }
+
+    return verdict;
+}
+
+/* Count the address groups' hits also by the cached verdicts */
+inline static void fort_callout_ale_addr_groups_hit(UCHAR ip_verdict)
+{
+    PFORT_PERF perf = &fort_device()->perf;
+
+    if ((ip_verdict & FORT_HOST_VERDICT_INET) != 0) {
+        fort_perf_addr_group_hit(perf, /*addr_group_index=*/0);
+    }
+
+    if ((ip_verdict & FORT_HOST_VERDICT_INET_INCLUDED) != 0) {
+        fort_perf_addr_group_hit(perf, /*addr_group_index=*/1);
+    }
+}
+
 inline static BOOL fort_callout_ale_check_filter_flags(PCFORT_CALLOUT_ARG ca,
         PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags)
 {
@@ -270,9 +602,19 @@ inline static BOOL fort_callout_ale_check_filter_flags(PCFORT_CALLOUT_ARG ca,
         return TRUE; /* block all */
     }
 
-    if (!fort_conf_ip_is_inet(&conf_ref->conf,
-                (fort_conf_zones_ip_included_func *) &fort_conf_zones_ip_included,
-                &fort_device()->conf, cx->remote_ip, ca->isIPv6)) {
+    if (fort_callout_ale_check_rules(ca, cx, conf_ref)) {
+        return TRUE; /* block by Rule */
+    }
+
+    if (cx->rule_allowed) {
+        return FALSE; /* allow by Rule, check the app */
+    }
+
+    const UCHAR ip_verdict = fort_callout_ale_ip_verdict(ca, cx, conf_ref);
+
+    fort_callout_ale_addr_groups_hit(ip_verdict);
+
+    if ((ip_verdict & FORT_HOST_VERDICT_INET) == 0) {
         cx->blocked = FALSE;
         return TRUE; /* allow LocalNetwork */
     }
@@ -281,9 +623,7 @@ inline static BOOL fort_callout_ale_check_filter_flags(PCFORT_CALLOUT_ARG ca,
         return TRUE; /* block Internet */
     }
 
-    if (!fort_conf_ip_inet_included(&conf_ref->conf,
-                (fort_conf_zones_ip_included_func *) &fort_conf_zones_ip_included,
-                &fort_device()->conf, cx->remote_ip, ca->isIPv6)) {
+    if ((ip_verdict & FORT_HOST_VERDICT_INET_INCLUDED) == 0) {
         cx->block_reason = FORT_BLOCK_REASON_IP_INET;
         return TRUE; /* block address */
     }
@@ -312,6 +652,8 @@ inline static void fort_callout_ale_classify_blocked(PCFORT_CALLOUT_ARG ca,
     /* Log the blocked connection */
     fort_callout_ale_log_blocked_ip(ca, cx, conf_ref, conf_flags);
 
+    fort_stat_proc_blocked(&fort_device()->stat, cx->process_id);
+
     if (cx->drop_blocked) {
         /* Drop the connection */
         fort_callout_classify_drop(ca->classifyOut);
@@ -324,6 +666,9 @@ inline static void fort_callout_ale_classify_blocked(PCFORT_CALLOUT_ARG ca,
 inline static void fort_callout_ale_classify_allowed(PCFORT_CALLOUT_ARG ca,
         PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags)
 {
+    /* Log the allowed connection */
+    fort_callout_ale_log_allowed_ip(ca, cx, conf_ref, conf_flags);
+
     if (cx->block_reason == FORT_BLOCK_REASON_NONE) {
         /* Continue the search */
         fort_callout_classify_continue(ca->classifyOut);
@@ -333,6 +678,87 @@ inline static void fort_callout_ale_classify_allowed(PCFORT_CALLOUT_ARG ca,
     }
 }
 
+/* The local address and port are ephemeral, so they're keyed only when the rules match them */
+inline static void fort_callout_ale_cache_key(PCFORT_CALLOUT_ARG ca, PCFORT_CALLOUT_ALE_EXTRA cx,
+        PFORT_CONF_REF conf_ref, PFORT_CACHE_KEY cache_key)
+{
+    RtlZeroMemory(cache_key, sizeof(FORT_CACHE_KEY));
+
+    cache_key->process_id = cx->process_id;
+    cache_key->path_hash = cx->path_hash;
+    cache_key->path_len = cx->path->Length;
+
+    const UINT32 ip_size = ca->isIPv6 ? sizeof(ip6_addr_t) : 4;
+
+    RtlCopyMemory(cache_key->remote_ip, cx->remote_ip, ip_size);
+
+    if (fort_conf_rules_has_locals(&conf_ref->conf)) {
+        RtlCopyMemory(cache_key->local_ip, fort_callout_ale_local_ip(ca), ip_size);
+
+        cache_key->local_port = ca->inFixedValues->incomingValue[ca->fi->localPort].value.uint16;
+    }
+
+    cache_key->remote_port = ca->inFixedValues->incomingValue[ca->fi->remotePort].value.uint16;
+    cache_key->ip_proto = ca->inFixedValues->incomingValue[ca->fi->ipProto].value.uint8;
+    cache_key->inbound = ca->inbound;
+    cache_key->isIPv6 = ca->isIPv6;
+}
+
+inline static BOOL fort_callout_ale_check_cache(PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx,
+        PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags, const PFORT_CACHE_KEY cache_key)
+{
+    FORT_CACHE_VERDICT verdict;
+    if (!fort_cache_lookup(&fort_device()->cache, cache_key, cx->conf_generation, &verdict))
+        return FALSE;
+
+    cx->blocked = verdict.blocked;
+    cx->block_reason = verdict.block_reason;
+
+    if (!verdict.decided) {
+        fort_callout_ale_set_app_flags(cx, verdict.app_data);
+
+        if (!verdict.blocked) {
+            cx->blocked = (UCHAR) conf_flags.filter_enabled; /* as before the flow processing */
+
+            fort_callout_ale_log_allowed(ca, cx, conf_ref, conf_flags, verdict.app_data.flags);
+        }
+    }
+
+    return TRUE;
+}
+
+inline static void fort_callout_ale_check_verdict(PCFORT_CALLOUT_ARG ca,
+        PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref, FORT_CONF_FLAGS conf_flags,
+        const PFORT_CACHE_KEY cache_key)
+{
+    if (fort_callout_ale_check_flags(ca, cx, conf_ref, conf_flags)) {
+        fort_callout_ale_cache_insert(cx, cache_key, /*decided=*/TRUE, cx->blocked);
+    } else {
+        fort_callout_ale_log(ca, cx, conf_ref, conf_flags, cache_key);
+    }
+}
+
+#if !defined(FORT_WIN7_COMPAT)
+inline static void fort_callout_ale_check_service_tag(
+        PCFORT_CALLOUT_ARG ca, PFORT_PSTREE ps_tree, PUNICODE_STRING path)
+{
+    if (!FWPS_IS_METADATA_FIELD_PRESENT(ca->inMetaValues, FWPS_METADATA_FIELD_SUB_PROCESS_TAG))
+        return;
+
+    const UINT32 service_tag = (UINT32) (UINT_PTR) ca->inMetaValues->subProcessTag;
+    if (service_tag == 0)
+        return;
+
+    UNICODE_STRING serviceName;
+    if (!fort_pstree_get_service_name(ps_tree, service_tag, &serviceName))
+        return;
+
+    fort_pstree_put_proc_name(ps_tree, path);
+
+    *path = serviceName;
+}
+#endif
+
 inline static void fort_callout_ale_check_conf(
         PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx, PFORT_CONF_REF conf_ref)
 {
@@ -346,23 +772,28 @@ inline static void fort_callout_ale_check_conf(
     real_path.MaximumLength = real_path.Length;
     real_path.Buffer = (PWSTR) ca->inMetaValues->processPath->data;
 
+    PFORT_PSTREE ps_tree = &fort_device()->ps_tree;
+
     BOOL isSvcHost = FALSE;
     BOOL inherited = FALSE;
     UNICODE_STRING path;
-    if (!fort_pstree_get_proc_name(
-                &fort_device()->ps_tree, process_id, &path, &isSvcHost, &inherited)) {
+    const BOOL is_proc_name =
+            fort_pstree_get_proc_name(ps_tree, process_id, &path, &isSvcHost, &inherited);
+    if (!is_proc_name) {
         path = real_path;
     } else if (!inherited) {
-        /* TODO: Check "ServiceTag" on Windows 10+ */
-#if 0 // !defined(FORT_WIN7_COMPAT)
-        PVOID subProcessTag = ca->inMetaValues->subProcessTag;
-        if (subProcessTag && isSvcHost) { }
+#if !defined(FORT_WIN7_COMPAT)
+        /* The shared svchost's connection is made by the service of the thread's tag */
+        if (isSvcHost) {
+            fort_callout_ale_check_service_tag(ca, ps_tree, &path);
+        }
 #endif
 
         real_path = path;
     }
 
     cx->process_id = process_id;
+    cx->path_hash = fort_conf_app_path_hash(path.Buffer, path.Length); /* also of the exe lookup */
     cx->path = &path;
     cx->real_path = &real_path;
     cx->inherited = (UCHAR) inherited;
@@ -370,8 +801,11 @@ inline static void fort_callout_ale_check_conf(
     cx->blocked = TRUE;
     cx->block_reason = FORT_BLOCK_REASON_UNKNOWN;
 
-    if (!fort_callout_ale_check_flags(ca, cx, conf_ref, conf_flags)) {
-        fort_callout_ale_log(ca, cx, conf_ref, conf_flags);
+    FORT_CACHE_KEY cache_key;
+    fort_callout_ale_cache_key(ca, cx, conf_ref, &cache_key);
+
+    if (!fort_callout_ale_check_cache(ca, cx, conf_ref, conf_flags, &cache_key)) {
+        fort_callout_ale_check_verdict(ca, cx, conf_ref, conf_flags, &cache_key);
     }
 
     if (cx->blocked) {
@@ -379,11 +813,18 @@ inline static void fort_callout_ale_check_conf(
     } else {
         fort_callout_ale_classify_allowed(ca, cx, conf_ref, conf_flags);
     }
+
+    if (is_proc_name) {
+        fort_pstree_put_proc_name(ps_tree, &path);
+    }
 }
 
 inline static void fort_callout_ale_by_conf(
         PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx, PFORT_DEVICE_CONF device_conf)
 {
+    /* Read before the conf is taken, so a concurrent update invalidates the cached verdict */
+    cx->conf_generation = device_conf->generation;
+
     PFORT_CONF_REF conf_ref = fort_conf_ref_take(device_conf);
 
     if (conf_ref == NULL) {
@@ -414,7 +855,8 @@ inline static BOOL fort_callout_ale_is_local_address(PFORT_CALLOUT_ARG ca,
         return FALSE;
 
     return ((classify_flags & FWP_CONDITION_FLAG_IS_LOOPBACK) != 0
-            || fort_addr_is_local_broadcast(cx->remote_ip, ca->isIPv6));
+            || fort_addr_is_local_broadcast(cx->remote_ip, ca->isIPv6)
+            || fort_host_is_local_ip(&fort_device()->host, cx->remote_ip, ca->isIPv6));
 }
 
 static void fort_callout_ale_classify(PFORT_CALLOUT_ARG ca)
@@ -444,6 +886,13 @@ static void fort_callout_ale_classify(PFORT_CALLOUT_ARG ca)
         return;
     }
 
+    /* Drop the flood of inbound connections before the conf's checks */
+    if (ca->inbound && !is_reauth
+            && fort_rate_accept_exceeded(&fort_device()->rate, remote_ip, ca->isIPv6)) {
+        fort_callout_classify_drop(ca->classifyOut);
+        return;
+    }
+
     fort_callout_ale_by_conf(ca, &cx, device_conf);
 }
 
@@ -464,7 +913,15 @@ inline static void fort_callout_ale_classify_v(const FWPS_INCOMING_VALUES0 *inFi
         .isIPv6 = isIPv6,
     };
 
+    const INT64 begin_ticks = fort_perf_ticks();
+
     fort_callout_ale_classify(&ca);
+
+    fort_perf_ale_classify_add(
+            &fort_device()->perf, begin_ticks, inbound, isIPv6, classifyOut->actionType);
+
+    fort_etw_ale_classify(
+            inbound, isIPv6, classifyOut->actionType, fort_perf_ticks() - begin_ticks);
 }
 
 static void NTAPI fort_callout_connect_v4(const FWPS_INCOMING_VALUES0 *inFixedValues,
@@ -478,6 +935,7 @@ static void NTAPI fort_callout_connect_v4(const FWPS_INCOMING_VALUES0 *inFixedVa
         .localPort = FWPS_FIELD_ALE_AUTH_CONNECT_V4_IP_LOCAL_PORT,
         .remotePort = FWPS_FIELD_ALE_AUTH_CONNECT_V4_IP_REMOTE_PORT,
         .ipProto = FWPS_FIELD_ALE_AUTH_CONNECT_V4_IP_PROTOCOL,
+        .destAddrType = FWPS_FIELD_ALE_AUTH_CONNECT_V4_IP_DESTINATION_ADDRESS_TYPE,
     };
 
     fort_callout_ale_classify_v(inFixedValues, inMetaValues, layerData, filter, flowContext,
@@ -495,6 +953,7 @@ static void NTAPI fort_callout_connect_v6(const FWPS_INCOMING_VALUES0 *inFixedVa
         .localPort = FWPS_FIELD_ALE_AUTH_CONNECT_V6_IP_LOCAL_PORT,
         .remotePort = FWPS_FIELD_ALE_AUTH_CONNECT_V6_IP_REMOTE_PORT,
         .ipProto = FWPS_FIELD_ALE_AUTH_CONNECT_V6_IP_PROTOCOL,
+        .destAddrType = FWPS_FIELD_ALE_AUTH_CONNECT_V6_IP_DESTINATION_ADDRESS_TYPE,
     };
 
     fort_callout_ale_classify_v(inFixedValues, inMetaValues, layerData, filter, flowContext,
@@ -512,6 +971,7 @@ static void NTAPI fort_callout_accept_v4(const FWPS_INCOMING_VALUES0 *inFixedVal
         .localPort = FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_IP_LOCAL_PORT,
         .remotePort = FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_IP_REMOTE_PORT,
         .ipProto = FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_IP_PROTOCOL,
+        .destAddrType = FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_IP_LOCAL_ADDRESS_TYPE,
     };
 
     fort_callout_ale_classify_v(inFixedValues, inMetaValues, layerData, filter, flowContext,
@@ -529,6 +989,7 @@ static void NTAPI fort_callout_accept_v6(const FWPS_INCOMING_VALUES0 *inFixedVal
         .localPort = FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V6_IP_LOCAL_PORT,
         .remotePort = FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V6_IP_REMOTE_PORT,
         .ipProto = FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V6_IP_PROTOCOL,
+        .destAddrType = FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V6_IP_LOCAL_ADDRESS_TYPE,
     };
 
     fort_callout_ale_classify_v(inFixedValues, inMetaValues, layerData, filter, flowContext,
@@ -913,8 +1374,37 @@ inline static NTSTATUS fort_callout_force_reauth_prov_recreate(HANDLE engine,
     return status;
 }
 
-inline static NTSTATUS fort_callout_force_reauth_prov_filters(
-        HANDLE engine, const FORT_CONF_FLAGS old_conf_flags, const FORT_CONF_FLAGS conf_flags)
+inline static NTSTATUS fort_callout_force_reauth_prov_addr_filters(
+        HANDLE engine, const FORT_CONF_FLAGS conf_flags)
+{
+    /* The address lists may be changed by conf */
+    fort_prov_addr_unregister(engine);
+
+    PFORT_CONF_REF conf_ref = fort_conf_ref_take(&fort_device()->conf);
+    if (conf_ref == NULL)
+        return STATUS_SUCCESS;
+
+    NTSTATUS status = STATUS_SUCCESS;
+
+    if (fort_prov_addr_enabled(&conf_ref->conf, conf_flags)) {
+        PFORT_PROV_ADDR_BUF buf = fort_mem_type_alloc(FORT_MEM_CONF, sizeof(FORT_PROV_ADDR_BUF));
+
+        if (buf == NULL) {
+            status = STATUS_INSUFFICIENT_RESOURCES;
+        } else {
+            status = fort_prov_addr_register(engine, &conf_ref->conf, buf);
+
+            fort_mem_type_free(FORT_MEM_CONF, buf);
+        }
+    }
+
+    fort_conf_ref_put(&fort_device()->conf, conf_ref);
+
+    return status;
+}
+
+inline static NTSTATUS fort_callout_force_reauth_prov_filters(HANDLE engine,
+        const FORT_CONF_FLAGS old_conf_flags, const FORT_CONF_FLAGS conf_flags, BOOL reauth_flows)
 {
     NTSTATUS status;
 
@@ -931,14 +1421,21 @@ inline static NTSTATUS fort_callout_force_reauth_prov_filters(
     if (status != 0)
         return status;
 
+    /* Check address filters */
+    status = fort_callout_force_reauth_prov_addr_filters(engine, conf_flags);
+    if (status != 0)
+        return status;
+
     /* Force reauth filter */
-    fort_prov_reauth(engine);
+    if (reauth_flows) {
+        fort_prov_reauth(engine);
+    }
 
     return STATUS_SUCCESS;
 }
 
 inline static NTSTATUS fort_callout_force_reauth_prov(
-        const FORT_CONF_FLAGS old_conf_flags, const FORT_CONF_FLAGS conf_flags)
+        const FORT_CONF_FLAGS old_conf_flags, const FORT_CONF_FLAGS conf_flags, BOOL reauth_flows)
 {
     NTSTATUS status;
 
@@ -947,12 +1444,43 @@ inline static NTSTATUS fort_callout_force_reauth_prov(
     if (!NT_SUCCESS(status))
         return status;
 
-    status = fort_callout_force_reauth_prov_filters(engine, old_conf_flags, conf_flags);
+    status = fort_callout_force_reauth_prov_filters(
+            engine, old_conf_flags, conf_flags, reauth_flows);
 
     return fort_prov_trans_close(engine, status);
 }
 
-FORT_API NTSTATUS fort_callout_force_reauth(const FORT_CONF_FLAGS old_conf_flags)
+/* The WFP reauth is global, so skip it when the changed groups have no live flows */
+static BOOL fort_callout_reauth_flows_check(const FORT_CONF_FLAGS old_conf_flags,
+        const FORT_CONF_FLAGS conf_flags, UINT32 changed_groups)
+{
+    if (changed_groups == FORT_CALLOUT_REAUTH_ALL)
+        return TRUE;
+
+    /* Other flags change the verdicts of all flows */
+    FORT_CONF_FLAGS flags = old_conf_flags;
+    flags.group_bits = conf_flags.group_bits;
+
+    if (!RtlEqualMemory(&flags, &conf_flags, sizeof(FORT_CONF_FLAGS)))
+        return TRUE;
+
+    changed_groups |= (old_conf_flags.group_bits ^ conf_flags.group_bits);
+    if (changed_groups == 0)
+        return FALSE;
+
+    /* The flow filters depend on the speed limited groups */
+    if ((changed_groups & fort_device()->stat.conf_group.limit_bits) != 0)
+        return TRUE;
+
+    /* Only the flows of the logged stat are known, the asked connections wait for reauth */
+    if (!conf_flags.log_stat || fort_device()->pending.proc_count != 0)
+        return TRUE;
+
+    return (fort_stat_flows_group_bits(&fort_device()->stat) & changed_groups) != 0;
+}
+
+FORT_API NTSTATUS fort_callout_force_reauth(
+        const FORT_CONF_FLAGS old_conf_flags, UINT32 changed_groups)
 {
     FORT_CHECK_STACK(FORT_CALLOUT_FORCE_REAUTH);
 
@@ -960,11 +1488,11 @@ FORT_API NTSTATUS fort_callout_force_reauth(const FORT_CONF_FLAGS old_conf_flags
 
     /* Check app group periods & update group_bits */
     {
-        int periods_n = 0;
+        ULONG next_msec;
 
-        fort_conf_ref_period_update(&fort_device()->conf, /*force=*/TRUE, &periods_n);
+        fort_conf_ref_period_update(&fort_device()->conf, /*force=*/TRUE, &next_msec);
 
-        fort_timer_set_running(&fort_device()->app_timer, /*run=*/(periods_n != 0));
+        fort_timer_restart(&fort_device()->app_timer, next_msec);
     }
 
     const FORT_CONF_FLAGS conf_flags = fort_device()->conf.conf_flags;
@@ -976,7 +1504,14 @@ FORT_API NTSTATUS fort_callout_force_reauth(const FORT_CONF_FLAGS old_conf_flags
     fort_timer_set_running(&fort_device()->log_timer, /*run=*/conf_flags.log_stat);
 
     /* Reauth provider filters */
-    status = fort_callout_force_reauth_prov(old_conf_flags, conf_flags);
+    const BOOL reauth_flows =
+            fort_callout_reauth_flows_check(old_conf_flags, conf_flags, changed_groups);
+
+    if (reauth_flows) {
+        fort_stat_untracked_group_bits_clear(&fort_device()->stat);
+    }
+
+    status = fort_callout_force_reauth_prov(old_conf_flags, conf_flags, reauth_flows);
 
     if (!NT_SUCCESS(status)) {
         LOG("Callout Reauth: Error: %x\n", status);
@@ -998,7 +1533,8 @@ inline static void fort_callout_update_system_time(
     stat->system_time = system_time;
 
     PCHAR out;
-    if (NT_SUCCESS(fort_buffer_prepare(buf, FORT_LOG_TIME_SIZE, &out, irp, info))) {
+    if (NT_SUCCESS(fort_buffer_prepare(
+                buf, FORT_LOG_TYPE_TIME, FORT_LOG_TIME_SIZE, &out, irp, info))) {
         const INT64 unix_time = fort_system_to_unix_time(system_time.QuadPart);
 
         const UCHAR old_stat_flags =
@@ -1012,27 +1548,125 @@ inline static void fort_callout_update_system_time(
 inline static void fort_callout_flush_stat_traf(
         PFORT_STAT stat, PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info)
 {
+    const BOOL compact = (fort_stat_flags(stat) & FORT_STAT_TRAF_COMPACT) != 0;
+    const UINT16 buffer_proc_count = FORT_LOG_STAT_BUFFER_PROC_COUNT(compact, /*conns=*/TRUE);
+
     while (stat->proc_active_count != 0) {
-        const UINT16 proc_count = (stat->proc_active_count < FORT_LOG_STAT_BUFFER_PROC_COUNT)
+        const UINT16 proc_count = (stat->proc_active_count < buffer_proc_count)
                 ? stat->proc_active_count
-                : FORT_LOG_STAT_BUFFER_PROC_COUNT;
-        const UINT32 len = FORT_LOG_STAT_SIZE(proc_count);
+                : buffer_proc_count;
+        const UINT32 len = FORT_LOG_STAT_SIZE(proc_count, compact, /*conns=*/TRUE);
         PCHAR out;
 
-        const NTSTATUS status = fort_buffer_prepare(buf, len, &out, irp, info);
+        const NTSTATUS status =
+                fort_buffer_prepare(buf, FORT_LOG_TYPE_STAT_TRAF, len, &out, irp, info);
         if (!NT_SUCCESS(status)) {
             LOG("Callout Timer: Error: %x\n", status);
             TRACE(FORT_CALLOUT_CALLOUT_TIMER_ERROR, status, 0, 0);
             break;
         }
 
-        fort_log_stat_traf_header_write(out, proc_count);
+        fort_log_stat_traf_header_write(out, proc_count, compact, /*conns=*/TRUE);
         out += FORT_LOG_STAT_HEADER_SIZE;
 
         fort_stat_traf_flush(stat, proc_count, out);
     }
 }
 
+inline static void fort_callout_flush_stat_flow_traf(
+        PFORT_STAT stat, PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info)
+{
+    while (stat->flow_active_count != 0) {
+        const UINT16 flow_count =
+                (stat->flow_active_count < FORT_LOG_FLOW_STAT_BUFFER_FLOW_COUNT)
+                ? (UINT16) stat->flow_active_count
+                : FORT_LOG_FLOW_STAT_BUFFER_FLOW_COUNT;
+        const UINT32 len = FORT_LOG_FLOW_STAT_SIZE(flow_count);
+        PCHAR out;
+
+        const NTSTATUS status =
+                fort_buffer_prepare(buf, FORT_LOG_TYPE_FLOW_STAT, len, &out, irp, info);
+        if (!NT_SUCCESS(status)) {
+            LOG("Callout Timer: Error: %x\n", status);
+            TRACE(FORT_CALLOUT_CALLOUT_TIMER_ERROR, status, 0, 0);
+            break;
+        }
+
+        fort_log_flow_stat_header_write(out, flow_count);
+        out += FORT_LOG_FLOW_STAT_HEADER_SIZE;
+
+        fort_stat_flow_traf_flush(stat, flow_count, out);
+    }
+}
+
+inline static void fort_callout_flush_shaper_stat(
+        PFORT_SHAPER shaper, PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info)
+{
+    UINT32 group_io_bits = fort_shaper_group_io_bits(shaper);
+
+    for (int i = 0; group_io_bits != 0; ++i) {
+        const BOOL queue_exists = (group_io_bits & 1) != 0;
+        group_io_bits >>= 1;
+
+        if (!queue_exists)
+            continue;
+
+        FORT_SHAPER_STAT shaper_stat;
+        UINT32 sojourn_max_ms;
+        if (!fort_shaper_queue_stat_flush(shaper, i, &shaper_stat, &sojourn_max_ms))
+            continue;
+
+        PCHAR out;
+        const NTSTATUS status = fort_buffer_prepare(
+                buf, FORT_LOG_TYPE_SHAPER_STAT, FORT_LOG_SHAPER_STAT_SIZE, &out, irp, info);
+        if (!NT_SUCCESS(status)) {
+            LOG("Callout Timer: Error: %x\n", status);
+            TRACE(FORT_CALLOUT_CALLOUT_TIMER_ERROR, status, 0, 0);
+            break;
+        }
+
+        fort_log_shaper_stat_write(out, (UCHAR) i, sojourn_max_ms, &shaper_stat);
+    }
+}
+
+inline static void fort_callout_flush_quota(
+        PFORT_BUFFER buf, UCHAR quota_bits, PIRP *irp, ULONG_PTR *info)
+{
+    if (quota_bits == 0)
+        return;
+
+    PCHAR out;
+    const NTSTATUS status =
+            fort_buffer_prepare(buf, FORT_LOG_TYPE_QUOTA, FORT_LOG_QUOTA_SIZE, &out, irp, info);
+    if (!NT_SUCCESS(status)) {
+        LOG("Callout Timer: Error: %x\n", status);
+        TRACE(FORT_CALLOUT_CALLOUT_TIMER_ERROR, status, 0, 0);
+        return;
+    }
+
+    fort_log_quota_write(out, quota_bits);
+}
+
+static ULONG fort_callout_timer_period(PFORT_STAT stat, PFORT_BUFFER buf, BOOL is_idle)
+{
+    if ((fort_stat_flags(stat) & FORT_STAT_LIVE) != 0)
+        return FORT_CALLOUT_TIMER_PERIOD_FAST;
+
+    PFORT_BUFFER_DATA data = buf->data_head;
+
+    if (data == NULL || data->top == 0)
+        return is_idle ? FORT_CALLOUT_TIMER_PERIOD_IDLE : FORT_CALLOUT_TIMER_PERIOD;
+
+    /* Flush faster, when the log buffers are queued */
+    for (int i = 1; i < FORT_CALLOUT_TIMER_FAST_BUFFERS; ++i) {
+        data = data->next;
+        if (data == NULL)
+            return FORT_CALLOUT_TIMER_PERIOD;
+    }
+
+    return FORT_CALLOUT_TIMER_PERIOD_FAST;
+}
+
 FORT_API void fort_callout_timer(void)
 {
     FORT_CHECK_STACK(FORT_CALLOUT_TIMER);
@@ -1043,6 +1677,9 @@ FORT_API void fort_callout_timer(void)
     PIRP irp = NULL;
     ULONG_PTR info;
 
+    /* Complete the timed out asks before the locks, they're classified again */
+    fort_pending_expire(&fort_device()->pending);
+
     /* Lock buffer */
     KLOCK_QUEUE_HANDLE buf_lock_queue;
     fort_buffer_dpc_begin(buf, &buf_lock_queue);
@@ -1054,20 +1691,58 @@ FORT_API void fort_callout_timer(void)
     /* Get current Unix time */
     fort_callout_update_system_time(stat, buf, &irp, &info);
 
+    /* Collect the traffic of processors */
+    fort_stat_traf_fold(stat);
+
+    /* Check the traffic quotas */
+    const UCHAR quota_bits = fort_stat_quota_check(stat);
+    const BOOL quota_block = (quota_bits != 0 && stat->quota.block_inet);
+
+    /* No traffic since the last tick */
+    const BOOL is_idle = (stat->proc_active_count == 0 && stat->flow_active_count == 0);
+
     /* Flush traffic statistics */
     fort_callout_flush_stat_traf(stat, buf, &irp, &info);
 
+    /* Flush flows' traffic statistics */
+    fort_callout_flush_stat_flow_traf(stat, buf, &irp, &info);
+
     /* Unlock stat */
     fort_stat_dpc_end(&stat_lock_queue);
 
+    /* Flush the shaper's queues' telemetry */
+    fort_callout_flush_shaper_stat(&fort_device()->shaper, buf, &irp, &info);
+
+    /* Report the exceeded quotas */
+    fort_callout_flush_quota(buf, quota_bits, &irp, &info);
+
+    /* Flush the coalesced blocked connections of the ended windows */
+    fort_buffer_repeats_flush(buf, &irp, &info);
+
+    /* Summarize the inbound connections, dropped by the rate limit */
+    fort_rate_summary_flush(&fort_device()->rate, buf, &irp, &info);
+
+    /* Report the dropped records */
+    fort_buffer_drops_flush(buf, &irp, &info);
+
     /* Flush pending buffer */
     if (irp == NULL) {
         fort_buffer_flush_pending(buf, &irp, &info);
     }
 
+    /* Adapt the timer period to the remaining work */
+    const ULONG period = fort_callout_timer_period(stat, buf, is_idle);
+
     /* Unlock buffer */
     fort_buffer_dpc_end(&buf_lock_queue);
 
+    fort_timer_set_period(&fort_device()->log_timer, period);
+
+    /* Block the internet traffic at PASSIVE_LEVEL */
+    if (quota_block) {
+        fort_worker_queue(&fort_device()->worker, FORT_WORKER_QUOTA);
+    }
+
     if (irp != NULL) {
         fort_buffer_irp_clear_pending(irp);
         fort_request_complete_info(irp, STATUS_SUCCESS, info);
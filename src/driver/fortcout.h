@@ -5,6 +5,15 @@
 
 #include "common/fortconf.h"
 
+#define FORT_CALLOUT_REAUTH_ALL ((UINT32) -1) /* changed groups are unknown */
+
+/* Log timer periods in milliseconds */
+#define FORT_CALLOUT_TIMER_PERIOD      500
+#define FORT_CALLOUT_TIMER_PERIOD_FAST 100 /* live traffic or the log buffer is filling */
+#define FORT_CALLOUT_TIMER_PERIOD_IDLE 4000 /* no traffic and no pending log data */
+
+#define FORT_CALLOUT_TIMER_FAST_BUFFERS 2 /* queued log buffers to flush faster */
+
 #if defined(__cplusplus)
 extern "C" {
 #endif
@@ -13,7 +22,8 @@ FORT_API NTSTATUS fort_callout_install(PDEVICE_OBJECT device);
 
 FORT_API void fort_callout_remove(void);
 
-FORT_API NTSTATUS fort_callout_force_reauth(const FORT_CONF_FLAGS old_conf_flags);
+FORT_API NTSTATUS fort_callout_force_reauth(
+        const FORT_CONF_FLAGS old_conf_flags, UINT32 changed_groups);
 
 FORT_API void fort_callout_timer(void);
 
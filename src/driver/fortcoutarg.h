@@ -14,6 +14,7 @@ typedef struct fort_callout_field_index
     UCHAR remotePort;
     UCHAR ipProto;
     UCHAR direction; /* used by DATAGRAM only */
+    UCHAR destAddrType; /* used by ALE only */
 } FORT_CALLOUT_FIELD_INDEX, *PFORT_CALLOUT_FIELD_INDEX;
 
 typedef const FORT_CALLOUT_FIELD_INDEX *PCFORT_CALLOUT_FIELD_INDEX;
@@ -45,11 +46,15 @@ typedef struct fort_callout_ale_extra
     UCHAR inherited : 1;
     UCHAR drop_blocked : 1;
     UCHAR blocked : 1;
+    UCHAR rule_allowed : 1;
     INT8 block_reason;
 
     FORT_APP_ENTRY app_data;
 
+    LONG conf_generation;
+
     UINT32 process_id;
+    UINT32 path_hash;
 
     const UINT32 *remote_ip;
 
@@ -7,12 +7,18 @@
 
 #include "fortcout.h"
 #include "fortdbg.h"
+#include "fortetw.h"
+#include "fortmem.h"
 #include "fortpkt.h"
 #include "fortps.h"
 #include "fortscb.h"
 #include "forttrace.h"
 #include "fortutl.h"
 
+#define FORT_DEVICE_POOL_TAG 'DwfF'
+
+#define FORT_DEVICE_CONF_CACHE_PATH L"\\SystemRoot\\System32\\drivers\\" FORT_CONF_CACHE_FILE
+
 static PFORT_DEVICE g_device = NULL;
 
 FORT_API PFORT_DEVICE fort_device(void)
@@ -25,34 +31,101 @@ FORT_API void fort_device_set(PFORT_DEVICE device)
     g_device = device;
 }
 
-static NTSTATUS fort_device_reauth_force(const FORT_CONF_FLAGS old_conf_flags)
+static NTSTATUS fort_device_reauth_groups(
+        const FORT_CONF_FLAGS old_conf_flags, UINT32 changed_groups)
 {
     PEX_RUNDOWN_REF reauth_rundown = &fort_device()->reauth_rundown;
     ExAcquireRundownProtection(reauth_rundown);
 
-    const NTSTATUS status = fort_callout_force_reauth(old_conf_flags);
+    const NTSTATUS status = fort_callout_force_reauth(old_conf_flags, changed_groups);
 
     ExReleaseRundownProtection(reauth_rundown);
 
     return status;
 }
 
+static NTSTATUS fort_device_reauth_force(const FORT_CONF_FLAGS old_conf_flags)
+{
+    return fort_device_reauth_groups(old_conf_flags, FORT_CALLOUT_REAUTH_ALL);
+}
+
 static void fort_device_reauth(void)
 {
     const FORT_CONF_FLAGS conf_flags = fort_device()->conf.conf_flags;
 
-    fort_device_reauth_force(conf_flags);
+    const UINT32 changed_groups = (UINT32) InterlockedExchange(&fort_device()->reauth_groups, 0);
+
+    fort_device_reauth_groups(conf_flags, changed_groups);
 }
 
-static void fort_device_reauth_queue(void)
+/* The changed groups are accumulated till the worker runs */
+static void fort_device_reauth_queue_groups(UINT32 changed_groups)
 {
+    InterlockedOr(&fort_device()->reauth_groups, (LONG) changed_groups);
+
     fort_worker_queue(&fort_device()->worker, FORT_WORKER_REAUTH);
 }
 
+static void fort_device_reauth_queue(void)
+{
+    fort_device_reauth_queue_groups(FORT_CALLOUT_REAUTH_ALL);
+}
+
+/* Release the pools, emptied by the deleted apps and the exited processes */
+static void fort_device_trim(void)
+{
+    PFORT_CONF_REF conf_ref = fort_conf_ref_take(&fort_device()->conf);
+
+    if (conf_ref != NULL) {
+        fort_conf_ref_trim(conf_ref);
+
+        fort_conf_ref_put(&fort_device()->conf, conf_ref);
+    }
+
+    fort_pstree_trim(&fort_device()->ps_tree);
+}
+
+static NTSTATUS fort_device_flags_set(const PFORT_CONF_FLAGS conf_flags)
+{
+    const FORT_CONF_FLAGS old_conf_flags =
+            fort_conf_ref_flags_set(&fort_device()->conf, conf_flags);
+
+    fort_stat_conf_flags_update(&fort_device()->stat, conf_flags);
+    fort_shaper_conf_flags_update(&fort_device()->shaper, conf_flags);
+
+    /* The changed group bits are checked against the live flows */
+    return fort_device_reauth_groups(old_conf_flags, /*changed_groups=*/0);
+}
+
+/* Block the internet traffic on the exceeded quota, the service is notified by the log */
+static void fort_device_quota_block(void)
+{
+    FORT_CONF_FLAGS conf_flags = fort_device()->conf.conf_flags;
+
+    if (conf_flags.block_inet_traffic)
+        return;
+
+    conf_flags.block_inet_traffic = TRUE;
+
+    fort_device_flags_set(&conf_flags);
+}
+
 static void fort_app_period_timer(void)
 {
-    if (fort_conf_ref_period_update(&fort_device()->conf, /*force=*/FALSE, /*periods_n=*/NULL)) {
-        fort_device_reauth_queue();
+    ULONG next_msec;
+
+    const UINT16 old_group_bits = (UINT16) fort_device()->conf.conf_flags.group_bits;
+
+    const BOOL res =
+            fort_conf_ref_period_update(&fort_device()->conf, /*force=*/FALSE, &next_msec);
+
+    /* Wake up at the next period boundary or full hour */
+    fort_timer_restart(&fort_device()->app_timer, next_msec);
+
+    if (res) {
+        const UINT16 group_bits = (UINT16) fort_device()->conf.conf_flags.group_bits;
+
+        fort_device_reauth_queue_groups(old_group_bits ^ group_bits);
     }
 }
 
@@ -113,16 +186,22 @@ FORT_API NTSTATUS fort_device_cleanup(PDEVICE_OBJECT device, PIRP irp)
         const FORT_CONF_FLAGS old_conf_flags = fort_conf_ref_set(&fort_device()->conf, NULL);
         FORT_CONF_FLAGS conf_flags = fort_device()->conf.conf_flags;
 
-        fort_conf_zones_set(&fort_device()->conf, NULL);
+        fort_conf_zones_set(&fort_device()->conf, NULL, 0);
 
         fort_stat_conf_flags_update(&fort_device()->stat, &conf_flags);
 
         fort_device_reauth_force(old_conf_flags);
     }
 
+    /* Stop showing live traffic */
+    fort_stat_flags_set(&fort_device()->stat, FORT_STAT_LIVE, FALSE);
+
     /* Clear pending packets */
     fort_pending_clear(&fort_device()->pending);
 
+    /* Unlock the log ring's pages, while in the service's context */
+    fort_buffer_ring_close(&fort_device()->buffer);
+
     /* Clear buffer */
     fort_buffer_clear(&fort_device()->buffer);
 
@@ -135,6 +214,9 @@ static NTSTATUS fort_device_control_validate(const PFORT_CONF_VERSION conf_ver,
 {
     if (len == sizeof(FORT_CONF_VERSION)) {
         if (conf_ver->driver_version == DRIVER_VERSION) {
+            fort_stat_flags_set(
+                    &fort_device()->stat, FORT_STAT_TRAF_COMPACT, conf_ver->compact_traf);
+
             fort_device_flag_set(&fort_device()->conf, FORT_DEVICE_IS_VALIDATED, TRUE);
             return STATUS_SUCCESS;
         }
@@ -155,38 +237,125 @@ static NTSTATUS fort_device_control_setservices(const PFORT_SERVICE_INFO_LIST se
     return STATUS_UNSUCCESSFUL;
 }
 
-static NTSTATUS fort_device_control_setconf(const PFORT_CONF_IO conf_io, ULONG len)
+static PVOID fort_device_irp_mdl_buffer(PIRP irp)
 {
-    if (len > sizeof(FORT_CONF_IO)) {
-        const PFORT_CONF conf = &conf_io->conf;
-        PFORT_CONF_REF conf_ref = fort_conf_ref_new(conf, len - FORT_CONF_IO_CONF_OFF);
+    PMDL mdl = irp->MdlAddress;
 
-        if (conf_ref == NULL) {
-            return STATUS_INSUFFICIENT_RESOURCES;
-        } else {
-            const FORT_CONF_FLAGS old_conf_flags =
-                    fort_conf_ref_set(&fort_device()->conf, conf_ref);
+    return (mdl != NULL)
+            ? MmGetSystemAddressForMdlSafe(mdl, NormalPagePriority | MdlMappingNoExecute)
+            : NULL;
+}
 
-            fort_stat_conf_update(&fort_device()->stat, conf_io);
-            fort_shaper_conf_update(&fort_device()->shaper, conf_io);
+static FORT_CONF_FLAGS fort_device_conf_ref_set(
+        PFORT_CONF_REF conf_ref, const PFORT_CONF_GROUP conf_group)
+{
+    const FORT_CONF_FLAGS conf_flags = conf_ref->conf.flags;
 
-            return fort_device_reauth_force(old_conf_flags);
-        }
+    fort_mem_conf_update(&conf_ref->conf);
+
+    fort_pending_conf_update(&fort_device()->pending, &conf_ref->conf);
+
+    fort_buffer_conf_update(&fort_device()->buffer, &conf_ref->conf);
+
+    fort_rate_conf_update(&fort_device()->rate, &conf_ref->conf);
+
+    const FORT_CONF_FLAGS old_conf_flags = fort_conf_ref_set(&fort_device()->conf, conf_ref);
+
+    fort_stat_conf_update(&fort_device()->stat, conf_group);
+    fort_stat_conf_flags_update(&fort_device()->stat, &conf_flags);
+    fort_stat_quota_conf_update(&fort_device()->stat, &conf_ref->conf);
+    fort_shaper_conf_update(&fort_device()->shaper, conf_group, &conf_flags);
+
+    return old_conf_flags;
+}
+
+static NTSTATUS fort_device_control_setconf(PIRP irp, ULONG len)
+{
+    if (len <= sizeof(FORT_CONF_IO))
+        return STATUS_UNSUCCESSFUL;
+
+    /* Map the locked pages of the service instead of the system buffer's copy */
+    const PFORT_CONF_IO conf_io = fort_device_irp_mdl_buffer(irp);
+    if (conf_io == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    /* The service's pages are not stable, so use the copied values only */
+    const FORT_CONF_GROUP conf_group = conf_io->conf_group;
+
+    PFORT_CONF_REF conf_ref = fort_conf_ref_new(&conf_io->conf, len - FORT_CONF_IO_CONF_OFF);
+    if (conf_ref == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    const FORT_CONF_FLAGS old_conf_flags = fort_device_conf_ref_set(conf_ref, &conf_group);
+
+    fort_perf_add(&fort_device()->perf, FORT_PERF_CONF_SWAPS, 1);
+    fort_etw_conf_swap(/*is_patch=*/FALSE);
+
+    return fort_device_reauth_force(old_conf_flags);
+}
+
+inline static NTSTATUS fort_device_patch_data_size(const PFORT_CONF_PATCH patch, ULONG *size)
+{
+    *size = 0;
+
+    if ((patch->sections & FORT_CONF_PATCH_ADDR_GROUPS) != 0) {
+        *size = patch->addr_groups_size;
+    }
+    if ((patch->sections & FORT_CONF_PATCH_APP_PERIODS) != 0) {
+        return RtlULongAdd(*size, patch->app_periods_size, size);
     }
 
-    return STATUS_UNSUCCESSFUL;
+    return STATUS_SUCCESS;
 }
 
-static NTSTATUS fort_device_control_setflags(const PFORT_CONF_FLAGS conf_flags, ULONG len)
+static NTSTATUS fort_device_control_patchconf(const PFORT_CONF_PATCH patch, ULONG len)
 {
-    if (len == sizeof(FORT_CONF_FLAGS)) {
-        const FORT_CONF_FLAGS old_conf_flags =
-                fort_conf_ref_flags_set(&fort_device()->conf, conf_flags);
+    if (len < FORT_CONF_PATCH_DATA_OFF)
+        return STATUS_UNSUCCESSFUL;
+
+    ULONG data_size;
+    if (!NT_SUCCESS(fort_device_patch_data_size(patch, &data_size))
+            || (len - FORT_CONF_PATCH_DATA_OFF) < data_size)
+        return STATUS_UNSUCCESSFUL;
 
-        fort_stat_conf_flags_update(&fort_device()->stat, conf_flags);
-        fort_shaper_conf_flags_update(&fort_device()->shaper, conf_flags);
+    PFORT_CONF_REF conf_ref = fort_conf_ref_take(&fort_device()->conf);
 
-        return fort_device_reauth_force(old_conf_flags);
+    if (conf_ref == NULL)
+        return STATUS_INVALID_DEVICE_STATE; /* the whole conf must be set first */
+
+    PFORT_CONF_REF new_conf_ref = NULL;
+    const NTSTATUS status = fort_conf_ref_patch(conf_ref, patch, &new_conf_ref);
+
+    fort_conf_ref_put(&fort_device()->conf, conf_ref);
+
+    if (!NT_SUCCESS(status))
+        return status;
+
+    const FORT_CONF_FLAGS old_conf_flags = fort_conf_ref_set(&fort_device()->conf, new_conf_ref);
+
+    fort_perf_add(&fort_device()->perf, FORT_PERF_CONF_SWAPS, 1);
+    fort_etw_conf_swap(/*is_patch=*/TRUE);
+
+    if ((patch->sections & FORT_CONF_PATCH_APP_GROUPS) != 0) {
+        fort_stat_conf_update(&fort_device()->stat, &patch->conf_group);
+        fort_shaper_conf_update(&fort_device()->shaper, &patch->conf_group, &patch->flags);
+    } else {
+        fort_stat_conf_flags_update(&fort_device()->stat, &patch->flags);
+        fort_shaper_conf_flags_update(&fort_device()->shaper, &patch->flags);
+    }
+
+    /* Log flags and speed limits do not change the verdicts */
+    if ((patch->sections & (FORT_CONF_PATCH_ADDR_GROUPS | FORT_CONF_PATCH_APP_PERIODS)) == 0
+            && RtlEqualMemory(&old_conf_flags, &patch->flags, sizeof(FORT_CONF_FLAGS)))
+        return STATUS_SUCCESS;
+
+    return fort_device_reauth_force(old_conf_flags);
+}
+
+static NTSTATUS fort_device_control_setflags(const PFORT_CONF_FLAGS conf_flags, ULONG len)
+{
+    if (len == sizeof(FORT_CONF_FLAGS)) {
+        return fort_device_flags_set(conf_flags);
     }
 
     return STATUS_UNSUCCESSFUL;
@@ -206,24 +375,39 @@ static NTSTATUS fort_device_control_getlog(PVOID out, ULONG out_len, PIRP irp, U
     return status;
 }
 
-inline static NTSTATUS fort_device_control_app_conf(
-        const PFORT_APP_ENTRY app_entry, PFORT_CONF_REF conf_ref, BOOL is_adding)
+static NTSTATUS fort_device_control_setlogring(const PFORT_LOG_RING_CONF ring_conf, ULONG len)
+{
+    if (len == sizeof(FORT_LOG_RING_CONF)) {
+        return fort_buffer_ring_open(&fort_device()->buffer, ring_conf);
+    }
+
+    return STATUS_UNSUCCESSFUL;
+}
+
+inline static NTSTATUS fort_device_control_app_conf(const PVOID app_entries, ULONG len,
+        PFORT_CONF_REF conf_ref, BOOL is_adding, UINT16 *group_bits)
 {
     NTSTATUS status;
 
     if (is_adding) {
-        status = fort_conf_ref_exe_add_entry(conf_ref, app_entry, /*locked=*/FALSE);
+        UINT32 added_n;
+        status = fort_conf_ref_exe_add_entries(conf_ref, app_entries, len, &added_n, group_bits);
     } else {
-        fort_conf_ref_exe_del_entry(conf_ref, app_entry);
+        fort_conf_ref_exe_del_entries(conf_ref, app_entries, len, group_bits);
         status = STATUS_SUCCESS;
+
+        if (fort_pool_trim_needed(&conf_ref->pool_list)) {
+            fort_worker_queue(&fort_device()->worker, FORT_WORKER_TRIM);
+        }
     }
 
     return status;
 }
 
-static NTSTATUS fort_device_control_app(const PFORT_APP_ENTRY app_entry, ULONG len, BOOL is_adding)
+/* The app entries are applied in a batch under one lock, with one reauth at the end */
+static NTSTATUS fort_device_control_app(const PVOID app_entries, ULONG len, BOOL is_adding)
 {
-    if (len < sizeof(FORT_APP_ENTRY) || len < (sizeof(FORT_APP_ENTRY) + app_entry->path_len))
+    if (!fort_conf_app_entries_valid(app_entries, len))
         return STATUS_UNSUCCESSFUL;
 
     PFORT_CONF_REF conf_ref = fort_conf_ref_take(&fort_device()->conf);
@@ -231,26 +415,40 @@ static NTSTATUS fort_device_control_app(const PFORT_APP_ENTRY app_entry, ULONG l
     if (conf_ref == NULL)
         return STATUS_INSUFFICIENT_RESOURCES;
 
-    const NTSTATUS status = fort_device_control_app_conf(app_entry, conf_ref, is_adding);
+    UINT16 group_bits;
+    const NTSTATUS status =
+            fort_device_control_app_conf(app_entries, len, conf_ref, is_adding, &group_bits);
 
     fort_conf_ref_put(&fort_device()->conf, conf_ref);
 
+    /* The service forgets the changed apps' paths */
     if (NT_SUCCESS(status)) {
-        fort_device_reauth_queue();
+        fort_buffer_apps_unreport(&fort_device()->buffer);
+    }
+
+    /* Only the flows of the changed apps' groups are reauthorized */
+    if (group_bits != 0) {
+        fort_device_conf_generation_bump(&fort_device()->conf);
+
+        fort_device_reauth_queue_groups(group_bits);
     }
 
     return status;
 }
 
-static NTSTATUS fort_device_control_setzones(const PFORT_CONF_ZONES zones, ULONG len)
+static NTSTATUS fort_device_control_setzones(PIRP irp, ULONG len)
 {
     if (len >= FORT_CONF_ZONES_DATA_OFF) {
+        const PFORT_CONF_ZONES zones = fort_device_irp_mdl_buffer(irp);
+        if (zones == NULL)
+            return STATUS_INSUFFICIENT_RESOURCES;
+
         PFORT_CONF_ZONES conf_zones = fort_conf_zones_new(zones, len);
 
         if (conf_zones == NULL) {
             return STATUS_INSUFFICIENT_RESOURCES;
         } else {
-            fort_conf_zones_set(&fort_device()->conf, conf_zones);
+            fort_conf_zones_set(&fort_device()->conf, conf_zones, len);
 
             fort_device_reauth_queue();
 
@@ -261,6 +459,34 @@ static NTSTATUS fort_device_control_setzones(const PFORT_CONF_ZONES zones, ULONG
     return STATUS_UNSUCCESSFUL;
 }
 
+static NTSTATUS fort_device_control_setzone(PIRP irp, ULONG len)
+{
+    if (len < FORT_CONF_ZONE_DATA_OFF + FORT_CONF_ADDR4_LIST_OFF)
+        return STATUS_UNSUCCESSFUL;
+
+    const PFORT_CONF_ZONE zone = fort_device_irp_mdl_buffer(irp);
+    if (zone == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    PFORT_CONF_ZONE conf_zone = fort_conf_zone_new(zone, len);
+    if (conf_zone == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    /* Validate the copy, as the service's pages are not stable */
+    if (conf_zone->zone_id == 0 || conf_zone->zone_id > FORT_CONF_ZONE_MAX) {
+        fort_mem_type_free(FORT_MEM_ZONES, conf_zone);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    const NTSTATUS status = fort_conf_zone_replace(&fort_device()->conf, conf_zone);
+
+    if (NT_SUCCESS(status)) {
+        fort_device_reauth_queue();
+    }
+
+    return status;
+}
+
 static NTSTATUS fort_device_control_setzoneflag(const PFORT_CONF_ZONE_FLAG zone_flag, ULONG len)
 {
     if (len == sizeof(FORT_CONF_ZONE_FLAG)) {
@@ -274,6 +500,88 @@ static NTSTATUS fort_device_control_setzoneflag(const PFORT_CONF_ZONE_FLAG zone_
     return STATUS_UNSUCCESSFUL;
 }
 
+static NTSTATUS fort_device_control_setlive(const PUCHAR live, ULONG len)
+{
+    if (len == sizeof(UCHAR)) {
+        const BOOL is_live = (*live != 0);
+
+        fort_stat_flags_set(&fort_device()->stat, FORT_STAT_LIVE, is_live);
+
+        if (is_live) {
+            fort_timer_set_period(&fort_device()->log_timer, FORT_CALLOUT_TIMER_PERIOD_FAST);
+        }
+
+        return STATUS_SUCCESS;
+    }
+
+    return STATUS_UNSUCCESSFUL;
+}
+
+static NTSTATUS fort_device_control_setquota(const PFORT_CONF_QUOTA quota, ULONG len)
+{
+    if (len == sizeof(FORT_CONF_QUOTA)) {
+        fort_stat_quota_set(&fort_device()->stat, quota);
+
+        return STATUS_SUCCESS;
+    }
+
+    return STATUS_UNSUCCESSFUL;
+}
+
+static NTSTATUS fort_device_control_getstats(
+        PFORT_DEVICE_STATS stats, ULONG out_len, ULONG_PTR *info)
+{
+    if (out_len < sizeof(FORT_DEVICE_STATS))
+        return STATUS_BUFFER_TOO_SMALL;
+
+    RtlZeroMemory(stats, sizeof(FORT_DEVICE_STATS));
+
+    fort_cache_stats(
+            &fort_device()->cache, &stats->verdict_cache_hits, &stats->verdict_cache_misses);
+
+    stats->stat_insert_time_max = fort_stat_insert_time_max(&fort_device()->stat);
+
+    fort_shaper_inject_stats(&fort_device()->shaper, stats->inject_batches);
+
+    fort_stat_flows_stats(&fort_device()->stat, &stats->flows_count, &stats->flow_inserts);
+
+    stats->shaper_queued_bytes = fort_shaper_queued_bytes(&fort_device()->shaper);
+    stats->log_buffered_bytes = fort_buffer_data_bytes(&fort_device()->buffer);
+
+    fort_perf_stats(&fort_device()->perf, stats);
+
+    fort_mem_stats(stats);
+
+    *info = sizeof(FORT_DEVICE_STATS);
+
+    return STATUS_SUCCESS;
+}
+
+static NTSTATUS fort_device_control_getflows(
+        PVOID buffer, ULONG in_len, ULONG out_len, ULONG_PTR *info)
+{
+    if (in_len != sizeof(UINT32))
+        return STATUS_INVALID_PARAMETER;
+
+    if (out_len < FORT_FLOWS_PAGE_FLOWS_OFF + sizeof(FORT_FLOW_INFO))
+        return STATUS_BUFFER_TOO_SMALL;
+
+    /* The input's cursor is overwritten by the output's page */
+    const UINT32 index = *((const UINT32 *) buffer);
+
+    PFORT_FLOWS_PAGE page = buffer;
+
+    UINT32 flows_count = (out_len - FORT_FLOWS_PAGE_FLOWS_OFF) / sizeof(FORT_FLOW_INFO);
+
+    page->next_index =
+            fort_stat_flows_snapshot(&fort_device()->stat, index, page->flows, &flows_count);
+    page->flows_count = flows_count;
+
+    *info = FORT_FLOWS_PAGE_FLOWS_OFF + flows_count * sizeof(FORT_FLOW_INFO);
+
+    return STATUS_SUCCESS;
+}
+
 static NTSTATUS fort_device_control_process(
         const PIO_STACK_LOCATION irp_stack, PIRP irp, ULONG_PTR *info)
 {
@@ -293,18 +601,32 @@ static NTSTATUS fort_device_control_process(
     case FORT_IOCTL_SETSERVICES:
         return fort_device_control_setservices(buffer, in_len);
     case FORT_IOCTL_SETCONF:
-        return fort_device_control_setconf(buffer, in_len);
+        return fort_device_control_setconf(irp, out_len);
     case FORT_IOCTL_SETFLAGS:
         return fort_device_control_setflags(buffer, in_len);
+    case FORT_IOCTL_PATCHCONF:
+        return fort_device_control_patchconf(buffer, in_len);
     case FORT_IOCTL_GETLOG:
         return fort_device_control_getlog(buffer, out_len, irp, info);
+    case FORT_IOCTL_SETLOGRING:
+        return fort_device_control_setlogring(buffer, in_len);
     case FORT_IOCTL_ADDAPP:
     case FORT_IOCTL_DELAPP:
         return fort_device_control_app(buffer, in_len, (control_code == FORT_IOCTL_ADDAPP));
     case FORT_IOCTL_SETZONES:
-        return fort_device_control_setzones(buffer, in_len);
+        return fort_device_control_setzones(irp, out_len);
+    case FORT_IOCTL_SETZONE:
+        return fort_device_control_setzone(irp, out_len);
     case FORT_IOCTL_SETZONEFLAG:
         return fort_device_control_setzoneflag(buffer, in_len);
+    case FORT_IOCTL_GETSTATS:
+        return fort_device_control_getstats(buffer, out_len, info);
+    case FORT_IOCTL_GETFLOWS:
+        return fort_device_control_getflows(buffer, in_len, out_len, info);
+    case FORT_IOCTL_SETLIVE:
+        return fort_device_control_setlive(buffer, in_len);
+    case FORT_IOCTL_SETQUOTA:
+        return fort_device_control_setquota(buffer, in_len);
     default:
         return STATUS_INVALID_DEVICE_REQUEST;
     }
@@ -377,6 +699,64 @@ static NTSTATUS fort_device_register_provider(void)
     return fort_prov_trans_close(engine, status);
 }
 
+static void fort_device_conf_cache_set(const PFORT_CONF_CACHE cache)
+{
+    const PFORT_CONF_IO conf_io = (PFORT_CONF_IO) cache->data;
+
+    PFORT_CONF_REF conf_ref =
+            fort_conf_ref_new(&conf_io->conf, cache->conf_size - FORT_CONF_IO_CONF_OFF);
+    if (conf_ref == NULL)
+        return;
+
+    fort_device_conf_ref_set(conf_ref, &conf_io->conf_group);
+
+    if (cache->zones_size != 0) {
+        const PFORT_CONF_ZONES zones =
+                (PFORT_CONF_ZONES) (cache->data + FORT_CONF_CACHE_ZONES_OFF(cache->conf_size));
+
+        PFORT_CONF_ZONES conf_zones = fort_conf_zones_new(zones, cache->zones_size);
+        if (conf_zones != NULL) {
+            fort_conf_zones_set(&fort_device()->conf, conf_zones, cache->zones_size);
+        }
+    }
+}
+
+static void fort_device_conf_cache_load(void)
+{
+    NTSTATUS status;
+
+    UNICODE_STRING filePath;
+    RtlInitUnicodeString(&filePath, FORT_DEVICE_CONF_CACHE_PATH);
+
+    PUCHAR data = NULL;
+    DWORD dataSize = 0;
+    {
+        HANDLE fileHandle;
+        status = fort_file_open(&filePath, &fileHandle);
+        if (!NT_SUCCESS(status))
+            return; /* not cached yet */
+
+        status = fort_file_read(fileHandle, FORT_DEVICE_POOL_TAG, &data, &dataSize);
+
+        ZwClose(fileHandle);
+    }
+
+    if (!NT_SUCCESS(status)) {
+        LOG("Conf Cache Read: Error: %x\n", status);
+        return;
+    }
+
+    const PFORT_CONF_CACHE cache = (PFORT_CONF_CACHE) data;
+
+    if (fort_conf_cache_check(cache, dataSize) && cache->driver_version == DRIVER_VERSION) {
+        fort_device_conf_cache_set(cache);
+    } else {
+        LOG("Conf Cache: Invalid size=%d\n", dataSize);
+    }
+
+    fort_mem_free(data, FORT_DEVICE_POOL_TAG);
+}
+
 FORT_API NTSTATUS fort_device_load(PVOID device_param)
 {
     FORT_CHECK_STACK(FORT_DEVICE_LOAD);
@@ -388,16 +768,31 @@ FORT_API NTSTATUS fort_device_load(PVOID device_param)
     ExInitializeRundownProtection(&fort_device()->reauth_rundown);
 
     fort_worker_func_set(&fort_device()->worker, FORT_WORKER_REAUTH, &fort_device_reauth);
+    fort_worker_func_set(
+            &fort_device()->worker, FORT_WORKER_PSTREE, &fort_pstree_resolve_processes);
+    fort_worker_func_set(&fort_device()->worker, FORT_WORKER_TRIM, &fort_device_trim);
+    fort_worker_func_set(&fort_device()->worker, FORT_WORKER_QUOTA, &fort_device_quota_block);
+    fort_worker_func_set(&fort_device()->worker, FORT_WORKER_MEM, &fort_mem_large_frees_flush);
+
+    fort_mem_worker_set(&fort_device()->worker);
 
     fort_device_conf_open(&fort_device()->conf);
+    fort_perf_open(&fort_device()->perf);
+    fort_cache_open(&fort_device()->cache);
+    fort_rate_open(&fort_device()->rate);
     fort_buffer_open(&fort_device()->buffer);
     fort_stat_open(&fort_device()->stat);
     fort_pending_open(&fort_device()->pending);
     fort_shaper_open(&fort_device()->shaper);
-    fort_timer_open(&fort_device()->log_timer, 500, /*flags=*/0, &fort_callout_timer);
+    fort_timer_open(&fort_device()->log_timer, FORT_CALLOUT_TIMER_PERIOD, /*flags=*/0,
+            &fort_callout_timer);
     fort_timer_open(
-            &fort_device()->app_timer, 60000, FORT_TIMER_COALESCABLE, &fort_app_period_timer);
+            &fort_device()->app_timer, /*period=*/0, FORT_TIMER_ONESHOT, &fort_app_period_timer);
     fort_pstree_open(&fort_device()->ps_tree);
+    fort_host_open(&fort_device()->host);
+
+    /* Filter by the cached conf, until the service sets the actual one */
+    fort_device_conf_cache_load();
 
     /* Register filters provider */
     status = fort_device_register_provider();
@@ -414,6 +809,9 @@ FORT_API NTSTATUS fort_device_load(PVOID device_param)
     if (!NT_SUCCESS(status))
         return status;
 
+    /* Add the existing processes, while the new ones are notified already */
+    fort_pstree_enum_processes(&fort_device()->ps_tree);
+
     /* Register power state change callback */
     status = fort_syscb_power_register();
     if (!NT_SUCCESS(status))
@@ -445,6 +843,9 @@ FORT_API void fort_device_unload(void)
     /* Stop process monitor */
     fort_pstree_close(&fort_device()->ps_tree);
 
+    /* Stop host addresses monitor */
+    fort_host_close(&fort_device()->host);
+
     /* Stop packets shaper & pending */
     fort_shaper_close(&fort_device()->shaper);
     fort_pending_close(&fort_device()->pending);
@@ -456,8 +857,18 @@ FORT_API void fort_device_unload(void)
     /* Uninstall callouts */
     fort_callout_remove();
 
+    /* Free verdict cache */
+    fort_cache_close(&fort_device()->cache);
+
+    /* Free performance counters */
+    fort_perf_close(&fort_device()->perf);
+
     /* Unregister filters provider */
     if (fort_device_flag(&fort_device()->conf, FORT_DEVICE_BOOT_FILTER) == 0) {
         fort_prov_trans_unregister();
     }
+
+    /* Free the large blocks, deferred after the worker's stop */
+    fort_mem_worker_set(NULL);
+    fort_mem_large_frees_flush();
 }
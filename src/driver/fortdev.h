@@ -4,9 +4,13 @@
 #include "fortdrv.h"
 
 #include "fortbuf.h"
+#include "fortcache.h"
 #include "fortcnf.h"
+#include "forthost.h"
+#include "fortperf.h"
 #include "fortpkt.h"
 #include "fortps.h"
+#include "fortrate.h"
 #include "fortstat.h"
 #include "forttmr.h"
 #include "fortwrk.h"
@@ -16,6 +20,7 @@ typedef struct fort_device
     PDEVICE_OBJECT device;
 
     EX_RUNDOWN_REF reauth_rundown;
+    LONG volatile reauth_groups; /* queued to the worker */
 
     PCALLBACK_OBJECT power_cb_obj;
     PVOID power_cb_reg;
@@ -24,11 +29,15 @@ typedef struct fort_device
     PVOID systime_cb_reg;
 
     FORT_DEVICE_CONF conf;
+    FORT_PERF perf;
+    FORT_CACHE cache;
+    FORT_RATE rate;
     FORT_BUFFER buffer;
     FORT_STAT stat;
     FORT_PENDING pending;
     FORT_SHAPER shaper;
     FORT_PSTREE ps_tree;
+    FORT_HOST host;
     FORT_TIMER log_timer;
     FORT_TIMER app_timer;
     FORT_WORKER worker;
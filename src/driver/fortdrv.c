@@ -6,6 +6,7 @@
 
 #include "fortcb.h"
 #include "fortdev.h"
+#include "fortetw.h"
 #include "forttrace.h"
 #include "fortutl.h"
 
@@ -72,14 +73,15 @@ static NTSTATUS fort_driver_create_device(PDRIVER_OBJECT driver, PUNICODE_STRING
 
 static void fort_driver_unload(PDRIVER_OBJECT driver)
 {
-    if (fort_device() == NULL)
-        return;
+    if (fort_device() != NULL) {
+        fort_device_unload();
 
-    fort_device_unload();
+        fort_driver_delete_device(driver);
 
-    fort_driver_delete_device(driver);
+        fort_device_set(NULL);
+    }
 
-    fort_device_set(NULL);
+    fort_etw_unregister();
 }
 
 static NTSTATUS fort_driver_load(PDRIVER_OBJECT driver, PUNICODE_STRING reg_path)
@@ -89,6 +91,8 @@ static NTSTATUS fort_driver_load(PDRIVER_OBJECT driver, PUNICODE_STRING reg_path
     /* Use NX Non-Paged Pool */
     ExInitializeDriverRuntime(DrvRtPoolNxOptIn);
 
+    fort_etw_register();
+
     status = fort_system32_path_init(driver, reg_path);
     if (!NT_SUCCESS(status)) {
         LOG("Driver Path Init: Error: %x\n", status);
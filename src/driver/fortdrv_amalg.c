@@ -18,15 +18,22 @@
 
 #include "forttlsf.c"
 #include "forttds.c"
+#include "forthash.c"
 
 #include "fortbuf.c"
+#include "fortcache.c"
 #include "fortcb.c"
 #include "fortcnf.c"
 #include "fortdbg.c"
+#include "fortetw.c"
+#include "forthost.c"
+#include "fortmem.c"
 #include "fortmod.c"
+#include "fortperf.c"
 #include "fortpkt.c"
 #include "fortpool.c"
 #include "fortps.c"
+#include "fortrate.c"
 #include "fortstat.c"
 #include "fortscb.c"
 #include "forttmr.c"
@@ -0,0 +1,84 @@
+/* Fort Firewall Driver TraceLogging Events */
+
+#include "fortetw.h"
+
+/*
+ * The TraceLoggingWrite() evaluates its arguments only when a session listens for the event's
+ * level and keyword, so the disabled events cost a check of the provider's state.
+ */
+#if defined(FORT_DRIVER)
+/* FortFirewall.Driver: f813ded9-25b2-552d-ec26-6e54afb907eb */
+TRACELOGGING_DEFINE_PROVIDER(fort_etw_provider, "FortFirewall.Driver",
+        (0xf813ded9, 0x25b2, 0x552d, 0xec, 0x26, 0x6e, 0x54, 0xaf, 0xb9, 0x07, 0xeb));
+
+#    define FORT_ETW_WRITE(name, level, keyword, ...)                                              \
+        TraceLoggingWrite(fort_etw_provider, name, TraceLoggingLevel(level),                      \
+                TraceLoggingKeyword(keyword), __VA_ARGS__)
+#else
+#    define FORT_ETW_WRITE(name, level, keyword, ...) ((void) 0)
+#endif
+
+FORT_API void fort_etw_register(void)
+{
+#if defined(FORT_DRIVER)
+    TraceLoggingRegister(fort_etw_provider);
+#endif
+}
+
+FORT_API void fort_etw_unregister(void)
+{
+#if defined(FORT_DRIVER)
+    TraceLoggingUnregister(fort_etw_provider);
+#endif
+}
+
+FORT_API void fort_etw_ale_classify(BOOL inbound, BOOL isIPv6, UINT32 action_type, INT64 ticks)
+{
+    FORT_ETW_WRITE("AleClassify", FORT_ETW_LEVEL_VERBOSE, FORT_ETW_KEYWORD_ALE,
+            TraceLoggingBoolean(inbound, "Inbound"), TraceLoggingBoolean(isIPv6, "IPv6"),
+            TraceLoggingUInt32(action_type, "ActionType"), TraceLoggingInt64(ticks, "Ticks"));
+}
+
+FORT_API void fort_etw_flow_add(UINT64 flow_id, UINT16 proc_index, UCHAR group_index)
+{
+    FORT_ETW_WRITE("FlowAdd", FORT_ETW_LEVEL_VERBOSE, FORT_ETW_KEYWORD_FLOW,
+            TraceLoggingUInt64(flow_id, "FlowId"), TraceLoggingUInt16(proc_index, "ProcIndex"),
+            TraceLoggingUInt8(group_index, "GroupIndex"));
+}
+
+FORT_API void fort_etw_flow_delete(UINT64 flow_id)
+{
+    FORT_ETW_WRITE("FlowDelete", FORT_ETW_LEVEL_VERBOSE, FORT_ETW_KEYWORD_FLOW,
+            TraceLoggingUInt64(flow_id, "FlowId"));
+}
+
+FORT_API void fort_etw_shaper_enqueue(UINT16 queue_index, UINT32 data_length)
+{
+    FORT_ETW_WRITE("ShaperEnqueue", FORT_ETW_LEVEL_VERBOSE, FORT_ETW_KEYWORD_SHAPER,
+            TraceLoggingUInt16(queue_index, "QueueIndex"),
+            TraceLoggingUInt32(data_length, "DataLength"));
+}
+
+FORT_API void fort_etw_shaper_drop(UINT32 data_length)
+{
+    FORT_ETW_WRITE("ShaperDrop", FORT_ETW_LEVEL_VERBOSE, FORT_ETW_KEYWORD_SHAPER,
+            TraceLoggingUInt32(data_length, "DataLength"));
+}
+
+FORT_API void fort_etw_shaper_inject(UINT32 count)
+{
+    FORT_ETW_WRITE("ShaperInject", FORT_ETW_LEVEL_VERBOSE, FORT_ETW_KEYWORD_SHAPER,
+            TraceLoggingUInt32(count, "Count"));
+}
+
+FORT_API void fort_etw_conf_swap(BOOL is_patch)
+{
+    FORT_ETW_WRITE("ConfSwap", FORT_ETW_LEVEL_INFO, FORT_ETW_KEYWORD_CONF,
+            TraceLoggingBoolean(is_patch, "Patch"));
+}
+
+FORT_API void fort_etw_log_flush(NTSTATUS status, ULONG_PTR size)
+{
+    FORT_ETW_WRITE("LogFlush", FORT_ETW_LEVEL_VERBOSE, FORT_ETW_KEYWORD_LOG,
+            TraceLoggingNTStatus(status, "Status"), TraceLoggingUInt64((UINT64) size, "Size"));
+}
@@ -0,0 +1,55 @@
+#ifndef FORTETW_H
+#define FORTETW_H
+
+#include "fortdrv.h"
+
+/* Keywords of the TraceLogging events */
+#define FORT_ETW_KEYWORD_ALE    0x01
+#define FORT_ETW_KEYWORD_FLOW   0x02
+#define FORT_ETW_KEYWORD_SHAPER 0x04
+#define FORT_ETW_KEYWORD_CONF   0x08
+#define FORT_ETW_KEYWORD_LOG    0x10
+
+#define FORT_ETW_LEVEL_INFO    4
+#define FORT_ETW_LEVEL_VERBOSE 5
+
+#if defined(FORT_DRIVER)
+#    include <TraceLoggingProvider.h>
+
+TRACELOGGING_DECLARE_PROVIDER(fort_etw_provider);
+
+#    define fort_etw_enabled(level, keyword)                                                       \
+        TraceLoggingProviderEnabled(fort_etw_provider, (level), (keyword))
+#else
+#    define fort_etw_enabled(level, keyword) FALSE
+#endif
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API void fort_etw_register(void);
+
+FORT_API void fort_etw_unregister(void);
+
+FORT_API void fort_etw_ale_classify(BOOL inbound, BOOL isIPv6, UINT32 action_type, INT64 ticks);
+
+FORT_API void fort_etw_flow_add(UINT64 flow_id, UINT16 proc_index, UCHAR group_index);
+
+FORT_API void fort_etw_flow_delete(UINT64 flow_id);
+
+FORT_API void fort_etw_shaper_enqueue(UINT16 queue_index, UINT32 data_length);
+
+FORT_API void fort_etw_shaper_drop(UINT32 data_length);
+
+FORT_API void fort_etw_shaper_inject(UINT32 count);
+
+FORT_API void fort_etw_conf_swap(BOOL is_patch);
+
+FORT_API void fort_etw_log_flush(NTSTATUS status, ULONG_PTR size);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTETW_H
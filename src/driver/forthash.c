@@ -0,0 +1,161 @@
+/* Fort Firewall Linear Hash Table */
+
+#include "forthash.h"
+
+#define FORT_HASH_LOW_MAX_LIMIT 0x40000000
+
+static tommy_node **fort_hash_bucket_ref(PFORT_HASH hash, UINT32 pos)
+{
+    const UINT32 bit = tommy_ilog2_u32(pos | 1);
+    const UINT32 segment_index = (bit < FORT_HASH_BIT) ? 0 : (bit - FORT_HASH_BIT + 1);
+
+    return &hash->segments[segment_index][pos];
+}
+
+static UINT32 fort_hash_pos(PFORT_HASH hash, tommy_key_t key)
+{
+    const UINT32 pos = key & (hash->low_max - 1);
+
+    /* The bucket is split already */
+    if (pos < hash->split)
+        return key & (hash->low_max * 2 - 1);
+
+    return pos;
+}
+
+static BOOL fort_hash_segment_add(PFORT_HASH hash)
+{
+    const UINT32 low_max = hash->low_max;
+
+    if (low_max >= FORT_HASH_LOW_MAX_LIMIT)
+        return FALSE;
+
+    /* The buckets are initialized on their splits */
+    tommy_node **segment = tommy_malloc(low_max * sizeof(tommy_node *));
+    if (segment == NULL)
+        return FALSE; /* the chains get longer */
+
+    hash->segments[hash->segments_n++] = segment - low_max;
+
+    return TRUE;
+}
+
+static void fort_hash_split(PFORT_HASH hash)
+{
+    const UINT32 low_max = hash->low_max;
+    const UINT32 split = hash->split;
+
+    /* The split round needs the next segment */
+    if (split == 0 && !fort_hash_segment_add(hash))
+        return;
+
+    tommy_node **low = fort_hash_bucket_ref(hash, split);
+    tommy_node **high = fort_hash_bucket_ref(hash, low_max + split);
+
+    tommy_node *node = *low;
+
+    *low = NULL;
+    *high = NULL;
+
+    while (node != NULL) {
+        tommy_node *next = node->next;
+        tommy_node **list = ((node->index & low_max) != 0) ? high : low;
+
+        if (*list != NULL) {
+            tommy_list_insert_tail_not_empty(*list, node);
+        } else {
+            tommy_list_insert_first(list, node);
+        }
+
+        node = next;
+    }
+
+    if (split + 1 == low_max) {
+        hash->low_max = low_max * 2;
+        hash->split = 0;
+    } else {
+        hash->split = split + 1;
+    }
+}
+
+FORT_API void fort_hash_init(PFORT_HASH hash)
+{
+    RtlZeroMemory(hash, sizeof(FORT_HASH));
+
+    hash->low_max = 1 << FORT_HASH_BIT;
+
+    hash->segments[0] = hash->buckets;
+    hash->segments_n = 1;
+}
+
+FORT_API void fort_hash_done(PFORT_HASH hash)
+{
+    for (UINT16 i = 1; i < hash->segments_n; ++i) {
+        const UINT32 first_pos = (UINT32) 1 << (FORT_HASH_BIT + i - 1);
+
+        tommy_free(hash->segments[i] + first_pos);
+    }
+
+    hash->segments_n = 1;
+}
+
+FORT_API tommy_node *fort_hash_bucket(PFORT_HASH hash, tommy_key_t key)
+{
+    return *fort_hash_bucket_ref(hash, fort_hash_pos(hash, key));
+}
+
+FORT_API void fort_hash_insert(PFORT_HASH hash, tommy_node *node, void *data, tommy_key_t key)
+{
+    tommy_node **bucket = fort_hash_bucket_ref(hash, fort_hash_pos(hash, key));
+
+    tommy_list_insert_tail(bucket, node, data);
+
+    node->index = key;
+
+    ++hash->count;
+
+    /* Split one bucket per insert, if more than 50% full */
+    if (hash->count >= (hash->low_max + hash->split) / 2) {
+        fort_hash_split(hash);
+    }
+}
+
+FORT_API void fort_hash_remove_existing(PFORT_HASH hash, tommy_node *node)
+{
+    tommy_node **bucket = fort_hash_bucket_ref(hash, fort_hash_pos(hash, node->index));
+
+    tommy_list_remove_existing(bucket, node);
+
+    --hash->count;
+}
+
+FORT_API void fort_hash_foreach_node(PFORT_HASH hash, tommy_foreach_node_func *func)
+{
+    const UINT32 buckets_n = hash->low_max + hash->split;
+
+    for (UINT32 pos = 0; pos < buckets_n; ++pos) {
+        tommy_node *node = *fort_hash_bucket_ref(hash, pos);
+
+        while (node != NULL) {
+            tommy_node *next = node->next;
+            func(node);
+            node = next;
+        }
+    }
+}
+
+FORT_API void fort_hash_foreach_node_arg(
+        PFORT_HASH hash, tommy_foreach_node_arg_func *func, void *arg)
+{
+    const UINT32 buckets_n = hash->low_max + hash->split;
+
+    for (UINT32 pos = 0; pos < buckets_n; ++pos) {
+        tommy_node *node = *fort_hash_bucket_ref(hash, pos);
+
+        while (node != NULL) {
+            tommy_node *next = node->next;
+            func(arg, node);
+            node = next;
+        }
+    }
+}
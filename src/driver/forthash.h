@@ -0,0 +1,51 @@
+#ifndef FORTHASH_H
+#define FORTHASH_H
+
+#include "fortdrv.h"
+
+#include "forttds.h"
+
+#define FORT_HASH_BIT          6 /* initial buckets count is 2^FORT_HASH_BIT */
+#define FORT_HASH_SEGMENTS_MAX (32 - FORT_HASH_BIT + 1)
+
+/* Linear hash table: grows by splitting one bucket per insert, without rehashing all nodes */
+typedef struct fort_hash
+{
+    UINT32 count;
+
+    UINT32 low_max; /* buckets count before the current split round */
+    UINT32 split; /* next bucket to split */
+
+    UINT16 segments_n;
+
+    tommy_node **segments[FORT_HASH_SEGMENTS_MAX]; /* adjusted by the segment's first bucket */
+
+    tommy_node *buckets[1 << FORT_HASH_BIT]; /* the first segment */
+} FORT_HASH, *PFORT_HASH;
+
+#define fort_hash_count(hash) ((hash)->count)
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API void fort_hash_init(PFORT_HASH hash);
+
+FORT_API void fort_hash_done(PFORT_HASH hash);
+
+FORT_API tommy_node *fort_hash_bucket(PFORT_HASH hash, tommy_key_t key);
+
+FORT_API void fort_hash_insert(PFORT_HASH hash, tommy_node *node, void *data, tommy_key_t key);
+
+FORT_API void fort_hash_remove_existing(PFORT_HASH hash, tommy_node *node);
+
+FORT_API void fort_hash_foreach_node(PFORT_HASH hash, tommy_foreach_node_func *func);
+
+FORT_API void fort_hash_foreach_node_arg(
+        PFORT_HASH hash, tommy_foreach_node_arg_func *func, void *arg);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTHASH_H
@@ -0,0 +1,160 @@
+/* Fort Firewall Host Addresses */
+
+#include "forthost.h"
+
+#if defined(FORT_DRIVER)
+#    include <netioapi.h>
+#endif
+
+#define FORT_HOST_VERDICT_GEN_MASK 0x3FFFFFFF
+
+#define fort_host_verdict_index(ip)                                                                \
+    ((UINT32) ((ip) * 2654435761u) >> (32 - FORT_HOST_VERDICT_BITS))
+
+#define fort_host_verdict_entry(ip, generation, verdict)                                           \
+    ((LONG64) (((UINT64) (ip) << 32)                                                               \
+            | ((UINT64) ((generation) & FORT_HOST_VERDICT_GEN_MASK) << 2) | (verdict)))
+
+#if defined(FORT_DRIVER)
+static void fort_host_addrs_fill(PFORT_HOST_ADDRS addrs, const PMIB_UNICASTIPADDRESS_TABLE table)
+{
+    for (ULONG i = 0; i < table->NumEntries; ++i) {
+        const SOCKADDR_INET *addr = &table->Table[i].Address;
+
+        if (addr->si_family == AF_INET) {
+            if (addrs->ip4_n < FORT_HOST_ADDR_MAX) {
+                /* In the host order, as the classify's values */
+                addrs->ip4[addrs->ip4_n++] = RtlUlongByteSwap(addr->Ipv4.sin_addr.s_addr);
+            }
+        } else if (addr->si_family == AF_INET6) {
+            if (addrs->ip6_n < FORT_HOST_ADDR_MAX) {
+                RtlCopyMemory(&addrs->ip6[addrs->ip6_n++], &addr->Ipv6.sin6_addr,
+                        sizeof(ip6_addr_t));
+            }
+        }
+    }
+}
+
+static void fort_host_update(PFORT_HOST host)
+{
+    PMIB_UNICASTIPADDRESS_TABLE table = NULL;
+    if (!NT_SUCCESS(GetUnicastIpAddressTable(AF_UNSPEC, &table)))
+        return;
+
+    FORT_HOST_ADDRS addrs;
+    RtlZeroMemory(&addrs, sizeof(FORT_HOST_ADDRS));
+
+    fort_host_addrs_fill(&addrs, table);
+
+    FreeMibTable(table);
+
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&host->lock);
+    {
+        host->addrs = addrs;
+    }
+    ExReleaseSpinLockExclusive(&host->lock, oldIrql);
+}
+
+static VOID NTAPI fort_host_notify(
+        PVOID context, PMIB_UNICASTIPADDRESS_ROW row, MIB_NOTIFICATION_TYPE notificationType)
+{
+    UNUSED(row);
+    UNUSED(notificationType);
+
+    fort_host_update(context);
+}
+#endif
+
+FORT_API void fort_host_open(PFORT_HOST host)
+{
+    RtlZeroMemory(host, sizeof(FORT_HOST));
+
+#if defined(FORT_DRIVER)
+    fort_host_update(host);
+
+    const NTSTATUS status = NotifyUnicastIpAddressChange(AF_UNSPEC, &fort_host_notify, host,
+            /*initialNotification=*/FALSE, &host->notify_handle);
+    if (!NT_SUCCESS(status)) {
+        LOG("Host: Notify Error: %x\n", status);
+        host->notify_handle = NULL;
+    }
+#endif
+}
+
+FORT_API void fort_host_close(PFORT_HOST host)
+{
+#if defined(FORT_DRIVER)
+    if (host->notify_handle != NULL) {
+        /* Waits for the running notifications */
+        CancelMibChangeNotify2(host->notify_handle);
+        host->notify_handle = NULL;
+    }
+#else
+    UNUSED(host);
+#endif
+}
+
+static BOOL fort_host_addrs_include(const PFORT_HOST_ADDRS addrs, const UINT32 *ip, BOOL isIPv6)
+{
+    if (isIPv6) {
+        for (int i = 0; i < addrs->ip6_n; ++i) {
+            if (RtlCompareMemory(&addrs->ip6[i], ip, sizeof(ip6_addr_t)) == sizeof(ip6_addr_t))
+                return TRUE;
+        }
+    } else {
+        for (int i = 0; i < addrs->ip4_n; ++i) {
+            if (addrs->ip4[i] == *ip)
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+FORT_API BOOL fort_host_is_local_ip(PFORT_HOST host, const UINT32 *ip, BOOL isIPv6)
+{
+    BOOL res;
+
+    const KIRQL oldIrql = ExAcquireSpinLockShared(&host->lock);
+    {
+        res = fort_host_addrs_include(&host->addrs, ip, isIPv6);
+    }
+    ExReleaseSpinLockShared(&host->lock, oldIrql);
+
+    return res;
+}
+
+FORT_API BOOL fort_host_verdict_get(
+        PFORT_HOST host, UINT32 ip, LONG generation, UCHAR *verdict, UINT32 *zones_mask)
+{
+    const UINT32 index = fort_host_verdict_index(ip);
+    LONG64 volatile *entry = &host->verdicts[index];
+
+    const LONG64 v = InterlockedCompareExchange64(entry, 0, 0); /* atomic read */
+
+    if ((v & ~(LONG64) 3) != fort_host_verdict_entry(ip, generation, 0))
+        return FALSE;
+
+    *zones_mask = (UINT32) InterlockedCompareExchange(&host->verdict_zones[index], 0, 0);
+
+    /* The zones are of the same entry, if it is not replaced meanwhile */
+    if (InterlockedCompareExchange64(entry, 0, 0) != v)
+        return FALSE;
+
+    *verdict = (UCHAR) (v & 3);
+
+    return TRUE;
+}
+
+FORT_API void fort_host_verdict_set(
+        PFORT_HOST host, UINT32 ip, LONG generation, UCHAR verdict, UINT32 zones_mask)
+{
+    const UINT32 index = fort_host_verdict_index(ip);
+    LONG64 volatile *entry = &host->verdicts[index];
+
+    /* Invalidate the entry before its zones change */
+    InterlockedExchange64(entry, 0);
+    InterlockedExchange(&host->verdict_zones[index], (LONG) zones_mask);
+
+    InterlockedExchange64(entry, fort_host_verdict_entry(ip, generation, verdict));
+}
@@ -0,0 +1,59 @@
+#ifndef FORTHOST_H
+#define FORTHOST_H
+
+#include "fortdrv.h"
+
+#define FORT_HOST_ADDR_MAX 16 /* per address family */
+
+#define FORT_HOST_VERDICT_BITS  8
+#define FORT_HOST_VERDICT_COUNT (1 << FORT_HOST_VERDICT_BITS)
+
+/* Address groups' verdict of the remote IPv4 address */
+#define FORT_HOST_VERDICT_INET          0x01 /* not in the local networks */
+#define FORT_HOST_VERDICT_INET_INCLUDED 0x02 /* allowed internet address */
+
+typedef struct fort_host_addrs
+{
+    UINT16 ip4_n;
+    UINT16 ip6_n;
+
+    UINT32 ip4[FORT_HOST_ADDR_MAX];
+    ip6_addr_t ip6[FORT_HOST_ADDR_MAX];
+} FORT_HOST_ADDRS, *PFORT_HOST_ADDRS;
+
+typedef struct fort_host
+{
+    HANDLE notify_handle;
+
+    EX_SPIN_LOCK lock;
+
+    FORT_HOST_ADDRS addrs; /* unicast addresses of the interfaces */
+
+    /* IPv4 address, conf generation and verdict bits by the address hash */
+    LONG64 volatile verdicts[FORT_HOST_VERDICT_COUNT];
+
+    /* Zones matched on the verdict's checks, to count their hits by the kept verdicts */
+    LONG volatile verdict_zones[FORT_HOST_VERDICT_COUNT];
+} FORT_HOST, *PFORT_HOST;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API void fort_host_open(PFORT_HOST host);
+
+FORT_API void fort_host_close(PFORT_HOST host);
+
+FORT_API BOOL fort_host_is_local_ip(PFORT_HOST host, const UINT32 *ip, BOOL isIPv6);
+
+FORT_API BOOL fort_host_verdict_get(
+        PFORT_HOST host, UINT32 ip, LONG generation, UCHAR *verdict, UINT32 *zones_mask);
+
+FORT_API void fort_host_verdict_set(
+        PFORT_HOST host, UINT32 ip, LONG generation, UCHAR verdict, UINT32 zones_mask);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTHOST_H
@@ -0,0 +1,263 @@
+/* Fort Firewall Driver Memory Accounting */
+
+#include "fortmem.h"
+
+static_assert(FORT_MEM_TYPE_COUNT == FORT_DEVICE_STATS_MEM_TYPE_COUNT, "FORT_MEM_TYPE mismatch");
+static_assert(sizeof(FORT_MEM_HEADER) <= FORT_MEM_HEADER_SIZE, "FORT_MEM_HEADER size mismatch");
+
+static const ULONG g_memPoolTags[FORT_MEM_TYPE_COUNT] = {
+    'BwfF', /* buffer */
+    'VwfF', /* cache */
+    'NwfF', /* conf */
+    'KwfF', /* packet */
+    'CwfF', /* perf */
+    'PwfF', /* pstree */
+    'SwfF', /* stat */
+    'TwfF', /* tommy */
+    'ZwfF', /* zones */
+};
+
+static FORT_MEM g_mem;
+
+/* The conf and zones are sized by the service, their failure would fail the conf's load */
+inline static BOOL fort_mem_type_limited(enum FORT_MEM_TYPE mem_type)
+{
+    return mem_type != FORT_MEM_CONF && mem_type != FORT_MEM_ZONES;
+}
+
+static BOOL fort_mem_counter_add(enum FORT_MEM_TYPE mem_type, LONG64 size)
+{
+    PFORT_MEM_COUNTER counter = &g_mem.counters[mem_type];
+
+    const LONG64 bytes = InterlockedAdd64(&counter->bytes, size);
+
+    const LONG64 limit = g_mem.limits[mem_type];
+    if (limit != 0 && bytes > limit) {
+        InterlockedAdd64(&counter->bytes, -size);
+        InterlockedIncrement64(&g_mem.limit_fails);
+        return FALSE;
+    }
+
+    LONG64 peak_bytes = counter->peak_bytes;
+    while (bytes > peak_bytes) {
+        const LONG64 old_peak_bytes =
+                InterlockedCompareExchange64(&counter->peak_bytes, bytes, peak_bytes);
+        if (old_peak_bytes == peak_bytes)
+            break;
+
+        peak_bytes = old_peak_bytes;
+    }
+
+    return TRUE;
+}
+
+static PVOID fort_mem_node_alloc(SIZE_T size, ULONG tag, USHORT node)
+{
+#if defined(FORT_WIN7_COMPAT)
+    UNUSED(node);
+
+    return fort_mem_alloc(size, tag);
+#else
+    if (node == FORT_MEM_NODE_ANY)
+        return fort_mem_alloc(size, tag);
+
+    POOL_EXTENDED_PARAMETER param;
+    RtlZeroMemory(&param, sizeof(POOL_EXTENDED_PARAMETER));
+
+    param.Type = PoolExtendedParameterNumaNode;
+    param.PreferredNode = node;
+
+    return ExAllocatePool3(
+            POOL_FLAG_UNINITIALIZED | POOL_FLAG_NON_PAGED, size, tag, &param, /*count=*/1);
+#endif
+}
+
+/* The pages are allocated by the large pages' units, so they are mapped by the large pages */
+static PVOID fort_mem_large_alloc(SIZE_T size, USHORT node, PMDL *large_mdl)
+{
+#if defined(FORT_WIN7_COMPAT)
+    UNUSED(size);
+    UNUSED(node);
+    UNUSED(large_mdl);
+
+    return NULL;
+#else
+    PHYSICAL_ADDRESS low_address;
+    PHYSICAL_ADDRESS high_address;
+    PHYSICAL_ADDRESS skip_bytes;
+
+    low_address.QuadPart = 0;
+    high_address.QuadPart = -1;
+    skip_bytes.QuadPart = 0;
+
+    const ULONG ideal_node = (node == FORT_MEM_NODE_ANY) ? MM_ANY_NODE_OK : node;
+    const ULONG flags =
+            MM_DONT_ZERO_ALLOCATION | MM_ALLOCATE_FULLY_REQUIRED | MM_ALLOCATE_FAST_LARGE_PAGES;
+
+    PMDL mdl = MmAllocateNodePagesForMdlEx(
+            low_address, high_address, skip_bytes, size, MmCached, ideal_node, flags);
+    if (mdl == NULL)
+        return NULL;
+
+    PVOID p = MmMapLockedPagesSpecifyCache(mdl, KernelMode, MmCached, /*requestedAddress=*/NULL,
+            /*bugCheckOnFailure=*/FALSE, NormalPagePriority | MdlMappingNoExecute);
+    if (p == NULL) {
+        MmFreePagesFromMdl(mdl);
+        ExFreePool(mdl);
+        return NULL;
+    }
+
+    *large_mdl = mdl;
+
+    return p;
+#endif
+}
+
+static PVOID fort_mem_type_alloc_header(
+        enum FORT_MEM_TYPE mem_type, PCHAR p, SIZE_T alloc_size, PMDL large_mdl)
+{
+    if (p == NULL) {
+        InterlockedAdd64(&g_mem.counters[mem_type].bytes, -(LONG64) alloc_size);
+        return NULL;
+    }
+
+    PFORT_MEM_HEADER header = (PFORT_MEM_HEADER) p;
+    header->alloc_size = alloc_size;
+    header->large_mdl = large_mdl;
+    header->mem_type = mem_type;
+    header->next = NULL;
+
+    return p + FORT_MEM_HEADER_SIZE;
+}
+
+FORT_API PVOID fort_mem_type_alloc(enum FORT_MEM_TYPE mem_type, SIZE_T size)
+{
+    return fort_mem_type_alloc_node(mem_type, size, FORT_MEM_NODE_ANY);
+}
+
+FORT_API PVOID fort_mem_type_alloc_node(enum FORT_MEM_TYPE mem_type, SIZE_T size, USHORT node)
+{
+    const SIZE_T alloc_size = FORT_MEM_HEADER_SIZE + size;
+
+    if (!fort_mem_counter_add(mem_type, (LONG64) alloc_size))
+        return NULL;
+
+    PCHAR p = fort_mem_node_alloc(alloc_size, g_memPoolTags[mem_type], node);
+
+    return fort_mem_type_alloc_header(mem_type, p, alloc_size, /*large_mdl=*/NULL);
+}
+
+/* The big blobs are searched by the binary searches, each probe of them may miss the TLB */
+FORT_API PVOID fort_mem_type_alloc_large(enum FORT_MEM_TYPE mem_type, SIZE_T size, USHORT node)
+{
+    if (FORT_MEM_HEADER_SIZE + size < FORT_MEM_LARGE_MIN)
+        return fort_mem_type_alloc_node(mem_type, size, node);
+
+    const SIZE_T alloc_size =
+            FORT_ALIGN_SIZE(FORT_MEM_HEADER_SIZE + size, FORT_MEM_LARGE_PAGE_SIZE);
+
+    if (!fort_mem_counter_add(mem_type, (LONG64) alloc_size))
+        return NULL;
+
+    PMDL large_mdl = NULL;
+    PCHAR p = fort_mem_large_alloc(alloc_size, node, &large_mdl);
+    if (p == NULL) {
+        /* The large pages are not available or the physical memory is fragmented */
+        InterlockedAdd64(&g_mem.counters[mem_type].bytes, -(LONG64) alloc_size);
+
+        return fort_mem_type_alloc_node(mem_type, size, node);
+    }
+
+    return fort_mem_type_alloc_header(mem_type, p, alloc_size, large_mdl);
+}
+
+static void fort_mem_large_free(PFORT_MEM_HEADER header)
+{
+    PMDL large_mdl = header->large_mdl;
+
+    InterlockedAdd64(&g_mem.counters[header->mem_type].bytes, -(LONG64) header->alloc_size);
+
+    MmUnmapLockedPages(header, large_mdl);
+    MmFreePagesFromMdl(large_mdl);
+    ExFreePool(large_mdl);
+}
+
+/* The last references may be released at DISPATCH_LEVEL, e.g. by the callouts */
+static void fort_mem_large_free_defer(PFORT_MEM_HEADER header)
+{
+    PFORT_MEM_HEADER next = g_mem.large_frees;
+    for (;;) {
+        header->next = next;
+
+        PFORT_MEM_HEADER old_next = InterlockedCompareExchangePointer(
+                (PVOID volatile *) &g_mem.large_frees, header, next);
+        if (old_next == next)
+            break;
+
+        next = old_next;
+    }
+
+    if (g_mem.worker != NULL) {
+        fort_worker_queue(g_mem.worker, FORT_WORKER_MEM);
+    }
+}
+
+FORT_API void fort_mem_type_free(enum FORT_MEM_TYPE mem_type, PVOID p)
+{
+    PFORT_MEM_HEADER header = (PFORT_MEM_HEADER) ((PCHAR) p - FORT_MEM_HEADER_SIZE);
+
+    if (header->large_mdl != NULL) {
+        if (KeGetCurrentIrql() == PASSIVE_LEVEL) {
+            fort_mem_large_free(header);
+        } else {
+            fort_mem_large_free_defer(header);
+        }
+        return;
+    }
+
+    InterlockedAdd64(&g_mem.counters[mem_type].bytes, -(LONG64) header->alloc_size);
+
+    fort_mem_free(header, g_memPoolTags[mem_type]);
+}
+
+FORT_API void fort_mem_worker_set(PFORT_WORKER worker)
+{
+    g_mem.worker = worker;
+}
+
+FORT_API void fort_mem_large_frees_flush(void)
+{
+    PFORT_MEM_HEADER header =
+            InterlockedExchangePointer((PVOID volatile *) &g_mem.large_frees, NULL);
+
+    while (header != NULL) {
+        PFORT_MEM_HEADER next = header->next;
+
+        fort_mem_large_free(header);
+
+        header = next;
+    }
+}
+
+FORT_API void fort_mem_conf_update(const PFORT_CONF conf)
+{
+    const LONG64 limit = (LONG64) conf->mem_limit * FORT_MEM_LIMIT_UNIT;
+
+    for (int i = 0; i < FORT_MEM_TYPE_COUNT; ++i) {
+        const enum FORT_MEM_TYPE mem_type = (enum FORT_MEM_TYPE) i;
+
+        InterlockedExchange64(&g_mem.limits[i], fort_mem_type_limited(mem_type) ? limit : 0);
+    }
+}
+
+FORT_API void fort_mem_stats(PFORT_DEVICE_STATS stats)
+{
+    for (int i = 0; i < FORT_MEM_TYPE_COUNT; ++i) {
+        const PFORT_MEM_COUNTER counter = &g_mem.counters[i];
+
+        stats->mem_bytes[i] = (UINT64) counter->bytes;
+        stats->mem_peak_bytes[i] = (UINT64) counter->peak_bytes;
+    }
+
+    stats->mem_limit_fails = (UINT64) g_mem.limit_fails;
+}
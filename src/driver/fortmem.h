@@ -0,0 +1,84 @@
+#ifndef FORTMEM_H
+#define FORTMEM_H
+
+#include "fortdrv.h"
+
+#include "common/fortconf.h"
+
+#include "fortwrk.h"
+
+#define FORT_MEM_HEADER_SIZE 64 /* keeps the cache line alignment of the per-processor arrays */
+
+#define FORT_MEM_LIMIT_UNIT (1024 * 1024) /* of the conf's mem_limit */
+
+#define FORT_MEM_NODE_ANY 0xFFFF /* of the allocating thread's NUMA node */
+
+#define FORT_MEM_LARGE_PAGE_SIZE (2 * 1024 * 1024)
+#define FORT_MEM_LARGE_MIN       FORT_MEM_LARGE_PAGE_SIZE /* of the blobs backed by large pages */
+
+/* Ordered as the stats by name */
+enum FORT_MEM_TYPE {
+    FORT_MEM_BUFFER = 0,
+    FORT_MEM_CACHE,
+    FORT_MEM_CONF,
+    FORT_MEM_PACKET,
+    FORT_MEM_PERF,
+    FORT_MEM_PSTREE,
+    FORT_MEM_STAT,
+    FORT_MEM_TOMMY,
+    FORT_MEM_ZONES,
+    FORT_MEM_TYPE_COUNT,
+};
+
+typedef struct fort_mem_header
+{
+    SIZE_T alloc_size;
+    PMDL large_mdl; /* of the large pages, NULL for the pool */
+
+    enum FORT_MEM_TYPE mem_type;
+    struct fort_mem_header *next; /* of the deferred frees */
+} FORT_MEM_HEADER, *PFORT_MEM_HEADER;
+
+typedef struct fort_mem_counter
+{
+    LONG64 volatile bytes;
+    LONG64 volatile peak_bytes;
+} FORT_MEM_COUNTER, *PFORT_MEM_COUNTER;
+
+typedef struct fort_mem
+{
+    LONG64 volatile limits[FORT_MEM_TYPE_COUNT]; /* bytes per subsystem, 0 for no limit */
+    LONG64 volatile limit_fails;
+
+    FORT_MEM_COUNTER counters[FORT_MEM_TYPE_COUNT];
+
+    /* The large pages are unmapped and freed at PASSIVE_LEVEL only */
+    PFORT_MEM_HEADER volatile large_frees;
+    PFORT_WORKER worker;
+} FORT_MEM, *PFORT_MEM;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API PVOID fort_mem_type_alloc(enum FORT_MEM_TYPE mem_type, SIZE_T size);
+
+FORT_API PVOID fort_mem_type_alloc_node(enum FORT_MEM_TYPE mem_type, SIZE_T size, USHORT node);
+
+FORT_API PVOID fort_mem_type_alloc_large(enum FORT_MEM_TYPE mem_type, SIZE_T size, USHORT node);
+
+FORT_API void fort_mem_type_free(enum FORT_MEM_TYPE mem_type, PVOID p);
+
+FORT_API void fort_mem_worker_set(PFORT_WORKER worker);
+
+FORT_API void fort_mem_large_frees_flush(void);
+
+FORT_API void fort_mem_conf_update(const PFORT_CONF conf);
+
+FORT_API void fort_mem_stats(PFORT_DEVICE_STATS stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTMEM_H
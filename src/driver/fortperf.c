@@ -0,0 +1,193 @@
+/* Fort Firewall Driver Performance Counters */
+
+#include "fortperf.h"
+
+#include "fortmem.h"
+#include "forttds.h"
+
+FORT_API void fort_perf_open(PFORT_PERF perf)
+{
+    const ULONG cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    const SIZE_T size = cpu_count * FORT_PERF_CPU_SIZE;
+
+    /* The counters stay disabled on allocation failure */
+    PCHAR cpus = fort_mem_type_alloc(FORT_MEM_PERF, size);
+    if (cpus == NULL)
+        return;
+
+    RtlZeroMemory(cpus, size);
+
+    perf->cpus = cpus;
+    perf->cpu_count = cpu_count;
+}
+
+FORT_API void fort_perf_close(PFORT_PERF perf)
+{
+    if (perf->cpus == NULL)
+        return;
+
+    fort_mem_type_free(FORT_MEM_PERF, perf->cpus);
+
+    perf->cpus = NULL;
+    perf->cpu_count = 0;
+}
+
+static PFORT_PERF_CPU fort_perf_cpu(PFORT_PERF perf)
+{
+    const ULONG cpu_index = KeGetCurrentProcessorIndex();
+
+    return (cpu_index < perf->cpu_count)
+            ? (PFORT_PERF_CPU) (perf->cpus + cpu_index * FORT_PERF_CPU_SIZE)
+            : NULL;
+}
+
+/* The thread may be moved to another processor: the updates are interlocked, but not shared */
+FORT_API void fort_perf_add(PFORT_PERF perf, enum FORT_PERF_COUNTER_TYPE counter, LONG64 value)
+{
+    PFORT_PERF_CPU cpu = fort_perf_cpu(perf);
+    if (cpu == NULL)
+        return;
+
+    InterlockedAdd64(&cpu->counters[counter], value);
+}
+
+FORT_API INT64 fort_perf_ticks(void)
+{
+    return KeQueryPerformanceCounter(NULL).QuadPart;
+}
+
+inline static int fort_perf_ale_verdict(UINT32 action_type)
+{
+    switch (action_type) {
+    case FWP_ACTION_PERMIT:
+        return 0;
+    case FWP_ACTION_BLOCK:
+        return 1;
+    default:
+        return 2;
+    }
+}
+
+FORT_API void fort_perf_ale_classify_add(
+        PFORT_PERF perf, INT64 begin_ticks, BOOL inbound, BOOL isIPv6, UINT32 action_type)
+{
+    PFORT_PERF_CPU cpu = fort_perf_cpu(perf);
+    if (cpu == NULL)
+        return;
+
+    const int layer = (inbound ? 2 : 0) + (isIPv6 ? 1 : 0);
+    const int verdict = fort_perf_ale_verdict(action_type);
+
+    InterlockedIncrement64(&cpu->ale_classifies[layer][verdict]);
+
+    const UINT64 ticks = (UINT64) (fort_perf_ticks() - begin_ticks);
+    const UINT32 index = (ticks >> 32) != 0 ? (FORT_DEVICE_STATS_ALE_TIME_COUNT - 1)
+                                            : tommy_ilog2_u32((UINT32) ticks | 1);
+
+    InterlockedIncrement64(&cpu->ale_classify_times[index]);
+}
+
+inline static INT64 fort_perf_system_time(void)
+{
+    LARGE_INTEGER system_time;
+    KeQuerySystemTime(&system_time);
+
+    return system_time.QuadPart;
+}
+
+/* The last hit's time is not interlocked: the racing updates are of the same tick */
+FORT_API void fort_perf_zones_hit(PFORT_PERF perf, UINT32 zones_mask)
+{
+    if (zones_mask == 0)
+        return;
+
+    PFORT_PERF_CPU cpu = fort_perf_cpu(perf);
+    if (cpu == NULL)
+        return;
+
+    const INT64 system_time = fort_perf_system_time();
+
+    do {
+        const int zone_index = bit_scan_forward(zones_mask);
+
+        InterlockedIncrement64(&cpu->zone_hits[zone_index]);
+        cpu->zone_hit_times[zone_index] = system_time;
+
+        zones_mask ^= (1u << zone_index);
+    } while (zones_mask != 0);
+}
+
+FORT_API void fort_perf_addr_group_hit(PFORT_PERF perf, int addr_group_index)
+{
+    PFORT_PERF_CPU cpu = fort_perf_cpu(perf);
+    if (cpu == NULL)
+        return;
+
+    InterlockedIncrement64(&cpu->addr_group_hits[addr_group_index]);
+    cpu->addr_group_hit_times[addr_group_index] = fort_perf_system_time();
+}
+
+FORT_API void fort_perf_log_filter_suppressed(PFORT_PERF perf, int filter_index)
+{
+    PFORT_PERF_CPU cpu = fort_perf_cpu(perf);
+    if (cpu == NULL)
+        return;
+
+    InterlockedIncrement64(&cpu->log_filter_suppressed[filter_index]);
+}
+
+inline static void fort_perf_hits_stats(const LONG64 volatile *hits,
+        const LONG64 volatile *hit_times, UINT64 *stats_hits, INT64 *stats_hit_times, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        stats_hits[i] += (UINT64) hits[i];
+
+        const INT64 hit_time = hit_times[i];
+        if (stats_hit_times[i] < hit_time) {
+            stats_hit_times[i] = hit_time;
+        }
+    }
+}
+
+static void fort_perf_cpu_stats(const PFORT_PERF_CPU cpu, PFORT_DEVICE_STATS stats)
+{
+    for (int i = 0; i < FORT_DEVICE_STATS_ALE_LAYER_COUNT; ++i) {
+        for (int j = 0; j < FORT_DEVICE_STATS_ALE_VERDICT_COUNT; ++j) {
+            stats->ale_classifies[i][j] += (UINT64) cpu->ale_classifies[i][j];
+        }
+    }
+
+    for (int i = 0; i < FORT_DEVICE_STATS_ALE_TIME_COUNT; ++i) {
+        stats->ale_classify_times[i] += (UINT64) cpu->ale_classify_times[i];
+    }
+
+    stats->shaper_drops += (UINT64) cpu->counters[FORT_PERF_SHAPER_DROPS];
+    stats->shaper_injects += (UINT64) cpu->counters[FORT_PERF_SHAPER_INJECTS];
+    stats->log_drops += (UINT64) cpu->counters[FORT_PERF_LOG_DROPS];
+    stats->conf_swaps += (UINT64) cpu->counters[FORT_PERF_CONF_SWAPS];
+    stats->pending_expires += (UINT64) cpu->counters[FORT_PERF_PENDING_EXPIRES];
+
+    fort_perf_hits_stats(cpu->zone_hits, cpu->zone_hit_times, stats->zone_hits,
+            stats->zone_hit_times, FORT_CONF_ZONE_MAX);
+    fort_perf_hits_stats(cpu->addr_group_hits, cpu->addr_group_hit_times,
+            stats->addr_group_hits, stats->addr_group_hit_times,
+            FORT_DEVICE_STATS_ADDR_GROUP_COUNT);
+
+    for (int i = 0; i < FORT_CONF_LOG_FILTERS_MAX; ++i) {
+        stats->log_filter_suppressed[i] += (UINT64) cpu->log_filter_suppressed[i];
+    }
+}
+
+FORT_API void fort_perf_stats(PFORT_PERF perf, PFORT_DEVICE_STATS stats)
+{
+    LARGE_INTEGER freq;
+    KeQueryPerformanceCounter(&freq);
+
+    stats->perf_frequency = (UINT64) freq.QuadPart;
+
+    for (ULONG i = 0; i < perf->cpu_count; ++i) {
+        const PFORT_PERF_CPU cpu = (PFORT_PERF_CPU) (perf->cpus + i * FORT_PERF_CPU_SIZE);
+
+        fort_perf_cpu_stats(cpu, stats);
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef FORTPERF_H
+#define FORTPERF_H
+
+#include "fortdrv.h"
+
+#include "common/fortconf.h"
+
+#define FORT_PERF_CPU_ALIGN 64 /* the processors don't share the cache lines */
+
+enum FORT_PERF_COUNTER_TYPE {
+    FORT_PERF_SHAPER_DROPS = 0,
+    FORT_PERF_SHAPER_INJECTS,
+    FORT_PERF_LOG_DROPS,
+    FORT_PERF_CONF_SWAPS,
+    FORT_PERF_PENDING_EXPIRES,
+    FORT_PERF_COUNTER_COUNT,
+};
+
+/* Updated by the current processor, summed on request */
+typedef struct fort_perf_cpu
+{
+    LONG64 volatile ale_classifies[FORT_DEVICE_STATS_ALE_LAYER_COUNT]
+                                  [FORT_DEVICE_STATS_ALE_VERDICT_COUNT];
+    LONG64 volatile ale_classify_times[FORT_DEVICE_STATS_ALE_TIME_COUNT];
+
+    LONG64 volatile counters[FORT_PERF_COUNTER_COUNT];
+
+    LONG64 volatile zone_hits[FORT_CONF_ZONE_MAX];
+    LONG64 volatile zone_hit_times[FORT_CONF_ZONE_MAX];
+
+    LONG64 volatile addr_group_hits[FORT_DEVICE_STATS_ADDR_GROUP_COUNT];
+    LONG64 volatile addr_group_hit_times[FORT_DEVICE_STATS_ADDR_GROUP_COUNT];
+
+    LONG64 volatile log_filter_suppressed[FORT_CONF_LOG_FILTERS_MAX];
+} FORT_PERF_CPU, *PFORT_PERF_CPU;
+
+#define FORT_PERF_CPU_SIZE FORT_ALIGN_SIZE(sizeof(FORT_PERF_CPU), FORT_PERF_CPU_ALIGN)
+
+typedef struct fort_perf
+{
+    ULONG cpu_count;
+
+    PCHAR cpus; /* of FORT_PERF_CPU_SIZE */
+} FORT_PERF, *PFORT_PERF;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API void fort_perf_open(PFORT_PERF perf);
+
+FORT_API void fort_perf_close(PFORT_PERF perf);
+
+FORT_API void fort_perf_add(PFORT_PERF perf, enum FORT_PERF_COUNTER_TYPE counter, LONG64 value);
+
+FORT_API INT64 fort_perf_ticks(void);
+
+FORT_API void fort_perf_ale_classify_add(
+        PFORT_PERF perf, INT64 begin_ticks, BOOL inbound, BOOL isIPv6, UINT32 action_type);
+
+FORT_API void fort_perf_zones_hit(PFORT_PERF perf, UINT32 zones_mask);
+
+FORT_API void fort_perf_addr_group_hit(PFORT_PERF perf, int addr_group_index);
+
+FORT_API void fort_perf_log_filter_suppressed(PFORT_PERF perf, int filter_index);
+
+FORT_API void fort_perf_stats(PFORT_PERF perf, PFORT_DEVICE_STATS stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTPERF_H
@@ -4,14 +4,29 @@
 
 #include "fortdbg.h"
 #include "fortdev.h"
+#include "fortetw.h"
+#include "fortmem.h"
 #include "forttrace.h"
 #include "fortutl.h"
 
 #define FORT_PACKET_POOL_TAG 'KwfF'
 
+#define FORT_PACKET_RESERVE_BYTES      1500 /* typical packet size to reserve the descriptors */
+#define FORT_SHAPER_PACKET_RESERVE_MAX 16384
+#define FORT_PENDING_PACKET_RESERVE    FORT_PACKET_MAGAZINE_SIZE
+
 #define FORT_PACKET_FLUSH_ALL 0xFFFFFFFF
 
+#define fort_pending_proc_hash(process_id) tommy_inthash_u32((UINT32) (process_id))
+
 #define FORT_QUEUE_INITIAL_TOKEN_COUNT 1500
+#define FORT_QUEUE_BURST_DEFAULT_MS    1 /* default burst size in time of the bandwidth */
+
+#define FORT_QUEUE_NEXT_TICK_NONE MAXLONGLONG
+
+#define FORT_QUEUE_FQ_QUANTUM     1514 /* bytes per round */
+#define FORT_QUEUE_FQ_TARGET_MS   5 /* acceptable sojourn time */
+#define FORT_QUEUE_FQ_INTERVAL_MS 100
 
 #define HTONL(l) _byteswap_ulong(l)
 
@@ -96,52 +111,276 @@ static ULONG fort_packet_data_length(const PNET_BUFFER_LIST netBufList)
     return data_length;
 }
 
-static PFORT_FLOW_PACKET fort_shaper_packet_get_locked(PFORT_SHAPER shaper)
+/* The ECN field of the IPv4 TOS or of the IPv6 Traffic Class */
+inline static UCHAR fort_packet_ip_ecn(const UCHAR *header, BOOL isIPv6)
 {
-    PFORT_FLOW_PACKET pkt = NULL;
+    return (isIPv6 ? (header[1] >> 4) : header[1]) & 0x03;
+}
 
-    if (shaper->packet_free != NULL) {
-        pkt = shaper->packet_free;
-        shaper->packet_free = pkt->next;
-    } else {
-        const tommy_size_t size = tommy_arrayof_size(&shaper->packets);
+static BOOL fort_packet_is_ecn_capable(PCFORT_CALLOUT_ARG ca, ULONG bytesRetreated)
+{
+    PNET_BUFFER netBuf = NET_BUFFER_LIST_FIRST_NB(ca->netBufList);
 
-        /* TODO: tommy_arrayof_grow(): check calloc()'s result for NULL */
-        if (tommy_arrayof_grow(&shaper->packets, size + 1), 0)
-            return NULL;
+    if (!NT_SUCCESS(NdisRetreatNetBufferDataStart(netBuf, bytesRetreated, 0, 0)))
+        return FALSE;
+
+    UCHAR storage[2];
+    const UCHAR *header = NdisGetDataBuffer(netBuf, sizeof(storage), storage, 1, 0);
 
-        pkt = tommy_arrayof_ref(&shaper->packets, size);
+    const BOOL ecn_capable = (header != NULL && fort_packet_ip_ecn(header, ca->isIPv6) != 0);
+
+    NdisAdvanceNetBufferDataStart(netBuf, bytesRetreated, FALSE, 0);
+
+    return ecn_capable;
+}
+
+static void fort_packet_ecn_set_ce(PNET_BUFFER netBuf, BOOL isIPv6)
+{
+    /* The IPv4 header is updated with its checksum */
+    UCHAR *header = NdisGetDataBuffer(netBuf, isIPv6 ? 2 : 12, NULL, 1, 0);
+    if (header == NULL || fort_packet_ip_ecn(header, isIPv6) == 0)
+        return;
+
+    if (isIPv6) {
+        header[1] |= 0x30;
+        return;
     }
 
-    return pkt;
+    const UINT16 old_word = (UINT16) ((header[0] << 8) | header[1]);
+
+    header[1] |= 0x03;
+
+    const UINT16 new_word = (UINT16) ((header[0] << 8) | header[1]);
+
+    /* Incremental update of the checksum (RFC 1624) */
+    const UINT16 checksum = (UINT16) ((header[10] << 8) | header[11]);
+
+    UINT32 sum = (UINT16) ~checksum + (UINT16) ~old_word + new_word;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+
+    const UINT16 new_checksum = (UINT16) ~sum;
+
+    header[10] = (UCHAR) (new_checksum >> 8);
+    header[11] = (UCHAR) new_checksum;
 }
 
-static PFORT_FLOW_PACKET fort_shaper_packet_get(PFORT_SHAPER shaper)
+static void fort_packet_pool_open(PFORT_PACKET_POOL pool, UINT32 packet_size)
 {
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&shaper->lock, &lock_queue);
+    tommy_arrayof_init(&pool->packets, packet_size);
 
-    PFORT_FLOW_PACKET pkt = fort_shaper_packet_get_locked(shaper);
+    KeInitializeSpinLock(&pool->lock);
 
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+    const ULONG cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    const SIZE_T size = cpu_count * sizeof(FORT_PACKET_MAGAZINE);
 
-    return pkt;
+    /* The depot is used directly on allocation failure */
+    PFORT_PACKET_MAGAZINE cpus = fort_mem_type_alloc(FORT_MEM_PACKET, size);
+    if (cpus == NULL)
+        return;
+
+    RtlZeroMemory(cpus, size);
+
+    pool->cpus = cpus;
+    pool->cpu_count = cpu_count;
+}
+
+static void fort_packet_pool_close(PFORT_PACKET_POOL pool)
+{
+    if (pool->cpus != NULL) {
+        fort_mem_type_free(FORT_MEM_PACKET, pool->cpus);
+
+        pool->cpus = NULL;
+        pool->cpu_count = 0;
+    }
+
+    pool->depot = NULL;
+
+    tommy_arrayof_done(&pool->packets);
+}
+
+/* Allocate the segments here, as tommy_arrayof_grow() doesn't check them for NULL */
+static NTSTATUS fort_packet_pool_grow_segments_locked(
+        PFORT_PACKET_POOL pool, tommy_size_t *count)
+{
+    tommy_arrayof *packets = &pool->packets;
+
+    if (packets->bucket[0] == NULL) {
+        *count = 0;
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    while (*count > packets->bucket_max) {
+        const tommy_size_t bucket_max = packets->bucket_max;
+        const tommy_size_t element_size = packets->element_size;
+
+        PUCHAR segment = (packets->bucket_bit < TOMMY_SIZE_BIT)
+                ? tommy_calloc(bucket_max, element_size)
+                : NULL;
+        if (segment == NULL) {
+            *count = bucket_max;
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        /* Store it adjusting the offset, as tommy_arrayof_grow() does */
+        packets->bucket[packets->bucket_bit] =
+                segment - (tommy_ptrdiff_t) bucket_max * element_size;
+
+        ++packets->bucket_bit;
+        packets->bucket_max = (tommy_size_t) 1 << packets->bucket_bit;
+    }
+
+    return STATUS_SUCCESS;
 }
 
-static void fort_shaper_packet_put_locked(PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt)
+static NTSTATUS fort_packet_pool_grow_locked(PFORT_PACKET_POOL pool, tommy_size_t count)
 {
-    pkt->next = shaper->packet_free;
-    shaper->packet_free = pkt;
+    const tommy_size_t size = tommy_arrayof_size(&pool->packets);
+    if (count <= size)
+        return STATUS_SUCCESS;
+
+    /* On failure grow by the allocated segments only */
+    const NTSTATUS status = fort_packet_pool_grow_segments_locked(pool, &count);
+
+    if (count > size) {
+        tommy_arrayof_grow(&pool->packets, count);
+    }
+
+    for (tommy_size_t i = size; i < count; ++i) {
+        PFORT_PACKET_FREE pkt = tommy_arrayof_ref(&pool->packets, i);
+
+        pkt->next = pool->depot;
+        pool->depot = pkt;
+    }
+
+    return status;
 }
 
-static void fort_shaper_packet_put(PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt)
+static NTSTATUS fort_packet_pool_reserve(PFORT_PACKET_POOL pool, UINT32 count)
 {
+    NTSTATUS status;
+
     KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&shaper->lock, &lock_queue);
+    KeAcquireInStackQueuedSpinLock(&pool->lock, &lock_queue);
 
-    fort_shaper_packet_put_locked(shaper, pkt);
+    status = fort_packet_pool_grow_locked(pool, count);
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return status;
+}
+
+static void fort_packet_pool_refill_locked(
+        PFORT_PACKET_POOL pool, PFORT_PACKET_MAGAZINE mag, UINT32 count)
+{
+    if (pool->depot == NULL) {
+        fort_packet_pool_grow_locked(pool, tommy_arrayof_size(&pool->packets) + count);
+    }
+
+    for (; count > 0 && pool->depot != NULL; --count) {
+        PFORT_PACKET_FREE pkt = pool->depot;
+        pool->depot = pkt->next;
+
+        pkt->next = mag->head;
+        mag->head = pkt;
+        ++mag->count;
+    }
+}
+
+static void fort_packet_pool_flush_locked(
+        PFORT_PACKET_POOL pool, PFORT_PACKET_MAGAZINE mag, UINT32 count)
+{
+    for (; count > 0; --count) {
+        PFORT_PACKET_FREE pkt = mag->head;
+        mag->head = pkt->next;
+        --mag->count;
+
+        pkt->next = pool->depot;
+        pool->depot = pkt;
+    }
+}
+
+inline static PFORT_PACKET_MAGAZINE fort_packet_pool_cpu(PFORT_PACKET_POOL pool)
+{
+    const ULONG cpu_index = KeGetCurrentProcessorIndex();
+
+    return (cpu_index < pool->cpu_count) ? &pool->cpus[cpu_index] : NULL;
+}
+
+static PVOID fort_packet_pool_get(PFORT_PACKET_POOL pool)
+{
+    FORT_PACKET_MAGAZINE mag_local = { 0 };
+
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
+
+    PFORT_PACKET_MAGAZINE mag = fort_packet_pool_cpu(pool);
+    if (mag == NULL) {
+        mag = &mag_local;
+    }
+
+    /* Take a half of magazine from the depot */
+    if (mag->count == 0) {
+        const UINT32 count = (mag == &mag_local) ? 1 : FORT_PACKET_MAGAZINE_SIZE / 2;
+
+        KLOCK_QUEUE_HANDLE lock_queue;
+        KeAcquireInStackQueuedSpinLockAtDpcLevel(&pool->lock, &lock_queue);
+
+        fort_packet_pool_refill_locked(pool, mag, count);
+
+        KeReleaseInStackQueuedSpinLockFromDpcLevel(&lock_queue);
+    }
+
+    PFORT_PACKET_FREE pkt = mag->head;
+    if (pkt != NULL) {
+        mag->head = pkt->next;
+        --mag->count;
+    }
+
+    KeLowerIrql(oldIrql);
+
+    return pkt;
+}
+
+static void fort_packet_pool_put(PFORT_PACKET_POOL pool, PVOID p)
+{
+    PFORT_PACKET_FREE pkt = p;
+
+    FORT_PACKET_MAGAZINE mag_local = { 0 };
+
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
+
+    PFORT_PACKET_MAGAZINE mag = fort_packet_pool_cpu(pool);
+    if (mag == NULL) {
+        mag = &mag_local;
+    }
+
+    pkt->next = mag->head;
+    mag->head = pkt;
+    ++mag->count;
+
+    /* Return a half of the full magazine to the depot */
+    if (mag == &mag_local || mag->count > FORT_PACKET_MAGAZINE_SIZE) {
+        const UINT32 count = (mag == &mag_local) ? 1 : FORT_PACKET_MAGAZINE_SIZE / 2;
+
+        KLOCK_QUEUE_HANDLE lock_queue;
+        KeAcquireInStackQueuedSpinLockAtDpcLevel(&pool->lock, &lock_queue);
+
+        fort_packet_pool_flush_locked(pool, mag, count);
+
+        KeReleaseInStackQueuedSpinLockFromDpcLevel(&lock_queue);
+    }
+
+    KeLowerIrql(oldIrql);
+}
+
+inline static PFORT_FLOW_PACKET fort_shaper_packet_get(PFORT_SHAPER shaper)
+{
+    return fort_packet_pool_get(&shaper->packet_pool);
+}
+
+inline static void fort_shaper_packet_put(PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt)
+{
+    fort_packet_pool_put(&shaper->packet_pool, pkt);
 }
 
 inline static void fort_packet_fill_in_interface_indexes(
@@ -222,7 +461,7 @@ inline static NTSTATUS fort_packet_fill_out(PCFORT_CALLOUT_ARG ca, PFORT_PACKET_
     const ULONG controlDataLength = ca->inMetaValues->controlDataLength;
     if (FWPS_IS_METADATA_FIELD_PRESENT(ca->inMetaValues, FWPS_METADATA_FIELD_TRANSPORT_CONTROL_DATA)
             && controlDataLength > 0) {
-        pkt_out->controlData = fort_mem_alloc(controlDataLength, FORT_PACKET_POOL_TAG);
+        pkt_out->controlData = fort_mem_type_alloc(FORT_MEM_PACKET, controlDataLength);
         if (pkt_out->controlData == NULL)
             return STATUS_INSUFFICIENT_RESOURCES;
 
@@ -288,7 +527,7 @@ static void fort_packet_free(PFORT_PACKET_IO pkt)
 {
     if ((pkt->flags & FORT_PACKET_INBOUND) == 0) {
         if (pkt->out.controlData != NULL) {
-            fort_mem_free(pkt->out.controlData, FORT_PACKET_POOL_TAG);
+            fort_mem_type_free(FORT_MEM_PACKET, pkt->out.controlData);
         }
     }
 
@@ -308,55 +547,38 @@ static void fort_shaper_packet_free(
 
 static void fort_shaper_packet_drop(PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt)
 {
-    fort_shaper_packet_free(shaper, pkt, /*clonedNetBufList=*/NULL);
-}
+    fort_perf_add(&fort_device()->perf, FORT_PERF_SHAPER_DROPS, 1);
 
-static PFORT_PENDING_PACKET fort_pending_packet_get_locked(PFORT_PENDING pending)
-{
-    PFORT_PENDING_PACKET pkt = NULL;
+    fort_etw_shaper_drop(pkt->data_length);
 
-    if (pending->packet_free != NULL) {
-        pkt = pending->packet_free;
-        pending->packet_free = pkt->next;
-    } else {
-        const tommy_size_t size = tommy_arrayof_size(&pending->packets);
-
-        /* TODO: tommy_arrayof_grow(): check calloc()'s result for NULL */
-        if (tommy_arrayof_grow(&pending->packets, size + 1), 0)
-            return NULL;
-
-        pkt = tommy_arrayof_ref(&pending->packets, size);
-    }
-
-    return pkt;
+    fort_shaper_packet_free(shaper, pkt, /*clonedNetBufList=*/NULL);
 }
 
-static PFORT_PENDING_PACKET fort_pending_packet_get(PFORT_PENDING pending)
+static void fort_shaper_packet_free_batch(
+        PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt, PNET_BUFFER_LIST clonedNetBufList)
 {
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&pending->lock, &lock_queue);
+    /* The packets and their clones are chained in the same order */
+    while (pkt != NULL) {
+        PFORT_FLOW_PACKET pkt_next = pkt->next;
+        PNET_BUFFER_LIST clonedNext = NET_BUFFER_LIST_NEXT_NBL(clonedNetBufList);
 
-    PFORT_PENDING_PACKET pkt = fort_pending_packet_get_locked(pending);
+        NET_BUFFER_LIST_NEXT_NBL(clonedNetBufList) = NULL;
 
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+        fort_shaper_packet_free(shaper, pkt, clonedNetBufList);
 
-    return pkt;
+        pkt = pkt_next;
+        clonedNetBufList = clonedNext;
+    }
 }
 
-static void fort_pending_packet_put_locked(PFORT_PENDING pending, PFORT_PENDING_PACKET pkt)
+inline static PFORT_PENDING_PACKET fort_pending_packet_get(PFORT_PENDING pending)
 {
-    pkt->next = pending->packet_free;
-    pending->packet_free = pkt;
+    return fort_packet_pool_get(&pending->packet_pool);
 }
 
-static void fort_pending_packet_put(PFORT_PENDING pending, PFORT_PENDING_PACKET pkt)
+inline static void fort_pending_packet_put(PFORT_PENDING pending, PFORT_PENDING_PACKET pkt)
 {
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&pending->lock, &lock_queue);
-
-    fort_pending_packet_put_locked(pending, pkt);
-
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+    fort_packet_pool_put(&pending->packet_pool, pkt);
 }
 
 static void fort_pending_packet_free(
@@ -377,7 +599,8 @@ static void NTAPI fort_packet_inject_complete(
 
     switch (pkt->flags & FORT_PACKET_TYPE_MASK) {
     case FORT_PACKET_TYPE_FLOW: {
-        fort_shaper_packet_free(&fort_device()->shaper, (PFORT_FLOW_PACKET) pkt, clonedNetBufList);
+        fort_shaper_packet_free_batch(
+                &fort_device()->shaper, (PFORT_FLOW_PACKET) pkt, clonedNetBufList);
     } break;
     case FORT_PACKET_TYPE_PENDING: {
         fort_pending_packet_free(
@@ -412,8 +635,8 @@ static NTSTATUS fort_packet_inject_out(const PFORT_PACKET_IO pkt, PNET_BUFFER_LI
             (FWPS_INJECT_COMPLETE0) &fort_packet_inject_complete, pkt);
 }
 
-inline static NTSTATUS fort_packet_clone(
-        PFORT_PACKET_IO pkt, PNET_BUFFER_LIST *clonedNetBufList, BOOL inbound)
+inline static NTSTATUS fort_packet_clone(PFORT_PACKET_IO pkt, PNET_BUFFER_LIST *clonedNetBufList,
+        NDIS_HANDLE nbl_pool, BOOL inbound)
 {
     NTSTATUS status;
 
@@ -424,9 +647,14 @@ inline static NTSTATUS fort_packet_clone(
                 NET_BUFFER_LIST_FIRST_NB(pkt->netBufList), bytesRetreated, 0, 0);
         if (!NT_SUCCESS(status))
             return status;
+
+        if ((pkt->flags & FORT_PACKET_ECN_CE) != 0) {
+            fort_packet_ecn_set_ce(NET_BUFFER_LIST_FIRST_NB(pkt->netBufList),
+                    (pkt->flags & FORT_PACKET_IP6) != 0);
+        }
     }
 
-    status = FwpsAllocateCloneNetBufferList0(pkt->netBufList, NULL, NULL, 0, clonedNetBufList);
+    status = FwpsAllocateCloneNetBufferList0(pkt->netBufList, nbl_pool, NULL, 0, clonedNetBufList);
 
     if (bytesRetreated != 0) {
         NdisAdvanceNetBufferDataStart(
@@ -436,45 +664,142 @@ inline static NTSTATUS fort_packet_clone(
     return status;
 }
 
-static NTSTATUS fort_packet_inject(PFORT_PACKET_IO pkt, PNET_BUFFER_LIST *clonedNetBufList)
+static NTSTATUS fort_packet_clone_checked(PFORT_PACKET_IO pkt, PNET_BUFFER_LIST *clonedNetBufList,
+        NDIS_HANDLE nbl_pool, BOOL inbound)
 {
-    NTSTATUS status;
-
-    const BOOL inbound = (pkt->flags & FORT_PACKET_INBOUND) != 0;
-
-    status = fort_packet_clone(pkt, clonedNetBufList, inbound);
+    const NTSTATUS status = fort_packet_clone(pkt, clonedNetBufList, nbl_pool, inbound);
     if (!NT_SUCCESS(status)) {
         LOG("Shaper: Packet clone error: %x\n", status);
         TRACE(FORT_SHAPER_PACKET_CLONE_ERROR, status, 0, 0);
-        return status;
     }
 
+    return status;
+}
+
+/* The completion is called once for the whole chain of cloned packets */
+static NTSTATUS fort_packet_inject_cloned(
+        const PFORT_PACKET_IO pkt, PNET_BUFFER_LIST clonedNetBufList, BOOL inbound)
+{
+    NTSTATUS status;
+
     const BOOL isIPv6 = (pkt->flags & FORT_PACKET_IP6) != 0;
     const ADDRESS_FAMILY addressFamily = (isIPv6 ? AF_INET6 : AF_INET);
     const HANDLE injection_id = fort_packet_injection_id(isIPv6);
 
-    status = inbound ? fort_packet_inject_in(pkt, *clonedNetBufList, injection_id, addressFamily)
-                     : fort_packet_inject_out(pkt, *clonedNetBufList, injection_id, addressFamily);
+    status = inbound ? fort_packet_inject_in(pkt, clonedNetBufList, injection_id, addressFamily)
+                     : fort_packet_inject_out(pkt, clonedNetBufList, injection_id, addressFamily);
     if (!NT_SUCCESS(status)) {
         LOG("Shaper: Packet injection call error: %x\n", status);
         TRACE(FORT_SHAPER_PACKET_INJECTION_CALL_ERROR, status, 0, 0);
 
-        (*clonedNetBufList)->Status = STATUS_SUCCESS;
+        for (PNET_BUFFER_LIST nbl = clonedNetBufList; nbl != NULL;
+                nbl = NET_BUFFER_LIST_NEXT_NBL(nbl)) {
+            nbl->Status = STATUS_SUCCESS;
+        }
     }
 
     return status;
 }
 
-static void fort_shaper_packet_inject(PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt)
+static BOOL fort_packet_is_same_path(const PFORT_PACKET_IO pkt, const PFORT_PACKET_IO pkt_first)
 {
-    NTSTATUS status;
+    if (pkt->flags != pkt_first->flags || pkt->compartmentId != pkt_first->compartmentId)
+        return FALSE;
+
+    if ((pkt->flags & FORT_PACKET_INBOUND) != 0) {
+        return pkt->in.interfaceIndex == pkt_first->in.interfaceIndex
+                && pkt->in.subInterfaceIndex == pkt_first->in.subInterfaceIndex;
+    }
+
+    /* The control data is sent per injection */
+    return pkt->out.controlData == NULL && pkt_first->out.controlData == NULL
+            && pkt->out.endpointHandle == pkt_first->out.endpointHandle
+            && pkt->out.remoteScopeId.Value == pkt_first->out.remoteScopeId.Value
+            && RtlEqualMemory(&pkt->out.remoteAddr, &pkt_first->out.remoteAddr, sizeof(ip_addr_t));
+}
 
-    PNET_BUFFER_LIST clonedNetBufList = NULL;
+static void fort_shaper_inject_batch_add(PFORT_SHAPER shaper, UINT32 count)
+{
+    const UINT32 index = tommy_ilog2_u32(count);
+
+    InterlockedIncrement64(&shaper->inject_batches[index]);
 
-    status = fort_packet_inject(&pkt->io, &clonedNetBufList);
+    fort_perf_add(&fort_device()->perf, FORT_PERF_SHAPER_INJECTS, count);
+
+    fort_etw_shaper_inject(count);
+}
+
+static void fort_shaper_packet_inject_batch(PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt)
+{
+    const BOOL inbound = (pkt->io.flags & FORT_PACKET_INBOUND) != 0;
+
+    PFORT_FLOW_PACKET pkt_head = NULL;
+    PFORT_FLOW_PACKET pkt_tail = NULL;
+    PNET_BUFFER_LIST cloned_head = NULL;
+    PNET_BUFFER_LIST cloned_tail = NULL;
+    UINT32 count = 0;
+
+    /* Clone the packets to one chain */
+    while (pkt != NULL) {
+        PFORT_FLOW_PACKET pkt_next = pkt->next;
+        pkt->next = NULL;
+
+        PNET_BUFFER_LIST clonedNetBufList = NULL;
+
+        const NTSTATUS status =
+                fort_packet_clone_checked(&pkt->io, &clonedNetBufList, shaper->nbl_pool, inbound);
+
+        if (!NT_SUCCESS(status)) {
+            fort_shaper_packet_drop(shaper, pkt);
+        } else {
+            if (pkt_tail == NULL) {
+                pkt_head = pkt;
+                cloned_head = clonedNetBufList;
+            } else {
+                pkt_tail->next = pkt;
+                NET_BUFFER_LIST_NEXT_NBL(cloned_tail) = clonedNetBufList;
+            }
+
+            pkt_tail = pkt;
+            cloned_tail = clonedNetBufList;
+
+            ++count;
+        }
+
+        pkt = pkt_next;
+    }
+
+    if (pkt_head == NULL)
+        return;
+
+    fort_shaper_inject_batch_add(shaper, count);
+
+    const NTSTATUS status = fort_packet_inject_cloned(&pkt_head->io, cloned_head, inbound);
 
     if (!NT_SUCCESS(status)) {
-        fort_shaper_packet_free(shaper, pkt, clonedNetBufList);
+        fort_shaper_packet_free_batch(shaper, pkt_head, cloned_head);
+    }
+}
+
+static void fort_shaper_packet_inject_chain(PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt)
+{
+    while (pkt != NULL) {
+        PFORT_FLOW_PACKET pkt_first = pkt;
+        PFORT_FLOW_PACKET pkt_last = pkt;
+        UINT32 count = 1;
+
+        /* Group the consecutive packets of the same path */
+        for (pkt = pkt->next; pkt != NULL && count < FORT_DEVICE_STATS_INJECT_BATCH_MAX;
+                pkt = pkt->next, ++count) {
+            if (!fort_packet_is_same_path(&pkt->io, &pkt_first->io))
+                break;
+
+            pkt_last = pkt;
+        }
+
+        pkt_last->next = NULL;
+
+        fort_shaper_packet_inject_batch(shaper, pkt_first);
     }
 }
 
@@ -573,22 +898,295 @@ static PFORT_FLOW_PACKET fort_shaper_packet_list_get_flow_packets(
     return pkt_chain;
 }
 
-static void fort_shaper_queue_process_bandwidth(
+inline static PFORT_PACKET_FLOW_QUEUE fort_shaper_fq_flow_queue(
+        PFORT_PACKET_QUEUE queue, PFORT_FLOW flow)
+{
+    /* The flows of a process share its flow queue */
+    const UINT32 key = (queue->fq_flags & FORT_SPEED_LIMIT_FQ_PROC) != 0
+            ? flow->opt.proc_index
+            : (UINT32) ((UINT_PTR) flow >> 4);
+
+    const UINT32 hash = tommy_inthash_u32(key);
+
+    return &queue->fq->flow_queues[hash & (FORT_PACKET_FLOW_QUEUE_COUNT - 1)];
+}
+
+static void fort_shaper_fq_activate(PFORT_PACKET_FQ fq, PFORT_PACKET_FLOW_QUEUE flow_queue)
+{
+    flow_queue->active = TRUE;
+    flow_queue->deficit = FORT_QUEUE_FQ_QUANTUM;
+    flow_queue->above_tick = 0;
+
+    /* New flows are served first within their quantum */
+    flow_queue->next_active = fq->active_head;
+    fq->active_head = flow_queue;
+
+    if (fq->active_tail == NULL) {
+        fq->active_tail = flow_queue;
+    }
+}
+
+static void fort_shaper_fq_deactivate(PFORT_PACKET_FQ fq, PFORT_PACKET_FLOW_QUEUE flow_queue)
+{
+    PFORT_PACKET_FLOW_QUEUE prev = NULL;
+    PFORT_PACKET_FLOW_QUEUE item = fq->active_head;
+
+    while (item != flow_queue) {
+        prev = item;
+        item = item->next_active;
+    }
+
+    if (prev != NULL) {
+        prev->next_active = flow_queue->next_active;
+    } else {
+        fq->active_head = flow_queue->next_active;
+    }
+
+    if (fq->active_tail == flow_queue) {
+        fq->active_tail = prev;
+    }
+
+    flow_queue->next_active = NULL;
+    flow_queue->active = FALSE;
+    flow_queue->deficit = 0;
+}
+
+static void fort_shaper_fq_rotate(PFORT_PACKET_FQ fq)
+{
+    PFORT_PACKET_FLOW_QUEUE flow_queue = fq->active_head;
+
+    if (flow_queue == fq->active_tail)
+        return;
+
+    fq->active_head = flow_queue->next_active;
+
+    flow_queue->next_active = NULL;
+    fq->active_tail->next_active = flow_queue;
+    fq->active_tail = flow_queue;
+}
+
+static BOOL fort_shaper_fq_add_packet(PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt)
+{
+    PFORT_PACKET_FQ fq = queue->fq;
+    PFORT_PACKET_FLOW_QUEUE flow_queue = fort_shaper_fq_flow_queue(queue, pkt->flow);
+
+    fort_shaper_packet_list_add(&flow_queue->packet_list, pkt);
+
+    flow_queue->queued_bytes += pkt->data_length;
+
+    if (flow_queue->active)
+        return FALSE;
+
+    fort_shaper_fq_activate(fq, flow_queue);
+
+    return TRUE;
+}
+
+static PFORT_FLOW_PACKET fort_shaper_fq_cut_head(
+        PFORT_PACKET_QUEUE queue, PFORT_PACKET_FLOW_QUEUE flow_queue)
+{
+    PFORT_FLOW_PACKET pkt = flow_queue->packet_list.packet_head;
+
+    fort_shaper_packet_list_cut_chain(&flow_queue->packet_list, pkt);
+
+    flow_queue->queued_bytes -= pkt->data_length;
+    queue->queued_bytes -= pkt->data_length;
+
+    if (fort_shaper_packet_list_is_empty(&flow_queue->packet_list)) {
+        fort_shaper_fq_deactivate(queue->fq, flow_queue);
+    }
+
+    return pkt;
+}
+
+static PFORT_PACKET_FLOW_QUEUE fort_shaper_fq_fattest(PFORT_PACKET_FQ fq)
+{
+    PFORT_PACKET_FLOW_QUEUE fattest = NULL;
+    UINT32 queued_bytes = 0;
+
+    for (PFORT_PACKET_FLOW_QUEUE flow_queue = fq->active_head; flow_queue != NULL;
+            flow_queue = flow_queue->next_active) {
+        if (queued_bytes < flow_queue->queued_bytes) {
+            queued_bytes = flow_queue->queued_bytes;
+            fattest = flow_queue;
+        }
+    }
+
+    return fattest;
+}
+
+inline static BOOL fort_shaper_packet_sojourn_is_above(
+        PFORT_SHAPER shaper, PFORT_FLOW_PACKET pkt, const LARGE_INTEGER now)
+{
+    const INT64 qpcFrequency = shaper->qpcFrequency.QuadPart;
+    const INT64 sojourn = now.QuadPart - pkt->latency_start.QuadPart;
+
+    return sojourn >= (FORT_QUEUE_FQ_TARGET_MS * qpcFrequency) / 1000LL;
+}
+
+inline static void fort_shaper_queue_sojourn_add(
+        PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt, const LARGE_INTEGER now)
+{
+    const INT64 sojourn = now.QuadPart - pkt->latency_start.QuadPart;
+
+    if (queue->sojourn_max < sojourn) {
+        queue->sojourn_max = sojourn;
+    }
+}
+
+inline static void fort_shaper_queue_drop_add(PFORT_PACKET_QUEUE queue, ULONG data_length)
+{
+    ++queue->stat.dropped_packets;
+    queue->stat.dropped_bytes += data_length;
+}
+
+inline static BOOL fort_shaper_packet_ecn_mark(PFORT_FLOW_PACKET pkt)
+{
+    if ((pkt->io.flags & FORT_PACKET_ECN_CAPABLE) == 0)
+        return FALSE;
+
+    pkt->io.flags |= FORT_PACKET_ECN_CE;
+
+    return TRUE;
+}
+
+static BOOL fort_shaper_fq_check_sojourn(PFORT_SHAPER shaper,
+        PFORT_PACKET_FLOW_QUEUE flow_queue, PFORT_FLOW_PACKET pkt, const LARGE_INTEGER now)
+{
+    const INT64 qpcFrequency = shaper->qpcFrequency.QuadPart;
+
+    /* The flow queue drains well */
+    if (!fort_shaper_packet_sojourn_is_above(shaper, pkt, now)
+            || flow_queue->queued_bytes <= FORT_QUEUE_FQ_QUANTUM) {
+        flow_queue->above_tick = 0;
+        return TRUE;
+    }
+
+    const INT64 interval = (FORT_QUEUE_FQ_INTERVAL_MS * qpcFrequency) / 1000LL;
+
+    if (flow_queue->above_tick == 0) {
+        flow_queue->above_tick = now.QuadPart + interval;
+        return TRUE;
+    }
+
+    if (now.QuadPart < flow_queue->above_tick)
+        return TRUE;
+
+    /* Drop or mark a packet per interval, while the sojourn time stays above the target */
+    flow_queue->above_tick = now.QuadPart + interval;
+
+    return fort_shaper_packet_ecn_mark(pkt);
+}
+
+static PFORT_FLOW_PACKET fort_shaper_fq_get_packets(PFORT_PACKET_FQ fq, PFORT_FLOW_PACKET pkt)
+{
+    for (PFORT_PACKET_FLOW_QUEUE flow_queue = fq->active_head; flow_queue != NULL;
+            flow_queue = flow_queue->next_active) {
+        pkt = fort_shaper_packet_list_get(&flow_queue->packet_list, pkt);
+    }
+
+    RtlZeroMemory(fq, sizeof(FORT_PACKET_FQ));
+
+    return pkt;
+}
+
+static PFORT_FLOW_PACKET fort_shaper_fq_get_flow_packets(
+        PFORT_PACKET_QUEUE queue, PFORT_FLOW flow, PFORT_FLOW_PACKET pkt)
+{
+    PFORT_PACKET_FQ fq = queue->fq;
+    PFORT_PACKET_FLOW_QUEUE flow_queue = fort_shaper_fq_flow_queue(queue, flow);
+
+    if (!flow_queue->active)
+        return pkt;
+
+    pkt = fort_shaper_packet_list_get_flow_packets(&flow_queue->packet_list, flow, pkt);
+
+    /* Re-count the rest packets of the hashed flows or of the process */
+    UINT32 queued_bytes = 0;
+
+    for (PFORT_FLOW_PACKET rest = flow_queue->packet_list.packet_head; rest != NULL;
+            rest = rest->next) {
+        queued_bytes += rest->data_length;
+    }
+
+    queue->queued_bytes -= (flow_queue->queued_bytes - queued_bytes);
+    flow_queue->queued_bytes = queued_bytes;
+
+    if (fort_shaper_packet_list_is_empty(&flow_queue->packet_list)) {
+        fort_shaper_fq_deactivate(fq, flow_queue);
+    }
+
+    return pkt;
+}
+
+inline static BOOL fort_shaper_queue_bandwidth_is_empty(PFORT_PACKET_QUEUE queue)
+{
+    return (queue->fq != NULL) ? (queue->fq->active_head == NULL)
+                               : fort_shaper_packet_list_is_empty(&queue->bandwidth_list);
+}
+
+inline static PFORT_FLOW_PACKET fort_shaper_queue_bandwidth_head(PFORT_PACKET_QUEUE queue)
+{
+    if (queue->fq != NULL) {
+        PFORT_PACKET_FLOW_QUEUE flow_queue = queue->fq->active_head;
+
+        return (flow_queue != NULL) ? flow_queue->packet_list.packet_head : NULL;
+    }
+
+    return queue->bandwidth_list.packet_head;
+}
+
+static UINT64 fort_shaper_queue_burst_bytes(PFORT_SHAPER shaper, const PFORT_PACKET_QUEUE queue)
+{
+    UINT64 burst_bytes;
+
+    if ((queue->limit.flags & FORT_SPEED_LIMIT_PACING) != 0) {
+        /* Keep only the bytes of a clock tick, as the timer can't fire earlier */
+        burst_bytes = (queue->limit.bps * shaper->timeIncrement) / 10000000LL;
+    } else {
+        burst_bytes = (queue->limit.burst_bytes != 0)
+                ? queue->limit.burst_bytes
+                : (queue->limit.bps * FORT_QUEUE_BURST_DEFAULT_MS) / 1000LL;
+    }
+
+    return (burst_bytes > FORT_QUEUE_INITIAL_TOKEN_COUNT) ? burst_bytes
+                                                          : FORT_QUEUE_INITIAL_TOKEN_COUNT;
+}
+
+static void fort_shaper_queue_advance_bandwidth(
         PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now)
 {
+    const UINT64 qpcFrequency = shaper->qpcFrequency.QuadPart;
     const UINT64 bps = queue->limit.bps;
 
-    /* Advance the available bytes */
-    const UINT64 accumulated =
-            ((now.QuadPart - queue->last_tick.QuadPart) * bps) / shaper->qpcFrequency.QuadPart;
-    queue->available_bytes += accumulated;
+    const UINT64 elapsed = now.QuadPart - queue->last_tick.QuadPart;
+
+    /* Advance the available bytes: split the elapsed ticks to avoid the overflow
+     * and carry the fraction of byte in 1/qpcFrequency units */
+    const UINT64 elapsed_secs = elapsed / qpcFrequency;
+    const UINT64 fraction = (elapsed % qpcFrequency) * bps + queue->available_fraction;
 
-    if (fort_shaper_packet_list_is_empty(&queue->bandwidth_list)
-            && queue->available_bytes > FORT_QUEUE_INITIAL_TOKEN_COUNT) {
-        queue->available_bytes = FORT_QUEUE_INITIAL_TOKEN_COUNT;
+    queue->available_bytes += elapsed_secs * bps + fraction / qpcFrequency;
+    queue->available_fraction = fraction % qpcFrequency;
+
+    if (fort_shaper_queue_bandwidth_is_empty(queue)) {
+        const UINT64 burst_bytes = fort_shaper_queue_burst_bytes(shaper, queue);
+
+        if (queue->available_bytes > burst_bytes) {
+            queue->available_bytes = burst_bytes;
+            queue->available_fraction = 0;
+        }
     }
 
     queue->last_tick = now;
+}
+
+static void fort_shaper_queue_process_bandwidth(
+        PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now)
+{
+    const UINT64 bps = queue->limit.bps;
+
+    fort_shaper_queue_advance_bandwidth(shaper, queue, now);
 
     /* Move packets to the latency queue as the accumulated available bytes will allow */
     PFORT_FLOW_PACKET pkt_chain = queue->bandwidth_list.packet_head;
@@ -604,6 +1202,13 @@ static void fort_shaper_queue_process_bandwidth(
         queue->available_bytes -= pkt->data_length;
         queue->queued_bytes -= pkt->data_length;
 
+        /* Mark the packets delayed above the target */
+        if (fort_shaper_packet_sojourn_is_above(shaper, pkt, now)) {
+            fort_shaper_packet_ecn_mark(pkt);
+        }
+
+        fort_shaper_queue_sojourn_add(queue, pkt, now);
+
         pkt->latency_start = now;
 
         pkt_tail = pkt;
@@ -617,6 +1222,54 @@ static void fort_shaper_queue_process_bandwidth(
     }
 }
 
+static PFORT_FLOW_PACKET fort_shaper_queue_process_fq(
+        PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now)
+{
+    const UINT64 bps = queue->limit.bps;
+
+    fort_shaper_queue_advance_bandwidth(shaper, queue, now);
+
+    PFORT_PACKET_FQ fq = queue->fq;
+    PFORT_PACKET_FLOW_QUEUE flow_queue;
+    PFORT_FLOW_PACKET pkt_drop = NULL;
+
+    /* Move packets of the flows to the latency queue in the deficit round robin order */
+    while ((flow_queue = fq->active_head) != NULL) {
+        PFORT_FLOW_PACKET pkt = flow_queue->packet_list.packet_head;
+
+        if (flow_queue->deficit < (INT32) pkt->data_length) {
+            flow_queue->deficit += FORT_QUEUE_FQ_QUANTUM;
+
+            fort_shaper_fq_rotate(fq);
+            continue;
+        }
+
+        if (bps != 0LL && queue->available_bytes < pkt->data_length)
+            break;
+
+        fort_shaper_fq_cut_head(queue, flow_queue);
+
+        fort_shaper_queue_sojourn_add(queue, pkt, now);
+
+        if (!fort_shaper_fq_check_sojourn(shaper, flow_queue, pkt, now)) {
+            fort_shaper_queue_drop_add(queue, pkt->data_length);
+
+            pkt->next = pkt_drop;
+            pkt_drop = pkt;
+            continue;
+        }
+
+        flow_queue->deficit -= (INT32) pkt->data_length;
+        queue->available_bytes -= pkt->data_length;
+
+        pkt->latency_start = now;
+
+        fort_shaper_packet_list_add(&queue->latency_list, pkt);
+    }
+
+    return pkt_drop;
+}
+
 static PFORT_FLOW_PACKET fort_shaper_queue_process_latency(
         PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now)
 {
@@ -641,6 +1294,9 @@ static PFORT_FLOW_PACKET fort_shaper_queue_process_latency(
         if (elapsed_ms < latency_ms)
             break;
 
+        ++queue->stat.passed_packets;
+        queue->stat.passed_bytes += pkt->data_length;
+
         pkt_tail = pkt;
         pkt = pkt->next;
     } while (pkt != NULL);
@@ -654,14 +1310,64 @@ static PFORT_FLOW_PACKET fort_shaper_queue_process_latency(
     return NULL;
 }
 
+static INT64 fort_shaper_queue_next_tick(PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue)
+{
+    const INT64 qpcFrequency = shaper->qpcFrequency.QuadPart;
+
+    INT64 next_tick = FORT_QUEUE_NEXT_TICK_NONE;
+
+    /* The head packet's latency deadline */
+    PFORT_FLOW_PACKET pkt = queue->latency_list.packet_head;
+    if (pkt != NULL) {
+        next_tick = pkt->latency_start.QuadPart
+                + ((INT64) queue->limit.latency_ms * qpcFrequency) / 1000LL;
+    }
+
+    /* The head packet's tokens deficit */
+    pkt = fort_shaper_queue_bandwidth_head(queue);
+    if (pkt != NULL) {
+        const UINT64 bps = queue->limit.bps;
+        const UINT64 deficit = (pkt->data_length > queue->available_bytes)
+                ? (pkt->data_length - queue->available_bytes)
+                : 0;
+
+        /* Round up the ticks to get the whole deficit with the carried fraction */
+        const UINT64 deficit_ticks = (deficit == 0 || bps == 0LL)
+                ? 0
+                : ((deficit * qpcFrequency - queue->available_fraction) + bps - 1) / bps;
+
+        const INT64 bandwidth_tick = queue->last_tick.QuadPart + (INT64) deficit_ticks;
+
+        if (next_tick > bandwidth_tick) {
+            next_tick = bandwidth_tick;
+        }
+    }
+
+    return next_tick;
+}
+
+static PFORT_FLOW_PACKET fort_shaper_queue_get_packets_locked(
+        PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt)
+{
+    pkt = fort_shaper_packet_list_get(&queue->latency_list, pkt);
+    pkt = fort_shaper_packet_list_get(&queue->bandwidth_list, pkt);
+
+    if (queue->fq != NULL) {
+        pkt = fort_shaper_fq_get_packets(queue->fq, pkt);
+    }
+
+    queue->queued_bytes = 0;
+
+    return pkt;
+}
+
 static PFORT_FLOW_PACKET fort_shaper_queue_get_packets(
         PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt)
 {
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&queue->lock, &lock_queue);
 
-    pkt = fort_shaper_packet_list_get(&queue->latency_list, pkt);
-    pkt = fort_shaper_packet_list_get(&queue->bandwidth_list, pkt);
+    pkt = fort_shaper_queue_get_packets_locked(queue, pkt);
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
@@ -677,6 +1383,13 @@ static PFORT_FLOW_PACKET fort_shaper_queue_get_flow_packets(
     pkt = fort_shaper_packet_list_get_flow_packets(&queue->bandwidth_list, flow, pkt);
     pkt = fort_shaper_packet_list_get_flow_packets(&queue->latency_list, flow, pkt);
 
+    if (queue->fq != NULL) {
+        pkt = fort_shaper_fq_get_flow_packets(queue, flow, pkt);
+    }
+
+    /* The head packets may be changed */
+    queue->next_tick = 0;
+
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
     return pkt;
@@ -684,31 +1397,49 @@ static PFORT_FLOW_PACKET fort_shaper_queue_get_flow_packets(
 
 inline static BOOL fort_shaper_queue_is_empty(PFORT_PACKET_QUEUE queue)
 {
-    return fort_shaper_packet_list_is_empty(&queue->bandwidth_list)
+    return fort_shaper_queue_bandwidth_is_empty(queue)
             && fort_shaper_packet_list_is_empty(&queue->latency_list);
 }
 
 static BOOL fort_shaper_queue_process(
-        PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now)
+        PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue, const LARGE_INTEGER now, INT64 *next_tick)
 {
     PFORT_FLOW_PACKET pkt_chain = NULL;
+    PFORT_FLOW_PACKET pkt_drop = NULL;
     BOOL is_active = FALSE;
 
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&queue->lock, &lock_queue);
 
     if (!fort_shaper_queue_is_empty(queue)) {
-        fort_shaper_queue_process_bandwidth(shaper, queue, now);
+        /* Skip the queue till its head packets are eligible for release */
+        if (queue->next_tick <= now.QuadPart) {
+            if (queue->fq != NULL) {
+                pkt_drop = fort_shaper_queue_process_fq(shaper, queue, now);
+            } else {
+                fort_shaper_queue_process_bandwidth(shaper, queue, now);
+            }
 
-        pkt_chain = fort_shaper_queue_process_latency(shaper, queue, now);
+            pkt_chain = fort_shaper_queue_process_latency(shaper, queue, now);
+
+            queue->next_tick = fort_shaper_queue_next_tick(shaper, queue);
+        }
 
         is_active = !fort_shaper_queue_is_empty(queue);
+
+        if (is_active && *next_tick > queue->next_tick) {
+            *next_tick = queue->next_tick;
+        }
     }
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
+    if (pkt_drop != NULL) {
+        fort_shaper_packet_foreach(shaper, pkt_drop, &fort_shaper_packet_drop);
+    }
+
     if (pkt_chain != NULL) {
-        fort_shaper_packet_foreach(shaper, pkt_chain, &fort_shaper_packet_inject);
+        fort_shaper_packet_inject_chain(shaper, pkt_chain);
     }
 
     return is_active;
@@ -720,22 +1451,61 @@ inline static PFORT_PACKET_QUEUE fort_shaper_create_queue(PFORT_SHAPER shaper, i
     if (queue != NULL)
         return queue;
 
-    queue = fort_mem_alloc(sizeof(FORT_PACKET_QUEUE), FORT_PACKET_POOL_TAG);
-    if (queue == NULL)
-        return NULL;
+    queue = fort_mem_type_alloc(FORT_MEM_PACKET, sizeof(FORT_PACKET_QUEUE));
+    if (queue == NULL)
+        return NULL;
+
+    RtlZeroMemory(queue, sizeof(FORT_PACKET_QUEUE));
+
+    KeInitializeSpinLock(&queue->lock);
+
+    shaper->queues[queue_index] = queue;
+
+    return queue;
+}
+
+static PFORT_FLOW_PACKET fort_shaper_queue_set_fq(
+        PFORT_PACKET_QUEUE queue, UINT16 fq_flags, PFORT_FLOW_PACKET pkt_chain)
+{
+    const BOOL fq_enabled = (fq_flags != 0);
+
+    if (fq_enabled == (queue->fq != NULL) && fq_flags == queue->fq_flags)
+        return pkt_chain;
+
+    PFORT_PACKET_FQ fq = fq_enabled ? queue->fq : NULL;
+
+    if (fq_enabled && fq == NULL) {
+        fq = fort_mem_type_alloc(FORT_MEM_PACKET, sizeof(FORT_PACKET_FQ));
+        if (fq == NULL)
+            return pkt_chain; /* keep the FIFO mode */
+
+        RtlZeroMemory(fq, sizeof(FORT_PACKET_FQ));
+    }
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&queue->lock, &lock_queue);
+
+    /* Release the queued packets on the mode or the hashing switch */
+    pkt_chain = fort_shaper_queue_get_packets_locked(queue, pkt_chain);
 
-    RtlZeroMemory(queue, sizeof(FORT_PACKET_QUEUE));
+    PFORT_PACKET_FQ old_fq = queue->fq;
+    queue->fq = fq;
+    queue->fq_flags = fq_flags;
 
-    KeInitializeSpinLock(&queue->lock);
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
 
-    shaper->queues[queue_index] = queue;
+    if (old_fq != NULL && old_fq != fq) {
+        fort_mem_type_free(FORT_MEM_PACKET, old_fq);
+    }
 
-    return queue;
+    return pkt_chain;
 }
 
-static void fort_shaper_create_queues(
+static PFORT_FLOW_PACKET fort_shaper_create_queues(
         PFORT_SHAPER shaper, PFORT_SPEED_LIMIT limits, UINT32 limit_io_bits)
 {
+    PFORT_FLOW_PACKET pkt_chain = NULL;
+
     for (int i = 0; limit_io_bits != 0; ++i) {
         const BOOL queue_exists = (limit_io_bits & 1) != 0;
         limit_io_bits >>= 1;
@@ -748,7 +1518,32 @@ static void fort_shaper_create_queues(
             continue;
 
         queue->limit = limits[i];
+
+        const UINT16 fq_flags = (queue->limit.flags & FORT_SPEED_LIMIT_FQ_MASK);
+
+        pkt_chain = fort_shaper_queue_set_fq(queue, fq_flags, pkt_chain);
+    }
+
+    return pkt_chain;
+}
+
+static UINT32 fort_shaper_packet_reserve_count(const PFORT_SPEED_LIMIT limits, UINT32 limit_io_bits)
+{
+    UINT64 buffer_bytes = 0;
+
+    for (int i = 0; limit_io_bits != 0; ++i) {
+        const BOOL queue_exists = (limit_io_bits & 1) != 0;
+        limit_io_bits >>= 1;
+
+        if (queue_exists) {
+            buffer_bytes += limits[i].buffer_bytes;
+        }
     }
+
+    const UINT64 count = buffer_bytes / FORT_PACKET_RESERVE_BYTES;
+
+    return (count < FORT_SHAPER_PACKET_RESERVE_MAX) ? (UINT32) count
+                                                    : FORT_SHAPER_PACKET_RESERVE_MAX;
 }
 
 static void fort_shaper_init_queues(PFORT_SHAPER shaper, UINT32 group_io_bits)
@@ -770,38 +1565,68 @@ static void fort_shaper_init_queues(PFORT_SHAPER shaper, UINT32 group_io_bits)
             continue;
 
         queue->queued_bytes = 0;
-        queue->available_bytes = FORT_QUEUE_INITIAL_TOKEN_COUNT;
+        queue->available_bytes = fort_shaper_queue_burst_bytes(shaper, queue);
+        queue->available_fraction = 0;
         queue->last_tick = now;
+        queue->next_tick = 0;
     }
 }
 
 static void fort_shaper_free_queues(PFORT_SHAPER shaper)
 {
-    for (int i = 0; i < FORT_CONF_GROUP_MAX; ++i) {
+    for (int i = 0; i < FORT_CONF_GROUP_MAX * 2; ++i) {
         PFORT_PACKET_QUEUE queue = shaper->queues[i];
         if (queue == NULL)
             continue;
 
-        fort_mem_free(queue, FORT_PACKET_POOL_TAG);
+        if (queue->fq != NULL) {
+            fort_mem_type_free(FORT_MEM_PACKET, queue->fq);
+        }
+
+        fort_mem_type_free(FORT_MEM_PACKET, queue);
+    }
+}
+
+static void fort_shaper_timer_schedule(
+        PFORT_SHAPER shaper, INT64 next_tick, const LARGE_INTEGER now)
+{
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&shaper->timer_lock, &lock_queue);
+
+    /* Re-arm the timer for the earlier release time only */
+    const INT64 timer_due = shaper->timer_due;
+
+    if (timer_due == 0 || next_tick < timer_due) {
+        shaper->timer_due = next_tick;
+
+        const INT64 qpcFrequency = shaper->qpcFrequency.QuadPart;
+
+        /* Round up to 100-ns units not to fire before the release time */
+        const INT64 due_time = (next_tick > now.QuadPart)
+                ? ((next_tick - now.QuadPart) * 10000000LL + qpcFrequency - 1) / qpcFrequency
+                : 0;
+
+        fort_timer_set_due(&shaper->timer, due_time);
     }
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
-static void fort_shaper_timer_start(PFORT_SHAPER shaper)
+static void fort_shaper_timer_reset(PFORT_SHAPER shaper)
 {
-    const ULONG active_io_bits = fort_shaper_io_bits(&shaper->active_io_bits);
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&shaper->timer_lock, &lock_queue);
 
-    if (active_io_bits == 0)
-        return;
+    shaper->timer_due = 0;
 
-    fort_timer_set_running(&shaper->timer, /*run=*/TRUE);
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
-inline static ULONG fort_shaper_timer_process_queues(PFORT_SHAPER shaper, ULONG active_io_bits)
+inline static ULONG fort_shaper_timer_process_queues(
+        PFORT_SHAPER shaper, ULONG active_io_bits, const LARGE_INTEGER now, INT64 *next_tick)
 {
     ULONG new_active_io_bits = 0;
 
-    const LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
-
     for (int i = 0; active_io_bits != 0; ++i) {
         const BOOL queue_exists = (active_io_bits & 1) != 0;
         active_io_bits >>= 1;
@@ -813,7 +1638,7 @@ inline static ULONG fort_shaper_timer_process_queues(PFORT_SHAPER shaper, ULONG
         if (queue == NULL)
             continue;
 
-        if (fort_shaper_queue_process(shaper, queue, now)) {
+        if (fort_shaper_queue_process(shaper, queue, now, next_tick)) {
             new_active_io_bits |= (1 << i);
         }
     }
@@ -827,18 +1652,23 @@ static void fort_shaper_timer_process(void)
 
     PFORT_SHAPER shaper = &fort_device()->shaper;
 
+    fort_shaper_timer_reset(shaper);
+
     ULONG active_io_bits =
             fort_shaper_io_bits_set(&shaper->active_io_bits, FORT_PACKET_FLUSH_ALL, FALSE);
 
     if (active_io_bits == 0)
         return;
 
-    active_io_bits = fort_shaper_timer_process_queues(shaper, active_io_bits);
+    const LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+    INT64 next_tick = FORT_QUEUE_NEXT_TICK_NONE;
+
+    active_io_bits = fort_shaper_timer_process_queues(shaper, active_io_bits, now, &next_tick);
 
     if (active_io_bits != 0) {
         fort_shaper_io_bits_set(&shaper->active_io_bits, active_io_bits, TRUE);
 
-        fort_shaper_timer_start(shaper);
+        fort_shaper_timer_schedule(shaper, next_tick, now);
     }
 }
 
@@ -875,8 +1705,46 @@ static void fort_shaper_flush(PFORT_SHAPER shaper, UINT32 group_io_bits, BOOL dr
 
     /* Process the packets */
     if (pkt_chain != NULL) {
-        fort_shaper_packet_foreach(
-                shaper, pkt_chain, (drop ? &fort_shaper_packet_drop : &fort_shaper_packet_inject));
+        if (drop) {
+            fort_shaper_packet_foreach(shaper, pkt_chain, &fort_shaper_packet_drop);
+        } else {
+            fort_shaper_packet_inject_chain(shaper, pkt_chain);
+        }
+    }
+}
+
+static void fort_shaper_nbl_pool_open(PFORT_SHAPER shaper)
+{
+    /* The clones are allocated from the default pool on failure */
+    PNDIS_GENERIC_OBJECT pool_owner =
+            NdisAllocateGenericObject(/*driverObject=*/NULL, FORT_PACKET_POOL_TAG, 0);
+    if (pool_owner == NULL)
+        return;
+
+    NET_BUFFER_LIST_POOL_PARAMETERS params;
+    RtlZeroMemory(&params, sizeof(NET_BUFFER_LIST_POOL_PARAMETERS));
+
+    params.Header.Type = NDIS_OBJECT_TYPE_DEFAULT;
+    params.Header.Revision = NET_BUFFER_LIST_POOL_PARAMETERS_REVISION_1;
+    params.Header.Size = NDIS_SIZEOF_NET_BUFFER_LIST_POOL_PARAMETERS_REVISION_1;
+    params.ProtocolId = NDIS_PROTOCOL_ID_DEFAULT;
+    params.fAllocateNetBuffer = TRUE;
+    params.PoolTag = FORT_PACKET_POOL_TAG;
+
+    shaper->nbl_pool_owner = pool_owner;
+    shaper->nbl_pool = NdisAllocateNetBufferListPool(pool_owner, &params);
+}
+
+static void fort_shaper_nbl_pool_close(PFORT_SHAPER shaper)
+{
+    if (shaper->nbl_pool != NULL) {
+        NdisFreeNetBufferListPool(shaper->nbl_pool);
+        shaper->nbl_pool = NULL;
+    }
+
+    if (shaper->nbl_pool_owner != NULL) {
+        NdisFreeGenericObject((PNDIS_GENERIC_OBJECT) shaper->nbl_pool_owner);
+        shaper->nbl_pool_owner = NULL;
     }
 }
 
@@ -884,13 +1752,17 @@ FORT_API void fort_shaper_open(PFORT_SHAPER shaper)
 {
     const LARGE_INTEGER now = KeQueryPerformanceCounter(&shaper->qpcFrequency);
     shaper->randomSeed = now.LowPart;
+    shaper->timeIncrement = KeQueryTimeIncrement();
+
+    fort_packet_pool_open(&shaper->packet_pool, sizeof(FORT_FLOW_PACKET));
 
-    tommy_arrayof_init(&shaper->packets, sizeof(FORT_FLOW_PACKET));
+    fort_shaper_nbl_pool_open(shaper);
 
     KeInitializeSpinLock(&shaper->lock);
+    KeInitializeSpinLock(&shaper->timer_lock);
 
     fort_timer_open(
-            &shaper->timer, /*period(ms)=*/1, FORT_TIMER_ONESHOT, &fort_shaper_timer_process);
+            &shaper->timer, /*period(ms)=*/0, FORT_TIMER_ONESHOT, &fort_shaper_timer_process);
 }
 
 FORT_API void fort_shaper_close(PFORT_SHAPER shaper)
@@ -900,19 +1772,26 @@ FORT_API void fort_shaper_close(PFORT_SHAPER shaper)
     fort_shaper_drop_packets(shaper);
     fort_shaper_free_queues(shaper);
 
-    tommy_arrayof_done(&shaper->packets);
+    fort_shaper_nbl_pool_close(shaper);
+
+    fort_packet_pool_close(&shaper->packet_pool);
 }
 
-FORT_API void fort_shaper_conf_update(PFORT_SHAPER shaper, const PFORT_CONF_IO conf_io)
+FORT_API void fort_shaper_conf_update(PFORT_SHAPER shaper, const PFORT_CONF_GROUP conf_group,
+        const PFORT_CONF_FLAGS conf_flags)
 {
-    const PFORT_CONF_GROUP conf_group = &conf_io->conf_group;
-    const PFORT_CONF_FLAGS conf_flags = &conf_io->conf.flags;
-
     const UINT32 limit_io_bits = conf_group->limit_io_bits;
     const UINT32 group_io_bits = conf_flags->filter_enabled
             ? (limit_io_bits & fort_bits_duplicate16(conf_group->group_bits))
             : 0;
     UINT32 flush_io_bits;
+    PFORT_FLOW_PACKET pkt_chain;
+
+    const NTSTATUS status = fort_packet_pool_reserve(&shaper->packet_pool,
+            fort_shaper_packet_reserve_count(conf_group->limits, limit_io_bits));
+    if (!NT_SUCCESS(status)) {
+        LOG("Shaper: Packet pool reserve error: %x\n", status);
+    }
 
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&shaper->lock, &lock_queue);
@@ -921,7 +1800,7 @@ FORT_API void fort_shaper_conf_update(PFORT_SHAPER shaper, const PFORT_CONF_IO c
 
         const UINT32 new_limit_io_bits = (flush_io_bits & limit_io_bits);
 
-        fort_shaper_create_queues(shaper, conf_group->limits, limit_io_bits);
+        pkt_chain = fort_shaper_create_queues(shaper, conf_group->limits, limit_io_bits);
         fort_shaper_init_queues(shaper, new_limit_io_bits);
 
         shaper->limit_io_bits = limit_io_bits;
@@ -930,6 +1809,10 @@ FORT_API void fort_shaper_conf_update(PFORT_SHAPER shaper, const PFORT_CONF_IO c
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
+    if (pkt_chain != NULL) {
+        fort_shaper_packet_inject_chain(shaper, pkt_chain);
+    }
+
     fort_shaper_flush(shaper, flush_io_bits, /*drop=*/FALSE);
 }
 
@@ -956,16 +1839,40 @@ void fort_shaper_conf_flags_update(PFORT_SHAPER shaper, const PFORT_CONF_FLAGS c
     fort_shaper_flush(shaper, flush_io_bits, /*drop=*/FALSE);
 }
 
-static void fort_shaper_packet_queue_add_packet(PFORT_PACKET_QUEUE queue, PFORT_FLOW_PACKET pkt)
+static BOOL fort_shaper_packet_queue_add_packet(PFORT_SHAPER shaper, PFORT_PACKET_QUEUE queue,
+        PFORT_FLOW_PACKET pkt, const LARGE_INTEGER now)
 {
+    BOOL is_head;
+
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&queue->lock, &lock_queue);
     {
+        is_head = fort_shaper_queue_bandwidth_is_empty(queue);
+
+        if (is_head) {
+            fort_shaper_queue_advance_bandwidth(shaper, queue, now);
+        }
+
         queue->queued_bytes += pkt->data_length;
 
-        fort_shaper_packet_list_add(&queue->bandwidth_list, pkt);
+        /* Time it was placed in the bandwidth or flow queue */
+        pkt->latency_start = now;
+
+        if (queue->fq != NULL) {
+            /* The new flow is served first */
+            is_head = fort_shaper_fq_add_packet(queue, pkt);
+        } else {
+            fort_shaper_packet_list_add(&queue->bandwidth_list, pkt);
+        }
+
+        /* The new head packet may be eligible for release right now */
+        if (is_head) {
+            queue->next_tick = 0;
+        }
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return is_head;
 }
 
 inline static BOOL fort_shaper_packet_queue_check_plr(PFORT_PACKET_QUEUE queue)
@@ -989,7 +1896,34 @@ inline static BOOL fort_shaper_packet_queue_check_buffer(
     return buffer_bytes == 0 || (UINT64) buffer_bytes >= (queue->queued_bytes + data_length);
 }
 
-static BOOL fort_shaper_packet_queue_check_packet(PFORT_PACKET_QUEUE queue, ULONG data_length)
+static BOOL fort_shaper_packet_queue_check_fq_buffer(PFORT_PACKET_QUEUE queue, PFORT_FLOW flow,
+        ULONG data_length, PFORT_FLOW_PACKET *pkt_drop)
+{
+    PFORT_PACKET_FQ fq = queue->fq;
+    if (fq == NULL)
+        return fort_shaper_packet_queue_check_buffer(queue, data_length);
+
+    PFORT_PACKET_FLOW_QUEUE flow_queue = fort_shaper_fq_flow_queue(queue, flow);
+
+    /* Drop the head packets of the fattest flow instead of the new one */
+    while (!fort_shaper_packet_queue_check_buffer(queue, data_length)) {
+        PFORT_PACKET_FLOW_QUEUE fattest = fort_shaper_fq_fattest(fq);
+        if (fattest == NULL || fattest == flow_queue)
+            return FALSE;
+
+        PFORT_FLOW_PACKET pkt = fort_shaper_fq_cut_head(queue, fattest);
+
+        fort_shaper_queue_drop_add(queue, pkt->data_length);
+
+        pkt->next = *pkt_drop;
+        *pkt_drop = pkt;
+    }
+
+    return TRUE;
+}
+
+static BOOL fort_shaper_packet_queue_check_packet(PFORT_PACKET_QUEUE queue, PFORT_FLOW flow,
+        ULONG data_length, PFORT_FLOW_PACKET *pkt_drop)
 {
     BOOL res;
 
@@ -997,7 +1931,11 @@ static BOOL fort_shaper_packet_queue_check_packet(PFORT_PACKET_QUEUE queue, ULON
     KeAcquireInStackQueuedSpinLock(&queue->lock, &lock_queue);
     {
         res = fort_shaper_packet_queue_check_plr(queue)
-                && fort_shaper_packet_queue_check_buffer(queue, data_length);
+                && fort_shaper_packet_queue_check_fq_buffer(queue, flow, data_length, pkt_drop);
+
+        if (!res) {
+            fort_shaper_queue_drop_add(queue, data_length);
+        }
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
@@ -1023,7 +1961,16 @@ inline static NTSTATUS fort_shaper_packet_queue(
     const ULONG data_length = fort_packet_data_length(ca->netBufList);
 
     /* Check the Queue for new Packet */
-    if (!fort_shaper_packet_queue_check_packet(queue, data_length))
+    PFORT_FLOW_PACKET pkt_drop = NULL;
+
+    const BOOL is_queued =
+            fort_shaper_packet_queue_check_packet(queue, flow, data_length, &pkt_drop);
+
+    if (pkt_drop != NULL) {
+        fort_shaper_packet_foreach(shaper, pkt_drop, &fort_shaper_packet_drop);
+    }
+
+    if (!is_queued)
         return STATUS_SUCCESS; /* drop the packet */
 
     /* Create the Packet */
@@ -1042,14 +1989,26 @@ inline static NTSTATUS fort_shaper_packet_queue(
     pkt->flow = flow;
     pkt->data_length = data_length;
 
+    /* The outbound packets have no IP header yet at the transport layer */
+    if ((queue->limit.flags & FORT_SPEED_LIMIT_ECN) != 0 && ca->inbound
+            && fort_packet_is_ecn_capable(ca, pkt->io.in.bytesRetreated)) {
+        pkt->io.flags |= FORT_PACKET_ECN_CAPABLE;
+    }
+
     /* Add the Packet to Queue */
-    fort_shaper_packet_queue_add_packet(queue, pkt);
+    const LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+
+    const BOOL is_head = fort_shaper_packet_queue_add_packet(shaper, queue, pkt, now);
+
+    fort_etw_shaper_enqueue(queue_index, data_length);
 
     /* Packets in transport layer must be re-injected in DCP due to locking */
     fort_shaper_io_bits_set(&shaper->active_io_bits, queue_bit, TRUE);
 
     /* Start the Timer */
-    fort_shaper_timer_start(shaper);
+    if (is_head) {
+        fort_shaper_timer_schedule(shaper, now.QuadPart, now);
+    }
 
     return STATUS_SUCCESS;
 }
@@ -1115,6 +2074,11 @@ FORT_API void fort_shaper_drop_flow_packets(PFORT_SHAPER shaper, UINT64 flowCont
     /* Drop the packets */
     if (pkt_chain != NULL) {
         fort_shaper_packet_foreach(shaper, pkt_chain, &fort_shaper_packet_drop);
+
+        /* Re-schedule the rest packets */
+        const LARGE_INTEGER now = KeQueryPerformanceCounter(NULL);
+
+        fort_shaper_timer_schedule(shaper, now.QuadPart, now);
     }
 }
 
@@ -1123,9 +2087,75 @@ FORT_API void fort_shaper_drop_packets(PFORT_SHAPER shaper)
     fort_shaper_flush(shaper, FORT_PACKET_FLUSH_ALL, /*drop=*/TRUE);
 }
 
+FORT_API void fort_shaper_inject_stats(PFORT_SHAPER shaper, UINT64 *inject_batches)
+{
+    for (int i = 0; i < FORT_DEVICE_STATS_INJECT_BATCH_COUNT; ++i) {
+        inject_batches[i] = (UINT64) InterlockedOr64(&shaper->inject_batches[i], 0);
+    }
+}
+
+FORT_API UINT64 fort_shaper_queued_bytes(PFORT_SHAPER shaper)
+{
+    UINT64 queued_bytes = 0;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&shaper->lock, &lock_queue);
+    {
+        for (int i = 0; i < FORT_CONF_GROUP_MAX * 2; ++i) {
+            const PFORT_PACKET_QUEUE queue = shaper->queues[i];
+
+            /* Approximate: the queue's lock isn't held */
+            if (queue != NULL) {
+                queued_bytes += queue->queued_bytes;
+            }
+        }
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return queued_bytes;
+}
+
+FORT_API UINT32 fort_shaper_group_io_bits(PFORT_SHAPER shaper)
+{
+    return fort_shaper_io_bits(&shaper->group_io_bits);
+}
+
+FORT_API BOOL fort_shaper_queue_stat_flush(PFORT_SHAPER shaper, int queue_index,
+        PFORT_SHAPER_STAT stat, UINT32 *sojourn_max_ms)
+{
+    PFORT_PACKET_QUEUE queue = shaper->queues[queue_index];
+    if (queue == NULL)
+        return FALSE;
+
+    INT64 sojourn_max;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&queue->lock, &lock_queue);
+    {
+        *stat = queue->stat;
+        stat->queued_bytes = queue->queued_bytes;
+
+        sojourn_max = queue->sojourn_max;
+
+        RtlZeroMemory(&queue->stat, sizeof(FORT_SHAPER_STAT));
+        queue->sojourn_max = 0;
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    /* The idle queue */
+    if (stat->queued_bytes == 0 && stat->passed_packets == 0 && stat->dropped_packets == 0)
+        return FALSE;
+
+    *sojourn_max_ms = (UINT32) ((sojourn_max * 1000LL) / shaper->qpcFrequency.QuadPart);
+
+    return TRUE;
+}
+
 static PFORT_PENDING_PROC fort_pending_proc_find_locked(PFORT_PENDING pending, UINT32 process_id)
 {
-    PFORT_PENDING_PROC proc = pending->procs_head;
+    const tommy_key_t pid_hash = fort_pending_proc_hash(process_id);
+
+    PFORT_PENDING_PROC proc = (PFORT_PENDING_PROC) fort_hash_bucket(&pending->procs_map, pid_hash);
 
     for (; proc != NULL; proc = proc->next) {
         if (proc->process_id == process_id)
@@ -1135,25 +2165,32 @@ static PFORT_PENDING_PROC fort_pending_proc_find_locked(PFORT_PENDING pending, U
     return NULL;
 }
 
-static BOOL fort_pending_proc_check_limits(PFORT_PENDING pending, UINT32 process_id)
+/* Returns FORT_PENDING_ADDED, when the packet can be added */
+static UCHAR fort_pending_proc_check_limits(PFORT_PENDING pending, UINT32 process_id)
 {
-    UINT16 proc_count = 0;
+    UCHAR res;
     UINT16 packet_count = 0;
 
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&pending->lock, &lock_queue);
 
-    proc_count = pending->proc_count;
-
     PFORT_PENDING_PROC proc = fort_pending_proc_find_locked(pending, process_id);
     if (proc != NULL) {
         packet_count = proc->packet_count;
     }
 
+    if (proc != NULL && proc->expired) {
+        res = pending->timeout_allow ? FORT_PENDING_EXPIRED_ALLOW : FORT_PENDING_EXPIRED_BLOCK;
+    } else {
+        res = (pending->proc_count < FORT_PENDING_PROC_COUNT_MAX
+                      && packet_count < pending->proc_packet_count_max)
+                ? FORT_PENDING_ADDED
+                : FORT_PENDING_ADD_FAILED;
+    }
+
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
-    return proc_count < FORT_PENDING_PROC_COUNT_MAX
-            && packet_count < FORT_PENDING_PROC_PACKET_COUNT_MAX;
+    return res;
 }
 
 static PFORT_PENDING_PROC fort_pending_proc_get_locked(PFORT_PENDING pending, UINT32 process_id)
@@ -1173,12 +2210,13 @@ static PFORT_PENDING_PROC fort_pending_proc_get_locked(PFORT_PENDING pending, UI
         proc = tommy_arrayof_ref(&pending->procs, size);
     }
 
+    const tommy_key_t pid_hash = fort_pending_proc_hash(process_id);
+
+    fort_hash_insert(&pending->procs_map, (tommy_node *) proc, /*data=*/NULL, pid_hash);
+
+    proc->process_id = process_id;
     proc->packets_head = NULL;
     proc->packet_count = 0;
-    proc->process_id = process_id;
-
-    proc->next = pending->procs_head;
-    pending->procs_head = proc;
 
     pending->proc_count++;
 
@@ -1193,7 +2231,7 @@ static PFORT_PENDING_PROC fort_pending_proc_get_check(PFORT_PENDING pending, UIN
         return fort_pending_proc_get_locked(pending, process_id);
     }
 
-    if (proc->packet_count >= FORT_PENDING_PROC_PACKET_COUNT_MAX)
+    if (proc->packet_count >= pending->proc_packet_count_max || proc->expired)
         return NULL;
 
     return proc;
@@ -1201,8 +2239,13 @@ static PFORT_PENDING_PROC fort_pending_proc_get_check(PFORT_PENDING pending, UIN
 
 static void fort_pending_proc_put_locked(PFORT_PENDING pending, PFORT_PENDING_PROC proc)
 {
+    fort_hash_remove_existing(&pending->procs_map, (tommy_node *) proc);
+
     pending->proc_count--;
 
+    proc->packet_count = 0;
+    proc->expired = FALSE;
+
     proc->next = pending->proc_free;
     pending->proc_free = proc;
 }
@@ -1225,6 +2268,13 @@ static NTSTATUS fort_pending_proc_add_packet_locked(PFORT_PENDING pending, PCFOR
         return status;
     }
 
+    if (proc->packet_count == 0) {
+        const INT64 timeout = pending->timeout;
+
+        proc->expire_time = (timeout != 0) ? (INT64) KeQueryInterruptTime() + timeout
+                                           : FORT_PENDING_EXPIRE_NONE;
+    }
+
     proc->packet_count++;
 
     pkt->next = proc->packets_head;
@@ -1233,6 +2283,44 @@ static NTSTATUS fort_pending_proc_add_packet_locked(PFORT_PENDING pending, PCFOR
     return STATUS_SUCCESS;
 }
 
+static void fort_pending_proc_packets_move(PFORT_PENDING_PROC proc, PFORT_PENDING_PACKET *packets)
+{
+    PFORT_PENDING_PACKET pkt = proc->packets_head;
+
+    while (pkt != NULL) {
+        PFORT_PENDING_PACKET pkt_next = pkt->next;
+
+        pkt->next = *packets;
+        *packets = pkt;
+
+        pkt = pkt_next;
+    }
+
+    proc->packets_head = NULL;
+    proc->packet_count = 0;
+}
+
+/* The completed connections are reauthorized */
+static UINT32 fort_pending_packets_complete(PFORT_PENDING pending, PFORT_PENDING_PACKET pkt)
+{
+    UINT32 count = 0;
+
+    while (pkt != NULL) {
+        PFORT_PENDING_PACKET pkt_next = pkt->next;
+
+        FwpsCompleteOperation0(pkt->completion_context, NULL);
+
+        fort_packet_free(&pkt->io);
+        fort_pending_packet_put(pending, pkt);
+
+        ++count;
+
+        pkt = pkt_next;
+    }
+
+    return count;
+}
+
 static NTSTATUS fort_pending_proc_add_packet(PFORT_PENDING pending, PCFORT_CALLOUT_ARG ca,
         PFORT_CALLOUT_ALE_EXTRA cx, PFORT_PENDING_PACKET pkt)
 {
@@ -1251,7 +2339,8 @@ static NTSTATUS fort_pending_proc_add_packet(PFORT_PENDING pending, PCFORT_CALLO
 static void fort_pending_init(PFORT_PENDING pending)
 {
     tommy_arrayof_init(&pending->procs, sizeof(FORT_PENDING_PROC));
-    tommy_arrayof_init(&pending->packets, sizeof(FORT_PENDING_PACKET));
+
+    fort_hash_init(&pending->procs_map);
 }
 
 FORT_API void fort_pending_open(PFORT_PENDING pending)
@@ -1263,64 +2352,107 @@ FORT_API void fort_pending_open(PFORT_PENDING pending)
 
     fort_pending_init(pending);
 
+    pending->proc_packet_count_max = FORT_PENDING_PROC_PACKET_COUNT_MAX;
+
+    fort_packet_pool_open(&pending->packet_pool, sizeof(FORT_PENDING_PACKET));
+    const NTSTATUS status =
+            fort_packet_pool_reserve(&pending->packet_pool, FORT_PENDING_PACKET_RESERVE);
+    if (!NT_SUCCESS(status)) {
+        LOG("Pending: Packet pool reserve error: %x\n", status);
+    }
+
     KeInitializeSpinLock(&pending->lock);
 }
 
 static void fort_pending_done(PFORT_PENDING pending)
 {
+    fort_hash_done(&pending->procs_map);
+
     tommy_arrayof_done(&pending->procs);
-    tommy_arrayof_done(&pending->packets);
 }
 
 FORT_API void fort_pending_close(PFORT_PENDING pending)
 {
     fort_pending_done(pending);
 
+    fort_packet_pool_close(&pending->packet_pool);
+
     FwpsInjectionHandleDestroy0(pending->injection_transport4_id);
     FwpsInjectionHandleDestroy0(pending->injection_transport6_id);
 }
 
-static void fort_pending_clear_locked(PFORT_PENDING pending)
+static PFORT_PENDING_PACKET fort_pending_clear_locked(PFORT_PENDING pending)
 {
+    PFORT_PENDING_PACKET packets = NULL;
+
     if (pending->proc_count == 0)
-        return;
+        return NULL;
+
+    const tommy_size_t size = tommy_arrayof_size(&pending->procs);
+
+    for (tommy_size_t i = 0; i < size; ++i) {
+        PFORT_PENDING_PROC proc = tommy_arrayof_ref(&pending->procs, i);
+
+        fort_pending_proc_packets_move(proc, &packets);
+    }
 
     pending->proc_count = 0;
     pending->proc_free = NULL;
-    pending->procs_head = NULL;
-    pending->packet_free = NULL;
 
     fort_pending_done(pending);
     fort_pending_init(pending);
+
+    return packets;
 }
 
 FORT_API void fort_pending_clear(PFORT_PENDING pending)
 {
+    PFORT_PENDING_PACKET packets;
+
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&pending->lock, &lock_queue);
 
-    fort_pending_clear_locked(pending);
+    packets = fort_pending_clear_locked(pending);
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    fort_pending_packets_complete(pending, packets);
+}
+
+FORT_API void fort_pending_conf_update(PFORT_PENDING pending, const PFORT_CONF conf)
+{
+    UINT16 packet_count_max = conf->proc_pending_packets_max;
+
+    if (packet_count_max == 0) {
+        packet_count_max = FORT_PENDING_PROC_PACKET_COUNT_MAX;
+    } else if (packet_count_max > FORT_PENDING_PROC_PACKET_COUNT_LIMIT) {
+        packet_count_max = FORT_PENDING_PROC_PACKET_COUNT_LIMIT;
+    }
+
+    pending->proc_packet_count_max = packet_count_max;
+
+    pending->timeout = (INT64) conf->proc_pending_timeout * FORT_PENDING_TIMEOUT_UNIT;
+    pending->timeout_allow = conf->proc_pending_allow;
 }
 
-FORT_API BOOL fort_pending_add_packet(
+FORT_API UCHAR fort_pending_add_packet(
         PFORT_PENDING pending, PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx)
 {
     NTSTATUS status;
 
     /* Skip self injected packet */
     if (fort_packet_injected_by_self(ca))
-        return FALSE;
+        return FORT_PENDING_ADD_FAILED;
 
-    /* Check the Process's Limits */
-    if (!fort_pending_proc_check_limits(pending, cx->process_id))
-        return FALSE;
+    /* Check the Process's Limits & the default verdict */
+    const UCHAR res = fort_pending_proc_check_limits(pending, cx->process_id);
+    if (res != FORT_PENDING_ADDED)
+        return res;
 
     /* Create the Packet */
     PFORT_PENDING_PACKET pkt = fort_pending_packet_get(pending);
     if (pkt == NULL)
-        return FALSE;
+        return FORT_PENDING_ADD_FAILED;
 
     RtlZeroMemory(pkt, sizeof(FORT_PENDING_PACKET));
 
@@ -1334,8 +2466,64 @@ FORT_API BOOL fort_pending_add_packet(
 
     if (!NT_SUCCESS(status)) {
         fort_pending_packet_put(pending, pkt);
-        return FALSE;
+        return FORT_PENDING_ADD_FAILED;
     }
 
-    return TRUE;
+    return FORT_PENDING_ADDED;
+}
+
+static PFORT_PENDING_PACKET fort_pending_expire_locked(PFORT_PENDING pending, INT64 now)
+{
+    PFORT_PENDING_PACKET packets = NULL;
+
+    const tommy_size_t size = tommy_arrayof_size(&pending->procs);
+
+    for (tommy_size_t i = 0; i < size && pending->proc_count != 0; ++i) {
+        PFORT_PENDING_PROC proc = tommy_arrayof_ref(&pending->procs, i);
+
+        if (proc->packet_count == 0 && !proc->expired)
+            continue; /* free */
+
+        if (now < proc->expire_time)
+            continue;
+
+        if (proc->expired) {
+            /* The default verdict's time ended */
+            fort_pending_proc_put_locked(pending, proc);
+            continue;
+        }
+
+        fort_pending_proc_packets_move(proc, &packets);
+
+        /* The reauthorized and the next connections get the default verdict */
+        proc->expired = TRUE;
+        proc->expire_time = now + pending->timeout;
+    }
+
+    return packets;
+}
+
+FORT_API void fort_pending_expire(PFORT_PENDING pending)
+{
+    if (pending->proc_count == 0)
+        return;
+
+    const INT64 now = (INT64) KeQueryInterruptTime();
+
+    PFORT_PENDING_PACKET packets;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&pending->lock, &lock_queue);
+
+    packets = fort_pending_expire_locked(pending, now);
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    /* Complete in a batch out of the lock, as they're classified again */
+    const UINT32 count = fort_pending_packets_complete(pending, packets);
+    if (count != 0) {
+        LOG("Pending: Expired packets: %u allow=%d\n", count, pending->timeout_allow);
+
+        fort_perf_add(&fort_device()->perf, FORT_PERF_PENDING_EXPIRES, count);
+    }
 }
@@ -5,11 +5,39 @@
 
 #include "common/fortconf.h"
 #include "fortcoutarg.h"
+#include "forthash.h"
 #include "forttds.h"
 #include "forttmr.h"
 
 #define FORT_PACKET_QUEUE_BAD_INDEX ((UINT16) -1)
 
+#define FORT_PACKET_MAGAZINE_SIZE 32 /* must be even */
+
+/* Free descriptor, overlays the packet's data */
+typedef struct fort_packet_free
+{
+    struct fort_packet_free *next;
+} FORT_PACKET_FREE, *PFORT_PACKET_FREE;
+
+/* Accessed by the owner processor at DISPATCH_LEVEL only */
+typedef struct fort_packet_magazine
+{
+    PFORT_PACKET_FREE head;
+    UINT32 count;
+} FORT_PACKET_MAGAZINE, *PFORT_PACKET_MAGAZINE;
+
+/* Packet descriptors: cached per processor, exchanged with the depot by half magazines */
+typedef struct fort_packet_pool
+{
+    ULONG cpu_count;
+    PFORT_PACKET_MAGAZINE cpus;
+
+    PFORT_PACKET_FREE depot;
+    tommy_arrayof packets;
+
+    KSPIN_LOCK lock;
+} FORT_PACKET_POOL, *PFORT_PACKET_POOL;
+
 typedef struct fort_packet_in
 {
     IF_INDEX interfaceIndex;
@@ -31,10 +59,12 @@ typedef struct fort_packet_out
 
 #define FORT_PACKET_INBOUND         0x01
 #define FORT_PACKET_IP6             0x02
+#define FORT_PACKET_ECN_CAPABLE     0x04
 #define FORT_PACKET_IPSEC_PROTECTED 0x08
 #define FORT_PACKET_TYPE_FLOW       0x10
 #define FORT_PACKET_TYPE_PENDING    0x20
 #define FORT_PACKET_TYPE_MASK       0x30
+#define FORT_PACKET_ECN_CE          0x40 /* set the Congestion Experienced on re-injection */
 
 typedef struct fort_packet_io
 {
@@ -67,6 +97,31 @@ typedef struct fort_packet_list
     PFORT_FLOW_PACKET packet_tail;
 } FORT_PACKET_LIST, *PFORT_PACKET_LIST;
 
+#define FORT_PACKET_FLOW_QUEUE_COUNT 64 /* must be power of 2 */
+
+typedef struct fort_packet_flow_queue
+{
+    FORT_PACKET_LIST packet_list;
+
+    struct fort_packet_flow_queue *next_active;
+
+    UINT32 queued_bytes;
+    INT32 deficit; /* bytes allowed to send in the current round */
+
+    INT64 above_tick; /* end of the interval, while the sojourn time is above the target */
+
+    UCHAR active : 1;
+} FORT_PACKET_FLOW_QUEUE, *PFORT_PACKET_FLOW_QUEUE;
+
+typedef struct fort_packet_fq
+{
+    /* Deficit round robin of the active flow queues */
+    PFORT_PACKET_FLOW_QUEUE active_head;
+    PFORT_PACKET_FLOW_QUEUE active_tail;
+
+    FORT_PACKET_FLOW_QUEUE flow_queues[FORT_PACKET_FLOW_QUEUE_COUNT]; /* hashed by flow */
+} FORT_PACKET_FQ, *PFORT_PACKET_FQ;
+
 typedef struct fort_packet_queue
 {
     /* All packets are first buffered into the bandwidth queue and released
@@ -79,11 +134,21 @@ typedef struct fort_packet_queue
     FORT_PACKET_LIST bandwidth_list;
     FORT_PACKET_LIST latency_list;
 
+    /* In the FQ mode the bandwidth queue is split to the flow queues */
+    PFORT_PACKET_FQ fq;
+    UINT16 fq_flags; /* FORT_SPEED_LIMIT_FQ* of the current fq */
+
     FORT_SPEED_LIMIT limit;
 
     UINT64 queued_bytes; /* accumulated size of queued packets */
     UINT64 available_bytes; /* accumulated bytes available for sending */
+    UINT64 available_fraction; /* fraction of the next available byte in 1/qpcFrequency */
     LARGE_INTEGER last_tick; /* last time the queue was checked */
+    INT64 next_tick; /* next time the head packets are eligible for release */
+
+    /* Telemetry since the last flush, without the queued_bytes */
+    FORT_SHAPER_STAT stat;
+    INT64 sojourn_max; /* in the bandwidth queue, in 1/qpcFrequency */
 
     KSPIN_LOCK lock;
 } FORT_PACKET_QUEUE, *PFORT_PACKET_QUEUE;
@@ -97,18 +162,41 @@ typedef struct fort_pending_packet
     HANDLE completion_context;
 } FORT_PENDING_PACKET, *PFORT_PENDING_PACKET;
 
-#define FORT_PENDING_PROC_COUNT_MAX 1024
-#define FORT_PENDING_PROC_PACKET_COUNT_MAX 3
+#define FORT_PENDING_PROC_COUNT_MAX          1024
+#define FORT_PENDING_PROC_PACKET_COUNT_MAX   3 /* default */
+#define FORT_PENDING_PROC_PACKET_COUNT_LIMIT 64
+
+#define FORT_PENDING_TIMEOUT_UNIT   (1 * 10000000LL) /* a second of the interrupt time */
+#define FORT_PENDING_EXPIRE_NONE    MAXLONGLONG
 
+/* Results of the fort_pending_add_packet() */
+enum {
+    FORT_PENDING_ADD_FAILED = 0, /* the limits are exceeded */
+    FORT_PENDING_ADDED,
+    FORT_PENDING_EXPIRED_ALLOW, /* the default verdict of the timed out process */
+    FORT_PENDING_EXPIRED_BLOCK,
+};
+
+/* Synchronize with tommy_node! */
 typedef struct fort_pending_proc
 {
     struct fort_pending_proc *next;
+    struct fort_pending_proc *prev;
+
+    union {
+        UINT32 process_id;
+        void *data; /* tommy_node::data */
+    };
+
+    tommy_key_t pid_hash; /* tommy_node::index */
 
     PFORT_PENDING_PACKET packets_head;
 
+    INT64 expire_time; /* of the packets or of the default verdict, in the interrupt time */
+
     UINT16 packet_count;
 
-    UINT32 process_id;
+    UCHAR expired : 1; /* the default verdict is applied until the expire time */
 } FORT_PENDING_PROC, *PFORT_PENDING_PROC;
 
 typedef struct fort_pending
@@ -117,14 +205,18 @@ typedef struct fort_pending
     HANDLE injection_transport6_id;
 
     UINT16 proc_count;
+    UINT16 proc_packet_count_max;
+
+    UCHAR timeout_allow : 1; /* the default verdict */
+
+    INT64 timeout; /* in 100ns, 0 for no timeout */
 
     PFORT_PENDING_PROC proc_free;
     tommy_arrayof procs;
 
-    PFORT_PENDING_PROC procs_head;
+    FORT_HASH procs_map;
 
-    PFORT_PENDING_PACKET packet_free;
-    tommy_arrayof packets;
+    FORT_PACKET_POOL packet_pool;
 
     KSPIN_LOCK lock;
 } FORT_PENDING, *PFORT_PENDING;
@@ -137,12 +229,18 @@ typedef struct fort_shaper
     LONG volatile active_io_bits;
 
     ULONG randomSeed;
+    ULONG timeIncrement; /* of the system clock, in 100-ns units */
     LARGE_INTEGER qpcFrequency;
 
     FORT_TIMER timer;
+    INT64 timer_due; /* the earliest queues' release time, the timer is armed for */
+    KSPIN_LOCK timer_lock;
 
-    PFORT_FLOW_PACKET packet_free;
-    tommy_arrayof packets;
+    FORT_PACKET_POOL packet_pool;
+    NDIS_HANDLE nbl_pool; /* for the packets' clones */
+    NDIS_HANDLE nbl_pool_owner;
+
+    LONG64 volatile inject_batches[FORT_DEVICE_STATS_INJECT_BATCH_COUNT];
 
     KSPIN_LOCK lock;
 
@@ -157,7 +255,8 @@ FORT_API void fort_shaper_open(PFORT_SHAPER shaper);
 
 FORT_API void fort_shaper_close(PFORT_SHAPER shaper);
 
-FORT_API void fort_shaper_conf_update(PFORT_SHAPER shaper, const PFORT_CONF_IO conf_io);
+FORT_API void fort_shaper_conf_update(PFORT_SHAPER shaper, const PFORT_CONF_GROUP conf_group,
+        const PFORT_CONF_FLAGS conf_flags);
 
 FORT_API void fort_shaper_conf_flags_update(PFORT_SHAPER shaper, const PFORT_CONF_FLAGS conf_flags);
 
@@ -167,15 +266,28 @@ FORT_API void fort_shaper_drop_flow_packets(PFORT_SHAPER shaper, UINT64 flowCont
 
 FORT_API void fort_shaper_drop_packets(PFORT_SHAPER shaper);
 
+FORT_API void fort_shaper_inject_stats(PFORT_SHAPER shaper, UINT64 *inject_batches);
+
+FORT_API UINT64 fort_shaper_queued_bytes(PFORT_SHAPER shaper);
+
+FORT_API UINT32 fort_shaper_group_io_bits(PFORT_SHAPER shaper);
+
+FORT_API BOOL fort_shaper_queue_stat_flush(PFORT_SHAPER shaper, int queue_index,
+        PFORT_SHAPER_STAT stat, UINT32 *sojourn_max_ms);
+
 FORT_API void fort_pending_open(PFORT_PENDING pending);
 
 FORT_API void fort_pending_close(PFORT_PENDING pending);
 
 FORT_API void fort_pending_clear(PFORT_PENDING pending);
 
-FORT_API BOOL fort_pending_add_packet(
+FORT_API void fort_pending_conf_update(PFORT_PENDING pending, const PFORT_CONF conf);
+
+FORT_API UCHAR fort_pending_add_packet(
         PFORT_PENDING pending, PCFORT_CALLOUT_ARG ca, PFORT_CALLOUT_ALE_EXTRA cx);
 
+FORT_API void fort_pending_expire(PFORT_PENDING pending);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -7,33 +7,61 @@
 #define FORT_POOL_SIZE_MIN (FORT_POOL_SIZE - FORT_POOL_OVERHEAD)
 #define FORT_POOL_SIZE_MAX (TLSF_MAX_POOL_SIZE - FORT_POOL_OVERHEAD)
 
+#define FORT_POOL_CLASS_SIZE_MAX (FORT_POOL_CLASS_GRAIN * FORT_POOL_CLASS_COUNT)
+
 #define fort_pool_size(size)                                                                       \
     ((size) < FORT_POOL_SIZE_MIN ? FORT_POOL_SIZE                                                  \
                                  : ((size) < (FORT_POOL_SIZE_MAX / 2) ? 2 * (size) : (size)))
 
-static tommy_node *fort_pool_new(UINT32 pool_size)
+/* Rounded up for the requests and down for the freed blocks */
+#define fort_pool_class_index(size)                                                                \
+    ((int) (((size) + FORT_POOL_CLASS_GRAIN - 1) / FORT_POOL_CLASS_GRAIN) - 1)
+#define fort_pool_block_class_index(size) ((int) ((size) / FORT_POOL_CLASS_GRAIN) - 1)
+
+static tommy_node *fort_pool_new(PFORT_POOL_LIST pool_list, UINT32 pool_size)
 {
     if (pool_size > FORT_POOL_SIZE_MAX)
         return NULL;
 
-    return tommy_malloc(pool_size);
+    PFORT_POOL pool = fort_mem_type_alloc(pool_list->mem_type, pool_size);
+    if (pool == NULL)
+        return NULL;
+
+    pool->size = pool_size;
+
+    ++pool_list->pools_n;
+    pool_list->pools_bytes += pool_size;
+
+    /* The new pool may be freed later */
+    pool_list->trim_used_bytes = (SIZE_T) -1;
+
+    return (tommy_node *) pool;
 }
 
-static void fort_pool_del(tommy_node *pool)
+static void fort_pool_del(PFORT_POOL_LIST pool_list, tommy_node *pool)
 {
-    tommy_free(pool);
+    --pool_list->pools_n;
+    pool_list->pools_bytes -= ((PFORT_POOL) pool)->size;
+
+    fort_mem_type_free(pool_list->mem_type, pool);
 }
 
-FORT_API void fort_pool_list_init(PFORT_POOL_LIST pool_list)
+FORT_API void fort_pool_list_init(
+        PFORT_POOL_LIST pool_list, enum FORT_MEM_TYPE mem_type, UCHAR flags)
 {
+    RtlZeroMemory(pool_list, sizeof(FORT_POOL_LIST));
+
     tommy_list_init(&pool_list->pools);
+
+    pool_list->flags = flags;
+    pool_list->mem_type = mem_type;
 }
 
 FORT_API void fort_pool_init(PFORT_POOL_LIST pool_list, UINT32 size)
 {
     const UINT32 pool_size = fort_pool_size(size);
 
-    tommy_node *pool = fort_pool_new(pool_size);
+    tommy_node *pool = fort_pool_new(pool_list, pool_size);
     if (pool == NULL)
         return;
 
@@ -48,23 +76,20 @@ FORT_API void fort_pool_done(PFORT_POOL_LIST pool_list)
     tommy_node *pool = tommy_list_head(&pool_list->pools);
     while (pool != NULL) {
         tommy_node *next = pool->next;
-        fort_pool_del(pool);
+        fort_pool_del(pool_list, pool);
         pool = next;
     }
+
+    tommy_list_init(&pool_list->pools);
 }
 
-FORT_API void *fort_pool_malloc(PFORT_POOL_LIST pool_list, UINT32 size)
+static void *fort_pool_tlsf_malloc(PFORT_POOL_LIST pool_list, UINT32 size)
 {
-    tommy_node *pool = tommy_list_tail(&pool_list->pools);
-
-    if (pool == NULL)
-        return NULL;
-
     void *p = tlsf_malloc(pool_list->tlsf, size);
     if (p == NULL) {
         const UINT32 pool_size = fort_pool_size(size);
 
-        pool = fort_pool_new(pool_size);
+        tommy_node *pool = fort_pool_new(pool_list, pool_size);
         if (pool == NULL)
             return NULL;
 
@@ -79,7 +104,142 @@ FORT_API void *fort_pool_malloc(PFORT_POOL_LIST pool_list, UINT32 size)
     return p;
 }
 
+static void *fort_pool_class_malloc(PFORT_POOL_LIST pool_list, int class_index)
+{
+    PFORT_POOL_BLOCK block = pool_list->class_blocks[class_index];
+    if (block != NULL) {
+        pool_list->class_blocks[class_index] = block->next;
+        --pool_list->class_blocks_n[class_index];
+        return block;
+    }
+
+    /* Allocate the whole class size to reuse the block by the class */
+    return fort_pool_tlsf_malloc(pool_list, (class_index + 1) * FORT_POOL_CLASS_GRAIN);
+}
+
+FORT_API void *fort_pool_malloc(PFORT_POOL_LIST pool_list, UINT32 size)
+{
+    tommy_node *pool = tommy_list_tail(&pool_list->pools);
+
+    if (pool == NULL)
+        return NULL;
+
+    const BOOL use_class = (pool_list->flags & FORT_POOL_SIZE_CLASSES) != 0 && size != 0
+            && size <= FORT_POOL_CLASS_SIZE_MAX;
+
+    void *p = use_class ? fort_pool_class_malloc(pool_list, fort_pool_class_index(size))
+                        : fort_pool_tlsf_malloc(pool_list, size);
+
+    if (p != NULL) {
+        pool_list->used_bytes += tlsf_block_size(p);
+    }
+
+    return p;
+}
+
+static BOOL fort_pool_class_free(PFORT_POOL_LIST pool_list, void *p, SIZE_T block_size)
+{
+    if ((pool_list->flags & FORT_POOL_SIZE_CLASSES) == 0)
+        return FALSE;
+
+    const int class_index = fort_pool_block_class_index(block_size);
+
+    if (class_index < 0 || class_index >= FORT_POOL_CLASS_COUNT
+            || pool_list->class_blocks_n[class_index] >= FORT_POOL_CLASS_CACHE_MAX)
+        return FALSE;
+
+    PFORT_POOL_BLOCK block = p;
+    block->next = pool_list->class_blocks[class_index];
+
+    pool_list->class_blocks[class_index] = block;
+    ++pool_list->class_blocks_n[class_index];
+
+    return TRUE;
+}
+
 FORT_API void fort_pool_free(PFORT_POOL_LIST pool_list, void *p)
 {
+    const SIZE_T block_size = tlsf_block_size(p);
+
+    pool_list->used_bytes -= block_size;
+
+    if (fort_pool_class_free(pool_list, p, block_size))
+        return;
+
     tlsf_free(pool_list->tlsf, p);
 }
+
+FORT_API BOOL fort_pool_trim_needed(PFORT_POOL_LIST pool_list)
+{
+    /* Freed at least a pool's size since the last trim */
+    return pool_list->pools_n > 1 && pool_list->used_bytes < pool_list->pools_bytes / 2
+            && pool_list->used_bytes + FORT_POOL_SIZE <= pool_list->trim_used_bytes;
+}
+
+static void fort_pool_classes_flush(PFORT_POOL_LIST pool_list)
+{
+    for (int i = 0; i < FORT_POOL_CLASS_COUNT; ++i) {
+        PFORT_POOL_BLOCK block = pool_list->class_blocks[i];
+
+        while (block != NULL) {
+            PFORT_POOL_BLOCK next = block->next;
+            tlsf_free(pool_list->tlsf, block);
+            block = next;
+        }
+
+        pool_list->class_blocks[i] = NULL;
+        pool_list->class_blocks_n[i] = 0;
+    }
+}
+
+static void fort_pool_used_walker(void *ptr, size_t size, int used, void *user)
+{
+    UNUSED(ptr);
+    UNUSED(size);
+
+    if (used) {
+        *((BOOL *) user) = TRUE;
+    }
+}
+
+static BOOL fort_pool_is_free(pool_t tlsf_pool)
+{
+    BOOL used = FALSE;
+
+    tlsf_walk_pool(tlsf_pool, &fort_pool_used_walker, &used);
+
+    return !used;
+}
+
+FORT_API UINT32 fort_pool_trim(PFORT_POOL_LIST pool_list)
+{
+    UINT32 count = 0;
+
+    /* The cached blocks keep their pools in use */
+    fort_pool_classes_flush(pool_list);
+
+    /* The tail pool holds the TLSF control */
+    tommy_node *control_pool = tommy_list_tail(&pool_list->pools);
+    tommy_node *pool = tommy_list_head(&pool_list->pools);
+
+    while (pool != control_pool) {
+        tommy_node *next = pool->next;
+
+        const pool_t tlsf_pool = (char *) pool + FORT_POOL_DATA_OFF;
+
+        if (fort_pool_is_free(tlsf_pool)) {
+            tlsf_remove_pool(pool_list->tlsf, tlsf_pool);
+
+            tommy_list_remove_existing(&pool_list->pools, pool);
+            fort_pool_del(pool_list, pool);
+
+            ++count;
+        }
+
+        pool = next;
+    }
+
+    pool_list->trim_used_bytes = pool_list->used_bytes;
+
+    return count;
+}
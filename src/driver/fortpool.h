@@ -3,31 +3,58 @@
 
 #include "fortdrv.h"
 
+#include "fortmem.h"
 #include "forttds.h"
 #include "forttlsf.h"
 
 #define FORT_POOL_DATA_OFF offsetof(FORT_POOL, data)
 
+#define FORT_POOL_SIZE_CLASSES 0x01 /* cache the freed small blocks by their size classes */
+
+#define FORT_POOL_CLASS_GRAIN     32
+#define FORT_POOL_CLASS_COUNT     8 /* up to 256 bytes */
+#define FORT_POOL_CLASS_CACHE_MAX 64 /* blocks per class */
+
 /* Synchronize with tommy_node! */
 typedef struct fort_pool
 {
     struct fort_pool *next;
     struct fort_pool *prev;
 
+    SIZE_T size; /* keeps the data aligned for TLSF */
+
     char data[4];
 } FORT_POOL, *PFORT_POOL;
 
+typedef struct fort_pool_block
+{
+    struct fort_pool_block *next;
+} FORT_POOL_BLOCK, *PFORT_POOL_BLOCK;
+
 typedef struct fort_pool_list
 {
+    UCHAR flags;
+
+    enum FORT_MEM_TYPE mem_type;
+
     tlsf_t tlsf;
-    tommy_list pools;
+    tommy_list pools; /* the tail pool holds the TLSF control */
+
+    UINT32 pools_n;
+    SIZE_T pools_bytes;
+    SIZE_T used_bytes; /* by the callers, without the cached blocks */
+    SIZE_T trim_used_bytes; /* after the last trim, to not repeat it in vain */
+
+    PFORT_POOL_BLOCK class_blocks[FORT_POOL_CLASS_COUNT];
+    UINT16 class_blocks_n[FORT_POOL_CLASS_COUNT];
 } FORT_POOL_LIST, *PFORT_POOL_LIST;
 
 #if defined(__cplusplus)
 extern "C" {
 #endif
 
-FORT_API void fort_pool_list_init(PFORT_POOL_LIST pool_list);
+FORT_API void fort_pool_list_init(
+        PFORT_POOL_LIST pool_list, enum FORT_MEM_TYPE mem_type, UCHAR flags);
 
 FORT_API void fort_pool_init(PFORT_POOL_LIST pool_list, UINT32 size);
 
@@ -37,6 +64,10 @@ FORT_API void *fort_pool_malloc(PFORT_POOL_LIST pool_list, UINT32 size);
 
 FORT_API void fort_pool_free(PFORT_POOL_LIST pool_list, void *p);
 
+FORT_API BOOL fort_pool_trim_needed(PFORT_POOL_LIST pool_list);
+
+FORT_API UINT32 fort_pool_trim(PFORT_POOL_LIST pool_list);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
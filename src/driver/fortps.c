@@ -5,11 +5,10 @@
 #include "fortcb.h"
 #include "fortdbg.h"
 #include "fortdev.h"
+#include "fortmem.h"
 #include "forttrace.h"
 #include "fortutl.h"
 
-#define FORT_PSTREE_POOL_TAG 'PwfF'
-
 #define FORT_SVCHOST_PREFIX L"\\svchost\\"
 #define FORT_SVCHOST_PREFIX_SIZE                                                                   \
     (sizeof(FORT_SVCHOST_PREFIX) - sizeof(WCHAR)) /* skip terminating zero */
@@ -18,13 +17,16 @@
 
 #define FORT_PSTREE_NAME_LEN_MAX      120
 #define FORT_PSTREE_NAME_LEN_MAX_SIZE (FORT_PSTREE_NAME_LEN_MAX * sizeof(WCHAR))
+
+#define FORT_PSTREE_SERVICE_NAME_MAX_SIZE (FORT_SVCHOST_PREFIX_SIZE + FORT_PSTREE_NAME_LEN_MAX_SIZE)
 #define FORT_PSTREE_NAMES_POOL_SIZE   (4 * 1024)
 
 #define FORT_PSNAME_DATA_OFF offsetof(FORT_PSNAME, data)
 
+/* Referenced by the nodes and the readers, the last one frees it */
 typedef struct fort_psname
 {
-    UINT16 refcount;
+    LONG volatile refcount;
     UINT16 size;
     WCHAR data[1];
 } FORT_PSNAME, *PFORT_PSNAME;
@@ -35,6 +37,11 @@ typedef struct fort_psname
 #define FORT_PSNODE_KILL_PROCESS   0x0008
 #define FORT_PSNODE_KILL_CHILD     0x0010
 #define FORT_PSNODE_IS_SVCHOST     0x0020
+#define FORT_PSNODE_UNRESOLVED     0x0040 /* created from the snapshot, the path is unknown */
+#define FORT_PSNODE_FILE_ID        0x0080 /* the image's file id is resolved */
+
+#define FORT_PSTREE_SNAPSHOT_SIZE_MIN (64 * 1024)
+#define FORT_PSTREE_RESOLVE_BATCH     64 /* processes per the worker's run */
 
 /* Synchronize with tommy_hashdyn_node! */
 typedef struct fort_psnode
@@ -47,10 +54,31 @@ typedef struct fort_psnode
     tommy_key_t pid_hash; /* tommy_hashdyn_node::index */
 
     UINT32 process_id;
+    UINT32 session_id; /* of the process's token, FORT_LOG_SESSION_UNKNOWN until resolved */
 
     UINT16 volatile flags;
+
+    /* Cached app entry of the process path */
+    FORT_APP_ENTRY app_data;
+    LONG app_generation;
+    tommy_key_t app_path_hash;
+
+    FORT_FILE_ID file_id; /* of the image, when the conf has the apps' file ids */
 } FORT_PSNODE, *PFORT_PSNODE;
 
+/* Synchronize with tommy_hashdyn_node! */
+typedef struct fort_pstag
+{
+    struct fort_pstag *next;
+    struct fort_pstag *prev;
+
+    PFORT_PSNAME ps_name; /* tommy_hashdyn_node::data */
+
+    tommy_key_t tag_hash; /* tommy_hashdyn_node::index */
+
+    UINT32 service_tag;
+} FORT_PSTAG, *PFORT_PSTAG;
+
 typedef struct _SYSTEM_PROCESSES
 {
     ULONG NextEntryOffset;
@@ -71,6 +99,10 @@ typedef struct _SYSTEM_PROCESSES
 #    define SystemProcessInformation 5
 #endif
 
+#if !defined(ProcessSessionInformation)
+#    define ProcessSessionInformation 24
+#endif
+
 #if defined(FORT_DRIVER)
 
 NTSTATUS NTAPI ZwQuerySystemInformation(ULONG systemInformationClass, PVOID systemInformation,
@@ -96,9 +128,18 @@ typedef struct fort_psinfo_hash
     HANDLE processHandle;
     DWORD processId;
     DWORD parentProcessId;
+    UINT32 sessionId;
 
     PCUNICODE_STRING path;
     PCUNICODE_STRING commandLine;
+    PFILE_OBJECT fileObject;
+
+    /* Resolved before the tree is locked */
+    BOOL isSvcHost;
+    BOOL isFileId;
+    PCUNICODE_STRING serviceName;
+    FORT_APP_FLAGS app_flags;
+    FORT_FILE_ID file_id;
 } FORT_PSINFO_HASH, *PFORT_PSINFO_HASH;
 
 typedef const FORT_PSINFO_HASH *PCFORT_PSINFO_HASH;
@@ -113,6 +154,7 @@ typedef struct fort_pstree_notify_arg
 typedef const FORT_PSTREE_NOTIFY_ARG *PCFORT_PSTREE_NOTIFY_ARG;
 
 #define fort_pstree_proc_hash(process_id) tommy_inthash_u32((UINT32) (process_id))
+#define fort_pstree_tag_hash(service_tag) tommy_inthash_u32((UINT32) (service_tag))
 
 #define fort_pstree_get_proc(ps_tree, index)                                                       \
     ((PFORT_PSNODE) tommy_arrayof_ref(&(ps_tree)->procs, (index)))
@@ -143,6 +185,41 @@ static NTSTATUS GetProcessImageName(HANDLE processHandle, PFORT_PATH_BUFFER pb)
     return STATUS_SUCCESS;
 }
 
+static BOOL GetProcessImageFileId(PFILE_OBJECT fileObject, PFORT_FILE_ID file_id)
+{
+    NTSTATUS status;
+
+    HANDLE fileHandle;
+    status = ObOpenObjectByPointer(
+            fileObject, OBJ_KERNEL_HANDLE, NULL, 0, *IoFileObjectType, KernelMode, &fileHandle);
+    if (!NT_SUCCESS(status))
+        return FALSE;
+
+    IO_STATUS_BLOCK statusBlock;
+    FILE_ID_INFORMATION fileInfo;
+    status = ZwQueryInformationFile(
+            fileHandle, &statusBlock, &fileInfo, sizeof(fileInfo), FileIdInformation);
+
+    ZwClose(fileHandle);
+
+    if (!NT_SUCCESS(status))
+        return FALSE;
+
+    file_id->volume_serial = fileInfo.VolumeSerialNumber;
+    RtlCopyMemory(file_id->id, fileInfo.FileId.Identifier, sizeof(file_id->id));
+
+    return TRUE;
+}
+
+static UINT32 GetProcessSessionId(HANDLE processHandle)
+{
+    ULONG sessionId = FORT_LOG_SESSION_UNKNOWN; /* PROCESS_SESSION_INFORMATION */
+    const NTSTATUS status = ZwQueryInformationProcess(
+            processHandle, ProcessSessionInformation, &sessionId, sizeof(sessionId), NULL);
+
+    return NT_SUCCESS(status) ? sessionId : FORT_LOG_SESSION_UNKNOWN;
+}
+
 static HANDLE OpenProcessById(DWORD processId)
 {
     NTSTATUS status;
@@ -190,13 +267,31 @@ static PFORT_PSNAME fort_pstree_name_new(PFORT_PSTREE ps_tree, UINT16 name_size)
     return ps_name;
 }
 
+static PFORT_PSNAME fort_pstree_name_copy(PFORT_PSTREE ps_tree, const PVOID buf, UINT16 size)
+{
+    PFORT_PSNAME ps_name = fort_pstree_name_new(ps_tree, size);
+    if (ps_name != NULL) {
+        RtlCopyMemory(ps_name->data, buf, size);
+    }
+    return ps_name;
+}
+
+static void fort_pstree_name_free(PFORT_PSTREE ps_tree, PFORT_PSNAME ps_name)
+{
+    fort_pool_free(&ps_tree->pool_list, ps_name);
+
+    if (fort_pool_trim_needed(&ps_tree->pool_list)) {
+        fort_worker_queue(&fort_device()->worker, FORT_WORKER_TRIM);
+    }
+}
+
 static void fort_pstree_name_del(PFORT_PSTREE ps_tree, PFORT_PSNAME ps_name)
 {
     if (ps_name == NULL)
         return;
 
-    if (--ps_name->refcount == 0) {
-        fort_pool_free(&ps_tree->pool_list, ps_name);
+    if (InterlockedDecrement(&ps_name->refcount) == 0) {
+        fort_pstree_name_free(ps_tree, ps_name);
     }
 }
 
@@ -260,24 +355,30 @@ static BOOL fort_pstree_svchost_check(PCUNICODE_STRING commandLine, PUNICODE_STR
     return TRUE;
 }
 
-static PFORT_PSNAME fort_pstree_create_service_name(
-        PFORT_PSTREE ps_tree, PCUNICODE_STRING serviceName)
+static void fort_pstree_format_service_name(PWCHAR buf, PCUNICODE_STRING serviceName)
 {
     const USHORT nameLen = serviceName->Length;
 
-    PFORT_PSNAME ps_name = fort_pstree_name_new(ps_tree, FORT_SVCHOST_PREFIX_SIZE + nameLen);
+    PCHAR data = (PCHAR) buf;
+    RtlCopyMemory(data, FORT_SVCHOST_PREFIX, FORT_SVCHOST_PREFIX_SIZE);
 
-    if (ps_name != NULL) {
-        PCHAR data = (PCHAR) &ps_name->data;
-        RtlCopyMemory(data, FORT_SVCHOST_PREFIX, FORT_SVCHOST_PREFIX_SIZE);
+    UNICODE_STRING nameString;
+    nameString.Length = nameLen;
+    nameString.MaximumLength = nameLen;
+    nameString.Buffer = (PWSTR) (data + FORT_SVCHOST_PREFIX_SIZE);
 
-        UNICODE_STRING nameString;
-        nameString.Length = nameLen;
-        nameString.MaximumLength = nameLen;
-        nameString.Buffer = (PWSTR) (data + FORT_SVCHOST_PREFIX_SIZE);
+    /* RtlDowncaseUnicodeString() must be called in <DISPATCH level only! */
+    fort_ascii_downcase(&nameString, serviceName);
+}
+
+static PFORT_PSNAME fort_pstree_create_service_name(
+        PFORT_PSTREE ps_tree, PCUNICODE_STRING serviceName)
+{
+    PFORT_PSNAME ps_name =
+            fort_pstree_name_new(ps_tree, FORT_SVCHOST_PREFIX_SIZE + serviceName->Length);
 
-        /* RtlDowncaseUnicodeString() must be called in <DISPATCH level only! */
-        fort_ascii_downcase(&nameString, serviceName);
+    if (ps_name != NULL) {
+        fort_pstree_format_service_name(ps_name->data, serviceName);
     }
 
     return ps_name;
@@ -295,8 +396,7 @@ static void fort_pstree_proc_set_service_name(PFORT_PSNODE proc, PFORT_PSNAME ps
     }
 }
 
-static void fort_pstree_proc_check_svchost(
-        PFORT_PSTREE ps_tree, PCFORT_PSINFO_HASH psi, PFORT_PSNODE proc)
+static void fort_pstree_psinfo_check_svchost(PFORT_PSINFO_HASH psi, PUNICODE_STRING serviceName)
 {
     if (psi->path == NULL || psi->commandLine == NULL)
         return;
@@ -304,13 +404,68 @@ static void fort_pstree_proc_check_svchost(
     if (!fort_pstree_svchost_path_check(psi->path))
         return;
 
+    psi->isSvcHost = TRUE;
+
+    UNICODE_STRING name;
+    if (!fort_pstree_svchost_check(psi->commandLine, &name))
+        return;
+
+    fort_pstree_format_service_name(serviceName->Buffer, &name);
+
+    serviceName->Length = FORT_SVCHOST_PREFIX_SIZE + name.Length;
+
+    psi->serviceName = serviceName;
+}
+
+static void fort_pstree_psinfo_check_conf(PFORT_PSINFO_HASH psi)
+{
+    PCUNICODE_STRING name = (psi->serviceName != NULL) ? psi->serviceName : psi->path;
+    if (name == NULL)
+        return;
+
+    PFORT_DEVICE_CONF device_conf = &fort_device()->conf;
+
+    PFORT_CONF_REF conf_ref = fort_conf_ref_take(device_conf);
+    if (conf_ref == NULL)
+        return;
+
+    const PFORT_CONF conf = &conf_ref->conf;
+
+    /* Kept by the process for the callouts' lookups */
+    if (conf_ref->file_ids_n != 0 && psi->serviceName == NULL && psi->fileObject != NULL) {
+        psi->isFileId = GetProcessImageFileId(psi->fileObject, &psi->file_id);
+    }
+
+    /* The exact path first, then the image's file id by any of the file's paths */
+    FORT_APP_ENTRY app_data = fort_conf_exe_find(conf, conf_ref, name->Buffer, name->Length);
+
+    if (app_data.flags.v == 0 && psi->isFileId) {
+        app_data = fort_conf_ref_file_id_find(conf_ref, &psi->file_id);
+    }
+
+    if (app_data.flags.v == 0 && conf->proc_wild) {
+        app_data = fort_conf_app_pattern_find(conf, name->Buffer, name->Length);
+    }
+
+    psi->app_flags = app_data.flags;
+
+    fort_conf_ref_put(device_conf, conf_ref);
+}
+
+static void fort_pstree_proc_check_svchost(
+        PFORT_PSTREE ps_tree, PCFORT_PSINFO_HASH psi, PFORT_PSNODE proc)
+{
+    if (!psi->isSvcHost)
+        return;
+
     proc->flags |= FORT_PSNODE_IS_SVCHOST;
 
-    UNICODE_STRING serviceName;
-    if (!fort_pstree_svchost_check(psi->commandLine, &serviceName))
+    PCUNICODE_STRING serviceName = psi->serviceName;
+    if (serviceName == NULL)
         return;
 
-    PFORT_PSNAME ps_name = fort_pstree_create_service_name(ps_tree, &serviceName);
+    PFORT_PSNAME ps_name =
+            fort_pstree_name_copy(ps_tree, serviceName->Buffer, serviceName->Length);
 
     fort_pstree_proc_set_service_name(proc, ps_name);
 }
@@ -378,20 +533,8 @@ static PFORT_PSNODE fort_pstree_find_proc(PFORT_PSTREE ps_tree, DWORD processId)
     return fort_pstree_find_proc_hash(ps_tree, processId, pid_hash);
 }
 
-inline static void fort_pstree_proc_set_name(
-        PFORT_PSTREE ps_tree, PFORT_PSNODE proc, const PVOID path_buf, UINT16 path_len)
-{
-    PFORT_PSNAME ps_name = fort_pstree_name_new(ps_tree, path_len);
-    if (ps_name == NULL)
-        return;
-
-    RtlCopyMemory(ps_name->data, path_buf, path_len);
-
-    proc->ps_name = ps_name;
-}
-
-inline static void fort_pstree_check_proc_app_flags(PFORT_PSTREE ps_tree, PFORT_PSNODE proc,
-        const PVOID path_buf, UINT16 path_len, FORT_APP_FLAGS app_flags)
+inline static void fort_pstree_check_proc_app_flags(
+        PFORT_PSTREE ps_tree, PFORT_PSNODE proc, PCUNICODE_STRING path, FORT_APP_FLAGS app_flags)
 {
     const UINT16 kill_flags = (app_flags.kill_process ? FORT_PSNODE_KILL_PROCESS : 0)
             | (app_flags.kill_child ? FORT_PSNODE_KILL_CHILD : 0);
@@ -400,31 +543,13 @@ inline static void fort_pstree_check_proc_app_flags(PFORT_PSTREE ps_tree, PFORT_
     if (kill_flags == 0 && app_flags.apply_child) {
         const BOOL has_ps_name = (proc->ps_name != NULL);
         if (!has_ps_name) {
-            fort_pstree_proc_set_name(ps_tree, proc, path_buf, path_len);
+            proc->ps_name = fort_pstree_name_copy(ps_tree, path->Buffer, path->Length);
         }
 
         proc->flags |= FORT_PSNODE_NAME_INHERIT;
     }
 }
 
-inline static void fort_pstree_check_proc_conf(
-        PFORT_PSTREE ps_tree, PFORT_CONF_REF conf_ref, PFORT_PSNODE proc, PCUNICODE_STRING path)
-{
-    const BOOL has_ps_name = (proc->ps_name != NULL);
-    const PVOID path_buf = has_ps_name ? proc->ps_name->data : path->Buffer;
-    const UINT16 path_len = has_ps_name ? proc->ps_name->size : path->Length;
-
-    const PFORT_CONF conf = &conf_ref->conf;
-
-    const FORT_APP_ENTRY app_data = conf->proc_wild
-            ? fort_conf_app_find(conf, path_buf, path_len, fort_conf_exe_find, conf_ref)
-            : fort_conf_exe_find(conf, conf_ref, path_buf, path_len);
-
-    if (app_data.flags.v != 0) {
-        fort_pstree_check_proc_app_flags(ps_tree, proc, path_buf, path_len, app_data.flags);
-    }
-}
-
 inline static BOOL fort_pstree_check_proc_inherited(
         PFORT_PSTREE ps_tree, PFORT_PSNODE proc, DWORD parentProcessId)
 {
@@ -441,7 +566,7 @@ inline static BOOL fort_pstree_check_proc_inherited(
     PFORT_PSNAME ps_name = parent->ps_name;
     assert(ps_name != NULL);
 
-    ++ps_name->refcount;
+    InterlockedIncrement(&ps_name->refcount);
     proc->ps_name = ps_name;
 
     proc->flags |= FORT_PSNODE_NAME_INHERITED;
@@ -455,17 +580,10 @@ static void fort_pstree_check_proc_inheritance(
     if (psi->path == NULL)
         return;
 
-    PFORT_DEVICE_CONF device_conf = &fort_device()->conf;
-
-    PFORT_CONF_REF conf_ref = fort_conf_ref_take(device_conf);
-    if (conf_ref == NULL)
-        return;
-
-    if (!fort_pstree_check_proc_inherited(ps_tree, proc, psi->parentProcessId)) {
-        fort_pstree_check_proc_conf(ps_tree, conf_ref, proc, psi->path);
+    if (!fort_pstree_check_proc_inherited(ps_tree, proc, psi->parentProcessId)
+            && psi->app_flags.v != 0) {
+        fort_pstree_check_proc_app_flags(ps_tree, proc, psi->path, psi->app_flags);
     }
-
-    fort_conf_ref_put(device_conf, conf_ref);
 }
 
 static PFORT_PSNODE fort_pstree_handle_new_proc(PFORT_PSTREE ps_tree, PCFORT_PSINFO_HASH psi)
@@ -475,7 +593,14 @@ static PFORT_PSNODE fort_pstree_handle_new_proc(PFORT_PSTREE ps_tree, PCFORT_PSI
         return NULL;
 
     proc->process_id = psi->processId;
+    proc->session_id = psi->sessionId;
     proc->flags = 0;
+    proc->app_generation = 0;
+
+    if (psi->isFileId) {
+        proc->file_id = psi->file_id;
+        proc->flags |= FORT_PSNODE_FILE_ID;
+    }
 
     fort_pstree_proc_check_svchost(ps_tree, psi, proc);
 
@@ -505,14 +630,25 @@ inline static void fort_pstree_handle_created_proc(PFORT_PSTREE ps_tree,
         return;
     }
 
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&ps_tree->lock, &lock_queue);
+    /* Parse the command line and lookup the conf before the tree is locked */
+    WCHAR serviceBuffer[FORT_PSTREE_SERVICE_NAME_MAX_SIZE / sizeof(WCHAR)];
+    UNICODE_STRING serviceName;
+    serviceName.Length = 0;
+    serviceName.MaximumLength = FORT_PSTREE_SERVICE_NAME_MAX_SIZE;
+    serviceName.Buffer = serviceBuffer;
+
+    fort_pstree_psinfo_check_svchost(psi, &serviceName);
+    fort_pstree_psinfo_check_conf(psi);
+
+    psi->sessionId = GetProcessSessionId(psi->processHandle);
+
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
     {
         PFORT_PSNODE proc = fort_pstree_handle_new_proc(ps_tree, psi);
 
         fort_pstree_check_kill_proc(proc, createInfo, FORT_PSNODE_KILL_PROCESS);
     }
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
 }
 
 inline static void fort_pstree_notify_process_created(
@@ -524,7 +660,7 @@ inline static void fort_pstree_notify_process_created(
     if (fort_is_system_process(psi->processId, psi->parentProcessId))
         return; /* skip System (sub)processes */
 
-    PFORT_PATH_BUFFER pb = fort_mem_alloc(sizeof(FORT_PATH_BUFFER), FORT_PSTREE_POOL_TAG);
+    PFORT_PATH_BUFFER pb = fort_mem_type_alloc(FORT_MEM_PSTREE, sizeof(FORT_PATH_BUFFER));
     if (pb == NULL)
         return;
 
@@ -543,7 +679,7 @@ inline static void fort_pstree_notify_process_created(
         ZwClose(processHandle);
     }
 
-    fort_mem_free(pb, FORT_PSTREE_POOL_TAG);
+    fort_mem_type_free(FORT_MEM_PSTREE, pb);
 }
 
 inline static BOOL fort_pstree_notify_process_prepare(
@@ -551,8 +687,7 @@ inline static BOOL fort_pstree_notify_process_prepare(
 {
     BOOL res = TRUE;
 
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&ps_tree->lock, &lock_queue);
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
 
     PFORT_PSNODE proc = fort_pstree_find_proc_hash(ps_tree, psi->processId, psi->pid_hash);
     if (proc != NULL) {
@@ -568,7 +703,7 @@ inline static BOOL fort_pstree_notify_process_prepare(
         res = !fort_pstree_check_kill_proc(parentProc, createInfo, FORT_PSNODE_KILL_CHILD);
     }
 
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
 
     return res;
 }
@@ -586,6 +721,7 @@ inline static void fort_pstree_notify_process(PFORT_PSTREE ps_tree, PCFORT_PSTRE
         .parentProcessId = parentProcessId,
 
         .commandLine = (createInfo != NULL ? createInfo->CommandLine : NULL),
+        .fileObject = (createInfo != NULL ? createInfo->FileObject : NULL),
     };
 
 #ifdef FORT_DEBUG
@@ -647,34 +783,252 @@ static void fort_pstree_update(PFORT_PSTREE ps_tree, BOOL active)
     }
 }
 
+static PSYSTEM_PROCESSES fort_pstree_query_processes(void)
+{
+    ULONG size = FORT_PSTREE_SNAPSHOT_SIZE_MIN;
+
+    for (;;) {
+        PSYSTEM_PROCESSES processes = fort_mem_type_alloc(FORT_MEM_PSTREE, size);
+        if (processes == NULL)
+            return NULL;
+
+        ULONG outLength = 0;
+        const NTSTATUS status = ZwQuerySystemInformation(
+                SystemProcessInformation, processes, size, &outLength);
+        if (NT_SUCCESS(status))
+            return processes;
+
+        fort_mem_type_free(FORT_MEM_PSTREE, processes);
+
+        if (status != STATUS_INFO_LENGTH_MISMATCH) {
+            LOG("PsTree: Query Processes Error: %x\n", status);
+            return NULL;
+        }
+
+        /* The processes may be created meanwhile */
+        size = outLength + outLength / 4;
+    }
+}
+
+static UINT32 fort_pstree_snapshot_fill(PSYSTEM_PROCESSES processes, PFORT_PSTREE_PID pids)
+{
+    UINT32 n = 0;
+
+    for (;;) {
+        const DWORD processId = (DWORD) processes->ProcessId;
+        const DWORD parentProcessId = (DWORD) processes->ParentProcessId;
+
+        if (!fort_is_system_process(processId, parentProcessId)) {
+            if (pids != NULL) {
+                pids[n].process_id = processId;
+                pids[n].parent_process_id = parentProcessId;
+            }
+            ++n;
+        }
+
+        if (processes->NextEntryOffset == 0)
+            break;
+
+        processes = (PSYSTEM_PROCESSES) ((PCHAR) processes + processes->NextEntryOffset);
+    }
+
+    return n;
+}
+
+static void fort_pstree_snapshot_add(PFORT_PSTREE ps_tree, PFORT_PSTREE_PID pids, UINT32 pids_n)
+{
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
+    {
+        for (UINT32 i = 0; i < pids_n; ++i) {
+            const UINT32 processId = pids[i].process_id;
+            const tommy_key_t pid_hash = fort_pstree_proc_hash(processId);
+
+            /* The process is created already by the notification */
+            if (fort_pstree_find_proc_hash(ps_tree, processId, pid_hash) != NULL)
+                continue;
+
+            PFORT_PSNODE proc = fort_pstree_proc_new(ps_tree, pid_hash);
+
+            proc->process_id = processId;
+            proc->session_id = FORT_LOG_SESSION_UNKNOWN;
+            proc->flags = FORT_PSNODE_UNRESOLVED;
+            proc->app_generation = 0;
+        }
+
+        ps_tree->snapshot = pids;
+        ps_tree->snapshot_n = pids_n;
+        ps_tree->snapshot_index = 0;
+    }
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
+}
+
+FORT_API void fort_pstree_enum_processes(PFORT_PSTREE ps_tree)
+{
+    PSYSTEM_PROCESSES processes = fort_pstree_query_processes();
+    if (processes == NULL)
+        return;
+
+    const UINT32 pids_n = fort_pstree_snapshot_fill(processes, NULL);
+
+    PFORT_PSTREE_PID pids = (pids_n == 0)
+            ? NULL
+            : fort_mem_type_alloc(FORT_MEM_PSTREE, pids_n * sizeof(FORT_PSTREE_PID));
+
+    if (pids != NULL) {
+        fort_pstree_snapshot_fill(processes, pids);
+    }
+
+    fort_mem_type_free(FORT_MEM_PSTREE, processes);
+
+    if (pids == NULL)
+        return;
+
+    /* Only the pids are known now, the worker resolves the paths */
+    fort_pstree_snapshot_add(ps_tree, pids, pids_n);
+
+    fort_worker_queue(&fort_device()->worker, FORT_WORKER_PSTREE);
+}
+
+static BOOL fort_pstree_snapshot_next(PFORT_PSTREE ps_tree, PFORT_PSTREE_PID pid)
+{
+    BOOL res = FALSE;
+
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
+    {
+        if (ps_tree->snapshot_index < ps_tree->snapshot_n) {
+            *pid = ps_tree->snapshot[ps_tree->snapshot_index++];
+            res = TRUE;
+        } else if (ps_tree->snapshot != NULL) {
+            fort_mem_type_free(FORT_MEM_PSTREE, ps_tree->snapshot);
+
+            ps_tree->snapshot = NULL;
+            ps_tree->snapshot_n = 0;
+            ps_tree->snapshot_index = 0;
+        }
+    }
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
+
+    return res;
+}
+
+static void fort_pstree_resolve_proc(
+        PFORT_PSTREE ps_tree, PFORT_PATH_BUFFER pb, const PFORT_PSTREE_PID pid)
+{
+    FORT_PSINFO_HASH psi = {
+        .pid_hash = fort_pstree_proc_hash(pid->process_id),
+        .processId = pid->process_id,
+        .parentProcessId = pid->parent_process_id,
+    };
+
+    /* The exited process's node is deleted by the notification */
+    const HANDLE processHandle = OpenProcessById(psi.processId);
+    if (processHandle == NULL)
+        return;
+
+    pb->path.Length = 0;
+    pb->path.MaximumLength = FORT_CONF_APP_PATH_MAX_SIZE;
+    pb->path.Buffer = pb->buffer;
+
+    const NTSTATUS status = GetProcessImageName(processHandle, pb);
+
+    psi.sessionId = GetProcessSessionId(processHandle);
+
+    ZwClose(processHandle);
+
+    if (!NT_SUCCESS(status))
+        return;
+
+    /* The services' names are set by the service's services list */
+    psi.path = &pb->path;
+    psi.isSvcHost = fort_pstree_svchost_path_check(psi.path);
+
+    fort_pstree_psinfo_check_conf(&psi);
+
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
+    {
+        PFORT_PSNODE proc = fort_pstree_find_proc_hash(ps_tree, psi.processId, psi.pid_hash);
+
+        if (proc != NULL && (proc->flags & FORT_PSNODE_UNRESOLVED) != 0) {
+            proc->flags &= ~FORT_PSNODE_UNRESOLVED;
+            proc->session_id = psi.sessionId;
+
+            fort_pstree_proc_check_svchost(ps_tree, &psi, proc);
+
+            if (proc->ps_name == NULL) {
+                fort_pstree_check_proc_inheritance(ps_tree, &psi, proc);
+            }
+        }
+    }
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
+}
+
+FORT_API void fort_pstree_resolve_processes(void)
+{
+    PFORT_PSTREE ps_tree = &fort_device()->ps_tree;
+
+    PFORT_PATH_BUFFER pb = fort_mem_type_alloc(FORT_MEM_PSTREE, sizeof(FORT_PATH_BUFFER));
+    if (pb == NULL)
+        return;
+
+    /* The parents precede their children in the snapshot mostly */
+    FORT_PSTREE_PID pid;
+    int n = FORT_PSTREE_RESOLVE_BATCH;
+
+    while (n-- > 0 && fort_pstree_snapshot_next(ps_tree, &pid)) {
+        fort_pstree_resolve_proc(ps_tree, pb, &pid);
+    }
+
+    fort_mem_type_free(FORT_MEM_PSTREE, pb);
+
+    /* Don't hold the system worker thread for long */
+    if (n < 0) {
+        fort_worker_queue(&fort_device()->worker, FORT_WORKER_PSTREE);
+    }
+}
+
 FORT_API void fort_pstree_open(PFORT_PSTREE ps_tree)
 {
-    fort_pool_list_init(&ps_tree->pool_list);
+    fort_pool_list_init(&ps_tree->pool_list, FORT_MEM_PSTREE, FORT_POOL_SIZE_CLASSES);
     fort_pool_init(&ps_tree->pool_list, FORT_PSTREE_NAMES_POOL_SIZE);
 
     tommy_list_init(&ps_tree->free_procs);
 
     tommy_arrayof_init(&ps_tree->procs, sizeof(FORT_PSNODE));
     tommy_hashdyn_init(&ps_tree->procs_map);
+    tommy_hashdyn_init(&ps_tree->tags_map);
 
-    KeInitializeSpinLock(&ps_tree->lock);
+    ps_tree->lock = 0;
 
     fort_pstree_update(ps_tree, /*active=*/TRUE); /* Start process monitor */
 }
 
+FORT_API void fort_pstree_trim(PFORT_PSTREE ps_tree)
+{
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
+    if (fort_pool_trim_needed(&ps_tree->pool_list)) {
+        fort_pool_trim(&ps_tree->pool_list);
+    }
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
+}
+
 FORT_API void fort_pstree_close(PFORT_PSTREE ps_tree)
 {
     fort_pstree_update(ps_tree, /*active=*/FALSE); /* Stop process monitor */
 
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&ps_tree->lock, &lock_queue);
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
     {
+        if (ps_tree->snapshot != NULL) {
+            fort_mem_type_free(FORT_MEM_PSTREE, ps_tree->snapshot);
+            ps_tree->snapshot = NULL;
+        }
+
         fort_pool_done(&ps_tree->pool_list);
 
         tommy_arrayof_done(&ps_tree->procs);
         tommy_hashdyn_done(&ps_tree->procs_map);
+        tommy_hashdyn_done(&ps_tree->tags_map);
     }
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
 }
 
 static BOOL fort_pstree_get_proc_name_locked(PFORT_PSTREE ps_tree, DWORD processId,
@@ -695,6 +1049,9 @@ static BOOL fort_pstree_get_proc_name_locked(PFORT_PSTREE ps_tree, DWORD process
             == FORT_PSNODE_NAME_INHERIT)
         return FALSE;
 
+    /* The name outlives the process's node, until the reader puts it */
+    InterlockedIncrement(&ps_name->refcount);
+
     path->Length = ps_name->size;
     path->MaximumLength = ps_name->size;
     path->Buffer = ps_name->data;
@@ -709,16 +1066,150 @@ FORT_API BOOL fort_pstree_get_proc_name(PFORT_PSTREE ps_tree, DWORD processId, P
 {
     BOOL res;
 
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&ps_tree->lock, &lock_queue);
+    const KIRQL oldIrql = ExAcquireSpinLockShared(&ps_tree->lock);
     {
         res = fort_pstree_get_proc_name_locked(ps_tree, processId, path, isSvcHost, inherited);
     }
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+    ExReleaseSpinLockShared(&ps_tree->lock, oldIrql);
+
+    return res;
+}
+
+FORT_API void fort_pstree_put_proc_name(PFORT_PSTREE ps_tree, PCUNICODE_STRING path)
+{
+    PFORT_PSNAME ps_name = CONTAINING_RECORD(path->Buffer, FORT_PSNAME, data);
+
+    if (InterlockedDecrement(&ps_name->refcount) != 0)
+        return;
+
+    /* The process's node is deleted already */
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
+    {
+        fort_pstree_name_free(ps_tree, ps_name);
+    }
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
+}
+
+static PFORT_PSTAG fort_pstree_find_tag(PFORT_PSTREE ps_tree, UINT32 service_tag)
+{
+    const tommy_key_t tag_hash = fort_pstree_tag_hash(service_tag);
+
+    PFORT_PSTAG tag = (PFORT_PSTAG) tommy_hashdyn_bucket(&ps_tree->tags_map, tag_hash);
+
+    while (tag != NULL) {
+        if (tag->service_tag == service_tag)
+            return tag;
+
+        tag = tag->next;
+    }
+
+    return NULL;
+}
+
+FORT_API BOOL fort_pstree_get_service_name(
+        PFORT_PSTREE ps_tree, UINT32 service_tag, PUNICODE_STRING path)
+{
+    PFORT_PSNAME ps_name = NULL;
+
+    const KIRQL oldIrql = ExAcquireSpinLockShared(&ps_tree->lock);
+    {
+        PFORT_PSTAG tag = fort_pstree_find_tag(ps_tree, service_tag);
+
+        if (tag != NULL) {
+            ps_name = tag->ps_name;
+
+            InterlockedIncrement(&ps_name->refcount);
+        }
+    }
+    ExReleaseSpinLockShared(&ps_tree->lock, oldIrql);
+
+    if (ps_name == NULL)
+        return FALSE;
+
+    path->Length = ps_name->size;
+    path->MaximumLength = ps_name->size;
+    path->Buffer = ps_name->data;
+
+    return TRUE;
+}
+
+FORT_API UINT32 fort_pstree_get_proc_session_id(PFORT_PSTREE ps_tree, DWORD processId)
+{
+    UINT32 session_id = FORT_LOG_SESSION_UNKNOWN;
+
+    const KIRQL oldIrql = ExAcquireSpinLockShared(&ps_tree->lock);
+    {
+        PFORT_PSNODE proc = fort_pstree_find_proc(ps_tree, processId);
+
+        if (proc != NULL) {
+            session_id = proc->session_id;
+        }
+    }
+    ExReleaseSpinLockShared(&ps_tree->lock, oldIrql);
+
+    return session_id;
+}
+
+/* The file id of the process's own image path only */
+FORT_API BOOL fort_pstree_get_proc_file_id(
+        PFORT_PSTREE ps_tree, DWORD processId, PFORT_FILE_ID file_id)
+{
+    BOOL res = FALSE;
+
+    const KIRQL oldIrql = ExAcquireSpinLockShared(&ps_tree->lock);
+    {
+        PFORT_PSNODE proc = fort_pstree_find_proc(ps_tree, processId);
+
+        if (proc != NULL
+                && (proc->flags
+                           & (FORT_PSNODE_FILE_ID | FORT_PSNODE_NAME_INHERITED
+                                   | FORT_PSNODE_NAME_CUSTOM | FORT_PSNODE_IS_SVCHOST))
+                        == FORT_PSNODE_FILE_ID) {
+            *file_id = proc->file_id;
+            res = TRUE;
+        }
+    }
+    ExReleaseSpinLockShared(&ps_tree->lock, oldIrql);
 
     return res;
 }
 
+FORT_API BOOL fort_pstree_get_proc_app(PFORT_PSTREE ps_tree, DWORD processId, LONG generation,
+        tommy_key_t path_hash, PFORT_APP_ENTRY app_data)
+{
+    BOOL res = FALSE;
+
+    const KIRQL oldIrql = ExAcquireSpinLockShared(&ps_tree->lock);
+    {
+        PFORT_PSNODE proc = fort_pstree_find_proc(ps_tree, processId);
+
+        if (proc != NULL && proc->app_generation == generation
+                && proc->app_path_hash == path_hash) {
+            *app_data = proc->app_data;
+            res = TRUE;
+        }
+    }
+    ExReleaseSpinLockShared(&ps_tree->lock, oldIrql);
+
+    return res;
+}
+
+FORT_API void fort_pstree_set_proc_app(PFORT_PSTREE ps_tree, DWORD processId, LONG generation,
+        tommy_key_t path_hash, FORT_APP_ENTRY app_data)
+{
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
+    {
+        PFORT_PSNODE proc = fort_pstree_find_proc(ps_tree, processId);
+
+        if (proc != NULL) {
+            proc->app_data = app_data;
+            proc->app_generation = generation;
+            proc->app_path_hash = path_hash;
+        }
+    }
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
+}
+
 inline static void fort_pstree_update_service_proc(
         PFORT_PSTREE ps_tree, PCUNICODE_STRING serviceName, DWORD processId)
 {
@@ -739,6 +1230,31 @@ inline static void fort_pstree_update_service_proc(
     }
 }
 
+inline static void fort_pstree_update_service_tag(
+        PFORT_PSTREE ps_tree, PCUNICODE_STRING serviceName, UINT32 service_tag)
+{
+    PFORT_PSTAG tag = fort_pstree_find_tag(ps_tree, service_tag);
+    if (tag == NULL) {
+        tag = fort_pool_malloc(&ps_tree->pool_list, sizeof(FORT_PSTAG));
+        if (tag == NULL)
+            return;
+
+        tag->service_tag = service_tag;
+
+        tommy_hashdyn_insert(&ps_tree->tags_map, (tommy_hashdyn_node *) tag, /*ps_name=*/NULL,
+                fort_pstree_tag_hash(service_tag));
+    }
+
+    PFORT_PSNAME ps_name = fort_pstree_create_service_name(ps_tree, serviceName);
+    if (ps_name == NULL)
+        return;
+
+    /* The tag may be reused by another service */
+    fort_pstree_name_del(ps_tree, tag->ps_name);
+
+    tag->ps_name = ps_name;
+}
+
 static int fort_pstree_update_service(
         PFORT_PSTREE ps_tree, const PFORT_SERVICE_INFO service, const PCHAR end_data)
 {
@@ -755,14 +1271,17 @@ static int fort_pstree_update_service(
 
     fort_pstree_update_service_proc(ps_tree, &serviceName, service->process_id);
 
+    if (service->service_tag != 0) {
+        fort_pstree_update_service_tag(ps_tree, &serviceName, service->service_tag);
+    }
+
     return FORT_SERVICE_INFO_NAME_OFF + FORT_CONF_STR_DATA_SIZE(serviceName.Length);
 }
 
 FORT_API void fort_pstree_update_services(
         PFORT_PSTREE ps_tree, const PFORT_SERVICE_INFO_LIST services, ULONG data_len)
 {
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&ps_tree->lock, &lock_queue);
+    const KIRQL oldIrql = ExAcquireSpinLockExclusive(&ps_tree->lock);
     {
         PCHAR data = (PCHAR) services->data;
         const PCHAR end_data = data + data_len;
@@ -777,5 +1296,5 @@ FORT_API void fort_pstree_update_services(
             data += size;
         }
     }
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+    ExReleaseSpinLockExclusive(&ps_tree->lock, oldIrql);
 }
@@ -9,6 +9,12 @@
 
 #define FORT_PSTREE_ACTIVE 0x0001
 
+typedef struct fort_pstree_pid
+{
+    UINT32 process_id;
+    UINT32 parent_process_id;
+} FORT_PSTREE_PID, *PFORT_PSTREE_PID;
+
 typedef struct fort_pstree
 {
     UCHAR volatile flags;
@@ -21,7 +27,14 @@ typedef struct fort_pstree
     tommy_arrayof procs;
     tommy_hashdyn procs_map;
 
-    KSPIN_LOCK lock;
+    tommy_hashdyn tags_map; /* service names by the svchost's service tags */
+
+    /* The existing processes, to be resolved by the worker */
+    PFORT_PSTREE_PID snapshot;
+    UINT32 snapshot_n;
+    UINT32 snapshot_index;
+
+    EX_SPIN_LOCK lock; /* the lookups are shared */
 } FORT_PSTREE, *PFORT_PSTREE;
 
 #if defined(__cplusplus)
@@ -32,9 +45,31 @@ FORT_API void fort_pstree_open(PFORT_PSTREE ps_tree);
 
 FORT_API void fort_pstree_close(PFORT_PSTREE ps_tree);
 
+FORT_API void fort_pstree_trim(PFORT_PSTREE ps_tree);
+
+FORT_API void fort_pstree_enum_processes(PFORT_PSTREE ps_tree);
+
+FORT_API void fort_pstree_resolve_processes(void);
+
 FORT_API BOOL fort_pstree_get_proc_name(PFORT_PSTREE ps_tree, DWORD processId, PUNICODE_STRING path,
         BOOL *isSvcHost, BOOL *inherited);
 
+FORT_API void fort_pstree_put_proc_name(PFORT_PSTREE ps_tree, PCUNICODE_STRING path);
+
+FORT_API BOOL fort_pstree_get_service_name(
+        PFORT_PSTREE ps_tree, UINT32 service_tag, PUNICODE_STRING path);
+
+FORT_API UINT32 fort_pstree_get_proc_session_id(PFORT_PSTREE ps_tree, DWORD processId);
+
+FORT_API BOOL fort_pstree_get_proc_file_id(
+        PFORT_PSTREE ps_tree, DWORD processId, PFORT_FILE_ID file_id);
+
+FORT_API BOOL fort_pstree_get_proc_app(PFORT_PSTREE ps_tree, DWORD processId, LONG generation,
+        tommy_key_t path_hash, PFORT_APP_ENTRY app_data);
+
+FORT_API void fort_pstree_set_proc_app(PFORT_PSTREE ps_tree, DWORD processId, LONG generation,
+        tommy_key_t path_hash, FORT_APP_ENTRY app_data);
+
 FORT_API void fort_pstree_update_services(
         PFORT_PSTREE ps_tree, const PFORT_SERVICE_INFO_LIST services, ULONG data_len);
 
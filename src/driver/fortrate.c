@@ -0,0 +1,118 @@
+/* Fort Firewall Inbound Connections Rate Limit */
+
+#include "fortrate.h"
+
+#include "forttds.h"
+
+FORT_API void fort_rate_open(PFORT_RATE rate)
+{
+    KeInitializeSpinLock(&rate->lock);
+}
+
+FORT_API void fort_rate_conf_update(PFORT_RATE rate, const PFORT_CONF conf)
+{
+    const UINT16 limit = conf->accept_rate_limit;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&rate->lock, &lock_queue);
+
+    rate->limit = limit;
+    rate->interval = (limit != 0) ? FORT_RATE_BURST_TIME / limit : 0;
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+}
+
+static void fort_rate_entry_drop(PFORT_RATE rate, PFORT_RATE_ENTRY entry)
+{
+    LARGE_INTEGER system_time;
+    KeQuerySystemTime(&system_time);
+
+    const INT64 unix_time = fort_system_to_unix_time(system_time.QuadPart);
+
+    if (entry->drops++ == 0) {
+        entry->first_drop_time = unix_time;
+        ++rate->drops_pending;
+    }
+
+    entry->last_drop_time = unix_time;
+}
+
+static BOOL fort_rate_entry_exceeded(PFORT_RATE rate, PFORT_RATE_ENTRY entry, INT64 now)
+{
+    const INT64 arrival_time = (entry->arrival_time > now) ? entry->arrival_time : now;
+
+    /* Up to the limit's count of connections is allowed at once */
+    if (arrival_time + rate->interval - now > FORT_RATE_BURST_TIME) {
+        fort_rate_entry_drop(rate, entry);
+        return TRUE;
+    }
+
+    entry->arrival_time = arrival_time + rate->interval;
+
+    return FALSE;
+}
+
+FORT_API BOOL fort_rate_accept_exceeded(PFORT_RATE rate, const UINT32 *remote_ip, BOOL isIPv6)
+{
+    if (rate->limit == 0)
+        return FALSE;
+
+    const UINT32 ip_size = FORT_IP_ADDR_SIZE(isIPv6);
+
+    const tommy_key_t ip_hash = (tommy_key_t) tommy_hash_u32(0, remote_ip, ip_size);
+
+    const INT64 now = (INT64) KeQueryInterruptTime();
+
+    BOOL exceeded = FALSE;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&rate->lock, &lock_queue);
+
+    PFORT_RATE_ENTRY entry = &rate->entries[ip_hash & (FORT_RATE_ENTRIES_COUNT - 1)];
+
+    if (entry->isIPv6 == (UCHAR) isIPv6 && RtlEqualMemory(entry->remote_ip, remote_ip, ip_size)) {
+        exceeded = fort_rate_entry_exceeded(rate, entry, now);
+    } else if (entry->arrival_time <= now && entry->drops == 0) {
+        /* Replace the aged entry: its bucket is full again */
+        RtlZeroMemory(entry->remote_ip, sizeof(entry->remote_ip));
+        RtlCopyMemory(entry->remote_ip, remote_ip, ip_size);
+        entry->isIPv6 = (UCHAR) isIPv6;
+        entry->arrival_time = now + rate->interval;
+    }
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return exceeded;
+}
+
+FORT_API void fort_rate_summary_flush(
+        PFORT_RATE rate, PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info)
+{
+    if (rate->drops_pending == 0)
+        return;
+
+    const INT64 now = (INT64) KeQueryInterruptTime();
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&rate->lock, &lock_queue);
+
+    if (now - rate->summary_time >= FORT_RATE_SUMMARY_WINDOW) {
+        rate->summary_time = now;
+
+        for (int i = 0; i < FORT_RATE_ENTRIES_COUNT && rate->drops_pending != 0; ++i) {
+            PFORT_RATE_ENTRY entry = &rate->entries[i];
+
+            if (entry->drops == 0)
+                continue;
+
+            fort_buffer_blocked_ip_summary_write(buf, entry->isIPv6,
+                    FORT_BLOCK_REASON_ACCEPT_RATE, entry->remote_ip, entry->drops,
+                    entry->first_drop_time, entry->last_drop_time, irp, info);
+
+            entry->drops = 0;
+            --rate->drops_pending;
+        }
+    }
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+}
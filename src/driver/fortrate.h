@@ -0,0 +1,58 @@
+#ifndef FORTRATE_H
+#define FORTRATE_H
+
+#include "fortdrv.h"
+
+#include "common/fortconf.h"
+#include "fortbuf.h"
+
+#define FORT_RATE_ENTRIES_COUNT  512 /* must be power of 2 */
+#define FORT_RATE_BURST_TIME     (1 * 10000000LL) /* 1 second in 100-ns units */
+#define FORT_RATE_SUMMARY_WINDOW (1 * 10000000LL)
+
+/* The inbound connections of a remote address, limited by the token bucket's arrival time */
+typedef struct fort_rate_entry
+{
+    UINT32 remote_ip[4];
+    UCHAR isIPv6;
+
+    UINT32 drops; /* since the last summary */
+
+    INT64 arrival_time; /* interrupt time of the next conforming connection */
+
+    INT64 first_drop_time; /* unix time */
+    INT64 last_drop_time;
+} FORT_RATE_ENTRY, *PFORT_RATE_ENTRY;
+
+typedef struct fort_rate
+{
+    UINT16 limit; /* connections per second per remote address, 0 for no limit */
+    UINT16 drops_pending; /* entries to summarize */
+
+    INT64 interval; /* 100-ns units between the conforming connections */
+
+    INT64 summary_time; /* interrupt time of the last summary */
+
+    FORT_RATE_ENTRY entries[FORT_RATE_ENTRIES_COUNT];
+
+    KSPIN_LOCK lock;
+} FORT_RATE, *PFORT_RATE;
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+FORT_API void fort_rate_open(PFORT_RATE rate);
+
+FORT_API void fort_rate_conf_update(PFORT_RATE rate, const PFORT_CONF conf);
+
+FORT_API BOOL fort_rate_accept_exceeded(PFORT_RATE rate, const UINT32 *remote_ip, BOOL isIPv6);
+
+FORT_API void fort_rate_summary_flush(
+        PFORT_RATE rate, PFORT_BUFFER buf, PIRP *irp, ULONG_PTR *info);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // FORTRATE_H
@@ -2,7 +2,10 @@
 
 #include "fortstat.h"
 
-#define FORT_STAT_POOL_TAG 'SwfF'
+#include "common/fortlog.h"
+
+#include "fortetw.h"
+#include "fortmem.h"
 
 #define FORT_PROC_BAD_INDEX ((UINT16) -1)
 #define FORT_PROC_COUNT_MAX 0xFFFF
@@ -24,9 +27,24 @@ static void fort_stat_proc_active_add(PFORT_STAT stat, PFORT_STAT_PROC proc)
     stat->proc_active_count++;
 }
 
+static void fort_stat_map_insert(
+        PFORT_STAT stat, PFORT_HASH map, tommy_node *node, tommy_key_t key)
+{
+    const LARGE_INTEGER begin = KeQueryPerformanceCounter(NULL);
+
+    fort_hash_insert(map, node, /*data=*/NULL, key);
+
+    const LARGE_INTEGER end = KeQueryPerformanceCounter(NULL);
+    const INT64 ticks = end.QuadPart - begin.QuadPart;
+
+    if (stat->insert_ticks_max < ticks) {
+        stat->insert_ticks_max = ticks;
+    }
+}
+
 static PFORT_STAT_PROC fort_stat_proc_get(PFORT_STAT stat, UINT32 process_id, tommy_key_t pid_hash)
 {
-    PFORT_STAT_PROC proc = (PFORT_STAT_PROC) tommy_hashdyn_bucket(&stat->procs_map, pid_hash);
+    PFORT_STAT_PROC proc = (PFORT_STAT_PROC) fort_hash_bucket(&stat->procs_map, pid_hash);
 
     while (proc != NULL) {
         if (proc->process_id == process_id)
@@ -37,9 +55,30 @@ static PFORT_STAT_PROC fort_stat_proc_get(PFORT_STAT stat, UINT32 process_id, to
     return NULL;
 }
 
+static void fort_stat_cpus_grow(PFORT_STAT stat, tommy_size_t count)
+{
+    for (ULONG i = 0; i < stat->cpu_count; ++i) {
+        tommy_arrayof_grow(&stat->cpus[i].trafs, count);
+    }
+}
+
+static void fort_stat_cpus_traf_clear(PFORT_STAT stat, UINT16 proc_index)
+{
+    for (ULONG i = 0; i < stat->cpu_count; ++i) {
+        PFORT_STAT_CPU_TRAF cpu_traf = tommy_arrayof_ref(&stat->cpus[i].trafs, proc_index);
+
+        InterlockedExchange64((LONG64 volatile *) &cpu_traf->traf.in_bytes, 0);
+        InterlockedExchange64((LONG64 volatile *) &cpu_traf->traf.out_bytes, 0);
+    }
+}
+
 static void fort_stat_proc_free(PFORT_STAT stat, PFORT_STAT_PROC proc)
 {
-    tommy_hashdyn_remove_existing(&stat->procs_map, (tommy_hashdyn_node *) proc);
+    fort_hash_remove_existing(&stat->procs_map, (tommy_node *) proc);
+
+    /* Drop the not folded traffic */
+    proc->log_stat = FALSE;
+    fort_stat_cpus_traf_clear(stat, proc->proc_index);
 
     /* Add to free chain */
     proc->next = stat->proc_free;
@@ -67,15 +106,20 @@ static PFORT_STAT_PROC fort_stat_proc_add(PFORT_STAT stat, UINT32 process_id)
         proc = tommy_arrayof_ref(&stat->procs, size);
 
         proc->proc_index = (UINT16) size;
+
+        fort_stat_cpus_grow(stat, size + 1);
     }
 
-    tommy_hashdyn_insert(&stat->procs_map, (tommy_hashdyn_node *) proc, 0, pid_hash);
+    fort_stat_map_insert(stat, &stat->procs_map, (tommy_node *) proc, pid_hash);
 
     proc->process_id = process_id;
-    proc->traf.v = 0;
+    proc->traf.in_bytes = 0;
+    proc->traf.out_bytes = 0;
     proc->log_stat = FALSE;
     proc->active = FALSE;
     proc->refcount = 0;
+    proc->conn_count = 0;
+    proc->blocked_count = 0;
 
     return proc;
 }
@@ -94,6 +138,29 @@ static void fort_stat_proc_inc(PFORT_STAT stat, UINT16 proc_index)
     ++proc->refcount;
 }
 
+static void fort_stat_proc_conn_add(PFORT_STAT stat, PFORT_STAT_PROC proc, BOOL blocked)
+{
+    UINT16 *count = blocked ? &proc->blocked_count : &proc->conn_count;
+
+    if (*count != MAXUINT16) {
+        ++*count;
+    }
+
+    fort_stat_proc_active_add(stat, proc);
+}
+
+static void fort_stat_proc_traf_add(PFORT_STAT stat, PFORT_STAT_PROC proc, const FORT_TRAF traf)
+{
+    if (!proc->log_stat)
+        return;
+
+    /* Add traffic to process's bytes */
+    proc->traf.in_bytes += traf.in_bytes;
+    proc->traf.out_bytes += traf.out_bytes;
+
+    fort_stat_proc_active_add(stat, proc);
+}
+
 static void fort_stat_proc_dec(PFORT_STAT stat, UINT16 proc_index)
 {
     PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, proc_index);
@@ -282,7 +349,7 @@ static void fort_flow_context_remove(PVOID stat_arg, PVOID flow_node)
 
 static PFORT_FLOW fort_flow_get(PFORT_STAT stat, UINT64 flow_id, tommy_key_t flow_hash)
 {
-    PFORT_FLOW flow = (PFORT_FLOW) tommy_hashdyn_bucket(&stat->flows_map, flow_hash);
+    PFORT_FLOW flow = (PFORT_FLOW) fort_hash_bucket(&stat->flows_map, flow_hash);
 
     while (flow != NULL) {
         if (flow->flow_id == flow_id)
@@ -293,11 +360,50 @@ static PFORT_FLOW fort_flow_get(PFORT_STAT stat, UINT64 flow_id, tommy_key_t flo
     return NULL;
 }
 
+static void fort_flow_active_add(PFORT_STAT stat, PFORT_FLOW flow)
+{
+    /* Add to active chain */
+    flow->prev_active = NULL;
+    flow->next_active = stat->flow_active;
+
+    if (stat->flow_active != NULL) {
+        stat->flow_active->prev_active = flow;
+    }
+    stat->flow_active = flow;
+
+    stat->flow_active_count++;
+}
+
+static void fort_flow_active_remove(PFORT_STAT stat, PFORT_FLOW flow)
+{
+    /* Remove from active chain */
+    if (flow->prev_active != NULL) {
+        flow->prev_active->next_active = flow->next_active;
+    } else {
+        stat->flow_active = flow->next_active;
+    }
+
+    if (flow->next_active != NULL) {
+        flow->next_active->prev_active = flow->prev_active;
+    }
+
+    stat->flow_active_count--;
+}
+
 static void fort_flow_free(PFORT_STAT stat, PFORT_FLOW flow)
 {
+    /* The not flushed traffic is counted by the process */
+    if ((fort_flow_flags_set(flow, FORT_FLOW_STAT_ACTIVE, FALSE) & FORT_FLOW_STAT_ACTIVE) != 0) {
+        fort_flow_active_remove(stat, flow);
+    }
+
+    fort_flow_flags_set(flow, FORT_FLOW_ACTIVE, FALSE);
+
     fort_stat_proc_dec(stat, flow->opt.proc_index);
 
-    tommy_hashdyn_remove_existing(&stat->flows_map, (tommy_hashdyn_node *) flow);
+    fort_hash_remove_existing(&stat->flows_map, (tommy_node *) flow);
+
+    fort_etw_flow_delete(flow->flow_id);
 
     /* Add to free chain */
     flow->next = stat->flow_free;
@@ -322,10 +428,12 @@ static PFORT_FLOW fort_flow_new(PFORT_STAT stat, UINT64 flow_id, const tommy_key
         flow = tommy_arrayof_ref(&stat->flows, size);
     }
 
-    tommy_hashdyn_insert(&stat->flows_map, (tommy_hashdyn_node *) flow, NULL, flow_hash);
+    fort_stat_map_insert(stat, &stat->flows_map, (tommy_node *) flow, flow_hash);
 
     flow->flow_id = flow_id;
 
+    RtlZeroMemory(&flow->traf, sizeof(FORT_FLOW_TRAF));
+
     return flow;
 }
 
@@ -337,6 +445,12 @@ inline static UCHAR fort_stat_group_speed_limit(PFORT_CONF_GROUP conf_group, UCH
     return (((conf_group->limit_io_bits) >> (group_index * 2)) & 3);
 }
 
+inline static BOOL fort_stat_group_flow_skip(PFORT_CONF_GROUP conf_group, UCHAR group_index)
+{
+    return (conf_group->stat_off_bits & (1 << group_index)) != 0
+            && fort_stat_group_speed_limit(conf_group, group_index) == 0;
+}
+
 inline static NTSTATUS fort_flow_add_new(PFORT_STAT stat, PFORT_FLOW *flow, UINT64 flow_id,
         tommy_key_t flow_hash, BOOL isIPv6, BOOL is_tcp, BOOL inbound, BOOL is_reauth)
 {
@@ -355,8 +469,19 @@ inline static NTSTATUS fort_flow_add_new(PFORT_STAT stat, PFORT_FLOW *flow, UINT
     return status;
 }
 
+static void fort_flow_endpoint_set(
+        PFORT_FLOW flow, const PFORT_FLOW_ENDPOINT endpoint, BOOL isIPv6)
+{
+    RtlZeroMemory(flow->remote_ip, sizeof(flow->remote_ip));
+    RtlCopyMemory(flow->remote_ip, endpoint->remote_ip, FORT_IP_ADDR_SIZE(isIPv6));
+
+    flow->local_port = endpoint->local_port;
+    flow->remote_port = endpoint->remote_port;
+    flow->ip_proto = endpoint->ip_proto;
+}
+
 static NTSTATUS fort_flow_add(PFORT_STAT stat, UINT64 flow_id, UCHAR group_index, UINT16 proc_index,
-        BOOL isIPv6, BOOL is_tcp, BOOL inbound, BOOL is_reauth)
+        BOOL isIPv6, BOOL is_tcp, BOOL inbound, BOOL is_reauth, const PFORT_FLOW_ENDPOINT endpoint)
 {
     const tommy_key_t flow_hash = fort_flow_hash(flow_id);
     PFORT_FLOW flow = fort_flow_get(stat, flow_id, flow_hash);
@@ -369,25 +494,79 @@ static NTSTATUS fort_flow_add(PFORT_STAT stat, UINT64 flow_id, UCHAR group_index
             return status;
 
         fort_stat_proc_inc(stat, proc_index);
+
+        if (!is_reauth) {
+            PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, proc_index);
+
+            fort_stat_proc_conn_add(stat, proc, /*blocked=*/FALSE);
+        }
+
+        ++stat->flow_inserts;
+
+        fort_etw_flow_add(flow_id, proc_index, group_index);
     }
 
     const UCHAR speed_limit = fort_stat_group_speed_limit(&stat->conf_group, group_index);
 
-    flow->opt.flags = speed_limit | (is_tcp ? FORT_FLOW_TCP : 0) | (isIPv6 ? FORT_FLOW_IP6 : 0)
-            | (inbound ? FORT_FLOW_INBOUND : 0);
+    /* Keep the reauthorized flow in the active chain */
+    const UCHAR stat_active = (flow->opt.flags & FORT_FLOW_STAT_ACTIVE);
+
+    flow->opt.flags = FORT_FLOW_ACTIVE | speed_limit | stat_active | (is_tcp ? FORT_FLOW_TCP : 0)
+            | (isIPv6 ? FORT_FLOW_IP6 : 0) | (inbound ? FORT_FLOW_INBOUND : 0);
     flow->opt.group_index = group_index;
     flow->opt.proc_index = proc_index;
 
+    fort_flow_endpoint_set(flow, endpoint, isIPv6);
+
     return STATUS_SUCCESS;
 }
 
+static void fort_stat_cpus_open(PFORT_STAT stat)
+{
+    const ULONG cpu_count = KeQueryMaximumProcessorCountEx(ALL_PROCESSOR_GROUPS);
+    const SIZE_T size = cpu_count * sizeof(FORT_STAT_CPU);
+
+    /* The traffic is added under the stat lock on allocation failure */
+    PFORT_STAT_CPU cpus = fort_mem_type_alloc(FORT_MEM_STAT, size);
+    if (cpus == NULL)
+        return;
+
+    RtlZeroMemory(cpus, size);
+
+    for (ULONG i = 0; i < cpu_count; ++i) {
+        tommy_arrayof_init(&cpus[i].trafs, sizeof(FORT_STAT_CPU_TRAF));
+    }
+
+    stat->cpus = cpus;
+    stat->cpu_count = cpu_count;
+}
+
+static void fort_stat_cpus_close(PFORT_STAT stat)
+{
+    if (stat->cpus == NULL)
+        return;
+
+    for (ULONG i = 0; i < stat->cpu_count; ++i) {
+        tommy_arrayof_done(&stat->cpus[i].trafs);
+    }
+
+    fort_mem_type_free(FORT_MEM_STAT, stat->cpus);
+
+    stat->cpus = NULL;
+    stat->cpu_count = 0;
+}
+
 FORT_API void fort_stat_open(PFORT_STAT stat)
 {
+    fort_stat_cpus_open(stat);
+
     tommy_arrayof_init(&stat->procs, sizeof(FORT_STAT_PROC));
-    tommy_hashdyn_init(&stat->procs_map);
+    fort_hash_init(&stat->procs_map);
 
     tommy_arrayof_init(&stat->flows, sizeof(FORT_FLOW));
-    tommy_hashdyn_init(&stat->flows_map);
+    fort_hash_init(&stat->flows_map);
+
+    KeInitializeEvent(&stat->flow_closed_event, NotificationEvent, FALSE);
 
     KeInitializeSpinLock(&stat->lock);
 }
@@ -402,23 +581,20 @@ FORT_API void fort_stat_close_flows(PFORT_STAT stat)
         if ((flags & FORT_STAT_CLOSED) == 0) {
             fort_stat_flags_set(stat, FORT_STAT_CLOSED, TRUE);
 
-            InterlockedAdd(&stat->flow_closing_count, (LONG) tommy_hashdyn_count(&stat->flows_map));
+            InterlockedAdd(&stat->flow_closing_count, (LONG) fort_hash_count(&stat->flows_map));
         }
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 
+    /* The closed stat doesn't add or free the flows, so walk them without the lock */
     while (InterlockedAdd(&stat->flow_closing_count, 0) > 0) {
-        KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
-        {
-            tommy_hashdyn_foreach_node_arg(&stat->flows_map, &fort_flow_context_remove, stat);
-        }
-        KeReleaseInStackQueuedSpinLock(&lock_queue);
+        fort_hash_foreach_node_arg(&stat->flows_map, &fort_flow_context_remove, stat);
 
-        /* Wait for asynchronously deleting flows */
-        LARGE_INTEGER delay;
-        delay.QuadPart = -50 * 1000 * 10; /* sleep 50000us (50ms) */
+        /* Wait for asynchronously deleting flows, then retry the failed removals */
+        LARGE_INTEGER timeout;
+        timeout.QuadPart = -1000 * 1000 * 10; /* 1s */
 
-        KeDelayExecutionThread(KernelMode, FALSE, &delay);
+        KeWaitForSingleObject(&stat->flow_closed_event, Executive, KernelMode, FALSE, &timeout);
     }
 }
 
@@ -430,10 +606,12 @@ FORT_API void fort_stat_close(PFORT_STAT stat)
     KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
 
     tommy_arrayof_done(&stat->procs);
-    tommy_hashdyn_done(&stat->procs_map);
+    fort_hash_done(&stat->procs_map);
 
     tommy_arrayof_done(&stat->flows);
-    tommy_hashdyn_done(&stat->flows_map);
+    fort_hash_done(&stat->flows_map);
+
+    fort_stat_cpus_close(stat);
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
@@ -451,18 +629,21 @@ FORT_API void fort_stat_log_update(PFORT_STAT stat, BOOL log_stat)
     /* Clear the processes' active list */
     fort_stat_traf_flush(stat, /*proc_count=*/FORT_PROC_COUNT_MAX, /*out=*/NULL);
 
+    /* Clear the flows' active list */
+    fort_stat_flow_traf_flush(stat, stat->flow_active_count, /*out=*/NULL);
+
     /* Clear the processes' logged flag */
-    tommy_hashdyn_foreach_node(&stat->procs_map, &fort_stat_proc_unlog);
+    fort_hash_foreach_node(&stat->procs_map, &fort_stat_proc_unlog);
 
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
-FORT_API void fort_stat_conf_update(PFORT_STAT stat, const PFORT_CONF_IO conf_io)
+FORT_API void fort_stat_conf_update(PFORT_STAT stat, const PFORT_CONF_GROUP conf_group)
 {
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
     {
-        stat->conf_group = conf_io->conf_group;
+        stat->conf_group = *conf_group;
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
@@ -473,8 +654,131 @@ FORT_API void fort_stat_conf_flags_update(PFORT_STAT stat, const PFORT_CONF_FLAG
     KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
     {
         stat->conf_group.group_bits = (UINT16) conf_flags->group_bits;
+
+        const UCHAR old_stat_flags =
+                fort_stat_flags_set(stat, FORT_STAT_LOG_FLOW, conf_flags->log_flow_stat);
+
+        /* Clear the flows' active list */
+        if (!conf_flags->log_flow_stat && (old_stat_flags & FORT_STAT_LOG_FLOW) != 0) {
+            fort_stat_flow_traf_flush(stat, stat->flow_active_count, /*out=*/NULL);
+        }
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+}
+
+/* Count the spent bytes of the budget by the quotas' bytes */
+static void fort_stat_quota_settle(PFORT_STAT_QUOTA quota)
+{
+    const UINT64 spent_bytes = (UINT64) (quota->budget_bytes - quota->left_bytes);
+
+    quota->day_bytes += spent_bytes;
+    quota->month_bytes += spent_bytes;
+
+    quota->budget_bytes = quota->left_bytes;
+}
+
+static INT64 fort_stat_quota_left(
+        INT64 left_bytes, UINT64 limit, UINT64 bytes, UCHAR quota_bit, UCHAR alerted_bits)
+{
+    if (limit == 0 || (alerted_bits & quota_bit) != 0)
+        return left_bytes;
+
+    /* Negative, when the quota is exceeded */
+    const INT64 quota_left = (INT64) limit - (INT64) bytes;
+
+    return (quota_left < left_bytes) ? quota_left : left_bytes;
+}
+
+/* Compute the bytes till the nearest threshold, checked by the flushes only */
+static void fort_stat_quota_budget(PFORT_STAT_QUOTA quota)
+{
+    INT64 left_bytes = MAXINT64;
+
+    left_bytes = fort_stat_quota_left(left_bytes, quota->day_limit, quota->day_bytes,
+            FORT_QUOTA_DAY, quota->alerted_bits);
+    left_bytes = fort_stat_quota_left(left_bytes, quota->month_limit, quota->month_bytes,
+            FORT_QUOTA_MONTH, quota->alerted_bits);
+
+    quota->left_bytes = left_bytes;
+    quota->budget_bytes = left_bytes;
+}
+
+FORT_API void fort_stat_quota_conf_update(PFORT_STAT stat, const PFORT_CONF conf)
+{
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+    {
+        PFORT_STAT_QUOTA quota = &stat->quota;
+
+        fort_stat_quota_settle(quota);
+
+        quota->day_limit = (UINT64) conf->quota_day_mb * (1024 * 1024);
+        quota->month_limit = (UINT64) conf->quota_month_mb * (1024 * 1024);
+        quota->block_inet = conf->quota_block_inet;
+
+        fort_stat_quota_budget(quota);
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+}
+
+FORT_API void fort_stat_quota_set(PFORT_STAT stat, const PFORT_CONF_QUOTA conf_quota)
+{
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+    {
+        PFORT_STAT_QUOTA quota = &stat->quota;
+
+        fort_stat_quota_settle(quota);
+
+        if ((conf_quota->set_bits & FORT_QUOTA_DAY) != 0) {
+            quota->day_bytes = conf_quota->day_bytes;
+        }
+        if ((conf_quota->set_bits & FORT_QUOTA_MONTH) != 0) {
+            quota->month_bytes = conf_quota->month_bytes;
+        }
+
+        quota->alerted_bits = (quota->alerted_bits & ~conf_quota->set_bits)
+                | (conf_quota->alerted_bits & conf_quota->set_bits);
+
+        fort_stat_quota_budget(quota);
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+}
+
+static void fort_flow_group_bit_add(PVOID group_bits_arg, PVOID flow_node)
+{
+    UINT16 *group_bits = group_bits_arg;
+    const PFORT_FLOW flow = flow_node;
+
+    *group_bits |= (UINT16) (1 << flow->opt.group_index);
+}
+
+FORT_API UINT16 fort_stat_flows_group_bits(PFORT_STAT stat)
+{
+    UINT16 group_bits = 0;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+    {
+        fort_hash_foreach_node_arg(&stat->flows_map, &fort_flow_group_bit_add, &group_bits);
+
+        /* The untracked flows may be alive */
+        group_bits |= stat->untracked_group_bits;
     }
     KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return group_bits;
+}
+
+/* The reauth classifies the alive untracked flows again, so they mark their groups anew */
+FORT_API void fort_stat_untracked_group_bits_clear(PFORT_STAT stat)
+{
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+
+    stat->untracked_group_bits = 0;
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
 static NTSTATUS fort_flow_associate_proc(
@@ -500,21 +804,32 @@ static NTSTATUS fort_flow_associate_proc(
 }
 
 FORT_API NTSTATUS fort_flow_associate(PFORT_STAT stat, UINT64 flow_id, UINT32 process_id,
-        UCHAR group_index, BOOL isIPv6, BOOL is_tcp, BOOL inbound, BOOL is_reauth, BOOL *log_stat)
+        UCHAR group_index, BOOL isIPv6, BOOL is_tcp, BOOL inbound, BOOL is_reauth,
+        const PFORT_FLOW_ENDPOINT endpoint, BOOL *log_stat)
 {
     NTSTATUS status;
 
     KLOCK_QUEUE_HANDLE lock_queue;
     KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
 
+    /* The group's packets don't reach the flow callouts without the flow's context */
+    if (fort_stat_group_flow_skip(&stat->conf_group, group_index)) {
+        stat->untracked_group_bits |= (UINT16) (1 << group_index);
+
+        KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+        *log_stat = TRUE; /* the process is not logged */
+        return STATUS_SUCCESS;
+    }
+
     BOOL is_new_proc = FALSE;
     PFORT_STAT_PROC proc = NULL;
     status = fort_flow_associate_proc(stat, process_id, &is_new_proc, &proc);
 
     /* Add flow */
     if (NT_SUCCESS(status)) {
-        status = fort_flow_add(
-                stat, flow_id, group_index, proc->proc_index, isIPv6, is_tcp, inbound, is_reauth);
+        status = fort_flow_add(stat, flow_id, group_index, proc->proc_index, isIPv6, is_tcp,
+                inbound, is_reauth, endpoint);
 
         if (NT_SUCCESS(status)) {
             *log_stat = proc->log_stat;
@@ -529,10 +844,72 @@ FORT_API NTSTATUS fort_flow_associate(PFORT_STAT stat, UINT64 flow_id, UINT32 pr
     return status;
 }
 
+/* Charges the short-lived flow's datagram to the process without the flow's tracking */
+FORT_API BOOL fort_stat_proc_light_add(PFORT_STAT stat, UINT32 process_id, UCHAR group_index,
+        BOOL inbound, UINT32 data_len, BOOL *log_stat)
+{
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+
+    /* The shapers need the flow's context */
+    if (fort_stat_group_speed_limit(&stat->conf_group, group_index) != 0) {
+        KeReleaseInStackQueuedSpinLock(&lock_queue);
+        return FALSE;
+    }
+
+    *log_stat = TRUE; /* the process is not logged */
+
+    stat->untracked_group_bits |= (UINT16) (1 << group_index);
+
+    BOOL is_new_proc = FALSE;
+    PFORT_STAT_PROC proc = NULL;
+
+    if (!fort_stat_group_flow_skip(&stat->conf_group, group_index)
+            && NT_SUCCESS(fort_flow_associate_proc(stat, process_id, &is_new_proc, &proc))) {
+        *log_stat = proc->log_stat;
+        proc->log_stat = TRUE;
+
+        FORT_TRAF traf;
+        traf.in_bytes = inbound ? data_len : 0;
+        traf.out_bytes = inbound ? 0 : data_len;
+
+        /* Without the flow's reference, the process is freed by the next flush */
+        fort_stat_proc_conn_add(stat, proc, /*blocked=*/FALSE);
+        fort_stat_proc_traf_add(stat, proc, traf);
+
+        stat->quota.left_bytes -= (INT64) traf.in_bytes;
+    }
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    return TRUE;
+}
+
+FORT_API void fort_stat_proc_blocked(PFORT_STAT stat, UINT32 process_id)
+{
+    if ((fort_stat_flags(stat) & FORT_STAT_LOG) == 0)
+        return;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+
+    /* Only the processes known by the client are counted */
+    const tommy_key_t pid_hash = fort_stat_proc_hash(process_id);
+    PFORT_STAT_PROC proc = fort_stat_proc_get(stat, process_id, pid_hash);
+
+    if (proc != NULL) {
+        fort_stat_proc_conn_add(stat, proc, /*blocked=*/TRUE);
+    }
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+}
+
 static BOOL fort_flow_delete_closing(PFORT_STAT stat)
 {
     if ((fort_stat_flags(stat) & FORT_STAT_CLOSED) != 0) {
-        InterlockedDecrement(&stat->flow_closing_count);
+        if (InterlockedDecrement(&stat->flow_closing_count) == 0) {
+            KeSetEvent(&stat->flow_closed_event, IO_NO_INCREMENT, FALSE);
+        }
         return TRUE;
     }
     return FALSE;
@@ -556,25 +933,101 @@ FORT_API void fort_flow_delete(PFORT_STAT stat, UINT64 flowContext)
     KeReleaseInStackQueuedSpinLock(&lock_queue);
 }
 
+static void fort_stat_cpu_dirty_add(PFORT_STAT_CPU cpu, UINT16 proc_index)
+{
+    const UINT32 tail = cpu->dirty_tail;
+
+    /* The flush scans all procs of the processor on overflow */
+    if (tail - cpu->dirty_head >= FORT_STAT_CPU_DIRTY_COUNT) {
+        InterlockedExchange(&cpu->dirty_overflow, TRUE);
+        return;
+    }
+
+    cpu->dirty[tail & (FORT_STAT_CPU_DIRTY_COUNT - 1)] = proc_index;
+
+    KeMemoryBarrier();
+
+    cpu->dirty_tail = tail + 1;
+}
+
+static void fort_stat_cpu_traf_add(PFORT_STAT_CPU cpu, UINT16 proc_index, const FORT_TRAF traf)
+{
+    PFORT_STAT_CPU_TRAF cpu_traf = tommy_arrayof_ref(&cpu->trafs, proc_index);
+
+    /* Only the flush exchanges the bytes of other processors */
+    if (traf.in_bytes != 0) {
+        InterlockedAdd64((LONG64 volatile *) &cpu_traf->traf.in_bytes, (LONG64) traf.in_bytes);
+    }
+    if (traf.out_bytes != 0) {
+        InterlockedAdd64((LONG64 volatile *) &cpu_traf->traf.out_bytes, (LONG64) traf.out_bytes);
+    }
+
+    /* The flush clears the flag before taking the bytes */
+    if (InterlockedExchange(&cpu_traf->dirty, TRUE) == FALSE) {
+        fort_stat_cpu_dirty_add(cpu, proc_index);
+    }
+}
+
+static void fort_flow_traf_add(PFORT_STAT stat, PFORT_FLOW flow, UINT32 data_len, BOOL inbound)
+{
+    if ((fort_stat_flags(stat) & FORT_STAT_LOG_FLOW) == 0)
+        return;
+
+    PFORT_FLOW_TRAF traf = &flow->traf;
+
+    if (inbound) {
+        InterlockedAdd64((LONG64 volatile *) &traf->in_bytes, data_len);
+        InterlockedIncrement64((LONG64 volatile *) &traf->in_packets);
+    } else {
+        InterlockedAdd64((LONG64 volatile *) &traf->out_bytes, data_len);
+        InterlockedIncrement64((LONG64 volatile *) &traf->out_packets);
+    }
+
+    /* The flush clears the flag under the stat lock */
+    if ((fort_flow_flags_set(flow, FORT_FLOW_STAT_ACTIVE, TRUE) & FORT_FLOW_STAT_ACTIVE) != 0)
+        return;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLockAtDpcLevel(&stat->lock, &lock_queue);
+
+    fort_flow_active_add(stat, flow);
+
+    KeReleaseInStackQueuedSpinLockFromDpcLevel(&lock_queue);
+}
+
 FORT_API void fort_flow_classify(PFORT_STAT stat, UINT64 flowContext, UINT32 data_len, BOOL inbound)
 {
     PFORT_FLOW flow = (PFORT_FLOW) flowContext;
 
-    KLOCK_QUEUE_HANDLE lock_queue;
-    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+    if (data_len == 0)
+        return;
 
-    PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, flow->opt.proc_index);
+    const UINT16 proc_index = flow->opt.proc_index;
 
-    if (proc->log_stat) {
-        UINT32 *proc_bytes = inbound ? &proc->traf.in_bytes : &proc->traf.out_bytes;
+    FORT_TRAF traf;
+    traf.in_bytes = inbound ? data_len : 0;
+    traf.out_bytes = inbound ? 0 : data_len;
 
-        /* Add traffic to process's bytes */
-        *proc_bytes += data_len;
+    const KIRQL oldIrql = KeRaiseIrqlToDpcLevel();
 
-        fort_stat_proc_active_add(stat, proc);
+    const ULONG cpu_index = KeGetCurrentProcessorIndex();
+
+    fort_flow_traf_add(stat, flow, data_len, inbound);
+
+    if (cpu_index < stat->cpu_count) {
+        fort_stat_cpu_traf_add(&stat->cpus[cpu_index], proc_index, traf);
+    } else {
+        KLOCK_QUEUE_HANDLE lock_queue;
+        KeAcquireInStackQueuedSpinLockAtDpcLevel(&stat->lock, &lock_queue);
+
+        PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, proc_index);
+
+        fort_stat_proc_traf_add(stat, proc, traf);
+
+        KeReleaseInStackQueuedSpinLockFromDpcLevel(&lock_queue);
     }
 
-    KeReleaseInStackQueuedSpinLock(&lock_queue);
+    KeLowerIrql(oldIrql);
 }
 
 FORT_API void fort_stat_dpc_begin(PFORT_STAT stat, PKLOCK_QUEUE_HANDLE lock_queue)
@@ -587,47 +1040,315 @@ FORT_API void fort_stat_dpc_end(PKLOCK_QUEUE_HANDLE lock_queue)
     KeReleaseInStackQueuedSpinLockFromDpcLevel(lock_queue);
 }
 
-static void fort_stat_traf_flush_proc(PFORT_STAT stat, PFORT_STAT_PROC proc, PCHAR *out)
+static void fort_stat_cpu_traf_fold(PFORT_STAT stat, PFORT_STAT_CPU cpu, UINT16 proc_index)
 {
-    PUINT32 out_proc = (PUINT32) *out;
-    PFORT_TRAF out_traf = (PFORT_TRAF) (out_proc + 1);
+    PFORT_STAT_CPU_TRAF cpu_traf = tommy_arrayof_ref(&cpu->trafs, proc_index);
+
+    if (InterlockedExchange(&cpu_traf->dirty, FALSE) == FALSE)
+        return;
+
+    FORT_TRAF traf;
+    traf.in_bytes =
+            (UINT64) InterlockedExchange64((LONG64 volatile *) &cpu_traf->traf.in_bytes, 0);
+    traf.out_bytes =
+            (UINT64) InterlockedExchange64((LONG64 volatile *) &cpu_traf->traf.out_bytes, 0);
+
+    if (traf.in_bytes == 0 && traf.out_bytes == 0)
+        return;
+
+    PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, proc_index);
 
-    *out = (PCHAR) (out_traf + 1);
+    fort_stat_proc_traf_add(stat, proc, traf);
+
+    stat->quota.left_bytes -= (INT64) traf.in_bytes;
+}
+
+static void fort_stat_cpu_fold(PFORT_STAT stat, PFORT_STAT_CPU cpu)
+{
+    const UINT32 tail = cpu->dirty_tail;
+
+    KeMemoryBarrier();
+
+    for (UINT32 head = cpu->dirty_head; head != tail; ++head) {
+        const UINT16 proc_index = cpu->dirty[head & (FORT_STAT_CPU_DIRTY_COUNT - 1)];
+
+        fort_stat_cpu_traf_fold(stat, cpu, proc_index);
+    }
+
+    KeMemoryBarrier();
+
+    cpu->dirty_head = tail;
+
+    /* The procs, which did not fit into the dirty list */
+    if (InterlockedExchange(&cpu->dirty_overflow, FALSE) != FALSE) {
+        const UINT16 proc_count = (UINT16) tommy_arrayof_size(&stat->procs);
+
+        for (UINT16 proc_index = 0; proc_index < proc_count; ++proc_index) {
+            fort_stat_cpu_traf_fold(stat, cpu, proc_index);
+        }
+    }
+}
+
+FORT_API UINT64 fort_stat_insert_time_max(PFORT_STAT stat)
+{
+    INT64 ticks;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+    {
+        ticks = stat->insert_ticks_max;
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    LARGE_INTEGER freq;
+    KeQueryPerformanceCounter(&freq);
+
+    /* In microseconds */
+    return (UINT64) (ticks * 1000000 / freq.QuadPart);
+}
+
+FORT_API void fort_stat_flows_stats(PFORT_STAT stat, UINT64 *flows_count, UINT64 *flow_inserts)
+{
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+    {
+        *flows_count = fort_hash_count(&stat->flows_map);
+        *flow_inserts = stat->flow_inserts;
+    }
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+}
+
+static void fort_flow_info_set(PFORT_STAT stat, PFORT_FLOW flow, PFORT_FLOW_INFO info)
+{
+    const UCHAR flags = flow->opt.flags;
+
+    const PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, flow->opt.proc_index);
+
+    info->flow_id = flow->flow_id;
+    info->in_bytes = flow->traf.in_bytes;
+    info->out_bytes = flow->traf.out_bytes;
+    info->process_id = proc->process_id;
+
+    RtlCopyMemory(info->remote_ip, flow->remote_ip, sizeof(info->remote_ip));
+    info->local_port = flow->local_port;
+    info->remote_port = flow->remote_port;
+
+    info->ip_proto = flow->ip_proto;
+    info->flags = ((flags & FORT_FLOW_TCP) != 0 ? FORT_FLOW_INFO_TCP : 0)
+            | ((flags & FORT_FLOW_IP6) != 0 ? FORT_FLOW_INFO_IP6 : 0)
+            | ((flags & FORT_FLOW_INBOUND) != 0 ? FORT_FLOW_INFO_INBOUND : 0);
+    info->group_index = flow->opt.group_index;
+}
+
+FORT_API UINT32 fort_stat_flows_snapshot(
+        PFORT_STAT stat, UINT32 index, PFORT_FLOW_INFO flows, UINT32 *flows_count)
+{
+    const UINT32 flows_max = min(*flows_count, FORT_FLOWS_PAGE_MAX);
+    UINT32 count = 0;
+
+    KLOCK_QUEUE_HANDLE lock_queue;
+    KeAcquireInStackQueuedSpinLock(&stat->lock, &lock_queue);
+
+    /* The flows are walked by their slots, so the freed & added ones don't move the cursor */
+    const UINT32 size = (UINT32) tommy_arrayof_size(&stat->flows);
+
+    for (; index < size && count < flows_max; ++index) {
+        const PFORT_FLOW flow = tommy_arrayof_ref(&stat->flows, index);
+
+        if ((fort_flow_flags(flow) & FORT_FLOW_ACTIVE) == 0)
+            continue;
+
+        fort_flow_info_set(stat, flow, &flows[count++]);
+    }
+
+    KeReleaseInStackQueuedSpinLock(&lock_queue);
+
+    *flows_count = count;
+
+    return (index < size) ? index : 0;
+}
+
+FORT_API void fort_stat_traf_fold(PFORT_STAT stat)
+{
+    for (ULONG i = 0; i < stat->cpu_count; ++i) {
+        fort_stat_cpu_fold(stat, &stat->cpus[i]);
+    }
+}
+
+static UCHAR fort_stat_quota_exceeded(UINT64 limit, UINT64 bytes, UCHAR quota_bit)
+{
+    return (limit != 0 && bytes > limit) ? quota_bit : 0;
+}
+
+FORT_API UCHAR fort_stat_quota_check(PFORT_STAT stat)
+{
+    PFORT_STAT_QUOTA quota = &stat->quota;
+
+    /* The nearest threshold is not crossed yet */
+    if (quota->left_bytes >= 0)
+        return 0;
+
+    fort_stat_quota_settle(quota);
+
+    const UCHAR exceeded_bits =
+            fort_stat_quota_exceeded(quota->day_limit, quota->day_bytes, FORT_QUOTA_DAY)
+            | fort_stat_quota_exceeded(quota->month_limit, quota->month_bytes, FORT_QUOTA_MONTH);
+
+    const UCHAR new_bits = exceeded_bits & ~quota->alerted_bits;
+
+    quota->alerted_bits |= new_bits;
+
+    fort_stat_quota_budget(quota);
+
+    return new_bits;
+}
+
+static UINT32 fort_stat_traf_compact_bytes(UINT64 *bytes, BOOL *carry)
+{
+    const UINT32 compact_bytes = (*bytes < MAXUINT32) ? (UINT32) *bytes : MAXUINT32;
+
+    /* Keep the remainder for the next record */
+    *bytes -= compact_bytes;
+
+    if (*bytes != 0) {
+        *carry = TRUE;
+    }
+
+    return compact_bytes;
+}
+
+static void fort_stat_traf_flush_conns(PFORT_STAT_PROC proc, PCHAR *out)
+{
+    PUINT32 out_conns = (PUINT32) *out;
+
+    *out_conns = proc->conn_count | ((UINT32) proc->blocked_count << 16);
+
+    proc->conn_count = 0;
+    proc->blocked_count = 0;
+
+    *out = (PCHAR) (out_conns + 1);
+}
+
+static BOOL fort_stat_traf_flush_proc(
+        PFORT_STAT stat, PFORT_STAT_PROC proc, BOOL compact, PCHAR *out)
+{
+    BOOL carry = FALSE;
+
+    PUINT32 out_proc = (PUINT32) *out;
 
     /* Write bytes */
-    *out_traf = proc->traf;
+    if (compact) {
+        PUINT32 out_traf = out_proc + 1;
+
+        out_traf[0] = fort_stat_traf_compact_bytes(&proc->traf.in_bytes, &carry);
+        out_traf[1] = fort_stat_traf_compact_bytes(&proc->traf.out_bytes, &carry);
+
+        *out = (PCHAR) (out_traf + 2);
+    } else {
+        PFORT_TRAF out_traf = (PFORT_TRAF) (out_proc + 1);
+
+        *out_traf = proc->traf;
+
+        *out = (PCHAR) (out_traf + 1);
+    }
+
+    /* Write connections */
+    fort_stat_traf_flush_conns(proc, out);
 
     /* Write process_id */
     *out_proc = proc->process_id
             /* The process is terminated */
-            | (proc->refcount == 0 ? 1 : 0);
+            | (proc->refcount == 0 && !carry ? 1 : 0);
+
+    return carry;
 }
 
 FORT_API void fort_stat_traf_flush(PFORT_STAT stat, UINT16 proc_count, PCHAR out)
 {
+    const BOOL compact = (fort_stat_flags(stat) & FORT_STAT_TRAF_COMPACT) != 0;
+
     PFORT_STAT_PROC proc = stat->proc_active;
+    PFORT_STAT_PROC proc_carry = NULL;
 
     for (; proc != NULL && proc_count != 0; --proc_count) {
         PFORT_STAT_PROC proc_next = proc->next_active;
 
-        if (out != NULL) {
-            fort_stat_traf_flush_proc(stat, proc, &out);
-        }
+        stat->proc_active_count--;
 
-        if (proc->refcount == 0) {
+        if (out != NULL && fort_stat_traf_flush_proc(stat, proc, compact, &out)) {
+            /* The compact counters' remainder */
+            proc->next_active = proc_carry;
+            proc_carry = proc;
+        } else if (proc->refcount == 0) {
             /* The process is terminated */
             fort_stat_proc_free(stat, proc);
         } else {
             proc->active = FALSE;
 
             /* Clear process's bytes */
-            proc->traf.v = 0;
+            proc->traf.in_bytes = 0;
+            proc->traf.out_bytes = 0;
+
+            proc->conn_count = 0;
+            proc->blocked_count = 0;
         }
 
         proc = proc_next;
-
-        stat->proc_active_count--;
     }
 
     stat->proc_active = proc;
+
+    /* Flush the remainders by the next records */
+    while (proc_carry != NULL) {
+        PFORT_STAT_PROC proc_next = proc_carry->next_active;
+
+        proc_carry->next_active = stat->proc_active;
+        stat->proc_active = proc_carry;
+
+        stat->proc_active_count++;
+
+        proc_carry = proc_next;
+    }
+}
+
+static void fort_stat_flow_traf_flush_flow(PFORT_STAT stat, PFORT_FLOW flow, PCHAR *out)
+{
+    FORT_FLOW_TRAF traf;
+    traf.in_bytes = (UINT64) InterlockedExchange64((LONG64 volatile *) &flow->traf.in_bytes, 0);
+    traf.out_bytes = (UINT64) InterlockedExchange64((LONG64 volatile *) &flow->traf.out_bytes, 0);
+    traf.in_packets = (UINT64) InterlockedExchange64((LONG64 volatile *) &flow->traf.in_packets, 0);
+    traf.out_packets =
+            (UINT64) InterlockedExchange64((LONG64 volatile *) &flow->traf.out_packets, 0);
+
+    if (*out == NULL)
+        return;
+
+    const PFORT_STAT_PROC proc = tommy_arrayof_ref(&stat->procs, flow->opt.proc_index);
+
+    const UCHAR flow_flags = fort_flow_flags(flow);
+    const BOOL isIPv6 = (flow_flags & FORT_FLOW_IP6) != 0;
+    const BOOL inbound = (flow_flags & FORT_FLOW_INBOUND) != 0;
+
+    fort_log_flow_stat_write(*out, isIPv6, inbound, flow->ip_proto, flow->local_port,
+            flow->remote_port, flow->remote_ip, proc->process_id, &traf);
+
+    *out += FORT_LOG_FLOW_STAT_ENTRY_SIZE;
+}
+
+FORT_API void fort_stat_flow_traf_flush(PFORT_STAT stat, UINT32 flow_count, PCHAR out)
+{
+    PFORT_FLOW flow = stat->flow_active;
+
+    for (; flow != NULL && flow_count != 0; --flow_count) {
+        PFORT_FLOW flow_next = flow->next_active;
+
+        /* Clear the flag before taking the bytes, the next bytes add the flow again */
+        fort_flow_flags_set(flow, FORT_FLOW_STAT_ACTIVE, FALSE);
+
+        fort_stat_flow_traf_flush_flow(stat, flow, &out);
+
+        fort_flow_active_remove(stat, flow);
+
+        flow = flow_next;
+    }
 }
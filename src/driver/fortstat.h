@@ -4,32 +4,25 @@
 #include "fortdrv.h"
 
 #include "common/fortconf.h"
+#include "forthash.h"
 #include "forttds.h"
 
 #define FORT_STATUS_FLOW_BLOCK STATUS_NOT_SAME_DEVICE
 
-/* Synchronize with tommy_hashdyn_node! */
+/* Synchronize with tommy_node! */
 typedef struct fort_stat_proc
 {
     struct fort_stat_proc *next;
     struct fort_stat_proc *prev;
 
     union {
-#if defined(_WIN64)
-        FORT_TRAF traf;
-#else
         UINT32 process_id;
-#endif
-        void *data; /* tommy_hashdyn_node::data */
+        void *data; /* tommy_node::data */
     };
 
-    tommy_key_t proc_hash; /* tommy_hashdyn_node::index */
+    tommy_key_t proc_hash; /* tommy_node::index */
 
-#if defined(_WIN64)
-    UINT32 process_id;
-#else
     FORT_TRAF traf;
-#endif
 
     UINT16 proc_index;
 
@@ -38,6 +31,9 @@ typedef struct fort_stat_proc
 
     UINT32 refcount;
 
+    UINT16 conn_count; /* new connections since the last flush */
+    UINT16 blocked_count; /* blocked connections since the last flush */
+
     struct fort_stat_proc *next_active;
 } FORT_STAT_PROC, *PFORT_STAT_PROC;
 
@@ -45,10 +41,11 @@ typedef struct fort_stat_proc
 #define FORT_FLOW_SPEED_LIMIT_OUT   0x02
 #define FORT_FLOW_SPEED_LIMIT_PROC  0x04
 #define FORT_FLOW_SPEED_LIMIT_FLAGS 0x07
+#define FORT_FLOW_STAT_ACTIVE       0x08
 #define FORT_FLOW_TCP               0x10
 #define FORT_FLOW_IP6               0x20
 #define FORT_FLOW_INBOUND           0x40
-#define FORT_FLOW_ACTIVE            0x80
+#define FORT_FLOW_ACTIVE            0x80 /* not in the free chain */
 
 typedef struct fort_flow_opt
 {
@@ -64,7 +61,7 @@ typedef struct fort_flow_opt
     };
 } FORT_FLOW_OPT, *PFORT_FLOW_OPT;
 
-/* Synchronize with tommy_hashdyn_node! */
+/* Synchronize with tommy_node! */
 typedef struct fort_flow
 {
     struct fort_flow *next;
@@ -76,21 +73,81 @@ typedef struct fort_flow
 #else
         FORT_FLOW_OPT opt;
 #endif
-        void *data; /* tommy_hashdyn_node::data */
+        void *data; /* tommy_node::data */
     };
 
-    tommy_key_t flow_hash; /* tommy_hashdyn_node::index */
+    tommy_key_t flow_hash; /* tommy_node::index */
 
 #if defined(_WIN64)
     FORT_FLOW_OPT opt;
 #else
     UINT64 flow_id;
 #endif
+
+    /* Flow statistics */
+    struct fort_flow *next_active;
+    struct fort_flow *prev_active;
+
+    FORT_FLOW_TRAF traf; /* added without the stat lock */
+
+    UINT32 remote_ip[4];
+    UINT16 local_port;
+    UINT16 remote_port;
+    UCHAR ip_proto;
 } FORT_FLOW, *PFORT_FLOW;
 
+typedef struct fort_flow_endpoint
+{
+    const UINT32 *remote_ip;
+    UINT16 local_port;
+    UINT16 remote_port;
+    UCHAR ip_proto;
+} FORT_FLOW_ENDPOINT, *PFORT_FLOW_ENDPOINT;
+
+#define FORT_STAT_CPU_DIRTY_COUNT 256 /* must be power of 2 */
+
+typedef struct fort_stat_cpu_traf
+{
+    FORT_TRAF traf;
+
+    LONG volatile dirty; /* set by the owner processor after adding the bytes */
+} FORT_STAT_CPU_TRAF, *PFORT_STAT_CPU_TRAF;
+
+/* Traffic of processes, added by the owner processor at DISPATCH_LEVEL without the stat lock */
+typedef struct fort_stat_cpu
+{
+    UINT32 volatile dirty_head; /* moved by the traffic flush */
+    UINT32 volatile dirty_tail; /* moved by the owner processor */
+    LONG volatile dirty_overflow;
+
+    tommy_arrayof trafs; /* FORT_STAT_CPU_TRAF by proc_index */
+
+    UINT16 dirty[FORT_STAT_CPU_DIRTY_COUNT]; /* proc_index of the procs with traffic */
+} FORT_STAT_CPU, *PFORT_STAT_CPU;
+
+/* Inbound traffic of the day & month, counted by the traffic fold */
+typedef struct fort_stat_quota
+{
+    UINT64 day_limit; /* bytes, 0 for no quota */
+    UINT64 month_limit;
+
+    UINT64 day_bytes;
+    UINT64 month_bytes;
+
+    /* Bytes till the nearest of the not alerted quotas, subtracted by the traffic fold */
+    INT64 left_bytes;
+    INT64 budget_bytes; /* of the left bytes, to count the spent ones by the quotas' bytes */
+
+    UCHAR alerted_bits; /* FORT_QUOTA_* of the exceeded quotas, reported once per period */
+    UCHAR block_inet : 1;
+} FORT_STAT_QUOTA, *PFORT_STAT_QUOTA;
+
 #define FORT_STAT_LOG                 0x01
 #define FORT_STAT_SYSTEM_TIME_CHANGED 0x02
+#define FORT_STAT_LOG_FLOW            0x04
+#define FORT_STAT_TRAF_COMPACT        0x08 /* 32-bit traffic counters in the log */
 #define FORT_STAT_CLOSED              0x10 /* used on driver unloading */
+#define FORT_STAT_LIVE                0x20 /* the client shows live traffic */
 
 #define FORT_STAT_ALE_CALLOUT_IDS_COUNT    4
 #define FORT_STAT_PACKET_CALLOUT_IDS_COUNT 8
@@ -122,22 +179,37 @@ typedef struct fort_stat
     UINT16 proc_active_count;
 
     LONG volatile flow_closing_count;
+    KEVENT flow_closed_event; /* signalled by the last closing flow's deletion */
 
     UINT32 callout_ids[FORT_STAT_CALLOUT_IDS_COUNT];
 
+    ULONG cpu_count;
+    PFORT_STAT_CPU cpus;
+
     PFORT_STAT_PROC proc_free;
     PFORT_STAT_PROC proc_active;
 
     PFORT_FLOW flow_free;
+    PFORT_FLOW flow_active;
+
+    UINT32 flow_active_count;
+
+    UINT16 untracked_group_bits; /* groups of the skipped and light flows since the last reauth */
 
     tommy_arrayof procs;
-    tommy_hashdyn procs_map;
+    FORT_HASH procs_map;
 
     tommy_arrayof flows;
-    tommy_hashdyn flows_map;
+    FORT_HASH flows_map;
+
+    UINT64 flow_inserts;
+
+    INT64 insert_ticks_max; /* worst-case time of the maps' inserts */
 
     FORT_CONF_GROUP conf_group;
 
+    FORT_STAT_QUOTA quota;
+
     LARGE_INTEGER system_time;
 
     KSPIN_LOCK lock;
@@ -163,15 +235,29 @@ FORT_API void fort_stat_close(PFORT_STAT stat);
 
 FORT_API void fort_stat_log_update(PFORT_STAT stat, BOOL log_stat);
 
-FORT_API void fort_stat_conf_update(PFORT_STAT stat, const PFORT_CONF_IO conf_io);
+FORT_API void fort_stat_conf_update(PFORT_STAT stat, const PFORT_CONF_GROUP conf_group);
 
 FORT_API void fort_stat_conf_flags_update(PFORT_STAT stat, const PFORT_CONF_FLAGS conf_flags);
 
+FORT_API void fort_stat_quota_conf_update(PFORT_STAT stat, const PFORT_CONF conf);
+
+FORT_API void fort_stat_quota_set(PFORT_STAT stat, const PFORT_CONF_QUOTA conf_quota);
+
+FORT_API UINT16 fort_stat_flows_group_bits(PFORT_STAT stat);
+
+FORT_API void fort_stat_untracked_group_bits_clear(PFORT_STAT stat);
+
 FORT_API NTSTATUS fort_flow_associate(PFORT_STAT stat, UINT64 flow_id, UINT32 process_id,
-        UCHAR group_index, BOOL isIPv6, BOOL is_tcp, BOOL inbound, BOOL is_reauth, BOOL *log_stat);
+        UCHAR group_index, BOOL isIPv6, BOOL is_tcp, BOOL inbound, BOOL is_reauth,
+        const PFORT_FLOW_ENDPOINT endpoint, BOOL *log_stat);
+
+FORT_API BOOL fort_stat_proc_light_add(PFORT_STAT stat, UINT32 process_id, UCHAR group_index,
+        BOOL inbound, UINT32 data_len, BOOL *log_stat);
 
 FORT_API void fort_flow_delete(PFORT_STAT stat, UINT64 flowContext);
 
+FORT_API void fort_stat_proc_blocked(PFORT_STAT stat, UINT32 process_id);
+
 FORT_API void fort_flow_classify(
         PFORT_STAT stat, UINT64 flowContext, UINT32 data_len, BOOL inbound);
 
@@ -179,8 +265,21 @@ FORT_API void fort_stat_dpc_begin(PFORT_STAT stat, PKLOCK_QUEUE_HANDLE lock_queu
 
 FORT_API void fort_stat_dpc_end(PKLOCK_QUEUE_HANDLE lock_queue);
 
+FORT_API UINT64 fort_stat_insert_time_max(PFORT_STAT stat);
+
+FORT_API void fort_stat_flows_stats(PFORT_STAT stat, UINT64 *flows_count, UINT64 *flow_inserts);
+
+FORT_API UINT32 fort_stat_flows_snapshot(
+        PFORT_STAT stat, UINT32 index, PFORT_FLOW_INFO flows, UINT32 *flows_count);
+
+FORT_API void fort_stat_traf_fold(PFORT_STAT stat);
+
+FORT_API UCHAR fort_stat_quota_check(PFORT_STAT stat);
+
 FORT_API void fort_stat_traf_flush(PFORT_STAT stat, UINT16 proc_count, PCHAR out);
 
+FORT_API void fort_stat_flow_traf_flush(PFORT_STAT stat, UINT32 flow_count, PCHAR out);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -2,16 +2,16 @@
 
 #include "forttds.h"
 
-#define FORT_TOMMY_POOL_TAG 'TwfF'
+#include "fortmem.h"
 
 FORT_API PVOID fort_tommy_malloc(SIZE_T size)
 {
-    return fort_mem_alloc(size, FORT_TOMMY_POOL_TAG);
+    return fort_mem_type_alloc(FORT_MEM_TOMMY, size);
 }
 
 FORT_API void fort_tommy_free(PVOID p)
 {
-    fort_mem_free(p, FORT_TOMMY_POOL_TAG);
+    fort_mem_type_free(FORT_MEM_TOMMY, p);
 }
 
 FORT_API PVOID fort_tommy_calloc(SIZE_T count, SIZE_T element_size)
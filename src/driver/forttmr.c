@@ -38,6 +38,18 @@ static void NTAPI fort_timer_callback(PKDPC dpc, PFORT_TIMER timer, PVOID arg1,
     }
 }
 
+static void fort_timer_start(PFORT_TIMER timer, UCHAR flags)
+{
+    const ULONG period = timer->period;
+    const ULONG interval = (flags & FORT_TIMER_ONESHOT) != 0 ? 0 : period;
+    const ULONG delay = (flags & FORT_TIMER_COALESCABLE) != 0 ? 500 : 0;
+
+    LARGE_INTEGER due;
+    due.QuadPart = (INT64) period * -10000LL /* ms -> us */;
+
+    KeSetCoalescableTimer(&timer->id, due, interval, delay, &timer->dpc);
+}
+
 FORT_API void fort_timer_open(
         PFORT_TIMER timer, ULONG period, UCHAR flags, FORT_TIMER_FUNC callback)
 {
@@ -76,15 +88,50 @@ void fort_timer_set_running(PFORT_TIMER timer, BOOL run)
         return;
 
     if (run) {
-        const ULONG period = timer->period;
-        const ULONG interval = (flags & FORT_TIMER_ONESHOT) != 0 ? 0 : period;
-        const ULONG delay = (flags & FORT_TIMER_COALESCABLE) != 0 ? 500 : 0;
+        fort_timer_start(timer, flags);
+    } else {
+        KeCancelTimer(&timer->id);
+    }
+}
 
-        LARGE_INTEGER due;
-        due.QuadPart = (INT64) period * -10000LL /* ms -> us */;
+FORT_API void fort_timer_restart(PFORT_TIMER timer, ULONG period)
+{
+    fort_timer_set_running(timer, FALSE);
 
-        KeSetCoalescableTimer(&timer->id, due, interval, delay, &timer->dpc);
-    } else {
+    if (period == 0)
+        return;
+
+    timer->period = period;
+
+    fort_timer_set_running(timer, TRUE);
+}
+
+FORT_API void fort_timer_set_period(PFORT_TIMER timer, ULONG period)
+{
+    if (timer->period == period)
+        return;
+
+    timer->period = period;
+
+    const UCHAR flags = fort_timer_flags(timer);
+    if ((flags & FORT_TIMER_RUNNING) == 0)
+        return;
+
+    fort_timer_start(timer, flags);
+
+    /* The timer may be stopped meanwhile */
+    if (!fort_timer_is_running(timer)) {
         KeCancelTimer(&timer->id);
     }
 }
+
+/* Run the one-shot timer after the due time, in 100-nanosecond units */
+FORT_API void fort_timer_set_due(PFORT_TIMER timer, INT64 due_time)
+{
+    fort_timer_flags_set(timer, FORT_TIMER_RUNNING, TRUE);
+
+    LARGE_INTEGER due;
+    due.QuadPart = (due_time > 0) ? -due_time : -1LL;
+
+    KeSetTimer(&timer->id, due, &timer->dpc);
+}
@@ -34,6 +34,12 @@ FORT_API BOOL fort_timer_is_running(PFORT_TIMER timer);
 
 FORT_API void fort_timer_set_running(PFORT_TIMER timer, BOOL run);
 
+FORT_API void fort_timer_restart(PFORT_TIMER timer, ULONG period);
+
+FORT_API void fort_timer_set_period(PFORT_TIMER timer, ULONG period);
+
+FORT_API void fort_timer_set_due(PFORT_TIMER timer, INT64 due_time);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -8,23 +8,16 @@
 #include "fortdbg.h"
 #include "fortutl.h"
 
-static void fort_worker_callback_run(
-        PFORT_WORKER worker, enum FORT_WORKER_TYPE worker_type, UCHAR id_bits)
-{
-    if ((id_bits & (1 << worker_type)) != 0) {
-        worker->funcs[worker_type]();
-    }
-}
-
 static NTSTATUS fort_worker_callback_expand(PVOID context)
 {
-    PFORT_WORKER worker = context;
+    PFORT_WORKER_ITEM worker_item = context;
 
-    InterlockedDecrement16(&worker->queue_size);
+    /* The work, queued from now, runs again */
+    InterlockedExchange(&worker_item->queued, 0);
 
-    const UCHAR id_bits = InterlockedAnd8(&worker->id_bits, 0);
+    worker_item->func();
 
-    fort_worker_callback_run(worker, FORT_WORKER_REAUTH, id_bits);
+    InterlockedDecrement16(&worker_item->worker->queue_size);
 
     return STATUS_SUCCESS;
 }
@@ -41,8 +34,6 @@ static void NTAPI fort_worker_callback(PDEVICE_OBJECT device, PVOID context)
 
 static void fort_worker_wait(PFORT_WORKER worker)
 {
-    InterlockedAnd8(&worker->id_bits, 0);
-
     for (;;) {
         const SHORT queue_size = InterlockedOr16(&worker->queue_size, 0);
 
@@ -60,41 +51,65 @@ FORT_API void fort_worker_func_set(PFORT_WORKER worker, UCHAR work_id, FORT_WORK
 {
     assert(work_id >= 0 && work_id < FORT_WORKER_FUNC_COUNT);
 
-    worker->funcs[work_id] = worker_func;
+    worker->items[work_id].func = worker_func;
 }
 
 FORT_API void fort_worker_queue(PFORT_WORKER worker, UCHAR work_id)
 {
-    const UCHAR id_bits = InterlockedOr8(&worker->id_bits, (1 << work_id));
+    PFORT_WORKER_ITEM worker_item = &worker->items[work_id];
+
+    if (worker_item->item == NULL)
+        return; /* not registered yet or already */
+
+    if (InterlockedExchange(&worker_item->queued, 1) != 0)
+        return; /* already queued */
+
+    InterlockedIncrement16(&worker->queue_size);
+
+    IoQueueWorkItem(worker_item->item, worker->callback, DelayedWorkQueue, worker_item);
+}
 
-    if (id_bits == 0) {
-        InterlockedIncrement16(&worker->queue_size);
+static void fort_worker_items_free(PFORT_WORKER worker)
+{
+    for (int i = 0; i < FORT_WORKER_FUNC_COUNT; ++i) {
+        PFORT_WORKER_ITEM worker_item = &worker->items[i];
 
-        IoQueueWorkItem(worker->item,
-                FORT_CALLBACK(
-                        FORT_CALLBACK_WORKER_CALLBACK, PIO_WORKITEM_ROUTINE, &fort_worker_callback),
-                DelayedWorkQueue, worker);
+        if (worker_item->item != NULL) {
+            IoFreeWorkItem(worker_item->item);
+            worker_item->item = NULL;
+        }
     }
 }
 
 FORT_API NTSTATUS fort_worker_register(PDEVICE_OBJECT device, PFORT_WORKER worker)
 {
-    PIO_WORKITEM item = IoAllocateWorkItem(device);
-    if (item == NULL) {
-        return STATUS_INSUFFICIENT_RESOURCES;
-    }
+    worker->callback = FORT_CALLBACK(
+            FORT_CALLBACK_WORKER_CALLBACK, PIO_WORKITEM_ROUTINE, &fort_worker_callback);
 
-    worker->item = item;
+    for (int i = 0; i < FORT_WORKER_FUNC_COUNT; ++i) {
+        PFORT_WORKER_ITEM worker_item = &worker->items[i];
+
+        PIO_WORKITEM item = IoAllocateWorkItem(device);
+        if (item == NULL) {
+            fort_worker_items_free(worker);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        worker_item->worker = worker;
+        worker_item->item = item;
+    }
 
     return STATUS_SUCCESS;
 }
 
 FORT_API void fort_worker_unregister(PFORT_WORKER worker)
 {
-    if (worker->item != NULL) {
-        fort_worker_wait(worker);
-
-        IoFreeWorkItem(worker->item);
-        worker->item = NULL;
+    /* Don't queue the works anymore */
+    for (int i = 0; i < FORT_WORKER_FUNC_COUNT; ++i) {
+        InterlockedExchange(&worker->items[i].queued, 1);
     }
+
+    fort_worker_wait(worker);
+
+    fort_worker_items_free(worker);
 }
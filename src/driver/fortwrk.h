@@ -5,19 +5,34 @@
 
 enum FORT_WORKER_TYPE {
     FORT_WORKER_REAUTH = 0,
+    FORT_WORKER_PSTREE,
+    FORT_WORKER_TRIM,
+    FORT_WORKER_QUOTA,
+    FORT_WORKER_MEM,
     FORT_WORKER_FUNC_COUNT,
 };
 
 typedef void (*FORT_WORKER_FUNC)(void);
 
+/* Work item of a work type, run by a system worker thread independently of the other types */
+typedef struct fort_worker_item
+{
+    LONG volatile queued; /* coalesces the work's queue requests till it runs */
+
+    PIO_WORKITEM item;
+
+    struct fort_worker *worker;
+
+    FORT_WORKER_FUNC func;
+} FORT_WORKER_ITEM, *PFORT_WORKER_ITEM;
+
 typedef struct fort_worker
 {
-    UCHAR volatile id_bits;
     SHORT volatile queue_size;
 
-    PIO_WORKITEM item;
+    PIO_WORKITEM_ROUTINE callback; /* resolved once, direct for the natively loaded driver */
 
-    FORT_WORKER_FUNC funcs[FORT_WORKER_FUNC_COUNT];
+    FORT_WORKER_ITEM items[FORT_WORKER_FUNC_COUNT];
 } FORT_WORKER, *PFORT_WORKER;
 
 #if defined(__cplusplus)
@@ -2,6 +2,7 @@
 
 @set BASENAME=fortfw
 @set DSTPATH=%SystemRoot%\System32\drivers\%BASENAME%.sys
+@set CONFPATH=%SystemRoot%\System32\drivers\%BASENAME%.conf
 
 @set DRIVERSVC=%BASENAME%
 @set FORTSVC=FortFirewallSvc
@@ -27,6 +28,9 @@ sc delete %DRIVERSVC%
 @rem Remove driver from system storage
 Del "%DSTPATH%"
 
+@rem Remove the cached conf
+@if exist "%CONFPATH%" Del "%CONFPATH%"
+
 
 @set RCODE=0
 @goto EXIT
@@ -6,12 +6,15 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "../fortcb.h"
 #include "../fortutl.h"
 #include "../proxycb/fortpcb_drv.h"
 #include "../proxycb/fortpcb_src.h"
 
+#include "replay.h"
+
 #define TEST_CALLBACK_ID 33
 
 typedef int (*TestCallbackFunc)(PVOID p, int i);
@@ -41,6 +44,58 @@ static void test_proxycb(void)
     assert(res == TEST_CALLBACK_ID);
 }
 
+#define TEST_BENCH_CALLS 10000000
+
+static int test_bench_callback(PVOID p, int i)
+{
+    UNUSED(p);
+    return i + 1;
+}
+
+static double test_bench_calls(TestCallbackFunc cb)
+{
+    LARGE_INTEGER freq;
+    const LARGE_INTEGER start = KeQueryPerformanceCounter(&freq);
+
+    int res = 0;
+    for (int i = 0; i < TEST_BENCH_CALLS; ++i) {
+        res = cb(NULL, res);
+    }
+
+    const LARGE_INTEGER end = KeQueryPerformanceCounter(NULL);
+
+    assert(res == TEST_BENCH_CALLS);
+
+    return (double) (end.QuadPart - start.QuadPart) * 1e9 / freq.QuadPart / TEST_BENCH_CALLS;
+}
+
+/* Compare the callback's direct call of the natively loaded driver with its proxy's one */
+static int test_bench_proxycb(void)
+{
+    TestCallbackFunc direct_cb =
+            FORT_CALLBACK(TEST_CALLBACK_ID, TestCallbackFunc, test_bench_callback);
+
+    FORT_PROXYCB_INFO cbInfo;
+
+    fort_proxycb_src_prepare(&cbInfo);
+    fort_callback_setup(&cbInfo);
+    fort_proxycb_src_setup(&cbInfo);
+
+    TestCallbackFunc proxy_cb =
+            FORT_CALLBACK(TEST_CALLBACK_ID, TestCallbackFunc, test_bench_callback);
+
+    assert(direct_cb == test_bench_callback);
+    assert(proxy_cb != test_bench_callback);
+
+    const double direct_ns = test_bench_calls(direct_cb);
+    const double proxy_ns = test_bench_calls(proxy_cb);
+
+    printf("test_bench_proxycb: calls=%d direct=%.2fns proxy=%.2fns\n", TEST_BENCH_CALLS,
+            direct_ns, proxy_ns);
+
+    return 0;
+}
+
 static NTSTATUS test_major0(PDEVICE_OBJECT device, PIRP irp)
 {
     printf("Major: %p %p\n", device, irp);
@@ -98,8 +153,11 @@ static void test_utl_bits(void)
 
 int main(int argc, char *argv[])
 {
-    (void) argc;
-    (void) argv;
+    if (argc > 1 && strcmp(argv[1], "replay") == 0)
+        return test_replay_main(argc - 2, argv + 2);
+
+    if (argc > 1 && strcmp(argv[1], "bench") == 0)
+        return test_bench_proxycb();
 
     test_proxycb();
     test_major();
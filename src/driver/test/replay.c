@@ -0,0 +1,558 @@
+/* Fort Firewall Driver: Test: Replay of connections through the callouts */
+
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../common/fortioctl.h"
+#include "../fortcout.h"
+#include "../fortdev.h"
+
+#define TEST_REPLAY_PATH_MAX    260
+#define TEST_REPLAY_PACKETS_MAX 256
+#define TEST_REPLAY_VALUES_MAX  64 /* more than the fields count of any used layer */
+
+#define TEST_REPLAY_LOCAL_IP 0x0A000001 /* 10.0.0.1 */
+
+typedef struct test_replay_conn
+{
+    UINT32 process_id;
+    UINT32 remote_ip;
+
+    UINT16 local_port;
+    UINT16 remote_port;
+
+    UCHAR ip_proto;
+    UCHAR inbound;
+
+    UINT16 packets_n;
+    UINT16 packet_size;
+
+    UINT16 path_size; /* without terminating zero */
+    WCHAR path[TEST_REPLAY_PATH_MAX];
+} TEST_REPLAY_CONN, *PTEST_REPLAY_CONN;
+
+typedef struct test_replay
+{
+    int threads_n;
+    int rounds_n;
+
+    int conns_n;
+    PTEST_REPLAY_CONN conns;
+
+    volatile LONG *verdicts; /* of the connections, 0 if not classified yet */
+
+    volatile LONG verdict_mismatches;
+    volatile LONG verdict_counts[3]; /* permit, block, other */
+
+    volatile LONG64 packets_n;
+} TEST_REPLAY, *PTEST_REPLAY;
+
+typedef struct test_replay_thread
+{
+    PTEST_REPLAY replay;
+
+    UINT32 thread_index;
+    UINT32 flow_seq;
+
+    NET_BUFFER_LIST nbls[TEST_REPLAY_PACKETS_MAX];
+    NET_BUFFER nbs[TEST_REPLAY_PACKETS_MAX];
+} TEST_REPLAY_THREAD, *PTEST_REPLAY_THREAD;
+
+static FORT_DEVICE g_replayDevice;
+
+static void test_replay_conn_path_set(PTEST_REPLAY_CONN conn, const char *path)
+{
+    int i = 0;
+    for (; path[i] != '\0' && i < TEST_REPLAY_PATH_MAX - 1; ++i) {
+        conn->path[i] = (WCHAR) (UCHAR) path[i];
+    }
+    conn->path[i] = L'\0';
+
+    conn->path_size = (UINT16) (i * sizeof(WCHAR));
+}
+
+static void test_replay_conns_generate(PTEST_REPLAY replay, int conns_n)
+{
+    srand(conns_n);
+
+    for (int i = 0; i < conns_n; ++i) {
+        PTEST_REPLAY_CONN conn = &replay->conns[i];
+
+        const UINT32 app_index = (UINT32) (rand() % 64);
+
+        char path[TEST_REPLAY_PATH_MAX];
+        snprintf(path, sizeof(path), "\\device\\harddiskvolume1\\replay\\app%u.exe", app_index);
+        test_replay_conn_path_set(conn, path);
+
+        conn->process_id = 1000 + app_index * 4;
+        conn->remote_ip = 0x5D000000 | ((UINT32) rand() << 8) | (UINT32) (rand() & 0xFF);
+        conn->local_port = (UINT16) (49152 + rand() % 16384);
+        conn->remote_port = (rand() % 4 == 0) ? 53 : 443;
+        conn->ip_proto = (conn->remote_port == 53) ? IPPROTO_UDP : IPPROTO_TCP;
+        conn->inbound = (rand() % 8 == 0);
+        conn->packets_n = (UINT16) (1 + rand() % 32);
+        conn->packet_size = (UINT16) (64 + rand() % 1400);
+    }
+
+    replay->conns_n = conns_n;
+}
+
+/* CSV lines: pid,path,proto,remote_ip,remote_port,local_port,inbound,packets,packet_size */
+static BOOL test_replay_conns_load(PTEST_REPLAY replay, const char *file_path, int conns_max)
+{
+    FILE *f = fopen(file_path, "r");
+    if (f == NULL)
+        return FALSE;
+
+    char line[TEST_REPLAY_PATH_MAX + 128];
+    int n = 0;
+
+    while (n < conns_max && fgets(line, sizeof(line), f) != NULL) {
+        PTEST_REPLAY_CONN conn = &replay->conns[n];
+
+        char path[TEST_REPLAY_PATH_MAX];
+        unsigned pid, proto, ip1, ip2, ip3, ip4, remote_port, local_port, inbound, packets, size;
+
+        if (sscanf(line, "%u,%259[^,],%u,%u.%u.%u.%u,%u,%u,%u,%u,%u", &pid, path, &proto, &ip1,
+                    &ip2, &ip3, &ip4, &remote_port, &local_port, &inbound, &packets, &size)
+                != 12)
+            continue;
+
+        test_replay_conn_path_set(conn, path);
+
+        conn->process_id = pid;
+        conn->remote_ip = (ip1 << 24) | (ip2 << 16) | (ip3 << 8) | ip4;
+        conn->remote_port = (UINT16) remote_port;
+        conn->local_port = (UINT16) local_port;
+        conn->ip_proto = (UCHAR) proto;
+        conn->inbound = (inbound != 0);
+        conn->packets_n = (UINT16) min(packets, TEST_REPLAY_PACKETS_MAX);
+        conn->packet_size = (UINT16) size;
+
+        ++n;
+    }
+
+    fclose(f);
+
+    replay->conns_n = n;
+
+    return n != 0;
+}
+
+static BOOL test_replay_conf_load(const char *file_path)
+{
+    FILE *f = fopen(file_path, "rb");
+    if (f == NULL)
+        return FALSE;
+
+    fseek(f, 0, SEEK_END);
+    const long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    PFORT_CONF_IO conf_io = (len > (long) sizeof(FORT_CONF_IO)) ? malloc(len) : NULL;
+
+    const BOOL ok = (conf_io != NULL && fread(conf_io, 1, len, f) == (size_t) len);
+
+    fclose(f);
+
+    PFORT_CONF_REF conf_ref =
+            ok ? fort_conf_ref_new(&conf_io->conf, (ULONG) len - FORT_CONF_IO_CONF_OFF) : NULL;
+
+    if (conf_ref != NULL) {
+        /* As by the FORT_IOCTL_SETCONF */
+        const FORT_CONF_GROUP conf_group = conf_io->conf_group;
+        const FORT_CONF_FLAGS conf_flags = conf_ref->conf.flags;
+
+        fort_mem_conf_update(&conf_ref->conf);
+        fort_pending_conf_update(&fort_device()->pending, &conf_ref->conf);
+        fort_buffer_conf_update(&fort_device()->buffer, &conf_ref->conf);
+
+        fort_conf_ref_set(&fort_device()->conf, conf_ref);
+
+        fort_stat_conf_update(&fort_device()->stat, &conf_group);
+        fort_stat_conf_flags_update(&fort_device()->stat, &conf_flags);
+        fort_shaper_conf_update(&fort_device()->shaper, &conf_group, &conf_flags);
+    }
+
+    free(conf_io);
+
+    return conf_ref != NULL;
+}
+
+static NTSTATUS test_replay_device_open(void)
+{
+    RtlZeroMemory(&g_replayDevice, sizeof(FORT_DEVICE));
+
+    fort_device_set(&g_replayDevice);
+
+    /* As by the fort_device_load() without the provider, timers and notifiers */
+    fort_device_conf_open(&fort_device()->conf);
+    fort_perf_open(&fort_device()->perf);
+    fort_cache_open(&fort_device()->cache);
+    fort_buffer_open(&fort_device()->buffer);
+    fort_stat_open(&fort_device()->stat);
+    fort_pending_open(&fort_device()->pending);
+    fort_shaper_open(&fort_device()->shaper);
+    fort_pstree_open(&fort_device()->ps_tree);
+
+    return fort_callout_install(/*device=*/NULL);
+}
+
+static void test_replay_device_close(void)
+{
+    fort_pstree_close(&fort_device()->ps_tree);
+    fort_shaper_close(&fort_device()->shaper);
+    fort_pending_close(&fort_device()->pending);
+    fort_stat_close(&fort_device()->stat);
+    fort_buffer_close(&fort_device()->buffer);
+    fort_callout_remove();
+    fort_cache_close(&fort_device()->cache);
+    fort_perf_close(&fort_device()->perf);
+
+    fort_device_set(NULL);
+}
+
+static void test_replay_values_init(FWPS_INCOMING_VALUES0 *inFixedValues,
+        FWPS_INCOMING_VALUE0 *values, UINT16 layerId, UINT32 valueCount)
+{
+    RtlZeroMemory(values, TEST_REPLAY_VALUES_MAX * sizeof(FWPS_INCOMING_VALUE0));
+
+    inFixedValues->layerId = layerId;
+    inFixedValues->valueCount = valueCount;
+    inFixedValues->incomingValue = values;
+}
+
+static void test_replay_value_set(FWPS_INCOMING_VALUE0 *values, int index, FWP_DATA_TYPE type,
+        UINT32 v)
+{
+    FWP_VALUE0 *value = &values[index].value;
+
+    value->type = type;
+
+    switch (type) {
+    case FWP_UINT8:
+        value->uint8 = (UINT8) v;
+        break;
+    case FWP_UINT16:
+        value->uint16 = (UINT16) v;
+        break;
+    default:
+        value->uint32 = v;
+    }
+}
+
+static void test_replay_verdict_check(PTEST_REPLAY replay, int conn_index, FWP_ACTION_TYPE verdict)
+{
+    const int verdict_index =
+            (verdict == FWP_ACTION_PERMIT) ? 0 : ((verdict == FWP_ACTION_BLOCK) ? 1 : 2);
+
+    InterlockedIncrement(&replay->verdict_counts[verdict_index]);
+
+    /* The same connection must get the same verdict on any thread and round */
+    const LONG old_verdict =
+            InterlockedCompareExchange(&replay->verdicts[conn_index], (LONG) verdict, 0);
+
+    if (old_verdict != 0 && old_verdict != (LONG) verdict) {
+        InterlockedIncrement(&replay->verdict_mismatches);
+    }
+}
+
+static FWP_ACTION_TYPE test_replay_ale_classify(
+        const TEST_REPLAY_CONN *conn, UINT64 flowId, FWP_BYTE_BLOB *processPath)
+{
+    const BOOL inbound = conn->inbound;
+
+    const FWPS_CALLOUT0 *callout =
+            um_fwps_callout(inbound ? &FORT_GUID_CALLOUT_ACCEPT_V4 : &FORT_GUID_CALLOUT_CONNECT_V4);
+
+    FWPS_INCOMING_VALUE0 values[TEST_REPLAY_VALUES_MAX];
+    FWPS_INCOMING_VALUES0 inFixedValues;
+
+    if (inbound) {
+        test_replay_values_init(&inFixedValues, values, FWPS_LAYER_ALE_AUTH_RECV_ACCEPT_V4,
+                FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_MAX);
+
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_IP_LOCAL_ADDRESS,
+                FWP_UINT32, TEST_REPLAY_LOCAL_IP);
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_IP_REMOTE_ADDRESS,
+                FWP_UINT32, conn->remote_ip);
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_IP_LOCAL_PORT,
+                FWP_UINT16, conn->local_port);
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_IP_REMOTE_PORT,
+                FWP_UINT16, conn->remote_port);
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_RECV_ACCEPT_V4_IP_PROTOCOL, FWP_UINT8,
+                conn->ip_proto);
+    } else {
+        test_replay_values_init(&inFixedValues, values, FWPS_LAYER_ALE_AUTH_CONNECT_V4,
+                FWPS_FIELD_ALE_AUTH_CONNECT_V4_MAX);
+
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_CONNECT_V4_IP_LOCAL_ADDRESS,
+                FWP_UINT32, TEST_REPLAY_LOCAL_IP);
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_CONNECT_V4_IP_REMOTE_ADDRESS,
+                FWP_UINT32, conn->remote_ip);
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_CONNECT_V4_IP_LOCAL_PORT, FWP_UINT16,
+                conn->local_port);
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_CONNECT_V4_IP_REMOTE_PORT, FWP_UINT16,
+                conn->remote_port);
+        test_replay_value_set(values, FWPS_FIELD_ALE_AUTH_CONNECT_V4_IP_PROTOCOL, FWP_UINT8,
+                conn->ip_proto);
+    }
+
+    FWPS_INCOMING_METADATA_VALUES0 inMetaValues;
+    RtlZeroMemory(&inMetaValues, sizeof(inMetaValues));
+
+    inMetaValues.currentMetadataValues = FWPS_METADATA_FIELD_PROCESS_ID
+            | FWPS_METADATA_FIELD_PROCESS_PATH | FWPS_METADATA_FIELD_FLOW_HANDLE;
+    inMetaValues.processId = conn->process_id;
+    inMetaValues.processPath = processPath;
+    inMetaValues.flowHandle = flowId;
+    inMetaValues.packetDirection = inbound ? FWP_DIRECTION_INBOUND : FWP_DIRECTION_OUTBOUND;
+
+    FWPS_FILTER0 filter;
+    RtlZeroMemory(&filter, sizeof(filter));
+
+    FWPS_CLASSIFY_OUT0 classifyOut;
+    RtlZeroMemory(&classifyOut, sizeof(classifyOut));
+    classifyOut.rights = FWPS_RIGHT_ACTION_WRITE;
+
+    callout->classifyFn(&inFixedValues, &inMetaValues, /*layerData=*/NULL, &filter,
+            /*flowContext=*/0, &classifyOut);
+
+    return classifyOut.actionType;
+}
+
+static void test_replay_packet_classify(PNET_BUFFER_LIST nbl, const TEST_REPLAY_CONN *conn,
+        UINT64 flowContext, BOOL inbound)
+{
+    FWPS_INCOMING_VALUE0 values[TEST_REPLAY_VALUES_MAX];
+    FWPS_INCOMING_VALUES0 inFixedValues;
+
+    FWPS_INCOMING_METADATA_VALUES0 inMetaValues;
+    RtlZeroMemory(&inMetaValues, sizeof(inMetaValues));
+
+    FWPS_FILTER0 filter;
+    RtlZeroMemory(&filter, sizeof(filter));
+
+    FWPS_CLASSIFY_OUT0 classifyOut;
+    RtlZeroMemory(&classifyOut, sizeof(classifyOut));
+    classifyOut.rights = FWPS_RIGHT_ACTION_WRITE;
+
+    /* Flow's traffic */
+    if (conn->ip_proto == IPPROTO_TCP) {
+        FWPS_STREAM_DATA0 streamData;
+        RtlZeroMemory(&streamData, sizeof(streamData));
+        streamData.flags = inbound ? FWPS_STREAM_FLAG_RECEIVE : FWPS_STREAM_FLAG_SEND;
+        streamData.dataLength = conn->packet_size;
+
+        FWPS_STREAM_CALLOUT_IO_PACKET0 packet;
+        RtlZeroMemory(&packet, sizeof(packet));
+        packet.streamData = &streamData;
+
+        test_replay_values_init(
+                &inFixedValues, values, FWPS_LAYER_STREAM_V4, FWPS_FIELD_STREAM_V4_MAX);
+
+        um_fwps_callout(&FORT_GUID_CALLOUT_STREAM_V4)
+                ->classifyFn(
+                        &inFixedValues, &inMetaValues, &packet, &filter, flowContext, &classifyOut);
+    } else {
+        test_replay_values_init(&inFixedValues, values, FWPS_LAYER_DATAGRAM_DATA_V4,
+                FWPS_FIELD_DATAGRAM_DATA_V4_MAX);
+
+        test_replay_value_set(values, FWPS_FIELD_DATAGRAM_DATA_V4_DIRECTION, FWP_UINT8,
+                inbound ? FWP_DIRECTION_INBOUND : FWP_DIRECTION_OUTBOUND);
+
+        um_fwps_callout(&FORT_GUID_CALLOUT_DATAGRAM_V4)
+                ->classifyFn(
+                        &inFixedValues, &inMetaValues, nbl, &filter, flowContext, &classifyOut);
+    }
+
+    /* Shaper */
+    RtlZeroMemory(&classifyOut, sizeof(classifyOut));
+    classifyOut.rights = FWPS_RIGHT_ACTION_WRITE;
+
+    test_replay_values_init(&inFixedValues, values,
+            inbound ? FWPS_LAYER_INBOUND_TRANSPORT_V4 : FWPS_LAYER_OUTBOUND_TRANSPORT_V4,
+            inbound ? FWPS_FIELD_INBOUND_TRANSPORT_V4_MAX : FWPS_FIELD_OUTBOUND_TRANSPORT_V4_MAX);
+
+    const FWPS_CALLOUT0 *callout = um_fwps_callout(
+            inbound ? &FORT_GUID_CALLOUT_IN_TRANSPORT_V4 : &FORT_GUID_CALLOUT_OUT_TRANSPORT_V4);
+
+    callout->classifyFn(&inFixedValues, &inMetaValues, nbl, &filter, flowContext, &classifyOut);
+}
+
+static void test_replay_flow(
+        PTEST_REPLAY_THREAD th, const TEST_REPLAY_CONN *conn, UINT64 flowId)
+{
+    const UINT64 flowContext = um_fwps_flow_context(flowId);
+    if (flowContext == 0)
+        return; /* not associated */
+
+    for (int i = 0; i < conn->packets_n; ++i) {
+        PNET_BUFFER_LIST nbl = &th->nbls[i];
+        PNET_BUFFER nb = &th->nbs[i];
+
+        RtlZeroMemory(nbl, sizeof(NET_BUFFER_LIST));
+        RtlZeroMemory(nb, sizeof(NET_BUFFER));
+
+        NET_BUFFER_LIST_FIRST_NB(nbl) = nb;
+        NET_BUFFER_DATA_LENGTH(nb) = conn->packet_size;
+
+        /* Requests and responses alternate */
+        const BOOL inbound = ((i & 1) != 0) != (conn->inbound != 0);
+
+        test_replay_packet_classify(nbl, conn, flowContext, inbound);
+    }
+
+    InterlockedAdd64(&th->replay->packets_n, conn->packets_n);
+
+    /* The flow's packets are dropped from the shaper's queues before the NBLs reuse */
+    const FWPS_CALLOUT0 *callout = um_fwps_callout((conn->ip_proto == IPPROTO_TCP)
+                    ? &FORT_GUID_CALLOUT_STREAM_V4
+                    : &FORT_GUID_CALLOUT_DATAGRAM_V4);
+
+    callout->flowDeleteFn(/*layerId=*/0, /*calloutId=*/0, flowContext);
+}
+
+static DWORD WINAPI test_replay_thread(PVOID param)
+{
+    PTEST_REPLAY_THREAD th = param;
+    PTEST_REPLAY replay = th->replay;
+
+    for (int round = 0; round < replay->rounds_n; ++round) {
+        for (int i = 0; i < replay->conns_n; ++i) {
+            const TEST_REPLAY_CONN *conn = &replay->conns[i];
+
+            /* The thread index in the low bits keeps the live flows apart */
+            const UINT64 flowId = ((UINT64) ++th->flow_seq << 6) | th->thread_index;
+
+            FWP_BYTE_BLOB processPath = {
+                .size = conn->path_size + sizeof(WCHAR), /* include terminating zero */
+                .data = (UINT8 *) conn->path,
+            };
+
+            const FWP_ACTION_TYPE verdict = test_replay_ale_classify(conn, flowId, &processPath);
+
+            test_replay_verdict_check(replay, i, verdict);
+
+            if (verdict == FWP_ACTION_PERMIT) {
+                test_replay_flow(th, conn, flowId);
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void test_replay_run(PTEST_REPLAY replay)
+{
+    HANDLE threads[TEST_REPLAY_THREADS_MAX];
+    PTEST_REPLAY_THREAD ths = calloc(replay->threads_n, sizeof(TEST_REPLAY_THREAD));
+
+    const UINT64 contentions_begin = um_spin_lock_contentions();
+
+    LARGE_INTEGER freq, begin, end;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&begin);
+
+    for (int i = 0; i < replay->threads_n; ++i) {
+        ths[i].replay = replay;
+        ths[i].thread_index = (UINT32) i;
+
+        threads[i] = CreateThread(NULL, 0, &test_replay_thread, &ths[i], 0, NULL);
+    }
+
+    WaitForMultipleObjects(replay->threads_n, threads, TRUE, INFINITE);
+
+    QueryPerformanceCounter(&end);
+
+    for (int i = 0; i < replay->threads_n; ++i) {
+        CloseHandle(threads[i]);
+    }
+    free(ths);
+
+    const double secs = (double) (end.QuadPart - begin.QuadPart) / (double) freq.QuadPart;
+    const UINT64 conns_n = (UINT64) replay->conns_n * replay->rounds_n * replay->threads_n;
+
+    FORT_DEVICE_STATS stats;
+    RtlZeroMemory(&stats, sizeof(stats));
+    fort_perf_stats(&fort_device()->perf, &stats);
+
+    printf("replay: threads=%d conns=%llu packets=%lld secs=%.3f\n", replay->threads_n, conns_n,
+            replay->packets_n, secs);
+    printf("replay: conns/sec=%.0f packets/sec=%.0f\n", conns_n / secs, replay->packets_n / secs);
+    printf("replay: lock contentions=%llu\n", um_spin_lock_contentions() - contentions_begin);
+    printf("replay: verdicts permit=%ld block=%ld other=%ld mismatches=%ld\n",
+            replay->verdict_counts[0], replay->verdict_counts[1], replay->verdict_counts[2],
+            replay->verdict_mismatches);
+    printf("replay: shaper drops=%llu injects=%llu\n", stats.shaper_drops, stats.shaper_injects);
+
+    fflush(stdout);
+}
+
+FORT_API int test_replay_main(int argc, char *argv[])
+{
+    TEST_REPLAY replay;
+    RtlZeroMemory(&replay, sizeof(replay));
+
+    replay.threads_n = 4;
+    replay.rounds_n = 1;
+
+    int conns_n = 10000;
+    const char *conf_path = NULL;
+    const char *conns_path = NULL;
+
+    for (int i = 0; i + 1 < argc; i += 2) {
+        const char *opt = argv[i];
+        const char *value = argv[i + 1];
+
+        if (strcmp(opt, "-t") == 0) {
+            replay.threads_n = max(1, min(atoi(value), TEST_REPLAY_THREADS_MAX));
+        } else if (strcmp(opt, "-n") == 0) {
+            conns_n = max(1, atoi(value));
+        } else if (strcmp(opt, "-r") == 0) {
+            replay.rounds_n = max(1, atoi(value));
+        } else if (strcmp(opt, "-c") == 0) {
+            conf_path = value;
+        } else if (strcmp(opt, "-f") == 0) {
+            conns_path = value;
+        }
+    }
+
+    replay.conns = calloc(conns_n, sizeof(TEST_REPLAY_CONN));
+    replay.verdicts = calloc(conns_n, sizeof(LONG));
+
+    if (conns_path == NULL) {
+        test_replay_conns_generate(&replay, conns_n);
+    } else if (!test_replay_conns_load(&replay, conns_path, conns_n)) {
+        printf("replay: Connections file error: %s\n", conns_path);
+        return 1;
+    }
+
+    if (!NT_SUCCESS(test_replay_device_open())) {
+        printf("replay: Device open error\n");
+        return 1;
+    }
+
+    if (conf_path != NULL && !test_replay_conf_load(conf_path)) {
+        printf("replay: Conf file error: %s\n", conf_path);
+    }
+
+    PFORT_CONF_REF conf_ref = fort_conf_ref_take(&fort_device()->conf);
+    if (conf_ref == NULL) {
+        printf("replay: No conf: the connections are not filtered\n");
+    } else {
+        fort_conf_ref_put(&fort_device()->conf, conf_ref);
+    }
+
+    test_replay_run(&replay);
+
+    test_replay_device_close();
+
+    free((PVOID) replay.verdicts);
+    free(replay.conns);
+
+    return (replay.verdict_mismatches == 0) ? 0 : 2;
+}
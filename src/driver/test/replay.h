@@ -0,0 +1,19 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "../fortdrv.h"
+
+#define TEST_REPLAY_THREADS_MAX 64 /* limited by the user mode processors */
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* Usage: replay [-t threads] [-n conns] [-r rounds] [-c conf_io.bin] [-f conns.csv] */
+FORT_API int test_replay_main(int argc, char *argv[]);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#endif // REPLAY_H
@@ -1,17 +1,65 @@
 #include "um_fwpsk.h"
 
+#define UM_FWPS_CALLOUTS_MAX 32
+#define UM_FWPS_FLOWS_MAX    0x10000 /* power of 2 */
+
+typedef struct um_fwps_flow
+{
+    volatile LONG64 flow_id;
+    volatile LONG64 flow_context;
+} UM_FWPS_FLOW, *PUM_FWPS_FLOW;
+
+static FWPS_CALLOUT0 g_umCallouts[UM_FWPS_CALLOUTS_MAX];
+static volatile LONG g_umCalloutsCount;
+
+static UM_FWPS_FLOW g_umFlows[UM_FWPS_FLOWS_MAX];
+
+FORT_API const FWPS_CALLOUT0 *um_fwps_callout(const GUID *calloutKey)
+{
+    const LONG count = g_umCalloutsCount;
+
+    for (LONG i = 0; i < count; ++i) {
+        const FWPS_CALLOUT0 *callout = &g_umCallouts[i];
+
+        if (callout->classifyFn != NULL && IsEqualGUID(&callout->calloutKey, calloutKey))
+            return callout;
+    }
+
+    return NULL;
+}
+
+FORT_API UINT64 um_fwps_flow_context(UINT64 flowId)
+{
+    PUM_FWPS_FLOW flow = &g_umFlows[flowId & (UM_FWPS_FLOWS_MAX - 1)];
+
+    return (flow->flow_id == (LONG64) flowId) ? (UINT64) flow->flow_context : 0;
+}
+
 NTSTATUS NTAPI FwpsCalloutRegister0(
         void *deviceObject, const FWPS_CALLOUT0 *callout, UINT32 *calloutId)
 {
     UNUSED(deviceObject);
-    UNUSED(callout);
-    UNUSED(calloutId);
+
+    const LONG index = InterlockedIncrement(&g_umCalloutsCount) - 1;
+    if (index >= UM_FWPS_CALLOUTS_MAX) {
+        InterlockedDecrement(&g_umCalloutsCount);
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    g_umCallouts[index] = *callout;
+
+    *calloutId = (UINT32) index + 1;
+
     return STATUS_SUCCESS;
 }
 
 NTSTATUS NTAPI FwpsCalloutUnregisterById0(const UINT32 calloutId)
 {
-    UNUSED(calloutId);
+    if (calloutId == 0 || calloutId > UM_FWPS_CALLOUTS_MAX)
+        return STATUS_NOT_FOUND;
+
+    g_umCallouts[calloutId - 1].classifyFn = NULL;
+
     return STATUS_SUCCESS;
 }
 
@@ -43,18 +91,30 @@ NTSTATUS NTAPI FwpsAllocateCloneNetBufferList0(NET_BUFFER_LIST *originalNetBuffe
         NDIS_HANDLE netBufferListPoolHandle, NDIS_HANDLE netBufferPoolHandle,
         ULONG allocateCloneFlags, NET_BUFFER_LIST **netBufferList)
 {
-    UNUSED(originalNetBufferList);
     UNUSED(netBufferListPoolHandle);
     UNUSED(netBufferPoolHandle);
     UNUSED(allocateCloneFlags);
-    UNUSED(netBufferList);
+
+    /* The clone shares the original's net buffers */
+    NET_BUFFER_LIST *clone = HeapAlloc(GetProcessHeap(), 0, sizeof(NET_BUFFER_LIST));
+    if (clone == NULL)
+        return STATUS_INSUFFICIENT_RESOURCES;
+
+    *clone = *originalNetBufferList;
+
+    NET_BUFFER_LIST_NEXT_NBL(clone) = NULL;
+    clone->Status = STATUS_SUCCESS;
+
+    *netBufferList = clone;
+
     return STATUS_SUCCESS;
 }
 
 void NTAPI FwpsFreeCloneNetBufferList0(NET_BUFFER_LIST *netBufferList, ULONG freeCloneFlags)
 {
-    UNUSED(netBufferList);
     UNUSED(freeCloneFlags);
+
+    HeapFree(GetProcessHeap(), 0, netBufferList);
 }
 
 NTSTATUS NTAPI FwpsInjectTransportSendAsync0(HANDLE injectionHandle, HANDLE injectionContext,
@@ -69,9 +129,10 @@ NTSTATUS NTAPI FwpsInjectTransportSendAsync0(HANDLE injectionHandle, HANDLE inje
     UNUSED(sendArgs);
     UNUSED(addressFamily);
     UNUSED(compartmentId);
-    UNUSED(netBufferList);
-    UNUSED(completionFn);
-    UNUSED(completionContext);
+
+    /* The injected packets are delivered at once */
+    completionFn(completionContext, netBufferList, /*dispatchLevel=*/FALSE);
+
     return STATUS_SUCCESS;
 }
 
@@ -88,9 +149,10 @@ NTSTATUS NTAPI FwpsInjectTransportReceiveAsync0(HANDLE injectionHandle, HANDLE i
     UNUSED(compartmentId);
     UNUSED(interfaceIndex);
     UNUSED(subInterfaceIndex);
-    UNUSED(netBufferList);
-    UNUSED(completionFn);
-    UNUSED(completionContext);
+
+    /* The injected packets are delivered at once */
+    completionFn(completionContext, netBufferList, /*dispatchLevel=*/FALSE);
+
     return STATUS_SUCCESS;
 }
 
@@ -171,18 +233,28 @@ NTSTATUS NTAPI FwpsStreamInjectAsync0(HANDLE injectionHandle, HANDLE injectionCo
 NTSTATUS NTAPI FwpsFlowAssociateContext0(
         UINT64 flowId, UINT16 layerId, UINT32 calloutId, UINT64 flowContext)
 {
-    UNUSED(flowId);
     UNUSED(layerId);
     UNUSED(calloutId);
-    UNUSED(flowContext);
+
+    /* The layers of a flow share its context */
+    PUM_FWPS_FLOW flow = &g_umFlows[flowId & (UM_FWPS_FLOWS_MAX - 1)];
+
+    InterlockedExchange64(&flow->flow_context, (LONG64) flowContext);
+    InterlockedExchange64(&flow->flow_id, (LONG64) flowId);
+
     return STATUS_SUCCESS;
 }
 
 NTSTATUS NTAPI FwpsFlowRemoveContext0(UINT64 flowId, UINT16 layerId, UINT32 calloutId)
 {
-    UNUSED(flowId);
     UNUSED(layerId);
     UNUSED(calloutId);
+
+    PUM_FWPS_FLOW flow = &g_umFlows[flowId & (UM_FWPS_FLOWS_MAX - 1)];
+
+    if (InterlockedCompareExchange64(&flow->flow_id, 0, (LONG64) flowId) != (LONG64) flowId)
+        return STATUS_NOT_FOUND;
+
     return STATUS_SUCCESS;
 }
 
@@ -2840,6 +2840,11 @@ _IRQL_requires_max_(DISPATCH_LEVEL) void NTAPI
         FwpsDiscardClonedStreamData0(_Inout_ NET_BUFFER_LIST *netBufferListChain,
                 _In_ UINT32 allocateCloneFlags, _In_ BOOLEAN dispatchLevel);
 
+/* User mode only: the registered callout and the flow's associated context */
+FORT_API const FWPS_CALLOUT0 *um_fwps_callout(const GUID *calloutKey);
+
+FORT_API UINT64 um_fwps_flow_context(UINT64 flowId);
+
 #ifdef __cplusplus
 }
 #endif
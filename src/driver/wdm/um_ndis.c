@@ -29,3 +29,29 @@ PVOID NdisGetDataBuffer(PNET_BUFFER netBuffer, ULONG bytesNeeded, PVOID storage,
     UNUSED(alignOffset);
     return NULL;
 }
+
+PNDIS_GENERIC_OBJECT NdisAllocateGenericObject(PDRIVER_OBJECT driverObject, ULONG tag, USHORT size)
+{
+    UNUSED(driverObject);
+    UNUSED(tag);
+    UNUSED(size);
+    return NULL;
+}
+
+VOID NdisFreeGenericObject(PNDIS_GENERIC_OBJECT ndisObject)
+{
+    UNUSED(ndisObject);
+}
+
+NDIS_HANDLE NdisAllocateNetBufferListPool(
+        NDIS_HANDLE ndisHandle, PNET_BUFFER_LIST_POOL_PARAMETERS parameters)
+{
+    UNUSED(ndisHandle);
+    UNUSED(parameters);
+    return NULL;
+}
+
+VOID NdisFreeNetBufferListPool(NDIS_HANDLE poolHandle)
+{
+    UNUSED(poolHandle);
+}
@@ -393,6 +393,54 @@ FORT_API VOID NdisAdvanceNetBufferDataStart(PNET_BUFFER netBuffer, ULONG dataOff
 FORT_API PVOID NdisGetDataBuffer(PNET_BUFFER netBuffer, ULONG bytesNeeded, PVOID storage,
         UINT alignMultiple, UINT alignOffset);
 
+//
+// NET_BUFFER_LIST pools
+//
+
+#define NDIS_OBJECT_TYPE_DEFAULT 0x80
+
+typedef struct _NDIS_OBJECT_HEADER
+{
+    UCHAR Type;
+    UCHAR Revision;
+    USHORT Size;
+} NDIS_OBJECT_HEADER, *PNDIS_OBJECT_HEADER;
+
+#define NDIS_PROTOCOL_ID_DEFAULT 0x00
+
+#define NET_BUFFER_LIST_POOL_PARAMETERS_REVISION_1 1
+
+typedef struct _NET_BUFFER_LIST_POOL_PARAMETERS
+{
+    NDIS_OBJECT_HEADER Header;
+    UCHAR ProtocolId;
+    BOOLEAN fAllocateNetBuffer;
+    USHORT ContextSize;
+    ULONG PoolTag;
+    ULONG DataSize;
+} NET_BUFFER_LIST_POOL_PARAMETERS, *PNET_BUFFER_LIST_POOL_PARAMETERS;
+
+#define NDIS_SIZEOF_NET_BUFFER_LIST_POOL_PARAMETERS_REVISION_1                                     \
+    sizeof(NET_BUFFER_LIST_POOL_PARAMETERS)
+
+typedef struct _NDIS_GENERIC_OBJECT
+{
+    NDIS_OBJECT_HEADER Header;
+    PVOID Caller;
+    PVOID CallersCaller;
+    PDRIVER_OBJECT DriverObject;
+} NDIS_GENERIC_OBJECT, *PNDIS_GENERIC_OBJECT;
+
+FORT_API PNDIS_GENERIC_OBJECT NdisAllocateGenericObject(
+        PDRIVER_OBJECT driverObject, ULONG tag, USHORT size);
+
+FORT_API VOID NdisFreeGenericObject(PNDIS_GENERIC_OBJECT ndisObject);
+
+FORT_API NDIS_HANDLE NdisAllocateNetBufferListPool(
+        NDIS_HANDLE ndisHandle, PNET_BUFFER_LIST_POOL_PARAMETERS parameters);
+
+FORT_API VOID NdisFreeNetBufferListPool(NDIS_HANDLE poolHandle);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -17,8 +17,9 @@ NTSTATUS PsSetCreateProcessNotifyRoutineEx(
 
 NTSTATUS KeExpandKernelStackAndCallout(PEXPAND_STACK_CALLOUT callout, PVOID parameter, SIZE_T size)
 {
-    UNUSED(callout);
-    UNUSED(parameter);
     UNUSED(size);
+
+    callout(parameter);
+
     return STATUS_SUCCESS;
 }
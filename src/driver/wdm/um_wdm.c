@@ -44,6 +44,84 @@ PVOID ExAllocatePool2(POOL_FLAGS flags, SIZE_T size, ULONG tag)
     return HeapAlloc(GetProcessHeap(), 0, size);
 }
 
+PVOID ExAllocatePool3(POOL_FLAGS flags, SIZE_T size, ULONG tag,
+        const POOL_EXTENDED_PARAMETER *extendedParameters, ULONG extendedParametersCount)
+{
+    UNUSED(extendedParameters);
+    UNUSED(extendedParametersCount);
+    return ExAllocatePool2(flags, size, tag);
+}
+
+/* The MDL is the memory itself */
+PVOID MmAllocateNodePagesForMdlEx(PHYSICAL_ADDRESS lowAddress, PHYSICAL_ADDRESS highAddress,
+        PHYSICAL_ADDRESS skipBytes, SIZE_T totalBytes, MEMORY_CACHING_TYPE cacheType,
+        ULONG idealNode, ULONG flags)
+{
+    UNUSED(lowAddress);
+    UNUSED(highAddress);
+    UNUSED(skipBytes);
+    UNUSED(cacheType);
+    UNUSED(idealNode);
+    UNUSED(flags);
+    return HeapAlloc(GetProcessHeap(), 0, totalBytes);
+}
+
+void MmFreePagesFromMdl(PVOID mdl)
+{
+    HeapFree(GetProcessHeap(), 0, mdl);
+}
+
+PVOID MmGetSystemAddressForMdlSafe(PVOID mdl, ULONG priority)
+{
+    UNUSED(priority);
+    return mdl;
+}
+
+PVOID MmMapLockedPagesSpecifyCache(PVOID mdl, KPROCESSOR_MODE accessMode,
+        MEMORY_CACHING_TYPE cacheType, PVOID requestedAddress, ULONG bugCheckOnFailure,
+        ULONG priority)
+{
+    UNUSED(accessMode);
+    UNUSED(cacheType);
+    UNUSED(requestedAddress);
+    UNUSED(bugCheckOnFailure);
+    UNUSED(priority);
+    return mdl;
+}
+
+void MmUnmapLockedPages(PVOID baseAddress, PVOID mdl)
+{
+    UNUSED(baseAddress);
+    UNUSED(mdl);
+}
+
+PVOID IoAllocateMdl(
+        PVOID virtualAddress, ULONG length, BOOLEAN secondaryBuffer, BOOLEAN chargeQuota, PIRP irp)
+{
+    UNUSED(length);
+    UNUSED(secondaryBuffer);
+    UNUSED(chargeQuota);
+    UNUSED(irp);
+    return virtualAddress;
+}
+
+void IoFreeMdl(PVOID mdl)
+{
+    UNUSED(mdl);
+}
+
+void MmProbeAndLockPages(PVOID mdl, KPROCESSOR_MODE accessMode, LOCK_OPERATION operation)
+{
+    UNUSED(mdl);
+    UNUSED(accessMode);
+    UNUSED(operation);
+}
+
+void MmUnlockPages(PVOID mdl)
+{
+    UNUSED(mdl);
+}
+
 PIO_STACK_LOCATION IoGetCurrentIrpStackLocation(PIRP irp)
 {
     UNUSED(irp);
@@ -145,31 +223,54 @@ LONG_PTR ObDereferenceObject(PVOID object)
     return 0;
 }
 
+#define UM_EX_SPIN_LOCK_EXCLUSIVE 0x80000000
+
+static volatile LONG64 g_umSpinLockContentions;
+
+static void um_spin_lock_contended(void)
+{
+    InterlockedIncrement64(&g_umSpinLockContentions);
+}
+
+FORT_API UINT64 um_spin_lock_contentions(void)
+{
+    return (UINT64) InterlockedCompareExchange64(&g_umSpinLockContentions, 0, 0);
+}
+
 void KeInitializeSpinLock(PKSPIN_LOCK lock)
 {
-    UNUSED(lock);
+    *lock = 0;
 }
 
 void KeAcquireInStackQueuedSpinLock(PKSPIN_LOCK lock, PKLOCK_QUEUE_HANDLE handle)
 {
-    UNUSED(lock);
-    UNUSED(handle);
+    PVOID volatile *p = (PVOID volatile *) lock;
+
+    handle->lock = lock;
+
+    if (InterlockedCompareExchangePointer(p, (PVOID) 1, NULL) == NULL)
+        return;
+
+    um_spin_lock_contended();
+
+    while (InterlockedCompareExchangePointer(p, (PVOID) 1, NULL) != NULL) {
+        YieldProcessor();
+    }
 }
 
 void KeReleaseInStackQueuedSpinLock(PKLOCK_QUEUE_HANDLE handle)
 {
-    UNUSED(handle);
+    InterlockedExchangePointer((PVOID volatile *) handle->lock, NULL);
 }
 
 void KeAcquireInStackQueuedSpinLockAtDpcLevel(PKSPIN_LOCK lock, PKLOCK_QUEUE_HANDLE handle)
 {
-    UNUSED(lock);
-    UNUSED(handle);
+    KeAcquireInStackQueuedSpinLock(lock, handle);
 }
 
 void KeReleaseInStackQueuedSpinLockFromDpcLevel(PKLOCK_QUEUE_HANDLE handle)
 {
-    UNUSED(handle);
+    KeReleaseInStackQueuedSpinLock(handle);
 }
 
 void IoAcquireCancelSpinLock(PKIRQL irql)
@@ -182,28 +283,55 @@ void IoReleaseCancelSpinLock(KIRQL irql)
     UNUSED(irql);
 }
 
+static BOOL um_spin_lock_try_shared(PEX_SPIN_LOCK lock)
+{
+    const LONG v = *lock;
+
+    return (v & UM_EX_SPIN_LOCK_EXCLUSIVE) == 0
+            && InterlockedCompareExchange(lock, v + 1, v) == v;
+}
+
+static BOOL um_spin_lock_try_exclusive(PEX_SPIN_LOCK lock)
+{
+    return InterlockedCompareExchange(lock, (LONG) UM_EX_SPIN_LOCK_EXCLUSIVE, 0) == 0;
+}
+
 KIRQL ExAcquireSpinLockShared(PEX_SPIN_LOCK lock)
 {
-    UNUSED(lock);
+    if (um_spin_lock_try_shared(lock))
+        return 0;
+
+    um_spin_lock_contended();
+
+    while (!um_spin_lock_try_shared(lock)) {
+        YieldProcessor();
+    }
     return 0;
 }
 
 KIRQL ExAcquireSpinLockExclusive(PEX_SPIN_LOCK lock)
 {
-    UNUSED(lock);
+    if (um_spin_lock_try_exclusive(lock))
+        return 0;
+
+    um_spin_lock_contended();
+
+    while (!um_spin_lock_try_exclusive(lock)) {
+        YieldProcessor();
+    }
     return 0;
 }
 
 void ExReleaseSpinLockShared(PEX_SPIN_LOCK lock, KIRQL oldIrql)
 {
-    UNUSED(lock);
     UNUSED(oldIrql);
+    InterlockedDecrement(lock);
 }
 
 void ExReleaseSpinLockExclusive(PEX_SPIN_LOCK lock, KIRQL oldIrql)
 {
-    UNUSED(lock);
     UNUSED(oldIrql);
+    InterlockedExchange(lock, 0);
 }
 
 KIRQL KeGetCurrentIrql(void)
@@ -211,6 +339,75 @@ KIRQL KeGetCurrentIrql(void)
     return 0;
 }
 
+KIRQL KeRaiseIrqlToDpcLevel(void)
+{
+    return 0;
+}
+
+void KeLowerIrql(KIRQL newIrql)
+{
+    UNUSED(newIrql);
+}
+
+/* The threads are the processors: the per-CPU data is not shared by the concurrent threads */
+#define UM_PROCESSORS_MAX 64
+
+static volatile LONG g_umProcessorsCount;
+
+static __declspec(thread) ULONG g_umProcessorIndex; /* 1-based, 0 if not assigned yet */
+
+ULONG KeQueryMaximumProcessorCountEx(USHORT groupNumber)
+{
+    UNUSED(groupNumber);
+    return UM_PROCESSORS_MAX;
+}
+
+ULONG KeGetCurrentProcessorIndex(void)
+{
+    if (g_umProcessorIndex == 0) {
+        const LONG index = InterlockedIncrement(&g_umProcessorsCount) - 1;
+
+        g_umProcessorIndex = (ULONG) (index % UM_PROCESSORS_MAX) + 1;
+    }
+
+    return g_umProcessorIndex - 1;
+}
+
+NTSTATUS KeGetProcessorNumberFromIndex(ULONG procIndex, PPROCESSOR_NUMBER procNumber)
+{
+    procNumber->Group = 0;
+    procNumber->Number = (UCHAR) procIndex;
+    procNumber->Reserved = 0;
+    return STATUS_SUCCESS;
+}
+
+KAFFINITY KeQueryGroupAffinity(USHORT groupNumber)
+{
+    UNUSED(groupNumber);
+    return 1;
+}
+
+USHORT KeQueryHighestNodeNumber(void)
+{
+    return 0;
+}
+
+USHORT KeGetCurrentNodeNumber(void)
+{
+    return 0;
+}
+
+void KeSetSystemGroupAffinityThread(PGROUP_AFFINITY affinity, PGROUP_AFFINITY previousAffinity)
+{
+    UNUSED(affinity);
+    UNUSED(previousAffinity);
+}
+
+void KeRevertToUserGroupAffinityThread(PGROUP_AFFINITY previousAffinity)
+{
+    UNUSED(previousAffinity);
+}
+
 void IoCompleteRequest(PIRP irp, CCHAR priorityBoost)
 {
     UNUSED(irp);
@@ -317,8 +514,12 @@ void IoQueueWorkItemEx(
 
 LARGE_INTEGER KeQueryPerformanceCounter(PLARGE_INTEGER performanceFrequency)
 {
-    UNUSED(performanceFrequency);
-    const LARGE_INTEGER res = { 0 };
+    if (performanceFrequency != NULL) {
+        QueryPerformanceFrequency(performanceFrequency);
+    }
+
+    LARGE_INTEGER res;
+    QueryPerformanceCounter(&res);
     return res;
 }
 
@@ -345,6 +546,17 @@ NTSTATUS RtlGetVersion(PRTL_OSVERSIONINFOW versionInformation)
     return STATUS_SUCCESS;
 }
 
+NTSTATUS RtlULongAdd(ULONG augend, ULONG addend, ULONG *result)
+{
+    if (augend > MAXULONG - addend) {
+        *result = MAXULONG;
+        return STATUS_INTEGER_OVERFLOW;
+    }
+
+    *result = augend + addend;
+    return STATUS_SUCCESS;
+}
+
 NTSTATUS ZwOpenKey(
         PHANDLE keyHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes)
 {
@@ -475,6 +687,8 @@ NTSTATUS MmCopyVirtualMemory(PEPROCESS sourceProcess, PVOID sourceAddress, PEPRO
 }
 
 POBJECT_TYPE *PsProcessType = NULL;
+POBJECT_TYPE *ExEventObjectType = NULL;
+POBJECT_TYPE *IoFileObjectType = NULL;
 
 NTSTATUS ObReferenceObjectByHandle(HANDLE handle, ACCESS_MASK desiredAccess,
         POBJECT_TYPE objectType, KPROCESSOR_MODE accessMode, PVOID *object,
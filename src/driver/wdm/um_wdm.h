@@ -156,6 +156,7 @@ typedef struct
         NTSTATUS Status;
         ULONG_PTR Information;
     } IoStatus;
+    PVOID MdlAddress;
     union {
         PVOID SystemBuffer;
     } AssociatedIrp;
@@ -165,6 +166,7 @@ typedef struct
 typedef struct _ACCESS_STATE *PACCESS_STATE;
 typedef struct _KPROCESS *PKPROCESS, *PRKPROCESS, *PEPROCESS;
 typedef struct _OBJECT_TYPE *POBJECT_TYPE;
+typedef struct _FILE_OBJECT *PFILE_OBJECT;
 
 typedef struct _OBJECT_HANDLE_INFORMATION
 {
@@ -216,7 +218,11 @@ typedef DRIVER_CANCEL *PDRIVER_CANCEL;
 typedef VOID CALLBACK_FUNCTION(PVOID context, PVOID arg1, PVOID arg2);
 typedef CALLBACK_FUNCTION *PCALLBACK_FUNCTION;
 
-typedef LONG KLOCK_QUEUE_HANDLE, *PKLOCK_QUEUE_HANDLE;
+typedef struct _KLOCK_QUEUE_HANDLE
+{
+    PKSPIN_LOCK lock;
+} KLOCK_QUEUE_HANDLE, *PKLOCK_QUEUE_HANDLE;
+
 typedef volatile LONG EX_SPIN_LOCK, *PEX_SPIN_LOCK;
 
 typedef struct _EX_RUNDOWN_REF
@@ -280,6 +286,7 @@ typedef enum _KEY_VALUE_INFORMATION_CLASS {
 // typedef enum _FILE_INFORMATION_CLASS {
 #define FileBasicInformation    4
 #define FileStandardInformation 5
+#define FileIdInformation       59
 
 typedef struct _FILE_STANDARD_INFORMATION
 {
@@ -290,6 +297,15 @@ typedef struct _FILE_STANDARD_INFORMATION
     BOOLEAN Directory;
 } FILE_STANDARD_INFORMATION, *PFILE_STANDARD_INFORMATION;
 
+typedef struct _FILE_ID_INFORMATION
+{
+    ULONGLONG VolumeSerialNumber;
+    struct
+    {
+        BYTE Identifier[16];
+    } FileId;
+} FILE_ID_INFORMATION, *PFILE_ID_INFORMATION;
+
 typedef NTSTATUS DRIVER_INITIALIZE(PDRIVER_OBJECT driverObject, PUNICODE_STRING registryPath);
 typedef DRIVER_INITIALIZE *PDRIVER_INITIALIZE;
 
@@ -319,6 +335,56 @@ typedef ULONG64 POOL_FLAGS;
 #define POOL_FLAG_PAGED             0x0000000000000100UI64 // Paged pool
 FORT_API PVOID ExAllocatePool2(POOL_FLAGS flags, SIZE_T size, ULONG tag);
 
+typedef enum {
+    PoolExtendedParameterInvalidType = 0,
+    PoolExtendedParameterPriority,
+    PoolExtendedParameterSecurePool,
+    PoolExtendedParameterNumaNode,
+    PoolExtendedParameterMax
+} POOL_EXTENDED_PARAMETER_TYPE;
+
+#define MM_ANY_NODE_OK 0x80000000
+
+typedef struct _POOL_EXTENDED_PARAMETER
+{
+    POOL_EXTENDED_PARAMETER_TYPE Type;
+    union {
+        ULONG64 Reserved2;
+        PVOID Reserved3;
+        ULONG PreferredNode;
+    };
+} POOL_EXTENDED_PARAMETER, *PPOOL_EXTENDED_PARAMETER;
+
+FORT_API PVOID ExAllocatePool3(POOL_FLAGS flags, SIZE_T size, ULONG tag,
+        const POOL_EXTENDED_PARAMETER *extendedParameters, ULONG extendedParametersCount);
+
+typedef enum { MmNonCached, MmCached, MmWriteCombined } MEMORY_CACHING_TYPE;
+
+#define MM_DONT_ZERO_ALLOCATION      0x00000001
+#define MM_ALLOCATE_FULLY_REQUIRED   0x00000004
+#define MM_ALLOCATE_FAST_LARGE_PAGES 0x00000040
+
+FORT_API PVOID MmAllocateNodePagesForMdlEx(PHYSICAL_ADDRESS lowAddress,
+        PHYSICAL_ADDRESS highAddress, PHYSICAL_ADDRESS skipBytes, SIZE_T totalBytes,
+        MEMORY_CACHING_TYPE cacheType, ULONG idealNode, ULONG flags);
+FORT_API void MmFreePagesFromMdl(PVOID mdl);
+
+#define NormalPagePriority  16
+#define MdlMappingNoExecute 0x40000000
+FORT_API PVOID MmGetSystemAddressForMdlSafe(PVOID mdl, ULONG priority);
+FORT_API PVOID MmMapLockedPagesSpecifyCache(PVOID mdl, KPROCESSOR_MODE accessMode,
+        MEMORY_CACHING_TYPE cacheType, PVOID requestedAddress, ULONG bugCheckOnFailure,
+        ULONG priority);
+FORT_API void MmUnmapLockedPages(PVOID baseAddress, PVOID mdl);
+
+typedef enum { IoReadAccess, IoWriteAccess, IoModifyAccess } LOCK_OPERATION;
+
+FORT_API PVOID IoAllocateMdl(PVOID virtualAddress, ULONG length, BOOLEAN secondaryBuffer,
+        BOOLEAN chargeQuota, PIRP irp);
+FORT_API void IoFreeMdl(PVOID mdl);
+FORT_API void MmProbeAndLockPages(PVOID mdl, KPROCESSOR_MODE accessMode, LOCK_OPERATION operation);
+FORT_API void MmUnlockPages(PVOID mdl);
+
 FORT_API PIO_STACK_LOCATION IoGetCurrentIrpStackLocation(PIRP irp);
 FORT_API void IoMarkIrpPending(PIRP irp);
 FORT_API PDRIVER_CANCEL IoSetCancelRoutine(PIRP irp, PDRIVER_CANCEL routine);
@@ -363,7 +429,23 @@ FORT_API KIRQL ExAcquireSpinLockExclusive(PEX_SPIN_LOCK lock);
 FORT_API void ExReleaseSpinLockShared(PEX_SPIN_LOCK lock, KIRQL oldIrql);
 FORT_API void ExReleaseSpinLockExclusive(PEX_SPIN_LOCK lock, KIRQL oldIrql);
 
+/* User mode only: count of the lock acquisitions, which had to spin */
+FORT_API UINT64 um_spin_lock_contentions(void);
+
 FORT_API KIRQL KeGetCurrentIrql(void);
+FORT_API KIRQL KeRaiseIrqlToDpcLevel(void);
+FORT_API void KeLowerIrql(KIRQL newIrql);
+
+#define ALL_PROCESSOR_GROUPS 0xffff
+FORT_API ULONG KeQueryMaximumProcessorCountEx(USHORT groupNumber);
+FORT_API ULONG KeGetCurrentProcessorIndex(void);
+FORT_API NTSTATUS KeGetProcessorNumberFromIndex(ULONG procIndex, PPROCESSOR_NUMBER procNumber);
+FORT_API KAFFINITY KeQueryGroupAffinity(USHORT groupNumber);
+FORT_API USHORT KeQueryHighestNodeNumber(void);
+FORT_API USHORT KeGetCurrentNodeNumber(void);
+FORT_API void KeSetSystemGroupAffinityThread(
+        PGROUP_AFFINITY affinity, PGROUP_AFFINITY previousAffinity);
+FORT_API void KeRevertToUserGroupAffinityThread(PGROUP_AFFINITY previousAffinity);
 
 #define IO_NO_INCREMENT 0
 FORT_API void IoCompleteRequest(PIRP irp, CCHAR priorityBoost);
@@ -401,6 +483,8 @@ FORT_API void RtlTimeToTimeFields(PLARGE_INTEGER time, PTIME_FIELDS timeFields);
 
 FORT_API NTSTATUS RtlGetVersion(PRTL_OSVERSIONINFOW versionInformation);
 
+FORT_API NTSTATUS RtlULongAdd(ULONG augend, ULONG addend, ULONG *result);
+
 FORT_API NTSTATUS ZwOpenKey(
         PHANDLE keyHandle, ACCESS_MASK desiredAccess, POBJECT_ATTRIBUTES objectAttributes);
 FORT_API NTSTATUS ZwClose(HANDLE handle);
@@ -440,6 +524,8 @@ FORT_API NTSTATUS MmCopyVirtualMemory(PEPROCESS sourceProcess, PVOID sourceAddre
         KPROCESSOR_MODE previousMode, PSIZE_T returnSize);
 
 extern POBJECT_TYPE *PsProcessType;
+extern POBJECT_TYPE *ExEventObjectType;
+extern POBJECT_TYPE *IoFileObjectType;
 
 FORT_API NTSTATUS ObReferenceObjectByHandle(HANDLE handle, ACCESS_MASK desiredAccess,
         POBJECT_TYPE objectType, KPROCESSOR_MODE accessMode, PVOID *object,
@@ -18,6 +18,9 @@ protected:
 
     MOCK_CONST_METHOD0(quotaMonthAlerted, qint32());
     MOCK_METHOD1(setQuotaMonthAlerted, void(qint32 v));
+
+    MOCK_METHOD4(writeDriverQuota,
+            void(qint64 dayBytes, qint64 monthBytes, quint8 setBits, quint8 alertedBits));
 };
 
 #endif // MOCKQUOTAMANAGER_H
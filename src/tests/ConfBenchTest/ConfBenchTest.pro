@@ -0,0 +1,7 @@
+include(../Common/Common.pri)
+
+HEADERS += \
+    tst_confbench.h
+
+SOURCES += \
+    tst_main.cpp
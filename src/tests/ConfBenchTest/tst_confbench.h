@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <QDebug>
+#include <QRandomGenerator>
+
+#include <googletest.h>
+
+#include <common/fortconf.h>
+
+#include <conf/addressgroup.h>
+#include <conf/appgroup.h>
+#include <conf/firewallconf.h>
+#include <driver/drivercommon.h>
+#include <manager/envmanager.h>
+#include <util/classhelpers.h>
+#include <util/conf/confutil.h>
+#include <util/fileutil.h>
+#include <util/net/netutil.h>
+
+#ifdef Q_OS_WIN
+#    include <qt_windows.h>
+#endif
+
+#if defined(Q_CC_MSVC)
+#    include <intrin.h>
+#elif defined(Q_PROCESSOR_X86)
+#    include <x86intrin.h>
+#endif
+
+namespace {
+
+constexpr int benchBatchSize = 64;
+constexpr int benchBatchesMin = 32;
+constexpr qint64 benchDurationNsec = 200 * 1000 * 1000;
+
+struct BenchResult
+{
+    double opsPerSec = 0;
+    qint64 p99Nsec = 0; // per operation, averaged over a batch
+    quint64 cycles = 0; // per operation, of the TSC
+};
+
+quint64 cpuCycles()
+{
+#if defined(Q_PROCESSOR_X86)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+// Time the batches of operations until the duration ends
+template<typename Op>
+BenchResult runBench(int keysCount, Op op)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<qint64> batchNsecs;
+    qint64 totalNsec = 0;
+    int keyIndex = 0;
+
+    const quint64 beginCycles = cpuCycles();
+
+    while (totalNsec < benchDurationNsec || int(batchNsecs.size()) < benchBatchesMin) {
+        const auto begin = Clock::now();
+
+        for (int i = 0; i < benchBatchSize; ++i) {
+            op(keyIndex);
+
+            if (++keyIndex == keysCount) {
+                keyIndex = 0;
+            }
+        }
+
+        const qint64 nsec =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+
+        batchNsecs.push_back(nsec);
+        totalNsec += nsec;
+    }
+
+    const quint64 totalCycles = cpuCycles() - beginCycles;
+
+    std::sort(batchNsecs.begin(), batchNsecs.end());
+
+    const qint64 opsCount = qint64(batchNsecs.size()) * benchBatchSize;
+
+    BenchResult res;
+    res.opsPerSec = double(opsCount) * 1e9 / double(std::max<qint64>(totalNsec, 1));
+    res.p99Nsec = batchNsecs[batchNsecs.size() * 99 / 100] / benchBatchSize;
+    res.cycles = totalCycles / quint64(opsCount);
+    return res;
+}
+
+void printBench(const char *name, int confSize, const BenchResult &res)
+{
+    qDebug().noquote() << QString("%1 [%2]: %3 ops/sec, p99 %4 nsec, %5 cycles")
+                                  .arg(name)
+                                  .arg(confSize)
+                                  .arg(qint64(res.opsPerSec))
+                                  .arg(res.p99Nsec)
+                                  .arg(res.cycles);
+}
+
+// Like the driver's conf blob in the large pages, needs the "Lock pages in memory" privilege
+class LargePageBuffer
+{
+public:
+    explicit LargePageBuffer(const QByteArray &buf);
+    ~LargePageBuffer();
+    CLASS_DELETE_COPY_MOVE(LargePageBuffer)
+
+    const char *data() const { return m_data; }
+
+private:
+    char *m_data = nullptr;
+};
+
+LargePageBuffer::LargePageBuffer(const QByteArray &buf)
+{
+#ifdef Q_OS_WIN
+    const SIZE_T pageSize = GetLargePageMinimum();
+    if (pageSize == 0)
+        return;
+
+    const SIZE_T size = (SIZE_T(buf.size()) + pageSize - 1) & ~(pageSize - 1);
+
+    m_data = (char *) VirtualAlloc(
+            nullptr, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (m_data) {
+        memcpy(m_data, buf.constData(), buf.size());
+    }
+#else
+    Q_UNUSED(buf);
+#endif
+}
+
+LargePageBuffer::~LargePageBuffer()
+{
+#ifdef Q_OS_WIN
+    if (m_data) {
+        VirtualFree(m_data, 0, MEM_RELEASE);
+    }
+#endif
+}
+
+QString kernelPathLower(const QString &path)
+{
+    return FileUtil::pathToKernelPath(path).toLower();
+}
+
+}
+
+class ConfBenchTest : public Test
+{
+    // Test interface
+protected:
+    void SetUp();
+    void TearDown();
+
+    static bool writeConf(FirewallConf &conf, QByteArray &buf);
+
+    static void writeIpConf(int addrCount, std::vector<quint32> &ips, QByteArray &buf);
+
+    static void benchApps(const char *name, int appsCount, const QString &appText,
+            const QString &pathText);
+};
+
+void ConfBenchTest::SetUp() { }
+
+void ConfBenchTest::TearDown() { }
+
+bool ConfBenchTest::writeConf(FirewallConf &conf, QByteArray &buf)
+{
+    EnvManager envManager;
+
+    conf.resetEdited(true);
+    conf.prepareToSave();
+
+    ConfUtil confUtil;
+
+    return confUtil.write(conf, nullptr, envManager, buf) != 0;
+}
+
+void ConfBenchTest::writeIpConf(int addrCount, std::vector<quint32> &ips, QByteArray &buf)
+{
+    QRandomGenerator rand(addrCount);
+
+    ips.reserve(addrCount * 2);
+
+    QString includeText;
+    includeText.reserve(addrCount * 16);
+
+    for (int i = 0; i < addrCount; ++i) {
+        const quint32 ip = rand.generate();
+
+        ips.push_back(ip);
+        includeText += NetUtil::ip4ToText(ip) + '\n';
+    }
+
+    // Most of the random addresses are not found
+    for (int i = 0; i < addrCount; ++i) {
+        ips.push_back(rand.generate());
+    }
+    std::shuffle(ips.begin(), ips.end(), rand);
+
+    FirewallConf conf;
+
+    AddressGroup *inetGroup = conf.inetAddressGroup();
+    inetGroup->setIncludeAll(false);
+    inetGroup->setExcludeAll(false);
+    inetGroup->setIncludeText(includeText);
+    inetGroup->setExcludeText(QString());
+
+    AppGroup *appGroup = new AppGroup();
+    appGroup->setName("Base");
+    conf.addAppGroup(appGroup);
+
+    ASSERT_TRUE(writeConf(conf, buf));
+}
+
+void ConfBenchTest::benchApps(
+        const char *name, int appsCount, const QString &appText, const QString &pathText)
+{
+    FirewallConf conf;
+
+    QString allowText;
+    for (int i = 0; i < appsCount; ++i) {
+        allowText += appText.arg(i) + '\n';
+    }
+
+    AppGroup *appGroup = new AppGroup();
+    appGroup->setName("Bench");
+    appGroup->setAllowText(allowText);
+    conf.addAppGroup(appGroup);
+
+    QByteArray buf;
+    ASSERT_TRUE(writeConf(conf, buf));
+
+    const PFORT_CONF drvConf = (const PFORT_CONF) (buf.constData() + DriverCommon::confIoConfOff());
+
+    // The found and not found paths alternate
+    QStringList paths;
+    for (int i = 0; i < appsCount; ++i) {
+        paths.append(kernelPathLower(pathText.arg(i)));
+        paths.append(kernelPathLower(pathText.arg(appsCount + i)));
+    }
+
+    std::vector<FORT_APP_FLAGS> foundFlags;
+
+    const auto findRes = runBench(paths.size(), [&](int i) {
+        const QString &path = paths[i];
+
+        const FORT_APP_ENTRY app_data = fort_conf_app_find(drvConf, (const PVOID) path.utf16(),
+                path.size() * sizeof(WCHAR), fort_conf_app_exe_find, /*exe_context=*/nullptr);
+
+        if (foundFlags.size() < size_t(appsCount) && app_data.flags.found) {
+            foundFlags.push_back(app_data.flags);
+        }
+    });
+    printBench(name, appsCount, findRes);
+
+    ASSERT_FALSE(foundFlags.empty());
+
+    const auto blockedRes = runBench(int(foundFlags.size()), [&](int i) {
+        INT8 block_reason = FORT_BLOCK_REASON_UNKNOWN;
+        fort_conf_app_blocked(drvConf, foundFlags[i], &block_reason);
+    });
+    printBench("app_blocked", appsCount, blockedRes);
+}
+
+TEST_F(ConfBenchTest, ipIncluded)
+{
+    const int addrCounts[] = { 1000, 10000, 100000, 1000000 };
+
+    for (const int addrCount : addrCounts) {
+        std::vector<quint32> ips;
+        QByteArray buf;
+        ASSERT_NO_FATAL_FAILURE(writeIpConf(addrCount, ips, buf));
+
+        const PFORT_CONF drvConf =
+                (const PFORT_CONF) (buf.constData() + DriverCommon::confIoConfOff());
+
+        const auto res = runBench(int(ips.size()), [&](int i) {
+            fort_conf_ip_is_inet(drvConf, /*zone_func=*/nullptr, /*ctx=*/nullptr, &ips[i],
+                    /*isIPv6=*/FALSE);
+        });
+        printBench("ip_included", addrCount, res);
+    }
+}
+
+TEST_F(ConfBenchTest, ipIncludedLargePages)
+{
+    const int addrCounts[] = { 100000, 1000000 };
+
+    for (const int addrCount : addrCounts) {
+        std::vector<quint32> ips;
+        QByteArray buf;
+        ASSERT_NO_FATAL_FAILURE(writeIpConf(addrCount, ips, buf));
+
+        const LargePageBuffer largeBuf(buf);
+        if (!largeBuf.data()) {
+            GTEST_SKIP() << "No large pages";
+        }
+
+        const PFORT_CONF drvConf =
+                (const PFORT_CONF) (buf.constData() + DriverCommon::confIoConfOff());
+        const PFORT_CONF largeConf =
+                (const PFORT_CONF) (largeBuf.data() + DriverCommon::confIoConfOff());
+
+        const auto res = runBench(int(ips.size()), [&](int i) {
+            fort_conf_ip_is_inet(drvConf, /*zone_func=*/nullptr, /*ctx=*/nullptr, &ips[i],
+                    /*isIPv6=*/FALSE);
+        });
+        printBench("ip_included_small_pages", addrCount, res);
+
+        const auto largeRes = runBench(int(ips.size()), [&](int i) {
+            fort_conf_ip_is_inet(largeConf, /*zone_func=*/nullptr, /*ctx=*/nullptr, &ips[i],
+                    /*isIPv6=*/FALSE);
+        });
+        printBench("ip_included_large_pages", addrCount, largeRes);
+    }
+}
+
+TEST_F(ConfBenchTest, appFind)
+{
+    const int appsCounts[] = { 1000, 10000, 100000 };
+
+    for (const int appsCount : appsCounts) {
+        benchApps("app_find_exe", appsCount, "C:\\Bench\\App%1\\app.exe",
+                "C:\\Bench\\App%1\\app.exe");
+        benchApps("app_find_wild", appsCount, "C:\\Bench\\Wild%1\\*\\app.exe",
+                "C:\\Bench\\Wild%1\\bin\\app.exe");
+        benchApps("app_find_prefix", appsCount, "C:\\Bench\\Prefix%1\\**",
+                "C:\\Bench\\Prefix%1\\bin\\app.exe");
+    }
+}
@@ -2,12 +2,20 @@ TEMPLATE = subdirs
 
 SUBDIRS = \
     Common \
+    ConfBenchTest \
+    LogBenchTest \
     LogBufferTest \
     LogReaderTest \
+    PipelineBenchTest \
+    RpcBenchTest \
     StatTest \
     UtilTest
 
+ConfBenchTest.depends = Common
+LogBenchTest.depends = Common
 LogBufferTest.depends = Common
 LogReaderTest.depends = Common
+PipelineBenchTest.depends = Common
+RpcBenchTest.depends = Common
 StatTest.depends = Common
 UtilTest.depends = Common
@@ -0,0 +1,7 @@
+include(../Common/Common.pri)
+
+HEADERS += \
+    tst_logbench.h
+
+SOURCES += \
+    tst_main.cpp
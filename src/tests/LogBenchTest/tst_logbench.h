@@ -0,0 +1,269 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+
+#include <QDebug>
+
+#include <googletest.h>
+
+#include <driver/drivercommon.h>
+#include <log/logbuffer.h>
+#include <log/logentryblocked.h>
+#include <log/logentryblockedip.h>
+#include <log/logentryprocnew.h>
+#include <log/logentrystattraf.h>
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#    include <crtdbg.h>
+#    define LOG_BENCH_COUNT_ALLOCS
+#endif
+
+namespace {
+
+constexpr int benchChunkSize = 16 * 1024; // of the driver's log buffer
+constexpr qint64 benchDurationNsec = 200 * 1000 * 1000;
+
+constexpr quint16 benchStatProcCount = 1000;
+
+std::atomic<qint64> g_allocCount { 0 };
+
+#ifdef LOG_BENCH_COUNT_ALLOCS
+int countAllocHook(int allocType, void * /*userData*/, size_t /*size*/, int /*blockType*/,
+        long /*requestNumber*/, const unsigned char * /*fileName*/, int /*lineNumber*/)
+{
+    if (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC) {
+        ++g_allocCount;
+    }
+    return TRUE;
+}
+#endif
+
+struct BenchResult
+{
+    double recordsPerSec = 0;
+    double allocsPerRecord = -1; // not counted
+};
+
+// Read the chunk by the passes until the duration ends
+template<typename ReadRecords>
+BenchResult runBench(LogBuffer &buf, ReadRecords readRecords)
+{
+    using Clock = std::chrono::steady_clock;
+
+    const int top = buf.top();
+
+    qint64 totalNsec = 0;
+    qint64 recordsCount = 0;
+
+#ifdef LOG_BENCH_COUNT_ALLOCS
+    _CRT_ALLOC_HOOK oldHook = _CrtSetAllocHook(countAllocHook);
+#endif
+    const qint64 allocCount = g_allocCount;
+
+    while (totalNsec < benchDurationNsec) {
+        buf.reset(top);
+
+        const auto begin = Clock::now();
+
+        recordsCount += readRecords(buf);
+
+        totalNsec +=
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+    }
+
+    const qint64 allocsCount = g_allocCount - allocCount;
+#ifdef LOG_BENCH_COUNT_ALLOCS
+    _CrtSetAllocHook(oldHook);
+#endif
+
+    BenchResult res;
+    res.recordsPerSec = double(recordsCount) * 1e9 / double(std::max<qint64>(totalNsec, 1));
+#ifdef LOG_BENCH_COUNT_ALLOCS
+    res.allocsPerRecord = double(allocsCount) / double(std::max<qint64>(recordsCount, 1));
+#else
+    Q_UNUSED(allocsCount);
+#endif
+    return res;
+}
+
+void printBench(const char *name, int chunkBytes, const BenchResult &res)
+{
+    const QString allocs = (res.allocsPerRecord < 0) ? QString("n/a (debug MSVC only)")
+                                                     : QString::number(res.allocsPerRecord, 'f', 2);
+
+    qDebug().noquote() << QString("%1 [%2 bytes]: %3 records/sec, %4 allocs/record")
+                                  .arg(name)
+                                  .arg(chunkBytes)
+                                  .arg(qint64(res.recordsPerSec))
+                                  .arg(allocs);
+}
+
+// Like the service's LogManager::processLogEntry(), without the entries' consumers
+int readLogEntries(LogBuffer &buf)
+{
+    int count = 0;
+
+    for (;;) {
+        switch (buf.peekEntryType()) {
+        case FORT_LOG_TYPE_BLOCKED:
+        case FORT_LOG_TYPE_ALLOWED: {
+            LogEntryBlocked entry;
+            buf.readEntryBlocked(&entry);
+        } break;
+        case FORT_LOG_TYPE_BLOCKED_IP: {
+            LogEntryBlockedIp entry;
+            buf.readEntryBlockedIp(&entry);
+        } break;
+        case FORT_LOG_TYPE_PROC_NEW: {
+            LogEntryProcNew entry;
+            buf.readEntryProcNew(&entry);
+        } break;
+        case FORT_LOG_TYPE_STAT_TRAF: {
+            LogEntryStatTraf entry;
+            buf.readEntryStatTraf(&entry);
+
+            // Each process is a record, as by the StatManager
+            for (int i = 0; i < entry.procCount(); ++i) {
+                quint32 pidFlag;
+                quint64 inBytes, outBytes;
+                entry.procTraf(i, pidFlag, inBytes, outBytes);
+            }
+            count += entry.procCount() - 1;
+        } break;
+        default:
+            return count;
+        }
+
+        ++count;
+    }
+}
+
+QString longKernelPath(int i)
+{
+    return QString(R"(\device\harddiskvolume3\program files\windowsapps\)"
+                   R"(microsoft.windowscommunicationsapps_16005.14326.21514.0_x64__8wekyb3d8bbwe\)"
+                   R"(hxtsr%1.exe)")
+            .arg(i);
+}
+
+// Fill the chunk by the repeated entries' mix
+template<typename WriteEntries>
+void fillChunk(LogBuffer &buf, int entrySizeMax, WriteEntries writeEntries)
+{
+    buf.reset();
+
+    for (int i = 0; buf.top() + entrySizeMax <= benchChunkSize; ++i) {
+        writeEntries(buf, i);
+    }
+}
+
+}
+
+class LogBenchTest : public Test
+{
+    // Test interface
+protected:
+    void SetUp();
+    void TearDown();
+};
+
+void LogBenchTest::SetUp() { }
+
+void LogBenchTest::TearDown() { }
+
+TEST_F(LogBenchTest, blockedIpMix)
+{
+    const int pathSize = longKernelPath(0).size() + 4;
+    const int entrySizeMax = int(DriverCommon::logBlockedIpSize(pathSize * sizeof(wchar_t), true)
+            + DriverCommon::logProcNewSize(pathSize * sizeof(wchar_t)));
+
+    LogBuffer buf(benchChunkSize);
+
+    // The IPv4 & IPv6 connections of the apps with the long paths, with their new processes
+    fillChunk(buf, entrySizeMax, [](LogBuffer &buf, int i) {
+        const QString path = longKernelPath(i);
+
+        LogEntryBlockedIp entry;
+        entry.setKernelPath(path);
+        entry.setIsIPv6((i & 1) != 0);
+        entry.setInbound((i % 3) == 0);
+        entry.setBlockReason(FORT_BLOCK_REASON_PROGRAM);
+        entry.setIpProto(6);
+        entry.setLocalPort(49152 + i);
+        entry.setRemotePort(443);
+        entry.setPid(1000 + i);
+
+        if (entry.isIPv6()) {
+            entry.localIp().v6.addr32[0] = 0xfe80;
+            entry.localIp().v6.addr32[3] = quint32(i);
+            entry.remoteIp().v6.addr32[0] = 0x2001;
+            entry.remoteIp().v6.addr32[3] = quint32(i);
+        } else {
+            entry.setLocalIp4(0xC0A80001 + i);
+            entry.setRemoteIp4(0x08080808 + i);
+        }
+
+        buf.writeEntryBlockedIp(&entry);
+
+        if ((i % 4) == 0) {
+            const LogEntryProcNew procEntry(1000 + i, path);
+            buf.writeEntryProcNew(&procEntry);
+        }
+    });
+
+    ASSERT_GT(readLogEntries(buf), 0);
+    ASSERT_EQ(buf.offset(), buf.top());
+
+    printBench("blockedIpMix", buf.top(), runBench(buf, readLogEntries));
+}
+
+TEST_F(LogBenchTest, blockedShortPaths)
+{
+    const QString path(R"(\device\harddiskvolume3\windows\system32\svchost.exe)");
+
+    const int entrySizeMax =
+            int(DriverCommon::logBlockedHeaderSize() + path.size() * sizeof(wchar_t));
+
+    LogBuffer buf(benchChunkSize);
+
+    fillChunk(buf, entrySizeMax, [&](LogBuffer &buf, int i) {
+        const LogEntryBlocked entry(1000 + i, path);
+        buf.writeEntryBlocked(&entry);
+    });
+
+    ASSERT_GT(readLogEntries(buf), 0);
+    ASSERT_EQ(buf.offset(), buf.top());
+
+    printBench("blockedShortPaths", buf.top(), runBench(buf, readLogEntries));
+}
+
+TEST_F(LogBenchTest, statTrafBurst)
+{
+    const int entrySize = int(
+            DriverCommon::logStatSize(benchStatProcCount, /*compact=*/true, /*conns=*/true));
+    ASSERT_LE(entrySize, benchChunkSize);
+
+    LogBuffer buf(benchChunkSize);
+
+    // The traffic of many processes at once
+    char *output = buf.array().data();
+
+    DriverCommon::logStatTrafHeaderWrite(output, benchStatProcCount, /*compact=*/1, /*conns=*/1);
+    output += DriverCommon::logStatHeaderSize();
+
+    quint32 *procTraf = reinterpret_cast<quint32 *>(output);
+    for (int i = 0; i < benchStatProcCount; ++i) {
+        *procTraf++ = 1000 + 4 * i; // pid
+        *procTraf++ = 1500 * (i + 1); // in bytes
+        *procTraf++ = 100 * (i + 1); // out bytes
+        *procTraf++ = 1 | (1 << 16); // conns | blocked
+    }
+
+    buf.reset(entrySize);
+
+    ASSERT_EQ(readLogEntries(buf), benchStatProcCount);
+    ASSERT_EQ(buf.offset(), entrySize);
+
+    printBench("statTrafBurst", entrySize, runBench(buf, readLogEntries));
+}
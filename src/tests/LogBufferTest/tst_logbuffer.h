@@ -8,6 +8,9 @@
 #include <log/logbuffer.h>
 #include <log/logentryblocked.h>
 #include <log/logentryblockedip.h>
+#include <log/logentryflowstat.h>
+#include <log/logentryshaperstat.h>
+#include <log/logentrystattraf.h>
 #include <log/logentrytime.h>
 #include <util/dateutil.h>
 
@@ -110,6 +113,148 @@ TEST_F(LogBufferTest, blockedIpWriteRead)
     ASSERT_EQ(index, testCount);
 }
 
+TEST_F(LogBufferTest, flowStatRead)
+{
+    const quint16 flowCount = 3;
+
+    const int entrySize = DriverCommon::logFlowStatSize(flowCount);
+    ASSERT_EQ(entrySize,
+            DriverCommon::logFlowStatHeaderSize()
+                    + flowCount * DriverCommon::logFlowStatEntrySize());
+
+    LogBuffer buf(entrySize);
+
+    // Write
+    char *output = buf.array().data();
+
+    DriverCommon::logFlowStatHeaderWrite(output, flowCount);
+    output += DriverCommon::logFlowStatHeaderSize();
+
+    for (int i = 0; i < flowCount; ++i) {
+        ip_addr_t remoteIp {};
+        remoteIp.v4 = 0x01020304 + i;
+
+        const quint64 traf[4] = { 0x100000000ULL + i, 2, 3, 4 };
+
+        DriverCommon::logFlowStatWrite(output, /*isIPv6=*/false, /*inbound=*/(i & 1) != 0,
+                /*ipProto=*/6, /*localPort=*/1000 + i, /*remotePort=*/443, &remoteIp,
+                /*pid=*/100 + i, traf);
+        output += DriverCommon::logFlowStatEntrySize();
+    }
+
+    buf.reset(entrySize);
+
+    // Read
+    ASSERT_EQ(buf.peekEntryType(), FORT_LOG_TYPE_FLOW_STAT);
+
+    LogEntryFlowStat entry;
+    buf.readEntryFlowStat(&entry);
+    ASSERT_EQ(entry.flowCount(), flowCount);
+    ASSERT_EQ(buf.offset(), entrySize);
+
+    for (int i = 0; i < flowCount; ++i) {
+        const FlowTraf flowTraf = entry.flowTraf(i);
+
+        ASSERT_FALSE(flowTraf.isIPv6);
+        ASSERT_EQ(flowTraf.inbound, (i & 1) != 0);
+        ASSERT_EQ(flowTraf.ipProto, 6);
+        ASSERT_EQ(flowTraf.localPort, 1000 + i);
+        ASSERT_EQ(flowTraf.remotePort, 443);
+        ASSERT_EQ(flowTraf.remoteIp.v4, 0x01020304 + i);
+        ASSERT_EQ(flowTraf.pid, 100 + i);
+        ASSERT_EQ(flowTraf.inBytes, 0x100000000ULL + i);
+        ASSERT_EQ(flowTraf.outBytes, 2);
+        ASSERT_EQ(flowTraf.inPackets, 3);
+        ASSERT_EQ(flowTraf.outPackets, 4);
+    }
+}
+
+TEST_F(LogBufferTest, shaperStatRead)
+{
+    const int entrySize = DriverCommon::logShaperStatSize();
+
+    LogBuffer buf(entrySize);
+
+    // Write
+    const quint64 bytes[3] = { 1500, 0x100000000ULL, 3000 };
+    const quint32 packets[2] = { 100, 2 };
+
+    DriverCommon::logShaperStatWrite(buf.array().data(), /*queueIndex=*/5,
+            /*sojournMaxMsecs=*/40, bytes, packets);
+
+    buf.reset(entrySize);
+
+    // Read
+    ASSERT_EQ(buf.peekEntryType(), FORT_LOG_TYPE_SHAPER_STAT);
+
+    LogEntryShaperStat entry;
+    buf.readEntryShaperStat(&entry);
+    ASSERT_EQ(buf.offset(), entrySize);
+
+    const ShaperStat &shaperStat = entry.shaperStat();
+
+    ASSERT_EQ(shaperStat.groupIndex(), 2);
+    ASSERT_FALSE(shaperStat.inbound());
+    ASSERT_EQ(shaperStat.sojournMaxMsecs, 40);
+    ASSERT_EQ(shaperStat.queuedBytes, 1500);
+    ASSERT_EQ(shaperStat.passedBytes, 0x100000000ULL);
+    ASSERT_EQ(shaperStat.droppedBytes, 3000);
+    ASSERT_EQ(shaperStat.passedPackets, 100);
+    ASSERT_EQ(shaperStat.droppedPackets, 2);
+}
+
+TEST_F(LogBufferTest, statTrafConnsRead)
+{
+    const quint16 procCount = 2;
+
+    const int entrySize = DriverCommon::logStatSize(procCount, /*compact=*/true, /*conns=*/true);
+    ASSERT_EQ(entrySize, DriverCommon::logStatHeaderSize() + procCount * 4 * sizeof(quint32));
+
+    LogBuffer buf(entrySize);
+
+    // Write
+    char *output = buf.array().data();
+
+    DriverCommon::logStatTrafHeaderWrite(output, procCount, /*compact=*/1, /*conns=*/1);
+    output += DriverCommon::logStatHeaderSize();
+
+    quint32 *procTraf = reinterpret_cast<quint32 *>(output);
+    for (int i = 0; i < procCount; ++i) {
+        *procTraf++ = 100 + 4 * i; // pid
+        *procTraf++ = 10 + i; // in bytes
+        *procTraf++ = 20 + i; // out bytes
+        *procTraf++ = (30 + i) | ((40 + i) << 16); // conns | blocked
+    }
+
+    buf.reset(entrySize);
+
+    // Read
+    ASSERT_EQ(buf.peekEntryType(), FORT_LOG_TYPE_STAT_TRAF);
+
+    LogEntryStatTraf entry;
+    buf.readEntryStatTraf(&entry);
+    ASSERT_EQ(entry.procCount(), procCount);
+    ASSERT_TRUE(entry.compact());
+    ASSERT_TRUE(entry.conns());
+    ASSERT_EQ(buf.offset(), entrySize);
+
+    for (int i = 0; i < procCount; ++i) {
+        quint32 pidFlag;
+        quint64 inBytes, outBytes;
+        entry.procTraf(i, pidFlag, inBytes, outBytes);
+
+        ASSERT_EQ(pidFlag, 100 + 4 * i);
+        ASSERT_EQ(inBytes, 10 + i);
+        ASSERT_EQ(outBytes, 20 + i);
+
+        quint16 connCount, blockedCount;
+        entry.procConns(i, connCount, blockedCount);
+
+        ASSERT_EQ(connCount, 30 + i);
+        ASSERT_EQ(blockedCount, 40 + i);
+    }
+}
+
 TEST_F(LogBufferTest, timeWriteRead)
 {
     const int entrySize = DriverCommon::logTimeSize();
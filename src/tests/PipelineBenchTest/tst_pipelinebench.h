@@ -0,0 +1,528 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QMutex>
+#include <QQueue>
+#include <QTemporaryDir>
+
+#include <googletest.h>
+
+#include <conf/firewallconf.h>
+#include <driver/drivercommon.h>
+#include <log/logbuffer.h>
+#include <log/logentryblockedip.h>
+#include <log/logentryprocnew.h>
+#include <log/logentrystattraf.h>
+#include <stat/quotamanager.h>
+#include <stat/statblockmanager.h>
+#include <stat/statmanager.h>
+#include <util/ioc/ioccontainer.h>
+
+#include <mocks/mockquotamanager.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int benchChunkSize = 16 * 1024; // of the driver's log buffer
+constexpr int benchPendingChunksMax = 64; // of the driver's buffer limit
+constexpr qint64 benchDurationMsecs = 2000;
+constexpr qint64 benchSampleMsecs = 50;
+
+constexpr int benchAppsCount = 200;
+constexpr int benchProcNewPerChunk = 4;
+constexpr int benchActiveProcsCount = 50; // of the chunk's STAT_TRAF record, after the exits
+
+// Offered events per second
+const int benchOfferedRates[] = { 10000, 50000, 200000 };
+
+qint64 elapsedNsec(Clock::time_point begin, Clock::time_point end = Clock::now())
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count();
+}
+
+qint64 percentile(std::vector<qint64> &v, int percent)
+{
+    if (v.empty())
+        return 0;
+
+    std::sort(v.begin(), v.end());
+
+    return v[std::min(v.size() - 1, v.size() * percent / 100)];
+}
+
+// Least squares slope of the samples: per second
+double slopePerSec(const std::vector<std::pair<qint64, qint64>> &samples)
+{
+    const int n = int(samples.size());
+    if (n < 2)
+        return 0;
+
+    double sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    for (const auto &[nsec, value] : samples) {
+        const double x = double(nsec) / 1e9;
+        const double y = double(value);
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+    }
+
+    const double d = n * sumXX - sumX * sumX;
+
+    return (d != 0) ? (n * sumXY - sumX * sumY) / d : 0;
+}
+
+struct BenchChunk
+{
+    QByteArray data;
+    int statTop = 0; // the stat records are first
+    int eventsCount = 0;
+    int blockedIpCount = 0;
+    Clock::time_point producedTime;
+};
+
+// The driver's side: fills the log buffer's chunks by the offered rate
+class BenchProducer
+{
+public:
+    explicit BenchProducer(int offeredRate) : m_offeredRate(offeredRate) { }
+
+    qint64 offeredEvents() const { return m_offeredEvents; }
+    qint64 droppedEvents() const { return m_droppedEvents; }
+    qint64 writeNsec() const { return m_writeNsec; }
+
+    bool isDone() const { return m_done; }
+    qint64 producedEvents() const { return m_producedEvents; }
+
+    bool takeChunk(BenchChunk &chunk)
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (m_chunks.isEmpty())
+            return false;
+
+        chunk = m_chunks.dequeue();
+        return true;
+    }
+
+    void run(Clock::time_point startTime)
+    {
+        while (elapsedNsec(startTime) < benchDurationMsecs * 1000 * 1000) {
+            const qint64 targetEvents = elapsedNsec(startTime) * m_offeredRate / 1000000000LL;
+
+            if (m_offeredEvents >= targetEvents) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            const auto writeBegin = Clock::now();
+
+            BenchChunk chunk = writeChunk();
+
+            m_writeNsec += elapsedNsec(writeBegin);
+            m_offeredEvents += chunk.eventsCount;
+
+            pushChunk(chunk);
+        }
+
+        m_done = true;
+    }
+
+private:
+    // The buffer's limit is exceeded only by the stat records, as by the driver
+    void pushChunk(BenchChunk &chunk)
+    {
+        QMutexLocker locker(&m_mutex);
+
+        if (m_chunks.size() >= benchPendingChunksMax) {
+            m_droppedEvents += chunk.blockedIpCount;
+
+            chunk.data.truncate(chunk.statTop);
+            chunk.eventsCount -= chunk.blockedIpCount;
+            chunk.blockedIpCount = 0;
+        }
+
+        m_chunks.enqueue(chunk);
+        m_producedEvents += chunk.eventsCount;
+    }
+
+    static QString appKernelPath(quint32 pid)
+    {
+        return QString("C:\\bench\\app%1.exe").arg(pid % benchAppsCount);
+    }
+
+    // The new processes, the active processes' traffic & their blocked connections
+    BenchChunk writeChunk()
+    {
+        BenchChunk chunk;
+
+        LogBuffer buf(benchChunkSize);
+
+        for (int i = 0; i < benchProcNewPerChunk; ++i) {
+            const quint32 pid = nextPid();
+
+            const LogEntryProcNew entry(pid, appKernelPath(pid));
+            buf.writeEntryProcNew(&entry);
+
+            m_activePids.push_back(pid);
+        }
+        chunk.eventsCount += benchProcNewPerChunk;
+
+        chunk.eventsCount += writeStatTraf(buf);
+        chunk.statTop = buf.top();
+
+        const int blockedIpSizeMax = int(DriverCommon::logBlockedIpSize(
+                appKernelPath(0).size() * sizeof(wchar_t) + 8, /*isIPv6=*/false));
+
+        for (int i = 0; buf.top() + blockedIpSizeMax <= benchChunkSize; ++i) {
+            const quint32 pid = m_activePids[(m_seq + i) % m_activePids.size()];
+
+            LogEntryBlockedIp entry;
+            entry.setKernelPath(appKernelPath(pid));
+            entry.setBlockReason(FORT_BLOCK_REASON_PROGRAM);
+            entry.setIpProto(6);
+            entry.setLocalPort(49152 + (i & 0x3FFF));
+            entry.setRemotePort(443);
+            entry.setPid(pid);
+            entry.setLocalIp4(0xC0A80001);
+            entry.setRemoteIp4(0x08080808 + i);
+
+            buf.writeEntryBlockedIp(&entry);
+
+            ++chunk.blockedIpCount;
+        }
+        chunk.eventsCount += chunk.blockedIpCount;
+
+        chunk.data = buf.array().left(buf.top());
+        chunk.producedTime = Clock::now();
+
+        ++m_seq;
+
+        return chunk;
+    }
+
+    // The oldest processes over the active count exit by the record
+    int writeStatTraf(LogBuffer &buf)
+    {
+        const int procCount = int(m_activePids.size());
+        const int exitCount = std::max(0, procCount - benchActiveProcsCount);
+
+        char *output = buf.array().data() + buf.top();
+
+        DriverCommon::logStatTrafHeaderWrite(output, procCount, /*compact=*/1, /*conns=*/0);
+        output += DriverCommon::logStatHeaderSize();
+
+        quint32 *procTraf = reinterpret_cast<quint32 *>(output);
+        for (int i = 0; i < procCount; ++i) {
+            *procTraf++ = m_activePids[i] | (i < exitCount ? 1 : 0); // pid | inactive
+            *procTraf++ = 1500 * (i + 1); // in bytes
+            *procTraf++ = 100 * (i + 1); // out bytes
+        }
+
+        buf.reset(buf.top() + int(DriverCommon::logStatSize(procCount, /*compact=*/true)));
+
+        m_activePids.erase(m_activePids.begin(), m_activePids.begin() + exitCount);
+
+        return procCount;
+    }
+
+    quint32 nextPid() { return quint32(++m_pidSeq) * 4; }
+
+private:
+    const int m_offeredRate;
+
+    std::atomic<bool> m_done { false };
+
+    int m_seq = 0;
+    int m_pidSeq = 0;
+
+    qint64 m_offeredEvents = 0;
+    qint64 m_droppedEvents = 0;
+    qint64 m_writeNsec = 0;
+
+    std::atomic<qint64> m_producedEvents { 0 };
+
+    std::vector<quint32> m_activePids;
+
+    QMutex m_mutex;
+    QQueue<BenchChunk> m_chunks;
+};
+
+// The connections' DB without the conf's options
+class BenchStatBlockManager : public StatBlockManager
+{
+public:
+    using StatBlockManager::StatBlockManager;
+
+protected:
+    void setupConfManager() override { }
+};
+
+struct PipelineResult
+{
+    qint64 offeredEvents = 0;
+    qint64 droppedEvents = 0; // by the driver's buffer limit
+    qint64 consumedEvents = 0;
+
+    double sustainedEventsPerSec = 0;
+    double backlogEventsPerSec = 0; // growth rate of the not consumed events
+
+    double writeEventsPerSec = 0;
+    double dispatchEventsPerSec = 0;
+
+    qint64 readDelayP50Usec = 0;
+    qint64 readDelayP99Usec = 0;
+
+    qint64 dispatchP50Usec = 0;
+    qint64 dispatchP99Usec = 0;
+
+    WorkerQueueStats statQueue;
+    WorkerQueueStats blockQueue;
+
+    qint64 blockedIpDispatched = 0;
+    qint64 blockedIpPersisted = 0;
+
+    qint64 notifyLagP50Msecs = 0;
+    qint64 notifyLagMaxMsecs = 0;
+};
+
+// Like the service's LogManager::processLogEntry(), with the paths resolved by the driver
+void dispatchChunk(const BenchChunk &chunk, StatManager &statManager,
+        StatBlockManager &statBlockManager, qint64 unixTime)
+{
+    LogBuffer buf;
+    buf.setRawData(chunk.data.constData(), chunk.data.size());
+
+    while (buf.offset() < buf.top()) {
+        switch (buf.peekEntryType()) {
+        case FORT_LOG_TYPE_BLOCKED_IP: {
+            LogEntryBlockedIp entry;
+            buf.readEntryBlockedIp(&entry);
+            entry.setPath(entry.kernelPath());
+            entry.setConnTime(unixTime);
+
+            statBlockManager.logBlockedIp(entry);
+        } break;
+        case FORT_LOG_TYPE_PROC_NEW: {
+            LogEntryProcNew entry;
+            buf.readEntryProcNew(&entry);
+            entry.setPath(entry.kernelPath());
+
+            statManager.logProcNew(entry, unixTime);
+        } break;
+        case FORT_LOG_TYPE_STAT_TRAF: {
+            LogEntryStatTraf entry;
+            buf.readEntryStatTraf(&entry);
+
+            statManager.logStatTraf(entry, unixTime);
+        } break;
+        default:
+            FAIL() << "Unexpected log type at" << buf.offset();
+        }
+    }
+}
+
+PipelineResult runPipeline(int offeredRate, const QString &dirPath)
+{
+    IocContainer ioc;
+    ioc.pinToThread();
+
+    NiceMock<MockQuotaManager> quotaManager;
+    ioc.set<QuotaManager>(quotaManager);
+
+    FirewallConf conf;
+    conf.setLogStat(true);
+
+    StatManager statManager(dirPath + "/stat.db");
+    statManager.setConf(&conf);
+    statManager.setUp();
+
+    BenchStatBlockManager statBlockManager(dirPath + "/statblock.db");
+    statBlockManager.setUp();
+
+    PipelineResult res;
+
+    // The RPC's notifications of the persisted connections
+    std::vector<qint64> notifyLagMsecs;
+    Clock::time_point unnotifiedTime;
+    bool isUnnotified = false;
+
+    QObject::connect(&statBlockManager, &StatBlockManager::logBlockedIpFinished,
+            [&](int count, qint64 /*newConnId*/) { res.blockedIpPersisted += count; });
+    QObject::connect(&statBlockManager, &StatBlockManager::connChanged, [&] {
+        if (isUnnotified) {
+            isUnnotified = false;
+            notifyLagMsecs.push_back(elapsedNsec(unnotifiedTime) / 1000000);
+        }
+    });
+
+    BenchProducer producer(offeredRate);
+
+    const auto startTime = Clock::now();
+
+    std::thread producerThread([&] { producer.run(startTime); });
+
+    std::vector<qint64> readDelayNsecs;
+    std::vector<qint64> dispatchNsecs;
+    std::vector<std::pair<qint64, qint64>> backlogSamples;
+
+    qint64 dispatchTotalNsec = 0;
+    qint64 windowConsumedEvents = 0;
+    qint64 nextSampleNsec = 0;
+
+    // The service's event loop
+    for (;;) {
+        const qint64 nowNsec = elapsedNsec(startTime);
+
+        if (!producer.isDone() && nowNsec >= nextSampleNsec) {
+            nextSampleNsec = nowNsec + benchSampleMsecs * 1000 * 1000;
+            backlogSamples.emplace_back(nowNsec, producer.producedEvents() - res.consumedEvents);
+        }
+
+        const bool isProducerDone = producer.isDone();
+
+        BenchChunk chunk;
+        if (!producer.takeChunk(chunk)) {
+            if (isProducerDone)
+                break;
+
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 1);
+            continue;
+        }
+
+        const auto dispatchBegin = Clock::now();
+        readDelayNsecs.push_back(elapsedNsec(chunk.producedTime, dispatchBegin));
+
+        dispatchChunk(chunk, statManager, statBlockManager,
+                QDateTime::currentSecsSinceEpoch());
+
+        const qint64 dispatchNsec = elapsedNsec(dispatchBegin);
+        dispatchNsecs.push_back(dispatchNsec);
+        dispatchTotalNsec += dispatchNsec;
+
+        res.consumedEvents += chunk.eventsCount;
+        res.blockedIpDispatched += chunk.blockedIpCount;
+
+        if (!producer.isDone()) {
+            windowConsumedEvents += chunk.eventsCount;
+        }
+
+        if (!isUnnotified && chunk.blockedIpCount != 0) {
+            isUnnotified = true;
+            unnotifiedTime = chunk.producedTime;
+        }
+
+        QCoreApplication::processEvents();
+    }
+
+    producerThread.join();
+
+    // Wait for the pending jobs and their notifications
+    statBlockManager.finishWorkers();
+    statManager.tearDown();
+
+    QCoreApplication::processEvents();
+
+    res.offeredEvents = producer.offeredEvents();
+    res.droppedEvents = producer.droppedEvents();
+
+    res.sustainedEventsPerSec = double(windowConsumedEvents) * 1000 / double(benchDurationMsecs);
+    res.backlogEventsPerSec = slopePerSec(backlogSamples);
+
+    res.writeEventsPerSec = double(res.offeredEvents) * 1e9
+            / double(std::max<qint64>(producer.writeNsec(), 1));
+    res.dispatchEventsPerSec =
+            double(res.consumedEvents) * 1e9 / double(std::max<qint64>(dispatchTotalNsec, 1));
+
+    res.readDelayP50Usec = percentile(readDelayNsecs, 50) / 1000;
+    res.readDelayP99Usec = percentile(readDelayNsecs, 99) / 1000;
+
+    res.dispatchP50Usec = percentile(dispatchNsecs, 50) / 1000;
+    res.dispatchP99Usec = percentile(dispatchNsecs, 99) / 1000;
+
+    res.statQueue = statManager.queueStats();
+    res.blockQueue = statBlockManager.queueStats();
+
+    res.notifyLagP50Msecs = percentile(notifyLagMsecs, 50);
+    res.notifyLagMaxMsecs = percentile(notifyLagMsecs, 100);
+
+    return res;
+}
+
+qint64 avgWaitMsecs(const WorkerQueueStats &stats)
+{
+    return (stats.jobsCount != 0) ? stats.totalWaitMsecs / stats.jobsCount : 0;
+}
+
+void printPipeline(int offeredRate, const PipelineResult &res)
+{
+    qDebug().noquote() << QString("pipeline [%1 events/sec offered]: %2 events/sec sustained,"
+                                  " backlog %3 events/sec, %4 dropped of %5")
+                                  .arg(offeredRate)
+                                  .arg(qint64(res.sustainedEventsPerSec))
+                                  .arg(qint64(res.backlogEventsPerSec))
+                                  .arg(res.droppedEvents)
+                                  .arg(res.offeredEvents);
+
+    qDebug().noquote() << QString("  driver write: %1 events/sec")
+                                  .arg(qint64(res.writeEventsPerSec));
+    qDebug().noquote() << QString("  read queue: p50 %1 usec, p99 %2 usec")
+                                  .arg(res.readDelayP50Usec)
+                                  .arg(res.readDelayP99Usec);
+    qDebug().noquote() << QString("  dispatch: %1 events/sec, chunk p50 %2 usec, p99 %3 usec")
+                                  .arg(qint64(res.dispatchEventsPerSec))
+                                  .arg(res.dispatchP50Usec)
+                                  .arg(res.dispatchP99Usec);
+    qDebug().noquote() << QString("  traffic jobs: %1, wait avg %2 msec, max %3 msec")
+                                  .arg(res.statQueue.jobsCount)
+                                  .arg(avgWaitMsecs(res.statQueue))
+                                  .arg(res.statQueue.maxWaitMsecs);
+    qDebug().noquote() << QString("  blocked jobs: %1, wait avg %2 msec, max %3 msec,"
+                                  " %4 persisted of %5")
+                                  .arg(res.blockQueue.jobsCount)
+                                  .arg(avgWaitMsecs(res.blockQueue))
+                                  .arg(res.blockQueue.maxWaitMsecs)
+                                  .arg(res.blockedIpPersisted)
+                                  .arg(res.blockedIpDispatched);
+    qDebug().noquote() << QString("  notify lag: p50 %1 msec, max %2 msec")
+                                  .arg(res.notifyLagP50Msecs)
+                                  .arg(res.notifyLagMaxMsecs);
+}
+
+}
+
+class PipelineBenchTest : public Test
+{
+    // Test interface
+protected:
+    void SetUp();
+    void TearDown();
+};
+
+void PipelineBenchTest::SetUp() { }
+
+void PipelineBenchTest::TearDown() { }
+
+TEST_F(PipelineBenchTest, driverLogToDb)
+{
+    for (const int offeredRate : benchOfferedRates) {
+        QTemporaryDir tempDir;
+        ASSERT_TRUE(tempDir.isValid());
+
+        const PipelineResult res = runPipeline(offeredRate, tempDir.path());
+
+        ASSERT_GT(res.consumedEvents, 0);
+        ASSERT_EQ(res.consumedEvents + res.droppedEvents, res.offeredEvents);
+
+        printPipeline(offeredRate, res);
+    }
+}
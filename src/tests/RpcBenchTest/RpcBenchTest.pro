@@ -0,0 +1,7 @@
+include(../Common/Common.pri)
+
+HEADERS += \
+    tst_rpcbench.h
+
+SOURCES += \
+    tst_main.cpp
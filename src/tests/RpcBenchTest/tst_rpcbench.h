@@ -0,0 +1,296 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include <googletest.h>
+
+#include <conf/appgroup.h>
+#include <conf/firewallconf.h>
+#include <control/controlworker.h>
+#include <util/dateutil.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int benchRoundTrips = 2000;
+constexpr int benchBroadcasts = 500;
+constexpr int benchWaitMsecs = 5000;
+
+const int benchClientCounts[] = { 1, 4, 16 };
+
+struct BenchResult
+{
+    double opsPerSec = 0;
+    qint64 p50Nsec = 0;
+    qint64 p99Nsec = 0;
+};
+
+qint64 elapsedNsec(Clock::time_point begin)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+}
+
+BenchResult benchResult(std::vector<qint64> &nsecs, qint64 totalNsec)
+{
+    std::sort(nsecs.begin(), nsecs.end());
+
+    BenchResult res;
+    res.opsPerSec = double(nsecs.size()) * 1e9 / double(std::max<qint64>(totalNsec, 1));
+    res.p50Nsec = nsecs[nsecs.size() / 2];
+    res.p99Nsec = nsecs[nsecs.size() * 99 / 100];
+    return res;
+}
+
+void printBench(const char *name, int clientsCount, int dataSize, const BenchResult &res)
+{
+    qDebug().noquote() << QString("%1 [%2 clients, %3 bytes]: %4 ops/sec, p50 %5 nsec, p99 %6 nsec")
+                                  .arg(name)
+                                  .arg(clientsCount)
+                                  .arg(dataSize)
+                                  .arg(qint64(res.opsPerSec))
+                                  .arg(res.p50Nsec)
+                                  .arg(res.p99Nsec);
+}
+
+// Process the events, until done or timed out
+bool waitFor(const std::function<bool()> &isDone)
+{
+    const auto begin = Clock::now();
+
+    while (!isDone()) {
+        if (elapsedNsec(begin) >= qint64(benchWaitMsecs) * 1000 * 1000)
+            return false;
+
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+    }
+
+    return true;
+}
+
+QVariant benchConfVariant()
+{
+    FirewallConf conf;
+    conf.setupDefaultAddressGroups();
+
+    for (int i = 0; i < 8; ++i) {
+        QString allowText;
+        for (int j = 0; j < 32; ++j) {
+            allowText += QString(R"(C:\Program Files\App%1\bin\app%2.exe)").arg(i).arg(j) + '\n';
+        }
+
+        AppGroup *appGroup = conf.addAppGroupByName(QString("Group %1").arg(i));
+        appGroup->setAllowText(allowText);
+    }
+
+    return conf.toVariant();
+}
+
+QVariant benchConfFlagsVariant()
+{
+    FirewallConf conf;
+    conf.resetEdited();
+    conf.setFlagsEdited();
+
+    return conf.toVariant(/*onlyEdited=*/true);
+}
+
+}
+
+class RpcBenchTest : public Test
+{
+    // Test interface
+protected:
+    void SetUp();
+    void TearDown();
+
+    // The service's side of ControlManager: the accepted clients' workers
+    bool setUpClients(int clientsCount);
+
+    void benchRoundTrip(const char *name, Control::Command command, const QVariantList &args);
+    void benchBroadcast(const char *name, Control::Command command, const QVariantList &args);
+
+private:
+    QString m_serverName;
+
+    QLocalServer *m_server = nullptr;
+
+    QList<ControlWorker *> m_serverWorkers;
+    QList<ControlWorker *> m_clients;
+};
+
+void RpcBenchTest::SetUp()
+{
+    m_serverName = QString("FortFirewallRpcBench-%1").arg(QCoreApplication::applicationPid());
+}
+
+void RpcBenchTest::TearDown()
+{
+    qDeleteAll(m_clients);
+    m_clients.clear();
+
+    delete m_server; // with the server's workers
+    m_server = nullptr;
+    m_serverWorkers.clear();
+}
+
+bool RpcBenchTest::setUpClients(int clientsCount)
+{
+    TearDown();
+
+    m_server = new QLocalServer();
+    m_server->setMaxPendingConnections(clientsCount);
+
+    if (!m_server->listen(m_serverName)) {
+        qWarning() << "Server listen error:" << m_server->errorString();
+        return false;
+    }
+
+    QObject::connect(m_server, &QLocalServer::newConnection, m_server, [&] {
+        while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+            auto w = new ControlWorker(socket, m_server);
+            w->setupForAsync();
+
+            // Answer the requests like RpcManager::sendResult()
+            QObject::connect(w, &ControlWorker::requestReady, w,
+                    [=](Control::Command /*command*/, const QVariantList & /*args*/) {
+                        if (w->requestId() != 0) {
+                            w->sendCommand(Control::Rpc_Result_Ok, {}, w->requestId());
+                        }
+                    });
+
+            m_serverWorkers.append(w);
+        }
+    });
+
+    for (int i = 0; i < clientsCount; ++i) {
+        auto w = new ControlWorker(new QLocalSocket());
+        w->setupForAsync();
+        w->setServerName(m_serverName);
+
+        m_clients.append(w);
+
+        // The server adds its pipe's listeners by the events
+        if (!waitFor([&] { return w->connectToServer(); }))
+            return false;
+    }
+
+    return waitFor([&] { return m_serverWorkers.size() == clientsCount; });
+}
+
+void RpcBenchTest::benchRoundTrip(
+        const char *name, Control::Command command, const QVariantList &args)
+{
+    const QByteArray commandData = ControlWorker::buildCommandData(command, args, /*requestId=*/1);
+    ASSERT_FALSE(commandData.isEmpty());
+
+    for (const int clientsCount : benchClientCounts) {
+        ASSERT_TRUE(setUpClients(clientsCount));
+
+        ControlWorker *client = m_clients.first();
+
+        bool answered = false;
+        QObject::connect(client, &ControlWorker::requestReady, client,
+                [&](Control::Command command, const QVariantList & /*args*/) {
+                    answered = (command == Control::Rpc_Result_Ok);
+                });
+
+        std::vector<qint64> nsecs;
+        nsecs.reserve(benchRoundTrips);
+
+        const auto totalBegin = Clock::now();
+
+        for (int i = 0; i < benchRoundTrips; ++i) {
+            answered = false;
+
+            const auto begin = Clock::now();
+
+            ASSERT_TRUE(client->sendCommand(command, args, /*requestId=*/i + 1));
+            ASSERT_TRUE(waitFor([&] { return answered; }));
+
+            nsecs.push_back(elapsedNsec(begin));
+        }
+
+        printBench(name, clientsCount, commandData.size(),
+                benchResult(nsecs, elapsedNsec(totalBegin)));
+    }
+}
+
+void RpcBenchTest::benchBroadcast(
+        const char *name, Control::Command command, const QVariantList &args)
+{
+    for (const int clientsCount : benchClientCounts) {
+        ASSERT_TRUE(setUpClients(clientsCount));
+
+        int receivedCount = 0;
+        for (ControlWorker *client : std::as_const(m_clients)) {
+            QObject::connect(client, &ControlWorker::requestReady, client,
+                    [&] { ++receivedCount; });
+        }
+
+        std::vector<qint64> sendNsecs;
+        std::vector<qint64> deliverNsecs;
+        sendNsecs.reserve(benchBroadcasts);
+        deliverNsecs.reserve(benchBroadcasts);
+
+        int dataSize = 0;
+
+        const auto totalBegin = Clock::now();
+
+        for (int i = 0; i < benchBroadcasts; ++i) {
+            receivedCount = 0;
+
+            const auto begin = Clock::now();
+
+            // Like RpcManager::invokeOnClients()
+            const QByteArray commandData = ControlWorker::buildCommandData(command, args);
+            ASSERT_FALSE(commandData.isEmpty());
+
+            for (ControlWorker *w : std::as_const(m_serverWorkers)) {
+                ASSERT_TRUE(w->sendCommandData(commandData));
+            }
+
+            sendNsecs.push_back(elapsedNsec(begin));
+
+            ASSERT_TRUE(waitFor([&] { return receivedCount == clientsCount; }));
+
+            deliverNsecs.push_back(elapsedNsec(begin));
+
+            dataSize = commandData.size();
+        }
+
+        const qint64 totalNsec = elapsedNsec(totalBegin);
+
+        printBench((QByteArray(name) + " send").constData(), clientsCount, dataSize,
+                benchResult(sendNsecs, totalNsec));
+        printBench((QByteArray(name) + " deliver").constData(), clientsCount, dataSize,
+                benchResult(deliverNsecs, totalNsec));
+    }
+}
+
+TEST_F(RpcBenchTest, confSaveRoundTrip)
+{
+    benchRoundTrip("confSaveVariant", Control::Rpc_ConfManager_saveVariant, { benchConfVariant() });
+}
+
+TEST_F(RpcBenchTest, confChangedBroadcast)
+{
+    benchBroadcast(
+            "confChanged", Control::Rpc_ConfManager_confChanged, { benchConfFlagsVariant() });
+}
+
+TEST_F(RpcBenchTest, trafficAddedBroadcast)
+{
+    const qint64 unixTime = DateUtil::getUnixTime();
+
+    benchBroadcast("trafficAdded", Control::Rpc_StatManager_trafficAdded,
+            { unixTime, quint64(1500000), quint64(64000) });
+}
@@ -2,7 +2,12 @@
 
 #include <QDebug>
 #include <QElapsedTimer>
+#include <QFileInfo>
 #include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include <algorithm>
+#include <vector>
 
 #include <googletest.h>
 
@@ -16,6 +21,8 @@
 #include <log/logentrystattraf.h>
 #include <stat/quotamanager.h>
 #include <stat/statmanager.h>
+#include <stat/statsql.h>
+#include <stat/stattopapps.h>
 #include <util/dateutil.h>
 #include <util/fileutil.h>
 #include <util/ioc/ioccontainer.h>
@@ -133,18 +140,35 @@ TEST_F(StatTest, dbWriteRead)
     {
         const quint32 trafBytes[procCount * 3] = { 10, 100, 200, 20, 300, 400, 30, 500, 600 };
 
-        LogEntryStatTraf entry(procCount, trafBytes);
+        LogEntryStatTraf entry(procCount, trafBytes, /*compact=*/true);
         statManager.logStatTraf(entry);
         statManager.logStatTraf(entry);
     }
 
+    // Add app 64-bit traffics
+    {
+        const quint32 trafBytes[procCount * 5] = { 10, 100, 1, 200, 0, 20, 300, 0, 400, 2, 30,
+            500, 0, 600, 0 };
+
+        LogEntryStatTraf entry(procCount, trafBytes);
+
+        quint32 pidFlag;
+        quint64 inBytes, outBytes;
+        entry.procTraf(0, pidFlag, inBytes, outBytes);
+        ASSERT_EQ(pidFlag, 10);
+        ASSERT_EQ(inBytes, 0x100000064ULL);
+        ASSERT_EQ(outBytes, 200);
+
+        statManager.logStatTraf(entry);
+    }
+
     qDebug() << "elapsed>" << timer.restart() << "msec";
 
     // Delete apps
     {
         const quint32 trafBytes[procCount * 3] = { 11, 10, 20, 21, 30, 40, 31, 50, 60 };
 
-        LogEntryStatTraf entry(procCount, trafBytes);
+        LogEntryStatTraf entry(procCount, trafBytes, /*compact=*/true);
         statManager.logStatTraf(entry);
     }
 
@@ -167,3 +191,223 @@ TEST_F(StatTest, monthStart)
     ASSERT_EQ(d2.month(), 12);
     ASSERT_EQ(d2.day(), 1);
 }
+
+TEST_F(StatTest, topApps)
+{
+    StatTopApps topApps;
+
+    const qint64 unixTime = 1700000000;
+
+    topApps.advance(unixTime);
+    topApps.addTraffic("a", 100, 0);
+    topApps.addTraffic("b", 10, 10);
+
+    topApps.advance(unixTime + 2 * 60);
+    topApps.addTraffic("b", 500, 0);
+
+    {
+        const auto list = topApps.topApps(StatTopApps::Window5Minutes, 1);
+        ASSERT_EQ(list.size(), 1);
+        ASSERT_EQ(list[0].appPath, "b");
+        ASSERT_EQ(list[0].bytes.inBytes, 510);
+    }
+
+    // The first minute leaves the 5 minutes window
+    topApps.advance(unixTime + 5 * 60);
+
+    {
+        const auto list = topApps.topApps(StatTopApps::Window5Minutes, 10);
+        ASSERT_EQ(list.size(), 1);
+        ASSERT_EQ(list[0].bytes.inBytes, 500);
+    }
+
+    ASSERT_EQ(topApps.topApps(StatTopApps::WindowHour, 10).size(), 2);
+
+    topApps.advance(unixTime + 3 * 60 * 60);
+
+    ASSERT_TRUE(topApps.topApps(StatTopApps::WindowHour, 10).isEmpty());
+}
+
+TEST_F(StatTest, archiveTraffic)
+{
+    IocContainer ioc;
+    ioc.pinToThread();
+
+    NiceMock<MockQuotaManager> quotaManager;
+    ioc.set<QuotaManager>(quotaManager);
+
+    FirewallConf conf;
+    conf.setLogStat(true);
+    conf.ini().setTrafFlushSeconds(0); // flush by every entry
+    conf.ini().setTrafHourKeepDays(30);
+    conf.ini().setTrafHourArchiveDays(1);
+
+    QTemporaryDir tempDir;
+    ASSERT_TRUE(tempDir.isValid());
+
+    const QString dbPath = tempDir.filePath("stat.db");
+
+    StatManager statManager(dbPath);
+    statManager.setConf(&conf);
+
+    statManager.setUp();
+    ASSERT_TRUE(statManager.isArchiveDb());
+
+    statManager.logProcNew(LogEntryProcNew(4, "C:\\test\\test.exe"));
+
+    // Replay the hours of the days, the day changes archive the old hours
+    constexpr int hoursCount = 4 * 24;
+
+    const qint64 startTime = QDateTime(QDate(2024, 1, 1), QTime(12, 0)).toSecsSinceEpoch();
+
+    for (int hour = 0; hour < hoursCount; ++hour) {
+        const quint32 trafBytes[3] = { 4, 1000, 100 };
+
+        const LogEntryStatTraf entry(1, trafBytes, /*compact=*/true);
+        statManager.logStatTraf(entry, startTime + qint64(hour) * 3600);
+    }
+
+    // Wait for the pending flushes
+    statManager.tearDown();
+
+    const qint32 minTrafHour = DateUtil::getUnixHour(startTime);
+    const qint32 maxTrafHour = minTrafHour + hoursCount;
+
+    const auto hoursCountOf = [&](const char *sql) {
+        SqliteStmt stmt;
+        stmt.prepare(statManager.sqliteDb()->db(), sql);
+        return (stmt.step() == SqliteStmt::StepRow) ? stmt.columnInt() : -1;
+    };
+
+    const int archiveHoursCount = hoursCountOf("SELECT count(*) FROM archive.traffic_hour;");
+    const int hotHoursCount = hoursCountOf("SELECT count(*) FROM traffic_hour;");
+
+    ASSERT_GT(archiveHoursCount, 0);
+    ASSERT_EQ(archiveHoursCount + hotHoursCount, hoursCount);
+
+    // The archived hours are read transparently
+    TrafTimeBytesMap trafMap;
+    statManager.getTrafficRange(
+            StatSql::sqlSelectTrafHourRange, minTrafHour, maxTrafHour, trafMap);
+
+    ASSERT_EQ(trafMap.size(), hoursCount);
+    ASSERT_EQ(statManager.getTrafficTime(StatSql::sqlSelectMinTrafHour), minTrafHour);
+}
+
+namespace {
+
+constexpr int benchProcsCount = 2000;
+constexpr int benchActiveProcsCount = 100; // per tick
+constexpr int benchTickMsecs = 500;
+constexpr int benchTicksPerDay = 480; // replayed ticks of each day
+constexpr int benchDaysCount = 5;
+
+// Baseline of the app traffic rows flushed per second; fail on a regression below it
+constexpr double benchMinRowsPerSec = 5000;
+
+}
+
+TEST_F(StatTest, benchTraffic)
+{
+    IocContainer ioc;
+    ioc.pinToThread();
+
+    NiceMock<MockQuotaManager> quotaManager;
+    ioc.set<QuotaManager>(quotaManager);
+
+    FirewallConf conf;
+    conf.setLogStat(true);
+    conf.ini().setTrafFlushSeconds(0); // flush by every tick
+    conf.ini().setTrafHourKeepDays(1);
+    conf.ini().setTrafDayKeepDays(2);
+
+    QTemporaryDir tempDir;
+    ASSERT_TRUE(tempDir.isValid());
+
+    const QString dbPath = tempDir.filePath("stat.db");
+
+    StatManager statManager(dbPath);
+    statManager.setConf(&conf);
+
+    statManager.setUp();
+
+    // Add apps
+    for (int i = 0; i < benchProcsCount; ++i) {
+        const quint32 pid = quint32(i + 1) * 4;
+        const QString appPath = QString("C:\\bench\\app%1.exe").arg(i);
+
+        statManager.logProcNew(LogEntryProcNew(pid, appPath));
+    }
+
+    const qint64 dbInitSize = QFileInfo(dbPath).size();
+
+    std::vector<qint64> tickNsecs;
+    tickNsecs.reserve(benchTicksPerDay * benchDaysCount);
+
+    QVector<quint32> trafBytes(benchActiveProcsCount * 3);
+
+    qint64 rowsCount = 0;
+    int procIndex = 0;
+
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+
+    // Replay the days of traffic, the day changes delete the old traffic
+    const qint64 startTime = QDateTime(QDate(2024, 1, 1), QTime(12, 0)).toSecsSinceEpoch();
+
+    for (int day = 0; day < benchDaysCount; ++day) {
+        qint64 unixTimeMsecs = (startTime + qint64(day) * 24 * 3600) * 1000;
+
+        for (int tick = 0; tick < benchTicksPerDay; ++tick) {
+            for (int i = 0; i < benchActiveProcsCount; ++i) {
+                const quint32 pid = quint32(procIndex + 1) * 4;
+
+                trafBytes[i * 3] = pid;
+                trafBytes[i * 3 + 1] = 1000 + i;
+                trafBytes[i * 3 + 2] = 100 + tick;
+
+                if (++procIndex == benchProcsCount) {
+                    procIndex = 0;
+                }
+            }
+
+            const LogEntryStatTraf entry(
+                    benchActiveProcsCount, trafBytes.constData(), /*compact=*/true);
+
+            QElapsedTimer tickTimer;
+            tickTimer.start();
+
+            statManager.logStatTraf(entry, unixTimeMsecs / 1000);
+
+            tickNsecs.push_back(tickTimer.nsecsElapsed());
+
+            rowsCount += benchActiveProcsCount;
+            unixTimeMsecs += benchTickMsecs;
+        }
+    }
+
+    // Wait for the pending flushes
+    statManager.tearDown();
+
+    const qint64 totalMsecs = std::max<qint64>(totalTimer.elapsed(), 1);
+    const double rowsPerSec = double(rowsCount) * 1000 / double(totalMsecs);
+
+    std::sort(tickNsecs.begin(), tickNsecs.end());
+
+    const auto tickPercentile = [&](int percent) {
+        return tickNsecs[tickNsecs.size() * percent / 100] / 1000;
+    };
+
+    const qint64 dbSize = QFileInfo(dbPath).size();
+
+    qDebug().noquote() << QString("benchTraffic [%1 procs, %2 ticks]: %3 rows/sec,"
+                                  " tick p50 %4 usec, p99 %5 usec, db growth %6 KiB")
+                                  .arg(benchProcsCount)
+                                  .arg(tickNsecs.size())
+                                  .arg(qint64(rowsPerSec))
+                                  .arg(tickPercentile(50))
+                                  .arg(tickPercentile(99))
+                                  .arg((dbSize - dbInitSize) / 1024);
+
+    ASSERT_GE(rowsPerSec, benchMinRowsPerSec);
+}
@@ -5,7 +5,8 @@ HEADERS += \
     tst_fileutil.h \
     tst_ioccontainer.h \
     tst_netutil.h \
-    tst_stringutil.h
+    tst_stringutil.h \
+    tst_zonebench.h
 
 SOURCES += \
     tst_main.cpp
@@ -7,12 +7,16 @@
 #include <conf/addressgroup.h>
 #include <conf/appgroup.h>
 #include <conf/firewallconf.h>
+#include <conf/rules/policyset.h>
+#include <conf/rules/rule.h>
 #include <driver/drivercommon.h>
 #include <log/logentryblockedip.h>
 #include <manager/envmanager.h>
 #include <util/conf/confappswalker.h>
+#include <util/conf/confevaluator.h>
 #include <util/conf/confutil.h>
 #include <util/fileutil.h>
+#include <util/net/iprange.h>
 #include <util/net/netutil.h>
 
 class ConfUtilTest : public Test
@@ -120,6 +124,10 @@ TEST_F(ConfUtilTest, confWriteRead)
     ASSERT_EQ(DriverCommon::confAppPeriodBits(data, 0, 0), 0x01);
     ASSERT_EQ(DriverCommon::confAppPeriodBits(data, 12, 0), 0);
 
+    ASSERT_EQ(DriverCommon::confAppPeriodNext(data, 0, 0), 11 * 60 + 59);
+    ASSERT_EQ(DriverCommon::confAppPeriodNext(data, 11, 59), 12 * 60 + 1);
+    ASSERT_EQ(DriverCommon::confAppPeriodNext(data, 12, 0), 12 * 60);
+
     const quint16 firefoxFlags = DriverCommon::confAppFind(
             data, FileUtil::pathToKernelPath("C:\\Utils\\Firefox\\Bin\\firefox.exe"));
     ASSERT_TRUE(DriverCommon::confAppBlocked(data, firefoxFlags, &blockReason));
@@ -127,6 +135,441 @@ TEST_F(ConfUtilTest, confWriteRead)
     ASSERT_EQ(int(DriverCommon::confAppGroupIndex(firefoxFlags)), 1);
 }
 
+TEST_F(ConfUtilTest, confWritePatch)
+{
+    EnvManager envManager;
+    FirewallConf conf;
+
+    AddressGroup *inetGroup = conf.inetAddressGroup();
+    inetGroup->setExcludeText("10.0.0.0/8");
+
+    AppGroup *appGroup = new AppGroup();
+    appGroup->setName("Base");
+    appGroup->setEnabled(true);
+    appGroup->setAllowText("C:\\Utils\\Firefox\\Bin\\firefox.exe");
+
+    conf.addAppGroup(appGroup);
+
+    conf.resetEdited(true);
+    conf.prepareToSave();
+
+    ConfUtil confUtil;
+
+    QByteArray buf;
+    ASSERT_NE(confUtil.write(conf, nullptr, envManager, buf), 0);
+
+    const QByteArray appsKey = ConfUtil::appsKey(conf);
+    ConfPatchSections sections = confUtil.patchSections();
+
+    // Nothing changed
+    const int emptyPatchSize = confUtil.writePatch(conf, sections, buf);
+    ASSERT_NE(emptyPatchSize, 0);
+
+    // Address group changed
+    inetGroup->setExcludeText("10.0.0.0/8\n192.168.0.0/16");
+    ASSERT_EQ(ConfUtil::appsKey(conf), appsKey);
+
+    const int addrPatchSize = confUtil.writePatch(conf, sections, buf);
+    ASSERT_GT(addrPatchSize, emptyPatchSize);
+
+    ASSERT_EQ(confUtil.writePatch(conf, sections, buf), emptyPatchSize);
+
+    // Speed limit changed
+    appGroup->setLimitInEnabled(true);
+    appGroup->setSpeedLimitIn(1024);
+    ASSERT_EQ(ConfUtil::appsKey(conf), appsKey);
+
+    ASSERT_EQ(confUtil.writePatch(conf, sections, buf), emptyPatchSize);
+
+    // Apps changed
+    appGroup->setBlockText("System");
+    ASSERT_NE(ConfUtil::appsKey(conf), appsKey);
+}
+
+TEST_F(ConfUtilTest, confIp4Index)
+{
+    EnvManager envManager;
+    FirewallConf conf;
+
+    AddressGroup *inetGroup = conf.inetAddressGroup();
+
+    QString includeText;
+    for (int i = 0; i < 64; ++i) {
+        for (int j = 0; j < 64; ++j) {
+            includeText += QString("10.%1.%2.1\n").arg(i * 4).arg(j * 4);
+            includeText += QString("172.%1.%2.0/24\n").arg(i * 4).arg(j * 4);
+        }
+    }
+    includeText += "200.0.0.0-223.255.255.255\n";
+
+    inetGroup->setIncludeAll(false);
+    inetGroup->setExcludeAll(false);
+    inetGroup->setIncludeText(includeText);
+    inetGroup->setExcludeText(QString());
+
+    AppGroup *appGroup = new AppGroup();
+    appGroup->setName("Base");
+    conf.addAppGroup(appGroup);
+
+    conf.resetEdited(true);
+    conf.prepareToSave();
+
+    ConfUtil confUtil;
+
+    QByteArray buf;
+    const int confIoSize = confUtil.write(conf, nullptr, envManager, buf);
+    ASSERT_NE(confIoSize, 0);
+
+    ASSERT_NE(DriverCommon::confIpIndexBits(4096, 4097), 0);
+
+    const char *data = buf.constData() + DriverCommon::confIoConfOff();
+
+    ASSERT_TRUE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("10.0.0.1"), true));
+    ASSERT_TRUE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("10.252.252.1"), true));
+    ASSERT_FALSE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("10.252.252.2"), true));
+    ASSERT_FALSE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("10.1.0.1"), true));
+    ASSERT_TRUE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("172.0.0.0"), true));
+    ASSERT_TRUE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("172.128.64.255"), true));
+    ASSERT_FALSE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("172.128.65.0"), true));
+    ASSERT_FALSE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("199.255.255.255"), true));
+    ASSERT_TRUE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("210.10.10.10"), true));
+    ASSERT_TRUE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("223.255.255.255"), true));
+    ASSERT_FALSE(DriverCommon::confIp4InRange(data, NetUtil::textToIp4("224.0.0.0"), true));
+}
+
+TEST_F(ConfUtilTest, confRules)
+{
+    EnvManager envManager;
+    FirewallConf conf;
+
+    AppGroup *appGroup = new AppGroup();
+    appGroup->setName("Base");
+    conf.addAppGroup(appGroup);
+
+    conf.resetEdited(true);
+    conf.prepareToSave();
+
+    Rule blockDns;
+    blockDns.block = true;
+    blockDns.ipProto = 17; // UDP
+    blockDns.remotePortText = "53";
+    blockDns.remoteIpText = "8.8.8.8\n1.1.1.0/24";
+
+    Rule allowWeb;
+    allowWeb.ipProto = 6; // TCP
+    allowWeb.remotePortText = "80, 443, 8000-8100";
+
+    Rule blockInbound;
+    blockInbound.block = true;
+    blockInbound.ruleFlags = Rule::FlagInbound;
+    blockInbound.localPortText = "1-1023";
+
+    Rule disabled;
+    disabled.enabled = false;
+    disabled.block = true;
+
+    PolicySet policySet;
+    policySet.m_rules = { &blockDns, &allowWeb, &blockInbound, &disabled };
+
+    ConfUtil confUtil;
+    confUtil.setPolicySet(&policySet);
+
+    QByteArray buf;
+    const int confIoSize = confUtil.write(conf, nullptr, envManager, buf);
+    ASSERT_NE(confIoSize, 0);
+
+    const char *data = buf.constData() + DriverCommon::confIoConfOff();
+
+    const auto ruleFind = [&](quint8 ipProto, bool inbound, quint16 localPort,
+                                  const char *remoteIp, quint16 remotePort) -> int {
+        return DriverCommon::confRuleFind(data, ipProto, inbound, NetUtil::textToIp4("10.0.0.1"),
+                localPort, NetUtil::textToIp4(remoteIp), remotePort);
+    };
+
+    ASSERT_EQ(ruleFind(17, false, 5000, "8.8.8.8", 53), 0);
+    ASSERT_EQ(ruleFind(17, false, 5000, "1.1.1.200", 53), 0);
+    ASSERT_EQ(ruleFind(17, false, 5000, "8.8.4.4", 53), -1);
+    ASSERT_EQ(ruleFind(17, false, 5000, "8.8.8.8", 54), -1);
+    ASSERT_EQ(ruleFind(6, false, 5000, "8.8.8.8", 443), 1);
+    ASSERT_EQ(ruleFind(6, false, 5000, "8.8.8.8", 8050), 1);
+    ASSERT_EQ(ruleFind(6, false, 5000, "8.8.8.8", 8101), -1);
+    ASSERT_EQ(ruleFind(6, true, 22, "8.8.8.8", 40000), 2);
+    ASSERT_EQ(ruleFind(17, true, 1023, "8.8.8.8", 53), 2);
+    ASSERT_EQ(ruleFind(17, true, 1024, "8.8.8.8", 53), -1);
+    ASSERT_EQ(ruleFind(1, false, 0, "8.8.8.8", 0), -1);
+}
+
+TEST_F(ConfUtilTest, confEvalConns)
+{
+    EnvManager envManager;
+    FirewallConf conf;
+
+    AddressGroup *inetGroup = conf.inetAddressGroup();
+
+    inetGroup->setIncludeAll(true);
+    inetGroup->setExcludeAll(false);
+    inetGroup->setExcludeText(NetUtil::localIpNetworksText());
+
+    AppGroup *appGroup = new AppGroup();
+    appGroup->setName("Base");
+    appGroup->setEnabled(true);
+    appGroup->setBlockText("C:\\Utils\\Blocked.exe");
+    appGroup->setAllowText("C:\\Utils\\Allowed.exe");
+    conf.addAppGroup(appGroup);
+
+    conf.resetEdited(true);
+    conf.prepareToSave();
+
+    Rule blockDns;
+    blockDns.block = true;
+    blockDns.ipProto = 17; // UDP
+    blockDns.remotePortText = "53";
+
+    Rule allowNtp;
+    allowNtp.ipProto = 17; // UDP
+    allowNtp.remotePortText = "123";
+
+    PolicySet policySet;
+    policySet.m_rules = { &blockDns, &allowNtp };
+
+    ConfUtil confUtil;
+    confUtil.setPolicySet(&policySet);
+
+    QByteArray buf;
+    const int confIoSize = confUtil.write(conf, nullptr, envManager, buf);
+    ASSERT_NE(confIoSize, 0);
+
+    ConfEvaluator evaluator;
+    evaluator.setConf(buf.left(confIoSize));
+    ASSERT_TRUE(evaluator.isValid());
+
+    const auto connLine = [](const char *path, int ipProto, const char *remoteIp,
+                                  int remotePort) -> QByteArray {
+        return QByteArray(R"({"type":"conn_block","path":")") + path
+                + R"(","inbound":false,"ip_proto":)" + QByteArray::number(ipProto)
+                + R"(,"local_ip":"10.0.0.1","local_port":50000,"remote_ip":")" + remoteIp
+                + R"(","remote_port":)" + QByteArray::number(remotePort) + "}";
+    };
+
+    const QList<QByteArray> lines = {
+        connLine(R"(C:\\Utils\\Allowed.exe)", 6, "8.8.8.8", 443),
+        connLine(R"(C:\\Utils\\Blocked.exe)", 6, "8.8.8.8", 443),
+        connLine(R"(C:\\Utils\\Unknown.exe)", 6, "8.8.8.8", 443),
+        connLine(R"(C:\\Utils\\Blocked.exe)", 6, "192.168.1.1", 443),
+        connLine(R"(C:\\Utils\\Allowed.exe)", 17, "8.8.8.8", 53),
+        connLine(R"(C:\\Utils\\Blocked.exe)", 17, "8.8.8.8", 123),
+        connLine(R"(C:\\Utils\\Unknown.exe)", 17, "8.8.8.8", 123),
+    };
+
+    QVector<ConfEvalConn> conns;
+    for (const QByteArray &line : lines) {
+        ConfEvalConn conn;
+        ASSERT_TRUE(evaluator.parseConnLine(line, conn));
+        conns.append(conn);
+    }
+
+    ConfEvalConn conn;
+    ASSERT_FALSE(evaluator.parseConnLine(R"({"type":"traffic","path":"C:\\Test.exe"})", conn));
+
+    qint8 blockReason;
+
+    ASSERT_FALSE(evaluator.connBlocked(conns[0], blockReason));
+    ASSERT_EQ(blockReason, FORT_BLOCK_REASON_NONE);
+
+    ASSERT_TRUE(evaluator.connBlocked(conns[1], blockReason));
+    ASSERT_EQ(blockReason, FORT_BLOCK_REASON_APP_GROUP_FOUND);
+
+    ASSERT_TRUE(evaluator.connBlocked(conns[2], blockReason));
+    ASSERT_EQ(blockReason, FORT_BLOCK_REASON_FILTER_MODE);
+
+    ASSERT_FALSE(evaluator.connBlocked(conns[3], blockReason)); // LAN
+
+    ASSERT_TRUE(evaluator.connBlocked(conns[4], blockReason));
+    ASSERT_EQ(blockReason, FORT_BLOCK_REASON_RULE);
+
+    // The allowing Rule doesn't override the blocked app
+    ASSERT_TRUE(evaluator.connBlocked(conns[5], blockReason));
+    ASSERT_EQ(blockReason, FORT_BLOCK_REASON_APP_GROUP_FOUND);
+
+    ASSERT_FALSE(evaluator.connBlocked(conns[6], blockReason));
+    ASSERT_EQ(blockReason, FORT_BLOCK_REASON_NONE);
+
+    const ConfEvalResult result = evaluator.evaluateConns(conns);
+
+    ASSERT_EQ(result.connsCount, 7);
+    ASSERT_EQ(result.blockedCount, 4);
+    ASSERT_EQ(result.blockReasonCounts[FORT_BLOCK_REASON_APP_GROUP_FOUND], 2);
+    ASSERT_EQ(result.blockReasonCounts[FORT_BLOCK_REASON_FILTER_MODE], 1);
+    ASSERT_EQ(result.blockReasonCounts[FORT_BLOCK_REASON_RULE], 1);
+}
+
+TEST_F(ConfUtilTest, confAppPrefixLongest)
+{
+    EnvManager envManager;
+    FirewallConf conf;
+
+    AppGroup *appGroup1 = new AppGroup();
+    appGroup1->setName("Utils");
+    appGroup1->setAllowText("C:\\Utils\\**\n"
+                            "C:\\Utils\\Dev\\Git\\**\n");
+
+    AppGroup *appGroup2 = new AppGroup();
+    appGroup2->setName("Dev");
+    appGroup2->setAllowText("C:\\Utils\\Dev\\**\n");
+
+    conf.addAppGroup(appGroup1);
+    conf.addAppGroup(appGroup2);
+
+    conf.resetEdited(true);
+    conf.prepareToSave();
+
+    ConfUtil confUtil;
+
+    QByteArray buf;
+    const int confIoSize = confUtil.write(conf, nullptr, envManager, buf);
+    ASSERT_NE(confIoSize, 0);
+
+    const char *data = buf.constData() + DriverCommon::confIoConfOff();
+
+    const auto appGroupIndex = [&](const char *path) -> int {
+        return DriverCommon::confAppGroupIndex(
+                DriverCommon::confAppFind(data, FileUtil::pathToKernelPath(path)));
+    };
+
+    ASSERT_EQ(appGroupIndex("C:\\Utils\\Test.exe"), 0);
+    ASSERT_EQ(appGroupIndex("C:\\Utils\\Dev\\Test.exe"), 1);
+    ASSERT_EQ(appGroupIndex("C:\\Utils\\Dev\\Git\\git.exe"), 0);
+    ASSERT_EQ(appGroupIndex("C:\\Utils\\Develop\\Test.exe"), 0);
+    ASSERT_EQ(DriverCommon::confAppFind(data, FileUtil::pathToKernelPath("D:\\Test.exe")), 0);
+}
+
+TEST_F(ConfUtilTest, confZonesIndex)
+{
+    const QStringList zonesText = { "10.0.0.0/8\n1.1.1.1\n",
+        "10.1.0.0-10.1.255.255\n2.2.2.2\n11.0.0.0/8\n", "1.1.1.1\n12.0.0.0/8\n" };
+
+    ConfUtil confUtil;
+
+    QList<QByteArray> zonesData;
+    quint32 dataSize = 0;
+
+    for (const QString &zoneText : zonesText) {
+        IpRange ipRange;
+        ASSERT_TRUE(ipRange.fromText(zoneText));
+
+        QByteArray zoneData;
+        const int zoneSize = confUtil.writeZone(ipRange, zoneData);
+        ASSERT_NE(zoneSize, 0);
+        zoneData.resize(zoneSize);
+
+        zonesData.append(zoneData);
+        dataSize += zoneSize;
+    }
+
+    QByteArray buf;
+    const int zonesSize = confUtil.writeZones(0x07, 0x07, dataSize, zonesData, buf);
+    ASSERT_NE(zonesSize, 0);
+
+    const char *data = buf.constData();
+
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("1.1.1.1")), 0x05);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("2.2.2.2")), 0x02);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("3.3.3.3")), 0);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("10.0.255.255")), 0x01);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("10.1.0.0")), 0x03);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("10.1.255.255")), 0x03);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("10.2.0.0")), 0x01);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("11.255.255.255")), 0x02);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("12.0.0.0")), 0x04);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("13.0.0.0")), 0);
+}
+
+TEST_F(ConfUtilTest, confZonesIndexPacked)
+{
+    IpRange packedRange;
+    for (quint32 i = 0; i < FORT_CONF_IP_PACK_MIN_COUNT; ++i) {
+        packedRange.ip4Array().append(0x0A000000 + i * 4);
+    }
+
+    IpRange firstRange;
+    ASSERT_TRUE(firstRange.fromText("10.0.0.0/8\n"));
+
+    IpRange lastRange;
+    ASSERT_TRUE(lastRange.fromText("10.1.0.0/16\n"));
+
+    ConfUtil confUtil;
+
+    QList<QByteArray> zonesData;
+    quint32 dataSize = 0;
+
+    for (const IpRange *ipRange : { &firstRange, &packedRange, &lastRange }) {
+        QByteArray zoneData;
+        const int zoneSize = confUtil.writeZone(*ipRange, zoneData);
+        ASSERT_NE(zoneSize, 0);
+        zoneData.resize(zoneSize);
+
+        zonesData.append(zoneData);
+        dataSize += zoneSize;
+    }
+
+    ASSERT_TRUE(PFORT_CONF_ADDR4_LIST(zonesData[1].constData())->is_packed);
+
+    QByteArray buf;
+    const int zonesSize = confUtil.writeZones(0x07, 0x07, dataSize, zonesData, buf);
+    ASSERT_NE(zonesSize, 0);
+
+    const char *data = buf.constData();
+
+    // The packed zone is not in the merged index of the other zones
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("10.0.0.4")), 0x01);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("10.1.0.0")), 0x05);
+    ASSERT_EQ(DriverCommon::confZonesIp4Mask(data, NetUtil::textToIp4("11.0.0.0")), 0);
+}
+
+TEST_F(ConfUtilTest, confIp4Packed)
+{
+    IpRange ipRange;
+
+    // 10.0.0.0 + i*4 and 172.0.0.0 + i*256 .. +99
+    for (quint32 i = 0; i < 40000; ++i) {
+        ipRange.ip4Array().append(0x0A000000 + i * 4);
+        ipRange.pair4FromArray().append(0xAC000000 + i * 256);
+        ipRange.pair4ToArray().append(0xAC000000 + i * 256 + 99);
+    }
+
+    ConfUtil confUtil;
+
+    QByteArray zoneData;
+    const int zoneSize = confUtil.writeZone(ipRange, zoneData);
+    ASSERT_NE(zoneSize, 0);
+    zoneData.resize(zoneSize);
+
+    ASSERT_LT(zoneSize, (ipRange.ip4Size() + ipRange.pair4Size() * 2) * int(sizeof(quint32)));
+
+    const char *data = zoneData.constData();
+
+    ASSERT_TRUE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("10.0.0.0")));
+    ASSERT_TRUE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("10.0.0.4")));
+    ASSERT_FALSE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("10.0.0.5")));
+    ASSERT_TRUE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("10.0.156.64")));
+    ASSERT_FALSE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("10.0.156.65")));
+    ASSERT_TRUE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("10.2.112.252")));
+    ASSERT_FALSE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("10.2.113.0")));
+    ASSERT_FALSE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("9.255.255.255")));
+    ASSERT_TRUE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("172.0.0.99")));
+    ASSERT_FALSE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("172.0.0.100")));
+    ASSERT_TRUE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("172.0.156.50")));
+    ASSERT_FALSE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("172.0.156.255")));
+    ASSERT_TRUE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("172.156.63.99")));
+    ASSERT_FALSE(DriverCommon::confIp4InList(data, NetUtil::textToIp4("172.156.64.0")));
+
+    IpRange loadedRange;
+    ASSERT_TRUE(confUtil.loadZone(zoneData, loadedRange));
+    ASSERT_EQ(loadedRange.ip4Array(), ipRange.ip4Array());
+    ASSERT_EQ(loadedRange.pair4FromArray(), ipRange.pair4FromArray());
+    ASSERT_EQ(loadedRange.pair4ToArray(), ipRange.pair4ToArray());
+}
+
 TEST_F(ConfUtilTest, checkPeriod)
 {
     const quint8 h = 15, m = 35;
@@ -169,3 +612,102 @@ TEST_F(ConfUtilTest, checkEnvManager)
 
     ASSERT_NE(envManager.expandString("%HOME%"), QString());
 }
+
+TEST_F(ConfUtilTest, logFilters)
+{
+    ConfUtil confUtil;
+
+    ConfUtil::logfilters_arr_t filters;
+    const QString text = "# SSDP\n"
+                         "proto=udp dir=in local_port=1900 addr=multicast\n"
+                         "\n"
+                         "proto=udp remote_port=137-138 addr=broadcast,link_local # NetBIOS\n";
+
+    ASSERT_TRUE(confUtil.parseLogFilters(text, filters));
+    ASSERT_EQ(filters.size(), 2);
+
+    const FORT_CONF_LOG_FILTER &ssdp = filters[0];
+    ASSERT_EQ(ssdp.ip_proto, 17);
+    ASSERT_TRUE(ssdp.inbound);
+    ASSERT_FALSE(ssdp.outbound);
+    ASSERT_EQ(ssdp.addr_classes, FORT_LOG_FILTER_ADDR_MULTICAST);
+    ASSERT_EQ(ssdp.local_ports.from, 1900);
+    ASSERT_EQ(ssdp.local_ports.to, 1900);
+    ASSERT_EQ(ssdp.remote_ports.from, 0);
+    ASSERT_EQ(ssdp.remote_ports.to, FORT_CONF_RULE_PORT_MAX);
+
+    const FORT_CONF_LOG_FILTER &netbios = filters[1];
+    ASSERT_TRUE(netbios.inbound);
+    ASSERT_TRUE(netbios.outbound);
+    ASSERT_EQ(netbios.addr_classes,
+            FORT_LOG_FILTER_ADDR_BROADCAST | FORT_LOG_FILTER_ADDR_LINK_LOCAL);
+    ASSERT_EQ(netbios.remote_ports.from, 137);
+    ASSERT_EQ(netbios.remote_ports.to, 138);
+
+    ConfUtil::logfilters_arr_t badFilters;
+    ASSERT_FALSE(confUtil.parseLogFilters("proto=udp dir=up", badFilters));
+    ASSERT_FALSE(confUtil.parseLogFilters("addr=anycast", badFilters));
+    ASSERT_FALSE(confUtil.parseLogFilters("local_port=2-1", badFilters));
+
+    FORT_CONF conf {};
+    conf.log_filters_n = quint8(filters.size());
+    std::copy(filters.constBegin(), filters.constEnd(), conf.log_filters);
+
+    const quint32 ssdpIp = NetUtil::textToIp4("239.255.255.250");
+    const quint8 ssdpClasses = fort_conf_log_filter_addr_classes(&ssdpIp, /*isIPv6=*/false);
+    ASSERT_EQ(ssdpClasses, FORT_LOG_FILTER_ADDR_MULTICAST);
+
+    ASSERT_EQ(fort_conf_log_filter_find(&conf, /*inbound=*/true, 17, 1900, 5000, ssdpClasses), 0);
+    ASSERT_EQ(fort_conf_log_filter_find(&conf, /*inbound=*/false, 17, 1900, 5000, ssdpClasses), -1);
+    ASSERT_EQ(fort_conf_log_filter_find(&conf, /*inbound=*/true, 6, 1900, 5000, ssdpClasses), -1);
+
+    const quint32 hostIp = NetUtil::textToIp4("192.168.1.1");
+    ASSERT_EQ(fort_conf_log_filter_addr_classes(&hostIp, /*isIPv6=*/false), 0);
+
+    ASSERT_EQ(fort_conf_log_filter_find(&conf, /*inbound=*/false, 17, 5000, 138,
+                      FORT_LOG_FILTER_ADDR_BROADCAST),
+            1);
+    ASSERT_EQ(fort_conf_log_filter_find(&conf, /*inbound=*/false, 17, 5000, 138, 0), -1);
+}
+
+TEST_F(ConfUtilTest, udpLightPorts)
+{
+    ConfUtil confUtil;
+
+    ruleports_arr_t ports;
+    ASSERT_TRUE(confUtil.parseUdpLightPorts("53,123,5353", ports));
+    ASSERT_EQ(ports.size(), 3);
+
+    FORT_CONF conf {};
+    conf.udp_light_ports_n = quint8(ports.size());
+    std::copy(ports.constBegin(), ports.constEnd(), conf.udp_light_ports);
+
+    ASSERT_TRUE(fort_conf_udp_light_port(&conf, 53));
+    ASSERT_TRUE(fort_conf_udp_light_port(&conf, 5353));
+    ASSERT_FALSE(fort_conf_udp_light_port(&conf, 443));
+
+    ruleports_arr_t badPorts;
+    ASSERT_FALSE(confUtil.parseUdpLightPorts("53,x", badPorts));
+
+    ruleports_arr_t manyPorts;
+    ASSERT_FALSE(confUtil.parseUdpLightPorts("1,3,5,7,9,11,13,15,17", manyPorts));
+}
+
+TEST_F(ConfUtilTest, fileIdCmp)
+{
+    FORT_FILE_ID a {};
+    FORT_FILE_ID b {};
+
+    a.volume_serial = 1;
+    b.volume_serial = 2;
+    ASSERT_LT(fort_conf_file_id_cmp(&a, &b), 0);
+
+    b.volume_serial = 1;
+    ASSERT_EQ(fort_conf_file_id_cmp(&a, &b), 0);
+
+    // The ids' bytes are unsigned
+    a.id[0] = 0x7F;
+    b.id[0] = 0x80;
+    ASSERT_LT(fort_conf_file_id_cmp(&a, &b), 0);
+    ASSERT_GT(fort_conf_file_id_cmp(&b, &a), 0);
+}
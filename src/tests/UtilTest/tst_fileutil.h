@@ -39,6 +39,32 @@ TEST_F(FileUtilTest, paths)
     ASSERT_EQ(FileUtil::pathToKernelPath(path, /*lower=*/false), kernelPath);
 }
 
+TEST_F(FileUtilTest, driveKernelNamesCache)
+{
+    QStringList kernelNames = FileUtil::driveKernelNames(FileUtil::driveMask());
+    ASSERT_EQ(kernelNames.size(), 26);
+
+    // X:
+    kernelNames[23] = "\\Device\\TestVolume9";
+    // Y: of the longer name with the same prefix
+    kernelNames[24] = "\\Device\\TestVolume90";
+
+    FileUtil::setDriveKernelNames(kernelNames);
+
+    ASSERT_EQ(FileUtil::driveToKernelName("X:"), "\\Device\\TestVolume9");
+    ASSERT_EQ(FileUtil::kernelNameToDrive(QString("\\device\\testvolume90")), "Y:");
+
+    ASSERT_EQ(FileUtil::kernelPathToPath("\\Device\\TestVolume9\\test\\"), "X:\\test\\");
+    ASSERT_EQ(FileUtil::kernelPathToPath("\\DEVICE\\TESTVOLUME90\\test"), "Y:\\test");
+    ASSERT_EQ(FileUtil::kernelPathToPath("\\Device\\TestVolume99\\test"),
+            "\\Device\\TestVolume99\\test");
+
+    ASSERT_EQ(FileUtil::pathToKernelPath("X:/test", /*lower=*/false),
+            "\\Device\\TestVolume9\\test");
+
+    FileUtil::setDriveKernelNames({});
+}
+
 TEST_F(FileUtilTest, mupPath)
 {
     const QString path(R"(\device\mup\vmware-host\shared folders\d\test.exe)");
@@ -3,6 +3,7 @@
 #include "tst_ioccontainer.h"
 #include "tst_netutil.h"
 #include "tst_stringutil.h"
+#include "tst_zonebench.h"
 
 #include <QCoreApplication>
 
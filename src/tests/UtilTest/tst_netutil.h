@@ -5,6 +5,7 @@
 
 #include <googletest.h>
 
+#include <hostinfo/dnsclientwatcher.h>
 #include <task/taskzonedownloader.h>
 #include <util/fileutil.h>
 #include <util/net/iprange.h>
@@ -22,6 +23,16 @@ void NetUtilTest::SetUp() { }
 
 void NetUtilTest::TearDown() { }
 
+TEST_F(NetUtilTest, dnsQueryResults)
+{
+    const QStringList addresses = DnsClientWatcher::parseQueryResults(
+            "type:  5 edge.example.net;::ffff:192.0.2.1;::ffff:192.0.2.2;2001:db8::1;");
+
+    ASSERT_EQ(addresses, QStringList({ "192.0.2.1", "192.0.2.2", "2001:db8::1" }));
+
+    ASSERT_TRUE(DnsClientWatcher::parseQueryResults("type:  5 alias.example.net;").isEmpty());
+}
+
 TEST_F(NetUtilTest, ip4Text)
 {
     const QString ip4Str("172.16.0.1");
@@ -56,6 +67,16 @@ TEST_F(NetUtilTest, ip6Bytes02)
     ASSERT_EQ(ip.addr32[3], 0x232a56a1);
 }
 
+TEST_F(NetUtilTest, ptrQueryName)
+{
+    ASSERT_EQ(NetUtil::ptrQueryName("192.0.2.10"), QString("10.2.0.192.in-addr.arpa"));
+
+    ASSERT_EQ(NetUtil::ptrQueryName("2001:db8::567:89ab"),
+            QString("b.a.9.8.7.6.5.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.0.8.b.d.0.1.0.0.2.ip6.arpa"));
+
+    ASSERT_TRUE(NetUtil::ptrQueryName("192.0.2").isEmpty());
+}
+
 TEST_F(NetUtilTest, ip6Mask01)
 {
     const ip6_addr_t ip = NetUtil::applyIp6Mask(NetUtil::textToIp6("::2"), 126);
@@ -113,6 +134,23 @@ TEST_F(NetUtilTest, ip4Ranges)
         ASSERT_EQ(ipPair1.from, NetUtil::textToIp4("10.0.0.0"));
         ASSERT_EQ(ipPair1.to, NetUtil::textToIp4("10.0.2.0"));
     }
+
+    // Merge ranges of the same start and duplicate addresses
+    {
+        ASSERT_TRUE(ipRange.fromText("10.0.0.0/8\n"
+                                     "10.0.0.0/24\n"
+                                     "10.0.0.1\n"
+                                     "127.0.0.1\n"
+                                     "127.0.0.1\n"));
+        ASSERT_EQ(ipRange.ip4Size(), 1);
+        ASSERT_EQ(ipRange.pair4Size(), 1);
+
+        const Ip4Pair &ipPair1 = ipRange.pair4At(0);
+        ASSERT_EQ(ipPair1.from, NetUtil::textToIp4("10.0.0.0"));
+        ASSERT_EQ(ipPair1.to, NetUtil::textToIp4("10.255.255.255"));
+
+        ASSERT_EQ(ipRange.ip4At(0), NetUtil::textToIp4("127.0.0.1"));
+    }
 }
 
 TEST_F(NetUtilTest, ip6Ranges)
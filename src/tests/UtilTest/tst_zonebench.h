@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+#include <QDebug>
+#include <QRandomGenerator>
+
+#include <googletest.h>
+
+#include <task/taskzonedownloader.h>
+#include <util/conf/confutil.h>
+#include <util/net/iprange.h>
+
+#ifdef Q_OS_WIN
+#    include <qt_windows.h>
+
+#    include <psapi.h>
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int benchIp4Lines = 500000;
+constexpr int benchIp6Lines = 200000;
+
+const char *const benchIp4Pattern = "^\\D*([\\d./-]{7,})"; // of the "gen" zone type
+const char *const benchIp6Pattern = "^\\s*([\\da-f:/-]{2,})";
+
+qint64 peakMemorySize()
+{
+#ifdef Q_OS_WIN
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+        return qint64(pmc.PeakWorkingSetSize);
+#endif
+    return -1;
+}
+
+struct BenchStage
+{
+    BenchStage() : peakSize(peakMemorySize()), begin(Clock::now()) { }
+
+    void print(const char *name, qint64 dataSize) const;
+
+    const qint64 peakSize;
+    const Clock::time_point begin;
+};
+
+// The peak's growth is process-wide, on top of the previous stages' data
+void BenchStage::print(const char *name, qint64 dataSize) const
+{
+    const qint64 nsec =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count();
+
+    const double mbPerSec =
+            double(dataSize) * 1e9 / double(std::max<qint64>(nsec, 1)) / (1024 * 1024);
+
+    const qint64 peakSizeNow = peakMemorySize();
+    const QString peak = (peakSizeNow < 0)
+            ? QString("n/a")
+            : QString("+%1 KiB").arg((peakSizeNow - peakSize) / 1024);
+
+    qDebug().noquote() << QString("%1 [%2 bytes]: %3 msec, %4 MB/s, peak memory %5")
+                                  .arg(name)
+                                  .arg(dataSize)
+                                  .arg(nsec / (1000 * 1000))
+                                  .arg(mbPerSec, 0, 'f', 1)
+                                  .arg(peak);
+}
+
+QString ip4Text(quint32 ip)
+{
+    return QString("%1.%2.%3.%4")
+            .arg(ip >> 24)
+            .arg((ip >> 16) & 0xFF)
+            .arg((ip >> 8) & 0xFF)
+            .arg(ip & 0xFF);
+}
+
+// The addresses, networks and ranges, like the BGP tables' & blocklists' lines
+QString benchIp4Text(int linesCount)
+{
+    QRandomGenerator rand(1);
+
+    QString text;
+    text.reserve(linesCount * 24);
+
+    for (int i = 0; i < linesCount; ++i) {
+        const quint32 ip = rand.bounded(0x01000000U, 0xE0000000U);
+
+        switch (i % 4) {
+        case 0:
+            text += ip4Text(ip);
+            break;
+        case 1:
+            text += ip4Text(ip & 0xFFFFFF00) + "/24";
+            break;
+        case 2:
+            text += ip4Text(ip & 0xFFFFF000) + "/20";
+            break;
+        case 3:
+            text += ip4Text(ip) + '-' + ip4Text(ip + rand.bounded(1U, 1024U));
+            break;
+        }
+
+        text += '\n';
+
+        if ((i % 64) == 0) {
+            text += "# comment\n";
+        }
+    }
+
+    return text;
+}
+
+QString benchIp6Text(int linesCount)
+{
+    QRandomGenerator rand(2);
+
+    QString text;
+    text.reserve(linesCount * 32);
+
+    for (int i = 0; i < linesCount; ++i) {
+        const QString net = QString("2001:%1:%2")
+                                    .arg(rand.bounded(0x10000U), 0, 16)
+                                    .arg(rand.bounded(0x10000U), 0, 16);
+
+        switch (i % 3) {
+        case 0:
+            text += net + "::" + QString::number(rand.bounded(1U, 0x10000U), 16);
+            break;
+        case 1:
+            text += net + "::/48";
+            break;
+        case 2:
+            text += net + ":" + QString::number(rand.bounded(0x10000U), 16) + "::/64";
+            break;
+        }
+
+        text += '\n';
+    }
+
+    return text;
+}
+
+}
+
+class ZoneBenchTest : public Test
+{
+    // Test interface
+protected:
+    void SetUp();
+    void TearDown();
+
+    // Like the TaskZoneDownloader's refresh: parse, sort/merge & the driver's zone blob
+    void benchZone(const char *name, const QString &text, const QString &pattern);
+};
+
+void ZoneBenchTest::SetUp() { }
+
+void ZoneBenchTest::TearDown() { }
+
+void ZoneBenchTest::benchZone(const char *name, const QString &text, const QString &pattern)
+{
+    const QByteArray stageName(name);
+    const qint64 textSize = text.size(); // Latin-1 chars of the downloaded feed
+
+    TaskZoneDownloader zone;
+    zone.setSort(true);
+    zone.setEmptyNetMask(32);
+    zone.setPattern(pattern);
+
+    // Parse the lines
+    StringViewList list;
+    {
+        const BenchStage stage;
+
+        QString textChecksum;
+        list = zone.parseAddresses(text, textChecksum);
+
+        stage.print((stageName + " parse").constData(), textSize);
+    }
+    ASSERT_FALSE(list.isEmpty());
+
+    // Sort & merge the ranges
+    IpRange ipRange;
+    ipRange.setEmptyNetMask(zone.emptyNetMask());
+    {
+        const BenchStage stage;
+
+        ASSERT_TRUE(ipRange.fromList(list, zone.sort()));
+
+        stage.print((stageName + " sort/merge").constData(), textSize);
+    }
+    ASSERT_FALSE(ipRange.isEmpty());
+
+    // Convert to the driver's zone
+    QByteArray zoneData;
+    {
+        const BenchStage stage;
+
+        ConfUtil confUtil;
+        const int bufSize = confUtil.writeZone(ipRange, zoneData);
+        ASSERT_GT(bufSize, 0);
+
+        zoneData.resize(bufSize);
+
+        stage.print((stageName + " zone blob").constData(), zoneData.size());
+    }
+}
+
+TEST_F(ZoneBenchTest, ip4Zone)
+{
+    benchZone("ip4Zone", benchIp4Text(benchIp4Lines), benchIp4Pattern);
+}
+
+TEST_F(ZoneBenchTest, ip6Zone)
+{
+    benchZone("ip6Zone", benchIp6Text(benchIp6Lines), benchIp6Pattern);
+}
+
+TEST_F(ZoneBenchTest, ipMixedText)
+{
+    // Like the AddressGroup's edited texts, parsed by IpRange::fromText()
+    const QString text = benchIp4Text(benchIp4Lines / 2) + benchIp6Text(benchIp6Lines / 2);
+
+    IpRange ipRange;
+    {
+        const BenchStage stage;
+
+        ASSERT_TRUE(ipRange.fromText(text));
+
+        stage.print("ipMixedText fromText", text.size());
+    }
+    ASSERT_FALSE(ipRange.isEmpty());
+}
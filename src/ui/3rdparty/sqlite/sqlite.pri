@@ -12,6 +12,7 @@ INCLUDEPATH += $$SQLITE_DIR
 
 SOURCES += \
     $$SQLITE_DIR/sqlite3.c \
+    $$PWD/sqlitebackup.cpp \
     $$PWD/sqlitedb.cpp \
     $$PWD/sqlitestmt.cpp
 
@@ -19,6 +20,7 @@ HEADERS += \
     $$SQLITE_DIR/sqlite.h \
     $$SQLITE_DIR/sqlite3.h \
     $$SQLITE_DIR/sqlite_cfg.h \
+    $$PWD/sqlitebackup.h \
     $$PWD/sqlitedb.h \
     $$PWD/sqlitestmt.h \
     $$PWD/sqlitetypes.h
@@ -0,0 +1,76 @@
+#include "sqlitebackup.h"
+
+#include <sqlite.h>
+
+SqliteBackup::SqliteBackup(SqliteDb *sourceDb, const QString &destFilePath) :
+    m_sourceDb(sourceDb), m_destDb(destFilePath)
+{
+}
+
+SqliteBackup::~SqliteBackup()
+{
+    finish();
+}
+
+int SqliteBackup::remainingPages() const
+{
+    return m_backup ? sqlite3_backup_remaining(m_backup) : 0;
+}
+
+int SqliteBackup::pageCount() const
+{
+    return m_backup ? sqlite3_backup_pagecount(m_backup) : 0;
+}
+
+bool SqliteBackup::open()
+{
+    if (!m_destDb.open())
+        return false;
+
+    m_backup = sqlite3_backup_init(m_destDb.db(), "main", m_sourceDb->db(), "main");
+
+    return m_backup != nullptr;
+}
+
+void SqliteBackup::finish()
+{
+    if (m_backup) {
+        sqlite3_backup_finish(m_backup);
+        m_backup = nullptr;
+    }
+
+    m_destDb.close();
+}
+
+bool SqliteBackup::step(int pageCount)
+{
+    if (!m_backup)
+        return false;
+
+    const int res = sqlite3_backup_step(m_backup, pageCount);
+
+    switch (res) {
+    case SQLITE_DONE:
+        m_done = true;
+        finish();
+        break;
+    case SQLITE_OK:
+    case SQLITE_BUSY:
+    case SQLITE_LOCKED:
+        break; // continue by the next step
+    default:
+        m_errorCode = res;
+        finish();
+        return false;
+    }
+
+    return true;
+}
+
+QString SqliteBackup::errorMessage() const
+{
+    if (m_errorCode != 0)
+        return QString::fromUtf8(sqlite3_errstr(m_errorCode));
+
+    return m_destDb.errorMessage();
+}
@@ -0,0 +1,45 @@
+#ifndef SQLITEBACKUP_H
+#define SQLITEBACKUP_H
+
+#include <QString>
+
+#include <util/classhelpers.h>
+
+#include "sqlitedb.h"
+
+struct sqlite3_backup;
+
+// Online backup of the source DB's main schema by the pages' steps.
+// The source connection can be used between the steps; the backup is restarted by the next step,
+// when the source DB is changed by another connection.
+class SqliteBackup
+{
+public:
+    explicit SqliteBackup(SqliteDb *sourceDb, const QString &destFilePath);
+    ~SqliteBackup();
+    CLASS_DELETE_COPY_MOVE(SqliteBackup)
+
+    bool isDone() const { return m_done; }
+
+    int remainingPages() const;
+    int pageCount() const;
+
+    bool open();
+    void finish();
+
+    // Copies the pages, -1 for all; returns false on error
+    bool step(int pageCount = -1);
+
+    QString errorMessage() const;
+
+private:
+    bool m_done = false;
+    int m_errorCode = 0;
+
+    SqliteDb *m_sourceDb = nullptr;
+    SqliteDb m_destDb;
+
+    sqlite3_backup *m_backup = nullptr;
+};
+
+#endif // SQLITEBACKUP_H
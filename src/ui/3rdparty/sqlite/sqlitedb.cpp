@@ -8,6 +8,7 @@
 
 #include <sqlite.h>
 
+#include "sqlitebackup.h"
 #include "sqlitestmt.h"
 
 namespace {
@@ -21,6 +22,8 @@ const char *const defaultSqlPragmas = "PRAGMA journal_mode = WAL;"
 
 const QString ftsTableSuffix = "_fts";
 
+constexpr int STMTS_CACHE_MAX_COUNT = 128;
+
 QAtomicInt g_sqliteInitCount;
 
 bool removeDbFile(const QString &filePath)
@@ -58,6 +61,8 @@ QString makeTriggerColumnNames(
 SqliteDb::SqliteDb(const QString &filePath, quint32 openFlags) :
     m_openFlags(openFlags != 0 ? openFlags : OpenDefaultReadWrite), m_filePath(filePath)
 {
+    m_stmts.setMaxCost(STMTS_CACHE_MAX_COUNT);
+
     if (g_sqliteInitCount++ == 0) {
         sqlite3_initialize();
     }
@@ -104,11 +109,41 @@ bool SqliteDb::vacuum()
     return execute("VACUUM;");
 }
 
+bool SqliteDb::incrementalVacuum(int pageCount)
+{
+    return executeStr(QString("PRAGMA incremental_vacuum(%1);").arg(pageCount));
+}
+
 bool SqliteDb::vacuumInto(const QString &filePath)
 {
     return executeExOk("VACUUM INTO ?1;", { filePath });
 }
 
+bool SqliteDb::backupTo(const QString &filePath, int stepPages, int stepSleepMsecs)
+{
+    removeDbFile(filePath);
+
+    SqliteBackup backup(this, filePath);
+
+    if (!backup.open()) {
+        qCWarning(LC) << "Backup open error:" << backup.errorMessage() << filePath;
+        return false;
+    }
+
+    while (!backup.isDone()) {
+        if (!backup.step(stepPages)) {
+            qCWarning(LC) << "Backup error:" << backup.errorMessage() << filePath;
+            return false;
+        }
+
+        if (!backup.isDone()) {
+            sqlite3_sleep(stepSleepMsecs);
+        }
+    }
+
+    return true;
+}
+
 bool SqliteDb::execute(const char *sql)
 {
     return sqlite3_exec(m_db, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
@@ -125,22 +160,28 @@ QVariant SqliteDb::executeEx(const char *sql, const QVariantList &vars, int resu
 {
     QVariantList list;
 
-    SqliteStmt stmt;
+    SqliteStmt *stmt = this->stmt(sql);
     bool success = false;
 
-    if (prepare(stmt, sql, vars)) {
-        const auto stepRes = stmt.step();
+    if (stmt->isPrepared() && (vars.isEmpty() || stmt->bindVars(vars))) {
+        const auto stepRes = stmt->step();
         success = (stepRes != SqliteStmt::StepError);
 
         // Get result
         if (stepRes == SqliteStmt::StepRow) {
             for (int i = 0; i < resultCount; ++i) {
-                const QVariant v = stmt.columnVar(i);
+                const QVariant v = stmt->columnVar(i);
                 list.append(v);
             }
         }
     }
 
+    // Keep the cached statement ready for the next call
+    if (stmt->isPrepared()) {
+        stmt->reset();
+        stmt->clearBindings();
+    }
+
     if (ok) {
         *ok = success;
     }
@@ -275,11 +316,51 @@ bool SqliteDb::setBusyTimeoutMs(int v)
     return sqlite3_busy_timeout(m_db, v) == SQLITE_OK;
 }
 
+bool SqliteDb::tune(const TuneOptions &opt)
+{
+    const QString sql = QString("PRAGMA cache_size = -%1;"
+                                "PRAGMA mmap_size = %2;"
+                                "PRAGMA wal_autocheckpoint = %3;"
+                                "PRAGMA temp_store = %4;")
+                                .arg(QString::number(opt.cacheSizeKb),
+                                        QString::number(opt.mmapSize),
+                                        QString::number(opt.walAutoCheckpoint),
+                                        opt.tempStoreMemory ? "MEMORY" : "DEFAULT");
+
+    return executeStr(sql);
+}
+
+bool SqliteDb::walCheckpoint()
+{
+    return sqlite3_wal_checkpoint_v2(m_db, nullptr, SQLITE_CHECKPOINT_PASSIVE, nullptr, nullptr)
+            == SQLITE_OK;
+}
+
 QString SqliteDb::getFtsTableName(const QString &tableName)
 {
     return tableName + ftsTableSuffix;
 }
 
+QString SqliteDb::makeFtsFilterMatch(const QString &filter)
+{
+    if (filter.isEmpty())
+        return {};
+
+    const QStringList words = filter.trimmed().split(' ', Qt::SkipEmptyParts);
+    if (words.isEmpty())
+        return {};
+
+    // Quote the words to not parse their punctuation as the FTS5 query syntax
+    QStringList tokens;
+    tokens.reserve(words.size());
+
+    for (const QString &word : words) {
+        tokens.append('"' + QString(word).replace('"', "\"\"") + "\"*");
+    }
+
+    return tokens.join(' ');
+}
+
 QString SqliteDb::migrationOldSchemaName()
 {
     return QLatin1String("old");
@@ -653,21 +734,24 @@ bool SqliteDb::copyTable(
 
 SqliteStmt *SqliteDb::stmt(const char *sql)
 {
-    SqliteStmt *stmt = m_stmts.value(sql);
+    SqliteStmt *stmt = m_stmts.object(sql);
 
     if (!stmt) {
         stmt = new SqliteStmt();
-        stmt->prepare(db(), sql, SqliteStmt::PreparePersistent);
 
         m_stmts.insert(sql, stmt);
     }
 
+    // Retry the failed preparation, e.g. before the migration
+    if (!stmt->isPrepared()) {
+        stmt->prepare(db(), sql, SqliteStmt::PreparePersistent);
+    }
+
     return stmt;
 }
 
 void SqliteDb::clearStmts()
 {
-    qDeleteAll(m_stmts);
     m_stmts.clear();
 }
 
@@ -1,7 +1,7 @@
 #ifndef SQLITEDB_H
 #define SQLITEDB_H
 
-#include <QHash>
+#include <QCache>
 #include <QObject>
 #include <QString>
 #include <QVariant>
@@ -55,6 +55,14 @@ public:
         QVector<FtsTable> ftsTables;
     };
 
+    struct TuneOptions
+    {
+        int cacheSizeKb = 2000; // SQLite's default
+        qint64 mmapSize = 0;
+        int walAutoCheckpoint = 1000; // pages, 0 to checkpoint manually
+        bool tempStoreMemory = true;
+    };
+
     explicit SqliteDb(
             const QString &filePath = QString(), quint32 openFlags = OpenDefaultReadWrite);
     virtual ~SqliteDb();
@@ -74,8 +82,12 @@ public:
     bool detach(const QString &schemaName);
 
     bool vacuum();
+    bool incrementalVacuum(int pageCount = 0);
     bool vacuumInto(const QString &filePath);
 
+    // Online backup by the pages' steps, sleeping between them for the other connections
+    bool backupTo(const QString &filePath, int stepPages = 1024, int stepSleepMsecs = 1);
+
     bool execute(const char *sql);
     bool executeStr(const QString &sql);
 
@@ -112,7 +124,13 @@ public:
 
     bool setBusyTimeoutMs(int v);
 
+    // The connection's options
+    bool tune(const TuneOptions &opt);
+
+    bool walCheckpoint();
+
     static QString getFtsTableName(const QString &tableName);
+    static QString makeFtsFilterMatch(const QString &filter);
 
     static QString migrationOldSchemaName();
     static QString migrationNewSchemaName();
@@ -155,7 +173,7 @@ private:
     sqlite3 *m_db = nullptr;
     QString m_filePath;
 
-    QHash<const char *, SqliteStmt *> m_stmts;
+    QCache<const char *, SqliteStmt> m_stmts; // LRU by the static SQL pointers
 };
 
 #endif // SQLITEDB_H
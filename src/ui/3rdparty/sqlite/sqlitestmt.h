@@ -32,6 +32,8 @@ public:
     bool prepare(struct sqlite3 *db, const char *sql, PrepareFlags flags = PrepareDefault);
     void finalize();
 
+    bool isPrepared() const { return m_stmt != nullptr; }
+
     QString expandedSql() const;
 
     int bindParameterIndex(const QString &name) const;
@@ -1,5 +1,5 @@
 
-QT += gui network widgets
+QT += concurrent gui network widgets
 
 CONFIG += c++2a
 
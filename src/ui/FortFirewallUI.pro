@@ -17,9 +17,12 @@ SOURCES += \
     appinfo/appinfomanager.cpp \
     appinfo/appinfoutil.cpp \
     appinfo/appinfoworker.cpp \
+    appinfo/appversioninfo.cpp \
     conf/addressgroup.cpp \
     conf/app.cpp \
     conf/appgroup.cpp \
+    conf/apppurgejob.cpp \
+    conf/apppurgemanager.cpp \
     conf/confappmanager.cpp \
     conf/confmanager.cpp \
     conf/confzonemanager.cpp \
@@ -89,6 +92,7 @@ SOURCES += \
     form/prog/programeditdialog.cpp \
     form/prog/programscontroller.cpp \
     form/prog/programswindow.cpp \
+    form/stat/pages/activeflowspage.cpp \
     form/stat/pages/connectionspage.cpp \
     form/stat/pages/statbasepage.cpp \
     form/stat/pages/statmainpage.cpp \
@@ -103,15 +107,19 @@ SOURCES += \
     form/zone/zoneswindow.cpp \
     fortmanager.cpp \
     fortsettings.cpp \
+    hostinfo/dnsclientwatcher.cpp \
     hostinfo/hostinfo.cpp \
     hostinfo/hostinfocache.cpp \
-    hostinfo/hostinfojob.cpp \
     hostinfo/hostinfomanager.cpp \
     log/logbuffer.cpp \
     log/logentry.cpp \
     log/logentryblocked.cpp \
     log/logentryblockedip.cpp \
+    log/logentrydropped.cpp \
+    log/logentryflowstat.cpp \
+    log/logentrypathdef.cpp \
     log/logentryprocnew.cpp \
+    log/logentryquota.cpp \
     log/logentrystattraf.cpp \
     log/logentrytime.cpp \
     log/logmanager.cpp \
@@ -119,6 +127,8 @@ SOURCES += \
     manager/envmanager.cpp \
     manager/hotkeymanager.cpp \
     manager/logger.cpp \
+    manager/loggerwriter.cpp \
+    manager/metricsmanager.cpp \
     manager/nativeeventfilter.cpp \
     manager/serviceinfomanager.cpp \
     manager/servicemanager.cpp \
@@ -127,6 +137,7 @@ SOURCES += \
     model/applistmodel.cpp \
     model/appstatmodel.cpp \
     model/connblocklistmodel.cpp \
+    model/flowlistmodel.cpp \
     model/policylistmodel.cpp \
     model/servicelistmodel.cpp \
     model/traflistmodel.cpp \
@@ -149,20 +160,31 @@ SOURCES += \
     rpc/windowmanagerfake.cpp \
     stat/askpendingmanager.cpp \
     stat/deleteconnblockjob.cpp \
+    stat/deleteoldtrafjob.cpp \
+    stat/deletetrafjob.cpp \
     stat/logblockedipjob.cpp \
     stat/quotamanager.cpp \
+    stat/statappidcache.cpp \
+    stat/statbackupjob.cpp \
     stat/statblockbasejob.cpp \
     stat/statblockmanager.cpp \
     stat/statblockworker.cpp \
+    stat/statexportjob.cpp \
+    stat/statexportmanager.cpp \
     stat/statmanager.cpp \
     stat/statsql.cpp \
+    stat/stattopapps.cpp \
+    stat/stattrafbasejob.cpp \
+    stat/stattrafjob.cpp \
     task/taskdownloader.cpp \
     task/taskeditinfo.cpp \
     task/taskinfo.cpp \
+    task/taskinfopolicysync.cpp \
     task/taskinfoupdatechecker.cpp \
     task/taskinfozonedownloader.cpp \
     task/tasklistmodel.cpp \
     task/taskmanager.cpp \
+    task/taskpolicysync.cpp \
     task/taskupdatechecker.cpp \
     task/taskworker.cpp \
     task/taskzonedownloader.cpp \
@@ -170,9 +192,11 @@ SOURCES += \
     user/usersettings.cpp \
     util/conf/addressrange.cpp \
     util/conf/appparseoptions.cpp \
+    util/conf/confevaluator.cpp \
     util/conf/confutil.cpp \
     util/dateutil.cpp \
     util/device.cpp \
+    util/etwutil.cpp \
     util/fileutil.cpp \
     util/guiutil.cpp \
     util/iconcache.cpp \
@@ -198,6 +222,7 @@ SOURCES += \
     util/startuputil.cpp \
     util/stringutil.cpp \
     util/textareautil.cpp \
+    util/triggerscheduler.cpp \
     util/triggertimer.cpp \
     util/variantutil.cpp \
     util/window/basewindowstatewatcher.cpp \
@@ -217,9 +242,12 @@ HEADERS += \
     appinfo/appinfomanager.h \
     appinfo/appinfoutil.h \
     appinfo/appinfoworker.h \
+    appinfo/appversioninfo.h \
     conf/addressgroup.h \
     conf/app.h \
     conf/appgroup.h \
+    conf/apppurgejob.h \
+    conf/apppurgemanager.h \
     conf/confappmanager.h \
     conf/confmanager.h \
     conf/confzonemanager.h \
@@ -232,9 +260,11 @@ HEADERS += \
     control/control.h \
     control/controlmanager.h \
     control/controlworker.h \
+    driver/devicestats.h \
     driver/drivercommon.h \
     driver/drivermanager.h \
     driver/driverworker.h \
+    driver/flowinfo.h \
     form/basecontroller.h \
     form/controls/appinforow.h \
     form/controls/checkspincombo.h \
@@ -289,6 +319,7 @@ HEADERS += \
     form/prog/programeditdialog.h \
     form/prog/programscontroller.h \
     form/prog/programswindow.h \
+    form/stat/pages/activeflowspage.h \
     form/stat/pages/connectionspage.h \
     form/stat/pages/statbasepage.h \
     form/stat/pages/statmainpage.h \
@@ -305,15 +336,20 @@ HEADERS += \
     fortcompat.h \
     fortmanager.h \
     fortsettings.h \
+    hostinfo/dnsclientwatcher.h \
     hostinfo/hostinfo.h \
     hostinfo/hostinfocache.h \
-    hostinfo/hostinfojob.h \
     hostinfo/hostinfomanager.h \
     log/logbuffer.h \
     log/logentry.h \
     log/logentryblocked.h \
     log/logentryblockedip.h \
+    log/logentrydropped.h \
+    log/logentryflowstat.h \
+    log/logentrypathdef.h \
     log/logentryprocnew.h \
+    log/logentryquota.h \
+    log/logentryshaperstat.h \
     log/logentrystattraf.h \
     log/logentrytime.h \
     log/logmanager.h \
@@ -321,6 +357,8 @@ HEADERS += \
     manager/envmanager.h \
     manager/hotkeymanager.h \
     manager/logger.h \
+    manager/loggerwriter.h \
+    manager/metricsmanager.h \
     manager/nativeeventfilter.h \
     manager/serviceinfomanager.h \
     manager/servicemanager.h \
@@ -329,6 +367,7 @@ HEADERS += \
     model/applistmodel.h \
     model/appstatmodel.h \
     model/connblocklistmodel.h \
+    model/flowlistmodel.h \
     model/policylistmodel.h \
     model/servicelistmodel.h \
     model/traflistmodel.h \
@@ -351,20 +390,31 @@ HEADERS += \
     rpc/windowmanagerfake.h \
     stat/askpendingmanager.h \
     stat/deleteconnblockjob.h \
+    stat/deleteoldtrafjob.h \
+    stat/deletetrafjob.h \
     stat/logblockedipjob.h \
     stat/quotamanager.h \
+    stat/statappidcache.h \
+    stat/statbackupjob.h \
     stat/statblockbasejob.h \
     stat/statblockmanager.h \
     stat/statblockworker.h \
+    stat/statexportjob.h \
+    stat/statexportmanager.h \
     stat/statmanager.h \
     stat/statsql.h \
+    stat/stattopapps.h \
+    stat/stattrafbasejob.h \
+    stat/stattrafjob.h \
     task/taskdownloader.h \
     task/taskeditinfo.h \
     task/taskinfo.h \
+    task/taskinfopolicysync.h \
     task/taskinfoupdatechecker.h \
     task/taskinfozonedownloader.h \
     task/tasklistmodel.h \
     task/taskmanager.h \
+    task/taskpolicysync.h \
     task/taskupdatechecker.h \
     task/taskworker.h \
     task/taskzonedownloader.h \
@@ -374,9 +424,11 @@ HEADERS += \
     util/conf/addressrange.h \
     util/conf/appparseoptions.h \
     util/conf/confappswalker.h \
+    util/conf/confevaluator.h \
     util/conf/confutil.h \
     util/dateutil.h \
     util/device.h \
+    util/etwutil.h \
     util/fileutil.h \
     util/guiutil.h \
     util/iconcache.h \
@@ -403,6 +455,7 @@ HEADERS += \
     util/startuputil.h \
     util/stringutil.h \
     util/textareautil.h \
+    util/triggerscheduler.h \
     util/triggertimer.h \
     util/variantutil.h \
     util/window/basewindowstatewatcher.h \
@@ -27,5 +27,9 @@ void AppIconJob::loadAppIcon(AppInfoManager *manager)
 
 void AppIconJob::emitFinished(AppInfoManager *manager)
 {
-    emit manager->lookupIconFinished(appPath(), m_image);
+    const QStringList appPaths = manager->finishLookupIcon(iconId());
+
+    for (const QString &path : appPaths) {
+        emit manager->lookupIconFinished(path, m_image);
+    }
 }
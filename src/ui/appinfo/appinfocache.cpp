@@ -3,14 +3,50 @@
 #include <QIcon>
 #include <QImage>
 
+#include <user/iniuser.h>
+#include <user/usersettings.h>
 #include <util/iconcache.h>
 #include <util/ioc/ioccontainer.h>
 
 #include "appinfomanager.h"
 
-AppInfoCache::AppInfoCache(QObject *parent) : QObject(parent), m_cache(1000)
+namespace {
+
+constexpr int APP_INFO_CACHE_MAX_COST = 4 * 1024 * 1024; // bytes
+constexpr int APP_INFO_RECENT_COUNT = 500;
+constexpr qint64 APP_INFO_CHECK_MSECS = 30 * 1000;
+constexpr int APP_ICON_CACHE_SIZE_MB_MAX = 1024;
+
+int appInfoCost(const QString &appPath, const AppInfo &info)
 {
-    connect(&m_triggerTimer, &QTimer::timeout, this, &AppInfoCache::cacheChanged);
+    const qsizetype textLength = appPath.size() + info.altPath.size()
+            + info.fileDescription.size() + info.companyName.size() + info.productName.size()
+            + info.productVersion.size();
+
+    return int(sizeof(AppInfo) + textLength * sizeof(QChar));
+}
+
+qsizetype iconCost(const QPixmap &pixmap)
+{
+    return qMax(qsizetype(pixmap.width()) * pixmap.height() * pixmap.depth() / 8, qsizetype(1));
+}
+
+int iconCacheSizeMb()
+{
+    // The Service doesn't show the icons
+    const auto userSettings = IoC()->resolve<UserSettings>();
+    const int sizeMb = userSettings ? userSettings->iniUser().progIconCacheSizeMb() : 1;
+
+    return qBound(1, sizeMb, APP_ICON_CACHE_SIZE_MB_MAX);
+}
+
+}
+
+AppInfoCache::AppInfoCache(QObject *parent) : QObject(parent), m_cache(APP_INFO_CACHE_MAX_COST)
+{
+    m_checkTimer.start();
+
+    connect(&m_triggerTimer, &TriggerTimer::timeout, this, &AppInfoCache::cacheChanged);
 }
 
 void AppInfoCache::setUp()
@@ -21,6 +57,10 @@ void AppInfoCache::setUp()
             &AppInfoCache::handleFinishedInfoLookup);
     connect(appInfoManager, &AppInfoManager::lookupIconFinished, this,
             &AppInfoCache::handleFinishedIconLookup);
+
+    m_iconCache.setMaxCost(qsizetype(iconCacheSizeMb()) * 1024 * 1024);
+
+    loadRecentInfos();
 }
 
 void AppInfoCache::tearDown()
@@ -37,22 +77,46 @@ QString AppInfoCache::appName(const QString &appPath)
     return appInfo.fileDescription;
 }
 
-QIcon AppInfoCache::appIcon(const QString &appPath, const QString &nullIconPath)
+QIcon AppInfoCache::appIcon(const QString &appPath, const QString &nullIconPath, int size)
+{
+    return appPixmap(appPath, nullIconPath, size);
+}
+
+void AppInfoCache::prefetchAppIcon(const QString &appPath)
 {
-    QPixmap pixmap;
-    if (IconCache::find(appPath, &pixmap))
-        return pixmap;
+    if (appPath.isEmpty())
+        return;
+
+    appPixmap(appPath, QString(), /*size=*/0);
+}
 
+QPixmap AppInfoCache::appPixmap(const QString &appPath, const QString &nullIconPath, int size)
+{
     const auto info = appInfo(appPath);
     if (info.isValid()) {
-        IoC<AppInfoManager>()->lookupAppIcon(appPath, info.iconId);
+        const AppIconKey key = { .iconId = info.iconId, .size = size };
+
+        // The apps may share the decoded icon
+        QPixmap pixmap;
+        if (findIcon(key, pixmap)) {
+            if (!pixmap.isNull())
+                return pixmap;
+        } else if (size != 0 && findIcon({ .iconId = info.iconId }, pixmap)) {
+            // Scale the decoded icon once per size
+            if (!pixmap.isNull()) {
+                pixmap = pixmap.scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            }
+
+            insertIcon(key, pixmap);
+
+            if (!pixmap.isNull())
+                return pixmap;
+        } else {
+            IoC<AppInfoManager>()->lookupAppIcon(appPath, info.iconId);
+        }
     }
 
-    pixmap = IconCache::file(!nullIconPath.isEmpty() ? nullIconPath : ":/icons/application.png");
-
-    IconCache::insert(appPath, pixmap);
-
-    return pixmap;
+    return IconCache::file(!nullIconPath.isEmpty() ? nullIconPath : ":/icons/application.png");
 }
 
 AppInfo AppInfoCache::appInfo(const QString &appPath)
@@ -65,10 +129,6 @@ AppInfo AppInfoCache::appInfo(const QString &appPath)
 
     appInfoCached(appPath, appInfo, lookupRequired);
 
-    if (!lookupRequired) {
-        lookupRequired = appInfo.isValid() && appInfo.isFileModified(appPath);
-    }
-
     if (lookupRequired) {
         IoC<AppInfoManager>()->lookupAppInfo(appPath);
     }
@@ -78,46 +138,118 @@ AppInfo AppInfoCache::appInfo(const QString &appPath)
 
 void AppInfoCache::handleFinishedInfoLookup(const QString &appPath, const AppInfo &info)
 {
-    AppInfo *appInfo = m_cache.object(appPath);
-    if (!appInfo)
+    const AppInfoEntry *entry = m_cache.object(appPath);
+    if (!entry)
         return;
 
-    *appInfo = info;
+    if (entry->info.isValid() && entry->info.iconId == info.iconId
+            && entry->info.fileModTime == info.fileModTime)
+        return; // the file was not modified
+
+    if (entry->info.isValid()) {
+        removeIcons(entry->info.iconId); // the icon may be deleted from DB
+    }
 
-    IconCache::remove(appPath); // invalidate cached icon
+    insertCacheEntry(appPath, info, m_checkTimer.elapsed());
 
     emitCacheChanged();
 }
 
 void AppInfoCache::handleFinishedIconLookup(const QString &appPath, const QImage &image)
 {
-    if (image.isNull())
+    const AppInfoEntry *entry = m_cache.object(appPath);
+    if (!entry || !entry->info.isValid())
         return;
 
-    IconCache::insert(appPath, QPixmap::fromImage(image)); // update cached icon
+    const AppIconKey key = { .iconId = entry->info.iconId };
+    if (m_iconCache.contains(key))
+        return; // reported for the other app, sharing the icon
 
-    emitCacheChanged();
+    // The null pixmap is cached too, not to look it up on each paint
+    insertIcon(key, QPixmap::fromImage(image));
+
+    if (!image.isNull()) {
+        emitCacheChanged();
+    }
+}
+
+void AppInfoCache::loadRecentInfos()
+{
+    QStringList appPaths;
+    QList<AppInfo> appInfos;
+
+    IoC<AppInfoManager>()->loadRecentInfosFromDb(appPaths, appInfos, APP_INFO_RECENT_COUNT);
+
+    // Not checked yet: the first access re-checks the file by the worker
+    const qint64 checkMsecs = -APP_INFO_CHECK_MSECS;
+
+    for (int i = appPaths.size(); --i >= 0;) {
+        insertCacheEntry(appPaths[i], appInfos[i], checkMsecs);
+    }
 }
 
 void AppInfoCache::appInfoCached(const QString &appPath, AppInfo &info, bool &lookupRequired)
 {
-    AppInfo *cachedInfo = m_cache.object(appPath);
+    const qint64 nowMsecs = m_checkTimer.elapsed();
 
-    if (cachedInfo) {
-        lookupRequired = false;
+    AppInfoEntry *entry = m_cache.object(appPath);
 
-        info = *cachedInfo;
-    } else {
-        lookupRequired = !IoC<AppInfoManager>()->loadInfoFromDb(appPath, info);
+    if (entry) {
+        info = entry->info;
 
-        cachedInfo = new AppInfo();
+        // Compare the file's modification time by the worker, not to block on it
+        lookupRequired = info.isValid() && nowMsecs - entry->checkMsecs >= APP_INFO_CHECK_MSECS;
 
-        if (!lookupRequired) {
-            *cachedInfo = info;
+        if (lookupRequired) {
+            entry->checkMsecs = nowMsecs;
+        }
+    } else {
+        if (!IoC<AppInfoManager>()->loadInfoFromDb(appPath, info)) {
+            info = {};
         }
 
-        m_cache.insert(appPath, cachedInfo, /*cost=*/1);
-        /* cachedInfo may be deleted */
+        lookupRequired = true;
+
+        insertCacheEntry(appPath, info, nowMsecs);
+    }
+}
+
+void AppInfoCache::insertCacheEntry(const QString &appPath, const AppInfo &info, qint64 checkMsecs)
+{
+    auto entry = new AppInfoEntry { .info = info, .checkMsecs = checkMsecs };
+
+    m_cache.insert(appPath, entry, appInfoCost(appPath, info));
+    /* entry may be deleted */
+}
+
+bool AppInfoCache::findIcon(const AppIconKey &key, QPixmap &pixmap)
+{
+    const QPixmap *cachedPixmap = m_iconCache.object(key);
+    if (!cachedPixmap) {
+        ++m_iconCacheMisses;
+        return false;
+    }
+
+    ++m_iconCacheHits;
+
+    pixmap = *cachedPixmap;
+    return true;
+}
+
+void AppInfoCache::insertIcon(const AppIconKey &key, const QPixmap &pixmap)
+{
+    m_iconCache.insert(key, new QPixmap(pixmap), iconCost(pixmap));
+    /* pixmap may be deleted */
+}
+
+void AppInfoCache::removeIcons(qint64 iconId)
+{
+    const QList<AppIconKey> keys = m_iconCache.keys();
+
+    for (const AppIconKey &key : keys) {
+        if (key.iconId == iconId) {
+            m_iconCache.remove(key);
+        }
     }
 }
 
@@ -2,13 +2,28 @@
 #define APPINFOCACHE_H
 
 #include <QCache>
+#include <QElapsedTimer>
 #include <QObject>
+#include <QPixmap>
 
 #include <util/ioc/iocservice.h>
 #include <util/triggertimer.h>
 
 #include "appinfo.h"
 
+struct AppIconKey
+{
+    bool operator==(const AppIconKey &o) const { return iconId == o.iconId && size == o.size; }
+
+    qint64 iconId = 0;
+    int size = 0; // of the scaled pixmap, 0 for the decoded one
+};
+
+inline size_t qHash(const AppIconKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.iconId, key.size);
+}
+
 class AppInfoCache : public QObject, public IocService
 {
     Q_OBJECT
@@ -20,7 +35,14 @@ public:
     void tearDown() override;
 
     QString appName(const QString &appPath);
-    QIcon appIcon(const QString &appPath, const QString &nullIconPath = QString());
+    QIcon appIcon(
+            const QString &appPath, const QString &nullIconPath = QString(), int size = 0);
+
+    // Look up the icons of the rows to be shown
+    void prefetchAppIcon(const QString &appPath);
+
+    qint64 iconCacheHits() const { return m_iconCacheHits; }
+    qint64 iconCacheMisses() const { return m_iconCacheMisses; }
 
     AppInfo appInfo(const QString &appPath);
 
@@ -32,12 +54,36 @@ private slots:
     void handleFinishedIconLookup(const QString &appPath, const QImage &image);
 
 private:
+    struct AppInfoEntry
+    {
+        AppInfo info;
+        qint64 checkMsecs = 0; // of the last lookup, to re-check the file by the worker
+    };
+
+    void loadRecentInfos();
+
     void appInfoCached(const QString &appPath, AppInfo &info, bool &lookupRequired);
 
+    void insertCacheEntry(const QString &appPath, const AppInfo &info, qint64 checkMsecs);
+
+    bool findIcon(const AppIconKey &key, QPixmap &pixmap);
+    void insertIcon(const AppIconKey &key, const QPixmap &pixmap);
+    void removeIcons(qint64 iconId);
+
+    QPixmap appPixmap(const QString &appPath, const QString &nullIconPath, int size);
+
     void emitCacheChanged();
 
 private:
-    QCache<QString, AppInfo> m_cache;
+    qint64 m_iconCacheHits = 0;
+    qint64 m_iconCacheMisses = 0;
+
+    QCache<QString, AppInfoEntry> m_cache;
+
+    // Decoded & scaled icons by their ids, shared by the apps, apart from the QPixmapCache
+    QCache<AppIconKey, QPixmap> m_iconCache;
+
+    QElapsedTimer m_checkTimer;
 
     TriggerTimer m_triggerTimer;
 };
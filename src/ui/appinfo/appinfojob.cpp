@@ -40,5 +40,7 @@ void AppInfoJob::loadAppInfo(AppInfoManager *manager)
 
 void AppInfoJob::emitFinished(AppInfoManager *manager)
 {
+    manager->finishLookupInfo(appPath());
+
     emit manager->lookupInfoFinished(appPath(), m_appInfo);
 }
@@ -11,6 +11,9 @@ class AppInfoJob : public AppBaseJob
 public:
     explicit AppInfoJob(const QString &appPath);
 
+    // The visible rows show the infos before their icons
+    bool isHighPriority() const override { return true; }
+
     void doJob(WorkerObject &worker) override;
     void reportResult(WorkerObject &worker) override;
 
@@ -1,5 +1,6 @@
 #include "appinfomanager.h"
 
+#include <QDateTime>
 #include <QImage>
 #include <QLoggingCategory>
 
@@ -17,12 +18,28 @@ const QLoggingCategory LC("appInfo");
 
 constexpr int DATABASE_USER_VERSION = 5;
 
+const SqliteDb::TuneOptions databaseTuneOptions = {
+    .cacheSizeKb = 2048,
+    .mmapSize = 16 * 1024 * 1024,
+};
+
 constexpr int APP_CACHE_MAX_COUNT = 2000;
 
+constexpr qint64 LOOKUP_INFO_TIMEOUT_MSECS = 30 * 1000;
+
+constexpr int ACCESS_TIME_FLUSH_MSECS = 30 * 1000;
+
 const char *const sqlSelectAppInfo = "SELECT alt_path, file_descr, company_name,"
                                      "    product_name, product_ver, file_mod_time, icon_id"
                                      "  FROM app WHERE path = ?1;";
 
+const char *const sqlSelectAppInfosRecent =
+        "SELECT alt_path, file_descr, company_name,"
+        "    product_name, product_ver, file_mod_time, icon_id, path"
+        "  FROM app"
+        "  ORDER BY access_time DESC"
+        "  LIMIT ?1;";
+
 const char *const sqlUpdateAppAccessTime = "UPDATE app"
                                            "  SET access_time = datetime('now')"
                                            "  WHERE path = ?1;";
@@ -55,12 +72,29 @@ const char *const sqlDeleteIconIfNotUsed = "DELETE FROM icon"
 
 const char *const sqlDeleteApp = "DELETE FROM app WHERE path = ?1;";
 
+void fillAppInfo(SqliteStmt &stmt, AppInfo &appInfo)
+{
+    appInfo.altPath = stmt.columnText(0);
+    appInfo.fileDescription = stmt.columnText(1);
+    appInfo.companyName = stmt.columnText(2);
+    appInfo.productName = stmt.columnText(3);
+    appInfo.productVersion = stmt.columnText(4);
+    appInfo.fileModTime = stmt.columnDateTime(5);
+    appInfo.iconId = stmt.columnInt64(6);
+}
+
 }
 
 AppInfoManager::AppInfoManager(const QString &filePath, QObject *parent, quint32 openFlags) :
-    WorkerManager(parent), m_sqliteDb(new SqliteDb(filePath, openFlags))
+    WorkerManager(parent),
+    m_sqliteDb(new SqliteDb(filePath, openFlags)),
+    m_accessTimer(ACCESS_TIME_FLUSH_MSECS)
 {
     setMaxWorkersCount(1);
+
+    m_accessTimer.setMaxInterval(ACCESS_TIME_FLUSH_MSECS);
+
+    connect(&m_accessTimer, &TriggerTimer::timeout, this, &AppInfoManager::flushAppAccessTimes);
 }
 
 void AppInfoManager::setUp()
@@ -68,6 +102,13 @@ void AppInfoManager::setUp()
     setupDb();
 }
 
+void AppInfoManager::tearDown()
+{
+    m_accessTimer.stop();
+
+    flushAppAccessTimes();
+}
+
 WorkerObject *AppInfoManager::createWorker()
 {
     return new AppInfoWorker(this);
@@ -75,22 +116,85 @@ WorkerObject *AppInfoManager::createWorker()
 
 void AppInfoManager::lookupAppInfo(const QString &appPath)
 {
+    if (!startLookupInfo(appPath))
+        return; // already in flight
+
     enqueueJob(WorkerJobPtr(new AppInfoJob(appPath)));
 }
 
 void AppInfoManager::lookupAppIcon(const QString &appPath, qint64 iconId)
 {
+    if (!startLookupIcon(appPath, iconId))
+        return; // waits for the icon's job
+
     enqueueJob(WorkerJobPtr(new AppIconJob(appPath, iconId)));
 }
 
 void AppInfoManager::checkLookupInfoFinished(const QString &appPath)
 {
+    if (!finishLookupInfo(appPath))
+        return; // not requested by this client
+
     AppInfo appInfo;
     if (loadInfoFromDb(appPath, appInfo)) {
         emit lookupInfoFinished(appPath, appInfo);
     }
 }
 
+void AppInfoManager::flushAppAccessTimes()
+{
+    QMutexLocker locker(&m_mutex);
+
+    updateAppAccessTimes();
+}
+
+bool AppInfoManager::startLookupInfo(const QString &appPath)
+{
+    QMutexLocker locker(&m_lookupMutex);
+
+    const qint64 nowMsecs = QDateTime::currentMSecsSinceEpoch();
+
+    // The timeout re-requests the lookups lost by the RPC
+    const qint64 startMsecs = m_lookupInfoTimes.value(appPath, -LOOKUP_INFO_TIMEOUT_MSECS);
+    if (nowMsecs - startMsecs < LOOKUP_INFO_TIMEOUT_MSECS)
+        return false;
+
+    m_lookupInfoTimes.insert(appPath, nowMsecs);
+
+    return true;
+}
+
+bool AppInfoManager::finishLookupInfo(const QString &appPath)
+{
+    QMutexLocker locker(&m_lookupMutex);
+
+    return m_lookupInfoTimes.remove(appPath);
+}
+
+bool AppInfoManager::startLookupIcon(const QString &appPath, qint64 iconId)
+{
+    QMutexLocker locker(&m_lookupMutex);
+
+    const auto it = m_lookupIconPaths.find(iconId);
+    if (it != m_lookupIconPaths.end()) {
+        if (!it->contains(appPath)) {
+            it->append(appPath);
+        }
+        return false;
+    }
+
+    m_lookupIconPaths.insert(iconId, { appPath });
+
+    return true;
+}
+
+QStringList AppInfoManager::finishLookupIcon(qint64 iconId)
+{
+    QMutexLocker locker(&m_lookupMutex);
+
+    return m_lookupIconPaths.take(iconId);
+}
+
 bool AppInfoManager::loadInfoFromFs(const QString &appPath, AppInfo &appInfo)
 {
     return AppInfoUtil::getInfo(appPath, appInfo);
@@ -118,13 +222,7 @@ bool AppInfoManager::loadInfoFromDb(const QString &appPath, AppInfo &appInfo)
     if (stmt.step() != SqliteStmt::StepRow)
         return false;
 
-    appInfo.altPath = stmt.columnText(0);
-    appInfo.fileDescription = stmt.columnText(1);
-    appInfo.companyName = stmt.columnText(2);
-    appInfo.productName = stmt.columnText(3);
-    appInfo.productVersion = stmt.columnText(4);
-    appInfo.fileModTime = stmt.columnDateTime(5);
-    appInfo.iconId = stmt.columnInt64(6);
+    fillAppInfo(stmt, appInfo);
 
     // Update last access time
     updateAppAccessTime(appPath);
@@ -132,9 +230,56 @@ bool AppInfoManager::loadInfoFromDb(const QString &appPath, AppInfo &appInfo)
     return true;
 }
 
+void AppInfoManager::loadRecentInfosFromDb(
+        QStringList &appPaths, QList<AppInfo> &appInfos, int limitCount)
+{
+    QMutexLocker locker(&m_mutex);
+
+    SqliteStmt stmt;
+    if (!stmt.prepare(sqliteDb()->db(), sqlSelectAppInfosRecent))
+        return;
+
+    stmt.bindInt(1, limitCount);
+
+    while (stmt.step() == SqliteStmt::StepRow) {
+        AppInfo appInfo;
+        fillAppInfo(stmt, appInfo);
+
+        appPaths.append(stmt.columnText(7));
+        appInfos.append(appInfo);
+    }
+}
+
 void AppInfoManager::updateAppAccessTime(const QString &appPath)
 {
-    sqliteDb()->executeEx(sqlUpdateAppAccessTime, QVariantList() << appPath);
+    const bool wasEmpty = m_accessedAppPaths.isEmpty();
+
+    m_accessedAppPaths.insert(appPath);
+
+    // Called by the worker too
+    if (wasEmpty) {
+        QMetaObject::invokeMethod(&m_accessTimer, &TriggerTimer::startTrigger);
+    }
+}
+
+void AppInfoManager::updateAppAccessTimes()
+{
+    if (m_accessedAppPaths.isEmpty())
+        return;
+
+    sqliteDb()->beginTransaction();
+
+    SqliteStmt *stmt = sqliteDb()->stmt(sqlUpdateAppAccessTime);
+
+    for (const QString &appPath : std::as_const(m_accessedAppPaths)) {
+        stmt->bindText(1, appPath);
+        stmt->step();
+        stmt->reset();
+    }
+
+    sqliteDb()->commitTransaction();
+
+    m_accessedAppPaths.clear();
 }
 
 bool AppInfoManager::setupDb()
@@ -157,6 +302,8 @@ bool AppInfoManager::setupDb()
         return false;
     }
 
+    sqliteDb()->tune(databaseTuneOptions);
+
     return true;
 }
 
@@ -257,6 +404,9 @@ void AppInfoManager::deleteOldApps(int limitCount)
     QStringList appPaths;
     QHash<qint64, int> iconIds;
 
+    // Order by the pending access times
+    updateAppAccessTimes();
+
     // Get old app info list
     getOldAppsAndIcons(appPaths, iconIds, limitCount);
 
@@ -1,12 +1,15 @@
 #ifndef APPINFOMANAGER_H
 #define APPINFOMANAGER_H
 
+#include <QHash>
 #include <QMutex>
+#include <QSet>
 
 #include <sqlite/sqlitetypes.h>
 
 #include <util/classhelpers.h>
 #include <util/ioc/iocservice.h>
+#include <util/triggertimer.h>
 #include <util/worker/workermanager.h>
 
 #include "appinfo.h"
@@ -23,11 +26,13 @@ public:
     SqliteDb *sqliteDb() const { return m_sqliteDb.data(); }
 
     void setUp() override;
+    void tearDown() override;
 
     bool loadInfoFromFs(const QString &appPath, AppInfo &appInfo);
     QImage loadIconFromFs(const QString &appPath, const AppInfo &appInfo);
 
     bool loadInfoFromDb(const QString &appPath, AppInfo &appInfo);
+    void loadRecentInfosFromDb(QStringList &appPaths, QList<AppInfo> &appInfos, int limitCount);
     QImage loadIconFromDb(qint64 iconId);
 
     bool saveToDb(const QString &appPath, AppInfo &appInfo, const QImage &appIcon);
@@ -35,6 +40,12 @@ public:
     void deleteAppInfo(const QString &appPath, const AppInfo &appInfo);
     void deleteOldApps(int limitCount = 0);
 
+    bool startLookupInfo(const QString &appPath);
+    bool finishLookupInfo(const QString &appPath);
+
+    bool startLookupIcon(const QString &appPath, qint64 iconId);
+    QStringList finishLookupIcon(qint64 iconId);
+
 signals:
     void lookupInfoFinished(const QString &appPath, const AppInfo &appInfo);
     void lookupIconFinished(const QString &appPath, const QImage &image);
@@ -45,6 +56,8 @@ public slots:
 
     void checkLookupInfoFinished(const QString &appPath);
 
+    void flushAppAccessTimes();
+
 protected:
     WorkerObject *createWorker() override;
 
@@ -53,6 +66,8 @@ protected:
 private:
     bool setupDb();
 
+    void updateAppAccessTimes();
+
     void saveAppIcon(const QImage &appIcon, QVariant &iconId, bool &ok);
     void saveAppInfo(
             const QString &appPath, const AppInfo &appInfo, const QVariant &iconId, bool &ok);
@@ -72,6 +87,13 @@ private:
 private:
     SqliteDbPtr m_sqliteDb;
     QMutex m_mutex;
+
+    QSet<QString> m_accessedAppPaths; // pending updates of the access times
+    TriggerTimer m_accessTimer;
+
+    QMutex m_lookupMutex;
+    QHash<QString, qint64> m_lookupInfoTimes; // in-flight lookups by app paths
+    QHash<qint64, QStringList> m_lookupIconPaths; // waiting app paths by icon ids
 };
 
 #endif // APPINFOMANAGER_H
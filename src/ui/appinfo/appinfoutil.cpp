@@ -14,6 +14,7 @@
 #include <util/osutil.h>
 
 #include "appinfo.h"
+#include "appversioninfo.h"
 
 namespace {
 
@@ -115,19 +116,8 @@ bool extractVersionInfo(const QString &appPath, AppInfo &appInfo)
         if (!VerQueryValueA(infoData, "\\", (LPVOID *) &ffi, (PUINT) &dummy))
             return false;
 
-        const DWORD leftMost = HIWORD(ffi->dwProductVersionMS);
-        const DWORD secondLeft = LOWORD(ffi->dwProductVersionMS);
-        const DWORD secondRight = HIWORD(ffi->dwProductVersionLS);
-        const DWORD rightMost = LOWORD(ffi->dwProductVersionLS);
-
-        appInfo.productVersion =
-                QString("%1.%2.%3.%4")
-                        .arg(QString::number(leftMost), QString::number(secondLeft),
-                                QString::number(secondRight), QString::number(rightMost));
-
-        if (rightMost == 0) {
-            appInfo.productVersion.chop(2);
-        }
+        appInfo.productVersion = AppVersionInfo::productVersionText(
+                ffi->dwProductVersionMS, ffi->dwProductVersionLS);
     }
 
     // Language info
@@ -173,8 +163,8 @@ bool getInfo(const QString &appPath, AppInfo &appInfo)
     appInfo.fileModTime = FileUtil::fileModTime(path);
 
     const bool ok = appInfo.fileModTime.isValid();
-    if (ok) {
-        extractVersionInfo(path, appInfo);
+    if (ok && !AppVersionInfo::readFile(path, appInfo)) {
+        extractVersionInfo(path, appInfo); // fallback
     }
 
     revertWow64FsRedirection(wow64FsRedir);
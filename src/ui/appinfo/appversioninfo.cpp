@@ -0,0 +1,420 @@
+#include "appversioninfo.h"
+
+#include <QFile>
+#include <QVarLengthArray>
+
+#include <qt_windows.h>
+
+#include "appinfo.h"
+
+namespace {
+
+constexpr qint64 headersMapMaxSize = 64 * 1024;
+
+constexpr int resourceTypeVersion = 16; // RT_VERSION
+constexpr int resourceAnyId = -1;
+
+constexpr WORD versionTextType = 1;
+
+template<typename T>
+const T *dataAt(const uchar *data, qint64 size, qint64 offset, qint64 count = 1)
+{
+    if (offset < 0 || count < 0 || offset + qint64(sizeof(T)) * count > size)
+        return nullptr;
+
+    return reinterpret_cast<const T *>(data + offset);
+}
+
+inline qint64 alignDword(qint64 offset)
+{
+    return (offset + 3) & ~qint64(3);
+}
+
+struct ResourceSection
+{
+    quint32 rva = 0;
+    qint64 fileOffset = 0;
+    qint64 size = 0;
+
+    qint64 rootOffset = 0; // of the resource directory
+};
+
+const IMAGE_DATA_DIRECTORY *resourceDataDir(const uchar *data, qint64 size, qint64 offset)
+{
+    const WORD *magic = dataAt<WORD>(data, size, offset);
+    if (!magic)
+        return nullptr;
+
+    const IMAGE_DATA_DIRECTORY *dataDirs;
+    DWORD dataDirsCount;
+
+    if (*magic == IMAGE_NT_OPTIONAL_HDR32_MAGIC) {
+        const auto header = dataAt<IMAGE_OPTIONAL_HEADER32>(data, size, offset);
+        if (!header)
+            return nullptr;
+
+        dataDirs = header->DataDirectory;
+        dataDirsCount = header->NumberOfRvaAndSizes;
+    } else if (*magic == IMAGE_NT_OPTIONAL_HDR64_MAGIC) {
+        const auto header = dataAt<IMAGE_OPTIONAL_HEADER64>(data, size, offset);
+        if (!header)
+            return nullptr;
+
+        dataDirs = header->DataDirectory;
+        dataDirsCount = header->NumberOfRvaAndSizes;
+    } else {
+        return nullptr;
+    }
+
+    if (dataDirsCount <= IMAGE_DIRECTORY_ENTRY_RESOURCE)
+        return nullptr;
+
+    const IMAGE_DATA_DIRECTORY *dataDir = &dataDirs[IMAGE_DIRECTORY_ENTRY_RESOURCE];
+
+    return (dataDir->VirtualAddress != 0 && dataDir->Size != 0) ? dataDir : nullptr;
+}
+
+bool findResourceSection(const uchar *data, qint64 size, ResourceSection &rs)
+{
+    const auto dosHeader = dataAt<IMAGE_DOS_HEADER>(data, size, 0);
+    if (!dosHeader || dosHeader->e_magic != IMAGE_DOS_SIGNATURE)
+        return false;
+
+    const qint64 ntOffset = dosHeader->e_lfanew;
+
+    const DWORD *signature = dataAt<DWORD>(data, size, ntOffset);
+    if (!signature || *signature != IMAGE_NT_SIGNATURE)
+        return false;
+
+    const qint64 fileHeaderOffset = ntOffset + sizeof(DWORD);
+
+    const auto fileHeader = dataAt<IMAGE_FILE_HEADER>(data, size, fileHeaderOffset);
+    if (!fileHeader)
+        return false;
+
+    const qint64 optHeaderOffset = fileHeaderOffset + sizeof(IMAGE_FILE_HEADER);
+
+    const IMAGE_DATA_DIRECTORY *dataDir = resourceDataDir(data, size, optHeaderOffset);
+    if (!dataDir)
+        return false;
+
+    const int sectionsCount = fileHeader->NumberOfSections;
+    const auto sections = dataAt<IMAGE_SECTION_HEADER>(
+            data, size, optHeaderOffset + fileHeader->SizeOfOptionalHeader, sectionsCount);
+    if (!sections)
+        return false;
+
+    for (int i = 0; i < sectionsCount; ++i) {
+        const IMAGE_SECTION_HEADER &section = sections[i];
+
+        const quint32 sectionSize = qMax(section.Misc.VirtualSize, section.SizeOfRawData);
+        const quint32 dirOffset = dataDir->VirtualAddress - section.VirtualAddress;
+
+        if (dataDir->VirtualAddress < section.VirtualAddress || dirOffset >= sectionSize)
+            continue;
+
+        rs.rva = section.VirtualAddress;
+        rs.fileOffset = section.PointerToRawData;
+        rs.size = section.SizeOfRawData;
+        rs.rootOffset = dirOffset;
+
+        return rs.rootOffset < rs.size;
+    }
+
+    return false;
+}
+
+// Of the directory's entry by the id, or the first one
+const IMAGE_RESOURCE_DIRECTORY_ENTRY *findResourceEntry(
+        const uchar *data, qint64 size, qint64 dirOffset, int id)
+{
+    const auto dir = dataAt<IMAGE_RESOURCE_DIRECTORY>(data, size, dirOffset);
+    if (!dir)
+        return nullptr;
+
+    const int entriesCount = dir->NumberOfNamedEntries + dir->NumberOfIdEntries;
+
+    const auto entries = dataAt<IMAGE_RESOURCE_DIRECTORY_ENTRY>(
+            data, size, dirOffset + sizeof(IMAGE_RESOURCE_DIRECTORY), entriesCount);
+    if (!entries)
+        return nullptr;
+
+    for (int i = 0; i < entriesCount; ++i) {
+        const IMAGE_RESOURCE_DIRECTORY_ENTRY &entry = entries[i];
+
+        if (id == resourceAnyId || (!entry.NameIsString && entry.Id == id))
+            return &entry;
+    }
+
+    return nullptr;
+}
+
+bool findVersionResource(const uchar *data, const ResourceSection &rs, qint64 &versionOffset,
+        qint64 &versionSize)
+{
+    const IMAGE_RESOURCE_DIRECTORY_ENTRY *entry = nullptr;
+
+    // By the type, name & language
+    for (const int id : { resourceTypeVersion, resourceAnyId, resourceAnyId }) {
+        qint64 dirOffset = rs.rootOffset;
+
+        if (entry) {
+            if (!entry->DataIsDirectory)
+                return false;
+
+            dirOffset += entry->OffsetToDirectory;
+        }
+
+        entry = findResourceEntry(data, rs.size, dirOffset, id);
+        if (!entry)
+            return false;
+    }
+
+    if (entry->DataIsDirectory)
+        return false;
+
+    const auto dataEntry =
+            dataAt<IMAGE_RESOURCE_DATA_ENTRY>(data, rs.size, rs.rootOffset + entry->OffsetToData);
+    if (!dataEntry || dataEntry->OffsetToData < rs.rva)
+        return false;
+
+    versionOffset = dataEntry->OffsetToData - rs.rva;
+    versionSize = dataEntry->Size;
+
+    return versionOffset + versionSize <= rs.size;
+}
+
+struct VersionBlock
+{
+    QStringView key;
+
+    WORD type = 0;
+    WORD valueLength = 0;
+
+    qint64 valueOffset = 0;
+    qint64 childrenOffset = 0;
+    qint64 end = 0;
+};
+
+bool readVersionBlock(const uchar *data, qint64 size, qint64 offset, VersionBlock &b)
+{
+    const WORD *header = dataAt<WORD>(data, size, offset, 3);
+    if (!header)
+        return false;
+
+    const qint64 keyOffset = offset + 3 * sizeof(WORD);
+
+    b.end = offset + header[0];
+    if (b.end <= keyOffset || b.end > size)
+        return false;
+
+    b.valueLength = header[1];
+    b.type = header[2];
+
+    // Zero-terminated key
+    const auto key = reinterpret_cast<const char16_t *>(data + keyOffset);
+    const qint64 keyMaxLength = (b.end - keyOffset) / 2;
+
+    qint64 keyLength = 0;
+    while (keyLength < keyMaxLength && key[keyLength] != 0) {
+        ++keyLength;
+    }
+
+    if (keyLength >= keyMaxLength)
+        return false;
+
+    b.key = QStringView(key, keyLength);
+
+    // The text's length is in chars
+    const qint64 valueSize = (b.type == versionTextType) ? 2 * b.valueLength : b.valueLength;
+
+    b.valueOffset = alignDword(keyOffset + 2 * (keyLength + 1));
+    b.childrenOffset = qMin(alignDword(b.valueOffset + valueSize), b.end);
+
+    return true;
+}
+
+template<typename F>
+bool forEachChildBlock(const uchar *data, const VersionBlock &parent, F f)
+{
+    VersionBlock b;
+
+    for (qint64 offset = parent.childrenOffset; offset < parent.end;
+            offset = alignDword(b.end)) {
+        if (!readVersionBlock(data, parent.end, offset, b))
+            return false;
+
+        f(b);
+    }
+
+    return true;
+}
+
+QString blockText(const uchar *data, const VersionBlock &b)
+{
+    const auto text = reinterpret_cast<const char16_t *>(data + b.valueOffset);
+    const qint64 textMaxLength = qMax(b.end - b.valueOffset, qint64(0)) / 2;
+
+    qint64 textLength = 0;
+    while (textLength < textMaxLength && text[textLength] != 0) {
+        ++textLength;
+    }
+
+    return QStringView(text, textLength).trimmed().toString();
+}
+
+struct VersionTexts
+{
+    QStringView langKey;
+
+    QString companyName;
+    QString productName;
+    QString fileDescription;
+};
+
+void readStringTable(const uchar *data, const VersionBlock &table, VersionTexts &texts)
+{
+    texts.langKey = table.key;
+
+    forEachChildBlock(data, table, [&](const VersionBlock &b) {
+        if (b.key.compare(u"CompanyName", Qt::CaseInsensitive) == 0) {
+            texts.companyName = blockText(data, b);
+        } else if (b.key.compare(u"ProductName", Qt::CaseInsensitive) == 0) {
+            texts.productName = blockText(data, b);
+        } else if (b.key.compare(u"FileDescription", Qt::CaseInsensitive) == 0) {
+            texts.fileDescription = blockText(data, b);
+        }
+    });
+}
+
+QString readTranslation(const uchar *data, const VersionBlock &varInfo)
+{
+    QString langKey;
+
+    forEachChildBlock(data, varInfo, [&](const VersionBlock &b) {
+        const WORD *langInfo = dataAt<WORD>(data, b.end, b.valueOffset, 2);
+
+        if (langKey.isEmpty() && langInfo
+                && b.key.compare(u"Translation", Qt::CaseInsensitive) == 0) {
+            langKey = QString("%1%2")
+                              .arg(langInfo[0], 4, 16, QLatin1Char('0'))
+                              .arg(langInfo[1], 4, 16, QLatin1Char('0'));
+        }
+    });
+
+    return langKey;
+}
+
+// Parse the VS_VERSIONINFO in one pass
+bool parseVersionInfo(const uchar *data, qint64 size, AppInfo &appInfo)
+{
+    VersionBlock root;
+    if (!readVersionBlock(data, size, 0, root) || root.key != u"VS_VERSION_INFO")
+        return false;
+
+    // Product Version
+    const auto ffi = dataAt<VS_FIXEDFILEINFO>(data, root.end, root.valueOffset);
+    if (!ffi || root.valueLength < sizeof(VS_FIXEDFILEINFO) || ffi->dwSignature != VS_FFI_SIGNATURE)
+        return false;
+
+    appInfo.productVersion = AppVersionInfo::productVersionText(
+            ffi->dwProductVersionMS, ffi->dwProductVersionLS);
+
+    QVarLengthArray<VersionTexts, 2> textsList;
+    QString langKey;
+
+    const bool ok = forEachChildBlock(data, root, [&](const VersionBlock &b) {
+        if (b.key == u"StringFileInfo") {
+            forEachChildBlock(data, b, [&](const VersionBlock &table) {
+                textsList.append({});
+                readStringTable(data, table, textsList.last());
+            });
+        } else if (b.key == u"VarFileInfo") {
+            langKey = readTranslation(data, b);
+        }
+    });
+
+    if (!ok)
+        return false;
+
+    // Texts of the language info
+    for (const VersionTexts &texts : std::as_const(textsList)) {
+        if (langKey.isEmpty() || texts.langKey.compare(langKey, Qt::CaseInsensitive) != 0)
+            continue;
+
+        appInfo.companyName = texts.companyName;
+        appInfo.productName = texts.productName;
+        appInfo.fileDescription = texts.fileDescription;
+        break;
+    }
+
+    return true;
+}
+
+}
+
+namespace AppVersionInfo {
+
+bool readFile(const QString &filePath, AppInfo &appInfo)
+{
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    const qint64 fileSize = file.size();
+
+    // Headers
+    ResourceSection rs;
+    {
+        const qint64 headersSize = qMin(fileSize, headersMapMaxSize);
+
+        uchar *headers = file.map(0, headersSize);
+        if (!headers)
+            return false;
+
+        const bool ok = findResourceSection(headers, headersSize, rs);
+
+        file.unmap(headers);
+
+        if (!ok)
+            return false;
+    }
+
+    // Resource section
+    if (rs.fileOffset >= fileSize)
+        return false;
+
+    rs.size = qMin(rs.size, fileSize - rs.fileOffset);
+
+    uchar *rsrc = file.map(rs.fileOffset, rs.size);
+    if (!rsrc)
+        return false;
+
+    qint64 versionOffset, versionSize;
+    const bool ok = findVersionResource(rsrc, rs, versionOffset, versionSize)
+            && parseVersionInfo(rsrc + versionOffset, versionSize, appInfo);
+
+    file.unmap(rsrc);
+
+    return ok;
+}
+
+QString productVersionText(quint32 versionMS, quint32 versionLS)
+{
+    const quint16 leftMost = HIWORD(versionMS);
+    const quint16 secondLeft = LOWORD(versionMS);
+    const quint16 secondRight = HIWORD(versionLS);
+    const quint16 rightMost = LOWORD(versionLS);
+
+    QString text = QString("%1.%2.%3.%4")
+                           .arg(QString::number(leftMost), QString::number(secondLeft),
+                                   QString::number(secondRight), QString::number(rightMost));
+
+    if (rightMost == 0) {
+        text.chop(2);
+    }
+
+    return text;
+}
+
+}
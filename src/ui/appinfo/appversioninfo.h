@@ -0,0 +1,17 @@
+#ifndef APPVERSIONINFO_H
+#define APPVERSIONINFO_H
+
+#include <QString>
+
+class AppInfo;
+
+namespace AppVersionInfo {
+
+// Read the version resource from the mapped PE headers & resource section
+bool readFile(const QString &filePath, AppInfo &appInfo);
+
+QString productVersionText(quint32 versionMS, quint32 versionLS);
+
+}
+
+#endif // APPVERSIONINFO_H
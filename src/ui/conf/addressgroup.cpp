@@ -1,51 +1,59 @@
 #include "addressgroup.h"
 
-AddressGroup::AddressGroup(QObject *parent) : QObject(parent) { }
+AddressGroup::AddressGroup(QObject *parent) : QObject(parent), m_data(new AddressGroupData()) { }
+
+void AddressGroup::setId(qint64 id)
+{
+    // Not to detach the shared data by the same id
+    if (this->id() != id) {
+        m_data->id = id;
+    }
+}
 
 void AddressGroup::setIncludeAll(bool includeAll)
 {
-    if (m_includeAll != includeAll) {
-        m_includeAll = includeAll;
+    if (this->includeAll() != includeAll) {
+        m_data->includeAll = includeAll;
         setEdited(true);
     }
 }
 
 void AddressGroup::setExcludeAll(bool excludeAll)
 {
-    if (m_excludeAll != excludeAll) {
-        m_excludeAll = excludeAll;
+    if (this->excludeAll() != excludeAll) {
+        m_data->excludeAll = excludeAll;
         setEdited(true);
     }
 }
 
 void AddressGroup::setIncludeZones(quint32 v)
 {
-    if (m_includeZones != v) {
-        m_includeZones = v;
+    if (this->includeZones() != v) {
+        m_data->includeZones = v;
         setEdited(true);
     }
 }
 
 void AddressGroup::setExcludeZones(quint32 v)
 {
-    if (m_excludeZones != v) {
-        m_excludeZones = v;
+    if (this->excludeZones() != v) {
+        m_data->excludeZones = v;
         setEdited(true);
     }
 }
 
 void AddressGroup::setIncludeText(const QString &includeText)
 {
-    if (m_includeText != includeText) {
-        m_includeText = includeText;
+    if (this->includeText() != includeText) {
+        m_data->includeText = includeText;
         setEdited(true);
     }
 }
 
 void AddressGroup::setExcludeText(const QString &excludeText)
 {
-    if (m_excludeText != excludeText) {
-        m_excludeText = excludeText;
+    if (this->excludeText() != excludeText) {
+        m_data->excludeText = excludeText;
         setEdited(true);
     }
 }
@@ -54,16 +62,7 @@ void AddressGroup::copy(const AddressGroup &o)
 {
     m_edited = o.edited();
 
-    m_includeAll = o.includeAll();
-    m_excludeAll = o.excludeAll();
-
-    m_id = o.id();
-
-    m_includeZones = o.includeZones();
-    m_excludeZones = o.excludeZones();
-
-    m_includeText = o.includeText();
-    m_excludeText = o.excludeText();
+    m_data = o.m_data;
 }
 
 QVariant AddressGroup::toVariant() const
@@ -92,14 +91,14 @@ void AddressGroup::fromVariant(const QVariant &v)
 
     m_edited = map["edited"].toBool();
 
-    m_includeAll = map["includeAll"].toBool();
-    m_excludeAll = map["excludeAll"].toBool();
+    m_data->includeAll = map["includeAll"].toBool();
+    m_data->excludeAll = map["excludeAll"].toBool();
 
-    m_id = map["id"].toLongLong();
+    m_data->id = map["id"].toLongLong();
 
-    m_includeZones = map["includeZones"].toUInt();
-    m_excludeZones = map["excludeZones"].toUInt();
+    m_data->includeZones = map["includeZones"].toUInt();
+    m_data->excludeZones = map["excludeZones"].toUInt();
 
-    m_includeText = map["includeText"].toString();
-    m_excludeText = map["excludeText"].toString();
+    m_data->includeText = map["includeText"].toString();
+    m_data->excludeText = map["excludeText"].toString();
 }
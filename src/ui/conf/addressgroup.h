@@ -2,9 +2,24 @@
 #define ADDRESSGROUP_H
 
 #include <QObject>
+#include <QSharedData>
 #include <QVariant>
 #include <QVector>
 
+struct AddressGroupData : public QSharedData
+{
+    bool includeAll : 1 = true;
+    bool excludeAll : 1 = false;
+
+    qint64 id = 0;
+
+    quint32 includeZones = 0;
+    quint32 excludeZones = 0;
+
+    QString includeText;
+    QString excludeText;
+};
+
 class AddressGroup : public QObject
 {
     Q_OBJECT
@@ -15,25 +30,25 @@ public:
     bool edited() const { return m_edited; }
     void setEdited(bool edited) { m_edited = edited; }
 
-    bool includeAll() const { return m_includeAll; }
+    bool includeAll() const { return m_data->includeAll; }
     void setIncludeAll(bool includeAll);
 
-    bool excludeAll() const { return m_excludeAll; }
+    bool excludeAll() const { return m_data->excludeAll; }
     void setExcludeAll(bool excludeAll);
 
-    qint64 id() const { return m_id; }
-    void setId(qint64 id) { m_id = id; }
+    qint64 id() const { return m_data->id; }
+    void setId(qint64 id);
 
-    quint32 includeZones() const { return m_includeZones; }
+    quint32 includeZones() const { return m_data->includeZones; }
     void setIncludeZones(quint32 v);
 
-    quint32 excludeZones() const { return m_excludeZones; }
+    quint32 excludeZones() const { return m_data->excludeZones; }
     void setExcludeZones(quint32 v);
 
-    QString includeText() const { return m_includeText; }
+    QString includeText() const { return m_data->includeText; }
     void setIncludeText(const QString &includeText);
 
-    QString excludeText() const { return m_excludeText; }
+    QString excludeText() const { return m_data->excludeText; }
     void setExcludeText(const QString &excludeText);
 
     void copy(const AddressGroup &o);
@@ -44,16 +59,7 @@ public:
 private:
     bool m_edited : 1 = false;
 
-    bool m_includeAll : 1 = true;
-    bool m_excludeAll : 1 = false;
-
-    qint64 m_id = 0;
-
-    quint32 m_includeZones = 0;
-    quint32 m_excludeZones = 0;
-
-    QString m_includeText;
-    QString m_excludeText;
+    QSharedDataPointer<AddressGroupData> m_data; // shared by the copies until edited
 };
 
 #endif // ADDRESSGROUP_H
@@ -3,164 +3,220 @@
 #include <util/dateutil.h>
 #include <util/net/netutil.h>
 
-AppGroup::AppGroup(QObject *parent) : QObject(parent) { }
+AppGroup::AppGroup(QObject *parent) : QObject(parent), m_data(new AppGroupData()) { }
+
+void AppGroup::setId(qint64 id)
+{
+    // Not to detach the shared data by the same id
+    if (this->id() != id) {
+        m_data->id = id;
+    }
+}
 
 void AppGroup::setEnabled(bool enabled)
 {
-    if (bool(m_enabled) != enabled) {
-        m_enabled = enabled;
+    if (this->enabled() != enabled) {
+        m_data->enabled = enabled;
         setEdited(true);
     }
 }
 
 void AppGroup::setApplyChild(bool on)
 {
-    if (bool(m_applyChild) != on) {
-        m_applyChild = on;
+    if (this->applyChild() != on) {
+        m_data->applyChild = on;
         setEdited(true);
     }
 }
 
 void AppGroup::setLanOnly(bool on)
 {
-    if (bool(m_lanOnly) != on) {
-        m_lanOnly = on;
+    if (this->lanOnly() != on) {
+        m_data->lanOnly = on;
         setEdited(true);
     }
 }
 
 void AppGroup::setLogBlocked(bool on)
 {
-    if (bool(m_logBlocked) != on) {
-        m_logBlocked = on;
+    if (this->logBlocked() != on) {
+        m_data->logBlocked = on;
         setEdited(true);
     }
 }
 
 void AppGroup::setLogConn(bool on)
 {
-    if (bool(m_logConn) != on) {
-        m_logConn = on;
+    if (this->logConn() != on) {
+        m_data->logConn = on;
+        setEdited(true);
+    }
+}
+
+void AppGroup::setLogStat(bool on)
+{
+    if (this->logStat() != on) {
+        m_data->logStat = on;
         setEdited(true);
     }
 }
 
 void AppGroup::setPeriodEnabled(bool enabled)
 {
-    if (bool(m_periodEnabled) != enabled) {
-        m_periodEnabled = enabled;
+    if (this->periodEnabled() != enabled) {
+        m_data->periodEnabled = enabled;
         setEdited(true);
     }
 }
 
 void AppGroup::setLimitInEnabled(bool enabled)
 {
-    if (bool(m_limitInEnabled) != enabled) {
-        m_limitInEnabled = enabled;
+    if (this->limitInEnabled() != enabled) {
+        m_data->limitInEnabled = enabled;
         setEdited(true);
     }
 }
 
 void AppGroup::setLimitOutEnabled(bool enabled)
 {
-    if (bool(m_limitOutEnabled) != enabled) {
-        m_limitOutEnabled = enabled;
+    if (this->limitOutEnabled() != enabled) {
+        m_data->limitOutEnabled = enabled;
+        setEdited(true);
+    }
+}
+
+void AppGroup::setLimitFairQueue(bool on)
+{
+    if (this->limitFairQueue() != on) {
+        m_data->limitFairQueue = on;
+        setEdited(true);
+    }
+}
+
+void AppGroup::setLimitFairProcess(bool on)
+{
+    if (this->limitFairProcess() != on) {
+        m_data->limitFairProcess = on;
+        setEdited(true);
+    }
+}
+
+void AppGroup::setLimitEcn(bool on)
+{
+    if (this->limitEcn() != on) {
+        m_data->limitEcn = on;
+        setEdited(true);
+    }
+}
+
+void AppGroup::setLimitPacing(bool on)
+{
+    if (this->limitPacing() != on) {
+        m_data->limitPacing = on;
         setEdited(true);
     }
 }
 
 void AppGroup::setLimitPacketLoss(quint16 v)
 {
-    if (m_limitPacketLoss != v) {
-        m_limitPacketLoss = v;
+    if (this->limitPacketLoss() != v) {
+        m_data->limitPacketLoss = v;
         setEdited(true);
     }
 }
 
 void AppGroup::setSpeedLimitIn(quint32 limit)
 {
-    if (m_speedLimitIn != limit) {
-        m_speedLimitIn = limit;
+    if (this->speedLimitIn() != limit) {
+        m_data->speedLimitIn = limit;
         setEdited(true);
     }
 }
 
 void AppGroup::setSpeedLimitOut(quint32 limit)
 {
-    if (m_speedLimitOut != limit) {
-        m_speedLimitOut = limit;
+    if (this->speedLimitOut() != limit) {
+        m_data->speedLimitOut = limit;
         setEdited(true);
     }
 }
 
 void AppGroup::setLimitLatency(quint32 v)
 {
-    if (m_limitLatency != v) {
-        m_limitLatency = v;
+    if (this->limitLatency() != v) {
+        m_data->limitLatency = v;
         setEdited(true);
     }
 }
 
 void AppGroup::setLimitBufferSizeIn(quint32 v)
 {
-    if (m_limitBufferSizeIn != v) {
-        m_limitBufferSizeIn = v;
+    if (this->limitBufferSizeIn() != v) {
+        m_data->limitBufferSizeIn = v;
         setEdited(true);
     }
 }
 
 void AppGroup::setLimitBufferSizeOut(quint32 v)
 {
-    if (m_limitBufferSizeOut != v) {
-        m_limitBufferSizeOut = v;
+    if (this->limitBufferSizeOut() != v) {
+        m_data->limitBufferSizeOut = v;
+        setEdited(true);
+    }
+}
+
+void AppGroup::setLimitBurstSize(quint32 v)
+{
+    if (this->limitBurstSize() != v) {
+        m_data->limitBurstSize = v;
         setEdited(true);
     }
 }
 
 void AppGroup::setName(const QString &name)
 {
-    if (m_name != name) {
-        m_name = name;
+    if (this->name() != name) {
+        m_data->name = name;
         setEdited(true);
     }
 }
 
 void AppGroup::setKillText(const QString &killText)
 {
-    if (m_killText != killText) {
-        m_killText = killText;
+    if (this->killText() != killText) {
+        m_data->killText = killText;
         setEdited(true);
     }
 }
 
 void AppGroup::setBlockText(const QString &blockText)
 {
-    if (m_blockText != blockText) {
-        m_blockText = blockText;
+    if (this->blockText() != blockText) {
+        m_data->blockText = blockText;
         setEdited(true);
     }
 }
 
 void AppGroup::setAllowText(const QString &allowText)
 {
-    if (m_allowText != allowText) {
-        m_allowText = allowText;
+    if (this->allowText() != allowText) {
+        m_data->allowText = allowText;
         setEdited(true);
     }
 }
 
 void AppGroup::setPeriodFrom(const QString &periodFrom)
 {
-    if (m_periodFrom != periodFrom) {
-        m_periodFrom = periodFrom;
+    if (this->periodFrom() != periodFrom) {
+        m_data->periodFrom = periodFrom;
         setEdited(true);
     }
 }
 
 void AppGroup::setPeriodTo(const QString &periodTo)
 {
-    if (m_periodTo != periodTo) {
-        m_periodTo = periodTo;
+    if (this->periodTo() != periodTo) {
+        m_data->periodTo = periodTo;
         setEdited(true);
     }
 }
@@ -190,32 +246,7 @@ void AppGroup::copy(const AppGroup &o)
 {
     m_edited = o.edited();
 
-    m_enabled = o.enabled();
-    m_applyChild = o.applyChild();
-    m_lanOnly = o.lanOnly();
-    m_logBlocked = o.logBlocked();
-    m_logConn = o.logConn();
-
-    m_periodEnabled = o.periodEnabled();
-    m_periodFrom = o.periodFrom();
-    m_periodTo = o.periodTo();
-
-    m_limitInEnabled = o.limitInEnabled();
-    m_limitOutEnabled = o.limitOutEnabled();
-    m_speedLimitIn = o.speedLimitIn();
-    m_speedLimitOut = o.speedLimitOut();
-
-    m_limitPacketLoss = o.limitPacketLoss();
-    m_limitLatency = o.limitLatency();
-    m_limitBufferSizeIn = o.limitBufferSizeIn();
-    m_limitBufferSizeOut = o.limitBufferSizeOut();
-
-    m_id = o.id();
-    m_name = o.name();
-
-    m_killText = o.killText();
-    m_blockText = o.blockText();
-    m_allowText = o.allowText();
+    m_data = o.m_data;
 }
 
 QVariant AppGroup::toVariant() const
@@ -229,6 +260,7 @@ QVariant AppGroup::toVariant() const
     map["lanOnly"] = lanOnly();
     map["logBlocked"] = logBlocked();
     map["logConn"] = logConn();
+    map["logStat"] = logStat();
 
     map["periodEnabled"] = periodEnabled();
     map["periodFrom"] = periodFrom();
@@ -238,11 +270,16 @@ QVariant AppGroup::toVariant() const
     map["limitOutEnabled"] = limitOutEnabled();
     map["speedLimitIn"] = speedLimitIn();
     map["speedLimitOut"] = speedLimitOut();
+    map["limitFairQueue"] = limitFairQueue();
+    map["limitFairProcess"] = limitFairProcess();
+    map["limitEcn"] = limitEcn();
+    map["limitPacing"] = limitPacing();
 
     map["limitPacketLoss"] = limitPacketLoss();
     map["limitLatency"] = limitLatency();
     map["limitBufferSizeIn"] = limitBufferSizeIn();
     map["limitBufferSizeOut"] = limitBufferSizeOut();
+    map["limitBurstSize"] = limitBurstSize();
 
     map["id"] = id();
     map["name"] = name();
@@ -259,31 +296,37 @@ void AppGroup::fromVariant(const QVariant &v)
     const QVariantMap map = v.toMap();
 
     m_edited = map["edited"].toBool();
-    m_enabled = map["enabled"].toBool();
-
-    m_applyChild = map["applyChild"].toBool();
-    m_lanOnly = map["lanOnly"].toBool();
-    m_logBlocked = map["logBlocked"].toBool();
-    m_logConn = map["logConn"].toBool();
-
-    m_periodEnabled = map["periodEnabled"].toBool();
-    m_periodFrom = DateUtil::reformatTime(map["periodFrom"].toString());
-    m_periodTo = DateUtil::reformatTime(map["periodTo"].toString());
-
-    m_limitInEnabled = map["limitInEnabled"].toBool();
-    m_limitOutEnabled = map["limitOutEnabled"].toBool();
-    m_speedLimitIn = map["speedLimitIn"].toUInt();
-    m_speedLimitOut = map["speedLimitOut"].toUInt();
-
-    m_limitPacketLoss = map["limitPacketLoss"].toUInt();
-    m_limitLatency = map["limitLatency"].toUInt();
-    m_limitBufferSizeIn = map["limitBufferSizeIn"].toUInt();
-    m_limitBufferSizeOut = map["limitBufferSizeOut"].toUInt();
-
-    m_id = map["id"].toLongLong();
-    m_name = map["name"].toString();
-
-    m_killText = map["killText"].toString();
-    m_blockText = map["blockText"].toString();
-    m_allowText = map["allowText"].toString();
+    m_data->enabled = map["enabled"].toBool();
+
+    m_data->applyChild = map["applyChild"].toBool();
+    m_data->lanOnly = map["lanOnly"].toBool();
+    m_data->logBlocked = map["logBlocked"].toBool();
+    m_data->logConn = map["logConn"].toBool();
+    m_data->logStat = map["logStat"].toBool();
+
+    m_data->periodEnabled = map["periodEnabled"].toBool();
+    m_data->periodFrom = DateUtil::reformatTime(map["periodFrom"].toString());
+    m_data->periodTo = DateUtil::reformatTime(map["periodTo"].toString());
+
+    m_data->limitInEnabled = map["limitInEnabled"].toBool();
+    m_data->limitOutEnabled = map["limitOutEnabled"].toBool();
+    m_data->speedLimitIn = map["speedLimitIn"].toUInt();
+    m_data->speedLimitOut = map["speedLimitOut"].toUInt();
+    m_data->limitFairQueue = map["limitFairQueue"].toBool();
+    m_data->limitFairProcess = map["limitFairProcess"].toBool();
+    m_data->limitEcn = map["limitEcn"].toBool();
+    m_data->limitPacing = map["limitPacing"].toBool();
+
+    m_data->limitPacketLoss = map["limitPacketLoss"].toUInt();
+    m_data->limitLatency = map["limitLatency"].toUInt();
+    m_data->limitBufferSizeIn = map["limitBufferSizeIn"].toUInt();
+    m_data->limitBufferSizeOut = map["limitBufferSizeOut"].toUInt();
+    m_data->limitBurstSize = map["limitBurstSize"].toUInt();
+
+    m_data->id = map["id"].toLongLong();
+    m_data->name = map["name"].toString();
+
+    m_data->killText = map["killText"].toString();
+    m_data->blockText = map["blockText"].toString();
+    m_data->allowText = map["allowText"].toString();
 }
@@ -2,11 +2,56 @@
 #define APPGROUP_H
 
 #include <QObject>
+#include <QSharedData>
 #include <QVariant>
 
 #define MAX_APP_GROUP_COUNT       16
 #define DEFAULT_LIMIT_BUFFER_SIZE 150000
 
+struct AppGroupData : public QSharedData
+{
+    bool enabled : 1 = true;
+
+    bool applyChild : 1 = false;
+    bool lanOnly : 1 = false;
+    bool logBlocked : 1 = true;
+    bool logConn : 1 = true;
+    bool logStat : 1 = true;
+
+    bool periodEnabled : 1 = false;
+
+    bool limitInEnabled : 1 = false;
+    bool limitOutEnabled : 1 = false;
+    bool limitFairQueue : 1 = false;
+    bool limitFairProcess : 1 = false;
+    bool limitEcn : 1 = false;
+    bool limitPacing : 1 = false;
+
+    quint16 limitPacketLoss = 0; // Percent
+    quint32 limitLatency = 0; // Milliseconds
+
+    // kbits per sec.
+    quint32 speedLimitIn = 0;
+    quint32 speedLimitOut = 0;
+
+    quint32 limitBufferSizeIn = DEFAULT_LIMIT_BUFFER_SIZE;
+    quint32 limitBufferSizeOut = DEFAULT_LIMIT_BUFFER_SIZE;
+
+    quint32 limitBurstSize = 0;
+
+    qint64 id = 0;
+
+    QString name;
+
+    QString killText;
+    QString blockText;
+    QString allowText;
+
+    // In format "hh:mm"
+    QString periodFrom;
+    QString periodTo;
+};
+
 class AppGroup : public QObject
 {
     Q_OBJECT
@@ -17,72 +62,96 @@ public:
     bool edited() const { return m_edited; }
     void setEdited(bool edited) { m_edited = edited; }
 
-    bool enabled() const { return m_enabled; }
+    bool enabled() const { return m_data->enabled; }
     void setEnabled(bool enabled);
 
-    bool applyChild() const { return m_applyChild; }
+    bool applyChild() const { return m_data->applyChild; }
     void setApplyChild(bool on);
 
-    bool lanOnly() const { return m_lanOnly; }
+    bool lanOnly() const { return m_data->lanOnly; }
     void setLanOnly(bool on);
 
-    bool logBlocked() const { return m_logBlocked; }
+    bool logBlocked() const { return m_data->logBlocked; }
     void setLogBlocked(bool on);
 
-    bool logConn() const { return m_logConn; }
+    bool logConn() const { return m_data->logConn; }
     void setLogConn(bool on);
 
-    bool periodEnabled() const { return m_periodEnabled; }
+    // Without the statistics and speed limits, the group's connections skip the driver's flows
+    bool logStat() const { return m_data->logStat; }
+    void setLogStat(bool on);
+
+    bool periodEnabled() const { return m_data->periodEnabled; }
     void setPeriodEnabled(bool enabled);
 
-    bool limitInEnabled() const { return m_limitInEnabled; }
+    bool limitInEnabled() const { return m_data->limitInEnabled; }
     void setLimitInEnabled(bool enabled);
 
-    bool limitOutEnabled() const { return m_limitOutEnabled; }
+    bool limitOutEnabled() const { return m_data->limitOutEnabled; }
     void setLimitOutEnabled(bool enabled);
 
-    quint16 limitPacketLoss() const { return m_limitPacketLoss; }
+    // Share the speed limit fairly between the group's connections
+    bool limitFairQueue() const { return m_data->limitFairQueue; }
+    void setLimitFairQueue(bool on);
+
+    // Share the speed limit fairly between the group's processes
+    bool limitFairProcess() const { return m_data->limitFairProcess; }
+    void setLimitFairProcess(bool on);
+
+    // Mark the congestion by ECN instead of dropping the packets
+    bool limitEcn() const { return m_data->limitEcn; }
+    void setLimitEcn(bool on);
+
+    // Release the packets evenly, without bursts
+    bool limitPacing() const { return m_data->limitPacing; }
+    void setLimitPacing(bool on);
+
+    quint16 limitPacketLoss() const { return m_data->limitPacketLoss; }
     void setLimitPacketLoss(quint16 v);
 
-    quint32 limitLatency() const { return m_limitLatency; }
+    quint32 limitLatency() const { return m_data->limitLatency; }
     void setLimitLatency(quint32 v);
 
-    quint32 speedLimitIn() const { return m_speedLimitIn; }
+    quint32 speedLimitIn() const { return m_data->speedLimitIn; }
     void setSpeedLimitIn(quint32 limit);
 
-    quint32 speedLimitOut() const { return m_speedLimitOut; }
+    quint32 speedLimitOut() const { return m_data->speedLimitOut; }
     void setSpeedLimitOut(quint32 limit);
 
-    quint32 limitBufferSizeIn() const { return m_limitBufferSizeIn; }
+    quint32 limitBufferSizeIn() const { return m_data->limitBufferSizeIn; }
     void setLimitBufferSizeIn(quint32 v);
 
-    quint32 limitBufferSizeOut() const { return m_limitBufferSizeOut; }
+    quint32 limitBufferSizeOut() const { return m_data->limitBufferSizeOut; }
     void setLimitBufferSizeOut(quint32 v);
 
+    // Bytes to send at once after an idle period, 0 to scale by the speed limit
+    quint32 limitBurstSize() const { return m_data->limitBurstSize; }
+    void setLimitBurstSize(quint32 v);
+
     quint32 enabledSpeedLimitIn() const { return limitInEnabled() ? speedLimitIn() : 0; }
     quint32 enabledSpeedLimitOut() const { return limitOutEnabled() ? speedLimitOut() : 0; }
 
-    bool isNull() const { return m_id == 0; }
+    bool isNull() const { return id() == 0; }
 
-    qint64 id() const { return m_id; }
-    void setId(qint64 id) { m_id = id; }
+    qint64 id() const { return m_data->id; }
+    void setId(qint64 id);
 
-    QString name() const { return m_name; }
+    QString name() const { return m_data->name; }
     void setName(const QString &name);
 
-    QString killText() const { return m_killText; }
+    QString killText() const { return m_data->killText; }
     void setKillText(const QString &killText);
 
-    QString blockText() const { return m_blockText; }
+    QString blockText() const { return m_data->blockText; }
     void setBlockText(const QString &blockText);
 
-    QString allowText() const { return m_allowText; }
+    QString allowText() const { return m_data->allowText; }
     void setAllowText(const QString &allowText);
 
-    QString periodFrom() const { return m_periodFrom; }
+    QString periodFrom() const { return m_data->periodFrom; }
     void setPeriodFrom(const QString &periodFrom);
 
-    QString periodTo() const { return m_periodTo; }
+    QString periodTo() const { return m_data->periodTo; }
     void setPeriodTo(const QString &periodTo);
 
     QString menuLabel() const;
@@ -94,39 +163,8 @@ public:
 
 private:
     bool m_edited : 1 = false;
-    bool m_enabled : 1 = true;
-
-    bool m_applyChild : 1 = false;
-    bool m_lanOnly : 1 = false;
-    bool m_logBlocked : 1 = true;
-    bool m_logConn : 1 = true;
-
-    bool m_periodEnabled : 1 = false;
-
-    bool m_limitInEnabled : 1 = false;
-    bool m_limitOutEnabled : 1 = false;
 
-    quint16 m_limitPacketLoss = 0; // Percent
-    quint32 m_limitLatency = 0; // Milliseconds
-
-    // kbits per sec.
-    quint32 m_speedLimitIn = 0;
-    quint32 m_speedLimitOut = 0;
-
-    quint32 m_limitBufferSizeIn = DEFAULT_LIMIT_BUFFER_SIZE;
-    quint32 m_limitBufferSizeOut = DEFAULT_LIMIT_BUFFER_SIZE;
-
-    qint64 m_id = 0;
-
-    QString m_name;
-
-    QString m_killText;
-    QString m_blockText;
-    QString m_allowText;
-
-    // In format "hh:mm"
-    QString m_periodFrom;
-    QString m_periodTo;
+    QSharedDataPointer<AppGroupData> m_data; // shared by the copies until edited
 };
 
 #endif // APPGROUP_H
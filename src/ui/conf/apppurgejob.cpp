@@ -0,0 +1,61 @@
+#include "apppurgejob.h"
+
+#include <QElapsedTimer>
+#include <QLoggingCategory>
+
+#include <appinfo/appinfoutil.h>
+#include <util/worker/workerobject.h>
+
+#include "apppurgemanager.h"
+
+namespace {
+
+const QLoggingCategory LC("appPurgeJob");
+
+constexpr int APP_PURGE_CHECK_TIMEOUT_MSECS = 3000;
+
+}
+
+AppPurgeJob::AppPurgeJob(const QString &drive, const QVector<AppPurgePath> &paths) :
+    WorkerJob(drive), m_paths(paths)
+{
+}
+
+void AppPurgeJob::doJob(WorkerObject &worker)
+{
+    QElapsedTimer timer;
+
+    for (const AppPurgePath &path : std::as_const(m_paths)) {
+        if (worker.manager()->aborted())
+            break;
+
+        timer.start();
+
+        const bool exists = AppInfoUtil::fileExists(path.appPath);
+
+        // Keep the apps of the unavailable volume
+        if (timer.elapsed() > APP_PURGE_CHECK_TIMEOUT_MSECS) {
+            qCDebug(LC) << "Drive timed out:" << drive();
+
+            m_timedOut = true;
+            m_appIdList.clear();
+            break;
+        }
+
+        if (!exists) {
+            m_appIdList.append(path.appId);
+
+            qCDebug(LC) << "Purge obsolete app:" << path.appId << path.appPath;
+        }
+    }
+}
+
+void AppPurgeJob::reportResult(WorkerObject &worker)
+{
+    emitFinished(static_cast<AppPurgeManager *>(worker.manager()));
+}
+
+void AppPurgeJob::emitFinished(AppPurgeManager *manager)
+{
+    emit manager->jobFinished(drive(), m_appIdList, m_timedOut);
+}
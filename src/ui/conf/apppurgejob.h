@@ -0,0 +1,37 @@
+#ifndef APPPURGEJOB_H
+#define APPPURGEJOB_H
+
+#include <QVector>
+
+#include <util/worker/workerjob.h>
+
+class AppPurgeManager;
+
+struct AppPurgePath
+{
+    qint64 appId = 0;
+    QString appPath;
+};
+
+// Checks the existence of a batch of the apps' files on the same drive
+class AppPurgeJob : public WorkerJob
+{
+public:
+    explicit AppPurgeJob(const QString &drive, const QVector<AppPurgePath> &paths);
+
+    QString drive() const { return text(); }
+
+    void doJob(WorkerObject &worker) override;
+    void reportResult(WorkerObject &worker) override;
+
+private:
+    void emitFinished(AppPurgeManager *manager);
+
+private:
+    bool m_timedOut = false;
+
+    QVector<AppPurgePath> m_paths;
+    QVector<qint64> m_appIdList; // of the non-existent files
+};
+
+#endif // APPPURGEJOB_H
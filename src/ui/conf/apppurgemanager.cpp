@@ -0,0 +1,78 @@
+#include "apppurgemanager.h"
+
+#include <QMap>
+
+namespace {
+
+constexpr int APP_PURGE_BATCH_SIZE = 256;
+
+}
+
+AppPurgeManager::AppPurgeManager(QObject *parent) : WorkerManager(parent)
+{
+    setMaxWorkersCount(4);
+
+    connect(this, &AppPurgeManager::jobFinished, this, &AppPurgeManager::onJobFinished,
+            Qt::QueuedConnection);
+}
+
+void AppPurgeManager::purgeApps(const QVector<AppPurgePath> &paths)
+{
+    if (isPurging())
+        return;
+
+    // Group the paths by drives
+    QMap<QString, QVector<AppPurgePath>> drivePaths;
+
+    for (const AppPurgePath &path : paths) {
+        const QString drive = path.appPath.left(2).toUpper();
+
+        drivePaths[drive].append(path);
+    }
+
+    for (auto it = drivePaths.constBegin(); it != drivePaths.constEnd(); ++it) {
+        enqueueDriveJobs(it.key(), it.value());
+    }
+
+    if (!isPurging()) {
+        emit purgeFinished({});
+    }
+}
+
+void AppPurgeManager::enqueueDriveJobs(const QString &drive, const QVector<AppPurgePath> &paths)
+{
+    const int pathsCount = paths.size();
+
+    for (int i = 0; i < pathsCount; i += APP_PURGE_BATCH_SIZE) {
+        enqueueJob(WorkerJobPtr(new AppPurgeJob(drive, paths.mid(i, APP_PURGE_BATCH_SIZE))));
+
+        ++m_jobsCount;
+    }
+}
+
+void AppPurgeManager::onJobFinished(
+        const QString &drive, const QVector<qint64> &appIdList, bool timedOut)
+{
+    // The whole drive is kept, when any of its batches timed out
+    if (timedOut) {
+        m_timedOutDrives.insert(drive);
+    } else {
+        m_driveAppIds[drive].append(appIdList);
+    }
+
+    if (--m_jobsCount > 0)
+        return;
+
+    QVector<qint64> purgeAppIdList;
+
+    for (auto it = m_driveAppIds.constBegin(); it != m_driveAppIds.constEnd(); ++it) {
+        if (!m_timedOutDrives.contains(it.key())) {
+            purgeAppIdList.append(it.value());
+        }
+    }
+
+    m_timedOutDrives.clear();
+    m_driveAppIds.clear();
+
+    emit purgeFinished(purgeAppIdList);
+}
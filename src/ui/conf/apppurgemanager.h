@@ -0,0 +1,43 @@
+#ifndef APPPURGEMANAGER_H
+#define APPPURGEMANAGER_H
+
+#include <QSet>
+
+#include <util/worker/workermanager.h>
+
+#include "apppurgejob.h"
+
+class AppPurgeManager : public WorkerManager
+{
+    Q_OBJECT
+
+public:
+    explicit AppPurgeManager(QObject *parent = nullptr);
+
+    QString workerName() const override { return "AppPurgeWorker"; }
+
+    bool isPurging() const { return m_jobsCount != 0; }
+
+signals:
+    void jobFinished(const QString &drive, const QVector<qint64> &appIdList, bool timedOut);
+
+    void purgeFinished(const QVector<qint64> &appIdList);
+
+public slots:
+    // The paths must be of the available drives
+    void purgeApps(const QVector<AppPurgePath> &paths);
+
+private slots:
+    void onJobFinished(const QString &drive, const QVector<qint64> &appIdList, bool timedOut);
+
+private:
+    void enqueueDriveJobs(const QString &drive, const QVector<AppPurgePath> &paths);
+
+private:
+    int m_jobsCount = 0;
+
+    QSet<QString> m_timedOutDrives;
+    QHash<QString, QVector<qint64>> m_driveAppIds;
+};
+
+#endif // APPPURGEMANAGER_H
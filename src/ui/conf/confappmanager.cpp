@@ -6,7 +6,6 @@
 #include <sqlite/sqlitestmt.h>
 
 #include <appinfo/appinfocache.h>
-#include <appinfo/appinfoutil.h>
 #include <conf/app.h>
 #include <driver/drivermanager.h>
 #include <log/logentryblocked.h>
@@ -19,6 +18,7 @@
 #include <util/ioc/ioccontainer.h>
 
 #include "appgroup.h"
+#include "apppurgemanager.h"
 #include "confmanager.h"
 #include "firewallconf.h"
 
@@ -29,12 +29,14 @@ const QLoggingCategory LC("confApp");
 constexpr int APP_END_TIMER_INTERVAL_MIN = 100;
 constexpr int APP_END_TIMER_INTERVAL_MAX = 24 * 60 * 60 * 1000; // 1 day
 
+constexpr int APP_ALERT_REPEAT_MSECS = 5 * 1000;
+constexpr int APP_ALERT_PATHS_MAX = 256; // then the expired paths are removed
+
+constexpr quint32 CONF_APP_ID_MAX = 1024 * 1024; // of the dense resolved paths
+
 const char *const sqlSelectAppPaths = "SELECT app_id, path FROM app;";
 
-#define SELECT_APP_FIELDS                                                                          \
-    "    t.app_id,"                                                                                \
-    "    t.origin_path,"                                                                           \
-    "    t.path,"                                                                                  \
+#define SELECT_APP_FLAGS_FIELDS                                                                    \
     "    t.is_wildcard,"                                                                           \
     "    t.use_group_perm,"                                                                        \
     "    t.apply_child,"                                                                           \
@@ -49,14 +51,22 @@ const char *const sqlSelectAppPaths = "SELECT app_id, path FROM app;";
     "    g.order_index as group_index,"                                                            \
     "    (alert.app_id IS NOT NULL) as alerted"
 
+#define SELECT_APP_FIELDS                                                                          \
+    "    t.app_id,"                                                                                \
+    "    t.origin_path,"                                                                           \
+    "    t.path," SELECT_APP_FLAGS_FIELDS
+
 const char *const sqlSelectAppById = "SELECT" SELECT_APP_FIELDS "  FROM app t"
                                      "    JOIN app_group g ON g.app_group_id = t.app_group_id"
                                      "    LEFT JOIN app_alert alert ON alert.app_id = t.app_id"
                                      "    WHERE t.app_id = ?1;";
 
-const char *const sqlSelectApps = "SELECT" SELECT_APP_FIELDS "  FROM app t"
-                                  "    JOIN app_group g ON g.app_group_id = t.app_group_id"
-                                  "    LEFT JOIN app_alert alert ON alert.app_id = t.app_id;";
+// Only the driver conf's fields in the SELECT_APP_FIELDS order
+const char *const sqlSelectConfApps =
+        "SELECT 0, (CASE WHEN t.is_wildcard THEN t.origin_path END), t.path,"
+        SELECT_APP_FLAGS_FIELDS "  FROM app t"
+        "    JOIN app_group g ON g.app_group_id = t.app_group_id"
+        "    LEFT JOIN app_alert alert ON alert.app_id = t.app_id;";
 
 const char *const sqlSelectMinEndApp = "SELECT MIN(end_time) FROM app"
                                        "  WHERE end_time != 0 AND blocked = 0;";
@@ -116,12 +126,14 @@ void showErrorMessage(const QString &errorMessage)
 
 ConfAppManager::ConfAppManager(QObject *parent) : QObject(parent)
 {
-    connect(&m_appAlertedTimer, &QTimer::timeout, this, &ConfAppManager::appAlerted);
-    connect(&m_appChangedTimer, &QTimer::timeout, this, &ConfAppManager::appChanged);
-    connect(&m_appUpdatedTimer, &QTimer::timeout, this, &ConfAppManager::appUpdated);
+    connect(&m_appAlertedTimer, &TriggerTimer::timeout, this, &ConfAppManager::appAlerted);
+    connect(&m_appChangedTimer, &TriggerTimer::timeout, this, &ConfAppManager::appChanged);
+    connect(&m_appUpdatedTimer, &TriggerTimer::timeout, this, &ConfAppManager::appUpdated);
 
     m_appEndTimer.setSingleShot(true);
     connect(&m_appEndTimer, &QTimer::timeout, this, &ConfAppManager::updateAppEndTimes);
+
+    m_alertTimer.start();
 }
 
 ConfManager *ConfAppManager::confManager() const
@@ -143,6 +155,8 @@ void ConfAppManager::setUp()
 {
     m_confManager = IoC()->setUpDependency<ConfManager>();
 
+    loadAppPaths();
+
     purgeAppsOnStart();
 
     setupAppEndTimer();
@@ -213,9 +227,18 @@ void ConfAppManager::logBlockedApp(const LogEntryBlocked &logEntry)
     const QString appOriginPath = logEntry.path();
     const QString appPath = FileUtil::normalizePath(appOriginPath);
 
-    if (appIdByPath(appPath) > 0)
+    if (m_appPaths.contains(appPath))
         return; // already added by user
 
+    if (isAppAlertRepeated(appPath))
+        return;
+
+    const qint64 appId = appIdByPath(appPath);
+    if (appId > 0) {
+        m_appPaths.insert(appPath, appId); // missed by the index
+        return;
+    }
+
     const QString appName = IoC<AppInfoCache>()->appName(appOriginPath);
 
     App app;
@@ -232,11 +255,80 @@ void ConfAppManager::logBlockedApp(const LogEntryBlocked &logEntry)
     }
 }
 
+bool ConfAppManager::isAppAlertRepeated(const QString &appPath)
+{
+    const qint64 nowMsecs = m_alertTimer.elapsed();
+
+    const qint64 alertMsecs = m_alertedPaths.value(appPath, -APP_ALERT_REPEAT_MSECS);
+    if (nowMsecs - alertMsecs < APP_ALERT_REPEAT_MSECS)
+        return true;
+
+    if (m_alertedPaths.size() >= APP_ALERT_PATHS_MAX) {
+        for (auto it = m_alertedPaths.begin(); it != m_alertedPaths.end();) {
+            if (nowMsecs - it.value() >= APP_ALERT_REPEAT_MSECS) {
+                it = m_alertedPaths.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    m_alertedPaths.insert(appPath, nowMsecs);
+
+    return false;
+}
+
+void ConfAppManager::loadAppPaths()
+{
+    m_appPaths.clear();
+
+    SqliteStmt stmt;
+    if (!sqliteDb()->prepare(stmt, sqlSelectAppPaths))
+        return;
+
+    while (stmt.step() == SqliteStmt::StepRow) {
+        const qint64 appId = stmt.columnInt64(0);
+        const QString appPath = stmt.columnText(1);
+
+        if (!appPath.isEmpty()) {
+            m_appPaths.insert(appPath, appId);
+        }
+    }
+}
+
+void ConfAppManager::insertAppPath(const QString &appPath, qint64 appId)
+{
+    // The app's path may be changed
+    for (auto it = m_appPaths.begin(); it != m_appPaths.end();) {
+        if (it.value() == appId) {
+            it = m_appPaths.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (!appPath.isEmpty()) {
+        m_appPaths.insert(appPath, appId);
+    }
+}
+
 qint64 ConfAppManager::appIdByPath(const QString &appPath)
 {
     return sqliteDb()->executeEx(sqlSelectAppIdByPath, { appPath }).toLongLong();
 }
 
+void ConfAppManager::setConfAppPath(quint32 confAppId, const QString &path)
+{
+    if (confAppId > CONF_APP_ID_MAX)
+        return;
+
+    if (confAppId >= quint32(m_confAppPaths.size())) {
+        m_confAppPaths.resize(confAppId + 1);
+    }
+
+    m_confAppPaths[confAppId] = path;
+}
+
 bool ConfAppManager::addApp(const App &app)
 {
     if (!addOrUpdateApp(app))
@@ -249,23 +341,53 @@ bool ConfAppManager::addApp(const App &app)
 
 void ConfAppManager::deleteApps(const QVector<qint64> &appIdList)
 {
-    bool isWildcard = false;
+    if (appIdList.isEmpty())
+        return;
+
+    QVector<App> deletedApps;
+    bool ok = true;
+
+    // Delete the apps in one transaction
+    beginTransaction();
 
     for (const qint64 appId : appIdList) {
-        deleteApp(appId, isWildcard);
+        if (!deleteApp(appId, deletedApps)) {
+            ok = false;
+            break;
+        }
+    }
+
+    if (!commitTransaction(ok))
+        return;
+
+    bool isWildcard = false;
+    QVector<App> driverApps;
+
+    for (const App &app : std::as_const(deletedApps)) {
+        m_appPaths.remove(app.appPath);
+
+        if (app.isWildcard) {
+            isWildcard = true;
+        } else {
+            driverApps.append(app);
+        }
+    }
+
+    if (!deletedApps.isEmpty()) {
+        emitAppChanged();
     }
 
     if (isWildcard) {
         updateDriverConf();
+    } else if (!driverApps.isEmpty()) {
+        updateDriverUpdateApps(driverApps, /*remove=*/true);
     }
 }
 
-bool ConfAppManager::deleteApp(qint64 appId, bool &isWildcard)
+bool ConfAppManager::deleteApp(qint64 appId, QVector<App> &deletedApps)
 {
     bool ok = false;
 
-    beginTransaction();
-
     const auto vars = QVariantList() << appId;
 
     const auto resList = sqliteDb()->executeEx(sqlDeleteApp, vars, 2, &ok).toList();
@@ -274,28 +396,39 @@ bool ConfAppManager::deleteApp(qint64 appId, bool &isWildcard)
         sqliteDb()->executeEx(sqlDeleteAppAlert, vars, 0, &ok);
     }
 
-    commitTransaction(ok);
+    if (ok && !resList.isEmpty()) {
+        App app;
+        app.appPath = resList.at(0).toString();
+        app.isWildcard = resList.at(1).toBool();
 
-    if (ok) {
-        const QString appPath = resList.at(0).toString();
+        deletedApps.append(app);
+    }
 
-        if (resList.at(1).toBool()) {
-            isWildcard = true;
-        } else {
-            updateDriverDeleteApp(appPath);
-        }
+    return ok;
+}
 
-        emitAppChanged();
+AppPurgeManager *ConfAppManager::appPurgeManager()
+{
+    if (!m_appPurgeManager) {
+        m_appPurgeManager = new AppPurgeManager(this);
+
+        connect(m_appPurgeManager, &AppPurgeManager::purgeFinished, this,
+                &ConfAppManager::deleteApps);
     }
 
-    return ok;
+    return m_appPurgeManager;
 }
 
 bool ConfAppManager::purgeApps()
 {
-    QVector<qint64> appIdList;
+    if (appPurgeManager()->isPurging())
+        return true;
+
+    const quint32 driveMask = IoC<DriveListManager>()->driveMask();
 
-    // Collect non-existent apps
+    QVector<AppPurgePath> paths;
+
+    // Collect the apps of the available drives, their files are checked by the workers
     {
         SqliteStmt stmt;
         if (!sqliteDb()->prepare(stmt, sqlSelectAppPaths))
@@ -304,17 +437,14 @@ bool ConfAppManager::purgeApps()
         while (stmt.step() == SqliteStmt::StepRow) {
             const QString appPath = stmt.columnText(1);
 
-            if (FileUtil::isDriveFilePath(appPath) && !AppInfoUtil::fileExists(appPath)) {
-                const qint64 appId = stmt.columnInt64(0);
-                appIdList.append(appId);
+            if ((FileUtil::driveMaskByPath(appPath) & driveMask) == 0)
+                continue;
 
-                qCDebug(LC) << "Purge obsolete app:" << appId << appPath;
-            }
+            paths.append({ .appId = stmt.columnInt64(0), .appPath = appPath });
         }
     }
 
-    // Delete apps
-    deleteApps(appIdList);
+    appPurgeManager()->purgeApps(paths);
 
     return true;
 }
@@ -345,6 +475,8 @@ bool ConfAppManager::updateApp(const App &app)
     commitTransaction(ok);
 
     if (ok) {
+        insertAppPath(app.appPath, app.appId);
+
         if (!app.endTime.isNull()) {
             updateAppEndTimer();
         }
@@ -360,19 +492,22 @@ bool ConfAppManager::updateApp(const App &app)
 void ConfAppManager::updateAppsBlocked(
         const QVector<qint64> &appIdList, bool blocked, bool killProcess)
 {
-    bool isWildcard = (appIdList.size() > 7);
+    bool isWildcard = false;
+    QVector<App> driverApps;
 
     for (const qint64 appId : appIdList) {
-        updateAppBlocked(appId, blocked, killProcess, isWildcard);
+        updateAppBlocked(appId, blocked, killProcess, isWildcard, driverApps);
     }
 
     if (isWildcard) {
         updateDriverConf();
+    } else if (!driverApps.isEmpty()) {
+        updateDriverUpdateApps(driverApps);
     }
 }
 
-bool ConfAppManager::updateAppBlocked(
-        qint64 appId, bool blocked, bool killProcess, bool &isWildcard)
+bool ConfAppManager::updateAppBlocked(qint64 appId, bool blocked, bool killProcess,
+        bool &isWildcard, QVector<App> &driverApps)
 {
     App app;
     app.appId = appId;
@@ -385,7 +520,7 @@ bool ConfAppManager::updateAppBlocked(
     if (app.isWildcard) {
         isWildcard = true;
     } else {
-        updateDriverUpdateApp(app);
+        driverApps.append(app);
     }
 
     return true;
@@ -427,11 +562,13 @@ bool ConfAppManager::updateAppName(qint64 appId, const QString &appName)
 bool ConfAppManager::walkApps(const std::function<walkAppsCallback> &func)
 {
     SqliteStmt stmt;
-    if (!sqliteDb()->prepare(stmt, sqlSelectApps))
+    if (!sqliteDb()->prepare(stmt, sqlSelectConfApps))
         return false;
 
+    // Reuse the app's strings buffers
+    App app;
+
     while (stmt.step() == SqliteStmt::StepRow) {
-        App app;
         fillApp(app, stmt);
 
         if (!func(app))
@@ -490,6 +627,13 @@ bool ConfAppManager::updateDriverConf(bool onlyFlags)
     ConfUtil confUtil;
     QByteArray buf;
 
+    if (!onlyFlags) {
+        m_driverAppsKey.clear();
+
+        confUtil.setAppsTextCache(confManager()->appsTextCache());
+        confUtil.setPolicySet(confManager()->policySet());
+    }
+
     const int confSize = onlyFlags ? confUtil.writeFlags(*conf(), buf)
                                    : confUtil.write(*conf(), this, *IoC<EnvManager>(), buf);
     if (confSize == 0) {
@@ -505,6 +649,59 @@ bool ConfAppManager::updateDriverConf(bool onlyFlags)
 
     m_driveMask = confUtil.driveMask();
 
+    if (!onlyFlags) {
+        m_confAppPaths.clear();
+
+        const ConfWriteTimes &times = confUtil.writeTimes();
+
+        qCDebug(LC) << "Driver conf:" << confSize << "bytes;"
+                    << "address groups:" << times.addressGroupsMsecs << "ms;"
+                    << "apps:" << times.appsMsecs << "ms;"
+                    << "total:" << times.totalMsecs << "ms";
+
+        m_driverAppsKey = ConfUtil::appsKey(*conf());
+        m_driverPatchSections = confUtil.patchSections();
+
+        updateDriverLogRing();
+    }
+
+    return true;
+}
+
+void ConfAppManager::updateDriverLogRing()
+{
+    const int logRingSize = conf()->ini().logRingSize();
+    if (logRingSize <= 0)
+        return;
+
+    // The logs are read by requests, when the ring can't be opened
+    auto driverManager = IoC<DriverManager>();
+    driverManager->openLogRing(logRingSize * 1024 * 1024);
+}
+
+bool ConfAppManager::updateDriverConfPatch()
+{
+    // Apps must be written by the whole conf
+    if (m_driverAppsKey.isEmpty() || m_driverAppsKey != ConfUtil::appsKey(*conf()))
+        return updateDriverConf();
+
+    ConfUtil confUtil;
+    QByteArray buf;
+
+    ConfPatchSections sections = m_driverPatchSections;
+
+    const int patchSize = confUtil.writePatch(*conf(), sections, buf);
+    if (patchSize == 0) {
+        showErrorMessage(confUtil.errorMessage());
+        return false;
+    }
+
+    auto driverManager = IoC<DriverManager>();
+    if (!driverManager->writeConfPatch(buf, patchSize))
+        return updateDriverConf();
+
+    m_driverPatchSections = sections;
+
     return true;
 }
 
@@ -526,16 +723,20 @@ bool ConfAppManager::addOrUpdateApp(const App &app)
             << (!app.endTime.isNull() ? app.endTime : QVariant()) << QDateTime::currentDateTime();
 
     const auto appIdVar = sqliteDb()->executeEx(sqlUpsertApp, vars, 1, &ok);
+    const qint64 appId = appIdVar.toLongLong();
 
     if (ok) {
         // Alert
-        const qint64 appId = appIdVar.toLongLong();
         sqliteDb()->executeEx(app.alerted ? sqlInsertAppAlert : sqlDeleteAppAlert, { appId });
     }
 
     commitTransaction(ok);
 
     if (ok) {
+        if (!app.appPath.isEmpty()) {
+            m_appPaths.insert(app.appPath, appId);
+        }
+
         if (!app.endTime.isNull()) {
             updateAppEndTimer();
         }
@@ -581,20 +782,17 @@ void ConfAppManager::fillApp(App &app, const SqliteStmt &stmt)
     app.alerted = stmt.columnBool(15);
 }
 
-bool ConfAppManager::updateDriverDeleteApp(const QString &appPath)
+bool ConfAppManager::updateDriverUpdateApp(const App &app, bool remove)
 {
-    App app;
-    app.appPath = appPath;
-
-    return updateDriverUpdateApp(app, /*remove=*/true);
+    return updateDriverUpdateApps({ app }, remove);
 }
 
-bool ConfAppManager::updateDriverUpdateApp(const App &app, bool remove)
+bool ConfAppManager::updateDriverUpdateApps(const QVector<App> &apps, bool remove)
 {
     ConfUtil confUtil;
     QByteArray buf;
 
-    const int entrySize = confUtil.writeAppEntry(app, /*isNew=*/false, buf);
+    const int entrySize = confUtil.writeAppEntries(apps, /*isNew=*/false, buf);
 
     if (entrySize == 0) {
         showErrorMessage(confUtil.errorMessage());
@@ -609,6 +807,13 @@ bool ConfAppManager::updateDriverUpdateApp(const App &app, bool remove)
 
     m_driveMask |= remove ? 0 : confUtil.driveMask();
 
+    // The app's path may be changed
+    for (const App &app : apps) {
+        if (app.appId < m_confAppPaths.size()) {
+            m_confAppPaths[app.appId].clear();
+        }
+    }
+
     return true;
 }
 
@@ -1,16 +1,21 @@
 #ifndef CONFAPPMANAGER_H
 #define CONFAPPMANAGER_H
 
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QTimer>
 
 #include <sqlite/sqlitetypes.h>
 
 #include <util/classhelpers.h>
 #include <util/conf/confappswalker.h>
+#include <util/conf/confutil.h>
 #include <util/ioc/iocservice.h>
 #include <util/triggertimer.h>
 
 class App;
+class AppPurgeManager;
 class ConfManager;
 class FirewallConf;
 class LogEntryBlocked;
@@ -30,10 +35,17 @@ public:
 
     void setUp() override;
 
+    // Reloads the known apps' paths, e.g. after the DB import
+    void loadAppPaths();
+
     void logBlockedApp(const LogEntryBlocked &logEntry);
 
     qint64 appIdByPath(const QString &appPath);
 
+    // Resolved paths of the processes by their conf's exe apps
+    QString confAppPath(quint32 confAppId) const { return m_confAppPaths.value(confAppId); }
+    void setConfAppPath(quint32 confAppId, const QString &path);
+
     virtual bool addApp(const App &app);
     virtual void deleteApps(const QVector<qint64> &appIdList);
     virtual bool purgeApps();
@@ -48,6 +60,7 @@ public:
     void updateAppEndTimes();
 
     virtual bool updateDriverConf(bool onlyFlags = false);
+    virtual bool updateDriverConfPatch();
 
 signals:
     void appAlerted();
@@ -63,9 +76,12 @@ protected:
 private:
     void setupDriveListManager();
 
-    bool deleteApp(qint64 appId, bool &isWildcard);
+    bool deleteApp(qint64 appId, QVector<App> &deletedApps);
+
+    AppPurgeManager *appPurgeManager();
 
-    bool updateAppBlocked(qint64 appId, bool blocked, bool killProcess, bool &isWildcard);
+    bool updateAppBlocked(qint64 appId, bool blocked, bool killProcess, bool &isWildcard,
+            QVector<App> &driverApps);
     bool prepareAppBlocked(App &app, bool blocked, bool killProcess);
 
 private:
@@ -75,13 +91,18 @@ private:
 
     bool addOrUpdateApp(const App &app);
 
+    bool isAppAlertRepeated(const QString &appPath);
+    void insertAppPath(const QString &appPath, qint64 appId);
+
     bool loadAppById(App &app);
     static void fillApp(App &app, const SqliteStmt &stmt);
 
-    bool updateDriverDeleteApp(const QString &appPath);
     bool updateDriverUpdateApp(const App &app, bool remove = false);
+    bool updateDriverUpdateApps(const QVector<App> &apps, bool remove = false);
     bool updateDriverUpdateAppConf(const App &app);
 
+    void updateDriverLogRing();
+
     bool beginTransaction();
     bool commitTransaction(bool ok);
     bool checkEndTransaction(bool ok);
@@ -89,13 +110,27 @@ private:
 private:
     quint32 m_driveMask = 0;
 
+    QByteArray m_driverAppsKey;
+    ConfPatchSections m_driverPatchSections;
+
     ConfManager *m_confManager = nullptr;
+    AppPurgeManager *m_appPurgeManager = nullptr;
 
     TriggerTimer m_appAlertedTimer;
     TriggerTimer m_appChangedTimer;
     TriggerTimer m_appUpdatedTimer;
 
     QTimer m_appEndTimer;
+
+    // The known apps, to not query the DB by each blocked app's log record
+    QHash<QString, qint64> m_appPaths; // normalized path -> app id
+
+    // Dense by the conf's app ids, cleared by each driver's conf
+    QVector<QString> m_confAppPaths;
+
+    // The recently alerted apps, to drop the repeated alerts
+    QHash<QString, qint64> m_alertedPaths; // normalized path -> alert msecs
+    QElapsedTimer m_alertTimer;
 };
 
 #endif // CONFAPPMANAGER_H
@@ -1,7 +1,10 @@
 #include "confmanager.h"
 
+#include <QEventLoop>
+#include <QFutureWatcher>
 #include <QHash>
 #include <QLoggingCategory>
+#include <QtConcurrent>
 
 #include <sqlite/sqlitedb.h>
 #include <sqlite/sqlitestmt.h>
@@ -28,12 +31,18 @@
 #include "appgroup.h"
 #include "confappmanager.h"
 #include "firewallconf.h"
+#include "rules/policy.h"
 
 namespace {
 
 const QLoggingCategory LC("conf");
 
-constexpr int DATABASE_USER_VERSION = 28;
+constexpr int DATABASE_USER_VERSION = 33;
+
+const SqliteDb::TuneOptions databaseTuneOptions = {
+    .cacheSizeKb = 2048,
+    .mmapSize = 16 * 1024 * 1024,
+};
 
 const char *const sqlSelectAddressGroups = "SELECT addr_group_id, include_all, exclude_all,"
                                            "    include_zones, exclude_zones,"
@@ -48,10 +57,23 @@ const char *const sqlSelectAppGroups = "SELECT app_group_id, enabled, apply_chil
                                        "    limit_packet_loss, limit_latency,"
                                        "    limit_bufsize_in, limit_bufsize_out,"
                                        "    name, kill_text, block_text, allow_text,"
-                                       "    period_from, period_to"
+                                       "    period_from, period_to, limit_fq, limit_burst,"
+                                       "    log_stat, limit_fq_proc, limit_ecn, limit_pacing"
                                        "  FROM app_group"
                                        "  ORDER BY order_index;";
 
+// The rules of the enabled policies, checked by the driver before the apps
+const char *const sqlSelectPolicyRules = "SELECT r.rule_id, r.block, r.rule_flags, r.ip_proto,"
+                                         "    r.local_port, r.remote_port, r.local_ip, r.remote_ip,"
+                                         "    r.name"
+                                         "  FROM policy p"
+                                         "    JOIN policy_rule pr ON pr.policy_id = p.policy_id"
+                                         "    JOIN rule r ON r.rule_id = pr.rule_id"
+                                         "  WHERE p.policy_type = ?1 AND p.enabled = 1"
+                                         "    AND coalesce(p.deleted, 0) = 0"
+                                         "    AND r.enabled = 1 AND coalesce(r.deleted, 0) = 0"
+                                         "  ORDER BY p.policy_id, pr.order_index;";
+
 const char *const sqlInsertAddressGroup = "INSERT INTO address_group(addr_group_id, order_index,"
                                           "    include_all, exclude_all,"
                                           "    include_zones, exclude_zones,"
@@ -72,9 +94,11 @@ const char *const sqlInsertAppGroup = "INSERT INTO app_group(app_group_id, order
                                       "    limit_packet_loss, limit_latency,"
                                       "    limit_bufsize_in, limit_bufsize_out,"
                                       "    name, kill_text, block_text, allow_text,"
-                                      "    period_from, period_to)"
+                                      "    period_from, period_to, limit_fq, limit_burst,"
+                                      "    log_stat, limit_fq_proc, limit_ecn, limit_pacing)"
                                       "  VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12,"
-                                      "    ?13, ?14, ?15, ?16, ?17, ?18, ?19, ?20, ?21, ?22);";
+                                      "    ?13, ?14, ?15, ?16, ?17, ?18, ?19, ?20, ?21, ?22, ?23,"
+                                      "    ?24, ?25, ?26, ?27, ?28);";
 
 const char *const sqlUpdateAppGroup = "UPDATE app_group"
                                       "  SET order_index = ?2, enabled = ?3,"
@@ -85,7 +109,9 @@ const char *const sqlUpdateAppGroup = "UPDATE app_group"
                                       "    limit_packet_loss = ?13, limit_latency = ?14,"
                                       "    limit_bufsize_in = ?15, limit_bufsize_out = ?16,"
                                       "    name = ?17, kill_text = ?18, block_text = ?19,"
-                                      "    allow_text = ?20, period_from = ?21, period_to = ?22"
+                                      "    allow_text = ?20, period_from = ?21, period_to = ?22,"
+                                      "    limit_fq = ?23, limit_burst = ?24, log_stat = ?25,"
+                                      "    limit_fq_proc = ?26, limit_ecn = ?27, limit_pacing = ?28"
                                       "  WHERE app_group_id = ?1;";
 
 const char *const sqlDeleteAppGroup = "DELETE FROM app_group"
@@ -200,6 +226,18 @@ bool migrateAppPaths(SqliteDb *db)
     return true;
 }
 
+bool backupDb(const QString &filePath, const QString &destFilePath)
+{
+    // A separate connection to not lock the conf's one while copying
+    SqliteDb db(filePath, SqliteDb::OpenDefaultReadOnly);
+    if (!db.open()) {
+        qCWarning(LC) << "Backup Db open error:" << db.errorMessage() << filePath;
+        return false;
+    }
+
+    return db.backupTo(destFilePath);
+}
+
 bool migrateFunc(SqliteDb *db, int version, bool isNewDb, void *ctx)
 {
     Q_UNUSED(ctx);
@@ -250,6 +288,33 @@ bool loadAddressGroups(SqliteDb *db, const QList<AddressGroup *> &addressGroups,
     return true;
 }
 
+bool loadPolicyRules(SqliteDb *db, QVector<Rule> &rules)
+{
+    SqliteStmt stmt;
+    if (!db->prepare(stmt, sqlSelectPolicyRules))
+        return false;
+
+    stmt.bindInt(1, Policy::TypeGlobalBeforeApp);
+
+    rules.clear();
+    while (stmt.step() == SqliteStmt::StepRow) {
+        Rule rule;
+        rule.ruleId = stmt.columnInt(0);
+        rule.block = stmt.columnBool(1);
+        rule.ruleFlags = quint16(stmt.columnInt(2));
+        rule.ipProto = quint16(stmt.columnInt(3));
+        rule.localPortText = stmt.columnText(4);
+        rule.remotePortText = stmt.columnText(5);
+        rule.localIpText = stmt.columnText(6);
+        rule.remoteIpText = stmt.columnText(7);
+        rule.name = stmt.columnText(8);
+
+        rules.append(rule);
+    }
+
+    return true;
+}
+
 bool saveAddressGroup(SqliteDb *db, AddressGroup *addrGroup, int orderIndex)
 {
     const bool rowExists = (addrGroup->id() != 0);
@@ -280,8 +345,14 @@ bool saveAddressGroups(SqliteDb *db, const FirewallConf &conf)
 {
     int orderIndex = 0;
     for (AddressGroup *addrGroup : conf.addressGroups()) {
+        const bool changed = addrGroup->edited() || addrGroup->id() == 0;
+
         if (!saveAddressGroup(db, addrGroup, orderIndex++))
             return false;
+
+        if (changed) {
+            conf.addChangedAddressGroupId(addrGroup->id());
+        }
     }
     return true;
 }
@@ -316,6 +387,12 @@ bool loadAppGroups(SqliteDb *db, FirewallConf &conf)
         appGroup->setAllowText(stmt.columnText(18));
         appGroup->setPeriodFrom(stmt.columnText(19));
         appGroup->setPeriodTo(stmt.columnText(20));
+        appGroup->setLimitFairQueue(stmt.columnBool(21));
+        appGroup->setLimitBurstSize(quint32(stmt.columnInt(22)));
+        appGroup->setLogStat(stmt.columnBool(23));
+        appGroup->setLimitFairProcess(stmt.columnBool(24));
+        appGroup->setLimitEcn(stmt.columnBool(25));
+        appGroup->setLimitPacing(stmt.columnBool(26));
         appGroup->setEdited(false);
 
         conf.addAppGroup(appGroup);
@@ -338,7 +415,9 @@ bool saveAppGroup(SqliteDb *db, AppGroup *appGroup, int orderIndex)
             << appGroup->limitPacketLoss() << appGroup->limitLatency()
             << appGroup->limitBufferSizeIn() << appGroup->limitBufferSizeOut() << appGroup->name()
             << appGroup->killText() << appGroup->blockText() << appGroup->allowText()
-            << appGroup->periodFrom() << appGroup->periodTo();
+            << appGroup->periodFrom() << appGroup->periodTo() << appGroup->limitFairQueue()
+            << appGroup->limitBurstSize() << appGroup->logStat() << appGroup->limitFairProcess()
+            << appGroup->limitEcn() << appGroup->limitPacing();
 
     const char *sql = rowExists ? sqlUpdateAppGroup : sqlInsertAppGroup;
 
@@ -357,8 +436,14 @@ bool saveAppGroups(SqliteDb *db, const FirewallConf &conf)
 {
     int orderIndex = 0;
     for (AppGroup *appGroup : conf.appGroups()) {
+        const bool changed = appGroup->edited() || appGroup->id() == 0;
+
         if (!saveAppGroup(db, appGroup, orderIndex++))
             return false;
+
+        if (changed) {
+            conf.addChangedAppGroupId(appGroup->id());
+        }
     }
     return true;
 }
@@ -512,6 +597,8 @@ bool ConfManager::setupDb()
         return false;
     }
 
+    sqliteDb()->tune(databaseTuneOptions);
+
     return true;
 }
 
@@ -552,6 +639,8 @@ bool ConfManager::loadConf(FirewallConf &conf)
             setupDefault(conf);
             saveToDb(conf);
         }
+
+        conf.setAllGroupsChanged();
     }
 
     IoC<FortSettings>()->readConfIni(conf);
@@ -657,8 +746,7 @@ void ConfManager::saveIniUser(bool edited, bool onlyFlags)
 QVariant ConfManager::toPatchVariant(bool onlyFlags) const
 {
     return onlyFlags ? conf()->toVariant(/*onlyEdited=*/true) // send only flags to clients
-                     : FirewallConf::editedFlagsToVariant(
-                             FirewallConf::AllEdited); // clients have to reload all from storage
+                     : conf()->toPatchVariant(); // clients have to patch the changed groups
 }
 
 bool ConfManager::saveVariant(const QVariant &confVar)
@@ -690,6 +778,41 @@ bool ConfManager::saveVariant(const QVariant &confVar)
     return true;
 }
 
+bool ConfManager::saveAppGroupsVariant(const QVariantList &appGroupsList)
+{
+    if (appGroupsList.isEmpty())
+        return true;
+
+    FirewallConf *conf = createConf();
+    conf->copy(*this->conf());
+
+    for (const QVariant &v : appGroupsList) {
+        const QString name = v.toMap()["name"].toString();
+        if (name.isEmpty())
+            continue;
+
+        AppGroup *appGroup = conf->appGroupByName(name);
+        if (!appGroup) {
+            appGroup = conf->addAppGroupByName(name);
+        }
+
+        const qint64 appGroupId = appGroup->id();
+
+        appGroup->fromVariant(v);
+        appGroup->setId(appGroupId);
+        appGroup->setEdited(true);
+    }
+
+    conf->setOptEdited();
+
+    if (!save(conf)) {
+        delete conf;
+        return false;
+    }
+
+    return true;
+}
+
 bool ConfManager::loadTasks(const QList<TaskInfo *> &taskInfos)
 {
     for (TaskInfo *taskInfo : taskInfos) {
@@ -739,9 +862,17 @@ bool ConfManager::exportMasterBackup(const QString &path)
         const QString fileName = FileUtil::fileName(sqliteDb()->filePath());
         const QString destFilePath = path + fileName;
 
-        FileUtil::removeFile(destFilePath);
-        if (!sqliteDb()->vacuumInto(destFilePath)) {
-            qCWarning(LC) << "Export Db error:" << sqliteDb()->errorMessage() << "to:" << path;
+        // Copy the DB by a worker, while the events are processed
+        QFutureWatcher<bool> watcher;
+        QEventLoop loop;
+
+        connect(&watcher, &QFutureWatcherBase::finished, &loop, &QEventLoop::quit);
+
+        watcher.setFuture(QtConcurrent::run(backupDb, sqliteDb()->filePath(), destFilePath));
+        loop.exec();
+
+        if (!watcher.result()) {
+            qCWarning(LC) << "Export Db error to:" << path;
             return false;
         }
     }
@@ -791,6 +922,8 @@ bool ConfManager::importMasterBackup(const QString &path)
             return false;
         }
 
+        IoC<ConfAppManager>()->loadAppPaths();
+
         load();
     }
 
@@ -818,6 +951,9 @@ bool ConfManager::validateConf(const FirewallConf &newConf)
         return true;
 
     ConfUtil confUtil;
+    confUtil.setAppsTextCache(appsTextCache());
+    confUtil.setPolicySet(policySet());
+
     QByteArray buf;
 
     const int confSize = confUtil.write(newConf, IoC<ConfAppManager>(), *IoC<EnvManager>(), buf);
@@ -887,6 +1023,15 @@ bool ConfManager::loadFromDb(FirewallConf &conf, bool &isNew)
     if (!loadAppGroups(sqliteDb(), conf))
         return false;
 
+    // Load Policy Rules
+    if (!loadPolicyRules(sqliteDb(), m_policyRules))
+        return false;
+
+    m_policySet.m_rules.clear();
+    for (Rule &rule : m_policyRules) {
+        m_policySet.m_rules.append(&rule);
+    }
+
     return true;
 }
 
@@ -2,13 +2,18 @@
 #define CONFMANAGER_H
 
 #include <QObject>
+#include <QVector>
 
 #include <sqlite/sqlitetypes.h>
 
 #include <util/classhelpers.h>
+#include <util/conf/appparseoptions.h>
 #include <util/ioc/iocservice.h>
 #include <util/service/serviceinfo.h>
 
+#include "rules/policyset.h"
+#include "rules/rule.h"
+
 class FirewallConf;
 class IniOptions;
 class IniUser;
@@ -30,6 +35,11 @@ public:
     IniUser &iniUser() const;
     IniUser *iniUserToEdit() const { return m_iniUserToEdit; }
 
+    appstext_cache_t *appsTextCache() { return &m_appsTextCache; }
+
+    // Rules of the enabled policies, compiled by the full conf writes
+    const PolicySet *policySet() const { return &m_policySet; }
+
     void setUp() override;
 
     void initConfToEdit();
@@ -52,6 +62,9 @@ public:
     QVariant toPatchVariant(bool onlyFlags) const;
     bool saveVariant(const QVariant &confVar);
 
+    // Add or update the app. groups by their names
+    bool saveAppGroupsVariant(const QVariantList &appGroupsList);
+
     bool loadTasks(const QList<TaskInfo *> &taskInfos);
     bool saveTasks(const QList<TaskInfo *> &taskInfos);
 
@@ -108,6 +121,11 @@ private:
     FirewallConf *m_confToEdit = nullptr;
 
     IniUser *m_iniUserToEdit = nullptr;
+
+    appstext_cache_t m_appsTextCache;
+
+    QVector<Rule> m_policyRules;
+    PolicySet m_policySet;
 };
 
 #endif // CONFMANAGER_H
@@ -232,6 +232,17 @@ void ConfZoneManager::updateDriverZones(quint32 zonesMask, quint32 enabledMask,
     driverWriteZones(confUtil, buf, entrySize);
 }
 
+bool ConfZoneManager::updateDriverZone(int zoneId, bool enabled, const QByteArray &zoneData)
+{
+    ConfUtil confUtil;
+    QByteArray buf;
+
+    const int entrySize = confUtil.writeZoneData(zoneId, enabled, zoneData, buf);
+
+    // The caller falls back to the full zones update on error
+    return IoC<DriverManager>()->writeZone(buf, entrySize);
+}
+
 bool ConfZoneManager::updateDriverZoneFlag(int zoneId, bool enabled)
 {
     ConfUtil confUtil;
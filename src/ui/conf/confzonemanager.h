@@ -33,6 +33,7 @@ public:
 
     void updateDriverZones(quint32 zonesMask, quint32 enabledMask, quint32 dataSize,
             const QList<QByteArray> &zonesData);
+    bool updateDriverZone(int zoneId, bool enabled, const QByteArray &zoneData);
 
 signals:
     void zoneAdded();
@@ -1,5 +1,7 @@
 #include "firewallconf.h"
 
+#include <QHash>
+
 #include <fortcompat.h>
 #include <manager/envmanager.h>
 #include <util/net/netutil.h>
@@ -15,6 +17,8 @@ FirewallConf::FirewallConf(Settings *settings, QObject *parent) : QObject(parent
 void FirewallConf::resetEdited(bool v)
 {
     m_editedFlags = v ? AllEdited : NoneEdited;
+
+    clearChangedGroups();
 }
 
 void FirewallConf::setBootFilter(bool bootFilter)
@@ -82,6 +86,11 @@ void FirewallConf::setLogAlertedBlockedIp(bool logAlertedBlockedIp)
     m_logAlertedBlockedIp = logAlertedBlockedIp;
 }
 
+void FirewallConf::setLogFlowStat(bool logFlowStat)
+{
+    m_logFlowStat = logFlowStat;
+}
+
 void FirewallConf::setAppBlockAll(bool appBlockAll)
 {
     m_appBlockAll = appBlockAll;
@@ -257,6 +266,23 @@ void FirewallConf::clearRemovedAppGroupIdList() const
     m_removedAppGroupIdList.clear();
 }
 
+void FirewallConf::setAllGroupsChanged() const
+{
+    for (const AddressGroup *addressGroup : addressGroups()) {
+        addChangedAddressGroupId(addressGroup->id());
+    }
+
+    for (const AppGroup *appGroup : appGroups()) {
+        addChangedAppGroupId(appGroup->id());
+    }
+}
+
+void FirewallConf::clearChangedGroups()
+{
+    m_changedAddressGroupIds.clear();
+    m_changedAppGroupIds.clear();
+}
+
 void FirewallConf::loadAppGroupBits()
 {
     m_appGroupBits = 0;
@@ -321,6 +347,8 @@ void FirewallConf::copyFlags(const FirewallConf &o)
     m_logBlockedIp = o.logBlockedIp();
     m_logAlertedBlockedIp = o.logAlertedBlockedIp();
 
+    m_logFlowStat = o.logFlowStat();
+
     m_appBlockAll = o.appBlockAll();
     m_appAllowAll = o.appAllowAll();
 
@@ -339,10 +367,17 @@ void FirewallConf::copy(const FirewallConf &o)
         addressGroup->copy(*ag);
     }
 
+    // The groups' data are shared with the source groups, until edited
+    m_appGroups.reserve(m_appGroups.size() + o.appGroups().size());
+
     for (const AppGroup *ag : o.appGroups()) {
-        auto appGroup = new AppGroup();
+        auto appGroup = new AppGroup(this);
         appGroup->copy(*ag);
-        addAppGroup(appGroup);
+        m_appGroups.append(appGroup);
+    }
+
+    if (!o.appGroups().isEmpty()) {
+        emit appGroupsChanged();
     }
 
     copyFlags(o); // after app. groups created
@@ -368,6 +403,8 @@ QVariant FirewallConf::flagsToVariant() const
     map["logBlockedIp"] = logBlockedIp();
     map["logAlertedBlockedIp"] = logAlertedBlockedIp();
 
+    map["logFlowStat"] = logFlowStat();
+
     map["appBlockAll"] = appBlockAll();
     map["appAllowAll"] = appAllowAll();
 
@@ -400,6 +437,8 @@ void FirewallConf::flagsFromVariant(const QVariant &v)
     m_logBlockedIp = map["logBlockedIp"].toBool();
     m_logAlertedBlockedIp = map["logAlertedBlockedIp"].toBool();
 
+    m_logFlowStat = map["logFlowStat"].toBool();
+
     m_appBlockAll = map["appBlockAll"].toBool();
     m_appAllowAll = map["appAllowAll"].toBool();
 
@@ -465,6 +504,115 @@ void FirewallConf::removedAppGroupIdListFromVariant(const QVariant &v)
     }
 }
 
+QVariant FirewallConf::changedAddressesToVariant() const
+{
+    QVariantList addresses;
+    for (const AddressGroup *addressGroup : addressGroups()) {
+        if (m_changedAddressGroupIds.contains(addressGroup->id())) {
+            addresses.append(addressGroup->toVariant());
+        }
+    }
+    return addresses;
+}
+
+bool FirewallConf::patchAddressesFromVariant(const QVariant &v)
+{
+    const QVariantList addresses = v.toList();
+
+    QHash<qint64, AddressGroup *> addressGroupsById;
+    for (AddressGroup *addressGroup : addressGroups()) {
+        addressGroupsById.insert(addressGroup->id(), addressGroup);
+    }
+
+    // Check before the patching
+    for (const QVariant &av : addresses) {
+        if (!addressGroupsById.contains(av.toMap()["id"].toLongLong()))
+            return false;
+    }
+
+    for (const QVariant &av : addresses) {
+        AddressGroup *addressGroup = addressGroupsById.value(av.toMap()["id"].toLongLong());
+        addressGroup->fromVariant(av);
+    }
+
+    return true;
+}
+
+QVariant FirewallConf::changedAppGroupsToVariant() const
+{
+    QVariantList groups;
+    for (const AppGroup *appGroup : appGroups()) {
+        if (m_changedAppGroupIds.contains(appGroup->id())) {
+            groups.append(appGroup->toVariant());
+        }
+    }
+    return groups;
+}
+
+bool FirewallConf::patchAppGroupsFromVariant(const QVariant &groupsVar, const QVariant &idListVar)
+{
+    const QVariantList groups = groupsVar.toList();
+    const QVariantList idList = idListVar.toList();
+
+    QHash<qint64, QVariant> changedGroups;
+    for (const QVariant &gv : groups) {
+        changedGroups.insert(gv.toMap()["id"].toLongLong(), gv);
+    }
+
+    QHash<qint64, AppGroup *> appGroupsById;
+    for (AppGroup *appGroup : appGroups()) {
+        appGroupsById.insert(appGroup->id(), appGroup);
+    }
+
+    // Check before the patching: the new groups must be sent with their values
+    for (const QVariant &idVar : idList) {
+        const qint64 id = idVar.toLongLong();
+        if (!appGroupsById.contains(id) && !changedGroups.contains(id))
+            return false;
+    }
+
+    // Reorder the groups by the list
+    QList<AppGroup *> newAppGroups;
+    newAppGroups.reserve(idList.size());
+
+    for (const QVariant &idVar : idList) {
+        const qint64 id = idVar.toLongLong();
+
+        AppGroup *appGroup = appGroupsById.take(id);
+        if (!appGroup) {
+            appGroup = new AppGroup();
+            appGroup->setParent(this);
+        }
+
+        const QVariant gv = changedGroups.value(id);
+        if (!gv.isNull()) {
+            appGroup->fromVariant(gv);
+        }
+
+        newAppGroups.append(appGroup);
+    }
+
+    // Removed groups
+    for (AppGroup *appGroup : std::as_const(appGroupsById)) {
+        appGroup->deleteLater();
+    }
+
+    m_appGroups = newAppGroups;
+
+    emit appGroupsChanged();
+
+    return true;
+}
+
+QVariant FirewallConf::appGroupIdListToVariant() const
+{
+    QVariantList list;
+    for (const AppGroup *appGroup : appGroups()) {
+        list.append(appGroup->id());
+    }
+    return list;
+}
+
 QVariant FirewallConf::toVariant(bool onlyEdited) const
 {
     QVariantMap map;
@@ -482,6 +630,48 @@ QVariant FirewallConf::toVariant(bool onlyEdited) const
         map["removedAppGroupIdList"] = removedAppGroupIdListToVariant();
     }
 
+    flagsIniToVariant(map, flags);
+
+    return map;
+}
+
+QVariant FirewallConf::toPatchVariant() const
+{
+    const EditedFlags flags = editedFlags();
+
+    QVariantMap map = editedFlagsToVariant(flags).toMap();
+
+    if ((flags & OptEdited) != 0) {
+        map["addressGroups"] = changedAddressesToVariant();
+
+        map["appGroups"] = changedAppGroupsToVariant();
+        map["appGroupIdList"] = appGroupIdListToVariant();
+    }
+
+    flagsIniToVariant(map, flags);
+
+    return map;
+}
+
+bool FirewallConf::patchFromVariant(const QVariant &v)
+{
+    const QVariantMap map = v.toMap();
+
+    m_editedFlags = editedFlagsFromVariant(v);
+
+    if (optEdited()) {
+        if (!(patchAddressesFromVariant(map["addressGroups"])
+                    && patchAppGroupsFromVariant(map["appGroups"], map["appGroupIdList"])))
+            return false;
+    }
+
+    flagsIniFromVariant(map);
+
+    return true;
+}
+
+void FirewallConf::flagsIniToVariant(QVariantMap &map, EditedFlags flags) const
+{
     if ((flags & FlagsEdited) != 0) {
         map["flags"] = flagsToVariant();
     }
@@ -492,8 +682,17 @@ QVariant FirewallConf::toVariant(bool onlyEdited) const
             map["ini"] = iniMap;
         }
     }
+}
+
+void FirewallConf::flagsIniFromVariant(const QVariantMap &map)
+{
+    if (flagsEdited()) {
+        flagsFromVariant(map["flags"]);
+    }
 
-    return map;
+    if (iniEdited() || taskEdited()) {
+        ini().setMap(map["ini"].toMap());
+    }
 }
 
 void FirewallConf::fromVariant(const QVariant &v, bool onlyEdited)
@@ -513,13 +712,7 @@ void FirewallConf::fromVariant(const QVariant &v, bool onlyEdited)
         removedAppGroupIdListFromVariant(map["removedAppGroupIdList"]);
     }
 
-    if (flagsEdited()) {
-        flagsFromVariant(map["flags"]);
-    }
-
-    if (iniEdited() || taskEdited()) {
-        ini().setMap(map["ini"].toMap());
-    }
+    flagsIniFromVariant(map);
 }
 
 QVariant FirewallConf::editedFlagsToVariant(uint editedFlags)
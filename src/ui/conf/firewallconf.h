@@ -2,6 +2,7 @@
 #define FIREWALLCONF_H
 
 #include <QObject>
+#include <QSet>
 #include <QVariant>
 
 #include "inioptions.h"
@@ -82,6 +83,9 @@ public:
     bool logAlertedBlockedIp() const { return m_logAlertedBlockedIp; }
     void setLogAlertedBlockedIp(bool logAlertedBlockedIp);
 
+    bool logFlowStat() const { return m_logFlowStat; }
+    void setLogFlowStat(bool logFlowStat);
+
     bool appBlockAll() const { return m_appBlockAll; }
     void setAppBlockAll(bool appBlockAll);
 
@@ -124,6 +128,11 @@ public:
     const QVector<qint64> &removedAppGroupIdList() const { return m_removedAppGroupIdList; }
     void clearRemovedAppGroupIdList() const;
 
+    // The groups, changed in the storage since the last applied conf, to patch the clients' conf
+    void addChangedAddressGroupId(qint64 id) const { m_changedAddressGroupIds.insert(id); }
+    void addChangedAppGroupId(qint64 id) const { m_changedAppGroupIds.insert(id); }
+    void setAllGroupsChanged() const;
+
     IniOptions &ini() { return m_ini; }
     const IniOptions &ini() const { return m_ini; }
 
@@ -133,6 +142,10 @@ public:
     QVariant toVariant(bool onlyEdited = false) const;
     void fromVariant(const QVariant &v, bool onlyEdited = false);
 
+    // The edited flags, ini and only the changed groups
+    QVariant toPatchVariant() const;
+    bool patchFromVariant(const QVariant &v);
+
     static QVariant editedFlagsToVariant(uint editedFlags);
     static uint editedFlagsFromVariant(const QVariant &v);
 
@@ -160,6 +173,9 @@ private:
     QVariant flagsToVariant() const;
     void flagsFromVariant(const QVariant &v);
 
+    void flagsIniToVariant(QVariantMap &map, EditedFlags flags) const;
+    void flagsIniFromVariant(const QVariantMap &map);
+
     QVariant addressesToVariant() const;
     void addressesFromVariant(const QVariant &v);
 
@@ -169,6 +185,16 @@ private:
     QVariant removedAppGroupIdListToVariant() const;
     void removedAppGroupIdListFromVariant(const QVariant &v);
 
+    QVariant changedAddressesToVariant() const;
+    bool patchAddressesFromVariant(const QVariant &v);
+
+    QVariant changedAppGroupsToVariant() const;
+    bool patchAppGroupsFromVariant(const QVariant &groupsVar, const QVariant &idListVar);
+
+    QVariant appGroupIdListToVariant() const;
+
+    void clearChangedGroups();
+
 private:
     uint m_editedFlags : 8 = AllEdited; // update all on load()!
 
@@ -188,6 +214,8 @@ private:
     uint m_logBlockedIp : 1 = false;
     uint m_logAlertedBlockedIp : 1 = false;
 
+    uint m_logFlowStat : 1 = false;
+
     uint m_appBlockAll : 1 = true;
     uint m_appAllowAll : 1 = false;
 
@@ -203,6 +231,9 @@ private:
     QList<AppGroup *> m_appGroups;
     mutable QVector<qint64> m_removedAppGroupIdList;
 
+    mutable QSet<qint64> m_changedAddressGroupIds;
+    mutable QSet<qint64> m_changedAppGroupIds;
+
     IniOptions m_ini;
 };
 
@@ -8,7 +8,10 @@
 #define DEFAULT_TRAF_HOUR_KEEP_DAYS    90 // ~3 months
 #define DEFAULT_TRAF_DAY_KEEP_DAYS     365 // ~1 year
 #define DEFAULT_TRAF_MONTH_KEEP_MONTHS 36 // ~3 years
+#define DEFAULT_TRAF_FLUSH_SECONDS     10
 #define DEFAULT_LOG_IP_KEEP_COUNT      10000
+#define DEFAULT_ASK_PACKETS_MAX        3
+#define DEFAULT_EXPORT_FILE_SIZE_MB    16
 
 class IniOptions : public MapSettings
 {
@@ -21,6 +24,76 @@ public:
     bool logConsole() const { return valueBool("base/console"); }
     void setLogConsole(bool v) { setValue("base/console", v); }
 
+    // Write the log file by a separate thread with batches; the errors are written at once.
+    bool logAsync() const { return valueBool("base/logAsync"); }
+    void setLogAsync(bool v) { setValue("base/logAsync", v); }
+
+    // Size in MiB of the log ring, shared with the driver; 0 to read the logs by requests.
+    // The ring is allocated once per service run.
+    int logRingSize() const { return valueInt("base/logRingSize"); }
+    void setLogRingSize(int v) { setValue("base/logRingSize", v); }
+
+    // Size in KiB of the log buffers, read by requests; 0 for the driver's chunk size.
+    // The driver moves all its chunks, which fit into the buffer.
+    int logBufferSize() const { return valueInt("base/logBufferSize"); }
+    void setLogBufferSize(int v) { setValue("base/logBufferSize", v); }
+
+    // Size in MiB of the logs, buffered by the driver for a slow service; 0 for the default.
+    // The blocked connections are dropped first, the traffic stat is kept.
+    int logDriverBufferLimit() const { return valueInt("base/logDriverBufferLimit"); }
+    void setLogDriverBufferLimit(int v) { setValue("base/logDriverBufferLimit", v); }
+
+    // Size in MiB of the nonpaged pool, allowed to each subsystem of the driver; 0 for no limit.
+    int driverMemLimit() const { return valueInt("base/driverMemLimit"); }
+    void setDriverMemLimit(int v) { setValue("base/driverMemLimit", v); }
+
+    // Inbound connections per second per remote address; 0 for no limit.
+    // The excess is dropped before the filtering and summarized in the blocked connections.
+    int acceptRateLimit() const { return valueInt("base/acceptRateLimit"); }
+    void setAcceptRateLimit(int v) { setValue("base/acceptRateLimit", v); }
+
+    // Lines of the blocked connections, not logged by the driver, e.g. the discovery traffic:
+    // "proto=udp dir=in local_port=1900 addr=multicast", with the keys of "proto"
+    // (tcp, udp or a number), "dir" (in, out), "local_port", "remote_port" (N or N-M) and
+    // "addr" (broadcast, multicast, link_local), all optional; "#" starts a comment.
+    QString logBlockedIpFilters() const { return valueText("base/logBlockedIpFilters"); }
+    void setLogBlockedIpFilters(const QString &v) { setValue("base/logBlockedIpFilters", v); }
+
+    // Don't track the short-lived UDP flows to the ports (the local ones for inbound), e.g. of
+    // DNS, on the busy servers: the first datagram's bytes are charged to the process only.
+    // The apps of the groups with speed limits are tracked always.
+    bool udpLightFlows() const { return valueBool("base/udpLightFlows"); }
+    void setUdpLightFlows(bool v) { setValue("base/udpLightFlows", v); }
+
+    QString udpLightFlowPorts() const { return valueText("base/udpLightFlowPorts", "53,123,5353"); }
+    void setUdpLightFlowPorts(const QString &v) { setValue("base/udpLightFlowPorts", v); }
+
+    // Match the exe apps by their files' ids too, i.e. by the hard links, short names and
+    // junctions' paths of the files, existing at the conf's write.
+    bool appFileIds() const { return valueBool("base/appFileIds"); }
+    void setAppFileIds(bool v) { setValue("base/appFileIds", v); }
+
+    // Filter the LAN and blocked addresses by the WFP itself, without the driver's callouts.
+    // Used without the rules, traffic statistics and connections' logging only.
+    bool addrProvFilters() const { return valueBool("base/addrProvFilters"); }
+    void setAddrProvFilters(bool v) { setValue("base/addrProvFilters", v); }
+
+    // Replicate the zones to the NUMA nodes' memory, applied by the next zones' update
+    bool zonesNodeReplicas() const { return valueBool("base/zonesNodeReplicas"); }
+    void setZonesNodeReplicas(bool v) { setValue("base/zonesNodeReplicas", v); }
+
+    // TCP port of the service's metrics in the Prometheus' text format; 0 to disable.
+    int metricsPort() const { return valueInt("base/metricsPort"); }
+    void setMetricsPort(int v) { setValue("base/metricsPort", v); }
+
+    // Address to serve the metrics on; the local host by default.
+    QString metricsAddress() const { return valueText("base/metricsAddress"); }
+    void setMetricsAddress(const QString &v) { setValue("base/metricsAddress", v); }
+
+    // URL of the central policy's versioned deltas, synced by the task; empty when not managed.
+    QString policyUrl() const { return valueText("base/policyUrl"); }
+    void setPolicyUrl(const QString &v) { setValue("base/policyUrl", v); }
+
     bool hasPasswordSet() const { return contains("base/hasPassword_"); }
 
     bool hasPassword() const { return valueBool("base/hasPassword_"); }
@@ -57,6 +130,25 @@ public:
     int quotaMonthMb() const { return valueInt("quota/quotaMonthMb"); }
     void setQuotaMonthMb(int v) { setValue("quota/quotaMonthMb", v); }
 
+    // Path of the JSON-lines (or CSV) file of the exported blocked connections & traffic,
+    // rotated by the size; empty to not export to the file.
+    QString exportFilePath() const { return valueText("export/filePath"); }
+    void setExportFilePath(const QString &v) { setValue("export/filePath", v); }
+
+    // Size in MiB to rotate the export file.
+    int exportFileSizeMb() const
+    {
+        return valueInt("export/fileSizeMb", DEFAULT_EXPORT_FILE_SIZE_MB);
+    }
+    void setExportFileSizeMb(int v) { setValue("export/fileSizeMb", v); }
+
+    // The "host:port" to send the exported lines by TCP, e.g. to a syslog collector.
+    QString exportTcpAddress() const { return valueText("export/tcpAddress"); }
+    void setExportTcpAddress(const QString &v) { setValue("export/tcpAddress", v); }
+
+    bool exportCsv() const { return valueBool("export/csv"); }
+    void setExportCsv(bool v) { setValue("export/csv", v); }
+
     bool quotaBlockInetTraffic() const { return valueBool("quota/blockInetTraffic"); }
     void setQuotaBlockInternet(bool v) { setValue("quota/blockInetTraffic", v); }
 
@@ -69,6 +161,11 @@ public:
     }
     void setTrafHourKeepDays(int v) { setValue("stat/trafHourKeepDays", v); }
 
+    // Days of the hours' traffic in the stat DB, the older hours are moved to the "-archive" DB
+    // (queried by the old periods too); 0 to keep all of them in the stat DB.
+    int trafHourArchiveDays() const { return valueInt("stat/trafHourArchiveDays"); }
+    void setTrafHourArchiveDays(int v) { setValue("stat/trafHourArchiveDays", v); }
+
     int trafDayKeepDays() const
     {
         return valueInt("stat/trafDayKeepDays", DEFAULT_TRAF_DAY_KEEP_DAYS);
@@ -81,12 +178,30 @@ public:
     }
     void setTrafMonthKeepMonths(int v) { setValue("stat/trafMonthKeepMonths", v); }
 
+    int trafFlushSeconds() const
+    {
+        return valueInt("stat/trafFlushSeconds", DEFAULT_TRAF_FLUSH_SECONDS);
+    }
+    void setTrafFlushSeconds(int v) { setValue("stat/trafFlushSeconds", v); }
+
+    // Hours between the online snapshots of the stat DB to the ".bak" file; 0 to disable.
+    int statBackupHours() const { return valueInt("stat/backupHours"); }
+    void setStatBackupHours(int v) { setValue("stat/backupHours", v); }
+
     int allowedIpKeepCount() const
     {
         return valueInt("stat/allowedIpKeepCount", DEFAULT_LOG_IP_KEEP_COUNT);
     }
     void setAllowedIpKeepCount(int v) { setValue("stat/allowedIpKeepCount", v); }
 
+    // The allowed connections, logged first per app & endpoint per 10 seconds;
+    // then 1 of the rate's count is logged. Both 0 to log all connections.
+    int allowedIpSampleFirst() const { return valueInt("stat/allowedIpSampleFirst"); }
+    void setAllowedIpSampleFirst(int v) { setValue("stat/allowedIpSampleFirst", v); }
+
+    int allowedIpSampleRate() const { return valueInt("stat/allowedIpSampleRate"); }
+    void setAllowedIpSampleRate(int v) { setValue("stat/allowedIpSampleRate", v); }
+
     int blockedIpKeepCount() const
     {
         return valueInt("stat/blockedIpKeepCount", DEFAULT_LOG_IP_KEEP_COUNT);
@@ -96,6 +211,20 @@ public:
     bool progPurgeOnStart() const { return valueBool("prog/purgeOnStart"); }
     void setProgPurgeOnStart(bool v) { setValue("prog/purgeOnStart", v); }
 
+    // Connections of a process to hold, while it's asked to connect
+    int progAskPacketsMax() const
+    {
+        return valueInt("prog/askPacketsMax", DEFAULT_ASK_PACKETS_MAX);
+    }
+    void setProgAskPacketsMax(int v) { setValue("prog/askPacketsMax", v); }
+
+    // Seconds to wait for the answer, then the default verdict is applied; 0 to wait forever
+    int progAskTimeout() const { return valueInt("prog/askTimeout"); }
+    void setProgAskTimeout(int v) { setValue("prog/askTimeout", v); }
+
+    bool progAskTimeoutAllow() const { return valueBool("prog/askTimeoutAllow"); }
+    void setProgAskTimeoutAllow(bool v) { setValue("prog/askTimeoutAllow", v); }
+
     constexpr bool graphWindowAlwaysOnTopDefault() const { return true; }
     bool graphWindowAlwaysOnTop() const { return valueBool("graphWindow/alwaysOnTop", true); }
     void setGraphWindowAlwaysOnTop(bool on) { setValue("graphWindow/alwaysOnTop", on); }
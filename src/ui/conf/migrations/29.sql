@@ -0,0 +1 @@
+ALTER TABLE app_group ADD COLUMN limit_fq BOOLEAN NOT NULL DEFAULT 0;
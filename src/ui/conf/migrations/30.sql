@@ -0,0 +1 @@
+ALTER TABLE app_group ADD COLUMN limit_burst INTEGER NOT NULL DEFAULT 0;
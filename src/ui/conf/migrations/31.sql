@@ -0,0 +1 @@
+ALTER TABLE app_group ADD COLUMN log_stat BOOLEAN NOT NULL DEFAULT 1;
@@ -0,0 +1,2 @@
+ALTER TABLE app_group ADD COLUMN limit_ecn BOOLEAN NOT NULL DEFAULT 0;
+ALTER TABLE app_group ADD COLUMN limit_pacing BOOLEAN NOT NULL DEFAULT 0;
@@ -45,17 +45,22 @@ const char *const commandString(Command cmd)
         CASE_STRING(Rpc_ConfZoneManager_zoneUpdated)
 
         CASE_STRING(Rpc_DriverManager_updateState)
+        CASE_STRING(Rpc_DriverManager_writeLiveTraffic)
+        CASE_STRING(Rpc_DriverManager_readFlows)
+        CASE_STRING(Rpc_DriverManager_readAddressHits)
 
         CASE_STRING(Rpc_QuotaManager_alert)
 
         CASE_STRING(Rpc_StatManager_deleteStatApp)
         CASE_STRING(Rpc_StatManager_resetAppTrafTotals)
         CASE_STRING(Rpc_StatManager_clearTraffic)
+        CASE_STRING(Rpc_StatManager_getTopApps)
         CASE_STRING(Rpc_StatManager_trafficCleared)
         CASE_STRING(Rpc_StatManager_appStatRemoved)
         CASE_STRING(Rpc_StatManager_appCreated)
         CASE_STRING(Rpc_StatManager_trafficAdded)
         CASE_STRING(Rpc_StatManager_appTrafTotalsResetted)
+        CASE_STRING(Rpc_StatManager_shaperStatAdded)
 
         CASE_STRING(Rpc_StatBlockManager_deleteConn)
         CASE_STRING(Rpc_StatBlockManager_connChanged)
@@ -135,17 +140,22 @@ RpcManager managerByCommand(Command cmd)
         Rpc_ConfZoneManager, // Rpc_ConfZoneManager_zoneUpdated,
 
         Rpc_DriverManager, // Rpc_DriverManager_updateState,
+        Rpc_DriverManager, // Rpc_DriverManager_writeLiveTraffic,
+        Rpc_DriverManager, // Rpc_DriverManager_readFlows,
+        Rpc_DriverManager, // Rpc_DriverManager_readAddressHits,
 
         Rpc_QuotaManager, // Rpc_QuotaManager_alert,
 
         Rpc_StatManager, // Rpc_StatManager_deleteStatApp,
         Rpc_StatManager, // Rpc_StatManager_resetAppTrafTotals,
         Rpc_StatManager, // Rpc_StatManager_clearTraffic,
+        Rpc_StatManager, // Rpc_StatManager_getTopApps,
         Rpc_StatManager, // Rpc_StatManager_trafficCleared,
         Rpc_StatManager, // Rpc_StatManager_appStatRemoved,
         Rpc_StatManager, // Rpc_StatManager_appCreated,
         Rpc_StatManager, // Rpc_StatManager_trafficAdded,
         Rpc_StatManager, // Rpc_StatManager_appTrafTotalsResetted,
+        Rpc_StatManager, // Rpc_StatManager_shaperStatAdded,
 
         Rpc_StatBlockManager, // Rpc_StatBlockManager_deleteConn,
         Rpc_StatBlockManager, // Rpc_StatBlockManager_connChanged,
@@ -205,21 +215,29 @@ bool commandRequiresValidation(Command cmd)
         0, // Rpc_ConfZoneManager_zoneUpdated,
 
         0, // Rpc_DriverManager_updateState,
+        0, // Rpc_DriverManager_writeLiveTraffic,
+        0, // Rpc_DriverManager_readFlows,
+        0, // Rpc_DriverManager_readAddressHits,
 
         0, // Rpc_QuotaManager_alert,
 
         true, // Rpc_StatManager_deleteStatApp,
         true, // Rpc_StatManager_resetAppTrafTotals,
         true, // Rpc_StatManager_clearTraffic,
+        0, // Rpc_StatManager_getTopApps,
         0, // Rpc_StatManager_trafficCleared,
         0, // Rpc_StatManager_appStatRemoved,
         0, // Rpc_StatManager_appCreated,
         0, // Rpc_StatManager_trafficAdded,
         0, // Rpc_StatManager_appTrafTotalsResetted,
+        0, // Rpc_StatManager_shaperStatAdded,
 
         true, // Rpc_StatBlockManager_deleteConn,
         0, // Rpc_StatBlockManager_connChanged,
 
+        true, // Rpc_ServiceInfoManager_trackService,
+        true, // Rpc_ServiceInfoManager_revertService,
+
         true, // Rpc_TaskManager_runTask,
         true, // Rpc_TaskManager_abortTask,
         0, // Rpc_TaskManager_taskStarted,
@@ -231,6 +249,52 @@ bool commandRequiresValidation(Command cmd)
     return g_commandValidations[cmd];
 }
 
+bool commandAllowsCompression(Command cmd)
+{
+    // Only the bulk payloads, the frequent notifications are sent as is
+    switch (cmd) {
+    case Rpc_Result_Ok:
+    case Rpc_ConfManager_saveVariant:
+    case Rpc_ConfManager_confChanged:
+    case Rpc_ConfAppManager_deleteApps:
+    case Rpc_ConfAppManager_updateAppsBlocked:
+    case Rpc_ConfZoneManager_addOrUpdateZone:
+    case Rpc_TaskManager_zonesDownloaded:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool commandIsCoalescable(Command cmd)
+{
+    // Only the state notifications, the clients re-read the state by them
+    switch (cmd) {
+    case Rpc_ConfAppManager_appAlerted:
+    case Rpc_ConfAppManager_appChanged:
+    case Rpc_ConfAppManager_appUpdated:
+    case Rpc_ConfZoneManager_zoneAdded:
+    case Rpc_ConfZoneManager_zoneUpdated:
+    case Rpc_DriverManager_updateState:
+    case Rpc_StatManager_trafficCleared:
+    case Rpc_StatManager_appTrafTotalsResetted:
+    case Rpc_StatBlockManager_connChanged:
+        return true;
+    default:
+        return false;
+    }
+}
+
+Subscription commandSubscription(Command cmd)
+{
+    switch (cmd) {
+    case Rpc_StatManager_trafficAdded:
+        return SubscribeTraffic;
+    default:
+        return SubscribeNone;
+    }
+}
+
 QDebug operator<<(QDebug debug, Command cmd)
 {
     debug << commandString(cmd);
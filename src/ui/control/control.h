@@ -45,17 +45,22 @@ enum Command : qint8 {
     Rpc_ConfZoneManager_zoneUpdated,
 
     Rpc_DriverManager_updateState,
+    Rpc_DriverManager_writeLiveTraffic,
+    Rpc_DriverManager_readFlows,
+    Rpc_DriverManager_readAddressHits,
 
     Rpc_QuotaManager_alert,
 
     Rpc_StatManager_deleteStatApp,
     Rpc_StatManager_resetAppTrafTotals,
     Rpc_StatManager_clearTraffic,
+    Rpc_StatManager_getTopApps,
     Rpc_StatManager_trafficCleared,
     Rpc_StatManager_appStatRemoved,
     Rpc_StatManager_appCreated,
     Rpc_StatManager_trafficAdded,
     Rpc_StatManager_appTrafTotalsResetted,
+    Rpc_StatManager_shaperStatAdded,
 
     Rpc_StatBlockManager_deleteConn,
     Rpc_StatBlockManager_connChanged,
@@ -85,10 +90,24 @@ enum RpcManager : qint8 {
     Rpc_TaskManager,
 };
 
+// Notifications, which are sent only to the subscribed clients
+enum Subscription : quint32 {
+    SubscribeNone = 0,
+    SubscribeTraffic = (1 << 0),
+    SubscribeAll = 0xFFFFFFFF,
+};
+
 RpcManager managerByCommand(Command cmd);
 
 bool commandRequiresValidation(Command cmd);
 
+bool commandAllowsCompression(Command cmd);
+
+// The latest notification replaces the pending ones to the lagging clients
+bool commandIsCoalescable(Command cmd);
+
+Subscription commandSubscription(Command cmd);
+
 QDebug operator<<(QDebug debug, Command cmd);
 QDebug operator<<(QDebug debug, RpcManager rpcManager);
 
@@ -1,17 +1,22 @@
 #include "controlmanager.h"
 
 #include <QApplication>
+#include <QFile>
 #include <QLocalServer>
 #include <QLocalSocket>
 #include <QLoggingCategory>
+#include <QTextStream>
+#include <QThread>
 
 #include <fort_version.h>
 
 #include <conf/confmanager.h>
 #include <conf/firewallconf.h>
+#include <driver/drivermanager.h>
 #include <fortsettings.h>
 #include <manager/windowmanager.h>
 #include <rpc/rpcmanager.h>
+#include <util/conf/confevaluator.h>
 #include <util/fileutil.h>
 #include <util/ioc/ioccontainer.h>
 #include <util/osutil.h>
@@ -31,6 +36,8 @@ ControlManager::ControlManager(QObject *parent) : QObject(parent) { }
 ControlManager::~ControlManager()
 {
     close();
+
+    stopIoThread(); // with the clients
 }
 
 void ControlManager::setUp()
@@ -78,6 +85,8 @@ bool ControlManager::listen()
 
     connect(m_server, &QLocalServer::newConnection, this, &ControlManager::onNewConnection);
 
+    startIoThread();
+
     return true;
 }
 
@@ -100,6 +109,10 @@ bool ControlManager::processCommandClient()
 {
     const auto settings = IoC<FortSettings>();
 
+    // Evaluated locally, without the running instance
+    if (settings->controlCommand() == "eval")
+        return processCommandEval(settings->args());
+
     Control::Command command;
     if (settings->controlCommand() == "prog") {
         command = Control::Prog;
@@ -117,6 +130,54 @@ bool ControlManager::processCommandClient()
     return postCommand(command, args);
 }
 
+bool ControlManager::processCommandEval(const QStringList &args)
+{
+    if (args.isEmpty()) {
+        qCWarning(LC) << "eval <conns-export-file> [<conf-cache-file>]";
+        return false;
+    }
+
+    const QString confCachePath = args.value(1, DriverManager::confCachePath());
+
+    ConfEvaluator evaluator;
+    if (!evaluator.loadConfCache(confCachePath)) {
+        qCWarning(LC) << "Conf cache load error:" << confCachePath;
+        return false;
+    }
+
+    QFile file(args.at(0));
+    if (!file.open(QFile::ReadOnly)) {
+        qCWarning(LC) << "File open error:" << file.fileName() << file.errorString();
+        return false;
+    }
+
+    QVector<ConfEvalConn> conns;
+    while (!file.atEnd()) {
+        ConfEvalConn conn;
+        if (evaluator.parseConnLine(file.readLine(), conn)) {
+            conns.append(conn);
+        }
+    }
+
+    const ConfEvalResult result = evaluator.evaluateConns(conns);
+
+    QTextStream out(stdout);
+    out << "conns: " << result.connsCount << '\n'
+        << "allowed: " << (result.connsCount - result.blockedCount) << '\n'
+        << "blocked: " << result.blockedCount << '\n';
+
+    for (int i = 0; i < result.blockReasonCounts.size(); ++i) {
+        const int count = result.blockReasonCounts[i];
+        if (count != 0) {
+            out << "blocked_" << ConfEvaluator::blockReasonName(i) << ": " << count << '\n';
+        }
+    }
+
+    out << "elapsed_msecs: " << (result.elapsedNsecs / 1000000.0) << '\n';
+
+    return true;
+}
+
 bool ControlManager::postCommand(Control::Command command, const QVariantList &args)
 {
     QLocalSocket socket;
@@ -147,14 +208,15 @@ void ControlManager::onNewConnection()
             continue;
         }
 
-        auto w = new ControlWorker(socket, this);
-        w->setupForAsync();
+        auto w = new ControlWorker(socket);
 
         w->setIsClientValidated(!hasPassword);
 
         connect(w, &ControlWorker::disconnected, this, &ControlManager::onDisconnected);
         connect(w, &ControlWorker::requestReady, this, &ControlManager::processRequest);
 
+        w->setupForIoThread(m_ioThread, this);
+
         m_clients.append(w);
 
         qCDebug(LC) << "Client connected: id:" << w->id() << "count:" << m_clients.size();
@@ -251,6 +313,28 @@ bool ControlManager::processCommandProg(const ProcessCommandArgs &p)
     return false;
 }
 
+void ControlManager::startIoThread()
+{
+    if (m_ioThread)
+        return;
+
+    m_ioThread = new QThread(this);
+    m_ioThread->setObjectName("ControlIo");
+    m_ioThread->start();
+}
+
+void ControlManager::stopIoThread()
+{
+    if (!m_ioThread)
+        return;
+
+    // The clients are deleted on the thread's finish
+    m_ioThread->quit();
+    m_ioThread->wait();
+
+    m_clients.clear();
+}
+
 QString ControlManager::getServerName(bool isService)
 {
     return QLatin1String(APP_BASE) + (isService ? "Svc" : OsUtil::userName()) + "Pipe";
@@ -10,6 +10,7 @@
 #include "control.h"
 
 QT_FORWARD_DECLARE_CLASS(QLocalServer)
+QT_FORWARD_DECLARE_CLASS(QThread)
 
 class ControlWorker;
 
@@ -44,6 +45,7 @@ public:
     void closeAllClients();
 
     bool processCommandClient();
+    bool processCommandEval(const QStringList &args);
     bool postCommand(Control::Command command, const QVariantList &args);
 
 private slots:
@@ -56,11 +58,16 @@ private:
     bool processCommand(const ProcessCommandArgs &p);
     bool processCommandProg(const ProcessCommandArgs &p);
 
+    void startIoThread();
+    void stopIoThread();
+
     static QString getServerName(bool isService = false);
 
 private:
     QLocalServer *m_server = nullptr;
 
+    QThread *m_ioThread = nullptr; // of the clients' sockets
+
     QList<ControlWorker *> m_clients;
 };
 
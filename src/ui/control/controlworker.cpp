@@ -1,8 +1,10 @@
 #include "controlworker.h"
 
+#include <QAtomicInteger>
 #include <QDataStream>
 #include <QLocalSocket>
 #include <QLoggingCategory>
+#include <QThread>
 #include <QTimer>
 
 namespace {
@@ -13,13 +15,227 @@ constexpr int commandMaxArgs = 32;
 constexpr int commandArgMaxSize = 4 * 1024;
 constexpr quint32 dataMaxSize = 1 * 1024 * 1024;
 
+// Of the lagging client: the unread socket's buffer, the queued commands and the lag's time
+constexpr qint64 sendBufferMaxSize = 4 * 1024 * 1024;
+constexpr int sendQueueMaxCount = 4096;
+constexpr int sendLagMaxMsecs = 15 * 1000;
+
+QAtomicInteger<quint32> g_slowClientsDroppedCount;
+
+constexpr int argsCompressMinSize = 4 * 1024;
+constexpr int argsCompressLevel = 1; // fast, for the local pipe
+
 quint32 nextWorkerId()
 {
     static quint32 g_workerId = 0;
     return ++g_workerId;
 }
 
-bool buildArgsData(QByteArray &buffer, const QVariantList &args, bool &compressed)
+// Compact args are tagged by their types, the other types are serialized as QVariant
+constexpr quint8 compactArgsFlag = 0x40;
+
+enum ArgType : quint8 {
+    ArgInvalid = 0,
+    ArgBool,
+    ArgInt,
+    ArgUInt,
+    ArgLongLong,
+    ArgULongLong,
+    ArgString,
+    ArgBytes,
+    ArgStringList,
+    ArgVariant,
+};
+
+void writeVarUInt(QByteArray &data, quint64 v)
+{
+    while (v >= 0x80) {
+        data.append(char(v | 0x80));
+        v >>= 7;
+    }
+    data.append(char(v));
+}
+
+void writeVarInt(QByteArray &data, qint64 v)
+{
+    writeVarUInt(data, (quint64(v) << 1) ^ quint64(v >> 63));
+}
+
+void writeBytes(QByteArray &data, const QByteArray &bytes)
+{
+    writeVarUInt(data, bytes.size());
+    data.append(bytes);
+}
+
+void writeArg(QByteArray &data, const QVariant &arg)
+{
+    switch (arg.userType()) {
+    case QMetaType::UnknownType: {
+        data.append(char(ArgInvalid));
+    } break;
+    case QMetaType::Bool: {
+        data.append(char(ArgBool));
+        data.append(char(arg.toBool()));
+    } break;
+    case QMetaType::Int: {
+        data.append(char(ArgInt));
+        writeVarInt(data, arg.toInt());
+    } break;
+    case QMetaType::UInt: {
+        data.append(char(ArgUInt));
+        writeVarUInt(data, arg.toUInt());
+    } break;
+    case QMetaType::LongLong: {
+        data.append(char(ArgLongLong));
+        writeVarInt(data, arg.toLongLong());
+    } break;
+    case QMetaType::ULongLong: {
+        data.append(char(ArgULongLong));
+        writeVarUInt(data, arg.toULongLong());
+    } break;
+    case QMetaType::QString: {
+        data.append(char(ArgString));
+        writeBytes(data, arg.toString().toUtf8());
+    } break;
+    case QMetaType::QByteArray: {
+        data.append(char(ArgBytes));
+        writeBytes(data, arg.toByteArray());
+    } break;
+    case QMetaType::QStringList: {
+        const QStringList list = arg.toStringList();
+
+        data.append(char(ArgStringList));
+        writeVarUInt(data, list.size());
+
+        for (const QString &s : list) {
+            writeBytes(data, s.toUtf8());
+        }
+    } break;
+    default: {
+        QByteArray varData;
+        {
+            QDataStream stream(&varData, QDataStream::WriteOnly);
+            stream << arg;
+        }
+
+        data.append(char(ArgVariant));
+        writeBytes(data, varData);
+    }
+    }
+}
+
+struct ArgsReader
+{
+    quint8 readByte()
+    {
+        if (p >= end) {
+            ok = false;
+            return 0;
+        }
+        return quint8(*p++);
+    }
+
+    quint64 readVarUInt()
+    {
+        quint64 v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            const quint8 c = readByte();
+            v |= quint64(c & 0x7F) << shift;
+            if ((c & 0x80) == 0)
+                return v;
+        }
+        ok = false;
+        return 0;
+    }
+
+    qint64 readVarInt()
+    {
+        const quint64 v = readVarUInt();
+        return qint64(v >> 1) ^ -qint64(v & 1);
+    }
+
+    const char *readData(int &size)
+    {
+        const quint64 n = readVarUInt();
+        if (n > quint64(end - p)) {
+            ok = false;
+            size = 0;
+            return p;
+        }
+
+        const char *data = p;
+        size = int(n);
+        p += n;
+        return data;
+    }
+
+    QString readString()
+    {
+        int size;
+        const char *data = readData(size);
+        return QString::fromUtf8(data, size);
+    }
+
+    QVariant readArg()
+    {
+        switch (readByte()) {
+        case ArgInvalid:
+            return QVariant();
+        case ArgBool:
+            return bool(readByte());
+        case ArgInt:
+            return int(readVarInt());
+        case ArgUInt:
+            return uint(readVarUInt());
+        case ArgLongLong:
+            return qint64(readVarInt());
+        case ArgULongLong:
+            return quint64(readVarUInt());
+        case ArgString:
+            return readString();
+        case ArgBytes: {
+            int size;
+            const char *data = readData(size);
+            return QByteArray(data, size);
+        }
+        case ArgStringList: {
+            const quint64 count = readVarUInt();
+            if (count > quint64(end - p)) {
+                ok = false; // each string takes a byte at least
+                return QVariant();
+            }
+
+            QStringList list;
+            list.reserve(int(count));
+
+            for (quint64 i = 0; i < count && ok; ++i) {
+                list.append(readString());
+            }
+            return list;
+        }
+        case ArgVariant: {
+            int size;
+            const char *data = readData(size);
+
+            QDataStream stream(QByteArray::fromRawData(data, size));
+
+            QVariant arg;
+            stream >> arg;
+            return arg;
+        }
+        default:
+            ok = false;
+            return QVariant();
+        }
+    }
+
+    const char *p = nullptr;
+    const char *end = nullptr;
+    bool ok = true;
+};
+
+bool buildArgsData(
+        QByteArray &buffer, const QVariantList &args, bool canCompress, bool &compressed)
 {
     const int argsCount = args.count();
     if (argsCount == 0)
@@ -31,49 +247,90 @@ bool buildArgsData(QByteArray &buffer, const QVariantList &args, bool &compresse
     }
 
     QByteArray data;
-    {
-        QDataStream stream(&data, QDataStream::WriteOnly);
+    data.append(char(argsCount | compactArgsFlag));
 
-        stream << qint8(argsCount);
-
-        for (const auto &arg : args) {
-            stream << arg;
-        }
+    for (const auto &arg : args) {
+        writeArg(data, arg);
     }
 
-    compressed = (data.size() > 128);
-    buffer = compressed ? qCompress(data) : data;
+    compressed = canCompress && (data.size() > argsCompressMinSize);
+    buffer = compressed ? qCompress(data, argsCompressLevel) : data;
 
     return true;
 }
 
+void parseLegacyArgsData(const QByteArray &data, QVariantList &args, int argsCount)
+{
+    QDataStream stream(data);
+    stream.skipRawData(1); // args count
+
+    while (--argsCount >= 0) {
+        QVariant arg;
+        stream >> arg;
+
+        args.append(arg);
+    }
+}
+
 bool parseArgsData(const QByteArray &buffer, QVariantList &args, bool compressed)
 {
     if (buffer.isEmpty())
         return true;
 
     const QByteArray data = compressed ? qUncompress(buffer) : buffer;
+    if (data.isEmpty()) {
+        qCWarning(LC) << "Bad parse args data";
+        return false;
+    }
 
-    QDataStream stream(data);
-
-    qint8 argsCount;
-    stream >> argsCount;
+    const quint8 argsHeader = quint8(data.at(0));
+    const bool isCompact = (argsHeader & compactArgsFlag) != 0;
+    const int argsCount = argsHeader & ~compactArgsFlag;
 
     if (argsCount > commandMaxArgs) {
         qCWarning(LC) << "Bad parse args count:" << argsCount;
         return false;
     }
 
-    while (--argsCount >= 0) {
-        QVariant arg;
-        stream >> arg;
+    if (!isCompact) {
+        parseLegacyArgsData(data, args, argsCount);
+        return true;
+    }
 
-        args.append(arg);
+    ArgsReader reader;
+    reader.p = data.constData() + 1;
+    reader.end = data.constData() + data.size();
+
+    args.reserve(argsCount);
+
+    for (int i = 0; i < argsCount; ++i) {
+        args.append(reader.readArg());
+    }
+
+    if (!reader.ok) {
+        qCWarning(LC) << "Bad parse args data";
+        return false;
     }
 
     return true;
 }
 
+const QByteArray &buildQueuedCommandData(ControlCommandData &c)
+{
+    if (!c.built) {
+        c.data = ControlWorker::buildCommandData(c.command, c.args, c.requestId);
+
+        if (c.data.isEmpty()) {
+            qCWarning(LC) << "Bad RPC command to send:" << c.command << c.args;
+        }
+
+        c.built = true;
+        c.args.clear();
+    }
+
+    return c.data;
+}
+
 }
 
 ControlWorker::ControlWorker(QLocalSocket *socket, QObject *parent) :
@@ -81,6 +338,20 @@ ControlWorker::ControlWorker(QLocalSocket *socket, QObject *parent) :
 {
 }
 
+bool ControlWorker::isSubscribed(Control::Subscription subscription) const
+{
+    return subscription == Control::SubscribeNone || (m_subscriptions & subscription) != 0;
+}
+
+void ControlWorker::setSubscribed(Control::Subscription subscription, bool subscribed)
+{
+    if (subscribed) {
+        m_subscriptions |= subscription;
+    } else {
+        m_subscriptions &= ~quint32(subscription);
+    }
+}
+
 bool ControlWorker::isConnected() const
 {
     return socket()->state() == QLocalSocket::ConnectedState;
@@ -107,6 +378,22 @@ void ControlWorker::setupForAsync()
     connect(socket(), &QLocalSocket::readyRead, this, &ControlWorker::processRequest);
 }
 
+void ControlWorker::setupForIoThread(QThread *ioThread, QObject *mainContext)
+{
+    Q_ASSERT(!parent());
+
+    m_mainContext = mainContext;
+
+    setupForAsync();
+
+    moveToThread(ioThread); // with the socket
+
+    connect(ioThread, &QThread::finished, this, &QObject::deleteLater);
+
+    // Resume the lagging client's queue
+    connect(socket(), &QLocalSocket::bytesWritten, this, &ControlWorker::writeSendQueue);
+}
+
 void ControlWorker::setServerName(const QString &v)
 {
     m_serverName = v;
@@ -155,6 +442,11 @@ bool ControlWorker::reconnectToServer()
 
 void ControlWorker::close()
 {
+    if (thread() != QThread::currentThread()) {
+        QMetaObject::invokeMethod(this, &ControlWorker::close, Qt::QueuedConnection);
+        return;
+    }
+
     socket()->abort();
     socket()->close();
 }
@@ -198,16 +490,18 @@ void ControlWorker::stopReconnectTimer()
     }
 }
 
-QByteArray ControlWorker::buildCommandData(Control::Command command, const QVariantList &args)
+QByteArray ControlWorker::buildCommandData(
+        Control::Command command, const QVariantList &args, quint32 requestId)
 {
     QByteArray data;
     bool compressed = false;
-    if (!buildArgsData(data, args, compressed))
+    if (!buildArgsData(data, args, Control::commandAllowsCompression(command), compressed))
         return {};
 
-    RequestHeader request(command, compressed, data.size());
+    RequestHeader request(command, compressed, data.size(), requestId);
 
     QByteArray buffer;
+    buffer.reserve(sizeof(RequestHeader) + data.size());
     buffer.append((const char *) &request, sizeof(RequestHeader));
     buffer.append(data);
 
@@ -218,6 +512,143 @@ bool ControlWorker::sendCommandData(const QByteArray &commandData)
 {
     Q_ASSERT(!commandData.isEmpty());
 
+    if (m_mainContext)
+        return postCommandData(ControlCommandDataPtr::create(commandData));
+
+    return writeCommandData(commandData);
+}
+
+bool ControlWorker::postCommandData(const ControlCommandDataPtr &commandData)
+{
+    if (!m_mainContext)
+        return writeCommandData(buildQueuedCommandData(*commandData));
+
+    const Control::Command command = commandData->command;
+    const bool isCoalescable = (commandData->requestId == 0)
+            && Control::commandIsCoalescable(command);
+
+    bool wasEmpty;
+    bool isDropped = false;
+    {
+        QMutexLocker locker(&m_sendMutex);
+
+        if (m_isSendDropped)
+            return false;
+
+        wasEmpty = m_sendQueue.isEmpty();
+
+        if (!wasEmpty && isCoalescable) {
+            m_sendQueue.removeIf([=](const ControlCommandDataPtr &c) {
+                return c->command == command && c->requestId == 0;
+            });
+        }
+
+        if (m_sendQueue.size() >= sendQueueMaxCount) {
+            m_isSendDropped = isDropped = true;
+        } else {
+            m_sendQueue.append(commandData);
+        }
+    }
+
+    if (isDropped) {
+        dropSlowClient();
+        return false;
+    }
+
+    // Wake up the I/O thread once for the queued commands
+    if (wasEmpty) {
+        QMetaObject::invokeMethod(this, &ControlWorker::writeSendQueue, Qt::QueuedConnection);
+    }
+
+    return true;
+}
+
+void ControlWorker::writeSendQueue()
+{
+    for (;;) {
+        // Keep the rest queued, to be coalesced, until the client reads the sent data
+        if (socket()->bytesToWrite() >= sendBufferMaxSize) {
+            startSendLagTimer();
+            return;
+        }
+
+        ControlCommandDataPtr commandData;
+        {
+            QMutexLocker locker(&m_sendMutex);
+
+            if (m_sendQueue.isEmpty())
+                break;
+
+            commandData = m_sendQueue.takeFirst();
+        }
+
+        const QByteArray &data = buildQueuedCommandData(*commandData);
+        if (data.isEmpty())
+            continue;
+
+        if (!writeCommandData(data))
+            break;
+    }
+
+    stopSendLagTimer();
+}
+
+void ControlWorker::onSendLagTimeout()
+{
+    {
+        QMutexLocker locker(&m_sendMutex);
+
+        if (m_isSendDropped)
+            return;
+
+        m_isSendDropped = true;
+    }
+
+    dropSlowClient();
+}
+
+void ControlWorker::startSendLagTimer()
+{
+    if (!m_sendLagTimer) {
+        m_sendLagTimer = new QTimer(this);
+        m_sendLagTimer->setSingleShot(true);
+        m_sendLagTimer->setInterval(sendLagMaxMsecs);
+
+        connect(m_sendLagTimer, &QTimer::timeout, this, &ControlWorker::onSendLagTimeout);
+    }
+
+    // Since the lag's start
+    if (!m_sendLagTimer->isActive()) {
+        m_sendLagTimer->start();
+    }
+}
+
+void ControlWorker::stopSendLagTimer()
+{
+    if (m_sendLagTimer) {
+        m_sendLagTimer->stop();
+    }
+}
+
+void ControlWorker::dropSlowClient()
+{
+    qCWarning(LC) << "Slow client dropped:" << id();
+
+    g_slowClientsDroppedCount.fetchAndAddRelaxed(1);
+
+    close();
+}
+
+quint32 ControlWorker::slowClientsDroppedCount()
+{
+    return g_slowClientsDroppedCount.loadRelaxed();
+}
+
+bool ControlWorker::writeCommandData(const QByteArray &commandData)
+{
+    if (commandData.isEmpty())
+        return false;
+
     const int bytesSent = socket()->write(commandData);
     if (bytesSent != commandData.size()) {
         if (bytesSent < 0) {
@@ -233,11 +664,15 @@ bool ControlWorker::sendCommandData(const QByteArray &commandData)
     return true;
 }
 
-bool ControlWorker::sendCommand(Control::Command command, const QVariantList &args)
+bool ControlWorker::sendCommand(
+        Control::Command command, const QVariantList &args, quint32 requestId)
 {
     // DBG: qCDebug(LC) << "Send Command: id:" << id() << command << args.size();
 
-    const QByteArray buffer = buildCommandData(command, args);
+    if (m_mainContext)
+        return postCommandData(ControlCommandDataPtr::create(command, args, requestId));
+
+    const QByteArray buffer = buildCommandData(command, args, requestId);
     if (buffer.isEmpty()) {
         qCWarning(LC) << "Bad RPC command to send:" << command << args;
         return false;
@@ -271,6 +706,7 @@ void ControlWorker::clearRequest()
 {
     m_requestHeader.clear();
     m_requestBuffer.clear();
+    m_requestReadSize = 0;
 }
 
 bool ControlWorker::readRequest()
@@ -278,20 +714,22 @@ bool ControlWorker::readRequest()
     if (m_requestHeader.command() == Control::CommandNone && !readRequestHeader())
         return false;
 
-    const int bytesNeeded = m_requestHeader.dataSize() - m_requestBuffer.size();
+    const int bytesNeeded = m_requestHeader.dataSize() - m_requestReadSize;
     if (bytesNeeded > 0) {
         if (socket()->bytesAvailable() == 0)
             return true; // need more data
 
-        const QByteArray data = socket()->read(bytesNeeded);
-        if (data.isEmpty()) {
+        // Read in place, the buffer is allocated by the header
+        const qint64 bytesRead =
+                socket()->read(m_requestBuffer.data() + m_requestReadSize, bytesNeeded);
+        if (bytesRead <= 0) {
             qCWarning(LC) << "Bad request: empty";
             return false;
         }
 
-        m_requestBuffer += data;
+        m_requestReadSize += int(bytesRead);
 
-        if (data.size() < bytesNeeded)
+        if (bytesRead < bytesNeeded)
             return true; // need more data
     }
 
@@ -300,16 +738,31 @@ bool ControlWorker::readRequest()
         return false;
 
     const Control::Command command = m_requestHeader.command();
+    const quint32 requestId = m_requestHeader.requestId();
 
     clearRequest();
 
     // qCDebug(LC) << "requestReady>" << id() << command << args;
 
-    emit requestReady(command, args);
+    if (m_mainContext) {
+        QMetaObject::invokeMethod(
+                m_mainContext, [=, this] { emitRequestReady(command, args, requestId); },
+                Qt::QueuedConnection);
+    } else {
+        emitRequestReady(command, args, requestId);
+    }
 
     return true;
 }
 
+void ControlWorker::emitRequestReady(
+        Control::Command command, const QVariantList &args, quint32 requestId)
+{
+    m_requestId = requestId;
+
+    emit requestReady(command, args);
+}
+
 bool ControlWorker::readRequestHeader()
 {
     const int headerSize = socket()->read((char *) &m_requestHeader, sizeof(RequestHeader));
@@ -327,6 +780,8 @@ bool ControlWorker::readRequestHeader()
         return false;
     }
 
+    m_requestBuffer.resize(m_requestHeader.dataSize());
+
     return true;
 }
 
@@ -1,14 +1,38 @@
 #ifndef CONTROLWORKER_H
 #define CONTROLWORKER_H
 
+#include <QMutex>
 #include <QObject>
+#include <QSharedPointer>
 #include <QVariant>
 
 #include "control.h"
 
 QT_FORWARD_DECLARE_CLASS(QLocalSocket)
+QT_FORWARD_DECLARE_CLASS(QThread)
 QT_FORWARD_DECLARE_CLASS(QTimer)
 
+// Queued to the clients' I/O thread, where it's built once for all the clients
+struct ControlCommandData
+{
+    ControlCommandData(
+            Control::Command command, const QVariantList &args = {}, quint32 requestId = 0) :
+        command(command), requestId(requestId), args(args)
+    {
+    }
+    explicit ControlCommandData(const QByteArray &data) : built(true), data(data) { }
+
+    bool built = false;
+
+    Control::Command command = Control::CommandNone;
+    quint32 requestId = 0;
+    QVariantList args;
+
+    QByteArray data;
+};
+
+using ControlCommandDataPtr = QSharedPointer<ControlCommandData>;
+
 class ControlWorker : public QObject
 {
     Q_OBJECT
@@ -25,8 +49,17 @@ public:
     bool isTryReconnect() const { return m_isTryReconnect; }
     void setIsTryReconnect(bool v) { m_isTryReconnect = v; }
 
+    quint32 subscriptions() const { return m_subscriptions; }
+    void setSubscriptions(quint32 v) { m_subscriptions = v; }
+
+    bool isSubscribed(Control::Subscription subscription) const;
+    void setSubscribed(Control::Subscription subscription, bool subscribed);
+
     quint32 id() const { return m_id; }
 
+    // Of the last read request, to answer it
+    quint32 requestId() const { return m_requestId; }
+
     QString serverName() const { return m_serverName; }
     void setServerName(const QString &v);
 
@@ -37,19 +70,29 @@ public:
 
     void setupForAsync();
 
+    // The socket's reads & writes run on the I/O thread,
+    // only the decoded requests are marshalled to the main context's thread
+    void setupForIoThread(QThread *ioThread, QObject *mainContext);
+
     bool connectToServer();
     bool reconnectToServer();
 
-    static QByteArray buildCommandData(Control::Command command, const QVariantList &args = {});
+    static QByteArray buildCommandData(
+            Control::Command command, const QVariantList &args = {}, quint32 requestId = 0);
     bool sendCommandData(const QByteArray &commandData);
+    bool postCommandData(const ControlCommandDataPtr &commandData);
 
-    bool sendCommand(Control::Command command, const QVariantList &args = {});
+    bool sendCommand(
+            Control::Command command, const QVariantList &args = {}, quint32 requestId = 0);
 
     bool waitForSent(int msecs = 700) const;
     bool waitForRead(int msecs = 700) const;
 
     static QVariantList buildArgs(const QStringList &list);
 
+    // Of the clients, disconnected for not reading their notifications
+    static quint32 slowClientsDroppedCount();
+
 signals:
     void connected();
     void disconnected();
@@ -67,7 +110,20 @@ private slots:
 
     void processRequest();
 
+    void writeSendQueue();
+
+    void onSendLagTimeout();
+
 private:
+    void startSendLagTimer();
+    void stopSendLagTimer();
+
+    void dropSlowClient();
+
+    bool writeCommandData(const QByteArray &commandData);
+
+    void emitRequestReady(Control::Command command, const QVariantList &args, quint32 requestId);
+
     void clearRequest();
     bool readRequest();
 
@@ -77,26 +133,33 @@ protected:
     struct RequestHeader
     {
         RequestHeader(Control::Command command = Control::CommandNone, bool compressed = false,
-                quint32 dataSize = 0) :
-            m_command(command), m_compressed(compressed), m_dataSize(dataSize)
+                quint32 dataSize = 0, quint32 requestId = 0) :
+            m_command(command),
+            m_compressed(compressed),
+            m_dataSize(dataSize),
+            m_requestId(requestId)
         {
         }
 
         Control::Command command() const { return static_cast<Control::Command>(m_command); }
         bool compressed() const { return m_compressed; }
         quint32 dataSize() const { return m_dataSize; }
+        quint32 requestId() const { return m_requestId; }
 
         void clear()
         {
             m_command = Control::CommandNone;
             m_compressed = false;
             m_dataSize = 0;
+            m_requestId = 0;
         }
 
     private:
         quint32 m_command : 7;
         quint32 m_compressed : 1;
         quint32 m_dataSize : 24;
+
+        quint32 m_requestId; // to match the results, 0 for notifications
     };
 
 private:
@@ -107,12 +170,26 @@ private:
 
     const quint32 m_id = 0;
 
+    quint32 m_requestId = 0;
+
+    quint32 m_subscriptions = Control::SubscribeAll;
+
     RequestHeader m_requestHeader;
+    int m_requestReadSize = 0;
     QByteArray m_requestBuffer;
 
     QString m_serverName;
     QLocalSocket *m_socket = nullptr;
+
+    QObject *m_mainContext = nullptr; // of the I/O thread's requests
+
+    bool m_isSendDropped = false; // guarded by the mutex
+
+    QMutex m_sendMutex;
+    QList<ControlCommandDataPtr> m_sendQueue;
+
     QTimer *m_reconnectTimer = nullptr;
+    QTimer *m_sendLagTimer = nullptr;
 };
 
 #endif // CONTROLWORKER_H
@@ -0,0 +1,56 @@
+#ifndef DEVICESTATS_H
+#define DEVICESTATS_H
+
+#include <QVector>
+
+// Matches of the zones and address groups, for pruning of the never matched ones
+struct AddressHits
+{
+    QVector<quint64> zoneHits; // by the zones' indexes
+    QVector<qint64> zoneHitTimes; // unix time of the last match, 0 for none
+
+    QVector<quint64> addrGroupHits; // internet addresses, allowed internet addresses
+    QVector<qint64> addrGroupHitTimes;
+};
+
+// Driver's performance counters, summed over the processors
+struct DeviceStats
+{
+    quint64 cacheHits = 0;
+    quint64 cacheMisses = 0;
+
+    quint64 statInsertTimeMax = 0; // in microseconds
+
+    quint64 perfFrequency = 0; // ticks per second of the classify times
+
+    quint64 flowsCount = 0;
+    quint64 flowInserts = 0;
+
+    quint64 shaperQueuedBytes = 0;
+    quint64 shaperDrops = 0;
+    quint64 shaperInjects = 0;
+
+    quint64 logBufferedBytes = 0;
+    quint64 logDrops = 0;
+
+    quint64 confSwaps = 0;
+
+    quint64 pendingExpires = 0;
+
+    quint64 memLimitFails = 0;
+
+    QVector<quint64> injectBatches; // by power of 2 sizes
+
+    QVector<quint64> aleClassifies; // [layer * verdictCount + verdict]
+    QVector<quint64> aleClassifyTimes; // by power of 2 ticks
+
+    // By the subsystems: buffer, cache, conf, packet, perf, pstree, stat, tommy, zones
+    QVector<quint64> memBytes;
+    QVector<quint64> memPeakBytes;
+
+    QVector<quint64> logFilterSuppressed; // by the conf's log filters
+
+    AddressHits addressHits;
+};
+
+#endif // DEVICESTATS_H
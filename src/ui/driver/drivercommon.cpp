@@ -4,6 +4,10 @@
 #include <common/fortioctl.h>
 #include <common/fortlog.h>
 #include <common/fortprov.h>
+#include <fort_version.h>
+
+#include "devicestats.h"
+#include "flowinfo.h"
 
 namespace DriverCommon {
 
@@ -32,6 +36,11 @@ quint32 ioctlSetFlags()
     return FORT_IOCTL_SETFLAGS;
 }
 
+quint32 ioctlPatchConf()
+{
+    return FORT_IOCTL_PATCHCONF;
+}
+
 quint32 ioctlGetLog()
 {
     return FORT_IOCTL_GETLOG;
@@ -52,11 +61,41 @@ quint32 ioctlSetZones()
     return FORT_IOCTL_SETZONES;
 }
 
+quint32 ioctlSetZone()
+{
+    return FORT_IOCTL_SETZONE;
+}
+
 quint32 ioctlSetZoneFlag()
 {
     return FORT_IOCTL_SETZONEFLAG;
 }
 
+quint32 ioctlGetStats()
+{
+    return FORT_IOCTL_GETSTATS;
+}
+
+quint32 ioctlSetLive()
+{
+    return FORT_IOCTL_SETLIVE;
+}
+
+quint32 ioctlSetLogRing()
+{
+    return FORT_IOCTL_SETLOGRING;
+}
+
+quint32 ioctlSetQuota()
+{
+    return FORT_IOCTL_SETQUOTA;
+}
+
+quint32 ioctlGetFlows()
+{
+    return FORT_IOCTL_GETFLOWS;
+}
+
 quint32 userErrorCode()
 {
     return FORT_ERROR_USER_ERROR;
@@ -77,6 +116,228 @@ quint32 confIoConfOff()
     return FORT_CONF_IO_CONF_OFF;
 }
 
+QString confCacheFileName()
+{
+    return QLatin1String(FORT_CONF_CACHE_FILE);
+}
+
+quint32 confCacheSize(quint32 confSize, quint32 zonesSize)
+{
+    return FORT_CONF_CACHE_DATA_OFF + FORT_CONF_CACHE_DATA_SIZE(confSize, zonesSize);
+}
+
+void confCacheWrite(
+        char *output, const char *conf, quint32 confSize, const char *zones, quint32 zonesSize)
+{
+    PFORT_CONF_CACHE cache = (PFORT_CONF_CACHE) output;
+
+    const quint32 dataSize = FORT_CONF_CACHE_DATA_SIZE(confSize, zonesSize);
+
+    memset(cache, 0, FORT_CONF_CACHE_DATA_OFF + dataSize);
+
+    memcpy(cache->data, conf, confSize);
+    if (zonesSize != 0) {
+        memcpy(cache->data + FORT_CONF_CACHE_ZONES_OFF(confSize), zones, zonesSize);
+    }
+
+    cache->magic = FORT_CONF_CACHE_MAGIC;
+    cache->driver_version = DRIVER_VERSION;
+    cache->conf_size = confSize;
+    cache->zones_size = zonesSize;
+    cache->checksum = fort_conf_cache_checksum(cache->data, dataSize);
+}
+
+bool confCacheRead(const char *input, quint32 size, quint32 *confOff, quint32 *confSize,
+        quint32 *zonesOff, quint32 *zonesSize)
+{
+    const PFORT_CONF_CACHE cache = (const PFORT_CONF_CACHE) input;
+
+    if (!fort_conf_cache_check(cache, size) || cache->driver_version != DRIVER_VERSION)
+        return false;
+
+    *confOff = FORT_CONF_CACHE_DATA_OFF;
+    *confSize = cache->conf_size;
+    *zonesOff = FORT_CONF_CACHE_DATA_OFF + FORT_CONF_CACHE_ZONES_OFF(cache->conf_size);
+    *zonesSize = cache->zones_size;
+
+    return true;
+}
+
+int confQuotaSize()
+{
+    return sizeof(FORT_CONF_QUOTA);
+}
+
+void confQuotaWrite(
+        char *output, quint64 dayBytes, quint64 monthBytes, quint8 setBits, quint8 alertedBits)
+{
+    PFORT_CONF_QUOTA quota = (PFORT_CONF_QUOTA) output;
+
+    quota->day_bytes = dayBytes;
+    quota->month_bytes = monthBytes;
+    quota->set_bits = setBits;
+    quota->alerted_bits = alertedBits;
+}
+
+quint32 deviceStatsSize()
+{
+    return sizeof(FORT_DEVICE_STATS);
+}
+
+void deviceStatsRead(const char *input, quint64 *cacheHits, quint64 *cacheMisses)
+{
+    const PFORT_DEVICE_STATS stats = (const PFORT_DEVICE_STATS) input;
+
+    *cacheHits = stats->verdict_cache_hits;
+    *cacheMisses = stats->verdict_cache_misses;
+}
+
+int deviceStatsInjectBatchCount()
+{
+    return FORT_DEVICE_STATS_INJECT_BATCH_COUNT;
+}
+
+void deviceStatsInjectBatchesRead(const char *input, quint64 *injectBatches)
+{
+    const PFORT_DEVICE_STATS stats = (const PFORT_DEVICE_STATS) input;
+
+    for (int i = 0; i < FORT_DEVICE_STATS_INJECT_BATCH_COUNT; ++i) {
+        injectBatches[i] = stats->inject_batches[i];
+    }
+}
+
+int deviceStatsAleLayerCount()
+{
+    return FORT_DEVICE_STATS_ALE_LAYER_COUNT;
+}
+
+int deviceStatsAleVerdictCount()
+{
+    return FORT_DEVICE_STATS_ALE_VERDICT_COUNT;
+}
+
+int deviceStatsAleTimeCount()
+{
+    return FORT_DEVICE_STATS_ALE_TIME_COUNT;
+}
+
+namespace {
+
+// Windows' system time is of 100-nanosecond intervals since 1601
+qint64 systemTimeToUnixTime(qint64 systemTime)
+{
+    constexpr qint64 unixEpochSystemTime = 116444736000000000LL;
+
+    return (systemTime > unixEpochSystemTime) ? (systemTime - unixEpochSystemTime) / 10000000
+                                              : 0;
+}
+
+void hitsRead(const UINT64 *hits, const INT64 *hitTimes, int count, QVector<quint64> &outHits,
+        QVector<qint64> &outHitTimes)
+{
+    outHits.clear();
+    outHitTimes.clear();
+
+    for (int i = 0; i < count; ++i) {
+        outHits.append(hits[i]);
+        outHitTimes.append(systemTimeToUnixTime(hitTimes[i]));
+    }
+}
+
+}
+
+void deviceStatsRead(const char *input, DeviceStats &stats)
+{
+    const PFORT_DEVICE_STATS ds = (const PFORT_DEVICE_STATS) input;
+
+    stats.cacheHits = ds->verdict_cache_hits;
+    stats.cacheMisses = ds->verdict_cache_misses;
+    stats.statInsertTimeMax = ds->stat_insert_time_max;
+    stats.perfFrequency = ds->perf_frequency;
+    stats.flowsCount = ds->flows_count;
+    stats.flowInserts = ds->flow_inserts;
+    stats.shaperQueuedBytes = ds->shaper_queued_bytes;
+    stats.shaperDrops = ds->shaper_drops;
+    stats.shaperInjects = ds->shaper_injects;
+    stats.logBufferedBytes = ds->log_buffered_bytes;
+    stats.logDrops = ds->log_drops;
+    stats.confSwaps = ds->conf_swaps;
+    stats.pendingExpires = ds->pending_expires;
+    stats.memLimitFails = ds->mem_limit_fails;
+
+    stats.injectBatches.resize(FORT_DEVICE_STATS_INJECT_BATCH_COUNT);
+    deviceStatsInjectBatchesRead(input, stats.injectBatches.data());
+
+    stats.aleClassifies.clear();
+    for (int i = 0; i < FORT_DEVICE_STATS_ALE_LAYER_COUNT; ++i) {
+        for (int j = 0; j < FORT_DEVICE_STATS_ALE_VERDICT_COUNT; ++j) {
+            stats.aleClassifies.append(ds->ale_classifies[i][j]);
+        }
+    }
+
+    stats.aleClassifyTimes.clear();
+    for (int i = 0; i < FORT_DEVICE_STATS_ALE_TIME_COUNT; ++i) {
+        stats.aleClassifyTimes.append(ds->ale_classify_times[i]);
+    }
+
+    stats.memBytes.clear();
+    stats.memPeakBytes.clear();
+    for (int i = 0; i < FORT_DEVICE_STATS_MEM_TYPE_COUNT; ++i) {
+        stats.memBytes.append(ds->mem_bytes[i]);
+        stats.memPeakBytes.append(ds->mem_peak_bytes[i]);
+    }
+
+    stats.logFilterSuppressed.clear();
+    for (int i = 0; i < FORT_CONF_LOG_FILTERS_MAX; ++i) {
+        stats.logFilterSuppressed.append(ds->log_filter_suppressed[i]);
+    }
+
+    AddressHits &hits = stats.addressHits;
+
+    hitsRead(ds->zone_hits, ds->zone_hit_times, FORT_CONF_ZONE_MAX, hits.zoneHits,
+            hits.zoneHitTimes);
+    hitsRead(ds->addr_group_hits, ds->addr_group_hit_times, FORT_DEVICE_STATS_ADDR_GROUP_COUNT,
+            hits.addrGroupHits, hits.addrGroupHitTimes);
+}
+
+quint32 flowsPageSize()
+{
+    return FORT_FLOWS_PAGE_FLOWS_OFF + FORT_FLOWS_PAGE_MAX * sizeof(FORT_FLOW_INFO);
+}
+
+quint32 flowsPageRead(const char *input, quint32 size, QVector<FlowInfo> &flows)
+{
+    if (size < FORT_FLOWS_PAGE_FLOWS_OFF)
+        return 0;
+
+    const PFORT_FLOWS_PAGE page = (const PFORT_FLOWS_PAGE) input;
+
+    const quint32 count = qMin<quint32>(
+            page->flows_count, (size - FORT_FLOWS_PAGE_FLOWS_OFF) / sizeof(FORT_FLOW_INFO));
+
+    for (quint32 i = 0; i < count; ++i) {
+        const PFORT_FLOW_INFO info = &page->flows[i];
+
+        FlowInfo flow;
+        flow.isTcp = (info->flags & FORT_FLOW_INFO_TCP) != 0;
+        flow.isIPv6 = (info->flags & FORT_FLOW_INFO_IP6) != 0;
+        flow.inbound = (info->flags & FORT_FLOW_INFO_INBOUND) != 0;
+        flow.ipProto = info->ip_proto;
+        flow.groupIndex = info->group_index;
+        flow.localPort = info->local_port;
+        flow.remotePort = info->remote_port;
+        memcpy(flow.remoteIp.v6.data, info->remote_ip, sizeof(info->remote_ip));
+        flow.pid = info->process_id;
+        flow.flowId = info->flow_id;
+        flow.inBytes = info->in_bytes;
+        flow.outBytes = info->out_bytes;
+
+        flows.append(flow);
+    }
+
+    return page->next_index;
+}
+
 quint32 logBlockedHeaderSize()
 {
     return FORT_LOG_BLOCKED_HEADER_SIZE;
@@ -97,6 +358,11 @@ quint32 logBlockedIpSize(quint32 pathLen, bool isIPv6)
     return FORT_LOG_BLOCKED_IP_SIZE(pathLen, isIPv6);
 }
 
+quint32 logBlockedIpRepeatSize(bool isIPv6)
+{
+    return FORT_LOG_BLOCKED_IP_REPEAT_SIZE(isIPv6);
+}
+
 quint32 logProcNewHeaderSize()
 {
     return FORT_LOG_PROC_NEW_HEADER_SIZE;
@@ -107,19 +373,49 @@ quint32 logProcNewSize(quint32 pathLen)
     return FORT_LOG_PROC_NEW_SIZE(pathLen);
 }
 
+quint32 logPathDefHeaderSize()
+{
+    return FORT_LOG_PATH_DEF_HEADER_SIZE;
+}
+
+quint32 logPathDefSize(quint32 pathLen)
+{
+    return FORT_LOG_PATH_DEF_SIZE(pathLen);
+}
+
+quint32 logPathId(quint32 pathLen)
+{
+    return (pathLen & FORT_LOG_PATH_ID_FLAG) != 0 ? (pathLen & FORT_LOG_PATH_ID_MASK) : 0;
+}
+
 quint32 logStatHeaderSize()
 {
     return FORT_LOG_STAT_HEADER_SIZE;
 }
 
-quint32 logStatTrafSize(quint16 procCount)
+quint32 logStatTrafSize(quint16 procCount, bool compact, bool conns)
 {
-    return FORT_LOG_STAT_TRAF_SIZE(procCount);
+    return FORT_LOG_STAT_TRAF_SIZE(procCount, compact, conns);
 }
 
-quint32 logStatSize(quint16 procCount)
+quint32 logStatSize(quint16 procCount, bool compact, bool conns)
 {
-    return FORT_LOG_STAT_SIZE(procCount);
+    return FORT_LOG_STAT_SIZE(procCount, compact, conns);
+}
+
+quint32 logFlowStatHeaderSize()
+{
+    return FORT_LOG_FLOW_STAT_HEADER_SIZE;
+}
+
+quint32 logFlowStatEntrySize()
+{
+    return FORT_LOG_FLOW_STAT_ENTRY_SIZE;
+}
+
+quint32 logFlowStatSize(quint16 flowCount)
+{
+    return FORT_LOG_FLOW_STAT_SIZE(flowCount);
 }
 
 quint32 logTimeSize()
@@ -127,6 +423,93 @@ quint32 logTimeSize()
     return FORT_LOG_TIME_SIZE;
 }
 
+int logDroppedTypes()
+{
+    return FORT_LOG_DROPPED_TYPES;
+}
+
+quint32 logDroppedSize()
+{
+    return FORT_LOG_DROPPED_SIZE;
+}
+
+quint32 logQuotaSize()
+{
+    return FORT_LOG_QUOTA_SIZE;
+}
+
+quint32 logShaperStatSize()
+{
+    return FORT_LOG_SHAPER_STAT_SIZE;
+}
+
+int logRingSizeMin()
+{
+    return FORT_LOG_RING_SIZE_MIN;
+}
+
+int logRingSizeMax()
+{
+    return FORT_LOG_RING_SIZE_MAX;
+}
+
+int logRingDataOff()
+{
+    return FORT_LOG_RING_DATA_OFF;
+}
+
+int logRingConfSize()
+{
+    return sizeof(FORT_LOG_RING_CONF);
+}
+
+void logRingConfWrite(char *output, void *ring, void *event, quint32 size)
+{
+    PFORT_LOG_RING_CONF ringConf = (PFORT_LOG_RING_CONF) output;
+
+    ringConf->ring = quint64(quintptr(ring));
+    ringConf->event = quint64(quintptr(event));
+    ringConf->size = size;
+}
+
+const char *logRingData(const void *ring)
+{
+    return ((const FORT_LOG_RING *) ring)->data;
+}
+
+quint32 logRingDataSize(const void *ring)
+{
+    return ((const FORT_LOG_RING *) ring)->size;
+}
+
+quint32 logRingHead(const void *ring)
+{
+    const quint32 head = ((const FORT_LOG_RING *) ring)->head;
+
+    MemoryBarrier(); // read the records after the head
+
+    return head;
+}
+
+quint32 logRingDropped(const void *ring)
+{
+    return ((const FORT_LOG_RING *) ring)->dropped;
+}
+
+void logRingSetTail(void *ring, quint32 tail)
+{
+    InterlockedExchange((volatile LONG *) &((PFORT_LOG_RING) ring)->tail, LONG(tail));
+}
+
+bool logRingSetWaiting(void *ring, quint32 head)
+{
+    PFORT_LOG_RING logRing = (PFORT_LOG_RING) ring;
+
+    InterlockedExchange((volatile LONG *) &logRing->waiting, 1);
+
+    return logRing->head == head;
+}
+
 quint8 logType(const char *input)
 {
     return fort_log_type(input);
@@ -143,34 +526,81 @@ void logBlockedHeaderRead(const char *input, int *blocked, quint32 *pid, quint32
 }
 
 void logBlockedIpHeaderWrite(char *output, int isIPv6, int inbound, int inherited,
-        quint8 blockReason, quint8 ipProto, quint16 localPort, quint16 remotePort,
-        const ip_addr_t *localIp, const ip_addr_t *remoteIp, quint32 pid, quint32 pathLen)
+        quint8 blockReason, quint8 sampleRate, quint8 ipProto, quint16 localPort,
+        quint16 remotePort, const ip_addr_t *localIp, const ip_addr_t *remoteIp, quint32 pid,
+        quint32 pathLen)
 {
-    fort_log_blocked_ip_header_write(output, isIPv6, inbound, inherited, blockReason, ipProto,
-            localPort, remotePort, &localIp->v4, &remoteIp->v4, pid, pathLen);
+    fort_log_blocked_ip_header_write(output, isIPv6, inbound, inherited, blockReason, sampleRate,
+            ipProto, localPort, remotePort, &localIp->v4, &remoteIp->v4, pid, pathLen);
 }
 
 void logBlockedIpHeaderRead(const char *input, int *isIPv6, int *inbound, int *inherited,
-        quint8 *blockReason, quint8 *ipProto, quint16 *localPort, quint16 *remotePort,
-        ip_addr_t *localIp, ip_addr_t *remoteIp, quint32 *pid, quint32 *pathLen)
+        quint8 *blockReason, quint8 *sampleRate, quint8 *ipProto, quint16 *localPort,
+        quint16 *remotePort, ip_addr_t *localIp, ip_addr_t *remoteIp, quint32 *pid,
+        quint32 *pathLen)
+{
+    fort_log_blocked_ip_header_read(input, isIPv6, inbound, inherited, blockReason, sampleRate,
+            ipProto, localPort, remotePort, &localIp->v4, &remoteIp->v4, pid, pathLen);
+}
+
+void logBlockedIpRepeatRead(const char *input, int *isIPv6, int *inbound, quint8 *blockReason,
+        quint8 *ipProto, quint16 *remotePort, ip_addr_t *remoteIp, quint32 *pid,
+        quint32 *repeatCount, qint64 *firstTime, qint64 *lastTime)
+{
+    fort_log_blocked_ip_repeat_read(input, isIPv6, inbound, blockReason, ipProto, remotePort,
+            &remoteIp->v4, pid, repeatCount, firstTime, lastTime);
+}
+
+void logProcNewHeaderWrite(
+        char *output, quint32 pid, quint32 sessionId, quint32 confAppId, quint32 pathLen)
+{
+    fort_log_proc_new_header_write(output, pid, sessionId, confAppId, pathLen);
+}
+
+void logProcNewHeaderRead(const char *input, quint32 *pid, quint32 *sessionId, quint32 *confAppId,
+        quint32 *pathLen)
+{
+    fort_log_proc_new_header_read(input, pid, sessionId, confAppId, pathLen);
+}
+
+void logPathDefHeaderRead(const char *input, quint32 *pathId, quint32 *pathLen)
 {
-    fort_log_blocked_ip_header_read(input, isIPv6, inbound, inherited, blockReason, ipProto,
-            localPort, remotePort, &localIp->v4, &remoteIp->v4, pid, pathLen);
+    fort_log_path_def_header_read(input, pathId, pathLen);
 }
 
-void logProcNewHeaderWrite(char *output, quint32 pid, quint32 pathLen)
+void logStatTrafHeaderWrite(char *output, quint16 procCount, int compact, int conns)
 {
-    fort_log_proc_new_header_write(output, pid, pathLen);
+    fort_log_stat_traf_header_write(output, procCount, compact, conns);
 }
 
-void logProcNewHeaderRead(const char *input, quint32 *pid, quint32 *pathLen)
+void logStatTrafHeaderRead(const char *input, quint16 *procCount, int *compact, int *conns)
 {
-    fort_log_proc_new_header_read(input, pid, pathLen);
+    fort_log_stat_traf_header_read(input, procCount, compact, conns);
 }
 
-void logStatTrafHeaderRead(const char *input, quint16 *procCount)
+void logFlowStatHeaderWrite(char *output, quint16 flowCount)
 {
-    fort_log_stat_traf_header_read(input, procCount);
+    fort_log_flow_stat_header_write(output, flowCount);
+}
+
+void logFlowStatHeaderRead(const char *input, quint16 *flowCount)
+{
+    fort_log_flow_stat_header_read(input, flowCount);
+}
+
+void logFlowStatWrite(char *output, int isIPv6, int inbound, quint8 ipProto, quint16 localPort,
+        quint16 remotePort, const ip_addr_t *remoteIp, quint32 pid, const quint64 *traf)
+{
+    fort_log_flow_stat_write(output, isIPv6, inbound, ipProto, localPort, remotePort,
+            &remoteIp->v4, pid, (const PFORT_FLOW_TRAF) traf);
+}
+
+void logFlowStatRead(const char *input, int *isIPv6, int *inbound, quint8 *ipProto,
+        quint16 *localPort, quint16 *remotePort, ip_addr_t *remoteIp, quint32 *pid,
+        quint64 *traf)
+{
+    fort_log_flow_stat_read(input, isIPv6, inbound, ipProto, localPort, remotePort,
+            &remoteIp->v4, pid, (PFORT_FLOW_TRAF) traf);
 }
 
 void logTimeWrite(char *output, int systemTimeChanged, qint64 unixTime)
@@ -183,6 +613,42 @@ void logTimeRead(const char *input, int *systemTimeChanged, qint64 *unixTime)
     fort_log_time_read(input, systemTimeChanged, unixTime);
 }
 
+void logDroppedRead(const char *input, quint32 *drops)
+{
+    fort_log_dropped_read(input, drops);
+}
+
+void logQuotaRead(const char *input, quint8 *quotaBits)
+{
+    fort_log_quota_read(input, quotaBits);
+}
+
+void logShaperStatWrite(char *output, quint8 queueIndex, quint32 sojournMaxMsecs,
+        const quint64 *bytes, const quint32 *packets)
+{
+    FORT_SHAPER_STAT stat;
+    stat.queued_bytes = bytes[0];
+    stat.passed_bytes = bytes[1];
+    stat.dropped_bytes = bytes[2];
+    stat.passed_packets = packets[0];
+    stat.dropped_packets = packets[1];
+
+    fort_log_shaper_stat_write(output, queueIndex, sojournMaxMsecs, &stat);
+}
+
+void logShaperStatRead(const char *input, quint8 *queueIndex, quint32 *sojournMaxMsecs,
+        quint64 *bytes, quint32 *packets)
+{
+    FORT_SHAPER_STAT stat;
+    fort_log_shaper_stat_read(input, queueIndex, sojournMaxMsecs, &stat);
+
+    bytes[0] = stat.queued_bytes;
+    bytes[1] = stat.passed_bytes;
+    bytes[2] = stat.dropped_bytes;
+    packets[0] = stat.passed_packets;
+    packets[1] = stat.dropped_packets;
+}
+
 void confAppPermsMaskInit(void *drvConf)
 {
     PFORT_CONF conf = (PFORT_CONF) drvConf;
@@ -190,6 +656,25 @@ void confAppPermsMaskInit(void *drvConf)
     fort_conf_app_perms_mask_init(conf, conf->flags.group_bits);
 }
 
+quint8 confIpIndexBits(quint32 ipCount, quint32 pairCount)
+{
+    return fort_conf_ip_index_bits(ipCount, pairCount);
+}
+
+quint32 confZonesIp4Mask(const void *drvZones, quint32 ip)
+{
+    const PFORT_CONF_ZONES zones = (const PFORT_CONF_ZONES) drvZones;
+
+    return fort_conf_zones_ip4_mask(zones, ip);
+}
+
+bool confIp4InList(const void *drvAddrList, quint32 ip)
+{
+    const PFORT_CONF_ADDR4_LIST addr_list = (const PFORT_CONF_ADDR4_LIST) drvAddrList;
+
+    return fort_conf_ip_inlist(&ip, addr_list, /*isIPv6=*/false);
+}
+
 bool confIpInRange(
         const void *drvConf, const quint32 *ip, bool isIPv6, bool included, int addrGroupIndex)
 {
@@ -217,6 +702,31 @@ bool confIp6InRange(const void *drvConf, const ip6_addr_t &ip, bool included, in
     return confIpInRange(drvConf, &ip.addr32[0], /*isIPv6=*/true, included, addrGroupIndex);
 }
 
+int confRuleFind(const void *drvConf, quint8 ipProto, bool inbound, quint32 localIp,
+        quint16 localPort, quint32 remoteIp, quint16 remotePort)
+{
+    const PFORT_CONF conf = (const PFORT_CONF) drvConf;
+
+    FORT_CONF_RULE_CONN conn;
+    conn.local_ip = &localIp;
+    conn.remote_ip = &remoteIp;
+    conn.local_port = localPort;
+    conn.remote_port = remotePort;
+    conn.ip_proto = ipProto;
+    conn.inbound = inbound;
+    conn.isIPv6 = false;
+
+    const PFORT_CONF_RULE rule = fort_conf_rules_find(conf, &conn);
+    if (rule == nullptr)
+        return -1;
+
+    const PFORT_CONF_RULES rules = (const PFORT_CONF_RULES) (conf->data + conf->rules_off);
+    const PFORT_CONF_RULE rulesArray =
+            (const PFORT_CONF_RULE) ((const char *) rules + rules->rules_off);
+
+    return int(rule - rulesArray);
+}
+
 quint16 confAppFind(const void *drvConf, const QString &kernelPath)
 {
     const PFORT_CONF conf = (const PFORT_CONF) drvConf;
@@ -244,6 +754,11 @@ bool confAppBlocked(const void *drvConf, quint16 appFlags, qint8 *blockReason)
     return fort_conf_app_blocked(conf, { appFlags }, blockReason);
 }
 
+quint32 confAppPathHash(const void *path, quint32 pathLen)
+{
+    return fort_conf_app_path_hash((const PVOID) path, pathLen);
+}
+
 quint16 confAppPeriodBits(const void *drvConf, quint8 hour, quint8 minute)
 {
     const PFORT_CONF conf = (const PFORT_CONF) drvConf;
@@ -255,6 +770,157 @@ quint16 confAppPeriodBits(const void *drvConf, quint8 hour, quint8 minute)
     return fort_conf_app_period_bits(conf, time, nullptr);
 }
 
+int confAppPeriodNext(const void *drvConf, quint8 hour, quint8 minute)
+{
+    const PFORT_CONF conf = (const PFORT_CONF) drvConf;
+
+    FORT_TIME time;
+    time.hour = hour;
+    time.minute = minute;
+
+    return fort_conf_app_period_next(conf, time);
+}
+
+namespace {
+
+BOOL confZonesIpIncluded(void *ctx, UINT32 zones_mask, const UINT32 *remote_ip, BOOL isIPv6)
+{
+    const PFORT_CONF_ZONES zones = (const PFORT_CONF_ZONES) ctx;
+    if (zones == nullptr)
+        return false;
+
+    zones_mask &= (zones->mask & zones->enabled_mask);
+
+    // Lookup the indexed zones at once by the merged index
+    if (!isIPv6 && zones->index_n != 0) {
+        if ((fort_conf_zones_ip4_mask(zones, *remote_ip) & zones_mask & zones->index_mask) != 0)
+            return true;
+
+        zones_mask &= ~zones->index_mask;
+    }
+
+    while (zones_mask != 0) {
+        const int zone_index = bit_scan_forward(zones_mask);
+        const PFORT_CONF_ADDR4_LIST addr_list =
+                (const PFORT_CONF_ADDR4_LIST) (zones->data + zones->addr_off[zone_index]);
+
+        if (fort_conf_ip_inlist(remote_ip, addr_list, isIPv6))
+            return true;
+
+        zones_mask ^= (1u << zone_index);
+    }
+
+    return false;
+}
+
+bool confAppZoneBlocked(const PFORT_CONF_ZONES zones, FORT_APP_ENTRY app_data,
+        const UINT32 *remote_ip, bool isIPv6, qint8 *blockReason)
+{
+    if (app_data.flags.lan_only) {
+        *blockReason = FORT_BLOCK_REASON_LAN_ONLY;
+        return true;
+    }
+
+    if ((app_data.reject_zones != 0
+                && confZonesIpIncluded(zones, app_data.reject_zones, remote_ip, isIPv6))
+            || (app_data.accept_zones != 0
+                    && !confZonesIpIncluded(zones, app_data.accept_zones, remote_ip, isIPv6))) {
+        *blockReason = FORT_BLOCK_REASON_ZONE;
+        return true;
+    }
+
+    return false;
+}
+
+}
+
+bool confConnBlocked(const void *drvConf, const void *drvZones, const QString &kernelPath,
+        bool isIPv6, bool inbound, quint8 ipProto, const ip_addr_t &localIp, quint16 localPort,
+        const ip_addr_t &remoteIp, quint16 remotePort, qint8 *blockReason)
+{
+    const PFORT_CONF conf = (const PFORT_CONF) drvConf;
+    const PFORT_CONF_ZONES zones = (const PFORT_CONF_ZONES) drvZones;
+    const FORT_CONF_FLAGS conf_flags = conf->flags;
+
+    const UINT32 *local_ip = isIPv6 ? localIp.v6.addr32 : &localIp.v4;
+    const UINT32 *remote_ip = isIPv6 ? remoteIp.v6.addr32 : &remoteIp.v4;
+
+    *blockReason = FORT_BLOCK_REASON_NONE;
+
+    if (!conf_flags.filter_enabled)
+        return false; // allow (Filter Disabled)
+
+    *blockReason = FORT_BLOCK_REASON_UNKNOWN;
+
+    if (conf_flags.block_traffic)
+        return true; // block all
+
+    // The same order of checks as the callouts' ones
+    FORT_CONF_RULE_CONN conn;
+    conn.local_ip = local_ip;
+    conn.remote_ip = remote_ip;
+    conn.local_port = localPort;
+    conn.remote_port = remotePort;
+    conn.ip_proto = ipProto;
+    conn.inbound = inbound;
+    conn.isIPv6 = isIPv6;
+
+    const PFORT_CONF_RULE rule = fort_conf_rules_find(conf, &conn);
+    if (rule != nullptr && rule->block) {
+        *blockReason = FORT_BLOCK_REASON_RULE;
+        return true; // block by Rule
+    }
+
+    const quint32 len = quint32(kernelPath.size()) * sizeof(WCHAR);
+    const WCHAR *p = (PCWCHAR) kernelPath.utf16();
+
+    const FORT_APP_ENTRY app_data = fort_conf_app_find(
+            conf, (const PVOID) p, len, fort_conf_app_exe_find, /*exe_context=*/nullptr);
+
+    // The Rule allows the addresses, but not the explicitly blocked apps
+    if (rule != nullptr) {
+        if (app_data.flags.v != 0 && fort_conf_app_blocked(conf, app_data.flags, blockReason))
+            return true;
+
+        *blockReason = FORT_BLOCK_REASON_NONE;
+        return false; // allow by Rule
+    }
+
+    if (!fort_conf_ip_is_inet(conf, &confZonesIpIncluded, zones, remote_ip, isIPv6)) {
+        *blockReason = FORT_BLOCK_REASON_NONE;
+        return false; // allow LocalNetwork
+    }
+
+    if (conf_flags.block_inet_traffic)
+        return true; // block Internet
+
+    if (!fort_conf_ip_inet_included(conf, &confZonesIpIncluded, zones, remote_ip, isIPv6)) {
+        *blockReason = FORT_BLOCK_REASON_IP_INET;
+        return true; // block address
+    }
+
+    if (app_data.flags.v == 0) {
+        if (conf_flags.ask_to_connect) {
+            *blockReason = FORT_BLOCK_REASON_ASK_PENDING;
+            return true; // wait for the answer
+        }
+
+        if (conf_flags.allow_all_new) {
+            *blockReason = FORT_BLOCK_REASON_NONE;
+            return false; // allow, if not blocked
+        }
+    } else if (confAppZoneBlocked(zones, app_data, remote_ip, isIPv6, blockReason)) {
+        return true;
+    }
+
+    if (!fort_conf_app_blocked(conf, app_data.flags, blockReason)) {
+        *blockReason = FORT_BLOCK_REASON_NONE;
+        return false;
+    }
+
+    return true;
+}
+
 bool isTimeInPeriod(quint8 hour, quint8 minute, quint8 fromHour, quint8 fromMinute, quint8 toHour,
         quint8 toMinute)
 {
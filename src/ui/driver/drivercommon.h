@@ -2,9 +2,13 @@
 #define DRIVERCOMMON_H
 
 #include <QString>
+#include <QVector>
 
 #include <common/common_types.h>
 
+struct DeviceStats;
+struct FlowInfo;
+
 namespace DriverCommon {
 
 QString deviceName();
@@ -13,11 +17,18 @@ quint32 ioctlValidate();
 quint32 ioctlSetServices();
 quint32 ioctlSetConf();
 quint32 ioctlSetFlags();
+quint32 ioctlPatchConf();
 quint32 ioctlGetLog();
 quint32 ioctlAddApp();
 quint32 ioctlDelApp();
 quint32 ioctlSetZones();
+quint32 ioctlSetZone();
 quint32 ioctlSetZoneFlag();
+quint32 ioctlGetStats();
+quint32 ioctlSetLive();
+quint32 ioctlSetLogRing();
+quint32 ioctlSetQuota();
+quint32 ioctlGetFlows();
 
 quint32 userErrorCode();
 
@@ -27,53 +38,162 @@ int bufferSize();
 
 quint32 confIoConfOff();
 
+QString confCacheFileName();
+quint32 confCacheSize(quint32 confSize, quint32 zonesSize);
+void confCacheWrite(
+        char *output, const char *conf, quint32 confSize, const char *zones, quint32 zonesSize);
+// Returns false, when the cache is invalid or of another driver version
+bool confCacheRead(const char *input, quint32 size, quint32 *confOff, quint32 *confSize,
+        quint32 *zonesOff, quint32 *zonesSize);
+
+int confQuotaSize();
+// The set bits select the driver's day & month counters to set, the others are kept
+void confQuotaWrite(
+        char *output, quint64 dayBytes, quint64 monthBytes, quint8 setBits, quint8 alertedBits);
+
+quint32 deviceStatsSize();
+void deviceStatsRead(const char *input, quint64 *cacheHits, quint64 *cacheMisses);
+int deviceStatsInjectBatchCount();
+void deviceStatsInjectBatchesRead(const char *input, quint64 *injectBatches);
+int deviceStatsAleLayerCount();
+int deviceStatsAleVerdictCount();
+int deviceStatsAleTimeCount();
+void deviceStatsRead(const char *input, DeviceStats &stats);
+
+quint32 flowsPageSize();
+// Returns the resume cursor of the next page, or 0 at the end of the flows
+quint32 flowsPageRead(const char *input, quint32 size, QVector<FlowInfo> &flows);
+
 quint32 logBlockedHeaderSize();
 quint32 logBlockedSize(quint32 pathLen);
 
 quint32 logBlockedIpHeaderSize(bool isIPv6 = false);
 quint32 logBlockedIpSize(quint32 pathLen, bool isIPv6 = false);
 
+quint32 logBlockedIpRepeatSize(bool isIPv6 = false);
+
 quint32 logProcNewHeaderSize();
 quint32 logProcNewSize(quint32 pathLen);
 
+quint32 logPathDefHeaderSize();
+quint32 logPathDefSize(quint32 pathLen);
+
+// Returns the id of the interned path, or 0 if the record carries its path
+quint32 logPathId(quint32 pathLen);
+
 quint32 logStatHeaderSize();
-quint32 logStatTrafSize(quint16 procCount);
-quint32 logStatSize(quint16 procCount);
+quint32 logStatTrafSize(quint16 procCount, bool compact = false, bool conns = false);
+quint32 logStatSize(quint16 procCount, bool compact = false, bool conns = false);
+
+quint32 logFlowStatHeaderSize();
+quint32 logFlowStatEntrySize();
+quint32 logFlowStatSize(quint16 flowCount);
 
 quint32 logTimeSize();
 
+int logDroppedTypes();
+quint32 logDroppedSize();
+
+quint32 logQuotaSize();
+
+quint32 logShaperStatSize();
+
+int logRingSizeMin();
+int logRingSizeMax();
+int logRingDataOff();
+
+int logRingConfSize();
+void logRingConfWrite(char *output, void *ring, void *event, quint32 size);
+
+// The ring's head is published by the driver, the tail is released by the service
+const char *logRingData(const void *ring);
+quint32 logRingDataSize(const void *ring);
+quint32 logRingHead(const void *ring);
+quint32 logRingDropped(const void *ring);
+void logRingSetTail(void *ring, quint32 tail);
+// Returns false, when the driver published new records meanwhile
+bool logRingSetWaiting(void *ring, quint32 head);
+
 quint8 logType(const char *input);
 
 void logBlockedHeaderWrite(char *output, bool blocked, quint32 pid, quint32 pathLen);
 void logBlockedHeaderRead(const char *input, int *blocked, quint32 *pid, quint32 *pathLen);
 
 void logBlockedIpHeaderWrite(char *output, int isIPv6, int inbound, int inherited,
-        quint8 blockReason, quint8 ipProto, quint16 localPort, quint16 remotePort,
-        const ip_addr_t *localIp, const ip_addr_t *remoteIp, quint32 pid, quint32 pathLen);
+        quint8 blockReason, quint8 sampleRate, quint8 ipProto, quint16 localPort,
+        quint16 remotePort, const ip_addr_t *localIp, const ip_addr_t *remoteIp, quint32 pid,
+        quint32 pathLen);
 void logBlockedIpHeaderRead(const char *input, int *isIPv6, int *inbound, int *inherited,
-        quint8 *blockReason, quint8 *ipProto, quint16 *localPort, quint16 *remotePort,
-        ip_addr_t *localIp, ip_addr_t *remoteIp, quint32 *pid, quint32 *pathLen);
+        quint8 *blockReason, quint8 *sampleRate, quint8 *ipProto, quint16 *localPort,
+        quint16 *remotePort, ip_addr_t *localIp, ip_addr_t *remoteIp, quint32 *pid,
+        quint32 *pathLen);
 
-void logProcNewHeaderWrite(char *output, quint32 pid, quint32 pathLen);
-void logProcNewHeaderRead(const char *input, quint32 *pid, quint32 *pathLen);
+void logBlockedIpRepeatRead(const char *input, int *isIPv6, int *inbound, quint8 *blockReason,
+        quint8 *ipProto, quint16 *remotePort, ip_addr_t *remoteIp, quint32 *pid,
+        quint32 *repeatCount, qint64 *firstTime, qint64 *lastTime);
 
-void logStatTrafHeaderRead(const char *input, quint16 *procCount);
+void logProcNewHeaderWrite(
+        char *output, quint32 pid, quint32 sessionId, quint32 confAppId, quint32 pathLen);
+void logProcNewHeaderRead(const char *input, quint32 *pid, quint32 *sessionId, quint32 *confAppId,
+        quint32 *pathLen);
+
+void logPathDefHeaderRead(const char *input, quint32 *pathId, quint32 *pathLen);
+
+void logStatTrafHeaderWrite(char *output, quint16 procCount, int compact, int conns);
+void logStatTrafHeaderRead(const char *input, quint16 *procCount, int *compact, int *conns);
+
+void logFlowStatHeaderWrite(char *output, quint16 flowCount);
+void logFlowStatHeaderRead(const char *input, quint16 *flowCount);
+
+// The traf holds in/out bytes and in/out packets
+void logFlowStatWrite(char *output, int isIPv6, int inbound, quint8 ipProto, quint16 localPort,
+        quint16 remotePort, const ip_addr_t *remoteIp, quint32 pid, const quint64 *traf);
+void logFlowStatRead(const char *input, int *isIPv6, int *inbound, quint8 *ipProto,
+        quint16 *localPort, quint16 *remotePort, ip_addr_t *remoteIp, quint32 *pid,
+        quint64 *traf);
 
 void logTimeWrite(char *output, int systemTimeChanged, qint64 unixTime);
 void logTimeRead(const char *input, int *systemTimeChanged, qint64 *unixTime);
 
+void logDroppedRead(const char *input, quint32 *drops);
+
+void logQuotaRead(const char *input, quint8 *quotaBits);
+
+// The stat holds queued, passed, dropped bytes and passed, dropped packets
+void logShaperStatWrite(char *output, quint8 queueIndex, quint32 sojournMaxMsecs,
+        const quint64 *bytes, const quint32 *packets);
+void logShaperStatRead(const char *input, quint8 *queueIndex, quint32 *sojournMaxMsecs,
+        quint64 *bytes, quint32 *packets);
+
 void confAppPermsMaskInit(void *drvConf);
 
+quint8 confIpIndexBits(quint32 ipCount, quint32 pairCount);
+
+quint32 confZonesIp4Mask(const void *drvZones, quint32 ip);
+
+bool confIp4InList(const void *drvAddrList, quint32 ip);
+
 bool confIpInRange(const void *drvConf, const quint32 *ip, bool isIPv6 = false,
         bool included = false, int addrGroupIndex = 0);
 bool confIp4InRange(const void *drvConf, quint32 ip, bool included = false, int addrGroupIndex = 0);
 bool confIp6InRange(
         const void *drvConf, const ip6_addr_t &ip, bool included = false, int addrGroupIndex = 0);
 
+int confRuleFind(const void *drvConf, quint8 ipProto, bool inbound, quint32 localIp,
+        quint16 localPort, quint32 remoteIp, quint16 remotePort);
+
 quint16 confAppFind(const void *drvConf, const QString &kernelPath);
 quint8 confAppGroupIndex(quint16 appFlags);
 bool confAppBlocked(const void *drvConf, quint16 appFlags, qint8 *blockReason);
+quint32 confAppPathHash(const void *path, quint32 pathLen);
 quint16 confAppPeriodBits(const void *drvConf, quint8 hour, quint8 minute);
+int confAppPeriodNext(const void *drvConf, quint8 hour, quint8 minute);
+
+// Returns the verdict of the driver's checks by the conf and zones, without its caches;
+// the block reason is FORT_BLOCK_REASON_NONE for the allowed connections
+bool confConnBlocked(const void *drvConf, const void *drvZones, const QString &kernelPath,
+        bool isIPv6, bool inbound, quint8 ipProto, const ip_addr_t &localIp, quint16 localPort,
+        const ip_addr_t &remoteIp, quint16 remotePort, qint8 *blockReason);
 
 bool isTimeInPeriod(quint8 hour, quint8 minute, quint8 fromHour, quint8 fromMinute, quint8 toHour,
         quint8 toMinute);
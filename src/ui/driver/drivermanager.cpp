@@ -1,5 +1,6 @@
 #include "drivermanager.h"
 
+#include <QLoggingCategory>
 #include <QProcess>
 #include <QThreadPool>
 
@@ -9,7 +10,17 @@
 #include <util/fileutil.h>
 #include <util/osutil.h>
 
+#include "devicestats.h"
 #include "driverworker.h"
+#include "flowinfo.h"
+
+namespace {
+
+const QLoggingCategory LC("driver.driverManager");
+
+constexpr int flowsMaxCount = 64 * 1024; // of the snapshot
+
+}
 
 DriverManager::DriverManager(QObject *parent, bool useDevice) : QObject(parent)
 {
@@ -82,6 +93,9 @@ bool DriverManager::openDevice()
 
 bool DriverManager::closeDevice()
 {
+    // The driver detaches the log ring on the device's cleanup
+    driverWorker()->closeLogRing();
+
     const bool res = device()->close();
 
     updateErrorCode(true);
@@ -101,10 +115,62 @@ bool DriverManager::writeServices(QByteArray &buf, int size)
     return writeData(DriverCommon::ioctlSetServices(), buf, size);
 }
 
+bool DriverManager::writeConfCacheToDriver()
+{
+    if (!isDeviceOpened())
+        return false;
+
+    const QByteArray data = FileUtil::readFileData(confCachePath());
+
+    quint32 confOff, confSize, zonesOff, zonesSize;
+    if (!DriverCommon::confCacheRead(
+                data.constData(), data.size(), &confOff, &confSize, &zonesOff, &zonesSize))
+        return false;
+
+    QByteArray confBuf = data.mid(confOff, confSize);
+    if (!writeData(DriverCommon::ioctlSetConf(), confBuf, confSize, /*inDirect=*/true))
+        return false;
+
+    m_cacheConf = confBuf;
+    m_isCacheConfSet = true;
+
+    if (zonesSize != 0) {
+        QByteArray zonesBuf = data.mid(zonesOff, zonesSize);
+        if (writeData(DriverCommon::ioctlSetZones(), zonesBuf, zonesSize, /*inDirect=*/true)) {
+            m_cacheZones = zonesBuf;
+            m_isCacheZonesSet = true;
+        }
+    }
+
+    return true;
+}
+
 bool DriverManager::writeConf(QByteArray &buf, int size, bool onlyFlags)
 {
-    return writeData(
-            onlyFlags ? DriverCommon::ioctlSetFlags() : DriverCommon::ioctlSetConf(), buf, size);
+    if (onlyFlags)
+        return writeData(DriverCommon::ioctlSetFlags(), buf, size);
+
+    if (m_isCacheConfSet) {
+        m_isCacheConfSet = false;
+
+        if (isDeviceOpened() && m_cacheConf == buf.left(size))
+            return true;
+    }
+
+    if (!writeData(DriverCommon::ioctlSetConf(), buf, size, /*inDirect=*/true))
+        return false;
+
+    if (isDeviceOpened()) {
+        m_cacheConf = buf.left(size);
+        writeConfCache();
+    }
+
+    return true;
+}
+
+bool DriverManager::writeConfPatch(QByteArray &buf, int size)
+{
+    return writeData(DriverCommon::ioctlPatchConf(), buf, size);
 }
 
 bool DriverManager::writeApp(QByteArray &buf, int size, bool remove)
@@ -114,18 +180,169 @@ bool DriverManager::writeApp(QByteArray &buf, int size, bool remove)
 
 bool DriverManager::writeZones(QByteArray &buf, int size, bool onlyFlags)
 {
-    return writeData(onlyFlags ? DriverCommon::ioctlSetZoneFlag() : DriverCommon::ioctlSetZones(),
-            buf, size);
+    if (onlyFlags)
+        return writeData(DriverCommon::ioctlSetZoneFlag(), buf, size);
+
+    if (m_isCacheZonesSet) {
+        m_isCacheZonesSet = false;
+
+        if (isDeviceOpened() && m_cacheZones == buf.left(size))
+            return true;
+    }
+
+    if (!writeData(DriverCommon::ioctlSetZones(), buf, size, /*inDirect=*/true))
+        return false;
+
+    if (isDeviceOpened()) {
+        m_cacheZones = buf.left(size);
+        writeConfCache();
+    }
+
+    return true;
+}
+
+bool DriverManager::writeZone(QByteArray &buf, int size)
+{
+    return writeData(DriverCommon::ioctlSetZone(), buf, size, /*inDirect=*/true);
+}
+
+bool DriverManager::readStats(QByteArray &buf)
+{
+    buf.resize(DriverCommon::deviceStatsSize());
+
+    return readData(DriverCommon::ioctlGetStats(), buf);
+}
+
+bool DriverManager::readDeviceStats(DeviceStats &stats)
+{
+    QByteArray buf;
+    if (!readStats(buf))
+        return false;
+
+    DriverCommon::deviceStatsRead(buf.constData(), stats);
+
+    emit deviceStatsRead(stats);
+
+    return true;
+}
+
+bool DriverManager::readAddressHits(AddressHits &hits)
+{
+    DeviceStats stats;
+    if (!isDeviceOpened() || !readDeviceStats(stats))
+        return false;
+
+    hits = stats.addressHits;
+
+    return true;
+}
+
+bool DriverManager::readFlows(QVector<FlowInfo> &flows)
+{
+    if (!isDeviceOpened())
+        return false;
+
+    QByteArray buf;
+    buf.resize(DriverCommon::flowsPageSize());
+
+    const bool wasCancelled = driverWorker()->cancelAsyncIo();
+
+    bool res;
+    quint32 index = 0;
+    do {
+        qsizetype retSize = 0;
+        res = device()->ioctl(DriverCommon::ioctlGetFlows(), (char *) &index, sizeof(index),
+                buf.data(), buf.size(), &retSize);
+        if (!res)
+            break;
+
+        index = DriverCommon::flowsPageRead(buf.constData(), retSize, flows);
+    } while (index != 0 && flows.size() < flowsMaxCount);
+
+    updateErrorCode(res);
+
+    if (wasCancelled) {
+        driverWorker()->continueAsyncIo();
+    }
+
+    return res;
+}
+
+bool DriverManager::openLogRing(int size)
+{
+    if (!isDeviceOpened())
+        return false;
+
+    const bool wasCancelled = driverWorker()->cancelAsyncIo();
+
+    const bool res = driverWorker()->openLogRing(size);
+
+    if (wasCancelled) {
+        driverWorker()->continueAsyncIo();
+    }
+
+    return res;
+}
+
+bool DriverManager::writeLiveTraffic(bool live)
+{
+    QByteArray buf(1, live ? 1 : 0);
+
+    return writeData(DriverCommon::ioctlSetLive(), buf, buf.size());
 }
 
-bool DriverManager::writeData(quint32 code, QByteArray &buf, int size)
+bool DriverManager::writeQuota(
+        quint64 dayBytes, quint64 monthBytes, quint8 setBits, quint8 alertedBits)
+{
+    QByteArray buf;
+    buf.resize(DriverCommon::confQuotaSize());
+
+    DriverCommon::confQuotaWrite(buf.data(), dayBytes, monthBytes, setBits, alertedBits);
+
+    return writeData(DriverCommon::ioctlSetQuota(), buf, buf.size());
+}
+
+void DriverManager::writeConfCache()
+{
+    // The zones are set after the conf
+    if (m_cacheConf.isEmpty())
+        return;
+
+    QByteArray data;
+    data.resize(DriverCommon::confCacheSize(m_cacheConf.size(), m_cacheZones.size()));
+
+    DriverCommon::confCacheWrite(data.data(), m_cacheConf.constData(), m_cacheConf.size(),
+            m_cacheZones.constData(), m_cacheZones.size());
+
+    const QString filePath = confCachePath();
+
+    if (!FileUtil::writeFileData(filePath, data)) {
+        qCWarning(LC) << "Conf cache write error:" << filePath;
+    }
+}
+
+QString DriverManager::confCachePath()
+{
+    return FileUtil::toNativeSeparators(qEnvironmentVariable("SystemRoot"))
+            + R"(\System32\drivers\)" + DriverCommon::confCacheFileName();
+}
+
+bool DriverManager::writeData(quint32 code, QByteArray &buf, int size, bool inDirect)
 {
     if (!isDeviceOpened())
         return true;
 
+    // The patches change the driver's conf, so the cached one may not be skipped anymore
+    if (code != DriverCommon::ioctlSetConf() && code != DriverCommon::ioctlSetZones()) {
+        m_isCacheConfSet = false;
+        m_isCacheZonesSet = false;
+    }
+
     const bool wasCancelled = driverWorker()->cancelAsyncIo();
 
-    const bool res = device()->ioctl(code, buf.data(), size);
+    // The METHOD_IN_DIRECT ioctl takes the data by the output buffer, locked by the system
+    const bool res = inDirect ? device()->ioctl(code, nullptr, 0, buf.data(), size)
+                              : device()->ioctl(code, buf.data(), size);
 
     updateErrorCode(res);
 
@@ -136,6 +353,25 @@ bool DriverManager::writeData(quint32 code, QByteArray &buf, int size)
     return res;
 }
 
+bool DriverManager::readData(quint32 code, QByteArray &buf)
+{
+    if (!isDeviceOpened())
+        return false;
+
+    const bool wasCancelled = driverWorker()->cancelAsyncIo();
+
+    qsizetype retSize = 0;
+    const bool res = device()->ioctl(code, nullptr, 0, buf.data(), buf.size(), &retSize);
+
+    updateErrorCode(res);
+
+    if (wasCancelled) {
+        driverWorker()->continueAsyncIo();
+    }
+
+    return res && retSize == buf.size();
+}
+
 bool DriverManager::reinstallDriver()
 {
     return executeCommand("reinstall.bat");
@@ -2,10 +2,15 @@
 #define DRIVERMANAGER_H
 
 #include <QObject>
+#include <QVector>
 
 #include <util/classhelpers.h>
 #include <util/ioc/iocservice.h>
 
+struct AddressHits;
+struct DeviceStats;
+struct FlowInfo;
+
 class Device;
 class DriverWorker;
 
@@ -32,9 +37,12 @@ public:
     bool reinstallDriver();
     bool uninstallDriver();
 
+    static QString confCachePath();
+
 signals:
     void errorCodeChanged();
     void isDeviceOpenedChanged();
+    void deviceStatsRead(const DeviceStats &stats);
 
 public slots:
     virtual bool openDevice();
@@ -43,9 +51,32 @@ public slots:
     bool validate(QByteArray &buf, int size);
 
     bool writeServices(QByteArray &buf, int size);
+
+    // Set the cached conf, until the full conf is loaded from the database
+    bool writeConfCacheToDriver();
     bool writeConf(QByteArray &buf, int size, bool onlyFlags = false);
+    bool writeConfPatch(QByteArray &buf, int size);
     bool writeApp(QByteArray &buf, int size, bool remove = false);
     bool writeZones(QByteArray &buf, int size, bool onlyFlags = false);
+    bool writeZone(QByteArray &buf, int size);
+
+    bool readStats(QByteArray &buf);
+    bool readDeviceStats(DeviceStats &stats);
+
+    // The active flows' snapshot, read by the pages
+    virtual bool readFlows(QVector<FlowInfo> &flows);
+
+    // The zones' and address groups' matches, read by the pages
+    virtual bool readAddressHits(AddressHits &hits);
+
+    // The logs are read in place from the ring, shared with the driver
+    bool openLogRing(int size);
+
+    // The driver flushes the traffic statistics faster, while the live traffic is shown
+    virtual bool writeLiveTraffic(bool live);
+
+    // The driver counts the inbound traffic of the day & month quotas from the given bytes
+    bool writeQuota(quint64 dayBytes, quint64 monthBytes, quint8 setBits, quint8 alertedBits);
 
 protected:
     void setErrorCode(quint32 v);
@@ -56,7 +87,11 @@ private:
     void setupWorker();
     void closeWorker();
 
-    bool writeData(quint32 code, QByteArray &buf, int size);
+    // Cache the applied conf and zones for the driver to filter by them at boot
+    void writeConfCache();
+
+    bool writeData(quint32 code, QByteArray &buf, int size, bool inDirect = false);
+    bool readData(quint32 code, QByteArray &buf);
 
     static bool executeCommand(const QString &fileName);
 
@@ -65,6 +100,12 @@ private:
 
     Device *m_device = nullptr;
     DriverWorker *m_driverWorker = nullptr;
+
+    bool m_isCacheConfSet = false; // by the cache, to skip the same full conf
+    bool m_isCacheZonesSet = false;
+
+    QByteArray m_cacheConf;
+    QByteArray m_cacheZones;
 };
 
 #endif // DRIVERMANAGER_H
@@ -1,5 +1,10 @@
 #include "driverworker.h"
 
+#include <QtMath>
+
+#define WIN32_LEAN_AND_MEAN
+#include <qt_windows.h>
+
 #include <driver/drivercommon.h>
 #include <log/logbuffer.h>
 #include <util/device.h>
@@ -7,6 +12,11 @@
 
 DriverWorker::DriverWorker(Device *device, QObject *parent) : QObject(parent), m_device(device) { }
 
+DriverWorker::~DriverWorker()
+{
+    freeLogRing();
+}
+
 void DriverWorker::run()
 {
     OsUtil::setCurrentThreadName("DriverWorker");
@@ -41,7 +51,11 @@ bool DriverWorker::cancelAsyncIo()
     m_cancelled = true;
 
     if (m_isLogReading) {
-        m_device->cancelIo();
+        if (m_logRingOpened) {
+            wakeLogRing();
+        } else {
+            m_device->cancelIo();
+        }
 
         do {
             m_cancelledWaitCondition.wait(&m_mutex);
@@ -70,6 +84,131 @@ void DriverWorker::close()
     m_aborted = true;
 
     readLogAsync(nullptr);
+
+    wakeLogRing();
+}
+
+bool DriverWorker::openLogRing(int size)
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (m_logRingOpened)
+        return true;
+
+    if (!m_logRing && !allocLogRing(size))
+        return false;
+
+    QByteArray buf(DriverCommon::logRingConfSize(), Qt::Uninitialized);
+    DriverCommon::logRingConfWrite(buf.data(), m_logRing, m_logRingEvent, m_logRingSize);
+
+    if (!m_device->ioctl(DriverCommon::ioctlSetLogRing(), buf.data(), buf.size()))
+        return false;
+
+    m_logRingPos = 0;
+    m_logRingTail = 0;
+    m_logRingOpened = true;
+
+    return true;
+}
+
+void DriverWorker::closeLogRing()
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_logRingOpened = false;
+}
+
+void DriverWorker::releaseLogRing(int size)
+{
+    QMutexLocker locker(&m_mutex);
+
+    // The data of a closed ring is not tracked by the driver
+    if (!m_logRingOpened)
+        return;
+
+    m_logRingTail += size;
+
+    DriverCommon::logRingSetTail(m_logRing, m_logRingTail);
+}
+
+bool DriverWorker::allocLogRing(int size)
+{
+    size = qBound(DriverCommon::logRingSizeMin(), size, DriverCommon::logRingSizeMax());
+
+    // The size must be power of 2
+    const quint32 dataSize = qNextPowerOfTwo(quint32(size)) / 2;
+
+    m_logRingEvent = CreateEventW(nullptr, /*bManualReset=*/FALSE, /*bInitialState=*/FALSE,
+            /*lpName=*/nullptr);
+    if (!m_logRingEvent)
+        return false;
+
+    m_logRing = VirtualAlloc(nullptr, DriverCommon::logRingDataOff() + dataSize,
+            MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (!m_logRing) {
+        freeLogRing();
+        return false;
+    }
+
+    m_logRingSize = dataSize;
+
+    return true;
+}
+
+void DriverWorker::freeLogRing()
+{
+    if (m_logRing) {
+        VirtualFree(m_logRing, 0, MEM_RELEASE);
+        m_logRing = nullptr;
+    }
+
+    if (m_logRingEvent) {
+        CloseHandle(m_logRingEvent);
+        m_logRingEvent = nullptr;
+    }
+}
+
+void DriverWorker::wakeLogRing()
+{
+    if (m_logRingEvent) {
+        SetEvent(m_logRingEvent);
+    }
+}
+
+quint32 DriverWorker::waitLogRing()
+{
+    for (;;) {
+        const quint32 head = DriverCommon::logRingHead(m_logRing);
+
+        if (head != m_logRingPos || m_cancelled || m_aborted)
+            return head;
+
+        // The driver signals the event only, when the waiting flag is set
+        if (DriverCommon::logRingSetWaiting(m_logRing, head)) {
+            WaitForSingleObject(m_logRingEvent, INFINITE);
+        }
+    }
+}
+
+void DriverWorker::readLogRing()
+{
+    const quint32 head = waitLogRing();
+    const quint32 pos = m_logRingPos;
+
+    if (head == pos) {
+        emitReadLogResult(false);
+        return;
+    }
+
+    // The records are parsed till the data's end, then from its start by the next read
+    const quint32 offset = pos & (m_logRingSize - 1);
+    const quint32 size = qMin(head - pos, m_logRingSize - offset);
+
+    m_logBuffer->setRawData(DriverCommon::logRingData(m_logRing) + offset, int(size));
+
+    m_logRingPos = pos + size;
+
+    emitReadLogResult(true);
 }
 
 bool DriverWorker::waitLogBuffer()
@@ -109,6 +248,11 @@ void DriverWorker::readLog()
     if (!waitLogBuffer())
         return;
 
+    if (m_logRingOpened) {
+        readLogRing();
+        return;
+    }
+
     QByteArray &array = m_logBuffer->array();
     qsizetype nr = 0;
 
@@ -15,6 +15,7 @@ class DriverWorker : public QObject, public QRunnable
 
 public:
     explicit DriverWorker(Device *device, QObject *parent = nullptr);
+    ~DriverWorker() override;
 
     void run() override;
 
@@ -27,12 +28,22 @@ public slots:
     void continueAsyncIo();
     void close();
 
+    bool openLogRing(int size);
+    void closeLogRing();
+    void releaseLogRing(int size);
+
 private:
     bool waitLogBuffer();
     void emitReadLogResult(bool success, quint32 errorCode = 0);
 
     void readLog();
 
+    bool allocLogRing(int size);
+    void freeLogRing();
+    void wakeLogRing();
+    quint32 waitLogRing();
+    void readLogRing();
+
 private:
     volatile bool m_isLogReading = false;
     volatile bool m_cancelled = false;
@@ -42,6 +53,14 @@ private:
 
     LogBuffer *m_logBuffer = nullptr;
 
+    // The log ring is kept till the end, as its data may be still parsed
+    void *m_logRing = nullptr;
+    void *m_logRingEvent = nullptr;
+    quint32 m_logRingSize = 0;
+    quint32 m_logRingPos = 0; // read
+    quint32 m_logRingTail = 0; // released
+    volatile bool m_logRingOpened = false;
+
     QMutex m_mutex;
     QWaitCondition m_bufferWaitCondition;
     QWaitCondition m_cancelledWaitCondition;
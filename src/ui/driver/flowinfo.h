@@ -0,0 +1,32 @@
+#ifndef FLOWINFO_H
+#define FLOWINFO_H
+
+#include <QString>
+
+#include <common/common_types.h>
+
+// Driver's active flow of the connections' snapshot
+struct FlowInfo
+{
+    bool isTcp : 1 = false;
+    bool isIPv6 : 1 = false;
+    bool inbound : 1 = false;
+
+    quint8 ipProto = 0;
+    quint8 groupIndex = 0;
+
+    quint16 localPort = 0;
+    quint16 remotePort = 0;
+    ip_addr_t remoteIp {};
+
+    quint32 pid = 0;
+
+    quint64 flowId = 0;
+
+    quint64 inBytes = 0;
+    quint64 outBytes = 0;
+
+    QString appPath; // resolved by the service's processes
+};
+
+#endif // FLOWINFO_H
@@ -19,6 +19,7 @@
 namespace {
 
 constexpr int stickyDistance = 30;
+constexpr int replotIntervalMsecs = 250;
 
 inline void checkWindowHorizontalEdges(const QRect &screenRect, const QRect &winRect, QPoint &diff)
 {
@@ -67,13 +68,13 @@ bool clearGraphData(
 }
 
 void adjustGraphData(
-        const QSharedPointer<QCPBarsDataContainer> &data, double unixTimeKey, quint32 &bits)
+        const QSharedPointer<QCPBarsDataContainer> &data, double unixTimeKey, quint64 &bits)
 {
     const auto hi = data->constEnd() - 1;
 
     // Check existing key
     if (qFuzzyCompare(unixTimeKey, hi->mainKey())) {
-        bits += quint32(hi->mainValue());
+        bits += quint64(hi->mainValue());
     }
 
     data->removeAfter(unixTimeKey);
@@ -250,9 +251,18 @@ void GraphWindow::setupTimer()
 {
     connect(&m_hoverTimer, &QTimer::timeout, this, &GraphWindow::checkHoverLeave);
     connect(&m_updateTimer, &QTimer::timeout, this, &GraphWindow::addEmptyTraffic);
+    connect(&m_replotTimer, &TriggerTimer::timeout, this, &GraphWindow::replot);
+
+    // Replot the hidden window when shown
+    connect(this, &WidgetWindow::visibilityChanged, this, [&](bool isVisible) {
+        if (isVisible) {
+            m_replotTimer.startTrigger();
+        }
+    });
 
     m_hoverTimer.setInterval(300);
     m_updateTimer.setInterval(1000); // 1 second
+    m_replotTimer.setInterval(replotIntervalMsecs);
 
     m_updateTimer.start();
 }
@@ -365,7 +375,7 @@ void GraphWindow::checkHoverLeave()
     }
 }
 
-void GraphWindow::addTraffic(qint64 unixTime, quint32 inBytes, quint32 outBytes)
+void GraphWindow::addTraffic(qint64 unixTime, quint64 inBytes, quint64 outBytes)
 {
     if (m_lastUnixTime != unixTime) {
         m_lastUnixTime = unixTime;
@@ -381,6 +391,20 @@ void GraphWindow::addTraffic(qint64 unixTime, quint32 inBytes, quint32 outBytes)
     addData(m_graphIn, rangeLowerKey, unixTimeKey, inBytes);
     addData(m_graphOut, rangeLowerKey, unixTimeKey, outBytes);
 
+    if (isVisible()) {
+        m_replotTimer.startTrigger();
+    }
+}
+
+void GraphWindow::addEmptyTraffic()
+{
+    addTraffic(DateUtil::getUnixTime(), 0, 0);
+}
+
+void GraphWindow::replot()
+{
+    const double unixTimeKey = double(m_lastUnixTime);
+
     m_plot->xAxis->setRange(unixTimeKey, qFloor(m_plot->axisRect()->width() / 4), Qt::AlignRight);
 
     m_graphIn->rescaleValueAxis(false, true);
@@ -398,15 +422,10 @@ void GraphWindow::addTraffic(qint64 unixTime, quint32 inBytes, quint32 outBytes)
     m_plot->replot();
 }
 
-void GraphWindow::addEmptyTraffic()
-{
-    addTraffic(DateUtil::getUnixTime(), 0, 0);
-}
-
-void GraphWindow::addData(QCPBars *graph, double rangeLowerKey, double unixTimeKey, quint32 bytes)
+void GraphWindow::addData(QCPBars *graph, double rangeLowerKey, double unixTimeKey, quint64 bytes)
 {
     auto data = graph->data();
-    quint32 bits = bytes * 8;
+    quint64 bits = bytes * 8;
 
     if (!clearGraphData(data, rangeLowerKey, unixTimeKey)) {
         adjustGraphData(data, unixTimeKey, bits);
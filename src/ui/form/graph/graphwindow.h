@@ -4,6 +4,7 @@
 #include <QTimer>
 
 #include <form/windowtypes.h>
+#include <util/triggertimer.h>
 #include <util/window/widgetwindow.h>
 
 class ConfManager;
@@ -36,13 +37,15 @@ signals:
     void mouseRightClick(QMouseEvent *event);
 
 public slots:
-    void addTraffic(qint64 unixTime, quint32 inBytes, quint32 outBytes);
+    void addTraffic(qint64 unixTime, quint64 inBytes, quint64 outBytes);
 
 private slots:
     void checkHoverLeave();
 
     void addEmptyTraffic();
 
+    void replot();
+
 private:
     void onMouseDoubleClick(QMouseEvent *event);
     void onMouseDragBegin(QMouseEvent *event);
@@ -62,7 +65,7 @@ private:
 
     void setupTimer();
 
-    void addData(QCPBars *graph, double rangeLowerKey, double unixTimeKey, quint32 bytes);
+    void addData(QCPBars *graph, double rangeLowerKey, double unixTimeKey, quint64 bytes);
 
     void updateWindowTitleSpeed();
     void setWindowOpacityPercent(int percent);
@@ -94,6 +97,7 @@ private:
 
     QTimer m_updateTimer;
     QTimer m_hoverTimer;
+    TriggerTimer m_replotTimer;
 };
 
 #endif // GRAPHWINDOW_H
@@ -13,6 +13,8 @@
 #include <conf/addressgroup.h>
 #include <conf/confmanager.h>
 #include <conf/firewallconf.h>
+#include <driver/devicestats.h>
+#include <driver/drivermanager.h>
 #include <form/controls/controlutil.h>
 #include <form/controls/plaintextedit.h>
 #include <form/controls/textarea2splitter.h>
@@ -22,7 +24,9 @@
 #include <fortmanager.h>
 #include <fortsettings.h>
 #include <user/iniuser.h>
+#include <util/dateutil.h>
 #include <util/iconcache.h>
+#include <util/ioc/ioccontainer.h>
 #include <util/net/netutil.h>
 #include <util/textareautil.h>
 
@@ -81,6 +85,8 @@ void AddressesPage::onRetranslateUi()
     m_btAddLocals->setToolTip(tr("Add Local Networks"));
 
     retranslateAddressesPlaceholderText();
+
+    updateGroupHits();
 }
 
 void AddressesPage::retranslateAddressesPlaceholderText()
@@ -102,6 +108,10 @@ void AddressesPage::setupUi()
     m_tabBar->addTab(IconCache::icon(":/icons/global_telecom.png"), QString());
     m_tabBar->addTab(IconCache::icon(":/icons/ip_block.png"), QString());
 
+    // Matches of the address group
+    m_labelHits = ControlUtil::createLabel();
+    layout->addWidget(m_labelHits);
+
     // Address Columns
     setupAddressColumns();
 
@@ -240,6 +250,31 @@ void AddressesPage::updateGroup()
 
     m_includeAddresses->btSelectZones()->setZones(addressGroup()->includeZones());
     m_excludeAddresses->btSelectZones()->setZones(addressGroup()->excludeZones());
+
+    updateGroupHits();
+}
+
+void AddressesPage::updateGroupHits()
+{
+    AddressHits hits;
+    if (!IoC<DriverManager>()->readAddressHits(hits)) {
+        m_labelHits->clear();
+        return;
+    }
+
+    const int index = addressGroupIndex();
+    const quint64 groupHits = hits.addrGroupHits.value(index);
+    const qint64 hitTime = hits.addrGroupHitTimes.value(index);
+
+    if (hitTime == 0) {
+        m_labelHits->setText(tr("Never matched"));
+        return;
+    }
+
+    const QString lastText = DateUtil::localeDateTime(
+            QDateTime::fromSecsSinceEpoch(hitTime), QLocale::ShortFormat);
+
+    m_labelHits->setText(tr("Matched: %1, last: %2").arg(QString::number(groupHits), lastText));
 }
 
 void AddressesPage::checkAddressGroupEdited()
@@ -43,6 +43,7 @@ private:
     void setupAddressGroup();
 
     void updateGroup();
+    void updateGroupHits();
 
     void checkAddressGroupEdited();
 
@@ -53,6 +54,7 @@ private:
     int m_addressGroupIndex = -1;
 
     QTabBar *m_tabBar = nullptr;
+    QLabel *m_labelHits = nullptr;
     AddressesColumn *m_includeAddresses = nullptr;
     AddressesColumn *m_excludeAddresses = nullptr;
     TextArea2Splitter *m_splitter = nullptr;
@@ -26,7 +26,9 @@
 #include <form/dialog/dialogutil.h>
 #include <form/opt/optionscontroller.h>
 #include <fortsettings.h>
+#include <stat/statmanager.h>
 #include <user/iniuser.h>
+#include <util/ioc/ioccontainer.h>
 #include <util/net/netutil.h>
 #include <util/textareautil.h>
 
@@ -151,6 +153,7 @@ void ApplicationsPage::onRetranslateUi()
 
     m_cbLogBlocked->setText(tr("Collect blocked connections"));
     m_cbLogConn->setText(tr("Collect connection statistics"));
+    m_cbLogStat->setText(tr("Collect traffic statistics"));
 
     m_cscLimitIn->checkBox()->setText(tr("Download speed limit:"));
     m_cscLimitOut->checkBox()->setText(tr("Upload speed limit:"));
@@ -160,6 +163,12 @@ void ApplicationsPage::onRetranslateUi()
     m_limitPacketLoss->label()->setText(tr("Packet Loss:"));
     m_limitBufferSizeIn->label()->setText(tr("Download Buffer Size:"));
     m_limitBufferSizeOut->label()->setText(tr("Upload Buffer Size:"));
+    m_limitBurstSize->label()->setText(tr("Burst Size:"));
+    m_cbLimitFairQueue->setText(tr("Share speed limit fairly between connections"));
+    m_cbLimitFairProcess->setText(tr("Share speed limit fairly between processes"));
+    m_cbLimitEcn->setText(tr("Mark congestion by ECN instead of dropping packets"));
+    m_cbLimitPacing->setText(tr("Pace packets evenly without bursts"));
+    retranslateLimitStat();
 
     m_cbGroupEnabled->setText(tr("Enabled"));
     m_ctpGroupPeriod->checkBox()->setText(tr("time period:"));
@@ -197,6 +206,27 @@ void ApplicationsPage::retranslateGroupLimits()
     m_cscLimitOut->setNames(list);
 }
 
+void ApplicationsPage::retranslateLimitStat()
+{
+    QStringList lines;
+
+    for (const ShaperStat &stat : m_limitStats) {
+        if (stat.passedPackets == 0 && stat.droppedPackets == 0)
+            continue;
+
+        lines.append(tr("%1: %2 queued, %3 ms max. delay, %4 of %5 packets dropped (%6)")
+                        .arg(stat.inbound() ? tr("Download") : tr("Upload"),
+                                NetUtil::formatDataSize(qint64(stat.queuedBytes)))
+                        .arg(stat.sojournMaxMsecs)
+                        .arg(stat.droppedPackets)
+                        .arg(stat.passedPackets + stat.droppedPackets)
+                        .arg(NetUtil::formatDataSize(qint64(stat.droppedBytes))));
+    }
+
+    m_labelLimitStat->setText(lines.join('\n'));
+    m_labelLimitStat->setVisible(!lines.isEmpty());
+}
+
 void ApplicationsPage::retranslateAppsPlaceholderText()
 {
     const auto placeholderText = tr("# Examples:") + '\n'
@@ -415,11 +445,18 @@ void ApplicationsPage::setupGroupOptions()
     setupGroupLimitLatency();
     setupGroupLimitPacketLoss();
     setupGroupLimitBufferSize();
+    setupGroupLimitFairQueue();
+    setupGroupLimitFairProcess();
+    setupGroupLimitEcn();
+    setupGroupLimitPacing();
+    setupGroupLimitStat();
 
     // Menu
     const QList<QWidget *> menuWidgets = { m_cbApplyChild, ControlUtil::createSeparator(),
-        m_cbLogBlocked, m_cbLogConn, ControlUtil::createSeparator(), m_cscLimitIn, m_cscLimitOut,
-        m_limitLatency, m_limitPacketLoss, m_limitBufferSizeIn, m_limitBufferSizeOut };
+        m_cbLogBlocked, m_cbLogConn, m_cbLogStat, ControlUtil::createSeparator(), m_cscLimitIn,
+        m_cscLimitOut, m_limitLatency, m_limitPacketLoss, m_limitBufferSizeIn,
+        m_limitBufferSizeOut, m_limitBurstSize, m_cbLimitFairQueue, m_cbLimitFairProcess,
+        m_cbLimitEcn, m_cbLimitPacing, m_labelLimitStat };
     auto layout = ControlUtil::createLayoutByWidgets(menuWidgets);
 
     auto menu = ControlUtil::createMenuByLayout(layout, this);
@@ -446,6 +483,9 @@ void ApplicationsPage::setupGroupLog()
             [&](bool checked) { pageAppGroupSetChecked(this, &AppGroup::setLogConn, checked); });
 
     m_cbLogConn->setVisible(false); // TODO: Collect allowed connections
+
+    m_cbLogStat = ControlUtil::createCheckBox(false,
+            [&](bool checked) { pageAppGroupSetChecked(this, &AppGroup::setLogStat, checked); });
 }
 
 void ApplicationsPage::setupGroupLimitIn()
@@ -508,6 +548,49 @@ void ApplicationsPage::setupGroupLimitBufferSize()
 
         pageAppGroupSetUInt32(this, &AppGroup::setLimitBufferSizeOut, bufferSize);
     });
+
+    m_limitBurstSize = ControlUtil::createSpin(0, 0, maxBufferSize, suffix, [&](int value) {
+        const auto burstSize = quint32(value);
+
+        pageAppGroupSetUInt32(this, &AppGroup::setLimitBurstSize, burstSize);
+    });
+}
+
+void ApplicationsPage::setupGroupLimitFairQueue()
+{
+    m_cbLimitFairQueue = ControlUtil::createCheckBox(false, [&](bool checked) {
+        pageAppGroupSetChecked(this, &AppGroup::setLimitFairQueue, checked);
+    });
+}
+
+void ApplicationsPage::setupGroupLimitFairProcess()
+{
+    m_cbLimitFairProcess = ControlUtil::createCheckBox(false, [&](bool checked) {
+        pageAppGroupSetChecked(this, &AppGroup::setLimitFairProcess, checked);
+    });
+}
+
+void ApplicationsPage::setupGroupLimitEcn()
+{
+    m_cbLimitEcn = ControlUtil::createCheckBox(false, [&](bool checked) {
+        pageAppGroupSetChecked(this, &AppGroup::setLimitEcn, checked);
+    });
+}
+
+void ApplicationsPage::setupGroupLimitPacing()
+{
+    m_cbLimitPacing = ControlUtil::createCheckBox(false, [&](bool checked) {
+        pageAppGroupSetChecked(this, &AppGroup::setLimitPacing, checked);
+    });
+}
+
+void ApplicationsPage::setupGroupLimitStat()
+{
+    m_labelLimitStat = ControlUtil::createLabel();
+    m_labelLimitStat->setVisible(false);
+
+    connect(IoC<StatManager>(), &StatManager::shaperStatAdded, this,
+            &ApplicationsPage::onShaperStatAdded);
 }
 
 void ApplicationsPage::setupKillApps()
@@ -583,6 +666,7 @@ void ApplicationsPage::updateGroup()
 
     m_cbLogBlocked->setChecked(appGroup->logBlocked());
     m_cbLogConn->setChecked(appGroup->logConn());
+    m_cbLogStat->setChecked(appGroup->logStat());
 
     m_cscLimitIn->checkBox()->setChecked(appGroup->limitInEnabled());
     m_cscLimitIn->spinBox()->setValue(int(appGroup->speedLimitIn()));
@@ -594,6 +678,11 @@ void ApplicationsPage::updateGroup()
     m_limitPacketLoss->spinBox()->setValue(double(appGroup->limitPacketLoss()) / 100.0);
     m_limitBufferSizeIn->spinBox()->setValue(int(appGroup->limitBufferSizeIn()));
     m_limitBufferSizeOut->spinBox()->setValue(int(appGroup->limitBufferSizeOut()));
+    m_limitBurstSize->spinBox()->setValue(int(appGroup->limitBurstSize()));
+    m_cbLimitFairQueue->setChecked(appGroup->limitFairQueue());
+    m_cbLimitFairProcess->setChecked(appGroup->limitFairProcess());
+    m_cbLimitEcn->setChecked(appGroup->limitEcn());
+    m_cbLimitPacing->setChecked(appGroup->limitPacing());
 
     m_cbGroupEnabled->setChecked(appGroup->enabled());
 
@@ -604,6 +693,10 @@ void ApplicationsPage::updateGroup()
     m_killApps->editText()->setText(appGroup->killText());
     m_blockApps->editText()->setText(appGroup->blockText());
     m_allowApps->editText()->setText(appGroup->allowText());
+
+    m_limitStats[0] = {};
+    m_limitStats[1] = {};
+    retranslateLimitStat();
 }
 
 void ApplicationsPage::setupAppGroup()
@@ -617,6 +710,25 @@ void ApplicationsPage::setupAppGroup()
     connect(m_tabBar, &QTabBar::currentChanged, this, refreshAppGroup);
 }
 
+void ApplicationsPage::onShaperStatAdded(const ShaperStat &shaperStat)
+{
+    if (shaperStat.groupIndex() != appGroupIndex())
+        return;
+
+    // The driver reports the counters since its last flush
+    ShaperStat &stat = m_limitStats[shaperStat.inbound() ? 0 : 1];
+
+    stat.queueIndex = shaperStat.queueIndex;
+    stat.queuedBytes = shaperStat.queuedBytes;
+    stat.sojournMaxMsecs = qMax(stat.sojournMaxMsecs, shaperStat.sojournMaxMsecs);
+    stat.passedBytes += shaperStat.passedBytes;
+    stat.droppedBytes += shaperStat.droppedBytes;
+    stat.passedPackets += shaperStat.passedPackets;
+    stat.droppedPackets += shaperStat.droppedPackets;
+
+    retranslateLimitStat();
+}
+
 const QList<AppGroup *> &ApplicationsPage::appGroups() const
 {
     return conf()->appGroups();
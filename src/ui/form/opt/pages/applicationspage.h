@@ -1,6 +1,8 @@
 #ifndef APPLICATIONSPAGE_H
 #define APPLICATIONSPAGE_H
 
+#include <log/logentryshaperstat.h>
+
 #include "optbasepage.h"
 
 class AppGroup;
@@ -35,6 +37,7 @@ protected slots:
 
 private:
     void retranslateGroupLimits();
+    void retranslateLimitStat();
     void retranslateAppsPlaceholderText();
 
     void setupUi();
@@ -55,6 +58,11 @@ private:
     void setupGroupLimitLatency();
     void setupGroupLimitPacketLoss();
     void setupGroupLimitBufferSize();
+    void setupGroupLimitFairQueue();
+    void setupGroupLimitFairProcess();
+    void setupGroupLimitEcn();
+    void setupGroupLimitPacing();
+    void setupGroupLimitStat();
     void setupKillApps();
     void setupBlockApps();
     void setupAllowApps();
@@ -63,6 +71,8 @@ private:
     void updateGroup();
     void setupAppGroup();
 
+    void onShaperStatAdded(const ShaperStat &shaperStat);
+
     const QList<AppGroup *> &appGroups() const;
     int appGroupsCount() const;
     AppGroup *appGroupByIndex(int index) const;
@@ -86,14 +96,23 @@ private:
     LabelDoubleSpin *m_limitPacketLoss = nullptr;
     LabelSpin *m_limitBufferSizeIn = nullptr;
     LabelSpin *m_limitBufferSizeOut = nullptr;
+    LabelSpin *m_limitBurstSize = nullptr;
+    QCheckBox *m_cbLimitFairQueue = nullptr;
+    QCheckBox *m_cbLimitFairProcess = nullptr;
+    QCheckBox *m_cbLimitEcn = nullptr;
+    QCheckBox *m_cbLimitPacing = nullptr;
+    QLabel *m_labelLimitStat = nullptr;
     QCheckBox *m_cbLogBlocked = nullptr;
     QCheckBox *m_cbLogConn = nullptr;
+    QCheckBox *m_cbLogStat = nullptr;
     AppsColumn *m_killApps = nullptr;
     AppsColumn *m_blockApps = nullptr;
     AppsColumn *m_allowApps = nullptr;
     QSplitter *m_killSplitter = nullptr;
     TextArea2Splitter *m_allowSplitter = nullptr;
     QToolButton *m_btSelectFile = nullptr;
+
+    ShaperStat m_limitStats[2]; // of the in/out-bound queues of the current group
 };
 
 #endif // APPLICATIONSPAGE_H
@@ -279,12 +279,14 @@ void StatisticsPage::setupTrafKeep()
 
 void StatisticsPage::setupQuota()
 {
+    // The driver counts the quotas by its conf
     const auto quotaList = SpinCombo::makeValuesList(quotaValues);
     m_lscQuotaDayMb = ControlUtil::createSpinCombo(
             ini()->quotaDayMb(), 0, 1024 * 1024, quotaList, " MiB", [&](int value) {
                 if (ini()->quotaDayMb() != value) {
                     ini()->setQuotaDayMb(value);
                     ctrl()->setIniEdited();
+                    ctrl()->setOptEdited();
                 }
             });
 
@@ -293,6 +295,7 @@ void StatisticsPage::setupQuota()
                 if (ini()->quotaMonthMb() != value) {
                     ini()->setQuotaMonthMb(value);
                     ctrl()->setIniEdited();
+                    ctrl()->setOptEdited();
                 }
             });
 
@@ -301,6 +304,7 @@ void StatisticsPage::setupQuota()
                 if (ini()->quotaBlockInetTraffic() != checked) {
                     ini()->setQuotaBlockInternet(checked);
                     ctrl()->setIniEdited();
+                    ctrl()->setOptEdited();
                 }
             });
 }
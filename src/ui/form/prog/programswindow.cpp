@@ -8,6 +8,7 @@
 #include <QMenu>
 #include <QMimeData>
 #include <QPushButton>
+#include <QScrollBar>
 #include <QToolButton>
 #include <QVBoxLayout>
 
@@ -330,6 +331,9 @@ void ProgramsWindow::setupTableApps()
     m_appListView->setMenu(m_btEdit->menu());
 
     connect(m_appListView, &TableView::activated, m_actEditApp, &QAction::trigger);
+
+    connect(m_appListView->verticalScrollBar(), &QScrollBar::valueChanged, this,
+            &ProgramsWindow::prefetchAppIcons);
 }
 
 void ProgramsWindow::setupTableAppsHeader()
@@ -471,6 +475,16 @@ void ProgramsWindow::deleteSelectedApps()
     confAppManager()->deleteApps(selectedAppIdList());
 }
 
+void ProgramsWindow::prefetchAppIcons()
+{
+    const int firstRow = qMax(m_appListView->rowAt(0), 0);
+    const int pageRows = m_appListView->viewport()->height()
+            / qMax(m_appListView->verticalHeader()->defaultSectionSize(), 1);
+
+    // The visible rows and the next page
+    appListModel()->prefetchIcons(firstRow, 2 * pageRows);
+}
+
 int ProgramsWindow::appListCurrentIndex() const
 {
     return m_appListView->currentRow();
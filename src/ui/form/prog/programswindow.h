@@ -81,6 +81,8 @@ private:
     void updateSelectedApps(bool blocked, bool killProcess = false);
     void deleteSelectedApps();
 
+    void prefetchAppIcons();
+
     int appListCurrentIndex() const;
     AppRow appListCurrentRow() const;
     QString appListCurrentPath() const;
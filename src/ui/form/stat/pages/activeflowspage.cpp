@@ -0,0 +1,154 @@
+#include "activeflowspage.h"
+
+#include <QCheckBox>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPushButton>
+#include <QTimer>
+#include <QVBoxLayout>
+
+#include <form/controls/controlutil.h>
+#include <form/controls/tableview.h>
+#include <model/flowlistmodel.h>
+
+namespace {
+
+constexpr int flowsRefreshMsecs = 2000;
+
+}
+
+ActiveFlowsPage::ActiveFlowsPage(StatisticsController *ctrl, QWidget *parent) :
+    StatBasePage(ctrl, parent), m_flowListModel(new FlowListModel(this))
+{
+    setupUi();
+
+    flowListModel()->initialize();
+}
+
+void ActiveFlowsPage::showEvent(QShowEvent *event)
+{
+    StatBasePage::showEvent(event);
+
+    // Read the snapshot on demand only, instead of the always-on logging
+    readFlows();
+    updateRefreshTimer();
+}
+
+void ActiveFlowsPage::hideEvent(QHideEvent *event)
+{
+    StatBasePage::hideEvent(event);
+
+    updateRefreshTimer();
+}
+
+void ActiveFlowsPage::onRetranslateUi()
+{
+    m_btRefresh->setText(tr("Refresh"));
+    m_cbAutoRefresh->setText(tr("Auto refresh"));
+
+    updateFlowsCount();
+
+    flowListModel()->refresh();
+}
+
+void ActiveFlowsPage::setupUi()
+{
+    auto layout = new QVBoxLayout();
+    layout->setContentsMargins(6, 6, 6, 6);
+
+    // Header
+    auto header = setupHeader();
+    layout->addLayout(header);
+
+    // Table
+    setupTableFlowList();
+    setupTableFlowListHeader();
+    layout->addWidget(m_flowListView, 1);
+
+    // Auto refresh
+    setupRefreshTimer();
+
+    this->setLayout(layout);
+}
+
+QLayout *ActiveFlowsPage::setupHeader()
+{
+    auto layout = new QHBoxLayout();
+
+    m_btRefresh = ControlUtil::createButton(":/icons/arrow_refresh_small.png");
+
+    connect(m_btRefresh, &QAbstractButton::clicked, this, &ActiveFlowsPage::readFlows);
+
+    m_cbAutoRefresh =
+            ControlUtil::createCheckBox(false, [&](bool /*checked*/) { updateRefreshTimer(); });
+
+    m_labelFlowsCount = ControlUtil::createLabel();
+
+    layout->addWidget(m_btRefresh);
+    layout->addWidget(m_cbAutoRefresh);
+    layout->addStretch();
+    layout->addWidget(m_labelFlowsCount);
+
+    return layout;
+}
+
+void ActiveFlowsPage::setupTableFlowList()
+{
+    m_flowListView = new TableView();
+    m_flowListView->setAlternatingRowColors(true);
+    m_flowListView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    m_flowListView->setSelectionBehavior(QAbstractItemView::SelectItems);
+
+    m_flowListView->setModel(flowListModel());
+}
+
+void ActiveFlowsPage::setupTableFlowListHeader()
+{
+    auto header = m_flowListView->horizontalHeader();
+
+    header->setSectionResizeMode(0, QHeaderView::Interactive);
+    header->setSectionResizeMode(1, QHeaderView::Interactive);
+    header->setSectionResizeMode(2, QHeaderView::Interactive);
+    header->setSectionResizeMode(3, QHeaderView::Interactive);
+    header->setSectionResizeMode(4, QHeaderView::Interactive);
+    header->setSectionResizeMode(5, QHeaderView::Fixed);
+    header->setSectionResizeMode(6, QHeaderView::Interactive);
+    header->setSectionResizeMode(7, QHeaderView::Stretch);
+
+    header->resizeSection(0, 330);
+    header->resizeSection(1, 50);
+    header->resizeSection(2, 60);
+    header->resizeSection(3, 70);
+    header->resizeSection(4, 200);
+    header->resizeSection(5, 40);
+    header->resizeSection(6, 90);
+}
+
+void ActiveFlowsPage::setupRefreshTimer()
+{
+    m_refreshTimer = new QTimer(this);
+    m_refreshTimer->setInterval(flowsRefreshMsecs);
+
+    connect(m_refreshTimer, &QTimer::timeout, this, &ActiveFlowsPage::readFlows);
+}
+
+void ActiveFlowsPage::updateRefreshTimer()
+{
+    if (m_cbAutoRefresh->isChecked() && isVisible()) {
+        m_refreshTimer->start();
+    } else {
+        m_refreshTimer->stop();
+    }
+}
+
+void ActiveFlowsPage::readFlows()
+{
+    flowListModel()->readFlows();
+
+    updateFlowsCount();
+}
+
+void ActiveFlowsPage::updateFlowsCount()
+{
+    m_labelFlowsCount->setText(tr("Connections: %1").arg(flowListModel()->flows().size()));
+}
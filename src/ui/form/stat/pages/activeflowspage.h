@@ -0,0 +1,51 @@
+#ifndef ACTIVEFLOWSPAGE_H
+#define ACTIVEFLOWSPAGE_H
+
+#include "statbasepage.h"
+
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
+class FlowListModel;
+class StatisticsController;
+class TableView;
+
+class ActiveFlowsPage : public StatBasePage
+{
+    Q_OBJECT
+
+public:
+    explicit ActiveFlowsPage(StatisticsController *ctrl = nullptr, QWidget *parent = nullptr);
+
+    FlowListModel *flowListModel() const { return m_flowListModel; }
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
+
+protected slots:
+    void onRetranslateUi() override;
+
+private:
+    void setupUi();
+    QLayout *setupHeader();
+    void setupTableFlowList();
+    void setupTableFlowListHeader();
+    void setupRefreshTimer();
+
+    void updateRefreshTimer();
+
+    void readFlows();
+    void updateFlowsCount();
+
+private:
+    FlowListModel *m_flowListModel = nullptr;
+
+    QPushButton *m_btRefresh = nullptr;
+    QCheckBox *m_cbAutoRefresh = nullptr;
+    QLabel *m_labelFlowsCount = nullptr;
+    TableView *m_flowListView = nullptr;
+
+    QTimer *m_refreshTimer = nullptr;
+};
+
+#endif // ACTIVEFLOWSPAGE_H
@@ -2,6 +2,7 @@
 
 #include <QCheckBox>
 #include <QHeaderView>
+#include <QLineEdit>
 #include <QMenu>
 #include <QPushButton>
 #include <QToolButton>
@@ -67,6 +68,7 @@ void ConnectionsPage::onRetranslateUi()
     m_actClearAll->setText(tr("Clear All"));
 
     m_btClearAll->setText(tr("Clear All"));
+    m_editSearch->setPlaceholderText(tr("Search"));
 
     m_btOptions->setText(tr("Options"));
     m_cbAutoScroll->setText(tr("Auto scroll"));
@@ -147,18 +149,33 @@ QLayout *ConnectionsPage::setupHeader()
 
     connect(m_btClearAll, &QAbstractButton::clicked, m_actClearAll, &QAction::trigger);
 
+    // Search edit line
+    setupEditSearch();
+
     // Options
     setupOptions();
 
     layout->addWidget(m_btEdit);
     layout->addWidget(ControlUtil::createSeparator(Qt::Vertical));
     layout->addWidget(m_btClearAll);
+    layout->addWidget(ControlUtil::createSeparator(Qt::Vertical));
+    layout->addWidget(m_editSearch);
     layout->addStretch();
     layout->addWidget(m_btOptions);
 
     return layout;
 }
 
+void ConnectionsPage::setupEditSearch()
+{
+    m_editSearch = ControlUtil::createLineEdit(
+            QString(), [&](const QString &text) { connBlockListModel()->setFtsFilter(text); });
+    m_editSearch->setClearButtonEnabled(true);
+    m_editSearch->setMaxLength(200);
+    m_editSearch->setMinimumWidth(100);
+    m_editSearch->setMaximumWidth(200);
+}
+
 void ConnectionsPage::setupOptions()
 {
     setupAutoScroll();
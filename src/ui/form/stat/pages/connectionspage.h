@@ -4,6 +4,7 @@
 #include "statbasepage.h"
 
 QT_FORWARD_DECLARE_CLASS(QCheckBox)
+QT_FORWARD_DECLARE_CLASS(QLineEdit)
 QT_FORWARD_DECLARE_CLASS(QPushButton)
 QT_FORWARD_DECLARE_CLASS(QToolButton)
 
@@ -38,6 +39,7 @@ protected slots:
 private:
     void setupUi();
     QLayout *setupHeader();
+    void setupEditSearch();
     void setupOptions();
     void setupAutoScroll();
     void setupShowHostNames();
@@ -63,6 +65,7 @@ private:
     QAction *m_actRemoveConn = nullptr;
     QAction *m_actClearAll = nullptr;
     QToolButton *m_btClearAll = nullptr;
+    QLineEdit *m_editSearch = nullptr;
     QPushButton *m_btOptions = nullptr;
     QCheckBox *m_cbAutoScroll = nullptr;
     QCheckBox *m_cbShowHostNames = nullptr;
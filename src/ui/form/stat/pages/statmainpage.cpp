@@ -12,6 +12,7 @@
 #include <manager/windowmanager.h>
 #include <util/iconcache.h>
 
+#include "activeflowspage.h"
 #include "connectionspage.h"
 #include "trafficpage.h"
 
@@ -24,6 +25,7 @@ void StatMainPage::onRetranslateUi()
 {
     m_tabWidget->setTabText(0, tr("Traffic"));
     m_tabWidget->setTabText(1, tr("Blocked Connections"));
+    m_tabWidget->setTabText(2, tr("Active Connections"));
 }
 
 void StatMainPage::setupUi()
@@ -42,10 +44,12 @@ void StatMainPage::setupTabBar()
 {
     auto statisticsPage = new TrafficPage(ctrl());
     auto connectionsPage = new ConnectionsPage(ctrl());
+    auto activeFlowsPage = new ActiveFlowsPage(ctrl());
 
     m_tabWidget = new QTabWidget();
     m_tabWidget->addTab(statisticsPage, IconCache::icon(":/icons/chart_bar.png"), QString());
     m_tabWidget->addTab(connectionsPage, IconCache::icon(":/icons/connect.png"), QString());
+    m_tabWidget->addTab(activeFlowsPage, IconCache::icon(":/icons/ip.png"), QString());
 
     // Menu button
     m_btMenu = windowManager()->createMenuButton();
@@ -37,7 +37,7 @@
 
 namespace {
 
-constexpr int ZONES_HEADER_VERSION = 3;
+constexpr int ZONES_HEADER_VERSION = 4;
 
 QLabel *formLabelForField(QFormLayout *formLayout, QWidget *field)
 {
@@ -117,6 +117,8 @@ void ZonesWindow::restoreWindowState()
         auto header = m_zoneListView->horizontalHeader();
         header->restoreState(iniUser()->zonesHeader());
     }
+
+    zoneListModel()->readAddressHits();
 }
 
 void ZonesWindow::setupController()
@@ -439,10 +441,13 @@ void ZonesWindow::setupTableZonesHeader()
     header->setSectionResizeMode(2, QHeaderView::Interactive);
     header->setSectionResizeMode(3, QHeaderView::Stretch);
     header->setSectionResizeMode(4, QHeaderView::Stretch);
+    header->setSectionResizeMode(5, QHeaderView::Interactive);
+    header->setSectionResizeMode(6, QHeaderView::Stretch);
 
     header->resizeSection(0, 250);
     header->resizeSection(1, 350);
     header->resizeSection(2, 90);
+    header->resizeSection(5, 90);
 }
 
 void ZonesWindow::setupTableZonesChanged()
@@ -20,6 +20,7 @@
 #include <manager/envmanager.h>
 #include <manager/hotkeymanager.h>
 #include <manager/logger.h>
+#include <manager/metricsmanager.h>
 #include <manager/nativeeventfilter.h>
 #include <manager/servicemanager.h>
 #include <manager/translationmanager.h>
@@ -38,6 +39,8 @@
 #include <rpc/statmanagerrpc.h>
 #include <rpc/taskmanagerrpc.h>
 #include <rpc/windowmanagerfake.h>
+#include <stat/statappidcache.h>
+#include <stat/statexportmanager.h>
 #include <task/taskinfozonedownloader.h>
 #include <user/usersettings.h>
 #include <util/dateutil.h>
@@ -67,8 +70,11 @@ inline void setupMasterServices(IocContainer *ioc, const FortSettings *settings)
     ioc->setService(new ConfAppManager());
     ioc->setService(new ConfZoneManager());
     ioc->setService(new QuotaManager());
+    ioc->setService(new StatAppIdCache());
     ioc->setService(new StatManager(settings->statFilePath()));
     ioc->setService(new StatBlockManager(settings->statBlockFilePath()));
+    ioc->setService(new StatExportManager(settings->statFilePath(),
+            settings->statBlockFilePath(), settings->statExportCursorFilePath()));
     ioc->setService(new AskPendingManager());
     ioc->setService(new DriverManager());
     ioc->setService(new AppInfoManager(settings->cacheFilePath()));
@@ -110,6 +116,7 @@ inline void setupServices(IocContainer *ioc, const FortSettings *settings)
 
         // For Service only
         ioc->setService(new ServiceManager());
+        ioc->setService(new MetricsManager());
     } else {
         ioc->setService(new WindowManager());
 
@@ -117,12 +124,12 @@ inline void setupServices(IocContainer *ioc, const FortSettings *settings)
         ioc->setService(new HotKeyManager());
         ioc->setService(new UserSettings());
         ioc->setService(new TranslationManager());
+        ioc->setService(new HostInfoCache());
     }
 
     ioc->setService(new DriveListManager());
     ioc->setService(new NativeEventFilter());
     ioc->setService(new AppInfoCache());
-    ioc->setService(new HostInfoCache());
     ioc->setService(new ZoneListModel());
 }
 
@@ -138,6 +145,9 @@ FortManager::~FortManager()
 
     deleteManagers();
 
+    // Write the queued log lines
+    Logger::instance()->setAsync(false);
+
     OsUtil::closeMutex(m_instanceMutex);
 }
 
@@ -209,6 +219,7 @@ void FortManager::updateLogger(const FirewallConf *conf)
 
     logger->setDebug(conf->ini().logDebug());
     logger->setConsole(conf->ini().logConsole());
+    logger->setAsync(conf->ini().logAsync());
 }
 
 void FortManager::setupDbLogger()
@@ -313,6 +324,9 @@ bool FortManager::setupDriver()
 
     if (ok) {
         confManager->updateServices();
+
+        // Filter by the last applied conf, while the database is loading
+        driverManager->writeConfCacheToDriver();
     }
 
     return ok;
@@ -362,8 +376,10 @@ void FortManager::setupConfManager()
 
         updateLogger(conf);
 
-        if (!onlyFlags || conf->flagsEdited()) {
-            updateDriverConf(onlyFlags);
+        if (!onlyFlags) {
+            updateDriverConfPatch();
+        } else if (conf->flagsEdited()) {
+            updateDriverConf(/*onlyFlags=*/true);
         }
     });
 }
@@ -487,9 +503,33 @@ bool FortManager::updateDriverConf(bool onlyFlags)
     return res;
 }
 
+bool FortManager::updateDriverConfPatch()
+{
+    auto confManager = IoC<ConfManager>();
+    auto confAppManager = IoC<ConfAppManager>();
+
+    updateLogManager(false);
+
+    const bool res = confAppManager->updateDriverConfPatch();
+    if (res) {
+        updateStatManager(confManager->conf());
+    }
+
+    updateLogManager(true);
+
+    return res;
+}
+
 void FortManager::updateLogManager(bool active)
 {
-    IoC<LogManager>()->setActive(active);
+    auto logManager = IoC<LogManager>();
+
+    if (active) {
+        const FirewallConf *conf = IoC<ConfManager>()->conf();
+        logManager->setBufferSize(conf->ini().logBufferSize() * 1024);
+    }
+
+    logManager->setActive(active);
 }
 
 void FortManager::updateStatManager(FirewallConf *conf)
@@ -62,6 +62,7 @@ private:
     void loadConf();
 
     bool updateDriverConf(bool onlyFlags = false);
+    bool updateDriverConfPatch();
 
     void updateLogManager(bool active);
     void updateStatManager(FirewallConf *conf);
@@ -48,6 +48,11 @@ QString FortSettings::statBlockFilePath() const
     return statFilePath() + "-block";
 }
 
+QString FortSettings::statExportCursorFilePath() const
+{
+    return statFilePath() + "-export";
+}
+
 QString FortSettings::cacheFilePath() const
 {
     return noCache() && !hasService() ? ":memory:" : cachePath() + "appinfo.db";
@@ -324,6 +329,7 @@ void FortSettings::readConfIni(FirewallConf &conf) const
     conf.setLogAllowedIp(iniBool("logAllowedIp", true));
     conf.setLogBlockedIp(iniBool("logBlockedIp", true));
     conf.setLogAlertedBlockedIp(iniBool("logAlertedBlockedIp"));
+    conf.setLogFlowStat(iniBool("logFlowStat"));
     conf.setAppBlockAll(iniBool("appBlockAll", true));
     conf.setAppAllowAll(iniBool("appAllowAll"));
     conf.setupAppGroupBits(iniUInt("appGroupBits", DEFAULT_APP_GROUP_BITS));
@@ -366,6 +372,7 @@ void FortSettings::writeConfIni(const FirewallConf &conf)
         setIniValue("logAllowedIp", conf.logAllowedIp());
         setIniValue("logBlockedIp", conf.logBlockedIp());
         setIniValue("logAlertedBlockedIp", conf.logAlertedBlockedIp());
+        setIniValue("logFlowStat", conf.logFlowStat());
         setIniValue("appBlockAll", conf.appBlockAll());
         setIniValue("appAllowAll", conf.appAllowAll());
         setIniValue("appGroupBits", conf.appGroupBits(), DEFAULT_APP_GROUP_BITS);
@@ -47,6 +47,7 @@ public:
     QString statPath() const { return m_statPath; }
     QString statFilePath() const;
     QString statBlockFilePath() const;
+    QString statExportCursorFilePath() const;
 
     QString cachePath() const { return m_cachePath; }
     QString cacheFilePath() const;
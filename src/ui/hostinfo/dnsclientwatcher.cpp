@@ -0,0 +1,259 @@
+#include "dnsclientwatcher.h"
+
+#include <QLoggingCategory>
+#include <QThread>
+
+#define WIN32_LEAN_AND_MEAN
+#include <qt_windows.h>
+
+#include <evntcons.h>
+#include <evntrace.h>
+#include <tdh.h>
+
+#include <util/net/netutil.h>
+
+namespace {
+
+const QLoggingCategory LC("hostInfo.dnsClientWatcher");
+
+const wchar_t *const sessionName = L"FortFirewall DNS Client";
+
+// Microsoft-Windows-DNS-Client: 1c95126e-7eea-49a9-a3fe-a378b03ddb4d
+const GUID dnsClientProviderGuid = { 0x1c95126e, 0x7eea, 0x49a9,
+    { 0xa3, 0xfe, 0xa3, 0x78, 0xb0, 0x3d, 0xdb, 0x4d } };
+
+constexpr USHORT dnsQueryCompletedEventId = 3008;
+
+constexpr ULONG sessionFlushSecs = 1;
+
+struct SessionProperties
+{
+    EVENT_TRACE_PROPERTIES props;
+    wchar_t name[64];
+};
+
+void initSessionProperties(SessionProperties &sp)
+{
+    ZeroMemory(&sp, sizeof(SessionProperties));
+
+    sp.props.Wnode.BufferSize = sizeof(SessionProperties);
+    sp.props.Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+    sp.props.Wnode.ClientContext = 1; // QPC
+    sp.props.LogFileMode = EVENT_TRACE_REAL_TIME_MODE;
+    sp.props.FlushTimer = sessionFlushSecs;
+    sp.props.LoggerNameOffset = offsetof(SessionProperties, name);
+}
+
+QByteArray eventProperty(PEVENT_RECORD event, const wchar_t *name)
+{
+    PROPERTY_DATA_DESCRIPTOR desc;
+    desc.PropertyName = ULONGLONG(name);
+    desc.ArrayIndex = ULONG_MAX;
+    desc.Reserved = 0;
+
+    ULONG size = 0;
+    if (TdhGetPropertySize(event, 0, nullptr, 1, &desc, &size) != ERROR_SUCCESS || size == 0)
+        return {};
+
+    QByteArray data(int(size), Qt::Uninitialized);
+    if (TdhGetProperty(event, 0, nullptr, 1, &desc, size, (PBYTE) data.data()) != ERROR_SUCCESS)
+        return {};
+
+    return data;
+}
+
+QString eventString(PEVENT_RECORD event, const wchar_t *name)
+{
+    const QByteArray data = eventProperty(event, name);
+
+    return QString::fromWCharArray((const wchar_t *) data.constData(),
+            wcsnlen((const wchar_t *) data.constData(), data.size() / sizeof(wchar_t)));
+}
+
+quint32 eventUInt32(PEVENT_RECORD event, const wchar_t *name, quint32 defaultValue)
+{
+    const QByteArray data = eventProperty(event, name);
+
+    return (data.size() == sizeof(quint32)) ? *((const quint32 *) data.constData())
+                                            : defaultValue;
+}
+
+void WINAPI eventRecordCallback(PEVENT_RECORD event)
+{
+    const EVENT_HEADER &header = event->EventHeader;
+
+    if (header.EventDescriptor.Id != dnsQueryCompletedEventId
+            || !IsEqualGUID(header.ProviderId, dnsClientProviderGuid))
+        return;
+
+    if (eventUInt32(event, L"QueryStatus", ERROR_INVALID_DATA) != ERROR_SUCCESS)
+        return;
+
+    const QString hostName = eventString(event, L"QueryName");
+    if (hostName.isEmpty())
+        return;
+
+    const QStringList addresses =
+            DnsClientWatcher::parseQueryResults(eventString(event, L"QueryResults"));
+    if (addresses.isEmpty())
+        return;
+
+    auto watcher = static_cast<DnsClientWatcher *>(event->UserContext);
+
+    emit watcher->queryResolved(hostName, addresses);
+}
+
+QString normalizedAddress(const QString &text)
+{
+    bool ok;
+
+    const quint32 ip4 = NetUtil::textToIp4(text, &ok);
+    if (ok)
+        return NetUtil::ip4ToText(ip4);
+
+    const ip6_addr_t ip6 = NetUtil::textToIp6(text, &ok);
+    if (ok)
+        return NetUtil::ip6ToText(ip6);
+
+    return {};
+}
+
+}
+
+DnsClientWatcher::DnsClientWatcher(QObject *parent) : QObject(parent) { }
+
+DnsClientWatcher::~DnsClientWatcher()
+{
+    stop();
+}
+
+bool DnsClientWatcher::start()
+{
+    if (isStarted())
+        return true;
+
+    if (!startSession())
+        return false;
+
+    if (!openTrace()) {
+        stopSession();
+        return false;
+    }
+
+    m_thread = QThread::create([traceHandle = TRACEHANDLE(m_traceHandle)]() mutable {
+        // Returns after the CloseTrace()
+        ProcessTrace(&traceHandle, 1, nullptr, nullptr);
+    });
+    m_thread->setObjectName("DnsClientWatcher");
+    m_thread->start(QThread::LowPriority);
+
+    return true;
+}
+
+void DnsClientWatcher::stop()
+{
+    if (m_traceHandle != 0) {
+        CloseTrace(m_traceHandle);
+        m_traceHandle = 0;
+    }
+
+    stopSession();
+
+    if (m_thread) {
+        m_thread->wait();
+
+        delete m_thread;
+        m_thread = nullptr;
+    }
+}
+
+QStringList DnsClientWatcher::parseQueryResults(const QString &results)
+{
+    QStringList addresses;
+
+    const QStringList parts = results.split(';', Qt::SkipEmptyParts);
+
+    for (QString part : parts) {
+        part = part.trimmed();
+
+        // The aliases' records
+        if (part.isEmpty() || part.startsWith("type:"))
+            continue;
+
+        // The IPv4-mapped addresses
+        if (part.startsWith("::ffff:", Qt::CaseInsensitive) && part.contains('.')) {
+            part = part.mid(7);
+        }
+
+        const QString address = normalizedAddress(part);
+        if (!address.isEmpty()) {
+            addresses.append(address);
+        }
+    }
+
+    return addresses;
+}
+
+bool DnsClientWatcher::startSession()
+{
+    SessionProperties sp;
+
+    // Stop the session, left by a crashed process
+    initSessionProperties(sp);
+    ControlTraceW(0, sessionName, &sp.props, EVENT_TRACE_CONTROL_STOP);
+
+    initSessionProperties(sp);
+
+    TRACEHANDLE sessionHandle = 0;
+    ULONG res = StartTraceW(&sessionHandle, sessionName, &sp.props);
+    if (res != ERROR_SUCCESS) {
+        qCDebug(LC) << "Start session error:" << res;
+        return false;
+    }
+
+    m_sessionHandle = sessionHandle;
+
+    res = EnableTraceEx2(sessionHandle, &dnsClientProviderGuid,
+            EVENT_CONTROL_CODE_ENABLE_PROVIDER, TRACE_LEVEL_INFORMATION, 0, 0, 0, nullptr);
+    if (res != ERROR_SUCCESS) {
+        qCWarning(LC) << "Enable provider error:" << res;
+        stopSession();
+        return false;
+    }
+
+    return true;
+}
+
+void DnsClientWatcher::stopSession()
+{
+    if (m_sessionHandle == 0)
+        return;
+
+    SessionProperties sp;
+    initSessionProperties(sp);
+
+    ControlTraceW(m_sessionHandle, nullptr, &sp.props, EVENT_TRACE_CONTROL_STOP);
+
+    m_sessionHandle = 0;
+}
+
+bool DnsClientWatcher::openTrace()
+{
+    EVENT_TRACE_LOGFILEW logFile;
+    ZeroMemory(&logFile, sizeof(EVENT_TRACE_LOGFILEW));
+
+    logFile.LoggerName = const_cast<LPWSTR>(sessionName);
+    logFile.ProcessTraceMode = PROCESS_TRACE_MODE_REAL_TIME | PROCESS_TRACE_MODE_EVENT_RECORD;
+    logFile.EventRecordCallback = &eventRecordCallback;
+    logFile.Context = this;
+
+    const TRACEHANDLE traceHandle = OpenTraceW(&logFile);
+    if (traceHandle == INVALID_PROCESSTRACE_HANDLE) {
+        qCWarning(LC) << "Open trace error:" << GetLastError();
+        return false;
+    }
+
+    m_traceHandle = traceHandle;
+
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef DNSCLIENTWATCHER_H
+#define DNSCLIENTWATCHER_H
+
+#include <QObject>
+#include <QStringList>
+
+#include <util/classhelpers.h>
+
+QT_FORWARD_DECLARE_CLASS(QThread)
+
+// Watches the machine's DNS queries by the Microsoft-Windows-DNS-Client's ETW events.
+// The real-time session needs the Administrators' or the "Performance Log Users" rights.
+class DnsClientWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit DnsClientWatcher(QObject *parent = nullptr);
+    ~DnsClientWatcher() override;
+    CLASS_DELETE_COPY_MOVE(DnsClientWatcher)
+
+    bool isStarted() const { return m_thread != nullptr; }
+
+    bool start();
+    void stop();
+
+    // Of the "QueryResults" text: "type:  5 alias.example.com;::ffff:192.0.2.1;2001:db8::1;"
+    static QStringList parseQueryResults(const QString &results);
+
+signals:
+    // Emitted from the session's thread
+    void queryResolved(const QString &hostName, const QStringList &addresses);
+
+private:
+    bool startSession();
+    void stopSession();
+
+    bool openTrace();
+
+private:
+    quint64 m_sessionHandle = 0;
+    quint64 m_traceHandle = 0;
+
+    QThread *m_thread = nullptr;
+};
+
+#endif // DNSCLIENTWATCHER_H
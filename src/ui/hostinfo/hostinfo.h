@@ -6,6 +6,12 @@
 class HostInfo
 {
 public:
+    static constexpr qint64 LookupPendingMsecs = Q_INT64_C(0x7FFFFFFFFFFFFFFF);
+
+    quint8 failCount = 0; // of the successive lookups, to back off the retries
+
+    qint64 expireMsecs = LookupPendingMsecs;
+
     QString hostName;
 };
 
@@ -1,14 +1,24 @@
 #include "hostinfocache.h"
 
+#include "dnsclientwatcher.h"
 #include "hostinfomanager.h"
 
+namespace {
+
+constexpr qint64 HOST_NAME_TTL_MSECS = 60 * 60 * 1000;
+constexpr qint64 DNS_NAME_TTL_MSECS = 30 * 60 * 1000; // the events have no records' TTLs
+constexpr int DNS_CACHE_MAX = 10000;
+constexpr qint64 LOOKUP_RETRY_MSECS = 30 * 1000;
+constexpr int LOOKUP_RETRY_MAX_SHIFT = 7; // ~1 hour
+
+}
+
 HostInfoCache::HostInfoCache(QObject *parent) :
-    QObject(parent), m_manager(new HostInfoManager(this)), m_cache(1000)
+    QObject(parent), m_cache(1000), m_dnsCache(DNS_CACHE_MAX)
 {
-    connect(m_manager, &HostInfoManager::lookupFinished, this,
-            &HostInfoCache::handleFinishedLookup);
+    m_expireTimer.start();
 
-    connect(&m_triggerTimer, &QTimer::timeout, this, &HostInfoCache::cacheChanged);
+    connect(&m_triggerTimer, &TriggerTimer::timeout, this, &HostInfoCache::cacheChanged);
 }
 
 HostInfoCache::~HostInfoCache()
@@ -19,33 +29,74 @@ HostInfoCache::~HostInfoCache()
 
 QString HostInfoCache::hostName(const QString &address)
 {
+    setupDnsWatcher();
+
+    // The name, which the app asked for, is preferred to the reverse lookup's one
+    const HostInfo *dnsInfo = m_dnsCache.object(address);
+    if (dnsInfo && m_expireTimer.elapsed() < dnsInfo->expireMsecs)
+        return dnsInfo->hostName;
+
     HostInfo *hostInfo = m_cache.object(address);
 
-    if (hostInfo) {
-        return hostInfo->hostName;
-    }
+    if (!hostInfo) {
+        hostInfo = new HostInfo();
 
-    hostInfo = new HostInfo();
+        m_cache.insert(address, hostInfo, 1);
+        /* hostInfo may be deleted */
 
-    m_cache.insert(address, hostInfo, 1);
-    /* hostInfo may be deleted */
+        manager()->lookupHost(address);
 
-    m_manager->lookupHost(address);
+        return {};
+    }
+
+    // Re-resolve the expired name in background, showing the old one meanwhile
+    if (m_expireTimer.elapsed() >= hostInfo->expireMsecs) {
+        hostInfo->expireMsecs = HostInfo::LookupPendingMsecs;
+
+        manager()->lookupHost(address);
+    }
 
-    return {};
+    return hostInfo->hostName;
 }
 
 void HostInfoCache::clear()
 {
-    m_manager->clear();
+    if (m_manager) {
+        m_manager->clear();
+    }
     m_cache.clear();
 
     emitCacheChanged();
 }
 
+void HostInfoCache::cancelLookups()
+{
+    if (!m_manager)
+        return;
+
+    const QList<QString> addresses = m_cache.keys();
+
+    for (const QString &address : addresses) {
+        HostInfo *hostInfo = m_cache.object(address);
+        if (hostInfo->expireMsecs != HostInfo::LookupPendingMsecs)
+            continue;
+
+        // Look up again when requested
+        if (m_manager->cancelLookup(address)) {
+            hostInfo->expireMsecs = 0;
+        }
+    }
+}
+
 void HostInfoCache::close()
 {
-    m_manager->abortWorkers();
+    if (m_dnsWatcher) {
+        m_dnsWatcher->stop();
+    }
+
+    if (m_manager) {
+        m_manager->abort();
+    }
 }
 
 void HostInfoCache::handleFinishedLookup(const QString &address, const QString &hostName)
@@ -54,12 +105,85 @@ void HostInfoCache::handleFinishedLookup(const QString &address, const QString &
     if (!hostInfo)
         return;
 
+    const qint64 nowMsecs = m_expireTimer.elapsed();
+
+    if (hostName.isEmpty()) {
+        const int retryShift = qMin(int(hostInfo->failCount), LOOKUP_RETRY_MAX_SHIFT);
+
+        hostInfo->expireMsecs = nowMsecs + (LOOKUP_RETRY_MSECS << retryShift);
+        hostInfo->failCount = quint8(retryShift + 1);
+        return; // keep the old name
+    }
+
+    hostInfo->failCount = 0;
+    hostInfo->expireMsecs = nowMsecs + HOST_NAME_TTL_MSECS;
+
+    if (hostInfo->hostName == hostName)
+        return;
+
     hostInfo->hostName = hostName;
 
     emitCacheChanged();
 }
 
+void HostInfoCache::handleDnsQuery(const QString &hostName, const QStringList &addresses)
+{
+    const qint64 expireMsecs = m_expireTimer.elapsed() + DNS_NAME_TTL_MSECS;
+
+    bool changed = false;
+
+    for (const QString &address : addresses) {
+        HostInfo *dnsInfo = m_dnsCache.object(address);
+        if (!dnsInfo) {
+            dnsInfo = new HostInfo();
+
+            m_dnsCache.insert(address, dnsInfo, 1);
+        }
+
+        dnsInfo->expireMsecs = expireMsecs;
+
+        if (dnsInfo->hostName == hostName)
+            continue;
+
+        dnsInfo->hostName = hostName;
+
+        // Refresh the shown addresses only
+        changed = changed || m_cache.contains(address);
+    }
+
+    if (changed) {
+        emitCacheChanged();
+    }
+}
+
 void HostInfoCache::emitCacheChanged()
 {
     m_triggerTimer.startTrigger();
 }
+
+HostInfoManager *HostInfoCache::manager()
+{
+    // Created on the first lookup to not load the network stack in vain
+    if (!m_manager) {
+        m_manager = new HostInfoManager(this);
+
+        connect(m_manager, &HostInfoManager::lookupFinished, this,
+                &HostInfoCache::handleFinishedLookup);
+    }
+
+    return m_manager;
+}
+
+void HostInfoCache::setupDnsWatcher()
+{
+    if (m_dnsWatcher)
+        return;
+
+    // Falls back to the reverse lookups, when the ETW session is not permitted
+    m_dnsWatcher = new DnsClientWatcher(this);
+
+    connect(m_dnsWatcher, &DnsClientWatcher::queryResolved, this, &HostInfoCache::handleDnsQuery,
+            Qt::QueuedConnection);
+
+    m_dnsWatcher->start();
+}
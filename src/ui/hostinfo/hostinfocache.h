@@ -2,6 +2,7 @@
 #define HOSTINFOCACHE_H
 
 #include <QCache>
+#include <QElapsedTimer>
 #include <QObject>
 
 #include <util/ioc/iocservice.h>
@@ -9,6 +10,7 @@
 
 #include "hostinfo.h"
 
+class DnsClientWatcher;
 class HostInfoManager;
 
 class HostInfoCache : public QObject, public IocService
@@ -26,19 +28,29 @@ public slots:
     QString hostName(const QString &address);
 
     void clear();
+    void cancelLookups();
 
 private slots:
     void close();
 
     void handleFinishedLookup(const QString &address, const QString &hostName);
+    void handleDnsQuery(const QString &hostName, const QStringList &addresses);
 
 private:
     void emitCacheChanged();
 
+    HostInfoManager *manager();
+
+    void setupDnsWatcher();
+
 private:
     HostInfoManager *m_manager = nullptr;
+    DnsClientWatcher *m_dnsWatcher = nullptr;
 
     QCache<QString, HostInfo> m_cache;
+    QCache<QString, HostInfo> m_dnsCache; // of the machine's DNS queries
+
+    QElapsedTimer m_expireTimer;
 
     TriggerTimer m_triggerTimer;
 };
@@ -1,15 +1,269 @@
 #include "hostinfomanager.h"
 
-#include "hostinfojob.h"
+#include <QLoggingCategory>
 
-HostInfoManager::HostInfoManager(QObject *parent) : WorkerManager(parent)
+#define WIN32_LEAN_AND_MEAN
+#include <qt_windows.h>
+
+#include <windns.h>
+
+#include <util/net/netutil.h>
+
+namespace {
+
+const QLoggingCategory LC("hostInfo.hostInfoManager");
+
+constexpr int LOOKUPS_MAX = 32; // of the running queries
+constexpr qint64 LOOKUP_TIMEOUT_MSECS = 8 * 1000;
+constexpr int TIMEOUT_CHECK_MSECS = 1000;
+
+}
+
+struct HostInfoLookup
+{
+    explicit HostInfoLookup(HostInfoManager *manager, const QString &address) :
+        manager(manager), address(address)
+    {
+        memset(&result, 0, sizeof(result));
+        memset(&cancelHandle, 0, sizeof(cancelHandle));
+
+        result.Version = DNS_QUERY_REQUEST_VERSION1;
+    }
+
+    ~HostInfoLookup()
+    {
+        if (result.pQueryRecords) {
+            DnsRecordListFree(result.pQueryRecords, DnsFreeRecordList);
+        }
+    }
+
+    QString hostName() const
+    {
+        if (result.QueryStatus != ERROR_SUCCESS)
+            return {};
+
+        for (PDNS_RECORD r = result.pQueryRecords; r != nullptr; r = r->pNext) {
+            if (r->wType == DNS_TYPE_PTR) // not CNAME
+                return QString::fromWCharArray(r->Data.PTR.pNameHost);
+        }
+
+        return {};
+    }
+
+    static VOID WINAPI queryCompleted(PVOID context, PDNS_QUERY_RESULT queryResults)
+    {
+        auto lookup = static_cast<HostInfoLookup *>(context);
+
+        lookup->result = *queryResults;
+
+        lookup->manager->handleQueryCompleted(lookup);
+    }
+
+    bool pending = false; // the callback is to be called
+    bool timedOut = false;
+    bool cancelled = false; // not to report the result
+
+    qint64 startMsecs = 0;
+
+    HostInfoManager *manager = nullptr;
+
+    QString address;
+    QString queryName;
+
+    DNS_QUERY_RESULT result;
+    DNS_QUERY_CANCEL cancelHandle;
+};
+
+HostInfoManager::HostInfoManager(QObject *parent) : QObject(parent)
 {
-    setMaxWorkersCount(2);
+    m_elapsedTimer.start();
 
-    QSysInfo::machineHostName(); // Initialize ws2_32.dll
+    m_timeoutTimer.setInterval(TIMEOUT_CHECK_MSECS);
+
+    connect(&m_timeoutTimer, &QTimer::timeout, this, &HostInfoManager::checkTimeouts);
+}
+
+HostInfoManager::~HostInfoManager()
+{
+    abort();
+
+    // The queued completions are discarded with this object
+    qDeleteAll(m_lookups);
+    qDeleteAll(m_cancelledLookups);
+}
+
+bool HostInfoManager::cancelLookup(const QString &address)
+{
+    if (m_queuedAddresses.removeOne(address))
+        return true;
+
+    HostInfoLookup *lookup = m_lookups.take(address);
+    if (!lookup)
+        return false;
+
+    lookup->cancelled = true;
+    m_cancelledLookups.append(lookup);
+
+    cancelQuery(lookup);
+
+    return true;
 }
 
 void HostInfoManager::lookupHost(const QString &address)
 {
-    enqueueJob(WorkerJobPtr(new HostInfoJob(address)));
+    if (m_aborted || m_lookups.contains(address) || m_queuedAddresses.contains(address))
+        return;
+
+    m_queuedAddresses.append(address);
+
+    startLookups();
+}
+
+void HostInfoManager::clear()
+{
+    m_queuedAddresses.clear();
+
+    const QStringList addresses = m_lookups.keys();
+
+    for (const QString &address : addresses) {
+        cancelLookup(address);
+    }
+}
+
+void HostInfoManager::abort()
+{
+    m_aborted = true;
+
+    clear();
+
+    // The callbacks refer to the lookups
+    QMutexLocker locker(&m_mutex);
+
+    while (m_runningCount > 0) {
+        m_runningWaitCondition.wait(&m_mutex);
+    }
+}
+
+void HostInfoManager::startLookups()
+{
+    while (!m_queuedAddresses.isEmpty()
+            && (m_lookups.size() + m_cancelledLookups.size()) < LOOKUPS_MAX) {
+        startLookup(m_queuedAddresses.takeLast());
+    }
+
+    if (!m_lookups.isEmpty() && !m_timeoutTimer.isActive()) {
+        m_timeoutTimer.start();
+    }
+}
+
+void HostInfoManager::startLookup(const QString &address)
+{
+    auto lookup = new HostInfoLookup(this, address);
+
+    lookup->queryName = NetUtil::ptrQueryName(address);
+    lookup->startMsecs = m_elapsedTimer.elapsed();
+
+    m_lookups.insert(address, lookup);
+
+    DNS_STATUS status = ERROR_INVALID_PARAMETER;
+
+    if (!lookup->queryName.isEmpty()) {
+        DNS_QUERY_REQUEST request;
+        memset(&request, 0, sizeof(request));
+
+        request.Version = DNS_QUERY_REQUEST_VERSION1;
+        request.QueryName = (PCWSTR) lookup->queryName.utf16();
+        request.QueryType = DNS_TYPE_PTR;
+        request.QueryOptions = DNS_QUERY_STANDARD;
+        request.pQueryCompletionCallback = &HostInfoLookup::queryCompleted;
+        request.pQueryContext = lookup;
+
+        lookup->pending = true;
+        setRunningCount(+1);
+
+        status = DnsQueryEx(&request, &lookup->result, &lookup->cancelHandle);
+
+        if (status == DNS_REQUEST_PENDING)
+            return;
+
+        lookup->pending = false;
+        setRunningCount(-1);
+    }
+
+    // Completed synchronously: from the DNS cache or by an error
+    if (status != ERROR_SUCCESS) {
+        lookup->result.QueryStatus = status;
+    }
+
+    QMetaObject::invokeMethod(
+            this, [this, lookup] { finishLookup(lookup); }, Qt::QueuedConnection);
+}
+
+void HostInfoManager::cancelQuery(HostInfoLookup *lookup)
+{
+    if (!lookup->pending)
+        return;
+
+    // The callback is still called, with ERROR_CANCELLED
+    const DNS_STATUS status = DnsCancelQuery(&lookup->cancelHandle);
+    if (status != ERROR_SUCCESS) {
+        qCDebug(LC) << "Cancel error:" << lookup->address << status;
+    }
+}
+
+void HostInfoManager::checkTimeouts()
+{
+    if (m_lookups.isEmpty()) {
+        m_timeoutTimer.stop();
+        return;
+    }
+
+    const qint64 nowMsecs = m_elapsedTimer.elapsed();
+
+    for (HostInfoLookup *lookup : std::as_const(m_lookups)) {
+        if (lookup->timedOut || nowMsecs - lookup->startMsecs < LOOKUP_TIMEOUT_MSECS)
+            continue;
+
+        // Reported as failed, to be retried later
+        lookup->timedOut = true;
+
+        cancelQuery(lookup);
+    }
+}
+
+void HostInfoManager::setRunningCount(int delta)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_runningCount += delta;
+
+    if (m_runningCount == 0) {
+        m_runningWaitCondition.wakeAll();
+    }
+}
+
+void HostInfoManager::handleQueryCompleted(HostInfoLookup *lookup)
+{
+    // Called on the DNS client's thread, before the lookup is released by abort()
+    QMetaObject::invokeMethod(
+            this, [this, lookup] { finishLookup(lookup); }, Qt::QueuedConnection);
+
+    setRunningCount(-1);
+}
+
+void HostInfoManager::finishLookup(HostInfoLookup *lookup)
+{
+    if (lookup->cancelled) {
+        m_cancelledLookups.removeOne(lookup);
+    } else {
+        m_lookups.remove(lookup->address);
+
+        emit lookupFinished(lookup->address, lookup->hostName());
+    }
+
+    delete lookup;
+
+    if (!m_aborted) {
+        startLookups();
+    }
 }
@@ -1,22 +1,71 @@
 #ifndef HOSTINFOMANAGER_H
 #define HOSTINFOMANAGER_H
 
-#include <util/worker/workermanager.h>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QWaitCondition>
 
-class HostInfoManager : public WorkerManager
+#include <util/classhelpers.h>
+
+struct HostInfoLookup;
+
+// Resolves the addresses' host names by the asynchronous DnsQueryEx() PTR queries,
+// which complete on the DNS client's threads.
+class HostInfoManager : public QObject
 {
     Q_OBJECT
 
 public:
     explicit HostInfoManager(QObject *parent = nullptr);
+    ~HostInfoManager() override;
+    CLASS_DELETE_COPY_MOVE(HostInfoManager)
 
-    QString workerName() const override { return "HostInfoWorker"; }
+    bool cancelLookup(const QString &address);
 
 signals:
     void lookupFinished(const QString &address, const QString &hostName);
 
 public slots:
     void lookupHost(const QString &address);
+
+    void clear();
+    void abort();
+
+private:
+    void startLookups();
+    void startLookup(const QString &address);
+
+    void cancelQuery(HostInfoLookup *lookup);
+
+    void checkTimeouts();
+
+    void setRunningCount(int delta);
+
+    void handleQueryCompleted(HostInfoLookup *lookup);
+    void finishLookup(HostInfoLookup *lookup);
+
+private:
+    friend struct HostInfoLookup;
+
+    bool m_aborted = false;
+
+    int m_runningCount = 0; // of the queries, which callbacks are not called yet
+
+    // The latest requests are of the visible rows
+    QStringList m_queuedAddresses;
+
+    QHash<QString, HostInfoLookup *> m_lookups;
+    QList<HostInfoLookup *> m_cancelledLookups;
+
+    QElapsedTimer m_elapsedTimer;
+    QTimer m_timeoutTimer;
+
+    QMutex m_mutex;
+    QWaitCondition m_runningWaitCondition;
 };
 
 #endif // HOSTINFOMANAGER_H
@@ -4,7 +4,12 @@
 
 #include "logentryblocked.h"
 #include "logentryblockedip.h"
+#include "logentrydropped.h"
+#include "logentryflowstat.h"
+#include "logentrypathdef.h"
 #include "logentryprocnew.h"
+#include "logentryquota.h"
+#include "logentryshaperstat.h"
 #include "logentrystattraf.h"
 #include "logentrytime.h"
 
@@ -18,6 +23,14 @@ void LogBuffer::reset(int top)
 {
     m_top = top;
     m_offset = 0;
+    m_rawData = nullptr;
+}
+
+void LogBuffer::setRawData(const char *data, int size)
+{
+    m_top = size;
+    m_offset = 0;
+    m_rawData = data;
 }
 
 char *LogBuffer::output()
@@ -27,7 +40,7 @@ char *LogBuffer::output()
 
 const char *LogBuffer::input() const
 {
-    return m_array.constData() + m_offset;
+    return data() + m_offset;
 }
 
 void LogBuffer::prepareFor(int len)
@@ -81,14 +94,17 @@ void LogBuffer::readEntryBlocked(LogEntryBlocked *logEntry)
     quint32 pid, pathLen;
     DriverCommon::logBlockedHeaderRead(input, &blocked, &pid, &pathLen);
 
+    const quint32 pathId = DriverCommon::logPathId(pathLen);
+
     QString path;
-    if (pathLen) {
+    if (pathLen && pathId == 0) {
         input += DriverCommon::logBlockedHeaderSize();
         path = QString::fromWCharArray((const wchar_t *) input, pathLen / int(sizeof(wchar_t)));
     }
 
     logEntry->setBlocked(blocked);
     logEntry->setPid(pid);
+    logEntry->setPathId(pathId);
     logEntry->setKernelPath(path);
 
     const int entrySize = int(DriverCommon::logBlockedSize(pathLen));
@@ -107,9 +123,9 @@ void LogBuffer::writeEntryBlockedIp(const LogEntryBlockedIp *logEntry)
     char *output = this->output();
 
     DriverCommon::logBlockedIpHeaderWrite(output, logEntry->isIPv6(), logEntry->inbound(),
-            logEntry->inherited(), logEntry->blockReason(), logEntry->ipProto(),
-            logEntry->localPort(), logEntry->remotePort(), &logEntry->localIp(),
-            &logEntry->remoteIp(), logEntry->pid(), pathLen);
+            logEntry->inherited(), logEntry->blockReason(), logEntry->sampleRate(),
+            logEntry->ipProto(), logEntry->localPort(), logEntry->remotePort(),
+            &logEntry->localIp(), &logEntry->remoteIp(), logEntry->pid(), pathLen);
 
     if (pathLen) {
         output += DriverCommon::logBlockedIpHeaderSize(logEntry->isIPv6());
@@ -129,16 +145,19 @@ void LogBuffer::readEntryBlockedIp(LogEntryBlockedIp *logEntry)
     int inbound;
     int inherited;
     quint8 blockReason;
+    quint8 sampleRate;
     quint8 proto;
     quint16 localPort;
     quint16 remotePort;
     ip_addr_t localIp, remoteIp;
     quint32 pid, pathLen;
-    DriverCommon::logBlockedIpHeaderRead(input, &isIPv6, &inbound, &inherited, &blockReason, &proto,
-            &localPort, &remotePort, &localIp, &remoteIp, &pid, &pathLen);
+    DriverCommon::logBlockedIpHeaderRead(input, &isIPv6, &inbound, &inherited, &blockReason,
+            &sampleRate, &proto, &localPort, &remotePort, &localIp, &remoteIp, &pid, &pathLen);
+
+    const quint32 pathId = DriverCommon::logPathId(pathLen);
 
     QString path;
-    if (pathLen) {
+    if (pathLen && pathId == 0) {
         input += DriverCommon::logBlockedIpHeaderSize(isIPv6 != 0);
         path = QString::fromWCharArray((const wchar_t *) input, pathLen / int(sizeof(wchar_t)));
     }
@@ -147,18 +166,52 @@ void LogBuffer::readEntryBlockedIp(LogEntryBlockedIp *logEntry)
     logEntry->setInbound(inbound != 0);
     logEntry->setInherited(inherited != 0);
     logEntry->setBlockReason(blockReason);
+    logEntry->setSampleRate(sampleRate);
     logEntry->setIpProto(proto);
     logEntry->setLocalPort(localPort);
     logEntry->setRemotePort(remotePort);
     logEntry->setLocalIp(localIp);
     logEntry->setRemoteIp(remoteIp);
     logEntry->setPid(pid);
+    logEntry->setPathId(pathId);
     logEntry->setKernelPath(path);
 
     const int entrySize = int(DriverCommon::logBlockedIpSize(pathLen, isIPv6 != 0));
     m_offset += entrySize;
 }
 
+void LogBuffer::readEntryBlockedIpRepeat(LogEntryBlockedIp *logEntry)
+{
+    Q_ASSERT(m_offset < m_top);
+
+    const char *input = this->input();
+
+    int isIPv6;
+    int inbound;
+    quint8 blockReason;
+    quint8 proto;
+    quint16 remotePort;
+    ip_addr_t remoteIp;
+    quint32 pid, repeatCount;
+    qint64 firstTime, lastTime;
+    DriverCommon::logBlockedIpRepeatRead(input, &isIPv6, &inbound, &blockReason, &proto,
+            &remotePort, &remoteIp, &pid, &repeatCount, &firstTime, &lastTime);
+
+    logEntry->setIsIPv6(isIPv6 != 0);
+    logEntry->setInbound(inbound != 0);
+    logEntry->setBlockReason(blockReason);
+    logEntry->setIpProto(proto);
+    logEntry->setRemotePort(remotePort);
+    logEntry->setRemoteIp(remoteIp);
+    logEntry->setPid(pid);
+    logEntry->setRepeatCount(repeatCount);
+    logEntry->setConnTime(firstTime);
+    logEntry->setLastConnTime(lastTime);
+
+    const int entrySize = int(DriverCommon::logBlockedIpRepeatSize(isIPv6 != 0));
+    m_offset += entrySize;
+}
+
 void LogBuffer::writeEntryProcNew(const LogEntryProcNew *logEntry)
 {
     const QString path = logEntry->kernelPath();
@@ -169,7 +222,8 @@ void LogBuffer::writeEntryProcNew(const LogEntryProcNew *logEntry)
 
     char *output = this->output();
 
-    DriverCommon::logProcNewHeaderWrite(output, logEntry->pid(), pathLen);
+    DriverCommon::logProcNewHeaderWrite(
+            output, logEntry->pid(), logEntry->sessionId(), logEntry->confAppId(), pathLen);
 
     if (pathLen != 0) {
         output += DriverCommon::logProcNewHeaderSize();
@@ -185,22 +239,49 @@ void LogBuffer::readEntryProcNew(LogEntryProcNew *logEntry)
 
     const char *input = this->input();
 
-    quint32 pid, pathLen;
-    DriverCommon::logProcNewHeaderRead(input, &pid, &pathLen);
+    quint32 pid, sessionId, confAppId, pathLen;
+    DriverCommon::logProcNewHeaderRead(input, &pid, &sessionId, &confAppId, &pathLen);
+
+    const quint32 pathId = DriverCommon::logPathId(pathLen);
 
     QString path;
-    if (pathLen != 0) {
+    if (pathLen != 0 && pathId == 0) {
         input += DriverCommon::logProcNewHeaderSize();
         path = QString::fromWCharArray((const wchar_t *) input, pathLen / sizeof(wchar_t));
     }
 
     logEntry->setPid(pid);
+    logEntry->setSessionId(sessionId);
+    logEntry->setConfAppId(confAppId);
+    logEntry->setPathId(pathId);
     logEntry->setKernelPath(path);
 
     const int entrySize = int(DriverCommon::logProcNewSize(pathLen));
     m_offset += entrySize;
 }
 
+void LogBuffer::readEntryPathDef(LogEntryPathDef *logEntry)
+{
+    Q_ASSERT(m_offset < m_top);
+
+    const char *input = this->input();
+
+    quint32 pathId, pathLen;
+    DriverCommon::logPathDefHeaderRead(input, &pathId, &pathLen);
+
+    QString path;
+    if (pathLen != 0) {
+        input += DriverCommon::logPathDefHeaderSize();
+        path = QString::fromWCharArray((const wchar_t *) input, pathLen / sizeof(wchar_t));
+    }
+
+    logEntry->setPathId(pathId);
+    logEntry->setKernelPath(path);
+
+    const int entrySize = int(DriverCommon::logPathDefSize(pathLen));
+    m_offset += entrySize;
+}
+
 void LogBuffer::readEntryStatTraf(LogEntryStatTraf *logEntry)
 {
     Q_ASSERT(m_offset < m_top);
@@ -208,16 +289,40 @@ void LogBuffer::readEntryStatTraf(LogEntryStatTraf *logEntry)
     const char *input = this->input();
 
     quint16 procCount;
-    DriverCommon::logStatTrafHeaderRead(input, &procCount);
+    int compact;
+    int conns;
+    DriverCommon::logStatTrafHeaderRead(input, &procCount, &compact, &conns);
 
     logEntry->setProcCount(procCount);
+    logEntry->setCompact(compact != 0);
+    logEntry->setConns(conns != 0);
 
     if (procCount != 0) {
         input += DriverCommon::logStatHeaderSize();
         logEntry->setProcTrafBytes(reinterpret_cast<const quint32 *>(input));
     }
 
-    const int entrySize = int(DriverCommon::logStatSize(procCount));
+    const int entrySize = int(DriverCommon::logStatSize(procCount, compact != 0, conns != 0));
+    m_offset += entrySize;
+}
+
+void LogBuffer::readEntryFlowStat(LogEntryFlowStat *logEntry)
+{
+    Q_ASSERT(m_offset < m_top);
+
+    const char *input = this->input();
+
+    quint16 flowCount;
+    DriverCommon::logFlowStatHeaderRead(input, &flowCount);
+
+    logEntry->setFlowCount(flowCount);
+
+    if (flowCount != 0) {
+        input += DriverCommon::logFlowStatHeaderSize();
+        logEntry->setFlowData(input);
+    }
+
+    const int entrySize = int(DriverCommon::logFlowStatSize(flowCount));
     m_offset += entrySize;
 }
 
@@ -249,3 +354,56 @@ void LogBuffer::readEntryTime(LogEntryTime *logEntry)
     const int entrySize = int(DriverCommon::logTimeSize());
     m_offset += entrySize;
 }
+
+void LogBuffer::readEntryDropped(LogEntryDropped *logEntry)
+{
+    Q_ASSERT(m_offset < m_top);
+
+    const char *input = this->input();
+
+    QVector<quint32> &drops = logEntry->drops();
+    drops.resize(DriverCommon::logDroppedTypes());
+
+    DriverCommon::logDroppedRead(input, drops.data());
+
+    const int entrySize = int(DriverCommon::logDroppedSize());
+    m_offset += entrySize;
+}
+
+void LogBuffer::readEntryQuota(LogEntryQuota *logEntry)
+{
+    Q_ASSERT(m_offset < m_top);
+
+    const char *input = this->input();
+
+    quint8 quotaBits;
+    DriverCommon::logQuotaRead(input, &quotaBits);
+
+    logEntry->setQuotaBits(quotaBits);
+
+    const int entrySize = int(DriverCommon::logQuotaSize());
+    m_offset += entrySize;
+}
+
+void LogBuffer::readEntryShaperStat(LogEntryShaperStat *logEntry)
+{
+    Q_ASSERT(m_offset < m_top);
+
+    const char *input = this->input();
+
+    ShaperStat &shaperStat = logEntry->shaperStat();
+
+    quint64 bytes[3];
+    quint32 packets[2];
+    DriverCommon::logShaperStatRead(
+            input, &shaperStat.queueIndex, &shaperStat.sojournMaxMsecs, bytes, packets);
+
+    shaperStat.queuedBytes = bytes[0];
+    shaperStat.passedBytes = bytes[1];
+    shaperStat.droppedBytes = bytes[2];
+    shaperStat.passedPackets = packets[0];
+    shaperStat.droppedPackets = packets[1];
+
+    const int entrySize = int(DriverCommon::logShaperStatSize());
+    m_offset += entrySize;
+}
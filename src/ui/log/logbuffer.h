@@ -8,7 +8,12 @@
 
 class LogEntryBlocked;
 class LogEntryBlockedIp;
+class LogEntryDropped;
+class LogEntryFlowStat;
+class LogEntryPathDef;
 class LogEntryProcNew;
+class LogEntryQuota;
+class LogEntryShaperStat;
 class LogEntryStatTraf;
 class LogEntryTime;
 
@@ -24,6 +29,11 @@ public:
 
     QByteArray &array() { return m_array; }
 
+    // The raw data is read in place, e.g. from the driver's log ring
+    bool isRawData() const { return m_rawData != nullptr; }
+    const char *data() const { return m_rawData ? m_rawData : m_array.constData(); }
+    void setRawData(const char *data, int size);
+
     FortLogType peekEntryType();
 
     void writeEntryBlocked(const LogEntryBlocked *logEntry);
@@ -31,15 +41,26 @@ public:
 
     void writeEntryBlockedIp(const LogEntryBlockedIp *logEntry);
     void readEntryBlockedIp(LogEntryBlockedIp *logEntry);
+    void readEntryBlockedIpRepeat(LogEntryBlockedIp *logEntry);
 
     void writeEntryProcNew(const LogEntryProcNew *logEntry);
     void readEntryProcNew(LogEntryProcNew *logEntry);
 
+    void readEntryPathDef(LogEntryPathDef *logEntry);
+
     void readEntryStatTraf(LogEntryStatTraf *logEntry);
 
+    void readEntryFlowStat(LogEntryFlowStat *logEntry);
+
     void writeEntryTime(const LogEntryTime *logEntry);
     void readEntryTime(LogEntryTime *logEntry);
 
+    void readEntryDropped(LogEntryDropped *logEntry);
+
+    void readEntryQuota(LogEntryQuota *logEntry);
+
+    void readEntryShaperStat(LogEntryShaperStat *logEntry);
+
 public slots:
     void reset(int top = 0);
 
@@ -53,6 +74,8 @@ private:
     int m_top = 0;
     int m_offset = 0;
 
+    const char *m_rawData = nullptr;
+
     QByteArray m_array;
 };
 
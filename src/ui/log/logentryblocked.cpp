@@ -26,7 +26,17 @@ void LogEntryBlocked::setKernelPath(const QString &kernelPath)
     m_kernelPath = kernelPath;
 }
 
+void LogEntryBlocked::setPathId(quint32 pathId)
+{
+    m_pathId = pathId;
+}
+
 QString LogEntryBlocked::path() const
 {
-    return getAppPath(m_kernelPath, m_pid);
+    return !m_path.isEmpty() ? m_path : getAppPath(m_kernelPath, m_pid);
+}
+
+void LogEntryBlocked::setPath(const QString &path)
+{
+    m_path = path;
 }
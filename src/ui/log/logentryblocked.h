@@ -19,12 +19,19 @@ public:
     QString kernelPath() const { return m_kernelPath; }
     void setKernelPath(const QString &kernelPath);
 
+    // The interned path is resolved by its id
+    quint32 pathId() const { return m_pathId; }
+    void setPathId(quint32 pathId);
+
     QString path() const;
+    void setPath(const QString &path);
 
 private:
     bool m_blocked : 1 = true;
     quint32 m_pid = 0;
+    quint32 m_pathId = 0;
     QString m_kernelPath;
+    QString m_path;
 };
 
 #endif // LOGENTRYBLOCKED_H
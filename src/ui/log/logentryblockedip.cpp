@@ -24,6 +24,11 @@ void LogEntryBlockedIp::setBlockReason(quint8 blockReason)
     m_blockReason = blockReason;
 }
 
+void LogEntryBlockedIp::setSampleRate(quint8 v)
+{
+    m_sampleRate = v;
+}
+
 void LogEntryBlockedIp::setIpProto(quint8 proto)
 {
     m_ipProto = proto;
@@ -44,6 +49,16 @@ void LogEntryBlockedIp::setConnTime(qint64 connTime)
     m_connTime = connTime;
 }
 
+void LogEntryBlockedIp::setRepeatCount(quint32 v)
+{
+    m_repeatCount = v;
+}
+
+void LogEntryBlockedIp::setLastConnTime(qint64 v)
+{
+    m_lastConnTime = v;
+}
+
 void LogEntryBlockedIp::setLocalIp(ip_addr_t &ip)
 {
     m_localIp = ip;
@@ -88,3 +103,8 @@ bool LogEntryBlockedIp::isAskPending() const
 {
     return blockReason() == FORT_BLOCK_REASON_ASK_PENDING;
 }
+
+bool LogEntryBlockedIp::isAllowed() const
+{
+    return blockReason() == FORT_BLOCK_REASON_ALLOWED;
+}
@@ -24,6 +24,10 @@ public:
     quint8 blockReason() const { return m_blockReason; }
     void setBlockReason(quint8 blockReason);
 
+    // The allowed connection is logged as 1 of the rate's count, when greater than 1
+    quint8 sampleRate() const { return m_sampleRate; }
+    void setSampleRate(quint8 v);
+
     quint8 ipProto() const { return m_ipProto; }
     void setIpProto(quint8 proto);
 
@@ -36,6 +40,13 @@ public:
     qint64 connTime() const { return m_connTime; }
     void setConnTime(qint64 connTime);
 
+    // The repeats are coalesced by the driver, after the first logged connection
+    quint32 repeatCount() const { return m_repeatCount; }
+    void setRepeatCount(quint32 v);
+
+    qint64 lastConnTime() const { return m_lastConnTime; }
+    void setLastConnTime(qint64 v);
+
     const ip_addr_t &localIp() const { return m_localIp; }
     ip_addr_t &localIp() { return m_localIp; }
     void setLocalIp(ip_addr_t &ip);
@@ -57,16 +68,20 @@ public:
     void setRemoteIp6(const QByteArray &ip);
 
     bool isAskPending() const;
+    bool isAllowed() const;
 
 private:
     bool m_isIPv6 : 1 = false;
     bool m_inbound : 1 = false;
     bool m_inherited : 1 = false;
     quint8 m_blockReason = 0;
+    quint8 m_sampleRate = 0;
     quint8 m_ipProto = 0;
     quint16 m_localPort = 0;
     quint16 m_remotePort = 0;
+    quint32 m_repeatCount = 0;
     qint64 m_connTime = 0;
+    qint64 m_lastConnTime = 0;
     ip_addr_t m_localIp;
     ip_addr_t m_remoteIp;
 };
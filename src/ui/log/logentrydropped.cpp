@@ -0,0 +1,12 @@
+#include "logentrydropped.h"
+
+quint32 LogEntryDropped::dropsCount() const
+{
+    quint32 count = 0;
+
+    for (const quint32 drops : m_drops) {
+        count += drops;
+    }
+
+    return count;
+}
@@ -0,0 +1,26 @@
+#ifndef LOGENTRYDROPPED_H
+#define LOGENTRYDROPPED_H
+
+#include <QVector>
+
+#include "logentry.h"
+
+// The driver drops the records, when the service doesn't read them in time
+class LogEntryDropped : public LogEntry
+{
+public:
+    explicit LogEntryDropped() = default;
+
+    FortLogType type() const override { return FORT_LOG_TYPE_DROPPED; }
+
+    // Dropped records, indexed by the log type
+    const QVector<quint32> &drops() const { return m_drops; }
+    QVector<quint32> &drops() { return m_drops; }
+
+    quint32 dropsCount() const;
+
+private:
+    QVector<quint32> m_drops;
+};
+
+#endif // LOGENTRYDROPPED_H
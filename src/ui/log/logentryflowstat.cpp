@@ -0,0 +1,41 @@
+#include "logentryflowstat.h"
+
+#include <driver/drivercommon.h>
+
+LogEntryFlowStat::LogEntryFlowStat(quint16 flowCount, const char *flowData) :
+    m_flowCount(flowCount), m_flowData(flowData)
+{
+}
+
+void LogEntryFlowStat::setFlowCount(quint16 flowCount)
+{
+    m_flowCount = flowCount;
+}
+
+void LogEntryFlowStat::setFlowData(const char *flowData)
+{
+    m_flowData = flowData;
+}
+
+FlowTraf LogEntryFlowStat::flowTraf(int index) const
+{
+    Q_ASSERT(index < m_flowCount);
+
+    const char *input = m_flowData + index * DriverCommon::logFlowStatEntrySize();
+
+    FlowTraf flowTraf;
+
+    int isIPv6, inbound;
+    quint64 traf[4];
+    DriverCommon::logFlowStatRead(input, &isIPv6, &inbound, &flowTraf.ipProto,
+            &flowTraf.localPort, &flowTraf.remotePort, &flowTraf.remoteIp, &flowTraf.pid, traf);
+
+    flowTraf.isIPv6 = (isIPv6 != 0);
+    flowTraf.inbound = (inbound != 0);
+    flowTraf.inBytes = traf[0];
+    flowTraf.outBytes = traf[1];
+    flowTraf.inPackets = traf[2];
+    flowTraf.outPackets = traf[3];
+
+    return flowTraf;
+}
@@ -0,0 +1,44 @@
+#ifndef LOGENTRYFLOWSTAT_H
+#define LOGENTRYFLOWSTAT_H
+
+#include <common/common_types.h>
+
+#include "logentry.h"
+
+struct FlowTraf
+{
+    bool isIPv6 : 1 = false;
+    bool inbound : 1 = false;
+    quint8 ipProto = 0;
+    quint16 localPort = 0;
+    quint16 remotePort = 0;
+    quint32 pid = 0;
+    ip_addr_t remoteIp {};
+
+    quint64 inBytes = 0;
+    quint64 outBytes = 0;
+    quint64 inPackets = 0;
+    quint64 outPackets = 0;
+};
+
+class LogEntryFlowStat : public LogEntry
+{
+public:
+    explicit LogEntryFlowStat(quint16 flowCount = 0, const char *flowData = nullptr);
+
+    FortLogType type() const override { return FORT_LOG_TYPE_FLOW_STAT; }
+
+    quint16 flowCount() const { return m_flowCount; }
+    void setFlowCount(quint16 flowCount);
+
+    const char *flowData() const { return m_flowData; }
+    void setFlowData(const char *flowData);
+
+    FlowTraf flowTraf(int index) const;
+
+private:
+    quint16 m_flowCount = 0;
+    const char *m_flowData = nullptr;
+};
+
+#endif // LOGENTRYFLOWSTAT_H
@@ -0,0 +1,23 @@
+#include "logentrypathdef.h"
+
+#include <util/fileutil.h>
+
+LogEntryPathDef::LogEntryPathDef(quint32 pathId, const QString &kernelPath) :
+    m_pathId(pathId), m_kernelPath(kernelPath)
+{
+}
+
+void LogEntryPathDef::setPathId(quint32 pathId)
+{
+    m_pathId = pathId;
+}
+
+void LogEntryPathDef::setKernelPath(const QString &kernelPath)
+{
+    m_kernelPath = kernelPath;
+}
+
+QString LogEntryPathDef::path() const
+{
+    return FileUtil::kernelPathToPath(m_kernelPath);
+}
@@ -0,0 +1,27 @@
+#ifndef LOGENTRYPATHDEF_H
+#define LOGENTRYPATHDEF_H
+
+#include "logentry.h"
+
+// The driver interns the logged paths: later records carry the path id only
+class LogEntryPathDef : public LogEntry
+{
+public:
+    explicit LogEntryPathDef(quint32 pathId = 0, const QString &kernelPath = QString());
+
+    FortLogType type() const override { return FORT_LOG_TYPE_PATH_DEF; }
+
+    quint32 pathId() const { return m_pathId; }
+    void setPathId(quint32 pathId);
+
+    QString kernelPath() const { return m_kernelPath; }
+    void setKernelPath(const QString &kernelPath);
+
+    QString path() const;
+
+private:
+    quint32 m_pathId = 0;
+    QString m_kernelPath;
+};
+
+#endif // LOGENTRYPATHDEF_H
@@ -10,12 +10,32 @@ void LogEntryProcNew::setPid(quint32 pid)
     m_pid = pid;
 }
 
+void LogEntryProcNew::setSessionId(quint32 sessionId)
+{
+    m_sessionId = sessionId;
+}
+
+void LogEntryProcNew::setConfAppId(quint32 confAppId)
+{
+    m_confAppId = confAppId;
+}
+
 void LogEntryProcNew::setKernelPath(const QString &kernelPath)
 {
     m_kernelPath = kernelPath;
 }
 
+void LogEntryProcNew::setPathId(quint32 pathId)
+{
+    m_pathId = pathId;
+}
+
 QString LogEntryProcNew::path() const
 {
-    return getAppPath(m_kernelPath, m_pid);
+    return !m_path.isEmpty() ? m_path : getAppPath(m_kernelPath, m_pid);
+}
+
+void LogEntryProcNew::setPath(const QString &path)
+{
+    m_path = path;
 }
@@ -13,14 +13,31 @@ public:
     quint32 pid() const { return m_pid; }
     void setPid(quint32 pid);
 
+    // The logon session of the process's token
+    quint32 sessionId() const { return m_sessionId; }
+    void setSessionId(quint32 sessionId);
+
+    // The conf's exe app, matched by the driver; 0 for the others
+    quint32 confAppId() const { return m_confAppId; }
+    void setConfAppId(quint32 confAppId);
+
     QString kernelPath() const { return m_kernelPath; }
     void setKernelPath(const QString &kernelPath);
 
+    // The interned path is resolved by its id
+    quint32 pathId() const { return m_pathId; }
+    void setPathId(quint32 pathId);
+
     QString path() const;
+    void setPath(const QString &path);
 
 private:
     quint32 m_pid = 0;
+    quint32 m_sessionId = FORT_LOG_SESSION_UNKNOWN;
+    quint32 m_confAppId = 0;
+    quint32 m_pathId = 0;
     QString m_kernelPath;
+    QString m_path;
 };
 
 #endif // LOGENTRYPROCNEW_H
@@ -0,0 +1,8 @@
+#include "logentryquota.h"
+
+LogEntryQuota::LogEntryQuota(quint8 quotaBits) : m_quotaBits(quotaBits) { }
+
+void LogEntryQuota::setQuotaBits(quint8 quotaBits)
+{
+    m_quotaBits = quotaBits;
+}
@@ -0,0 +1,22 @@
+#ifndef LOGENTRYQUOTA_H
+#define LOGENTRYQUOTA_H
+
+#include "logentry.h"
+
+// The driver counts the quotas' traffic and reports their exceeding
+class LogEntryQuota : public LogEntry
+{
+public:
+    explicit LogEntryQuota(quint8 quotaBits = 0);
+
+    FortLogType type() const override { return FORT_LOG_TYPE_QUOTA; }
+
+    // Bits of the exceeded quotas: QuotaManager::AlertType
+    quint8 quotaBits() const { return m_quotaBits; }
+    void setQuotaBits(quint8 quotaBits);
+
+private:
+    quint8 m_quotaBits = 0;
+};
+
+#endif // LOGENTRYQUOTA_H
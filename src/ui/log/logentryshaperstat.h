@@ -0,0 +1,36 @@
+#ifndef LOGENTRYSHAPERSTAT_H
+#define LOGENTRYSHAPERSTAT_H
+
+#include "logentry.h"
+
+struct ShaperStat
+{
+    int groupIndex() const { return queueIndex / 2; }
+    bool inbound() const { return (queueIndex & 1) == 0; }
+
+    quint8 queueIndex = 0; // group index * 2 + (inbound ? 0 : 1)
+    quint32 sojournMaxMsecs = 0; // in the bandwidth queue
+
+    quint64 queuedBytes = 0;
+    quint64 passedBytes = 0;
+    quint64 droppedBytes = 0;
+    quint32 passedPackets = 0;
+    quint32 droppedPackets = 0;
+};
+
+// The driver reports the shaper's queues, active since the last flush
+class LogEntryShaperStat : public LogEntry
+{
+public:
+    explicit LogEntryShaperStat() = default;
+
+    FortLogType type() const override { return FORT_LOG_TYPE_SHAPER_STAT; }
+
+    const ShaperStat &shaperStat() const { return m_shaperStat; }
+    ShaperStat &shaperStat() { return m_shaperStat; }
+
+private:
+    ShaperStat m_shaperStat;
+};
+
+#endif // LOGENTRYSHAPERSTAT_H
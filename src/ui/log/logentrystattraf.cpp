@@ -1,7 +1,9 @@
 #include "logentrystattraf.h"
 
-LogEntryStatTraf::LogEntryStatTraf(quint16 procCount, const quint32 *procTrafBytes) :
-    m_procCount(procCount), m_procTrafBytes(procTrafBytes)
+#include <QtEndian>
+
+LogEntryStatTraf::LogEntryStatTraf(quint16 procCount, const quint32 *procTrafBytes, bool compact) :
+    m_compact(compact), m_procCount(procCount), m_procTrafBytes(procTrafBytes)
 {
 }
 
@@ -10,7 +12,56 @@ void LogEntryStatTraf::setProcCount(quint16 procCount)
     m_procCount = procCount;
 }
 
+void LogEntryStatTraf::setCompact(bool compact)
+{
+    m_compact = compact;
+}
+
+void LogEntryStatTraf::setConns(bool conns)
+{
+    m_conns = conns;
+}
+
 void LogEntryStatTraf::setProcTrafBytes(const quint32 *procTrafBytes)
 {
     m_procTrafBytes = procTrafBytes;
 }
+
+void LogEntryStatTraf::procTraf(
+        int index, quint32 &pidFlag, quint64 &inBytes, quint64 &outBytes) const
+{
+    Q_ASSERT(index < m_procCount);
+
+    const quint32 *procTrafBytes = m_procTrafBytes + index * procSize();
+
+    if (m_compact) {
+        pidFlag = procTrafBytes[0];
+        inBytes = procTrafBytes[1];
+        outBytes = procTrafBytes[2];
+    } else {
+        pidFlag = procTrafBytes[0];
+        inBytes = qFromUnaligned<quint64>(procTrafBytes + 1);
+        outBytes = qFromUnaligned<quint64>(procTrafBytes + 3);
+    }
+}
+
+void LogEntryStatTraf::procConns(int index, quint16 &connCount, quint16 &blockedCount) const
+{
+    Q_ASSERT(index < m_procCount);
+
+    if (!m_conns) {
+        connCount = blockedCount = 0;
+        return;
+    }
+
+    const int procSize = this->procSize();
+    const quint32 conns = m_procTrafBytes[index * procSize + procSize - 1];
+
+    connCount = quint16(conns);
+    blockedCount = quint16(conns >> 16);
+}
+
+int LogEntryStatTraf::procSize() const
+{
+    return (m_compact ? 3 : 5) + (m_conns ? 1 : 0);
+}
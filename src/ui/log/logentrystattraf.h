@@ -6,17 +6,35 @@
 class LogEntryStatTraf : public LogEntry
 {
 public:
-    explicit LogEntryStatTraf(quint16 procCount = 0, const quint32 *procTrafBytes = nullptr);
+    explicit LogEntryStatTraf(
+            quint16 procCount = 0, const quint32 *procTrafBytes = nullptr, bool compact = false);
 
     FortLogType type() const override { return FORT_LOG_TYPE_STAT_TRAF; }
 
     quint16 procCount() const { return m_procCount; }
     void setProcCount(quint16 procCount);
 
+    // 32-bit traffic counters
+    bool compact() const { return m_compact; }
+    void setCompact(bool compact);
+
+    // Connections counters of the processes
+    bool conns() const { return m_conns; }
+    void setConns(bool conns);
+
     const quint32 *procTrafBytes() const { return m_procTrafBytes; }
     void setProcTrafBytes(const quint32 *procTrafBytes);
 
+    void procTraf(int index, quint32 &pidFlag, quint64 &inBytes, quint64 &outBytes) const;
+
+    void procConns(int index, quint16 &connCount, quint16 &blockedCount) const;
+
+private:
+    int procSize() const;
+
 private:
+    bool m_compact = false;
+    bool m_conns = false;
     quint16 m_procCount = 0;
     const quint32 *m_procTrafBytes = nullptr;
 };
@@ -7,25 +7,47 @@
 #include <driver/drivercommon.h>
 #include <driver/drivermanager.h>
 #include <driver/driverworker.h>
+#include <manager/drivelistmanager.h>
 #include <stat/askpendingmanager.h>
+#include <stat/quotamanager.h>
 #include <stat/statblockmanager.h>
 #include <stat/statmanager.h>
 #include <util/dateutil.h>
+#include <util/etwutil.h>
+#include <util/fileutil.h>
 #include <util/ioc/ioccontainer.h>
 #include <util/osutil.h>
 
 #include "logbuffer.h"
 #include "logentryblocked.h"
 #include "logentryblockedip.h"
+#include "logentrydropped.h"
+#include "logentryflowstat.h"
+#include "logentrypathdef.h"
 #include "logentryprocnew.h"
+#include "logentryquota.h"
+#include "logentryshaperstat.h"
 #include "logentrystattraf.h"
 #include "logentrytime.h"
 
 namespace {
 const QLoggingCategory LC("log");
+
+constexpr int LOG_BUFFER_SIZE_MAX = 4 * 1024 * 1024;
+
+constexpr int LOG_PENDING_BUFFERS_MAX = 8; // then the driver drops the records
+constexpr int LOG_SLICE_MSECS = 20;
+constexpr int LOG_SLICE_CHECK_ENTRIES = 64;
+
+constexpr int LOG_PATH_CACHE_MAX = 1024;
 }
 
-LogManager::LogManager(QObject *parent) : QObject(parent) { }
+LogManager::LogManager(QObject *parent) :
+    QObject(parent),
+    m_bufferSize(DriverCommon::bufferSize()),
+    m_pathCache(LOG_PATH_CACHE_MAX)
+{
+}
 
 void LogManager::setActive(bool active)
 {
@@ -42,6 +64,19 @@ void LogManager::setActive(bool active)
     }
 }
 
+void LogManager::setBufferSize(int size)
+{
+    size = qBound(DriverCommon::bufferSize(), size, LOG_BUFFER_SIZE_MAX);
+
+    if (m_bufferSize == size)
+        return;
+
+    m_bufferSize = size;
+
+    qDeleteAll(m_freeBuffers);
+    m_freeBuffers.clear();
+}
+
 void LogManager::setErrorMessage(const QString &errorMessage)
 {
     if (m_errorMessage != errorMessage) {
@@ -60,12 +95,68 @@ void LogManager::setCurrentUnixTime(qint64 unixTime)
     m_currentUnixTime = unixTime;
 }
 
+QString LogManager::resolveKernelPath(const QString &kernelPath, quint32 pid)
+{
+    if (kernelPath.isEmpty())
+        return OsUtil::pidToPath(pid);
+
+    const QString *cachedPath = m_pathCache.object(kernelPath);
+    if (cachedPath)
+        return *cachedPath;
+
+    const QString path = FileUtil::kernelPathToPath(kernelPath);
+
+    m_pathCache.insert(kernelPath, new QString(path));
+
+    return path;
+}
+
+void LogManager::resolvePath(LogEntryBlocked &entry)
+{
+    // Convert the record's own path once for all consumers
+    const QString kernelPath =
+            entry.pathId() != 0 ? m_paths.value(entry.pathId()) : entry.kernelPath();
+
+    entry.setPath(resolveKernelPath(kernelPath, entry.pid()));
+}
+
+void LogManager::resolvePath(LogEntryProcNew &entry)
+{
+    // The conf's apps are resolved once by their ids
+    auto confAppManager = IoC<ConfAppManager>();
+
+    const quint32 confAppId = entry.confAppId();
+    if (confAppId != 0) {
+        const QString path = confAppManager->confAppPath(confAppId);
+        if (!path.isEmpty()) {
+            entry.setPath(path);
+            return;
+        }
+    }
+
+    // The driver omits the paths of the reported conf's apps: resolved by the pids on misses
+    const QString kernelPath =
+            entry.pathId() != 0 ? m_paths.value(entry.pathId()) : entry.kernelPath();
+
+    const QString path = resolveKernelPath(kernelPath, entry.pid());
+
+    entry.setPath(path);
+
+    if (confAppId != 0) {
+        confAppManager->setConfAppPath(confAppId, path);
+    }
+}
+
 void LogManager::setUp()
 {
     const auto driverManager = IoC()->setUpDependency<DriverManager>();
 
     connect(driverManager->driverWorker(), &DriverWorker::readLogResult, this,
             &LogManager::processLogBuffer, Qt::QueuedConnection);
+
+    // The drive letters of the cached paths may be remapped
+    connect(IoC<DriveListManager>(), &DriveListManager::driveMaskChanged, this,
+            [&] { m_pathCache.clear(); });
 }
 
 void LogManager::tearDown()
@@ -96,45 +187,119 @@ void LogManager::cancelAsyncIo()
 LogBuffer *LogManager::getFreeBuffer()
 {
     if (m_freeBuffers.isEmpty())
-        return new LogBuffer(DriverCommon::bufferSize(), this);
+        return new LogBuffer(m_bufferSize, this);
 
     return m_freeBuffers.takeLast();
 }
 
 void LogManager::addFreeBuffer(LogBuffer *logBuffer)
 {
+    // The buffer of the previous size was in flight
+    if (logBuffer->array().size() != m_bufferSize) {
+        logBuffer->deleteLater();
+        return;
+    }
+
     m_freeBuffers.append(logBuffer);
 }
 
 void LogManager::processLogBuffer(LogBuffer *logBuffer, bool success, quint32 errorCode)
 {
-    if (m_active && (success || errorCode == 0)) {
-        readLogAsync();
+    if (!success) {
+        if (errorCode != 0) {
+            const auto errorMessage = OsUtil::errorMessage(errorCode);
+            setErrorMessage(errorMessage);
+        } else if (m_active) {
+            readLogAsync();
+        }
+
+        finishLogBuffer(logBuffer);
+        return;
+    }
+
+    m_pendingBuffers.enqueue(logBuffer);
+
+    // Read the next buffer, while this one is processed
+    if (m_pendingBuffers.size() < LOG_PENDING_BUFFERS_MAX) {
+        if (m_active) {
+            readLogAsync();
+        }
+    } else {
+        m_readDeferred = true;
+    }
+
+    if (!m_processQueued) {
+        processPendingBuffers();
+    }
+}
+
+void LogManager::processPendingBuffers()
+{
+    m_processQueued = false;
+
+    QElapsedTimer sliceTimer;
+    sliceTimer.start();
+
+    while (!m_pendingBuffers.isEmpty()) {
+        LogBuffer *logBuffer = m_pendingBuffers.head();
+
+        if (logBuffer->offset() == 0) {
+            EtwUtil::logBufferStart(logBuffer->top(), logBuffer->isRawData());
+        }
+
+        if (!processLogEntries(logBuffer, sliceTimer)) {
+            // Continue after the queued events, e.g. RPC calls
+            m_processQueued = true;
+            QMetaObject::invokeMethod(
+                    this, &LogManager::processPendingBuffers, Qt::QueuedConnection);
+            return;
+        }
+
+        EtwUtil::logBufferStop(logBuffer->offset());
+
+        m_pendingBuffers.dequeue();
+
+        finishLogBuffer(logBuffer);
     }
 
-    if (success) {
-        processLogEntries(logBuffer);
-    } else if (errorCode != 0) {
-        const auto errorMessage = OsUtil::errorMessage(errorCode);
-        setErrorMessage(errorMessage);
+    if (m_readDeferred) {
+        m_readDeferred = false;
+
+        if (m_active) {
+            readLogAsync();
+        }
+    }
+}
+
+void LogManager::finishLogBuffer(LogBuffer *logBuffer)
+{
+    // The parsed data is released to the driver's log ring
+    if (logBuffer->isRawData()) {
+        IoC<DriverManager>()->driverWorker()->releaseLogRing(logBuffer->top());
     }
 
     logBuffer->reset();
     addFreeBuffer(logBuffer);
 }
 
-void LogManager::processLogEntries(LogBuffer *logBuffer)
+bool LogManager::processLogEntries(LogBuffer *logBuffer, const QElapsedTimer &sliceTimer)
 {
     // XXX: OsUtil::setThreadIsBusy(true);
 
-    for (;;) {
+    for (int count = 1;; ++count) {
         const FortLogType logType = logBuffer->peekEntryType();
 
         if (!processLogEntry(logBuffer, logType))
             break;
+
+        if ((count % LOG_SLICE_CHECK_ENTRIES) == 0 && sliceTimer.hasExpired(LOG_SLICE_MSECS)
+                && logBuffer->offset() < logBuffer->top())
+            return false;
     }
 
     // XXX: OsUtil::setThreadIsBusy(false);
+
+    return true;
 }
 
 bool LogManager::processLogEntry(LogBuffer *logBuffer, FortLogType logType)
@@ -145,12 +310,28 @@ bool LogManager::processLogEntry(LogBuffer *logBuffer, FortLogType logType)
         return processLogEntryBlocked(logBuffer);
     case FORT_LOG_TYPE_BLOCKED_IP:
         return processLogEntryBlockedIp(logBuffer);
+    case FORT_LOG_TYPE_BLOCKED_IP_REPEAT:
+        return processLogEntryBlockedIpRepeat(logBuffer);
     case FORT_LOG_TYPE_PROC_NEW:
         return processLogEntryProcNew(logBuffer);
+    case FORT_LOG_TYPE_PATH_DEF:
+        return processLogEntryPathDef(logBuffer);
     case FORT_LOG_TYPE_STAT_TRAF:
         return processLogEntryStatTraf(logBuffer);
+    case FORT_LOG_TYPE_FLOW_STAT:
+        return processLogEntryFlowStat(logBuffer);
     case FORT_LOG_TYPE_TIME:
         return processLogEntryTime(logBuffer);
+    case FORT_LOG_TYPE_DROPPED:
+        return processLogEntryDropped(logBuffer);
+    case FORT_LOG_TYPE_QUOTA:
+        return processLogEntryQuota(logBuffer);
+    case FORT_LOG_TYPE_SHAPER_STAT:
+        return processLogEntryShaperStat(logBuffer);
+    case FORT_LOG_TYPE_NONE:
+        if (logBuffer->isRawData())
+            return false; // the log ring's wrap
+        Q_FALLTHROUGH();
     default:
         return processLogEntryError(logBuffer, logType);
     }
@@ -161,6 +342,8 @@ bool LogManager::processLogEntryBlocked(LogBuffer *logBuffer)
     LogEntryBlocked blockedEntry;
     logBuffer->readEntryBlocked(&blockedEntry);
 
+    resolvePath(blockedEntry);
+
     IoC<ConfAppManager>()->logBlockedApp(blockedEntry);
 
     return true;
@@ -171,6 +354,13 @@ bool LogManager::processLogEntryBlockedIp(LogBuffer *logBuffer)
     LogEntryBlockedIp blockedIpEntry;
     logBuffer->readEntryBlockedIp(&blockedIpEntry);
 
+    // The rate limit drops the inbound connections before their apps are known
+    if (blockedIpEntry.blockReason() == FORT_BLOCK_REASON_ACCEPT_RATE) {
+        blockedIpEntry.setPath(FileUtil::systemApp());
+    } else {
+        resolvePath(blockedIpEntry);
+    }
+
     blockedIpEntry.setConnTime(currentUnixTime());
 
     if (blockedIpEntry.isAskPending()) {
@@ -182,16 +372,42 @@ bool LogManager::processLogEntryBlockedIp(LogBuffer *logBuffer)
     return true;
 }
 
+bool LogManager::processLogEntryBlockedIpRepeat(LogBuffer *logBuffer)
+{
+    LogEntryBlockedIp blockedIpEntry;
+    logBuffer->readEntryBlockedIpRepeat(&blockedIpEntry);
+
+    // The pending connection is asked by its first record
+    if (!blockedIpEntry.isAskPending()) {
+        IoC<StatBlockManager>()->logBlockedIp(blockedIpEntry);
+    }
+
+    return true;
+}
+
 bool LogManager::processLogEntryProcNew(LogBuffer *logBuffer)
 {
     LogEntryProcNew procNewEntry;
     logBuffer->readEntryProcNew(&procNewEntry);
 
+    resolvePath(procNewEntry);
+
     IoC<StatManager>()->logProcNew(procNewEntry, currentUnixTime());
 
     return true;
 }
 
+bool LogManager::processLogEntryPathDef(LogBuffer *logBuffer)
+{
+    LogEntryPathDef pathDefEntry;
+    logBuffer->readEntryPathDef(&pathDefEntry);
+
+    // The driver redefines the id of an evicted path, before its next use
+    m_paths.insert(pathDefEntry.pathId(), pathDefEntry.kernelPath());
+
+    return true;
+}
+
 bool LogManager::processLogEntryStatTraf(LogBuffer *logBuffer)
 {
     LogEntryStatTraf statTrafEntry;
@@ -202,6 +418,16 @@ bool LogManager::processLogEntryStatTraf(LogBuffer *logBuffer)
     return true;
 }
 
+bool LogManager::processLogEntryFlowStat(LogBuffer *logBuffer)
+{
+    LogEntryFlowStat flowStatEntry;
+    logBuffer->readEntryFlowStat(&flowStatEntry);
+
+    IoC<StatManager>()->logFlowStat(flowStatEntry);
+
+    return true;
+}
+
 bool LogManager::processLogEntryTime(LogBuffer *logBuffer)
 {
     LogEntryTime timeEntry;
@@ -216,12 +442,44 @@ bool LogManager::processLogEntryTime(LogBuffer *logBuffer)
     return true;
 }
 
+bool LogManager::processLogEntryDropped(LogBuffer *logBuffer)
+{
+    LogEntryDropped droppedEntry;
+    logBuffer->readEntryDropped(&droppedEntry);
+
+    // The counters are indexed by the log type
+    qCWarning(LC) << "Log entries dropped:" << droppedEntry.dropsCount() << droppedEntry.drops();
+
+    setErrorMessage(tr("Log entries dropped: %1").arg(droppedEntry.dropsCount()));
+
+    return true;
+}
+
+bool LogManager::processLogEntryQuota(LogBuffer *logBuffer)
+{
+    LogEntryQuota quotaEntry;
+    logBuffer->readEntryQuota(&quotaEntry);
+
+    IoC<QuotaManager>()->logQuota(quotaEntry, currentUnixTime());
+
+    return true;
+}
+
+bool LogManager::processLogEntryShaperStat(LogBuffer *logBuffer)
+{
+    LogEntryShaperStat shaperStatEntry;
+    logBuffer->readEntryShaperStat(&shaperStatEntry);
+
+    IoC<StatManager>()->logShaperStat(shaperStatEntry);
+
+    return true;
+}
+
 bool LogManager::processLogEntryError(LogBuffer *logBuffer, FortLogType logType)
 {
     if (logBuffer->offset() < logBuffer->top()) {
-        const auto data =
-                QByteArray::fromRawData(logBuffer->array().constData() + logBuffer->offset(),
-                        logBuffer->top() - logBuffer->offset());
+        const auto data = QByteArray::fromRawData(
+                logBuffer->data() + logBuffer->offset(), logBuffer->top() - logBuffer->offset());
 
         qCCritical(LC) << "Unknown Log entry:" << logType << logBuffer->offset() << logBuffer->top()
                        << data;
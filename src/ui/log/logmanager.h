@@ -1,13 +1,19 @@
 #ifndef LOGMANAGER_H
 #define LOGMANAGER_H
 
+#include <QCache>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QObject>
+#include <QQueue>
 
 #include <common/fortdef.h>
 #include <util/ioc/iocservice.h>
 
 class LogBuffer;
 class LogEntry;
+class LogEntryBlocked;
+class LogEntryProcNew;
 
 class LogManager : public QObject, public IocService
 {
@@ -18,6 +24,9 @@ public:
 
     virtual void setActive(bool active);
 
+    int bufferSize() const { return m_bufferSize; }
+    void setBufferSize(int size);
+
     QString errorMessage() const { return m_errorMessage; }
 
     void setUp() override;
@@ -37,29 +46,57 @@ private:
     qint64 currentUnixTime() const;
     void setCurrentUnixTime(qint64 unixTime);
 
+    QString resolveKernelPath(const QString &kernelPath, quint32 pid);
+    void resolvePath(LogEntryBlocked &entry);
+    void resolvePath(LogEntryProcNew &entry);
+
     void readLogAsync();
     void cancelAsyncIo();
 
     LogBuffer *getFreeBuffer();
     void addFreeBuffer(LogBuffer *logBuffer);
 
-    void processLogEntries(LogBuffer *logBuffer);
+    void processPendingBuffers();
+    void finishLogBuffer(LogBuffer *logBuffer);
+
+    // Returns false, when the time slice is over before the buffer's end
+    bool processLogEntries(LogBuffer *logBuffer, const QElapsedTimer &sliceTimer);
     bool processLogEntry(LogBuffer *logBuffer, FortLogType logType);
     bool processLogEntryBlocked(LogBuffer *logBuffer);
     bool processLogEntryBlockedIp(LogBuffer *logBuffer);
+    bool processLogEntryBlockedIpRepeat(LogBuffer *logBuffer);
     bool processLogEntryProcNew(LogBuffer *logBuffer);
+    bool processLogEntryPathDef(LogBuffer *logBuffer);
     bool processLogEntryStatTraf(LogBuffer *logBuffer);
+    bool processLogEntryFlowStat(LogBuffer *logBuffer);
     bool processLogEntryTime(LogBuffer *logBuffer);
+    bool processLogEntryDropped(LogBuffer *logBuffer);
+    bool processLogEntryQuota(LogBuffer *logBuffer);
+    bool processLogEntryShaperStat(LogBuffer *logBuffer);
     bool processLogEntryError(LogBuffer *logBuffer, FortLogType logType);
 
 private:
     bool m_active = false;
 
+    int m_bufferSize = 0;
+
+    bool m_readDeferred = false; // till the pending buffers are processed
+    bool m_processQueued = false;
+
     QList<LogBuffer *> m_freeBuffers;
 
+    // The read buffers are processed by time slices, to keep the event loop responsive
+    QQueue<LogBuffer *> m_pendingBuffers;
+
     QString m_errorMessage;
 
     qint64 m_currentUnixTime = 0;
+
+    // The driver's interned paths: id -> kernel path
+    QHash<quint32, QString> m_paths;
+
+    // Least recently used conversions: kernel path -> Win32 path
+    QCache<QString, QString> m_pathCache;
 };
 
 #endif // LOGMANAGER_H
@@ -14,6 +14,8 @@ DriveListManager::DriveListManager(QObject *parent) : QObject(parent) { }
 void DriveListManager::initialize()
 {
     m_driveMask = FileUtil::driveMask();
+
+    updateDriveKernelNames();
 }
 
 void DriveListManager::onDriveListChanged()
@@ -27,10 +29,12 @@ void DriveListManager::onDriveListChanged()
         return;
 
     const quint32 addedMask = (driveMask & (driveMask ^ m_driveMask));
-    const quint32 removedMask = (m_driveMask ^ (m_driveMask & m_driveMask));
+    const quint32 removedMask = (m_driveMask & ~driveMask);
 
     m_driveMask = driveMask;
 
+    updateDriveKernelNames();
+
     if (addedMask != 0 || removedMask != 0) {
         emit driveMaskChanged(addedMask, removedMask);
     }
@@ -58,3 +62,9 @@ void DriveListManager::setupPollingTimer()
 
     connect(m_pollingTimer, &QTimer::timeout, this, &DriveListManager::onDriveListChanged);
 }
+
+void DriveListManager::updateDriveKernelNames()
+{
+    // The apps' and logs' paths are converted by the cached DOS device names
+    FileUtil::setDriveKernelNames(FileUtil::driveKernelNames(m_driveMask));
+}
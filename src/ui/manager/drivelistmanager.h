@@ -16,6 +16,8 @@ public:
 
     void initialize();
 
+    quint32 driveMask() const { return m_driveMask; }
+
 signals:
     void driveMaskChanged(quint32 addedMask, quint32 removedMask);
 
@@ -27,6 +29,8 @@ public slots:
 private:
     void setupPollingTimer();
 
+    void updateDriveKernelNames();
+
 private:
     bool m_checkMounted = false;
 
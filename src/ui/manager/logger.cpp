@@ -8,6 +8,8 @@
 #include <util/fileutil.h>
 #include <util/osutil.h>
 
+#include "loggerwriter.h"
+
 namespace {
 
 const QLoggingCategory LC("logger");
@@ -17,6 +19,8 @@ constexpr int LOGGER_KEEP_FILES = 9;
 
 QtMessageHandler g_oldMessageHandler = nullptr;
 
+thread_local bool g_writing = false; // avoid recursive calls
+
 Logger::LogLevel levelByMsgType(QtMsgType type)
 {
     switch (type) {
@@ -51,7 +55,11 @@ void processMessage(QtMsgType type, const QMessageLogContext &context, const QSt
 
     // Write only errors to log file
     if (isLogToFile) {
-        logger->writeLog(dateString, logLine);
+        if (logger->async() && level != Logger::Error) {
+            logger->writeLogAsync(logLine);
+        } else {
+            logger->writeLog(logLine);
+        }
     }
 
     // Additionally write to console if needed
@@ -96,6 +104,27 @@ void Logger::setConsole(bool v)
     }
 }
 
+void Logger::setAsync(bool v)
+{
+    if (m_async == v)
+        return;
+
+    // The writer is kept for the lines, pushed by other threads
+    if (!m_writer) {
+        m_writer = new LoggerWriter(this);
+    }
+
+    m_async = v;
+
+    if (v) {
+        m_writer->start();
+    } else {
+        m_writer->stop();
+
+        flushLog();
+    }
+}
+
 void Logger::setPath(const QString &path)
 {
     m_dir.setPath(path);
@@ -169,43 +198,97 @@ bool Logger::tryOpenLogFile(const QDir &dir, const QString &fileName)
     return m_file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate);
 }
 
+bool Logger::prepareLogFile()
+{
+    // Create file when required to avoid empty files
+    if (m_file.isOpen())
+        return true;
+
+    FileUtil::removeOldFiles(m_dir.path(), fileNamePrefix(), fileNameSuffix(), LOGGER_KEEP_FILES);
+
+    if (!openLogFile())
+        return false;
+
+    // Write file header
+    m_file.write(makeLogLine(Info, getDateString(), getFileTitle()).toUtf8());
+
+    return true;
+}
+
 void Logger::closeLogFile()
 {
     m_file.close();
 }
 
-void Logger::writeLogLine(const QString &logLine)
+void Logger::writeLogData(const QByteArray &data)
 {
-    m_file.write(logLine.toUtf8());
+    if (!prepareLogFile())
+        return;
+
+    m_file.write(data);
     m_file.flush();
+
+    if (m_file.size() > LOGGER_FILE_MAX_SIZE) {
+        closeLogFile(); // Too big file
+    }
 }
 
-void Logger::writeLog(const QString &dateString, const QString &logLine)
+void Logger::writeLogRing()
 {
-    if (m_writing)
-        return; // avoid recursive calls
+    if (!m_writer)
+        return;
 
-    m_writing = true;
+    QByteArray data;
+    QByteArray line;
 
-    // Create file when required to avoid empty files
-    if (!m_file.isOpen()) {
-        FileUtil::removeOldFiles(
-                m_dir.path(), fileNamePrefix(), fileNameSuffix(), LOGGER_KEEP_FILES);
+    while (m_writer->pop(line)) {
+        data += line;
+    }
 
-        if (!openLogFile()) {
-            m_writing = false;
-            return;
-        }
+    const quint32 droppedCount = m_writer->takeDroppedCount();
+    if (droppedCount != 0) {
+        const auto message = QString("logger: Dropped lines: %1").arg(droppedCount);
 
-        // Write file header
-        writeLogLine(makeLogLine(Info, dateString, getFileTitle()));
+        data += makeLogLine(Warning, getDateString(), message).toUtf8();
     }
 
-    writeLogLine(logLine);
+    if (!data.isEmpty()) {
+        writeLogData(data);
+    }
+}
 
-    if (m_file.size() > LOGGER_FILE_MAX_SIZE) {
-        closeLogFile(); // Too big file
+void Logger::writeLog(const QString &logLine)
+{
+    if (g_writing)
+        return;
+
+    g_writing = true;
+    {
+        QMutexLocker locker(&m_fileMutex);
+
+        // Keep the order of the queued lines
+        writeLogRing();
+
+        writeLogData(logLine.toUtf8());
     }
+    g_writing = false;
+}
+
+void Logger::writeLogAsync(const QString &logLine)
+{
+    m_writer->push(logLine.toUtf8());
+}
+
+void Logger::flushLog()
+{
+    if (g_writing)
+        return;
+
+    g_writing = true;
+    {
+        QMutexLocker locker(&m_fileMutex);
 
-    m_writing = false;
+        writeLogRing();
+    }
+    g_writing = false;
 }
@@ -3,6 +3,9 @@
 
 #include <QDir>
 #include <QFile>
+#include <QMutex>
+
+class LoggerWriter;
 
 class Logger : public QObject
 {
@@ -27,6 +30,10 @@ public:
     bool console() const { return m_console; }
     void setConsole(bool v);
 
+    // Write the lines by the writer thread; the errors are still written at once
+    bool async() const { return m_async; }
+    void setAsync(bool v);
+
     void setPath(const QString &path);
 
     QString getFileTitle() const;
@@ -39,7 +46,10 @@ public:
             Logger::LogLevel level, const QString &dateString, const QString &message);
 
 public slots:
-    void writeLog(const QString &dateString, const QString &logLine);
+    void writeLog(const QString &logLine);
+    void writeLogAsync(const QString &logLine);
+
+    void flushLog();
 
 private:
     QString fileNamePrefix() const;
@@ -47,19 +57,25 @@ private:
 
     bool openLogFile();
     bool tryOpenLogFile(const QDir &dir, const QString &fileName);
+    bool prepareLogFile();
     void closeLogFile();
 
-    void writeLogLine(const QString &logLine);
+    void writeLogData(const QByteArray &data);
+    void writeLogRing();
 
 private:
     bool m_isService : 1 = false;
     bool m_hasService : 1 = false;
     bool m_debug : 1 = false;
     bool m_console : 1 = false;
-    bool m_writing : 1 = false;
+    volatile bool m_async = false;
+
+    LoggerWriter *m_writer = nullptr;
 
     QDir m_dir;
     QFile m_file;
+
+    QMutex m_fileMutex;
 };
 
 #endif // LOGGER_H
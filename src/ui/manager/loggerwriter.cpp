@@ -0,0 +1,124 @@
+#include "loggerwriter.h"
+
+#include <util/osutil.h>
+
+#include "logger.h"
+
+namespace {
+
+constexpr quint32 LOGGER_RING_SIZE = 4096; // must be power of 2
+constexpr int LOGGER_FLUSH_INTERVAL_MS = 200;
+
+}
+
+LoggerWriter::LoggerWriter(Logger *logger) :
+    m_logger(logger), m_mask(LOGGER_RING_SIZE - 1), m_slots(new Slot[LOGGER_RING_SIZE])
+{
+    setAutoDelete(false);
+
+    for (quint32 i = 0; i < LOGGER_RING_SIZE; ++i) {
+        m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    m_threadPool.setMaxThreadCount(1);
+}
+
+LoggerWriter::~LoggerWriter()
+{
+    stop();
+}
+
+bool LoggerWriter::push(const QByteArray &line)
+{
+    quint32 pos = m_pushPos.load(std::memory_order_relaxed);
+    Slot *slot;
+
+    for (;;) {
+        slot = &m_slots[pos & m_mask];
+
+        const quint32 sequence = slot->sequence.load(std::memory_order_acquire);
+        const qint32 diff = qint32(sequence - pos);
+
+        if (diff == 0) {
+            if (m_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (diff < 0) {
+            m_droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return false; // the ring is full
+        } else {
+            pos = m_pushPos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->data = line;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+
+    // Wake the writer earlier than its flush interval, when the ring is half full
+    const quint32 count = pos + 1 - m_popPos.load(std::memory_order_relaxed);
+    if (count == LOGGER_RING_SIZE / 2) {
+        m_waitCondition.wakeOne();
+    }
+
+    return true;
+}
+
+bool LoggerWriter::pop(QByteArray &line)
+{
+    const quint32 pos = m_popPos.load(std::memory_order_relaxed);
+    Slot *slot = &m_slots[pos & m_mask];
+
+    if (slot->sequence.load(std::memory_order_acquire) != pos + 1)
+        return false; // the ring is empty
+
+    line = std::move(slot->data);
+    slot->data = QByteArray();
+
+    slot->sequence.store(pos + LOGGER_RING_SIZE, std::memory_order_release);
+    m_popPos.store(pos + 1, std::memory_order_relaxed);
+
+    return true;
+}
+
+quint32 LoggerWriter::takeDroppedCount()
+{
+    return m_droppedCount.exchange(0, std::memory_order_relaxed);
+}
+
+void LoggerWriter::start()
+{
+    QMutexLocker locker(&m_mutex);
+
+    if (!m_stopped)
+        return;
+
+    m_stopped = false;
+
+    m_threadPool.start(this);
+}
+
+void LoggerWriter::stop()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+
+        m_stopped = true;
+        m_waitCondition.wakeOne();
+    }
+
+    m_threadPool.waitForDone();
+}
+
+void LoggerWriter::run()
+{
+    OsUtil::setCurrentThreadName("LoggerWriter");
+
+    QMutexLocker locker(&m_mutex);
+
+    while (!m_stopped) {
+        m_waitCondition.wait(&m_mutex, LOGGER_FLUSH_INTERVAL_MS);
+
+        locker.unlock();
+        m_logger->flushLog();
+        locker.relock();
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef LOGGERWRITER_H
+#define LOGGERWRITER_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <atomic>
+#include <memory>
+
+class Logger;
+
+// Lock-free ring of the preformatted log lines, pushed by any thread
+// and drained in batches by the writer thread
+class LoggerWriter : public QRunnable
+{
+public:
+    explicit LoggerWriter(Logger *logger);
+    ~LoggerWriter() override;
+
+    bool push(const QByteArray &line);
+
+    // Called by the single consumer, under the logger's file lock
+    bool pop(QByteArray &line);
+
+    quint32 takeDroppedCount();
+
+    void start();
+    void stop();
+
+    void run() override;
+
+private:
+    struct Slot
+    {
+        std::atomic<quint32> sequence;
+        QByteArray data;
+    };
+
+    bool m_stopped = true;
+
+    Logger *m_logger = nullptr;
+
+    const quint32 m_mask;
+    std::unique_ptr<Slot[]> m_slots;
+
+    alignas(64) std::atomic<quint32> m_pushPos { 0 };
+    alignas(64) std::atomic<quint32> m_popPos { 0 };
+    std::atomic<quint32> m_droppedCount { 0 };
+
+    QMutex m_mutex;
+    QWaitCondition m_waitCondition;
+
+    QThreadPool m_threadPool;
+};
+
+#endif // LOGGERWRITER_H
@@ -0,0 +1,335 @@
+#include "metricsmanager.h"
+
+#include <QHostAddress>
+#include <QLoggingCategory>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+
+#include <conf/confmanager.h>
+#include <conf/firewallconf.h>
+#include <control/controlworker.h>
+#include <driver/devicestats.h>
+#include <driver/drivermanager.h>
+#include <stat/statblockmanager.h>
+#include <stat/statmanager.h>
+#include <task/taskinfopolicysync.h>
+#include <task/taskmanager.h>
+#include <util/ioc/ioccontainer.h>
+
+namespace {
+
+const QLoggingCategory LC("manager.metrics");
+
+constexpr int requestSizeMax = 8 * 1024;
+constexpr int requestTimeoutMsecs = 5000;
+
+// Of the driver's memory accounting
+const char *const memTypeNames[] = { "buffer", "cache", "conf", "packet", "perf", "pstree",
+    "stat", "tommy", "zones" };
+constexpr int memTypeNamesCount = sizeof(memTypeNames) / sizeof(memTypeNames[0]);
+
+QByteArray labelValue(const QString &v)
+{
+    QByteArray res = v.toUtf8();
+    res.replace('\\', "\\\\");
+    res.replace('"', "\\\"");
+    res.replace('\n', "\\n");
+    return res;
+}
+
+void writeHeader(QByteArray &text, const char *name, const char *type, const char *help)
+{
+    text += "# HELP ";
+    text += name;
+    text += ' ';
+    text += help;
+    text += "\n# TYPE ";
+    text += name;
+    text += ' ';
+    text += type;
+    text += '\n';
+}
+
+void writeValue(QByteArray &text, const char *name, quint64 value, const QByteArray &labels = {})
+{
+    text += name;
+    if (!labels.isEmpty()) {
+        text += '{';
+        text += labels;
+        text += '}';
+    }
+    text += ' ';
+    text += QByteArray::number(value);
+    text += '\n';
+}
+
+void writeMetric(
+        QByteArray &text, const char *name, const char *type, const char *help, quint64 value)
+{
+    writeHeader(text, name, type, help);
+    writeValue(text, name, value);
+}
+
+QByteArray httpResponse(const char *status, const char *contentType, const QByteArray &body)
+{
+    QByteArray res = "HTTP/1.1 ";
+    res += status;
+    res += "\r\nContent-Type: ";
+    res += contentType;
+    res += "\r\nContent-Length: ";
+    res += QByteArray::number(body.size());
+    res += "\r\nConnection: close\r\n\r\n";
+    res += body;
+    return res;
+}
+
+QByteArray processRequest(const QByteArray &requestLine, const MetricsManager *manager)
+{
+    const QList<QByteArray> parts = requestLine.split(' ');
+    const QByteArray method = parts.value(0);
+    const QByteArray path = parts.value(1);
+
+    if (method != "GET")
+        return httpResponse("405 Method Not Allowed", "text/plain", "Method Not Allowed\n");
+
+    if (path != "/metrics" && !path.startsWith("/metrics?"))
+        return httpResponse("404 Not Found", "text/plain", "Not Found\n");
+
+    return httpResponse("200 OK", "text/plain; version=0.0.4; charset=utf-8",
+            manager->metricsText());
+}
+
+}
+
+MetricsManager::MetricsManager(QObject *parent) : QObject(parent) { }
+
+void MetricsManager::setUp()
+{
+    setupStatManager();
+    setupConfManager();
+}
+
+void MetricsManager::tearDown()
+{
+    stopServer();
+}
+
+QByteArray MetricsManager::metricsText() const
+{
+    QByteArray text;
+    text.reserve(16 * 1024);
+
+    writeStatMetrics(text);
+    writeDriverMetrics(text);
+    writeServiceMetrics(text);
+
+    return text;
+}
+
+void MetricsManager::setupConfManager()
+{
+    auto confManager = IoC()->setUpDependency<ConfManager>();
+
+    connect(confManager, &ConfManager::iniChanged, this, &MetricsManager::setupByConf);
+}
+
+void MetricsManager::setupStatManager()
+{
+    auto statManager = IoC()->setUpDependency<StatManager>();
+
+    connect(statManager, &StatManager::trafficAdded, this, &MetricsManager::onTrafficAdded);
+    connect(statManager, &StatManager::appConnsAdded, this, &MetricsManager::onAppConnsAdded);
+}
+
+void MetricsManager::setupByConf(const IniOptions &ini)
+{
+    const int port = qBound(0, ini.metricsPort(), 65535);
+    const QString address = ini.metricsAddress();
+
+    if (port == m_port && address == m_address)
+        return;
+
+    m_port = port;
+    m_address = address;
+
+    stopServer();
+
+    if (port != 0) {
+        startServer(address, port);
+    }
+}
+
+void MetricsManager::startServer(const QString &address, int port)
+{
+    const QHostAddress hostAddress = address.isEmpty() ? QHostAddress(QHostAddress::LocalHost)
+                                                       : QHostAddress(address);
+
+    m_server = new QTcpServer(this);
+
+    connect(m_server, &QTcpServer::newConnection, this, &MetricsManager::onNewConnection);
+
+    if (!m_server->listen(hostAddress, quint16(port))) {
+        qCWarning(LC) << "Listen error:" << hostAddress << port << m_server->errorString();
+        stopServer();
+    }
+}
+
+void MetricsManager::stopServer()
+{
+    if (!m_server)
+        return;
+
+    m_server->close();
+    m_server->deleteLater(); // with the clients' sockets
+    m_server = nullptr;
+}
+
+void MetricsManager::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        connect(socket, &QTcpSocket::readyRead, this, [=, this] { onReadyRead(socket); });
+
+        // Drop the idle clients
+        QTimer::singleShot(requestTimeoutMsecs, socket, &QTcpSocket::abort);
+    }
+}
+
+void MetricsManager::onReadyRead(QTcpSocket *socket)
+{
+    // Wait for the request's headers
+    const QByteArray request = socket->peek(requestSizeMax);
+    if (!request.contains("\r\n\r\n")) {
+        if (request.size() >= requestSizeMax) {
+            socket->abort();
+        }
+        return;
+    }
+
+    disconnect(socket, &QTcpSocket::readyRead, this, nullptr);
+
+    const QByteArray requestLine = request.left(request.indexOf("\r\n"));
+
+    socket->write(processRequest(requestLine, this));
+    socket->disconnectFromHost();
+}
+
+void MetricsManager::onTrafficAdded(qint64 /*unixTime*/, quint64 inBytes, quint64 outBytes)
+{
+    m_inBytes += inBytes;
+    m_outBytes += outBytes;
+}
+
+void MetricsManager::onAppConnsAdded(
+        const QString & /*appPath*/, quint16 connCount, quint16 blockedCount)
+{
+    m_connsCount += connCount;
+    m_blockedCount += blockedCount;
+}
+
+void MetricsManager::writeStatMetrics(QByteArray &text) const
+{
+    writeHeader(text, "fort_traffic_bytes_total", "counter", "Traffic bytes by the direction.");
+    writeValue(text, "fort_traffic_bytes_total", m_inBytes, "direction=\"in\"");
+    writeValue(text, "fort_traffic_bytes_total", m_outBytes, "direction=\"out\"");
+
+    // Since the service's start
+    const AppTrafBytesMap &appBytes = IoC<StatManager>()->appTotalBytes();
+
+    writeHeader(text, "fort_app_traffic_bytes_total", "counter",
+            "Traffic bytes of the apps by the direction.");
+    for (auto it = appBytes.constBegin(); it != appBytes.constEnd(); ++it) {
+        const QByteArray appLabel = "app=\"" + labelValue(it.key()) + "\",";
+
+        writeValue(text, "fort_app_traffic_bytes_total", it->inBytes,
+                appLabel + "direction=\"in\"");
+        writeValue(text, "fort_app_traffic_bytes_total", it->outBytes,
+                appLabel + "direction=\"out\"");
+    }
+
+    writeMetric(text, "fort_conns_total", "counter", "Connections of the apps.", m_connsCount);
+    writeMetric(text, "fort_conns_blocked_total", "counter", "Blocked connections of the apps.",
+            m_blockedCount);
+
+    auto statBlockManager = IoC<StatBlockManager>();
+    const qint64 connIdMin = statBlockManager->connIdMin();
+    const qint64 connIdMax = statBlockManager->connIdMax();
+
+    writeMetric(text, "fort_conn_block_rows", "gauge", "Stored blocked connections.",
+            (connIdMax > 0) ? quint64(connIdMax - connIdMin + 1) : 0);
+}
+
+void MetricsManager::writeDriverMetrics(QByteArray &text) const
+{
+    auto driverManager = IoC<DriverManager>();
+
+    const bool isDeviceOpened = driverManager->isDeviceOpened();
+
+    writeMetric(text, "fort_driver_up", "gauge", "Whether the driver's device is opened.",
+            isDeviceOpened ? 1 : 0);
+    writeMetric(text, "fort_driver_error_code", "gauge", "Last error code of the driver's device.",
+            driverManager->errorCode());
+
+    // The driver's in-memory counters
+    DeviceStats stats;
+    if (!isDeviceOpened || !driverManager->readDeviceStats(stats))
+        return;
+
+    writeMetric(text, "fort_driver_cache_hits_total", "counter", "Hits of the apps' cache.",
+            stats.cacheHits);
+    writeMetric(text, "fort_driver_cache_misses_total", "counter", "Misses of the apps' cache.",
+            stats.cacheMisses);
+
+    writeMetric(text, "fort_driver_flows", "gauge", "Active flows.", stats.flowsCount);
+    writeMetric(text, "fort_driver_flow_inserts_total", "counter", "Inserted flows.",
+            stats.flowInserts);
+
+    writeMetric(text, "fort_driver_shaper_queued_bytes", "gauge", "Bytes in the shapers' queues.",
+            stats.shaperQueuedBytes);
+    writeMetric(text, "fort_driver_shaper_drops_total", "counter",
+            "Packets dropped by the shapers.", stats.shaperDrops);
+    writeMetric(text, "fort_driver_shaper_injects_total", "counter",
+            "Packets injected by the shapers.", stats.shaperInjects);
+
+    writeMetric(text, "fort_driver_log_buffered_bytes", "gauge", "Bytes in the log's buffers.",
+            stats.logBufferedBytes);
+    writeMetric(text, "fort_driver_log_drops_total", "counter", "Dropped log entries.",
+            stats.logDrops);
+
+    writeHeader(text, "fort_driver_log_suppressed_total", "counter",
+            "Blocked log entries suppressed by the log filters.");
+    for (int i = 0; i < stats.logFilterSuppressed.size(); ++i) {
+        const quint64 count = stats.logFilterSuppressed[i];
+        if (count == 0)
+            continue;
+
+        writeValue(text, "fort_driver_log_suppressed_total", count,
+                "filter=\"" + QByteArray::number(i) + '"');
+    }
+
+    writeMetric(text, "fort_driver_conf_swaps_total", "counter", "Swaps of the conf.",
+            stats.confSwaps);
+    writeMetric(text, "fort_driver_ask_timeouts_total", "counter",
+            "Asked connections of the default verdict.", stats.pendingExpires);
+    writeMetric(text, "fort_driver_mem_limit_fails_total", "counter",
+            "Allocations failed by the memory's limit.", stats.memLimitFails);
+
+    writeHeader(text, "fort_driver_mem_bytes", "gauge", "Nonpaged pool bytes by the subsystem.");
+    for (int i = 0; i < stats.memBytes.size(); ++i) {
+        const QByteArray typeName =
+                (i < memTypeNamesCount) ? QByteArray(memTypeNames[i]) : QByteArray::number(i);
+
+        writeValue(text, "fort_driver_mem_bytes", stats.memBytes[i],
+                "subsystem=\"" + typeName + '"');
+    }
+}
+
+void MetricsManager::writeServiceMetrics(QByteArray &text) const
+{
+    writeMetric(text, "fort_rpc_slow_clients_dropped_total", "counter",
+            "Clients dropped by the send queue's lag.", ControlWorker::slowClientsDroppedCount());
+
+    writeMetric(text, "fort_policy_version", "gauge", "Applied version of the central policy.",
+            quint64(IoC<TaskManager>()->taskInfoPolicySync()->version()));
+}
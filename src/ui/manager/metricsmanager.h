@@ -0,0 +1,61 @@
+#ifndef METRICSMANAGER_H
+#define METRICSMANAGER_H
+
+#include <QObject>
+
+#include <util/classhelpers.h>
+#include <util/ioc/iocservice.h>
+
+QT_FORWARD_DECLARE_CLASS(QTcpServer)
+QT_FORWARD_DECLARE_CLASS(QTcpSocket)
+
+class IniOptions;
+
+// Serves the in-memory counters by HTTP in the Prometheus' text format, for the scrapers.
+// The stat DB is not queried.
+class MetricsManager : public QObject, public IocService
+{
+    Q_OBJECT
+
+public:
+    explicit MetricsManager(QObject *parent = nullptr);
+    CLASS_DELETE_COPY_MOVE(MetricsManager)
+
+    void setUp() override;
+    void tearDown() override;
+
+    QByteArray metricsText() const;
+
+private:
+    void setupConfManager();
+    void setupStatManager();
+
+    void setupByConf(const IniOptions &ini);
+
+    void startServer(const QString &address, int port);
+    void stopServer();
+
+    void onNewConnection();
+    void onReadyRead(QTcpSocket *socket);
+
+    void onTrafficAdded(qint64 unixTime, quint64 inBytes, quint64 outBytes);
+    void onAppConnsAdded(const QString &appPath, quint16 connCount, quint16 blockedCount);
+
+    void writeStatMetrics(QByteArray &text) const;
+    void writeDriverMetrics(QByteArray &text) const;
+    void writeServiceMetrics(QByteArray &text) const;
+
+private:
+    int m_port = 0;
+    QString m_address;
+
+    quint64 m_inBytes = 0;
+    quint64 m_outBytes = 0;
+
+    quint64 m_connsCount = 0;
+    quint64 m_blockedCount = 0;
+
+    QTcpServer *m_server = nullptr;
+};
+
+#endif // METRICSMANAGER_H
@@ -1,6 +1,8 @@
 #include "serviceinfomanager.h"
 
+#include <QHash>
 #include <QLoggingCategory>
+#include <QMutex>
 
 #define WIN32_LEAN_AND_MEAN
 #include <qt_windows.h>
@@ -19,8 +21,24 @@ const char *const serviceImagePathKey = "ImagePath";
 const char *const serviceImagePathOldKey = "_Fort_ImagePath";
 const char *const serviceTypeKey = "Type";
 const char *const serviceTypeOldKey = "_Fort_Type";
+const char *const serviceGroupKey = "Group";
 const char *const serviceTrackFlagsKey = "_FortTrackFlags";
 
+constexpr quint32 serviceTagMax = 4096;
+
+// Undocumented advapi32's I_QueryTagInformation()
+enum SC_SERVICE_TAG_QUERY_TYPE { ServiceNameFromTagInformation = 1 };
+
+struct SC_SERVICE_TAG_QUERY
+{
+    ULONG processId;
+    ULONG serviceTag;
+    ULONG reserved;
+    PVOID buffer;
+};
+
+using QueryTagInformationFunc = ULONG(WINAPI *)(PCWSTR, SC_SERVICE_TAG_QUERY_TYPE, PVOID);
+
 QString getServiceDll(const RegKey &svcReg, bool *expand = nullptr)
 {
     QVariant dllPathVar = svcReg.value("ServiceDll", expand);
@@ -32,11 +50,128 @@ QString getServiceDll(const RegKey &svcReg, bool *expand = nullptr)
     return dllPathVar.toString();
 }
 
-QString resolveSvcHostServiceName(const RegKey &servicesReg, const QString &serviceName)
+bool checkIsSvcHostService(const RegKey &svcReg, const QString &imagePath, const QString &dllPath)
+{
+    if (!imagePath.contains(R"(\system32\svchost.exe)", Qt::CaseInsensitive))
+        return false;
+
+    if (!svcReg.contains("ServiceSidType") || svcReg.value("SvcHostSplitDisable").toInt() != 0)
+        return false;
+
+    return !dllPath.isEmpty();
+}
+
+struct ServiceRegInfo
+{
+    bool isSvcHost = false;
+    quint16 trackFlags = 0;
+    quint32 serviceType = 0;
+
+    QString dllPath; // expanded
+    QString imagePath;
+    QString group;
+};
+
+ServiceRegInfo readServiceRegInfo(const RegKey &servicesReg, const QString &serviceName)
 {
     const RegKey svcReg(servicesReg, serviceName);
 
-    const quint32 serviceType = svcReg.value(serviceTypeKey).toUInt();
+    ServiceRegInfo info;
+    info.trackFlags = svcReg.value(serviceTrackFlagsKey).toUInt();
+    info.serviceType = svcReg.value(serviceTypeKey).toUInt();
+    info.imagePath = svcReg.value(serviceImagePathKey).toString();
+    info.group = svcReg.value(serviceGroupKey).toString();
+
+    bool expand = false;
+    const QString dllPath = getServiceDll(svcReg, &expand);
+
+    info.isSvcHost = checkIsSvcHostService(svcReg, info.imagePath, dllPath);
+    info.dllPath = expand ? FileUtil::expandPath(dllPath) : dllPath;
+
+    return info;
+}
+
+// Services' registry values by the names, until the Services key's subtree is changed
+class ServiceRegCache
+{
+public:
+    ServiceRegCache() :
+        m_servicesReg(RegKey::HKLM, servicesSubKey, RegKey::DefaultReadOnly | RegKey::Notify),
+        m_changedEvent(CreateEventW(
+                nullptr, /*bManualReset=*/FALSE, /*bInitialState=*/FALSE, nullptr))
+    {
+    }
+
+    ~ServiceRegCache()
+    {
+        if (m_changedEvent) {
+            CloseHandle(m_changedEvent);
+        }
+    }
+
+    ServiceRegInfo info(const QString &serviceName)
+    {
+        QMutexLocker locker(&m_mutex);
+
+        checkChanged();
+
+        const auto it = m_infos.constFind(serviceName);
+        if (it != m_infos.constEnd())
+            return it.value();
+
+        const ServiceRegInfo info = readServiceRegInfo(m_servicesReg, serviceName);
+
+        // Cache only while the changes are notified
+        if (m_isNotifying) {
+            m_infos.insert(serviceName, info);
+        }
+
+        return info;
+    }
+
+    void remove(const QString &serviceName)
+    {
+        QMutexLocker locker(&m_mutex);
+
+        m_infos.remove(serviceName);
+    }
+
+private:
+    void checkChanged()
+    {
+        if (m_isNotifying && WaitForSingleObject(m_changedEvent, 0) != WAIT_OBJECT_0)
+            return;
+
+        m_infos.clear();
+
+        // The notification is one-shot, set it again
+        m_isNotifying = m_changedEvent
+                && m_servicesReg.notify(/*watchSubtree=*/true,
+                        RegKey::NotifyChangeName | RegKey::NotifyChangeLastSet
+                                | RegKey::NotifyThreadAgnostic,
+                        qintptr(m_changedEvent));
+    }
+
+private:
+    bool m_isNotifying = false;
+
+    QMutex m_mutex;
+
+    RegKey m_servicesReg;
+    const HANDLE m_changedEvent = nullptr;
+
+    QHash<QString, ServiceRegInfo> m_infos;
+};
+
+ServiceRegCache &serviceRegCache()
+{
+    static ServiceRegCache g_serviceRegCache;
+    return g_serviceRegCache;
+}
+
+QString resolveSvcHostServiceName(const QString &serviceName)
+{
+    const quint32 serviceType = serviceRegCache().info(serviceName).serviceType;
 
     // Check a per-user service
     if (serviceType == 224) {
@@ -49,23 +184,7 @@ QString resolveSvcHostServiceName(const RegKey &servicesReg, const QString &serv
     return serviceName;
 }
 
-bool checkIsSvcHostService(const RegKey &svcReg)
-{
-    const auto imagePath = svcReg.value(serviceImagePathKey).toString();
-    if (!imagePath.contains(R"(\system32\svchost.exe)", Qt::CaseInsensitive))
-        return false;
-
-    if (!svcReg.contains("ServiceSidType") || svcReg.value("SvcHostSplitDisable").toInt() != 0)
-        return false;
-
-    const QString dllPath = getServiceDll(svcReg);
-    if (dllPath.isEmpty())
-        return false;
-
-    return true;
-}
-
-void fillServiceInfoList(QVector<ServiceInfo> &infoList, const RegKey &servicesReg,
+void fillServiceInfoList(QVector<ServiceInfo> &infoList,
         const ENUM_SERVICE_STATUS_PROCESSW *service, DWORD serviceCount, bool displayName,
         int &runningCount)
 {
@@ -73,19 +192,17 @@ void fillServiceInfoList(QVector<ServiceInfo> &infoList, const RegKey &servicesR
             --serviceCount, ++service, ++infoIndex) {
 
         auto serviceName = QString::fromUtf16((const char16_t *) service->lpServiceName);
-        serviceName = resolveSvcHostServiceName(servicesReg, serviceName);
+        serviceName = resolveSvcHostServiceName(serviceName);
 
-        const RegKey svcReg(servicesReg, serviceName);
+        const ServiceRegInfo regInfo = serviceRegCache().info(serviceName);
 
-        if (!checkIsSvcHostService(svcReg))
+        if (!regInfo.isSvcHost)
             continue;
 
-        const quint16 trackFlags = svcReg.value(serviceTrackFlagsKey).toUInt();
-
         ServiceInfo info;
         info.isRunning = (service->ServiceStatusProcess.dwCurrentState == SERVICE_RUNNING);
         info.serviceType = ServiceInfo::Type(service->ServiceStatusProcess.dwServiceType);
-        info.trackFlags = trackFlags;
+        info.trackFlags = regInfo.trackFlags;
         info.processId = service->ServiceStatusProcess.dwProcessId;
         info.serviceName = serviceName;
 
@@ -101,14 +218,72 @@ void fillServiceInfoList(QVector<ServiceInfo> &infoList, const RegKey &servicesR
     }
 }
 
+QueryTagInformationFunc getQueryTagInformation()
+{
+    static const auto func = reinterpret_cast<QueryTagInformationFunc>(
+            GetProcAddress(GetModuleHandleW(L"advapi32.dll"), "I_QueryTagInformation"));
+    return func;
+}
+
+QString getServiceNameByTag(QueryTagInformationFunc func, quint32 processId, quint32 serviceTag)
+{
+    SC_SERVICE_TAG_QUERY query = {
+        .processId = processId,
+        .serviceTag = serviceTag,
+    };
+
+    if (func(nullptr, ServiceNameFromTagInformation, &query) != ERROR_SUCCESS || !query.buffer)
+        return {};
+
+    const auto serviceName = QString::fromUtf16((const char16_t *) query.buffer);
+
+    LocalFree(query.buffer);
+
+    return serviceName;
+}
+
+void fillServiceTags(QVector<ServiceInfo> &infoList)
+{
+    const auto func = getQueryTagInformation();
+    if (!func)
+        return;
+
+    // The services of a process are distinguished by tags only when the process is shared
+    QHash<quint32, QHash<QString, ServiceInfo *>> processServices;
+
+    for (ServiceInfo &info : infoList) {
+        if (info.isRunning && info.serviceType == ServiceInfo::TypeWin32ShareProcess) {
+            processServices[info.processId].insert(info.serviceName.toLower(), &info);
+        }
+    }
+
+    for (auto it = processServices.begin(); it != processServices.end(); ++it) {
+        const quint32 processId = it.key();
+        auto &services = it.value();
+
+        if (services.size() < 2)
+            continue;
+
+        for (quint32 serviceTag = 1; serviceTag <= serviceTagMax && !services.isEmpty();
+                ++serviceTag) {
+            const QString serviceName = getServiceNameByTag(func, processId, serviceTag);
+            if (serviceName.isEmpty())
+                continue;
+
+            ServiceInfo *info = services.take(serviceName.toLower());
+            if (info) {
+                info->serviceTag = serviceTag;
+            }
+        }
+    }
+}
+
 QVector<ServiceInfo> getServiceInfoList(SC_HANDLE mngr, DWORD serviceType = SERVICE_WIN32,
         DWORD state = SERVICE_STATE_ALL, bool displayName = true,
         int *runningServicesCount = nullptr)
 {
     QVector<ServiceInfo> infoList;
 
-    const RegKey servicesReg(RegKey::HKLM, servicesSubKey);
-
     constexpr DWORD bufferMaxSize = 32 * 1024;
     ENUM_SERVICE_STATUS_PROCESSW buffer[bufferMaxSize / sizeof(ENUM_SERVICE_STATUS_PROCESSW)];
     DWORD bytesRemaining = 0;
@@ -122,8 +297,7 @@ QVector<ServiceInfo> getServiceInfoList(SC_HANDLE mngr, DWORD serviceType = SERV
         const ENUM_SERVICE_STATUS_PROCESSW *service = &buffer[0];
 
         int runningCount = 0;
-        fillServiceInfoList(
-                infoList, servicesReg, service, serviceCount, displayName, runningCount);
+        fillServiceInfoList(infoList, service, serviceCount, displayName, runningCount);
 
         if (runningServicesCount) {
             *runningServicesCount += runningCount;
@@ -133,6 +307,8 @@ QVector<ServiceInfo> getServiceInfoList(SC_HANDLE mngr, DWORD serviceType = SERV
             break;
     }
 
+    fillServiceTags(infoList);
+
     return infoList;
 }
 
@@ -160,13 +336,7 @@ QVector<ServiceInfo> ServiceInfoManager::loadServiceInfoList(ServiceInfo::Type s
 
 QString ServiceInfoManager::getSvcHostServiceDll(const QString &serviceName)
 {
-    const RegKey servicesReg(RegKey::HKLM, servicesSubKey);
-    const RegKey svcReg(servicesReg, serviceName);
-
-    bool expand = false;
-    const QString dllPath = getServiceDll(svcReg, &expand);
-
-    return expand ? FileUtil::expandPath(dllPath) : dllPath;
+    return serviceRegCache().info(serviceName).dllPath;
 }
 
 void ServiceInfoManager::trackService(const QString &serviceName)
@@ -184,6 +354,8 @@ void ServiceInfoManager::trackService(const QString &serviceName)
     svcReg.setValue(serviceTypeKey, 0x10); // Own process
 
     svcReg.setValue(serviceTrackFlagsKey, ServiceInfo::RegImagePath | ServiceInfo::RegType);
+
+    serviceRegCache().remove(serviceName);
 }
 
 void ServiceInfoManager::revertService(const QString &serviceName)
@@ -205,11 +377,17 @@ void ServiceInfoManager::revertService(const QString &serviceName)
     svcReg.removeValue(serviceTypeOldKey);
 
     svcReg.removeValue(serviceTrackFlagsKey);
+
+    serviceRegCache().remove(serviceName);
 }
 
 void ServiceInfoManager::monitorServices(const QVector<ServiceInfo> &serviceInfoList)
 {
     for (const ServiceInfo &serviceInfo : serviceInfoList) {
+        if (serviceInfo.isRunning) {
+            m_serviceProcessIds.insert(serviceInfo.serviceName, serviceInfo.processId);
+        }
+
         setupServiceMonitor(serviceInfo.serviceName);
     }
 }
@@ -252,20 +430,17 @@ void ServiceInfoManager::startServiceMonitor(ServiceMonitor *serviceMonitor)
 void ServiceInfoManager::stopServiceMonitor(ServiceMonitor *serviceMonitor)
 {
     m_serviceMonitors.remove(serviceMonitor->serviceName());
+    m_serviceProcessIds.remove(serviceMonitor->serviceName());
 
     delete serviceMonitor;
 }
 
 void ServiceInfoManager::onServicesCreated(const QStringList &serviceNames)
 {
-    const RegKey servicesReg(RegKey::HKLM, servicesSubKey);
-
     for (const QString &name : serviceNames) {
-        const QString serviceName = resolveSvcHostServiceName(servicesReg, name);
-
-        const RegKey svcReg(servicesReg, serviceName);
+        const QString serviceName = resolveSvcHostServiceName(name);
 
-        if (!checkIsSvcHostService(svcReg))
+        if (!serviceRegCache().info(serviceName).isSvcHost)
             continue;
 
         setupServiceMonitor(serviceName);
@@ -288,14 +463,24 @@ void ServiceInfoManager::onServiceStateChanged(ServiceMonitor *serviceMonitor)
 
 void ServiceInfoManager::onServiceStarted(ServiceMonitor *serviceMonitor)
 {
+    const QString &serviceName = serviceMonitor->serviceName();
+    const quint32 processId = serviceMonitor->processId();
+
+    // The already running services are notified when their monitors start
+    quint32 &sentProcessId = m_serviceProcessIds[serviceName];
+    if (sentProcessId == processId)
+        return;
+
+    sentProcessId = processId;
+
     constexpr int servicesCount = 1;
 
     QVector<ServiceInfo> services(servicesCount);
 
     ServiceInfo &info = services[0];
     info.isRunning = true;
-    info.processId = serviceMonitor->processId();
-    info.serviceName = serviceMonitor->serviceName();
+    info.processId = processId;
+    info.serviceName = serviceName;
 
     emit servicesStarted(services, servicesCount);
 }
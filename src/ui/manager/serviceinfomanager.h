@@ -50,6 +50,9 @@ private:
 private:
     ServiceListMonitor *m_serviceListMonitor = nullptr;
     QHash<QString, ServiceMonitor *> m_serviceMonitors;
+
+    // Sent to the driver by the service names
+    QHash<QString, quint32> m_serviceProcessIds;
 };
 
 #endif // SERVICEINFOMANAGER_H
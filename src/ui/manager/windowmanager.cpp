@@ -10,6 +10,7 @@
 #include <QStyleHints>
 
 #include <conf/confmanager.h>
+#include <driver/drivermanager.h>
 #include <form/controls/controlutil.h>
 #include <form/controls/mainwindow.h>
 #include <form/dialog/dialogutil.h>
@@ -424,12 +425,16 @@ void WindowManager::showGraphWindow()
     }
 
     showWindow(m_graphWindow, /*activate=*/false);
+
+    IoC<DriverManager>()->writeLiveTraffic(true);
 }
 
 void WindowManager::closeGraphWindow()
 {
     if (closeWindow(m_graphWindow)) {
         m_graphWindow = nullptr;
+
+        IoC<DriverManager>()->writeLiveTraffic(false);
     }
 }
 
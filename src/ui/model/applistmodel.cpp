@@ -20,6 +20,8 @@
 
 namespace {
 
+constexpr int APP_ROWS_BLOCK_COUNT = 256;
+
 const auto alertColor = QColor("orange");
 const auto allowColor = QColor("green");
 const auto blockColor = QColor("red");
@@ -46,18 +48,6 @@ QString appStateIconPath(const AppRow &appRow)
     return ":/icons/accept.png";
 }
 
-QString makeFtsFilterMatch(const QString &filter)
-{
-    if (filter.isEmpty())
-        return {};
-
-    const QStringList words = filter.trimmed().split(' ', Qt::SkipEmptyParts);
-    if (words.isEmpty())
-        return {};
-
-    return words.join("* ") + '*';
-}
-
 }
 
 AppListModel::AppListModel(QObject *parent) : TableSqlModel(parent) { }
@@ -69,7 +59,7 @@ void AppListModel::setFtsFilter(const QString &filter)
 
     m_ftsFilter = filter;
 
-    m_ftsFilterMatch = makeFtsFilterMatch(m_ftsFilter);
+    m_ftsFilterMatch = SqliteDb::makeFtsFilterMatch(m_ftsFilter);
 
     resetLater();
 }
@@ -321,6 +311,13 @@ bool AppListModel::updateAppRow(const QString &sql, const QVariantList &vars, Ap
         return false;
     }
 
+    fillAppRow(stmt, appRow);
+
+    return true;
+}
+
+void AppListModel::fillAppRow(const SqliteStmt &stmt, AppRow &appRow)
+{
     appRow.appId = stmt.columnInt64(0);
     appRow.groupIndex = stmt.columnInt(1);
     appRow.appOriginPath = stmt.columnText(2);
@@ -340,8 +337,27 @@ bool AppListModel::updateAppRow(const QString &sql, const QVariantList &vars, Ap
     appRow.alerted = stmt.columnBool(16);
     appRow.endTime = stmt.columnDateTime(17);
     appRow.creatTime = stmt.columnDateTime(18);
+}
 
-    return true;
+void AppListModel::loadAppRows(int blockRow) const
+{
+    m_blockRow = blockRow;
+    m_appRows.clear();
+
+    QVariantList vars;
+    fillSqlVars(vars);
+    vars.append(blockRow); // must be a last one!
+
+    SqliteStmt stmt;
+    if (!sqliteDb()->prepare(stmt, sql(), vars))
+        return;
+
+    while (stmt.step() == SqliteStmt::StepRow) {
+        AppRow appRow;
+        fillAppRow(stmt, appRow);
+
+        m_appRows.append(appRow);
+    }
 }
 
 const AppRow &AppListModel::appRowAt(int row) const
@@ -351,6 +367,19 @@ const AppRow &AppListModel::appRowAt(int row) const
     return m_appRow;
 }
 
+void AppListModel::prefetchIcons(int row, int count) const
+{
+    const int endRow = qMin(row + count, rowCount());
+
+    for (; row < endRow; ++row) {
+        const auto &appRow = appRowAt(row);
+
+        if (!appRow.isNull() && !appRow.isWildcard) {
+            appInfoCache()->prefetchAppIcon(appRow.appPath);
+        }
+    }
+}
+
 AppRow AppListModel::appRowById(qint64 appId) const
 {
     AppRow appRow;
@@ -370,13 +399,31 @@ AppRow AppListModel::appRowByPath(const QString &appPath) const
     return appRow;
 }
 
+void AppListModel::invalidateRowCache()
+{
+    m_blockRow = -1;
+    m_appRows.clear();
+
+    TableSqlModel::invalidateRowCache();
+}
+
 bool AppListModel::updateTableRow(int row) const
 {
-    QVariantList vars;
-    fillSqlVars(vars);
-    vars.append(row); // must be a last one!
+    // Prefetch the block of rows by one query
+    const int blockRow = row - row % APP_ROWS_BLOCK_COUNT;
+    if (m_blockRow != blockRow) {
+        loadAppRows(blockRow);
+    }
+
+    const int index = row - blockRow;
+    if (index >= m_appRows.size()) {
+        m_appRow.invalidate();
+        return false;
+    }
 
-    return updateAppRow(sql(), vars, m_appRow);
+    m_appRow = m_appRows.at(index);
+
+    return true;
 }
 
 void AppListModel::fillSqlVars(QVariantList &vars) const
@@ -444,3 +491,8 @@ QString AppListModel::sqlOrderColumn() const
 
     return columnsStr;
 }
+
+QString AppListModel::sqlLimitOffset() const
+{
+    return QString(" LIMIT %1 OFFSET :row").arg(APP_ROWS_BLOCK_COUNT);
+}
@@ -2,6 +2,7 @@
 #define APPLISTMODEL_H
 
 #include <QDateTime>
+#include <QVector>
 
 #include <sqlite/sqlitetypes.h>
 
@@ -47,7 +48,11 @@ public:
     AppRow appRowById(qint64 appId) const;
     AppRow appRowByPath(const QString &appPath) const;
 
+    void prefetchIcons(int row, int count) const;
+
 protected:
+    void invalidateRowCache() override;
+
     bool updateTableRow(int row) const override;
     TableRow &tableRow() const override { return m_appRow; }
 
@@ -56,6 +61,7 @@ protected:
     QString sqlBase() const override;
     QString sqlWhere() const override;
     QString sqlOrderColumn() const override;
+    QString sqlLimitOffset() const override;
 
 private:
     QVariant headerDataDisplay(int section) const;
@@ -77,10 +83,17 @@ private:
 
     bool updateAppRow(const QString &sql, const QVariantList &vars, AppRow &appRow) const;
 
+    static void fillAppRow(const SqliteStmt &stmt, AppRow &appRow);
+
+    void loadAppRows(int blockRow) const;
+
 private:
     QString m_ftsFilter;
     QString m_ftsFilterMatch;
 
+    mutable int m_blockRow = -1;
+    mutable QVector<AppRow> m_appRows;
+
     mutable AppRow m_appRow;
 };
 
@@ -20,6 +20,8 @@ namespace {
 
 const QLoggingCategory LC("connBlockListModel");
 
+constexpr int CONN_ROWS_BLOCK_COUNT = 256;
+
 }
 
 ConnBlockListModel::ConnBlockListModel(QObject *parent) : TableSqlModel(parent) { }
@@ -28,10 +30,27 @@ void ConnBlockListModel::setResolveAddress(bool v)
 {
     if (m_resolveAddress != v) {
         m_resolveAddress = v;
+
+        if (!v) {
+            hostInfoCache()->cancelLookups();
+        }
+
         refresh();
     }
 }
 
+void ConnBlockListModel::setFtsFilter(const QString &filter)
+{
+    if (m_ftsFilter == filter)
+        return;
+
+    m_ftsFilter = filter;
+
+    m_ftsFilterMatch = SqliteDb::makeFtsFilterMatch(m_ftsFilter);
+
+    resetLater();
+}
+
 FortManager *ConnBlockListModel::fortManager() const
 {
     return IoC<FortManager>();
@@ -199,10 +218,14 @@ QString ConnBlockListModel::blockReasonText(const ConnRow &connRow)
         QT_TR_NOOP("Restrict access to LAN only"),
         QT_TR_NOOP("Restrict access by Zone"),
         QT_TR_NOOP("Limit of Ask to Connect"),
+        QT_TR_NOOP("Rules logic"),
+        QT_TR_NOOP("Allowed connection"),
+        QT_TR_NOOP("Limit of inbound connections rate"),
+        QT_TR_NOOP("Timeout of Ask to Connect"),
     };
 
     if (connRow.blockReason >= FORT_BLOCK_REASON_IP_INET
-            && connRow.blockReason <= FORT_BLOCK_REASON_ASK_LIMIT) {
+            && connRow.blockReason <= FORT_BLOCK_REASON_ASK_TIMEOUT) {
         const int index = connRow.blockReason - FORT_BLOCK_REASON_IP_INET;
         return tr(blockReasonTexts[index]);
     }
@@ -221,10 +244,14 @@ QString ConnBlockListModel::connIconPath(const ConnRow &connRow)
         ":/icons/hostname.png",
         ":/icons/ip_class.png",
         ":/icons/help.png",
+        ":/icons/road_sign.png",
+        ":/icons/accept.png",
+        ":/icons/clock.png",
+        ":/icons/time.png",
     };
 
     if (connRow.blockReason >= FORT_BLOCK_REASON_IP_INET
-            && connRow.blockReason <= FORT_BLOCK_REASON_ASK_LIMIT) {
+            && connRow.blockReason <= FORT_BLOCK_REASON_ASK_TIMEOUT) {
         const int index = connRow.blockReason - FORT_BLOCK_REASON_IP_INET;
         return blockReasonIcons[index];
     }
@@ -256,51 +283,113 @@ void ConnBlockListModel::updateConnIdRange()
     const qint64 oldIdMin = connIdMin();
     const qint64 oldIdMax = connIdMax();
 
-    qint64 idMin, idMax;
-    statBlockManager()->getConnIdRange(sqliteDb(), idMin, idMax);
+    const qint64 idMin = statBlockManager()->connIdMin();
+    const qint64 idMax = statBlockManager()->connIdMax();
 
     if (idMin == oldIdMin && idMax == oldIdMax)
         return;
 
+    // The filtered rows are not mapped to the conn_id's range
+    if (isFiltered()) {
+        resetConnRows(idMin, idMax);
+        return;
+    }
+
     updateConnRows(oldIdMin, oldIdMax, idMin, idMax);
 }
 
+void ConnBlockListModel::invalidateRowCache()
+{
+    m_blockId = -1;
+    m_connRows.clear();
+
+    TableSqlModel::invalidateRowCache();
+}
+
 bool ConnBlockListModel::updateTableRow(int row) const
 {
-    const qint64 connId = connIdMin() + row;
+    const bool filtered = isFiltered();
+    const qint64 connId = filtered ? row : connIdMin() + row;
 
-    SqliteStmt stmt;
-    if (!(sqliteDb()->prepare(stmt, sql(), { connId }) && stmt.step() == SqliteStmt::StepRow))
+    // Prefetch the block of rows by the conn_id's range, or by the filtered rows' offset
+    const qint64 blockId = connId - (connId % CONN_ROWS_BLOCK_COUNT);
+    if (m_blockId != blockId) {
+        loadConnRows(blockId);
+    }
+
+    const ConnRow &connRow = m_connRows.at(connId - blockId);
+    if (filtered ? (connRow.connId == 0) : (connRow.connId != connId))
         return false;
 
-    m_connRow.connId = stmt.columnInt64(0);
-    m_connRow.appId = stmt.columnInt64(1);
-    m_connRow.connTime = stmt.columnUnixTime(2);
-    m_connRow.pid = stmt.columnInt(3);
-    m_connRow.inbound = stmt.columnBool(4);
-    m_connRow.inherited = stmt.columnBool(5);
-    m_connRow.ipProto = stmt.columnInt(6);
-    m_connRow.localPort = stmt.columnInt(7);
-    m_connRow.remotePort = stmt.columnInt(8);
-
-    m_connRow.isIPv6 = stmt.columnIsNull(9);
-    if (!m_connRow.isIPv6) {
-        m_connRow.localIp.v4 = stmt.columnInt(9);
-        m_connRow.remoteIp.v4 = stmt.columnInt(10);
+    m_connRow = connRow;
+
+    return true;
+}
+
+void ConnBlockListModel::loadConnRows(qint64 blockId) const
+{
+    const bool filtered = isFiltered();
+
+    m_blockId = blockId;
+
+    m_connRows.clear();
+    m_connRows.resize(CONN_ROWS_BLOCK_COUNT);
+
+    const QVariantList vars = filtered
+            ? QVariantList { ftsFilterMatch(), blockId }
+            : QVariantList { blockId, blockId + CONN_ROWS_BLOCK_COUNT - 1 };
+
+    SqliteStmt stmt;
+    if (!sqliteDb()->prepare(stmt, sql(), vars))
+        return;
+
+    int index = 0;
+    while (stmt.step() == SqliteStmt::StepRow && index < CONN_ROWS_BLOCK_COUNT) {
+        const qint64 connId = stmt.columnInt64(0);
+
+        fillConnRow(stmt, m_connRows[filtered ? index : int(connId - blockId)]);
+        ++index;
+    }
+}
+
+void ConnBlockListModel::fillConnRow(const SqliteStmt &stmt, ConnRow &connRow)
+{
+    connRow.connId = stmt.columnInt64(0);
+    connRow.appId = stmt.columnInt64(1);
+    connRow.connTime = stmt.columnUnixTime(2);
+    connRow.pid = stmt.columnInt(3);
+    connRow.inbound = stmt.columnBool(4);
+    connRow.inherited = stmt.columnBool(5);
+    connRow.ipProto = stmt.columnInt(6);
+    connRow.localPort = stmt.columnInt(7);
+    connRow.remotePort = stmt.columnInt(8);
+
+    connRow.isIPv6 = stmt.columnIsNull(9);
+    if (!connRow.isIPv6) {
+        connRow.localIp.v4 = stmt.columnInt(9);
+        connRow.remoteIp.v4 = stmt.columnInt(10);
     } else {
-        m_connRow.localIp.v6 = NetUtil::rawArrayToIp6(stmt.columnBlob(11, /*isRaw=*/true));
-        m_connRow.remoteIp.v6 = NetUtil::rawArrayToIp6(stmt.columnBlob(12, /*isRaw=*/true));
+        connRow.localIp.v6 = NetUtil::rawArrayToIp6(stmt.columnBlob(11, /*isRaw=*/true));
+        connRow.remoteIp.v6 = NetUtil::rawArrayToIp6(stmt.columnBlob(12, /*isRaw=*/true));
     }
 
-    m_connRow.blockReason = stmt.columnInt(13);
+    connRow.blockReason = stmt.columnInt(13);
 
-    m_connRow.appPath = stmt.columnText(14);
+    connRow.appPath = stmt.columnText(14);
+}
 
-    return true;
+void ConnBlockListModel::fillSqlVars(QVariantList &vars) const
+{
+    if (isFiltered()) {
+        vars.append(ftsFilterMatch());
+    }
 }
 
 int ConnBlockListModel::doSqlCount() const
 {
+    if (isFiltered())
+        return TableSqlModel::doSqlCount();
+
     return connIdMax() <= 0 ? 0 : int(connIdMax() - connIdMin()) + 1;
 }
 
@@ -328,11 +417,26 @@ QString ConnBlockListModel::sqlBase() const
 
 QString ConnBlockListModel::sqlWhere() const
 {
-    return " WHERE t.conn_id = ?1";
+    // The parts' app_id indexes are searched by the matched apps
+    if (isFiltered())
+        return " WHERE t.app_id IN ( SELECT rowid FROM app_fts(?1) )";
+
+    return " WHERE t.conn_id BETWEEN ?1 AND ?2";
+}
+
+QString ConnBlockListModel::sqlOrder() const
+{
+    if (isFiltered())
+        return " ORDER BY t.conn_id";
+
+    return QString();
 }
 
 QString ConnBlockListModel::sqlLimitOffset() const
 {
+    if (isFiltered())
+        return QString(" LIMIT %1 OFFSET ?2").arg(CONN_ROWS_BLOCK_COUNT);
+
     return QString();
 }
 
@@ -385,14 +489,22 @@ void ConnBlockListModel::removeConnRows(qint64 idMin, int count)
 {
     beginRemoveRows({}, 0, count - 1);
     m_connIdMin = idMin;
-    invalidateRowCache();
+    invalidateRowCount();
+    TableSqlModel::invalidateRowCache(); // the prefetched rows are kept by their ids
     endRemoveRows();
 }
 
 void ConnBlockListModel::insertConnRows(qint64 idMax, int endRow, int count)
 {
     beginInsertRows({}, endRow, endRow + count - 1);
+
+    // The prefetched block may miss the new rows
+    if (m_blockId + CONN_ROWS_BLOCK_COUNT > m_connIdMax) {
+        m_blockId = -1;
+    }
+
     m_connIdMax = idMax;
-    invalidateRowCache();
+    invalidateRowCount();
+    TableSqlModel::invalidateRowCache();
     endInsertRows();
 }
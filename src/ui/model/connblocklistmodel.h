@@ -2,6 +2,7 @@
 #define CONNBLOCKLISTMODEL_H
 
 #include <QDateTime>
+#include <QVector>
 
 #include <common/common_types.h>
 #include <util/model/tablesqlmodel.h>
@@ -45,6 +46,10 @@ public:
     bool resolveAddress() const { return m_resolveAddress; }
     void setResolveAddress(bool v);
 
+    QString ftsFilterMatch() const { return m_ftsFilterMatch; }
+    QString ftsFilter() const { return m_ftsFilter; }
+    void setFtsFilter(const QString &filter);
+
     FortManager *fortManager() const;
     StatBlockManager *statBlockManager() const;
     SqliteDb *sqliteDb() const override;
@@ -70,12 +75,17 @@ protected slots:
     void updateConnIdRange();
 
 protected:
+    void invalidateRowCache() override;
+
     bool updateTableRow(int row) const override;
     TableRow &tableRow() const override { return m_connRow; }
 
+    void fillSqlVars(QVariantList &vars) const override;
+
     int doSqlCount() const override;
     QString sqlBase() const override;
     QString sqlWhere() const override;
+    QString sqlOrder() const override;
     QString sqlLimitOffset() const override;
 
 private:
@@ -88,11 +98,17 @@ private:
     static QString blockReasonText(const ConnRow &connRow);
     static QString connIconPath(const ConnRow &connRow);
 
+    bool isFiltered() const { return !m_ftsFilterMatch.isEmpty(); }
+
     qint64 connIdMin() const { return m_connIdMin; }
     qint64 connIdMax() const { return m_connIdMax; }
 
     QString formatIpPort(const ip_addr_t &ip, quint16 port, bool isIPv6) const;
 
+    void loadConnRows(qint64 blockId) const;
+
+    static void fillConnRow(const SqliteStmt &stmt, ConnRow &connRow);
+
     void updateConnRows(qint64 oldIdMin, qint64 oldIdMax, qint64 idMin, qint64 idMax);
     void resetConnRows(qint64 idMin, qint64 idMax);
     void removeConnRows(qint64 idMin, int count);
@@ -104,6 +120,12 @@ private:
     qint64 m_connIdMin = 0;
     qint64 m_connIdMax = 0;
 
+    QString m_ftsFilter;
+    QString m_ftsFilterMatch;
+
+    mutable qint64 m_blockId = -1; // the block's first conn_id, or first row when filtered
+    mutable QVector<ConnRow> m_connRows;
+
     mutable ConnRow m_connRow;
 };
 
@@ -0,0 +1,179 @@
+#include "flowlistmodel.h"
+
+#include <appinfo/appinfocache.h>
+#include <driver/drivermanager.h>
+#include <stat/statmanager.h>
+#include <util/ioc/ioccontainer.h>
+#include <util/net/netutil.h>
+
+FlowListModel::FlowListModel(QObject *parent) : TableItemModel(parent) { }
+
+DriverManager *FlowListModel::driverManager() const
+{
+    return IoC<DriverManager>();
+}
+
+StatManager *FlowListModel::statManager() const
+{
+    return IoC<StatManager>();
+}
+
+AppInfoCache *FlowListModel::appInfoCache() const
+{
+    return IoC<AppInfoCache>();
+}
+
+void FlowListModel::initialize()
+{
+    connect(appInfoCache(), &AppInfoCache::cacheChanged, this, &FlowListModel::refresh);
+}
+
+bool FlowListModel::readFlows()
+{
+    QVector<FlowInfo> flows;
+    if (!driverManager()->readFlows(flows))
+        return false;
+
+    statManager()->fillFlowsAppPaths(flows);
+
+    m_flows = flows;
+
+    reset();
+
+    return true;
+}
+
+int FlowListModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent);
+
+    return flows().size();
+}
+
+int FlowListModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 8;
+}
+
+QVariant FlowListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && (role == Qt::DisplayRole || role == Qt::ToolTipRole)) {
+        return headerDataDisplay(section, role);
+    }
+    return QVariant();
+}
+
+QVariant FlowListModel::headerDataDisplay(int section, int role) const
+{
+    static const char *const headerTexts[] = {
+        QT_TR_NOOP("Program"),
+        QT_TR_NOOP("Proc. ID"),
+        QT_TR_NOOP("Protocol"),
+        QT_TR_NOOP("Local Port"),
+        QT_TR_NOOP("Remote IP and Port"),
+        QT_TR_NOOP("Dir."),
+        QT_TR_NOOP("Download"),
+        QT_TR_NOOP("Upload"),
+    };
+
+    static const char *const headerTooltips[] = {
+        QT_TR_NOOP("Program"),
+        QT_TR_NOOP("Process ID"),
+        QT_TR_NOOP("Protocol"),
+        QT_TR_NOOP("Local Port"),
+        QT_TR_NOOP("Remote IP and Port"),
+        QT_TR_NOOP("Direction"),
+        QT_TR_NOOP("Download"),
+        QT_TR_NOOP("Upload"),
+    };
+
+    if (section >= 0 && section <= 7) {
+        const char *const *arr = (role == Qt::ToolTipRole) ? headerTooltips : headerTexts;
+        return tr(arr[section]);
+    }
+
+    return QVariant();
+}
+
+QVariant FlowListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    switch (role) {
+    // Label
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        return dataDisplay(index);
+
+    // Icon
+    case Qt::DecorationRole:
+        return dataDecoration(index);
+    }
+
+    return QVariant();
+}
+
+QVariant FlowListModel::dataDisplay(const QModelIndex &index) const
+{
+    const int row = index.row();
+    const int column = index.column();
+
+    const auto &flow = flowAt(row);
+
+    switch (column) {
+    case 0:
+        return flow.appPath.isEmpty() ? QVariant() : appInfoCache()->appName(flow.appPath);
+    case 1:
+        return flow.pid;
+    case 2:
+        return NetUtil::protocolName(flow.ipProto);
+    case 3:
+        return flow.localPort;
+    case 4:
+        return formatIpPort(flow.remoteIp, flow.remotePort, flow.isIPv6);
+    case 5:
+        return flow.inbound ? tr("In") : tr("Out");
+    case 6:
+        return NetUtil::formatDataSize(flow.inBytes);
+    case 7:
+        return NetUtil::formatDataSize(flow.outBytes);
+    }
+
+    return QVariant();
+}
+
+QVariant FlowListModel::dataDecoration(const QModelIndex &index) const
+{
+    if (index.column() == 0) {
+        const auto &flow = flowAt(index.row());
+
+        if (!flow.appPath.isEmpty())
+            return appInfoCache()->appIcon(flow.appPath);
+    }
+
+    return QVariant();
+}
+
+bool FlowListModel::updateTableRow(int /*row*/) const
+{
+    return true;
+}
+
+const FlowInfo &FlowListModel::flowAt(int index) const
+{
+    if (index < 0 || index >= flows().size()) {
+        static const FlowInfo g_nullFlowInfo;
+        return g_nullFlowInfo;
+    }
+    return flows()[index];
+}
+
+QString FlowListModel::formatIpPort(const ip_addr_t &ip, quint16 port, bool isIPv6)
+{
+    QString address = NetUtil::ipToText(ip, isIPv6);
+    if (isIPv6) {
+        address = '[' + address + ']';
+    }
+    return address + ':' + QString::number(port);
+}
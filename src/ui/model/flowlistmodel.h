@@ -0,0 +1,58 @@
+#ifndef FLOWLISTMODEL_H
+#define FLOWLISTMODEL_H
+
+#include <QVector>
+
+#include <driver/flowinfo.h>
+#include <util/model/tableitemmodel.h>
+
+class AppInfoCache;
+class DriverManager;
+class StatManager;
+
+class FlowListModel : public TableItemModel
+{
+    Q_OBJECT
+
+public:
+    explicit FlowListModel(QObject *parent = nullptr);
+
+    DriverManager *driverManager() const;
+    StatManager *statManager() const;
+    AppInfoCache *appInfoCache() const;
+
+    void initialize();
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+
+    QVariant headerData(
+            int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    const QVector<FlowInfo> &flows() const { return m_flows; }
+    const FlowInfo &flowAt(int index) const;
+
+public slots:
+    // Read the driver's active flows' snapshot
+    bool readFlows();
+
+protected:
+    bool updateTableRow(int row) const override;
+    TableRow &tableRow() const override { return m_flowRow; }
+
+private:
+    QVariant headerDataDisplay(int section, int role) const;
+
+    QVariant dataDisplay(const QModelIndex &index) const;
+    QVariant dataDecoration(const QModelIndex &index) const;
+
+    static QString formatIpPort(const ip_addr_t &ip, quint16 port, bool isIPv6);
+
+private:
+    QVector<FlowInfo> m_flows;
+
+    mutable TableRow m_flowRow;
+};
+
+#endif // FLOWLISTMODEL_H
@@ -10,6 +10,8 @@
 
 namespace {
 
+constexpr int TRAF_PAGE_ROWS = 64;
+
 bool checkTrafType(TrafListModel::TrafType type)
 {
     if (type >= TrafListModel::TrafHourly && type <= TrafListModel::TrafTotal)
@@ -63,6 +65,26 @@ const char *getSqlSelectTraffic(TrafListModel::TrafType type, qint64 appId)
     return (appId != 0 ? sqlSelectTrafApps : sqlSelectTrafs)[type];
 }
 
+static const char *const sqlSelectTrafAppRanges[] = {
+    StatSql::sqlSelectTrafAppHourRange,
+    StatSql::sqlSelectTrafAppDayRange,
+    StatSql::sqlSelectTrafAppMonthRange,
+};
+
+static const char *const sqlSelectTrafRanges[] = {
+    StatSql::sqlSelectTrafHourRange,
+    StatSql::sqlSelectTrafDayRange,
+    StatSql::sqlSelectTrafMonthRange,
+};
+
+const char *getSqlSelectTrafficRange(TrafListModel::TrafType type, qint64 appId)
+{
+    if (!checkTrafType(type) || type == TrafListModel::TrafTotal)
+        return nullptr;
+
+    return (appId != 0 ? sqlSelectTrafAppRanges : sqlSelectTrafRanges)[type];
+}
+
 }
 
 TrafListModel::TrafListModel(QObject *parent) : TableItemModel(parent) { }
@@ -177,18 +199,56 @@ void TrafListModel::reset()
     }
 }
 
+void TrafListModel::invalidateRowCache()
+{
+    TableItemModel::invalidateRowCache();
+
+    m_pageRow = -1;
+    m_pageTraf.clear();
+}
+
 bool TrafListModel::updateTableRow(int row) const
 {
     m_trafRow.trafTime = getTrafTime(row);
 
-    const char *sqlSelectTraffic = getSqlSelectTraffic(m_type, m_appId);
+    if (m_type == TrafTotal) {
+        const char *sqlSelectTraffic = getSqlSelectTraffic(m_type, m_appId);
 
-    statManager()->getTraffic(
-            sqlSelectTraffic, m_trafRow.trafTime, m_trafRow.inBytes, m_trafRow.outBytes, m_appId);
+        statManager()->getTraffic(sqlSelectTraffic, m_trafRow.trafTime, m_trafRow.inBytes,
+                m_trafRow.outBytes, m_appId);
+        return true;
+    }
+
+    const int pageRow = row - row % TRAF_PAGE_ROWS;
+    if (m_pageRow != pageRow) {
+        loadTrafPage(pageRow);
+    }
+
+    const TrafBytes trafBytes = m_pageTraf.value(m_trafRow.trafTime);
+
+    m_trafRow.inBytes = qint64(trafBytes.inBytes);
+    m_trafRow.outBytes = qint64(trafBytes.outBytes);
 
     return true;
 }
 
+void TrafListModel::loadTrafPage(int pageRow) const
+{
+    const int lastRow = qMin(pageRow + TRAF_PAGE_ROWS, m_trafCount) - 1;
+
+    // The rows are ordered by the descending traffic times
+    const qint32 maxTrafTime = getTrafTime(pageRow);
+    const qint32 minTrafTime = getTrafTime(lastRow);
+
+    const char *sqlSelectTrafficRange = getSqlSelectTrafficRange(m_type, m_appId);
+
+    m_pageRow = pageRow;
+    m_pageTraf.clear();
+
+    statManager()->getTrafficRange(
+            sqlSelectTrafficRange, minTrafTime, maxTrafTime, m_pageTraf, m_appId);
+}
+
 QString TrafListModel::formatTrafUnit(qint64 bytes) const
 {
     static const QVector<qint64> unitMults = {
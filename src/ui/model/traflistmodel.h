@@ -1,6 +1,7 @@
 #ifndef TRAFLISTMODEL_H
 #define TRAFLISTMODEL_H
 
+#include <stat/stattrafjob.h>
 #include <util/model/tableitemmodel.h>
 
 class StatManager;
@@ -54,6 +55,8 @@ public slots:
     void reset();
 
 protected:
+    void invalidateRowCache() override;
+
     bool updateTableRow(int row) const override;
     TableRow &tableRow() const override { return m_trafRow; }
 
@@ -62,6 +65,9 @@ protected:
 
     qint32 getTrafTime(int row) const;
 
+    // Load the page's traffic by one range scan of the clustered table
+    void loadTrafPage(int pageRow) const;
+
     static qint32 getTrafCount(TrafType type, qint32 minTrafTime, qint32 maxTrafTime);
     static qint32 getMaxTrafTime(TrafType type);
 
@@ -77,6 +83,9 @@ private:
     qint32 m_maxTrafTime = 0;
     qint32 m_trafCount = 0;
 
+    mutable int m_pageRow = -1;
+    mutable TrafTimeBytesMap m_pageTraf;
+
     mutable TrafficRow m_trafRow;
 };
 
@@ -8,6 +8,7 @@
 
 #include <conf/confmanager.h>
 #include <conf/confzonemanager.h>
+#include <driver/drivermanager.h>
 #include <util/conf/confutil.h>
 #include <util/fileutil.h>
 #include <util/ioc/ioccontainer.h>
@@ -51,7 +52,7 @@ void ZoneListModel::setUp()
 
 int ZoneListModel::columnCount(const QModelIndex &parent) const
 {
-    return parent.isValid() ? 0 : 5;
+    return parent.isValid() ? 0 : 7;
 }
 
 QVariant ZoneListModel::headerData(int section, Qt::Orientation orientation, int role) const
@@ -94,6 +95,10 @@ QVariant ZoneListModel::headerDataDisplay(int section) const
         return tr("Last Download");
     case 4:
         return tr("Last Success");
+    case 5:
+        return tr("Hits");
+    case 6:
+        return tr("Last Matched");
     }
     return QVariant();
 }
@@ -118,6 +123,12 @@ QVariant ZoneListModel::dataDisplay(const QModelIndex &index) const
         return zoneRow.lastRun;
     case 4:
         return zoneRow.lastSuccess;
+    case 5:
+        return m_addressHits.zoneHits.value(zoneRow.zoneId - 1);
+    case 6: {
+        const qint64 hitTime = m_addressHits.zoneHitTimes.value(zoneRow.zoneId - 1);
+        return (hitTime != 0) ? QDateTime::fromSecsSinceEpoch(hitTime) : QVariant();
+    }
     }
 
     return QVariant();
@@ -172,6 +183,15 @@ QString ZoneListModel::zoneNameById(int zoneId)
     return QString();
 }
 
+void ZoneListModel::readAddressHits()
+{
+    if (!IoC<DriverManager>()->readAddressHits(m_addressHits)) {
+        m_addressHits = {};
+    }
+
+    refresh();
+}
+
 QVariant ZoneListModel::zoneTypeByCode(const QString &typeCode) const
 {
     return m_zoneTypesMap.value(typeCode);
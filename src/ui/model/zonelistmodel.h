@@ -6,6 +6,7 @@
 #include <sqlite/sqlitetypes.h>
 
 #include <conf/zone.h>
+#include <driver/devicestats.h>
 #include <util/ioc/iocservice.h>
 #include <util/model/tablesqlmodel.h>
 
@@ -46,6 +47,9 @@ public:
     QVariant zoneSourceByCode(const QString &sourceCode) const;
     const QVariantList &zoneSources() const { return m_zoneSources; }
 
+    // Refresh the zones' matches from the driver
+    void readAddressHits();
+
 protected:
     Qt::ItemFlags flagIsUserCheckable(const QModelIndex &index) const override;
 
@@ -70,6 +74,8 @@ private:
     QVariantList m_zoneSources;
     QVariantHash m_zoneSourcesMap;
 
+    AddressHits m_addressHits;
+
     mutable ZoneRow m_zoneRow;
 };
 
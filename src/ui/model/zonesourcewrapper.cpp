@@ -39,7 +39,7 @@ QString ZoneSourceWrapper::formData() const
 
 bool ZoneSourceWrapper::isTextInline() const
 {
-    return code() == textSourceCode();
+    return code() == textSourceCode() || valueBool("textInline");
 }
 
 QString ZoneSourceWrapper::textSourceCode()
@@ -41,3 +41,8 @@ int ZoneTypeWrapper::emptyNetMask() const
 {
     return valueInt("emptyNetMask");
 }
+
+bool ZoneTypeWrapper::resolve() const
+{
+    return valueBool("resolve");
+}
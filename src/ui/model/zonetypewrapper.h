@@ -17,6 +17,9 @@ public:
     bool sort() const;
     QString pattern() const;
     int emptyNetMask() const;
+
+    // The list of domain names, resolved by the service
+    bool resolve() const;
 };
 
 #endif // ZONEWRAPPER_H
@@ -12,5 +12,8 @@ AppInfoManagerRpc::AppInfoManagerRpc(const QString &filePath, QObject *parent) :
 
 void AppInfoManagerRpc::lookupAppInfo(const QString &appPath)
 {
+    if (!startLookupInfo(appPath))
+        return; // already in flight
+
     IoC<RpcManager>()->invokeOnServer(Control::Rpc_AppInfoManager_lookupAppInfo, { appPath });
 }
@@ -22,7 +22,7 @@ void ConfAppManagerRpc::deleteApps(const QVector<qint64> &appIdList)
     QVariantList args;
     VariantUtil::addToList(args, appIdVarList);
 
-    IoC<RpcManager>()->doOnServer(Control::Rpc_ConfAppManager_deleteApps, args);
+    IoC<RpcManager>()->doOnServerAsync(Control::Rpc_ConfAppManager_deleteApps, args);
 }
 
 bool ConfAppManagerRpc::purgeApps()
@@ -44,7 +44,7 @@ void ConfAppManagerRpc::updateAppsBlocked(
     VariantUtil::addToList(args, appIdVarList);
     args << blocked << killProcess;
 
-    IoC<RpcManager>()->doOnServer(Control::Rpc_ConfAppManager_updateAppsBlocked, args);
+    IoC<RpcManager>()->doOnServerAsync(Control::Rpc_ConfAppManager_updateAppsBlocked, args);
 }
 
 bool ConfAppManagerRpc::updateAppName(qint64 appId, const QString &appName)
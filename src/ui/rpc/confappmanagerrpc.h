@@ -21,6 +21,7 @@ public:
     bool updateAppName(qint64 appId, const QString &appName) override;
 
     bool updateDriverConf(bool /*onlyFlags*/ = false) override { return false; }
+    bool updateDriverConfPatch() override { return false; }
 
     static QVariantList appToVarList(const App &app);
     static App varListToApp(const QVariantList &v);
@@ -63,9 +63,11 @@ void ConfManagerRpc::onConfChanged(const QVariant &confVar)
     const uint editedFlags = FirewallConf::editedFlagsFromVariant(confVar);
 
     if ((editedFlags & FirewallConf::OptEdited) != 0) {
-        // Reload from storage
-        setConf(createConf());
-        loadConf(*conf());
+        // Patch the changed groups in place, else reload from storage
+        if (!conf()->patchFromVariant(confVar)) {
+            setConf(createConf());
+            loadConf(*conf());
+        }
     } else {
         // Apply only flags
         conf()->fromVariant(confVar, /*onlyEdited=*/true);
@@ -1,9 +1,20 @@
 #include "drivermanagerrpc.h"
 
+#include <QDataStream>
+#include <QHash>
+
 #include <control/controlworker.h>
+#include <driver/devicestats.h>
+#include <driver/flowinfo.h>
 #include <rpc/rpcmanager.h>
 #include <util/ioc/ioccontainer.h>
 
+namespace {
+
+constexpr int flowsRpcMaxCount = 8 * 1024; // limited by the request's data size
+
+}
+
 DriverManagerRpc::DriverManagerRpc(QObject *parent) : DriverManager(parent, /*useDevice=*/false) { }
 
 void DriverManagerRpc::setIsDeviceOpened(bool v)
@@ -31,3 +42,127 @@ bool DriverManagerRpc::closeDevice()
 
     return false;
 }
+
+bool DriverManagerRpc::writeLiveTraffic(bool live)
+{
+    // Re-subscribe on reconnection
+    IoC<RpcManager>()->client()->setSubscribed(Control::SubscribeTraffic, live);
+
+    return IoC<RpcManager>()->doOnServer(Control::Rpc_DriverManager_writeLiveTraffic, { live });
+}
+
+bool DriverManagerRpc::readFlows(QVector<FlowInfo> &flows)
+{
+    QVariantList resArgs;
+
+    if (!IoC<RpcManager>()->doOnServer(Control::Rpc_DriverManager_readFlows, {}, &resArgs))
+        return false;
+
+    flows = varListToFlows(resArgs);
+
+    return true;
+}
+
+bool DriverManagerRpc::readAddressHits(AddressHits &hits)
+{
+    QVariantList resArgs;
+
+    if (!IoC<RpcManager>()->doOnServer(Control::Rpc_DriverManager_readAddressHits, {}, &resArgs))
+        return false;
+
+    hits = varListToAddressHits(resArgs);
+
+    return true;
+}
+
+QVariantList DriverManagerRpc::flowsToVarList(const QVector<FlowInfo> &flows)
+{
+    QStringList appPaths;
+    QHash<QString, int> appPathIndexes;
+
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+
+    const int count = qMin(flows.size(), flowsRpcMaxCount);
+
+    for (int i = 0; i < count; ++i) {
+        const FlowInfo &flow = flows[i];
+
+        // The flows of a process share its path
+        int appPathIndex = appPathIndexes.value(flow.appPath, -1);
+        if (appPathIndex < 0) {
+            appPathIndex = appPaths.size();
+            appPathIndexes.insert(flow.appPath, appPathIndex);
+            appPaths.append(flow.appPath);
+        }
+
+        const quint8 flags = (flow.isTcp ? 0x01 : 0) | (flow.isIPv6 ? 0x02 : 0)
+                | (flow.inbound ? 0x04 : 0);
+
+        stream << flags << flow.ipProto << flow.groupIndex << flow.localPort << flow.remotePort;
+        stream.writeRawData(flow.remoteIp.v6.data, sizeof(flow.remoteIp.v6.data));
+        stream << flow.pid << flow.flowId << flow.inBytes << flow.outBytes << appPathIndex;
+    }
+
+    return { count, data, appPaths };
+}
+
+QVector<FlowInfo> DriverManagerRpc::varListToFlows(const QVariantList &v)
+{
+    const int count = v.value(0).toInt();
+    const QByteArray data = v.value(1).toByteArray();
+    const QStringList appPaths = v.value(2).toStringList();
+
+    QVector<FlowInfo> flows;
+    flows.reserve(count);
+
+    QDataStream stream(data);
+
+    for (int i = 0; i < count && !stream.atEnd(); ++i) {
+        FlowInfo flow;
+        quint8 flags;
+        int appPathIndex;
+
+        stream >> flags >> flow.ipProto >> flow.groupIndex >> flow.localPort >> flow.remotePort;
+        stream.readRawData(flow.remoteIp.v6.data, sizeof(flow.remoteIp.v6.data));
+        stream >> flow.pid >> flow.flowId >> flow.inBytes >> flow.outBytes >> appPathIndex;
+
+        if (stream.status() != QDataStream::Ok)
+            break;
+
+        flow.isTcp = (flags & 0x01) != 0;
+        flow.isIPv6 = (flags & 0x02) != 0;
+        flow.inbound = (flags & 0x04) != 0;
+        flow.appPath = appPaths.value(appPathIndex);
+
+        flows.append(flow);
+    }
+
+    return flows;
+}
+
+QVariantList DriverManagerRpc::addressHitsToVarList(const AddressHits &hits)
+{
+    QByteArray data;
+    QDataStream stream(&data, QIODevice::WriteOnly);
+
+    stream << hits.zoneHits << hits.zoneHitTimes << hits.addrGroupHits << hits.addrGroupHitTimes;
+
+    return { data };
+}
+
+AddressHits DriverManagerRpc::varListToAddressHits(const QVariantList &v)
+{
+    const QByteArray data = v.value(0).toByteArray();
+
+    AddressHits hits;
+
+    QDataStream stream(data);
+
+    stream >> hits.zoneHits >> hits.zoneHitTimes >> hits.addrGroupHits >> hits.addrGroupHitTimes;
+
+    if (stream.status() != QDataStream::Ok)
+        return {};
+
+    return hits;
+}
@@ -21,6 +21,19 @@ public slots:
     bool openDevice() override;
     bool closeDevice() override;
 
+    bool writeLiveTraffic(bool live) override;
+
+    bool readFlows(QVector<FlowInfo> &flows) override;
+
+    bool readAddressHits(AddressHits &hits) override;
+
+public:
+    static QVariantList flowsToVarList(const QVector<FlowInfo> &flows);
+    static QVector<FlowInfo> varListToFlows(const QVariantList &v);
+
+    static QVariantList addressHitsToVarList(const AddressHits &hits);
+    static AddressHits varListToAddressHits(const QVariantList &v);
+
 private:
     bool m_isDeviceOpened : 1 = false;
 };
@@ -12,6 +12,11 @@ public:
 
 protected:
     void setupConfManager() override { }
+
+    void writeDriverQuota(qint64 /*dayBytes*/, qint64 /*monthBytes*/, quint8 /*setBits*/,
+            quint8 /*alertedBits*/) override
+    {
+    }
 };
 
 #endif // QUOTAMANAGERRPC_H
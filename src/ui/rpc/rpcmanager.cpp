@@ -6,7 +6,10 @@
 #include <conf/zone.h>
 #include <control/controlmanager.h>
 #include <control/controlworker.h>
+#include <driver/devicestats.h>
+#include <driver/flowinfo.h>
 #include <fortsettings.h>
+#include <log/logentryshaperstat.h>
 #include <manager/windowmanager.h>
 #include <rpc/appinfomanagerrpc.h>
 #include <rpc/confappmanagerrpc.h>
@@ -34,18 +37,18 @@ void showErrorBox(const QString &text)
             windowManager, [=] { windowManager->showErrorBox(text); }, Qt::QueuedConnection);
 }
 
-inline bool sendCommandDataToClients(
-        const QByteArray &commandData, const QList<ControlWorker *> &clients)
+inline bool sendCommandDataToClients(const ControlCommandDataPtr &commandData,
+        const QList<ControlWorker *> &clients, Control::Subscription subscription)
 {
     bool ok = true;
 
     // XXX: OsUtil::setThreadIsBusy(true);
 
     for (ControlWorker *w : clients) {
-        if (!w->isServiceClient())
+        if (!w->isServiceClient() || !w->isSubscribed(subscription))
             continue;
 
-        if (!w->sendCommandData(commandData)) {
+        if (!w->postCommandData(commandData)) {
             qCWarning(LC) << "Send command error:" << w->id() << w->errorString();
             ok = false;
         }
@@ -251,8 +254,8 @@ bool processStatManager_appCreated(StatManager *statManager, const ProcessComman
 
 bool processStatManager_trafficAdded(StatManager *statManager, const ProcessCommandArgs &p)
 {
-    emit statManager->trafficAdded(
-            p.args.value(0).toLongLong(), p.args.value(1).toUInt(), p.args.value(2).toUInt());
+    emit statManager->trafficAdded(p.args.value(0).toLongLong(), p.args.value(1).toULongLong(),
+            p.args.value(2).toULongLong());
     return true;
 }
 
@@ -263,6 +266,21 @@ bool processStatManager_appTrafTotalsResetted(
     return true;
 }
 
+bool processStatManager_shaperStatAdded(StatManager *statManager, const ProcessCommandArgs &p)
+{
+    ShaperStat shaperStat;
+    shaperStat.queueIndex = quint8(p.args.value(0).toUInt());
+    shaperStat.sojournMaxMsecs = p.args.value(1).toUInt();
+    shaperStat.queuedBytes = p.args.value(2).toULongLong();
+    shaperStat.passedBytes = p.args.value(3).toULongLong();
+    shaperStat.droppedBytes = p.args.value(4).toULongLong();
+    shaperStat.passedPackets = p.args.value(5).toUInt();
+    shaperStat.droppedPackets = p.args.value(6).toUInt();
+
+    emit statManager->shaperStatAdded(shaperStat);
+    return true;
+}
+
 using processStatManagerSignal_func = bool (*)(
         StatManager *statManager, const ProcessCommandArgs &p);
 
@@ -272,18 +290,19 @@ static processStatManagerSignal_func processStatManagerSignal_funcList[] = {
     &processStatManager_appCreated, // Rpc_StatManager_appCreated,
     &processStatManager_trafficAdded, // Rpc_StatManager_trafficAdded,
     &processStatManager_appTrafTotalsResetted, // Rpc_StatManager_appTrafTotalsResetted,
+    &processStatManager_shaperStatAdded, // Rpc_StatManager_shaperStatAdded,
 };
 
 inline bool processStatManagerRpcSignal(StatManager *statManager, const ProcessCommandArgs &p)
 {
     const processStatManagerSignal_func func = getProcessFunc(p, processStatManagerSignal_funcList,
-            Control::Rpc_StatManager_trafficCleared,
-            Control::Rpc_StatManager_appTrafTotalsResetted);
+            Control::Rpc_StatManager_trafficCleared, Control::Rpc_StatManager_shaperStatAdded);
 
     return func ? func(statManager, p) : false;
 }
 
-inline bool processStatManagerRpcResult(StatManager *statManager, const ProcessCommandArgs &p)
+inline bool processStatManagerRpcResult(
+        StatManager *statManager, const ProcessCommandArgs &p, QVariantList &resArgs)
 {
     switch (p.command) {
     case Control::Rpc_StatManager_deleteStatApp:
@@ -292,6 +311,14 @@ inline bool processStatManagerRpcResult(StatManager *statManager, const ProcessC
         return statManager->resetAppTrafTotals();
     case Control::Rpc_StatManager_clearTraffic:
         return statManager->clearTraffic();
+    case Control::Rpc_StatManager_getTopApps: {
+        const auto window = StatTopApps::Window(
+                qBound(0, p.args.value(0).toInt(), int(StatTopApps::WindowCount) - 1));
+
+        resArgs = StatManagerRpc::topAppsToVarList(
+                statManager->getTopApps(window, p.args.value(1).toInt()));
+        return true;
+    }
     default:
         return false;
     }
@@ -430,8 +457,8 @@ bool processConfZoneManagerRpc(
     }
 }
 
-bool processDriverManagerRpc(const ProcessCommandArgs &p, QVariantList & /*resArgs*/, bool & /*ok*/,
-        bool & /*isSendResult*/)
+bool processDriverManagerRpc(
+        const ProcessCommandArgs &p, QVariantList &resArgs, bool &ok, bool &isSendResult)
 {
     auto driverManager = IoC<DriverManager>();
 
@@ -441,6 +468,37 @@ bool processDriverManagerRpc(const ProcessCommandArgs &p, QVariantList & /*resAr
             dm->updateState(p.args.value(0).toUInt(), p.args.value(1).toBool());
         }
         return true;
+    case Control::Rpc_DriverManager_writeLiveTraffic: {
+        const bool live = p.args.value(0).toBool();
+
+        p.worker->setSubscribed(Control::SubscribeTraffic, live);
+
+        ok = driverManager->writeLiveTraffic(live);
+        isSendResult = true;
+        return true;
+    }
+    case Control::Rpc_DriverManager_readFlows: {
+        QVector<FlowInfo> flows;
+
+        ok = driverManager->readFlows(flows);
+        if (ok) {
+            IoC<StatManager>()->fillFlowsAppPaths(flows);
+
+            resArgs = DriverManagerRpc::flowsToVarList(flows);
+        }
+        isSendResult = true;
+        return true;
+    }
+    case Control::Rpc_DriverManager_readAddressHits: {
+        AddressHits hits;
+
+        ok = driverManager->readAddressHits(hits);
+        if (ok) {
+            resArgs = DriverManagerRpc::addressHitsToVarList(hits);
+        }
+        isSendResult = true;
+        return true;
+    }
     default:
         return false;
     }
@@ -461,7 +519,7 @@ bool processQuotaManagerRpc(const ProcessCommandArgs &p, QVariantList & /*resArg
 }
 
 bool processStatManagerRpc(
-        const ProcessCommandArgs &p, QVariantList & /*resArgs*/, bool &ok, bool &isSendResult)
+        const ProcessCommandArgs &p, QVariantList &resArgs, bool &ok, bool &isSendResult)
 {
     auto statManager = IoC<StatManager>();
 
@@ -471,10 +529,11 @@ bool processStatManagerRpc(
     case Control::Rpc_StatManager_appCreated:
     case Control::Rpc_StatManager_trafficAdded:
     case Control::Rpc_StatManager_appTrafTotalsResetted:
+    case Control::Rpc_StatManager_shaperStatAdded:
         return processStatManagerRpcSignal(statManager, p);
 
     default: {
-        ok = processStatManagerRpcResult(statManager, p);
+        ok = processStatManagerRpcResult(statManager, p, resArgs);
         isSendResult = true;
         return true;
     }
@@ -488,7 +547,9 @@ bool processStatBlockManagerRpc(
 
     switch (p.command) {
     case Control::Rpc_StatBlockManager_connChanged:
-        emit statBlockManager->connChanged();
+        if (auto sbm = qobject_cast<StatBlockManagerRpc *>(statBlockManager)) {
+            sbm->onConnChanged(p.args.value(0).toLongLong(), p.args.value(1).toLongLong());
+        }
         return true;
     default: {
         ok = processStatBlockManagerRpcResult(statBlockManager, p);
@@ -646,21 +707,26 @@ void RpcManager::setupStatManagerSignals()
     connect(statManager, &StatManager::appCreated, this, [&](qint64 appId, const QString &appPath) {
         invokeOnClients(Control::Rpc_StatManager_appCreated, { appId, appPath });
     });
-    connect(statManager, &StatManager::trafficAdded, this,
-            [&](qint64 unixTime, quint32 inBytes, quint32 outBytes) {
-                invokeOnClients(
-                        Control::Rpc_StatManager_trafficAdded, { unixTime, inBytes, outBytes });
-            });
+    connect(statManager, &StatManager::trafficAdded, this, &RpcManager::addTrafficToClients);
+    connect(&m_trafficAddedTimer, &TriggerTimer::timeout, this, &RpcManager::flushTrafficToClients);
     connect(statManager, &StatManager::appTrafTotalsResetted, this,
             [&] { invokeOnClients(Control::Rpc_StatManager_appTrafTotalsResetted); });
+    connect(statManager, &StatManager::shaperStatAdded, this, [&](const ShaperStat &shaperStat) {
+        invokeOnClients(Control::Rpc_StatManager_shaperStatAdded,
+                { shaperStat.queueIndex, shaperStat.sojournMaxMsecs, shaperStat.queuedBytes,
+                        shaperStat.passedBytes, shaperStat.droppedBytes, shaperStat.passedPackets,
+                        shaperStat.droppedPackets });
+    });
 }
 
 void RpcManager::setupStatBlockManagerSignals()
 {
     auto statBlockManager = IoC<StatBlockManager>();
 
-    connect(statBlockManager, &StatBlockManager::connChanged, this,
-            [&] { invokeOnClients(Control::Rpc_StatBlockManager_connChanged); });
+    connect(statBlockManager, &StatBlockManager::connChanged, this, [=, this] {
+        invokeOnClients(Control::Rpc_StatBlockManager_connChanged,
+                { statBlockManager->connIdMin(), statBlockManager->connIdMax() });
+    });
 }
 
 void RpcManager::setupTaskManagerSignals()
@@ -688,8 +754,13 @@ void RpcManager::setupClient()
 
     m_client = controlManager->newServiceClient(this);
 
-    connect(client(), &ControlWorker::connected, this,
-            [&] { invokeOnServer(Control::Rpc_RpcManager_initClient); });
+    // Subscribed by the shown windows
+    client()->setSubscriptions(Control::SubscribeNone);
+
+    connect(client(), &ControlWorker::connected, this, [&] {
+        invokeOnServer(Control::Rpc_RpcManager_initClient, { client()->subscriptions() });
+    });
+    connect(client(), &ControlWorker::disconnected, this, &RpcManager::cancelResultCallbacks);
 
     client()->setIsTryReconnect(true);
     client()->reconnectToServer();
@@ -704,17 +775,18 @@ void RpcManager::closeClient()
     client()->close();
 }
 
-bool RpcManager::waitResult()
+bool RpcManager::waitResult(quint32 requestId)
 {
     m_resultCommand = Control::CommandNone;
 
+    // The late results of the previous requests are skipped
     int waitCount = 3;
     do {
         if (!client()->waitForRead()) {
             if (--waitCount <= 0)
                 return false;
         }
-    } while (m_resultCommand == Control::CommandNone);
+    } while (m_resultCommand == Control::CommandNone || m_resultRequestId != requestId);
 
     return true;
 }
@@ -723,25 +795,21 @@ void RpcManager::sendResult(ControlWorker *w, bool ok, const QVariantList &args)
 {
     // DBG: qCDebug(LC) << "Send Result to Client: id:" << w->id() << ok << args.size();
 
-    w->sendCommand(ok ? Control::Rpc_Result_Ok : Control::Rpc_Result_Error, args);
+    w->sendCommand(ok ? Control::Rpc_Result_Ok : Control::Rpc_Result_Error, args, w->requestId());
 }
 
 bool RpcManager::invokeOnServer(Control::Command cmd, const QVariantList &args)
 {
-    if (!client()->isConnected() && !client()->reconnectToServer()) {
-        showErrorBox(tr("Service isn't available."));
-        return false;
-    }
-
-    return client()->sendCommand(cmd, args);
+    return sendToServer(cmd, args) != 0;
 }
 
 bool RpcManager::doOnServer(Control::Command cmd, const QVariantList &args, QVariantList *resArgs)
 {
-    if (!invokeOnServer(cmd, args))
+    const quint32 requestId = sendToServer(cmd, args);
+    if (requestId == 0)
         return false;
 
-    if (!waitResult()) {
+    if (!waitResult(requestId)) {
         showErrorBox(tr("Service isn't responding."));
         return false;
     }
@@ -756,34 +824,119 @@ bool RpcManager::doOnServer(Control::Command cmd, const QVariantList &args, QVar
     return true;
 }
 
+bool RpcManager::doOnServerAsync(Control::Command cmd, const QVariantList &args,
+        const std::function<rpcResultCallback> &callback)
+{
+    const quint32 requestId = sendToServer(cmd, args);
+    if (requestId == 0)
+        return false;
+
+    if (callback) {
+        m_resultCallbacks.insert(requestId, callback);
+    }
+
+    return true;
+}
+
+quint32 RpcManager::sendToServer(Control::Command cmd, const QVariantList &args)
+{
+    if (!client()->isConnected() && !client()->reconnectToServer()) {
+        showErrorBox(tr("Service isn't available."));
+        return 0;
+    }
+
+    if (++m_lastRequestId == 0) {
+        ++m_lastRequestId; // 0 is for notifications
+    }
+
+    if (!client()->sendCommand(cmd, args, m_lastRequestId))
+        return 0;
+
+    return m_lastRequestId;
+}
+
+void RpcManager::processResult(const ProcessCommandArgs &p)
+{
+    const quint32 requestId = p.worker->requestId();
+
+    const auto callback = m_resultCallbacks.take(requestId);
+    if (callback) {
+        callback(p.command == Control::Rpc_Result_Ok, p.args);
+        return;
+    }
+
+    m_resultCommand = p.command;
+    m_resultRequestId = requestId;
+    m_resultArgs = p.args;
+}
+
+void RpcManager::cancelResultCallbacks()
+{
+    const auto callbacks = m_resultCallbacks;
+    m_resultCallbacks.clear();
+
+    for (const auto &callback : callbacks) {
+        callback(/*ok=*/false, {});
+    }
+}
+
 void RpcManager::invokeOnClients(Control::Command cmd, const QVariantList &args)
 {
     const auto clients = IoC<ControlManager>()->clients();
     if (clients.isEmpty())
         return;
 
-    const QByteArray buffer = ControlWorker::buildCommandData(cmd, args);
-    if (buffer.isEmpty()) {
-        qCWarning(LC) << "Bad RPC command to invoke:" << cmd << args;
-        return;
-    }
+    // Serialized on the clients' I/O thread
+    const auto commandData = ControlCommandDataPtr::create(cmd, args);
 
     // DBG: qCDebug(LC) << "Invoke On Clients:" << cmd << args.size() << clients.size();
 
-    if (!sendCommandDataToClients(buffer, clients)) {
+    if (!sendCommandDataToClients(commandData, clients, Control::commandSubscription(cmd))) {
         qCWarning(LC) << "Invoke on clients error:" << cmd << args;
     }
 }
 
+void RpcManager::addTrafficToClients(qint64 unixTime, quint64 inBytes, quint64 outBytes)
+{
+    if (m_trafPending && m_trafUnixTime != unixTime) {
+        flushTrafficToClients();
+    }
+
+    m_trafPending = true;
+    m_trafUnixTime = unixTime;
+    m_trafInBytes += inBytes;
+    m_trafOutBytes += outBytes;
+
+    m_trafficAddedTimer.startTrigger();
+}
+
+void RpcManager::flushTrafficToClients()
+{
+    if (!m_trafPending)
+        return;
+
+    invokeOnClients(Control::Rpc_StatManager_trafficAdded,
+            { m_trafUnixTime, m_trafInBytes, m_trafOutBytes });
+
+    m_trafPending = false;
+    m_trafInBytes = 0;
+    m_trafOutBytes = 0;
+}
+
 bool RpcManager::checkClientValidated(ControlWorker *w) const
 {
     return !IoC<FortSettings>()->isPasswordRequired() || w->isClientValidated();
 }
 
-void RpcManager::initClientOnServer(ControlWorker *w) const
+void RpcManager::initClientOnServer(ControlWorker *w, const QVariantList &args) const
 {
     w->setIsServiceClient(true);
 
+    // The older clients don't declare their subscriptions
+    if (!args.isEmpty()) {
+        w->setSubscriptions(args.value(0).toUInt());
+    }
+
     w->sendCommand(Control::Rpc_DriverManager_updateState, driverManager_updateState_args());
 }
 
@@ -799,12 +952,11 @@ bool RpcManager::processCommandRpc(const ProcessCommandArgs &p)
     switch (p.command) {
     case Control::Rpc_Result_Ok:
     case Control::Rpc_Result_Error:
-        m_resultCommand = p.command;
-        m_resultArgs = p.args;
+        processResult(p);
         return true;
 
     case Control::Rpc_RpcManager_initClient:
-        initClientOnServer(p.worker);
+        initClientOnServer(p.worker, p.args);
         return true;
 
     default:
@@ -1,15 +1,21 @@
 #ifndef RPCMANAGER_H
 #define RPCMANAGER_H
 
+#include <QHash>
 #include <QObject>
 #include <QVariant>
 
+#include <functional>
+
 #include <control/control.h>
 #include <util/ioc/iocservice.h>
+#include <util/triggertimer.h>
 
 struct ProcessCommandArgs;
 class ControlWorker;
 
+using rpcResultCallback = void(bool ok, const QVariantList &resArgs);
+
 class RpcManager : public QObject, public IocService
 {
     Q_OBJECT
@@ -25,13 +31,17 @@ public:
     void setUp() override;
     void tearDown() override;
 
-    bool waitResult();
+    bool waitResult(quint32 requestId);
     void sendResult(ControlWorker *w, bool ok, const QVariantList &args = {});
 
     bool invokeOnServer(Control::Command cmd, const QVariantList &args = {});
     bool doOnServer(
             Control::Command cmd, const QVariantList &args = {}, QVariantList *resArgs = nullptr);
 
+    // Doesn't wait for the result, the callback is called on its receiving
+    bool doOnServerAsync(Control::Command cmd, const QVariantList &args = {},
+            const std::function<rpcResultCallback> &callback = {});
+
     bool processCommandRpc(const ProcessCommandArgs &p);
 
 private:
@@ -49,10 +59,18 @@ private:
     void setupClient();
     void closeClient();
 
+    quint32 sendToServer(Control::Command cmd, const QVariantList &args);
+
+    void processResult(const ProcessCommandArgs &p);
+    void cancelResultCallbacks();
+
     void invokeOnClients(Control::Command cmd, const QVariantList &args = {});
 
+    void addTrafficToClients(qint64 unixTime, quint64 inBytes, quint64 outBytes);
+    void flushTrafficToClients();
+
     bool checkClientValidated(ControlWorker *w) const;
-    void initClientOnServer(ControlWorker *w) const;
+    void initClientOnServer(ControlWorker *w, const QVariantList &args) const;
 
     QVariantList driverManager_updateState_args() const;
 
@@ -60,9 +78,21 @@ private:
 
 private:
     Control::Command m_resultCommand = Control::CommandNone;
+    quint32 m_resultRequestId = 0;
     QVariantList m_resultArgs;
 
+    quint32 m_lastRequestId = 0;
+    QHash<quint32, std::function<rpcResultCallback>> m_resultCallbacks;
+
     ControlWorker *m_client = nullptr;
+
+    // Traffic of the same time is sent to the clients in one message
+    bool m_trafPending = false;
+    qint64 m_trafUnixTime = 0;
+    quint64 m_trafInBytes = 0;
+    quint64 m_trafOutBytes = 0;
+
+    TriggerTimer m_trafficAddedTimer;
 };
 
 #endif // RPCMANAGER_H
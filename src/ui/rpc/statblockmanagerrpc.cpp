@@ -10,6 +10,13 @@ StatBlockManagerRpc::StatBlockManagerRpc(const QString &filePath, QObject *paren
 {
 }
 
+void StatBlockManagerRpc::onConnChanged(qint64 connIdMin, qint64 connIdMax)
+{
+    setConnIdRange(connIdMin, connIdMax);
+
+    emit connChanged();
+}
+
 void StatBlockManagerRpc::deleteConn(qint64 connIdTo)
 {
     IoC<RpcManager>()->doOnServer(
@@ -12,6 +12,8 @@ public:
 
     void deleteConn(qint64 connIdTo = 0) override;
 
+    void onConnChanged(qint64 connIdMin, qint64 connIdMax);
+
 protected:
     void setupWorker() override { }
     void setupConfManager() override { }
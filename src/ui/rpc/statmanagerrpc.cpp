@@ -20,7 +20,51 @@ bool StatManagerRpc::resetAppTrafTotals()
     return IoC<RpcManager>()->doOnServer(Control::Rpc_StatManager_resetAppTrafTotals);
 }
 
+QVector<TopAppTraf> StatManagerRpc::getTopApps(StatTopApps::Window window, int count)
+{
+    QVariantList resArgs;
+
+    if (!IoC<RpcManager>()->doOnServer(
+                Control::Rpc_StatManager_getTopApps, { int(window), count }, &resArgs))
+        return {};
+
+    return varListToTopApps(resArgs);
+}
+
 bool StatManagerRpc::clearTraffic()
 {
     return IoC<RpcManager>()->doOnServer(Control::Rpc_StatManager_clearTraffic);
 }
+
+QVariantList StatManagerRpc::topAppsToVarList(const QVector<TopAppTraf> &topApps)
+{
+    QStringList appPaths;
+    QVariantList inBytesList;
+    QVariantList outBytesList;
+
+    for (const TopAppTraf &topApp : topApps) {
+        appPaths.append(topApp.appPath);
+        inBytesList.append(topApp.bytes.inBytes);
+        outBytesList.append(topApp.bytes.outBytes);
+    }
+
+    return { appPaths, inBytesList, outBytesList };
+}
+
+QVector<TopAppTraf> StatManagerRpc::varListToTopApps(const QVariantList &v)
+{
+    const QStringList appPaths = v.value(0).toStringList();
+    const QVariantList inBytesList = v.value(1).toList();
+    const QVariantList outBytesList = v.value(2).toList();
+
+    QVector<TopAppTraf> topApps(appPaths.size());
+
+    for (int i = 0; i < topApps.size(); ++i) {
+        TopAppTraf &topApp = topApps[i];
+        topApp.appPath = appPaths.at(i);
+        topApp.bytes.inBytes = inBytesList.value(i).toULongLong();
+        topApp.bytes.outBytes = outBytesList.value(i).toULongLong();
+    }
+
+    return topApps;
+}
@@ -16,6 +16,11 @@ public:
 
     bool resetAppTrafTotals() override;
 
+    QVector<TopAppTraf> getTopApps(StatTopApps::Window window, int count) override;
+
+    static QVariantList topAppsToVarList(const QVector<TopAppTraf> &topApps);
+    static QVector<TopAppTraf> varListToTopApps(const QVariantList &v);
+
 public slots:
     bool clearTraffic() override;
 };
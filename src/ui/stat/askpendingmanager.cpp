@@ -2,53 +2,102 @@
 
 #include <QLoggingCategory>
 
-#include <sqlite/sqlitedb.h>
-#include <sqlite/sqlitestmt.h>
-
-#include <util/ioc/ioccontainer.h>
-
-#include "logblockedipjob.h"
-#include "statsql.h"
+#include <log/logentryblockedip.h>
 
 namespace {
 
 const QLoggingCategory LC("pendingManager");
 
+constexpr int ASK_PENDING_APPS_MAX = 64;
+constexpr int ASK_PENDING_APP_CONNS_MAX = 64;
+
+bool isSameEndpoint(const AskPendingConn &conn, const LogEntryBlockedIp &entry)
+{
+    if (conn.remotePort != entry.remotePort() || conn.ipProto != entry.ipProto()
+            || conn.isIPv6 != entry.isIPv6() || conn.inbound != entry.inbound())
+        return false;
+
+    const ip_addr_t &ip = entry.remoteIp();
+
+    return conn.isIPv6
+            ? (conn.remoteIp.v6.lo64 == ip.v6.lo64 && conn.remoteIp.v6.hi64 == ip.v6.hi64)
+            : (conn.remoteIp.v4 == ip.v4);
 }
 
-AskPendingManager::AskPendingManager(QObject *parent) :
-    QObject(parent), m_sqliteDb(new SqliteDb(":memory:"))
+}
+
+AskPendingManager::AskPendingManager(QObject *parent) : QObject(parent)
 {
+    connect(&m_pendingChangedTimer, &TriggerTimer::timeout, this, &AskPendingManager::pendingChanged);
 }
 
-void AskPendingManager::setUp()
+QVector<AskPendingConn> AskPendingManager::pendingConns(const QString &appPath) const
 {
-    setupDb();
+    return m_appConns.value(appPath);
 }
 
-bool AskPendingManager::setupDb()
+void AskPendingManager::logBlockedIp(const LogEntryBlockedIp &entry)
 {
-    if (!sqliteDb()->open()) {
-        qCCritical(LC) << "File open error:" << sqliteDb()->filePath()
-                       << sqliteDb()->errorMessage();
-        return false;
+    const QString appPath = entry.path();
+
+    auto it = m_appConns.find(appPath);
+    if (it == m_appConns.end()) {
+        if (m_appConns.size() >= ASK_PENDING_APPS_MAX) {
+            qCDebug(LC) << "Too many apps pending:" << appPath;
+            return;
+        }
+
+        it = m_appConns.insert(appPath, {});
     }
 
-    SqliteDb::MigrateOptions opt = {
-        .sqlDir = ":/stat/migrations/block",
-        .recreate = true,
-    };
+    QVector<AskPendingConn> &conns = it.value();
 
-    if (!sqliteDb()->migrate(opt)) {
-        qCCritical(LC) << "Migration error" << sqliteDb()->filePath();
-        return false;
+    const quint32 connCount = 1 + entry.repeatCount();
+    const qint64 lastConnTime = qMax(entry.connTime(), entry.lastConnTime());
+
+    // Merge the repeated connections
+    for (AskPendingConn &conn : conns) {
+        if (isSameEndpoint(conn, entry)) {
+            conn.connCount += connCount;
+            conn.lastConnTime = lastConnTime;
+            return; // the prompt shows the endpoint already
+        }
     }
 
-    return true;
+    if (conns.size() >= ASK_PENDING_APP_CONNS_MAX)
+        return;
+
+    AskPendingConn conn;
+    conn.isIPv6 = entry.isIPv6();
+    conn.inbound = entry.inbound();
+    conn.ipProto = entry.ipProto();
+    conn.remotePort = entry.remotePort();
+    conn.connCount = connCount;
+    conn.connTime = entry.connTime();
+    conn.lastConnTime = lastConnTime;
+    conn.remoteIp = entry.remoteIp();
+
+    conns.append(conn);
+
+    emitPendingChanged();
 }
 
-void AskPendingManager::logBlockedIp(const LogEntryBlockedIp &entry)
+void AskPendingManager::removeApp(const QString &appPath)
+{
+    if (m_appConns.remove(appPath) != 0) {
+        emitPendingChanged();
+    }
+}
+
+void AskPendingManager::clear()
+{
+    if (!m_appConns.isEmpty()) {
+        m_appConns.clear();
+        emitPendingChanged();
+    }
+}
+
+void AskPendingManager::emitPendingChanged()
 {
-    // TODO
-    Q_UNUSED(entry);
+    m_pendingChangedTimer.startTrigger();
 }
@@ -1,15 +1,34 @@
 #ifndef ASKPENDINGMANAGER_H
 #define ASKPENDINGMANAGER_H
 
+#include <QHash>
 #include <QObject>
+#include <QVector>
 
-#include <sqlite/sqlitetypes.h>
+#include <common/common_types.h>
 
 #include <util/classhelpers.h>
 #include <util/ioc/iocservice.h>
+#include <util/triggertimer.h>
 
 class LogEntryBlockedIp;
 
+struct AskPendingConn
+{
+    bool isIPv6 : 1 = false;
+    bool inbound : 1 = false;
+
+    quint8 ipProto = 0;
+    quint16 remotePort = 0;
+
+    quint32 connCount = 0;
+
+    qint64 connTime = 0;
+    qint64 lastConnTime = 0;
+
+    ip_addr_t remoteIp;
+};
+
 class AskPendingManager : public QObject, public IocService
 {
     Q_OBJECT
@@ -18,17 +37,25 @@ public:
     explicit AskPendingManager(QObject *parent = nullptr);
     CLASS_DELETE_COPY_MOVE(AskPendingManager)
 
-    SqliteDb *sqliteDb() const { return m_sqliteDb.data(); }
-
-    void setUp() override;
+    QStringList pendingApps() const { return m_appConns.keys(); }
+    QVector<AskPendingConn> pendingConns(const QString &appPath) const;
 
     void logBlockedIp(const LogEntryBlockedIp &entry);
 
+    void removeApp(const QString &appPath);
+    void clear();
+
+signals:
+    void pendingChanged();
+
 private:
-    bool setupDb();
+    void emitPendingChanged();
 
 private:
-    SqliteDbPtr m_sqliteDb;
+    // The app's connections by their remote endpoints
+    QHash<QString, QVector<AskPendingConn>> m_appConns;
+
+    TriggerTimer m_pendingChangedTimer;
 };
 
 #endif // ASKPENDINGMANAGER_H
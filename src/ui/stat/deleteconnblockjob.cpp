@@ -1,13 +1,28 @@
 #include "deleteconnblockjob.h"
 
+#include <limits>
+
+#include <QElapsedTimer>
+
 #include <sqlite/sqlitedb.h>
 #include <sqlite/sqlitestmt.h>
 
 #include <util/worker/workerobject.h>
 
+#include <util/ioc/ioccontainer.h>
+
+#include "statappidcache.h"
 #include "statblockmanager.h"
 #include "statsql.h"
 
+namespace {
+
+constexpr int DELETE_CHUNK_ROWS = 1000;
+constexpr int DELETE_PASS_MSECS = 50;
+constexpr int VACUUM_PASS_PAGES = 1024;
+
+}
+
 DeleteConnBlockJob::DeleteConnBlockJob(qint64 connIdTo) : m_connIdTo(connIdTo) { }
 
 bool DeleteConnBlockJob::processMerge(const StatBlockBaseJob &statJob)
@@ -28,25 +43,108 @@ void DeleteConnBlockJob::processJob()
 {
     const bool isDeleteAll = (connIdTo() <= 0);
 
-    sqliteDb()->beginWriteTransaction();
-
-    SqliteStmtList stmtList;
     if (isDeleteAll) {
-        stmtList = { getStmt(StatSql::sqlDeleteAllConnBlock), getStmt(StatSql::sqlDeleteAllApps) };
-    } else {
-        stmtList = { getIdStmt(StatSql::sqlDeleteConnBlock, connIdTo()),
-            getStmt(StatSql::sqlDeleteConnBlockApps) };
+        deleteAllConnBlock();
+    } else if (!deleteConnBlock()) {
+        // Continue after the other queued jobs
+        manager()->enqueueJob(WorkerJobPtr(new DeleteConnBlockJob(connIdTo())));
+        return;
     }
 
-    SqliteStmt::doList(stmtList);
+    setResultCount(1);
+}
+
+void DeleteConnBlockJob::deleteAllConnBlock()
+{
+    sqliteDb()->beginWriteTransaction();
+
+    dropConnBlockParts(std::numeric_limits<qint64>::max());
+
+    sqliteDb()->execute(StatSql::sqlDeleteAllConnBlock);
+
+    SqliteStmt::doList({ getStmt(StatSql::sqlDeleteAllApps) });
 
     sqliteDb()->commitTransaction();
 
-    if (isDeleteAll) {
-        sqliteDb()->vacuum(); // Vacuum outside of transaction
+    IoC<StatAppIdCache>()->clear(StatAppIdCache::DbBlock);
+
+    sqliteDb()->vacuum(); // Vacuum outside of transaction
+}
+
+bool DeleteConnBlockJob::deleteConnBlock()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    // Drop the whole closed parts at once
+    sqliteDb()->beginWriteTransaction();
+
+    dropConnBlockParts(connIdTo());
+
+    sqliteDb()->commitTransaction();
+
+    qint64 idMin, idMax;
+    StatBlockManager::getConnIdRange(sqliteDb(), idMin, idMax);
+
+    if (idMin > 0 && idMin <= connIdTo() && !deleteConnBlockPartRows(idMin, timer))
+        return false;
+
+    sqliteDb()->beginWriteTransaction();
+
+    deleteConnBlockApps();
+
+    sqliteDb()->commitTransaction();
+
+    sqliteDb()->incrementalVacuum(VACUUM_PASS_PAGES);
+    sqliteDb()->walCheckpoint();
+
+    return true;
+}
+
+bool DeleteConnBlockJob::deleteConnBlockPartRows(qint64 idMin, const QElapsedTimer &timer)
+{
+    qint64 partId = 0;
+    bool isLastPart = false;
+
+    SqliteStmt *partStmt = getIdStmt(StatSql::sqlSelectConnBlockPartOf, connIdTo());
+    if (partStmt->step() == SqliteStmt::StepRow) {
+        partId = partStmt->columnInt64(0);
+        isLastPart = partStmt->columnBool(1);
     }
+    partStmt->reset();
 
-    setResultCount(1);
+    if (partId <= 0)
+        return true;
+
+    const QString tableName = isLastPart ? "conn_block_last" : connBlockPartName(partId);
+
+    SqliteStmt stmt;
+    if (!sqliteDb()->prepare(stmt, QString("DELETE FROM %1 WHERE conn_id <= ?1;").arg(tableName)))
+        return true;
+
+    // Delete by the conn_id's chunks to not block the writer for long
+    while (idMin <= connIdTo()) {
+        const qint64 idTo = qMin(connIdTo(), idMin + DELETE_CHUNK_ROWS - 1);
+
+        sqliteDb()->beginWriteTransaction();
+
+        stmt.bindInt64(1, idTo);
+        stmt.step();
+        stmt.reset();
+
+        if (!isLastPart) {
+            sqliteDb()->executeEx(StatSql::sqlUpdateConnBlockPartMin, { partId, idTo + 1 });
+        }
+
+        sqliteDb()->commitTransaction();
+
+        idMin = idTo + 1;
+
+        if (idMin <= connIdTo() && timer.elapsed() >= DELETE_PASS_MSECS)
+            return false;
+    }
+
+    return true;
 }
 
 void DeleteConnBlockJob::emitFinished()
@@ -1,8 +1,12 @@
 #ifndef DELETECONNBLOCKJOB_H
 #define DELETECONNBLOCKJOB_H
 
+#include <QObject>
+
 #include "statblockbasejob.h"
 
+QT_FORWARD_DECLARE_CLASS(QElapsedTimer)
+
 class StatBlockManager;
 
 class DeleteConnBlockJob : public StatBlockBaseJob
@@ -19,6 +23,13 @@ protected:
     void processJob() override;
     void emitFinished() override;
 
+private:
+    void deleteAllConnBlock();
+
+    // Returns false, when the time budget is over before the end
+    bool deleteConnBlock();
+    bool deleteConnBlockPartRows(qint64 idMin, const QElapsedTimer &timer);
+
 private:
     qint64 m_connIdTo = 0;
 };
@@ -0,0 +1,126 @@
+#include "deleteoldtrafjob.h"
+
+#include <sqlite/sqlitedb.h>
+#include <sqlite/sqlitestmt.h>
+
+#include "statmanager.h"
+#include "statsql.h"
+
+namespace {
+
+constexpr int DELETE_CHUNK_ROWS = 1000;
+constexpr int DELETE_PASS_MSECS = 50;
+constexpr int VACUUM_PASS_PAGES = 1024;
+
+}
+
+DeleteOldTrafJob::DeleteOldTrafJob(
+        qint32 oldTrafHour, qint32 oldTrafDay, qint32 oldTrafMonth, qint32 archiveTrafHour) :
+    m_oldTrafHour(oldTrafHour),
+    m_oldTrafDay(oldTrafDay),
+    m_oldTrafMonth(oldTrafMonth),
+    m_archiveTrafHour(archiveTrafHour)
+{
+}
+
+bool DeleteOldTrafJob::processMerge(const StatTrafBaseJob &statJob)
+{
+    const auto &job = static_cast<const DeleteOldTrafJob &>(statJob);
+
+    // Restart by the latest traffic times
+    m_tableIndex = 0;
+
+    m_oldTrafHour = job.m_oldTrafHour;
+    m_oldTrafDay = job.m_oldTrafDay;
+    m_oldTrafMonth = job.m_oldTrafMonth;
+    m_archiveTrafHour = job.m_archiveTrafHour;
+
+    return true;
+}
+
+void DeleteOldTrafJob::processJob()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (deleteOldTraffic(timer)) {
+        sqliteDb()->incrementalVacuum(VACUUM_PASS_PAGES);
+        sqliteDb()->walCheckpoint();
+    } else {
+        // Continue after the other queued jobs
+        manager()->enqueueJob(WorkerJobPtr(new DeleteOldTrafJob(*this)));
+    }
+}
+
+bool DeleteOldTrafJob::deleteOldTraffic(const QElapsedTimer &timer)
+{
+    const qint32 oldArchiveTrafHour = manager()->isArchiveDb() ? m_oldTrafHour : -1;
+
+    const struct
+    {
+        const char *sql;
+        const char *deleteSql; // of the archived rows
+        qint32 oldTrafTime;
+    } tables[] = {
+        { StatSql::sqlArchiveTrafAppHour, StatSql::sqlDeleteArchivedTrafAppHour,
+                m_archiveTrafHour },
+        { StatSql::sqlArchiveTrafHour, StatSql::sqlDeleteArchivedTrafHour, m_archiveTrafHour },
+        { StatSql::sqlArchiveTrafUserAppHour, StatSql::sqlDeleteArchivedTrafUserAppHour,
+                m_archiveTrafHour },
+        { StatSql::sqlDeleteArchiveTrafAppHour, nullptr, oldArchiveTrafHour },
+        { StatSql::sqlDeleteArchiveTrafHour, nullptr, oldArchiveTrafHour },
+        { StatSql::sqlDeleteArchiveTrafUserAppHour, nullptr, oldArchiveTrafHour },
+        { StatSql::sqlDeleteTrafAppHour, nullptr, m_oldTrafHour },
+        { StatSql::sqlDeleteTrafHour, nullptr, m_oldTrafHour },
+        { StatSql::sqlDeleteTrafUserAppHour, nullptr, m_oldTrafHour },
+        { StatSql::sqlDeleteTrafAppDay, nullptr, m_oldTrafDay },
+        { StatSql::sqlDeleteTrafDay, nullptr, m_oldTrafDay },
+        { StatSql::sqlDeleteTrafUserAppDay, nullptr, m_oldTrafDay },
+        { StatSql::sqlDeleteTrafAppMonth, nullptr, m_oldTrafMonth },
+        { StatSql::sqlDeleteTrafMonth, nullptr, m_oldTrafMonth },
+    };
+
+    constexpr int tablesCount = sizeof(tables) / sizeof(tables[0]);
+
+    for (; m_tableIndex < tablesCount; ++m_tableIndex) {
+        const auto &table = tables[m_tableIndex];
+        if (table.oldTrafTime < 0)
+            continue;
+
+        while (deleteTableChunk(table.sql, table.deleteSql, table.oldTrafTime)) {
+            if (timer.elapsed() >= DELETE_PASS_MSECS)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool DeleteOldTrafJob::deleteTableChunk(
+        const char *sql, const char *deleteSql, qint32 oldTrafTime)
+{
+    SqliteStmt *stmt = getTrafficStmt(sql, oldTrafTime);
+
+    stmt->bindInt(2, DELETE_CHUNK_ROWS);
+
+    sqliteDb()->beginWriteTransaction();
+
+    bool ok = (stmt->step() == SqliteStmt::StepDone);
+    const int deletedCount = sqliteDb()->changes();
+    stmt->reset();
+
+    // Delete the archived chunk
+    if (ok && deleteSql) {
+        SqliteStmt *deleteStmt = getTrafficStmt(deleteSql, oldTrafTime);
+
+        deleteStmt->bindInt(2, DELETE_CHUNK_ROWS);
+
+        ok = (deleteStmt->step() == SqliteStmt::StepDone);
+        deleteStmt->reset();
+    }
+
+    sqliteDb()->endTransaction(ok);
+
+    // Is the table's chunk full, to continue
+    return ok && deletedCount >= DELETE_CHUNK_ROWS;
+}
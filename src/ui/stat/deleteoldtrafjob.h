@@ -0,0 +1,38 @@
+#ifndef DELETEOLDTRAFJOB_H
+#define DELETEOLDTRAFJOB_H
+
+#include <QElapsedTimer>
+
+#include "stattrafbasejob.h"
+
+class DeleteOldTrafJob : public StatTrafBaseJob
+{
+public:
+    // The traffic is deleted before the traffic times, -1 to keep it.
+    // The hours' traffic is moved to the archive DB before the archive's hour.
+    explicit DeleteOldTrafJob(qint32 oldTrafHour, qint32 oldTrafDay, qint32 oldTrafMonth,
+            qint32 archiveTrafHour = -1);
+
+    StatTrafJobType jobType() const override { return JobTypeDeleteOldTraf; }
+
+protected:
+    bool processMerge(const StatTrafBaseJob &statJob) override;
+    void processJob() override;
+    void emitFinished() override { }
+
+private:
+    // Returns false, when the time budget is over before the end
+    bool deleteOldTraffic(const QElapsedTimer &timer);
+
+    bool deleteTableChunk(const char *sql, const char *deleteSql, qint32 oldTrafTime);
+
+private:
+    int m_tableIndex = 0; // to continue by the next pass
+
+    qint32 m_oldTrafHour = -1;
+    qint32 m_oldTrafDay = -1;
+    qint32 m_oldTrafMonth = -1;
+    qint32 m_archiveTrafHour = -1;
+};
+
+#endif // DELETEOLDTRAFJOB_H
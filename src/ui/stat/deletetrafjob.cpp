@@ -0,0 +1,95 @@
+#include "deletetrafjob.h"
+
+#include <sqlite/sqlitedb.h>
+#include <sqlite/sqlitestmt.h>
+
+#include <util/ioc/ioccontainer.h>
+
+#include "statappidcache.h"
+#include "statmanager.h"
+#include "statsql.h"
+
+DeleteTrafJob::DeleteTrafJob(DeleteType deleteType, qint64 appId, qint32 trafHour) :
+    m_deleteType(deleteType), m_trafHour(trafHour), m_appId(appId)
+{
+}
+
+bool DeleteTrafJob::processMerge(const StatTrafBaseJob & /*statJob*/)
+{
+    return false;
+}
+
+void DeleteTrafJob::processJob()
+{
+    switch (deleteType()) {
+    case DeleteAll:
+        deleteAll();
+        break;
+    case DeleteApp:
+        deleteApp();
+        break;
+    case ResetAppTotals:
+        resetAppTotals();
+        break;
+    }
+
+    setResultCount(1);
+}
+
+void DeleteTrafJob::emitFinished()
+{
+    switch (deleteType()) {
+    case DeleteAll:
+        emit manager()->trafficCleared();
+        break;
+    case DeleteApp:
+        emit manager()->appStatRemoved(m_appId);
+        break;
+    case ResetAppTotals:
+        emit manager()->appTrafTotalsResetted();
+        break;
+    }
+}
+
+void DeleteTrafJob::deleteAll()
+{
+    sqliteDb()->beginWriteTransaction();
+    sqliteDb()->execute(StatSql::sqlDeleteAllTraffic);
+    if (manager()->isArchiveDb()) {
+        sqliteDb()->execute(StatSql::sqlDeleteAllArchiveTraffic);
+    }
+    sqliteDb()->commitTransaction();
+
+    IoC<StatAppIdCache>()->clear(StatAppIdCache::DbTraf);
+
+    sqliteDb()->vacuum(); // Vacuum outside of transaction
+}
+
+void DeleteTrafJob::deleteApp()
+{
+    sqliteDb()->beginWriteTransaction();
+
+    SqliteStmt::doList({ getIdStmt(StatSql::sqlDeleteAppTrafHour, m_appId),
+            getIdStmt(StatSql::sqlDeleteAppTrafDay, m_appId),
+            getIdStmt(StatSql::sqlDeleteAppTrafMonth, m_appId),
+            getIdStmt(StatSql::sqlDeleteAppTrafTotal, m_appId),
+            getIdStmt(StatSql::sqlDeleteAppTrafUserHour, m_appId),
+            getIdStmt(StatSql::sqlDeleteAppTrafUserDay, m_appId),
+            getIdStmt(StatSql::sqlDeleteAppId, m_appId) });
+
+    if (manager()->isArchiveDb()) {
+        SqliteStmt::doList({ getIdStmt(StatSql::sqlDeleteAppArchiveTrafHour, m_appId),
+                getIdStmt(StatSql::sqlDeleteAppArchiveTrafUserHour, m_appId) });
+    }
+
+    sqliteDb()->commitTransaction();
+
+    IoC<StatAppIdCache>()->clear(StatAppIdCache::DbTraf);
+}
+
+void DeleteTrafJob::resetAppTotals()
+{
+    SqliteStmt *stmt = getTrafficStmt(StatSql::sqlResetAppTrafTotals, m_trafHour);
+
+    sqliteDb()->done(stmt);
+}
@@ -0,0 +1,34 @@
+#ifndef DELETETRAFJOB_H
+#define DELETETRAFJOB_H
+
+#include "stattrafbasejob.h"
+
+class DeleteTrafJob : public StatTrafBaseJob
+{
+public:
+    enum DeleteType : qint8 { DeleteAll, DeleteApp, ResetAppTotals };
+
+    explicit DeleteTrafJob(DeleteType deleteType, qint64 appId = 0, qint32 trafHour = 0);
+
+    DeleteType deleteType() const { return m_deleteType; }
+
+    StatTrafJobType jobType() const override { return JobTypeDeleteTraf; }
+
+protected:
+    bool processMerge(const StatTrafBaseJob &statJob) override;
+    void processJob() override;
+    void emitFinished() override;
+
+private:
+    void deleteAll();
+    void deleteApp();
+    void resetAppTotals();
+
+private:
+    DeleteType m_deleteType = DeleteAll;
+
+    qint32 m_trafHour = 0;
+    qint64 m_appId = 0;
+};
+
+#endif // DELETETRAFJOB_H
@@ -5,8 +5,10 @@
 #include <sqlite/sqlitedb.h>
 #include <sqlite/sqlitestmt.h>
 
+#include <util/ioc/ioccontainer.h>
 #include <util/worker/workerobject.h>
 
+#include "statappidcache.h"
 #include "statblockmanager.h"
 #include "statsql.h"
 
@@ -14,10 +16,64 @@ namespace {
 
 constexpr qint64 INVALID_APP_ID = Q_INT64_C(-1);
 constexpr int MAX_LOG_BLOCKED_IP_MERGE_COUNT = 1000;
+constexpr int MAX_LOG_BLOCKED_IP_MERGE_SCALE = 4;
+
+constexpr int CONN_BLOCK_COLUMNS_COUNT = 13;
+
+// The parts' size by the keep count, to keep it by the few ones
+constexpr int CONN_BLOCK_KEEP_PARTS = 8;
+constexpr int CONN_BLOCK_PART_ROWS_MIN = 1000;
+constexpr int CONN_BLOCK_PART_ROWS_MAX = 1000000;
+
+// Descending row counts of the multi-row inserts
+constexpr int insertConnRowCounts[] = { 64, 16, 4 };
+constexpr int insertConnRowCountsSize = sizeof(insertConnRowCounts) / sizeof(int);
+
+QByteArray buildInsertConnsSql(int rowCount)
+{
+    QByteArray sql = StatSql::sqlInsertConnBlockRows;
+
+    for (int i = 0; i < rowCount; ++i) {
+        sql += (i == 0) ? " (" : ", (";
+
+        for (int col = 0; col < CONN_BLOCK_COLUMNS_COUNT; ++col) {
+            sql += (col == 0) ? "?" : ", ?";
+        }
+
+        sql += ')';
+    }
+
+    sql += ';';
+
+    return sql;
+}
+
+const char *getInsertConnsSql(int index)
+{
+    static const QByteArray sqls[] = {
+        buildInsertConnsSql(insertConnRowCounts[0]),
+        buildInsertConnsSql(insertConnRowCounts[1]),
+        buildInsertConnsSql(insertConnRowCounts[2]),
+    };
+
+    return sqls[index].constData();
+}
+
+int connBlockPartRows(int keepCount)
+{
+    if (keepCount <= 0)
+        return CONN_BLOCK_PART_ROWS_MAX; // keep all
+
+    return qBound(CONN_BLOCK_PART_ROWS_MIN, keepCount / CONN_BLOCK_KEEP_PARTS,
+            CONN_BLOCK_PART_ROWS_MAX);
+}
 
 }
 
-LogBlockedIpJob::LogBlockedIpJob(const LogEntryBlockedIp &entry)
+LogBlockedIpJob::LogBlockedIpJob(const LogEntryBlockedIp &entry, int keepCount, int backlogCount) :
+    m_keepCount(keepCount),
+    m_mergeMax(MAX_LOG_BLOCKED_IP_MERGE_COUNT
+            * (1 + qBound(0, backlogCount, MAX_LOG_BLOCKED_IP_MERGE_SCALE - 1)))
 {
     m_entries.append(entry);
 }
@@ -26,11 +82,14 @@ bool LogBlockedIpJob::processMerge(const StatBlockBaseJob &statJob)
 {
     const auto &job = static_cast<const LogBlockedIpJob &>(statJob);
 
-    if (m_entries.size() >= MAX_LOG_BLOCKED_IP_MERGE_COUNT)
+    // Merge more by the backlog of the new job
+    if (m_entries.size() >= job.mergeMax())
         return false;
 
     m_entries.append(job.entries());
 
+    m_keepCount = job.keepCount();
+
     return true;
 }
 
@@ -40,13 +99,37 @@ void LogBlockedIpJob::processJob()
 
     sqliteDb()->beginWriteTransaction();
 
+    QVector<ConnAppEntry> conns;
+    conns.reserve(entries().size());
+
     for (const LogEntryBlockedIp &entry : entries()) {
-        if (processEntry(entry)) {
-            ++resultCount;
+        if (entry.repeatCount() != 0) {
+            // The repeat may refer to the pending connections
+            resultCount += insertConns(conns);
+
+            if (updateConnRepeat(entry)) {
+                ++resultCount;
+            }
+            continue;
         }
+
+        const qint64 appId = getOrCreateAppId(entry.path(), entry.connTime());
+        if (appId == INVALID_APP_ID)
+            continue;
+
+        conns.append({ &entry, appId });
+    }
+
+    resultCount += insertConns(conns);
+
+    if (m_connId > 0) {
+        closeConnBlockPart();
+        dropOldConnBlockParts();
     }
 
-    sqliteDb()->endTransaction();
+    if (!sqliteDb()->endTransaction()) {
+        IoC<StatAppIdCache>()->clear(StatAppIdCache::DbBlock); // the created apps are lost
+    }
 
     setResultCount(resultCount);
 }
@@ -56,23 +139,6 @@ void LogBlockedIpJob::emitFinished()
     emit manager()->logBlockedIpFinished(resultCount(), m_connId);
 }
 
-bool LogBlockedIpJob::processEntry(const LogEntryBlockedIp &entry)
-{
-    const qint64 appId = getOrCreateAppId(entry.path(), entry.connTime());
-    if (appId == INVALID_APP_ID)
-        return false;
-
-    const qint64 connId = insertConn(entry, appId);
-    if (connId <= 0)
-        return false;
-
-    if (m_connId < connId) {
-        m_connId = connId;
-    }
-
-    return true;
-}
-
 qint64 LogBlockedIpJob::getAppId(const QString &appPath)
 {
     qint64 appId = INVALID_APP_ID;
@@ -104,46 +170,170 @@ qint64 LogBlockedIpJob::createAppId(const QString &appPath, qint64 unixTime)
 
 qint64 LogBlockedIpJob::getOrCreateAppId(const QString &appPath, qint64 unixTime)
 {
-    qint64 appId = getAppId(appPath);
+    auto appIdCache = IoC<StatAppIdCache>();
+
+    qint64 appId = appIdCache->appId(StatAppIdCache::DbBlock, appPath);
+    if (appId != INVALID_APP_ID)
+        return appId;
+
+    appId = getAppId(appPath);
     if (appId == INVALID_APP_ID) {
         appId = createAppId(appPath, unixTime);
     }
 
     Q_ASSERT(appId != INVALID_APP_ID);
 
+    appIdCache->insert(StatAppIdCache::DbBlock, appPath, appId);
+
     return appId;
 }
 
-qint64 LogBlockedIpJob::insertConn(const LogEntryBlockedIp &entry, qint64 appId)
+int LogBlockedIpJob::insertConns(QVector<ConnAppEntry> &conns)
+{
+    int resultCount = 0;
+    int connIndex = 0;
+
+    for (int i = 0; i < insertConnRowCountsSize; ++i) {
+        const int rowCount = insertConnRowCounts[i];
+
+        while (conns.size() - connIndex >= rowCount) {
+            resultCount += insertConnRows(getInsertConnsSql(i), conns, connIndex, rowCount);
+            connIndex += rowCount;
+        }
+    }
+
+    while (connIndex < conns.size()) {
+        resultCount += insertConnRows(StatSql::sqlInsertConnBlock, conns, connIndex, 1);
+        ++connIndex;
+    }
+
+    conns.clear();
+
+    return resultCount;
+}
+
+int LogBlockedIpJob::insertConnRows(
+        const char *sql, const QVector<ConnAppEntry> &conns, int connIndex, int rowCount)
+{
+    SqliteStmt *stmt = getStmt(sql);
+
+    for (int row = 0; row < rowCount; ++row) {
+        const ConnAppEntry &conn = conns.at(connIndex + row);
+
+        bindConn(stmt, row * CONN_BLOCK_COLUMNS_COUNT, *conn.entry, conn.appId);
+    }
+
+    if (!sqliteDb()->done(stmt))
+        return 0;
+
+    // The rowids of the inserted rows are sequential
+    m_connId = sqliteDb()->lastInsertRowid();
+
+    return rowCount;
+}
+
+void LogBlockedIpJob::bindConn(
+        SqliteStmt *stmt, int paramOffset, const LogEntryBlockedIp &entry, qint64 appId)
+{
+    stmt->bindInt64(paramOffset + 1, appId);
+    stmt->bindInt64(paramOffset + 2, entry.connTime());
+    stmt->bindInt(paramOffset + 3, entry.pid());
+    stmt->bindInt(paramOffset + 4, entry.inbound());
+    stmt->bindInt(paramOffset + 5, entry.inherited());
+    stmt->bindInt(paramOffset + 6, entry.ipProto());
+    stmt->bindInt(paramOffset + 7, entry.localPort());
+    stmt->bindInt(paramOffset + 8, entry.remotePort());
+
+    if (!entry.isIPv6()) {
+        stmt->bindInt(paramOffset + 9, entry.localIp4());
+        stmt->bindInt(paramOffset + 10, entry.remoteIp4());
+        stmt->bindNull(paramOffset + 11);
+        stmt->bindNull(paramOffset + 12);
+    } else {
+        stmt->bindNull(paramOffset + 9);
+        stmt->bindNull(paramOffset + 10);
+        stmt->bindBlob(paramOffset + 11, entry.localIp6());
+        stmt->bindBlob(paramOffset + 12, entry.remoteIp6());
+    }
+
+    stmt->bindInt(paramOffset + 13, entry.blockReason());
+}
+
+bool LogBlockedIpJob::updateConnRepeat(const LogEntryBlockedIp &entry)
 {
-    SqliteStmt *stmt = getStmt(StatSql::sqlInsertConnBlock);
+    SqliteStmt *stmt = getStmt(StatSql::sqlUpdateConnBlockRepeat);
 
-    stmt->bindInt64(1, appId);
-    stmt->bindInt64(2, entry.connTime());
+    stmt->bindInt(1, entry.repeatCount());
+    stmt->bindInt64(2, entry.lastConnTime());
     stmt->bindInt(3, entry.pid());
     stmt->bindInt(4, entry.inbound());
-    stmt->bindInt(5, entry.inherited());
-    stmt->bindInt(6, entry.ipProto());
-    stmt->bindInt(7, entry.localPort());
-    stmt->bindInt(8, entry.remotePort());
+    stmt->bindInt(5, entry.ipProto());
+    stmt->bindInt(6, entry.remotePort());
 
     if (!entry.isIPv6()) {
-        stmt->bindInt(9, entry.localIp4());
-        stmt->bindInt(10, entry.remoteIp4());
-        stmt->bindNull(11);
-        stmt->bindNull(12);
+        stmt->bindInt(7, entry.remoteIp4());
+        stmt->bindNull(8);
     } else {
-        stmt->bindNull(9);
-        stmt->bindNull(10);
-        stmt->bindBlob(11, entry.localIp6());
-        stmt->bindBlob(12, entry.remoteIp6());
+        stmt->bindNull(7);
+        stmt->bindBlob(8, entry.remoteIp6());
     }
 
-    stmt->bindInt(13, entry.blockReason());
+    stmt->bindInt(9, entry.blockReason());
 
-    if (sqliteDb()->done(stmt)) {
-        return sqliteDb()->lastInsertRowid();
+    return sqliteDb()->done(stmt) && sqliteDb()->changes() > 0;
+}
+
+bool LogBlockedIpJob::closeConnBlockPart()
+{
+    qint64 partId = 0;
+    qint64 partConnIdMin = 0;
+
+    SqliteStmt *stmt = getStmt(StatSql::sqlSelectConnBlockLastPart);
+    if (stmt->step() == SqliteStmt::StepRow) {
+        partId = stmt->columnInt64(0);
+        partConnIdMin = stmt->columnInt64(1);
     }
+    stmt->reset();
+
+    if (partId <= 0 || m_connId - partConnIdMin + 1 < connBlockPartRows(m_keepCount))
+        return false;
+
+    const auto vars =
+            sqliteDb()->executeEx(StatSql::sqlSelectMinMaxConnBlockLastId, {}, 2).toList();
+    const qint64 connIdMin = vars.value(0).toLongLong();
+    const qint64 connIdMax = vars.value(1).toLongLong();
+    if (connIdMax <= 0)
+        return false;
 
-    return 0;
+    const qint64 newPartId = partId + 1;
+
+    // The view must not refer to the renamed table
+    dropConnBlockView();
+
+    // The cached statements are re-prepared for the new last table by its name
+    sqliteDb()->executeStr(QString("ALTER TABLE conn_block_last RENAME TO %1;")
+                                   .arg(connBlockPartName(partId)));
+
+    sqliteDb()->execute(StatSql::sqlCreateConnBlockLast);
+    sqliteDb()->executeStr(QString("CREATE INDEX %1_app_id_idx ON conn_block_last(app_id);")
+                                   .arg(connBlockPartName(newPartId)));
+
+    // Continue the conn_id's sequence
+    sqliteDb()->executeEx(StatSql::sqlInsertConnBlockLastSeq, { connIdMax });
+
+    sqliteDb()->executeEx(StatSql::sqlCloseConnBlockPart, { partId, connIdMin, connIdMax });
+    sqliteDb()->executeEx(StatSql::sqlInsertConnBlockPart, { newPartId, connIdMax + 1 });
+
+    return createConnBlockView();
+}
+
+void LogBlockedIpJob::dropOldConnBlockParts()
+{
+    if (m_keepCount <= 0)
+        return;
+
+    // Drop the whole tables instead of deleting the rows
+    if (dropConnBlockParts(m_connId - m_keepCount) > 0) {
+        deleteConnBlockApps();
+    }
 }
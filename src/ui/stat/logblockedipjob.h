@@ -12,7 +12,12 @@ class StatBlockManager;
 class LogBlockedIpJob : public StatBlockBaseJob
 {
 public:
-    explicit LogBlockedIpJob(const LogEntryBlockedIp &entry);
+    // The oldest closed parts over the keep count are dropped
+    explicit LogBlockedIpJob(
+            const LogEntryBlockedIp &entry, int keepCount = 0, int backlogCount = 0);
+
+    int keepCount() const { return m_keepCount; }
+    int mergeMax() const { return m_mergeMax; }
 
     const QVector<LogEntryBlockedIp> &entries() const { return m_entries; }
 
@@ -24,15 +29,32 @@ protected:
     void emitFinished() override;
 
 private:
-    bool processEntry(const LogEntryBlockedIp &entry);
+    struct ConnAppEntry
+    {
+        const LogEntryBlockedIp *entry;
+        qint64 appId;
+    };
 
     qint64 getAppId(const QString &appPath);
     qint64 createAppId(const QString &appPath, qint64 unixTime);
     qint64 getOrCreateAppId(const QString &appPath, qint64 unixTime = 0);
 
-    qint64 insertConn(const LogEntryBlockedIp &entry, qint64 appId);
+    int insertConns(QVector<ConnAppEntry> &conns);
+    int insertConnRows(
+            const char *sql, const QVector<ConnAppEntry> &conns, int connIndex, int rowCount);
+
+    static void bindConn(
+            SqliteStmt *stmt, int paramOffset, const LogEntryBlockedIp &entry, qint64 appId);
+    bool updateConnRepeat(const LogEntryBlockedIp &entry);
+
+    // Start the new last part, when the last one is full
+    bool closeConnBlockPart();
+    void dropOldConnBlockParts();
 
 private:
+    int m_keepCount = 0;
+    int m_mergeMax = 0;
+
     qint64 m_connId = 0;
 
     QVector<LogEntryBlockedIp> m_entries;
@@ -6,8 +6,18 @@ CREATE TABLE app(
 
 CREATE UNIQUE INDEX app_path_uk ON app(path);
 
-CREATE TABLE conn_block(
-  conn_id INTEGER PRIMARY KEY,
+-- The conn_id's ranges of the "conn_block_<part_id>" tables, the last one is open
+CREATE TABLE conn_block_part(
+  part_id INTEGER PRIMARY KEY,
+  conn_id_min INTEGER NOT NULL,
+  conn_id_max INTEGER
+);
+
+INSERT INTO conn_block_part(part_id, conn_id_min) VALUES(1, 1);
+
+-- The inserted rows, renamed to the "conn_block_<part_id>" when full
+CREATE TABLE conn_block_last(
+  conn_id INTEGER PRIMARY KEY AUTOINCREMENT,
   app_id INTEGER NOT NULL,
   conn_time INTEGER NOT NULL,
   process_id INTEGER NOT NULL,
@@ -21,7 +31,12 @@ CREATE TABLE conn_block(
   local_ip6 BLOB,
   remote_ip6 BLOB,
   --
-  block_reason INTEGER NOT NULL
+  block_reason INTEGER NOT NULL,
+  repeat_count INTEGER NOT NULL DEFAULT 0,
+  last_time INTEGER
 );
 
-CREATE INDEX conn_block_app_id_idx ON conn_block(app_id);
+CREATE INDEX conn_block_1_app_id_idx ON conn_block_last(app_id);
+
+-- The union of the parts
+CREATE VIEW conn_block AS SELECT * FROM conn_block_last;
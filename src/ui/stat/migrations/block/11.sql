@@ -0,0 +1,4 @@
+-- The blocked connections' filter by the apps' paths, its triggers are of the migration options
+CREATE VIRTUAL TABLE app_fts USING fts5(path, content='app', content_rowid='app_id');
+
+INSERT INTO app_fts(app_fts) VALUES('rebuild');
@@ -37,6 +37,36 @@ CREATE TABLE traffic_app_month(
   PRIMARY KEY (app_id, traf_time)
 ) WITHOUT ROWID;
 
+CREATE TABLE user(
+  user_id INTEGER PRIMARY KEY,
+  name TEXT NOT NULL,
+  creat_time INTEGER NOT NULL
+);
+
+CREATE UNIQUE INDEX user_name_uk ON user(name);
+
+CREATE TABLE traffic_user_app_hour(
+  user_id INTEGER NOT NULL,
+  app_id INTEGER NOT NULL,
+  traf_time INTEGER NOT NULL,
+  in_bytes INTEGER NOT NULL,
+  out_bytes INTEGER NOT NULL,
+  PRIMARY KEY (user_id, app_id, traf_time)
+) WITHOUT ROWID;
+
+CREATE INDEX traffic_user_app_hour_time_idx ON traffic_user_app_hour(traf_time);
+
+CREATE TABLE traffic_user_app_day(
+  user_id INTEGER NOT NULL,
+  app_id INTEGER NOT NULL,
+  traf_time INTEGER NOT NULL,
+  in_bytes INTEGER NOT NULL,
+  out_bytes INTEGER NOT NULL,
+  PRIMARY KEY (user_id, app_id, traf_time)
+) WITHOUT ROWID;
+
+CREATE INDEX traffic_user_app_day_time_idx ON traffic_user_app_day(traf_time);
+
 CREATE TABLE traffic_hour(
   traf_time INTEGER PRIMARY KEY,
   in_bytes INTEGER NOT NULL,
@@ -2,6 +2,8 @@
 
 #include <conf/confmanager.h>
 #include <conf/firewallconf.h>
+#include <driver/drivermanager.h>
+#include <log/logentryquota.h>
 #include <stat/statmanager.h>
 #include <util/dateutil.h>
 #include <util/ioc/ioccontainer.h>
@@ -32,16 +34,6 @@ void QuotaManager::setQuotaMonthBytes(qint64 bytes)
     }
 }
 
-void QuotaManager::setTrafDayBytes(qint64 bytes)
-{
-    m_trafDayBytes = bytes;
-}
-
-void QuotaManager::setTrafMonthBytes(qint64 bytes)
-{
-    m_trafMonthBytes = bytes;
-}
-
 void QuotaManager::setUp()
 {
     setupConfManager();
@@ -50,57 +42,39 @@ void QuotaManager::setUp()
 void QuotaManager::clear(bool clearDay, bool clearMonth)
 {
     if (clearDay) {
-        m_trafDayBytes = 0;
-
         setQuotaDayAlerted(0);
     }
 
     if (clearMonth) {
-        m_trafMonthBytes = 0;
-
         setQuotaMonthAlerted(0);
     }
-}
 
-void QuotaManager::addTraf(qint64 bytes)
-{
-    m_trafDayBytes += bytes;
-    m_trafMonthBytes += bytes;
+    startPeriods(clearDay, clearMonth);
 }
 
-void QuotaManager::checkQuotaDay(qint32 trafDay)
+void QuotaManager::startPeriods(bool isNewDay, bool isNewMonth)
 {
-    if (m_quotaDayBytes == 0)
-        return;
+    const quint8 setBits = (isNewDay ? AlertDay : 0) | (isNewMonth ? AlertMonth : 0);
 
-    if (m_quotaDayAlerted == 0) {
-        m_quotaDayAlerted = quotaDayAlerted();
-    }
-
-    if (m_quotaDayAlerted == trafDay)
-        return;
-
-    if (m_trafDayBytes > m_quotaDayBytes) {
-        setQuotaDayAlerted(trafDay);
-
-        processQuotaExceed(AlertDay);
+    if (setBits != 0) {
+        writeDriverQuota(0, 0, setBits, /*alertedBits=*/0);
     }
 }
 
-void QuotaManager::checkQuotaMonth(qint32 trafMonth)
+void QuotaManager::logQuota(const LogEntryQuota &entry, qint64 unixTime)
 {
-    if (m_quotaMonthBytes == 0)
-        return;
+    const quint8 quotaBits = entry.quotaBits();
+
+    if ((quotaBits & AlertDay) != 0) {
+        setQuotaDayAlerted(DateUtil::getUnixDay(unixTime));
 
-    if (m_quotaMonthAlerted == 0) {
-        m_quotaMonthAlerted = quotaMonthAlerted();
+        processQuotaExceed(AlertDay);
     }
 
-    if (m_quotaMonthAlerted == trafMonth)
-        return;
+    if ((quotaBits & AlertMonth) != 0) {
+        const IniOptions &ini = IoC<ConfManager>()->conf()->ini();
 
-    if (m_trafMonthBytes > m_quotaMonthBytes) {
-        setQuotaMonthAlerted(trafMonth);
+        setQuotaMonthAlerted(DateUtil::getUnixMonth(unixTime, ini.monthStart()));
 
         processQuotaExceed(AlertMonth);
     }
@@ -139,8 +113,6 @@ void QuotaManager::setQuotaDayAlerted(int v)
     auto confManager = IoC<ConfManager>();
     IniOptions &ini = confManager->conf()->ini();
 
-    m_quotaDayAlerted = v;
-
     if (ini.quotaDayAlerted() != v) {
         ini.setQuotaDayAlerted(v);
         confManager->saveIni();
@@ -160,19 +132,24 @@ void QuotaManager::setQuotaMonthAlerted(int v)
     auto confManager = IoC<ConfManager>();
     IniOptions &ini = confManager->conf()->ini();
 
-    m_quotaMonthAlerted = v;
-
     if (ini.quotaMonthAlerted() != v) {
         ini.setQuotaMonthAlerted(v);
         confManager->saveIni();
     }
 }
 
+void QuotaManager::writeDriverQuota(
+        qint64 dayBytes, qint64 monthBytes, quint8 setBits, quint8 alertedBits)
+{
+    IoC<DriverManager>()->writeQuota(quint64(dayBytes), quint64(monthBytes), setBits, alertedBits);
+}
+
 void QuotaManager::processQuotaExceed(AlertType alertType)
 {
     auto confManager = IoC<ConfManager>();
     FirewallConf *conf = confManager->conf();
 
+    // The driver has blocked the internet traffic already, keep the conf in sync
     if (conf->ini().quotaBlockInetTraffic() && !conf->blockInetTraffic()) {
         conf->setBlockInetTraffic(true);
         confManager->saveFlags();
@@ -191,11 +168,18 @@ void QuotaManager::setupByConf(const IniOptions &ini)
     const qint32 trafMonth = DateUtil::getUnixMonth(unixTime, ini.monthStart());
 
     auto statManager = IoC<StatManager>();
-    qint64 inBytes, outBytes;
+    qint64 dayInBytes, monthInBytes, outBytes;
 
-    statManager->getTraffic(StatSql::sqlSelectTrafDay, trafDay, inBytes, outBytes);
-    setTrafDayBytes(inBytes);
+    statManager->getTraffic(StatSql::sqlSelectTrafDay, trafDay, dayInBytes, outBytes);
+    statManager->getTraffic(StatSql::sqlSelectTrafMonth, trafMonth, monthInBytes, outBytes);
+
+    quint8 alertedBits = 0;
+    if (quotaDayAlerted() == trafDay) {
+        alertedBits |= AlertDay;
+    }
+    if (quotaMonthAlerted() == trafMonth) {
+        alertedBits |= AlertMonth;
+    }
 
-    statManager->getTraffic(StatSql::sqlSelectTrafMonth, trafMonth, inBytes, outBytes);
-    setTrafMonthBytes(inBytes);
+    writeDriverQuota(dayInBytes, monthInBytes, AlertDay | AlertMonth, alertedBits);
 }
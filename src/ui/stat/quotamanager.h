@@ -6,29 +6,31 @@
 #include <util/ioc/iocservice.h>
 
 class IniOptions;
+class LogEntryQuota;
 
 class QuotaManager : public QObject, public IocService
 {
     Q_OBJECT
 
 public:
-    enum AlertType : qint8 { AlertDay = 1, AlertMonth };
+    // Bits of the driver's FORT_QUOTA_*
+    enum AlertType : qint8 { AlertDay = 0x01, AlertMonth = 0x02 };
 
     explicit QuotaManager(QObject *parent = nullptr);
 
     void setQuotaDayBytes(qint64 bytes);
     void setQuotaMonthBytes(qint64 bytes);
 
-    void setTrafDayBytes(qint64 bytes);
-    void setTrafMonthBytes(qint64 bytes);
-
     void setUp() override;
 
     void clear(bool clearDay = true, bool clearMonth = true);
-    void addTraf(qint64 bytes);
 
-    void checkQuotaDay(qint32 trafDay);
-    void checkQuotaMonth(qint32 trafMonth);
+    // Reset the driver's quotas' traffic by the new periods; the alerted periods are kept,
+    // as they differ from the new ones
+    void startPeriods(bool isNewDay, bool isNewMonth);
+
+    // The driver counts the quotas' traffic and reports their exceeding
+    void logQuota(const LogEntryQuota &entry, qint64 unixTime);
 
     static QString alertTypeText(qint8 alertType);
 
@@ -44,20 +46,17 @@ protected:
     virtual int quotaMonthAlerted() const;
     virtual void setQuotaMonthAlerted(qint32 v);
 
+    virtual void writeDriverQuota(
+            qint64 dayBytes, qint64 monthBytes, quint8 setBits, quint8 alertedBits);
+
 private:
     void processQuotaExceed(AlertType alertType);
 
     void setupByConf(const IniOptions &ini);
 
 private:
-    int m_quotaDayAlerted = 0;
-    int m_quotaMonthAlerted = 0;
-
     qint64 m_quotaDayBytes = 0;
     qint64 m_quotaMonthBytes = 0;
-
-    qint64 m_trafDayBytes = 0;
-    qint64 m_trafMonthBytes = 0;
 };
 
 #endif // QUOTAMANAGER_H
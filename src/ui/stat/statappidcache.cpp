@@ -0,0 +1,38 @@
+#include "statappidcache.h"
+
+StatAppIdCache::StatAppIdCache(int maxCount)
+{
+    for (auto &cache : m_caches) {
+        cache.setMaxCost(maxCount);
+    }
+}
+
+qint64 StatAppIdCache::appId(DbType dbType, const QString &appPath)
+{
+    QMutexLocker locker(&m_mutex);
+
+    const qint64 *appId = m_caches[dbType].object(appPath);
+
+    return appId ? *appId : -1;
+}
+
+void StatAppIdCache::insert(DbType dbType, const QString &appPath, qint64 appId)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_caches[dbType].insert(appPath, new qint64(appId));
+}
+
+void StatAppIdCache::remove(DbType dbType, const QString &appPath)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_caches[dbType].remove(appPath);
+}
+
+void StatAppIdCache::clear(DbType dbType)
+{
+    QMutexLocker locker(&m_mutex);
+
+    m_caches[dbType].clear();
+}
@@ -0,0 +1,33 @@
+#ifndef STATAPPIDCACHE_H
+#define STATAPPIDCACHE_H
+
+#include <QCache>
+#include <QMutex>
+
+#include <util/classhelpers.h>
+#include <util/ioc/iocservice.h>
+
+// Thread-safe LRU cache of the app ids by the app paths, used by the stat workers
+class StatAppIdCache : public IocService
+{
+public:
+    enum DbType : qint8 { DbTraf = 0, DbBlock, DbTypeCount }; // the DBs have own app ids
+
+    explicit StatAppIdCache(int maxCount = 1024);
+    CLASS_DELETE_COPY_MOVE(StatAppIdCache)
+
+    // Returns -1, when the app's path is not cached
+    qint64 appId(DbType dbType, const QString &appPath);
+
+    void insert(DbType dbType, const QString &appPath, qint64 appId);
+    void remove(DbType dbType, const QString &appPath);
+
+    void clear(DbType dbType);
+
+private:
+    QMutex m_mutex;
+
+    QCache<QString, qint64> m_caches[DbTypeCount];
+};
+
+#endif // STATAPPIDCACHE_H
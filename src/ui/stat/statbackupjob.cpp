@@ -0,0 +1,77 @@
+#include "statbackupjob.h"
+
+#include <QLoggingCategory>
+
+#include <sqlite/sqlitebackup.h>
+#include <sqlite/sqlitedb.h>
+
+#include <util/fileutil.h>
+
+#include "statmanager.h"
+
+namespace {
+
+const QLoggingCategory LC("stat.backup");
+
+constexpr int BACKUP_PASS_PAGES = 1024;
+
+}
+
+StatBackupJob::StatBackupJob(const QString &filePath) : m_filePath(filePath) { }
+
+bool StatBackupJob::processMerge(const StatTrafBaseJob & /*statJob*/)
+{
+    return true; // the queued backup is enough
+}
+
+void StatBackupJob::processJob()
+{
+    if (!m_backup && !openBackup())
+        return;
+
+    if (!m_backup->step(BACKUP_PASS_PAGES)) {
+        qCWarning(LC) << "Backup error:" << m_backup->errorMessage() << m_filePath;
+        m_backup.reset();
+        FileUtil::removeFile(tempFilePath());
+        return;
+    }
+
+    if (m_backup->isDone()) {
+        finishBackup();
+    } else {
+        // Continue after the other queued jobs
+        manager()->enqueueJob(WorkerJobPtr(new StatBackupJob(*this)));
+    }
+}
+
+bool StatBackupJob::openBackup()
+{
+    FileUtil::removeFile(tempFilePath());
+
+    m_backup.reset(new SqliteBackup(sqliteDb(), tempFilePath()));
+
+    if (!m_backup->open()) {
+        qCWarning(LC) << "Backup open error:" << m_backup->errorMessage() << m_filePath;
+        m_backup.reset();
+        return false;
+    }
+
+    return true;
+}
+
+void StatBackupJob::finishBackup()
+{
+    m_backup.reset();
+
+    // Keep the previous backup, until the new one is complete
+    FileUtil::removeFile(m_filePath);
+
+    if (!FileUtil::renameFile(tempFilePath(), m_filePath)) {
+        qCWarning(LC) << "Backup rename error:" << m_filePath;
+    }
+}
+
+QString StatBackupJob::tempFilePath() const
+{
+    return m_filePath + ".tmp";
+}
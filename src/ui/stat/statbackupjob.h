@@ -0,0 +1,34 @@
+#ifndef STATBACKUPJOB_H
+#define STATBACKUPJOB_H
+
+#include <QSharedPointer>
+
+#include "stattrafbasejob.h"
+
+class SqliteBackup;
+
+class StatBackupJob : public StatTrafBaseJob
+{
+public:
+    explicit StatBackupJob(const QString &filePath);
+
+    StatTrafJobType jobType() const override { return JobTypeBackup; }
+
+protected:
+    bool processMerge(const StatTrafBaseJob &statJob) override;
+    void processJob() override;
+    void emitFinished() override { }
+
+private:
+    bool openBackup();
+    void finishBackup();
+
+    QString tempFilePath() const;
+
+private:
+    QString m_filePath;
+
+    QSharedPointer<SqliteBackup> m_backup; // shared by the next pass' copy
+};
+
+#endif // STATBACKUPJOB_H
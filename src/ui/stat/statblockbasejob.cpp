@@ -5,7 +5,11 @@
 
 #include <util/worker/workerobject.h>
 
+#include <util/ioc/ioccontainer.h>
+
+#include "statappidcache.h"
 #include "statblockmanager.h"
+#include "statsql.h"
 
 SqliteDb *StatBlockBaseJob::sqliteDb() const
 {
@@ -46,3 +50,72 @@ SqliteStmt *StatBlockBaseJob::getIdStmt(const char *sql, qint64 id)
 
     return stmt;
 }
+
+QString StatBlockBaseJob::connBlockPartName(qint64 partId)
+{
+    return QString("conn_block_%1").arg(partId);
+}
+
+QVector<qint64> StatBlockBaseJob::getConnBlockPartIds(const char *sql, qint64 id)
+{
+    QVector<qint64> partIds;
+
+    SqliteStmt *stmt = getStmt(sql);
+
+    if (id != 0) {
+        stmt->bindInt64(1, id);
+    }
+
+    while (stmt->step() == SqliteStmt::StepRow) {
+        partIds.append(stmt->columnInt64());
+    }
+    stmt->reset();
+
+    return partIds;
+}
+
+bool StatBlockBaseJob::dropConnBlockView()
+{
+    return sqliteDb()->execute("DROP VIEW IF EXISTS conn_block;");
+}
+
+bool StatBlockBaseJob::createConnBlockView()
+{
+    QString sql = "CREATE VIEW conn_block AS";
+
+    const auto partIds = getConnBlockPartIds(StatSql::sqlSelectConnBlockPartIds);
+    for (const qint64 partId : partIds) {
+        sql += QString(" SELECT * FROM %1 UNION ALL").arg(connBlockPartName(partId));
+    }
+
+    sql += " SELECT * FROM conn_block_last;";
+
+    return sqliteDb()->executeStr(sql);
+}
+
+int StatBlockBaseJob::dropConnBlockParts(qint64 connIdTo)
+{
+    const auto partIds = getConnBlockPartIds(StatSql::sqlSelectConnBlockPartsTo, connIdTo);
+    if (partIds.isEmpty())
+        return 0;
+
+    // The view must not refer to the dropped tables
+    dropConnBlockView();
+
+    for (const qint64 partId : partIds) {
+        sqliteDb()->executeStr(QString("DROP TABLE %1;").arg(connBlockPartName(partId)));
+
+        SqliteStmt::doList({ getIdStmt(StatSql::sqlDeleteConnBlockPart, partId) });
+    }
+
+    createConnBlockView();
+
+    return partIds.size();
+}
+
+void StatBlockBaseJob::deleteConnBlockApps()
+{
+    SqliteStmt::doList({ getStmt(StatSql::sqlDeleteConnBlockApps) });
+
+    IoC<StatAppIdCache>()->clear(StatAppIdCache::DbBlock);
+}
@@ -1,6 +1,8 @@
 #ifndef STATBLOCKBASEJOB_H
 #define STATBLOCKBASEJOB_H
 
+#include <QVector>
+
 #include <sqlite/sqlitetypes.h>
 
 #include <util/worker/workerjob.h>
@@ -33,6 +35,19 @@ protected:
     SqliteStmt *getStmt(const char *sql);
     SqliteStmt *getIdStmt(const char *sql, qint64 id);
 
+    // The "conn_block" view is the union of the "conn_block_<part_id>" & "conn_block_last"
+    // tables, re-created by the parts' changes
+    static QString connBlockPartName(qint64 partId);
+
+    QVector<qint64> getConnBlockPartIds(const char *sql, qint64 id = 0);
+
+    bool dropConnBlockView();
+    bool createConnBlockView();
+
+    // Returns the count of the dropped closed parts up to the connection
+    int dropConnBlockParts(qint64 connIdTo);
+    void deleteConnBlockApps();
+
 private:
     int m_resultCount = 0;
 
@@ -18,10 +18,16 @@ namespace {
 
 const QLoggingCategory LC("statBlock");
 
-constexpr int DATABASE_USER_VERSION = 7;
+constexpr int DATABASE_USER_VERSION = 11;
+constexpr int DATABASE_RECREATE_VERSION = 10; // the older DBs are re-created
 
 constexpr int DATABASE_BUSY_TIMEOUT = 3000; // 3 seconds
 
+const SqliteDb::TuneOptions databaseTuneOptions = {
+    .cacheSizeKb = 4096,
+    .mmapSize = 32 * 1024 * 1024,
+};
+
 bool migrateFunc(SqliteDb *db, int version, bool isNewDb, void *ctx)
 {
     Q_UNUSED(ctx);
@@ -31,6 +37,10 @@ bool migrateFunc(SqliteDb *db, int version, bool isNewDb, void *ctx)
         return true;
     }
 
+    // COMPAT: DB schema, migrated in place
+    if (version > DATABASE_RECREATE_VERSION)
+        return true;
+
     // COMPAT: DB content
     if (version < 7) {
         const QString srcSchema = SqliteDb::migrationOldSchemaName();
@@ -43,15 +53,47 @@ bool migrateFunc(SqliteDb *db, int version, bool isNewDb, void *ctx)
 
         // Union the "conn" & "conn_block" tables
         db->executeStr(QString("INSERT INTO %1 (%4) SELECT %4 FROM %2 JOIN %3 USING(conn_id);")
-                               .arg(SqliteDb::entityName(dstSchema, "conn_block"),
+                               .arg(SqliteDb::entityName(dstSchema, "conn_block_last"),
                                        SqliteDb::entityName(srcSchema, "conn"),
                                        SqliteDb::entityName(srcSchema, "conn_block"),
                                        "conn_id, app_id, conn_time, process_id, inbound,"
                                        " inherited, ip_proto, local_port, remote_port,"
                                        " local_ip, remote_ip, local_ip6, remote_ip6,"
                                        " block_reason"));
+    } else if (version < 8) {
+        const QString srcSchema = SqliteDb::migrationOldSchemaName();
+        const QString dstSchema = SqliteDb::migrationNewSchemaName();
+
+        db->executeStr(QString("INSERT INTO %1 SELECT * FROM %2;")
+                               .arg(SqliteDb::entityName(dstSchema, "app"),
+                                       SqliteDb::entityName(srcSchema, "app")));
+
+        // The repeats of coalesced connections are added
+        db->executeStr(QString("INSERT INTO %1 (%3) SELECT %3 FROM %2;")
+                               .arg(SqliteDb::entityName(dstSchema, "conn_block_last"),
+                                       SqliteDb::entityName(srcSchema, "conn_block"),
+                                       "conn_id, app_id, conn_time, process_id, inbound,"
+                                       " inherited, ip_proto, local_port, remote_port,"
+                                       " local_ip, remote_ip, local_ip6, remote_ip6,"
+                                       " block_reason"));
+    } else if (version < 10) {
+        const QString srcSchema = SqliteDb::migrationOldSchemaName();
+        const QString dstSchema = SqliteDb::migrationNewSchemaName();
+
+        // The DB is re-created with the incremental vacuum, then by the "conn_block"'s parts
+        db->executeStr(QString("INSERT INTO %1 SELECT * FROM %2;")
+                               .arg(SqliteDb::entityName(dstSchema, "app"),
+                                       SqliteDb::entityName(srcSchema, "app")));
+
+        db->executeStr(QString("INSERT INTO %1 SELECT * FROM %2;")
+                               .arg(SqliteDb::entityName(dstSchema, "conn_block_last"),
+                                       SqliteDb::entityName(srcSchema, "conn_block")));
     }
 
+    // The imported connections are in the first part
+    db->execute("UPDATE conn_block_part"
+                "  SET conn_id_min = COALESCE((SELECT MIN(conn_id) FROM conn_block_last), 1);");
+
     return true;
 }
 
@@ -65,7 +107,7 @@ StatBlockManager::StatBlockManager(const QString &filePath, QObject *parent, qui
                     : m_sqliteDb),
     m_connChangedTimer(500)
 {
-    connect(&m_connChangedTimer, &QTimer::timeout, this, &StatBlockManager::connChanged);
+    connect(&m_connChangedTimer, &TriggerTimer::timeout, this, &StatBlockManager::onConnChangedTimeout);
 }
 
 void StatBlockManager::emitConnChanged()
@@ -73,12 +115,30 @@ void StatBlockManager::emitConnChanged()
     m_connChangedTimer.startTrigger();
 }
 
+void StatBlockManager::onConnChangedTimeout()
+{
+    qint64 idMin, idMax;
+    getConnIdRange(roSqliteDb(), idMin, idMax);
+
+    setConnIdRange(idMin, idMax);
+
+    emit connChanged();
+}
+
+void StatBlockManager::setConnIdRange(qint64 connIdMin, qint64 connIdMax)
+{
+    m_connIdMin = connIdMin;
+    m_connIdMax = connIdMax;
+}
+
 void StatBlockManager::setUp()
 {
     setupWorker();
     setupConfManager();
 
     setupDb();
+
+    getConnIdRange(roSqliteDb(), m_connIdMin, m_connIdMax);
 }
 
 void StatBlockManager::tearDown()
@@ -89,10 +149,11 @@ void StatBlockManager::tearDown()
 void StatBlockManager::logBlockedIp(const LogEntryBlockedIp &entry)
 {
     constexpr int maxJobCount = 16;
-    if (jobCount() >= maxJobCount)
+    const int backlogCount = jobCount();
+    if (backlogCount >= maxJobCount)
         return; // drop excessive data
 
-    enqueueJob(WorkerJobPtr(new LogBlockedIpJob(entry)));
+    enqueueJob(WorkerJobPtr(new LogBlockedIpJob(entry, m_keepCount, backlogCount)));
 }
 
 void StatBlockManager::deleteConn(qint64 connIdTo)
@@ -112,28 +173,10 @@ void StatBlockManager::getConnIdRange(SqliteDb *sqliteDb, qint64 &connIdMin, qin
     connIdMax = vars.value(1).toLongLong();
 }
 
-void StatBlockManager::onLogBlockedIpFinished(int count, qint64 /*newConnId*/)
+void StatBlockManager::onLogBlockedIpFinished(int /*count*/, qint64 /*newConnId*/)
 {
+    // The job drops the oldest parts over the keep count
     emitConnChanged();
-
-    if (m_keepCount <= 0)
-        return;
-
-    constexpr int connBlockIncMax = 99;
-
-    m_connInc += count;
-    if (m_connInc < connBlockIncMax)
-        return;
-
-    m_connInc = 0;
-
-    qint64 idMin, idMax;
-    getConnIdRange(roSqliteDb(), idMin, idMax);
-
-    const qint64 idMinKeep = idMax - m_keepCount;
-    if (idMinKeep > 0 && idMinKeep > idMin) {
-        deleteConn(idMinKeep);
-    }
 }
 
 void StatBlockManager::onDeleteConnBlockFinished(qint64 /*connIdTo*/)
@@ -171,13 +214,24 @@ bool StatBlockManager::setupDb()
         return false;
     }
 
+    // COMPAT: Re-create the DB to enable the incremental vacuum
+    const bool recreate = (sqliteDb()->userVersion() < DATABASE_RECREATE_VERSION);
+
     SqliteDb::MigrateOptions opt = {
         .sqlDir = ":/stat/migrations/block",
+        .sqlPragmas = StatSql::sqlPragmas,
         .version = DATABASE_USER_VERSION,
-        .recreate = true,
-        // COMPAT: Union the "conn" & "conn_block" tables
-        .autoCopyTables = (DATABASE_USER_VERSION != 7),
+        .recreate = recreate,
+        // COMPAT: Union the "conn" & "conn_block" tables, then add the repeats
+        .autoCopyTables = false,
         .migrateFunc = &migrateFunc,
+        .ftsTables = {
+                {
+                        .contentTable = "app",
+                        .contentRowid = "app_id",
+                        .columns = { "path" }
+                },
+                },
     };
 
     if (!sqliteDb()->migrate(opt)) {
@@ -193,9 +247,11 @@ bool StatBlockManager::setupDb()
         }
 
         roSqliteDb()->setBusyTimeoutMs(DATABASE_BUSY_TIMEOUT);
+        roSqliteDb()->tune(databaseTuneOptions);
     }
 
     sqliteDb()->setBusyTimeoutMs(DATABASE_BUSY_TIMEOUT);
+    sqliteDb()->tune(databaseTuneOptions);
 
     return true;
 }
@@ -32,6 +32,10 @@ public:
 
     virtual void deleteConn(qint64 connIdTo = 0);
 
+    // Read by the service once per change for all clients
+    qint64 connIdMin() const { return m_connIdMin; }
+    qint64 connIdMax() const { return m_connIdMax; }
+
     static void getConnIdRange(SqliteDb *sqliteDb, qint64 &rowIdMin, qint64 &rowIdMax);
 
 signals:
@@ -45,8 +49,11 @@ private:
     void onDeleteConnBlockFinished(qint64 connIdTo);
 
     void emitConnChanged();
+    void onConnChangedTimeout();
 
 protected:
+    void setConnIdRange(qint64 connIdMin, qint64 connIdMax);
+
     WorkerObject *createWorker() override;
     bool canMergeJobs() const override { return true; }
 
@@ -59,10 +66,11 @@ private:
     void setupByConf(const IniOptions &ini);
 
 private:
-    int m_connInc = 999999999; // to trigger on first check
-
     int m_keepCount = 0;
 
+    qint64 m_connIdMin = 0;
+    qint64 m_connIdMax = 0;
+
     SqliteDbPtr m_sqliteDb;
     SqliteDbPtr m_roSqliteDb;
 
@@ -0,0 +1,309 @@
+#include "statexportjob.h"
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QLoggingCategory>
+#include <QTcpSocket>
+
+#include <sqlite/sqlitedb.h>
+#include <sqlite/sqlitestmt.h>
+
+#include <util/dateutil.h>
+#include <util/fileutil.h>
+#include <util/net/netutil.h>
+#include <util/worker/workerobject.h>
+
+#include "statblockmanager.h"
+#include "statsql.h"
+
+namespace {
+
+const QLoggingCategory LC("statExport");
+
+constexpr int EXPORT_CONNS_MAX = 5000; // per job
+constexpr int EXPORT_TRAF_HOURS_MAX = 24; // per job
+constexpr int EXPORT_FILES_COUNT = 4; // of the rotated ones
+constexpr int EXPORT_TCP_TIMEOUT_MSECS = 5000;
+
+// The hour's traffic is complete after its last flush
+constexpr int TRAF_HOUR_EXPORT_DELAY_SECS = 2 * 60;
+
+QByteArray csvText(const QString &text)
+{
+    QByteArray res = text.toUtf8();
+    res.replace('"', "\"\"");
+    return '"' + res + '"';
+}
+
+QString ipText(const SqliteStmt *stmt, int ip4Column, int ip6Column)
+{
+    if (!stmt->columnIsNull(ip4Column))
+        return NetUtil::ip4ToText(stmt->columnInt(ip4Column));
+
+    const QByteArray ip6 = stmt->columnBlob(ip6Column);
+
+    return NetUtil::ip6ToText(NetUtil::rawArrayToIp6(ip6));
+}
+
+}
+
+StatExportJob::StatExportJob(const StatExportOptions &options) : m_options(options) { }
+
+bool StatExportJob::mergeJob(const WorkerJob &job)
+{
+    const auto &exportJob = static_cast<const StatExportJob &>(job);
+
+    m_options = exportJob.options();
+
+    return true;
+}
+
+void StatExportJob::doJob(WorkerObject &worker)
+{
+    m_manager = static_cast<StatExportManager *>(worker.manager());
+
+    qint64 connIdCursor = m_manager->connIdCursor();
+    qint32 trafHourCursor = m_manager->trafHourCursor();
+
+    QByteArray data;
+
+    const int connsCount = exportConns(data, connIdCursor);
+    const int trafHoursCount = exportTraffic(data, trafHourCursor);
+
+    if (connIdCursor == m_manager->connIdCursor()
+            && trafHourCursor == m_manager->trafHourCursor())
+        return;
+
+    // Keep the cursor to retry the batch by the next run
+    if (!data.isEmpty() && !writeData(data))
+        return;
+
+    m_manager->saveCursor(connIdCursor, trafHourCursor);
+
+    // Continue with the backlog
+    if (connsCount >= EXPORT_CONNS_MAX || trafHoursCount >= EXPORT_TRAF_HOURS_MAX) {
+        m_manager->enqueueJob(WorkerJobPtr(new StatExportJob(options())));
+    }
+}
+
+int StatExportJob::exportConns(QByteArray &data, qint64 &connIdCursor)
+{
+    SqliteDb *sqliteDb = m_manager->blockDb();
+
+    qint64 idMin, idMax;
+    StatBlockManager::getConnIdRange(sqliteDb, idMin, idMax);
+
+    // All connections are deleted, the new ones start from 1
+    if (idMax < connIdCursor) {
+        connIdCursor = 0;
+    }
+
+    SqliteStmt *stmt = sqliteDb->stmt(StatSql::sqlSelectExportConnBlock);
+    if (!stmt->isPrepared())
+        return 0;
+
+    stmt->bindInt64(1, connIdCursor);
+    stmt->bindInt(2, EXPORT_CONNS_MAX);
+
+    int count = 0;
+    while (stmt->step() == SqliteStmt::StepRow) {
+        const qint64 connId = stmt->columnInt64(0);
+
+        if (count == 0 && connIdCursor > 0 && connId > connIdCursor + 1) {
+            qCWarning(LC) << "Connections deleted before the export:" << (connIdCursor + 1)
+                          << "-" << (connId - 1);
+        }
+
+        addConnLine(data, stmt);
+
+        connIdCursor = connId;
+        ++count;
+    }
+    stmt->reset();
+
+    return count;
+}
+
+int StatExportJob::exportTraffic(QByteArray &data, qint32 &trafHourCursor)
+{
+    const qint32 lastHour =
+            DateUtil::getUnixHour(DateUtil::getUnixTime() - TRAF_HOUR_EXPORT_DELAY_SECS) - 1;
+
+    const qint32 hourTo = qMin(lastHour, trafHourCursor + EXPORT_TRAF_HOURS_MAX);
+    if (hourTo <= trafHourCursor)
+        return 0;
+
+    SqliteStmt *stmt = m_manager->statDb()->stmt(StatSql::sqlSelectExportTrafAppHour);
+    if (!stmt->isPrepared())
+        return 0;
+
+    // The hours' range by one scan
+    stmt->bindInt(1, trafHourCursor);
+    stmt->bindInt(2, hourTo);
+
+    while (stmt->step() == SqliteStmt::StepRow) {
+        addTrafLine(data, stmt);
+    }
+    stmt->reset();
+
+    const int hoursCount = hourTo - trafHourCursor;
+
+    trafHourCursor = hourTo;
+
+    return hoursCount;
+}
+
+/*
+ * CSV columns: "conn_block", id, time, pid, path, inbound, inherited, ip_proto,
+ * local_ip, local_port, remote_ip, remote_port, block_reason, repeat_count, last_time
+ */
+void StatExportJob::addConnLine(QByteArray &data, const SqliteStmt *stmt) const
+{
+    const QString path = stmt->columnText(15);
+    const QString localIp = ipText(stmt, 8, 10);
+    const QString remoteIp = ipText(stmt, 9, 11);
+
+    if (options().csv) {
+        data += "conn_block," + QByteArray::number(stmt->columnInt64(0)) + ','
+                + QByteArray::number(stmt->columnInt64(1)) + ','
+                + QByteArray::number(stmt->columnInt(2)) + ',' + csvText(path) + ','
+                + QByteArray::number(stmt->columnInt(3)) + ','
+                + QByteArray::number(stmt->columnInt(4)) + ','
+                + QByteArray::number(stmt->columnInt(5)) + ',' + localIp.toLatin1() + ','
+                + QByteArray::number(stmt->columnInt(6)) + ',' + remoteIp.toLatin1() + ','
+                + QByteArray::number(stmt->columnInt(7)) + ','
+                + QByteArray::number(stmt->columnInt(12)) + ','
+                + QByteArray::number(stmt->columnInt(13)) + ','
+                + QByteArray::number(stmt->columnInt64(14)) + '\n';
+        return;
+    }
+
+    const QJsonObject obj = {
+        { "type", "conn_block" },
+        { "id", stmt->columnInt64(0) },
+        { "time", stmt->columnInt64(1) },
+        { "pid", stmt->columnInt(2) },
+        { "path", path },
+        { "inbound", stmt->columnBool(3) },
+        { "inherited", stmt->columnBool(4) },
+        { "ip_proto", stmt->columnInt(5) },
+        { "local_ip", localIp },
+        { "local_port", stmt->columnInt(6) },
+        { "remote_ip", remoteIp },
+        { "remote_port", stmt->columnInt(7) },
+        { "block_reason", stmt->columnInt(12) },
+        { "repeat_count", stmt->columnInt(13) },
+        { "last_time", stmt->columnInt64(14) },
+    };
+
+    data += QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+
+/*
+ * CSV columns: "traffic", time, path, in_bytes, out_bytes
+ */
+void StatExportJob::addTrafLine(QByteArray &data, const SqliteStmt *stmt) const
+{
+    const qint64 unixTime = qint64(stmt->columnInt(0)) * 3600;
+    const QString path = stmt->columnText(1);
+    const qint64 inBytes = stmt->columnInt64(2);
+    const qint64 outBytes = stmt->columnInt64(3);
+
+    if (options().csv) {
+        data += "traffic," + QByteArray::number(unixTime) + ',' + csvText(path) + ','
+                + QByteArray::number(inBytes) + ',' + QByteArray::number(outBytes) + '\n';
+        return;
+    }
+
+    const QJsonObject obj = {
+        { "type", "traffic" },
+        { "time", unixTime },
+        { "path", path },
+        { "in_bytes", inBytes },
+        { "out_bytes", outBytes },
+    };
+
+    data += QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+}
+
+bool StatExportJob::writeData(const QByteArray &data)
+{
+    if (!options().filePath.isEmpty() && !writeFile(data))
+        return false;
+
+    if (!options().tcpAddress.isEmpty() && !writeTcp(data))
+        return false;
+
+    return true;
+}
+
+bool StatExportJob::writeFile(const QByteArray &data)
+{
+    const QString &filePath = options().filePath;
+
+    QFile file(filePath);
+
+    if (file.size() > 0 && file.size() + data.size() > options().fileSizeMax) {
+        rotateFiles();
+    }
+
+    FileUtil::makePathForFile(filePath);
+
+    if (!file.open(QFile::WriteOnly | QFile::Append)) {
+        qCWarning(LC) << "File open error:" << filePath << file.errorString();
+        return false;
+    }
+
+    return file.write(data) == data.size() && file.flush();
+}
+
+bool StatExportJob::writeTcp(const QByteArray &data)
+{
+    QString host = options().tcpAddress;
+    const int portIndex = host.lastIndexOf(':');
+    const quint16 port = quint16(host.mid(portIndex + 1).toUInt());
+
+    host.truncate(portIndex);
+    host.remove('[').remove(']'); // of IPv6
+
+    if (portIndex <= 0 || port == 0) {
+        qCWarning(LC) << "Bad TCP address:" << options().tcpAddress;
+        return false;
+    }
+
+    QTcpSocket socket;
+    socket.connectToHost(host, port);
+
+    if (!socket.waitForConnected(EXPORT_TCP_TIMEOUT_MSECS)) {
+        qCDebug(LC) << "TCP connect error:" << options().tcpAddress << socket.errorString();
+        return false;
+    }
+
+    socket.write(data);
+
+    while (socket.bytesToWrite() > 0) {
+        if (!socket.waitForBytesWritten(EXPORT_TCP_TIMEOUT_MSECS)) {
+            qCDebug(LC) << "TCP write error:" << options().tcpAddress << socket.errorString();
+            return false; // the batch is re-sent
+        }
+    }
+
+    socket.disconnectFromHost();
+
+    return true;
+}
+
+void StatExportJob::rotateFiles()
+{
+    const QString &filePath = options().filePath;
+
+    FileUtil::removeFile(filePath + '.' + QString::number(EXPORT_FILES_COUNT));
+
+    for (int i = EXPORT_FILES_COUNT - 1; i > 0; --i) {
+        FileUtil::renameFile(
+                filePath + '.' + QString::number(i), filePath + '.' + QString::number(i + 1));
+    }
+
+    FileUtil::renameFile(filePath, filePath + ".1");
+}
@@ -0,0 +1,43 @@
+#ifndef STATEXPORTJOB_H
+#define STATEXPORTJOB_H
+
+#include <QByteArray>
+
+#include <sqlite/sqlitetypes.h>
+
+#include <util/worker/workerjob.h>
+
+#include "statexportmanager.h"
+
+class StatExportJob : public WorkerJob
+{
+public:
+    explicit StatExportJob(const StatExportOptions &options);
+
+    const StatExportOptions &options() const { return m_options; }
+
+    bool mergeJob(const WorkerJob &job) override;
+
+    void doJob(WorkerObject &worker) override;
+
+private:
+    // Returns the count of the exported rows
+    int exportConns(QByteArray &data, qint64 &connIdCursor);
+    int exportTraffic(QByteArray &data, qint32 &trafHourCursor);
+
+    void addConnLine(QByteArray &data, const SqliteStmt *stmt) const;
+    void addTrafLine(QByteArray &data, const SqliteStmt *stmt) const;
+
+    bool writeData(const QByteArray &data);
+    bool writeFile(const QByteArray &data);
+    bool writeTcp(const QByteArray &data);
+
+    void rotateFiles();
+
+private:
+    StatExportOptions m_options;
+
+    StatExportManager *m_manager = nullptr;
+};
+
+#endif // STATEXPORTJOB_H
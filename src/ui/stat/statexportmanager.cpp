@@ -0,0 +1,128 @@
+#include "statexportmanager.h"
+
+#include <QLoggingCategory>
+#include <QSaveFile>
+
+#include <sqlite/sqlitedb.h>
+
+#include <conf/confmanager.h>
+#include <conf/firewallconf.h>
+#include <util/dateutil.h>
+#include <util/fileutil.h>
+#include <util/ioc/ioccontainer.h>
+
+#include "statblockmanager.h"
+#include "statexportjob.h"
+#include "statmanager.h"
+
+namespace {
+
+const QLoggingCategory LC("statExport");
+
+constexpr int EXPORT_INTERVAL_MSECS = 10 * 1000;
+
+constexpr int DATABASE_BUSY_TIMEOUT = 3000; // 3 seconds
+
+}
+
+StatExportManager::StatExportManager(const QString &statFilePath,
+        const QString &statBlockFilePath, const QString &cursorFilePath, QObject *parent) :
+    WorkerManager(parent),
+    m_cursorFilePath(cursorFilePath),
+    m_statDb(SqliteDbPtr::create(statFilePath, SqliteDb::OpenDefaultReadOnly)),
+    m_blockDb(SqliteDbPtr::create(statBlockFilePath, SqliteDb::OpenDefaultReadOnly))
+{
+    m_exportTimer.setInterval(EXPORT_INTERVAL_MSECS);
+
+    connect(&m_exportTimer, &QTimer::timeout, this, &StatExportManager::onExportTimeout);
+}
+
+bool StatExportManager::saveCursor(qint64 connIdCursor, qint32 trafHourCursor)
+{
+    m_connIdCursor = connIdCursor;
+    m_trafHourCursor = trafHourCursor;
+
+    // Replace the file at once
+    QSaveFile file(m_cursorFilePath);
+    if (!file.open(QFile::WriteOnly))
+        return false;
+
+    file.write(QByteArray::number(connIdCursor) + ' ' + QByteArray::number(trafHourCursor) + '\n');
+
+    return file.commit();
+}
+
+void StatExportManager::setUp()
+{
+    setMaxWorkersCount(1);
+
+    // The DBs are migrated by their managers
+    IoC()->setUpDependency<StatManager>();
+    IoC()->setUpDependency<StatBlockManager>();
+
+    openDb(statDb());
+    openDb(blockDb());
+
+    loadCursor();
+
+    setupConfManager();
+}
+
+void StatExportManager::tearDown()
+{
+    m_exportTimer.stop();
+
+    abortWorkers();
+}
+
+void StatExportManager::setupConfManager()
+{
+    auto confManager = IoC()->setUpDependency<ConfManager>();
+
+    connect(confManager, &ConfManager::iniChanged, this, &StatExportManager::setupByConf);
+}
+
+void StatExportManager::setupByConf(const IniOptions &ini)
+{
+    m_options.csv = ini.exportCsv();
+    m_options.fileSizeMax = qint64(qMax(1, ini.exportFileSizeMb())) * 1024 * 1024;
+    m_options.filePath = ini.exportFilePath();
+    m_options.tcpAddress = ini.exportTcpAddress();
+
+    if (m_options.isEnabled()) {
+        m_exportTimer.start();
+    } else {
+        m_exportTimer.stop();
+    }
+}
+
+bool StatExportManager::openDb(SqliteDb *sqliteDb)
+{
+    if (!sqliteDb->open()) {
+        qCWarning(LC) << "File open error:" << sqliteDb->filePath() << sqliteDb->errorMessage();
+        return false;
+    }
+
+    sqliteDb->setBusyTimeoutMs(DATABASE_BUSY_TIMEOUT);
+
+    return true;
+}
+
+void StatExportManager::loadCursor()
+{
+    const QList<QByteArray> parts = FileUtil::readFileData(m_cursorFilePath).trimmed().split(' ');
+
+    if (parts.size() == 2) {
+        m_connIdCursor = parts[0].toLongLong();
+        m_trafHourCursor = parts[1].toInt();
+    } else {
+        // Export the kept connections and the new hours' traffic
+        m_connIdCursor = 0;
+        m_trafHourCursor = DateUtil::getUnixHour(DateUtil::getUnixTime()) - 1;
+    }
+}
+
+void StatExportManager::onExportTimeout()
+{
+    enqueueJob(WorkerJobPtr(new StatExportJob(m_options)));
+}
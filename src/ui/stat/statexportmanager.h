@@ -0,0 +1,79 @@
+#ifndef STATEXPORTMANAGER_H
+#define STATEXPORTMANAGER_H
+
+#include <QObject>
+#include <QTimer>
+
+#include <sqlite/sqlitetypes.h>
+
+#include <util/classhelpers.h>
+#include <util/ioc/iocservice.h>
+#include <util/worker/workermanager.h>
+
+class IniOptions;
+
+struct StatExportOptions
+{
+    bool isEnabled() const { return !filePath.isEmpty() || !tcpAddress.isEmpty(); }
+
+    bool csv = false;
+
+    qint64 fileSizeMax = 0;
+
+    QString filePath;
+    QString tcpAddress;
+};
+
+// Tails the new blocked connections & the hours' traffic by the persisted cursor, by own
+// read-only connections to not block the logging
+class StatExportManager : public WorkerManager, public IocService
+{
+    Q_OBJECT
+
+public:
+    explicit StatExportManager(const QString &statFilePath, const QString &statBlockFilePath,
+            const QString &cursorFilePath, QObject *parent = nullptr);
+    CLASS_DELETE_COPY_MOVE(StatExportManager)
+
+    SqliteDb *statDb() const { return m_statDb.data(); }
+    SqliteDb *blockDb() const { return m_blockDb.data(); }
+
+    // Used by the worker only
+    qint64 connIdCursor() const { return m_connIdCursor; }
+    qint32 trafHourCursor() const { return m_trafHourCursor; }
+    bool saveCursor(qint64 connIdCursor, qint32 trafHourCursor);
+
+    void setUp() override;
+    void tearDown() override;
+
+    QString workerName() const override { return "StatExportWorker"; }
+
+protected:
+    bool canMergeJobs() const override { return true; }
+
+private:
+    void setupConfManager();
+
+    void setupByConf(const IniOptions &ini);
+
+    bool openDb(SqliteDb *sqliteDb);
+
+    void loadCursor();
+
+    void onExportTimeout();
+
+private:
+    qint64 m_connIdCursor = 0;
+    qint32 m_trafHourCursor = 0;
+
+    QString m_cursorFilePath;
+
+    StatExportOptions m_options;
+
+    SqliteDbPtr m_statDb;
+    SqliteDbPtr m_blockDb;
+
+    QTimer m_exportTimer;
+};
+
+#endif // STATEXPORTMANAGER_H
@@ -7,25 +7,42 @@
 
 #include <conf/firewallconf.h>
 #include <driver/drivercommon.h>
+#include <driver/flowinfo.h>
+#include <log/logentryflowstat.h>
 #include <log/logentryprocnew.h>
+#include <log/logentryshaperstat.h>
 #include <log/logentrystattraf.h>
 #include <stat/quotamanager.h>
 #include <util/dateutil.h>
+#include <util/etwutil.h>
 #include <util/fileutil.h>
 #include <util/ioc/ioccontainer.h>
 #include <util/osutil.h>
 
+#include "deleteoldtrafjob.h"
+#include "deletetrafjob.h"
+#include "statbackupjob.h"
 #include "statsql.h"
 
 namespace {
 
 const QLoggingCategory LC("stat");
 
-constexpr int DATABASE_USER_VERSION = 7;
+constexpr int DATABASE_USER_VERSION = 9;
+
+const QString archiveDbSchema = "archive";
+
+constexpr int DATABASE_BUSY_TIMEOUT = 3000; // 3 seconds
+
+const SqliteDb::TuneOptions databaseTuneOptions = {
+    .cacheSizeKb = 4096,
+    .mmapSize = 32 * 1024 * 1024,
+};
 
 constexpr qint32 ACTIVE_PERIOD_CHECK_SECS = 60 * OS_TICKS_PER_SECOND;
 
-constexpr qint64 INVALID_APP_ID = Q_INT64_C(-1);
+constexpr int TRAF_FLUSH_SECONDS_MAX = 60;
+constexpr int BACKUP_HOURS_MAX = 24 * 7;
 
 bool migrateFunc(SqliteDb *db, int version, bool isNewDb, void *ctx)
 {
@@ -55,8 +72,13 @@ bool migrateFunc(SqliteDb *db, int version, bool isNewDb, void *ctx)
 }
 
 StatManager::StatManager(const QString &filePath, QObject *parent, quint32 openFlags) :
-    QObject(parent), m_sqliteDb(new SqliteDb(filePath, openFlags))
+    WorkerManager(parent),
+    m_sqliteDb(new SqliteDb(filePath, openFlags)),
+    m_roSqliteDb((openFlags == 0 || (openFlags & SqliteDb::OpenReadWrite) != 0)
+                    ? SqliteDbPtr::create(filePath, SqliteDb::OpenDefaultReadOnly)
+                    : m_sqliteDb)
 {
+    setMaxWorkersCount(1);
 }
 
 void StatManager::setConf(const FirewallConf *conf)
@@ -76,6 +98,13 @@ void StatManager::setUp()
     setupDb();
 }
 
+void StatManager::tearDown()
+{
+    flushTraffic();
+
+    finishWorkers();
+}
+
 void StatManager::setupTrafDate()
 {
     m_trafHour = m_trafDay = m_trafMonth = 0;
@@ -124,22 +153,12 @@ void StatManager::updateActivePeriod()
 
 void StatManager::clearQuotas(bool isNewDay, bool isNewMonth)
 {
-    auto quotaManager = IoC<QuotaManager>();
-
-    quotaManager->clear(isNewDay && m_trafDay != 0, isNewMonth && m_trafMonth != 0);
-}
-
-void StatManager::checkQuotas(quint32 inBytes)
-{
-    if (m_isActivePeriod) {
-        auto quotaManager = IoC<QuotaManager>();
+    if (!isNewDay && !isNewMonth)
+        return;
 
-        // Update quota traffic bytes
-        quotaManager->addTraf(inBytes);
+    auto quotaManager = IoC<QuotaManager>();
 
-        quotaManager->checkQuotaDay(m_trafDay);
-        quotaManager->checkQuotaMonth(m_trafMonth);
-    }
+    quotaManager->startPeriods(isNewDay && m_trafDay != 0, isNewMonth && m_trafMonth != 0);
 }
 
 bool StatManager::updateTrafDay(qint64 unixTime)
@@ -154,6 +173,11 @@ bool StatManager::updateTrafDay(qint64 unixTime)
             isNewDay ? DateUtil::getUnixMonth(unixTime, ini()->monthStart()) : m_trafMonth;
     const bool isNewMonth = (trafMonth != m_trafMonth);
 
+    // Flush the traffic of the previous hour
+    if (isNewHour) {
+        flushTraffic();
+    }
+
     // Initialize quotas traffic bytes
     clearQuotas(isNewDay, isNewMonth);
 
@@ -166,19 +190,17 @@ bool StatManager::updateTrafDay(qint64 unixTime)
 
 bool StatManager::clearTraffic()
 {
-    sqliteDb()->beginTransaction();
-    sqliteDb()->execute(StatSql::sqlDeleteAllTraffic);
-    sqliteDb()->commitTransaction();
+    clear(); // drop the queued jobs
 
-    sqliteDb()->vacuum(); // Vacuum outside of transaction
+    clearPendingTraffic();
 
-    clearAppIdCache();
+    m_topApps.clear();
 
     setupTrafDate();
 
-    IoC<QuotaManager>()->clear();
+    enqueueJob(WorkerJobPtr(new DeleteTrafJob(DeleteTrafJob::DeleteAll)));
 
-    emit trafficCleared();
+    IoC<QuotaManager>()->clear();
 
     return true;
 }
@@ -193,6 +215,8 @@ bool StatManager::setupDb()
 
     SqliteDb::MigrateOptions opt = {
         .sqlDir = ":/stat/migrations/traf",
+        // COMPAT: Re-create the DB to enable the incremental vacuum
+        .sqlPragmas = StatSql::sqlPragmas,
         .version = DATABASE_USER_VERSION,
         .recreate = true,
         .migrateFunc = &migrateFunc,
@@ -203,48 +227,94 @@ bool StatManager::setupDb()
         return false;
     }
 
+    if (roSqliteDb() != sqliteDb()) {
+        if (!roSqliteDb()->open()) {
+            qCCritical(LC) << "File open error:" << roSqliteDb()->filePath()
+                           << roSqliteDb()->errorMessage();
+            return false;
+        }
+
+        roSqliteDb()->setBusyTimeoutMs(DATABASE_BUSY_TIMEOUT);
+        roSqliteDb()->tune(databaseTuneOptions);
+    }
+
+    sqliteDb()->setBusyTimeoutMs(DATABASE_BUSY_TIMEOUT);
+    sqliteDb()->tune(databaseTuneOptions);
+
+    setupArchiveDb();
+
     return true;
 }
 
-void StatManager::logClear()
+void StatManager::setupArchiveDb()
 {
-    m_appPidPathMap.clear();
-}
+    const QString filePath = archiveFilePath();
+    const bool isReadOnly = (sqliteDb()->openFlags() & SqliteDb::OpenReadWrite) == 0;
 
-void StatManager::logClearApp(quint32 pid)
-{
-    m_appPidPathMap.remove(pid);
-}
+    // The worker's DB creates the archive's tables
+    if (!isReadOnly) {
+        m_isArchiveDb = sqliteDb()->attach(archiveDbSchema, filePath)
+                && sqliteDb()->execute(StatSql::sqlArchivePragmas)
+                && sqliteDb()->execute(StatSql::sqlCreateArchiveTables);
 
-void StatManager::addCachedAppId(const QString &appPath, qint64 appId)
-{
-    m_appPathIdCache.insert(appPath, appId);
+        if (!m_isArchiveDb) {
+            qCWarning(LC) << "Archive DB error:" << filePath << sqliteDb()->errorMessage();
+            return;
+        }
+
+        sqliteDb()->execute(StatSql::sqlArchiveTune);
+    }
+
+    // The readers' DB, the archive may be absent yet
+    SqliteDb *roDb = roSqliteDb();
+
+    m_isRoArchiveDb = roDb->attach(archiveDbSchema, filePath)
+            && roDb->tableNames(archiveDbSchema).contains("traffic_hour");
+
+    if (m_isRoArchiveDb) {
+        roDb->execute(StatSql::sqlArchiveTune);
+    }
 }
 
-qint64 StatManager::getCachedAppId(const QString &appPath) const
+QString StatManager::archiveFilePath() const
 {
-    return m_appPathIdCache.value(appPath, INVALID_APP_ID);
+    const QString filePath = sqliteDb()->filePath();
+
+    return (filePath == ":memory:") ? filePath : filePath + "-archive";
 }
 
-void StatManager::clearCachedAppId(const QString &appPath)
+void StatManager::logClear()
 {
-    m_appPathIdCache.remove(appPath);
+    m_appPidPathMap.clear();
+    m_appPidUserMap.clear();
 }
 
-void StatManager::clearAppIdCache()
+void StatManager::logClearApp(quint32 pid)
 {
-    m_appPathIdCache.clear();
+    m_appPidPathMap.remove(pid);
+    m_appPidUserMap.remove(pid);
 }
 
 bool StatManager::logProcNew(const LogEntryProcNew &entry, qint64 unixTime)
 {
+    Q_UNUSED(unixTime);
+
     const quint32 pid = entry.pid();
     const QString appPath = entry.path();
 
     Q_ASSERT(!m_appPidPathMap.contains(pid));
     m_appPidPathMap.insert(pid, appPath);
 
-    return getOrCreateAppId(appPath, unixTime) != INVALID_APP_ID;
+    // The session's user is resolved once per process
+    const quint32 sessionId = entry.sessionId();
+    if (sessionId != FORT_LOG_SESSION_UNKNOWN) {
+        const QString userName = OsUtil::sessionUserName(sessionId);
+        if (!userName.isEmpty()) {
+            m_appPidUserMap.insert(pid, userName);
+        }
+    }
+
+    return !appPath.isEmpty();
 }
 
 bool StatManager::logStatTraf(const LogEntryStatTraf &entry, qint64 unixTime)
@@ -254,71 +324,56 @@ bool StatManager::logStatTraf(const LogEntryStatTraf &entry, qint64 unixTime)
 
     const bool logStat = conf() && conf()->logStat() && m_isActivePeriod;
 
-    const bool isNewDay = updateTrafDay(unixTime);
+    // Delete old data by the next flush
+    if (updateTrafDay(unixTime)) {
+        m_deleteOldTraffic = true;
+    }
 
-    sqliteDb()->beginTransaction();
+    EtwUtil::statTrafStart(entry.procCount());
 
-    // Delete old data
-    if (isNewDay) {
-        deleteOldTraffic(m_trafHour);
-    }
+    m_topApps.advance(unixTime != 0 ? unixTime : DateUtil::getUnixTime());
 
     // Sum traffic bytes
-    quint32 sumInBytes = 0;
-    quint32 sumOutBytes = 0;
+    quint64 sumInBytes = 0;
+    quint64 sumOutBytes = 0;
 
     const quint16 procCount = entry.procCount();
-    {
-        const quint32 *procTrafBytes = entry.procTrafBytes();
-
-        const SqliteStmtList insertTrafAppStmts = SqliteStmtList()
-                << getTrafficStmt(StatSql::sqlInsertTrafAppHour, m_trafHour)
-                << getTrafficStmt(StatSql::sqlInsertTrafAppDay, m_trafDay)
-                << getTrafficStmt(StatSql::sqlInsertTrafAppMonth, m_trafMonth)
-                << getTrafficStmt(StatSql::sqlInsertTrafAppTotal, m_trafHour);
-
-        const SqliteStmtList updateTrafAppStmts = SqliteStmtList()
-                << getTrafficStmt(StatSql::sqlUpdateTrafAppHour, m_trafHour)
-                << getTrafficStmt(StatSql::sqlUpdateTrafAppDay, m_trafDay)
-                << getTrafficStmt(StatSql::sqlUpdateTrafAppMonth, m_trafMonth)
-                << getTrafficStmt(StatSql::sqlUpdateTrafAppTotal, -1);
-
-        for (int i = 0; i < procCount; ++i) {
-            const quint32 pidFlag = *procTrafBytes++;
-            const quint32 inBytes = *procTrafBytes++;
-            const quint32 outBytes = *procTrafBytes++;
-
-            const bool inactive = (pidFlag & 1) != 0;
-            const quint32 pid = pidFlag & ~quint32(1);
-
-            logTrafBytes(insertTrafAppStmts, updateTrafAppStmts, sumInBytes, sumOutBytes, pid,
-                    inBytes, outBytes, unixTime, logStat);
-
-            if (inactive) {
-                logClearApp(pid);
-            }
+    for (int i = 0; i < procCount; ++i) {
+        quint32 pidFlag;
+        quint64 inBytes, outBytes;
+        entry.procTraf(i, pidFlag, inBytes, outBytes);
+
+        const bool inactive = (pidFlag & 1) != 0;
+        const quint32 pid = pidFlag & ~quint32(1);
+
+        logTrafBytes(sumInBytes, sumOutBytes, pid, inBytes, outBytes, logStat);
+
+        if (entry.conns()) {
+            quint16 connCount, blockedCount;
+            entry.procConns(i, connCount, blockedCount);
+
+            logConns(pid, connCount, blockedCount);
+        }
+
+        if (inactive) {
+            logClearApp(pid);
         }
     }
 
     if (logStat) {
-        const SqliteStmtList insertTrafStmts = SqliteStmtList()
-                << getTrafficStmt(StatSql::sqlInsertTrafHour, m_trafHour)
-                << getTrafficStmt(StatSql::sqlInsertTrafDay, m_trafDay)
-                << getTrafficStmt(StatSql::sqlInsertTrafMonth, m_trafMonth);
+        m_trafBytes.inBytes += sumInBytes;
+        m_trafBytes.outBytes += sumOutBytes;
 
-        const SqliteStmtList updateTrafStmts = SqliteStmtList()
-                << getTrafficStmt(StatSql::sqlUpdateTrafHour, m_trafHour)
-                << getTrafficStmt(StatSql::sqlUpdateTrafDay, m_trafDay)
-                << getTrafficStmt(StatSql::sqlUpdateTrafMonth, m_trafMonth);
-
-        // Update or insert total bytes
-        updateTrafficList(insertTrafStmts, updateTrafStmts, sumInBytes, sumOutBytes);
+        if (m_trafUnixTime == 0) {
+            m_trafUnixTime = unixTime != 0 ? unixTime : DateUtil::getUnixTime();
+        }
     }
 
-    sqliteDb()->commitTransaction();
+    if (isTrafFlushTime()) {
+        flushTraffic();
+    }
 
-    // Check quotas
-    checkQuotas(sumInBytes);
+    EtwUtil::statTrafStop(sumInBytes, sumOutBytes);
 
     // Notify about sum traffic bytes
     emit trafficAdded(unixTime, sumInBytes, sumOutBytes);
@@ -326,144 +381,145 @@ bool StatManager::logStatTraf(const LogEntryStatTraf &entry, qint64 unixTime)
     return true;
 }
 
-bool StatManager::deleteStatApp(qint64 appId)
+bool StatManager::isTrafFlushTime() const
 {
-    sqliteDb()->beginTransaction();
-
-    SqliteStmt::doList({ getIdStmt(StatSql::sqlDeleteAppTrafHour, appId),
-            getIdStmt(StatSql::sqlDeleteAppTrafDay, appId),
-            getIdStmt(StatSql::sqlDeleteAppTrafMonth, appId),
-            getIdStmt(StatSql::sqlDeleteAppTrafTotal, appId) });
-
-    deleteAppId(appId);
-
-    sqliteDb()->commitTransaction();
+    if (!conf())
+        return true;
 
-    emit appStatRemoved(appId);
+    const int flushSecs = qBound(0, ini()->trafFlushSeconds(), TRAF_FLUSH_SECONDS_MAX);
+    const qint32 flushTicks = flushSecs * OS_TICKS_PER_SECOND;
 
-    return true;
+    return qAbs(OsUtil::getTickCount() - m_trafFlushTick) >= flushTicks;
 }
 
-bool StatManager::resetAppTrafTotals()
+void StatManager::flushTraffic()
 {
-    SqliteStmt *stmt = getStmt(StatSql::sqlResetAppTrafTotals);
-    const qint64 unixTime = DateUtil::getUnixTime();
+    m_trafFlushTick = OsUtil::getTickCount();
+
+    if (!m_appTrafBytes.isEmpty() || m_trafBytes.inBytes != 0 || m_trafBytes.outBytes != 0) {
+        auto job = new StatTrafJob(m_trafHour, m_trafDay, m_trafMonth, m_trafUnixTime);
 
-    stmt->bindInt(1, DateUtil::getUnixHour(unixTime));
+        job->setTrafBytes(m_trafBytes, m_appTrafBytes, m_userAppTrafBytes);
 
-    const bool ok = sqliteDb()->done(stmt);
+        enqueueJob(WorkerJobPtr(job));
+    }
+
+    if (m_deleteOldTraffic) {
+        enqueueJob(WorkerJobPtr(createDeleteOldTrafJob()));
+    }
 
-    if (ok) {
-        emit appTrafTotalsResetted();
+    if (isBackupTime()) {
+        backupDb();
     }
 
-    return ok;
+    clearPendingTraffic();
 }
 
-bool StatManager::hasAppTraf(qint64 appId)
+WorkerJob *StatManager::createDeleteOldTrafJob() const
 {
-    SqliteStmt *stmt = getStmt(StatSql::sqlSelectStatAppExists);
+    // Traffic Hour
+    const int trafHourKeepDays = ini()->trafHourKeepDays();
+    const qint32 oldTrafHour = (trafHourKeepDays >= 0) ? m_trafHour - 24 * trafHourKeepDays : -1;
 
-    stmt->bindInt64(1, appId);
-    const bool res = (stmt->step() == SqliteStmt::StepRow);
-    stmt->reset();
+    // Traffic Day
+    const int trafDayKeepDays = ini()->trafDayKeepDays();
+    const qint32 oldTrafDay = (trafDayKeepDays >= 0) ? m_trafHour - 24 * trafDayKeepDays : -1;
 
-    return res;
+    // Traffic Month
+    const int trafMonthKeepMonths = ini()->trafMonthKeepMonths();
+    const qint32 oldTrafMonth = (trafMonthKeepMonths >= 0)
+            ? DateUtil::addUnixMonths(m_trafHour, -trafMonthKeepMonths)
+            : -1;
+
+    // Traffic Hour's Archive
+    const int trafHourArchiveDays = ini()->trafHourArchiveDays();
+    const qint32 archiveTrafHour = (isArchiveDb() && trafHourArchiveDays > 0)
+            ? m_trafHour - 24 * trafHourArchiveDays
+            : -1;
+
+    return new DeleteOldTrafJob(oldTrafHour, oldTrafDay, oldTrafMonth, archiveTrafHour);
 }
 
-qint64 StatManager::getAppId(const QString &appPath)
+bool StatManager::isBackupTime() const
 {
-    qint64 appId = INVALID_APP_ID;
+    if (!conf())
+        return false;
 
-    SqliteStmt *stmt = getStmt(StatSql::sqlSelectAppId);
+    const int backupHours = qBound(0, ini()->statBackupHours(), BACKUP_HOURS_MAX);
+    if (backupHours == 0)
+        return false;
 
-    stmt->bindText(1, appPath);
-    if (stmt->step() == SqliteStmt::StepRow) {
-        appId = stmt->columnInt64();
-    }
-    stmt->reset();
+    if (!m_isBackupTickSet)
+        return true;
 
-    return appId;
+    const qint32 backupTicks = backupHours * 60 * 60 * OS_TICKS_PER_SECOND;
+
+    return qAbs(OsUtil::getTickCount() - m_backupTick) >= backupTicks;
 }
 
-qint64 StatManager::createAppId(const QString &appPath, qint64 unixTime)
+void StatManager::backupDb()
 {
-    SqliteStmt *stmt = getStmt(StatSql::sqlInsertAppId);
-
-    stmt->bindText(1, appPath);
-    stmt->bindInt64(2, unixTime);
+    m_backupTick = OsUtil::getTickCount();
 
-    if (sqliteDb()->done(stmt)) {
-        return sqliteDb()->lastInsertRowid();
+    // The first snapshot is taken after the interval since the start
+    if (!m_isBackupTickSet) {
+        m_isBackupTickSet = true;
+        return;
     }
 
-    return INVALID_APP_ID;
+    enqueueJob(WorkerJobPtr(new StatBackupJob(sqliteDb()->filePath() + ".bak")));
 }
 
-qint64 StatManager::getOrCreateAppId(const QString &appPath, qint64 unixTime)
+void StatManager::clearPendingTraffic()
 {
-    qint64 appId = getCachedAppId(appPath);
-    if (appId == INVALID_APP_ID) {
-        appId = getAppId(appPath);
-        if (appId == INVALID_APP_ID) {
-            if (unixTime == 0) {
-                unixTime = DateUtil::getUnixTime();
-            }
-            appId = createAppId(appPath, unixTime);
-        }
+    m_deleteOldTraffic = false;
 
-        Q_ASSERT(appId != INVALID_APP_ID);
+    m_trafUnixTime = 0;
 
-        addCachedAppId(appPath, appId);
-    }
-    return appId;
+    m_trafBytes = {};
+    m_appTrafBytes.clear();
+    m_userAppTrafBytes.clear();
 }
 
-bool StatManager::deleteAppId(qint64 appId)
+void StatManager::logFlowStat(const LogEntryFlowStat &entry)
 {
-    SqliteStmt *stmt = getIdStmt(StatSql::sqlDeleteAppId, appId);
+    const bool logFlowStat = conf() && conf()->logFlowStat();
+    if (!logFlowStat)
+        return;
 
-    const bool ok = (stmt->step() == SqliteStmt::StepDone && sqliteDb()->changes() != 0);
-    if (ok) {
-        const QString appPath = stmt->columnText(0);
-        clearCachedAppId(appPath);
+    const quint16 flowCount = entry.flowCount();
+
+    EtwUtil::flowStat(flowCount);
+
+    for (int i = 0; i < flowCount; ++i) {
+        const FlowTraf flowTraf = entry.flowTraf(i);
+
+        emit flowTrafAdded(flowTraf);
     }
-    stmt->reset();
-    return ok;
 }
 
-void StatManager::deleteOldTraffic(qint32 trafHour)
+void StatManager::logShaperStat(const LogEntryShaperStat &entry)
 {
-    SqliteStmtList deleteTrafStmts;
-
-    // Traffic Hour
-    const int trafHourKeepDays = ini()->trafHourKeepDays();
-    if (trafHourKeepDays >= 0) {
-        const qint32 oldTrafHour = trafHour - 24 * trafHourKeepDays;
+    emit shaperStatAdded(entry.shaperStat());
+}
 
-        deleteTrafStmts << getTrafficStmt(StatSql::sqlDeleteTrafAppHour, oldTrafHour)
-                        << getTrafficStmt(StatSql::sqlDeleteTrafHour, oldTrafHour);
-    }
+bool StatManager::deleteStatApp(qint64 appId)
+{
+    enqueueJob(WorkerJobPtr(new DeleteTrafJob(DeleteTrafJob::DeleteApp, appId)));
 
-    // Traffic Day
-    const int trafDayKeepDays = ini()->trafDayKeepDays();
-    if (trafDayKeepDays >= 0) {
-        const qint32 oldTrafDay = trafHour - 24 * trafDayKeepDays;
+    return true;
+}
 
-        deleteTrafStmts << getTrafficStmt(StatSql::sqlDeleteTrafAppDay, oldTrafDay)
-                        << getTrafficStmt(StatSql::sqlDeleteTrafDay, oldTrafDay);
-    }
+bool StatManager::resetAppTrafTotals()
+{
+    flushTraffic();
 
-    // Traffic Month
-    const int trafMonthKeepMonths = ini()->trafMonthKeepMonths();
-    if (trafMonthKeepMonths >= 0) {
-        const qint32 oldTrafMonth = DateUtil::addUnixMonths(trafHour, -trafMonthKeepMonths);
+    const qint32 trafHour = DateUtil::getUnixHour(DateUtil::getUnixTime());
 
-        deleteTrafStmts << getTrafficStmt(StatSql::sqlDeleteTrafAppMonth, oldTrafMonth)
-                        << getTrafficStmt(StatSql::sqlDeleteTrafMonth, oldTrafMonth);
-    }
+    enqueueJob(WorkerJobPtr(
+            new DeleteTrafJob(DeleteTrafJob::ResetAppTotals, /*appId=*/0, trafHour)));
 
-    SqliteStmt::doList(deleteTrafStmts);
+    return true;
 }
 
 void StatManager::getStatAppList(QStringList &list, QVector<qint64> &appIds)
@@ -477,9 +533,20 @@ void StatManager::getStatAppList(QStringList &list, QVector<qint64> &appIds)
     stmt->reset();
 }
 
-void StatManager::logTrafBytes(const SqliteStmtList &insertStmtList,
-        const SqliteStmtList &updateStmtList, quint32 &sumInBytes, quint32 &sumOutBytes,
-        quint32 pid, quint32 inBytes, quint32 outBytes, qint64 unixTime, bool logStat)
+void StatManager::logConns(quint32 pid, quint16 connCount, quint16 blockedCount)
+{
+    if (connCount == 0 && blockedCount == 0)
+        return;
+
+    const QString appPath = m_appPidPathMap.value(pid);
+    if (appPath.isEmpty())
+        return;
+
+    emit appConnsAdded(appPath, connCount, blockedCount);
+}
+
+void StatManager::logTrafBytes(quint64 &sumInBytes, quint64 &sumOutBytes, quint32 pid,
+        quint64 inBytes, quint64 outBytes, bool logStat)
 {
     const QString appPath = m_appPidPathMap.value(pid);
 
@@ -492,50 +559,31 @@ void StatManager::logTrafBytes(const SqliteStmtList &insertStmtList,
     if (inBytes == 0 && outBytes == 0)
         return;
 
-    const qint64 appId = getOrCreateAppId(appPath, unixTime);
-    Q_ASSERT(appId != INVALID_APP_ID);
+    m_topApps.addTraffic(appPath, inBytes, outBytes);
+
+    TrafBytes &totalBytes = m_appTotalBytes[appPath];
+    totalBytes.inBytes += inBytes;
+    totalBytes.outBytes += outBytes;
 
     if (logStat) {
-        if (!hasAppTraf(appId)) {
-            emit appCreated(appId, appPath);
-        }
+        // Add app bytes to be flushed
+        TrafBytes &bytes = m_appTrafBytes[appPath];
 
-        // Update or insert app bytes
-        updateTrafficList(insertStmtList, updateStmtList, inBytes, outBytes, appId);
-    }
+        bytes.inBytes += inBytes;
+        bytes.outBytes += outBytes;
 
-    // Update sum traffic bytes
-    sumInBytes += inBytes;
-    sumOutBytes += outBytes;
-}
+        const QString userName = m_appPidUserMap.value(pid);
+        if (!userName.isEmpty()) {
+            TrafBytes &userBytes = m_userAppTrafBytes[userName][appPath];
 
-void StatManager::updateTrafficList(const SqliteStmtList &insertStmtList,
-        const SqliteStmtList &updateStmtList, quint32 inBytes, quint32 outBytes, qint64 appId)
-{
-    int i = 0;
-    for (SqliteStmt *stmtUpdate : updateStmtList) {
-        if (!updateTraffic(stmtUpdate, inBytes, outBytes, appId)) {
-            SqliteStmt *stmtInsert = insertStmtList.at(i);
-            if (!updateTraffic(stmtInsert, inBytes, outBytes, appId)) {
-                qCCritical(LC) << "Update traffic error:" << sqliteDb()->errorMessage()
-                               << "inBytes:" << inBytes << "outBytes:" << outBytes
-                               << "appId:" << appId << "index:" << i;
-            }
+            userBytes.inBytes += inBytes;
+            userBytes.outBytes += outBytes;
         }
-        ++i;
     }
-}
-
-bool StatManager::updateTraffic(SqliteStmt *stmt, quint32 inBytes, quint32 outBytes, qint64 appId)
-{
-    stmt->bindInt64(2, inBytes);
-    stmt->bindInt64(3, outBytes);
 
-    if (appId != 0) {
-        stmt->bindInt64(4, appId);
-    }
-
-    return sqliteDb()->done(stmt);
+    // Update sum traffic bytes
+    sumInBytes += inBytes;
+    sumOutBytes += outBytes;
 }
 
 qint32 StatManager::getTrafficTime(const char *sql, qint64 appId)
@@ -577,25 +625,76 @@ void StatManager::getTraffic(
     stmt->reset();
 }
 
-SqliteStmt *StatManager::getStmt(const char *sql)
+void StatManager::getTrafficRange(const char *sql, qint32 minTrafTime, qint32 maxTrafTime,
+        TrafTimeBytesMap &trafMap, qint64 appId)
+{
+    SqliteStmt *stmt = getStmt(sql);
+
+    stmt->bindInt(1, minTrafTime);
+    stmt->bindInt(2, maxTrafTime);
+
+    if (appId != 0) {
+        stmt->bindInt64(3, appId);
+    }
+
+    while (stmt->step() == SqliteStmt::StepRow) {
+        const qint32 trafTime = stmt->columnInt(0);
+
+        trafMap.insert(trafTime, { quint64(stmt->columnInt64(1)), quint64(stmt->columnInt64(2)) });
+    }
+
+    stmt->reset();
+}
+
+QVector<TopAppTraf> StatManager::getTopApps(StatTopApps::Window window, int count)
 {
-    return sqliteDb()->stmt(sql);
+    // Expire the windows without new traffic
+    m_topApps.advance(DateUtil::getUnixTime());
+
+    return m_topApps.topApps(window, count);
 }
 
-SqliteStmt *StatManager::getTrafficStmt(const char *sql, qint32 trafTime)
+QVector<TopUserAppTraf> StatManager::getUserTopApps(
+        qint32 minTrafHour, qint32 maxTrafHour, int count)
 {
-    SqliteStmt *stmt = getStmt(sql);
+    QVector<TopUserAppTraf> list;
 
-    stmt->bindInt(1, trafTime);
+    SqliteStmt *stmt = getStmt(StatSql::sqlSelectTrafUserTopApps);
+
+    stmt->bindInt(1, minTrafHour);
+    stmt->bindInt(2, maxTrafHour);
+    stmt->bindInt(3, count);
 
-    return stmt;
+    while (stmt->step() == SqliteStmt::StepRow) {
+        const TopUserAppTraf top = {
+            .userName = stmt->columnText(0),
+            .appPath = stmt->columnText(1),
+            .bytes = { quint64(stmt->columnInt64(2)), quint64(stmt->columnInt64(3)) },
+        };
+
+        list.append(top);
+    }
+
+    stmt->reset();
+
+    return list;
 }
 
-SqliteStmt *StatManager::getIdStmt(const char *sql, qint64 id)
+void StatManager::fillFlowsAppPaths(QVector<FlowInfo> &flows) const
 {
-    SqliteStmt *stmt = getStmt(sql);
+    for (FlowInfo &flow : flows) {
+        if (flow.appPath.isEmpty()) {
+            flow.appPath = m_appPidPathMap.value(flow.pid);
+        }
+    }
+}
 
-    stmt->bindInt64(1, id);
+SqliteStmt *StatManager::getStmt(const char *sql)
+{
+    // Query the archived hours too
+    if (m_isRoArchiveDb) {
+        sql = StatSql::archiveSql(sql);
+    }
 
-    return stmt;
+    return roSqliteDb()->stmt(sql);
 }
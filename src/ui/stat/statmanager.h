@@ -10,13 +10,23 @@
 
 #include <util/classhelpers.h>
 #include <util/ioc/iocservice.h>
+#include <util/worker/workermanager.h>
+
+#include "stattopapps.h"
+#include "stattrafjob.h"
 
 class FirewallConf;
 class IniOptions;
+class LogEntryFlowStat;
 class LogEntryProcNew;
+class LogEntryShaperStat;
 class LogEntryStatTraf;
 
-class StatManager : public QObject, public IocService
+struct FlowInfo;
+struct FlowTraf;
+struct ShaperStat;
+
+class StatManager : public WorkerManager, public IocService
 {
     Q_OBJECT
 
@@ -29,31 +39,59 @@ public:
 
     const IniOptions *ini() const;
 
+    // Used by the worker's jobs
     SqliteDb *sqliteDb() const { return m_sqliteDb.data(); }
 
+    // Used by the readers
+    SqliteDb *roSqliteDb() const { return m_roSqliteDb.data(); }
+
+    // Is the archive DB of the old hours' traffic attached to the worker's DB
+    bool isArchiveDb() const { return m_isArchiveDb; }
+
+    QString workerName() const override { return "StatTrafWorker"; }
+
     void setUp() override;
+    void tearDown() override;
 
     bool logProcNew(const LogEntryProcNew &entry, qint64 unixTime = 0);
     bool logStatTraf(const LogEntryStatTraf &entry, qint64 unixTime = 0);
+    void logFlowStat(const LogEntryFlowStat &entry);
+    void logShaperStat(const LogEntryShaperStat &entry);
 
     void getStatAppList(QStringList &list, QVector<qint64> &appIds);
 
     virtual bool deleteStatApp(qint64 appId);
 
     virtual bool resetAppTrafTotals();
-    bool hasAppTraf(qint64 appId);
 
     qint32 getTrafficTime(const char *sql, qint64 appId = 0);
 
     void getTraffic(
             const char *sql, qint32 trafTime, qint64 &inBytes, qint64 &outBytes, qint64 appId = 0);
 
+    void getTrafficRange(const char *sql, qint32 minTrafTime, qint32 maxTrafTime,
+            TrafTimeBytesMap &trafMap, qint64 appId = 0);
+
+    virtual QVector<TopAppTraf> getTopApps(StatTopApps::Window window, int count);
+
+    // By the logged hours' traffic of the sessions' users
+    QVector<TopUserAppTraf> getUserTopApps(qint32 minTrafHour, qint32 maxTrafHour, int count);
+
+    // By the logged processes' paths
+    void fillFlowsAppPaths(QVector<FlowInfo> &flows) const;
+
+    // The apps' traffic since the start, for the metrics
+    const AppTrafBytesMap &appTotalBytes() const { return m_appTotalBytes; }
+
 signals:
     void trafficCleared();
 
     void appStatRemoved(qint64 appId);
     void appCreated(qint64 appId, const QString &appPath);
-    void trafficAdded(qint64 unixTime, quint32 inBytes, quint32 outBytes);
+    void trafficAdded(qint64 unixTime, quint64 inBytes, quint64 outBytes);
+    void appConnsAdded(const QString &appPath, quint16 connCount, quint16 blockedCount);
+    void flowTrafAdded(const FlowTraf &flowTraf);
+    void shaperStatAdded(const ShaperStat &shaperStat);
 
     void connChanged();
 
@@ -62,8 +100,14 @@ signals:
 public slots:
     virtual bool clearTraffic();
 
+protected:
+    bool canMergeJobs() const override { return true; }
+
 private:
     bool setupDb();
+    void setupArchiveDb();
+
+    QString archiveFilePath() const;
 
     void setupTrafDate();
 
@@ -73,42 +117,35 @@ private:
     void updateActivePeriod();
 
     void clearQuotas(bool isNewDay, bool isNewMonth);
-    void checkQuotas(quint32 inBytes);
 
     bool updateTrafDay(qint64 unixTime);
 
-    void logClear();
-    void logClearApp(quint32 pid);
+    bool isTrafFlushTime() const;
+    void flushTraffic();
 
-    void addCachedAppId(const QString &appPath, qint64 appId);
-    qint64 getCachedAppId(const QString &appPath) const;
-    void clearCachedAppId(const QString &appPath);
-    void clearAppIdCache();
+    WorkerJob *createDeleteOldTrafJob() const;
 
-    qint64 getAppId(const QString &appPath);
-    qint64 createAppId(const QString &appPath, qint64 unixTime);
-    qint64 getOrCreateAppId(const QString &appPath, qint64 unixTime = 0);
-    bool deleteAppId(qint64 appId);
+    bool isBackupTime() const;
+    void backupDb();
 
-    void deleteOldTraffic(qint32 trafHour);
+    void clearPendingTraffic();
 
-    void logTrafBytes(const SqliteStmtList &insertStmtList, const SqliteStmtList &updateStmtList,
-            quint32 &sumInBytes, quint32 &sumOutBytes, quint32 pid, quint32 inBytes,
-            quint32 outBytes, qint64 unixTime, bool logStat);
-
-    void updateTrafficList(const SqliteStmtList &insertStmtList,
-            const SqliteStmtList &updateStmtList, quint32 inBytes, quint32 outBytes,
-            qint64 appId = 0);
+    void logClear();
+    void logClearApp(quint32 pid);
 
-    bool updateTraffic(SqliteStmt *stmt, quint32 inBytes, quint32 outBytes, qint64 appId = 0);
+    void logConns(quint32 pid, quint16 connCount, quint16 blockedCount);
+    void logTrafBytes(quint64 &sumInBytes, quint64 &sumOutBytes, quint32 pid, quint64 inBytes,
+            quint64 outBytes, bool logStat);
 
     SqliteStmt *getStmt(const char *sql);
-    SqliteStmt *getTrafficStmt(const char *sql, qint32 trafTime);
-    SqliteStmt *getIdStmt(const char *sql, qint64 id);
 
 private:
     bool m_isActivePeriodSet : 1 = false;
     bool m_isActivePeriod : 1 = false;
+    bool m_deleteOldTraffic : 1 = false;
+    bool m_isBackupTickSet : 1 = false;
+    bool m_isArchiveDb : 1 = false;
+    bool m_isRoArchiveDb : 1 = false;
 
     quint8 m_activePeriodFromHour = 0;
     quint8 m_activePeriodFromMinute = 0;
@@ -119,13 +156,28 @@ private:
     qint32 m_trafDay = 0;
     qint32 m_trafMonth = 0;
     qint32 m_tick = 0;
+    qint32 m_trafFlushTick = 0;
+    qint32 m_backupTick = 0;
+
+    qint64 m_trafUnixTime = 0; // of the first not flushed traffic
 
     const FirewallConf *m_conf = nullptr;
 
     SqliteDbPtr m_sqliteDb;
+    SqliteDbPtr m_roSqliteDb;
 
     QHash<quint32, QString> m_appPidPathMap; // pid -> appPath
-    QHash<QString, qint64> m_appPathIdCache; // appPath -> appId
+    QHash<quint32, QString> m_appPidUserMap; // pid -> userName
+
+    // Not flushed traffic of the current hour
+    TrafBytes m_trafBytes;
+    AppTrafBytesMap m_appTrafBytes;
+    UserAppTrafBytesMap m_userAppTrafBytes;
+
+    AppTrafBytesMap m_appTotalBytes;
+
+    // Recent traffic of the apps, including not logged to the DB
+    StatTopApps m_topApps;
 };
 
 #endif // STATMANAGER_H
@@ -1,79 +1,92 @@
 #include "statsql.h"
 
+#include <QHash>
+
+// The incremental vacuum is enabled by the DB's creation
+const char *const StatSql::sqlPragmas = "PRAGMA auto_vacuum = INCREMENTAL;"
+                                        "PRAGMA journal_mode = WAL;"
+                                        "PRAGMA locking_mode = NORMAL;"
+                                        "PRAGMA synchronous = NORMAL;"
+                                        "PRAGMA encoding = 'UTF-8';";
+
 const char *const StatSql::sqlSelectAppId = "SELECT app_id FROM app WHERE path = ?1;";
 
 const char *const StatSql::sqlInsertAppId = "INSERT INTO app(path, creat_time) VALUES(?1, ?2);";
 
 const char *const StatSql::sqlDeleteAppId = "DELETE FROM app WHERE app_id = ?1 RETURNING path;";
 
+const char *const StatSql::sqlSelectUserId = "SELECT user_id FROM user WHERE name = ?1;";
+
+const char *const StatSql::sqlInsertUserId = "INSERT INTO user(name, creat_time) VALUES(?1, ?2);";
+
 const char *const StatSql::sqlSelectStatAppExists = "SELECT 1 FROM traffic_app WHERE app_id = ?1;";
 
 const char *const StatSql::sqlSelectStatAppList = "SELECT t.app_id, t.path FROM app t"
                                                   "  JOIN traffic_app ta ON ta.app_id = t.app_id"
                                                   "  ORDER BY t.app_id;";
 
-const char *const StatSql::sqlInsertTrafAppHour =
+const char *const StatSql::sqlUpsertTrafAppHour =
         "INSERT INTO traffic_app_hour(app_id, traf_time, in_bytes, out_bytes)"
-        "  VALUES(?4, ?1, ?2, ?3);";
+        "  VALUES(?4, ?1, ?2, ?3)"
+        "  ON CONFLICT(app_id, traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafAppDay =
+const char *const StatSql::sqlUpsertTrafAppDay =
         "INSERT INTO traffic_app_day(app_id, traf_time, in_bytes, out_bytes)"
-        "  VALUES(?4, ?1, ?2, ?3);";
+        "  VALUES(?4, ?1, ?2, ?3)"
+        "  ON CONFLICT(app_id, traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafAppMonth =
+const char *const StatSql::sqlUpsertTrafAppMonth =
         "INSERT INTO traffic_app_month(app_id, traf_time, in_bytes, out_bytes)"
-        "  VALUES(?4, ?1, ?2, ?3);";
+        "  VALUES(?4, ?1, ?2, ?3)"
+        "  ON CONFLICT(app_id, traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafAppTotal =
+const char *const StatSql::sqlUpsertTrafAppTotal =
         "INSERT INTO traffic_app(app_id, traf_time, in_bytes, out_bytes)"
-        "  VALUES(?4, ?1, ?2, ?3);";
-
-const char *const StatSql::sqlInsertTrafHour =
+        "  VALUES(?4, ?1, ?2, ?3)"
+        "  ON CONFLICT(app_id) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
+
+const char *const StatSql::sqlUpsertTrafUserAppHour =
+        "INSERT INTO traffic_user_app_hour(user_id, app_id, traf_time, in_bytes, out_bytes)"
+        "  VALUES(?5, ?4, ?1, ?2, ?3)"
+        "  ON CONFLICT(user_id, app_id, traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
+
+const char *const StatSql::sqlUpsertTrafUserAppDay =
+        "INSERT INTO traffic_user_app_day(user_id, app_id, traf_time, in_bytes, out_bytes)"
+        "  VALUES(?5, ?4, ?1, ?2, ?3)"
+        "  ON CONFLICT(user_id, app_id, traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
+
+const char *const StatSql::sqlUpsertTrafHour =
         "INSERT INTO traffic_hour(traf_time, in_bytes, out_bytes)"
-        "  VALUES(?1, ?2, ?3);";
+        "  VALUES(?1, ?2, ?3)"
+        "  ON CONFLICT(traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafDay =
+const char *const StatSql::sqlUpsertTrafDay =
         "INSERT INTO traffic_day(traf_time, in_bytes, out_bytes)"
-        "  VALUES(?1, ?2, ?3);";
+        "  VALUES(?1, ?2, ?3)"
+        "  ON CONFLICT(traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
-const char *const StatSql::sqlInsertTrafMonth =
+const char *const StatSql::sqlUpsertTrafMonth =
         "INSERT INTO traffic_month(traf_time, in_bytes, out_bytes)"
-        "  VALUES(?1, ?2, ?3);";
-
-const char *const StatSql::sqlUpdateTrafAppHour = "UPDATE traffic_app_hour"
-                                                  "  SET in_bytes = in_bytes + ?2,"
-                                                  "    out_bytes = out_bytes + ?3"
-                                                  "  WHERE app_id = ?4 AND traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafAppDay = "UPDATE traffic_app_day"
-                                                 "  SET in_bytes = in_bytes + ?2,"
-                                                 "    out_bytes = out_bytes + ?3"
-                                                 "  WHERE app_id = ?4 AND traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafAppMonth = "UPDATE traffic_app_month"
-                                                   "  SET in_bytes = in_bytes + ?2,"
-                                                   "    out_bytes = out_bytes + ?3"
-                                                   "  WHERE app_id = ?4 AND traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafAppTotal = "UPDATE traffic_app"
-                                                   "  SET in_bytes = in_bytes + ?2,"
-                                                   "    out_bytes = out_bytes + ?3"
-                                                   "  WHERE app_id = ?4 AND 0 != ?1;";
-
-const char *const StatSql::sqlUpdateTrafHour = "UPDATE traffic_hour"
-                                               "  SET in_bytes = in_bytes + ?2,"
-                                               "    out_bytes = out_bytes + ?3"
-                                               "  WHERE traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafDay = "UPDATE traffic_day"
-                                              "  SET in_bytes = in_bytes + ?2,"
-                                              "    out_bytes = out_bytes + ?3"
-                                              "  WHERE traf_time = ?1;";
-
-const char *const StatSql::sqlUpdateTrafMonth = "UPDATE traffic_month"
-                                                "  SET in_bytes = in_bytes + ?2,"
-                                                "    out_bytes = out_bytes + ?3"
-                                                "  WHERE traf_time = ?1;";
+        "  VALUES(?1, ?2, ?3)"
+        "  ON CONFLICT(traf_time) DO UPDATE"
+        "  SET in_bytes = in_bytes + excluded.in_bytes,"
+        "    out_bytes = out_bytes + excluded.out_bytes;";
 
 const char *const StatSql::sqlSelectMinTrafAppHour = "SELECT min(traf_time) FROM traffic_app_hour"
                                                      "  WHERE app_id = ?1;";
@@ -89,9 +102,9 @@ const char *const StatSql::sqlSelectMinTrafAppTotal =
 
 const char *const StatSql::sqlSelectMinTrafHour = "SELECT min(traf_time) FROM traffic_hour;";
 
-const char *const StatSql::sqlSelectMinTrafDay = "SELECT min(traf_time) FROM traffic_app_day;";
+const char *const StatSql::sqlSelectMinTrafDay = "SELECT min(traf_time) FROM traffic_day;";
 
-const char *const StatSql::sqlSelectMinTrafMonth = "SELECT min(traf_time) FROM traffic_app_month;";
+const char *const StatSql::sqlSelectMinTrafMonth = "SELECT min(traf_time) FROM traffic_month;";
 
 const char *const StatSql::sqlSelectMinTrafTotal = "SELECT min(traf_time) FROM traffic_app;";
 
@@ -123,20 +136,84 @@ const char *const StatSql::sqlSelectTrafMonth = "SELECT in_bytes, out_bytes"
 const char *const StatSql::sqlSelectTrafTotal = "SELECT sum(in_bytes), sum(out_bytes)"
                                                 "  FROM traffic_app WHERE 0 != ?1;";
 
-const char *const StatSql::sqlDeleteTrafAppHour = "DELETE FROM traffic_app_hour"
-                                                  "  WHERE traf_time < ?1 AND app_id > 0;";
-
-const char *const StatSql::sqlDeleteTrafAppDay = "DELETE FROM traffic_app_day"
-                                                 "  WHERE traf_time < ?1 AND app_id > 0;";
-
-const char *const StatSql::sqlDeleteTrafAppMonth = "DELETE FROM traffic_app_month"
-                                                   "  WHERE traf_time < ?1 AND app_id > 0;";
-
-const char *const StatSql::sqlDeleteTrafHour = "DELETE FROM traffic_hour WHERE traf_time < ?1;";
-
-const char *const StatSql::sqlDeleteTrafDay = "DELETE FROM traffic_day WHERE traf_time < ?1;";
-
-const char *const StatSql::sqlDeleteTrafMonth = "DELETE FROM traffic_month WHERE traf_time < ?1;";
+const char *const StatSql::sqlSelectTrafAppHourRange =
+        "SELECT traf_time, in_bytes, out_bytes FROM traffic_app_hour"
+        "  WHERE app_id = ?3 AND traf_time BETWEEN ?1 AND ?2;";
+
+const char *const StatSql::sqlSelectTrafAppDayRange =
+        "SELECT traf_time, in_bytes, out_bytes FROM traffic_app_day"
+        "  WHERE app_id = ?3 AND traf_time BETWEEN ?1 AND ?2;";
+
+const char *const StatSql::sqlSelectTrafAppMonthRange =
+        "SELECT traf_time, in_bytes, out_bytes FROM traffic_app_month"
+        "  WHERE app_id = ?3 AND traf_time BETWEEN ?1 AND ?2;";
+
+const char *const StatSql::sqlSelectTrafUserTopApps =
+        "SELECT u.name, t.path, sum(h.in_bytes) AS in_sum, sum(h.out_bytes) AS out_sum"
+        "  FROM traffic_user_app_hour h"
+        "    JOIN user u ON u.user_id = h.user_id"
+        "    JOIN app t ON t.app_id = h.app_id"
+        "  WHERE h.traf_time BETWEEN ?1 AND ?2"
+        "  GROUP BY h.user_id, h.app_id"
+        "  ORDER BY in_sum + out_sum DESC"
+        "  LIMIT ?3;";
+
+const char *const StatSql::sqlSelectTrafHourRange = "SELECT traf_time, in_bytes, out_bytes"
+                                                    "  FROM traffic_hour"
+                                                    "  WHERE traf_time BETWEEN ?1 AND ?2;";
+
+const char *const StatSql::sqlSelectTrafDayRange = "SELECT traf_time, in_bytes, out_bytes"
+                                                   "  FROM traffic_day"
+                                                   "  WHERE traf_time BETWEEN ?1 AND ?2;";
+
+const char *const StatSql::sqlSelectTrafMonthRange = "SELECT traf_time, in_bytes, out_bytes"
+                                                     "  FROM traffic_month"
+                                                     "  WHERE traf_time BETWEEN ?1 AND ?2;";
+
+const char *const StatSql::sqlDeleteTrafAppHour =
+        "DELETE FROM traffic_app_hour WHERE (app_id, traf_time) IN ("
+        "  SELECT app_id, traf_time FROM traffic_app_hour"
+        "    WHERE traf_time < ?1 AND app_id > 0 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteTrafAppDay =
+        "DELETE FROM traffic_app_day WHERE (app_id, traf_time) IN ("
+        "  SELECT app_id, traf_time FROM traffic_app_day"
+        "    WHERE traf_time < ?1 AND app_id > 0 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteTrafAppMonth =
+        "DELETE FROM traffic_app_month WHERE (app_id, traf_time) IN ("
+        "  SELECT app_id, traf_time FROM traffic_app_month"
+        "    WHERE traf_time < ?1 AND app_id > 0 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteTrafUserAppHour =
+        "DELETE FROM traffic_user_app_hour WHERE (user_id, app_id, traf_time) IN ("
+        "  SELECT user_id, app_id, traf_time FROM traffic_user_app_hour"
+        "    WHERE traf_time < ?1 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteTrafUserAppDay =
+        "DELETE FROM traffic_user_app_day WHERE (user_id, app_id, traf_time) IN ("
+        "  SELECT user_id, app_id, traf_time FROM traffic_user_app_day"
+        "    WHERE traf_time < ?1 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteTrafHour =
+        "DELETE FROM traffic_hour WHERE traf_time IN ("
+        "  SELECT traf_time FROM traffic_hour WHERE traf_time < ?1 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteTrafDay =
+        "DELETE FROM traffic_day WHERE traf_time IN ("
+        "  SELECT traf_time FROM traffic_day WHERE traf_time < ?1 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteTrafMonth =
+        "DELETE FROM traffic_month WHERE traf_time IN ("
+        "  SELECT traf_time FROM traffic_month WHERE traf_time < ?1 LIMIT ?2"
+        ");";
 
 const char *const StatSql::sqlDeleteAppTrafHour = "DELETE FROM traffic_app_hour"
                                                   "  WHERE app_id = ?1;";
@@ -150,6 +227,12 @@ const char *const StatSql::sqlDeleteAppTrafMonth = "DELETE FROM traffic_app_mont
 const char *const StatSql::sqlDeleteAppTrafTotal = "DELETE FROM traffic_app"
                                                    "  WHERE app_id = ?1;";
 
+const char *const StatSql::sqlDeleteAppTrafUserHour = "DELETE FROM traffic_user_app_hour"
+                                                      "  WHERE app_id = ?1;";
+
+const char *const StatSql::sqlDeleteAppTrafUserDay = "DELETE FROM traffic_user_app_day"
+                                                     "  WHERE app_id = ?1;";
+
 const char *const StatSql::sqlResetAppTrafTotals =
         "UPDATE traffic_app"
         "  SET traf_time = ?1, in_bytes = 0, out_bytes = 0;";
@@ -161,18 +244,258 @@ const char *const StatSql::sqlDeleteAllTraffic = "DELETE FROM traffic_app;"
                                                  "DELETE FROM traffic_hour;"
                                                  "DELETE FROM traffic_day;"
                                                  "DELETE FROM traffic_month;"
+                                                 "DELETE FROM traffic_user_app_hour;"
+                                                 "DELETE FROM traffic_user_app_day;"
+                                                 "DELETE FROM user;"
                                                  "DELETE FROM app;";
 
+const char *const StatSql::sqlArchivePragmas = "PRAGMA archive.auto_vacuum = INCREMENTAL;"
+                                               "PRAGMA archive.journal_mode = WAL;"
+                                               "PRAGMA archive.synchronous = NORMAL;";
+
+// Keep the archive's pages out of the stat DB's cache
+const char *const StatSql::sqlArchiveTune = "PRAGMA archive.cache_size = -512;";
+
+const char *const StatSql::sqlCreateArchiveTables =
+        "CREATE TABLE IF NOT EXISTS archive.traffic_app_hour("
+        "  app_id INTEGER NOT NULL,"
+        "  traf_time INTEGER NOT NULL,"
+        "  in_bytes INTEGER NOT NULL,"
+        "  out_bytes INTEGER NOT NULL,"
+        "  PRIMARY KEY (app_id, traf_time)"
+        ") WITHOUT ROWID;"
+        "CREATE TABLE IF NOT EXISTS archive.traffic_user_app_hour("
+        "  user_id INTEGER NOT NULL,"
+        "  app_id INTEGER NOT NULL,"
+        "  traf_time INTEGER NOT NULL,"
+        "  in_bytes INTEGER NOT NULL,"
+        "  out_bytes INTEGER NOT NULL,"
+        "  PRIMARY KEY (user_id, app_id, traf_time)"
+        ") WITHOUT ROWID;"
+        "CREATE INDEX IF NOT EXISTS archive.traffic_user_app_hour_time_idx"
+        "  ON traffic_user_app_hour(traf_time);"
+        "CREATE TABLE IF NOT EXISTS archive.traffic_hour("
+        "  traf_time INTEGER PRIMARY KEY,"
+        "  in_bytes INTEGER NOT NULL,"
+        "  out_bytes INTEGER NOT NULL"
+        ") WITHOUT ROWID;";
+
+// The archived chunks are deleted by the same order; the repeated chunk is replaced
+const char *const StatSql::sqlArchiveTrafAppHour =
+        "INSERT OR REPLACE INTO archive.traffic_app_hour(app_id, traf_time, in_bytes, out_bytes)"
+        "  SELECT app_id, traf_time, in_bytes, out_bytes FROM traffic_app_hour"
+        "    WHERE traf_time < ?1 AND app_id > 0 ORDER BY app_id, traf_time LIMIT ?2;";
+
+const char *const StatSql::sqlArchiveTrafHour =
+        "INSERT OR REPLACE INTO archive.traffic_hour(traf_time, in_bytes, out_bytes)"
+        "  SELECT traf_time, in_bytes, out_bytes FROM traffic_hour"
+        "    WHERE traf_time < ?1 ORDER BY traf_time LIMIT ?2;";
+
+const char *const StatSql::sqlArchiveTrafUserAppHour =
+        "INSERT OR REPLACE INTO archive.traffic_user_app_hour("
+        "    user_id, app_id, traf_time, in_bytes, out_bytes)"
+        "  SELECT user_id, app_id, traf_time, in_bytes, out_bytes FROM traffic_user_app_hour"
+        "    WHERE traf_time < ?1 ORDER BY user_id, app_id, traf_time LIMIT ?2;";
+
+const char *const StatSql::sqlDeleteArchivedTrafAppHour =
+        "DELETE FROM traffic_app_hour WHERE (app_id, traf_time) IN ("
+        "  SELECT app_id, traf_time FROM traffic_app_hour"
+        "    WHERE traf_time < ?1 AND app_id > 0 ORDER BY app_id, traf_time LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteArchivedTrafHour =
+        "DELETE FROM traffic_hour WHERE traf_time IN ("
+        "  SELECT traf_time FROM traffic_hour WHERE traf_time < ?1 ORDER BY traf_time LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteArchivedTrafUserAppHour =
+        "DELETE FROM traffic_user_app_hour WHERE (user_id, app_id, traf_time) IN ("
+        "  SELECT user_id, app_id, traf_time FROM traffic_user_app_hour"
+        "    WHERE traf_time < ?1 ORDER BY user_id, app_id, traf_time LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteArchiveTrafAppHour =
+        "DELETE FROM archive.traffic_app_hour WHERE (app_id, traf_time) IN ("
+        "  SELECT app_id, traf_time FROM archive.traffic_app_hour"
+        "    WHERE traf_time < ?1 AND app_id > 0 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteArchiveTrafHour =
+        "DELETE FROM archive.traffic_hour WHERE traf_time IN ("
+        "  SELECT traf_time FROM archive.traffic_hour WHERE traf_time < ?1 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteArchiveTrafUserAppHour =
+        "DELETE FROM archive.traffic_user_app_hour WHERE (user_id, app_id, traf_time) IN ("
+        "  SELECT user_id, app_id, traf_time FROM archive.traffic_user_app_hour"
+        "    WHERE traf_time < ?1 LIMIT ?2"
+        ");";
+
+const char *const StatSql::sqlDeleteAppArchiveTrafHour = "DELETE FROM archive.traffic_app_hour"
+                                                         "  WHERE app_id = ?1;";
+
+const char *const StatSql::sqlDeleteAppArchiveTrafUserHour =
+        "DELETE FROM archive.traffic_user_app_hour WHERE app_id = ?1;";
+
+const char *const StatSql::sqlDeleteAllArchiveTraffic =
+        "DELETE FROM archive.traffic_app_hour;"
+        "DELETE FROM archive.traffic_hour;"
+        "DELETE FROM archive.traffic_user_app_hour;";
+
+const char *const StatSql::sqlSelectMinTrafAppHourArchive =
+        "SELECT min(traf_time) FROM ("
+        "  SELECT min(traf_time) AS traf_time FROM traffic_app_hour WHERE app_id = ?1"
+        "  UNION ALL"
+        "  SELECT min(traf_time) FROM archive.traffic_app_hour WHERE app_id = ?1"
+        ");";
+
+const char *const StatSql::sqlSelectMinTrafHourArchive =
+        "SELECT min(traf_time) FROM ("
+        "  SELECT min(traf_time) AS traf_time FROM traffic_hour"
+        "  UNION ALL"
+        "  SELECT min(traf_time) FROM archive.traffic_hour"
+        ");";
+
+const char *const StatSql::sqlSelectTrafAppHourArchive =
+        "SELECT in_bytes, out_bytes FROM traffic_app_hour"
+        "  WHERE app_id = ?2 AND traf_time = ?1"
+        "  UNION ALL "
+        "SELECT in_bytes, out_bytes FROM archive.traffic_app_hour"
+        "  WHERE app_id = ?2 AND traf_time = ?1;";
+
+const char *const StatSql::sqlSelectTrafHourArchive =
+        "SELECT in_bytes, out_bytes FROM traffic_hour WHERE traf_time = ?1"
+        "  UNION ALL "
+        "SELECT in_bytes, out_bytes FROM archive.traffic_hour WHERE traf_time = ?1;";
+
+const char *const StatSql::sqlSelectTrafAppHourRangeArchive =
+        "SELECT traf_time, in_bytes, out_bytes FROM archive.traffic_app_hour"
+        "  WHERE app_id = ?3 AND traf_time BETWEEN ?1 AND ?2"
+        "  UNION ALL "
+        "SELECT traf_time, in_bytes, out_bytes FROM traffic_app_hour"
+        "  WHERE app_id = ?3 AND traf_time BETWEEN ?1 AND ?2;";
+
+const char *const StatSql::sqlSelectTrafHourRangeArchive =
+        "SELECT traf_time, in_bytes, out_bytes FROM archive.traffic_hour"
+        "  WHERE traf_time BETWEEN ?1 AND ?2"
+        "  UNION ALL "
+        "SELECT traf_time, in_bytes, out_bytes FROM traffic_hour"
+        "  WHERE traf_time BETWEEN ?1 AND ?2;";
+
+const char *const StatSql::sqlSelectTrafUserTopAppsArchive =
+        "SELECT u.name, t.path, sum(h.in_bytes) AS in_sum, sum(h.out_bytes) AS out_sum"
+        "  FROM ("
+        "    SELECT user_id, app_id, in_bytes, out_bytes FROM traffic_user_app_hour"
+        "      WHERE traf_time BETWEEN ?1 AND ?2"
+        "    UNION ALL"
+        "    SELECT user_id, app_id, in_bytes, out_bytes FROM archive.traffic_user_app_hour"
+        "      WHERE traf_time BETWEEN ?1 AND ?2"
+        "  ) h"
+        "    JOIN user u ON u.user_id = h.user_id"
+        "    JOIN app t ON t.app_id = h.app_id"
+        "  GROUP BY h.user_id, h.app_id"
+        "  ORDER BY in_sum + out_sum DESC"
+        "  LIMIT ?3;";
+
+const char *StatSql::archiveSql(const char *sql)
+{
+    static const QHash<const char *, const char *> archiveSqls = {
+        { sqlSelectMinTrafAppHour, sqlSelectMinTrafAppHourArchive },
+        { sqlSelectMinTrafHour, sqlSelectMinTrafHourArchive },
+        { sqlSelectTrafAppHour, sqlSelectTrafAppHourArchive },
+        { sqlSelectTrafHour, sqlSelectTrafHourArchive },
+        { sqlSelectTrafAppHourRange, sqlSelectTrafAppHourRangeArchive },
+        { sqlSelectTrafHourRange, sqlSelectTrafHourRangeArchive },
+        { sqlSelectTrafUserTopApps, sqlSelectTrafUserTopAppsArchive },
+    };
+
+    return archiveSqls.value(sql, sql);
+}
+
 const char *const StatSql::sqlInsertConnBlock =
-        "INSERT INTO conn_block(app_id, conn_time, process_id, inbound, inherited,"
+        "INSERT INTO conn_block_last(app_id, conn_time, process_id, inbound, inherited,"
         "    ip_proto, local_port, remote_port, local_ip, remote_ip,"
         "    local_ip6, remote_ip6, block_reason)"
         "  VALUES(?1, ?2, ?3, ?4, ?5, ?6, ?7, ?8, ?9, ?10, ?11, ?12, ?13);";
 
-const char *const StatSql::sqlSelectMinMaxConnBlockId =
-        "SELECT MIN(conn_id), MAX(conn_id) FROM conn_block;";
+const char *const StatSql::sqlInsertConnBlockRows =
+        "INSERT INTO conn_block_last(app_id, conn_time, process_id, inbound, inherited,"
+        "    ip_proto, local_port, remote_port, local_ip, remote_ip,"
+        "    local_ip6, remote_ip6, block_reason)"
+        "  VALUES";
 
-const char *const StatSql::sqlDeleteConnBlock = "DELETE FROM conn_block WHERE conn_id <= ?1;";
+const char *const StatSql::sqlUpdateConnBlockRepeat =
+        "UPDATE conn_block_last SET repeat_count = repeat_count + ?1, last_time = ?2"
+        "  WHERE conn_id = ("
+        "    SELECT conn_id FROM conn_block_last"
+        "    WHERE process_id = ?3 AND inbound = ?4 AND ip_proto = ?5 AND remote_port = ?6"
+        "      AND remote_ip IS ?7 AND remote_ip6 IS ?8 AND block_reason = ?9"
+        "    ORDER BY conn_id DESC LIMIT 1"
+        "  );";
+
+const char *const StatSql::sqlSelectMinMaxConnBlockId =
+        "SELECT"
+        "    COALESCE("
+        "      (SELECT MIN(conn_id_min) FROM conn_block_part WHERE conn_id_max IS NOT NULL),"
+        "      (SELECT MIN(conn_id) FROM conn_block_last)"
+        "    ),"
+        "    COALESCE("
+        "      (SELECT MAX(conn_id) FROM conn_block_last),"
+        "      (SELECT MAX(conn_id_max) FROM conn_block_part)"
+        "    );";
+
+// As in the migration
+const char *const StatSql::sqlCreateConnBlockLast =
+        "CREATE TABLE conn_block_last("
+        "  conn_id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "  app_id INTEGER NOT NULL,"
+        "  conn_time INTEGER NOT NULL,"
+        "  process_id INTEGER NOT NULL,"
+        "  inbound BOOLEAN NOT NULL,"
+        "  inherited BOOLEAN NOT NULL,"
+        "  ip_proto INTEGER NOT NULL,"
+        "  local_port INTEGER NOT NULL,"
+        "  remote_port INTEGER NOT NULL,"
+        "  local_ip INTEGER,"
+        "  remote_ip INTEGER,"
+        "  local_ip6 BLOB,"
+        "  remote_ip6 BLOB,"
+        "  block_reason INTEGER NOT NULL,"
+        "  repeat_count INTEGER NOT NULL DEFAULT 0,"
+        "  last_time INTEGER"
+        ");";
+
+const char *const StatSql::sqlInsertConnBlockLastSeq =
+        "INSERT INTO sqlite_sequence(name, seq) VALUES('conn_block_last', ?1);";
+
+const char *const StatSql::sqlSelectMinMaxConnBlockLastId =
+        "SELECT MIN(conn_id), MAX(conn_id) FROM conn_block_last;";
+
+const char *const StatSql::sqlSelectConnBlockLastPart =
+        "SELECT part_id, conn_id_min FROM conn_block_part WHERE conn_id_max IS NULL;";
+
+const char *const StatSql::sqlSelectConnBlockPartIds =
+        "SELECT part_id FROM conn_block_part WHERE conn_id_max IS NOT NULL ORDER BY part_id;";
+
+const char *const StatSql::sqlSelectConnBlockPartsTo =
+        "SELECT part_id FROM conn_block_part WHERE conn_id_max <= ?1;";
+
+const char *const StatSql::sqlSelectConnBlockPartOf =
+        "SELECT part_id, conn_id_max IS NULL FROM conn_block_part"
+        "  WHERE conn_id_min <= ?1"
+        "  ORDER BY part_id LIMIT 1;";
+
+const char *const StatSql::sqlInsertConnBlockPart =
+        "INSERT INTO conn_block_part(part_id, conn_id_min) VALUES(?1, ?2);";
+
+const char *const StatSql::sqlCloseConnBlockPart =
+        "UPDATE conn_block_part SET conn_id_min = ?2, conn_id_max = ?3 WHERE part_id = ?1;";
+
+const char *const StatSql::sqlUpdateConnBlockPartMin =
+        "UPDATE conn_block_part SET conn_id_min = ?2 WHERE part_id = ?1;";
+
+const char *const StatSql::sqlDeleteConnBlockPart =
+        "DELETE FROM conn_block_part WHERE part_id = ?1;";
 
 const char *const StatSql::sqlDeleteConnBlockApps =
         "DELETE FROM app t"
@@ -180,6 +503,26 @@ const char *const StatSql::sqlDeleteConnBlockApps =
         "    SELECT 1 FROM conn_block c WHERE c.app_id = t.app_id LIMIT 1"
         "  ) IS NULL;";
 
-const char *const StatSql::sqlDeleteAllConnBlock = "DELETE FROM conn_block;";
+const char *const StatSql::sqlDeleteAllConnBlock =
+        "DELETE FROM conn_block_last;"
+        "DELETE FROM sqlite_sequence WHERE name = 'conn_block_last';"
+        "UPDATE conn_block_part SET conn_id_min = 1;";
 
 const char *const StatSql::sqlDeleteAllApps = "DELETE FROM app;";
+
+const char *const StatSql::sqlSelectExportConnBlock =
+        "SELECT t.conn_id, t.conn_time, t.process_id, t.inbound, t.inherited,"
+        "    t.ip_proto, t.local_port, t.remote_port, t.local_ip, t.remote_ip,"
+        "    t.local_ip6, t.remote_ip6, t.block_reason, t.repeat_count, t.last_time,"
+        "    a.path"
+        "  FROM conn_block t"
+        "    JOIN app a ON a.app_id = t.app_id"
+        "  WHERE t.conn_id > ?1"
+        "  ORDER BY t.conn_id LIMIT ?2;";
+
+const char *const StatSql::sqlSelectExportTrafAppHour =
+        "SELECT t.traf_time, a.path, t.in_bytes, t.out_bytes"
+        "  FROM traffic_app_hour t"
+        "    JOIN app a ON a.app_id = t.app_id"
+        "  WHERE t.traf_time > ?1 AND t.traf_time <= ?2"
+        "  ORDER BY t.traf_time;";
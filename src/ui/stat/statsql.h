@@ -4,31 +4,29 @@
 class StatSql
 {
 public:
+    static const char *const sqlPragmas;
+
     static const char *const sqlSelectAppId;
     static const char *const sqlInsertAppId;
     static const char *const sqlDeleteAppId;
 
+    static const char *const sqlSelectUserId;
+    static const char *const sqlInsertUserId;
+
     static const char *const sqlSelectStatAppExists;
     static const char *const sqlSelectStatAppList;
 
-    static const char *const sqlInsertTrafAppHour;
-    static const char *const sqlInsertTrafAppDay;
-    static const char *const sqlInsertTrafAppMonth;
-    static const char *const sqlInsertTrafAppTotal;
-
-    static const char *const sqlInsertTrafHour;
-    static const char *const sqlInsertTrafDay;
-    static const char *const sqlInsertTrafMonth;
+    static const char *const sqlUpsertTrafAppHour;
+    static const char *const sqlUpsertTrafAppDay;
+    static const char *const sqlUpsertTrafAppMonth;
+    static const char *const sqlUpsertTrafAppTotal;
 
-    static const char *const sqlUpdateTrafAppHour;
-    static const char *const sqlUpdateTrafAppDay;
-    static const char *const sqlUpdateTrafAppMonth;
+    static const char *const sqlUpsertTrafUserAppHour;
+    static const char *const sqlUpsertTrafUserAppDay;
 
-    static const char *const sqlUpdateTrafHour;
-    static const char *const sqlUpdateTrafDay;
-    static const char *const sqlUpdateTrafMonth;
-
-    static const char *const sqlUpdateTrafAppTotal;
+    static const char *const sqlUpsertTrafHour;
+    static const char *const sqlUpsertTrafDay;
+    static const char *const sqlUpsertTrafMonth;
 
     static const char *const sqlSelectMinTrafAppHour;
     static const char *const sqlSelectMinTrafAppDay;
@@ -50,10 +48,23 @@ public:
     static const char *const sqlSelectTrafMonth;
     static const char *const sqlSelectTrafTotal;
 
+    static const char *const sqlSelectTrafAppHourRange;
+    static const char *const sqlSelectTrafAppDayRange;
+    static const char *const sqlSelectTrafAppMonthRange;
+
+    static const char *const sqlSelectTrafUserTopApps;
+
+    static const char *const sqlSelectTrafHourRange;
+    static const char *const sqlSelectTrafDayRange;
+    static const char *const sqlSelectTrafMonthRange;
+
     static const char *const sqlDeleteTrafAppHour;
     static const char *const sqlDeleteTrafAppDay;
     static const char *const sqlDeleteTrafAppMonth;
 
+    static const char *const sqlDeleteTrafUserAppHour;
+    static const char *const sqlDeleteTrafUserAppDay;
+
     static const char *const sqlDeleteTrafHour;
     static const char *const sqlDeleteTrafDay;
     static const char *const sqlDeleteTrafMonth;
@@ -62,18 +73,69 @@ public:
     static const char *const sqlDeleteAppTrafDay;
     static const char *const sqlDeleteAppTrafMonth;
     static const char *const sqlDeleteAppTrafTotal;
+    static const char *const sqlDeleteAppTrafUserHour;
+    static const char *const sqlDeleteAppTrafUserDay;
 
     static const char *const sqlResetAppTrafTotals;
     static const char *const sqlDeleteAllTraffic;
 
+    static const char *const sqlArchivePragmas;
+    static const char *const sqlArchiveTune;
+    static const char *const sqlCreateArchiveTables;
+
+    static const char *const sqlArchiveTrafAppHour;
+    static const char *const sqlArchiveTrafHour;
+    static const char *const sqlArchiveTrafUserAppHour;
+
+    static const char *const sqlDeleteArchivedTrafAppHour;
+    static const char *const sqlDeleteArchivedTrafHour;
+    static const char *const sqlDeleteArchivedTrafUserAppHour;
+
+    static const char *const sqlDeleteArchiveTrafAppHour;
+    static const char *const sqlDeleteArchiveTrafHour;
+    static const char *const sqlDeleteArchiveTrafUserAppHour;
+
+    static const char *const sqlDeleteAppArchiveTrafHour;
+    static const char *const sqlDeleteAppArchiveTrafUserHour;
+
+    static const char *const sqlDeleteAllArchiveTraffic;
+
+    static const char *const sqlSelectMinTrafAppHourArchive;
+    static const char *const sqlSelectMinTrafHourArchive;
+    static const char *const sqlSelectTrafAppHourArchive;
+    static const char *const sqlSelectTrafHourArchive;
+    static const char *const sqlSelectTrafAppHourRangeArchive;
+    static const char *const sqlSelectTrafHourRangeArchive;
+    static const char *const sqlSelectTrafUserTopAppsArchive;
+
+    // The hourly selects of the stat and archive DBs, or the SQL itself
+    static const char *archiveSql(const char *sql);
+
     static const char *const sqlInsertConnBlock;
+    static const char *const sqlInsertConnBlockRows;
+    static const char *const sqlUpdateConnBlockRepeat;
 
     static const char *const sqlSelectMinMaxConnBlockId;
 
-    static const char *const sqlDeleteConnBlock;
+    static const char *const sqlCreateConnBlockLast;
+    static const char *const sqlInsertConnBlockLastSeq;
+    static const char *const sqlSelectMinMaxConnBlockLastId;
+
+    static const char *const sqlSelectConnBlockLastPart;
+    static const char *const sqlSelectConnBlockPartIds;
+    static const char *const sqlSelectConnBlockPartsTo;
+    static const char *const sqlSelectConnBlockPartOf;
+    static const char *const sqlInsertConnBlockPart;
+    static const char *const sqlCloseConnBlockPart;
+    static const char *const sqlUpdateConnBlockPartMin;
+    static const char *const sqlDeleteConnBlockPart;
+
     static const char *const sqlDeleteConnBlockApps;
 
     static const char *const sqlDeleteAllConnBlock;
+
+    static const char *const sqlSelectExportConnBlock;
+    static const char *const sqlSelectExportTrafAppHour;
     static const char *const sqlDeleteAllApps;
 };
 
@@ -0,0 +1,114 @@
+#include "stattopapps.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr int windowMinutes[StatTopApps::WindowCount] = { 5, StatTopApps::MinutesCount };
+
+inline quint64 totalBytes(const TrafBytes &bytes)
+{
+    return bytes.inBytes + bytes.outBytes;
+}
+
+}
+
+void StatTopApps::advance(qint64 unixTime)
+{
+    const qint64 minute = unixTime / 60;
+
+    if (minute <= m_minute) {
+        if (minute < m_minute - MinutesCount) {
+            clear(); // the clock was moved back
+            m_minute = minute;
+        }
+        return;
+    }
+
+    if (minute - m_minute > MinutesCount) {
+        clear();
+        m_minute = minute;
+        return;
+    }
+
+    while (m_minute < minute) {
+        advanceMinute();
+    }
+}
+
+void StatTopApps::addTraffic(const QString &appPath, quint64 inBytes, quint64 outBytes)
+{
+    TrafBytes &minuteBytes = m_minuteBytes[m_minute % MinutesCount][appPath];
+    minuteBytes.inBytes += inBytes;
+    minuteBytes.outBytes += outBytes;
+
+    for (AppTrafBytesMap &windowBytes : m_windowBytes) {
+        TrafBytes &bytes = windowBytes[appPath];
+        bytes.inBytes += inBytes;
+        bytes.outBytes += outBytes;
+    }
+}
+
+QVector<TopAppTraf> StatTopApps::topApps(Window window, int count) const
+{
+    const AppTrafBytesMap &windowBytes = m_windowBytes[window];
+
+    QVector<TopAppTraf> list;
+    list.reserve(windowBytes.size());
+
+    for (auto it = windowBytes.constBegin(); it != windowBytes.constEnd(); ++it) {
+        list.append({ it.key(), it.value() });
+    }
+
+    const auto mid = list.begin() + qBound(qsizetype(0), qsizetype(count), list.size());
+
+    std::partial_sort(list.begin(), mid, list.end(), [](const auto &a, const auto &b) {
+        return totalBytes(a.bytes) > totalBytes(b.bytes);
+    });
+
+    list.erase(mid, list.end());
+
+    return list;
+}
+
+void StatTopApps::clear()
+{
+    for (AppTrafBytesMap &minuteBytes : m_minuteBytes) {
+        minuteBytes.clear();
+    }
+
+    for (AppTrafBytesMap &windowBytes : m_windowBytes) {
+        windowBytes.clear();
+    }
+}
+
+void StatTopApps::advanceMinute()
+{
+    ++m_minute;
+
+    // The minutes leaving the windows
+    for (int i = 0; i < WindowCount; ++i) {
+        const qint64 oldMinute = m_minute - windowMinutes[i];
+
+        subtractBytes(m_windowBytes[i], m_minuteBytes[oldMinute % MinutesCount]);
+    }
+
+    m_minuteBytes[m_minute % MinutesCount].clear();
+}
+
+void StatTopApps::subtractBytes(AppTrafBytesMap &windowBytes, const AppTrafBytesMap &bytes)
+{
+    for (auto it = bytes.constBegin(); it != bytes.constEnd(); ++it) {
+        const auto windowIt = windowBytes.find(it.key());
+        if (windowIt == windowBytes.end())
+            continue;
+
+        TrafBytes &appBytes = windowIt.value();
+        appBytes.inBytes -= it.value().inBytes;
+        appBytes.outBytes -= it.value().outBytes;
+
+        if (appBytes.inBytes == 0 && appBytes.outBytes == 0) {
+            windowBytes.erase(windowIt);
+        }
+    }
+}
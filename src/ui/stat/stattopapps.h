@@ -0,0 +1,49 @@
+#ifndef STATTOPAPPS_H
+#define STATTOPAPPS_H
+
+#include <QVector>
+
+#include "stattrafjob.h"
+
+struct TopAppTraf
+{
+    QString appPath;
+    TrafBytes bytes;
+};
+
+struct TopUserAppTraf
+{
+    QString userName;
+    QString appPath;
+    TrafBytes bytes;
+};
+
+// Sliding windows of the apps' traffic by minutes, kept in memory for the top queries
+class StatTopApps
+{
+public:
+    enum Window : qint8 { Window5Minutes = 0, WindowHour, WindowCount };
+
+    static constexpr int MinutesCount = 60; // of the longest window
+
+    void advance(qint64 unixTime);
+
+    void addTraffic(const QString &appPath, quint64 inBytes, quint64 outBytes);
+
+    QVector<TopAppTraf> topApps(Window window, int count) const;
+
+    void clear();
+
+private:
+    void advanceMinute();
+
+    static void subtractBytes(AppTrafBytesMap &windowBytes, const AppTrafBytesMap &bytes);
+
+private:
+    qint64 m_minute = 0; // of the last added traffic
+
+    AppTrafBytesMap m_minuteBytes[MinutesCount];
+    AppTrafBytesMap m_windowBytes[WindowCount];
+};
+
+#endif // STATTOPAPPS_H
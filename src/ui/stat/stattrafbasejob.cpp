@@ -0,0 +1,57 @@
+#include "stattrafbasejob.h"
+
+#include <sqlite/sqlitedb.h>
+#include <sqlite/sqlitestmt.h>
+
+#include <util/worker/workerobject.h>
+
+#include "statmanager.h"
+
+SqliteDb *StatTrafBaseJob::sqliteDb() const
+{
+    return manager()->sqliteDb();
+}
+
+bool StatTrafBaseJob::mergeJob(const WorkerJob &job)
+{
+    const auto &statJob = static_cast<const StatTrafBaseJob &>(job);
+
+    return jobType() == statJob.jobType() && processMerge(statJob);
+}
+
+void StatTrafBaseJob::doJob(WorkerObject &worker)
+{
+    m_manager = static_cast<StatManager *>(worker.manager());
+
+    processJob();
+}
+
+void StatTrafBaseJob::reportResult(WorkerObject & /*worker*/)
+{
+    if (resultCount() > 0) {
+        emitFinished();
+    }
+}
+
+SqliteStmt *StatTrafBaseJob::getStmt(const char *sql)
+{
+    return sqliteDb()->stmt(sql);
+}
+
+SqliteStmt *StatTrafBaseJob::getIdStmt(const char *sql, qint64 id)
+{
+    SqliteStmt *stmt = getStmt(sql);
+
+    stmt->bindInt64(1, id);
+
+    return stmt;
+}
+
+SqliteStmt *StatTrafBaseJob::getTrafficStmt(const char *sql, qint32 trafTime)
+{
+    SqliteStmt *stmt = getStmt(sql);
+
+    stmt->bindInt(1, trafTime);
+
+    return stmt;
+}
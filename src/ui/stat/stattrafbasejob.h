@@ -0,0 +1,48 @@
+#ifndef STATTRAFBASEJOB_H
+#define STATTRAFBASEJOB_H
+
+#include <sqlite/sqlitetypes.h>
+
+#include <util/worker/workerjob.h>
+
+class StatManager;
+
+class StatTrafBaseJob : public WorkerJob
+{
+public:
+    enum StatTrafJobType : qint8 {
+        JobTypeTraf,
+        JobTypeDeleteTraf,
+        JobTypeDeleteOldTraf,
+        JobTypeBackup,
+    };
+
+    StatManager *manager() const { return m_manager; }
+    SqliteDb *sqliteDb() const;
+
+    bool mergeJob(const WorkerJob &job) override;
+
+    void doJob(WorkerObject &worker) override;
+    void reportResult(WorkerObject &worker) override;
+
+    virtual StatTrafJobType jobType() const = 0;
+
+protected:
+    virtual bool processMerge(const StatTrafBaseJob &statJob) = 0;
+    virtual void processJob() = 0;
+    virtual void emitFinished() = 0;
+
+    int resultCount() const { return m_resultCount; }
+    void setResultCount(int v) { m_resultCount = v; }
+
+    SqliteStmt *getStmt(const char *sql);
+    SqliteStmt *getIdStmt(const char *sql, qint64 id);
+    SqliteStmt *getTrafficStmt(const char *sql, qint32 trafTime);
+
+private:
+    int m_resultCount = 0;
+
+    StatManager *m_manager = nullptr;
+};
+
+#endif // STATTRAFBASEJOB_H
@@ -0,0 +1,270 @@
+#include "stattrafjob.h"
+
+#include <QLoggingCategory>
+
+#include <sqlite/sqlitedb.h>
+#include <sqlite/sqlitestmt.h>
+
+#include <util/ioc/ioccontainer.h>
+
+#include "statappidcache.h"
+#include "statmanager.h"
+#include "statsql.h"
+
+namespace {
+
+const QLoggingCategory LC("statTraf");
+
+constexpr qint64 INVALID_APP_ID = Q_INT64_C(-1);
+
+}
+
+StatTrafJob::StatTrafJob(qint32 trafHour, qint32 trafDay, qint32 trafMonth, qint64 unixTime) :
+    m_trafHour(trafHour), m_trafDay(trafDay), m_trafMonth(trafMonth), m_unixTime(unixTime)
+{
+}
+
+void StatTrafJob::setTrafBytes(const TrafBytes &trafBytes, const AppTrafBytesMap &appTrafBytes,
+        const UserAppTrafBytesMap &userAppTrafBytes)
+{
+    m_trafBytes = trafBytes;
+    m_appTrafBytes = appTrafBytes;
+    m_userAppTrafBytes = userAppTrafBytes;
+}
+
+bool StatTrafJob::processMerge(const StatTrafBaseJob &statJob)
+{
+    const auto &job = static_cast<const StatTrafJob &>(statJob);
+
+    if (job.m_trafHour != m_trafHour)
+        return false;
+
+    m_trafBytes.inBytes += job.m_trafBytes.inBytes;
+    m_trafBytes.outBytes += job.m_trafBytes.outBytes;
+
+    for (auto it = job.m_appTrafBytes.constBegin(); it != job.m_appTrafBytes.constEnd(); ++it) {
+        TrafBytes &bytes = m_appTrafBytes[it.key()];
+
+        bytes.inBytes += it->inBytes;
+        bytes.outBytes += it->outBytes;
+    }
+
+    for (auto it = job.m_userAppTrafBytes.constBegin(); it != job.m_userAppTrafBytes.constEnd();
+            ++it) {
+        AppTrafBytesMap &appTrafBytes = m_userAppTrafBytes[it.key()];
+
+        for (auto appIt = it->constBegin(); appIt != it->constEnd(); ++appIt) {
+            TrafBytes &bytes = appTrafBytes[appIt.key()];
+
+            bytes.inBytes += appIt->inBytes;
+            bytes.outBytes += appIt->outBytes;
+        }
+    }
+
+    return true;
+}
+
+void StatTrafJob::processJob()
+{
+    sqliteDb()->beginWriteTransaction();
+
+    updateAppTraffic();
+    updateUserTraffic();
+    updateTraffic();
+
+    if (!sqliteDb()->commitTransaction()) {
+        IoC<StatAppIdCache>()->clear(StatAppIdCache::DbTraf); // the created apps are lost
+    }
+
+    setResultCount(m_createdAppIds.size());
+}
+
+void StatTrafJob::emitFinished()
+{
+    for (int i = 0; i < m_createdAppIds.size(); ++i) {
+        emit manager()->appCreated(m_createdAppIds[i], m_createdAppPaths[i]);
+    }
+}
+
+void StatTrafJob::updateAppTraffic()
+{
+    if (m_appTrafBytes.isEmpty())
+        return;
+
+    const SqliteStmtList trafAppStmts = SqliteStmtList()
+            << getTrafficStmt(StatSql::sqlUpsertTrafAppHour, m_trafHour)
+            << getTrafficStmt(StatSql::sqlUpsertTrafAppDay, m_trafDay)
+            << getTrafficStmt(StatSql::sqlUpsertTrafAppMonth, m_trafMonth)
+            << getTrafficStmt(StatSql::sqlUpsertTrafAppTotal, m_trafHour);
+
+    auto appIdCache = IoC<StatAppIdCache>();
+
+    for (auto it = m_appTrafBytes.constBegin(); it != m_appTrafBytes.constEnd(); ++it) {
+        const QString &appPath = it.key();
+
+        // The cached apps have the traffic already
+        qint64 appId = appIdCache->appId(StatAppIdCache::DbTraf, appPath);
+        if (appId == INVALID_APP_ID) {
+            appId = getOrCreateAppId(appPath);
+            if (appId == INVALID_APP_ID)
+                continue;
+
+            if (!hasAppTraf(appId)) {
+                m_createdAppIds.append(appId);
+                m_createdAppPaths.append(appPath);
+            }
+
+            appIdCache->insert(StatAppIdCache::DbTraf, appPath, appId);
+        }
+
+        updateTrafficList(trafAppStmts, it.value(), appId);
+    }
+}
+
+void StatTrafJob::updateUserTraffic()
+{
+    if (m_userAppTrafBytes.isEmpty())
+        return;
+
+    const SqliteStmtList trafUserStmts = SqliteStmtList()
+            << getTrafficStmt(StatSql::sqlUpsertTrafUserAppHour, m_trafHour)
+            << getTrafficStmt(StatSql::sqlUpsertTrafUserAppDay, m_trafDay);
+
+    auto appIdCache = IoC<StatAppIdCache>();
+
+    for (auto it = m_userAppTrafBytes.constBegin(); it != m_userAppTrafBytes.constEnd(); ++it) {
+        const qint64 userId = getOrCreateUserId(it.key());
+        if (userId == INVALID_APP_ID)
+            continue;
+
+        for (SqliteStmt *stmt : trafUserStmts) {
+            stmt->bindInt64(5, userId);
+        }
+
+        // The apps are created by their traffic already
+        for (auto appIt = it->constBegin(); appIt != it->constEnd(); ++appIt) {
+            const QString &appPath = appIt.key();
+
+            qint64 appId = appIdCache->appId(StatAppIdCache::DbTraf, appPath);
+            if (appId == INVALID_APP_ID) {
+                appId = getAppId(appPath);
+                if (appId == INVALID_APP_ID)
+                    continue;
+            }
+
+            updateTrafficList(trafUserStmts, appIt.value(), appId);
+        }
+    }
+}
+
+void StatTrafJob::updateTraffic()
+{
+    if (m_trafBytes.inBytes == 0 && m_trafBytes.outBytes == 0)
+        return;
+
+    const SqliteStmtList trafStmts = SqliteStmtList()
+            << getTrafficStmt(StatSql::sqlUpsertTrafHour, m_trafHour)
+            << getTrafficStmt(StatSql::sqlUpsertTrafDay, m_trafDay)
+            << getTrafficStmt(StatSql::sqlUpsertTrafMonth, m_trafMonth);
+
+    updateTrafficList(trafStmts, m_trafBytes);
+}
+
+void StatTrafJob::updateTrafficList(
+        const SqliteStmtList &stmtList, const TrafBytes &bytes, qint64 appId)
+{
+    int i = 0;
+    for (SqliteStmt *stmt : stmtList) {
+        stmt->bindInt64(2, bytes.inBytes);
+        stmt->bindInt64(3, bytes.outBytes);
+
+        if (appId != 0) {
+            stmt->bindInt64(4, appId);
+        }
+
+        if (!sqliteDb()->done(stmt)) {
+            qCCritical(LC) << "Update traffic error:" << sqliteDb()->errorMessage()
+                           << "inBytes:" << bytes.inBytes << "outBytes:" << bytes.outBytes
+                           << "appId:" << appId << "index:" << i;
+        }
+        ++i;
+    }
+}
+
+bool StatTrafJob::hasAppTraf(qint64 appId)
+{
+    SqliteStmt *stmt = getIdStmt(StatSql::sqlSelectStatAppExists, appId);
+
+    const bool res = (stmt->step() == SqliteStmt::StepRow);
+    stmt->reset();
+
+    return res;
+}
+
+qint64 StatTrafJob::getAppId(const QString &appPath)
+{
+    qint64 appId = INVALID_APP_ID;
+
+    SqliteStmt *stmt = getStmt(StatSql::sqlSelectAppId);
+
+    stmt->bindText(1, appPath);
+    if (stmt->step() == SqliteStmt::StepRow) {
+        appId = stmt->columnInt64();
+    }
+    stmt->reset();
+
+    return appId;
+}
+
+qint64 StatTrafJob::createAppId(const QString &appPath)
+{
+    SqliteStmt *stmt = getStmt(StatSql::sqlInsertAppId);
+
+    stmt->bindText(1, appPath);
+    stmt->bindInt64(2, m_unixTime);
+
+    if (sqliteDb()->done(stmt)) {
+        return sqliteDb()->lastInsertRowid();
+    }
+
+    return INVALID_APP_ID;
+}
+
+qint64 StatTrafJob::getOrCreateAppId(const QString &appPath)
+{
+    qint64 appId = getAppId(appPath);
+    if (appId == INVALID_APP_ID) {
+        appId = createAppId(appPath);
+    }
+
+    Q_ASSERT(appId != INVALID_APP_ID);
+
+    return appId;
+}
+
+qint64 StatTrafJob::getOrCreateUserId(const QString &userName)
+{
+    qint64 userId = INVALID_APP_ID;
+
+    SqliteStmt *stmt = getStmt(StatSql::sqlSelectUserId);
+
+    stmt->bindText(1, userName);
+    if (stmt->step() == SqliteStmt::StepRow) {
+        userId = stmt->columnInt64();
+    }
+    stmt->reset();
+
+    if (userId != INVALID_APP_ID)
+        return userId;
+
+    stmt = getStmt(StatSql::sqlInsertUserId);
+
+    stmt->bindText(1, userName);
+    stmt->bindInt64(2, m_unixTime);
+
+    if (sqliteDb()->done(stmt)) {
+        userId = sqliteDb()->lastInsertRowid();
+    }
+
+    return userId;
+}
@@ -0,0 +1,66 @@
+#ifndef STATTRAFJOB_H
+#define STATTRAFJOB_H
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+#include "stattrafbasejob.h"
+
+struct TrafBytes
+{
+    quint64 inBytes = 0;
+    quint64 outBytes = 0;
+};
+
+using AppTrafBytesMap = QHash<QString, TrafBytes>; // appPath -> bytes
+using TrafTimeBytesMap = QHash<qint32, TrafBytes>; // trafTime -> bytes
+using UserAppTrafBytesMap = QHash<QString, AppTrafBytesMap>; // userName -> appPath -> bytes
+
+class StatTrafJob : public StatTrafBaseJob
+{
+public:
+    explicit StatTrafJob(qint32 trafHour, qint32 trafDay, qint32 trafMonth, qint64 unixTime);
+
+    StatTrafJobType jobType() const override { return JobTypeTraf; }
+
+    void setTrafBytes(const TrafBytes &trafBytes, const AppTrafBytesMap &appTrafBytes,
+            const UserAppTrafBytesMap &userAppTrafBytes);
+
+protected:
+    bool processMerge(const StatTrafBaseJob &statJob) override;
+    void processJob() override;
+    void emitFinished() override;
+
+private:
+    void updateAppTraffic();
+    void updateUserTraffic();
+    void updateTraffic();
+    void updateTrafficList(
+            const SqliteStmtList &stmtList, const TrafBytes &bytes, qint64 appId = 0);
+
+    bool hasAppTraf(qint64 appId);
+
+    qint64 getAppId(const QString &appPath);
+    qint64 createAppId(const QString &appPath);
+    qint64 getOrCreateAppId(const QString &appPath);
+
+    qint64 getOrCreateUserId(const QString &userName);
+
+private:
+    qint32 m_trafHour = 0;
+    qint32 m_trafDay = 0;
+    qint32 m_trafMonth = 0;
+
+    qint64 m_unixTime = 0;
+
+    TrafBytes m_trafBytes;
+    AppTrafBytesMap m_appTrafBytes;
+    UserAppTrafBytesMap m_userAppTrafBytes;
+
+    // The apps with their first traffic
+    QVector<qint64> m_createdAppIds;
+    QStringList m_createdAppPaths;
+};
+
+#endif // STATTRAFJOB_H
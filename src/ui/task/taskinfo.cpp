@@ -6,6 +6,7 @@
 
 #include "taskeditinfo.h"
 #include "taskmanager.h"
+#include "taskpolicysync.h"
 #include "taskupdatechecker.h"
 #include "taskzonedownloader.h"
 
@@ -53,6 +54,8 @@ QString TaskInfo::title() const
         return tr("Update Checker");
     case ZoneDownloader:
         return tr("Zones Downloader");
+    case PolicySync:
+        return tr("Policy Sync");
     default:
         Q_UNREACHABLE();
         return QString();
@@ -186,6 +189,8 @@ TaskWorker *TaskInfo::createWorker()
         return new TaskUpdateChecker(this);
     case ZoneDownloader:
         return new TaskZoneDownloader(this);
+    case PolicySync:
+        return new TaskPolicySync(this);
     default:
         Q_UNREACHABLE();
         return nullptr;
@@ -23,7 +23,7 @@ class TaskInfo : public QObject
     Q_PROPERTY(bool running READ running NOTIFY taskWorkerChanged)
 
 public:
-    enum TaskType : qint8 { TypeNone = -1, UpdateChecker = 0, ZoneDownloader };
+    enum TaskType : qint8 { TypeNone = -1, UpdateChecker = 0, ZoneDownloader, PolicySync };
     Q_ENUM(TaskType)
 
     explicit TaskInfo(TaskInfo::TaskType type, TaskManager &taskManager);
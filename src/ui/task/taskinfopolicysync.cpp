@@ -0,0 +1,257 @@
+#include "taskinfopolicysync.h"
+
+#include <QDataStream>
+#include <QLoggingCategory>
+
+#include <conf/app.h>
+#include <conf/appgroup.h>
+#include <conf/confappmanager.h>
+#include <conf/confmanager.h>
+#include <conf/confzonemanager.h>
+#include <conf/firewallconf.h>
+#include <conf/zone.h>
+#include <model/zonelistmodel.h>
+#include <util/fileutil.h>
+#include <util/ioc/ioccontainer.h>
+
+#include "taskmanager.h"
+#include "taskpolicysync.h"
+
+#define TASK_INFO_VERSION 1
+
+namespace {
+
+const QLoggingCategory LC("task.taskInfoPolicySync");
+
+int appGroupIndexByName(const FirewallConf *conf, const QString &name)
+{
+    const auto &appGroups = conf->appGroups();
+
+    for (int i = 0; i < appGroups.size(); ++i) {
+        if (appGroups[i]->name() == name)
+            return i;
+    }
+    return -1;
+}
+
+}
+
+TaskInfoPolicySync::TaskInfoPolicySync(TaskManager &taskManager) :
+    TaskInfo(PolicySync, taskManager)
+{
+}
+
+QByteArray TaskInfoPolicySync::data() const
+{
+    QByteArray data;
+    QDataStream stream(&data, QDataStream::WriteOnly);
+
+    // Store data
+    const quint16 infoVersion = TASK_INFO_VERSION;
+
+    stream << infoVersion << m_version;
+
+    return data;
+}
+
+void TaskInfoPolicySync::setData(const QByteArray &data)
+{
+    QDataStream stream(data);
+
+    // Check version
+    quint16 infoVersion;
+    stream >> infoVersion;
+
+    if (infoVersion > TASK_INFO_VERSION)
+        return;
+
+    // Load data
+    stream >> m_version;
+}
+
+TaskPolicySync *TaskInfoPolicySync::policySync() const
+{
+    return static_cast<TaskPolicySync *>(taskWorker());
+}
+
+bool TaskInfoPolicySync::processResult(bool success)
+{
+    if (!success)
+        return false;
+
+    const auto worker = policySync();
+
+    if (worker->version() <= m_version)
+        return false;
+
+    // Keep the applied version on errors, to retry the delta
+    if (!applyPolicy(worker->policy())) {
+        qCWarning(LC) << "Policy Sync: Apply error:" << worker->version();
+        return false;
+    }
+
+    m_version = worker->version();
+
+    return true;
+}
+
+void TaskInfoPolicySync::setupTaskWorker()
+{
+    TaskInfo::setupTaskWorker();
+
+    auto worker = policySync();
+
+    worker->setUrl(IoC<ConfManager>()->conf()->ini().policyUrl());
+    worker->setSinceVersion(m_version);
+}
+
+void TaskInfoPolicySync::runTaskWorker()
+{
+    if (aborted() || !taskWorker())
+        return;
+
+    // Not managed
+    if (policySync()->url().isEmpty()) {
+        handleFinished(false);
+        return;
+    }
+
+    TaskInfo::runTaskWorker();
+}
+
+bool TaskInfoPolicySync::applyPolicy(const QVariantMap &policy)
+{
+    // The apps refer to the groups and zones
+    if (!IoC<ConfManager>()->saveAppGroupsVariant(policy["appGroups"].toList()))
+        return false;
+
+    if (!applyZones(policy["zones"].toList(), policy["zonesRemoved"].toStringList()))
+        return false;
+
+    return applyApps(policy["apps"].toList(), policy["appsRemoved"].toStringList());
+}
+
+bool TaskInfoPolicySync::applyZones(const QVariantList &zonesList, const QStringList &removedNames)
+{
+    auto zoneListModel = IoC<ZoneListModel>();
+
+    m_zoneIds.clear();
+
+    const int rowCount = zoneListModel->rowCount();
+    for (int i = 0; i < rowCount; ++i) {
+        const auto &zoneRow = zoneListModel->zoneRowAt(i);
+
+        m_zoneIds.insert(zoneRow.zoneName, zoneRow.zoneId);
+    }
+
+    auto confZoneManager = IoC<ConfZoneManager>();
+    bool zonesChanged = false;
+
+    for (const QString &name : removedNames) {
+        const int zoneId = m_zoneIds.take(name);
+        if (zoneId == 0)
+            continue;
+
+        if (!confZoneManager->deleteZone(zoneId))
+            return false;
+
+        zonesChanged = true;
+    }
+
+    for (const QVariant &v : zonesList) {
+        const QVariantMap map = v.toMap();
+
+        Zone zone;
+        zone.zoneName = map["name"].toString();
+        if (zone.zoneName.isEmpty())
+            continue;
+
+        zone.zoneId = m_zoneIds.value(zone.zoneName);
+        zone.enabled = map.value("enabled", true).toBool();
+        zone.sourceCode = map["sourceCode"].toString();
+        zone.url = map["url"].toString();
+        zone.formData = map["formData"].toString();
+        zone.textInline = map["textInline"].toString();
+        zone.customUrl = !zone.url.isEmpty();
+
+        if (!confZoneManager->addOrUpdateZone(zone))
+            return false;
+
+        m_zoneIds.insert(zone.zoneName, zone.zoneId);
+
+        zonesChanged = true;
+    }
+
+    // Download the changed zones by their task
+    if (zonesChanged) {
+        taskManager()->runTask(ZoneDownloader);
+    }
+
+    return true;
+}
+
+bool TaskInfoPolicySync::applyApps(const QVariantList &appsList, const QStringList &removedPaths)
+{
+    auto confAppManager = IoC<ConfAppManager>();
+
+    QVector<qint64> removedAppIds;
+    for (const QString &path : removedPaths) {
+        const qint64 appId = confAppManager->appIdByPath(FileUtil::normalizePath(path));
+        if (appId != 0) {
+            removedAppIds.append(appId);
+        }
+    }
+
+    confAppManager->deleteApps(removedAppIds);
+
+    const FirewallConf *conf = IoC<ConfManager>()->conf();
+
+    for (const QVariant &v : appsList) {
+        const QVariantMap map = v.toMap();
+
+        App app;
+        app.appOriginPath = map["path"].toString();
+        app.appPath = FileUtil::normalizePath(app.appOriginPath);
+        if (app.appPath.isEmpty())
+            continue;
+
+        app.appName = map["name"].toString();
+        app.groupIndex = appGroupIndexByName(conf, map["group"].toString());
+        if (app.groupIndex < 0) {
+            qCWarning(LC) << "Policy Sync: Unknown app. group:" << map["group"].toString();
+            return false;
+        }
+
+        app.useGroupPerm = map.value("useGroupPerm", true).toBool();
+        app.applyChild = map["applyChild"].toBool();
+        app.killChild = map["killChild"].toBool();
+        app.lanOnly = map["lanOnly"].toBool();
+        app.logBlocked = map.value("logBlocked", true).toBool();
+        app.logConn = map.value("logConn", true).toBool();
+        app.blocked = map["blocked"].toBool();
+        app.killProcess = map["killProcess"].toBool();
+
+        // The zones' ids are local, so they're referred by names
+        app.acceptZones = zonesMaskByNames(map["acceptZones"].toStringList());
+        app.rejectZones = zonesMaskByNames(map["rejectZones"].toStringList());
+
+        if (!confAppManager->addApp(app))
+            return false;
+    }
+
+    return true;
+}
+
+quint32 TaskInfoPolicySync::zonesMaskByNames(const QStringList &names) const
+{
+    quint32 zonesMask = 0;
+
+    for (const QString &name : names) {
+        const int zoneId = m_zoneIds.value(name);
+        if (zoneId != 0) {
+            zonesMask |= (quint32(1) << (zoneId - 1));
+        }
+    }
+
+    return zonesMask;
+}
@@ -0,0 +1,48 @@
+#ifndef TASKINFOPOLICYSYNC_H
+#define TASKINFOPOLICYSYNC_H
+
+#include <QHash>
+#include <QVariant>
+
+#include "taskinfo.h"
+
+class TaskPolicySync;
+
+// Syncs the zones, app. groups and programs from the central policy's versioned deltas,
+// when the managed mode's URL is set.
+class TaskInfoPolicySync : public TaskInfo
+{
+    Q_OBJECT
+
+public:
+    explicit TaskInfoPolicySync(TaskManager &taskManager);
+
+    qint64 version() const { return m_version; }
+
+    QByteArray data() const override;
+    void setData(const QByteArray &data) override;
+
+    TaskPolicySync *policySync() const;
+
+public slots:
+    bool processResult(bool success) override;
+
+protected slots:
+    void setupTaskWorker() override;
+    void runTaskWorker() override;
+
+private:
+    bool applyPolicy(const QVariantMap &policy);
+
+    bool applyZones(const QVariantList &zonesList, const QStringList &removedNames);
+    bool applyApps(const QVariantList &appsList, const QStringList &removedPaths);
+
+    quint32 zonesMaskByNames(const QStringList &names) const;
+
+private:
+    qint64 m_version = 0;
+
+    QHash<QString, int> m_zoneIds; // by names
+};
+
+#endif // TASKINFOPOLICYSYNC_H
@@ -1,6 +1,7 @@
 #include "taskinfozonedownloader.h"
 
 #include <QDir>
+#include <QTimer>
 
 #include <conf/confzonemanager.h>
 #include <fortsettings.h>
@@ -13,6 +14,16 @@
 #include "taskmanager.h"
 #include "taskzonedownloader.h"
 
+namespace {
+
+constexpr int ZONE_DOWNLOADS_MAX_COUNT = 4;
+
+// Bounds of the resolved addresses' TTL to refresh them
+constexpr quint32 ZONE_RESOLVE_TTL_MIN_SECS = 60;
+constexpr quint32 ZONE_RESOLVE_TTL_MAX_SECS = 60 * 60;
+
+}
+
 TaskInfoZoneDownloader::TaskInfoZoneDownloader(TaskManager &taskManager) :
     TaskInfo(ZoneDownloader, taskManager)
 {
@@ -43,21 +54,22 @@ void TaskInfoZoneDownloader::loadZones()
     TaskZoneDownloader worker;
 
     const int rowCount = zoneListModel()->rowCount();
-    for (m_zoneIndex = 0; m_zoneIndex < rowCount; ++m_zoneIndex) {
-        setupTaskWorkerByZone(&worker);
+    for (int zoneIndex = 0; zoneIndex < rowCount; ++zoneIndex) {
+        setupTaskWorkerByZone(&worker, zoneIndex);
         addSubResult(&worker, false);
+        addResolveTtl(&worker);
     }
 
     emitZonesUpdated();
+
+    startResolveTimer();
 }
 
 bool TaskInfoZoneDownloader::saveZoneAsText(const QString &filePath, int zoneIndex)
 {
     TaskZoneDownloader worker;
 
-    m_zoneIndex = zoneIndex;
-
-    setupTaskWorkerByZone(&worker);
+    setupTaskWorkerByZone(&worker, zoneIndex);
 
     return worker.saveAddressesAsText(filePath);
 }
@@ -66,41 +78,121 @@ void TaskInfoZoneDownloader::setupTaskWorker()
 {
     m_success = false;
     m_zoneIndex = 0;
+    m_runningCount = 0;
     m_zonesMask = 0;
     m_zoneNames.clear();
 
     clearSubResults();
+    clearZoneWorkers();
 
-    setupNextTaskWorker();
+    TaskInfo::setupTaskWorker();
 }
 
-void TaskInfoZoneDownloader::setupNextTaskWorker()
+void TaskInfoZoneDownloader::runTaskWorker()
+{
+    if (aborted() || !taskWorker())
+        return;
+
+    runNextTaskWorkers();
+}
+
+void TaskInfoZoneDownloader::runNextTaskWorkers()
 {
     const int rowCount = zoneListModel()->rowCount();
-    if (m_zoneIndex >= rowCount) {
-        emitZonesUpdated();
 
-        TaskInfo::handleFinished(m_success);
-        return;
+    // Download the zones concurrently, the workers may also finish synchronously
+    while (running() && !aborted() && m_zoneIndex < rowCount
+            && m_runningCount < ZONE_DOWNLOADS_MAX_COUNT) {
+        const int zoneIndex = m_zoneIndex++;
+
+        auto worker = (zoneIndex == 0) ? zoneDownloader() : createZoneWorker();
+
+        setupTaskWorkerByZone(worker, zoneIndex);
+
+        m_zoneWorkers.append(ZoneWorker { .worker = worker });
+        ++m_runningCount;
+
+        // Keep a running worker as the task's one, to abort them by abortTask()
+        setTaskWorker(runningZoneWorker());
+
+        worker->run();
     }
 
-    abortTask();
+    if (running() && m_runningCount == 0 && (aborted() || m_zoneIndex >= rowCount)) {
+        finishZoneWorkers();
+    }
+}
 
-    TaskInfo::setupTaskWorker();
-    auto worker = zoneDownloader();
+void TaskInfoZoneDownloader::abortZoneWorkers()
+{
+    for (int i = 0; i < m_zoneWorkers.size(); ++i) {
+        const ZoneWorker &zoneWorker = m_zoneWorkers[i];
+        if (zoneWorker.running) {
+            zoneWorker.worker->finish(); // calls handleFinished()
+        }
+    }
+}
+
+void TaskInfoZoneDownloader::finishZoneWorkers()
+{
+    for (const ZoneWorker &zoneWorker : asConst(m_zoneWorkers)) {
+        processSubResult(zoneWorker.worker, zoneWorker.success);
+    }
+
+    clearZoneWorkers();
 
-    setupTaskWorkerByZone(worker);
+    emitZonesUpdated(/*onlyChanged=*/true);
+
+    startResolveTimer();
+
+    TaskInfo::handleFinished(m_success);
+}
+
+void TaskInfoZoneDownloader::clearZoneWorkers()
+{
+    for (const ZoneWorker &zoneWorker : asConst(m_zoneWorkers)) {
+        if (zoneWorker.worker != taskWorker()) {
+            zoneWorker.worker->deleteLater();
+        }
+    }
+
+    m_zoneWorkers.clear();
 }
 
-void TaskInfoZoneDownloader::setupTaskWorkerByZone(TaskZoneDownloader *worker)
+TaskZoneDownloader *TaskInfoZoneDownloader::createZoneWorker()
 {
-    const auto zoneRow = zoneListModel()->zoneRowAt(m_zoneIndex);
+    auto worker = new TaskZoneDownloader(this);
+
+    connect(worker, &TaskWorker::finished, this, &TaskInfoZoneDownloader::handleFinished);
+
+    return worker;
+}
+
+TaskZoneDownloader *TaskInfoZoneDownloader::runningZoneWorker() const
+{
+    for (const ZoneWorker &zoneWorker : m_zoneWorkers) {
+        if (zoneWorker.running && zoneWorker.worker == taskWorker())
+            return zoneWorker.worker;
+    }
+
+    for (const ZoneWorker &zoneWorker : m_zoneWorkers) {
+        if (zoneWorker.running)
+            return zoneWorker.worker;
+    }
+
+    return nullptr;
+}
+
+void TaskInfoZoneDownloader::setupTaskWorkerByZone(TaskZoneDownloader *worker, int zoneIndex)
+{
+    const auto zoneRow = zoneListModel()->zoneRowAt(zoneIndex);
     const auto zoneSource =
             ZoneSourceWrapper(zoneListModel()->zoneSourceByCode(zoneRow.sourceCode));
     const auto zoneType = ZoneTypeWrapper(zoneListModel()->zoneTypeByCode(zoneSource.zoneType()));
 
     worker->setZoneEnabled(zoneRow.enabled);
     worker->setSort(zoneType.sort());
+    worker->setResolve(zoneType.resolve());
     worker->setEmptyNetMask(zoneType.emptyNetMask());
     worker->setZoneId(zoneRow.zoneId);
     worker->setZoneName(zoneRow.zoneName);
@@ -120,29 +212,35 @@ void TaskInfoZoneDownloader::setupTaskWorkerByZone(TaskZoneDownloader *worker)
 
 void TaskInfoZoneDownloader::handleFinished(bool success)
 {
-    processSubResult(success);
+    const auto worker = sender();
+
+    const auto it = std::find_if(m_zoneWorkers.begin(), m_zoneWorkers.end(),
+            [&](const ZoneWorker &zoneWorker) { return zoneWorker.worker == worker; });
+    if (it == m_zoneWorkers.end() || !it->running)
+        return;
+
+    it->running = false;
+    it->success = success;
+    --m_runningCount;
 
     if (success) {
         m_success = true;
     }
 
     if (aborted()) {
-        m_zoneIndex = INT_MAX;
-    } else {
-        ++m_zoneIndex;
+        abortZoneWorkers();
+    } else if (auto runningWorker = runningZoneWorker()) {
+        setTaskWorker(runningWorker);
     }
 
-    setupNextTaskWorker();
-    runTaskWorker();
+    runNextTaskWorkers();
 }
 
-void TaskInfoZoneDownloader::processSubResult(bool success)
+void TaskInfoZoneDownloader::processSubResult(TaskZoneDownloader *worker, bool success)
 {
     if (aborted() && !success)
         return;
 
-    auto worker = zoneDownloader();
-
     Zone zone;
     zone.zoneId = worker->zoneId();
     zone.addressCount = worker->addressCount();
@@ -156,6 +254,7 @@ void TaskInfoZoneDownloader::processSubResult(bool success)
     IoC<ConfZoneManager>()->updateZoneResult(zone);
 
     addSubResult(worker, success);
+    addResolveTtl(worker);
 }
 
 void TaskInfoZoneDownloader::clearSubResults()
@@ -164,6 +263,9 @@ void TaskInfoZoneDownloader::clearSubResults()
     m_enabledMask = 0;
     m_dataSize = 0;
     m_zonesData.clear();
+
+    m_changedZoneIds.clear();
+    m_changedZonesData.clear();
 }
 
 void TaskInfoZoneDownloader::addSubResult(TaskZoneDownloader *worker, bool success)
@@ -185,20 +287,157 @@ void TaskInfoZoneDownloader::addSubResult(TaskZoneDownloader *worker, bool succe
 
     insertZoneId(m_dataZonesMask, worker->zoneId());
 
+    if (success) {
+        m_changedZoneIds.append(worker->zoneId());
+        m_changedZonesData.append(zoneData);
+    }
+
     if (worker->zoneEnabled()) {
         insertZoneId(m_enabledMask, worker->zoneId());
     }
 }
 
-void TaskInfoZoneDownloader::emitZonesUpdated()
+void TaskInfoZoneDownloader::emitZonesUpdated(bool onlyChanged)
 {
-    emit taskManager()->zonesUpdated(m_dataZonesMask, m_enabledMask, m_dataSize, m_zonesData);
+    if (!(onlyChanged && updateDriverChangedZones())) {
+        emit taskManager()->zonesUpdated(m_dataZonesMask, m_enabledMask, m_dataSize, m_zonesData);
+
+        m_driverZonesMask = m_dataZonesMask;
+        m_driverEnabledMask = m_enabledMask;
+    }
 
     removeOrphanCacheFiles();
 
     clearSubResults();
 }
 
+bool TaskInfoZoneDownloader::updateDriverChangedZones()
+{
+    // Replace just the re-downloaded zones, when the set of zones is the same
+    if (m_dataZonesMask != m_driverZonesMask || m_enabledMask != m_driverEnabledMask)
+        return false;
+
+    auto confZoneManager = IoC<ConfZoneManager>();
+
+    const int count = m_changedZoneIds.size();
+    for (int i = 0; i < count; ++i) {
+        const int zoneId = m_changedZoneIds[i];
+        const bool enabled = containsZoneId(m_enabledMask, zoneId);
+
+        if (!confZoneManager->updateDriverZone(zoneId, enabled, m_changedZonesData[i]))
+            return false;
+    }
+
+    return true;
+}
+
+void TaskInfoZoneDownloader::refreshResolvedZones()
+{
+    // The running task resolves them too
+    if (running() || m_resolveRunningCount > 0)
+        return;
+
+    ++m_resolveRunningCount; // the workers may finish synchronously
+
+    const int rowCount = zoneListModel()->rowCount();
+    for (int zoneIndex = 0; zoneIndex < rowCount; ++zoneIndex) {
+        auto worker = new TaskZoneDownloader(this);
+
+        setupTaskWorkerByZone(worker, zoneIndex);
+
+        if (!worker->resolve() || !worker->zoneEnabled()) {
+            delete worker;
+            continue;
+        }
+
+        ++m_resolveRunningCount;
+
+        connect(worker, &TaskWorker::finished, this,
+                [=, this](bool success) { processResolvedZone(worker, success); });
+
+        worker->run();
+    }
+
+    if (--m_resolveRunningCount == 0) {
+        finishResolvedZones();
+    }
+}
+
+void TaskInfoZoneDownloader::processResolvedZone(TaskZoneDownloader *worker, bool success)
+{
+    if (success) {
+        Zone zone;
+        zone.zoneId = worker->zoneId();
+        zone.addressCount = worker->addressCount();
+        zone.textChecksum = worker->textChecksum();
+        zone.binChecksum = worker->binChecksum();
+
+        zone.sourceModTime = worker->sourceModTime();
+        zone.lastRun = QDateTime::currentDateTime();
+        zone.lastSuccess = zone.lastRun;
+
+        auto confZoneManager = IoC<ConfZoneManager>();
+        confZoneManager->updateZoneResult(zone);
+
+        // Replace just the changed zone in the driver, when it's there
+        const int zoneId = worker->zoneId();
+        if (!(containsZoneId(m_driverZonesMask, zoneId)
+                    && containsZoneId(m_driverEnabledMask, zoneId)
+                    && confZoneManager->updateDriverZone(zoneId, true, worker->zoneData()))) {
+            m_resolveReloadZones = true;
+        }
+    }
+
+    addResolveTtl(worker);
+
+    worker->deleteLater();
+
+    if (--m_resolveRunningCount == 0) {
+        finishResolvedZones();
+    }
+}
+
+void TaskInfoZoneDownloader::finishResolvedZones()
+{
+    if (m_resolveReloadZones) {
+        m_resolveReloadZones = false;
+
+        loadZones();
+    }
+
+    startResolveTimer();
+}
+
+void TaskInfoZoneDownloader::addResolveTtl(TaskZoneDownloader *worker)
+{
+    if (!worker->resolve() || !worker->zoneEnabled())
+        return;
+
+    // Retry the failed ones soon
+    const quint32 ttlSecs = qBound(
+            ZONE_RESOLVE_TTL_MIN_SECS, worker->resolveTtlSecs(), ZONE_RESOLVE_TTL_MAX_SECS);
+
+    m_resolveTtlSecs = (m_resolveTtlSecs == 0) ? ttlSecs : qMin(m_resolveTtlSecs, ttlSecs);
+}
+
+void TaskInfoZoneDownloader::startResolveTimer()
+{
+    if (m_resolveTtlSecs == 0)
+        return;
+
+    if (!m_resolveTimer) {
+        m_resolveTimer = new QTimer(this);
+        m_resolveTimer->setSingleShot(true);
+
+        connect(m_resolveTimer, &QTimer::timeout, this,
+                &TaskInfoZoneDownloader::refreshResolvedZones);
+    }
+
+    m_resolveTimer->start(m_resolveTtlSecs * 1000);
+
+    m_resolveTtlSecs = 0;
+}
+
 void TaskInfoZoneDownloader::insertZoneId(quint32 &zonesMask, int zoneId)
 {
     zonesMask |= (quint32(1) << (zoneId - 1));
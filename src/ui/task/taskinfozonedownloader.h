@@ -5,6 +5,8 @@
 
 #include "taskinfo.h"
 
+QT_FORWARD_DECLARE_CLASS(QTimer)
+
 class TaskZoneDownloader;
 class ZoneListModel;
 
@@ -24,23 +26,48 @@ public slots:
     void loadZones();
     bool saveZoneAsText(const QString &filePath, int zoneIndex);
 
+    // Re-resolve the domain names' zones by their addresses' TTL
+    void refreshResolvedZones();
+
 protected slots:
     void setupTaskWorker() override;
+    void runTaskWorker() override;
 
     void handleFinished(bool success) override;
 
-    void processSubResult(bool success);
+    void processSubResult(TaskZoneDownloader *worker, bool success);
     void clearSubResults();
 
 private:
-    void setupNextTaskWorker();
-    void setupTaskWorkerByZone(TaskZoneDownloader *worker);
+    struct ZoneWorker
+    {
+        TaskZoneDownloader *worker = nullptr;
+        bool running : 1 = true;
+        bool success : 1 = false;
+    };
+
+    void runNextTaskWorkers();
+    void abortZoneWorkers();
+    void finishZoneWorkers();
+    void clearZoneWorkers();
+
+    TaskZoneDownloader *createZoneWorker();
+    TaskZoneDownloader *runningZoneWorker() const;
+
+    void setupTaskWorkerByZone(TaskZoneDownloader *worker, int zoneIndex);
     void addSubResult(TaskZoneDownloader *worker, bool success);
 
     void insertZoneId(quint32 &zonesMask, int zoneId);
     bool containsZoneId(quint32 zonesMask, int zoneId) const;
 
-    void emitZonesUpdated();
+    void emitZonesUpdated(bool onlyChanged = false);
+    bool updateDriverChangedZones();
+
+    void processResolvedZone(TaskZoneDownloader *worker, bool success);
+    void finishResolvedZones();
+
+    void addResolveTtl(TaskZoneDownloader *worker);
+    void startResolveTimer();
 
     void removeOrphanCacheFiles();
 
@@ -49,14 +76,29 @@ private:
 private:
     bool m_success = false;
     int m_zoneIndex = 0;
+    int m_runningCount = 0;
     quint32 m_zonesMask = 0;
 
     quint32 m_dataZonesMask = 0;
     quint32 m_enabledMask = 0;
     quint32 m_dataSize = 0;
 
+    quint32 m_driverZonesMask = 0;
+    quint32 m_driverEnabledMask = 0;
+
+    bool m_resolveReloadZones = false;
+    int m_resolveRunningCount = 0;
+    quint32 m_resolveTtlSecs = 0; // of the next refresh
+
+    QTimer *m_resolveTimer = nullptr;
+
     QStringList m_zoneNames;
+
+    QList<ZoneWorker> m_zoneWorkers; // by zone indexes
     QList<QByteArray> m_zonesData;
+
+    QList<int> m_changedZoneIds;
+    QList<QByteArray> m_changedZonesData;
 };
 
 #endif // TASKINFOZONEDOWNLOADER_H
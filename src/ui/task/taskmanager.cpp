@@ -4,6 +4,7 @@
 #include <util/dateutil.h>
 #include <util/ioc/ioccontainer.h>
 
+#include "taskinfopolicysync.h"
 #include "taskinfoupdatechecker.h"
 #include "taskinfozonedownloader.h"
 
@@ -25,6 +26,11 @@ TaskInfoZoneDownloader *TaskManager::taskInfoZoneDownloader() const
     return static_cast<TaskInfoZoneDownloader *>(taskInfoAt(1));
 }
 
+TaskInfoPolicySync *TaskManager::taskInfoPolicySync() const
+{
+    return static_cast<TaskInfoPolicySync *>(taskInfoAt(2));
+}
+
 TaskInfo *TaskManager::taskInfoAt(int row) const
 {
     return taskInfoList().at(row);
@@ -48,6 +54,7 @@ void TaskManager::setupTasks()
 {
     appendTaskInfo(new TaskInfoUpdateChecker(*this));
     appendTaskInfo(new TaskInfoZoneDownloader(*this));
+    appendTaskInfo(new TaskInfoPolicySync(*this));
 }
 
 void TaskManager::appendTaskInfo(TaskInfo *taskInfo)
@@ -147,6 +154,8 @@ TaskInfo *TaskManager::taskInfoByType(qint8 taskType) const
         return taskInfoUpdateChecker();
     case TaskInfo::ZoneDownloader:
         return taskInfoZoneDownloader();
+    case TaskInfo::PolicySync:
+        return taskInfoPolicySync();
     default:
         Q_UNREACHABLE();
         return nullptr;
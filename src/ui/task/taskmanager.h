@@ -8,6 +8,7 @@
 #include <util/ioc/iocservice.h>
 
 class TaskInfo;
+class TaskInfoPolicySync;
 class TaskInfoUpdateChecker;
 class TaskInfoZoneDownloader;
 
@@ -20,6 +21,7 @@ public:
 
     TaskInfoUpdateChecker *taskInfoUpdateChecker() const;
     TaskInfoZoneDownloader *taskInfoZoneDownloader() const;
+    TaskInfoPolicySync *taskInfoPolicySync() const;
 
     const QList<TaskInfo *> &taskInfoList() const { return m_taskInfoList; }
     TaskInfo *taskInfoAt(int row) const;
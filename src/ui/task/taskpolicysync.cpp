@@ -0,0 +1,68 @@
+#include "taskpolicysync.h"
+
+#include <QLoggingCategory>
+#include <QSysInfo>
+#include <QUrl>
+#include <QUrlQuery>
+
+#include <util/json/jsonutil.h>
+#include <util/net/netdownloader.h>
+
+namespace {
+
+const QLoggingCategory LC("task.taskPolicySync");
+
+}
+
+TaskPolicySync::TaskPolicySync(QObject *parent) : TaskDownloader(parent) { }
+
+QString TaskPolicySync::requestUrl(const QString &url, qint64 sinceVersion, const QString &hostName)
+{
+    QUrl requestUrl(url);
+
+    // Report the applied version, to get the delta since it
+    QUrlQuery query(requestUrl);
+    query.addQueryItem("since", QString::number(sinceVersion));
+    query.addQueryItem("host", hostName);
+
+    requestUrl.setQuery(query);
+
+    return requestUrl.toString();
+}
+
+void TaskPolicySync::setupDownloader()
+{
+    downloader()->setUrl(requestUrl(url(), sinceVersion(), QSysInfo::machineHostName()));
+}
+
+void TaskPolicySync::downloadFinished(bool success)
+{
+    if (success) {
+        success = parseBuffer(downloader()->takeBuffer());
+    }
+
+    finish(success);
+}
+
+bool TaskPolicySync::parseBuffer(const QByteArray &buffer)
+{
+    QString errorString;
+    const auto map = JsonUtil::jsonToVariant(buffer, errorString).toMap();
+    if (!errorString.isEmpty()) {
+        qCWarning(LC) << "Policy Sync: JSON error:" << errorString;
+        return false;
+    }
+
+    m_version = map["version"].toLongLong();
+
+    // The delta's base must be applied already; a full policy has no base
+    const qint64 since = map["since"].toLongLong();
+    if (since > sinceVersion()) {
+        qCWarning(LC) << "Policy Sync: Delta of unknown version:" << since << sinceVersion();
+        return false;
+    }
+
+    m_policy = map;
+
+    return true;
+}
@@ -0,0 +1,46 @@
+#ifndef TASKPOLICYSYNC_H
+#define TASKPOLICYSYNC_H
+
+#include <QVariant>
+
+#include "taskdownloader.h"
+
+class TaskPolicySync : public TaskDownloader
+{
+    Q_OBJECT
+
+public:
+    explicit TaskPolicySync(QObject *parent = nullptr);
+
+    QString url() const { return m_url; }
+    void setUrl(const QString &v) { m_url = v; }
+
+    // Of the applied policy
+    qint64 sinceVersion() const { return m_sinceVersion; }
+    void setSinceVersion(qint64 v) { m_sinceVersion = v; }
+
+    qint64 version() const { return m_version; }
+
+    const QVariantMap &policy() const { return m_policy; }
+
+    static QString requestUrl(const QString &url, qint64 sinceVersion, const QString &hostName);
+
+protected:
+    void setupDownloader() override;
+
+protected slots:
+    void downloadFinished(bool success) override;
+
+private:
+    bool parseBuffer(const QByteArray &buffer);
+
+private:
+    qint64 m_sinceVersion = 0;
+    qint64 m_version = 0;
+
+    QString m_url;
+
+    QVariantMap m_policy;
+};
+
+#endif // TASKPOLICYSYNC_H
@@ -1,19 +1,33 @@
 #include "taskzonedownloader.h"
 
 #include <QCryptographicHash>
+#include <QFutureWatcher>
 #include <QLoggingCategory>
 #include <QRegularExpression>
 #include <QUrl>
+#include <QtConcurrent>
 
 #include <fortcompat.h>
 #include <util/conf/confutil.h>
 #include <util/fileutil.h>
 #include <util/net/iprange.h>
 #include <util/net/netdownloader.h>
+#include <util/net/netutil.h>
 #include <util/stringutil.h>
 
 namespace {
+
 const QLoggingCategory LC("task.taskZoneDownloader");
+
+using ResolvedHost = QPair<QStringList, quint32>; // addresses & TTL
+
+ResolvedHost resolveHost(const QString &hostName)
+{
+    ResolvedHost host;
+    host.second = NetUtil::resolveHostAddresses(hostName, host.first);
+    return host;
+}
+
 }
 
 TaskZoneDownloader::TaskZoneDownloader(QObject *parent) : TaskDownloader(parent) { }
@@ -34,29 +48,118 @@ void TaskZoneDownloader::setupDownloader()
 
     downloader()->setUrl(url());
     downloader()->setData(formData().toUtf8());
+
+    // Download the list only when modified since the cached one
+    if (FileUtil::fileExists(cacheFileBinPath())) {
+        downloader()->setIfModifiedSince(sourceModTime());
+    }
 }
 
 void TaskZoneDownloader::downloadFinished(bool success)
 {
-    if (success) {
-        success = false;
+    if (success && resolve()) {
+        resolveNames();
+        return;
+    }
 
+    if (success) {
         QString textChecksum;
         const auto text = QString::fromLatin1(downloader()->takeBuffer());
         const auto list = parseAddresses(text, textChecksum);
 
-        if (!list.isEmpty()
-                && (this->textChecksum() != textChecksum
-                        || !FileUtil::fileExists(cacheFileBinPath()))) {
-            setTextChecksum(textChecksum);
-            success = storeAddresses(list);
-            setAddressCount(success ? list.size() : 0);
-        }
+        success = processAddresses(list, textChecksum);
     }
 
     finish(success);
 }
 
+bool TaskZoneDownloader::processAddresses(const StringViewList &list, const QString &textChecksum)
+{
+    bool success = false;
+
+    const bool changed =
+            (this->textChecksum() != textChecksum || !FileUtil::fileExists(cacheFileBinPath()));
+
+    if (!list.isEmpty() && changed) {
+        setTextChecksum(textChecksum);
+        success = storeAddresses(list);
+        setAddressCount(success ? list.size() : 0);
+    }
+
+    const auto lastModified = downloader()->lastModified();
+    if (lastModified.isValid() && !list.isEmpty() && (success || !changed)) {
+        setSourceModTime(lastModified);
+    }
+
+    return success;
+}
+
+void TaskZoneDownloader::resolveNames()
+{
+    QString namesChecksum;
+    const auto text = QString::fromLatin1(downloader()->takeBuffer());
+    const auto list = parseAddresses(text, namesChecksum);
+
+    QStringList hostNames;
+    hostNames.reserve(list.size());
+    for (const auto &hostName : list) {
+        hostNames.append(hostName.toString());
+    }
+
+    hostNames.removeDuplicates();
+
+    // Resolve the names concurrently, without blocking the service's thread
+    auto watcher = new QFutureWatcher<ResolvedHost>(this);
+
+    connect(watcher, &QFutureWatcherBase::finished, this, [=, this] {
+        watcher->deleteLater();
+
+        // Aborted
+        if (!downloader())
+            return;
+
+        processResolvedNames(watcher->future().results());
+    });
+
+    watcher->setFuture(QtConcurrent::mapped(std::move(hostNames), resolveHost));
+}
+
+void TaskZoneDownloader::processResolvedNames(const QList<ResolvedHost> &hosts)
+{
+    QStringList addresses;
+    quint32 ttlSecs = 0;
+
+    for (const ResolvedHost &host : hosts) {
+        if (host.first.isEmpty())
+            continue;
+
+        addresses.append(host.first);
+        ttlSecs = (ttlSecs == 0) ? host.second : qMin(ttlSecs, host.second);
+    }
+
+    m_resolveTtlSecs = ttlSecs;
+
+    // The DNS servers rotate the addresses
+    addresses.sort();
+    addresses.removeDuplicates();
+
+    StringViewList list;
+    list.reserve(addresses.size());
+
+    QCryptographicHash cryptoHash(QCryptographicHash::Sha256);
+
+    for (const auto &address : asConst(addresses)) {
+        list.append(address);
+
+        cryptoHash.addData(address.toLatin1());
+        cryptoHash.addData("\n");
+    }
+
+    const auto textChecksum = QString::fromLatin1(cryptoHash.result().toHex());
+
+    finish(processAddresses(list, textChecksum));
+}
+
 void TaskZoneDownloader::loadTextInline()
 {
     downloader()->setBuffer(textInline().toUtf8());
@@ -90,6 +193,8 @@ StringViewList TaskZoneDownloader::parseAddresses(const QString &text, QString &
 
     const auto lines = StringUtil::tokenizeView(text, QLatin1Char('\n'), true);
 
+    list.reserve(text.count('\n') + 1);
+
     for (const auto &line : lines) {
         if (line.startsWith('#') || line.startsWith(';')) // commented line
             continue;
@@ -131,7 +236,8 @@ bool TaskZoneDownloader::storeAddresses(const StringViewList &list)
 
     m_zoneData.resize(bufSize);
 
-    const auto binData = qCompress(m_zoneData);
+    // Compressed once per download, but decompressed on each start
+    const auto binData = qCompress(m_zoneData, /*compressionLevel=*/9);
 
     const auto binChecksumData = QCryptographicHash::hash(binData, QCryptographicHash::Sha256);
     setBinChecksum(QString::fromLatin1(binChecksumData.toHex()));
@@ -2,6 +2,7 @@
 #define TASKZONEDOWNLOADER_H
 
 #include <QDateTime>
+#include <QStringList>
 
 #include <fortcompat.h>
 
@@ -20,6 +21,12 @@ public:
     bool sort() const { return m_sort; }
     void setSort(bool v) { m_sort = v; }
 
+    bool resolve() const { return m_resolve; }
+    void setResolve(bool v) { m_resolve = v; }
+
+    // Minimal TTL of the resolved addresses, 0 when not resolved
+    quint32 resolveTtlSecs() const { return m_resolveTtlSecs; }
+
     int emptyNetMask() const { return m_emptyNetMask; }
     void setEmptyNetMask(int v) { m_emptyNetMask = v; }
 
@@ -81,9 +88,15 @@ private:
     void loadTextInline();
     void loadLocalFile();
 
+    bool processAddresses(const StringViewList &list, const QString &textChecksum);
+
+    void resolveNames();
+    void processResolvedNames(const QList<QPair<QStringList, quint32>> &hosts);
+
 private:
     bool m_zoneEnabled : 1 = false;
     bool m_sort : 1 = false;
+    bool m_resolve : 1 = false;
 
     int m_emptyNetMask = 32;
 
@@ -91,6 +104,8 @@ private:
 
     int m_addressCount = 0;
 
+    quint32 m_resolveTtlSecs = 0;
+
     QString m_zoneName;
 
     QString m_url;
@@ -51,6 +51,7 @@ public:
     void setHomeAutoShowMenu(bool v) { setValue("home/autoShowMenu", v); }
 
     bool progNotifyMessage() const { return valueBool("prog/notifyMessage", true); }
+    int progIconCacheSizeMb(int v = 16) const { return valueInt("prog/iconCacheSizeMb", v); }
     void setProgNotifyMessage(bool v) { setValue("prog/notifyMessage", v, true); }
 
     bool trayShowIcon() const { return valueBool("tray/showIcon", true); }
@@ -1,11 +1,42 @@
 #include "appparseoptions.h"
 
-appentry_map_t &AppParseOptions::appsMap(bool isWild, bool isPrefix)
+appentry_arr_t &AppParseOptions::apps(bool isWild, bool isPrefix)
 {
-    return isWild ? wildAppsMap : (isPrefix ? prefixAppsMap : exeAppsMap);
+    return isWild ? wildApps : (isPrefix ? prefixApps : exeApps);
 }
 
 quint32 &AppParseOptions::appsSize(bool isWild, bool isPrefix)
 {
     return isWild ? wildAppsSize : (isPrefix ? prefixAppsSize : exeAppsSize);
 }
+
+void AppParseOptions::sortApps()
+{
+    sortApps(wildApps, wildAppsSize);
+    sortApps(prefixApps, prefixAppsSize);
+    sortApps(exeApps, exeAppsSize);
+}
+
+void AppParseOptions::sortApps(appentry_arr_t &apps, quint32 &appsSize)
+{
+    std::stable_sort(apps.begin(), apps.end(),
+            [](const AppEntry &a, const AppEntry &b) { return a.path < b.path; });
+
+    // Keep the first added entry of the same path
+    int count = 0;
+    for (int i = 0, n = apps.size(); i < n; ++i) {
+        AppEntry &app = apps[i];
+
+        if (count > 0 && apps[count - 1].path == app.path) {
+            appsSize -= FORT_CONF_APP_ENTRY_SIZE(app.entry.path_len);
+            continue;
+        }
+
+        if (count != i) {
+            apps[count] = std::move(app);
+        }
+        ++count;
+    }
+
+    apps.resize(count);
+}
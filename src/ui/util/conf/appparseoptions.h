@@ -1,23 +1,47 @@
 #ifndef APPPARSEOPTIONS_H
 #define APPPARSEOPTIONS_H
 
-#include <QMap>
+#include <QByteArray>
+#include <QHash>
 #include <QObject>
 #include <QVarLengthArray>
+#include <QVector>
 
 #include <common/fortconf.h>
 
 #include "addressrange.h"
 
+struct AppEntry
+{
+    QString path;
+    FORT_APP_ENTRY entry;
+};
+
+struct AppTextLine
+{
+    QString appPath;
+    bool isWild = false;
+    bool isPrefix = false;
+};
+
 using addrranges_arr_t = QVarLengthArray<AddressRange, 2>;
-using appentry_map_t = QMap<QString, FORT_APP_ENTRY>;
+using appentry_arr_t = QVector<AppEntry>;
+using apptextlines_arr_t = QVector<AppTextLine>;
+using fileidapps_arr_t = QVector<FORT_CONF_FILE_ID_APP>;
+
+// Parsed lines by the env. expanded apps text
+using appstext_cache_t = QHash<QString, apptextlines_arr_t>;
 
 class AppParseOptions
 {
 public:
-    appentry_map_t &appsMap(bool isWild, bool isPrefix);
+    appentry_arr_t &apps(bool isWild, bool isPrefix);
     quint32 &appsSize(bool isWild, bool isPrefix);
 
+    void sortApps();
+
+    static void sortApps(appentry_arr_t &apps, quint32 &appsSize);
+
 public:
     bool procWild = false;
 
@@ -25,9 +49,15 @@ public:
     quint32 prefixAppsSize = 0;
     quint32 exeAppsSize = 0;
 
-    appentry_map_t wildAppsMap;
-    appentry_map_t prefixAppsMap;
-    appentry_map_t exeAppsMap;
+    appentry_arr_t wildApps;
+    appentry_arr_t prefixApps;
+    appentry_arr_t exeApps;
+
+    // Sorted by the file ids, of the sorted exe apps
+    fileidapps_arr_t exeFileIds;
+
+    QByteArray wildMatcher;
+    QByteArray prefixTrie;
 };
 
 #endif // APPPARSEOPTIONS_H
@@ -0,0 +1,157 @@
+#include "confevaluator.h"
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <common/fortdef.h>
+
+#include <driver/drivercommon.h>
+#include <util/fileutil.h>
+#include <util/net/netutil.h>
+
+namespace {
+
+constexpr int blockReasonsCount = FORT_BLOCK_REASON_ASK_PENDING + 1;
+
+bool parseIp(const QString &text, bool &isIPv6, ip_addr_t &ip)
+{
+    bool ok;
+
+    ip.v4 = NetUtil::textToIp4(text, &ok);
+    if (ok) {
+        isIPv6 = false;
+        return true;
+    }
+
+    ip.v6 = NetUtil::textToIp6(text, &ok);
+    if (ok) {
+        isIPv6 = true;
+        return true;
+    }
+
+    return false;
+}
+
+}
+
+void ConfEvaluator::setConf(const QByteArray &confIoBuf, const QByteArray &zonesBuf)
+{
+    m_confBuf = confIoBuf.mid(DriverCommon::confIoConfOff());
+    m_zonesBuf = zonesBuf;
+
+    if (m_confBuf.isEmpty())
+        return;
+
+    // As the driver does on the conf's set, the periods are not checked
+    DriverCommon::confAppPermsMaskInit(m_confBuf.data());
+}
+
+bool ConfEvaluator::loadConfCache(const QString &filePath)
+{
+    const QByteArray data = FileUtil::readFileData(filePath);
+
+    quint32 confOff, confSize, zonesOff, zonesSize;
+    if (!DriverCommon::confCacheRead(
+                data.constData(), data.size(), &confOff, &confSize, &zonesOff, &zonesSize))
+        return false;
+
+    setConf(data.mid(confOff, confSize), data.mid(zonesOff, zonesSize));
+
+    return isValid();
+}
+
+bool ConfEvaluator::connBlocked(const ConfEvalConn &conn, qint8 &blockReason) const
+{
+    return DriverCommon::confConnBlocked(m_confBuf.constData(),
+            m_zonesBuf.isEmpty() ? nullptr : m_zonesBuf.constData(), conn.kernelPath, conn.isIPv6,
+            conn.inbound, conn.ipProto, conn.localIp, conn.localPort, conn.remoteIp,
+            conn.remotePort, &blockReason);
+}
+
+ConfEvalResult ConfEvaluator::evaluateConns(const QVector<ConfEvalConn> &conns) const
+{
+    ConfEvalResult result;
+    result.connsCount = conns.size();
+    result.blockReasonCounts.resize(blockReasonsCount);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (const ConfEvalConn &conn : conns) {
+        qint8 blockReason;
+        if (!connBlocked(conn, blockReason))
+            continue;
+
+        ++result.blockedCount;
+
+        if (blockReason >= 0 && blockReason < blockReasonsCount) {
+            ++result.blockReasonCounts[blockReason];
+        }
+    }
+
+    result.elapsedNsecs = timer.nsecsElapsed();
+
+    return result;
+}
+
+bool ConfEvaluator::parseConnLine(const QByteArray &line, ConfEvalConn &conn)
+{
+    const QJsonObject obj = QJsonDocument::fromJson(line).object();
+
+    if (obj["type"].toString() != "conn_block")
+        return false;
+
+    const QString path = obj["path"].toString();
+    if (path.isEmpty())
+        return false;
+
+    bool isIPv6;
+    if (!parseIp(obj["remote_ip"].toString(), isIPv6, conn.remoteIp))
+        return false;
+
+    bool isLocalIPv6;
+    if (!parseIp(obj["local_ip"].toString(), isLocalIPv6, conn.localIp) || isLocalIPv6 != isIPv6)
+        return false;
+
+    conn.isIPv6 = isIPv6;
+    conn.inbound = obj["inbound"].toBool();
+    conn.ipProto = quint8(obj["ip_proto"].toInt());
+    conn.localPort = quint16(obj["local_port"].toInt());
+    conn.remotePort = quint16(obj["remote_port"].toInt());
+
+    // The paths repeat, convert them once
+    auto it = m_kernelPaths.constFind(path);
+    if (it == m_kernelPaths.constEnd()) {
+        it = m_kernelPaths.insert(path, FileUtil::pathToKernelPath(path));
+    }
+    conn.kernelPath = it.value();
+
+    return true;
+}
+
+QString ConfEvaluator::blockReasonName(qint8 blockReason)
+{
+    switch (blockReason) {
+    case FORT_BLOCK_REASON_UNKNOWN:
+        return "unknown";
+    case FORT_BLOCK_REASON_IP_INET:
+        return "ip_inet";
+    case FORT_BLOCK_REASON_PROGRAM:
+        return "program";
+    case FORT_BLOCK_REASON_APP_GROUP_FOUND:
+        return "app_group";
+    case FORT_BLOCK_REASON_FILTER_MODE:
+        return "filter_mode";
+    case FORT_BLOCK_REASON_LAN_ONLY:
+        return "lan_only";
+    case FORT_BLOCK_REASON_ZONE:
+        return "zone";
+    case FORT_BLOCK_REASON_RULE:
+        return "rule";
+    case FORT_BLOCK_REASON_ASK_PENDING:
+        return "ask_pending";
+    default:
+        return QString::number(blockReason);
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef CONFEVALUATOR_H
+#define CONFEVALUATOR_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <common/common_types.h>
+
+struct ConfEvalConn
+{
+    bool isIPv6 : 1 = false;
+    bool inbound : 1 = false;
+
+    quint8 ipProto = 0;
+
+    quint16 localPort = 0;
+    quint16 remotePort = 0;
+
+    ip_addr_t localIp = {};
+    ip_addr_t remoteIp = {};
+
+    QString kernelPath;
+};
+
+struct ConfEvalResult
+{
+    int connsCount = 0;
+    int blockedCount = 0;
+
+    qint64 elapsedNsecs = 0;
+
+    QVector<int> blockReasonCounts; // by the blocked connections' reasons
+};
+
+// Replays the connections against the compiled driver's conf and zones in user mode,
+// to check the conf's changes before applying them.
+class ConfEvaluator
+{
+public:
+    bool isValid() const { return !m_confBuf.isEmpty(); }
+
+    // Of the FORT_CONF_IO and FORT_CONF_ZONES buffers, as written to the driver
+    void setConf(const QByteArray &confIoBuf, const QByteArray &zonesBuf = {});
+
+    bool loadConfCache(const QString &filePath);
+
+    bool connBlocked(const ConfEvalConn &conn, qint8 &blockReason) const;
+
+    ConfEvalResult evaluateConns(const QVector<ConfEvalConn> &conns) const;
+
+    // Of the connections' export lines: {"type":"conn_block","path":...}
+    bool parseConnLine(const QByteArray &line, ConfEvalConn &conn);
+
+    static QString blockReasonName(qint8 blockReason);
+
+private:
+    QByteArray m_confBuf;
+    QByteArray m_zonesBuf;
+
+    QHash<QString, QString> m_kernelPaths; // by the paths
+};
+
+#endif // CONFEVALUATOR_H
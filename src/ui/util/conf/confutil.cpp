@@ -1,6 +1,11 @@
 #include "confutil.h"
 
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QLoggingCategory>
 #include <QRegularExpression>
+#include <QtConcurrent>
+#include <QtEndian>
 
 #include <common/fortconf.h>
 #include <fort_version.h>
@@ -10,6 +15,8 @@
 #include <conf/app.h>
 #include <conf/appgroup.h>
 #include <conf/firewallconf.h>
+#include <conf/rules/policyset.h>
+#include <conf/rules/rule.h>
 #include <driver/drivercommon.h>
 #include <manager/envmanager.h>
 #include <util/dateutil.h>
@@ -24,12 +31,190 @@
 
 namespace {
 
+const QLoggingCategory LC("util.conf.confUtil");
+
 inline bool checkIpRangeSize(const IpRange &range)
 {
     return (range.ip4Size() + range.pair4Size()) < FORT_CONF_IP_MAX
             && (range.ip6Size() + range.pair6Size()) < FORT_CONF_IP_MAX;
 }
 
+inline bool isIp4Packed(const IpRange &range)
+{
+    return (range.ip4Size() + range.pair4Size()) >= FORT_CONF_IP_PACK_MIN_COUNT;
+}
+
+// Walk the sorted IPv4 addresses and ranges as merged disjoint ranges
+template<typename Func>
+void walkIp4Ranges(const IpRange &range, Func func)
+{
+    const int ipSize = range.ip4Size();
+    const int pairSize = range.pair4Size();
+
+    Ip4Pair cur { 0, 0 };
+    bool hasCur = false;
+
+    for (int i = 0, j = 0; i < ipSize || j < pairSize;) {
+        Ip4Pair ip;
+        if (j >= pairSize || (i < ipSize && range.ip4At(i) < range.pair4FromArray().at(j))) {
+            const quint32 v = range.ip4At(i++);
+            ip = { v, v };
+        } else {
+            ip = range.pair4At(j++);
+        }
+
+        if (hasCur && quint64(ip.from) <= quint64(cur.to) + 1) {
+            cur.to = std::max(cur.to, ip.to);
+            continue;
+        }
+
+        if (hasCur) {
+            func(cur);
+        }
+
+        cur = ip;
+        hasCur = true;
+    }
+
+    if (hasCur) {
+        func(cur);
+    }
+}
+
+// Sweep the remote ports of the rules into disjoint ranges with the lists of rules
+void buildRuleRanges(const QVector<int> &ruleIndexes, const QVector<ruleports_arr_t> &remotePorts,
+        QVector<FORT_CONF_RULE_RANGE> &ranges, QVector<quint16> &lists)
+{
+    // Boundaries of port ranges: position and signed rule number
+    QVector<QPair<quint32, int>> bounds;
+
+    const auto addBound = [&](quint32 from, quint32 to, int ruleNum) {
+        bounds.append({ from, ruleNum });
+        bounds.append({ to + 1, -ruleNum });
+    };
+
+    for (const int ruleIndex : ruleIndexes) {
+        const ruleports_arr_t &ports = remotePorts[ruleIndex];
+        const int ruleNum = ruleIndex + 1;
+
+        if (ports.isEmpty()) {
+            addBound(0, FORT_CONF_RULE_PORT_MAX, ruleNum);
+            continue;
+        }
+
+        for (const FORT_CONF_RULE_PORTS &port : ports) {
+            addBound(port.from, port.to, ruleNum);
+        }
+    }
+
+    std::sort(bounds.begin(), bounds.end());
+
+    // Active rules by their index, i.e. in priority order
+    QMap<int, int> activeCounts;
+    QVector<quint16> prevList;
+
+    const int boundsCount = bounds.size();
+    for (int i = 0; i < boundsCount;) {
+        const quint32 pos = bounds[i].first;
+
+        for (; i < boundsCount && bounds[i].first == pos; ++i) {
+            const int ruleNum = bounds[i].second;
+            const int ruleIndex = qAbs(ruleNum) - 1;
+
+            if (ruleNum > 0) {
+                ++activeCounts[ruleIndex];
+            } else if (--activeCounts[ruleIndex] == 0) {
+                activeCounts.remove(ruleIndex);
+            }
+        }
+
+        if (activeCounts.isEmpty() || i >= boundsCount)
+            continue;
+
+        const quint16 from = quint16(pos);
+        const quint16 to = quint16(bounds[i].first - 1);
+
+        QVector<quint16> list;
+        for (const int ruleIndex : activeCounts.keys()) {
+            list.append(quint16(ruleIndex));
+        }
+
+        if (!ranges.isEmpty() && quint32(ranges.last().ports.to) + 1 == from && list == prevList) {
+            ranges.last().ports.to = to;
+            continue;
+        }
+
+        FORT_CONF_RULE_RANGE range;
+        range.ports = { from, to };
+        range.list_i = quint32(lists.size());
+        ranges.append(range);
+
+        lists.append(quint16(list.size()));
+        lists.append(list);
+
+        prevList = list;
+    }
+}
+
+int varintSize(quint32 v)
+{
+    int n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+void writeVarint(quint8 **data, quint32 v)
+{
+    quint8 *p = *data;
+    while (v >= 0x80) {
+        *p++ = quint8(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = quint8(v);
+    *data = p;
+}
+
+quint32 readVarint(const quint8 **data)
+{
+    const quint8 *p = *data;
+    quint32 v = 0;
+    int shift = 0;
+    quint8 c;
+
+    do {
+        c = *p++;
+        v |= quint32(c & 0x7F) << shift;
+        shift += 7;
+    } while ((c & 0x80) != 0 && shift < 35);
+
+    *data = p;
+    return v;
+}
+
+// Count of merged ranges and size of their blocks data
+void packedIp4Size(const IpRange &range, quint32 &count, quint32 &dataSize)
+{
+    count = 0;
+    dataSize = 0;
+
+    quint32 prevTo = 0;
+
+    walkIp4Ranges(range, [&](const Ip4Pair &ip) {
+        if ((count % FORT_CONF_IP_BLOCK_N) != 0) {
+            dataSize += varintSize(ip.from - prevTo);
+        }
+        dataSize += varintSize(ip.to - ip.from);
+
+        prevTo = ip.to;
+        ++count;
+    });
+
+    dataSize = FORT_ALIGN_SIZE(dataSize, sizeof(quint32));
+}
+
 int writeServicesHeader(char *data, int servicesCount)
 {
     PFORT_SERVICE_INFO_LIST infoList = (PFORT_SERVICE_INFO_LIST) data;
@@ -44,6 +229,7 @@ int writeServiceInfo(char *data, const ServiceInfo &serviceInfo)
     PFORT_SERVICE_INFO info = (PFORT_SERVICE_INFO) data;
 
     info->process_id = serviceInfo.processId;
+    info->service_tag = serviceInfo.serviceTag;
 
     const quint16 nameLen = quint16(serviceInfo.serviceName.size() * sizeof(char16_t));
     info->name_len = nameLen;
@@ -53,6 +239,66 @@ int writeServiceInfo(char *data, const ServiceInfo &serviceInfo)
     return FORT_SERVICE_INFO_NAME_OFF + FORT_CONF_STR_DATA_SIZE(nameLen);
 }
 
+int commonPrefixSize(const QString &s1, const QString &s2)
+{
+    const int size = std::min(s1.size(), s2.size());
+
+    int i = 0;
+    while (i < size && s1.at(i) == s2.at(i)) {
+        ++i;
+    }
+    return i;
+}
+
+struct PrefixTrieKeys
+{
+    QStringList paths;
+    QVector<quint32> appOffsets;
+};
+
+// Fill the node of sorted keys [lo, hi) sharing the prefix of "end" chars
+void writePrefixNodes(QVector<FORT_CONF_PREFIX_NODE> &nodes, int nodeIndex,
+        const PrefixTrieKeys &keys, int lo, int hi, int depth, int end)
+{
+    FORT_CONF_PREFIX_NODE &node = nodes[nodeIndex];
+
+    node.label_off = keys.appOffsets[lo] + sizeof(FORT_APP_ENTRY) + depth * sizeof(wchar_t);
+    node.label_len = quint16((end - depth) * sizeof(wchar_t));
+    node.app_off = FORT_CONF_PREFIX_NONE;
+
+    if (keys.paths[lo].size() == end) {
+        node.app_off = keys.appOffsets[lo];
+        ++lo;
+    }
+
+    // Group the longer keys by their next char
+    QVector<QPair<int, int>> groups;
+    for (int i = lo; i < hi;) {
+        const QChar c = keys.paths[i].at(end);
+
+        int j = i + 1;
+        while (j < hi && keys.paths[j].at(end) == c) {
+            ++j;
+        }
+        groups.append({ i, j });
+        i = j;
+    }
+
+    const int childrenIndex = nodes.size();
+
+    node.children_i = childrenIndex;
+    node.children_n = quint16(groups.size());
+
+    nodes.resize(childrenIndex + groups.size()); // invalidates the node
+
+    for (int k = 0; k < groups.size(); ++k) {
+        const auto &[groupLo, groupHi] = groups[k];
+        const int groupEnd = commonPrefixSize(keys.paths[groupLo], keys.paths[groupHi - 1]);
+
+        writePrefixNodes(nodes, childrenIndex + k, keys, groupLo, groupHi, end, groupEnd);
+    }
+}
+
 void writeConfFlags(const FirewallConf &conf, PFORT_CONF_FLAGS confFlags)
 {
     confFlags->boot_filter = conf.bootFilter();
@@ -74,6 +320,8 @@ void writeConfFlags(const FirewallConf &conf, PFORT_CONF_FLAGS confFlags)
     confFlags->log_blocked_ip = conf.logBlockedIp();
     confFlags->log_alerted_blocked_ip = conf.logAlertedBlockedIp();
 
+    confFlags->log_flow_stat = conf.logFlowStat();
+
     confFlags->group_bits = conf.appGroupBits();
 }
 
@@ -104,6 +352,7 @@ int ConfUtil::writeVersion(QByteArray &buf)
     PFORT_CONF_VERSION confVer = (PFORT_CONF_VERSION) buf.data();
 
     confVer->driver_version = DRIVER_VERSION;
+    confVer->compact_traf = false; // 64-bit traffic counters
 
     return verSize;
 }
@@ -130,47 +379,171 @@ int ConfUtil::writeServices(
 int ConfUtil::write(const FirewallConf &conf, ConfAppsWalker *confAppsWalker,
         EnvManager &envManager, QByteArray &buf)
 {
+    QElapsedTimer timer;
+    timer.start();
+
     quint32 addressGroupsSize = 0;
     longs_arr_t addressGroupOffsets;
     addrranges_arr_t addressRanges(conf.addressGroups().size());
 
-    if (!parseAddressGroups(
-                conf.addressGroups(), addressRanges, addressGroupOffsets, addressGroupsSize))
-        return 0;
+    // Parse the address groups in parallel with the apps, which are read from the DB
+    ConfUtil addressGroupsUtil;
+
+    QFuture<bool> addressGroupsFuture = QtConcurrent::run([&] {
+        QElapsedTimer addressGroupsTimer;
+        addressGroupsTimer.start();
+
+        const bool ok = addressGroupsUtil.parseAddressGroups(
+                conf.addressGroups(), addressRanges, addressGroupOffsets, addressGroupsSize);
+
+        m_writeTimes.addressGroupsMsecs = addressGroupsTimer.elapsed();
+
+        return ok;
+    });
 
     quint8 appPeriodsCount = 0;
     chars_arr_t appPeriods;
 
     AppParseOptions opt;
 
-    if (!parseExeApps(envManager, confAppsWalker, opt))
+    const bool appsOk = parseExeApps(envManager, confAppsWalker, opt)
+            && parseAppGroups(envManager, conf.appGroups(), appPeriods, appPeriodsCount, opt);
+
+    m_writeTimes.appsMsecs = timer.elapsed();
+
+    if (!addressGroupsFuture.result()) {
+        setErrorMessage(addressGroupsUtil.errorMessage());
         return 0;
+    }
 
-    if (!parseAppGroups(envManager, conf.appGroups(), appPeriods, appPeriodsCount, opt))
+    if (!appsOk)
         return 0;
 
+    opt.sortApps();
+
     const quint32 appsSize = opt.wildAppsSize + opt.prefixAppsSize + opt.exeAppsSize;
     if (appsSize > FORT_CONF_APPS_LEN_MAX) {
         setErrorMessage(tr("Too many application paths"));
         return 0;
     }
 
+    QByteArray rulesData;
+    if (!parseRules(rulesData))
+        return 0;
+
+    logfilters_arr_t logFilters;
+    if (!parseLogFilters(conf.ini().logBlockedIpFilters(), logFilters))
+        return 0;
+
+    ruleports_arr_t udpLightPorts;
+    if (conf.ini().udpLightFlows()
+            && !parseUdpLightPorts(conf.ini().udpLightFlowPorts(), udpLightPorts))
+        return 0;
+
+    if (conf.ini().appFileIds()) {
+        parseExeFileIds(opt);
+    }
+
+    writeWildMatcher(opt.wildMatcher, opt.wildApps);
+    writePrefixTrie(opt.prefixTrie, opt.prefixApps);
+
     // Fill the buffer
     const int confIoSize = int(FORT_CONF_IO_CONF_OFF + FORT_CONF_DATA_OFF + addressGroupsSize
             + FORT_CONF_STR_DATA_SIZE(conf.appGroups().size() * sizeof(FORT_PERIOD)) // appPeriods
-            + FORT_CONF_STR_DATA_SIZE(opt.wildAppsSize)
-            + FORT_CONF_STR_HEADER_SIZE(opt.prefixAppsMap.size())
-            + FORT_CONF_STR_DATA_SIZE(opt.prefixAppsSize)
-            + FORT_CONF_STR_DATA_SIZE(opt.exeAppsSize));
+            + rulesData.size()
+            + opt.wildMatcher.size() + FORT_CONF_STR_DATA_SIZE(opt.wildAppsSize)
+            + opt.prefixTrie.size() + FORT_CONF_STR_DATA_SIZE(opt.prefixAppsSize)
+            + FORT_CONF_STR_DATA_SIZE(opt.exeAppsSize)
+            + FORT_CONF_EXE_HASHES_SIZE(opt.exeApps.size())
+            + FORT_CONF_FILE_ID_APPS_SIZE(opt.exeFileIds.size()));
 
     buf.reserve(confIoSize);
 
-    writeConf(
-            buf.data(), conf, addressRanges, addressGroupOffsets, appPeriods, appPeriodsCount, opt);
+    writeConf(buf.data(), conf, addressRanges, addressGroupOffsets, appPeriods, appPeriodsCount,
+            rulesData, logFilters, udpLightPorts, opt);
+
+    writePatchSections(conf, addressRanges, addressGroupOffsets, addressGroupsSize, appPeriods,
+            appPeriodsCount, m_patchSections);
+
+    // Drop the texts, which are not used anymore
+    if (m_appsTextCache) {
+        m_appsTextCache->swap(m_usedAppsTexts);
+        m_usedAppsTexts.clear();
+    }
+
+    m_writeTimes.totalMsecs = timer.elapsed();
 
     return confIoSize;
 }
 
+int ConfUtil::writePatch(const FirewallConf &conf, ConfPatchSections &sections, QByteArray &buf)
+{
+    quint32 addressGroupsSize = 0;
+    longs_arr_t addressGroupOffsets;
+    addrranges_arr_t addressRanges(conf.addressGroups().size());
+
+    if (!parseAddressGroups(
+                conf.addressGroups(), addressRanges, addressGroupOffsets, addressGroupsSize))
+        return 0;
+
+    quint8 appPeriodsCount = 0;
+    chars_arr_t appPeriods;
+
+    for (const AppGroup *appGroup : conf.appGroups()) {
+        parseAppPeriod(appGroup, appPeriods, appPeriodsCount);
+    }
+
+    ConfPatchSections newSections;
+    writePatchSections(conf, addressRanges, addressGroupOffsets, addressGroupsSize, appPeriods,
+            appPeriodsCount, newSections);
+
+    // Compare with the sections sent before
+    quint16 patchSections = 0;
+    quint32 patchDataSize = 0;
+
+    if (newSections.addressGroups != sections.addressGroups) {
+        patchSections |= FORT_CONF_PATCH_ADDR_GROUPS;
+        patchDataSize += newSections.addressGroups.size();
+    }
+    if (newSections.appPeriods != sections.appPeriods
+            || newSections.appPeriodsCount != sections.appPeriodsCount) {
+        patchSections |= FORT_CONF_PATCH_APP_PERIODS;
+        patchDataSize += newSections.appPeriods.size();
+    }
+    if (newSections.appGroups != sections.appGroups) {
+        patchSections |= FORT_CONF_PATCH_APP_GROUPS;
+    }
+
+    const int patchSize = int(FORT_CONF_PATCH_DATA_OFF + patchDataSize);
+
+    buf.reserve(patchSize);
+
+    // Fill the buffer
+    PFORT_CONF_PATCH drvPatch = (PFORT_CONF_PATCH) buf.data();
+    char *data = drvPatch->data;
+
+    drvPatch->sections = patchSections;
+    drvPatch->app_periods_n = newSections.appPeriodsCount;
+
+    drvPatch->addr_groups_size = quint32(newSections.addressGroups.size());
+    drvPatch->app_periods_size = quint32(newSections.appPeriods.size());
+
+    writeConfFlags(conf, &drvPatch->flags);
+
+    memcpy(&drvPatch->conf_group, newSections.appGroups.constData(), sizeof(FORT_CONF_GROUP));
+
+    if ((patchSections & FORT_CONF_PATCH_ADDR_GROUPS) != 0) {
+        writeArray(&data, newSections.addressGroups);
+    }
+    if ((patchSections & FORT_CONF_PATCH_APP_PERIODS) != 0) {
+        writeArray(&data, newSections.appPeriods);
+    }
+
+    sections = newSections;
+
+    return patchSize;
+}
+
 int ConfUtil::writeFlags(const FirewallConf &conf, QByteArray &buf)
 {
     const int flagsSize = sizeof(FORT_CONF_FLAGS);
@@ -187,27 +560,34 @@ int ConfUtil::writeFlags(const FirewallConf &conf, QByteArray &buf)
 
 int ConfUtil::writeAppEntry(const App &app, bool isNew, QByteArray &buf)
 {
-    appentry_map_t appsMap;
-    QStringList appsList;
+    return writeAppEntries({ app }, isNew, buf);
+}
+
+int ConfUtil::writeAppEntries(const QVector<App> &apps, bool isNew, QByteArray &buf)
+{
+    appentry_arr_t appEntries;
     quint32 appsSize = 0;
 
-    if (!addApp(app, isNew, appsMap, appsSize))
-        return 0;
+    for (const App &app : apps) {
+        if (!addApp(app, isNew, appEntries, appsSize))
+            return 0;
+    }
+
+    AppParseOptions::sortApps(appEntries, appsSize);
 
     buf.reserve(appsSize);
 
     // Fill the buffer
     char *data = (char *) buf.data();
 
-    writeApps(&data, appsMap);
+    writeApps(&data, appEntries);
 
     return int(appsSize);
 }
 
 int ConfUtil::writeZone(const IpRange &ipRange, QByteArray &buf)
 {
-    const int addrSize = FORT_CONF_ADDR_LIST_SIZE(
-            ipRange.ip4Size(), ipRange.pair4Size(), ipRange.ip6Size(), ipRange.pair6Size());
+    const int addrSize = addressListSize(ipRange);
 
     buf.reserve(addrSize);
 
@@ -222,7 +602,36 @@ int ConfUtil::writeZone(const IpRange &ipRange, QByteArray &buf)
 int ConfUtil::writeZones(quint32 zonesMask, quint32 enabledMask, quint32 dataSize,
         const QList<QByteArray> &zonesData, QByteArray &buf)
 {
-    const int zonesSize = FORT_CONF_ZONES_DATA_OFF + dataSize;
+    ip4_arr_t indexFromArray;
+    ip4_arr_t indexToArray;
+    longs_arr_t indexMaskArray;
+
+    // The packed zones are looked up by their own blocks index
+    quint32 indexMask = 0;
+    {
+        quint32 mask = zonesMask;
+        for (const auto &zoneData : zonesData) {
+            const int zoneIndex = DriverCommon::bitScanForward(mask);
+            mask ^= (quint32(1) << zoneIndex);
+
+            if (!PFORT_CONF_ADDR4_LIST(zoneData.constData())->is_packed) {
+                indexMask |= (quint32(1) << zoneIndex);
+            }
+        }
+    }
+
+    if (DriverCommon::bitCount(indexMask) > 1) {
+        parseZonesIndex(zonesMask, indexMask, zonesData, indexFromArray, indexToArray,
+                indexMaskArray);
+    }
+
+    for (const auto &zoneData : zonesData) {
+        dataSize += migrateZoneDataSize(zoneData);
+    }
+
+    const int indexCount = indexFromArray.size();
+    const int zonesSize =
+            FORT_CONF_ZONES_DATA_OFF + dataSize + FORT_CONF_ZONES_INDEX_SIZE(indexCount);
 
     buf.reserve(zonesSize);
 
@@ -230,39 +639,179 @@ int ConfUtil::writeZones(quint32 zonesMask, quint32 enabledMask, quint32 dataSiz
     PFORT_CONF_ZONES confZones = (PFORT_CONF_ZONES) buf.data();
     char *data = confZones->data;
 
-    memset(confZones, 0, sizeof(FORT_CONF_ZONES_DATA_OFF));
+    memset(confZones, 0, FORT_CONF_ZONES_DATA_OFF);
 
     confZones->mask = zonesMask;
     confZones->enabled_mask = enabledMask;
 
+#define CONF_DATA_OFFSET quint32(data - confZones->data)
     for (const auto &zoneData : zonesData) {
         Q_ASSERT(!zoneData.isEmpty());
 
         const int zoneIndex = DriverCommon::bitScanForward(zonesMask);
         const quint32 zoneMask = (quint32(1) << zoneIndex);
 
-#define CONF_DATA_OFFSET quint32(data - confZones->data)
         confZones->addr_off[zoneIndex] = CONF_DATA_OFFSET;
         writeArray(&data, zoneData);
         migrateZoneData(&data, zoneData);
-#undef CONF_DATA_OFFSET
 
         zonesMask ^= zoneMask;
     }
 
+    if (indexCount != 0) {
+        confZones->index_n = quint32(indexCount);
+        confZones->index_off = CONF_DATA_OFFSET;
+        confZones->index_mask = indexMask;
+
+        writeLongs(&data, indexFromArray);
+        writeLongs(&data, indexToArray);
+        writeLongs(&data, indexMaskArray);
+    }
+#undef CONF_DATA_OFFSET
+
     return zonesSize;
 }
 
-void ConfUtil::migrateZoneData(char **data, const QByteArray &zoneData)
+void ConfUtil::parseZonesIndex(quint32 zonesMask, quint32 indexMask,
+        const QList<QByteArray> &zonesData, ip4_arr_t &fromArray, ip4_arr_t &toArray,
+        longs_arr_t &maskArray)
+{
+    // Boundaries of IPv4 ranges: position and signed zone number
+    QVector<QPair<quint64, qint8>> bounds;
+
+    const auto addBound = [&](quint32 from, quint32 to, qint8 zoneNum) {
+        bounds.append({ from, zoneNum });
+        bounds.append({ quint64(to) + 1, qint8(-zoneNum) });
+    };
+
+    for (const auto &zoneData : zonesData) {
+        const int zoneIndex = DriverCommon::bitScanForward(zonesMask);
+        const qint8 zoneNum = qint8(zoneIndex + 1);
+
+        zonesMask ^= (quint32(1) << zoneIndex);
+
+        if ((indexMask & (quint32(1) << zoneIndex)) == 0)
+            continue;
+
+        // Read the non-packed driver's layout as is, without the IpRange decode
+        const PFORT_CONF_ADDR4_LIST addrList = PFORT_CONF_ADDR4_LIST(zoneData.constData());
+        const quint32 ipCount = addrList->ip_n;
+        const quint32 pairCount = addrList->pair_n;
+
+        if (quint64(zoneData.size())
+                < FORT_CONF_ADDR4_LIST_OFF + (ipCount + quint64(pairCount) * 2) * sizeof(quint32))
+            continue;
+
+        const quint32 *ipArray = addrList->ip;
+        const quint32 *pairFromArray = ipArray + ipCount;
+        const quint32 *pairToArray = pairFromArray + pairCount;
+
+        for (quint32 i = 0; i < ipCount; ++i) {
+            addBound(ipArray[i], ipArray[i], zoneNum);
+        }
+
+        for (quint32 i = 0; i < pairCount; ++i) {
+            addBound(pairFromArray[i], pairToArray[i], zoneNum);
+        }
+    }
+
+    std::sort(bounds.begin(), bounds.end());
+
+    // Sweep the boundaries into disjoint ranges with zone masks
+    int zoneCounts[FORT_CONF_ZONE_MAX] = { 0 };
+    quint32 mask = 0;
+
+    // Addresses of each zone, included by it only or shared with other zones
+    quint64 uniqueCounts[FORT_CONF_ZONE_MAX] = { 0 };
+    quint64 sharedCounts[FORT_CONF_ZONE_MAX] = { 0 };
+
+    const int boundsCount = bounds.size();
+    for (int i = 0; i < boundsCount;) {
+        const quint64 pos = bounds[i].first;
+
+        for (; i < boundsCount && bounds[i].first == pos; ++i) {
+            const qint8 zoneNum = bounds[i].second;
+            const int zoneIndex = qAbs(zoneNum) - 1;
+
+            zoneCounts[zoneIndex] += (zoneNum > 0) ? 1 : -1;
+
+            if (zoneCounts[zoneIndex] > 0) {
+                mask |= (quint32(1) << zoneIndex);
+            } else {
+                mask &= ~(quint32(1) << zoneIndex);
+            }
+        }
+
+        if (mask == 0 || i >= boundsCount)
+            continue;
+
+        const quint32 from = quint32(pos);
+        const quint32 to = quint32(bounds[i].first - 1);
+
+        const quint64 count = quint64(to) - from + 1;
+        quint64 *counts = (mask & (mask - 1)) != 0 ? sharedCounts : uniqueCounts;
+
+        for (quint32 m = mask; m != 0; m &= m - 1) {
+            counts[DriverCommon::bitScanForward(m)] += count;
+        }
+
+        const int lastIndex = maskArray.size() - 1;
+        if (lastIndex >= 0 && maskArray[lastIndex] == mask
+                && quint64(toArray[lastIndex]) + 1 == from) {
+            toArray[lastIndex] = to;
+        } else {
+            fromArray.append(from);
+            toArray.append(to);
+            maskArray.append(mask);
+        }
+    }
+
+    for (int i = 0; i < FORT_CONF_ZONE_MAX; ++i) {
+        if (uniqueCounts[i] != 0 || sharedCounts[i] != 0) {
+            qCDebug(LC) << "Zone" << (i + 1) << "addresses: unique" << uniqueCounts[i] << "shared"
+                        << sharedCounts[i];
+        }
+    }
+}
+
+int ConfUtil::migrateZoneDataSize(const QByteArray &zoneData)
 {
     PFORT_CONF_ADDR4_LIST addr_list = (PFORT_CONF_ADDR4_LIST) zoneData.data();
 
-    if (FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n) == zoneData.size()) {
+    return (FORT_CONF_ADDR4_LIST_REF_SIZE(addr_list) == zoneData.size())
+            ? FORT_CONF_ADDR6_LIST_OFF
+            : 0;
+}
+
+void ConfUtil::migrateZoneData(char **data, const QByteArray &zoneData)
+{
+    if (migrateZoneDataSize(zoneData) != 0) {
         IpRange ipRange;
         writeAddress6List(data, ipRange);
     }
 }
 
+int ConfUtil::writeZoneData(int zoneId, bool enabled, const QByteArray &zoneData, QByteArray &buf)
+{
+    Q_ASSERT(!zoneData.isEmpty());
+
+    const int zoneSize = FORT_CONF_ZONE_DATA_OFF + zoneData.size() + migrateZoneDataSize(zoneData);
+
+    buf.reserve(zoneSize);
+
+    // Fill the buffer
+    PFORT_CONF_ZONE confZone = (PFORT_CONF_ZONE) buf.data();
+    char *data = confZone->data;
+
+    confZone->zone_id = zoneId;
+    confZone->enabled = enabled;
+
+    writeArray(&data, zoneData);
+    migrateZoneData(&data, zoneData);
+
+    return zoneSize;
+}
+
 int ConfUtil::writeZoneFlag(int zoneId, bool enabled, QByteArray &buf)
 {
     const int flagSize = sizeof(FORT_CONF_ZONE_FLAG);
@@ -275,68 +824,410 @@ int ConfUtil::writeZoneFlag(int zoneId, bool enabled, QByteArray &buf)
     confZoneFlag->zone_id = zoneId;
     confZoneFlag->enabled = enabled;
 
-    return flagSize;
+    return flagSize;
+}
+
+bool ConfUtil::loadZone(const QByteArray &buf, IpRange &ipRange)
+{
+    const char *data = buf.data();
+    uint bufSize = buf.size();
+
+    return loadAddressList(&data, ipRange, bufSize);
+}
+
+QByteArray ConfUtil::appsKey(const FirewallConf &conf)
+{
+    QByteArray key;
+    QDataStream stream(&key, QIODevice::WriteOnly);
+
+    // App groups' options, which are written into the app entries
+    for (const AppGroup *appGroup : conf.appGroups()) {
+        stream << appGroup->applyChild() << appGroup->lanOnly() << appGroup->logBlocked()
+               << appGroup->logConn() << appGroup->killText() << appGroup->blockText()
+               << appGroup->allowText();
+    }
+
+    return key;
+}
+
+bool ConfUtil::parseAddressGroups(const QList<AddressGroup *> &addressGroups,
+        addrranges_arr_t &addressRanges, longs_arr_t &addressGroupOffsets,
+        quint32 &addressGroupsSize)
+{
+    const int groupsCount = addressGroups.size();
+
+    addressGroupsSize = quint32(groupsCount) * sizeof(quint32); // offsets
+
+    for (int i = 0; i < groupsCount; ++i) {
+        AddressGroup *addressGroup = addressGroups.at(i);
+
+        AddressRange &addressRange = addressRanges[i];
+        addressRange.setIncludeAll(addressGroup->includeAll());
+        addressRange.setExcludeAll(addressGroup->excludeAll());
+        addressRange.setIncludeZones(addressGroup->includeZones());
+        addressRange.setExcludeZones(addressGroup->excludeZones());
+
+        if (!addressRange.includeRange().fromText(addressGroup->includeText())) {
+            setErrorMessage(
+                    tr("Bad Include IP address: #%1 %2")
+                            .arg(QString::number(i),
+                                    addressRange.includeRange().errorLineAndMessageDetails()));
+            return false;
+        }
+
+        if (!addressRange.excludeRange().fromText(addressGroup->excludeText())) {
+            setErrorMessage(
+                    tr("Bad Exclude IP address: #%1 %2")
+                            .arg(QString::number(i),
+                                    addressRange.excludeRange().errorLineAndMessageDetails()));
+            return false;
+        }
+
+        const IpRange &incRange = addressRange.includeRange();
+        const IpRange &excRange = addressRange.excludeRange();
+
+        if (!(checkIpRangeSize(incRange) && checkIpRangeSize(excRange))) {
+            setErrorMessage(tr("Too many IP addresses"));
+            return false;
+        }
+
+        addressGroupOffsets.append(addressGroupsSize);
+
+        addressGroupsSize +=
+                FORT_CONF_ADDR_GROUP_OFF + addressListSize(incRange) + addressListSize(excRange);
+    }
+
+    return true;
+}
+
+bool ConfUtil::parseRules(QByteArray &rulesData)
+{
+    QVector<const Rule *> rules;
+
+    if (m_policySet != nullptr) {
+        for (const Rule *rule : m_policySet->m_rules) {
+            if (rule->enabled) {
+                rules.append(rule);
+            }
+        }
+    }
+
+    const int rulesCount = rules.size();
+    if (rulesCount > FORT_CONF_RULES_MAX) {
+        setErrorMessage(tr("Too many rules"));
+        return false;
+    }
+
+    QVector<FORT_CONF_RULE> ruleArray(rulesCount);
+    QVector<ruleports_arr_t> remotePorts(rulesCount);
+    QVector<quint16> protos;
+    bool hasAnyProto = false;
+    int localsCount = 0;
+
+    // Ports and address lists of the rules, offset 0 means any address
+    QByteArray rulesExtra(sizeof(quint32), '\0');
+
+    for (int i = 0; i < rulesCount; ++i) {
+        const Rule *rule = rules.at(i);
+        FORT_CONF_RULE &confRule = ruleArray[i];
+
+        memset(&confRule, 0, sizeof(FORT_CONF_RULE));
+
+        confRule.block = rule->block;
+        confRule.inbound = (rule->ruleFlags & Rule::FlagInbound) != 0;
+        confRule.equal_ports = (rule->ruleFlags & Rule::FlagEqualPorts) != 0;
+
+        ruleports_arr_t localPorts;
+        if (!parseRulePorts(rule->localPortText, localPorts)
+                || !parseRulePorts(rule->remotePortText, remotePorts[i])) {
+            setErrorMessage(tr("Bad rule ports: #%1 %2").arg(QString::number(i), rule->name));
+            return false;
+        }
+
+        AddressRange localAddr;
+        AddressRange remoteAddr;
+        if (!localAddr.includeRange().fromText(rule->localIpText)
+                || !remoteAddr.includeRange().fromText(rule->remoteIpText)) {
+            setErrorMessage(tr("Bad rule IP address: #%1 %2").arg(QString::number(i), rule->name));
+            return false;
+        }
+
+        if (!(checkIpRangeSize(localAddr.includeRange())
+                    && checkIpRangeSize(remoteAddr.includeRange()))) {
+            setErrorMessage(tr("Too many IP addresses"));
+            return false;
+        }
+
+        if (!localPorts.isEmpty()) {
+            confRule.local_ports_n = quint16(localPorts.size());
+            confRule.local_ports_off = quint32(rulesExtra.size());
+
+            rulesExtra.append((const char *) localPorts.constData(),
+                    localPorts.size() * sizeof(FORT_CONF_RULE_PORTS));
+        }
+
+        writeRuleAddrGroup(rulesExtra, localAddr, confRule.local_addr_off);
+        writeRuleAddrGroup(rulesExtra, remoteAddr, confRule.remote_addr_off);
+
+        // The driver keys its verdicts by the local address and port for such rules only
+        if (confRule.local_ports_n != 0 || confRule.local_addr_off != 0 || confRule.equal_ports) {
+            ++localsCount;
+        }
+
+        if (rule->ipProto == 0) {
+            hasAnyProto = true;
+        } else {
+            protos.append(rule->ipProto);
+        }
+    }
+
+    // Protocol buckets, the rules of any protocol are in all of them
+    std::sort(protos.begin(), protos.end());
+    protos.erase(std::unique(protos.begin(), protos.end()), protos.end());
+
+    if (hasAnyProto) {
+        protos.append(FORT_CONF_RULE_PROTO_ANY);
+    }
+
+    const int protosCount = protos.size();
+
+    QVector<FORT_CONF_RULE_PROTO> confProtos(protosCount);
+    QVector<FORT_CONF_RULE_RANGE> ranges;
+    QVector<quint16> lists;
+
+    for (int p = 0; p < protosCount; ++p) {
+        const quint16 ipProto = protos.at(p);
+
+        QVector<int> ruleIndexes;
+        for (int i = 0; i < rulesCount; ++i) {
+            const quint16 ruleProto = rules.at(i)->ipProto;
+            if (ruleProto == 0 || ruleProto == ipProto) {
+                ruleIndexes.append(i);
+            }
+        }
+
+        FORT_CONF_RULE_PROTO &confProto = confProtos[p];
+        confProto.ip_proto = ipProto;
+        confProto.ranges_i = quint32(ranges.size());
+
+        buildRuleRanges(ruleIndexes, remotePorts, ranges, lists);
+
+        confProto.ranges_n = quint16(ranges.size() - confProto.ranges_i);
+    }
+
+    // Fill the section
+    const quint32 rangesOff =
+            FORT_CONF_RULES_DATA_OFF + quint32(protosCount * sizeof(FORT_CONF_RULE_PROTO));
+    const quint32 listsOff = rangesOff + quint32(ranges.size() * sizeof(FORT_CONF_RULE_RANGE));
+    const quint32 rulesOff =
+            listsOff + FORT_CONF_STR_DATA_SIZE(quint32(lists.size() * sizeof(quint16)));
+    const quint32 extraOff = rulesOff + quint32(rulesCount * sizeof(FORT_CONF_RULE));
+
+    for (FORT_CONF_RULE &confRule : ruleArray) {
+        confRule.local_ports_off += (confRule.local_ports_n != 0) ? extraOff : 0;
+        confRule.local_addr_off += (confRule.local_addr_off != 0) ? extraOff : 0;
+        confRule.remote_addr_off += (confRule.remote_addr_off != 0) ? extraOff : 0;
+    }
+
+    rulesData.fill('\0', extraOff);
+
+    PFORT_CONF_RULES confRules = (PFORT_CONF_RULES) rulesData.data();
+    confRules->rules_n = quint16(rulesCount);
+    confRules->protos_n = quint16(protosCount);
+    confRules->locals_n = quint16(localsCount);
+    confRules->ranges_off = rangesOff;
+    confRules->lists_off = listsOff;
+    confRules->rules_off = rulesOff;
+
+    char *data = rulesData.data() + FORT_CONF_RULES_DATA_OFF;
+    writeData(&data, confProtos.constData(), protosCount, sizeof(FORT_CONF_RULE_PROTO));
+    writeData(&data, ranges.constData(), ranges.size(), sizeof(FORT_CONF_RULE_RANGE));
+    writeShorts(&data, lists);
+
+    data = rulesData.data() + rulesOff;
+    writeData(&data, ruleArray.constData(), rulesCount, sizeof(FORT_CONF_RULE));
+
+    if (rulesCount != 0) {
+        rulesData.append(rulesExtra);
+    }
+
+    return true;
+}
+
+bool ConfUtil::parseRulePorts(const QString &text, ruleports_arr_t &ports)
+{
+    static const QRegularExpression sepRe("[\\s,;]+");
+
+    const QStringList list = text.split(sepRe, Qt::SkipEmptyParts);
+
+    for (const QString &s : list) {
+        const int sepIndex = s.indexOf('-');
+
+        bool okFrom = false;
+        bool okTo = true;
+
+        const uint from = (sepIndex < 0 ? s : s.left(sepIndex)).toUInt(&okFrom);
+        const uint to = (sepIndex < 0) ? from : s.mid(sepIndex + 1).toUInt(&okTo);
+
+        if (!okFrom || !okTo || from > to || to > FORT_CONF_RULE_PORT_MAX)
+            return false;
+
+        ports.append({ quint16(from), quint16(to) });
+    }
+
+    std::sort(ports.begin(), ports.end(),
+            [](const FORT_CONF_RULE_PORTS &l, const FORT_CONF_RULE_PORTS &r) {
+                return l.from < r.from;
+            });
+
+    // Merge the colliding ranges
+    int n = 0;
+    for (const FORT_CONF_RULE_PORTS &port : std::as_const(ports)) {
+        if (n > 0 && quint32(port.from) <= quint32(ports[n - 1].to) + 1) {
+            ports[n - 1].to = std::max(ports[n - 1].to, port.to);
+        } else {
+            ports[n++] = port;
+        }
+    }
+    ports.resize(n);
+
+    return true;
+}
+
+bool ConfUtil::parseLogFilters(const QString &text, logfilters_arr_t &filters)
+{
+    const QStringList lines = text.split('\n');
+
+    for (const QString &line : lines) {
+        const QString filterLine = line.section('#', 0, 0).trimmed();
+        if (filterLine.isEmpty())
+            continue;
+
+        if (filters.size() >= FORT_CONF_LOG_FILTERS_MAX) {
+            setErrorMessage(tr("Too many log filters"));
+            return false;
+        }
+
+        FORT_CONF_LOG_FILTER filter;
+        if (!parseLogFilterLine(filterLine, filter)) {
+            setErrorMessage(tr("Bad log filter: %1").arg(filterLine));
+            return false;
+        }
+
+        filters.append(filter);
+    }
+
+    return true;
+}
+
+bool ConfUtil::parseUdpLightPorts(const QString &text, ruleports_arr_t &ports)
+{
+    if (!parseRulePorts(text, ports)) {
+        setErrorMessage(tr("Bad light UDP flows' ports: %1").arg(text));
+        return false;
+    }
+
+    if (ports.size() > FORT_CONF_UDP_LIGHT_PORTS_MAX) {
+        setErrorMessage(tr("Too many light UDP flows' ports"));
+        return false;
+    }
+
+    return true;
 }
 
-bool ConfUtil::loadZone(const QByteArray &buf, IpRange &ipRange)
+bool ConfUtil::parseLogFilterLine(const QString &line, FORT_CONF_LOG_FILTER &filter)
 {
-    const char *data = buf.data();
-    uint bufSize = buf.size();
+    static const QRegularExpression sepRe("\\s+");
+
+    filter = {};
+    filter.inbound = true;
+    filter.outbound = true;
+    filter.local_ports = { 0, FORT_CONF_RULE_PORT_MAX };
+    filter.remote_ports = { 0, FORT_CONF_RULE_PORT_MAX };
+
+    const QStringList tokens = line.split(sepRe, Qt::SkipEmptyParts);
+
+    for (const QString &token : tokens) {
+        const QString key = token.section('=', 0, 0).toLower();
+        const QString value = token.section('=', 1).toLower();
+
+        if (key == "proto") {
+            if (value == "tcp") {
+                filter.ip_proto = 6; // TCP
+            } else if (value == "udp") {
+                filter.ip_proto = 17; // UDP
+            } else {
+                bool ok;
+                const uint ipProto = value.toUInt(&ok);
+                if (!ok || ipProto == 0 || ipProto > 0xFF)
+                    return false;
+
+                filter.ip_proto = quint8(ipProto);
+            }
+        } else if (key == "dir") {
+            if (value != "in" && value != "out")
+                return false;
+
+            filter.inbound = (value == "in");
+            filter.outbound = (value == "out");
+        } else if (key == "local_port") {
+            if (!parseLogFilterPorts(value, filter.local_ports))
+                return false;
+        } else if (key == "remote_port") {
+            if (!parseLogFilterPorts(value, filter.remote_ports))
+                return false;
+        } else if (key == "addr") {
+            for (const QString &addrClass : value.split(',', Qt::SkipEmptyParts)) {
+                if (addrClass == "broadcast") {
+                    filter.addr_classes |= FORT_LOG_FILTER_ADDR_BROADCAST;
+                } else if (addrClass == "multicast") {
+                    filter.addr_classes |= FORT_LOG_FILTER_ADDR_MULTICAST;
+                } else if (addrClass == "link_local") {
+                    filter.addr_classes |= FORT_LOG_FILTER_ADDR_LINK_LOCAL;
+                } else {
+                    return false;
+                }
+            }
+        } else {
+            return false;
+        }
+    }
 
-    return loadAddressList(&data, ipRange, bufSize);
+    return true;
 }
 
-bool ConfUtil::parseAddressGroups(const QList<AddressGroup *> &addressGroups,
-        addrranges_arr_t &addressRanges, longs_arr_t &addressGroupOffsets,
-        quint32 &addressGroupsSize)
+bool ConfUtil::parseLogFilterPorts(const QString &text, FORT_CONF_RULE_PORTS &ports)
 {
-    const int groupsCount = addressGroups.size();
-
-    addressGroupsSize = quint32(groupsCount) * sizeof(quint32); // offsets
-
-    for (int i = 0; i < groupsCount; ++i) {
-        AddressGroup *addressGroup = addressGroups.at(i);
+    ruleports_arr_t portsList;
+    if (!parseRulePorts(text, portsList) || portsList.size() != 1)
+        return false;
 
-        AddressRange &addressRange = addressRanges[i];
-        addressRange.setIncludeAll(addressGroup->includeAll());
-        addressRange.setExcludeAll(addressGroup->excludeAll());
-        addressRange.setIncludeZones(addressGroup->includeZones());
-        addressRange.setExcludeZones(addressGroup->excludeZones());
+    ports = portsList.first();
 
-        if (!addressRange.includeRange().fromText(addressGroup->includeText())) {
-            setErrorMessage(
-                    tr("Bad Include IP address: #%1 %2")
-                            .arg(QString::number(i),
-                                    addressRange.includeRange().errorLineAndMessageDetails()));
-            return false;
-        }
+    return true;
+}
 
-        if (!addressRange.excludeRange().fromText(addressGroup->excludeText())) {
-            setErrorMessage(
-                    tr("Bad Exclude IP address: #%1 %2")
-                            .arg(QString::number(i),
-                                    addressRange.excludeRange().errorLineAndMessageDetails()));
-            return false;
-        }
+void ConfUtil::writeRuleAddrGroup(
+        QByteArray &data, const AddressRange &addressRange, quint32 &addrOff)
+{
+    const IpRange &incRange = addressRange.includeRange();
+    const IpRange &excRange = addressRange.excludeRange();
 
-        const IpRange &incRange = addressRange.includeRange();
-        const IpRange &excRange = addressRange.excludeRange();
+    if (incRange.isEmpty()) {
+        addrOff = 0; // any address
+        return;
+    }
 
-        if (!(checkIpRangeSize(incRange) && checkIpRangeSize(excRange))) {
-            setErrorMessage(tr("Too many IP addresses"));
-            return false;
-        }
+    const int off = data.size();
+    const int size =
+            FORT_CONF_ADDR_GROUP_OFF + addressListSize(incRange) + addressListSize(excRange);
 
-        addressGroupOffsets.append(addressGroupsSize);
+    data.resize(off + size);
 
-        addressGroupsSize += FORT_CONF_ADDR_GROUP_OFF
-                + FORT_CONF_ADDR_LIST_SIZE(incRange.ip4Size(), incRange.pair4Size(),
-                        incRange.ip6Size(), incRange.pair6Size())
-                + FORT_CONF_ADDR_LIST_SIZE(excRange.ip4Size(), excRange.pair4Size(),
-                        excRange.ip6Size(), excRange.pair6Size());
-    }
+    char *p = data.data() + off;
+    writeAddressRange(&p, addressRange);
 
-    return true;
+    addrOff = quint32(off);
 }
 
 bool ConfUtil::parseAppGroups(EnvManager &envManager, const QList<AppGroup *> &appGroups,
@@ -400,7 +1291,7 @@ bool ConfUtil::parseExeApps(
         if (app.isWildcard) {
             return parseAppsText(envManager, app, opt);
         } else {
-            return addApp(app, /*isNew=*/true, opt.exeAppsMap, opt.exeAppsSize);
+            return addApp(app, /*isNew=*/true, opt.exeApps, opt.exeAppsSize);
         }
     });
 }
@@ -408,6 +1299,31 @@ bool ConfUtil::parseExeApps(
 bool ConfUtil::parseAppsText(EnvManager &envManager, App &app, AppParseOptions &opt)
 {
     const auto text = envManager.expandString(app.appOriginPath);
+    if (text.isEmpty())
+        return true;
+
+    const apptextlines_arr_t lines = parseAppsTextLines(text);
+
+    for (const AppTextLine &line : lines) {
+        if (!parseAppLine(app, line, opt))
+            return false;
+    }
+
+    return true;
+}
+
+apptextlines_arr_t ConfUtil::parseAppsTextLines(const QString &text)
+{
+    if (m_appsTextCache) {
+        const auto it = m_appsTextCache->constFind(text);
+        if (it != m_appsTextCache->constEnd()) {
+            m_usedAppsTexts.insert(text, it.value());
+            return it.value();
+        }
+    }
+
+    apptextlines_arr_t appLines;
+
     const auto lines = StringUtil::tokenizeView(text, QLatin1Char('\n'));
 
     for (const auto &line : lines) {
@@ -415,44 +1331,43 @@ bool ConfUtil::parseAppsText(EnvManager &envManager, App &app, AppParseOptions &
         if (lineTrimmed.isEmpty() || lineTrimmed.startsWith('#')) // commented line
             continue;
 
-        if (!parseAppLine(app, lineTrimmed, opt))
-            return false;
+        AppTextLine appLine;
+        appLine.appPath = parseAppPath(lineTrimmed, appLine.isWild, appLine.isPrefix);
+        if (appLine.appPath.isEmpty())
+            continue;
+
+        appLines.append(appLine);
     }
 
-    return true;
+    if (m_appsTextCache) {
+        m_usedAppsTexts.insert(text, appLines);
+    }
+
+    return appLines;
 }
 
-bool ConfUtil::parseAppLine(App &app, const StringView &line, AppParseOptions &opt)
+bool ConfUtil::parseAppLine(App &app, const AppTextLine &line, AppParseOptions &opt)
 {
-    bool isWild = false;
-    bool isPrefix = false;
-    const QString appPath = parseAppPath(line, isWild, isPrefix);
-    if (appPath.isEmpty())
-        return true;
-
-    app.appPath = appPath;
+    app.appPath = line.appPath;
     app.useGroupPerm = true;
     app.alerted = false;
 
-    if (isWild || isPrefix) {
+    if (line.isWild || line.isPrefix) {
         if (app.isProcWild()) {
             opt.procWild = true;
         }
     }
 
-    appentry_map_t &appsMap = opt.appsMap(isWild, isPrefix);
-    quint32 &appsSize = opt.appsSize(isWild, isPrefix);
+    appentry_arr_t &apps = opt.apps(line.isWild, line.isPrefix);
+    quint32 &appsSize = opt.appsSize(line.isWild, line.isPrefix);
 
-    return addApp(app, /*isNew=*/true, appsMap, appsSize);
+    return addApp(app, /*isNew=*/true, apps, appsSize);
 }
 
-bool ConfUtil::addApp(const App &app, bool isNew, appentry_map_t &appsMap, quint32 &appsSize)
+bool ConfUtil::addApp(const App &app, bool isNew, appentry_arr_t &apps, quint32 &appsSize)
 {
     const QString kernelPath = FileUtil::pathToKernelPath(app.appPath);
 
-    if (appsMap.contains(kernelPath))
-        return true;
-
     if (kernelPath.size() > APP_PATH_MAX) {
         setErrorMessage(tr("Length of Application's Path must be < %1").arg(APP_PATH_MAX));
         return false;
@@ -481,15 +1396,68 @@ bool ConfUtil::addApp(const App &app, bool isNew, appentry_map_t &appsMap, quint
         .path_len = appPathLen,
         .accept_zones = quint16(app.acceptZones),
         .reject_zones = quint16(app.rejectZones),
+        .app_id = app.isWildcard ? 0 : quint32(app.appId), // the wildcard's paths differ
     };
 
-    appsMap.insert(kernelPath, appEntry);
+    // The duplicate paths are removed by AppParseOptions::sortApps()
+    apps.append({ kernelPath, appEntry });
 
     m_driveMask |= FileUtil::driveMaskByPath(app.appPath);
 
     return true;
 }
 
+void ConfUtil::parseExeFileIds(AppParseOptions &opt)
+{
+    static_assert(sizeof(FORT_FILE_ID) == 24, "FORT_FILE_ID size mismatch");
+
+    const int appsCount = opt.exeApps.size();
+
+    for (int i = 0; i < appsCount; ++i) {
+        const AppEntry &app = opt.exeApps[i];
+
+        // The apps' files may be absent yet
+        const QByteArray fileId = FileUtil::fileId(FileUtil::kernelPathToPath(app.path));
+        if (fileId.size() != sizeof(FORT_FILE_ID))
+            continue;
+
+        FORT_CONF_FILE_ID_APP fileIdApp;
+        memcpy(&fileIdApp.file_id, fileId.constData(), sizeof(FORT_FILE_ID));
+        fileIdApp.app_index = quint32(i);
+
+        opt.exeFileIds.append(fileIdApp);
+    }
+
+    const auto fileIdCmp = [](const FORT_CONF_FILE_ID_APP &l, const FORT_CONF_FILE_ID_APP &r) {
+        const auto lId = (const PFORT_FILE_ID) &l.file_id;
+        const auto rId = (const PFORT_FILE_ID) &r.file_id;
+        return fort_conf_file_id_cmp(lId, rId);
+    };
+
+    // The same order, as of the driver's binary search
+    std::sort(opt.exeFileIds.begin(), opt.exeFileIds.end(),
+            [&](const FORT_CONF_FILE_ID_APP &l, const FORT_CONF_FILE_ID_APP &r) {
+                return fileIdCmp(l, r) < 0;
+            });
+
+    // The hard links of different apps share the file id, so only their paths are matched
+    int n = 0;
+    for (int i = 0; i < opt.exeFileIds.size();) {
+        int j = i + 1;
+        while (j < opt.exeFileIds.size() && fileIdCmp(opt.exeFileIds[i], opt.exeFileIds[j]) == 0) {
+            ++j;
+        }
+
+        if (j == i + 1) {
+            opt.exeFileIds[n++] = opt.exeFileIds[i];
+        }
+
+        i = j;
+    }
+
+    opt.exeFileIds.resize(n);
+}
+
 QString ConfUtil::parseAppPath(const StringView line, bool &isWild, bool &isPrefix)
 {
     static const QRegularExpression wildMatcher("([*?[])");
@@ -541,14 +1509,17 @@ void ConfUtil::parseAppPeriod(
 
 void ConfUtil::writeConf(char *output, const FirewallConf &conf,
         const addrranges_arr_t &addressRanges, const longs_arr_t &addressGroupOffsets,
-        const chars_arr_t &appPeriods, quint8 appPeriodsCount, AppParseOptions &opt)
+        const chars_arr_t &appPeriods, quint8 appPeriodsCount, const QByteArray &rulesData,
+        const logfilters_arr_t &logFilters, const ruleports_arr_t &udpLightPorts,
+        AppParseOptions &opt)
 {
     PFORT_CONF_IO drvConfIo = (PFORT_CONF_IO) output;
     PFORT_CONF drvConf = &drvConfIo->conf;
     char *data = drvConf->data;
     quint32 addrGroupsOff;
     quint32 appPeriodsOff;
-    quint32 wildAppsOff, prefixAppsOff, exeAppsOff;
+    quint32 rulesOff;
+    quint32 wildAppsOff, prefixAppsOff, exeAppsOff, exeHashesOff, fileIdAppsOff;
 
 #define CONF_DATA_OFFSET quint32(data - drvConf->data)
     addrGroupsOff = CONF_DATA_OFFSET;
@@ -558,18 +1529,30 @@ void ConfUtil::writeConf(char *output, const FirewallConf &conf,
     appPeriodsOff = CONF_DATA_OFFSET;
     writeChars(&data, appPeriods);
 
+    rulesOff = CONF_DATA_OFFSET;
+    writeArray(&data, rulesData);
+
     wildAppsOff = CONF_DATA_OFFSET;
-    writeApps(&data, opt.wildAppsMap);
+    writeArray(&data, opt.wildMatcher);
+    writeApps(&data, opt.wildApps);
 
     prefixAppsOff = CONF_DATA_OFFSET;
-    writeApps(&data, opt.prefixAppsMap, /*useHeader=*/true);
+    writeArray(&data, opt.prefixTrie);
+    writeApps(&data, opt.prefixApps);
 
     exeAppsOff = CONF_DATA_OFFSET;
-    writeApps(&data, opt.exeAppsMap);
+    writeApps(&data, opt.exeApps);
+
+    exeHashesOff = CONF_DATA_OFFSET;
+    writeAppHashes(&data, opt.exeApps);
+
+    fileIdAppsOff = CONF_DATA_OFFSET;
+    writeData(&data, opt.exeFileIds.constData(), opt.exeFileIds.size(),
+            sizeof(FORT_CONF_FILE_ID_APP));
 #undef CONF_DATA_OFFSET
 
     writeAppGroupFlags(&drvConfIo->conf_group.group_bits, &drvConfIo->conf_group.log_blocked,
-            &drvConfIo->conf_group.log_conn, conf);
+            &drvConfIo->conf_group.log_conn, &drvConfIo->conf_group.stat_off_bits, conf);
 
     writeLimits(drvConfIo->conf_group.limits, &drvConfIo->conf_group.limit_bits,
             &drvConfIo->conf_group.limit_io_bits, conf.appGroups());
@@ -581,26 +1564,85 @@ void ConfUtil::writeConf(char *output, const FirewallConf &conf,
     drvConf->app_periods_n = appPeriodsCount;
 
     drvConf->proc_wild = opt.procWild;
+    drvConf->quota_block_inet = conf.ini().quotaBlockInetTraffic();
+    drvConf->addr_prov_filters = conf.ini().addrProvFilters();
+    drvConf->zones_node_replicas = conf.ini().zonesNodeReplicas();
+
+    drvConf->wild_apps_n = quint16(opt.wildApps.size());
+    drvConf->prefix_apps_n = quint16(opt.prefixApps.size());
+    drvConf->exe_apps_n = quint16(opt.exeApps.size());
+    drvConf->file_id_apps_n = quint16(opt.exeFileIds.size());
+
+    drvConf->proc_pending_packets_max = quint16(conf.ini().progAskPacketsMax());
+    drvConf->proc_pending_timeout = quint16(qBound(0, conf.ini().progAskTimeout(), 0xFFFF));
+    drvConf->proc_pending_allow = conf.ini().progAskTimeoutAllow();
 
-    drvConf->wild_apps_n = quint16(opt.wildAppsMap.size());
-    drvConf->prefix_apps_n = quint16(opt.prefixAppsMap.size());
-    drvConf->exe_apps_n = quint16(opt.exeAppsMap.size());
+    drvConf->log_buffer_limit = quint16(conf.ini().logDriverBufferLimit());
+    drvConf->mem_limit = quint16(conf.ini().driverMemLimit());
+
+    drvConf->log_allowed_ip_first = quint8(qBound(0, conf.ini().allowedIpSampleFirst(), 255));
+    drvConf->log_allowed_ip_rate = quint8(qBound(0, conf.ini().allowedIpSampleRate(), 255));
+
+    drvConf->accept_rate_limit = quint16(qBound(0, conf.ini().acceptRateLimit(), 0xFFFF));
+
+    drvConf->log_filters_n = quint8(logFilters.size());
+    std::copy(logFilters.constBegin(), logFilters.constEnd(), drvConf->log_filters);
+
+    drvConf->udp_light_ports_n = quint8(udpLightPorts.size());
+    std::copy(udpLightPorts.constBegin(), udpLightPorts.constEnd(), drvConf->udp_light_ports);
+
+    drvConf->quota_day_mb = quint32(conf.ini().quotaDayMb());
+    drvConf->quota_month_mb = quint32(conf.ini().quotaMonthMb());
 
     drvConf->addr_groups_off = addrGroupsOff;
 
     drvConf->app_periods_off = appPeriodsOff;
 
+    drvConf->rules_off = rulesOff;
+
     drvConf->wild_apps_off = wildAppsOff;
     drvConf->prefix_apps_off = prefixAppsOff;
     drvConf->exe_apps_off = exeAppsOff;
+    drvConf->exe_hashes_off = exeHashesOff;
+    drvConf->file_id_apps_off = fileIdAppsOff;
+}
+
+void ConfUtil::writePatchSections(const FirewallConf &conf,
+        const addrranges_arr_t &addressRanges, const longs_arr_t &addressGroupOffsets,
+        quint32 addressGroupsSize, const chars_arr_t &appPeriods, quint8 appPeriodsCount,
+        ConfPatchSections &sections)
+{
+    char *data;
+
+    // Zero the paddings to compare the sections
+    sections.addressGroups.fill('\0', addressGroupsSize);
+    data = sections.addressGroups.data();
+    writeLongs(&data, addressGroupOffsets);
+    writeAddressRanges(&data, addressRanges);
+
+    sections.appPeriods.fill('\0', FORT_CONF_STR_DATA_SIZE(appPeriods.size()));
+    data = sections.appPeriods.data();
+    writeChars(&data, appPeriods);
+
+    sections.appPeriodsCount = appPeriodsCount;
+
+    sections.appGroups.fill('\0', sizeof(FORT_CONF_GROUP));
+    PFORT_CONF_GROUP confGroup = (PFORT_CONF_GROUP) sections.appGroups.data();
+
+    writeAppGroupFlags(&confGroup->group_bits, &confGroup->log_blocked, &confGroup->log_conn,
+            &confGroup->stat_off_bits, conf);
+
+    writeLimits(confGroup->limits, &confGroup->limit_bits, &confGroup->limit_io_bits,
+            conf.appGroups());
 }
 
-void ConfUtil::writeAppGroupFlags(
-        quint16 *groupBits, quint16 *logBlockedBits, quint16 *logConnBits, const FirewallConf &conf)
+void ConfUtil::writeAppGroupFlags(quint16 *groupBits, quint16 *logBlockedBits,
+        quint16 *logConnBits, quint16 *statOffBits, const FirewallConf &conf)
 {
     *groupBits = 0;
     *logBlockedBits = 0;
     *logConnBits = 0;
+    *statOffBits = 0;
 
     int i = 0;
     for (const AppGroup *appGroup : conf.appGroups()) {
@@ -613,6 +1655,9 @@ void ConfUtil::writeAppGroupFlags(
         if (appGroup->logConn()) {
             *logConnBits |= (1 << i);
         }
+        if (!appGroup->logStat()) {
+            *statOffBits |= (1 << i);
+        }
         ++i;
     }
 }
@@ -636,29 +1681,38 @@ void ConfUtil::writeLimits(struct fort_speed_limit *limits, quint16 *limitBits,
         if (isLimitIn || isLimitOut) {
             *limitBits |= (1 << i);
 
+            const quint16 limitFlags = (appGroup->limitFairQueue() ? FORT_SPEED_LIMIT_FQ : 0)
+                    | (appGroup->limitFairProcess() ? FORT_SPEED_LIMIT_FQ_PROC : 0)
+                    | (appGroup->limitEcn() ? FORT_SPEED_LIMIT_ECN : 0)
+                    | (appGroup->limitPacing() ? FORT_SPEED_LIMIT_PACING : 0);
+
             if (isLimitIn) {
                 *limitIoBits |= (1 << (i * 2 + 0));
 
                 writeLimit(&limits[0], limitIn, appGroup->limitBufferSizeIn(),
-                        appGroup->limitLatency(), appGroup->limitPacketLoss());
+                        appGroup->limitBurstSize(), appGroup->limitLatency(),
+                        appGroup->limitPacketLoss(), limitFlags);
             }
 
             if (isLimitOut) {
                 *limitIoBits |= (1 << (i * 2 + 1));
 
                 writeLimit(&limits[1], limitOut, appGroup->limitBufferSizeOut(),
-                        appGroup->limitLatency(), appGroup->limitPacketLoss());
+                        appGroup->limitBurstSize(), appGroup->limitLatency(),
+                        appGroup->limitPacketLoss(), limitFlags);
             }
         }
     }
 }
 
 void ConfUtil::writeLimit(fort_speed_limit *limit, quint32 kBits, quint32 bufferSize,
-        quint32 latencyMsec, quint16 packetLoss)
+        quint32 burstSize, quint32 latencyMsec, quint16 packetLoss, quint16 flags)
 {
     limit->plr = packetLoss;
+    limit->flags = flags;
     limit->latency_ms = latencyMsec;
     limit->buffer_bytes = bufferSize;
+    limit->burst_bytes = burstSize;
     limit->bps = kBits * (1024 / 8);
 }
 
@@ -691,6 +1745,31 @@ void ConfUtil::writeAddressRange(char **data, const AddressRange &addressRange)
     writeAddressList(data, addressRange.excludeRange());
 }
 
+quint8 ConfUtil::ip4IndexBits(const IpRange &ipRange)
+{
+    return DriverCommon::confIpIndexBits(ipRange.ip4Size(), ipRange.pair4Size());
+}
+
+quint8 ConfUtil::ip6IndexBits(const IpRange &ipRange)
+{
+    return DriverCommon::confIpIndexBits(ipRange.ip6Size(), ipRange.pair6Size());
+}
+
+int ConfUtil::addressListSize(const IpRange &ipRange)
+{
+    if (isIp4Packed(ipRange)) {
+        quint32 count, dataSize;
+        packedIp4Size(ipRange, count, dataSize);
+
+        return FORT_CONF_ADDR4_PACKED_SIZE(count, dataSize)
+                + FORT_CONF_ADDR6_LIST_SIZE(
+                        ipRange.ip6Size(), ipRange.pair6Size(), ip6IndexBits(ipRange));
+    }
+
+    return FORT_CONF_ADDR_LIST_SIZE(ipRange.ip4Size(), ipRange.pair4Size(), ip4IndexBits(ipRange),
+            ipRange.ip6Size(), ipRange.pair6Size(), ip6IndexBits(ipRange));
+}
+
 void ConfUtil::writeAddressList(char **data, const IpRange &ipRange)
 {
     writeAddress4List(data, ipRange);
@@ -699,9 +1778,18 @@ void ConfUtil::writeAddressList(char **data, const IpRange &ipRange)
 
 void ConfUtil::writeAddress4List(char **data, const IpRange &ipRange)
 {
+    if (isIp4Packed(ipRange)) {
+        writeAddress4Packed(data, ipRange);
+        return;
+    }
+
     PFORT_CONF_ADDR4_LIST addrList = PFORT_CONF_ADDR4_LIST(*data);
 
+    const quint8 indexBits = ip4IndexBits(ipRange);
+
     addrList->ip_n = quint32(ipRange.ip4Size());
+    addrList->index_bits = indexBits;
+    addrList->is_packed = false;
     addrList->pair_n = quint32(ipRange.pair4Size());
 
     *data += FORT_CONF_ADDR4_LIST_OFF;
@@ -709,13 +1797,87 @@ void ConfUtil::writeAddress4List(char **data, const IpRange &ipRange)
     writeLongs(data, ipRange.ip4Array());
     writeLongs(data, ipRange.pair4FromArray());
     writeLongs(data, ipRange.pair4ToArray());
+
+    if (indexBits != 0) {
+        writeIp4Index(data, ipRange.ip4Array(), indexBits);
+        writeIp4Index(data, ipRange.pair4FromArray(), indexBits);
+    }
+}
+
+void ConfUtil::writeAddress4Packed(char **data, const IpRange &ipRange)
+{
+    PFORT_CONF_ADDR4_LIST addrList = PFORT_CONF_ADDR4_LIST(*data);
+
+    quint32 count, dataSize;
+    packedIp4Size(ipRange, count, dataSize);
+
+    addrList->ip_n = count;
+    addrList->index_bits = 0;
+    addrList->is_packed = true;
+    addrList->pair_n = dataSize;
+
+    const quint32 blocksCount = FORT_CONF_IP_BLOCKS_N(count);
+
+    quint32 *blockIps = addrList->ip;
+    quint32 *blockOffs = blockIps + blocksCount;
+    quint8 *blocksData = (quint8 *) (blockOffs + blocksCount + 1);
+
+    quint8 *p = blocksData;
+    quint32 prevTo = 0;
+    quint32 i = 0;
+
+    walkIp4Ranges(ipRange, [&](const Ip4Pair &ip) {
+        const quint32 blockIndex = i / FORT_CONF_IP_BLOCK_N;
+
+        if ((i % FORT_CONF_IP_BLOCK_N) == 0) {
+            blockIps[blockIndex] = ip.from;
+            blockOffs[blockIndex] = quint32(p - blocksData);
+        } else {
+            writeVarint(&p, ip.from - prevTo);
+        }
+        writeVarint(&p, ip.to - ip.from);
+
+        prevTo = ip.to;
+        ++i;
+    });
+
+    blockOffs[blocksCount] = quint32(p - blocksData);
+
+    // Zero the alignment padding
+    memset(p, 0, blocksData + dataSize - p);
+
+    *data = (char *) (blocksData + dataSize);
+}
+
+void ConfUtil::writeIp4Index(char **data, const ip4_arr_t &array, quint8 indexBits)
+{
+    // Index of the first address for each bucket of high address bits
+    quint32 *ipIndex = (quint32 *) *data;
+
+    const int shift = 32 - indexBits;
+    const quint32 bucketsCount = (quint32(1) << indexBits);
+    const int count = array.size();
+
+    int i = 0;
+    for (quint32 bucket = 0; bucket <= bucketsCount; ++bucket) {
+        while (i < count && (array.at(i) >> shift) < bucket) {
+            ++i;
+        }
+        *ipIndex++ = quint32(i);
+    }
+
+    *data = (char *) ipIndex;
 }
 
 void ConfUtil::writeAddress6List(char **data, const IpRange &ipRange)
 {
     PFORT_CONF_ADDR6_LIST addrList = PFORT_CONF_ADDR6_LIST(*data);
 
+    const quint8 indexBits = ip6IndexBits(ipRange);
+
     addrList->ip_n = quint32(ipRange.ip6Size());
+    addrList->index_bits = indexBits;
+    addrList->is_ip_u64 = true;
     addrList->pair_n = quint32(ipRange.pair6Size());
 
     *data += FORT_CONF_ADDR6_LIST_OFF;
@@ -723,6 +1885,34 @@ void ConfUtil::writeAddress6List(char **data, const IpRange &ipRange)
     writeIp6Array(data, ipRange.ip6Array());
     writeIp6Array(data, ipRange.pair6FromArray());
     writeIp6Array(data, ipRange.pair6ToArray());
+
+    if (indexBits != 0) {
+        const FORT_CONF_IP6 *ipArray = (const FORT_CONF_IP6 *) addrList->ip;
+        const FORT_CONF_IP6 *pairFromArray = ipArray + addrList->ip_n;
+
+        writeIp6Index(data, ipArray, addrList->ip_n, indexBits);
+        writeIp6Index(data, pairFromArray, addrList->pair_n, indexBits);
+    }
+}
+
+void ConfUtil::writeIp6Index(
+        char **data, const FORT_CONF_IP6 *array, quint32 count, quint8 indexBits)
+{
+    // Index of the first address for each bucket of high address bits
+    quint32 *ipIndex = (quint32 *) *data;
+
+    const int shift = 64 - indexBits;
+    const quint32 bucketsCount = (quint32(1) << indexBits);
+
+    quint32 i = 0;
+    for (quint32 bucket = 0; bucket <= bucketsCount; ++bucket) {
+        while (i < count && (array[i].hi >> shift) < bucket) {
+            ++i;
+        }
+        *ipIndex++ = i;
+    }
+
+    *data = (char *) ipIndex;
 }
 
 bool ConfUtil::loadAddressList(const char **data, IpRange &ipRange, uint &bufSize)
@@ -739,12 +1929,19 @@ bool ConfUtil::loadAddress4List(const char **data, IpRange &ipRange, uint &bufSi
     PFORT_CONF_ADDR4_LIST addr_list = (PFORT_CONF_ADDR4_LIST) *data;
     *data = (const char *) addr_list->ip;
 
-    const uint addrListSize = FORT_CONF_ADDR4_LIST_SIZE(addr_list->ip_n, addr_list->pair_n);
+    const uint addrListSize = FORT_CONF_ADDR4_LIST_REF_SIZE(addr_list);
     if (bufSize < addrListSize)
         return false;
 
     bufSize -= addrListSize;
 
+    if (addr_list->is_packed) {
+        loadAddress4Packed(addr_list, ipRange);
+
+        *data = (const char *) addr_list + addrListSize;
+        return true;
+    }
+
     ipRange.ip4Array().resize(addr_list->ip_n);
     ipRange.pair4FromArray().resize(addr_list->pair_n);
     ipRange.pair4ToArray().resize(addr_list->pair_n);
@@ -753,9 +1950,43 @@ bool ConfUtil::loadAddress4List(const char **data, IpRange &ipRange, uint &bufSi
     loadLongs(data, ipRange.pair4FromArray());
     loadLongs(data, ipRange.pair4ToArray());
 
+    *data += FORT_CONF_IP_INDEX_SIZE(addr_list->index_bits);
+
     return true;
 }
 
+void ConfUtil::loadAddress4Packed(const PFORT_CONF_ADDR4_LIST addrList, IpRange &ipRange)
+{
+    const quint32 count = addrList->ip_n;
+    const quint32 blocksCount = FORT_CONF_IP_BLOCKS_N(count);
+
+    const quint32 *blockIps = addrList->ip;
+    const quint32 *blockOffs = blockIps + blocksCount;
+    const quint8 *blocksData = (const quint8 *) (blockOffs + blocksCount + 1);
+
+    ipRange.ip4Array().clear();
+    ipRange.pair4FromArray().clear();
+    ipRange.pair4ToArray().clear();
+
+    const quint8 *p = blocksData;
+    quint32 to = 0;
+
+    for (quint32 i = 0; i < count; ++i) {
+        const quint32 from = ((i % FORT_CONF_IP_BLOCK_N) == 0)
+                ? blockIps[i / FORT_CONF_IP_BLOCK_N]
+                : to + readVarint(&p);
+
+        to = from + readVarint(&p);
+
+        if (from == to) {
+            ipRange.ip4Array().append(from);
+        } else {
+            ipRange.pair4FromArray().append(from);
+            ipRange.pair4ToArray().append(to);
+        }
+    }
+}
+
 bool ConfUtil::loadAddress6List(const char **data, IpRange &ipRange, uint &bufSize)
 {
     if (bufSize < FORT_CONF_ADDR6_LIST_OFF)
@@ -764,7 +1995,8 @@ bool ConfUtil::loadAddress6List(const char **data, IpRange &ipRange, uint &bufSi
     PFORT_CONF_ADDR6_LIST addr_list = (PFORT_CONF_ADDR6_LIST) *data;
     *data = (const char *) addr_list->ip;
 
-    const uint addrListSize = FORT_CONF_ADDR6_LIST_SIZE(addr_list->ip_n, addr_list->pair_n);
+    const uint addrListSize =
+            FORT_CONF_ADDR6_LIST_SIZE(addr_list->ip_n, addr_list->pair_n, addr_list->index_bits);
     if (bufSize < addrListSize)
         return false;
 
@@ -774,30 +2006,26 @@ bool ConfUtil::loadAddress6List(const char **data, IpRange &ipRange, uint &bufSi
     ipRange.pair6FromArray().resize(addr_list->pair_n);
     ipRange.pair6ToArray().resize(addr_list->pair_n);
 
-    loadIp6Array(data, ipRange.ip6Array());
-    loadIp6Array(data, ipRange.pair6FromArray());
-    loadIp6Array(data, ipRange.pair6ToArray());
+    const bool isIpU64 = addr_list->is_ip_u64;
+
+    loadIp6Array(data, ipRange.ip6Array(), isIpU64);
+    loadIp6Array(data, ipRange.pair6FromArray(), isIpU64);
+    loadIp6Array(data, ipRange.pair6ToArray(), isIpU64);
+
+    *data += FORT_CONF_IP_INDEX_SIZE(addr_list->index_bits);
 
     return true;
 }
 
-void ConfUtil::writeApps(char **data, const appentry_map_t &appsMap, bool useHeader)
+void ConfUtil::writeApps(char **data, const appentry_arr_t &apps)
 {
-    quint32 *offp = (quint32 *) *data;
-    const quint32 offTableSize = quint32(useHeader ? FORT_CONF_STR_HEADER_SIZE(appsMap.size()) : 0);
-    char *p = *data + offTableSize;
+    char *p = *data;
     quint32 off = 0;
 
-    if (useHeader) {
-        *offp++ = 0;
-    }
-
-    auto it = appsMap.constBegin();
-    const auto end = appsMap.constEnd();
-    for (; it != end; ++it) {
-        const QString &appPath = it.key();
+    for (const AppEntry &app : apps) {
+        const QString &appPath = app.path;
 
-        const FORT_APP_ENTRY &appEntry = it.value();
+        const FORT_APP_ENTRY &appEntry = app.entry;
 
         PFORT_APP_ENTRY entry = (PFORT_APP_ENTRY) p;
         *entry++ = appEntry;
@@ -809,13 +2037,128 @@ void ConfUtil::writeApps(char **data, const appentry_map_t &appsMap, bool useHea
         const quint32 appSize = FORT_CONF_APP_ENTRY_SIZE(appEntry.path_len);
 
         off += appSize;
-        if (useHeader) {
-            *offp++ = off;
-        }
         p += appSize;
     }
 
-    *data += offTableSize + FORT_CONF_STR_DATA_SIZE(off);
+    *data += FORT_CONF_STR_DATA_SIZE(off);
+}
+
+void ConfUtil::writeAppHashes(char **data, const appentry_arr_t &apps)
+{
+    quint32 *hashes = (quint32 *) *data;
+
+    for (const AppEntry &app : apps) {
+        *hashes++ = DriverCommon::confAppPathHash(app.path.utf16(), app.entry.path_len);
+    }
+
+    *data = (char *) hashes;
+}
+
+void ConfUtil::writeWildMatcher(QByteArray &buf, const appentry_arr_t &apps)
+{
+    static const QRegularExpression wildPrefixEnd("[*?[]");
+    static const QRegularExpression wildSuffixStart("[*?[\\]][^*?[\\]]*$");
+
+    if (apps.isEmpty())
+        return;
+
+    // Group the app entries by their literal prefixes
+    QMap<QString, QVector<FORT_CONF_WILD_ITEM>> prefixItems;
+
+    quint16 appIndex = 0;
+    quint32 appOff = 0;
+
+    for (const AppEntry &app : apps) {
+        const QString &appPath = app.path;
+
+        const int prefixSize = std::max(appPath.indexOf(wildPrefixEnd), 0);
+        const int suffixStart = std::max(appPath.indexOf(wildSuffixStart) + 1, prefixSize);
+
+        const FORT_CONF_WILD_ITEM item = {
+            .app_i = appIndex++,
+            .suffix_len = quint16((appPath.size() - suffixStart) * sizeof(wchar_t)),
+            .app_off = appOff,
+        };
+
+        prefixItems[appPath.left(prefixSize)].append(item);
+
+        appOff += FORT_CONF_APP_ENTRY_SIZE(app.entry.path_len);
+    }
+
+    const int bucketsCount = prefixItems.size();
+    const int itemsCount = apps.size();
+
+    buf.resize(FORT_CONF_WILD_MATCHER_SIZE(bucketsCount, itemsCount));
+
+    PFORT_CONF_WILD_MATCHER matcher = (PFORT_CONF_WILD_MATCHER) buf.data();
+    matcher->buckets_n = quint16(bucketsCount);
+    matcher->items_n = quint16(itemsCount);
+
+    PFORT_CONF_WILD_BUCKET bucket = (PFORT_CONF_WILD_BUCKET) matcher->data;
+    PFORT_CONF_WILD_ITEM item = (PFORT_CONF_WILD_ITEM) (bucket + bucketsCount);
+
+    // Sorted prefixes: the parents of a bucket are on the stack
+    QVector<QString> prefixStack;
+    shorts_arr_t parentStack;
+
+    quint16 bucketIndex = 0;
+    quint16 itemsIndex = 0;
+
+    auto pit = prefixItems.constBegin();
+    const auto pend = prefixItems.constEnd();
+    for (; pit != pend; ++pit, ++bucket, ++bucketIndex) {
+        const QString &prefix = pit.key();
+        const QVector<FORT_CONF_WILD_ITEM> &items = pit.value();
+
+        while (!prefixStack.isEmpty() && !prefix.startsWith(prefixStack.last())) {
+            prefixStack.removeLast();
+            parentStack.removeLast();
+        }
+
+        bucket->parent = parentStack.isEmpty() ? FORT_CONF_WILD_NONE : parentStack.last();
+        bucket->prefix_len = quint16(prefix.size() * sizeof(wchar_t));
+        bucket->items_i = itemsIndex;
+        bucket->items_n = quint16(items.size());
+
+        prefixStack.append(prefix);
+        parentStack.append(bucketIndex);
+
+        for (const FORT_CONF_WILD_ITEM &bucketItem : items) {
+            *item++ = bucketItem;
+        }
+        itemsIndex += quint16(items.size());
+    }
+}
+
+void ConfUtil::writePrefixTrie(QByteArray &buf, const appentry_arr_t &apps)
+{
+    if (apps.isEmpty())
+        return;
+
+    PrefixTrieKeys keys;
+    keys.paths.reserve(apps.size());
+    keys.appOffsets.reserve(apps.size());
+
+    quint32 appOff = 0;
+
+    for (const AppEntry &app : apps) {
+        keys.paths.append(app.path);
+        keys.appOffsets.append(appOff);
+
+        appOff += FORT_CONF_APP_ENTRY_SIZE(app.entry.path_len);
+    }
+
+    QVector<FORT_CONF_PREFIX_NODE> nodes(1);
+    writePrefixNodes(nodes, /*nodeIndex=*/0, keys, /*lo=*/0, /*hi=*/keys.paths.size(), /*depth=*/0,
+            /*end=*/0);
+
+    buf.resize(FORT_CONF_PREFIX_TRIE_SIZE(nodes.size()));
+
+    PFORT_CONF_PREFIX_TRIE trie = (PFORT_CONF_PREFIX_TRIE) buf.data();
+    trie->nodes_n = quint32(nodes.size());
+
+    char *data = trie->data;
+    writeData(&data, nodes.constData(), nodes.size(), sizeof(FORT_CONF_PREFIX_NODE));
 }
 
 void ConfUtil::writeShorts(char **data, const shorts_arr_t &array)
@@ -830,7 +2173,16 @@ void ConfUtil::writeLongs(char **data, const longs_arr_t &array)
 
 void ConfUtil::writeIp6Array(char **data, const ip6_arr_t &array)
 {
-    writeData(data, array.constData(), array.size(), sizeof(ip6_addr_t));
+    // Store addresses as comparable integers
+    PFORT_CONF_IP6 ip6 = (PFORT_CONF_IP6) *data;
+
+    for (const ip6_addr_t &ip : array) {
+        ip6->hi = qFromBigEndian<quint64>(ip.data);
+        ip6->lo = qFromBigEndian<quint64>(ip.data + 8);
+        ++ip6;
+    }
+
+    *data = (char *) ip6;
 }
 
 void ConfUtil::writeData(char **data, void const *src, int elemCount, uint elemSize)
@@ -865,9 +2217,22 @@ void ConfUtil::loadLongs(const char **data, longs_arr_t &array)
     loadData(data, array.data(), array.size(), sizeof(quint32));
 }
 
-void ConfUtil::loadIp6Array(const char **data, ip6_arr_t &array)
+void ConfUtil::loadIp6Array(const char **data, ip6_arr_t &array, bool isIpU64)
 {
-    loadData(data, array.data(), array.size(), sizeof(ip6_addr_t));
+    if (!isIpU64) {
+        loadData(data, array.data(), array.size(), sizeof(ip6_addr_t));
+        return;
+    }
+
+    const FORT_CONF_IP6 *ip6 = (const FORT_CONF_IP6 *) *data;
+
+    for (ip6_addr_t &ip : array) {
+        qToBigEndian<quint64>(ip6->hi, ip.data);
+        qToBigEndian<quint64>(ip6->lo, ip.data + 8);
+        ++ip6;
+    }
+
+    *data = (const char *) ip6;
 }
 
 void ConfUtil::loadData(const char **data, void *dst, int elemCount, uint elemSize)
@@ -16,10 +16,31 @@ class AppGroup;
 class ConfAppsWalker;
 class EnvManager;
 class FirewallConf;
+class PolicySet;
 
 using longs_arr_t = QVector<quint32>;
 using shorts_arr_t = QVector<quint16>;
 using chars_arr_t = QVector<qint8>;
+using ruleports_arr_t = QVector<FORT_CONF_RULE_PORTS>;
+using logfilters_arr_t = QVector<FORT_CONF_LOG_FILTER>;
+
+// Durations of the full conf write's phases
+struct ConfWriteTimes
+{
+    qint64 addressGroupsMsecs = 0;
+    qint64 appsMsecs = 0;
+    qint64 totalMsecs = 0;
+};
+
+// Driver conf sections, which can be patched without a full conf update
+struct ConfPatchSections
+{
+    quint8 appPeriodsCount = 0;
+
+    QByteArray addressGroups;
+    QByteArray appPeriods;
+    QByteArray appGroups;
+};
 
 class ConfUtil : public QObject
 {
@@ -31,10 +52,23 @@ public:
 
     quint32 driveMask() const { return m_driveMask; }
 
+    const ConfPatchSections &patchSections() const { return m_patchSections; }
+
+    const ConfWriteTimes &writeTimes() const { return m_writeTimes; }
+
+    // Rules are compiled from the policy set on full conf writes
+    void setPolicySet(const PolicySet *policySet) { m_policySet = policySet; }
+
+    // Apps texts are parsed once and reused by the next full conf writes
+    void setAppsTextCache(appstext_cache_t *cache) { m_appsTextCache = cache; }
+
     QString errorMessage() const { return m_errorMessage; }
 
     static int zoneMaxCount();
 
+    bool parseLogFilters(const QString &text, logfilters_arr_t &filters);
+    bool parseUdpLightPorts(const QString &text, ruleports_arr_t &ports);
+
 signals:
     void errorMessageChanged();
 
@@ -45,18 +79,28 @@ public slots:
     int write(const FirewallConf &conf, ConfAppsWalker *confAppsWalker, EnvManager &envManager,
             QByteArray &buf);
     int writeFlags(const FirewallConf &conf, QByteArray &buf);
+    int writePatch(const FirewallConf &conf, ConfPatchSections &sections, QByteArray &buf);
     int writeAppEntry(const App &app, bool isNew, QByteArray &buf);
+    int writeAppEntries(const QVector<App> &apps, bool isNew, QByteArray &buf);
     int writeZone(const IpRange &ipRange, QByteArray &buf);
     int writeZones(quint32 zonesMask, quint32 enabledMask, quint32 dataSize,
             const QList<QByteArray> &zonesData, QByteArray &buf);
     void migrateZoneData(char **data, const QByteArray &zoneData);
+    int writeZoneData(int zoneId, bool enabled, const QByteArray &zoneData, QByteArray &buf);
     int writeZoneFlag(int zoneId, bool enabled, QByteArray &buf);
 
     bool loadZone(const QByteArray &buf, IpRange &ipRange);
 
+    static QByteArray appsKey(const FirewallConf &conf);
+
 private:
     void setErrorMessage(const QString &errorMessage);
 
+    void parseZonesIndex(quint32 zonesMask, quint32 indexMask, const QList<QByteArray> &zonesData,
+            ip4_arr_t &fromArray, ip4_arr_t &toArray, longs_arr_t &maskArray);
+
+    static int migrateZoneDataSize(const QByteArray &zoneData);
+
     bool parseAddressGroups(const QList<AddressGroup *> &addressGroups,
             addrranges_arr_t &addressRanges, longs_arr_t &addressGroupOffsets,
             quint32 &addressGroupsSize);
@@ -69,39 +113,72 @@ private:
 
     bool parseAppsText(EnvManager &envManager, App &app, AppParseOptions &opt);
 
-    bool parseAppLine(App &app, const StringView &line, AppParseOptions &opt);
+    apptextlines_arr_t parseAppsTextLines(const QString &text);
+
+    bool parseAppLine(App &app, const AppTextLine &line, AppParseOptions &opt);
 
-    bool addApp(const App &app, bool isNew, appentry_map_t &appsMap, quint32 &appsSize);
+    bool addApp(const App &app, bool isNew, appentry_arr_t &apps, quint32 &appsSize);
+
+    static void parseExeFileIds(AppParseOptions &opt);
 
     static QString parseAppPath(const StringView line, bool &isWild, bool &isPrefix);
 
+    bool parseRules(QByteArray &rulesData);
+
+    static bool parseRulePorts(const QString &text, ruleports_arr_t &ports);
+
+    static bool parseLogFilterLine(const QString &line, FORT_CONF_LOG_FILTER &filter);
+    static bool parseLogFilterPorts(const QString &text, FORT_CONF_RULE_PORTS &ports);
+
+    static void writeRuleAddrGroup(
+            QByteArray &data, const AddressRange &addressRange, quint32 &addrOff);
+
     static void parseAppPeriod(
             const AppGroup *appGroup, chars_arr_t &appPeriods, quint8 &appPeriodsCount);
 
     static void writeConf(char *output, const FirewallConf &conf,
             const addrranges_arr_t &addressRanges, const longs_arr_t &addressGroupOffsets,
-            const chars_arr_t &appPeriods, quint8 appPeriodsCount, AppParseOptions &opt);
+            const chars_arr_t &appPeriods, quint8 appPeriodsCount, const QByteArray &rulesData,
+            const logfilters_arr_t &logFilters, const ruleports_arr_t &udpLightPorts,
+            AppParseOptions &opt);
+
+    static void writePatchSections(const FirewallConf &conf,
+            const addrranges_arr_t &addressRanges, const longs_arr_t &addressGroupOffsets,
+            quint32 addressGroupsSize, const chars_arr_t &appPeriods, quint8 appPeriodsCount,
+            ConfPatchSections &sections);
 
     static void writeAppGroupFlags(quint16 *groupBits, quint16 *logBlockedBits,
-            quint16 *logConnBits, const FirewallConf &conf);
+            quint16 *logConnBits, quint16 *statOffBits, const FirewallConf &conf);
 
     static void writeLimits(struct fort_speed_limit *limits, quint16 *limitBits,
             quint32 *limitIoBits, const QList<AppGroup *> &appGroups);
     static void writeLimit(struct fort_speed_limit *limit, quint32 kBits, quint32 bufferSize,
-            quint32 latencyMsec, quint16 packetLoss);
+            quint32 burstSize, quint32 latencyMsec, quint16 packetLoss, quint16 flags);
 
     static void writeAddressRanges(char **data, const addrranges_arr_t &addressRanges);
     static void writeAddressRange(char **data, const AddressRange &addressRange);
 
+    static quint8 ip4IndexBits(const IpRange &ipRange);
+    static quint8 ip6IndexBits(const IpRange &ipRange);
+    static int addressListSize(const IpRange &ipRange);
+
     static void writeAddressList(char **data, const IpRange &ipRange);
     static void writeAddress4List(char **data, const IpRange &ipRange);
+    static void writeAddress4Packed(char **data, const IpRange &ipRange);
     static void writeAddress6List(char **data, const IpRange &ipRange);
+    static void writeIp4Index(char **data, const ip4_arr_t &array, quint8 indexBits);
+    static void writeIp6Index(
+            char **data, const FORT_CONF_IP6 *array, quint32 count, quint8 indexBits);
 
     static bool loadAddressList(const char **data, IpRange &ipRange, uint &bufSize);
     static bool loadAddress4List(const char **data, IpRange &ipRange, uint &bufSize);
+    static void loadAddress4Packed(const PFORT_CONF_ADDR4_LIST addrList, IpRange &ipRange);
     static bool loadAddress6List(const char **data, IpRange &ipRange, uint &bufSize);
 
-    static void writeApps(char **data, const appentry_map_t &appsMap, bool useHeader = false);
+    static void writeApps(char **data, const appentry_arr_t &apps);
+    static void writeAppHashes(char **data, const appentry_arr_t &apps);
+    static void writeWildMatcher(QByteArray &buf, const appentry_arr_t &apps);
+    static void writePrefixTrie(QByteArray &buf, const appentry_arr_t &apps);
 
     static void writeShorts(char **data, const shorts_arr_t &array);
     static void writeLongs(char **data, const longs_arr_t &array);
@@ -111,12 +188,21 @@ private:
     static void writeArray(char **data, const QByteArray &array);
 
     static void loadLongs(const char **data, longs_arr_t &array);
-    static void loadIp6Array(const char **data, ip6_arr_t &array);
+    static void loadIp6Array(const char **data, ip6_arr_t &array, bool isIpU64);
     static void loadData(const char **data, void *dst, int elemCount, uint elemSize);
 
 private:
     quint32 m_driveMask = 0;
 
+    const PolicySet *m_policySet = nullptr;
+
+    appstext_cache_t *m_appsTextCache = nullptr;
+    appstext_cache_t m_usedAppsTexts;
+
+    ConfPatchSections m_patchSections;
+
+    ConfWriteTimes m_writeTimes;
+
     QString m_errorMessage;
 };
 
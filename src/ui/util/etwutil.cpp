@@ -0,0 +1,55 @@
+#include "etwutil.h"
+
+#define WIN32_LEAN_AND_MEAN
+#include <qt_windows.h>
+
+#include <TraceLoggingProvider.h>
+#include <winmeta.h>
+
+// FortFirewall.Service: 0307a431-20f6-55e6-cd74-0d3365436295
+TRACELOGGING_DEFINE_PROVIDER(g_etwProvider, "FortFirewall.Service",
+        (0x0307a431, 0x20f6, 0x55e6, 0xcd, 0x74, 0x0d, 0x33, 0x65, 0x43, 0x62, 0x95));
+
+// The events' arguments are evaluated only when a session listens for the provider
+#define ETW_WRITE(name, opcode, ...)                                                               \
+    TraceLoggingWrite(g_etwProvider, name, TraceLoggingLevel(WINEVENT_LEVEL_VERBOSE),              \
+            TraceLoggingOpcode(opcode), __VA_ARGS__)
+
+namespace {
+
+struct EtwProvider
+{
+    EtwProvider() { TraceLoggingRegister(g_etwProvider); }
+    ~EtwProvider() { TraceLoggingUnregister(g_etwProvider); }
+};
+
+const EtwProvider g_etwProviderRegistration;
+
+}
+
+void EtwUtil::logBufferStart(int size, bool isRawData)
+{
+    ETW_WRITE("LogBuffer", WINEVENT_OPCODE_START, TraceLoggingInt32(size, "Size"),
+            TraceLoggingBool(isRawData, "RawData"));
+}
+
+void EtwUtil::logBufferStop(int size)
+{
+    ETW_WRITE("LogBuffer", WINEVENT_OPCODE_STOP, TraceLoggingInt32(size, "Size"));
+}
+
+void EtwUtil::statTrafStart(int procCount)
+{
+    ETW_WRITE("StatTraf", WINEVENT_OPCODE_START, TraceLoggingInt32(procCount, "ProcCount"));
+}
+
+void EtwUtil::statTrafStop(quint64 inBytes, quint64 outBytes)
+{
+    ETW_WRITE("StatTraf", WINEVENT_OPCODE_STOP, TraceLoggingUInt64(inBytes, "InBytes"),
+            TraceLoggingUInt64(outBytes, "OutBytes"));
+}
+
+void EtwUtil::flowStat(int flowCount)
+{
+    ETW_WRITE("FlowStat", WINEVENT_OPCODE_INFO, TraceLoggingInt32(flowCount, "FlowCount"));
+}
@@ -0,0 +1,19 @@
+#ifndef ETWUTIL_H
+#define ETWUTIL_H
+
+#include <QtGlobal>
+
+// TraceLogging events of the service, to be captured with the driver's ones by WPR
+class EtwUtil
+{
+public:
+    static void logBufferStart(int size, bool isRawData);
+    static void logBufferStop(int size);
+
+    static void statTrafStart(int procCount);
+    static void statTrafStop(quint64 inBytes, quint64 outBytes);
+
+    static void flowStat(int flowCount);
+};
+
+#endif // ETWUTIL_H
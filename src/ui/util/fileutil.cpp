@@ -3,6 +3,7 @@
 #include <QCoreApplication>
 #include <QDir>
 #include <QFileInfo>
+#include <QReadWriteLock>
 #include <QStandardPaths>
 #include <QTimeZone>
 
@@ -14,6 +15,11 @@ namespace FileUtil {
 
 Q_STATIC_ASSERT(sizeof(wchar_t) == sizeof(QChar));
 
+constexpr int DRIVES_COUNT = 26;
+
+static QReadWriteLock g_driveKernelNamesLock;
+static QStringList g_driveKernelNames; // by drive indexes, empty when not cached
+
 QString systemAppDescription()
 {
     return QStringLiteral("NT Kernel & System");
@@ -106,13 +112,77 @@ quint32 driveMaskByPath(const QString &path)
     return 1U << (c - 'A');
 }
 
+static QString queryDriveKernelName(const QString &drive)
+{
+    char driveName[3] = { drive.at(0).toLatin1(), ':', '\0' };
+
+    char buf[MAX_PATH];
+    const int len = QueryDosDeviceA((LPCSTR) driveName, buf, MAX_PATH);
+
+    return (len > 0) ? QString::fromLatin1(buf) : QString();
+}
+
+QStringList driveKernelNames(quint32 driveMask)
+{
+    QStringList kernelNames;
+    kernelNames.reserve(DRIVES_COUNT);
+
+    for (int i = 0; i < DRIVES_COUNT; ++i) {
+        const bool exists = (driveMask & (1u << i)) != 0;
+
+        kernelNames.append(exists ? queryDriveKernelName(QChar('A' + i)) : QString());
+    }
+
+    return kernelNames;
+}
+
+void setDriveKernelNames(const QStringList &kernelNames)
+{
+    QWriteLocker locker(&g_driveKernelNamesLock);
+
+    g_driveKernelNames = kernelNames;
+}
+
+// Lookup the drive of the longest DOS device name, which is the kernel path's prefix
+static bool lookupKernelPathDrive(
+        const StringView kernelPath, QString &driveName, int &kernelNameSize)
+{
+    QReadLocker locker(&g_driveKernelNamesLock);
+
+    if (g_driveKernelNames.isEmpty())
+        return false;
+
+    kernelNameSize = 0;
+
+    const int count = g_driveKernelNames.size();
+    for (int i = 0; i < count; ++i) {
+        const QString &kernelName = g_driveKernelNames[i];
+        const int size = kernelName.size();
+
+        if (size <= kernelNameSize || kernelPath.size() < size
+                || !kernelPath.startsWith(kernelName, Qt::CaseInsensitive))
+            continue;
+
+        if (kernelPath.size() > size && kernelPath.at(size) != QLatin1Char('\\'))
+            continue;
+
+        driveName = QString(QChar('A' + i)) + QLatin1Char(':');
+        kernelNameSize = size;
+    }
+
+    return true;
+}
+
 // Convert "\\Device\\HarddiskVolume1" to "C:"
-QString kernelNameToDrive(const QString &kernelName)
+QString kernelNameToDrive(const StringView kernelName)
 {
     if (kernelName.isEmpty())
         return QString();
 
-    const QString kernelNameLower = kernelName.toLower();
+    QString driveName;
+    int kernelNameSize;
+    if (lookupKernelPathDrive(kernelName, driveName, kernelNameSize))
+        return (kernelNameSize == kernelName.size()) ? driveName : QString();
 
     const auto drives = QDir::drives();
 
@@ -120,7 +190,7 @@ QString kernelNameToDrive(const QString &kernelName)
         const QString driveName = fi.path().left(2);
         const QString driveKernelName = driveToKernelName(driveName);
 
-        if (kernelNameLower == driveKernelName.toLower()) {
+        if (kernelName.compare(driveKernelName, Qt::CaseInsensitive) == 0) {
             return driveName;
         }
     }
@@ -130,35 +200,46 @@ QString kernelNameToDrive(const QString &kernelName)
 // Convert "C:" to "\\Device\\HarddiskVolume1"
 QString driveToKernelName(const QString &drive)
 {
-    char driveName[3] = { drive.at(0).toLatin1(), ':', '\0' };
+    {
+        QReadLocker locker(&g_driveKernelNamesLock);
 
-    char buf[MAX_PATH];
-    const int len = QueryDosDeviceA((LPCSTR) driveName, buf, MAX_PATH);
+        if (!g_driveKernelNames.isEmpty()) {
+            const int index = drive.at(0).toUpper().unicode() - 'A';
+            return g_driveKernelNames.value(index);
+        }
+    }
 
-    return (len > 0) ? QString::fromLatin1(buf) : QString();
+    return queryDriveKernelName(drive);
 }
 
-inline QString getKernelName(const QString &kernelPath)
+inline StringView getKernelName(const StringView kernelPath)
 {
     const QLatin1Char sep('\\');
 
     if (kernelPath.startsWith(sep)) {
-        const int sepPos1 = kernelPath.indexOf(sep, 1);
+        const int sepPos1 = int(kernelPath.indexOf(sep, 1));
         if (sepPos1 > 0) {
-            const int sepPos2 = kernelPath.indexOf(sep, sepPos1 + 1);
+            const int sepPos2 = int(kernelPath.indexOf(sep, sepPos1 + 1));
             if (sepPos2 > 0) {
                 return kernelPath.left(sepPos2);
             }
         }
     }
 
-    return QString();
+    return StringView();
 }
 
 // Convert "\\Device\\HarddiskVolume1\\path" to "C:\\path"
 QString kernelPathToPath(const QString &kernelPath)
 {
-    const QString kernelName = getKernelName(kernelPath);
+    QString cachedDriveName;
+    int kernelNameSize;
+    if (lookupKernelPathDrive(kernelPath, cachedDriveName, kernelNameSize)) {
+        return (kernelNameSize != 0) ? cachedDriveName + kernelPath.mid(kernelNameSize)
+                                     : kernelPath;
+    }
+
+    const StringView kernelName = getKernelName(kernelPath);
     const QString driveName = kernelNameToDrive(kernelName);
 
     if (!driveName.isEmpty()) {
@@ -346,6 +427,31 @@ QDateTime fileModTime(const QString &filePath)
     );
 }
 
+QByteArray fileId(const QString &filePath)
+{
+    const DWORD shareMode = FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE;
+    const HANDLE fileHandle = CreateFileW((LPCWSTR) toNativeSeparators(filePath).utf16(),
+            FILE_READ_ATTRIBUTES, shareMode, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS,
+            nullptr);
+
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return {};
+
+    FILE_ID_INFO info;
+    const bool ok = GetFileInformationByHandleEx(fileHandle, FileIdInfo, &info, sizeof(info));
+
+    CloseHandle(fileHandle);
+
+    if (!ok)
+        return {};
+
+    QByteArray res(sizeof(info.VolumeSerialNumber) + sizeof(info.FileId), Qt::Uninitialized);
+    memcpy(res.data(), &info.VolumeSerialNumber, sizeof(info.VolumeSerialNumber));
+    memcpy(res.data() + sizeof(info.VolumeSerialNumber), &info.FileId, sizeof(info.FileId));
+
+    return res;
+}
+
 QString expandPath(const QString &path)
 {
     constexpr int maxPathSize = 4096;
@@ -4,6 +4,8 @@
 #include <QDateTime>
 #include <QObject>
 
+#include <fortcompat.h>
+
 namespace FileUtil {
 
 QString systemAppDescription();
@@ -21,8 +23,14 @@ quint32 mountedDriveMask(quint32 driveMask);
 
 quint32 driveMaskByPath(const QString &path);
 
+// DOS device names of the drives (A: .. Z:) by indexes, or empty ones of the absent drives
+QStringList driveKernelNames(quint32 driveMask);
+
+// Cache the DOS device names of the drives for the paths' conversions; empty to not cache
+void setDriveKernelNames(const QStringList &kernelNames);
+
 // Convert DOS device name to drive letter (A: .. Z:)
-QString kernelNameToDrive(const QString &kernelName);
+QString kernelNameToDrive(const StringView kernelName);
 
 // Convert drive letter (A: .. Z:) to DOS device name
 QString driveToKernelName(const QString &drive);
@@ -60,6 +68,10 @@ bool writeFileData(const QString &filePath, const QByteArray &data);
 
 QDateTime fileModTime(const QString &filePath);
 
+// Volume's serial number (8 bytes) & 128-bit id of the file, the same by all of its paths;
+// empty on error
+QByteArray fileId(const QString &filePath);
+
 QString expandPath(const QString &path);
 
 bool setCurrentDirectory(const QString &path);
@@ -1,11 +1,17 @@
 #include "ioccontainer.h"
 
+#include <QElapsedTimer>
 #include <QLoggingCategory>
+#include <QStringList>
 
 #include "iocservice.h"
 
 namespace {
+
 const QLoggingCategory LC("util.ioc.iocContainer");
+
+constexpr int SETUP_SLOWEST_COUNT = 5;
+
 }
 
 int IocContainer::g_tlsIndex = -1;
@@ -17,7 +23,7 @@ IocContainer::~IocContainer()
     autoDeleteAll();
 }
 
-void IocContainer::setObject(int typeId, IocObject *obj, quint8 flags)
+void IocContainer::setObject(int typeId, IocObject *obj, quint8 flags, const char *typeName)
 {
     const int newSize = typeId + 1;
     if (newSize > m_size) {
@@ -33,6 +39,7 @@ void IocContainer::setObject(int typeId, IocObject *obj, quint8 flags)
 
     Q_ASSERT(obj || flags == 0);
     m_objectFlags[typeId] = flags;
+    m_typeNames[typeId] = typeName;
 }
 
 void IocContainer::setUpAll()
@@ -40,6 +47,34 @@ void IocContainer::setUpAll()
     for (int i = 0; i < m_size; ++i) {
         setUp(i);
     }
+
+    logSetUpTimes();
+}
+
+void IocContainer::logSetUpTimes() const
+{
+    QVector<int> typeIds;
+    for (int i = 0; i < m_size; ++i) {
+        if (m_setUpNsecs[i] != 0) {
+            typeIds.append(i);
+        }
+    }
+
+    std::sort(typeIds.begin(), typeIds.end(),
+            [&](int a, int b) { return m_setUpNsecs[a] > m_setUpNsecs[b]; });
+
+    if (typeIds.size() > SETUP_SLOWEST_COUNT) {
+        typeIds.resize(SETUP_SLOWEST_COUNT);
+    }
+
+    QStringList slowest;
+    for (const int typeId : typeIds) {
+        slowest.append(QLatin1String(m_typeNames[typeId] ? m_typeNames[typeId] : "?") + ": "
+                + QString::number(m_setUpNsecs[typeId] / 1000000) + " ms");
+    }
+
+    qCDebug(LC) << "Set up:" << (m_setUpNsecsTotal / 1000000) << "ms; slowest:"
+                << slowest.join(", ");
 }
 
 void IocContainer::tearDownAll()
@@ -65,7 +100,19 @@ void IocContainer::setUp(int typeId)
     m_objectFlags[typeId] = (flags | WasSetUp);
 
     IocService *obj = resolveService(typeId);
+
+    const qint64 nsecsTotal = m_setUpNsecsTotal;
+
+    QElapsedTimer timer;
+    timer.start();
+
     obj->setUp();
+
+    // Exclude the nested dependencies' own times
+    const qint64 nsecs = timer.nsecsElapsed() - (m_setUpNsecsTotal - nsecsTotal);
+
+    m_setUpNsecs[typeId] = nsecs;
+    m_setUpNsecsTotal += nsecs;
 }
 
 void IocContainer::tearDown(int typeId)
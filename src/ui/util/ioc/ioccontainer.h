@@ -3,6 +3,8 @@
 
 #include <QObject>
 
+#include <typeinfo>
+
 #define WIN32_LEAN_AND_MEAN
 #include <qt_windows.h>
 
@@ -45,7 +47,7 @@ public:
     {
         auto svc = static_cast<IocService *>(obj);
         Q_ASSERT(svc);
-        setObject(getTypeId<T>(), svc, flags);
+        setObject(getTypeId<T>(), svc, flags, typeid(T).name());
     }
 
     template<class T>
@@ -93,7 +95,9 @@ public:
     }
 
 private:
-    void setObject(int typeId, IocObject *obj, quint8 flags = 0);
+    void setObject(int typeId, IocObject *obj, quint8 flags = 0, const char *typeName = nullptr);
+
+    void logSetUpTimes() const;
 
     inline IocObject *resolveObject(int typeId) const { return m_objects[typeId]; }
     inline IocService *resolveService(int typeId) const
@@ -115,8 +119,14 @@ private:
 
     int m_size = 0;
 
+    qint64 m_setUpNsecsTotal = 0;
+
     quint8 m_objectFlags[IOC_MAX_SIZE] = {};
     IocObject *m_objects[IOC_MAX_SIZE] = {};
+
+    // Of the services' own setUp(), without their dependencies
+    qint64 m_setUpNsecs[IOC_MAX_SIZE] = {};
+    const char *m_typeNames[IOC_MAX_SIZE] = {};
 };
 
 template<class T>
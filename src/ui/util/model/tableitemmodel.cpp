@@ -42,7 +42,7 @@ void TableItemModel::resetLater()
     if (!m_resetTimer) {
         m_resetTimer = new TriggerTimer(this);
 
-        connect(m_resetTimer, &QTimer::timeout, this, &TableItemModel::reset);
+        connect(m_resetTimer, &TriggerTimer::timeout, this, &TableItemModel::reset);
     }
 
     m_resetTimer->startTrigger();
@@ -56,6 +56,7 @@ Qt::ItemFlags TableItemModel::flagIsUserCheckable(const QModelIndex & /*index*/)
 void TableItemModel::reset()
 {
     beginResetModel();
+    invalidateRowCount();
     invalidateRowCache();
     endResetModel();
 }
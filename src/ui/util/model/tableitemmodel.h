@@ -39,6 +39,7 @@ protected:
     virtual Qt::ItemFlags flagIsUserCheckable(const QModelIndex &index) const;
 
     virtual void invalidateRowCache();
+    virtual void invalidateRowCount() { }
     void updateRowCache(int row) const;
 
     virtual bool updateTableRow(int row) const = 0;
@@ -28,11 +28,16 @@ void TableSqlModel::sort(int column, Qt::SortOrder order)
 
 void TableSqlModel::invalidateRowCache()
 {
-    m_rowCount = -1;
     TableItemModel::invalidateRowCache();
     emit modelChanged();
 }
 
+void TableSqlModel::invalidateRowCount()
+{
+    // The refreshed rows keep their count
+    m_rowCount = -1;
+}
+
 void TableSqlModel::fillSqlVars(QVariantList &vars) const
 {
     Q_UNUSED(vars);
@@ -23,6 +23,7 @@ signals:
 
 protected:
     void invalidateRowCache() override;
+    void invalidateRowCount() override;
 
     virtual void fillSqlVars(QVariantList &vars) const;
 
@@ -1,7 +1,6 @@
 #include "iprange.h"
 
 #include <QHash>
-#include <QRegularExpression>
 
 #include <util/stringutil.h>
 
@@ -19,6 +18,46 @@ inline bool checkIp6MaskBitsCount(const int nbits)
     return (nbits >= 0 && nbits <= 128);
 }
 
+inline bool isIp4Char(const QChar c)
+{
+    return c.isDigit() || c == '.';
+}
+
+inline bool isIp6Char(const QChar c)
+{
+    return c.isDigit() || c == ':' || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+qsizetype skipIpChars(const StringView line, qsizetype pos, bool isIPv6)
+{
+    const qsizetype size = line.size();
+
+    if (isIPv6) {
+        while (pos < size && isIp6Char(line.at(pos)))
+            ++pos;
+    } else {
+        while (pos < size && isIp4Char(line.at(pos)))
+            ++pos;
+    }
+
+    return pos;
+}
+
+qsizetype skipSpaces(const StringView line, qsizetype pos, bool isSpace = true)
+{
+    const qsizetype size = line.size();
+
+    while (pos < size && line.at(pos).isSpace() == isSpace)
+        ++pos;
+
+    return pos;
+}
+
+inline qsizetype skipNonSpaces(const StringView line, qsizetype pos)
+{
+    return skipSpaces(line, pos, /*isSpace=*/false);
+}
+
 bool compareLessIp6(const ip6_addr_t &l, const ip6_addr_t &r)
 {
     return memcmp(&l, &r, sizeof(ip6_addr_t)) < 0;
@@ -138,7 +177,7 @@ bool IpRange::fromList(const StringViewList &list, bool sort)
 {
     clear();
 
-    ip4range_map_t ip4RangeMap;
+    ip4_pair_arr_t ip4Pairs;
     int pair4Size = 0;
 
     int lineNo = 0;
@@ -149,7 +188,7 @@ bool IpRange::fromList(const StringViewList &list, bool sort)
         if (lineTrimmed.isEmpty() || lineTrimmed.startsWith('#')) // commented line
             continue;
 
-        if (parseIpLine(line, ip4RangeMap, pair4Size) != ErrorOk) {
+        if (parseIpLine(line, ip4Pairs, pair4Size) != ErrorOk) {
             setErrorDetails(errorDetails() + (errorDetails().isEmpty() ? QString() : QString(' '))
                     + QString("line='%1'").arg(line));
             setErrorLineNo(lineNo);
@@ -157,7 +196,7 @@ bool IpRange::fromList(const StringViewList &list, bool sort)
         }
     }
 
-    fillIp4Range(ip4RangeMap, pair4Size);
+    fillIp4Range(ip4Pairs, pair4Size);
 
     if (sort) {
         sortIp6Array(m_ip6Array);
@@ -170,23 +209,27 @@ bool IpRange::fromList(const StringViewList &list, bool sort)
 }
 
 IpRange::ParseError IpRange::parseIpLine(
-        const StringView line, ip4range_map_t &ip4RangeMap, int &pair4Size)
+        const StringView line, ip4_pair_arr_t &ip4Pairs, int &pair4Size)
 {
-    static const QRegularExpression ip4Re(R"(^([\d.]+)\s*([\/-]?)\s*(\S*))");
-    static const QRegularExpression ip6Re(R"(^([A-Fa-f\d:]+)\s*([\/-]?)\s*(\S*))");
-
     const bool isIPv6 = !line.contains('.');
-    const QRegularExpression &re = isIPv6 ? ip6Re : ip4Re;
 
-    const auto match = matchRegExp(re, line);
-    if (!match.hasMatch()) {
+    // Split the "<ip> [<sep> <mask>]" by hand, the lines of zones may be counted by millions
+    const qsizetype ipEnd = skipIpChars(line, 0, isIPv6);
+    if (ipEnd == 0) {
         setErrorMessage(tr("Bad format"));
         return ErrorBadFormat;
     }
 
-    const auto ip = match.captured(1);
-    const auto sepStr = match.capturedView(2);
-    const auto mask = match.captured(3);
+    const qsizetype sepPos = skipSpaces(line, ipEnd);
+    const qsizetype sepLen =
+            (sepPos < line.size() && (line.at(sepPos) == '/' || line.at(sepPos) == '-')) ? 1 : 0;
+
+    const qsizetype maskPos = skipSpaces(line, sepPos + sepLen);
+    const qsizetype maskEnd = skipNonSpaces(line, maskPos);
+
+    const auto ip = line.left(ipEnd).toString();
+    const auto sepStr = line.mid(sepPos, sepLen);
+    const auto mask = line.mid(maskPos, maskEnd - maskPos).toString();
 
     if (sepStr.isEmpty() != mask.isEmpty()) {
         setErrorMessage(tr("Bad mask"));
@@ -197,11 +240,11 @@ IpRange::ParseError IpRange::parseIpLine(
     const char maskSep = sepStr.isEmpty() ? '\0' : sepStr.at(0).toLatin1();
 
     return isIPv6 ? parseIp6Address(ip, mask, maskSep)
-                  : parseIp4Address(ip, mask, ip4RangeMap, pair4Size, maskSep);
+                  : parseIp4Address(ip, mask, ip4Pairs, pair4Size, maskSep);
 }
 
 IpRange::ParseError IpRange::parseIp4Address(const QString &ip, const QString &mask,
-        ip4range_map_t &ip4RangeMap, int &pair4Size, char maskSep)
+        ip4_pair_arr_t &ip4Pairs, int &pair4Size, char maskSep)
 {
     quint32 from, to = 0;
 
@@ -217,7 +260,7 @@ IpRange::ParseError IpRange::parseIp4Address(const QString &ip, const QString &m
     if (err != ErrorOk)
         return err;
 
-    ip4RangeMap.insert(from, to);
+    ip4Pairs.append(Ip4Pair { from, to });
 
     if (from != to) {
         ++pair4Size;
@@ -357,25 +400,24 @@ IpRange::ParseError IpRange::parseIp6AddressMaskPrefix(
     return ErrorOk;
 }
 
-void IpRange::fillIp4Range(const ip4range_map_t &ipRangeMap, int pairSize)
+void IpRange::fillIp4Range(ip4_pair_arr_t &ipPairs, int pairSize)
 {
-    if (ipRangeMap.isEmpty())
+    if (ipPairs.isEmpty())
         return;
 
-    const int mapSize = ipRangeMap.size();
-    m_ip4Array.reserve(mapSize - pairSize);
+    // Sort the flat array instead of a map's node per address
+    std::sort(ipPairs.begin(), ipPairs.end(), [](const Ip4Pair &l, const Ip4Pair &r) {
+        return l.from < r.from || (l.from == r.from && l.to > r.to);
+    });
+
+    m_ip4Array.reserve(ipPairs.size() - pairSize);
     m_pair4FromArray.reserve(pairSize);
     m_pair4ToArray.reserve(pairSize);
 
     Ip4Pair prevIp;
     int prevIndex = -1;
 
-    auto it = ipRangeMap.constBegin();
-    auto end = ipRangeMap.constEnd();
-
-    for (; it != end; ++it) {
-        Ip4Pair ip { it.key(), it.value() };
-
+    for (const Ip4Pair &ip : asConst(ipPairs)) {
         // try to merge colliding addresses
         if (prevIndex >= 0 && ip.from <= prevIp.to + 1) {
             if (ip.to > prevIp.to) {
@@ -385,7 +427,9 @@ void IpRange::fillIp4Range(const ip4range_map_t &ipRangeMap, int pairSize)
             }
             // else skip it
         } else if (ip.from == ip.to) {
-            m_ip4Array.append(ip.from);
+            if (m_ip4Array.isEmpty() || m_ip4Array.last() != ip.from) {
+                m_ip4Array.append(ip.from); // skip the duplicates
+            }
         } else {
             m_pair4FromArray.append(ip.from);
             m_pair4ToArray.append(ip.to);
@@ -1,7 +1,6 @@
 #ifndef IPRANGE_H
 #define IPRANGE_H
 
-#include <QMap>
 #include <QObject>
 #include <QVector>
 
@@ -18,7 +17,7 @@ using Ip6Pair = struct
     ip6_addr_t from, to;
 };
 
-using ip4range_map_t = QMap<quint32, quint32>;
+using ip4_pair_arr_t = QVector<Ip4Pair>;
 using ip4_arr_t = QVector<quint32>;
 
 using ip6_pair_arr_t = QVector<Ip6Pair>;
@@ -103,10 +102,10 @@ private:
     void setErrorDetails(const QString &errorDetails);
 
     IpRange::ParseError parseIpLine(
-            const StringView line, ip4range_map_t &ip4RangeMap, int &pair4Size);
+            const StringView line, ip4_pair_arr_t &ip4Pairs, int &pair4Size);
 
     IpRange::ParseError parseIp4Address(const QString &ip, const QString &mask,
-            ip4range_map_t &ip4RangeMap, int &pair4Size, char maskSep);
+            ip4_pair_arr_t &ip4Pairs, int &pair4Size, char maskSep);
 
     IpRange::ParseError parseIp4AddressMask(
             const QString &mask, quint32 &from, quint32 &to, char maskSep);
@@ -121,7 +120,7 @@ private:
     IpRange::ParseError parseIp6AddressMaskPrefix(
             const QString &mask, ip6_addr_t &from, ip6_addr_t &to, bool &hasMask);
 
-    void fillIp4Range(const ip4range_map_t &ipRangeMap, int pairSize);
+    void fillIp4Range(ip4_pair_arr_t &ipPairs, int pairSize);
 
 private:
     qint8 m_emptyNetMask = 32;
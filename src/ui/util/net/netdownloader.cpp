@@ -37,11 +37,17 @@ void NetDownloader::start()
     m_aborted = false;
 
     m_buffer.clear();
+    m_lastModified = {};
 
     m_downloadTimer.start();
 
     QNetworkRequest request(url());
 
+    // The not modified response has no content
+    if (m_ifModifiedSince.isValid()) {
+        request.setHeader(QNetworkRequest::IfModifiedSinceHeader, m_ifModifiedSince);
+    }
+
     if (!m_data.isEmpty()) {
         request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
         m_reply = m_manager->post(request, data());
@@ -76,11 +82,22 @@ void NetDownloader::finish(bool success)
     emit finished(success);
 }
 
-void NetDownloader::onDownloadProgress(qint64 bytesReceived, qint64 /*bytesTotal*/)
+void NetDownloader::onDownloadProgress(qint64 bytesReceived, qint64 bytesTotal)
 {
     if (m_aborted || bytesReceived == 0)
         return;
 
+    if (bytesTotal > 0 && m_buffer.isEmpty()) {
+        if (bytesTotal > DOWNLOAD_MAXSIZE) {
+            qCWarning(LC) << "NetDownloader: Error: Too big file:" << bytesTotal;
+            finish();
+            return;
+        }
+
+        // Don't re-allocate the buffer per chunk
+        m_buffer.reserve(bytesTotal);
+    }
+
     const QByteArray data = m_reply->read(DOWNLOAD_MAXSIZE - m_buffer.size());
 
     m_buffer.append(data);
@@ -94,6 +111,10 @@ void NetDownloader::onFinished()
 {
     const bool success = (m_reply->error() == QNetworkReply::NoError);
 
+    if (success) {
+        m_lastModified = m_reply->header(QNetworkRequest::LastModifiedHeader).toDateTime();
+    }
+
     finish(success && !m_buffer.isEmpty());
 }
 
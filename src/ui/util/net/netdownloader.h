@@ -1,6 +1,7 @@
 #ifndef NETDOWNLOADER_H
 #define NETDOWNLOADER_H
 
+#include <QDateTime>
 #include <QNetworkReply>
 #include <QObject>
 #include <QTimer>
@@ -21,6 +22,11 @@ public:
     QByteArray data() const { return m_data; }
     void setData(const QByteArray &data) { m_data = data; }
 
+    QDateTime ifModifiedSince() const { return m_ifModifiedSince; }
+    void setIfModifiedSince(const QDateTime &v) { m_ifModifiedSince = v; }
+
+    QDateTime lastModified() const { return m_lastModified; }
+
     QByteArray buffer() const { return m_buffer; }
     void setBuffer(const QByteArray &buffer) { m_buffer = buffer; }
 
@@ -46,6 +52,9 @@ private:
     QString m_url;
     QByteArray m_data;
 
+    QDateTime m_ifModifiedSince;
+    QDateTime m_lastModified;
+
     QByteArray m_buffer;
 
     QTimer m_downloadTimer;
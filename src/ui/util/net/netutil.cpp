@@ -5,6 +5,8 @@
 #define WIN32_LEAN_AND_MEAN
 #include <ws2tcpip.h>
 
+#include <windns.h>
+
 struct sock_addr
 {
     union {
@@ -153,20 +155,75 @@ QString NetUtil::formatSpeed(quint32 bitsPerSecond)
     return text + QLatin1String("ps");
 }
 
-QString NetUtil::getHostName(const QString &address)
+QString NetUtil::ptrQueryName(const QString &address)
 {
-    WCHAR hostName[NI_MAXHOST];
-
-    struct sockaddr_in sa;
-    memset(&sa, 0, sizeof(struct sockaddr_in));
-    sa.sin_family = AF_INET;
-    sa.sin_addr.s_addr = htonl(textToIp4(address));
+    bool ok = false;
+
+    if (!address.contains(':')) {
+        const quint32 ip = textToIp4(address, &ok);
+        if (!ok)
+            return QString();
+
+        return QString("%1.%2.%3.%4.in-addr.arpa")
+                .arg(ip & 0xFF)
+                .arg((ip >> 8) & 0xFF)
+                .arg((ip >> 16) & 0xFF)
+                .arg(ip >> 24);
+    }
 
-    if (GetNameInfoW((struct sockaddr *) &sa, sizeof(struct sockaddr), hostName, NI_MAXHOST,
-                nullptr, 0, 0))
+    const ip6_addr_t ip = textToIp6(address, &ok);
+    if (!ok)
         return QString();
 
-    return QString::fromWCharArray(hostName);
+    static const char hexDigits[] = "0123456789abcdef";
+
+    QString name;
+    name.reserve(16 * 4 + 8);
+
+    for (int i = 15; i >= 0; --i) {
+        const quint8 b = quint8(ip.data[i]);
+
+        name += QLatin1Char(hexDigits[b & 0x0F]);
+        name += QLatin1Char('.');
+        name += QLatin1Char(hexDigits[b >> 4]);
+        name += QLatin1Char('.');
+    }
+
+    return name + QLatin1String("ip6.arpa");
+}
+
+quint32 NetUtil::resolveHostAddresses(const QString &hostName, QStringList &addresses)
+{
+    quint32 ttlSecs = 0;
+
+    const auto name = (LPCWSTR) hostName.utf16();
+
+    for (const WORD type : { DNS_TYPE_A, DNS_TYPE_AAAA }) {
+        PDNS_RECORD records = nullptr;
+
+        if (DnsQuery_W(name, type, DNS_QUERY_STANDARD, nullptr, &records, nullptr) != 0)
+            continue;
+
+        for (PDNS_RECORD r = records; r != nullptr; r = r->pNext) {
+            if (r->wType != type) // CNAME
+                continue;
+
+            if (type == DNS_TYPE_A) {
+                addresses.append(ip4ToText(ntohl(r->Data.A.IpAddress)));
+            } else {
+                ip6_addr_t ip;
+                memcpy(ip.data, &r->Data.AAAA.Ip6Address, sizeof(ip.data));
+
+                addresses.append(ip6ToText(ip));
+            }
+
+            ttlSecs = (ttlSecs == 0) ? r->dwTtl : qMin<quint32>(ttlSecs, r->dwTtl);
+        }
+
+        DnsRecordListFree(records, DnsFreeRecordList);
+    }
+
+    return ttlSecs;
 }
 
 QStringList NetUtil::localIpNetworks()
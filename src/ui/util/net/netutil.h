@@ -36,7 +36,11 @@ public:
     static QString formatDataSize1(qint64 bytes);
     static QString formatSpeed(quint32 bitsPerSecond);
 
-    static QString getHostName(const QString &address);
+    // Of the reverse lookup: "1.0.0.127.in-addr.arpa" or the nibbles' "...ip6.arpa"
+    static QString ptrQueryName(const QString &address);
+
+    // Resolve the IPv4 & IPv6 addresses, returns their records' minimal TTL in seconds
+    static quint32 resolveHostAddresses(const QString &hostName, QStringList &addresses);
 
     static QStringList localIpNetworks();
     static QString localIpNetworksText();
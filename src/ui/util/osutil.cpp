@@ -11,6 +11,7 @@
 #include <qt_windows.h>
 
 #include <lmcons.h>
+#include <wtsapi32.h>
 
 #include "processinfo.h"
 
@@ -106,6 +107,29 @@ QString OsUtil::userName()
     return QString();
 }
 
+QString OsUtil::sessionUserName(quint32 sessionId)
+{
+    const auto querySessionText = [&](WTS_INFO_CLASS infoClass) -> QString {
+        LPWSTR buf = nullptr;
+        DWORD len = 0;
+        if (!WTSQuerySessionInformationW(
+                    WTS_CURRENT_SERVER_HANDLE, sessionId, infoClass, &buf, &len))
+            return QString();
+
+        const QString text = QString::fromWCharArray(buf);
+        WTSFreeMemory(buf);
+        return text;
+    };
+
+    const QString user = querySessionText(WTSUserName);
+    if (user.isEmpty())
+        return QString(); // no interactive logon
+
+    const QString domain = querySessionText(WTSDomainName);
+
+    return domain.isEmpty() ? user : (domain + '\\' + user);
+}
+
 bool OsUtil::isUserAdmin()
 {
     SID_IDENTIFIER_AUTHORITY idAuth = SECURITY_NT_AUTHORITY;
@@ -23,12 +23,13 @@ public:
         DefaultCreate = (ReadWrite | Create | Native64Key)
     };
 
-    // Sync with REG_NOTIFY_CHANGE_*
-    enum NotifyFlag : qint8 {
+    // Sync with REG_NOTIFY_CHANGE_* & REG_NOTIFY_THREAD_AGNOSTIC
+    enum NotifyFlag : quint32 {
         NotifyChangeName = 0x01,
         NotifyChangeAttributes = 0x02,
         NotifyChangeLastSet = 0x04,
         NotifyChangeSecurity = 0x08,
+        NotifyThreadAgnostic = 0x10000000, // keep the notification after the thread's exit
     };
 
 protected:
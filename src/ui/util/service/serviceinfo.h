@@ -27,6 +27,7 @@ public:
     Type serviceType = TypeUnknown;
     quint16 trackFlags = 0;
     quint32 processId = 0;
+    quint32 serviceTag = 0; // of the shared process's threads, 0 if unknown
     QString serviceName;
     QString displayName;
 };
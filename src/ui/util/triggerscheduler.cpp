@@ -0,0 +1,93 @@
+#include "triggerscheduler.h"
+
+#include <limits>
+
+#include <QPointer>
+#include <QThread>
+#include <QVarLengthArray>
+
+#include "triggertimer.h"
+
+TriggerScheduler::TriggerScheduler(QObject *parent) : QObject(parent)
+{
+    m_clock.start();
+
+    m_timer.setSingleShot(true);
+
+    connect(&m_timer, &QTimer::timeout, this, &TriggerScheduler::onWakeup);
+}
+
+TriggerScheduler *TriggerScheduler::instance()
+{
+    static thread_local TriggerScheduler *g_scheduler = nullptr;
+
+    if (!g_scheduler) {
+        g_scheduler = new TriggerScheduler();
+
+        connect(QThread::currentThread(), &QThread::finished, g_scheduler, &QObject::deleteLater);
+    }
+
+    return g_scheduler;
+}
+
+void TriggerScheduler::addTrigger(TriggerTimer *trigger)
+{
+    m_triggers.append(trigger);
+
+    scheduleWakeup();
+}
+
+void TriggerScheduler::removeTrigger(TriggerTimer *trigger)
+{
+    m_triggers.removeOne(trigger);
+
+    if (m_triggers.isEmpty()) {
+        m_timer.stop();
+    }
+}
+
+void TriggerScheduler::onWakeup()
+{
+    ++m_wakeupCount;
+
+    const qint64 now = nowMsecs();
+
+    // Take the ready triggers, their handlers may add or delete the triggers
+    QVarLengthArray<QPointer<TriggerTimer>, 16> readyTriggers;
+
+    m_triggers.removeIf([&](TriggerTimer *trigger) {
+        if (trigger->minDeadline() > now)
+            return false;
+
+        readyTriggers.append(trigger);
+        return true;
+    });
+
+    for (const QPointer<TriggerTimer> &trigger : std::as_const(readyTriggers)) {
+        if (trigger) {
+            ++m_firedCount;
+            trigger->fire();
+        }
+    }
+
+    scheduleWakeup();
+}
+
+void TriggerScheduler::scheduleWakeup()
+{
+    if (m_triggers.isEmpty())
+        return;
+
+    // The latest min. deadline, to fire all at once, but not later than any max. deadline
+    qint64 minMaxDeadline = std::numeric_limits<qint64>::max();
+    qint64 maxMinDeadline = 0;
+
+    for (const TriggerTimer *trigger : std::as_const(m_triggers)) {
+        minMaxDeadline = qMin(minMaxDeadline, trigger->maxDeadline());
+        maxMinDeadline = qMax(maxMinDeadline, trigger->minDeadline());
+    }
+
+    const qint64 wakeupMsecs = qMin(minMaxDeadline, maxMinDeadline);
+
+    m_timer.start(int(qMax(wakeupMsecs - nowMsecs(), qint64(0))));
+}
@@ -0,0 +1,47 @@
+#ifndef TRIGGERSCHEDULER_H
+#define TRIGGERSCHEDULER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QTimer>
+
+class TriggerTimer;
+
+// Fires the thread's pending triggers by one wakeup, within their min. & max. intervals
+class TriggerScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TriggerScheduler(QObject *parent = nullptr);
+
+    static TriggerScheduler *instance(); // of the current thread
+
+    qint64 nowMsecs() const { return m_clock.elapsed(); }
+
+    int pendingCount() const { return m_triggers.size(); }
+
+    qint64 wakeupCount() const { return m_wakeupCount; }
+    qint64 firedCount() const { return m_firedCount; }
+
+    void addTrigger(TriggerTimer *trigger);
+    void removeTrigger(TriggerTimer *trigger);
+
+private slots:
+    void onWakeup();
+
+private:
+    void scheduleWakeup();
+
+private:
+    qint64 m_wakeupCount = 0;
+    qint64 m_firedCount = 0;
+
+    QElapsedTimer m_clock;
+    QTimer m_timer;
+
+    QList<TriggerTimer *> m_triggers;
+};
+
+#endif // TRIGGERSCHEDULER_H
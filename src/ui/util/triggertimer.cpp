@@ -1,16 +1,49 @@
 #include "triggertimer.h"
 
+#include "triggerscheduler.h"
+
 TriggerTimer::TriggerTimer(QObject *parent) : TriggerTimer(/*interval=*/DefaultInterval, parent) { }
 
-TriggerTimer::TriggerTimer(int interval, QObject *parent) : QTimer(parent)
+TriggerTimer::TriggerTimer(int interval, QObject *parent) : QObject(parent), m_interval(interval)
 {
-    setSingleShot(true);
-    setInterval(interval);
+}
+
+TriggerTimer::~TriggerTimer()
+{
+    stop();
 }
 
 void TriggerTimer::startTrigger()
 {
-    if (!isActive()) {
-        start();
+    ++m_triggerCount;
+
+    if (isActive())
+        return;
+
+    if (!m_scheduler) {
+        m_scheduler = TriggerScheduler::instance();
     }
+
+    m_triggerMsecs = m_scheduler->nowMsecs();
+
+    m_scheduler->addTrigger(this);
+}
+
+void TriggerTimer::stop()
+{
+    if (!isActive())
+        return;
+
+    m_triggerMsecs = -1;
+
+    m_scheduler->removeTrigger(this);
+}
+
+void TriggerTimer::fire()
+{
+    m_triggerMsecs = -1;
+
+    ++m_fireCount;
+
+    emit timeout();
 }
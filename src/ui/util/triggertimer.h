@@ -1,9 +1,14 @@
 #ifndef TRIGGERTIMER_H
 #define TRIGGERTIMER_H
 
-#include <QTimer>
+#include <QObject>
 
-class TriggerTimer : public QTimer
+#include <util/classhelpers.h>
+
+class TriggerScheduler;
+
+// Fired by the thread's TriggerScheduler, aligned with the other pending triggers
+class TriggerTimer : public QObject
 {
     Q_OBJECT
 
@@ -12,9 +17,47 @@ public:
 
     explicit TriggerTimer(QObject *parent = nullptr);
     explicit TriggerTimer(int interval, QObject *parent = nullptr);
+    ~TriggerTimer() override;
+    CLASS_DELETE_COPY_MOVE(TriggerTimer)
+
+    // Fired no earlier than the interval after the first trigger
+    int interval() const { return m_interval; }
+    void setInterval(int v) { m_interval = v; }
+
+    // ... and no later than the max. interval
+    int maxInterval() const { return m_maxInterval > 0 ? m_maxInterval : 2 * m_interval; }
+    void setMaxInterval(int v) { m_maxInterval = v; }
+
+    bool isActive() const { return m_triggerMsecs >= 0; }
+
+    qint64 minDeadline() const { return m_triggerMsecs + interval(); }
+    qint64 maxDeadline() const { return m_triggerMsecs + maxInterval(); }
+
+    qint64 triggerCount() const { return m_triggerCount; }
+    qint64 fireCount() const { return m_fireCount; }
+
+signals:
+    void timeout();
 
 public slots:
     void startTrigger();
+    void stop();
+
+private:
+    friend class TriggerScheduler;
+
+    void fire();
+
+private:
+    int m_interval = DefaultInterval;
+    int m_maxInterval = 0;
+
+    qint64 m_triggerMsecs = -1; // of the first pending trigger
+
+    qint64 m_triggerCount = 0;
+    qint64 m_fireCount = 0;
+
+    TriggerScheduler *m_scheduler = nullptr;
 };
 
 #endif // TRIGGERTIMER_H
@@ -1,6 +1,7 @@
 #ifndef WORKERJOB_H
 #define WORKERJOB_H
 
+#include <QElapsedTimer>
 #include <QObject>
 
 #include <util/classhelpers.h>
@@ -15,6 +16,11 @@ public:
 
     const QString &text() const { return m_text; }
 
+    // The high priority jobs are dequeued before the normal ones
+    virtual bool isHighPriority() const { return false; }
+
+    QElapsedTimer &queuedTimer() { return m_queuedTimer; }
+
     virtual bool mergeJob(const WorkerJob &job)
     {
         Q_UNUSED(job);
@@ -26,6 +32,8 @@ public:
 
 private:
     const QString m_text;
+
+    QElapsedTimer m_queuedTimer;
 };
 
 #endif // WORKERJOB_H
@@ -1,7 +1,5 @@
 #include "workermanager.h"
 
-#include <QThreadPool>
-
 #include "workerjob.h"
 #include "workerobject.h"
 
@@ -9,7 +7,10 @@ namespace {
 constexpr unsigned long WORKER_TIMEOUT_MSEC = 5000;
 }
 
-WorkerManager::WorkerManager(QObject *parent) : QObject(parent) { }
+WorkerManager::WorkerManager(QObject *parent) : QObject(parent)
+{
+    m_threadPool.setMaxThreadCount(1);
+}
 
 WorkerManager::~WorkerManager()
 {
@@ -24,7 +25,7 @@ void WorkerManager::setupWorker()
     WorkerObject *worker = createWorker(); // autoDelete = true
     m_workers.append(worker);
 
-    QThreadPool::globalInstance()->start(worker);
+    m_threadPool.start(worker);
 }
 
 bool WorkerManager::checkNewWorkerNeeded() const
@@ -34,12 +35,30 @@ bool WorkerManager::checkNewWorkerNeeded() const
     if (workersCount == 0)
         return true;
 
-    return workersCount < maxWorkersCount() && !m_jobQueue.isEmpty();
+    return workersCount < maxWorkersCount()
+            && !(m_jobQueue.isEmpty() && m_highJobQueue.isEmpty());
 }
 
 void WorkerManager::clearJobQueue()
 {
     m_jobQueue.clear();
+    m_highJobQueue.clear();
+
+    m_queueStats.queueSize = 0;
+}
+
+WorkerJobPtr WorkerManager::takeJob(QQueue<WorkerJobPtr> &jobQueue)
+{
+    WorkerJobPtr job = jobQueue.dequeue();
+
+    const qint64 waitMsecs = job->queuedTimer().elapsed();
+
+    --m_queueStats.queueSize;
+    ++m_queueStats.jobsCount;
+    m_queueStats.totalWaitMsecs += waitMsecs;
+    m_queueStats.maxWaitMsecs = qMax(m_queueStats.maxWaitMsecs, waitMsecs);
+
+    return job;
 }
 
 void WorkerManager::workerFinished(WorkerObject *worker)
@@ -48,7 +67,7 @@ void WorkerManager::workerFinished(WorkerObject *worker)
 
     m_workers.removeOne(worker);
 
-    if (m_workers.isEmpty() && aborted()) {
+    if (m_workers.isEmpty() && (aborted() || m_finishing)) {
         m_abortWaitCondition.wakeOne();
     }
 }
@@ -58,19 +77,33 @@ WorkerObject *WorkerManager::createWorker()
     return new WorkerObject(this);
 }
 
+void WorkerManager::setMaxWorkersCount(int v)
+{
+    m_maxWorkersCount = v;
+
+    m_threadPool.setMaxThreadCount(qMax(v, 1));
+}
+
+WorkerQueueStats WorkerManager::queueStats() const
+{
+    QMutexLocker locker(&m_mutex);
+
+    return m_queueStats;
+}
+
 int WorkerManager::jobCount() const
 {
     QMutexLocker locker(&m_mutex);
 
-    return m_jobQueue.size();
+    return m_queueStats.queueSize;
 }
 
-bool WorkerManager::mergeJob(WorkerJobPtr job)
+bool WorkerManager::mergeJob(QQueue<WorkerJobPtr> &jobQueue, WorkerJobPtr job)
 {
-    if (!canMergeJobs() || m_jobQueue.isEmpty())
+    if (!canMergeJobs() || jobQueue.isEmpty())
         return false;
 
-    return m_jobQueue.last()->mergeJob(*job);
+    return jobQueue.last()->mergeJob(*job);
 }
 
 void WorkerManager::clear()
@@ -95,19 +128,40 @@ void WorkerManager::abortWorkers()
     }
 }
 
+void WorkerManager::finishWorkers()
+{
+    QMutexLocker locker(&m_mutex);
+
+    // The workers exit after the queued jobs
+    m_finishing = true;
+
+    m_jobWaitCondition.wakeAll();
+
+    while (!m_workers.isEmpty()) {
+        m_abortWaitCondition.wait(&m_mutex);
+    }
+}
+
 void WorkerManager::enqueueJob(WorkerJobPtr job)
 {
     QMutexLocker locker(&m_mutex);
 
-    if (aborted())
+    if (aborted() || m_finishing)
         return;
 
     setupWorker();
 
-    if (mergeJob(job))
+    QQueue<WorkerJobPtr> &jobQueue = job->isHighPriority() ? m_highJobQueue : m_jobQueue;
+
+    if (mergeJob(jobQueue, job))
         return;
 
-    m_jobQueue.enqueue(job);
+    job->queuedTimer().start();
+
+    jobQueue.enqueue(job);
+
+    ++m_queueStats.queueSize;
+    m_queueStats.maxQueueSize = qMax(m_queueStats.maxQueueSize, m_queueStats.queueSize);
 
     m_jobWaitCondition.wakeOne();
 }
@@ -116,13 +170,13 @@ WorkerJobPtr WorkerManager::dequeueJob()
 {
     QMutexLocker locker(&m_mutex);
 
-    while (!aborted() && m_jobQueue.isEmpty()) {
+    while (!aborted() && !m_finishing && m_queueStats.queueSize == 0) {
         if (!m_jobWaitCondition.wait(&m_mutex, WORKER_TIMEOUT_MSEC))
             break; // timed out
     }
 
-    if (aborted() || m_jobQueue.isEmpty())
+    if (aborted() || m_queueStats.queueSize == 0)
         return nullptr;
 
-    return m_jobQueue.dequeue();
+    return takeJob(!m_highJobQueue.isEmpty() ? m_highJobQueue : m_jobQueue);
 }
@@ -5,6 +5,7 @@
 #include <QObject>
 #include <QQueue>
 #include <QRunnable>
+#include <QThreadPool>
 #include <QVariant>
 #include <QWaitCondition>
 
@@ -12,6 +13,16 @@
 
 #include "workertypes.h"
 
+struct WorkerQueueStats
+{
+    int queueSize = 0;
+    int maxQueueSize = 0;
+
+    qint64 jobsCount = 0;
+    qint64 totalWaitMsecs = 0;
+    qint64 maxWaitMsecs = 0;
+};
+
 class WorkerManager : public QObject
 {
     Q_OBJECT
@@ -24,13 +35,16 @@ public:
     bool aborted() const { return m_aborted; }
 
     int maxWorkersCount() const { return m_maxWorkersCount; }
-    void setMaxWorkersCount(int v) { m_maxWorkersCount = v; }
+    void setMaxWorkersCount(int v);
+
+    WorkerQueueStats queueStats() const;
 
     virtual QString workerName() const { return QString(); }
 
 public slots:
     void clear();
     void abortWorkers();
+    void finishWorkers();
 
     void enqueueJob(WorkerJobPtr job);
     WorkerJobPtr dequeueJob();
@@ -43,7 +57,7 @@ protected:
 
     int jobCount() const;
 
-    bool mergeJob(WorkerJobPtr job);
+    bool mergeJob(QQueue<WorkerJobPtr> &jobQueue, WorkerJobPtr job);
 
 private:
     void setupWorker();
@@ -52,14 +66,23 @@ private:
 
     void clearJobQueue();
 
+    WorkerJobPtr takeJob(QQueue<WorkerJobPtr> &jobQueue);
+
 private:
     volatile bool m_aborted = false;
+    bool m_finishing = false;
 
     int m_maxWorkersCount = 0;
 
     QList<WorkerObject *> m_workers;
 
     QQueue<WorkerJobPtr> m_jobQueue;
+    QQueue<WorkerJobPtr> m_highJobQueue;
+
+    WorkerQueueStats m_queueStats;
+
+    // Own pool to not wait for the other managers' workers
+    QThreadPool m_threadPool;
 
     mutable QMutex m_mutex;
     QWaitCondition m_jobWaitCondition;